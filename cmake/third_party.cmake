@@ -86,6 +86,7 @@ if(BUILD_CUDA)
   if(OF_CUDA_LINK_DYNAMIC_LIBRARY)
     list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cublas)
     list(APPEND VENDOR_CUDA_LIBRARIES CUDA::curand)
+    list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cupti)
     if(CUDA_VERSION VERSION_GREATER_EQUAL "10.1")
       list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cublasLt)
     endif()
@@ -97,6 +98,7 @@ if(BUILD_CUDA)
   else()
     list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cublas_static)
     list(APPEND VENDOR_CUDA_LIBRARIES CUDA::curand_static)
+    list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cupti_static)
     if(CUDA_VERSION VERSION_GREATER_EQUAL "10.1")
       list(APPEND VENDOR_CUDA_LIBRARIES CUDA::cublasLt_static)
     endif()
@@ -43,7 +43,7 @@ if(CPU_THREADING_RUNTIME STREQUAL "TBB")
   set(ONEDNN_DEPENDS install-tbb)
 elseif(CPU_THREADING_RUNTIME STREQUAL "OMP")
   set(ONEDNN_CPU_RUNTIME OMP)
-elseif(CPU_THREADING_RUNTIME STREQUAL "SEQ")
+elseif(CPU_THREADING_RUNTIME STREQUAL "SEQ" OR CPU_THREADING_RUNTIME STREQUAL "THREAD_POOL")
   set(ONEDNN_CPU_RUNTIME SEQ)
 endif()
 
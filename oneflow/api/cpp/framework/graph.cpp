@@ -14,6 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+
 #include "oneflow/api/common/ofblob.h"
 #include "oneflow/api/cpp/framework/device.h"
 #include "oneflow/api/cpp/framework/dtype.h"
@@ -27,6 +33,7 @@ limitations under the License.
 #include "oneflow/core/common/global.h"
 #include "oneflow/core/common/hash_container.h"
 #include "oneflow/core/common/just.h"
+#include "oneflow/core/common/scalar.h"
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/util.h"
@@ -54,6 +61,7 @@ limitations under the License.
 #include "oneflow/core/operator/interface_blob_conf.pb.h"
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/core/register/logical_blob_id.pb.h"
+#include "oneflow/core/vm/vm_util.h"
 
 namespace oneflow_api {
 
@@ -125,30 +133,60 @@ Shape OfShapeToOfApiShape(const of::Shape& of_shape) {
   return Shape(dims);
 }
 
+std::vector<int64_t> ShapeToDims(const Shape& shape) {
+  std::vector<int64_t> dims(shape.NumAxes());
+  for (int64_t i = 0; i < shape.NumAxes(); ++i) { dims[i] = shape.At(i); }
+  return dims;
+}
+
 }  // namespace
 
+ShapeBucketingPolicy PowerOfTwoShapeBucketing(const std::vector<int64_t>& axes) {
+  return [axes](size_t input_index, const Shape& shape) {
+    Shape bucket_shape = shape;
+    for (int64_t axis : axes) {
+      if (axis >= shape.NumAxes()) { continue; }
+      int64_t dim = 1;
+      while (dim < shape.At(axis)) { dim *= 2; }
+      bucket_shape.Set(axis, dim);
+    }
+    return bucket_shape;
+  };
+}
+
 class Graph::GraphImpl final {
  public:
   explicit GraphImpl(const std::string& model_path, const Device& device = Device("cpu"));
 
   GraphImpl(const GraphImpl& graph) = delete;
-  GraphImpl(GraphImpl&& graph) = default;
+  GraphImpl(GraphImpl&& graph) = delete;
 
   ~GraphImpl() = default;
 
   GraphImpl& operator=(const GraphImpl& graph) = delete;
-  GraphImpl& operator=(GraphImpl&& graph) = default;
+  GraphImpl& operator=(GraphImpl&& graph) = delete;
 
   InputOutputInfos GetInputInfos();
   InputOutputInfos GetOutputInfos();
   std::vector<Tensor> Forward(const std::vector<Tensor>& inputs);
+  void Forward(const std::vector<Tensor>& inputs, const std::vector<Tensor>& outputs);
   void set_batch_size(int batch_size) { batch_size_ = batch_size; }
   void enable_tensorrt() { xrt_kind_ = XrtKind::kTensorRT; }
+  const std::string& model_path() const { return model_path_; }
+  const Device& device() const { return device_; }
+  bool is_tensorrt_enabled() const { return xrt_kind_ == XrtKind::kTensorRT; }
+  // Overrides the shapes of the inputs in the order of the input infos.
+  void set_input_shapes(const std::vector<std::vector<int64_t>>& input_shapes) {
+    input_shapes_ = input_shapes;
+  }
+  // Closes the compiled graph and removes it from the session.
+  of::Maybe<void> Release();
 
  private:
   of::Maybe<void> CollectInputOutputInfos();
+  void TryCompile(const std::vector<Tensor>& inputs);
   of::Maybe<void> Compile(const std::vector<Tensor>& inputs);
-  of::Maybe<std::vector<Tensor>> Run(const std::vector<Tensor>& inputs) const;
+  of::Maybe<void> Run(const std::vector<Tensor>& inputs, const of::one::TensorTuple& outputs) const;
   of::Maybe<void> AddOp(of::OperatorConf op_conf);
   of::Maybe<void> BuildGraph();
   of::Maybe<void> LoadCheckpoint();
@@ -156,8 +194,9 @@ class Graph::GraphImpl final {
 
   std::shared_ptr<of::NNGraph> graph_ = nullptr;
   std::string model_path_;
-  bool is_compiled_ = false;
+  std::atomic<bool> is_compiled_{false};
   int batch_size_ = 0;
+  std::vector<std::vector<int64_t>> input_shapes_;
   XrtKind xrt_kind_ = XrtKind::kNone;
   Device device_;
   of::Job job_;
@@ -166,20 +205,133 @@ class Graph::GraphImpl final {
   InputOutputInfos output_infos_;
   of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> output_name_to_tensor_;
   of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> variable_op_name_to_tensor_;
+  // The registered outputs only serve as the templates, each run writes its own outputs so that
+  // concurrent runs of the graph do not share them.
   std::shared_ptr<of::one::TensorTuple> output_tensor_tuple_;
+  std::vector<std::string> output_op_names_;
   std::shared_ptr<of::one::TensorTuple> parameter_tensor_tuple_;
 };
 
+// Graphs compiled for the buckets of the input shapes, kept in the least recently used order.
+class Graph::BucketedGraphs final {
+ public:
+  BucketedGraphs(const std::string& model_path, const Device& device,
+                 const InputOutputInfos& input_infos, const ShapeBucketingPolicy& policy,
+                 size_t capacity)
+      : model_path_(model_path),
+        device_(device),
+        input_infos_(input_infos),
+        policy_(policy),
+        capacity_(std::max<size_t>(capacity, 1)) {}
+
+  void enable_tensorrt() { enable_tensorrt_ = true; }
+
+  std::vector<Tensor> Forward(const std::vector<Tensor>& inputs) {
+    std::vector<Shape> bucket_shapes;
+    const auto& padded_inputs = PadInputs(inputs, &bucket_shapes);
+    return GetOrCreate(bucket_shapes)->Forward(padded_inputs);
+  }
+
+  void Forward(const std::vector<Tensor>& inputs, const std::vector<Tensor>& outputs) {
+    std::vector<Shape> bucket_shapes;
+    const auto& padded_inputs = PadInputs(inputs, &bucket_shapes);
+    GetOrCreate(bucket_shapes)->Forward(padded_inputs, outputs);
+  }
+
+  void Warmup(const std::vector<Shape>& input_shapes) {
+    CHECK_EQ(input_shapes.size(), input_infos_.size());
+    std::vector<DType> dtypes(input_infos_.size());
+    for (const auto& pair : input_infos_) {
+      dtypes.at(pair.second.input_output_index_) = pair.second.datatype_;
+    }
+    std::vector<Tensor> inputs;
+    for (size_t i = 0; i < input_shapes.size(); ++i) {
+      inputs.emplace_back(policy_(i, input_shapes.at(i)), device_, dtypes.at(i));
+      inputs.back().zeros_();
+    }
+    Forward(inputs);
+  }
+
+ private:
+  using Key = std::vector<std::vector<int64_t>>;
+  using Entry = std::pair<Key, std::shared_ptr<GraphImpl>>;
+
+  std::vector<Tensor> PadInputs(const std::vector<Tensor>& inputs,
+                                std::vector<Shape>* bucket_shapes) const {
+    const of::LazyMode::Guard lazy_mode_disabled_guard(/*is_enabled*/ false);
+    std::vector<Tensor> padded_inputs;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      const Shape shape = inputs.at(i).shape();
+      bucket_shapes->emplace_back(policy_(i, shape));
+      std::shared_ptr<of::one::Tensor> tensor = inputs.at(i).tensor_;
+      for (int64_t axis = 0; axis < shape.NumAxes(); ++axis) {
+        const int64_t padding = bucket_shapes->back().At(axis) - shape.At(axis);
+        CHECK_GE(padding, 0) << "the bucket of the input " << i << " is smaller than it";
+        if (padding == 0) { continue; }
+        of::Shape padding_shape(*tensor->shape());
+        padding_shape.Set(axis, padding);
+        const auto& zeros = of::one::functional::Constant(padding_shape, of::Scalar(0),
+                                                          tensor->dtype(),
+                                                          tensor->device().GetOrThrow())
+                                .GetPtrOrThrow();
+        tensor = of::one::functional::Concat({tensor, zeros}, axis).GetPtrOrThrow();
+      }
+      padded_inputs.emplace_back(tensor);
+    }
+    return padded_inputs;
+  }
+
+  std::shared_ptr<GraphImpl> GetOrCreate(const std::vector<Shape>& bucket_shapes) {
+    Key key;
+    for (const auto& shape : bucket_shapes) { key.emplace_back(ShapeToDims(shape)); }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = key2entry_.find(key);
+    if (it != key2entry_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+    // The graph is compiled by its first run, and it is released once the last run using it is
+    // done after its eviction.
+    std::shared_ptr<GraphImpl> graph(new GraphImpl(model_path_, device_), [](GraphImpl* graph) {
+      const auto& status = graph->Release();
+      if (!status.IsOk()) { LOG(WARNING) << "Failed to release the graph of a shape bucket"; }
+      delete graph;
+    });
+    graph->set_input_shapes(key);
+    if (enable_tensorrt_) { graph->enable_tensorrt(); }
+    entries_.emplace_front(key, graph);
+    key2entry_[key] = entries_.begin();
+    if (entries_.size() > capacity_) {
+      key2entry_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    return graph;
+  }
+
+  std::string model_path_;
+  Device device_;
+  InputOutputInfos input_infos_;
+  ShapeBucketingPolicy policy_;
+  size_t capacity_;
+  bool enable_tensorrt_ = false;
+
+  std::mutex mutex_;
+  std::list<Entry> entries_;
+  std::map<Key, std::list<Entry>::iterator> key2entry_;
+};
+
 Graph::Graph(const std::string& model_path, const Device& device)
     : graph_(std::make_unique<GraphImpl>(model_path, device)) {}
 
 Graph::~Graph() = default;
 
-Graph::Graph(Graph&& graph) noexcept : graph_(std::move(graph.graph_)) {}
+Graph::Graph(Graph&& graph) noexcept
+    : graph_(std::move(graph.graph_)), bucketed_graphs_(std::move(graph.bucketed_graphs_)) {}
 
 Graph& Graph::operator=(Graph&& graph) noexcept {
   if (&graph == this) { return *this; }
   graph_ = std::move(graph.graph_);
+  bucketed_graphs_ = std::move(graph.bucketed_graphs_);
   return *this;
 }
 
@@ -199,7 +351,8 @@ IValue Graph::Forward(const IValue& inputs) {
     LOG(WARNING) << "Graph currently only support types: Tensor/vector(Tensor)/None";
   }
 
-  std::vector<Tensor> output_tensors = graph_->Forward(input_tensors);
+  std::vector<Tensor> output_tensors = bucketed_graphs_ ? bucketed_graphs_->Forward(input_tensors)
+                                                       : graph_->Forward(input_tensors);
   if (output_tensors.empty()) {
     return IValue{};
   } else if (output_tensors.size() == 1) {
@@ -209,9 +362,31 @@ IValue Graph::Forward(const IValue& inputs) {
   }
 }
 
+void Graph::Forward(const std::vector<Tensor>& inputs, const std::vector<Tensor>& outputs) {
+  if (bucketed_graphs_) {
+    bucketed_graphs_->Forward(inputs, outputs);
+  } else {
+    graph_->Forward(inputs, outputs);
+  }
+}
+
 void Graph::set_batch_size(int batch_size) { graph_->set_batch_size(batch_size); }
 
-void Graph::enable_tensorrt() { graph_->enable_tensorrt(); }
+void Graph::enable_tensorrt() {
+  graph_->enable_tensorrt();
+  if (bucketed_graphs_) { bucketed_graphs_->enable_tensorrt(); }
+}
+
+void Graph::enable_shape_bucketing(const ShapeBucketingPolicy& policy, size_t capacity) {
+  bucketed_graphs_ = std::make_unique<BucketedGraphs>(graph_->model_path(), graph_->device(),
+                                                      graph_->GetInputInfos(), policy, capacity);
+  if (graph_->is_tensorrt_enabled()) { bucketed_graphs_->enable_tensorrt(); }
+}
+
+void Graph::warmup(const std::vector<Shape>& input_shapes) {
+  CHECK(bucketed_graphs_) << "warmup needs the shape bucketing to be enabled";
+  bucketed_graphs_->Warmup(input_shapes);
+}
 
 Graph Graph::Load(const std::string& model_path, const Device& device) {
   Graph graph(model_path, device);
@@ -257,14 +432,54 @@ of::Maybe<void> Graph::GraphImpl::CollectInputOutputInfos() {
   return of::Maybe<void>::Ok();
 }
 
+void Graph::GraphImpl::TryCompile(const std::vector<Tensor>& inputs) {
+  if (is_compiled_) { return; }
+  // Jobs are built in the global job build context one at a time.
+  static std::mutex mtx;
+  std::lock_guard<std::mutex> lock(mtx);
+  if (is_compiled_) { return; }
+  Compile(inputs).GetOrThrow();
+  is_compiled_ = true;
+}
+
 std::vector<Tensor> Graph::GraphImpl::Forward(const std::vector<Tensor>& inputs) {
-  if (!is_compiled_) {
-    static std::mutex mtx;
-    std::lock_guard<std::mutex> lock(mtx);
-    Compile(inputs).GetOrThrow();
-    is_compiled_ = true;
+  TryCompile(inputs);
+  of::one::TensorTuple output_tensor_tuple;
+  {
+    const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+    for (const auto& tensor : *output_tensor_tuple_) {
+      output_tensor_tuple.emplace_back(
+          of::one::functional::Empty(*tensor->shape(), tensor->dtype(),
+                                     tensor->device().GetOrThrow())
+              .GetPtrOrThrow());
+    }
+  }
+  Run(inputs, output_tensor_tuple).GetOrThrow();
+  std::vector<Tensor> outputs;
+  for (const auto& tensor : output_tensor_tuple) { outputs.emplace_back(Tensor(tensor)); }
+  return outputs;
+}
+
+void Graph::GraphImpl::Forward(const std::vector<Tensor>& inputs,
+                               const std::vector<Tensor>& outputs) {
+  TryCompile(inputs);
+  CHECK_EQ(outputs.size(), output_op_names_.size());
+  of::one::TensorTuple output_tensor_tuple(output_op_names_.size());
+  for (size_t i = 0; i < output_op_names_.size(); ++i) {
+    const size_t index = output_infos_.at(output_op_names_.at(i)).input_output_index_;
+    output_tensor_tuple.at(i) = outputs.at(index).tensor_;
   }
-  return Run(inputs).GetOrThrow();
+  Run(inputs, output_tensor_tuple).GetOrThrow();
+  for (const auto& tensor : output_tensor_tuple) {
+    of::one::SyncAccessTensorWithTimeOut(tensor, [](uint64_t) {}, "const").GetOrThrow();
+  }
+}
+
+of::Maybe<void> Graph::GraphImpl::Release() {
+  // The runs launched with the graph must be done before it is closed.
+  JUST(of::vm::CurrentRankSync());
+  JUST(graph_->Close());
+  return of::Global<of::MultiClientSessionContext>::Get()->RemoveCGraph(graph_);
 }
 
 of::Maybe<void> Graph::GraphImpl::Compile(const std::vector<Tensor>& inputs) {
@@ -275,17 +490,14 @@ of::Maybe<void> Graph::GraphImpl::Compile(const std::vector<Tensor>& inputs) {
   return of::Maybe<void>::Ok();
 }
 
-of::Maybe<std::vector<Tensor>> Graph::GraphImpl::Run(const std::vector<Tensor>& inputs) const {
+of::Maybe<void> Graph::GraphImpl::Run(const std::vector<Tensor>& inputs,
+                                      const of::one::TensorTuple& outputs) const {
   const auto input_tensor_tuple = std::make_shared<of::one::TensorTuple>();
   for (const auto& tensor : inputs) { input_tensor_tuple->emplace_back(tensor.tensor_); }
 
-  JUST(of::RunLazyNNGraph(*input_tensor_tuple, *output_tensor_tuple_, *parameter_tensor_tuple_,
-                          graph_));
-  JUST(of::SoftSyncNNGraphBuffers(*output_tensor_tuple_, graph_));
-
-  std::vector<Tensor> outputs;
-  for (const auto& tensor : *output_tensor_tuple_) { outputs.emplace_back(Tensor(tensor)); }
-  return outputs;
+  JUST(of::RunLazyNNGraph(*input_tensor_tuple, outputs, *parameter_tensor_tuple_, graph_));
+  JUST(of::SoftSyncNNGraphBuffers(outputs, graph_));
+  return of::Maybe<void>::Ok();
 }
 
 of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf) {
@@ -294,7 +506,12 @@ of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf) {
     op_conf.set_scope_symbol_id(scope->symbol_id().value_or(0));
   }
   op_conf.set_device_tag(GetDeviceTag(device_));
-  if (batch_size_ > 0 && op_conf.has_input_conf()) {
+  if (!input_shapes_.empty() && op_conf.has_input_conf()) {
+    const size_t index = input_infos_.at(op_conf.name()).input_output_index_;
+    auto* shape = op_conf.mutable_input_conf()->mutable_blob_conf()->mutable_shape();
+    shape->clear_dim();
+    for (int64_t dim : input_shapes_.at(index)) { shape->add_dim(dim); }
+  } else if (batch_size_ > 0 && op_conf.has_input_conf()) {
     op_conf.mutable_input_conf()->mutable_blob_conf()->mutable_shape()->mutable_dim()->Set(
         0, batch_size_);
   }
@@ -331,11 +548,10 @@ of::Maybe<void> Graph::GraphImpl::BuildGraph() {
       const of::OperatorConf& op_conf = node->op().op_conf();
       if (op_conf.has_output_conf()) {
         of::InterfaceBlobConf blob_conf = op_conf.output_conf().blob_conf();
-        if (batch_size_ > 0) {
+        if (batch_size_ > 0 || !input_shapes_.empty()) {
           const std::string input_lbi_str = op_conf.output_conf().in();
           const of::LogicalBlobId input_lbi = of::GenLogicalBlobId(input_lbi_str);
-          int64_t batch_size = node->LogicalBlobDesc4Lbi(input_lbi).shape().At(0);
-          blob_conf.mutable_shape()->set_dim(0, batch_size);
+          node->LogicalBlobDesc4Lbi(input_lbi).shape().ToProto(blob_conf.mutable_shape());
         }
         output_name_to_tensor_[op_conf.name()] = JUST(of::one::functional::Empty(
             of::Shape(blob_conf.shape()),
@@ -389,6 +605,7 @@ of::Maybe<void> Graph::GraphImpl::RegisterTensors(const std::vector<Tensor>& inp
     const std::vector<std::shared_ptr<of::one::Tensor>>& output_tensors = pair.second;
     JUST(graph_->RegisterOutputOpNamesAndTensors(output_op_names, output_tensors));
     output_tensor_tuple_ = ConvertToTensorTuple(output_tensors);
+    output_op_names_ = output_op_names;
   }
   {
     const auto& pair = Unzip(variable_op_name_to_tensor_);
@@ -23,8 +23,10 @@ limitations under the License.
 #include "ivalue.h"
 #include "tensor.h"
 #include <cstddef>
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace oneflow {
 
@@ -48,6 +50,13 @@ struct InputOutputAttribute {
 
 using InputOutputInfos = std::unordered_map<std::string, InputOutputAttribute>;
 
+// Maps the shape of the input of the index to the shape of its bucket, which is at least as large
+// in every axis.
+using ShapeBucketingPolicy = std::function<Shape(size_t input_index, const Shape& shape)>;
+
+// Rounds the given axes of all the inputs up to powers of two.
+ShapeBucketingPolicy PowerOfTwoShapeBucketing(const std::vector<int64_t>& axes);
+
 class Graph {
  public:
   explicit Graph(const std::string& model_path, const Device& device = Device("cpu"));
@@ -62,14 +71,26 @@ class Graph {
   InputOutputInfos GetInputInfos();
   InputOutputInfos GetOutputInfos();
   IValue Forward(const IValue& inputs);
+  // Writes the outputs into the given tensors in the order of the output infos, e.g. the ones
+  // made by Tensor::from_blob, and returns once they are ready.
+  void Forward(const std::vector<Tensor>& inputs, const std::vector<Tensor>& outputs);
   void set_batch_size(int batch_size);
   void enable_tensorrt();
+  // Compiles the graph for the buckets of the input shapes instead of the shapes of the model. The
+  // inputs are zero padded to their buckets, so are the outputs. The graphs are compiled at the
+  // first use of their buckets and at most `capacity` of them are kept, the least recently used
+  // ones are released.
+  void enable_shape_bucketing(const ShapeBucketingPolicy& policy, size_t capacity = 8);
+  // Compiles the graph of the bucket of the input shapes ahead of the requests.
+  void warmup(const std::vector<Shape>& input_shapes);
 
   static Graph Load(const std::string& model_path, const Device& device = Device("cpu"));
 
  private:
   class GraphImpl;
+  class BucketedGraphs;
   std::unique_ptr<GraphImpl> graph_;
+  std::unique_ptr<BucketedGraphs> bucketed_graphs_;
 };
 
 }  // namespace oneflow_api
@@ -25,6 +25,10 @@ limitations under the License.
 #include "oneflow/core/register/ofblob.h"
 #include "oneflow/api/common/ofblob.h"
 #include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_dep_object.h"
 #include "oneflow/core/vm/virtual_machine.h"
 
 namespace oneflow_api {
@@ -99,6 +103,35 @@ Tensor Tensor::from_buffer(const void* buffer, const Shape& shape, const Device&
   return tensor;
 }
 
+Tensor Tensor::from_blob(void* blob, const Shape& shape, const Device& device,
+                         const DType& dtype) {
+  const auto& of_device = *device.device_;
+  const auto of_shape = std::make_shared<of::Shape>(*shape.shape_);
+  const auto data_type = static_cast<of::DataType>(dtype);
+  const auto tensor_meta = std::make_shared<of::one::MirroredTensorMeta>(
+      of_shape, data_type, of_device, std::make_shared<of::Stride>(*of_shape), 0);
+
+  // The blob is not released with the storage.
+  auto tensor_data = std::make_shared<of::vm::TensorStorage>();
+  tensor_data->set_blob_dptr(
+      std::unique_ptr<char, std::function<void(char*)>>(static_cast<char*>(blob), [](char*) {}),
+      shape.Count(0) * GetDTypeSize(dtype));
+  auto tensor_impl = std::make_shared<of::one::EagerMirroredTensorImpl>(
+      tensor_meta, std::make_shared<of::one::TensorStorage>(tensor_data),
+      /*requires_grad=*/false, /*is_leaf=*/true);
+
+  const auto& InitBlob = [&]() -> of::Maybe<void> {
+    JUST(tensor_impl->InitEagerBlobObject(of::NewLocalDepObject()));
+    const auto& eager_blob_object = JUST(tensor_impl->eager_blob_object());
+    eager_blob_object->set_last_used_stream(of::GetDefaultStreamByDevice(of_device));
+    JUST(eager_blob_object->TryInitBlob());
+    eager_blob_object->mut_blob()->reset_dptr(static_cast<char*>(blob));
+    return of::Maybe<void>::Ok();
+  };
+  InitBlob().GetOrThrow();
+  return Tensor(std::make_shared<of::one::MirroredTensor>(tensor_impl));
+}
+
 template<typename T>
 void Tensor::copy_to(T* buffer) const {
   std::shared_ptr<of::one::MirroredTensor> local_tensor =
@@ -63,6 +63,11 @@ class Tensor final {
   [[nodiscard]] static Tensor from_buffer(const void* buffer, const Shape& shape,
                                           const Device& device, const DType& dtype);
 
+  // Wraps the contiguous blob of the device as a tensor without copying it. The blob is still
+  // owned by the caller and must outlive the tensor and the computations using it.
+  [[nodiscard]] static Tensor from_blob(void* blob, const Shape& shape, const Device& device,
+                                        const DType& dtype);
+
  private:
   std::shared_ptr<oneflow::one::Tensor> tensor_ = nullptr;
 };
@@ -0,0 +1,324 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "oneflow/api/cpp/serving/batching_server.h"
+#include "oneflow/core/common/scalar.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/lazy_mode.h"
+
+namespace oneflow_api {
+namespace serving {
+
+namespace of = oneflow;
+namespace functional = of::one::functional;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+  std::vector<Tensor> inputs;
+  int64_t batch_size;
+  Clock::time_point enqueue_time;
+  std::promise<std::vector<Tensor>> promise;
+};
+
+double ToMicroseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+class LatencyWindow final {
+ public:
+  explicit LatencyWindow(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  void Add(double latency_us) {
+    if (latencies_us_.size() < capacity_) {
+      latencies_us_.emplace_back(latency_us);
+    } else {
+      latencies_us_[next_] = latency_us;
+    }
+    next_ = (next_ + 1) % capacity_;
+  }
+
+  LatencyPercentiles Percentiles() const {
+    LatencyPercentiles percentiles;
+    if (latencies_us_.empty()) { return percentiles; }
+    std::vector<double> sorted(latencies_us_);
+    std::sort(sorted.begin(), sorted.end());
+    const auto At = [&](double q) {
+      return sorted.at(std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size())));
+    };
+    percentiles.p50_us = At(0.5);
+    percentiles.p90_us = At(0.9);
+    percentiles.p99_us = At(0.99);
+    return percentiles;
+  }
+
+ private:
+  size_t capacity_;
+  size_t next_ = 0;
+  std::vector<double> latencies_us_;
+};
+
+Shape WithBatchSize(const Shape& shape, int64_t batch_size) {
+  Shape batched_shape = shape;
+  batched_shape.Set(0, batch_size);
+  return batched_shape;
+}
+
+// Returns the infos sorted by the input or output index.
+std::vector<InputOutputAttribute> SortedInfos(const InputOutputInfos& infos) {
+  std::vector<InputOutputAttribute> sorted(infos.size());
+  for (const auto& pair : infos) { sorted.at(pair.second.input_output_index_) = pair.second; }
+  return sorted;
+}
+
+}  // namespace
+
+class BatchingServer::Impl final {
+ public:
+  Impl(const std::string& model_path, const BatchingOptions& options);
+  ~Impl();
+
+  std::future<std::vector<Tensor>> Submit(const std::vector<Tensor>& inputs);
+  LatencyStats GetLatencyStats() const;
+
+ private:
+  void Loop();
+  void RunBatch(std::vector<Request>* requests);
+  std::vector<Tensor> NewOutputs(int64_t batch_size) const;
+
+  BatchingOptions options_;
+  std::vector<int> batch_sizes_;
+  std::vector<std::unique_ptr<Graph>> graphs_;
+  std::vector<InputOutputAttribute> input_infos_;
+  std::vector<InputOutputAttribute> output_infos_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Request> queue_;
+  int64_t queued_batch_size_ = 0;
+  bool stopped_ = false;
+
+  mutable std::mutex stats_mutex_;
+  LatencyWindow queueing_latencies_;
+  LatencyWindow compute_latencies_;
+  int64_t num_requests_ = 0;
+  int64_t num_batches_ = 0;
+
+  std::thread worker_;
+};
+
+BatchingServer::Impl::Impl(const std::string& model_path, const BatchingOptions& options)
+    : options_(options),
+      batch_sizes_(options.batch_sizes),
+      queueing_latencies_(options.latency_window),
+      compute_latencies_(options.latency_window) {
+  std::sort(batch_sizes_.begin(), batch_sizes_.end());
+  batch_sizes_.erase(std::unique(batch_sizes_.begin(), batch_sizes_.end()), batch_sizes_.end());
+  CHECK(!batch_sizes_.empty() && batch_sizes_.front() > 0);
+  for (int batch_size : batch_sizes_) {
+    auto graph = std::make_unique<Graph>(model_path, options_.device);
+    graph->set_batch_size(batch_size);
+    if (input_infos_.empty() && output_infos_.empty()) {
+      input_infos_ = SortedInfos(graph->GetInputInfos());
+      output_infos_ = SortedInfos(graph->GetOutputInfos());
+    }
+    // Compiles the graph before serving so that the first requests do not pay for it.
+    std::vector<Tensor> inputs;
+    for (const auto& info : input_infos_) {
+      inputs.emplace_back(WithBatchSize(info.input_output_shape_, batch_size), options_.device,
+                          info.datatype_);
+      inputs.back().zeros_();
+    }
+    graph->Forward(inputs, NewOutputs(batch_size));
+    graphs_.emplace_back(std::move(graph));
+  }
+  worker_ = std::thread([this]() { Loop(); });
+}
+
+BatchingServer::Impl::~Impl() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  worker_.join();
+  for (auto& request : queue_) {
+    request.promise.set_exception(
+        std::make_exception_ptr(std::runtime_error("the batching server is stopped")));
+  }
+}
+
+std::vector<Tensor> BatchingServer::Impl::NewOutputs(int64_t batch_size) const {
+  std::vector<Tensor> outputs;
+  for (const auto& info : output_infos_) {
+    outputs.emplace_back(WithBatchSize(info.input_output_shape_, batch_size), options_.device,
+                         info.datatype_);
+  }
+  return outputs;
+}
+
+std::future<std::vector<Tensor>> BatchingServer::Impl::Submit(const std::vector<Tensor>& inputs) {
+  Request request;
+  request.inputs = inputs;
+  request.enqueue_time = Clock::now();
+  auto future = request.promise.get_future();
+  const auto& Reject = [&](const std::string& message) {
+    request.promise.set_exception(std::make_exception_ptr(std::invalid_argument(message)));
+    return std::move(future);
+  };
+  if (inputs.size() != input_infos_.size()) {
+    return Reject("the number of inputs is " + std::to_string(inputs.size()) + " but "
+                  + std::to_string(input_infos_.size()) + " is expected");
+  }
+  request.batch_size = inputs.empty() ? 0 : inputs.front().shape().At(0);
+  for (const auto& input : inputs) {
+    if (input.shape().NumAxes() == 0 || input.shape().At(0) != request.batch_size) {
+      return Reject("the inputs of a request must share the leading batch dimension");
+    }
+  }
+  if (request.batch_size <= 0 || request.batch_size > batch_sizes_.back()) {
+    return Reject("the batch size of a request must be in [1, "
+                  + std::to_string(batch_sizes_.back()) + "]");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) { return Reject("the batching server is stopped"); }
+    queued_batch_size_ += request.batch_size;
+    queue_.emplace_back(std::move(request));
+  }
+  cond_.notify_one();
+  return future;
+}
+
+void BatchingServer::Impl::Loop() {
+  const int64_t max_batch_size = batch_sizes_.back();
+  while (true) {
+    std::vector<Request> requests;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [&]() { return stopped_ || !queue_.empty(); });
+      if (stopped_) { return; }
+      // The batch is dispatched once it is full or its oldest request reaches the deadline.
+      const auto deadline = queue_.front().enqueue_time + options_.max_queue_delay;
+      cond_.wait_until(lock, deadline,
+                       [&]() { return stopped_ || queued_batch_size_ >= max_batch_size; });
+      if (stopped_) { return; }
+      int64_t batch_size = 0;
+      while (!queue_.empty() && batch_size + queue_.front().batch_size <= max_batch_size) {
+        batch_size += queue_.front().batch_size;
+        requests.emplace_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      queued_batch_size_ -= batch_size;
+    }
+    RunBatch(&requests);
+  }
+}
+
+void BatchingServer::Impl::RunBatch(std::vector<Request>* requests) {
+  const auto dispatch_time = Clock::now();
+  int64_t batch_size = 0;
+  for (const auto& request : *requests) { batch_size += request.batch_size; }
+  const size_t bucket =
+      std::lower_bound(batch_sizes_.begin(), batch_sizes_.end(), batch_size) - batch_sizes_.begin();
+  const int64_t padded_batch_size = batch_sizes_.at(bucket);
+  std::vector<std::vector<Tensor>> request_outputs(requests->size());
+  Clock::time_point compute_end_time;
+  try {
+    const of::LazyMode::Guard lazy_mode_disabled_guard(/*is_enabled*/ false);
+    std::vector<Tensor> inputs;
+    for (size_t i = 0; i < input_infos_.size(); ++i) {
+      of::one::TensorTuple parts;
+      for (const auto& request : *requests) {
+        parts.emplace_back(request.inputs.at(i).__internal_tensor());
+      }
+      if (batch_size < padded_batch_size) {
+        const auto& part = parts.front();
+        of::Shape padding_shape(*part->shape());
+        padding_shape.Set(0, padded_batch_size - batch_size);
+        parts.emplace_back(functional::Constant(padding_shape, of::Scalar(0), part->dtype(),
+                                                part->device().GetOrThrow())
+                               .GetPtrOrThrow());
+      }
+      inputs.emplace_back(parts.size() == 1 ? parts.front()
+                                            : functional::Concat(parts, 0).GetPtrOrThrow());
+    }
+    std::vector<Tensor> outputs = NewOutputs(padded_batch_size);
+    graphs_.at(bucket)->Forward(inputs, outputs);
+    compute_end_time = Clock::now();
+
+    int64_t offset = 0;
+    for (size_t i = 0; i < requests->size(); ++i) {
+      const int64_t request_batch_size = requests->at(i).batch_size;
+      for (const auto& output : outputs) {
+        request_outputs.at(i).emplace_back(
+            functional::Narrow(output.__internal_tensor(), 0, offset, request_batch_size)
+                .GetPtrOrThrow());
+      }
+      offset += request_batch_size;
+    }
+  } catch (...) {
+    for (auto& request : *requests) { request.promise.set_exception(std::current_exception()); }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    for (const auto& request : *requests) {
+      queueing_latencies_.Add(ToMicroseconds(dispatch_time - request.enqueue_time));
+      compute_latencies_.Add(ToMicroseconds(compute_end_time - dispatch_time));
+    }
+    num_requests_ += requests->size();
+    num_batches_ += 1;
+  }
+  for (size_t i = 0; i < requests->size(); ++i) {
+    requests->at(i).promise.set_value(std::move(request_outputs.at(i)));
+  }
+}
+
+LatencyStats BatchingServer::Impl::GetLatencyStats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  LatencyStats stats;
+  stats.queueing = queueing_latencies_.Percentiles();
+  stats.compute = compute_latencies_.Percentiles();
+  stats.num_requests = num_requests_;
+  stats.num_batches = num_batches_;
+  return stats;
+}
+
+BatchingServer::BatchingServer(const std::string& model_path, const BatchingOptions& options)
+    : impl_(std::make_unique<Impl>(model_path, options)) {}
+
+BatchingServer::~BatchingServer() = default;
+
+std::future<std::vector<Tensor>> BatchingServer::Submit(const std::vector<Tensor>& inputs) {
+  return impl_->Submit(inputs);
+}
+
+LatencyStats BatchingServer::GetLatencyStats() const { return impl_->GetLatencyStats(); }
+
+}  // namespace serving
+}  // namespace oneflow_api
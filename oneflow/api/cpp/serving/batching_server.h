@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef ONEFLOW_API_CPP_SERVING_BATCHING_SERVER_H_
+#define ONEFLOW_API_CPP_SERVING_BATCHING_SERVER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../framework.h"
+
+namespace oneflow_api {
+namespace serving {
+
+struct BatchingOptions {
+  // Batch sizes the graphs are compiled for, a batch runs on the smallest one it fits.
+  std::vector<int> batch_sizes{1, 2, 4, 8, 16, 32};
+  // The longest time a request waits for the others to be batched with.
+  std::chrono::microseconds max_queue_delay{2000};
+  Device device = Device("cpu");
+  // The number of the latest requests the latency percentiles are computed over.
+  size_t latency_window = 4096;
+};
+
+struct LatencyPercentiles {
+  double p50_us = 0;
+  double p90_us = 0;
+  double p99_us = 0;
+};
+
+struct LatencyStats {
+  LatencyPercentiles queueing;
+  LatencyPercentiles compute;
+  int64_t num_requests = 0;
+  int64_t num_batches = 0;
+};
+
+// Batches the requests to a model under a latency deadline and runs each batch on the graph of
+// the smallest batch size it fits, padding the rest of the batch.
+class BatchingServer final {
+ public:
+  explicit BatchingServer(const std::string& model_path,
+                          const BatchingOptions& options = BatchingOptions());
+  ~BatchingServer();
+
+  BatchingServer(const BatchingServer&) = delete;
+  BatchingServer& operator=(const BatchingServer&) = delete;
+
+  // The inputs are in the order of the input infos of the model, they share the leading batch
+  // dimension which is at most the largest batch size. So do the outputs of the request.
+  std::future<std::vector<Tensor>> Submit(const std::vector<Tensor>& inputs);
+
+  LatencyStats GetLatencyStats() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace serving
+}  // namespace oneflow_api
+
+#endif  // ONEFLOW_API_CPP_SERVING_BATCHING_SERVER_H_
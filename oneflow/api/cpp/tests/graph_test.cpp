@@ -167,6 +167,62 @@ TEST(Api, graph_thread_test) {
   for (auto& thread : threads) { thread.join(); }
 }
 
+TEST(Api, graph_concurrent_forward_test) {
+  EnvScope scope;
+
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&graph, &device]() {
+      for (int j = 0; j < 8; j++) { Forward(graph, device, 1); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+}
+
+TEST(Api, graph_forward_with_blob_test) {
+  EnvScope scope;
+
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+
+  std::vector<float> x(3, 1);
+  std::vector<float> y(4, 0);
+  std::vector<Tensor> inputs{Tensor::from_blob(x.data(), Shape({1, 3}), device, DType::kFloat)};
+  std::vector<Tensor> outputs{Tensor::from_blob(y.data(), Shape({1, 4}), device, DType::kFloat)};
+  for (int i = 0; i < 2; i++) {
+    graph.Forward(inputs, outputs);
+    for (const float& element : y) { ASSERT_EQ(element, 4); }
+    std::fill(y.begin(), y.end(), 0);
+  }
+}
+
+TEST(Api, graph_shape_bucketing_test) {
+  EnvScope scope;
+
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+  graph.enable_shape_bucketing(PowerOfTwoShapeBucketing({0}), /*capacity=*/1);
+  graph.warmup({Shape({3, 3})});
+
+  for (int64_t batch_size : {3, 4, 5, 2}) {
+    std::vector<float> data(batch_size * 3, 1);
+    const auto& value = graph.Forward(
+        Tensor::from_buffer(data.data(), Shape({batch_size, 3}), device, DType::kFloat));
+    ASSERT_TRUE(value.IsTensor());
+    Tensor output = value.ToTensor();
+    // The outputs are padded to the bucket as well.
+    int64_t bucket = 1;
+    while (bucket < batch_size) { bucket *= 2; }
+    ASSERT_EQ(output.shape(), Shape({bucket, 4}));
+    std::vector<float> buf(bucket * 4);
+    output.copy_to(buf.data());
+    for (int64_t i = 0; i < batch_size * 4; ++i) { ASSERT_EQ(buf[i], 4); }
+  }
+}
+
 TEST(Api, graph_input_order_test) {
   EnvScope scope;
 
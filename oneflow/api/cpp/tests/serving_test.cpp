@@ -0,0 +1,58 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+#include <future>
+#include <vector>
+#include "oneflow/api/cpp/tests/api_test.h"
+
+namespace oneflow_api {
+
+TEST(Api, serving_batching_server_test) {
+  EnvScope scope;
+
+  serving::BatchingOptions options;
+  options.batch_sizes = {1, 2, 4};
+  options.max_queue_delay = std::chrono::milliseconds(20);
+  serving::BatchingServer server("./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter",
+                                 options);
+
+  std::vector<std::vector<float>> data{std::vector<float>(3, 1), std::vector<float>(2 * 3, 1)};
+  std::vector<std::future<std::vector<Tensor>>> futures;
+  for (int i = 0; i < 3; ++i) {
+    const int64_t batch_size = i == 1 ? 2 : 1;
+    futures.emplace_back(server.Submit({Tensor::from_buffer(
+        data.at(batch_size - 1).data(), Shape({batch_size, 3}), Device("cpu"), DType::kFloat)}));
+  }
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Tensor> outputs = futures.at(i).get();
+    ASSERT_EQ(outputs.size(), 1);
+    const int64_t batch_size = i == 1 ? 2 : 1;
+    ASSERT_EQ(outputs.at(0).shape(), Shape({batch_size, 4}));
+    std::vector<float> buf(batch_size * 4);
+    outputs.at(0).copy_to(buf.data());
+    for (const float& element : buf) { ASSERT_EQ(element, 4); }
+  }
+
+  const auto stats = server.GetLatencyStats();
+  ASSERT_EQ(stats.num_requests, 3);
+  ASSERT_GE(stats.num_batches, 1);
+  ASSERT_GE(stats.compute.p99_us, stats.compute.p50_us);
+
+  ASSERT_THROW(server.Submit({}).get(), std::invalid_argument);
+}
+
+}  // namespace oneflow_api
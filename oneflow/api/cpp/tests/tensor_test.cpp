@@ -75,6 +75,24 @@ TEST(Api, tensor_from_buffer_and_copy_to) {
   TEST_TENSOR_FROM_AND_TO_BLOB(DType::kInt64, int64_t)
 }
 
+TEST(Api, tensor_from_blob) {
+  EnvScope scope;
+
+  const auto shape = RandomShape();
+
+  std::vector<float> data(shape.Count(0)), new_data(shape.Count(0));
+  for (int i = 0; i < shape.Count(0); ++i) { data[i] = i; }
+  Tensor tensor = Tensor::from_blob(data.data(), shape, Device("cpu"), DType::kFloat);
+  ASSERT_EQ(tensor.shape(), shape);
+
+  // The tensor shares the blob with the caller.
+  tensor.zeros_();
+  tensor.copy_to(new_data.data());
+  std::vector<float> target_data(shape.Count(0), 0);
+  ASSERT_EQ(new_data, target_data);
+  ASSERT_EQ(data, target_data);
+}
+
 TEST(Api, tensor_zeros) {
   EnvScope scope;
 
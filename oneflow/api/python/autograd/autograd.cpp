@@ -104,6 +104,12 @@ std::shared_ptr<oneflow::one::TensorTuple> BackwardOrThrow(
     const std::shared_ptr<oneflow::one::TensorTuple>& outputs,
     const std::shared_ptr<oneflow::one::TensorTuple>& out_grads, bool retain_graph,
     bool create_graph) {
+  if (oneflow::one::ParallelBackwardThreadNum() > 1) {
+    // The python hooks run on the backward threads acquire the GIL by themselves.
+    pybind11::gil_scoped_release release;
+    return oneflow::autograd::Backward(*outputs, *out_grads.get(), retain_graph, create_graph)
+        .GetPtrOrThrow();
+  }
   return oneflow::autograd::Backward(*outputs, *out_grads.get(), retain_graph, create_graph)
       .GetPtrOrThrow();
 }
@@ -113,6 +119,12 @@ std::shared_ptr<oneflow::one::TensorTuple> GradOrThrow(
     const std::shared_ptr<oneflow::one::TensorTuple>& inputs,
     const std::shared_ptr<oneflow::one::TensorTuple>& out_grads, bool retain_graph,
     bool create_graph) {
+  if (oneflow::one::ParallelBackwardThreadNum() > 1) {
+    pybind11::gil_scoped_release release;
+    return oneflow::autograd::Grad(*outputs, *inputs, *out_grads.get(), retain_graph,
+                                   create_graph)
+        .GetPtrOrThrow();
+  }
   return oneflow::autograd::Grad(*outputs, *inputs, *out_grads.get(), retain_graph, create_graph)
       .GetPtrOrThrow();
 }
@@ -62,6 +62,8 @@ py::object PackTensorTuple(const one::TensorTuple& tp) {
 one::AutogradFunctionBase::FType PackPyFunctionToFType(const py::function& func) {
   return [func](const std::shared_ptr<one::FunctionAutoGradCaptureState>& ctx,
                 const one::TensorTuple& inputs) {
+    // The backward may be called from a parallel backward thread without the GIL.
+    py::gil_scoped_acquire acquire;
     const py::tuple& a = py::cast(inputs);
     py::object res = func(ctx, *a);
     return UnpackTensorTuple(res).GetPtrOrThrow();
@@ -92,6 +94,7 @@ ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
            [](FunctionAutoGradCaptureState& ctx, const py::args& input) {
              const auto& tensors = UnpackTensorTuple(input).GetOrThrow();
              for (const auto& tensor : tensors) { ctx.SaveTensorForBackward(tensor); }
+             ctx.CheckPackedTensors().GetOrThrow();
            })
       .def_property_readonly(
           "saved_tensors",
@@ -0,0 +1,37 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <memory>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/autograd/checkpoint.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+namespace one {
+
+ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
+  m.def("_begin_checkpoint",
+        [](bool preserve_rng_state) { BeginCheckpoint(preserve_rng_state).GetOrThrow(); });
+  m.def("_end_checkpoint", [](const std::shared_ptr<TensorTuple>& outputs) {
+    EndCheckpoint(*outputs).GetOrThrow();
+  });
+  m.def("_abort_checkpoint", []() { AbortCheckpoint().GetOrThrow(); });
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/autograd/saved_tensor_hooks.h"
+#include "oneflow/core/framework/tensor.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+class PySavedTensorHook final : public SavedTensorHook {
+ public:
+  PySavedTensorHook(const py::function& pack_hook, const py::function& unpack_hook)
+      : pack_hook_(pack_hook), unpack_hook_(unpack_hook) {}
+  ~PySavedTensorHook() override {
+    // The hook may be released by a backward thread without the GIL.
+    py::gil_scoped_acquire acquire;
+    pack_hook_.release().dec_ref();
+    unpack_hook_.release().dec_ref();
+    packed_.release().dec_ref();
+  }
+
+  Maybe<void> Pack(const std::shared_ptr<Tensor>& tensor) override {
+    py::gil_scoped_acquire acquire;
+    try {
+      packed_ = pack_hook_(tensor);
+    } catch (py::error_already_set& e) {
+      return Error::RuntimeError() << "the pack hook of saved tensors fails: " << e.what();
+    }
+    return Maybe<void>::Ok();
+  }
+
+  Maybe<Tensor> Unpack() override {
+    py::gil_scoped_acquire acquire;
+    std::shared_ptr<Tensor> tensor;
+    try {
+      py::object unpacked = unpack_hook_(packed_);
+      tensor = py::cast<std::shared_ptr<Tensor>>(unpacked);
+    } catch (py::error_already_set& e) {
+      return Error::RuntimeError() << "the unpack hook of saved tensors fails: " << e.what();
+    } catch (py::cast_error& e) {
+      return Error::RuntimeError() << "the unpack hook of saved tensors must return a tensor";
+    }
+    // Releases the packed object as early as possible, e.g. the offloaded host copy.
+    packed_ = py::none();
+    return tensor;
+  }
+
+ private:
+  py::object pack_hook_;
+  py::object unpack_hook_;
+  py::object packed_;
+};
+
+class PySavedTensorHookCreator final : public SavedTensorHookCreator {
+ public:
+  PySavedTensorHookCreator(const py::function& pack_hook, const py::function& unpack_hook)
+      : pack_hook_(pack_hook), unpack_hook_(unpack_hook) {}
+  ~PySavedTensorHookCreator() override {
+    py::gil_scoped_acquire acquire;
+    pack_hook_.release().dec_ref();
+    unpack_hook_.release().dec_ref();
+  }
+
+  std::unique_ptr<SavedTensorHook> NewHook() const override {
+    py::gil_scoped_acquire acquire;
+    return std::make_unique<PySavedTensorHook>(pack_hook_, unpack_hook_);
+  }
+
+ private:
+  py::function pack_hook_;
+  py::function unpack_hook_;
+};
+
+}  // namespace
+
+ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
+  m.def("_push_saved_tensors_hooks", [](const py::function& pack_hook,
+                                        const py::function& unpack_hook) {
+    PushSavedTensorHookCreator(std::make_shared<PySavedTensorHookCreator>(pack_hook, unpack_hook));
+  });
+  m.def("_pop_saved_tensors_hooks", []() { PopSavedTensorHookCreator().GetOrThrow(); });
+}
+
+}  // namespace one
+}  // namespace oneflow
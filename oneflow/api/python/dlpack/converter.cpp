@@ -0,0 +1,318 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/api/python/dlpack/dlpack.h"
+#include "oneflow/api/python/utils/tensor_utils.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/ep/include/device.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#ifdef WITH_CUDA
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_event.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#endif  // WITH_CUDA
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+namespace {
+
+constexpr const char* kDLTensorCapsuleName = "dltensor";
+constexpr const char* kUsedDLTensorCapsuleName = "used_dltensor";
+
+Maybe<DLDataType> ToDLDataType(DataType data_type) {
+  DLDataType dl_dtype;
+  dl_dtype.lanes = 1;
+  dl_dtype.bits = GetSizeOfDataType(data_type) * 8;
+  switch (data_type) {
+    case DataType::kInt8:
+    case DataType::kInt16:
+    case DataType::kInt32:
+    case DataType::kInt64: dl_dtype.code = kDLInt; break;
+    case DataType::kUInt8:
+    case DataType::kUInt16:
+    case DataType::kUInt32:
+    case DataType::kUInt64: dl_dtype.code = kDLUInt; break;
+    case DataType::kFloat16:
+    case DataType::kFloat:
+    case DataType::kDouble: dl_dtype.code = kDLFloat; break;
+    case DataType::kBFloat16: dl_dtype.code = kDLBfloat; break;
+    case DataType::kComplex64:
+    case DataType::kComplex128: dl_dtype.code = kDLComplex; break;
+    case DataType::kBool: dl_dtype.code = kDLBool; break;
+    default:
+      return Error::TypeError() << "DLPack does not support data type "
+                                << DataType_Name(data_type);
+  }
+  return dl_dtype;
+}
+
+Maybe<DataType> FromDLDataType(const DLDataType& dl_dtype) {
+  CHECK_EQ_OR_RETURN(dl_dtype.lanes, 1) << "vectorized DLPack data types are not supported.";
+  switch (dl_dtype.code) {
+    case kDLInt:
+      switch (dl_dtype.bits) {
+        case 8: return DataType::kInt8;
+        case 16: return DataType::kInt16;
+        case 32: return DataType::kInt32;
+        case 64: return DataType::kInt64;
+      }
+      break;
+    case kDLUInt:
+      switch (dl_dtype.bits) {
+        case 8: return DataType::kUInt8;
+        case 16: return DataType::kUInt16;
+        case 32: return DataType::kUInt32;
+        case 64: return DataType::kUInt64;
+      }
+      break;
+    case kDLFloat:
+      switch (dl_dtype.bits) {
+        case 16: return DataType::kFloat16;
+        case 32: return DataType::kFloat;
+        case 64: return DataType::kDouble;
+      }
+      break;
+    case kDLBfloat:
+      if (dl_dtype.bits == 16) { return DataType::kBFloat16; }
+      break;
+    case kDLComplex:
+      switch (dl_dtype.bits) {
+        case 64: return DataType::kComplex64;
+        case 128: return DataType::kComplex128;
+      }
+      break;
+    case kDLBool:
+      if (dl_dtype.bits == 8) { return DataType::kBool; }
+      break;
+  }
+  return Error::TypeError() << "unsupported DLPack data type (code " << int(dl_dtype.code)
+                            << ", bits " << int(dl_dtype.bits) << ")";
+}
+
+// Owns what a DLManagedTensor handed out by ToDLPack points to, including a reference to the
+// tensor so that its storage outlives the consumer.
+struct DLPackExportCtx {
+  std::shared_ptr<one::Tensor> tensor;
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  DLManagedTensor managed;
+};
+
+void DeleteDLPackExportCtx(DLManagedTensor* self) {
+  delete static_cast<DLPackExportCtx*>(self->manager_ctx);
+}
+
+// Frees a capsule nobody consumed. Consumers rename it to "used_dltensor" and take over the
+// deleter.
+void DLTensorCapsuleDestructor(PyObject* capsule) {
+  if (!PyCapsule_IsValid(capsule, kDLTensorCapsuleName)) { return; }
+  auto* managed =
+      static_cast<DLManagedTensor*>(PyCapsule_GetPointer(capsule, kDLTensorCapsuleName));
+  if (managed->deleter) { managed->deleter(managed); }
+}
+
+#ifdef WITH_CUDA
+
+// `stream` follows the __dlpack__ protocol: 1 is the legacy default stream, 2 the per-thread
+// default stream, and any other value a cudaStream_t.
+cudaStream_t ConsumerCudaStream(int64_t stream) {
+  if (stream == 1) { return cudaStreamLegacy; }
+  if (stream == 2) { return cudaStreamPerThread; }
+  return reinterpret_cast<cudaStream_t>(stream);
+}
+
+#endif  // WITH_CUDA
+
+// Hands the memory of `t` out as a DLPack capsule. For cuda tensors the consumer stream waits for
+// the work pending on the tensor, unless `stream` is -1.
+Maybe<py::capsule> ToDLPack(const std::shared_ptr<one::Tensor>& t, int64_t stream) {
+  const auto& tensor = JUST(t->AsMirroredTensor());
+  CHECK_OR_RETURN(tensor->is_eager()) << "eager tensors supported only.";
+  const auto& device = JUST(tensor->device());
+  DLDevice dl_device;
+  if (device->type() == "cpu") {
+    dl_device.device_type = kDLCPU;
+    dl_device.device_id = 0;
+  } else if (device->type() == "cuda") {
+    dl_device.device_type = kDLCUDA;
+    dl_device.device_id = device->device_id();
+  } else {
+    return Error::RuntimeError() << "DLPack does not support device " << device->type();
+  }
+  const DLDataType dl_dtype = JUST(ToDLDataType(tensor->dtype()->data_type()));
+
+  void* dptr = nullptr;
+  const bool sync_consumer = device->type() == "cuda" && stream != -1;
+  const auto& Callback = [&](uint64_t ofblob_ptr) {
+    auto* of_blob = reinterpret_cast<OfBlob*>(ofblob_ptr);
+    dptr = of_blob->mut_blob()->mut_dptr();
+    if (!sync_consumer) { return; }
+#ifdef WITH_CUDA
+    ep::Stream* of_stream = of_blob->stream();
+    ep::Event* event = nullptr;
+    of_stream->device()->CreateEvents(&event, 1);
+    CHECK_JUST(of_stream->RecordEvent(event));
+    OF_CUDA_CHECK(cudaStreamWaitEvent(ConsumerCudaStream(stream),
+                                      static_cast<ep::CudaEvent*>(event)->cuda_event(), 0));
+    of_stream->device()->DestroyEvents(&event, 1);
+#endif  // WITH_CUDA
+  };
+  auto btb = std::make_shared<BlockingThenBusy>(1);
+  JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    return builder->SyncAccessBlobByCallback(tensor, btb, Callback, "mut");
+  }));
+  JUST(btb->WaitUntilCntEqualZero(VirtualMachine::GetPredicatorNoMoreInstructionsFinished()));
+
+  auto* ctx = new DLPackExportCtx();
+  ctx->tensor = t;
+  const auto& shape = tensor->shape();
+  ctx->shape.assign(shape->dim_vec().begin(), shape->dim_vec().end());
+  const auto& stride = JUST(tensor->stride());
+  ctx->strides.assign(stride->StrideVec().begin(), stride->StrideVec().end());
+  DLTensor* dl_tensor = &ctx->managed.dl_tensor;
+  dl_tensor->data = dptr;
+  dl_tensor->device = dl_device;
+  dl_tensor->ndim = ctx->shape.size();
+  dl_tensor->dtype = dl_dtype;
+  dl_tensor->shape = ctx->shape.data();
+  dl_tensor->strides = ctx->strides.data();
+  dl_tensor->byte_offset = 0;
+  ctx->managed.manager_ctx = ctx;
+  ctx->managed.deleter = DeleteDLPackExportCtx;
+  PyObject* capsule = PyCapsule_New(&ctx->managed, kDLTensorCapsuleName, DLTensorCapsuleDestructor);
+  if (capsule == nullptr) {
+    DeleteDLPackExportCtx(&ctx->managed);
+    return Error::RuntimeError() << "failed to create the DLPack capsule.";
+  }
+  return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+// Builds a tensor aliasing the memory of a DLPack capsule, and calls the deleter of the producer
+// once the tensor storage is freed.
+Maybe<one::Tensor> FromDLPack(PyObject* capsule) {
+  auto* managed =
+      static_cast<DLManagedTensor*>(PyCapsule_GetPointer(capsule, kDLTensorCapsuleName));
+  if (managed == nullptr) {
+    PyErr_Clear();
+    return Error::TypeError() << "expected a DLPack capsule named \"dltensor\", which can be "
+                                 "consumed only once.";
+  }
+  const DLTensor& dl_tensor = managed->dl_tensor;
+  Symbol<Device> device;
+  switch (dl_tensor.device.device_type) {
+    case kDLCPU:
+    case kDLCUDAHost: device = JUST(Device::New("cpu")); break;
+    case kDLCUDA: device = JUST(Device::New("cuda", dl_tensor.device.device_id)); break;
+    default:
+      return Error::RuntimeError() << "DLPack device type " << dl_tensor.device.device_type
+                                   << " is not supported.";
+  }
+  const DataType data_type = JUST(FromDLDataType(dl_tensor.dtype));
+
+  const int32_t ndim = dl_tensor.ndim;
+  const auto shape =
+      std::make_shared<Shape>(DimVector(dl_tensor.shape, dl_tensor.shape + ndim));
+  StrideVector strides_vec(ndim);
+  if (dl_tensor.strides == nullptr) {
+    int64_t stride = 1;
+    for (int32_t i = ndim - 1; i >= 0; --i) {
+      strides_vec[i] = stride;
+      stride *= std::max<int64_t>(dl_tensor.shape[i], 1);
+    }
+  } else {
+    strides_vec.assign(dl_tensor.strides, dl_tensor.strides + ndim);
+  }
+  // The storage spans from the first element to the farthest one.
+  int64_t span = shape->elem_cnt() > 0 ? 1 : 0;
+  for (int32_t i = 0; i < ndim && span > 0; ++i) {
+    CHECK_GE_OR_RETURN(strides_vec[i], 0) << "negative DLPack strides are not supported.";
+    span += (dl_tensor.shape[i] - 1) * strides_vec[i];
+  }
+  const auto strides = std::make_shared<Stride>(strides_vec);
+  auto tensor_meta =
+      std::make_shared<one::MirroredTensorMeta>(shape, data_type, device, strides, 0);
+
+  const auto& Free = [managed](char* dptr) {
+    if (managed->deleter == nullptr) { return; }
+    CHECK_JUST(Global<ForeignLockHelper>::Get()->WithScopedAcquire([&]() -> Maybe<void> {
+      managed->deleter(managed);
+      return Maybe<void>::Ok();
+    }));
+  };
+  char* data_ptr = static_cast<char*>(dl_tensor.data) + dl_tensor.byte_offset;
+  auto tensor_data = std::make_shared<vm::TensorStorage>();
+  tensor_data->set_blob_dptr(std::unique_ptr<char, std::function<void(char*)>>(data_ptr, Free),
+                             span * GetSizeOfDataType(data_type));
+  // From here on the deleter belongs to the tensor storage.
+  PyCapsule_SetName(capsule, kUsedDLTensorCapsuleName);
+  auto tensor_storage = std::make_shared<one::TensorStorage>(tensor_data);
+  auto tensor_impl = std::make_shared<one::EagerMirroredTensorImpl>(tensor_meta, tensor_storage,
+                                                                    /*requires_grad=*/false,
+                                                                    /*ls_leaf=*/true);
+  JUST(tensor_impl->InitEagerBlobObject(NewLocalDepObject()));
+  JUST(tensor_impl->eager_blob_object())->set_last_used_stream(GetDefaultStreamByDevice(device));
+  JUST(JUST(tensor_impl->eager_blob_object())->TryInitBlob());
+  JUST(tensor_impl->eager_blob_object())->mut_blob()->reset_dptr(data_ptr);
+  std::shared_ptr<one::Tensor> out(new one::MirroredTensor(tensor_impl));
+
+#ifdef WITH_CUDA
+  if (device->type() == "cuda") {
+    // The producer was asked for its data on the legacy default stream, so the stream of the
+    // tensor waits for the work recorded there so far before touching it.
+    const auto& ep_device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(
+        DeviceType::kCUDA, device->device_id());
+    ep::Event* event = nullptr;
+    ep_device->CreateEvents(&event, 1);
+    {
+      CudaCurrentDeviceGuard guard(device->device_id());
+      OF_CUDA_CHECK(cudaEventRecord(static_cast<ep::CudaEvent*>(event)->cuda_event(),
+                                    cudaStreamLegacy));
+    }
+    const auto& Callback = [ep_device, event](uint64_t ofblob_ptr) mutable {
+      auto* of_blob = reinterpret_cast<OfBlob*>(ofblob_ptr);
+      OF_CUDA_CHECK(cudaStreamWaitEvent(of_blob->stream()->As<ep::CudaStream>()->cuda_stream(),
+                                        static_cast<ep::CudaEvent*>(event)->cuda_event(), 0));
+      ep_device->DestroyEvents(&event, 1);
+    };
+    JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+      return builder->AccessBlobByCallback(JUST(out->AsMirroredTensor()), Callback, "mut");
+    }));
+  }
+#endif  // WITH_CUDA
+  return out;
+}
+
+}  // namespace
+
+ONEFLOW_API_PYBIND11_MODULE("dlpack", m) {
+  m.def(
+      "to_dlpack",
+      [](const std::shared_ptr<one::Tensor>& t, int64_t stream) {
+        return ToDLPack(t, stream).GetOrThrow();
+      },
+      py::arg("tensor"), py::arg("stream") = 1);
+  m.def("from_dlpack", [](const py::capsule& capsule) {
+    return FromDLPack(capsule.ptr()).GetPtrOrThrow();
+  });
+}
+
+}  // namespace oneflow
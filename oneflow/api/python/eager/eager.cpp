@@ -16,13 +16,19 @@ limitations under the License.
 #include <pybind11/pybind11.h>
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/framework/batched_consistency_check.h"
 #include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
 
 ONEFLOW_API_PYBIND11_MODULE("eager", m) {
   using namespace oneflow;
   namespace py = pybind11;
   m.def(
-      "Sync", []() { vm::ClusterSync().GetOrThrow(); }, py::call_guard<py::gil_scoped_release>());
+      "Sync",
+      []() {
+        FlushBatchedConsistencyChecks().GetOrThrow();
+        vm::ClusterSync().GetOrThrow();
+      },
+      py::call_guard<py::gil_scoped_release>());
 
   py::class_<one::DevVmDepObjectConsumeModeGuard,
              std::shared_ptr<one::DevVmDepObjectConsumeModeGuard>>(
@@ -0,0 +1,155 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/embedding/persistent_table.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/embedding/sharding_planner.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+#ifdef WITH_CUDA
+#include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+namespace {
+
+// Plans the tables looked up with column ids 0, 1, ... and returns the column_parallel_ids of
+// one_embedding_id_shuffle for the plan. Tables are never replicated, id_shuffle has no such
+// layout.
+std::vector<int64_t> PlanIdShuffleColumnParallelIds(const std::vector<int64_t>& num_rows,
+                                                    const std::vector<int64_t>& row_bytes,
+                                                    const std::vector<double>& lookups_per_step,
+                                                    int64_t parallel_num,
+                                                    int64_t memory_budget_per_rank,
+                                                    int64_t max_table_wise_table_bytes) {
+  CHECK_EQ(num_rows.size(), row_bytes.size());
+  CHECK_EQ(num_rows.size(), lookups_per_step.size());
+  std::vector<embedding::TableStats> tables(num_rows.size());
+  for (size_t i = 0; i < tables.size(); ++i) {
+    tables.at(i).name = "column_" + std::to_string(i);
+    tables.at(i).num_rows = num_rows.at(i);
+    tables.at(i).row_bytes = row_bytes.at(i);
+    tables.at(i).lookups_per_step = lookups_per_step.at(i);
+  }
+  embedding::ShardingPlannerOptions options;
+  options.parallel_num = parallel_num;
+  options.memory_budget_per_rank = memory_budget_per_rank;
+  options.max_replicated_table_bytes = 0;
+  options.max_table_wise_table_bytes = max_table_wise_table_bytes;
+  const auto& plans = embedding::PlanEmbeddingSharding(tables, options).GetOrThrow();
+  return embedding::GetIdShuffleColumnParallelIds(plans).GetOrThrow();
+}
+
+}  // namespace
+
+#ifdef WITH_CUDA
+
+namespace {
+
+py::dict GetEmbeddingStatistics(const std::string& embedding_name, int64_t rank_id) {
+  embedding::KeyValueStoreStatistics statistics;
+  Global<embedding::EmbeddingManager>::Get()
+      ->GetKeyValueStore(embedding_name, rank_id)
+      ->GetStatistics(&statistics);
+  py::list caches;
+  for (const auto& cache_statistics : statistics.caches) {
+    py::dict cache;
+    cache["queries"] = cache_statistics.num_queries;
+    cache["hits"] = cache_statistics.num_hits;
+    cache["misses"] = cache_statistics.num_misses;
+    cache["evictions"] = cache_statistics.num_evictions;
+    caches.append(cache);
+  }
+  py::dict result;
+  result["caches"] = caches;
+  result["store_block_reads"] = statistics.num_store_block_reads;
+  result["store_block_writes"] = statistics.num_store_block_writes;
+  return result;
+}
+
+void ResetEmbeddingStatistics(const std::string& embedding_name, int64_t rank_id) {
+  Global<embedding::EmbeddingManager>::Get()
+      ->GetKeyValueStore(embedding_name, rank_id)
+      ->ResetStatistics();
+}
+
+void SetEmbeddingCurrentStep(const std::string& embedding_name, int64_t rank_id, uint64_t step) {
+  Global<embedding::EmbeddingManager>::Get()
+      ->GetKeyValueStore(embedding_name, rank_id)
+      ->SetCurrentStep(step);
+}
+
+uint64_t EvictExpiredEmbeddingRows(const std::string& embedding_name, int64_t rank_id) {
+  return Global<embedding::EmbeddingManager>::Get()
+      ->GetKeyValueStore(embedding_name, rank_id)
+      ->EvictExpired();
+}
+
+// Writes rows into the store of an embedding created on this process, mainly to seed tests.
+void PutEmbeddingRows(const std::string& embedding_name, int64_t rank_id, const py::array& keys,
+                      const py::array& values) {
+  embedding::KeyValueStore* store =
+      Global<embedding::EmbeddingManager>::Get()->GetKeyValueStore(embedding_name, rank_id);
+  CHECK(keys.flags() & py::array::c_style);
+  CHECK(values.flags() & py::array::c_style);
+  CHECK_EQ(keys.itemsize(), store->KeySize());
+  const uint32_t num_keys = keys.size();
+  CHECK_EQ(values.nbytes(), num_keys * store->ValueSize());
+  if (num_keys == 0) { return; }
+  auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(
+      DeviceType::kCUDA, GlobalProcessCtx::LocalRank());
+  CHECK(device);
+  device->SetAsActiveDevice();
+  void* keys_ptr = nullptr;
+  void* values_ptr = nullptr;
+  OF_CUDA_CHECK(cudaMalloc(&keys_ptr, keys.nbytes()));
+  OF_CUDA_CHECK(cudaMalloc(&values_ptr, values.nbytes()));
+  OF_CUDA_CHECK(cudaMemcpy(keys_ptr, keys.data(), keys.nbytes(), cudaMemcpyDefault));
+  OF_CUDA_CHECK(cudaMemcpy(values_ptr, values.data(), values.nbytes(), cudaMemcpyDefault));
+  ep::Stream* stream = device->CreateStream();
+  store->ReserveQueryLength(num_keys);
+  store->Put(stream, num_keys, keys_ptr, values_ptr);
+  CHECK_JUST(stream->Sync());
+  device->DestroyStream(stream);
+  OF_CUDA_CHECK(cudaFree(keys_ptr));
+  OF_CUDA_CHECK(cudaFree(values_ptr));
+}
+
+}  // namespace
+
+#endif  // WITH_CUDA
+
+ONEFLOW_API_PYBIND11_MODULE("embedding", m) {
+  m.def("CompactPersistentTableSnapshot", &embedding::CompactPersistentTableSnapshot,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("PlanIdShuffleColumnParallelIds", &PlanIdShuffleColumnParallelIds);
+#ifdef WITH_CUDA
+  m.def("GetEmbeddingStatistics", &GetEmbeddingStatistics);
+  m.def("ResetEmbeddingStatistics", &ResetEmbeddingStatistics);
+  m.def("SetEmbeddingCurrentStep", &SetEmbeddingCurrentStep);
+  m.def("EvictExpiredEmbeddingRows", &EvictExpiredEmbeddingRows,
+        py::call_guard<py::gil_scoped_release>());
+  m.def("PutEmbeddingRows", &PutEmbeddingRows);
+#endif  // WITH_CUDA
+}
+
+}  // namespace oneflow
@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_util.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistent_out_stream.h"
+#include "oneflow/core/register/ofblob.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+namespace {
+
+// Schedules a write of the data of an eager local tensor to the file. The data is first copied
+// to a new host tensor by the virtual machine, so the value at the time of the call is written
+// even if the tensor is updated later, and neither the copy nor the write blocks the caller.
+Maybe<int64_t> WriteTensorAsync(const std::shared_ptr<one::Tensor>& tensor,
+                                const std::string& snapshot_root_path,
+                                const std::string& file_path) {
+  CHECK_OR_RETURN(tensor->is_local() && tensor->is_eager())
+      << "only eager local tensors can be saved asynchronously";
+  const auto& contiguous = JUST(one::functional::ToContiguous(tensor));
+  const auto& staged = JUST(one::functional::Copy(contiguous, "cpu", 0));
+  return Global<AsyncSnapshotWriter>::Get()->Schedule(snapshot_root_path, [staged, file_path]() {
+    const size_t size =
+        staged->shape()->elem_cnt() * GetSizeOfDataType(staged->dtype()->data_type());
+    std::vector<char> buffer(size);
+    CHECK_JUST(one::SyncAccessTensorWithTimeOut(
+        staged,
+        [&](uint64_t of_blob_ptr) {
+          const auto* of_blob = reinterpret_cast<OfBlob*>(of_blob_ptr);
+          std::memcpy(buffer.data(), of_blob->blob().dptr(), size);
+        },
+        "const"));
+    PersistentOutStream out_stream(LocalFS(), file_path);
+    out_stream.Write(buffer.data(), size);
+  });
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+ONEFLOW_API_PYBIND11_MODULE("async_snapshot", m) {
+  using namespace oneflow;
+  m.def("WriteTensor", [](const std::shared_ptr<one::Tensor>& tensor,
+                          const std::string& snapshot_root_path, const std::string& file_path) {
+    return WriteTensorAsync(tensor, snapshot_root_path, file_path).GetOrThrow();
+  });
+  m.def("IsDone", [](int64_t snapshot_id) {
+    return Global<AsyncSnapshotWriter>::Get()->IsDone(snapshot_id);
+  });
+  m.def(
+      "Wait", [](int64_t snapshot_id) { Global<AsyncSnapshotWriter>::Get()->Wait(snapshot_id); },
+      py::call_guard<py::gil_scoped_release>());
+  m.def(
+      "WaitAll", []() { Global<AsyncSnapshotWriter>::Get()->WaitAll(); },
+      py::call_guard<py::gil_scoped_release>());
+}
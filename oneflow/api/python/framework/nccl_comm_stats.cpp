@@ -0,0 +1,45 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/job/eager_nccl_comm_manager.h"
+
+namespace py = pybind11;
+
+ONEFLOW_API_PYBIND11_MODULE("nccl", m) {
+  using namespace oneflow;
+  // The number of nccl communicators created by this process, how many of them were split from
+  // the communicator of their device set, and roughly how much device memory they hold.
+  m.def("GetCommStats", []() {
+    py::dict stats;
+    int64_t num_comms = 0;
+    int64_t num_split_comms = 0;
+    int64_t memory_bytes = 0;
+#ifdef WITH_CUDA
+    if (Global<EagerNcclCommMgr>::Get() != nullptr) {
+      const EagerNcclCommStats comm_stats = Global<EagerNcclCommMgr>::Get()->GetStats();
+      num_comms = comm_stats.num_comms;
+      num_split_comms = comm_stats.num_split_comms;
+      memory_bytes = comm_stats.memory_bytes;
+    }
+#endif  // WITH_CUDA
+    stats["num_comms"] = num_comms;
+    stats["num_split_comms"] = num_split_comms;
+    stats["memory_bytes"] = memory_bytes;
+    return stats;
+  });
+}
@@ -75,6 +75,8 @@ ONEFLOW_API_PYBIND11_MODULE("nn.graph.", m) {
            })
       .def_property_readonly("additional_var_names", &APINNGraphAdditionalVarNames)
       .def_property_readonly("additional_var_tensors", &APINNGraphAdditionalVarTensors)
+      .def("update_folded_variables",
+           [](NNGraph& graph) { return graph.UpdateFoldedVariables().GetOrThrow(); })
       .def("complie_and_init_runtime",
            [](NNGraph& graph) { return graph.CompileAndInitRuntime().GetOrThrow(); });
 
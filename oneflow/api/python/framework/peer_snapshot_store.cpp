@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/persistence/peer_snapshot_store.h"
+
+namespace py = pybind11;
+
+ONEFLOW_API_PYBIND11_MODULE("peer_snapshot", m) {
+  using namespace oneflow;
+  m.def("Replicate", [](const std::string& name, int64_t step, const py::bytes& shard) {
+    std::string data(shard);
+    py::gil_scoped_release release;
+    Global<PeerSnapshotStore>::Get()->Replicate(name, step, std::move(data));
+  });
+  m.def("IsReplicated", []() { return Global<PeerSnapshotStore>::Get()->IsReplicated(); });
+  m.def(
+      "WaitReplicated", []() { Global<PeerSnapshotStore>::Get()->WaitReplicated(); },
+      py::call_guard<py::gil_scoped_release>());
+  // Returns (step, shard), or None if the shards can not be restored from the peers.
+  m.def("Restore", [](const std::string& name) -> py::object {
+    int64_t step = -1;
+    std::string shard;
+    bool restored = false;
+    {
+      py::gil_scoped_release release;
+      restored = Global<PeerSnapshotStore>::Get()->Restore(name, &step, &shard).GetOrThrow();
+    }
+    if (!restored) { return py::none(); }
+    return py::make_tuple(step, py::bytes(shard));
+  });
+}
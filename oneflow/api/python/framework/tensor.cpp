@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/api/python/functional/tensor_api.yaml.pybind.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_rpc_util.h"
+#include "oneflow/core/framework/tensor_util.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/stride.h"
 #include "oneflow/core/framework/py_distribute.h"
@@ -189,6 +190,8 @@ ONEFLOW_API_PYBIND11_MODULE("", m) {
       .def("contiguous", &Tensor::contiguous)
       .def_property_readonly("grad_fn", &Tensor::grad_fn_node)
       .def_property_readonly("is_leaf", &Tensor::is_leaf)
+      .def_property_readonly("_version",
+                             [](const Tensor& t) { return TensorVersion(t).GetOrThrow(); })
       .def_property("requires_grad", &Tensor::requires_grad, &ApiSetRequiresGrad)
       // Methods of pytorch
       .def(
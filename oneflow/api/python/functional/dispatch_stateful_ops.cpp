@@ -52,6 +52,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
+         const std::string& shuffle_mode, int64_t start_sample, bool raw_records,
          const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr("data_dir", data_dir));
@@ -63,6 +64,9 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("random_shuffle", random_shuffle));
         JUST(attrs.SetAttr("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr("seed", seed));
+        JUST(attrs.SetAttr("shuffle_mode", shuffle_mode));
+        JUST(attrs.SetAttr("start_sample", start_sample));
+        JUST(attrs.SetAttr("raw_records", raw_records));
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -70,6 +74,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
+         const std::string& shuffle_mode, int64_t start_sample, bool raw_records,
          const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         MutableAttrMap attrs;
@@ -82,6 +87,9 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("random_shuffle", random_shuffle));
         JUST(attrs.SetAttr("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr("seed", seed));
+        JUST(attrs.SetAttr("shuffle_mode", shuffle_mode));
+        JUST(attrs.SetAttr("start_sample", start_sample));
+        JUST(attrs.SetAttr("raw_records", raw_records));
         JUST(attrs.SetAttr("nd_sbp", *JUST(GetNdSbpStrList(sbp_tuple))));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
@@ -168,6 +176,34 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("output_dtype", output_dtype->data_type()));
         return OpInterpUtil::Dispatch<Tensor>(*op, {input}, attrs);
       });
+  m.add_functor(
+      "DispatchImageAugment",
+      [](const std::shared_ptr<OpExpr>& op, const TensorTuple& input, int64_t target_height,
+         int64_t target_width, const std::string& interpolation_type,
+         const std::vector<float>& random_area, const std::vector<float>& random_aspect_ratio,
+         float flip_prob, float rotate_degrees, float brightness, float contrast, float saturation,
+         float hue, const std::vector<float>& mean, const std::vector<float>& std,
+         const std::string& color_space, const std::string& output_layout,
+         int64_t seed) -> Maybe<Tensor> {
+        MutableAttrMap attrs;
+        JUST(attrs.SetAttr("target_height", target_height));
+        JUST(attrs.SetAttr("target_width", target_width));
+        JUST(attrs.SetAttr("interpolation_type", interpolation_type));
+        JUST(attrs.SetAttr("random_area", random_area));
+        JUST(attrs.SetAttr("random_aspect_ratio", random_aspect_ratio));
+        JUST(attrs.SetAttr("flip_prob", flip_prob));
+        JUST(attrs.SetAttr("rotate_degrees", rotate_degrees));
+        JUST(attrs.SetAttr("brightness", brightness));
+        JUST(attrs.SetAttr("contrast", contrast));
+        JUST(attrs.SetAttr("saturation", saturation));
+        JUST(attrs.SetAttr("hue", hue));
+        JUST(attrs.SetAttr("mean", mean));
+        JUST(attrs.SetAttr("std", std));
+        JUST(attrs.SetAttr("color_space", color_space));
+        JUST(attrs.SetAttr("output_layout", output_layout));
+        JUST(attrs.SetAttr("seed", seed));
+        return OpInterpUtil::Dispatch<Tensor>(*op, input, attrs);
+      });
   m.add_functor(
       "DispatchOfrecordImageDecoderRandomCrop",
       [](const std::shared_ptr<OpExpr>& op, const std::shared_ptr<Tensor>& input,
@@ -197,7 +233,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
                    int64_t target_width, int64_t target_height, int64_t seed, int64_t num_workers,
                    int64_t max_num_pixels, float random_area_min, float random_area_max,
                    float random_aspect_ratio_min, float random_aspect_ratio_max,
-                   int64_t warmup_size, int64_t num_attempts) -> Maybe<Tensor> {
+                   int64_t warmup_size, int64_t num_attempts, const std::vector<float>& mean,
+                   const std::vector<float>& std) -> Maybe<Tensor> {
                   MutableAttrMap attrs;
                   JUST(attrs.SetAttr("target_width", target_width));
                   JUST(attrs.SetAttr("target_height", target_height));
@@ -210,6 +247,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
                   JUST(attrs.SetAttr("random_aspect_ratio_max", random_aspect_ratio_max));
                   JUST(attrs.SetAttr("warmup_size", warmup_size));
                   JUST(attrs.SetAttr("num_attempts", num_attempts));
+                  JUST(attrs.SetAttr("mean", mean));
+                  JUST(attrs.SetAttr("std", std));
                   return OpInterpUtil::Dispatch<Tensor>(*op, {input}, attrs);
                 });
   m.add_functor(
@@ -334,7 +373,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::vector<std::string>& files,
          const int64_t batch_size, const bool random_shuffle, const std::string& shuffle_mode,
          const int32_t shuffle_buffer_size, const bool shuffle_after_epoch, int64_t random_seed,
-         const bool verify_example, const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
+         const bool verify_example, int64_t start_sample,
+         const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr<std::vector<std::string>>("files", files));
         JUST(attrs.SetAttr<int64_t>("batch_size", batch_size));
@@ -344,6 +384,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr<bool>("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr<int64_t>("seed", random_seed));
         JUST(attrs.SetAttr<bool>("verify_example", verify_example));
+        JUST(attrs.SetAttr<int64_t>("start_sample", start_sample));
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -351,7 +392,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::vector<std::string>& files,
          const int64_t batch_size, const bool random_shuffle, const std::string& shuffle_mode,
          const int32_t shuffle_buffer_size, const bool shuffle_after_epoch, int64_t random_seed,
-         const bool verify_example, const Symbol<ParallelDesc>& placement,
+         const bool verify_example, int64_t start_sample, const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr<std::vector<std::string>>("files", files));
@@ -362,6 +403,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr<bool>("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr<int64_t>("seed", random_seed));
         JUST(attrs.SetAttr<bool>("verify_example", verify_example));
+        JUST(attrs.SetAttr<int64_t>("start_sample", start_sample));
         JUST(attrs.SetAttr("nd_sbp", *JUST(GetNdSbpStrList(sbp_tuple))));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
@@ -372,7 +414,9 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_file_prefix, int64_t seq_length,
          int64_t label_length, int64_t num_samples, int64_t batch_size, const Symbol<DType>& dtype,
          const std::vector<int64_t>& split_sizes, int64_t split_index, bool shuffle,
-         int64_t random_seed, const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
+         int64_t random_seed, const std::vector<std::string>& blend_data_file_prefixes,
+         const std::vector<float>& blend_weights,
+         const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr("data_file_prefix", data_file_prefix));
         JUST(attrs.SetAttr("seq_length", seq_length));
@@ -384,6 +428,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("split_index", split_index));
         JUST(attrs.SetAttr("shuffle", shuffle));
         JUST(attrs.SetAttr("random_seed", random_seed));
+        JUST(attrs.SetAttr("blend_data_file_prefixes", blend_data_file_prefixes));
+        JUST(attrs.SetAttr("blend_weights", blend_weights));
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -391,7 +437,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_file_prefix, int64_t seq_length,
          int64_t label_length, int64_t num_samples, int64_t batch_size, const Symbol<DType>& dtype,
          const std::vector<int64_t>& split_sizes, int64_t split_index, bool shuffle,
-         int64_t random_seed, const Symbol<ParallelDesc>& placement,
+         int64_t random_seed, const std::vector<std::string>& blend_data_file_prefixes,
+         const std::vector<float>& blend_weights, const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr("data_file_prefix", data_file_prefix));
@@ -404,6 +451,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("split_index", split_index));
         JUST(attrs.SetAttr("shuffle", shuffle));
         JUST(attrs.SetAttr("random_seed", random_seed));
+        JUST(attrs.SetAttr("blend_data_file_prefixes", blend_data_file_prefixes));
+        JUST(attrs.SetAttr("blend_weights", blend_weights));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
                                               OpExprInterpContext(attrs, placement, nd_sbp));
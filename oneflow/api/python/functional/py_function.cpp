@@ -118,6 +118,50 @@ bool ParseArgs(const py::args& args, const py::kwargs& kwargs, std::vector<Pytho
   return true;
 }
 
+namespace {
+
+// Same as PythonArg::TypeCheck for the types listed in `fast_path_types` of
+// tools/functional/generator.py.
+bool FastTypeCheck(PyObject* obj, ValueType type) {
+  switch (type) {
+    case kTENSOR:
+    case kTENSOR_REF: return PyTensorCheck(obj);
+    case kSCALAR: return PyScalarCheck(obj);
+    case kTENSOR_INDEX: return PyTensorIndexCheck(obj);
+    case kINT32:
+    case kINT64:
+    case kBOOL: return PyLong_Check(obj);
+    case kFLOAT:
+    case kDOUBLE: return PyFloat_Check(obj) || PyLong_Check(obj);
+    default: return false;
+  }
+}
+
+}  // namespace
+
+bool FastParseArgs(const py::args& args, std::vector<PythonArg>* parsed_args,
+                   const FunctionDef& function, size_t max_pos_args) {
+  const size_t nargs = PyTuple_GET_SIZE(args.ptr());
+  if (nargs > max_pos_args) { return false; }
+  // Keyword-only parameters follow the positional ones, so the first nargs parameters are
+  // exactly the positional arguments given.
+  for (size_t i = 0; i < function.argument_def.size(); ++i) {
+    const auto& param = function.argument_def[i];
+    if (i < nargs) {
+      PyObject* obj = PyTuple_GET_ITEM(args.ptr(), i);
+      if (!(obj == Py_None && param.optional) && !FastTypeCheck(obj, param.type)) {
+        return false;
+      }
+      (*parsed_args)[i] = PythonArg(obj, param.size);
+    } else if (param.has_default_value) {
+      (*parsed_args)[i] = PythonArg(param.default_value);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace functional
 }  // namespace one
 }  // namespace oneflow
@@ -29,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/core/framework/op_interpreter/dispatch_frame.h"
+#include "oneflow/core/profiler/memory_trace.h"
 
 namespace py = pybind11;
 
@@ -40,6 +41,12 @@ bool ParseArgs(const py::args& args, const py::kwargs& kwargs,  // NOLINT
                std::vector<PythonArg>* parsed_args, const FunctionDef& function,
                size_t max_pos_args, bool raise_exception);
 
+// Parses positional-only calls of the schemas generated with `fast_path`, whose positional
+// parameters are all matched by a C-level type check. It neither touches the kwargs nor copies
+// the arguments into py::object, and rejects exactly the calls ParseArgs would reject.
+bool FastParseArgs(const py::args& args, std::vector<PythonArg>* parsed_args,
+                   const FunctionDef& function, size_t max_pos_args);
+
 template<typename... SchemaT>
 class PyFunctionDispatcher {
  public:
@@ -59,6 +66,13 @@ class PyFunctionDispatcher {
                   std::index_sequence<I0, I...>) const {
     using T = schema_t<I0>;
     std::vector<PythonArg> parsed_args(T::max_args);
+    if (T::fast_path && kwargs.size() == 0) {
+      if (FastParseArgs(args, &parsed_args, T::function_def, T::max_pos_args)) {
+        return detail::unpack_call(*T::func, parsed_args);
+      }
+      // Let ParseArgs raise the error if there is no other schema to try.
+      if (schema_size_ > 1) { return call(args, kwargs, std::index_sequence<I...>{}); }
+    }
     if (ParseArgs(args, kwargs, &parsed_args, T::function_def, T::max_pos_args,
                   /*raise_exception*/ schema_size_ == 1)) {
       return detail::unpack_call(*T::func, parsed_args);
@@ -120,7 +134,7 @@ template<typename... SchemaT>
 inline py::object PyFunction(const py::args& args, const py::kwargs& kwargs) {
   static PyFunctionDispatcher<SchemaT...> dispatcher;
 
-  if (OF_PREDICT_FALSE(LazyMode::is_enabled())) {
+  if (OF_PREDICT_FALSE(LazyMode::is_enabled() || profiler::MemoryTraceStackEnabled())) {
     // Create the last 2 frame stack string in Python Interpreter.
     std::string cur_f_str =
         get_cur_frame_stack_str() + "; C API: <func " + dispatcher.func_name() + ">";
@@ -55,6 +55,10 @@ class PythonArg {
   PythonArg(const py::object& object, int size)
       : object_(object.ptr()), immediate_(), size_(size), active_tag_(HAS_OBJECT) {}
 
+  // Borrows the object, which must outlive the argument.
+  PythonArg(PyObject* object, int size)
+      : object_(object), immediate_(), size_(size), active_tag_(HAS_OBJECT) {}
+
   PythonArg(const std::shared_ptr<const detail::Immediate>& value)
       : object_(nullptr), immediate_(value), size_(0), active_tag_(HAS_IMMEDIATE) {}
 
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/api/python/utils/tensor_utils.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/framework/stream.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/core/ipc/cuda_ipc_memory.h"
+#ifdef WITH_CUDA
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#endif  // WITH_CUDA
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+namespace {
+
+#ifdef WITH_CUDA
+
+// Copies `t` to a block of the CUDA IPC pool on the stream that produces it, and returns what a
+// receiver needs to map the block.
+Maybe<py::tuple> ShareCudaTensor(const std::shared_ptr<one::Tensor>& t) {
+  const auto& tensor = JUST(t->AsMirroredTensor());
+  CHECK_OR_RETURN(tensor->is_eager()) << "eager tensors supported only.";
+  CHECK_OR_RETURN(tensor->is_cuda()) << "cuda tensors supported only.";
+  CHECK_OR_RETURN(tensor->is_contiguous()) << "contiguous tensors supported only.";
+  const size_t size =
+      tensor->shape()->elem_cnt() * GetSizeOfDataType(tensor->dtype()->data_type());
+  void* block_dptr = nullptr;
+  const auto& desc = JUST(ipc::CudaIpcMemoryPool::get().Acquire(
+      JUST(tensor->device())->device_id(), size, &block_dptr));
+  const auto& Callback = [&](uint64_t ofblob_ptr) {
+    auto* of_blob = reinterpret_cast<OfBlob*>(ofblob_ptr);
+    OF_CUDA_CHECK(cudaMemcpyAsync(block_dptr, of_blob->blob().dptr(), size, cudaMemcpyDefault,
+                                  of_blob->stream()->As<ep::CudaStream>()->cuda_stream()));
+    // The receiver reads the block as soon as it gets the handle.
+    CHECK_JUST(of_blob->stream()->Sync());
+  };
+  auto btb = std::make_shared<BlockingThenBusy>(1);
+  JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    return builder->SyncAccessBlobByCallback(tensor, btb, Callback, "const");
+  }));
+  JUST(btb->WaitUntilCntEqualZero(VirtualMachine::GetPredicatorNoMoreInstructionsFinished()));
+  return py::make_tuple(py::bytes(desc->mem_handle), desc->ref_counts_name, desc->device_id,
+                        desc->block_id, desc->size);
+}
+
+// Builds a tensor on a block shared by ShareCudaTensor, which is given back once the tensor
+// storage is freed.
+Maybe<one::Tensor> RebuildCudaTensor(const std::string& mem_handle,
+                                     const std::string& ref_counts_name, int64_t device_id,
+                                     int64_t block_id, size_t size, const Shape& shape,
+                                     const Symbol<DType>& dtype) {
+  ipc::CudaIpcMemoryDesc desc;
+  desc.mem_handle = mem_handle;
+  desc.ref_counts_name = ref_counts_name;
+  desc.device_id = device_id;
+  desc.block_id = block_id;
+  desc.size = size;
+  const auto& memory = JUST(ipc::CudaIpcMemory::Open(desc));
+
+  const auto& shape_ptr = std::make_shared<Shape>(shape);
+  const auto& device = JUST(Device::New("cuda", device_id));
+  const auto& tensor_meta = std::make_shared<one::MirroredTensorMeta>(
+      shape_ptr, dtype->data_type(), device, std::make_shared<Stride>(shape), 0);
+  auto tensor_data = std::make_shared<vm::TensorStorage>();
+  char* dptr = static_cast<char*>(memory->mut_dptr());
+  tensor_data->set_blob_dptr(
+      std::unique_ptr<char, std::function<void(char*)>>(dptr, [memory](char*) {}),
+      shape.elem_cnt() * GetSizeOfDataType(dtype->data_type()));
+  auto tensor_storage = std::make_shared<one::TensorStorage>(tensor_data);
+  auto tensor_impl = std::make_shared<one::EagerMirroredTensorImpl>(tensor_meta, tensor_storage,
+                                                                    /*requires_grad=*/false,
+                                                                    /*ls_leaf=*/true);
+  JUST(tensor_impl->InitEagerBlobObject(NewLocalDepObject()));
+  JUST(tensor_impl->eager_blob_object())->set_last_used_stream(GetDefaultStreamByDevice(device));
+  JUST(JUST(tensor_impl->eager_blob_object())->TryInitBlob());
+  JUST(tensor_impl->eager_blob_object())->mut_blob()->reset_dptr(dptr);
+  return std::shared_ptr<one::Tensor>(new one::MirroredTensor(tensor_impl));
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace
+
+ONEFLOW_API_PYBIND11_MODULE("multiprocessing", m) {
+#ifdef WITH_CUDA
+  m.def("share_cuda_tensor",
+        [](const std::shared_ptr<one::Tensor>& t) { return ShareCudaTensor(t).GetOrThrow(); });
+  m.def("rebuild_cuda_tensor",
+        [](const py::bytes& mem_handle, const std::string& ref_counts_name, int64_t device_id,
+           int64_t block_id, size_t size, const std::vector<int64_t>& shape,
+           const Symbol<DType>& dtype) {
+          return RebuildCudaTensor(mem_handle, ref_counts_name, device_id, block_id, size,
+                                   Shape(DimVector(shape.begin(), shape.end())), dtype)
+              .GetPtrOrThrow();
+        });
+#endif  // WITH_CUDA
+}
+
+}  // namespace oneflow
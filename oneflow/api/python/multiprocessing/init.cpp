@@ -55,14 +55,14 @@ void multiprocessing_init() {
 }
 
 void set_num_threads(int num) {
-  int64_t cpu_logic_core = std::thread::hardware_concurrency();
+  int64_t cpu_logic_core = ep::GetNumAvailableCpus();
   if (num <= 0) {
     py::print("Warning : ", num, " less than 1 will be set to 1.");
     num = 1;
   } else if (num >= cpu_logic_core) {
     py::print("Warning : ", num,
-              " is greater than the number of logical cores and will be set to the maximum number "
-              "of logical cores ",
+              " is greater than the number of available cpus and will be set to the maximum number "
+              "of available cpus ",
               cpu_logic_core);
     num = cpu_logic_core;
   }
@@ -37,6 +37,15 @@ ONEFLOW_API_PYBIND11_MODULE("multiprocessing", m) {
                              })
       .def_property_readonly("name", &ipc::SharedMemory::name)
       .def_property_readonly("size", &ipc::SharedMemory::size);
+  m.def("acquire_pooled_shared_memory", [](size_t size) {
+    return ipc::SharedMemoryPool::get().Acquire(size).GetPtrOrThrow();
+  });
+  m.def("open_pooled_shared_memory", [](const std::string& name) {
+    return ipc::SharedMemoryPool::get().Open(name).GetPtrOrThrow();
+  });
+  m.def("release_pooled_shared_memory",
+        [](ipc::SharedMemory* shm) { return ipc::SharedMemoryPool::Release(shm); });
+  m.attr("pooled_shared_memory_header_size") = py::int_(ipc::SharedMemoryPool::kHeaderSize);
   m.def("unlink_all_shared_memory",
         []() { return ipc::SharedMemoryManager::get().UnlinkAllShms(); });
 }
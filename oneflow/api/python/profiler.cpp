@@ -17,6 +17,14 @@ limitations under the License.
 #include "oneflow/api/python/of_api_registry.h"
 
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/instruction_trace.h"
+#include "oneflow/core/profiler/collective_trace.h"
+#include "oneflow/core/profiler/kernel_metrics.h"
+#include "oneflow/core/profiler/data_reader_metrics.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
+#include "oneflow/core/profiler/managed_memory_metrics.h"
+#include "oneflow/core/profiler/event_trace.h"
+#include "oneflow/core/profiler/memory_trace.h"
 
 namespace py = pybind11;
 
@@ -30,6 +38,74 @@ ONEFLOW_API_PYBIND11_MODULE("profiler", m) {
   m.def("ProfilerStart", []() { profiler::ProfilerStart(); });
 
   m.def("ProfilerStop", []() { profiler::ProfilerStop(); });
+
+  m.def("EnableInstructionTrace", []() { profiler::EnableInstructionTrace(); });
+
+  m.def("DisableInstructionTrace", []() { profiler::DisableInstructionTrace(); });
+
+  m.def("ResetInstructionTrace", []() { profiler::ResetInstructionTrace(); });
+
+  m.def("GetInstructionLatencySummary", []() { return profiler::GetInstructionLatencySummary(); });
+
+  m.def("DumpInstructionChromeTrace",
+        [](const std::string& path) { profiler::DumpInstructionChromeTrace(path); });
+
+  m.def("EnableCollectiveTrace", []() { profiler::EnableCollectiveTrace(); });
+
+  m.def("DisableCollectiveTrace", []() { profiler::DisableCollectiveTrace(); });
+
+  m.def("ResetCollectiveTrace", []() { profiler::ResetCollectiveTrace(); });
+
+  m.def("GetCollectiveSummary", []() { return profiler::GetCollectiveSummary(); });
+
+  m.def("DumpCollectiveChromeTrace",
+        [](const std::string& path) { profiler::DumpCollectiveChromeTrace(path); });
+
+  m.def("EnableKernelMetrics", []() { profiler::EnableKernelMetrics(); });
+
+  m.def("DisableKernelMetrics", []() { profiler::DisableKernelMetrics(); });
+
+  m.def("ResetKernelMetrics", []() { profiler::ResetKernelMetrics(); });
+
+  m.def("GetKernelMetricsSummary", []() { return profiler::GetKernelMetricsSummary(); });
+
+  m.def("ResetDataReaderMetrics", []() { profiler::ResetDataReaderMetrics(); });
+
+  m.def("GetDataReaderMetricsSummary", []() { return profiler::GetDataReaderMetricsSummary(); });
+
+  m.def("ResetCheckpointIOMetrics", []() { profiler::ResetCheckpointIOMetrics(); });
+
+  m.def("GetCheckpointIOMetricsSummary",
+        []() { return profiler::GetCheckpointIOMetricsSummary(); });
+
+  m.def("ResetManagedMemoryMetrics", []() { profiler::ResetManagedMemoryMetrics(); });
+
+  m.def("GetManagedMemoryMetricsSummary",
+        []() { return profiler::GetManagedMemoryMetricsSummary(); });
+
+  m.def("EnableEventTrace", []() { profiler::EnableEventTrace(); });
+
+  m.def("DisableEventTrace", []() { profiler::DisableEventTrace(); });
+
+  m.def("ResetEventTrace", []() { profiler::ResetEventTrace(); });
+
+  m.def("GetEventTraceOpSummary", []() { return profiler::GetEventTraceOpSummary(); });
+
+  m.def("GetEventTraceKernelSummary", []() { return profiler::GetEventTraceKernelSummary(); });
+
+  m.def("DumpEventTraceChromeTrace",
+        [](const std::string& path) { profiler::DumpEventTraceChromeTrace(path); });
+
+  m.def("EnableMemoryTrace", [](bool record_stack) { profiler::EnableMemoryTrace(record_stack); });
+
+  m.def("DisableMemoryTrace", []() { profiler::DisableMemoryTrace(); });
+
+  m.def("ResetMemoryTrace", []() { profiler::ResetMemoryTrace(); });
+
+  m.def("GetMemorySnapshot", [](bool at_peak) { return profiler::GetMemorySnapshot(at_peak); });
+
+  m.def("DumpMemoryTimelineChromeTrace",
+        [](const std::string& path) { profiler::DumpMemoryTimelineChromeTrace(path); });
 }
 
 }  // namespace oneflow
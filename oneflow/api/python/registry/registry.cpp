@@ -17,10 +17,14 @@ limitations under the License.
 #include <pybind11/pybind11.h>
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/common/registry_error.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
 
 namespace py = pybind11;
 
 ONEFLOW_API_PYBIND11_MODULE("", m) {
   m.def("CheckAndClearRegistryFlag",
         []() { return oneflow::CheckAndClearRegistryFlag().GetOrThrow(); });
+  m.def("GetRegistrationTimeSummary", []() {
+    return oneflow::user_op::UserOpRegistryMgr::Get().GetRegistrationTimeSummary();
+  });
 }
@@ -14,9 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <string>
 #include "oneflow/core/auto_parallel/boxing_collector.h"
+#include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/framework/nd_sbp.h"
@@ -28,6 +32,7 @@ limitations under the License.
 #include "oneflow/core/framework/sbp_infer_util.h"
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/job/lazy_mode.h"
+#include "oneflow/core/persistence/file_system.h"
 
 namespace oneflow {
 
@@ -69,6 +74,80 @@ Maybe<NdSbp> SetNdSbpDim(NdSbp nd_sbp, int32_t hierarchy_num) {
   return new_sbp;
 }
 
+// The virtual hierarchies the uncustomized tables are generated on
+Shape VirtualHierarchy4SamePlacement() {
+  int32_t world_size = GlobalProcessCtx::WorldSize();
+  return Shape({4 * world_size, 4 * world_size});
+}
+
+Shape VirtualInHierarchy4DiffPlacement() {
+  int32_t world_size = GlobalProcessCtx::WorldSize();
+  return Shape({4 * world_size + 1, 4 * world_size});
+}
+
+// Bump it whenever the generation of the tables or the cache format changes.
+constexpr uint32_t kBoxingCollectorCacheVersion = 1;
+constexpr uint32_t kBoxingCollectorCacheMagic = 0x4342464f;  // "OFBC"
+// Guard against allocating for a corrupted size
+constexpr uint64_t kMaxCachedTableSize = 1 << 24;
+
+template<typename T>
+void WriteCacheTable(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteCacheTable(std::ostream& out, const std::string& value) {
+  WriteCacheTable<uint64_t>(out, value.size());
+  out.write(value.data(), value.size());
+}
+
+template<typename T>
+void WriteCacheTable(std::ostream& out, const std::vector<T>& values) {
+  WriteCacheTable<uint64_t>(out, values.size());
+  for (const auto& value : values) { WriteCacheTable(out, value); }
+}
+
+template<typename T>
+bool ReadCacheTable(std::istream& in, T* value) {
+  in.read(reinterpret_cast<char*>(value), sizeof(T));
+  return in.good();
+}
+
+bool ReadCacheTable(std::istream& in, std::string* value) {
+  uint64_t size = 0;
+  if (!ReadCacheTable(in, &size) || size > kMaxCachedTableSize) { return false; }
+  value->resize(size);
+  in.read(&(*value)[0], size);
+  return in.good();
+}
+
+template<typename T>
+bool ReadCacheTable(std::istream& in, std::vector<T>* values) {
+  uint64_t size = 0;
+  if (!ReadCacheTable(in, &size) || size > kMaxCachedTableSize) { return false; }
+  values->resize(size);
+  for (auto& value : *values) {
+    if (!ReadCacheTable(in, &value)) { return false; }
+  }
+  return true;
+}
+
+// The cache is disabled if ONEFLOW_BOXING_COLLECTOR_CACHE_DIR is not set.
+std::string CachePath4UncustomizedTables(int32_t max_axis, int32_t hierarchy_num,
+                                         int32_t max_middle_node_num) {
+  const std::string cache_dir = GetStringFromEnv("ONEFLOW_BOXING_COLLECTOR_CACHE_DIR", "");
+  if (cache_dir.empty()) { return ""; }
+  const Shape same_hierarchy = VirtualHierarchy4SamePlacement();
+  const Shape diff_in_hierarchy = VirtualInHierarchy4DiffPlacement();
+  const std::string file_name =
+      "boxing_collector_v" + std::to_string(kBoxingCollectorCacheVersion) + "_axis"
+      + std::to_string(max_axis) + "_dim" + std::to_string(hierarchy_num) + "_middle"
+      + std::to_string(max_middle_node_num) + "_" + std::to_string(same_hierarchy.At(0)) + "x"
+      + std::to_string(same_hierarchy.At(1)) + "_" + std::to_string(diff_in_hierarchy.At(0)) + "x"
+      + std::to_string(diff_in_hierarchy.At(1)) + ".bin";
+  return JoinPath(cache_dir, file_name);
+}
+
 }  // namespace
 
 // A constructor with init, designed for uncustomized boxing collector
@@ -83,16 +162,89 @@ Maybe<void> BoxingCollector::Init(int32_t max_axis) {
   // Set up at least two split for op graph.
   // For a negative example: Resnet50 only have B, P, S(0)
   CollectUniverse(max_axis);
-  GenerateNdSbpList(2);
+  constexpr int32_t kHierarchyNum = 2;
+  constexpr int32_t kMaxMiddleNodeNum = 3;
+  GenerateNdSbpList(kHierarchyNum);
   GenerateMap1d2nd();
+  const std::string cache_path =
+      CachePath4UncustomizedTables(max_axis, kHierarchyNum, kMaxMiddleNodeNum);
+  if (!cache_path.empty() && LoadCombinations(cache_path)) { return Maybe<void>::Ok(); }
   // Get copy cost in lazy mode
   LazyMode::Guard enable_lazy_mode(true);
-  JUST(GenerateCombination4SamePlacement(3));
+  JUST(GenerateCombination4SamePlacement(kMaxMiddleNodeNum));
   JUST(GenerateCombination4DiffHierarchy(this, this));
   JUST(GenerateCombination4DiffPlacement(this, this));
+  if (!cache_path.empty()) { SaveCombinations(cache_path); }
   return Maybe<void>::Ok();
 }
 
+bool BoxingCollector::LoadCombinations(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) { return false; }
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  double transfer_cost = 0;
+  std::vector<std::string> nd_sbp_strs;
+  if (!ReadCacheTable(in, &magic) || magic != kBoxingCollectorCacheMagic
+      || !ReadCacheTable(in, &version) || version != kBoxingCollectorCacheVersion
+      || !ReadCacheTable(in, &transfer_cost) || transfer_cost != GetTransferCost()
+      || !ReadCacheTable(in, &nd_sbp_strs) || nd_sbp_strs.size() != nd_sbp_lists_.size()) {
+    LOG(WARNING) << "Ignore the mismatched boxing collector cache " << path;
+    return false;
+  }
+  for (int32_t i = 0; i < nd_sbp_lists_.size(); i++) {
+    if (nd_sbp_strs[i] != NdSbpToString(nd_sbp_lists_[i])) {
+      LOG(WARNING) << "Ignore the mismatched boxing collector cache " << path;
+      return false;
+    }
+  }
+  std::vector<std::vector<double>> minimum_copy_cost;
+  std::vector<std::vector<std::vector<std::vector<int32_t>>>> middle_nodes;
+  std::vector<std::vector<std::vector<std::vector<int32_t>>>> diag_node_diff_hierarchy;
+  std::vector<std::vector<std::vector<std::vector<int32_t>>>> diag_node_diff_placement;
+  if (!ReadCacheTable(in, &minimum_copy_cost) || !ReadCacheTable(in, &middle_nodes)
+      || !ReadCacheTable(in, &diag_node_diff_hierarchy)
+      || !ReadCacheTable(in, &diag_node_diff_placement)) {
+    LOG(WARNING) << "Ignore the truncated boxing collector cache " << path;
+    return false;
+  }
+  minimum_copy_cost_ = std::move(minimum_copy_cost);
+  middle_nodes_ = std::move(middle_nodes);
+  diag_node_diff_hierarchy_ = std::move(diag_node_diff_hierarchy);
+  diag_node_diff_placement_ = std::move(diag_node_diff_placement);
+  return true;
+}
+
+void BoxingCollector::SaveCombinations(const std::string& path) const {
+  const std::string dir = Dirname(path);
+  LocalFS()->RecursivelyCreateDirIfNotExist(dir);
+  // Several processes might write the same cache, rename the complete file into place.
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    WriteCacheTable(out, kBoxingCollectorCacheMagic);
+    WriteCacheTable(out, kBoxingCollectorCacheVersion);
+    WriteCacheTable(out, GetTransferCost());
+    std::vector<std::string> nd_sbp_strs;
+    for (const auto& nd_sbp : nd_sbp_lists_) { nd_sbp_strs.push_back(NdSbpToString(nd_sbp)); }
+    WriteCacheTable(out, nd_sbp_strs);
+    WriteCacheTable(out, minimum_copy_cost_);
+    WriteCacheTable(out, middle_nodes_);
+    WriteCacheTable(out, diag_node_diff_hierarchy_);
+    WriteCacheTable(out, diag_node_diff_placement_);
+    out.close();
+    if (!out.good()) {
+      LOG(WARNING) << "Failed to write the boxing collector cache " << tmp_path;
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to write the boxing collector cache " << path;
+    std::remove(tmp_path.c_str());
+  }
+}
+
 // Customized initialization with given blob and parallel description
 Maybe<void> BoxingCollector::Init(const BlobDesc& logical_blob_desc,
                                   const ParallelDesc& parallel_desc) {
@@ -186,8 +338,7 @@ void BoxingCollector::GenerateMap1d2nd() {
 Maybe<void> BoxingCollector::GenerateCombination4SamePlacement(int32_t max_middle_node_num) {
   // other parameters
   // NOTE: The performance of this function are all the same with different hierarchy
-  int32_t world_size = GlobalProcessCtx::WorldSize();
-  Shape hierarchy44({4 * world_size, 4 * world_size});
+  Shape hierarchy44 = VirtualHierarchy4SamePlacement();
   std::shared_ptr<Shape> virtual_hierarchy = std::make_shared<Shape>(hierarchy44);
   auto parallel_desc = JUST(ParallelDesc::New(
       "cpu", {"0:0-" + std::to_string(hierarchy44.elem_cnt() - 1)}, virtual_hierarchy));
@@ -306,15 +457,14 @@ Maybe<void> BoxingCollector::GenerateCombination4DiffHierarchy(
 Maybe<void> BoxingCollector::GenerateCombination4DiffPlacement(
     BoxingCollector* boxing_collector_producer, BoxingCollector* boxing_collector_consumer) {
   // Virtual parallel and blob description
-  int32_t world_size = GlobalProcessCtx::WorldSize();
   BlobDesc blob_desc({16, 16, 16, 16}, DataType::kInt8, /*is_dynamic=*/false);
   // Virtual placements before transfer
-  Shape in_hierarchy44({4 * world_size + 1, 4 * world_size});
+  Shape in_hierarchy44 = VirtualInHierarchy4DiffPlacement();
   std::shared_ptr<Shape> in_hierarchy = std::make_shared<Shape>(in_hierarchy44);
   auto in_parallel_desc = JUST(ParallelDesc::New(
       "cpu", {"0:0-" + std::to_string(in_hierarchy44.elem_cnt() - 1)}, in_hierarchy));
   // Virtual placements after transfer
-  Shape out_hierarchy44({4 * world_size, 4 * world_size});
+  Shape out_hierarchy44 = VirtualHierarchy4SamePlacement();
   std::shared_ptr<Shape> out_hierarchy = std::make_shared<Shape>(out_hierarchy44);
   auto out_parallel_desc = JUST(ParallelDesc::New(
       "cpu", {"0:0-" + std::to_string(out_hierarchy44.elem_cnt() - 1)}, out_hierarchy));
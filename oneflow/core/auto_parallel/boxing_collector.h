@@ -80,6 +80,11 @@ class BoxingCollector final {
   // Filter nd sbp from nd_sbp_lists_ with given logical shape
   Maybe<void> FilterNdSbpList4LogicalShape(const BlobDesc& logical_blob_desc,
                                            const Shape& parallel_hierarchy);
+  // Load the uncustomized transfer rules generated by a previous run. Returns false if the cache
+  // is absent or was generated by another version or for another universe.
+  bool LoadCombinations(const std::string& path);
+  // Save the uncustomized transfer rules, failures are only warned
+  void SaveCombinations(const std::string& path) const;
 
  private:
   // Collect Sbp Parallel
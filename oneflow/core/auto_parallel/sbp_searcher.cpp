@@ -0,0 +1,211 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/auto_parallel/sbp_searcher.h"
+#include <algorithm>
+#include <limits>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int32_t kMaxRefineSweeps = 16;
+constexpr int32_t kMaxMemoryWeightRounds = 16;
+constexpr int32_t kMaxMemoryWeightBisections = 8;
+
+}  // namespace
+
+int32_t SbpSearcher::AddNode(std::vector<double> compute_costs, std::vector<double> memory_costs) {
+  CHECK(!compute_costs.empty());
+  CHECK_EQ(compute_costs.size(), memory_costs.size());
+  nodes_.emplace_back();
+  nodes_.back().compute_costs = std::move(compute_costs);
+  nodes_.back().memory_costs = std::move(memory_costs);
+  return nodes_.size() - 1;
+}
+
+Maybe<void> SbpSearcher::AddEdge(int32_t src, int32_t dst,
+                                 std::vector<std::vector<double>> copy_costs) {
+  CHECK_GE_OR_RETURN(src, 0);
+  CHECK_LT_OR_RETURN(src, dst) << "nodes must be added in topological order";
+  CHECK_LT_OR_RETURN(dst, nodes_.size());
+  CHECK_EQ_OR_RETURN(copy_costs.size(), nodes_.at(src).compute_costs.size());
+  for (const auto& row : copy_costs) {
+    CHECK_EQ_OR_RETURN(row.size(), nodes_.at(dst).compute_costs.size());
+  }
+  const int32_t edge_id = edges_.size();
+  edges_.emplace_back(Edge{src, dst, std::move(copy_costs)});
+  nodes_.at(src).out_edges.emplace_back(edge_id);
+  nodes_.at(dst).in_edges.emplace_back(edge_id);
+  return Maybe<void>::Ok();
+}
+
+double SbpSearcher::ComputeAndCopyCost(const std::vector<int32_t>& choices) const {
+  double cost = 0;
+  for (int32_t i = 0; i < nodes_.size(); ++i) {
+    cost += nodes_.at(i).compute_costs.at(choices[i]);
+  }
+  for (const auto& edge : edges_) {
+    cost += edge.copy_costs.at(choices[edge.src]).at(choices[edge.dst]);
+  }
+  return cost;
+}
+
+double SbpSearcher::MemoryCost(const std::vector<int32_t>& choices) const {
+  double memory = 0;
+  for (int32_t i = 0; i < nodes_.size(); ++i) {
+    memory += nodes_.at(i).memory_costs.at(choices[i]);
+  }
+  return memory;
+}
+
+double SbpSearcher::NodeCost(int32_t node_id, int32_t choice, double memory_weight) const {
+  const Node& node = nodes_.at(node_id);
+  double cost = node.compute_costs.at(choice);
+  if (memory_weight > 0) { cost += memory_weight * node.memory_costs.at(choice); }
+  return cost;
+}
+
+void SbpSearcher::DynamicProgramming(double memory_weight, std::vector<int32_t>* choices) const {
+  // dp[n][i] is the least cost of the ancestors of node n when it chooses candidate i. Ancestors
+  // shared by several paths are counted once per path, so it is only an estimation for a DAG.
+  std::vector<std::vector<double>> dp(nodes_.size());
+  for (int32_t n = 0; n < nodes_.size(); ++n) {
+    const int32_t num_candidates = nodes_.at(n).compute_costs.size();
+    dp[n].resize(num_candidates);
+    for (int32_t i = 0; i < num_candidates; ++i) {
+      double cost = NodeCost(n, i, memory_weight);
+      for (int32_t edge_id : nodes_.at(n).in_edges) {
+        const Edge& edge = edges_.at(edge_id);
+        double min_cost = std::numeric_limits<double>::max();
+        for (int32_t p = 0; p < dp[edge.src].size(); ++p) {
+          min_cost = std::min(min_cost, dp[edge.src][p] + edge.copy_costs[p][i]);
+        }
+        cost += min_cost;
+      }
+      dp[n][i] = cost;
+    }
+    // Only the differences between candidates matter, keep the values from growing with the
+    // number of paths.
+    const double min_dp = *std::min_element(dp[n].begin(), dp[n].end());
+    for (double& value : dp[n]) { value -= min_dp; }
+  }
+  // All the consumers of a node have chosen when the node is visited in reverse topological order.
+  choices->assign(nodes_.size(), 0);
+  for (int32_t n = nodes_.size() - 1; n >= 0; --n) {
+    double min_cost = std::numeric_limits<double>::max();
+    for (int32_t i = 0; i < dp[n].size(); ++i) {
+      double cost = dp[n][i];
+      for (int32_t edge_id : nodes_.at(n).out_edges) {
+        const Edge& edge = edges_.at(edge_id);
+        cost += edge.copy_costs[i][choices->at(edge.dst)];
+      }
+      if (cost < min_cost) {
+        min_cost = cost;
+        (*choices)[n] = i;
+      }
+    }
+  }
+}
+
+void SbpSearcher::Refine(double memory_weight, std::vector<int32_t>* choices) const {
+  for (int32_t sweep = 0; sweep < kMaxRefineSweeps; ++sweep) {
+    bool changed = false;
+    for (int32_t n = 0; n < nodes_.size(); ++n) {
+      const auto LocalCost = [&](int32_t i) {
+        double cost = NodeCost(n, i, memory_weight);
+        for (int32_t edge_id : nodes_.at(n).in_edges) {
+          const Edge& edge = edges_.at(edge_id);
+          cost += edge.copy_costs[choices->at(edge.src)][i];
+        }
+        for (int32_t edge_id : nodes_.at(n).out_edges) {
+          const Edge& edge = edges_.at(edge_id);
+          cost += edge.copy_costs[i][choices->at(edge.dst)];
+        }
+        return cost;
+      };
+      int32_t best = choices->at(n);
+      double min_cost = LocalCost(best);
+      for (int32_t i = 0; i < nodes_.at(n).compute_costs.size(); ++i) {
+        const double cost = LocalCost(i);
+        if (cost < min_cost) {
+          min_cost = cost;
+          best = i;
+        }
+      }
+      if (best != choices->at(n)) {
+        (*choices)[n] = best;
+        changed = true;
+      }
+    }
+    if (!changed) { break; }
+  }
+}
+
+void SbpSearcher::Solve(double memory_weight, std::vector<int32_t>* choices) const {
+  DynamicProgramming(memory_weight, choices);
+  Refine(memory_weight, choices);
+}
+
+Maybe<void> SbpSearcher::Search(double memory_budget, std::vector<int32_t>* choices) const {
+  Solve(0, choices);
+  if (memory_budget <= 0 || MemoryCost(*choices) <= memory_budget) { return Maybe<void>::Ok(); }
+  // Charge memory with an increasing weight until the solution fits the budget, then bisect the
+  // weight to give up as little computation and copy cost as possible.
+  std::vector<int32_t> least_memory_choices = *choices;
+  double least_memory = MemoryCost(*choices);
+  double infeasible_weight = 0;
+  double feasible_weight = -1;
+  std::vector<int32_t> feasible_choices;
+  double weight = std::max(ComputeAndCopyCost(*choices), 1.0) / least_memory;
+  for (int32_t round = 0; round < kMaxMemoryWeightRounds; ++round) {
+    std::vector<int32_t> current;
+    Solve(weight, &current);
+    const double memory = MemoryCost(current);
+    if (memory < least_memory) {
+      least_memory = memory;
+      least_memory_choices = current;
+    }
+    if (memory <= memory_budget) {
+      feasible_weight = weight;
+      feasible_choices = std::move(current);
+      break;
+    }
+    infeasible_weight = weight;
+    weight *= 4;
+  }
+  if (feasible_weight < 0) {
+    LOG(WARNING) << "auto parallel can not fit the memory budget " << memory_budget
+                 << ", the least memory found is " << least_memory;
+    *choices = std::move(least_memory_choices);
+    return Maybe<void>::Ok();
+  }
+  for (int32_t step = 0; step < kMaxMemoryWeightBisections; ++step) {
+    weight = (infeasible_weight + feasible_weight) / 2;
+    std::vector<int32_t> current;
+    Solve(weight, &current);
+    if (MemoryCost(current) <= memory_budget) {
+      feasible_weight = weight;
+      feasible_choices = std::move(current);
+    } else {
+      infeasible_weight = weight;
+    }
+  }
+  *choices = std::move(feasible_choices);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTO_PARALLEL_SBP_SEARCHER_H_
+#define ONEFLOW_CORE_AUTO_PARALLEL_SBP_SEARCHER_H_
+
+#include <vector>
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+// Picks one candidate sbp signature for each node of a DAG so that the sum of computation costs
+// and copy costs on the edges is minimal, while keeping the total memory under a budget.
+// Nodes must be added in topological order, an edge always goes from a smaller node id to a larger
+// one.
+class SbpSearcher final {
+ public:
+  SbpSearcher() = default;
+  ~SbpSearcher() = default;
+
+  // compute_costs[i] and memory_costs[i] are the costs of the i-th candidate of the node.
+  // Returns the id of the node.
+  int32_t AddNode(std::vector<double> compute_costs, std::vector<double> memory_costs);
+  // copy_costs[i][j] is the cost when src chooses its i-th candidate and dst chooses its j-th one.
+  Maybe<void> AddEdge(int32_t src, int32_t dst, std::vector<std::vector<double>> copy_costs);
+
+  // Searches the candidate of each node. The memory is ignored if memory_budget <= 0. If no
+  // solution fits the budget, the one with the least memory found is returned.
+  Maybe<void> Search(double memory_budget, std::vector<int32_t>* choices) const;
+
+  double ComputeAndCopyCost(const std::vector<int32_t>& choices) const;
+  double MemoryCost(const std::vector<int32_t>& choices) const;
+
+  int32_t num_nodes() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    std::vector<double> compute_costs;
+    std::vector<double> memory_costs;
+    std::vector<int32_t> in_edges;
+    std::vector<int32_t> out_edges;
+  };
+  struct Edge {
+    int32_t src;
+    int32_t dst;
+    std::vector<std::vector<double>> copy_costs;
+  };
+
+  // Solves the problem with memory_weight * memory added to the computation cost.
+  void Solve(double memory_weight, std::vector<int32_t>* choices) const;
+  // Assigns the candidates by dynamic programming in topological order and backtracking from
+  // sinks. It is exact if the graph is a tree.
+  void DynamicProgramming(double memory_weight, std::vector<int32_t>* choices) const;
+  // Moves single nodes to better candidates with their neighbours fixed until no cost decreases.
+  void Refine(double memory_weight, std::vector<int32_t>* choices) const;
+  double NodeCost(int32_t node_id, int32_t choice, double memory_weight) const;
+
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTO_PARALLEL_SBP_SEARCHER_H_
@@ -0,0 +1,83 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/auto_parallel/sbp_searcher.h"
+
+namespace oneflow {
+
+namespace test {
+
+TEST(SbpSearcher, Chain) {
+  // Candidate 0 of node 1 computes cheaper but the boxing to node 2 costs more than it saves,
+  // which a greedy choice in topological order misses.
+  SbpSearcher searcher;
+  const int32_t a = searcher.AddNode({0}, {0});
+  const int32_t b = searcher.AddNode({1, 2}, {0, 0});
+  const int32_t c = searcher.AddNode({0}, {0});
+  ASSERT_TRUE(searcher.AddEdge(a, b, {{0, 0}}).IsOk());
+  ASSERT_TRUE(searcher.AddEdge(b, c, {{5}, {0}}).IsOk());
+  std::vector<int32_t> choices;
+  ASSERT_TRUE(searcher.Search(0, &choices).IsOk());
+  ASSERT_EQ(choices, (std::vector<int32_t>{0, 1, 0}));
+  ASSERT_DOUBLE_EQ(searcher.ComputeAndCopyCost(choices), 2);
+}
+
+TEST(SbpSearcher, Diamond) {
+  // Both branches prefer the candidate matching the other branch at the join.
+  SbpSearcher searcher;
+  const int32_t src = searcher.AddNode({0, 0}, {0, 0});
+  const int32_t left = searcher.AddNode({0, 0}, {0, 0});
+  const int32_t right = searcher.AddNode({0, 0}, {0, 0});
+  const int32_t dst = searcher.AddNode({3, 0}, {0, 0});
+  const std::vector<std::vector<double>> same_is_free{{0, 4}, {4, 0}};
+  ASSERT_TRUE(searcher.AddEdge(src, left, same_is_free).IsOk());
+  ASSERT_TRUE(searcher.AddEdge(src, right, same_is_free).IsOk());
+  ASSERT_TRUE(searcher.AddEdge(left, dst, same_is_free).IsOk());
+  ASSERT_TRUE(searcher.AddEdge(right, dst, same_is_free).IsOk());
+  std::vector<int32_t> choices;
+  ASSERT_TRUE(searcher.Search(0, &choices).IsOk());
+  ASSERT_EQ(choices, (std::vector<int32_t>{1, 1, 1, 1}));
+  ASSERT_DOUBLE_EQ(searcher.ComputeAndCopyCost(choices), 0);
+}
+
+TEST(SbpSearcher, MemoryBudget) {
+  // Candidate 0 is the broadcast one: no boxing but the whole blob on each device.
+  SbpSearcher searcher;
+  const int32_t a = searcher.AddNode({0, 0}, {100, 25});
+  const int32_t b = searcher.AddNode({0, 0}, {100, 25});
+  ASSERT_TRUE(searcher.AddEdge(a, b, {{0, 10}, {10, 10}}).IsOk());
+  std::vector<int32_t> choices;
+  ASSERT_TRUE(searcher.Search(0, &choices).IsOk());
+  ASSERT_EQ(choices, (std::vector<int32_t>{0, 0}));
+  ASSERT_TRUE(searcher.Search(150, &choices).IsOk());
+  ASSERT_LE(searcher.MemoryCost(choices), 150);
+  ASSERT_DOUBLE_EQ(searcher.ComputeAndCopyCost(choices), 10);
+  // The least memory is returned if no solution fits.
+  ASSERT_TRUE(searcher.Search(10, &choices).IsOk());
+  ASSERT_EQ(choices, (std::vector<int32_t>{1, 1}));
+}
+
+TEST(SbpSearcher, InvalidEdge) {
+  SbpSearcher searcher;
+  const int32_t a = searcher.AddNode({0}, {0});
+  const int32_t b = searcher.AddNode({0, 0}, {0, 0});
+  ASSERT_FALSE(searcher.AddEdge(b, a, {{0}, {0}}).IsOk());
+  ASSERT_FALSE(searcher.AddEdge(a, b, {{0}}).IsOk());
+}
+
+}  // namespace test
+
+}  // namespace oneflow
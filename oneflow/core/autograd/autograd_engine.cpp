@@ -16,6 +16,8 @@ limitations under the License.
 
 #include <stack>
 #include <queue>
+#include <mutex>
+#include <condition_variable>
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_meta.h"
 #include "oneflow/core/framework/tensor.h"
@@ -28,6 +30,7 @@ limitations under the License.
 #include "oneflow/core/framework/nd_sbp.h"
 #include "oneflow/core/framework/global_param_grad_sync_mode.h"
 #include "oneflow/core/common/container_util.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 namespace one {
@@ -334,12 +337,13 @@ GraphFunctionNode::GraphFunctionNode(
 }
 
 GraphTask::GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph)
-    : retain_graph_(retain_graph), create_graph_(create_graph) {
+    : retain_graph_(retain_graph), create_graph_(create_graph), has_consistent_root_(false) {
   roots_.reserve(outputs.size());
   for (const auto& out_tensor : outputs) {
     FunctionNode* node = out_tensor->mut_grad_fn_node().get();
     roots_.emplace_back(node);
     dependencies_.insert(std::make_pair(node, 0));
+    if (out_tensor->is_consistent()) { has_consistent_root_ = true; }
   }
 }
 
@@ -416,7 +420,24 @@ Maybe<void> GraphTask::ComputeDependenciesAndPruneNode(const TensorTuple& inputs
   return Maybe<void>::Ok();
 }
 
+Maybe<bool> GraphTask::ApplyNode(FunctionNode* node, bool save_grad_for_leaf) {
+  if (!need_execute_.empty() && need_execute_.find(node) == need_execute_.end()) {
+    node->ReleaseOutTensorArgs();
+    return false;
+  }
+  if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { return false; }
+  if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
+  JUST(node->AccGrad4RetainGradTensor());
+  node->ReleaseOutTensorArgs();
+  if (!retain_graph_) { node->ReleaseData(); }
+  return true;
+}
+
 Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
+  const int64_t thread_num = ParallelBackwardThreadNum();
+  if (thread_num > 1 && !has_consistent_root_) {
+    return ParallelApply(save_grad_for_leaf, thread_num);
+  }
   std::queue<FunctionNode*> queue;
   for (FunctionNode* node : roots_) {
     if (dependencies_[node] == 0) { queue.push(node); }
@@ -425,22 +446,75 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   while (!queue.empty()) {
     FunctionNode* node = queue.front();
     queue.pop();
-    if (!need_execute_.empty() && need_execute_.find(node) == need_execute_.end()) {
-      node->ReleaseOutTensorArgs();
-      continue;
+    if (!JUST(ApplyNode(node, save_grad_for_leaf))) { continue; }
+
+    for (const auto& next_grad_fn : *(node->GetNextFunctions())) {
+      FunctionNode* next_node = next_grad_fn.get();
+      dependencies_[next_node] -= 1;
+      if (dependencies_[next_node] == 0) { queue.push(next_node); }
     }
-    if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { continue; }
-    if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
-    JUST(node->AccGrad4RetainGradTensor());
-    node->ReleaseOutTensorArgs();
-    if (!retain_graph_) { node->ReleaseData(); }
+  }
+  return Maybe<void>::Ok();
+}
 
+Maybe<void> GraphTask::ParallelApply(bool save_grad_for_leaf, int64_t thread_num) {
+  // The calling thread keeps running one ready node and hands the other ready nodes to the
+  // workers, so a chain of nodes never leaves the calling thread.
+  static ThreadPool* workers = new ThreadPool(thread_num - 1);
+  const bool grad_mode = autograd::GradMode::is_enabled();
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::queue<FunctionNode*> queue;
+  int64_t running_worker_num = 0;
+  std::shared_ptr<cfg::ErrorProto> error;
+  for (FunctionNode* node : roots_) {
+    if (dependencies_[node] == 0) { queue.push(node); }
+  }
+
+  // Must be called with mutex held.
+  const auto& OnNodeDone = [&](FunctionNode* node, const Maybe<bool>& maybe_released) {
+    const auto& released_and_error = maybe_released.GetDataAndErrorProto(false);
+    if (released_and_error.second) {
+      if (!error) { error = released_and_error.second; }
+      return;
+    }
+    if (!released_and_error.first) { return; }
     for (const auto& next_grad_fn : *(node->GetNextFunctions())) {
       FunctionNode* next_node = next_grad_fn.get();
       dependencies_[next_node] -= 1;
       if (dependencies_[next_node] == 0) { queue.push(next_node); }
     }
+  };
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    if (error) { queue = std::queue<FunctionNode*>(); }
+    while (queue.size() > 1 && running_worker_num < workers->thread_num()) {
+      FunctionNode* node = queue.front();
+      queue.pop();
+      running_worker_num += 1;
+      workers->AddWork([&, node]() {
+        autograd::AutoGradMode mode(grad_mode);
+        const auto& maybe_released = ApplyNode(node, save_grad_for_leaf);
+        std::unique_lock<std::mutex> worker_lock(mutex);
+        OnNodeDone(node, maybe_released);
+        running_worker_num -= 1;
+        cond.notify_one();
+      });
+    }
+    if (!queue.empty()) {
+      FunctionNode* node = queue.front();
+      queue.pop();
+      lock.unlock();
+      const auto& maybe_released = ApplyNode(node, save_grad_for_leaf);
+      lock.lock();
+      OnNodeDone(node, maybe_released);
+      continue;
+    }
+    if (running_worker_num == 0) { break; }
+    cond.wait(lock);
   }
+  if (error) { return error; }
   return Maybe<void>::Ok();
 }
 
@@ -505,6 +579,12 @@ Maybe<FunctionNode> GraphAutogradEngine::AddBackwardFuncPtr(
   return func_node;
 }
 
+int64_t ParallelBackwardThreadNum() {
+  static const int64_t thread_num =
+      ParseIntegerFromEnv("ONEFLOW_AUTOGRAD_PARALLEL_BACKWARD_THREAD_NUM", 1);
+  return thread_num;
+}
+
 AutogradEngine* GetThreadLocalAutogradEngine() {
   // thread_local static StackAutogradEngine autograd_engine;
   thread_local static GraphAutogradEngine autograd_engine;
@@ -173,8 +173,17 @@ class GraphTask final {
   Maybe<void> Apply(bool save_grad_for_leaf);
 
  private:
+  // Runs one node and returns whether its next functions may be released.
+  Maybe<bool> ApplyNode(FunctionNode* node, bool save_grad_for_leaf);
+  // Runs the ready nodes of independent branches concurrently on up to `thread_num` threads,
+  // using the dependency counts computed before.
+  Maybe<void> ParallelApply(bool save_grad_for_leaf, int64_t thread_num);
+
   bool retain_graph_;
   bool create_graph_;
+  // Only the backward of local tensors runs in parallel, the collective communications of
+  // consistent tensors have to be issued in the same order on all ranks.
+  bool has_consistent_root_;
   std::vector<FunctionNode*> roots_;
   HashMap<FunctionNode*, int> dependencies_;
   HashSet<FunctionNode*> need_execute_;
@@ -206,6 +215,11 @@ class GraphAutogradEngine final : public AutogradEngine {
 
 AutogradEngine* GetThreadLocalAutogradEngine();
 
+// Number of threads running the independent branches of a backward pass, configured by
+// ONEFLOW_AUTOGRAD_PARALLEL_BACKWARD_THREAD_NUM. The backward runs on the calling thread only
+// if it is not greater than 1.
+int64_t ParallelBackwardThreadNum();
+
 Maybe<void> AddAccumulateFunctionNode(const std::shared_ptr<Tensor>& tensor);
 
 }  // namespace one
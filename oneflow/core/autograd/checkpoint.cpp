@@ -0,0 +1,226 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/autograd/checkpoint.h"
+#include "oneflow/core/autograd/autograd_engine.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/framework/random_generator.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+std::shared_ptr<CheckpointRecorder>* ThreadLocalCheckpointRecorder() {
+  static thread_local std::shared_ptr<CheckpointRecorder> recorder;
+  return &recorder;
+}
+
+}  // namespace
+
+CheckpointRecorder::ValueRef CheckpointRecorder::Ref4Tensor(const std::shared_ptr<Tensor>& tensor) {
+  const auto& it = tensor2entry_.find(tensor.get());
+  // The address may be reused by a new tensor after the recorded one is released.
+  if (it != tensor2entry_.end() && it->second.tensor.lock() == tensor) { return it->second.ref; }
+  ValueRef ref{/*is_external=*/true, static_cast<int64_t>(external_inputs_.size())};
+  external_inputs_.emplace_back(tensor);
+  tensor2entry_[tensor.get()] = TensorEntry{tensor, ref};
+  return ref;
+}
+
+Maybe<void> CheckpointRecorder::RecordAndApply(const OpExprInterpreter& interpreter,
+                                               const OpExpr& op_expr, const TensorTuple& inputs,
+                                               TensorTuple* outputs,
+                                               const OpExprInterpContext& ctx) {
+  CHECK_OR_RETURN(dynamic_cast<const FunctionOpExpr*>(&op_expr) == nullptr)
+      << Error::RuntimeError() << "autograd.Function is not supported in checkpointed segments";
+  RecordedOp op{&op_expr, {}, {}, {}, ctx, autograd::GradMode::is_enabled()};
+  op.inputs.reserve(inputs.size());
+  for (const auto& input : inputs) { op.inputs.emplace_back(Ref4Tensor(input)); }
+  op.inplace_outputs.resize(outputs->size(), -1);
+  for (int i = 0; i < outputs->size(); ++i) {
+    if (!outputs->at(i)) { continue; }
+    const ValueRef ref = Ref4Tensor(outputs->at(i));
+    CHECK_OR_RETURN(!ref.is_external)
+        << Error::RuntimeError()
+        << "checkpointed segments can not modify the tensors they do not produce inplace";
+    op.inplace_outputs.at(i) = ref.index;
+  }
+  if (ctx.state && preserve_rng_state_ && first_random_op_index_ < 0) {
+    rng_state_ = JUST(JUST(DefaultAutoGenerator())->GetState());
+    first_random_op_index_ = ops_.size();
+  }
+  {
+    autograd::AutoGradMode mode(false);
+    JUST(interpreter.Apply(op_expr, inputs, outputs, ctx));
+  }
+  op.outputs.reserve(outputs->size());
+  for (const auto& output : *outputs) {
+    const ValueRef ref{/*is_external=*/false, value_num_++};
+    op.outputs.emplace_back(ref.index);
+    tensor2entry_[output.get()] = TensorEntry{output, ref};
+  }
+  ops_.emplace_back(std::move(op));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckpointRecorder::Finish(const std::shared_ptr<CheckpointRecorder>& self,
+                                       const TensorTuple& outputs) {
+  CHECK_EQ_OR_RETURN(self.get(), this);
+  output_refs_.reserve(outputs.size());
+  for (const auto& output : outputs) {
+    const ValueRef ref = Ref4Tensor(output);
+    CHECK_OR_RETURN(!ref.is_external)
+        << Error::RuntimeError() << "the outputs of checkpointed segments must be produced in them";
+    output_refs_.emplace_back(ref);
+  }
+  tensor2entry_.clear();
+
+  std::vector<int64_t> last_use(value_num_, -1);
+  for (int64_t i = 0; i < ops_.size(); ++i) {
+    for (const auto& ref : ops_.at(i).inputs) {
+      if (!ref.is_external) { last_use.at(ref.index) = i; }
+    }
+    for (int64_t index : ops_.at(i).inplace_outputs) {
+      if (index >= 0) { last_use.at(index) = i; }
+    }
+  }
+  for (const auto& ref : output_refs_) { last_use.at(ref.index) = ops_.size(); }
+  values_released_after_op_.resize(ops_.size());
+  for (int64_t index = 0; index < value_num_; ++index) {
+    if (last_use.at(index) >= 0 && last_use.at(index) < ops_.size()) {
+      values_released_after_op_.at(last_use.at(index)).emplace_back(index);
+    }
+  }
+
+  TensorTuple grad_inputs;
+  for (int64_t i = 0; i < external_inputs_.size(); ++i) {
+    if (external_inputs_.at(i)->requires_grad()) {
+      grad_input_indexes_.emplace_back(i);
+      grad_inputs.emplace_back(external_inputs_.at(i));
+    }
+  }
+  if (grad_inputs.empty()) { return Maybe<void>::Ok(); }
+  auto backward_fn =
+      std::make_shared<std::function<Maybe<void>(const TensorTuple&, TensorTuple*, bool)>>(
+          [self](const TensorTuple& out_grads, TensorTuple* in_grads,
+                 bool create_graph) -> Maybe<void> {
+            return self->Replay(out_grads, in_grads, create_graph);
+          });
+  TensorTuple node_outputs(outputs);
+  JUST(GetThreadLocalAutogradEngine()->AddBackwardFuncPtr("checkpoint_backward", backward_fn,
+                                                          grad_inputs, &node_outputs));
+  for (const auto& output : node_outputs) {
+    output->set_is_leaf(false);
+    JUST(output->set_requires_grad(IsSupportRequireGradDataType(output->dtype()->data_type())));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckpointRecorder::Replay(const TensorTuple& out_grads, TensorTuple* in_grads,
+                                       bool create_graph) const {
+  // The external inputs requiring grad are replaced by leaves collecting their grads.
+  TensorTuple external_inputs(external_inputs_.size());
+  std::copy(external_inputs_.begin(), external_inputs_.end(), external_inputs.begin());
+  TensorTuple grad_inputs(grad_input_indexes_.size());
+  for (int i = 0; i < grad_input_indexes_.size(); ++i) {
+    const auto& leaf = JUST(external_inputs_.at(grad_input_indexes_.at(i))->detach());
+    JUST(leaf->set_requires_grad(true));
+    external_inputs.at(grad_input_indexes_.at(i)) = leaf;
+    grad_inputs.at(i) = leaf;
+  }
+  std::vector<std::shared_ptr<Tensor>> values(value_num_);
+  const auto& Tensor4Ref = [&](const ValueRef& ref) -> const std::shared_ptr<Tensor>& {
+    return ref.is_external ? external_inputs.at(ref.index) : values.at(ref.index);
+  };
+
+  std::shared_ptr<Tensor> current_rng_state;
+  for (int64_t i = 0; i < ops_.size(); ++i) {
+    const RecordedOp& op = ops_.at(i);
+    if (i == first_random_op_index_) {
+      const auto& generator = JUST(DefaultAutoGenerator());
+      current_rng_state = JUST(generator->GetState());
+      JUST(generator->SetState(rng_state_));
+    }
+    TensorTuple inputs(op.inputs.size());
+    for (int j = 0; j < op.inputs.size(); ++j) { inputs.at(j) = Tensor4Ref(op.inputs.at(j)); }
+    TensorTuple outputs(op.outputs.size());
+    for (int j = 0; j < op.outputs.size(); ++j) {
+      if (op.inplace_outputs.at(j) >= 0) { outputs.at(j) = values.at(op.inplace_outputs.at(j)); }
+    }
+    {
+      autograd::AutoGradMode mode(op.grad_mode);
+      JUST(OpInterpUtil::Dispatch(*op.op_expr, inputs, &outputs, op.ctx));
+    }
+    for (int j = 0; j < op.outputs.size(); ++j) { values.at(op.outputs.at(j)) = outputs.at(j); }
+    for (int64_t index : values_released_after_op_.at(i)) { values.at(index).reset(); }
+  }
+  if (current_rng_state) { JUST(JUST(DefaultAutoGenerator())->SetState(current_rng_state)); }
+
+  TensorTuple replayed_outputs;
+  TensorTuple replayed_out_grads;
+  for (int i = 0; i < output_refs_.size(); ++i) {
+    const auto& output = Tensor4Ref(output_refs_.at(i));
+    if (!output->requires_grad()) { continue; }
+    replayed_outputs.emplace_back(output);
+    replayed_out_grads.emplace_back(out_grads.at(i));
+  }
+  // Only the leaves used by the replayed ops get grads.
+  TensorTuple used_grad_inputs;
+  std::vector<int> used_grad_input_indexes;
+  for (int i = 0; i < grad_inputs.size(); ++i) {
+    if (grad_inputs.at(i)->grad_fn_node()) {
+      used_grad_inputs.emplace_back(grad_inputs.at(i));
+      used_grad_input_indexes.emplace_back(i);
+    }
+  }
+  if (replayed_outputs.empty() || used_grad_inputs.empty()) { return Maybe<void>::Ok(); }
+  const auto& grads = JUST(GetThreadLocalAutogradEngine()->RunBackwardAndReturnInputsTensorGradIf(
+      replayed_outputs, used_grad_inputs, replayed_out_grads, /*retain_graph=*/false,
+      create_graph));
+  for (int i = 0; i < used_grad_input_indexes.size(); ++i) {
+    in_grads->at(used_grad_input_indexes.at(i)) = grads->at(i);
+  }
+  return Maybe<void>::Ok();
+}
+
+CheckpointRecorder* CurrentCheckpointRecorder() { return ThreadLocalCheckpointRecorder()->get(); }
+
+Maybe<void> BeginCheckpoint(bool preserve_rng_state) {
+  auto* recorder = ThreadLocalCheckpointRecorder();
+  CHECK_OR_RETURN(!*recorder) << Error::RuntimeError() << "checkpoints can not be nested";
+  *recorder = std::make_shared<CheckpointRecorder>(preserve_rng_state);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EndCheckpoint(const TensorTuple& outputs) {
+  auto* recorder = ThreadLocalCheckpointRecorder();
+  CHECK_OR_RETURN(*recorder) << Error::RuntimeError() << "no checkpoint is being recorded";
+  std::shared_ptr<CheckpointRecorder> finished = std::move(*recorder);
+  recorder->reset();
+  return finished->Finish(finished, outputs);
+}
+
+Maybe<void> AbortCheckpoint() {
+  ThreadLocalCheckpointRecorder()->reset();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
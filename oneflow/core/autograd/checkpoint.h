@@ -0,0 +1,104 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTOGRAD_CHECKPOINT_H_
+#define ONEFLOW_CORE_AUTOGRAD_CHECKPOINT_H_
+
+#include <memory>
+#include <vector>
+#include "oneflow/core/common/hash_container.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/op_interpreter.h"
+
+namespace oneflow {
+namespace one {
+
+class OpExpr;
+class Tensor;
+class TensorTuple;
+
+// Records the ops of a checkpointed segment of forward. The ops run without building the
+// autograd graph, so the activations inside the segment are released as soon as they are
+// consumed. The outputs of the segment get a single backward node, which replays the recorded
+// ops through the interpreter to recompute the activations and runs the backward of the replayed
+// ops, without calling back into python.
+class CheckpointRecorder final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CheckpointRecorder);
+  explicit CheckpointRecorder(bool preserve_rng_state)
+      : preserve_rng_state_(preserve_rng_state), value_num_(0) {}
+  ~CheckpointRecorder() = default;
+
+  // Runs the op by `interpreter` without autograd and records it.
+  Maybe<void> RecordAndApply(const OpExprInterpreter& interpreter, const OpExpr& op_expr,
+                             const TensorTuple& inputs, TensorTuple* outputs,
+                             const OpExprInterpContext& ctx);
+
+  // Binds the backward node replaying the segment to `outputs`.
+  Maybe<void> Finish(const std::shared_ptr<CheckpointRecorder>& self, const TensorTuple& outputs);
+
+ private:
+  struct ValueRef {
+    bool is_external;
+    // Index of the external inputs if is_external, otherwise index of the values produced by the
+    // recorded ops.
+    int64_t index;
+  };
+  struct RecordedOp {
+    // Op exprs are owned by the functors, which live as long as the process.
+    const OpExpr* op_expr;
+    std::vector<ValueRef> inputs;
+    // The values an inplace op writes to, -1 for the outputs it allocates.
+    std::vector<int64_t> inplace_outputs;
+    std::vector<int64_t> outputs;
+    OpExprInterpContext ctx;
+    bool grad_mode;
+  };
+  struct TensorEntry {
+    std::weak_ptr<Tensor> tensor;
+    ValueRef ref;
+  };
+
+  ValueRef Ref4Tensor(const std::shared_ptr<Tensor>& tensor);
+  // Recomputes the segment and returns the grads of the external inputs requiring grad.
+  Maybe<void> Replay(const TensorTuple& out_grads, TensorTuple* in_grads, bool create_graph) const;
+
+  bool preserve_rng_state_;
+  int64_t value_num_;
+  std::vector<RecordedOp> ops_;
+  std::vector<std::shared_ptr<Tensor>> external_inputs_;
+  HashMap<const Tensor*, TensorEntry> tensor2entry_;
+  std::vector<ValueRef> output_refs_;
+  // The values no longer used after each op, released during the replay.
+  std::vector<std::vector<int64_t>> values_released_after_op_;
+  // Indexes of the external inputs requiring grad, which are the inputs of the backward node.
+  std::vector<int64_t> grad_input_indexes_;
+  // The state of the default generator before the first random op, and the index of that op.
+  std::shared_ptr<Tensor> rng_state_;
+  int64_t first_random_op_index_ = -1;
+};
+
+// Returns nullptr if no checkpointed segment is recorded on the current thread.
+CheckpointRecorder* CurrentCheckpointRecorder();
+
+Maybe<void> BeginCheckpoint(bool preserve_rng_state);
+Maybe<void> EndCheckpoint(const TensorTuple& outputs);
+// Drops the recording if the checkpointed function fails.
+Maybe<void> AbortCheckpoint();
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTOGRAD_CHECKPOINT_H_
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct EmbeddingBagCaptureState : public AutoGradCaptureState {
+  std::string mode;
+  int64_t padding_idx;
+  bool has_per_sample_weights;
+  bool requires_grad;
+};
+
+class EmbeddingBag : public OpExprGradFunction<EmbeddingBagCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(EmbeddingBagCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const EmbeddingBagCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+};
+
+Maybe<void> EmbeddingBag::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EmbeddingBag::Capture(EmbeddingBagCaptureState* ctx, const TensorTuple& inputs,
+                                  const TensorTuple& outputs, const AttrMap& attrs) const {
+  ctx->requires_grad = inputs.at(0)->requires_grad();
+  if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+
+  ctx->SaveTensorForBackward(inputs.at(0));  // weight
+  ctx->SaveTensorForBackward(inputs.at(1));  // indices
+  ctx->has_per_sample_weights = inputs.size() > 2;
+  if (ctx->has_per_sample_weights) { ctx->SaveTensorForBackward(inputs.at(2)); }
+
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->mode = JUST(composed_attrs.GetAttr<std::string>("mode"));
+  ctx->padding_idx = JUST(composed_attrs.GetAttr<int64_t>("padding_idx"));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EmbeddingBag::Apply(const EmbeddingBagCaptureState* ctx, const TensorTuple& out_grads,
+                                TensorTuple* in_grads) const {
+  if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+  CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+  const auto& weight = ctx->SavedTensors().at(0);
+  const auto& indices = ctx->SavedTensors().at(1);
+  const Optional<one::Tensor> per_sample_weights =
+      ctx->has_per_sample_weights ? Optional<one::Tensor>(ctx->SavedTensors().at(2))
+                                  : Optional<one::Tensor>();
+  // The per-id gradient rows are scattered with unsorted_segment_sum_like so that the weight
+  // gradient takes the same shape as the one of gather.
+  const auto& values = JUST(functional::EmbeddingBagGrad(out_grads.at(0), weight, indices,
+                                                         per_sample_weights, ctx->mode,
+                                                         ctx->padding_idx));
+  in_grads->resize(ctx->has_per_sample_weights ? 3 : 2);
+  in_grads->at(0) = JUST(functional::UnsortedSegmentSumLike(values, indices, weight, 0));
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("embedding_bag", EmbeddingBag);
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct FusedAttentionCaptureState : public AutoGradCaptureState {
+  bool query_requires_grad = false;
+  bool key_requires_grad = false;
+  bool value_requires_grad = false;
+  bool has_key_mask = false;
+  bool is_packed = false;
+  float scale = 1.0;
+  bool causal = false;
+  float dropout_rate = 0.0;
+  int64_t max_seqlen_q = 0;
+  int64_t max_seqlen_k = 0;
+};
+
+class FusedAttention : public OpExprGradFunction<FusedAttentionCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(FusedAttentionCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const FusedAttentionCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+};
+
+Maybe<void> FusedAttention::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedAttention::Capture(FusedAttentionCaptureState* ctx, const TensorTuple& inputs,
+                                    const TensorTuple& outputs, const AttrMap& attrs) const {
+  // query, key, value, then key_mask or cu_seqlens_q and cu_seqlens_k if any
+  CHECK_OR_RETURN(inputs.size() >= 3 && inputs.size() <= 5);
+  CHECK_EQ_OR_RETURN(outputs.size(), 3);  // out, softmax_lse, rng_state
+  ctx->query_requires_grad = inputs.at(0)->requires_grad();
+  ctx->key_requires_grad = inputs.at(1)->requires_grad();
+  ctx->value_requires_grad = inputs.at(2)->requires_grad();
+  if (!ctx->query_requires_grad && !ctx->key_requires_grad && !ctx->value_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->scale = JUST(composed_attrs.GetAttr<float>("scale"));
+  ctx->causal = JUST(composed_attrs.GetAttr<bool>("causal"));
+  ctx->dropout_rate = JUST(composed_attrs.GetAttr<float>("dropout_rate"));
+  ctx->max_seqlen_q = JUST(composed_attrs.GetAttr<int64_t>("max_seqlen_q"));
+  ctx->max_seqlen_k = JUST(composed_attrs.GetAttr<int64_t>("max_seqlen_k"));
+  ctx->has_key_mask = inputs.size() == 4;
+  ctx->is_packed = inputs.size() == 5;
+
+  ctx->SaveTensorForBackward(inputs.at(0));   // query
+  ctx->SaveTensorForBackward(inputs.at(1));   // key
+  ctx->SaveTensorForBackward(inputs.at(2));   // value
+  ctx->SaveTensorForBackward(outputs.at(0));  // out
+  ctx->SaveTensorForBackward(outputs.at(1));  // softmax_lse
+  ctx->SaveTensorForBackward(outputs.at(2));  // rng_state
+  for (size_t i = 3; i < inputs.size(); ++i) { ctx->SaveTensorForBackward(inputs.at(i)); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedAttention::Apply(const FusedAttentionCaptureState* ctx,
+                                  const TensorTuple& out_grads, TensorTuple* in_grads) const {
+  CHECK_EQ_OR_RETURN(out_grads.size(), 3);  // out, softmax_lse, rng_state
+  if (!ctx->query_requires_grad && !ctx->key_requires_grad && !ctx->value_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  const auto& saved = ctx->SavedTensors();
+  in_grads->resize(saved.size() - 3);
+  Optional<one::Tensor> key_mask;
+  Optional<one::Tensor> cu_seqlens_q;
+  Optional<one::Tensor> cu_seqlens_k;
+  if (ctx->has_key_mask) { key_mask = Optional<one::Tensor>(saved.at(6)); }
+  if (ctx->is_packed) {
+    cu_seqlens_q = Optional<one::Tensor>(saved.at(6));
+    cu_seqlens_k = Optional<one::Tensor>(saved.at(7));
+  }
+  const auto& grads = JUST(functional::FusedAttentionGrad(
+      saved.at(0), saved.at(1), saved.at(2), saved.at(3), out_grads.at(0), saved.at(4),
+      saved.at(5), key_mask, ctx->scale, ctx->causal, ctx->dropout_rate, cu_seqlens_q,
+      cu_seqlens_k, ctx->max_seqlen_q, ctx->max_seqlen_k));
+  if (ctx->query_requires_grad) { in_grads->at(0) = grads->at(0); }
+  if (ctx->key_requires_grad) { in_grads->at(1) = grads->at(1); }
+  if (ctx->value_requires_grad) { in_grads->at(2) = grads->at(2); }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("fused_attention", FusedAttention);
+
+}  // namespace one
+}  // namespace oneflow
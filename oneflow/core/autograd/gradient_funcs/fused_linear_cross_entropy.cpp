@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct FusedLinearCrossEntropyCaptureState : public AutoGradCaptureState {
+  int64_t ignore_index;
+  int64_t chunk_size;
+  bool x_requires_grad;
+  bool weight_requires_grad;
+};
+
+class FusedLinearCrossEntropy : public OpExprGradFunction<FusedLinearCrossEntropyCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(FusedLinearCrossEntropyCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const FusedLinearCrossEntropyCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+};
+
+Maybe<void> FusedLinearCrossEntropy::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedLinearCrossEntropy::Capture(FusedLinearCrossEntropyCaptureState* ctx,
+                                             const TensorTuple& inputs,
+                                             const TensorTuple& outputs,
+                                             const AttrMap& attrs) const {
+  CHECK_EQ_OR_RETURN(inputs.size(), 4);
+  ctx->x_requires_grad = inputs.at(0)->requires_grad();
+  ctx->weight_requires_grad = inputs.at(1)->requires_grad();
+  if (!ctx->x_requires_grad && !ctx->weight_requires_grad) { return Maybe<void>::Ok(); }
+
+  // Only the inputs are saved, the logits are recomputed chunk by chunk in the backward.
+  ctx->SaveTensorForBackward(inputs.at(0));  // x
+  ctx->SaveTensorForBackward(inputs.at(1));  // weight
+  ctx->SaveTensorForBackward(inputs.at(2));  // label
+  ctx->SaveTensorForBackward(inputs.at(3));  // log_sum_exp
+
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->ignore_index = JUST(composed_attrs.GetAttr<int64_t>("ignore_index"));
+  ctx->chunk_size = JUST(composed_attrs.GetAttr<int64_t>("chunk_size"));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedLinearCrossEntropy::Apply(const FusedLinearCrossEntropyCaptureState* ctx,
+                                           const TensorTuple& out_grads,
+                                           TensorTuple* in_grads) const {
+  if (!ctx->x_requires_grad && !ctx->weight_requires_grad) { return Maybe<void>::Ok(); }
+  CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+  const auto& x = ctx->SavedTensors().at(0);
+  const auto& weight = ctx->SavedTensors().at(1);
+  const auto& label = ctx->SavedTensors().at(2);
+  const auto& log_sum_exp = ctx->SavedTensors().at(3);
+  const auto& grads =
+      JUST(functional::FusedLinearCrossEntropyGrad(out_grads.at(0), x, weight, label, log_sum_exp,
+                                                   ctx->ignore_index, ctx->chunk_size));
+  in_grads->resize(4);
+  if (ctx->x_requires_grad) { in_grads->at(0) = grads->at(0); }
+  if (ctx->weight_requires_grad) { in_grads->at(1) = grads->at(1); }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("fused_linear_cross_entropy", FusedLinearCrossEntropy);
+
+}  // namespace one
+}  // namespace oneflow
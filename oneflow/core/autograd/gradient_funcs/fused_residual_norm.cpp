@@ -0,0 +1,146 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct FusedResidualNormCaptureState : public AutoGradCaptureState {
+  bool x_requires_grad = false;
+  bool residual_requires_grad = false;
+  bool bias_requires_grad = false;
+  bool gamma_requires_grad = false;
+  bool beta_requires_grad = false;
+  std::string norm_type;
+  std::string activation;
+  int64_t begin_norm_axis = -1;
+  size_t gamma_index = 0;
+  size_t beta_index = 0;
+};
+
+// y, sum, mean, inv_variance =
+//   fused_residual_norm(x, [residual], [bias], [gamma], [beta], norm_type, activation,
+//                       begin_norm_axis, epsilon)
+class FusedResidualNorm : public OpExprGradFunction<FusedResidualNormCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(FusedResidualNormCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const FusedResidualNormCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+  bool has_residual_ = false;
+  bool has_bias_ = false;
+  bool has_gamma_ = false;
+  bool has_beta_ = false;
+};
+
+Maybe<void> FusedResidualNorm::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  const auto& input_map = fw_op_expr->proto().input();
+  has_residual_ = input_map.find("residual") != input_map.end();
+  has_bias_ = input_map.find("bias") != input_map.end();
+  has_gamma_ = input_map.find("gamma") != input_map.end();
+  has_beta_ = input_map.find("beta") != input_map.end();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedResidualNorm::Capture(FusedResidualNormCaptureState* ctx,
+                                       const TensorTuple& inputs, const TensorTuple& outputs,
+                                       const AttrMap& attrs) const {
+  CHECK_EQ_OR_RETURN(inputs.size(), 1 + has_residual_ + has_bias_ + has_gamma_ + has_beta_);
+  CHECK_EQ_OR_RETURN(outputs.size(), 4);  // y, sum, mean, inv_variance
+  size_t input_index = 0;
+  ctx->x_requires_grad = inputs.at(input_index++)->requires_grad();
+  if (has_residual_) { ctx->residual_requires_grad = inputs.at(input_index++)->requires_grad(); }
+  if (has_bias_) { ctx->bias_requires_grad = inputs.at(input_index++)->requires_grad(); }
+  const size_t gamma_input_index = input_index;
+  if (has_gamma_) { ctx->gamma_requires_grad = inputs.at(input_index++)->requires_grad(); }
+  const size_t beta_input_index = input_index;
+  if (has_beta_) { ctx->beta_requires_grad = inputs.at(input_index++)->requires_grad(); }
+  if (!ctx->x_requires_grad && !ctx->residual_requires_grad && !ctx->bias_requires_grad
+      && !ctx->gamma_requires_grad && !ctx->beta_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->norm_type = JUST(composed_attrs.GetAttr<std::string>("norm_type"));
+  ctx->activation = JUST(composed_attrs.GetAttr<std::string>("activation"));
+  ctx->begin_norm_axis = JUST(composed_attrs.GetAttr<int64_t>("begin_norm_axis"));
+  ctx->SaveTensorForBackward(outputs.at(1));  // sum
+  ctx->SaveTensorForBackward(outputs.at(2));  // mean
+  ctx->SaveTensorForBackward(outputs.at(3));  // inv_variance
+  if (has_gamma_) { ctx->gamma_index = ctx->SaveTensorForBackward(inputs.at(gamma_input_index)); }
+  if (has_beta_) { ctx->beta_index = ctx->SaveTensorForBackward(inputs.at(beta_input_index)); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FusedResidualNorm::Apply(const FusedResidualNormCaptureState* ctx,
+                                     const TensorTuple& out_grads, TensorTuple* in_grads) const {
+  CHECK_EQ_OR_RETURN(out_grads.size(), 4);  // y, sum, mean, inv_variance
+  in_grads->resize(1 + has_residual_ + has_bias_ + has_gamma_ + has_beta_);
+  if (!ctx->x_requires_grad && !ctx->residual_requires_grad && !ctx->bias_requires_grad
+      && !ctx->gamma_requires_grad && !ctx->beta_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+  const auto& saved = ctx->SavedTensors();
+  const std::shared_ptr<Tensor>& sum = saved.at(0);
+  const Optional<one::Tensor> sum_grad =
+      out_grads.at(1) ? Optional<one::Tensor>(out_grads.at(1)) : Optional<one::Tensor>();
+  const Optional<one::Tensor> gamma =
+      has_gamma_ ? Optional<one::Tensor>(saved.at(ctx->gamma_index)) : Optional<one::Tensor>();
+  const Optional<one::Tensor> beta =
+      has_beta_ ? Optional<one::Tensor>(saved.at(ctx->beta_index)) : Optional<one::Tensor>();
+  const auto& grads = JUST(functional::FusedResidualNormGrad(
+      out_grads.at(0), sum, saved.at(1), saved.at(2), sum_grad, gamma, beta, ctx->norm_type,
+      ctx->activation, ctx->begin_norm_axis));
+  const std::shared_ptr<Tensor>& sum_diff = grads->at(0);
+  size_t input_index = 0;
+  if (ctx->x_requires_grad) { in_grads->at(input_index) = sum_diff; }
+  input_index++;
+  if (has_residual_) {
+    if (ctx->residual_requires_grad) { in_grads->at(input_index) = sum_diff; }
+    input_index++;
+  }
+  if (has_bias_) {
+    if (ctx->bias_requires_grad) {
+      int64_t begin_norm_axis = ctx->begin_norm_axis;
+      if (begin_norm_axis < 0) { begin_norm_axis += sum->ndim(); }
+      std::vector<int32_t> reduce_axes_vec(begin_norm_axis);
+      std::iota(reduce_axes_vec.begin(), reduce_axes_vec.end(), 0);
+      in_grads->at(input_index) = JUST(functional::ReduceSum(sum_diff, reduce_axes_vec, false));
+    }
+    input_index++;
+  }
+  size_t grad_index = 1;
+  if (has_gamma_) {
+    if (ctx->gamma_requires_grad) { in_grads->at(input_index) = grads->at(grad_index); }
+    input_index++;
+    grad_index++;
+  }
+  if (has_beta_ && ctx->beta_requires_grad) { in_grads->at(input_index) = grads->at(grad_index); }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("fused_residual_norm", FusedResidualNorm);
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,145 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+struct MoeGatingCaptureState : public AutoGradCaptureState {
+  bool requires_grad = false;
+};
+
+class MoeGating : public OpExprGradFunction<MoeGatingCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override { return Maybe<void>::Ok(); }
+
+  Maybe<void> Capture(MoeGatingCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override {
+    CHECK_EQ_OR_RETURN(inputs.size(), 1);
+    // expert_indices, locations, gates, probs, aux_loss
+    CHECK_EQ_OR_RETURN(outputs.size(), 5);
+    ctx->requires_grad = inputs.at(0)->requires_grad();
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    ctx->SaveTensorForBackward(outputs.at(3));  // probs
+    ctx->SaveTensorForBackward(outputs.at(0));  // expert_indices
+    ctx->SaveTensorForBackward(outputs.at(2));  // gates
+    return Maybe<void>::Ok();
+  }
+
+  Maybe<void> Apply(const MoeGatingCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override {
+    CHECK_EQ_OR_RETURN(out_grads.size(), 5);
+    in_grads->resize(1);
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    const auto& saved = ctx->SavedTensors();
+    in_grads->at(0) = JUST(functional::MoeGatingGrad(saved.at(0), saved.at(1), saved.at(2),
+                                                     out_grads.at(2), out_grads.at(4)));
+    return Maybe<void>::Ok();
+  }
+};
+
+struct MoeRoutingCaptureState : public AutoGradCaptureState {
+  bool in_requires_grad = false;
+  bool gates_requires_grad = false;
+  bool has_gates = false;
+  int64_t num_experts = 0;
+  int64_t capacity = 0;
+};
+
+// moe_dispatch and moe_combine are the transpose of each other, and the gradient of the gates is
+// the dot product of every routed token with the gradient of its slot, or the other way round.
+class MoeRouting : public OpExprGradFunction<MoeRoutingCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override {
+    const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+    CHECK_NOTNULL_OR_RETURN(fw_op_expr);
+    base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+    return Maybe<void>::Ok();
+  }
+
+  Maybe<void> Capture(MoeRoutingCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override {
+    ctx->in_requires_grad = inputs.at(0)->requires_grad();
+    ctx->has_gates = inputs.size() > 3;
+    ctx->gates_requires_grad = ctx->has_gates && inputs.at(3)->requires_grad();
+    if (!ctx->in_requires_grad && !ctx->gates_requires_grad) { return Maybe<void>::Ok(); }
+    ctx->SaveTensorForBackward(inputs.at(1));  // expert_indices
+    ctx->SaveTensorForBackward(inputs.at(2));  // locations
+    if (ctx->has_gates) { ctx->SaveTensorForBackward(inputs.at(3)); }
+    if (ctx->gates_requires_grad) { ctx->SaveTensorForBackward(inputs.at(0)); }
+    ComposedAttrMap composed_attrs(attrs, base_attrs_);
+    ctx->num_experts = JUST(composed_attrs.GetAttr<int64_t>("num_experts"));
+    ctx->capacity = JUST(composed_attrs.GetAttr<int64_t>("capacity"));
+    return Maybe<void>::Ok();
+  }
+
+ protected:
+  AttrMap base_attrs_;
+};
+
+class MoeDispatch : public MoeRouting {
+ public:
+  Maybe<void> Apply(const MoeRoutingCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override {
+    CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+    in_grads->resize(ctx->has_gates ? 4 : 3);
+    if (!ctx->in_requires_grad && !ctx->gates_requires_grad) { return Maybe<void>::Ok(); }
+    const auto& saved = ctx->SavedTensors();
+    const Optional<one::Tensor> gates =
+        ctx->has_gates ? Optional<one::Tensor>(saved.at(2)) : Optional<one::Tensor>();
+    if (ctx->in_requires_grad) {
+      in_grads->at(0) = JUST(functional::MoeCombine(out_grads.at(0), saved.at(0), saved.at(1),
+                                                    gates, ctx->num_experts, ctx->capacity));
+    }
+    if (ctx->gates_requires_grad) {
+      in_grads->at(3) = JUST(
+          functional::MoeGatesGrad(saved.at(3), out_grads.at(0), saved.at(0), saved.at(1)));
+    }
+    return Maybe<void>::Ok();
+  }
+};
+
+class MoeCombine : public MoeRouting {
+ public:
+  Maybe<void> Apply(const MoeRoutingCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override {
+    CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+    in_grads->resize(ctx->has_gates ? 4 : 3);
+    if (!ctx->in_requires_grad && !ctx->gates_requires_grad) { return Maybe<void>::Ok(); }
+    const auto& saved = ctx->SavedTensors();
+    const Optional<one::Tensor> gates =
+        ctx->has_gates ? Optional<one::Tensor>(saved.at(2)) : Optional<one::Tensor>();
+    if (ctx->in_requires_grad) {
+      in_grads->at(0) = JUST(functional::MoeDispatch(out_grads.at(0), saved.at(0), saved.at(1),
+                                                     gates, ctx->num_experts, ctx->capacity));
+    }
+    if (ctx->gates_requires_grad) {
+      in_grads->at(3) = JUST(
+          functional::MoeGatesGrad(out_grads.at(0), saved.at(3), saved.at(0), saved.at(1)));
+    }
+    return Maybe<void>::Ok();
+  }
+};
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("moe_gating", MoeGating);
+REGISTER_OP_EXPR_GRAD_FUNCTION("moe_dispatch", MoeDispatch);
+REGISTER_OP_EXPR_GRAD_FUNCTION("moe_combine", MoeCombine);
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+// padded_to_packed and packed_to_padded move the same rows in opposite directions, so each is the
+// gradient of the other.
+struct PackedSequenceCaptureState : public AutoGradCaptureState {
+  bool requires_grad = false;
+  // Length of the axis of "in" that the other op gives back.
+  int64_t in_seq_len = 0;
+};
+
+class PaddedToPacked : public OpExprGradFunction<PackedSequenceCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override { return Maybe<void>::Ok(); }
+  Maybe<void> Capture(PackedSequenceCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override {
+    CHECK_EQ_OR_RETURN(inputs.size(), 2);  // in, cu_seqlens
+    ctx->requires_grad = inputs.at(0)->requires_grad();
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    ctx->in_seq_len = inputs.at(0)->shape()->At(1);  // max_seqlen
+    ctx->SaveTensorForBackward(inputs.at(1));
+    return Maybe<void>::Ok();
+  }
+  Maybe<void> Apply(const PackedSequenceCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override {
+    CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+    in_grads->resize(2);
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    in_grads->at(0) = JUST(
+        functional::PackedToPadded(out_grads.at(0), ctx->SavedTensors().at(0), ctx->in_seq_len));
+    return Maybe<void>::Ok();
+  }
+};
+
+class PackedToPadded : public OpExprGradFunction<PackedSequenceCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override { return Maybe<void>::Ok(); }
+  Maybe<void> Capture(PackedSequenceCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override {
+    CHECK_EQ_OR_RETURN(inputs.size(), 2);  // in, cu_seqlens
+    ctx->requires_grad = inputs.at(0)->requires_grad();
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    ctx->in_seq_len = inputs.at(0)->shape()->At(0);  // total_len
+    ctx->SaveTensorForBackward(inputs.at(1));
+    return Maybe<void>::Ok();
+  }
+  Maybe<void> Apply(const PackedSequenceCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override {
+    CHECK_EQ_OR_RETURN(out_grads.size(), 1);
+    in_grads->resize(2);
+    if (!ctx->requires_grad) { return Maybe<void>::Ok(); }
+    in_grads->at(0) = JUST(
+        functional::PaddedToPacked(out_grads.at(0), ctx->SavedTensors().at(0), ctx->in_seq_len));
+    return Maybe<void>::Ok();
+  }
+};
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("padded_to_packed", PaddedToPacked);
+REGISTER_OP_EXPR_GRAD_FUNCTION("packed_to_padded", PackedToPadded);
+
+}  // namespace one
+}  // namespace oneflow
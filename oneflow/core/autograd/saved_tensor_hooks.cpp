@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <vector>
+#include "oneflow/core/autograd/saved_tensor_hooks.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+std::vector<std::shared_ptr<const SavedTensorHookCreator>>* ThreadLocalSavedTensorHookCreators() {
+  static thread_local std::vector<std::shared_ptr<const SavedTensorHookCreator>> creators;
+  return &creators;
+}
+
+}  // namespace
+
+void PushSavedTensorHookCreator(const std::shared_ptr<const SavedTensorHookCreator>& creator) {
+  ThreadLocalSavedTensorHookCreators()->emplace_back(creator);
+}
+
+Maybe<void> PopSavedTensorHookCreator() {
+  auto* creators = ThreadLocalSavedTensorHookCreators();
+  CHECK_OR_RETURN(!creators->empty()) << "no saved tensor hooks to pop";
+  creators->pop_back();
+  return Maybe<void>::Ok();
+}
+
+const std::shared_ptr<const SavedTensorHookCreator>& CurrentSavedTensorHookCreator() {
+  static const std::shared_ptr<const SavedTensorHookCreator> none;
+  const auto* creators = ThreadLocalSavedTensorHookCreators();
+  if (creators->empty()) { return none; }
+  return creators->back();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTOGRAD_SAVED_TENSOR_HOOKS_H_
+#define ONEFLOW_CORE_AUTOGRAD_SAVED_TENSOR_HOOKS_H_
+
+#include <memory>
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+namespace one {
+
+class Tensor;
+
+// Packs a tensor saved for backward when it is captured in forward, e.g. casts it to a lower
+// precision or offloads it to host memory, and unpacks it right before backward uses it.
+class SavedTensorHook {
+ public:
+  virtual ~SavedTensorHook() = default;
+
+  virtual Maybe<void> Pack(const std::shared_ptr<Tensor>& tensor) = 0;
+  virtual Maybe<Tensor> Unpack() = 0;
+};
+
+class SavedTensorHookCreator {
+ public:
+  virtual ~SavedTensorHookCreator() = default;
+
+  virtual std::unique_ptr<SavedTensorHook> NewHook() const = 0;
+};
+
+// The creators are thread local, the top one packs the tensors saved on the current thread.
+void PushSavedTensorHookCreator(const std::shared_ptr<const SavedTensorHookCreator>& creator);
+Maybe<void> PopSavedTensorHookCreator();
+// Returns nullptr if the tensors are saved as they are.
+const std::shared_ptr<const SavedTensorHookCreator>& CurrentSavedTensorHookCreator();
+
+// Saves the tensors as they are in the scope, used while packing or unpacking.
+class DisableSavedTensorHookGuard final {
+ public:
+  DisableSavedTensorHookGuard() { PushSavedTensorHookCreator(nullptr); }
+  ~DisableSavedTensorHookGuard() { CHECK_JUST(PopSavedTensorHookCreator()); }
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTOGRAD_SAVED_TENSOR_HOOKS_H_
@@ -62,12 +62,18 @@ inline void RegisterBoxingFunction(
   RegisterBoxingFunction(method_name, CheckAndBoxing.first, CheckAndBoxing.second);
 }
 
+// A boxing function resolved from the boxing expressions once for the given in and out placed nd
+// sbp, which are kept to save the symbol lookups on every call.
 class NaiveEagerBoxingInterpreter : public EagerBoxingInterpreter {
  public:
   explicit NaiveEagerBoxingInterpreter(
       const std::shared_ptr<BoxingFunctionT>& boxing_function,
-      const std::shared_ptr<BoxingInterpreterStatus>& boxing_interpreter_status)
-      : boxing_function_(boxing_function), boxing_interpreter_status_(boxing_interpreter_status) {}
+      const std::shared_ptr<BoxingInterpreterStatus>& boxing_interpreter_status,
+      Symbol<PlacedNdSbp> in, Symbol<PlacedNdSbp> out)
+      : boxing_function_(boxing_function),
+        boxing_interpreter_status_(boxing_interpreter_status),
+        in_(in),
+        out_(out) {}
   NaiveEagerBoxingInterpreter(const NaiveEagerBoxingInterpreter&) = delete;
   NaiveEagerBoxingInterpreter(NaiveEagerBoxingInterpreter&&) = delete;
   ~NaiveEagerBoxingInterpreter() override = default;
@@ -81,13 +87,15 @@ class NaiveEagerBoxingInterpreter : public EagerBoxingInterpreter {
                                    Symbol<NdSbp> in_nd_sbp, Symbol<NdSbp> out_nd_sbp,
                                    Symbol<ParallelDesc> in_parallel_desc,
                                    Symbol<ParallelDesc> out_parallel_desc) const override {
-    const auto& in_placed_nd_sbp = JUST(PlacedNdSbp::New(in_nd_sbp, in_parallel_desc));
-    const auto& out_placed_nd_sbp = JUST(PlacedNdSbp::New(out_nd_sbp, out_parallel_desc));
-    return JUST((*boxing_function_)(input, in_placed_nd_sbp, out_placed_nd_sbp));
+    CHECK_OR_RETURN(in_->nd_sbp() == in_nd_sbp && in_->placement() == in_parallel_desc);
+    CHECK_OR_RETURN(out_->nd_sbp() == out_nd_sbp && out_->placement() == out_parallel_desc);
+    return JUST((*boxing_function_)(input, in_, out_));
   }
 
   const std::shared_ptr<BoxingFunctionT> boxing_function_;
   const std::shared_ptr<BoxingInterpreterStatus> boxing_interpreter_status_;
+  const Symbol<PlacedNdSbp> in_;
+  const Symbol<PlacedNdSbp> out_;
 };
 
 class BoxingExprIf {
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/nd_sbp.h"
 #include "oneflow/core/boxing/eager_boxing_interpreter_mgr.h"
 #include "oneflow/core/boxing/boxing_dividor_util.h"
+#include "oneflow/core/boxing/eager_boxing_logger.h"
 
 namespace oneflow {
 
@@ -172,7 +173,7 @@ Maybe<EagerBoxingInterpreter> GetBoxingInterpreter(Symbol<NdSbp> in_nd_sbp,
   if (status.IsOk()) {
     const auto& boxing_func = JUST(main_boxing_expr->GetBoxingFunction(in, out, logical_shape));
     return std::shared_ptr<EagerBoxingInterpreter>(
-        new NaiveEagerBoxingInterpreter(boxing_func, JUST(status)));
+        new NaiveEagerBoxingInterpreter(boxing_func, JUST(status), in, out));
   }
 
   UNIMPLEMENTED_THEN_RETURN() << Error::BoxingNotSupportedError()
@@ -183,16 +184,50 @@ Maybe<EagerBoxingInterpreter> GetBoxingInterpreter(Symbol<NdSbp> in_nd_sbp,
                               << ", to_placement: " << *JUST(PlacementToString(out_parallel_desc));
 }
 
-static constexpr auto* CachedGetBoxingInterpreter =
-    DECORATE(&GetBoxingInterpreter, ThreadLocalCopiable);
+struct BoxingPlanKey {
+  Symbol<NdSbp> in_nd_sbp;
+  Symbol<NdSbp> out_nd_sbp;
+  Symbol<ParallelDesc> in_parallel_desc;
+  Symbol<ParallelDesc> out_parallel_desc;
+  Shape logical_shape;
+
+  bool operator==(const BoxingPlanKey& other) const {
+    return in_nd_sbp == other.in_nd_sbp && out_nd_sbp == other.out_nd_sbp
+           && in_parallel_desc == other.in_parallel_desc
+           && out_parallel_desc == other.out_parallel_desc && logical_shape == other.logical_shape;
+  }
+};
+
+struct BoxingPlanKeyHash {
+  size_t operator()(const BoxingPlanKey& key) const {
+    return Hash(key.in_nd_sbp, key.out_nd_sbp, key.in_parallel_desc, key.out_parallel_desc,
+                key.logical_shape);
+  }
+};
 
 }  // namespace
 
 Maybe<EagerBoxingInterpreter> EagerBoxingInterpreterManager::GetEagerBoxingInterpreter(
     Symbol<NdSbp> in_nd_sbp, Symbol<NdSbp> out_nd_sbp, Symbol<ParallelDesc> in_parallel_desc,
     Symbol<ParallelDesc> out_parallel_desc, const Shape& logical_shape) const {
-  return JUST(CachedGetBoxingInterpreter(in_nd_sbp, out_nd_sbp, in_parallel_desc, out_parallel_desc,
-                                         logical_shape));
+  // Unsupported boxings are cached as well, they are asked repeatedly by the sbp inference.
+  static thread_local HashMap<BoxingPlanKey, Maybe<EagerBoxingInterpreter>, BoxingPlanKeyHash>
+      key2plan;
+  BoxingPlanKey key{in_nd_sbp, out_nd_sbp, in_parallel_desc, out_parallel_desc, logical_shape};
+  auto iter = key2plan.find(key);
+  if (likely(iter != key2plan.end())) {
+    ++plan_cache_hit_count_;
+    return iter->second;
+  }
+  const int64_t miss_count = ++plan_cache_miss_count_;
+  auto plan = GetBoxingInterpreter(in_nd_sbp, out_nd_sbp, in_parallel_desc, out_parallel_desc,
+                                   logical_shape);
+  if (plan.IsOk()) {
+    Global<const EagerBoxingLogger>::Get()->LogPlanCacheMiss(
+        *JUST(JUST(plan)->boxing_interpreter_status()), plan_cache_hit_count_, miss_count);
+  }
+  iter = key2plan.emplace(std::move(key), std::move(plan)).first;
+  return iter->second;
 }
 
 COMMAND(Global<EagerBoxingInterpreterManager>::SetAllocated(new EagerBoxingInterpreterManager()));
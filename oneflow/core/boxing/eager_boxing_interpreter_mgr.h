@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_BOXING_EAGER_BOXING_INTERPRETER_MGR_H_
 #define ONEFLOW_CORE_BOXING_EAGER_BOXING_INTERPRETER_MGR_H_
 
+#include <atomic>
 #include "oneflow/core/boxing/eager_boxing_interpreter.h"
 
 namespace oneflow {
@@ -31,6 +32,14 @@ class EagerBoxingInterpreterManager final {
                                                           Symbol<ParallelDesc> in_parallel_desc,
                                                           Symbol<ParallelDesc> out_parallel_desc,
                                                           const Shape& logical_shape) const;
+
+  // Statistics of the boxing plan caches of all threads
+  int64_t plan_cache_hit_count() const { return plan_cache_hit_count_; }
+  int64_t plan_cache_miss_count() const { return plan_cache_miss_count_; }
+
+ private:
+  mutable std::atomic<int64_t> plan_cache_hit_count_{0};
+  mutable std::atomic<int64_t> plan_cache_miss_count_{0};
 };
 
 template<typename RetT, typename... Args>
@@ -29,6 +29,8 @@ class NullEagerBoxingLogger final : public EagerBoxingLogger {
   ~NullEagerBoxingLogger() override = default;
 
   void Log(const BoxingInterpreterStatus& status, const std::string& prefix) const override {}
+  void LogPlanCacheMiss(const BoxingInterpreterStatus& status, int64_t hit_count,
+                        int64_t miss_count) const override {}
 };
 
 class NaiveEagerBoxingLogger final : public EagerBoxingLogger {
@@ -42,6 +44,12 @@ class NaiveEagerBoxingLogger final : public EagerBoxingLogger {
     LOG(INFO) << prefix << "Altered state of sbp: " << (status.nd_sbp_routing());
     LOG(INFO) << prefix << "Altered state of placement: " << (status.placement_routing());
   }
+
+  void LogPlanCacheMiss(const BoxingInterpreterStatus& status, int64_t hit_count,
+                        int64_t miss_count) const override {
+    LOG(INFO) << "boxing plan cache miss, route: " << status.boxing_interpreter_routing()
+              << ", hits: " << hit_count << ", misses: " << miss_count;
+  }
 };
 
 const EagerBoxingLogger* CreateEagerBoxingLogger() {
@@ -29,6 +29,10 @@ class EagerBoxingLogger {
   virtual ~EagerBoxingLogger() = default;
 
   virtual void Log(const BoxingInterpreterStatus& status, const std::string& prefix) const = 0;
+  // Called when a boxing plan is resolved because the plan cache misses. The counts are over all
+  // threads, including this miss.
+  virtual void LogPlanCacheMiss(const BoxingInterpreterStatus& status, int64_t hit_count,
+                                int64_t miss_count) const = 0;
 };
 
 }  // namespace oneflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/lazy/actor/actor_message.h"
 #include "oneflow/core/common/platform.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/device_type.h"
 
 namespace oneflow {
 
@@ -40,6 +41,9 @@ class CommNet {
   // we can use this token to use the "Read"
   virtual void* RegisterMemory(void* ptr, size_t byte_size) = 0;
   virtual void UnRegisterMemory(void* token) = 0;
+  // Whether memory of `device_type` devices can be registered, so reads move data between
+  // devices of different machines without staging it in host memory. The same on all ranks.
+  virtual bool IsDeviceMemorySupported(DeviceType device_type) const { return false; }
 
   // Stream
   void* NewActorReadId();
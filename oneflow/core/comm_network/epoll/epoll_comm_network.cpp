@@ -110,7 +110,11 @@ void EpollCommNet::SendTransportMsg(int64_t dst_machine_id, const TransportMsg&
 }
 
 void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    GetDataSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  } else {
+    GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  }
 }
 
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
@@ -120,7 +124,7 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   return mem_desc;
 }
 
-EpollCommNet::EpollCommNet() : CommNetIf() {
+EpollCommNet::EpollCommNet() : CommNetIf(), data_socket_cnt_(0) {
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
   InitSockets();
@@ -131,7 +135,11 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = GlobalProcessCtx::Rank();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->process_ranks().size();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  // must be the same on all ranks
+  const int64_t num_sockets_per_peer =
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_NUM_SOCKETS_PER_PEER", 1);
+  CHECK_GT(num_sockets_per_peer, 0);
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(num_sockets_per_peer, -1));
   sockfd2helper_.clear();
   size_t poller_idx = 0;
   auto NewSocketHelper = [&](int sockfd) {
@@ -150,7 +158,8 @@ void EpollCommNet::InitSockets() {
       this_listen_port = Global<EnvDesc>::Get()->data_port();
     }
   }
-  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num), 0);
+  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num * num_sockets_per_peer),
+           0);
   CHECK_NE(this_listen_port, 0);
   PushPort(this_machine_id, this_listen_port);
   int32_t src_machine_count = 0;
@@ -164,45 +173,58 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    ssize_t n = write(sockfd, &this_machine_id, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int64_t, socket_idx, 0, num_sockets_per_peer) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      const int64_t hello[2] = {this_machine_id, socket_idx};
+      ssize_t n = write(sockfd, hello, sizeof(hello));
+      PCHECK(n == sizeof(hello));
+      CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
+      machine_id2sockfds_[peer_id][socket_idx] = sockfd;
+    }
   }
 
   // accept
-  HashSet<int64_t> processed_ranks;
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
+  HashSet<std::pair<int64_t, int64_t>> processed_sockets;
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * num_sockets_per_peer) {
     sockaddr_in peer_sockaddr;
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
-    int64_t peer_rank;
-    ssize_t n = read(sockfd, &peer_rank, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
+    int64_t hello[2];
+    ssize_t n = read(sockfd, hello, sizeof(hello));
+    PCHECK(n == sizeof(hello));
+    const int64_t peer_rank = hello[0];
+    const int64_t socket_idx = hello[1];
+    CHECK_LT(socket_idx, num_sockets_per_peer);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    CHECK(processed_ranks.emplace(peer_rank).second);
-    machine_id2sockfd_[peer_rank] = sockfd;
+    CHECK(processed_sockets.emplace(peer_rank, socket_idx).second);
+    machine_id2sockfds_[peer_rank][socket_idx] = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    VLOG(2) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    VLOG(2) << "machine " << machine_id << " sockfd " << machine_id2sockfds_[machine_id].front();
   }
 }
 
 SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+  int sockfd = machine_id2sockfds_.at(machine_id).front();
   return sockfd2helper_.at(sockfd);
 }
 
+SocketHelper* EpollCommNet::GetDataSocketHelper(int64_t machine_id) {
+  const std::vector<int>& sockfds = machine_id2sockfds_.at(machine_id);
+  if (sockfds.size() == 1) { return sockfd2helper_.at(sockfds.front()); }
+  const uint64_t idx = data_socket_cnt_.fetch_add(1, std::memory_order_relaxed);
+  return sockfd2helper_.at(sockfds.at(1 + idx % (sockfds.size() - 1)));
+}
+
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
   SocketMsg msg;
   msg.msg_type = SocketMsgType::kRequestWrite;
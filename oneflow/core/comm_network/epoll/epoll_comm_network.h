@@ -39,12 +39,16 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   friend class Global<EpollCommNet>;
   EpollCommNet();
   void InitSockets();
+  // Messages go through the first socket to a peer, bodies of reads through the others if any,
+  // so a large body does not delay the messages queued behind it.
   SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetDataSocketHelper(int64_t machine_id);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
+  std::atomic<uint64_t> data_socket_cnt_;
 };
 
 }  // namespace oneflow
@@ -24,12 +24,21 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kReadBufferSize = 64 * 1024;
+
+}  // namespace
+
 SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
 SocketReadHelper::SocketReadHelper(int sockfd) {
   sockfd_ = sockfd;
+  buffer_.resize(kReadBufferSize);
+  buffer_begin_ = 0;
+  buffer_end_ = 0;
   SwitchToMsgHeadReadHandle();
 }
 
@@ -54,10 +63,29 @@ bool SocketReadHelper::MsgBodyReadHandle() {
 }
 
 bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)()) {
-  ssize_t n = read(sockfd_, read_ptr_, read_size_);
+  if (read_size_ == 0) {
+    (this->*set_cur_read_done)();
+    return true;
+  }
+  if (buffer_begin_ < buffer_end_) {
+    const size_t n = std::min(read_size_, buffer_end_ - buffer_begin_);
+    std::memcpy(read_ptr_, buffer_.data() + buffer_begin_, n);
+    buffer_begin_ += n;
+    read_ptr_ += n;
+    read_size_ -= n;
+    if (read_size_ == 0) { (this->*set_cur_read_done)(); }
+    return true;
+  }
+  const bool read_to_buffer = read_size_ < buffer_.size();
+  ssize_t n = read_to_buffer ? read(sockfd_, buffer_.data(), buffer_.size())
+                             : read(sockfd_, read_ptr_, read_size_);
   const int val = 1;
   PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
-  if (n == read_size_) {
+  if (n >= 0 && read_to_buffer) {
+    buffer_begin_ = 0;
+    buffer_end_ = n;
+    return true;
+  } else if (n == read_size_) {
     (this->*set_cur_read_done)();
     return true;
   } else if (n >= 0) {
@@ -22,6 +22,8 @@ limitations under the License.
 
 namespace oneflow {
 
+// Reads the socket into a staging buffer so that many small messages take one read. Bodies at
+// least as large as the buffer are read into their destination directly.
 class SocketReadHelper final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SocketReadHelper);
@@ -53,6 +55,10 @@ class SocketReadHelper final {
   bool (SocketReadHelper::*cur_read_handle_)();
   char* read_ptr_;
   size_t read_size_;
+
+  std::vector<char> buffer_;
+  size_t buffer_begin_;
+  size_t buffer_end_;
 };
 
 }  // namespace oneflow
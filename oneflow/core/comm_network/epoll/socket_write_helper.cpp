@@ -18,10 +18,18 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
+#include <linux/errqueue.h>
 #include <sys/eventfd.h>
+#include <sys/uio.h>
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kMaxIovCnt = 64;
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -40,9 +48,18 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  zerocopy_threshold_ = ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_ZEROCOPY_THRESHOLD", 0);
+#ifdef SO_ZEROCOPY
+  if (zerocopy_threshold_ > 0) {
+    const int val = 1;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) != 0) {
+      PLOG(WARNING) << "MSG_ZEROCOPY is not supported by fd " << sockfd_;
+      zerocopy_threshold_ = 0;
+    }
+  }
+#else
+  zerocopy_threshold_ = 0;
+#endif  // SO_ZEROCOPY
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -55,6 +72,37 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
 
 void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
 
+void SocketWriteHelper::NotifyMeSocketError() {
+  // Completions of MSG_ZEROCOPY sends are reported on the error queue of the socket. The bodies
+  // are registers, which are not rewritten before the peer has received them, so the
+  // completions are only reaped to release the kernel's resources.
+  bool has_zerocopy_completion = false;
+  while (true) {
+    char control[CMSG_SPACE(sizeof(sock_extended_err))];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd_, &msg, MSG_ERRQUEUE) == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      break;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+      const auto* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+      CHECK_EQ(err->ee_errno, 0) << "fd: " << sockfd_;
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+      CHECK_EQ(err->ee_origin, SO_EE_ORIGIN_ZEROCOPY) << "fd: " << sockfd_;
+#endif  // SO_EE_ORIGIN_ZEROCOPY
+      has_zerocopy_completion = true;
+    }
+  }
+  if (!has_zerocopy_completion) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    PCHECK(getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &err, &len) == 0);
+    LOG(FATAL) << "fd: " << sockfd_ << " error: " << strerror(err);
+  }
+}
+
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
   PCHECK(write(queue_not_empty_fd_, &event_num, 8) == 8);
@@ -67,41 +115,59 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
+  while (true) {
+    FillSegments();
+    if (segments_.empty()) { return; }
+    if (!WriteSegments()) { return; }
+  }
 }
 
-bool SocketWriteHelper::InitMsgWriteHandle() {
-  if (cur_msg_queue_->empty()) {
-    {
-      std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
-      std::swap(cur_msg_queue_, pending_msg_queue_);
+void SocketWriteHelper::FillSegments() {
+  while (segments_.size() + 2 <= kMaxIovCnt) {
+    if (cur_msg_queue_->empty()) {
+      {
+        std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
+        std::swap(cur_msg_queue_, pending_msg_queue_);
+      }
+      if (cur_msg_queue_->empty()) { return; }
     }
-    if (cur_msg_queue_->empty()) { return false; }
+    writing_msgs_.push_back(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+    const SocketMsg& msg = writing_msgs_.back();
+    size_t body_size = 0;
+    const char* body_ptr = nullptr;
+    if (msg.msg_type == SocketMsgType::kRequestRead) {
+      auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+      body_ptr = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
+      body_size = src_mem_desc->byte_size;
+    }
+    segments_.push_back(
+        WriteSegment{reinterpret_cast<const char*>(&msg), sizeof(SocketMsg), body_size == 0});
+    if (body_size > 0) { segments_.push_back(WriteSegment{body_ptr, body_size, true}); }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
-  return true;
-}
-
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
 }
 
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
-}
-
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
+bool SocketWriteHelper::WriteSegments() {
+  iovec iov[kMaxIovCnt];
+  size_t iov_cnt = 0;
+  int flags = 0;
+  for (const WriteSegment& segment : segments_) {
+    if (iov_cnt == kMaxIovCnt) { break; }
+    iov[iov_cnt].iov_base = const_cast<char*>(segment.ptr);
+    iov[iov_cnt].iov_len = segment.size;
+    iov_cnt += 1;
+#ifdef MSG_ZEROCOPY
+    if (zerocopy_threshold_ > 0 && segment.size >= zerocopy_threshold_) { flags = MSG_ZEROCOPY; }
+#endif  // MSG_ZEROCOPY
+  }
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iov_cnt;
+  ssize_t n = sendmsg(sockfd_, &msg, flags);
+  // out of the socket's optmem for pinning pages, fall back to copying
+  if (n == -1 && flags != 0 && errno == ENOBUFS) { n = sendmsg(sockfd_, &msg, 0); }
+  if (n >= 0) {
+    ConsumeSegments(n);
     return true;
   } else {
     CHECK_EQ(n, -1);
@@ -110,40 +176,20 @@ bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+void SocketWriteHelper::ConsumeSegments(size_t byte_size) {
+  while (byte_size > 0) {
+    WriteSegment& segment = segments_.front();
+    if (byte_size < segment.size) {
+      segment.ptr += byte_size;
+      segment.size -= byte_size;
+      return;
+    }
+    byte_size -= segment.size;
+    if (segment.is_msg_end) { writing_msgs_.pop_front(); }
+    segments_.pop_front();
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
 }  // namespace oneflow
 
 #endif  // __linux__
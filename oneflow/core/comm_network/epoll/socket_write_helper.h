@@ -23,6 +23,9 @@ limitations under the License.
 
 namespace oneflow {
 
+// Writes the queued messages of a socket with sendmsg, gathering the headers and bodies of up to
+// kMaxIovCnt of them in one call. Bodies of at least ONEFLOW_COMM_NET_EPOLL_ZEROCOPY_THRESHOLD
+// bytes are sent with MSG_ZEROCOPY if it is set and the kernel supports it.
 class SocketWriteHelper final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SocketWriteHelper);
@@ -34,23 +37,22 @@ class SocketWriteHelper final {
   void AsyncWrite(const SocketMsg& msg);
 
   void NotifyMeSocketWriteable();
+  void NotifyMeSocketError();
 
  private:
+  struct WriteSegment {
+    const char* ptr;
+    size_t size;
+    bool is_msg_end;
+  };
+
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  void FillSegments();
+  bool WriteSegments();
+  void ConsumeSegments(size_t byte_size);
 
   int sockfd_;
   int queue_not_empty_fd_;
@@ -60,10 +62,11 @@ class SocketWriteHelper final {
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // Messages being written, the header segments point into them. std::deque keeps references
+  // valid on push_back and pop_front.
+  std::deque<SocketMsg> writing_msgs_;
+  std::deque<WriteSegment> segments_;
+  size_t zerocopy_threshold_;
 };
 
 }  // namespace oneflow
@@ -20,9 +20,14 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/platform/include/ibv.h"
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
+#include "oneflow/core/hardware/node_device_descriptor_manager.h"
+#include "oneflow/core/hardware/net_ib_device_descriptor.h"
+#include "oneflow/core/hardware/cuda_device_descriptor.h"
 
 #if defined(WITH_RDMA) && defined(OF_PLATFORM_POSIX)
 
+#include <sstream>
+
 namespace oneflow {
 
 namespace {
@@ -43,37 +48,114 @@ void IBVForkInit() {
   }
 }
 
-void ParseUserDevicePort(std::string* device_name, int* port) {
-  std::string user_device_port = GetStringFromEnv("ONEFLOW_COMM_NET_IB_HCA", "");
-  if (user_device_port.empty()) {
-    *device_name = "";
-    *port = 0;
-    return;
-  } else {
+constexpr size_t kDefaultReadStripeSize = 4 * 1024 * 1024;
+
+// A port number of 0 is for the first port of the device.
+struct DevicePort {
+  std::string device_name;
+  int port;
+};
+
+// ONEFLOW_COMM_NET_IB_HCA is a comma separated list of devices, each optionally followed by
+// ':' and a port number, e.g. "mlx5_0:1,mlx5_1:1".
+std::vector<DevicePort> ParseUserDevicePorts() {
+  std::vector<DevicePort> device_ports;
+  const std::string user_device_ports = GetStringFromEnv("ONEFLOW_COMM_NET_IB_HCA", "");
+  std::stringstream ss(user_device_ports);
+  std::string user_device_port;
+  while (std::getline(ss, user_device_port, ',')) {
+    if (user_device_port.empty()) { continue; }
     const std::string::size_type pos = user_device_port.find(':', 0);
     if (pos == std::string::npos) {
-      *device_name = user_device_port;
-      *port = 0;
-      return;
+      device_ports.emplace_back(DevicePort{user_device_port, 0});
+    } else {
+      const int port = std::strtol(user_device_port.data() + pos + 1, nullptr, 10);
+      device_ports.emplace_back(DevicePort{user_device_port.substr(0, pos), port});
+    }
+  }
+  return device_ports;
+}
+
+// Distance between two PCI devices by bus number, a GPU and an HCA behind the same PCIe switch get
+// adjacent bus numbers. Bus ids look like "0000:3b:00.0".
+int64_t PCIBusDistance(const std::string& lhs, const std::string& rhs) {
+  constexpr int64_t kUnknownDistance = 1 << 16;
+  if (lhs.size() < 7 || rhs.size() < 7 || lhs.substr(0, 4) != rhs.substr(0, 4)) {
+    return kUnknownDistance;
+  }
+  const int64_t lhs_bus = std::strtol(lhs.substr(5, 2).c_str(), nullptr, 16);
+  const int64_t rhs_bus = std::strtol(rhs.substr(5, 2).c_str(), nullptr, 16);
+  return std::abs(lhs_bus - rhs_bus);
+}
+
+// Picks `num` active ports, those on the NUMA node of the GPU of this process first, and the
+// closest to the GPU on the PCI bus among them. Processes whose GPUs are equally close start from
+// different ports, so they spread over the devices.
+std::vector<DevicePort> SelectDevicePorts(size_t num) {
+  std::vector<DevicePort> device_ports;
+  auto* manager = Global<hardware::NodeDeviceDescriptorManager>::Get();
+  if (manager == nullptr) { return device_ports; }
+  auto node_desc = manager->GetLocalNodeDeviceDescriptor();
+  auto ib_device_list =
+      node_desc->GetDeviceDescriptorList(hardware::kNetIBDeviceDescriptorClassName);
+  if (!ib_device_list) { return device_ports; }
+  const int64_t local_rank = GlobalProcessCtx::LocalRank();
+  int32_t gpu_numa_node = -1;
+  std::string gpu_bus_id;
+#ifdef WITH_CUDA
+  auto cuda_device = std::dynamic_pointer_cast<const hardware::CudaDeviceDescriptor>(
+      node_desc->GetDevice(hardware::kCudaDeviceDescriptorClassName, local_rank));
+  if (cuda_device) {
+    gpu_bus_id = cuda_device->PCIBusID();
+    gpu_numa_node = node_desc->Topology()->GetNumaNodeByPCIBusID(gpu_bus_id);
+  }
+#endif  // WITH_CUDA
+  std::vector<std::shared_ptr<const hardware::NetIBDeviceDescriptor>> near_ib_devices;
+  std::vector<std::shared_ptr<const hardware::NetIBDeviceDescriptor>> far_ib_devices;
+  for (size_t i = 0; i < ib_device_list->DeviceCount(); ++i) {
+    auto ib_device = std::dynamic_pointer_cast<const hardware::NetIBDeviceDescriptor>(
+        ib_device_list->GetDevice(i));
+    if (!ib_device) { continue; }
+    if (gpu_numa_node >= 0
+        && node_desc->Topology()->GetNumaNodeByPCIBusID(ib_device->PCIBusID()) == gpu_numa_node) {
+      near_ib_devices.emplace_back(ib_device);
     } else {
-      *device_name = user_device_port.substr(0, pos);
-      *port = std::strtol(user_device_port.data() + pos + 1, nullptr, 10);
-      return;
+      far_ib_devices.emplace_back(ib_device);
+    }
+  }
+  for (auto* ib_devices : {&near_ib_devices, &far_ib_devices}) {
+    if (ib_devices->empty()) { continue; }
+    std::rotate(ib_devices->begin(), ib_devices->begin() + local_rank % ib_devices->size(),
+                ib_devices->end());
+    if (!gpu_bus_id.empty()) {
+      std::stable_sort(ib_devices->begin(), ib_devices->end(),
+                       [&](const std::shared_ptr<const hardware::NetIBDeviceDescriptor>& lhs,
+                           const std::shared_ptr<const hardware::NetIBDeviceDescriptor>& rhs) {
+                         return PCIBusDistance(gpu_bus_id, lhs->PCIBusID())
+                                < PCIBusDistance(gpu_bus_id, rhs->PCIBusID());
+                       });
+    }
+    for (const auto& ib_device : *ib_devices) {
+      if (device_ports.size() >= num) { break; }
+      device_ports.emplace_back(DevicePort{ib_device->Name(), ib_device->Port()});
     }
   }
+  return device_ports;
 }
 
 }  // namespace
 
 IBVerbsCommNet::~IBVerbsCommNet() {
-  while (poll_exit_flag_.test_and_set() == true) {}
-  poll_thread_.join();
-  for (IBVerbsQP* qp : qp_vec_) {
-    if (qp) { delete qp; }
-  }
-  CHECK_EQ(ibv::wrapper.ibv_destroy_cq(cq_), 0);
-  CHECK_EQ(ibv::wrapper.ibv_dealloc_pd(pd_), 0);
-  CHECK_EQ(ibv::wrapper.ibv_close_device(context_), 0);
+  poll_exit_flag_.store(true);
+  for (std::thread& poll_thread : poll_thread_vec_) { poll_thread.join(); }
+  for (const auto& qp_vec : peer_id2qp_vec_) {
+    for (IBVerbsQP* qp : qp_vec) { delete qp; }
+  }
+  for (const Device& device : device_vec_) {
+    CHECK_EQ(ibv::wrapper.ibv_destroy_cq(device.cq), 0);
+    CHECK_EQ(ibv::wrapper.ibv_dealloc_pd(device.pd), 0);
+    CHECK_EQ(ibv::wrapper.ibv_close_device(device.context), 0);
+  }
 }
 
 void IBVerbsCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) {
@@ -85,11 +167,11 @@ void IBVerbsCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) {
     IBVerbsCommNetRMADesc rma_desc{};
     rma_desc.mem_ptr = reinterpret_cast<uint64_t>(mem_desc->mem_ptr());
     rma_desc.mem_size = mem_desc->mem_size();
-    rma_desc.mr_rkey = mem_desc->mr()->rkey;
+    for (size_t i = 0; i < device_vec_.size(); ++i) { rma_desc.mr_rkey[i] = mem_desc->mr(i)->rkey; }
     static_assert(sizeof(IBVerbsCommNetRMADesc) <= kActorMsgUserDataMaxSize, "");
     new_msg.AddUserData(sizeof(IBVerbsCommNetRMADesc), &rma_desc);
   }
-  qp_vec_.at(dst_machine_id)->PostSendRequest(new_msg);
+  peer_id2qp_vec_.at(dst_machine_id).front()->PostSendRequest(new_msg);
 }
 
 void IBVerbsCommNet::RecvActorMsg(const ActorMsg& msg) {
@@ -106,95 +188,150 @@ void IBVerbsCommNet::RecvActorMsg(const ActorMsg& msg) {
   Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(new_msg);
 }
 
-IBVerbsCommNet::IBVerbsCommNet() : CommNetIf(), poll_exit_flag_(ATOMIC_FLAG_INIT) {
+IBVerbsCommNet::IBVerbsCommNet()
+    : CommNetIf(),
+      read_stripe_size_(
+          ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_READ_STRIPE_SIZE", kDefaultReadStripeSize)),
+      gpu_direct_rdma_enabled_(ParseBooleanFromEnv("ONEFLOW_COMM_NET_IB_ENABLE_GPU_DIRECT", false)
+                               && IBVerbsDeviceMemRegistrationSupported()),
+      read_cnt_(0),
+      poll_exit_flag_(false) {
+  std::vector<DevicePort> device_ports = ParseUserDevicePorts();
+  if (device_ports.empty()) {
+    const int64_t num_devices = ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_NUM_DEVICES", 1);
+    CHECK_GT(num_devices, 0);
+    device_ports = SelectDevicePorts(num_devices);
+  }
+  CHECK_LE(device_ports.size(), kMaxIBVerbsDeviceNum);
   int num_device;
   ibv_device** device_list = ibv::wrapper.ibv_get_device_list(&num_device);
   CHECK_GT(num_device, 0) << "No IB device found";
   PCHECK(device_list);
-  std::string user_device;
-  int user_port;
-  ParseUserDevicePort(&user_device, &user_port);
-  ibv_device* device = nullptr;
-  if (user_device.empty()) {
-    device = device_list[0];
-  } else {
+  // Without a user choice or a device descriptor, the first port of the first device is used.
+  if (device_ports.empty()) { device_ports.emplace_back(DevicePort{device_list[0]->name, 0}); }
+  const int64_t gid_index = ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_GID_INDEX", 0);
+  for (const DevicePort& device_port : device_ports) {
+    ibv_device* device = nullptr;
     for (int i = 0; i < num_device; ++i) {
-      if (device_list[i]->name == user_device) {
+      if (device_list[i]->name == device_port.device_name) {
         device = device_list[i];
         break;
       }
     }
-    CHECK(device != nullptr) << "No IB device match " << user_device;
+    CHECK(device != nullptr) << "No IB device match " << device_port.device_name;
+    Device ctx{};
+    ctx.context = ibv::wrapper.ibv_open_device(device);
+    CHECK(ctx.context);
+    ctx.pd = ibv::wrapper.ibv_alloc_pd(ctx.context);
+    CHECK(ctx.pd);
+    ibv_device_attr device_attr{};
+    CHECK_EQ(ibv::wrapper.ibv_query_device(ctx.context, &device_attr), 0);
+    ctx.cq = ibv::wrapper.ibv_create_cq(ctx.context, device_attr.max_cqe, nullptr, nullptr, 0);
+    CHECK(ctx.cq);
+    ctx.port = device_port.port == 0 ? 1 : device_port.port;
+    CHECK_EQ(ibv::wrapper.ibv_query_port_wrap(ctx.context, ctx.port, &ctx.port_attr), 0);
+    CHECK_EQ(ibv::wrapper.ibv_query_gid(ctx.context, ctx.port, gid_index, &ctx.gid), 0);
+    LOG(INFO) << "rank " << GlobalProcessCtx::Rank() << " uses IB device " << device->name
+              << " port " << static_cast<int32_t>(ctx.port) << " gid index " << gid_index;
+    device_vec_.emplace_back(ctx);
+    pd_vec_.emplace_back(ctx.pd);
   }
-  context_ = ibv::wrapper.ibv_open_device(device);
-  CHECK(context_);
   ibv::wrapper.ibv_free_device_list(device_list);
-  pd_ = ibv::wrapper.ibv_alloc_pd(context_);
-  CHECK(pd_);
-  ibv_device_attr device_attr{};
-  CHECK_EQ(ibv::wrapper.ibv_query_device(context_, &device_attr), 0);
-  cq_ = ibv::wrapper.ibv_create_cq(context_, device_attr.max_cqe, nullptr, nullptr, 0);
-  CHECK(cq_);
-  ibv_port_attr port_attr{};
-  const uint8_t port = user_port == 0 ? 1 : user_port;
-  CHECK_EQ(ibv::wrapper.ibv_query_port_wrap(context_, port, &port_attr), 0);
-  ibv_gid gid{};
-  const int64_t gid_index = ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_GID_INDEX", 0);
-  CHECK_EQ(ibv::wrapper.ibv_query_gid(context_, port, gid_index, &gid), 0);
-  VLOG(1) << "Using IB device " << device->name << " port " << static_cast<int32_t>(port)
-          << " gid index " << gid_index;
+  const int64_t num_qps_per_peer =
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_NUM_QPS_PER_PEER", device_vec_.size());
+  CHECK_GT(num_qps_per_peer, 0);
   int64_t this_machine_id = GlobalProcessCtx::Rank();
-  qp_vec_.assign(Global<ResourceDesc, ForEnv>::Get()->process_ranks().size(), nullptr);
+  peer_id2qp_vec_.resize(Global<ResourceDesc, ForEnv>::Get()->process_ranks().size());
   for (int64_t peer_id : peer_machine_id()) {
-    IBVerbsQP* cur_qp = new IBVerbsQP(context_, pd_, port, cq_, cq_);
-    qp_vec_.at(peer_id) = cur_qp;
-    IBVerbsConnectionInfo conn_info;
-    conn_info.set_lid(port_attr.lid);
-    conn_info.set_qp_num(cur_qp->qp_num());
-    conn_info.set_subnet_prefix(gid.global.subnet_prefix);
-    conn_info.set_interface_id(gid.global.interface_id);
-    conn_info.set_port_num(port);
-    conn_info.set_mtu(static_cast<int>(port_attr.active_mtu));
-    Global<CtrlClient>::Get()->PushKV(GenConnInfoKey(this_machine_id, peer_id), conn_info);
+    IBVerbsConnectionInfoList conn_info_list;
+    for (int64_t i = 0; i < num_qps_per_peer; ++i) {
+      const int64_t device_index = i % device_vec_.size();
+      const Device& device = device_vec_.at(device_index);
+      IBVerbsQP* cur_qp =
+          new IBVerbsQP(device.context, device.pd, device.port, device.cq, device.cq);
+      peer_id2qp_vec_.at(peer_id).emplace_back(cur_qp);
+      IBVerbsConnectionInfo* conn_info = conn_info_list.add_conn_info();
+      conn_info->set_lid(device.port_attr.lid);
+      conn_info->set_qp_num(cur_qp->qp_num());
+      conn_info->set_subnet_prefix(device.gid.global.subnet_prefix);
+      conn_info->set_interface_id(device.gid.global.interface_id);
+      conn_info->set_port_num(device.port);
+      conn_info->set_mtu(static_cast<int>(device.port_attr.active_mtu));
+      conn_info->set_device_index(device_index);
+      conn_info->set_max_recv_msg_num(cur_qp->max_recv_msg_num());
+    }
+    conn_info_list.set_gpu_direct_rdma(gpu_direct_rdma_enabled_);
+    Global<CtrlClient>::Get()->PushKV(GenConnInfoKey(this_machine_id, peer_id), conn_info_list);
   }
   for (int64_t peer_id : peer_machine_id()) {
-    IBVerbsConnectionInfo conn_info;
-    Global<CtrlClient>::Get()->PullKV(GenConnInfoKey(peer_id, this_machine_id), &conn_info);
-    if (conn_info.lid() == 0) {
-      VLOG(2) << "Connecting to peer " << peer_id << " port " << conn_info.port_num() << " qpn "
-              << conn_info.qp_num() << " gid index " << gid_index << " spn "
-              << conn_info.subnet_prefix() << " iid " << conn_info.interface_id() << " mtu "
-              << conn_info.mtu();
-    } else {
-      VLOG(2) << "Connecting to peer " << peer_id << " port " << conn_info.port_num() << " qpn "
-              << conn_info.qp_num() << " lid " << conn_info.interface_id() << " mtu "
-              << conn_info.mtu();
+    IBVerbsConnectionInfoList conn_info_list;
+    Global<CtrlClient>::Get()->PullKV(GenConnInfoKey(peer_id, this_machine_id), &conn_info_list);
+    CHECK_EQ(conn_info_list.conn_info_size(), num_qps_per_peer)
+        << "ONEFLOW_COMM_NET_IB_NUM_QPS_PER_PEER of peer " << peer_id << " mismatches";
+    // Device memory is read directly only if every rank can register it.
+    gpu_direct_rdma_enabled_ = gpu_direct_rdma_enabled_ && conn_info_list.gpu_direct_rdma();
+    for (int64_t i = 0; i < num_qps_per_peer; ++i) {
+      const IBVerbsConnectionInfo& conn_info = conn_info_list.conn_info(i);
+      if (conn_info.lid() == 0) {
+        VLOG(2) << "Connecting to peer " << peer_id << " port " << conn_info.port_num()
+                << " qpn " << conn_info.qp_num() << " gid index " << gid_index << " spn "
+                << conn_info.subnet_prefix() << " iid " << conn_info.interface_id() << " mtu "
+                << conn_info.mtu();
+      } else {
+        VLOG(2) << "Connecting to peer " << peer_id << " port " << conn_info.port_num()
+                << " qpn " << conn_info.qp_num() << " lid " << conn_info.interface_id()
+                << " mtu " << conn_info.mtu();
+      }
+      CHECK_LT(conn_info.device_index(), kMaxIBVerbsDeviceNum);
+      peer_id2qp_vec_.at(peer_id).at(i)->Connect(conn_info);
     }
-    qp_vec_.at(peer_id)->Connect(conn_info);
     VLOG(1) << "Connected to peer " << peer_id;
   }
+  VLOG(1) << "GPUDirect RDMA " << (gpu_direct_rdma_enabled_ ? "enabled" : "disabled");
   OF_ENV_BARRIER();
   for (int64_t peer_id : peer_machine_id()) {
-    qp_vec_.at(peer_id)->PostAllRecvRequest();
+    for (IBVerbsQP* qp : peer_id2qp_vec_.at(peer_id)) { qp->PostAllRecvRequest(); }
     Global<CtrlClient>::Get()->ClearKV(GenConnInfoKey(this_machine_id, peer_id));
   }
   OF_ENV_BARRIER();
-  poll_thread_ = std::thread(&IBVerbsCommNet::PollCQ, this);
+  for (const Device& device : device_vec_) {
+    poll_thread_vec_.emplace_back(&IBVerbsCommNet::PollCQ, this, device.cq);
+  }
   OF_ENV_BARRIER();
 }
 
 void IBVerbsCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token,
                             void* dst_token) {
-  qp_vec_.at(src_machine_id)
-      ->PostReadRequest(*reinterpret_cast<IBVerbsCommNetRMADesc*>(src_token),
-                        *static_cast<const IBVerbsMemDesc*>(dst_token), read_id);
+  const auto& remote_mem = *reinterpret_cast<IBVerbsCommNetRMADesc*>(src_token);
+  const auto& local_mem = *static_cast<const IBVerbsMemDesc*>(dst_token);
+  CHECK_EQ(remote_mem.mem_size, local_mem.mem_size());
+  const std::vector<IBVerbsQP*>& qp_vec = peer_id2qp_vec_.at(src_machine_id);
+  const size_t size = local_mem.mem_size();
+  size_t num_parts = 1;
+  if (qp_vec.size() > 1 && read_stripe_size_ > 0 && size > read_stripe_size_) {
+    num_parts = RoundUp(size, read_stripe_size_) / read_stripe_size_;
+  }
+  const size_t part_size = num_parts == 1 ? size : read_stripe_size_;
+  // Reads smaller than a stripe go round-robin over the QPs.
+  const size_t first_qp_index = read_cnt_.fetch_add(1, std::memory_order_relaxed) % qp_vec.size();
+  auto* read_state = new IBVerbsReadState;
+  read_state->outstanding_part_cnt = static_cast<int32_t>(num_parts);
+  read_state->read_id = read_id;
+  for (size_t i = 0; i < num_parts; ++i) {
+    const size_t qp_index = (first_qp_index + i) % qp_vec.size();
+    IBVerbsQP* qp = qp_vec.at(qp_index);
+    const size_t offset = i * part_size;
+    qp->PostReadRequest(remote_mem.mem_ptr + offset, remote_mem.mr_rkey[qp->peer_device_index()],
+                        reinterpret_cast<char*>(local_mem.mem_ptr()) + offset,
+                        local_mem.mr(qp_index % device_vec_.size())->lkey,
+                        std::min(part_size, size - offset), read_state);
+  }
 }
 
-void IBVerbsCommNet::PollCQ() {
+void IBVerbsCommNet::PollCQ(ibv_cq* cq) {
   std::vector<ibv_wc> wc_vec(max_poll_wc_num_);
-  while (poll_exit_flag_.test_and_set() == false) {
-    poll_exit_flag_.clear();
-    int32_t found_wc_num = ibv_poll_cq(cq_, max_poll_wc_num_, wc_vec.data());
+  while (!poll_exit_flag_.load(std::memory_order_relaxed)) {
+    int32_t found_wc_num = ibv_poll_cq(cq, max_poll_wc_num_, wc_vec.data());
     CHECK_GE(found_wc_num, 0);
     FOR_RANGE(int32_t, i, 0, found_wc_num) {
       const ibv_wc& wc = wc_vec.at(i);
@@ -211,7 +348,7 @@ void IBVerbsCommNet::PollCQ() {
           break;
         }
         case IBV_WC_RECV: {
-          qp->RecvDone(wr_id);
+          qp->RecvDone(wr_id, wc.byte_len);
           break;
         }
         default: UNIMPLEMENTED();
@@ -28,10 +28,13 @@ limitations under the License.
 
 namespace oneflow {
 
+// The rkeys of a remote memory have to fit in the user data of an actor message.
+constexpr size_t kMaxIBVerbsDeviceNum = 4;
+
 struct IBVerbsCommNetRMADesc {
   uint64_t mem_ptr;
   uint64_t mem_size;
-  uint32_t mr_rkey;
+  uint32_t mr_rkey[kMaxIBVerbsDeviceNum];
 };
 
 class IBVerbsCommNet final : public CommNetIf<IBVerbsMemDesc> {
@@ -41,26 +44,42 @@ class IBVerbsCommNet final : public CommNetIf<IBVerbsMemDesc> {
 
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
   void RecvActorMsg(const ActorMsg& msg);
+  bool IsDeviceMemorySupported(DeviceType device_type) const override {
+    return device_type == DeviceType::kCUDA && gpu_direct_rdma_enabled_;
+  }
 
  private:
   friend class Global<IBVerbsCommNet>;
   IBVerbsCommNet();
 
+  struct Device {
+    ibv_context* context;
+    ibv_pd* pd;
+    ibv_cq* cq;
+    uint8_t port;
+    ibv_port_attr port_attr;
+    ibv_gid gid;
+  };
+
   IBVerbsMemDesc* NewMemDesc(void* ptr, size_t byte_size) override {
-    return new IBVerbsMemDesc(pd_, ptr, byte_size);
+    return new IBVerbsMemDesc(pd_vec_, ptr, byte_size);
   }
 
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
-  void PollCQ();
+  void PollCQ(ibv_cq* cq);
 
   static const int32_t max_poll_wc_num_;
 
-  ibv_context* context_;
-  ibv_pd* pd_;
-  ibv_cq* cq_;
-  std::vector<IBVerbsQP*> qp_vec_;
-  std::atomic_flag poll_exit_flag_;
-  std::thread poll_thread_;
+  std::vector<Device> device_vec_;
+  std::vector<ibv_pd*> pd_vec_;
+  // QPs to each peer, the i-th of them on device i % device_vec_.size(). Actor messages always
+  // go through the first one to keep their order, reads are striped over all of them.
+  std::vector<std::vector<IBVerbsQP*>> peer_id2qp_vec_;
+  size_t read_stripe_size_;
+  bool gpu_direct_rdma_enabled_;
+  std::atomic<uint64_t> read_cnt_;
+  std::atomic<bool> poll_exit_flag_;
+  std::vector<std::thread> poll_thread_vec_;
   HashMap<std::pair<int64_t, uint64_t>, std::shared_ptr<IBVerbsCommNetRMADesc>>
       remote_regst2rma_desc_;
   std::mutex remote_regst2rma_desc_mutex_;
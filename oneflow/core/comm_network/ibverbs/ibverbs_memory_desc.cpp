@@ -16,20 +16,130 @@ limitations under the License.
 #include "oneflow/core/comm_network/ibverbs/ibverbs_memory_desc.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/platform/include/ibv.h"
+#ifdef WITH_CUDA
+#include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
 
 #if defined(WITH_RDMA) && defined(OF_PLATFORM_POSIX)
 
+#include <unistd.h>
+
 namespace oneflow {
 
+namespace {
+
+constexpr int kMrAccess =
+    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_READ;
+
+bool IsPeerMemLoaded() {
+  for (const char* path :
+       {"/sys/module/nvidia_peermem/version", "/sys/module/nv_peer_mem/version",
+        "/sys/kernel/mm/memory_peers/nv_mem/version"}) {
+    if (access(path, F_OK) == 0) { return true; }
+  }
+  return false;
+}
+
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11070
+
+using GetHandleForAddressRangeFn = decltype(&cuMemGetHandleForAddressRange);
+
+// The driver API is loaded with cudaGetDriverEntryPoint, no libcuda is linked.
+GetHandleForAddressRangeFn GetHandleForAddressRange() {
+  static const GetHandleForAddressRangeFn fn = []() -> GetHandleForAddressRangeFn {
+    void* ptr = nullptr;
+    if (cudaGetDriverEntryPoint("cuMemGetHandleForAddressRange", &ptr, cudaEnableDefault)
+        != cudaSuccess) {
+      // Clear the sticky error of the runtime.
+      cudaGetLastError();
+      return nullptr;
+    }
+    return reinterpret_cast<GetHandleForAddressRangeFn>(ptr);
+  }();
+  return fn;
+}
+
+#endif  // WITH_CUDA && CUDA_VERSION >= 11070
+
+bool IsDmaBufSupported() {
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11070
+  return ibv::IsDmaBufMrAvailable() && GetHandleForAddressRange() != nullptr;
+#else
+  return false;
+#endif  // WITH_CUDA && CUDA_VERSION >= 11070
+}
+
+bool IsCudaDeviceMem(void* ptr) {
+#ifdef WITH_CUDA
+  // Device memory is registered only with GPUDirect RDMA, do not touch the CUDA runtime
+  // otherwise since it may create a context on the current device.
+  static const bool gpu_direct_rdma_requested =
+      ParseBooleanFromEnv("ONEFLOW_COMM_NET_IB_ENABLE_GPU_DIRECT", false);
+  if (!gpu_direct_rdma_requested) { return false; }
+  cudaPointerAttributes attributes{};
+  if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess) {
+    cudaGetLastError();
+    return false;
+  }
+  return attributes.type == cudaMemoryTypeDevice;
+#else
+  return false;
+#endif  // WITH_CUDA
+}
+
+ibv_mr* RegisterCudaDeviceMem(ibv_pd* pd, void* mem_ptr, size_t byte_size) {
+  if (IsPeerMemLoaded()) { return ibv::wrapper.ibv_reg_mr_wrap(pd, mem_ptr, byte_size, kMrAccess); }
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11070
+  CHECK(IsDmaBufSupported()) << "Neither nvidia-peermem nor dmabuf is available to register "
+                                "CUDA device memory";
+  // The range of a dmabuf must be aligned to host pages, the memory is at `offset` in it.
+  const uint64_t page_size = sysconf(_SC_PAGESIZE);
+  const uint64_t begin = reinterpret_cast<uint64_t>(mem_ptr);
+  const uint64_t aligned_begin = begin / page_size * page_size;
+  const uint64_t aligned_size = RoundUp(begin + byte_size - aligned_begin, page_size);
+  int fd = -1;
+  const CUresult result = GetHandleForAddressRange()(
+      &fd, static_cast<CUdeviceptr>(aligned_begin), aligned_size,
+      CU_MEM_RANGE_HANDLE_TYPE_DMA_BUF_FD, 0);
+  CHECK_EQ(result, CUDA_SUCCESS) << "cuMemGetHandleForAddressRange failed";
+  ibv_mr* mr = ibv::wrapper.ibv_reg_dmabuf_mr_wrap(pd, begin - aligned_begin, byte_size, begin,
+                                                   fd, kMrAccess);
+  // The MR holds its own reference of the dmabuf.
+  PCHECK(close(fd) == 0);
+  return mr;
+#else
+  UNIMPLEMENTED() << "Registering CUDA device memory requires nvidia-peermem";
+  return nullptr;
+#endif  // WITH_CUDA && CUDA_VERSION >= 11070
+}
+
+}  // namespace
+
 IBVerbsMemDesc::IBVerbsMemDesc(ibv_pd* pd, void* mem_ptr, size_t byte_size)
+    : IBVerbsMemDesc(std::vector<ibv_pd*>{pd}, mem_ptr, byte_size) {}
+
+IBVerbsMemDesc::IBVerbsMemDesc(const std::vector<ibv_pd*>& pd_vec, void* mem_ptr,
+                               size_t byte_size)
     : mem_ptr_(mem_ptr), mem_size_(byte_size) {
-  mr_ = ibv::wrapper.ibv_reg_mr_wrap(
-      pd, mem_ptr, byte_size,
-      IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_READ);
-  CHECK(mr_);
+  CHECK(!pd_vec.empty());
+  const bool is_cuda_device_mem = IsCudaDeviceMem(mem_ptr);
+  for (ibv_pd* pd : pd_vec) {
+    ibv_mr* mr = nullptr;
+    if (is_cuda_device_mem) {
+      mr = RegisterCudaDeviceMem(pd, mem_ptr, byte_size);
+    } else {
+      mr = ibv::wrapper.ibv_reg_mr_wrap(pd, mem_ptr, byte_size, kMrAccess);
+    }
+    PCHECK(mr != nullptr);
+    mr_vec_.emplace_back(mr);
+  }
+}
+
+IBVerbsMemDesc::~IBVerbsMemDesc() {
+  for (ibv_mr* mr : mr_vec_) { CHECK_EQ(ibv::wrapper.ibv_dereg_mr(mr), 0); }
 }
 
-IBVerbsMemDesc::~IBVerbsMemDesc() { CHECK_EQ(ibv::wrapper.ibv_dereg_mr(mr_), 0); }
+bool IBVerbsDeviceMemRegistrationSupported() { return IsPeerMemLoaded() || IsDmaBufSupported(); }
 
 }  // namespace oneflow
 
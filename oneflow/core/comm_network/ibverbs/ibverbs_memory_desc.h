@@ -31,20 +31,28 @@ class IBVerbsMemDesc final {
   OF_DISALLOW_COPY_AND_MOVE(IBVerbsMemDesc);
   IBVerbsMemDesc() = delete;
   IBVerbsMemDesc(ibv_pd* pd, void* mem_ptr, size_t byte_size);
+  // Registers the memory with every protection domain in `pd_vec`. CUDA device memory is
+  // registered by nvidia-peermem if it is loaded, by dmabuf otherwise.
+  IBVerbsMemDesc(const std::vector<ibv_pd*>& pd_vec, void* mem_ptr, size_t byte_size);
   ~IBVerbsMemDesc();
 
   void* mem_ptr() const { return mem_ptr_; }
 
   size_t mem_size() const { return mem_size_; }
 
-  const ibv_mr* mr() const { return mr_; }
+  const ibv_mr* mr() const { return mr_vec_.front(); }
+
+  const ibv_mr* mr(size_t pd_index) const { return mr_vec_.at(pd_index); }
 
  private:
-  ibv_mr* mr_;
+  std::vector<ibv_mr*> mr_vec_;
   void* mem_ptr_;
   uint64_t mem_size_;
 };
 
+// Whether CUDA device memory can be registered for RDMA, by nvidia-peermem or dmabuf.
+bool IBVerbsDeviceMemRegistrationSupported();
+
 }  // namespace oneflow
 
 #endif  // WITH_RDMA && OF_PLATFORM_POSIX
@@ -29,6 +29,8 @@ namespace {
 
 constexpr uint32_t kDefaultQueueDepth = 1024;
 constexpr uint64_t kDefaultMemBlockSize = 8388608;  // 8M
+constexpr uint32_t kDefaultMaxInlineData = 256;
+constexpr uint32_t kDefaultMaxSendMsgBatch = 8;
 
 }  // namespace
 
@@ -38,12 +40,19 @@ IBVerbsQP::IBVerbsQP(ibv_context* ctx, ibv_pd* pd, uint8_t port_num, ibv_cq* sen
   ctx_ = ctx;
   pd_ = pd;
   port_num_ = port_num;
+  peer_device_index_ = 0;
   // qp_
   ibv_device_attr device_attr{};
   CHECK_EQ(ibv::wrapper.ibv_query_device(ctx, &device_attr), 0);
   const int64_t user_queue_depth =
       ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_QUEUE_DEPTH", kDefaultQueueDepth);
   const uint32_t queue_depth = std::min<uint32_t>(device_attr.max_qp_wr, user_queue_depth);
+  const int64_t user_max_inline_data =
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_MAX_INLINE_DATA", kDefaultMaxInlineData);
+  const int64_t user_max_send_msg_batch =
+      ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_MAX_SEND_MSG_BATCH", kDefaultMaxSendMsgBatch);
+  CHECK_GE(user_max_inline_data, 0);
+  CHECK_GT(user_max_send_msg_batch, 0);
   ibv_qp_init_attr qp_init_attr{};
   qp_init_attr.qp_context = nullptr;
   qp_init_attr.send_cq = send_cq;
@@ -51,16 +60,30 @@ IBVerbsQP::IBVerbsQP(ibv_context* ctx, ibv_pd* pd, uint8_t port_num, ibv_cq* sen
   qp_init_attr.srq = nullptr;
   qp_init_attr.cap.max_send_wr = queue_depth;
   qp_init_attr.cap.max_recv_wr = queue_depth;
-  qp_init_attr.cap.max_send_sge = 1;
+  // one sge for each message batched in a send
+  qp_init_attr.cap.max_send_sge =
+      std::min<uint32_t>(device_attr.max_sge, static_cast<uint32_t>(user_max_send_msg_batch));
   qp_init_attr.cap.max_recv_sge = 1;
-  qp_init_attr.cap.max_inline_data = 0;
+  qp_init_attr.cap.max_inline_data = user_max_inline_data;
   qp_init_attr.qp_type = IBV_QPT_RC;
   qp_init_attr.sq_sig_all = 1;
   qp_ = ibv::wrapper.ibv_create_qp(pd, &qp_init_attr);
+  if (qp_ == nullptr && qp_init_attr.cap.max_inline_data > 0) {
+    // inline data is optional, some devices reject it
+    qp_init_attr.cap.max_inline_data = 0;
+    qp_ = ibv::wrapper.ibv_create_qp(pd, &qp_init_attr);
+  }
   CHECK(qp_);
+  // ibv_create_qp returns the actual capabilities in qp_init_attr.cap
+  max_inline_data_ = qp_init_attr.cap.max_inline_data;
+  max_send_sge_ = std::max<uint32_t>(qp_init_attr.cap.max_send_sge, 1);
+  max_recv_msg_num_ = user_max_send_msg_batch;
+  max_send_msg_batch_ = 1;
   // recv_msg_buf_
   recv_msg_buf_.assign(queue_depth, nullptr);
-  FOR_RANGE(size_t, i, 0, recv_msg_buf_.size()) { recv_msg_buf_.at(i) = new ActorMsgMR(pd_); }
+  FOR_RANGE(size_t, i, 0, recv_msg_buf_.size()) {
+    recv_msg_buf_.at(i) = new ActorMsgMR(pd_, max_recv_msg_num_);
+  }
   // send_msg_buf_
   CHECK(send_msg_buf_.empty());
   num_outstanding_send_wr_ = 0;
@@ -79,6 +102,8 @@ IBVerbsQP::~IBVerbsQP() {
 }
 
 void IBVerbsQP::Connect(const IBVerbsConnectionInfo& peer_info) {
+  peer_device_index_ = peer_info.device_index();
+  max_send_msg_batch_ = std::min<uint32_t>(max_send_sge_, peer_info.max_recv_msg_num());
   ibv_qp_attr qp_attr{};
 
   // IBV_QPS_INIT
@@ -144,19 +169,18 @@ void IBVerbsQP::PostAllRecvRequest() {
   for (ActorMsgMR* msg_mr : recv_msg_buf_) { PostRecvRequest(msg_mr); }
 }
 
-void IBVerbsQP::PostReadRequest(const IBVerbsCommNetRMADesc& remote_mem,
-                                const IBVerbsMemDesc& local_mem, void* read_id) {
-  CHECK_EQ(remote_mem.mem_size, local_mem.mem_size());
+void IBVerbsQP::PostReadRequest(uint64_t remote_addr, uint32_t rkey, void* local_ptr,
+                                uint32_t lkey, size_t size, IBVerbsReadState* read_state) {
   WorkRequestId* wr_id = NewWorkRequestId();
-  const size_t block_num = RoundUp(remote_mem.mem_size, read_block_size_) / read_block_size_;
+  const size_t block_num = RoundUp(size, read_block_size_) / read_block_size_;
   wr_id->outstanding_sge_cnt = static_cast<int32_t>(block_num);
-  wr_id->read_id = read_id;
+  wr_id->read_state = read_state;
   FOR_RANGE(size_t, i, 0, block_num) {
     ibv_send_wr wr{};
     ibv_sge sge{};
-    sge.addr = reinterpret_cast<uint64_t>(local_mem.mem_ptr()) + i * read_block_size_;
-    sge.length = std::min(read_block_size_, local_mem.mem_size() - i * read_block_size_);
-    sge.lkey = local_mem.mr()->lkey;
+    sge.addr = reinterpret_cast<uint64_t>(local_ptr) + i * read_block_size_;
+    sge.length = std::min(read_block_size_, size - i * read_block_size_);
+    sge.lkey = lkey;
     wr.wr_id = reinterpret_cast<uint64_t>(wr_id);
     wr.next = nullptr;
     wr.sg_list = &sge;
@@ -164,8 +188,8 @@ void IBVerbsQP::PostReadRequest(const IBVerbsCommNetRMADesc& remote_mem,
     wr.opcode = IBV_WR_RDMA_READ;
     wr.send_flags = 0;
     wr.imm_data = 0;
-    wr.wr.rdma.remote_addr = remote_mem.mem_ptr + i * read_block_size_;
-    wr.wr.rdma.rkey = remote_mem.mr_rkey;
+    wr.wr.rdma.remote_addr = remote_addr + i * read_block_size_;
+    wr.wr.rdma.rkey = rkey;
     EnqueuePostSendReadWR(wr, sge);
   }
 }
@@ -185,7 +209,8 @@ void IBVerbsQP::PostSendRequest(const ActorMsg& msg) {
   wr.sg_list = &sge;
   wr.num_sge = 1;
   wr.opcode = IBV_WR_SEND;
-  wr.send_flags = 0;
+  // the device copies inline data when the wr is posted, without reading the buffer by dma
+  wr.send_flags = sge.length <= max_inline_data_ ? IBV_SEND_INLINE : 0;
   wr.imm_data = 0;
   memset(&(wr.wr), 0, sizeof(wr.wr));
   EnqueuePostSendReadWR(wr, sge);
@@ -207,7 +232,11 @@ void IBVerbsQP::ReadDone(WorkRequestId* wr_id) {
   CHECK_GE(wr_id->outstanding_sge_cnt, 1);
   wr_id->outstanding_sge_cnt -= 1;
   if (wr_id->outstanding_sge_cnt == 0) {
-    Global<CommNet>::Get()->ReadDone(wr_id->read_id);
+    IBVerbsReadState* read_state = wr_id->read_state;
+    if (read_state->outstanding_part_cnt.fetch_sub(1) == 1) {
+      Global<CommNet>::Get()->ReadDone(read_state->read_id);
+      delete read_state;
+    }
     DeleteWorkRequestId(wr_id);
   }
   PostPendingSendWR();
@@ -217,15 +246,24 @@ void IBVerbsQP::SendDone(WorkRequestId* wr_id) {
   {
     std::unique_lock<std::mutex> lck(send_msg_buf_mtx_);
     send_msg_buf_.push(wr_id->msg_mr);
+    for (ActorMsgMR* msg_mr : wr_id->batched_msg_mr_vec) { send_msg_buf_.push(msg_mr); }
   }
   DeleteWorkRequestId(wr_id);
   PostPendingSendWR();
 }
 
-void IBVerbsQP::RecvDone(WorkRequestId* wr_id) {
-  auto* ibv_comm_net = dynamic_cast<IBVerbsCommNet*>(Global<CommNet>::Get());
-  CHECK(ibv_comm_net != nullptr);
-  ibv_comm_net->RecvActorMsg(wr_id->msg_mr->msg());
+void IBVerbsQP::RecvDone(WorkRequestId* wr_id, uint32_t byte_len) {
+  CHECK_EQ(byte_len % sizeof(ActorMsg), 0);
+  const size_t msg_num = byte_len / sizeof(ActorMsg);
+  CHECK_GE(msg_num, 1);
+  CHECK_LE(msg_num, wr_id->msg_mr->capacity());
+  if (recv_msg_handler_) {
+    FOR_RANGE(size_t, i, 0, msg_num) { recv_msg_handler_(wr_id->msg_mr->msg(i)); }
+  } else {
+    auto* ibv_comm_net = dynamic_cast<IBVerbsCommNet*>(Global<CommNet>::Get());
+    CHECK(ibv_comm_net != nullptr);
+    FOR_RANGE(size_t, i, 0, msg_num) { ibv_comm_net->RecvActorMsg(wr_id->msg_mr->msg(i)); }
+  }
   PostRecvRequest(wr_id->msg_mr);
   DeleteWorkRequestId(wr_id);
 }
@@ -235,8 +273,26 @@ void IBVerbsQP::PostPendingSendWR() {
   if (pending_send_wr_queue_.empty() == false) {
     std::pair<ibv_send_wr, ibv_sge> ibv_send_wr_sge = std::move(pending_send_wr_queue_.front());
     ibv_send_wr wr = ibv_send_wr_sge.first;
-    wr.sg_list = &ibv_send_wr_sge.second;
     pending_send_wr_queue_.pop();
+    // Messages queued behind a full send queue are batched into one send, one sge for each.
+    std::vector<ibv_sge> sge_vec{ibv_send_wr_sge.second};
+    if (wr.opcode == IBV_WR_SEND) {
+      auto* wr_id = reinterpret_cast<WorkRequestId*>(wr.wr_id);
+      while (sge_vec.size() < max_send_msg_batch_ && pending_send_wr_queue_.empty() == false
+             && pending_send_wr_queue_.front().first.opcode == IBV_WR_SEND) {
+        auto* batched_wr_id =
+            reinterpret_cast<WorkRequestId*>(pending_send_wr_queue_.front().first.wr_id);
+        wr_id->batched_msg_mr_vec.emplace_back(batched_wr_id->msg_mr);
+        DeleteWorkRequestId(batched_wr_id);
+        sge_vec.emplace_back(pending_send_wr_queue_.front().second);
+        pending_send_wr_queue_.pop();
+      }
+      size_t byte_len = 0;
+      for (const ibv_sge& sge : sge_vec) { byte_len += sge.length; }
+      wr.send_flags = byte_len <= max_inline_data_ ? IBV_SEND_INLINE : 0;
+    }
+    wr.sg_list = sge_vec.data();
+    wr.num_sge = static_cast<int>(sge_vec.size());
     ibv_send_wr* bad_wr = nullptr;
     CHECK_EQ(ibv_post_send(qp_, &wr, &bad_wr), 0);
   } else {
@@ -272,7 +328,7 @@ WorkRequestId* IBVerbsQP::NewWorkRequestId() {
   WorkRequestId* wr_id = new WorkRequestId;
   wr_id->qp = this;
   wr_id->outstanding_sge_cnt = 0;
-  wr_id->read_id = nullptr;
+  wr_id->read_state = nullptr;
   wr_id->msg_mr = nullptr;
   return wr_id;
 }
@@ -18,6 +18,8 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/ibverbs/ibverbs_memory_desc.h"
 #include "oneflow/core/lazy/actor/actor_message.h"
+#include <atomic>
+#include <functional>
 
 #if defined(WITH_RDMA) && defined(OF_PLATFORM_POSIX)
 
@@ -27,29 +29,41 @@ class ActorMsgMR final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ActorMsgMR);
   ActorMsgMR() = delete;
-  ActorMsgMR(ibv_pd* pd) { mem_desc_.reset(new IBVerbsMemDesc(pd, &msg_, sizeof(msg_))); }
+  ActorMsgMR(ibv_pd* pd) : ActorMsgMR(pd, 1) {}
+  // Room for `capacity` messages, a receive buffer takes all messages batched in one send.
+  ActorMsgMR(ibv_pd* pd, size_t capacity) : msg_vec_(capacity) {
+    mem_desc_.reset(new IBVerbsMemDesc(pd, msg_vec_.data(), capacity * sizeof(ActorMsg)));
+  }
   ~ActorMsgMR() { mem_desc_.reset(); }
 
-  const ActorMsg& msg() const { return msg_; }
-  void set_msg(const ActorMsg& val) { msg_ = val; }
+  const ActorMsg& msg() const { return msg_vec_.front(); }
+  const ActorMsg& msg(size_t index) const { return msg_vec_.at(index); }
+  size_t capacity() const { return msg_vec_.size(); }
+  void set_msg(const ActorMsg& val) { msg_vec_.front() = val; }
   const IBVerbsMemDesc& mem_desc() const { return *mem_desc_; }
 
  private:
-  ActorMsg msg_;
+  std::vector<ActorMsg> msg_vec_;
   std::unique_ptr<IBVerbsMemDesc> mem_desc_;
 };
 
 class IBVerbsQP;
 
+// A read striped over several QPs, done when the part posted to each of them is done.
+struct IBVerbsReadState {
+  std::atomic<int32_t> outstanding_part_cnt;
+  void* read_id;
+};
+
 struct WorkRequestId {
   IBVerbsQP* qp;
   int32_t outstanding_sge_cnt;
-  void* read_id;
+  IBVerbsReadState* read_state;
   ActorMsgMR* msg_mr;
+  // Buffers of the messages batched after msg_mr in the same send.
+  std::vector<ActorMsgMR*> batched_msg_mr_vec;
 };
 
-struct IBVerbsCommNetRMADesc;
-
 class IBVerbsQP final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(IBVerbsQP);
@@ -57,17 +71,26 @@ class IBVerbsQP final {
   IBVerbsQP(ibv_context*, ibv_pd*, uint8_t port_num, ibv_cq* send_cq, ibv_cq* recv_cq);
   ~IBVerbsQP();
 
+  using RecvMsgHandler = std::function<void(const ActorMsg&)>;
+
   uint32_t qp_num() const { return qp_->qp_num; }
+  // Number of messages a receive buffer holds, the peer batches at most that many in a send.
+  uint32_t max_recv_msg_num() const { return max_recv_msg_num_; }
+  // Index of the device of the peer QP, valid after Connect().
+  uint32_t peer_device_index() const { return peer_device_index_; }
   void Connect(const IBVerbsConnectionInfo& peer_info);
   void PostAllRecvRequest();
 
-  void PostReadRequest(const IBVerbsCommNetRMADesc& remote_mem, const IBVerbsMemDesc& local_mem,
-                       void* read_id);
+  // Reads `size` bytes as one part of `read_state`.
+  void PostReadRequest(uint64_t remote_addr, uint32_t rkey, void* local_ptr, uint32_t lkey,
+                       size_t size, IBVerbsReadState* read_state);
   void PostSendRequest(const ActorMsg& msg);
+  // Received messages go to IBVerbsCommNet if no handler is set.
+  void set_recv_msg_handler(RecvMsgHandler handler) { recv_msg_handler_ = std::move(handler); }
 
   void ReadDone(WorkRequestId*);
   void SendDone(WorkRequestId*);
-  void RecvDone(WorkRequestId*);
+  void RecvDone(WorkRequestId*, uint32_t byte_len);
 
  private:
   void EnqueuePostSendReadWR(ibv_send_wr wr, ibv_sge sge);
@@ -80,6 +103,7 @@ class IBVerbsQP final {
   ibv_context* ctx_;
   ibv_pd* pd_;
   uint8_t port_num_;
+  uint32_t peer_device_index_;
   ibv_qp* qp_;
   std::vector<ActorMsgMR*> recv_msg_buf_;
 
@@ -90,6 +114,11 @@ class IBVerbsQP final {
   uint32_t max_outstanding_send_wr_;
   std::queue<std::pair<ibv_send_wr, ibv_sge>> pending_send_wr_queue_;
   size_t read_block_size_;
+  uint32_t max_inline_data_;
+  uint32_t max_send_sge_;
+  uint32_t max_recv_msg_num_;
+  uint32_t max_send_msg_batch_;
+  RecvMsgHandler recv_msg_handler_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,224 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/comm_network/ibverbs/ibverbs_qp.h"
+#include "oneflow/core/platform/include/ibv.h"
+
+// Measures the actor message latency and rate of IBVerbsQP over a loopback connection between
+// two QPs of the same port, with and without inline sends and batching. The records are printed
+// as a json array. Configured through the environment:
+//   ONEFLOW_IBVERBS_QP_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_IBVERBS_QP_BENCHMARK_NUM_MSGS: messages sent to measure the rate, 1048576 by default.
+//   ONEFLOW_IBVERBS_QP_BENCHMARK_NUM_ROUND_TRIPS: round trips to measure the latency, 65536 by
+//     default.
+//   ONEFLOW_COMM_NET_IB_HCA: device used, the first one by default.
+//   ONEFLOW_COMM_NET_IB_GID_INDEX: as for IBVerbsCommNet.
+
+#if defined(WITH_RDMA) && defined(OF_PLATFORM_POSIX)
+
+namespace oneflow {
+
+namespace {
+
+struct LoopbackDevice {
+  ibv_context* context;
+  ibv_pd* pd;
+  ibv_cq* cq;
+  uint8_t port;
+  ibv_port_attr port_attr;
+  ibv_gid gid;
+};
+
+LoopbackDevice OpenDevice() {
+  int num_device = 0;
+  ibv_device** device_list = ibv::wrapper.ibv_get_device_list(&num_device);
+  CHECK_GT(num_device, 0) << "No IB device found";
+  const std::string user_device = GetStringFromEnv("ONEFLOW_COMM_NET_IB_HCA", "");
+  ibv_device* device = nullptr;
+  for (int i = 0; i < num_device; ++i) {
+    if (user_device.empty() || user_device.find(device_list[i]->name) == 0) {
+      device = device_list[i];
+      break;
+    }
+  }
+  CHECK(device != nullptr) << "No IB device match " << user_device;
+  LoopbackDevice ret{};
+  ret.context = ibv::wrapper.ibv_open_device(device);
+  CHECK(ret.context);
+  ibv::wrapper.ibv_free_device_list(device_list);
+  ret.pd = ibv::wrapper.ibv_alloc_pd(ret.context);
+  CHECK(ret.pd);
+  ibv_device_attr device_attr{};
+  CHECK_EQ(ibv::wrapper.ibv_query_device(ret.context, &device_attr), 0);
+  ret.cq = ibv::wrapper.ibv_create_cq(ret.context, device_attr.max_cqe, nullptr, nullptr, 0);
+  CHECK(ret.cq);
+  ret.port = 1;
+  CHECK_EQ(ibv::wrapper.ibv_query_port_wrap(ret.context, ret.port, &ret.port_attr), 0);
+  const int64_t gid_index = ParseIntegerFromEnv("ONEFLOW_COMM_NET_IB_GID_INDEX", 0);
+  CHECK_EQ(ibv::wrapper.ibv_query_gid(ret.context, ret.port, gid_index, &ret.gid), 0);
+  return ret;
+}
+
+void CloseDevice(const LoopbackDevice& device) {
+  CHECK_EQ(ibv::wrapper.ibv_destroy_cq(device.cq), 0);
+  CHECK_EQ(ibv::wrapper.ibv_dealloc_pd(device.pd), 0);
+  CHECK_EQ(ibv::wrapper.ibv_close_device(device.context), 0);
+}
+
+IBVerbsConnectionInfo GetConnectionInfo(const LoopbackDevice& device, const IBVerbsQP& qp) {
+  IBVerbsConnectionInfo conn_info;
+  conn_info.set_lid(device.port_attr.lid);
+  conn_info.set_qp_num(qp.qp_num());
+  conn_info.set_subnet_prefix(device.gid.global.subnet_prefix);
+  conn_info.set_interface_id(device.gid.global.interface_id);
+  conn_info.set_port_num(device.port);
+  conn_info.set_mtu(static_cast<int>(device.port_attr.active_mtu));
+  conn_info.set_max_recv_msg_num(qp.max_recv_msg_num());
+  return conn_info;
+}
+
+// Dispatches completions of both QPs like IBVerbsCommNet::PollCQ.
+void PollCQ(ibv_cq* cq, const std::atomic<bool>* exit_flag) {
+  std::vector<ibv_wc> wc_vec(32);
+  while (!exit_flag->load(std::memory_order_relaxed)) {
+    const int found_wc_num = ibv_poll_cq(cq, wc_vec.size(), wc_vec.data());
+    CHECK_GE(found_wc_num, 0);
+    for (int i = 0; i < found_wc_num; ++i) {
+      const ibv_wc& wc = wc_vec.at(i);
+      CHECK_EQ(wc.status, IBV_WC_SUCCESS) << wc.opcode;
+      auto* wr_id = reinterpret_cast<WorkRequestId*>(wc.wr_id);
+      if (wc.opcode == IBV_WC_SEND) {
+        wr_id->qp->SendDone(wr_id);
+      } else if (wc.opcode == IBV_WC_RECV) {
+        wr_id->qp->RecvDone(wr_id, wc.byte_len);
+      } else {
+        UNIMPLEMENTED();
+      }
+    }
+  }
+}
+
+nlohmann::json Run(const LoopbackDevice& device, int64_t max_inline_data,
+                   int64_t max_send_msg_batch, int64_t num_msgs, int64_t num_round_trips) {
+  // IBVerbsQP reads its configuration from the environment when it is created.
+  CHECK_EQ(setenv("ONEFLOW_COMM_NET_IB_MAX_INLINE_DATA", std::to_string(max_inline_data).c_str(),
+                  1),
+           0);
+  CHECK_EQ(setenv("ONEFLOW_COMM_NET_IB_MAX_SEND_MSG_BATCH",
+                  std::to_string(max_send_msg_batch).c_str(), 1),
+           0);
+  auto* sender = new IBVerbsQP(device.context, device.pd, device.port, device.cq, device.cq);
+  auto* receiver = new IBVerbsQP(device.context, device.pd, device.port, device.cq, device.cq);
+  sender->Connect(GetConnectionInfo(device, *receiver));
+  receiver->Connect(GetConnectionInfo(device, *sender));
+  std::atomic<int64_t> num_received(0);
+  std::atomic<int64_t> num_replied(0);
+  std::atomic<bool> reply(false);
+  receiver->set_recv_msg_handler([&](const ActorMsg& msg) {
+    num_received.fetch_add(1, std::memory_order_relaxed);
+    if (reply.load(std::memory_order_relaxed)) { receiver->PostSendRequest(msg); }
+  });
+  sender->set_recv_msg_handler(
+      [&](const ActorMsg& msg) { num_replied.fetch_add(1, std::memory_order_release); });
+  sender->PostAllRecvRequest();
+  receiver->PostAllRecvRequest();
+  std::atomic<bool> exit_flag(false);
+  std::thread poll_thread(&PollCQ, device.cq, &exit_flag);
+  const ActorMsg msg = ActorMsg::BuildCommandMsg(0, ActorCmd::kStart);
+
+  const auto rate_start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < num_msgs; ++i) { sender->PostSendRequest(msg); }
+  while (num_received.load(std::memory_order_relaxed) < num_msgs) {}
+  const auto rate_end = std::chrono::steady_clock::now();
+
+  reply.store(true);
+  const auto latency_start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < num_round_trips; ++i) {
+    sender->PostSendRequest(msg);
+    while (num_replied.load(std::memory_order_acquire) <= i) {}
+  }
+  const auto latency_end = std::chrono::steady_clock::now();
+
+  // Completions of the last sends may still be in the cq.
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  exit_flag.store(true);
+  poll_thread.join();
+  delete sender;
+  delete receiver;
+
+  nlohmann::json record;
+  record["max_inline_data"] = max_inline_data;
+  record["max_send_msg_batch"] = max_send_msg_batch;
+  record["msg_size"] = sizeof(ActorMsg);
+  record["num_msgs"] = num_msgs;
+  record["msgs_per_second"] =
+      num_msgs / std::chrono::duration<double>(rate_end - rate_start).count();
+  record["round_trip_latency_us"] =
+      std::chrono::duration<double, std::micro>(latency_end - latency_start).count()
+      / num_round_trips;
+  return record;
+}
+
+int Main() {
+  if (!ibv::IsAvailable()) {
+    std::cerr << "libibverbs is not available" << std::endl;
+    return 1;
+  }
+  const int64_t num_msgs = ParseIntegerFromEnv("ONEFLOW_IBVERBS_QP_BENCHMARK_NUM_MSGS", 1 << 20);
+  const int64_t num_round_trips =
+      ParseIntegerFromEnv("ONEFLOW_IBVERBS_QP_BENCHMARK_NUM_ROUND_TRIPS", 1 << 16);
+  const LoopbackDevice device = OpenDevice();
+  std::vector<nlohmann::json> records;
+  for (const int64_t max_inline_data : {0, 256}) {
+    for (const int64_t max_send_msg_batch : {1, 8}) {
+      records.push_back(
+          Run(device, max_inline_data, max_send_msg_batch, num_msgs, num_round_trips));
+    }
+  }
+  CloseDevice(device);
+  const std::string output = GetStringFromEnv("ONEFLOW_IBVERBS_QP_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main() { return oneflow::Main(); }
+
+#else
+
+int main() {
+  std::cerr << "oneflow is built without RDMA" << std::endl;
+  return 0;
+}
+
+#endif  // WITH_RDMA && OF_PLATFORM_POSIX
@@ -0,0 +1,179 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_CROSS_THREAD_OBJ_POOL_H_
+#define ONEFLOW_CORE_COMMON_CROSS_THREAD_OBJ_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "oneflow/core/common/cpp_attribute.h"
+
+namespace oneflow {
+namespace obj_pool {
+
+// Pool of fixed size blocks for objects allocated by one thread and released by another one, like
+// the instruction operands built by the python thread and released by the vm. Each thread
+// allocates from its own pool, see ThreadLocal(). Released blocks are pushed onto a lock-free stack
+// of the pool they come from, which the owner thread takes over as a whole once its own free list
+// runs dry, so neither side takes a lock.
+template<size_t block_size, size_t block_align>
+class CrossThreadBlockPool final {
+ public:
+  CrossThreadBlockPool(const CrossThreadBlockPool&) = delete;
+  CrossThreadBlockPool(CrossThreadBlockPool&&) = delete;
+
+  static CrossThreadBlockPool* ThreadLocal() {
+    static thread_local Owner owner;
+    return owner.pool;
+  }
+
+  void* Allocate() {
+    if (unlikely(free_blocks_.empty())) { ReclaimReturned(); }
+    Header* header = nullptr;
+    if (unlikely(free_blocks_.empty())) {
+      header = static_cast<Header*>(::operator new(sizeof(Header) + block_size));
+      header->pool = this;
+    } else {
+      header = free_blocks_.back();
+      free_blocks_.pop_back();
+    }
+    return header + 1;
+  }
+
+  // May be called by any thread.
+  static void Deallocate(void* ptr) {
+    Header* header = static_cast<Header*>(ptr) - 1;
+    header->pool->Return(header);
+  }
+
+ private:
+  static_assert(block_align <= alignof(std::max_align_t), "over-aligned blocks are not supported");
+
+  struct alignas(block_align > alignof(void*) ? block_align : alignof(void*)) Header final {
+    CrossThreadBlockPool* pool;
+    // link of the stack of blocks returned by other threads.
+    Header* next;
+  };
+
+  // The pool outlives its thread, blocks may still be released after the thread exits. It is
+  // orphaned then, the blocks returned to it are freed from that point on.
+  struct Owner final {
+    Owner() : pool(new CrossThreadBlockPool()) {}
+    ~Owner() { pool->Orphan(); }
+    CrossThreadBlockPool* pool;
+  };
+
+  CrossThreadBlockPool() : returned_(nullptr), orphaned_(false) {
+    free_blocks_.reserve(kInitPoolCap);
+  }
+  ~CrossThreadBlockPool() = delete;
+
+  void Return(Header* header) {
+    Header* head = returned_.load(std::memory_order_relaxed);
+    do { header->next = head; } while (!returned_.compare_exchange_weak(head, header));
+    // Either the owner sees this block when it frees the returned ones, or this thread sees the
+    // pool orphaned.
+    if (unlikely(orphaned_.load())) { FreeReturned(); }
+  }
+
+  void ReclaimReturned() {
+    for (Header* header = returned_.exchange(nullptr); header != nullptr; header = header->next) {
+      free_blocks_.push_back(header);
+    }
+  }
+
+  void FreeReturned() {
+    Header* header = returned_.exchange(nullptr);
+    while (header != nullptr) {
+      Header* next = header->next;
+      ::operator delete(header);
+      header = next;
+    }
+  }
+
+  void Orphan() {
+    orphaned_.store(true);
+    for (Header* header : free_blocks_) { ::operator delete(header); }
+    free_blocks_.clear();
+    free_blocks_.shrink_to_fit();
+    FreeReturned();
+  }
+
+  static constexpr int kInitPoolCap = 1024;
+  std::vector<Header*> free_blocks_;
+  std::atomic<Header*> returned_;
+  std::atomic<bool> orphaned_;
+};
+
+// Allocator serving single objects from the CrossThreadBlockPool of the allocating thread. Classes
+// with private constructors befriend it to be built by obj_pool::make_shared.
+template<typename T>
+class CrossThreadPoolAllocator final {
+ public:
+  using value_type = T;
+
+  CrossThreadPoolAllocator() = default;
+  template<typename U>
+  CrossThreadPoolAllocator(const CrossThreadPoolAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) {
+    if (likely(n == 1)) { return static_cast<T*>(BlockPool::ThreadLocal()->Allocate()); }
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (likely(n == 1)) {
+      BlockPool::Deallocate(ptr);
+    } else {
+      std::allocator<T>().deallocate(ptr, n);
+    }
+  }
+
+  template<typename U, typename... Args>
+  void construct(U* ptr, Args&&... args) {
+    ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+  }
+
+  template<typename U>
+  void destroy(U* ptr) {
+    ptr->~U();
+  }
+
+ private:
+  using BlockPool = CrossThreadBlockPool<sizeof(T), alignof(T)>;
+};
+
+template<typename T, typename U>
+bool operator==(const CrossThreadPoolAllocator<T>&, const CrossThreadPoolAllocator<U>&) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const CrossThreadPoolAllocator<T>&, const CrossThreadPoolAllocator<U>&) {
+  return false;
+}
+
+// Like std::make_shared, the object and its control block share one pooled block.
+template<typename T, typename... Args>
+std::shared_ptr<T> make_shared(Args&&... args) {
+  return std::allocate_shared<T>(CrossThreadPoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace obj_pool
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_CROSS_THREAD_OBJ_POOL_H_
@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/cross_thread_obj_pool.h"
+
+namespace oneflow {
+namespace obj_pool {
+namespace test {
+
+namespace {
+
+class Foo final {
+ public:
+  explicit Foo(int* num_alive) : num_alive_(num_alive) { ++*num_alive_; }
+  ~Foo() { --*num_alive_; }
+
+ private:
+  int* num_alive_;
+};
+
+class PrivateFoo final {
+ public:
+  int value() const { return value_; }
+
+ private:
+  template<typename T>
+  friend class obj_pool::CrossThreadPoolAllocator;
+  explicit PrivateFoo(int value) : value_(value) {}
+
+  int value_;
+};
+
+TEST(CrossThreadObjPool, recycle) {
+  int num_alive = 0;
+  const Foo* ptr = nullptr;
+  { ptr = obj_pool::make_shared<Foo>(&num_alive).get(); }
+  ASSERT_EQ(num_alive, 0);
+  const auto foo = obj_pool::make_shared<Foo>(&num_alive);
+  ASSERT_EQ(num_alive, 1);
+  ASSERT_EQ(foo.get(), ptr);
+}
+
+TEST(CrossThreadObjPool, return_from_other_thread) {
+  int num_alive = 0;
+  auto foo = obj_pool::make_shared<Foo>(&num_alive);
+  const Foo* ptr = foo.get();
+  std::thread([&]() { foo.reset(); }).join();
+  ASSERT_EQ(num_alive, 0);
+  ASSERT_EQ(obj_pool::make_shared<Foo>(&num_alive).get(), ptr);
+}
+
+TEST(CrossThreadObjPool, return_after_owner_exit) {
+  int num_alive = 0;
+  std::shared_ptr<Foo> foo;
+  std::thread([&]() { foo = obj_pool::make_shared<Foo>(&num_alive); }).join();
+  foo.reset();
+  ASSERT_EQ(num_alive, 0);
+}
+
+TEST(CrossThreadObjPool, private_constructor) {
+  ASSERT_EQ(obj_pool::make_shared<PrivateFoo>(1)->value(), 1);
+}
+
+}  // namespace
+
+}  // namespace test
+}  // namespace obj_pool
+}  // namespace oneflow
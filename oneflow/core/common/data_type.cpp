@@ -99,6 +99,8 @@ size_t GetSizeOfDataType(DataType data_type) {
     case kInt8: return 1;
     case kUInt8: return 1;
     case kBool: return 1;
+    case kFloat8E4M3: return 1;
+    case kFloat8E5M2: return 1;
 
     // 16-bit
     case kInt16: return 2;
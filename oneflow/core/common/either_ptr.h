@@ -70,6 +70,11 @@ class EitherPtr final {
     return Get(tag<T>{});
   }
 
+  template<typename T>
+  std::shared_ptr<T>* Mutable() {
+    return Mutable(tag<T>{});
+  }
+
  private:
   template<typename T, typename Enable = void>
   struct UnionType;
@@ -96,6 +101,17 @@ class EitherPtr final {
     return *ptr;
   }
 
+  XPtr* Mutable(tag<X>) {
+    CHECK(Has<X>());
+    return &x_ptr_;
+  }
+
+  YPtr* Mutable(tag<Y>) {
+    CHECK(Has<Y>());
+    auto* __attribute__((__may_alias__)) ptr = reinterpret_cast<YPtr*>(&x_ptr_);
+    return ptr;
+  }
+
   int8_t type_;
   std::shared_ptr<X> x_ptr_;
 };
@@ -34,7 +34,11 @@ DEFINE_ENV_INTEGER(ONEFLOW_TIMEOUT_SECONDS, 7200);
 DEFINE_ENV_INTEGER(ONEFLOW_CHECK_TIMEOUT_SLEEP_SECONDS, EnvInteger<ONEFLOW_TIMEOUT_SECONDS>());
 
 DEFINE_ENV_INTEGER(ONEFLOW_VM_BLOCKING_DEBUG_INSTRUCTIONS_DISPLAY_LIMIT, 100);
+DEFINE_ENV_INTEGER(ONEFLOW_VM_NUM_CUDA_DEVICES_PER_WORKER_THREAD, 0);
 DEFINE_ENV_INTEGER(ONEFLOW_DELETE_OUTDATED_SHM_NAMES_INTERVAL, 1000);
+DEFINE_ENV_INTEGER(ONEFLOW_SHARED_MEMORY_POOL_MAX_BYTES, 1LL << 30);
+DEFINE_ENV_INTEGER(ONEFLOW_SHARED_MEMORY_POOL_MAX_OPENED, 1024);
+DEFINE_ENV_INTEGER(ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY, 1024);
 
 template<typename env_var>
 int64_t ThreadLocalEnvInteger();
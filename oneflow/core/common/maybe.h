@@ -53,9 +53,14 @@ class Maybe<T, typename std::enable_if<!(std::is_same<T, void>::value || IsScala
   ~Maybe() = default;
 
   bool IsOk() const { return data_or_error_.template Has<T>(); }
-  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() const {
+  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() const& {
     return data_or_error_.template Get<T>();
   }
+  // JUST and CHECK_JUST unwrap temporaries, moving the data out saves a pair of atomic refcount
+  // updates on every successful call.
+  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() && {
+    return std::move(*data_or_error_.template Mutable<T>());
+  }
   std::shared_ptr<cfg::ErrorProto> error() const {
     return data_or_error_.template Get<cfg::ErrorProto>();
   }
@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/util.h"
+
+// Measures what the Maybe results cost along an eager dispatch: every op call goes through a chain
+// of functions returning Maybe (functional api, interpreter, instruction builder, vm), each one
+// unwrapping the result of the next one with JUST. The chains are run for Maybe<void>, for inline
+// scalars and for shared data, the latter unwrapped both by JUST, which moves the data out of the
+// temporary, and by copying it. The ns per op call are printed as a json array.
+// Configured through the environment:
+//   ONEFLOW_MAYBE_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_MAYBE_BENCHMARK_NUM_CALLS: op calls per case, 10000000 by default.
+//   ONEFLOW_MAYBE_BENCHMARK_DEPTH: functions returning Maybe per op call, 8 by default.
+
+namespace oneflow {
+
+namespace {
+
+struct Payload final {
+  int64_t value;
+};
+
+__attribute__((noinline)) Maybe<void> VoidChain(int64_t depth, int64_t* sum) {
+  if (depth == 0) {
+    *sum += 1;
+    return Maybe<void>::Ok();
+  }
+  JUST(VoidChain(depth - 1, sum));
+  return Maybe<void>::Ok();
+}
+
+__attribute__((noinline)) Maybe<int64_t> ScalarChain(int64_t depth) {
+  if (depth == 0) { return 1; }
+  return JUST(ScalarChain(depth - 1));
+}
+
+__attribute__((noinline)) Maybe<Payload> SharedChain(int64_t depth,
+                                                     const std::shared_ptr<Payload>& payload) {
+  if (depth == 0) { return payload; }
+  return JUST(SharedChain(depth - 1, payload));
+}
+
+__attribute__((noinline)) Maybe<Payload> SharedCopyChain(int64_t depth,
+                                                         const std::shared_ptr<Payload>& payload) {
+  if (depth == 0) { return payload; }
+  const auto& maybe = SharedCopyChain(depth - 1, payload);
+  if (!maybe.IsOk()) { return maybe.error(); }
+  return maybe.Data_YouAreNotAllowedToCallThisFuncOutsideThisFile();
+}
+
+__attribute__((noinline)) Maybe<Payload> AllocatingChain(int64_t depth) {
+  if (depth == 0) { return Payload{1}; }
+  return *JUST(AllocatingChain(depth - 1));
+}
+
+template<typename F>
+double NsPerCall(int64_t num_calls, const F& Call) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < num_calls; ++i) { Call(); }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / num_calls;
+}
+
+int Main() {
+  const int64_t num_calls = ParseIntegerFromEnv("ONEFLOW_MAYBE_BENCHMARK_NUM_CALLS", 10000000);
+  const int64_t depth = ParseIntegerFromEnv("ONEFLOW_MAYBE_BENCHMARK_DEPTH", 8);
+  const auto payload = std::make_shared<Payload>(Payload{1});
+  int64_t sum = 0;
+  std::vector<nlohmann::json> records;
+  const auto Record = [&](const std::string& name, double ns_per_call) {
+    nlohmann::json record;
+    record["case"] = name;
+    record["depth"] = depth;
+    record["num_calls"] = num_calls;
+    record["ns_per_call"] = ns_per_call;
+    records.push_back(record);
+  };
+  Record("void", NsPerCall(num_calls, [&]() { CHECK_JUST(VoidChain(depth, &sum)); }));
+  Record("scalar", NsPerCall(num_calls, [&]() { sum += CHECK_JUST(ScalarChain(depth)); }));
+  Record("shared_moved", NsPerCall(num_calls, [&]() {
+           sum += CHECK_JUST(SharedChain(depth, payload))->value;
+         }));
+  Record("shared_copied", NsPerCall(num_calls, [&]() {
+           sum += CHECK_JUST(SharedCopyChain(depth, payload))->value;
+         }));
+  Record("allocating", NsPerCall(num_calls / 10, [&]() {
+           sum += CHECK_JUST(AllocatingChain(depth))->value;
+         }));
+  CHECK_GT(sum, 0);
+  const std::string output = GetStringFromEnv("ONEFLOW_MAYBE_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main() { return oneflow::Main(); }
@@ -69,6 +69,18 @@ TEST(Maybe, CHECK_OK) {
   ASSERT_EXIT(CHECK_OK(g(11)), testing::KilledBySignal(SIGABRT), R"(g\(11\) is not OK)");
 }
 
+TEST(Maybe, JUST_moves_data) {
+  const auto data = std::make_shared<std::string>("data");
+  auto f = [&]() -> Maybe<std::string> { return data; };
+  // Only the data and the unwrapped pointer refer to it, the temporary Maybe holds no reference.
+  auto g = [&]() -> Maybe<long> { return JUST(f()).use_count(); };
+  ASSERT_EQ(CHECK_JUST(g()), 2);
+  ASSERT_EQ(CHECK_JUST(f()).use_count(), 2);
+  const auto& maybe = f();
+  ASSERT_EQ(maybe.Data_YouAreNotAllowedToCallThisFuncOutsideThisFile().get(), data.get());
+  ASSERT_EQ(data.use_count(), 2);
+}
+
 TEST(Maybe, Noncopyable) { Maybe<std::unique_ptr<int>> a{std::make_unique<int>(1)}; }
 
 }  // namespace test
@@ -0,0 +1,255 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// A multi-producer single-consumer channel on a bounded lock-free ring. Every slot carries a
+// sequence number telling whether it is free for the producer of a lap or filled for the consumer,
+// so Send costs a CAS and the consumer never takes a lock while messages keep coming.
+// When the ring is full the messages go to a mutexed overflow queue, which the consumer only
+// drains once the ring is empty so that the order of the messages of each producer is kept.
+// An idle consumer spins for a while before it parks on a condition variable. The spin budget
+// grows when spinning catches a message and shrinks when the consumer has to park anyway.
+// Receive and ReceiveMany must only be called from one thread at a time.
+template<typename T>
+class MpscRingChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscRingChannel);
+  // `capacity` is rounded up to a power of two.
+  explicit MpscRingChannel(size_t capacity);
+  ~MpscRingChannel() = default;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr int64_t kMinSpinNum = 16;
+  static constexpr int64_t kMaxSpinNum = 16384;
+
+  struct Slot {
+    std::atomic<size_t> seq;
+    T item;
+  };
+
+  template<typename U>
+  bool TryPushRing(U&& item);
+  bool TryPopRing(T* item);
+  bool IsEmpty() const;
+  void WakeUpConsumer();
+  // Hands up to `max_num` items to `Consume` if any, the ring before the overflow queue.
+  template<typename ConsumeT>
+  size_t TryReceive(size_t max_num, const ConsumeT& Consume);
+  // Blocks until an item comes or the channel is closed.
+  void Wait();
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+  alignas(kCacheLineSize) size_t head_;
+  int64_t spin_num_;
+  std::queue<T> overflow_items_;
+  alignas(kCacheLineSize) std::atomic<size_t> overflow_size_;
+  std::mutex overflow_mutex_;
+  std::atomic<bool> sleeping_;
+  std::atomic<bool> is_closed_;
+  std::mutex park_mutex_;
+  std::condition_variable park_cond_;
+};
+
+template<typename T>
+MpscRingChannel<T>::MpscRingChannel(size_t capacity)
+    : tail_(0),
+      head_(0),
+      spin_num_(kMinSpinNum),
+      overflow_size_(0),
+      sleeping_(false),
+      is_closed_(false) {
+  size_t size = 1;
+  while (size < capacity) { size <<= 1; }
+  mask_ = size - 1;
+  slots_.reset(new Slot[size]);
+  for (size_t i = 0; i < size; ++i) { slots_[i].seq.store(i, std::memory_order_relaxed); }
+}
+
+template<typename T>
+template<typename U>
+bool MpscRingChannel<T>::TryPushRing(U&& item) {
+  size_t pos = tail_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos & mask_];
+    const size_t seq = slot->seq.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      // Sequentially consistent, see WakeUpConsumer().
+      if (tail_.compare_exchange_weak(pos, pos + 1)) {
+        slot->item = std::forward<U>(item);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The slot is still filled by the last lap.
+      return false;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template<typename T>
+bool MpscRingChannel<T>::TryPopRing(T* item) {
+  Slot* slot = &slots_[head_ & mask_];
+  if (slot->seq.load(std::memory_order_acquire) != head_ + 1) { return false; }
+  *item = std::move(slot->item);
+  slot->seq.store(head_ + mask_ + 1, std::memory_order_release);
+  ++head_;
+  return true;
+}
+
+template<typename T>
+bool MpscRingChannel<T>::IsEmpty() const {
+  return tail_.load() == head_ && overflow_size_.load() == 0;
+}
+
+template<typename T>
+void MpscRingChannel<T>::WakeUpConsumer() {
+  // The tail or the overflow size was updated before with sequential consistency, just like
+  // sleeping_ in Wait(). So either the consumer sees the item or the producer sees the consumer
+  // sleeping. Only the first producer seeing it pays for the notification.
+  if (sleeping_.load() && sleeping_.exchange(false)) {
+    // Once the lock is got the consumer is either waiting or about to see the item.
+    { std::unique_lock<std::mutex> lock(park_mutex_); }
+    park_cond_.notify_one();
+  }
+}
+
+template<typename T>
+template<typename U>
+ChannelStatus MpscRingChannel<T>::Send(U&& item) {
+  if (is_closed_.load(std::memory_order_relaxed)) { return kChannelStatusErrorClosed; }
+  // Once some items overflowed, the following ones have to queue up behind them.
+  if (overflow_size_.load(std::memory_order_acquire) != 0 || !TryPushRing(std::forward<U>(item))) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    overflow_items_.push(std::forward<U>(item));
+    overflow_size_.store(overflow_items_.size());
+  }
+  WakeUpConsumer();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+template<typename ConsumeT>
+size_t MpscRingChannel<T>::TryReceive(size_t max_num, const ConsumeT& Consume) {
+  size_t num = 0;
+  T item;
+  while (num < max_num && TryPopRing(&item)) {
+    Consume(std::move(item));
+    ++num;
+  }
+  // A slot claimed by a producer but not filled yet keeps the overflow queue waiting, its item
+  // may have been sent before the overflowed ones.
+  if (num < max_num && overflow_size_.load(std::memory_order_acquire) != 0
+      && tail_.load(std::memory_order_acquire) == head_) {
+    std::unique_lock<std::mutex> lock(overflow_mutex_);
+    while (num < max_num && !overflow_items_.empty()) {
+      Consume(std::move(overflow_items_.front()));
+      overflow_items_.pop();
+      ++num;
+    }
+    overflow_size_.store(overflow_items_.size(), std::memory_order_release);
+  }
+  return num;
+}
+
+template<typename T>
+void MpscRingChannel<T>::Wait() {
+  // Spinning only delays the producers if they have no other core to run on.
+  static const bool spin_enabled = std::thread::hardware_concurrency() > 1;
+  for (int64_t i = 0; spin_enabled && i < spin_num_; ++i) {
+    if (!IsEmpty() || is_closed_.load(std::memory_order_relaxed)) {
+      spin_num_ = std::min(spin_num_ * 2, kMaxSpinNum);
+      return;
+    }
+    CpuRelax();
+  }
+  spin_num_ = std::max(spin_num_ / 2, kMinSpinNum);
+  std::unique_lock<std::mutex> lock(park_mutex_);
+  while (true) {
+    // Set again after every wake up, a producer notifying late may have cleared it.
+    sleeping_.store(true);
+    if (!IsEmpty() || is_closed_.load()) { break; }
+    park_cond_.wait(lock);
+  }
+  sleeping_.store(false);
+}
+
+template<typename T>
+ChannelStatus MpscRingChannel<T>::Receive(T* item) {
+  while (TryReceive(1, [item](T&& received) { *item = std::move(received); }) == 0) {
+    if (is_closed_.load() && IsEmpty()) { return kChannelStatusErrorClosed; }
+    Wait();
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus MpscRingChannel<T>::ReceiveMany(std::queue<T>* items) {
+  while (TryReceive(capacity(), [items](T&& received) { items->push(std::move(received)); })
+         == 0) {
+    if (is_closed_.load() && IsEmpty()) { return kChannelStatusErrorClosed; }
+    Wait();
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscRingChannel<T>::Close() {
+  is_closed_.store(true);
+  std::unique_lock<std::mutex> lock(park_mutex_);
+  park_cond_.notify_all();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_RING_CHANNEL_H_
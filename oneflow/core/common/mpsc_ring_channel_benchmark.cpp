@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_ring_channel.h"
+#include "oneflow/core/common/util.h"
+
+// Compares Channel and MpscRingChannel under the access pattern of the actor threads: several
+// producers send messages one by one while a single consumer drains them with ReceiveMany. The
+// round trip latency of a message bounced between two threads is measured as well. The records
+// are printed as a json array.
+// Configured through the environment:
+//   ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_NUM_ITEMS: items sent by each producer, 1048576 by
+//     default.
+//   ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_CAPACITY: capacity of the ring, 1024 by default.
+
+namespace oneflow {
+
+namespace {
+
+template<typename ChannelT>
+double RunProducersAndConsumer(ChannelT* channel, int num_producers, int64_t num_items) {
+  const int64_t total_items = num_producers * num_items;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([channel, num_items]() {
+      for (int64_t i = 0; i < num_items; ++i) { CHECK_EQ(channel->Send(i), kChannelStatusSuccess); }
+    });
+  }
+  std::queue<int64_t> items;
+  int64_t received = 0;
+  while (received < total_items) {
+    CHECK_EQ(channel->ReceiveMany(&items), kChannelStatusSuccess);
+    received += items.size();
+    items = std::queue<int64_t>();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  for (auto& producer : producers) { producer.join(); }
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  return total_items / seconds;
+}
+
+// Returns the mean round trip time in nanoseconds.
+template<typename ChannelT>
+double RunPingPong(ChannelT* ping, ChannelT* pong, int64_t num_round_trips) {
+  std::thread echo([&]() {
+    int64_t item = 0;
+    for (int64_t i = 0; i < num_round_trips; ++i) {
+      CHECK_EQ(ping->Receive(&item), kChannelStatusSuccess);
+      CHECK_EQ(pong->Send(item), kChannelStatusSuccess);
+    }
+  });
+  const auto start = std::chrono::steady_clock::now();
+  int64_t item = 0;
+  for (int64_t i = 0; i < num_round_trips; ++i) {
+    CHECK_EQ(ping->Send(i), kChannelStatusSuccess);
+    CHECK_EQ(pong->Receive(&item), kChannelStatusSuccess);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  echo.join();
+  return std::chrono::duration<double, std::nano>(end - start).count() / num_round_trips;
+}
+
+int Main() {
+  const int64_t num_items =
+      ParseIntegerFromEnv("ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_NUM_ITEMS", 1 << 20);
+  const int64_t capacity =
+      ParseIntegerFromEnv("ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_CAPACITY", 1024);
+  const int max_producers =
+      std::max<int>(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+  std::vector<nlohmann::json> records;
+  {
+    nlohmann::json record;
+    record["num_round_trips"] = num_items / 16;
+    Channel<int64_t> ping;
+    Channel<int64_t> pong;
+    record["channel_round_trip_ns"] = RunPingPong(&ping, &pong, num_items / 16);
+    MpscRingChannel<int64_t> ring_ping(capacity);
+    MpscRingChannel<int64_t> ring_pong(capacity);
+    record["mpsc_ring_channel_round_trip_ns"] =
+        RunPingPong(&ring_ping, &ring_pong, num_items / 16);
+    records.push_back(record);
+  }
+  for (int num_producers = 1; num_producers <= max_producers; num_producers *= 2) {
+    nlohmann::json record;
+    record["num_producers"] = num_producers;
+    record["num_items_per_producer"] = num_items;
+    record["capacity"] = capacity;
+    {
+      Channel<int64_t> channel;
+      record["channel_items_per_second"] =
+          RunProducersAndConsumer(&channel, num_producers, num_items);
+    }
+    {
+      MpscRingChannel<int64_t> channel(capacity);
+      record["mpsc_ring_channel_items_per_second"] =
+          RunProducersAndConsumer(&channel, num_producers, num_items);
+    }
+    records.push_back(record);
+  }
+  const std::string output = GetStringFromEnv("ONEFLOW_MPSC_RING_CHANNEL_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main() { return oneflow::Main(); }
@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/mpsc_ring_channel.h"
+
+namespace oneflow {
+
+namespace {
+
+void TestPerProducerOrder(size_t capacity, int producer_num, int64_t item_num) {
+  MpscRingChannel<std::pair<int, int64_t>> channel(capacity);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producer_num; ++p) {
+    producers.emplace_back([&channel, p, item_num]() {
+      for (int64_t i = 0; i < item_num; ++i) {
+        ASSERT_EQ(channel.Send(std::make_pair(p, i)), kChannelStatusSuccess);
+      }
+    });
+  }
+  std::vector<int64_t> next(producer_num, 0);
+  std::queue<std::pair<int, int64_t>> items;
+  int64_t received = 0;
+  while (received < producer_num * item_num) {
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+    while (!items.empty()) {
+      ASSERT_EQ(items.front().second, next.at(items.front().first));
+      ++next.at(items.front().first);
+      items.pop();
+      ++received;
+    }
+  }
+  for (std::thread& producer : producers) { producer.join(); }
+  for (int p = 0; p < producer_num; ++p) { ASSERT_EQ(next.at(p), item_num); }
+}
+
+}  // namespace
+
+TEST(MpscRingChannel, capacity) {
+  ASSERT_EQ(MpscRingChannel<int>(1).capacity(), 1);
+  ASSERT_EQ(MpscRingChannel<int>(1000).capacity(), 1024);
+  ASSERT_EQ(MpscRingChannel<int>(1024).capacity(), 1024);
+}
+
+TEST(MpscRingChannel, single_thread) {
+  MpscRingChannel<int> channel(4);
+  for (int i = 0; i < 10; ++i) { ASSERT_EQ(channel.Send(i), kChannelStatusSuccess); }
+  for (int i = 0; i < 10; ++i) {
+    int item = -1;
+    ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+    ASSERT_EQ(item, i);
+  }
+}
+
+TEST(MpscRingChannel, per_producer_order) { TestPerProducerOrder(1024, 8, 100000); }
+
+TEST(MpscRingChannel, per_producer_order_with_overflow) { TestPerProducerOrder(4, 8, 100000); }
+
+TEST(MpscRingChannel, close) {
+  MpscRingChannel<int> channel(8);
+  ASSERT_EQ(channel.Send(1), kChannelStatusSuccess);
+  std::thread closer([&channel]() { channel.Close(); });
+  closer.join();
+  ASSERT_EQ(channel.Send(2), kChannelStatusErrorClosed);
+  int item = -1;
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+  ASSERT_EQ(item, 1);
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusErrorClosed);
+}
+
+TEST(MpscRingChannel, close_wakes_up_consumer) {
+  MpscRingChannel<int> channel(8);
+  std::thread consumer([&channel]() {
+    std::queue<int> items;
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  channel.Close();
+  consumer.join();
+}
+
+}  // namespace oneflow
@@ -68,18 +68,23 @@ struct IsScalarType<Symbol<T>> final {
   static const bool value = true;
 };
 
+// Symbols are interned in a table sharded by hash, each shard with its own mutex, behind a
+// thread local cache that serves the lookups of a thread without any lock after the first one.
 template<typename T>
 struct SymbolUtil final {
   using SymbolMap = std::unordered_map<HashEqTraitPtr<const T>, std::shared_ptr<const T>>;
 
-  static SymbolMap* GlobalSymbolMap() {
-    static SymbolMap symbol_map;
-    return &symbol_map;
-  }
+  static constexpr size_t kNumShards = 64;
+
+  struct SymbolMapShard final {
+    std::mutex mutex;
+    SymbolMap symbol_map;
+  };
 
-  static std::mutex* GlobalSymbolMapMutex() {
-    static std::mutex mutex;
-    return &mutex;
+  static SymbolMapShard* GlobalSymbolMapShard(size_t hash_value) {
+    static SymbolMapShard shards[kNumShards];
+    // Mix the high bits in, some hash functions leave the low ones poorly distributed.
+    return &shards[(hash_value ^ (hash_value >> 17) ^ (hash_value >> 31)) % kNumShards];
   }
 
   static SymbolMap* ThreadLocalSymbolMap() {
@@ -92,37 +97,44 @@ struct SymbolUtil final {
     return &thread_local_symbol_ptr_set;
   }
 
-  template<typename SymbolMap::iterator (*GetIter4ObjectAndHashValue)(const T&, size_t)>
+  template<std::shared_ptr<const T> (*GetGlobalSymbol4ObjectAndHashValue)(const T&, size_t)>
   static const std::shared_ptr<const T>& LocalThreadGetOr(const T& obj) {
     auto* thread_local_symbol_map = ThreadLocalSymbolMap();
     size_t hash_value = std::hash<T>()(obj);
     HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
     const auto& local_iter = thread_local_symbol_map->find(obj_ptr_wraper);
     if (local_iter != thread_local_symbol_map->end()) { return local_iter->second; }
-    const auto& iter = GetIter4ObjectAndHashValue(obj, hash_value);
-    (*thread_local_symbol_map)[iter->first] = iter->second;
-    CHECK(ThreadLocalSymbolPtrSet()->emplace(iter->second.get()).second);
-    return iter->second;
+    std::shared_ptr<const T> ptr = GetGlobalSymbol4ObjectAndHashValue(obj, hash_value);
+    CHECK(ThreadLocalSymbolPtrSet()->emplace(ptr.get()).second);
+    HashEqTraitPtr<const T> ptr_wraper(ptr.get(), hash_value);
+    return thread_local_symbol_map->emplace(ptr_wraper, std::move(ptr)).first->second;
   }
 
-  static typename SymbolMap::iterator FindGlobalSymbol(const T& obj, size_t hash_value) {
-    HashEqTraitPtr<const T> new_obj_ptr_wraper(&obj, hash_value);
-    auto* symbol_map = GlobalSymbolMap();
-    std::unique_lock<std::mutex> lock(*GlobalSymbolMapMutex());
-    const auto& iter = symbol_map->find(new_obj_ptr_wraper);
-    CHECK(iter != symbol_map->end());
-    return iter;
+  // The shared_ptr is copied under the lock, iterators of the shard are invalidated by the
+  // insertions of other threads.
+  static std::shared_ptr<const T> FindGlobalSymbol(const T& obj, size_t hash_value) {
+    HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
+    auto* shard = GlobalSymbolMapShard(hash_value);
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& iter = shard->symbol_map.find(obj_ptr_wraper);
+    CHECK(iter != shard->symbol_map.end());
+    return iter->second;
   }
 
   static const std::shared_ptr<const T>& SharedFromObject(const T& obj) {
     return LocalThreadGetOr<FindGlobalSymbol>(obj);
   }
 
-  static typename SymbolMap::iterator CreateGlobalSymbol(const T& obj, size_t hash_value) {
+  static std::shared_ptr<const T> CreateGlobalSymbol(const T& obj, size_t hash_value) {
+    HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
+    auto* shard = GlobalSymbolMapShard(hash_value);
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& iter = shard->symbol_map.find(obj_ptr_wraper);
+    if (iter != shard->symbol_map.end()) { return iter->second; }
     std::shared_ptr<const T> ptr(new T(obj));
     HashEqTraitPtr<const T> new_obj_ptr_wraper(ptr.get(), hash_value);
-    std::unique_lock<std::mutex> lock(*GlobalSymbolMapMutex());
-    return GlobalSymbolMap()->emplace(new_obj_ptr_wraper, ptr).first;
+    shard->symbol_map.emplace(new_obj_ptr_wraper, ptr);
+    return ptr;
   }
 
   static const std::shared_ptr<const T>& GetOrCreatePtr(const T& obj) {
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <thread>
 #include "gtest/gtest.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/util.h"
@@ -42,6 +43,26 @@ TEST(Symbol, shared_from_symbol) {
               == SymbolOf(detail::SymObject("SymbolObjectFoo")).shared_from_symbol().get());
 }
 
+TEST(Symbol, intern_from_threads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumObjects = 1000;
+  std::vector<std::vector<const detail::SymObject*>> ptrs(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i, &ptrs]() {
+      for (int j = 0; j < kNumObjects; ++j) {
+        Symbol<detail::SymObject> symbol(detail::SymObject("SymbolObject" + std::to_string(j)));
+        ptrs[i].emplace_back(&*symbol);
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  for (int i = 1; i < kNumThreads; ++i) { ASSERT_EQ(ptrs[i], ptrs[0]); }
+  for (int j = 0; j < kNumObjects; ++j) {
+    ASSERT_EQ(&*SymbolOf(detail::SymObject("SymbolObject" + std::to_string(j))), ptrs[0][j]);
+  }
+}
+
 }  // namespace test
 }  // namespace oneflow
 
@@ -52,7 +52,12 @@ void TensorBufferImpl::Reset(const Shape& shape, DataType dtype) {
   if (dtype == DataType::kInvalidDataType || elem_cnt == 0) { return; }
   CheckTensorBufferDataType(dtype);
 
-  if (shape == shape_ && dtype == data_type_) { return; }
+  // The memory of a view is not writable, so it is never reused.
+  if (is_view()) {
+    DeallocateBuffer();
+  } else if (shape == shape_ && dtype == data_type_) {
+    return;
+  }
 
   shape_ = shape;
   data_type_ = dtype;
@@ -78,6 +83,18 @@ void TensorBufferImpl::Reset() {
   DeallocateBuffer();
 }
 
+void TensorBufferImpl::ResetView(const Shape& shape, DataType dtype, const void* data,
+                                 std::shared_ptr<const void> data_owner) {
+  CheckTensorBufferDataType(dtype);
+  CHECK(data_owner);
+  DeallocateBuffer();
+  shape_ = shape;
+  data_type_ = dtype;
+  buffer_ = const_cast<void*>(data);
+  buffer_size_ = shape.elem_cnt() * GetSizeOfDataType(dtype);
+  data_owner_ = std::move(data_owner);
+}
+
 void TensorBufferImpl::AllocateBuffer(size_t size) {
   CHECK(buffer_ == nullptr);
   buffer_ = MemoryAllocatorImpl::AllocateUnPinnedHostMem(size);
@@ -85,19 +102,30 @@ void TensorBufferImpl::AllocateBuffer(size_t size) {
 }
 
 void TensorBufferImpl::DeallocateBuffer() {
-  if (buffer_) { MemoryAllocatorImpl::DeallocateUnPinnedHostMem(buffer_); }
+  if (data_owner_) {
+    data_owner_.reset();
+  } else if (buffer_) {
+    MemoryAllocatorImpl::DeallocateUnPinnedHostMem(buffer_);
+  }
   buffer_ = nullptr;
   buffer_size_ = 0;
 }
 
+// Rounds up to the smallest capacity of a size class, so TensorBufferPool hands the buffer out
+// again for requests of the same size.
+size_t RoundUpToSizeClass(size_t size) {
+  return TensorBufferPool::Capacity4SizeClass(TensorBufferPool::SizeClass4Request(size));
+}
+
 void TensorBufferImpl::Reserve(size_t new_size) {
   if (new_size > buffer_size_) {
-    size_t growth_size = std::max(new_size, GetTensorBufferGrowthSize(new_size));
+    size_t growth_size =
+        RoundUpToSizeClass(std::max(new_size, GetTensorBufferGrowthSize(new_size)));
     DeallocateBuffer();
     AllocateBuffer(growth_size);
   } else {
-    size_t shrink_size = GetTensorBufferShrinkSize(buffer_size_);
-    if (new_size <= shrink_size) {
+    size_t shrink_size = RoundUpToSizeClass(GetTensorBufferShrinkSize(buffer_size_));
+    if (new_size <= shrink_size && shrink_size < buffer_size_) {
       DeallocateBuffer();
       AllocateBuffer(shrink_size);
     }
@@ -115,11 +143,14 @@ void TensorBufferImpl::Swap(TensorBufferImpl* other) {
   std::swap(buffer_size_, other->buffer_size_);
   std::swap(shape_, other->shape_);
   std::swap(data_type_, other->data_type_);
+  std::swap(data_owner_, other->data_owner_);
 }
 
 }  // namespace detail
 
 TensorBuffer::~TensorBuffer() {
+  // A pooled view would keep the memory it points to alive.
+  if (is_view()) { impl_->Reset(); }
   if (auto* pool = TensorBufferPool::TryGet()) { pool->Deallocate(&impl_); }
 }
 
@@ -147,6 +178,12 @@ void TensorBuffer::Reset(const Shape& shape, DataType dtype) {
   }
 }
 
+void TensorBuffer::ResetView(const Shape& shape, DataType dtype, const void* data,
+                             std::shared_ptr<const void> data_owner) {
+  if (!is_allocated()) { Allocate(Shape(), DataType::kInvalidDataType); }
+  impl_->ResetView(shape, dtype, data, std::move(data_owner));
+}
+
 void TensorBuffer::Reset(const Shape& shape) {
   CHECK(is_allocated()) << "TensorBuffer is not allocated";
   impl_->Reset(shape);
@@ -173,6 +210,7 @@ DataType TensorBuffer::data_type() const {
 
 void* TensorBuffer::raw_data() {
   CHECK(is_allocated()) << "TensorBuffer is not allocated";
+  CHECK(!impl_->is_view()) << "TensorBuffer is a read-only view";
   return impl_->buffer();
 }
 
@@ -209,80 +247,148 @@ size_t GetTensorBufferPoolThreadLocalCacheSize() {
 
 }  // namespace
 
+constexpr size_t kSizeClassesPerPowerOfTwoLog2 = 3;
+constexpr size_t kSizeClassesPerPowerOfTwo = 1 << kSizeClassesPerPowerOfTwoLog2;
+
+size_t TensorBufferPool::SizeClass4Capacity(size_t capacity) {
+  // Capacities below 8 are classes of their own, above that each power of two is split into 8.
+  if (capacity < kSizeClassesPerPowerOfTwo) { return capacity; }
+  const size_t log2 = 63 - __builtin_clzll(capacity);
+  const size_t shift = log2 - kSizeClassesPerPowerOfTwoLog2;
+  return kSizeClassesPerPowerOfTwo * (shift + 1)
+         + ((capacity >> shift) & (kSizeClassesPerPowerOfTwo - 1));
+}
+
+size_t TensorBufferPool::SizeClass4Request(size_t size) {
+  if (size == 0) { return 0; }
+  return std::min(SizeClass4Capacity(size - 1) + 1, kNumSizeClasses - 1);
+}
+
+size_t TensorBufferPool::Capacity4SizeClass(size_t size_class) {
+  if (size_class < kSizeClassesPerPowerOfTwo) { return size_class; }
+  const size_t shift = size_class / kSizeClassesPerPowerOfTwo - 1;
+  const size_t mantissa = kSizeClassesPerPowerOfTwo + size_class % kSizeClassesPerPowerOfTwo;
+  return mantissa << shift;
+}
+
 TensorBufferPool::TensorBufferPool()
     : thread_local_cache_size_(GetTensorBufferPoolThreadLocalCacheSize()),
-      pool_size_(GetTensorBufferPoolSize()) {
-  auto& thread_local_cache = ThreadLocalCache();
-  thread_local_cache.reserve(thread_local_cache_size_);
-  global_free_list_.reserve(pool_size_);
+      pool_size_(GetTensorBufferPoolSize()),
+      global_free_count_(0) {
+  for (auto& list : global_free_lists_) { list.store(nullptr, std::memory_order_relaxed); }
+}
+
+TensorBufferPool::~TensorBufferPool() {
+  for (size_t size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+    detail::TensorBufferImpl* impl = TakeGlobal(size_class);
+    while (impl != nullptr) {
+      detail::TensorBufferImpl* next = impl->next_free_;
+      delete impl;
+      impl = next;
+    }
+  }
+}
+
+bool TensorBufferPool::TryPushGlobal(size_t size_class, detail::TensorBufferImpl* impl) {
+  if (global_free_count_.fetch_add(1, std::memory_order_relaxed)
+      >= pool_size_.load(std::memory_order_relaxed)) {
+    global_free_count_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  auto& head = global_free_lists_.at(size_class);
+  impl->next_free_ = head.load(std::memory_order_relaxed);
+  while (!head.compare_exchange_weak(impl->next_free_, impl, std::memory_order_release,
+                                     std::memory_order_relaxed)) {}
+  return true;
+}
+
+detail::TensorBufferImpl* TensorBufferPool::TakeGlobal(size_t size_class) {
+  auto& head = global_free_lists_.at(size_class);
+  if (head.load(std::memory_order_relaxed) == nullptr) { return nullptr; }
+  detail::TensorBufferImpl* impl = head.exchange(nullptr, std::memory_order_acquire);
+  size_t count = 0;
+  for (detail::TensorBufferImpl* it = impl; it != nullptr; it = it->next_free_) { ++count; }
+  global_free_count_.fetch_sub(count, std::memory_order_relaxed);
+  return impl;
+}
+
+void TensorBufferPool::TrimGlobal() {
+  for (size_t size_class = kNumSizeClasses; size_class > 0; --size_class) {
+    if (global_free_count_.load(std::memory_order_relaxed)
+        <= pool_size_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    detail::TensorBufferImpl* impl = TakeGlobal(size_class - 1);
+    while (impl != nullptr) {
+      detail::TensorBufferImpl* next = impl->next_free_;
+      delete impl;
+      impl = next;
+    }
+  }
 }
 
 void TensorBufferPool::Allocate(ItemT* item, const Shape& shape, DataType dtype) {
   CHECK(!(*item)) << "TensorBuffer is already allocated";
-  auto& thread_local_cache = ThreadLocalCache();
-  if (thread_local_cache.empty() && thread_local_cache_size_ > 0) {
-    std::unique_lock<std::mutex> lck(mtx_);
-    if (!global_free_list_.empty()) {
-      // fetch half of thread_local_cache_size of tensor buffers from global free list
-      size_t fetches = thread_local_cache_size_ / 2;
-      auto begin = global_free_list_.size() >= fetches ? (global_free_list_.end() - fetches)
-                                                       : global_free_list_.begin();
-      for (auto it = begin; it < global_free_list_.end(); ++it) {
-        thread_local_cache.push_back(std::move(*it));
+  const int64_t elem_cnt = shape.elem_cnt();
+  size_t size = 0;
+  if (dtype != DataType::kInvalidDataType && elem_cnt > 0) {
+    // The same size TensorBufferImpl::Reserve allocates for the request.
+    const size_t new_size = elem_cnt * GetSizeOfDataType(dtype);
+    size = std::max(new_size, detail::GetTensorBufferGrowthSize(new_size));
+  }
+  const size_t size_class = SizeClass4Request(size);
+  auto& thread_local_cache = GetThreadLocalCache();
+  ListT& list = thread_local_cache.lists.at(size_class);
+  if (list.empty() && thread_local_cache_size_ > 0) {
+    // Moves the whole global list of the class into the thread local cache, the buffers beyond
+    // its capacity go back.
+    detail::TensorBufferImpl* impl = TakeGlobal(size_class);
+    while (impl != nullptr) {
+      detail::TensorBufferImpl* next = impl->next_free_;
+      impl->next_free_ = nullptr;
+      if (thread_local_cache.size < thread_local_cache_size_) {
+        list.emplace_back(impl);
+        ++thread_local_cache.size;
+      } else if (!TryPushGlobal(size_class, impl)) {
+        delete impl;
       }
-      global_free_list_.erase(begin, global_free_list_.end());
+      impl = next;
     }
   }
 
-  if (thread_local_cache.empty()) {
+  if (list.empty()) {
     item->reset(new detail::TensorBufferImpl(shape, dtype));
   } else {
-    *item = std::move(thread_local_cache.back());
-    thread_local_cache.pop_back();
+    *item = std::move(list.back());
+    list.pop_back();
+    --thread_local_cache.size;
     (*item)->Reset(shape, dtype);
   }
 }
 
 void TensorBufferPool::Deallocate(ItemT* item) {
   if (!(*item)) { return; }
-  auto& thread_local_cache = ThreadLocalCache();
-  if (thread_local_cache.size() < thread_local_cache_size_) {
-    thread_local_cache.push_back(std::move(*item));
+  const size_t size_class = SizeClass4Capacity((*item)->buffer_size());
+  auto& thread_local_cache = GetThreadLocalCache();
+  if (thread_local_cache.size < thread_local_cache_size_) {
+    thread_local_cache.lists.at(size_class).push_back(std::move(*item));
+    ++thread_local_cache.size;
   } else {
-    size_t releases = thread_local_cache.size() / 2;
-    {
-      std::unique_lock<std::mutex> lck(mtx_);
-      if (global_free_list_.size() < pool_size_) {
-        global_free_list_.push_back(std::move(*item));
-        // release half of tensor buffers in thread local cache back to global free list
-        while (global_free_list_.size() < pool_size_ && releases > 0) {
-          global_free_list_.push_back(std::move(thread_local_cache.back()));
-          thread_local_cache.pop_back();
-          releases--;
-        }
-      }
-    }
-    // global free list is also full, release half of thread local cache
-    thread_local_cache.resize(thread_local_cache.size() - releases);
+    detail::TensorBufferImpl* impl = item->release();
+    if (!TryPushGlobal(size_class, impl)) { delete impl; }
   }
-  if (*item) { item->reset(); }
 }
 
 void TensorBufferPool::IncreasePoolSizeByBase(size_t base) {
-  std::unique_lock<std::mutex> lck(mtx_);
-  pool_size_ += GetTensorBufferPoolSize(base);
-  if (pool_size_ > global_free_list_.capacity()) { global_free_list_.reserve(pool_size_); }
-  if (pool_size_ < global_free_list_.size()) { global_free_list_.resize(pool_size_); }
+  pool_size_.fetch_add(GetTensorBufferPoolSize(base), std::memory_order_relaxed);
 }
 
 void TensorBufferPool::DecreasePoolSizeByBase(size_t base) {
-  std::unique_lock<std::mutex> lck(mtx_);
-  size_t dec = GetTensorBufferPoolSize(base);
-  CHECK_GE(pool_size_, dec) << "pool_size " << pool_size_ << " decreased by " << dec
-                            << " would be negative";
-  pool_size_ -= dec;
-  if (pool_size_ > global_free_list_.capacity()) { global_free_list_.reserve(pool_size_); }
-  if (pool_size_ < global_free_list_.size()) { global_free_list_.resize(pool_size_); }
+  const size_t dec = GetTensorBufferPoolSize(base);
+  const size_t pool_size = pool_size_.fetch_sub(dec, std::memory_order_relaxed);
+  CHECK_GE(pool_size, dec) << "pool_size " << pool_size << " decreased by " << dec
+                           << " would be negative";
+  TrimGlobal();
 }
 
 }  // namespace oneflow
@@ -19,9 +19,13 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/common/data_type.h"
+#include <array>
+#include <atomic>
 
 namespace oneflow {
 
+class TensorBufferPool;
+
 namespace detail {
 
 class TensorBufferImpl final {
@@ -30,9 +34,14 @@ class TensorBufferImpl final {
       : shape_(Shape()),
         data_type_(DataType::kInvalidDataType),
         buffer_(nullptr),
-        buffer_size_(0) {}
+        buffer_size_(0),
+        next_free_(nullptr) {}
   TensorBufferImpl(const Shape& shape, DataType dtype)
-      : shape_(Shape()), data_type_(DataType::kInvalidDataType), buffer_(nullptr), buffer_size_(0) {
+      : shape_(Shape()),
+        data_type_(DataType::kInvalidDataType),
+        buffer_(nullptr),
+        buffer_size_(0),
+        next_free_(nullptr) {
     Reset(shape, dtype);
   }
   ~TensorBufferImpl() { DeallocateBuffer(); }
@@ -42,6 +51,8 @@ class TensorBufferImpl final {
   void Reset(const Shape& shape);
   void Reset(DataType dtype);
   void Reset();
+  void ResetView(const Shape& shape, DataType dtype, const void* data,
+                 std::shared_ptr<const void> data_owner);
 
   void CopyFrom(const TensorBufferImpl* src);
   void Swap(TensorBufferImpl* other);
@@ -52,6 +63,7 @@ class TensorBufferImpl final {
   void* buffer() { return buffer_; }
   const void* buffer() const { return buffer_; }
   size_t buffer_size() const { return buffer_size_; }
+  bool is_view() const { return bool(data_owner_); }
 
  private:
   void AllocateBuffer(size_t size);
@@ -63,6 +75,12 @@ class TensorBufferImpl final {
 
   void* buffer_;
   size_t buffer_size_;
+  // Keeps the memory of a view alive, empty if buffer_ is owned.
+  std::shared_ptr<const void> data_owner_;
+
+  friend class oneflow::TensorBufferPool;
+  // Links the free lists of TensorBufferPool.
+  TensorBufferImpl* next_free_;
 };
 
 }  // namespace detail
@@ -94,6 +112,12 @@ class TensorBuffer final {
   // backward compatible interface and will be deprecated in future
   void Resize(const Shape& shape, DataType dtype) { Reset(shape, dtype); }
 
+  // Makes the buffer a read-only view of data, which is kept alive by data_owner as long as the
+  // view exists. Resetting the shape or the data type detaches the view into owned memory.
+  void ResetView(const Shape& shape, DataType dtype, const void* data,
+                 std::shared_ptr<const void> data_owner);
+  bool is_view() const { return is_allocated() && impl_->is_view(); }
+
   void CopyFrom(const TensorBuffer& src);
   void Swap(TensorBuffer& other);
 
@@ -129,6 +153,11 @@ inline TensorBuffer GetTypeByDataType(std::integral_constant<DataType, DataType:
   return {};
 }
 
+// Recycles TensorBufferImpls along with their memory. Free buffers are bucketed by capacity
+// into size classes, 8 per power of two, and a buffer is only handed out for requests of its
+// class, so it fits without being reallocated. Each thread caches up to
+// ONEFLOW_TENSOR_BUFFER_POOL_THREAD_LOCAL_CACHE_SIZE buffers. Beyond that they go to global
+// lock-free free lists, up to the pool size, and the rest is freed.
 class TensorBufferPool final {
  public:
   using ItemT = std::unique_ptr<detail::TensorBufferImpl>;
@@ -156,7 +185,7 @@ class TensorBufferPool final {
     if (ptr) { ptr.reset(); }
   }
 
-  ~TensorBufferPool() = default;
+  ~TensorBufferPool();
   OF_DISALLOW_COPY_AND_MOVE(TensorBufferPool);
 
   void Allocate(ItemT* item, const Shape& shape, DataType dtype);
@@ -165,24 +194,44 @@ class TensorBufferPool final {
   void IncreasePoolSizeByBase(size_t base);
   void DecreasePoolSizeByBase(size_t base);
 
+  // The size class of the buffers able to hold size bytes, and the one of a buffer of capacity
+  // bytes. Buffers of class c hold at least the bytes of any request of class c.
+  static size_t SizeClass4Request(size_t size);
+  static size_t SizeClass4Capacity(size_t capacity);
+  // The smallest capacity of the size class.
+  static size_t Capacity4SizeClass(size_t size_class);
+
+  static constexpr size_t kNumSizeClasses = 496;
+
  private:
+  struct ThreadLocalCache {
+    std::array<ListT, kNumSizeClasses> lists;
+    size_t size = 0;
+  };
+
   static std::unique_ptr<TensorBufferPool>& GetPtr() {
     static std::unique_ptr<TensorBufferPool> ptr;
     return ptr;
   }
 
-  static ListT& ThreadLocalCache() {
-    thread_local ListT thread_local_cache;
+  static ThreadLocalCache& GetThreadLocalCache() {
+    thread_local ThreadLocalCache thread_local_cache;
     return thread_local_cache;
   }
 
   TensorBufferPool();
 
-  size_t thread_local_cache_size_;
-  size_t pool_size_;
+  // Threads push single buffers to and take whole lists from the global free lists, neither of
+  // which suffers from the ABA problem of lock-free stacks.
+  bool TryPushGlobal(size_t size_class, detail::TensorBufferImpl* impl);
+  detail::TensorBufferImpl* TakeGlobal(size_t size_class);
+  // Frees global buffers, the largest first, until there are no more than the pool size.
+  void TrimGlobal();
 
-  ListT global_free_list_;
-  std::mutex mtx_;
+  size_t thread_local_cache_size_;
+  std::atomic<size_t> pool_size_;
+  std::atomic<size_t> global_free_count_;
+  std::array<std::atomic<detail::TensorBufferImpl*>, kNumSizeClasses> global_free_lists_;
 };
 
 }  // namespace oneflow
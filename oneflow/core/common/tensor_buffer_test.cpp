@@ -0,0 +1,71 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/common/tensor_buffer.h"
+
+namespace oneflow {
+
+TEST(TensorBuffer, view) {
+  auto owner = std::make_shared<std::vector<char>>(16, 'x');
+  std::weak_ptr<std::vector<char>> weak_owner = owner;
+  {
+    TensorBuffer buffer;
+    buffer.ResetView(Shape({8}), DataType::kChar, owner->data() + 4, owner);
+    owner.reset();
+    ASSERT_TRUE(buffer.is_view());
+    ASSERT_FALSE(weak_owner.expired());
+    ASSERT_EQ(buffer.elem_cnt(), 8);
+    ASSERT_EQ(buffer.data<char>(), weak_owner.lock()->data() + 4);
+
+    TensorBuffer copy;
+    copy.CopyFrom(buffer);
+    ASSERT_FALSE(copy.is_view());
+    ASSERT_EQ(std::string(copy.data<char>(), 8), std::string(8, 'x'));
+
+    buffer.Reset(Shape({8}), DataType::kChar);
+    ASSERT_FALSE(buffer.is_view());
+    ASSERT_TRUE(weak_owner.expired());
+    buffer.mut_data<char>()[0] = 'y';
+  }
+  ASSERT_TRUE(weak_owner.expired());
+}
+
+TEST(TensorBufferPool, size_class) {
+  for (size_t size = 1; size < (1 << 20); size += 97) {
+    const size_t size_class = TensorBufferPool::SizeClass4Request(size);
+    const size_t capacity = TensorBufferPool::Capacity4SizeClass(size_class);
+    ASSERT_GE(capacity, size);
+    ASSERT_EQ(TensorBufferPool::SizeClass4Capacity(capacity), size_class);
+    ASSERT_LT(TensorBufferPool::Capacity4SizeClass(size_class - 1), size);
+  }
+}
+
+TEST(TensorBufferPool, reuse) {
+  TensorBufferPool::New();
+  const void* data = nullptr;
+  {
+    TensorBuffer buffer(Shape({1000}), DataType::kChar);
+    data = buffer.data();
+  }
+  {
+    // Requests of the same size class get the buffer back without reallocating it.
+    TensorBuffer buffer(Shape({900}), DataType::kChar);
+    ASSERT_EQ(buffer.data(), data);
+  }
+  TensorBufferPool::Delete();
+}
+
+}  // namespace oneflow
@@ -102,6 +102,14 @@ void GrpcCtrlClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   rpc_client_.PullMasterKV(k, msg);
 }
 
+void GrpcCtrlClient::BroadcastKV(const std::string& k, int64_t root, std::string* v) {
+  rpc_client_.BroadcastKV(k, root, v);
+}
+
+void GrpcCtrlClient::BroadcastKV(const std::string& k, int64_t root, PbMessage* msg) {
+  rpc_client_.BroadcastKV(k, root, msg);
+}
+
 void GrpcCtrlClient::Clear() { rpc_client_.Clear(); }
 
 int32_t GrpcCtrlClient::IncreaseCount(const std::string& k, int32_t v) {
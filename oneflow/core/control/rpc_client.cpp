@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/control/rpc_client.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 
@@ -45,6 +46,31 @@ class ClientCall final {
   CtrlResponse<ctrl_method> response_;
 };
 
+// Barriers and broadcasts over all ranks go through a tree of this fan-out instead of the master,
+// which bounds the number of requests any single server handles. 0 or 1 disables the tree.
+int64_t CtrlTreeFanout() {
+  static const int64_t fanout = ParseIntegerFromEnv("ONEFLOW_CTRL_TREE_FANOUT", 8);
+  return fanout;
+}
+
+bool UseCtrlTree(size_t num_ranks) { return CtrlTreeFanout() > 1 && num_ranks > 1; }
+
+int64_t CtrlTreeParent(int64_t rank, int64_t root, int64_t num_ranks) {
+  const int64_t rel_rank = (rank - root + num_ranks) % num_ranks;
+  CHECK_GT(rel_rank, 0);
+  return ((rel_rank - 1) / CtrlTreeFanout() + root) % num_ranks;
+}
+
+std::vector<int64_t> CtrlTreeChildren(int64_t rank, int64_t root, int64_t num_ranks) {
+  const int64_t fanout = CtrlTreeFanout();
+  const int64_t rel_rank = (rank - root + num_ranks) % num_ranks;
+  std::vector<int64_t> children;
+  for (int64_t i = rel_rank * fanout + 1; i <= rel_rank * fanout + fanout && i < num_ranks; ++i) {
+    children.push_back((i + root) % num_ranks);
+  }
+  return children;
+}
+
 }  // namespace
 
 void RpcClient::Barrier(const std::string& barrier_name) {
@@ -52,6 +78,10 @@ void RpcClient::Barrier(const std::string& barrier_name) {
 }
 
 void RpcClient::Barrier(const std::string& barrier_name, int32_t barrier_num) {
+  if (barrier_num == static_cast<int32_t>(stubs_.size()) && UseCtrlTree(stubs_.size())) {
+    TreeBarrier(barrier_name);
+    return;
+  }
   ClientCall<CtrlMethod::kBarrier> call;
   call.mut_request()->set_name(barrier_name);
   call.mut_request()->set_num(barrier_num);
@@ -150,6 +180,79 @@ void RpcClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   PullMasterKV(k, [&](const std::string& i) { msg->ParseFromString(i); });
 }
 
+void RpcClient::PushKVToRank(int64_t rank, const std::string& k, const std::string& v) {
+  ClientCall<CtrlMethod::kPushKV> call;
+  call.mut_request()->set_key(k);
+  call.mut_request()->set_val(v);
+  call(GetStubAt(rank));
+}
+
+void RpcClient::PullKVFromRank(int64_t rank, const std::string& k, std::string* v) {
+  ClientCall<CtrlMethod::kPullKV> call;
+  call.mut_request()->set_key(k);
+  call(GetStubAt(rank));
+  *v = call.response().val();
+}
+
+void RpcClient::ClearKVOnRank(int64_t rank, const std::string& k) {
+  ClientCall<CtrlMethod::kClearKV> call;
+  call.mut_request()->set_key(k);
+  call(GetStubAt(rank));
+}
+
+// Every message is pushed onto the server of its receiver, which pulls and clears it there. So
+// no rank waits on a key another rank has to clear, and a barrier name can be reused right away.
+void RpcClient::TreeBarrier(const std::string& barrier_name) {
+  const int64_t rank = GlobalProcessCtx::Rank();
+  const int64_t num_ranks = stubs_.size();
+  const std::string arrive_prefix = "tree_barrier_arrive/" + barrier_name + "/";
+  const std::string release_key = "tree_barrier_release/" + barrier_name;
+  const auto& children = CtrlTreeChildren(rank, 0, num_ranks);
+  std::string unused;
+  for (int64_t child : children) {
+    PullKVFromRank(rank, arrive_prefix + std::to_string(child), &unused);
+    ClearKVOnRank(rank, arrive_prefix + std::to_string(child));
+  }
+  if (rank != 0) {
+    PushKVToRank(CtrlTreeParent(rank, 0, num_ranks), arrive_prefix + std::to_string(rank), "");
+    PullKVFromRank(rank, release_key, &unused);
+    ClearKVOnRank(rank, release_key);
+  }
+  for (int64_t child : children) { PushKVToRank(child, release_key, ""); }
+}
+
+void RpcClient::BroadcastKV(const std::string& k, int64_t root, std::string* v) {
+  const int64_t rank = GlobalProcessCtx::Rank();
+  const int64_t num_ranks = stubs_.size();
+  if (num_ranks == 1) { return; }
+  if (!UseCtrlTree(num_ranks)) {
+    if (rank == root) {
+      PushKVToRank(rank, k, *v);
+      Barrier("broadcast_kv/" + k);
+      ClearKVOnRank(rank, k);
+    } else {
+      PullKVFromRank(root, k, v);
+      Barrier("broadcast_kv/" + k);
+    }
+    return;
+  }
+  const std::string relay_key = "tree_broadcast/" + k;
+  if (rank != root) {
+    PullKVFromRank(rank, relay_key, v);
+    ClearKVOnRank(rank, relay_key);
+  }
+  for (int64_t child : CtrlTreeChildren(rank, root, num_ranks)) {
+    PushKVToRank(child, relay_key, *v);
+  }
+}
+
+void RpcClient::BroadcastKV(const std::string& k, int64_t root, PbMessage* msg) {
+  std::string serialized;
+  if (GlobalProcessCtx::Rank() == root) { msg->SerializeToString(&serialized); }
+  BroadcastKV(k, root, &serialized);
+  if (GlobalProcessCtx::Rank() != root) { msg->ParseFromString(serialized); }
+}
+
 void RpcClient::Clear() {
   ClientCall<CtrlMethod::kClear> call;
   call(GetThisStub());
@@ -59,6 +59,11 @@ class RpcClient {
     *v = oneflow_cast<T>(v_str);
   }
 
+  // Relays the value of `k` held by rank `root` down a tree of ranks, so that the root serves a
+  // few children instead of every rank. `k` must not be broadcast again before all ranks return.
+  void BroadcastKV(const std::string& k, int64_t root, std::string* v);
+  void BroadcastKV(const std::string& k, int64_t root, PbMessage* msg);
+
   void Clear();
 
   int32_t IncreaseCount(const std::string& k, int32_t v);
@@ -76,6 +81,11 @@ class RpcClient {
   void ReserveStubsOfSize(int64_t n) { stubs_.reserve(n); };
   void AddStub(std::unique_ptr<CtrlService::Stub> s) { stubs_.emplace_back(std::move(s)); };
 
+  void PushKVToRank(int64_t rank, const std::string& k, const std::string& v);
+  void PullKVFromRank(int64_t rank, const std::string& k, std::string* v);
+  void ClearKVOnRank(int64_t rank, const std::string& k);
+  void TreeBarrier(const std::string& barrier_name);
+
   std::vector<std::unique_ptr<CtrlService::Stub>> stubs_;
   std::mutex done_names_mtx_;
   HashSet<std::string> done_names_;
@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_CUDA_PHILOX_H_
+#define ONEFLOW_CORE_CUDA_PHILOX_H_
+
+#include <curand_kernel.h>
+#include "oneflow/core/cuda/atomic.cuh"
+#include "oneflow/core/framework/random_generator_impl.h"
+
+namespace oneflow {
+
+namespace cuda {
+
+namespace philox {
+
+// Philox-4x32-10 numbers are a function of (seed, subsequence, offset), so a kernel draws them
+// without any state of its own: each subsequence, usually an element or a pack of elements, starts
+// at the offset of the generator. A kernel advances the offset in the device memory of the
+// generator past the numbers it drew, see AdvanceOffset, which also keeps replays of captured CUDA
+// graphs drawing new numbers. The numbers of an element do not depend on the launch configuration.
+
+using State = curandStatePhilox4_32_10_t;
+
+// Offsets taken by a subsequence drawing one curand_uniform4, curand_normal4,
+// curand_uniform2_double or curand_normal2_double, or less.
+constexpr uint64_t kOffsetIncrement = 4;
+
+__device__ __forceinline__ uint64_t Offset(const one::CUDAGeneratorState* gen_state) {
+  return gen_state == nullptr ? 0 : gen_state->dev_offset;
+}
+
+__device__ __forceinline__ State MakeState(uint64_t seed, uint64_t offset, uint64_t subsequence) {
+  State state;
+  curand_init(seed, subsequence, offset, &state);
+  return state;
+}
+
+// Called by all the threads of every block, after they have read the offset: the last block to
+// get here advances the offset by increment.
+__device__ __forceinline__ void AdvanceOffset(one::CUDAGeneratorState* gen_state,
+                                              uint64_t increment) {
+  if (gen_state == nullptr) { return; }
+  __syncthreads();
+  if (threadIdx.x == 0 && threadIdx.y == 0 && threadIdx.z == 0) {
+    const int32_t num_blocks = gridDim.x * gridDim.y * gridDim.z;
+    if (cuda::atomic::Add(&gen_state->dev_counter, 1) + 1 == num_blocks) {
+      gen_state->dev_counter = 0;
+      gen_state->dev_offset += increment;
+    }
+  }
+}
+
+}  // namespace philox
+
+}  // namespace cuda
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_CUDA_PHILOX_H_
@@ -770,6 +770,49 @@ DispatchLogSoftmax(cudaStream_t stream, LOAD load, STORE store, const int64_t ro
       stream, load, store, rows, cols);
 }
 
+// The implementations DispatchSoftmax and DispatchLogSoftmax choose from by the number of
+// columns, for callers choosing one by measurement instead. The warp implementation only takes
+// up to 1024 columns and the shared memory one rows fitting in shared memory, *success is false
+// when the implementation does not apply and nothing is launched.
+enum SoftmaxImpl {
+  kSoftmaxWarpImpl = 0,
+  kSoftmaxBlockSMemImpl = 1,
+  kSoftmaxBlockUncachedImpl = 2,
+  kNumSoftmaxImpls = 3,
+};
+
+template<typename LOAD, typename STORE, typename ComputeType, Algorithm algorithm>
+inline typename std::enable_if<!std::is_same<ComputeType, double>::value, cudaError_t>::type
+TryDispatchSoftmaxImpl(cudaStream_t stream, LOAD load, STORE store, const int64_t rows,
+                       const int64_t cols, SoftmaxImpl impl, bool* success) {
+  if (impl == kSoftmaxWarpImpl) {
+    *success = cols <= 1024;
+    if (!*success) { return cudaSuccess; }
+    return DispatchSoftmaxWarpImpl<LOAD, STORE, ComputeType, algorithm>(stream, load, store, rows,
+                                                                        cols);
+  } else if (impl == kSoftmaxBlockSMemImpl) {
+    return TryDispatchSoftmaxBlockSMemImpl<LOAD, STORE, ComputeType, algorithm>(
+        stream, load, store, rows, cols, success);
+  } else if (impl == kSoftmaxBlockUncachedImpl) {
+    *success = true;
+    return DispatchSoftmaxBlockUncachedImpl<LOAD, STORE, ComputeType, algorithm>(stream, load,
+                                                                                 store, rows, cols);
+  } else {
+    *success = false;
+    return cudaErrorInvalidValue;
+  }
+}
+
+template<typename LOAD, typename STORE, typename ComputeType, Algorithm algorithm>
+inline typename std::enable_if<std::is_same<ComputeType, double>::value, cudaError_t>::type
+TryDispatchSoftmaxImpl(cudaStream_t stream, LOAD load, STORE store, const int64_t rows,
+                       const int64_t cols, SoftmaxImpl impl, bool* success) {
+  *success = impl == kSoftmaxBlockUncachedImpl;
+  if (!*success) { return cudaSuccess; }
+  return DispatchSoftmaxBlockUncachedImpl<LOAD, STORE, ComputeType, algorithm>(stream, load, store,
+                                                                               rows, cols);
+}
+
 template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename ComputeType, int pack_size,
          int cols_per_thread, int thread_group_width, int rows_per_access, bool padding,
          Algorithm algorithm>
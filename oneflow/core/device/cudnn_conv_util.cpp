@@ -22,6 +22,12 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/common/str_util.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstring>
+#include <fstream>
 
 namespace oneflow {
 
@@ -130,10 +136,97 @@ perf_t GetBestAlgorithm(const CudnnConvArgs& args, CudnnConvResource* res,
   return perf_vec.at(found_algo_idx);
 }
 
+// Layout of a single record of the persistent algo cache file. Records are fixed-size and only
+// ever appended, so several processes may share one file and a torn tail record is skipped.
+constexpr uint32_t kCudnnConvAlgoCacheRecordMagic = 0x4F464341;  // "OFCA"
+constexpr int kCudnnConvAlgoCacheFormatVersion = 1;
+
+enum CudnnConvAlgoCacheRecordKind : uint32_t {
+  kCudnnConvFwdAlgoRecord = 0,
+  kCudnnConvBwdDataAlgoRecord = 1,
+  kCudnnConvBwdFilterAlgoRecord = 2,
+};
+
+struct CudnnConvAlgoCacheRecord {
+  uint32_t magic;
+  uint32_t kind;
+  uint64_t max_ws_size;
+  CudnnConvParams params;
+  int32_t algo;
+  int32_t math_type;
+  int32_t determinism;
+  float time;
+  uint64_t memory;
+};
+
+template<typename perf_t>
+struct CudnnConvAlgoCacheRecordKindOf;
+
+template<>
+struct CudnnConvAlgoCacheRecordKindOf<cudnnConvolutionFwdAlgoPerf_t> {
+  static constexpr uint32_t value = kCudnnConvFwdAlgoRecord;
+};
+
+template<>
+struct CudnnConvAlgoCacheRecordKindOf<cudnnConvolutionBwdDataAlgoPerf_t> {
+  static constexpr uint32_t value = kCudnnConvBwdDataAlgoRecord;
+};
+
+template<>
+struct CudnnConvAlgoCacheRecordKindOf<cudnnConvolutionBwdFilterAlgoPerf_t> {
+  static constexpr uint32_t value = kCudnnConvBwdFilterAlgoRecord;
+};
+
+template<typename perf_t>
+CudnnConvAlgoCacheRecord MakeCudnnConvAlgoCacheRecord(const CudnnConvParams& params_without_ws,
+                                                      size_t max_ws_size, const perf_t& perf) {
+  CudnnConvAlgoCacheRecord record;
+  std::memset(&record, 0, sizeof(record));
+  record.magic = kCudnnConvAlgoCacheRecordMagic;
+  record.kind = CudnnConvAlgoCacheRecordKindOf<perf_t>::value;
+  record.max_ws_size = max_ws_size;
+  record.params = params_without_ws;
+  record.algo = static_cast<int32_t>(perf.algo);
+  record.math_type = static_cast<int32_t>(perf.mathType);
+  record.determinism = static_cast<int32_t>(perf.determinism);
+  record.time = perf.time;
+  record.memory = perf.memory;
+  return record;
+}
+
 template<typename perf_t>
-perf_t CudnnConvAlgoGetOrInfer(const CudnnConvParams& params,
-                               const std::function<perf_t(const CudnnConvParams&)>& InferFn,
-                               CudnnConvAlgoCache::Store<perf_t>* store, std::mutex* mutex) {
+void AddCudnnConvAlgoCacheRecordToStore(const CudnnConvAlgoCacheRecord& record,
+                                        CudnnConvAlgoCache::Store<perf_t>* store) {
+  perf_t perf;
+  std::memset(&perf, 0, sizeof(perf));
+  perf.algo = static_cast<decltype(perf.algo)>(record.algo);
+  perf.status = CUDNN_STATUS_SUCCESS;
+  perf.time = record.time;
+  perf.memory = record.memory;
+  perf.determinism = static_cast<cudnnDeterminism_t>(record.determinism);
+  perf.mathType = static_cast<cudnnMathType_t>(record.math_type);
+  (*store)[record.params].emplace_back(std::make_pair(record.max_ws_size, perf));
+}
+
+std::string GetCudnnConvAlgoCacheFileName() {
+  int device_id = 0;
+  OF_CUDA_CHECK(cudaGetDevice(&device_id));
+  cudaDeviceProp prop{};
+  OF_CUDA_CHECK(cudaGetDeviceProperties(&prop, device_id));
+  std::string gpu_name(prop.name);
+  for (char& c : gpu_name) {
+    if (!std::isalnum(static_cast<unsigned char>(c))) { c = '_'; }
+  }
+  return "cudnn_conv_algo_cache.v" + std::to_string(kCudnnConvAlgoCacheFormatVersion) + "."
+         + gpu_name + ".sm" + std::to_string(prop.major) + std::to_string(prop.minor) + ".cudnn"
+         + std::to_string(cudnnGetVersion()) + ".bin";
+}
+
+template<typename perf_t>
+perf_t CudnnConvAlgoGetOrInfer(
+    const CudnnConvParams& params, const std::function<perf_t(const CudnnConvParams&)>& InferFn,
+    const std::function<void(const CudnnConvParams&, size_t, const perf_t&)>& OnInferred,
+    CudnnConvAlgoCache::Store<perf_t>* store, std::mutex* mutex) {
   const size_t cache_size = Global<ResourceDesc, ForSession>::Get()->thread_local_cache_max_size();
   auto InferWithCache = [&](const CudnnConvParams& p) -> perf_t {
     CudnnConvParams params_without_ws = p;
@@ -153,6 +246,7 @@ perf_t CudnnConvAlgoGetOrInfer(const CudnnConvParams& params,
     }
     perf_t perf = InferFn(p);
     (*store)[params_without_ws].emplace_back(std::make_pair(p.max_ws_size, perf));
+    if (OnInferred) { OnInferred(params_without_ws, p.max_ws_size, perf); }
     return perf;
   };
   return ThreadLocalCachedCall(cache_size, InferWithCache, params);
@@ -160,28 +254,109 @@ perf_t CudnnConvAlgoGetOrInfer(const CudnnConvParams& params,
 
 }  // namespace
 
+void CudnnConvAlgoCache::LoadPersistentStoreOnce() {
+  std::call_once(persistent_store_load_flag_, [&]() {
+    const std::string dir = GetStringFromEnv("ONEFLOW_CUDNN_CONV_ALGO_CACHE_DIR", "");
+    if (dir.empty()) { return; }
+    persistent_store_path_ = JoinPath(dir, GetCudnnConvAlgoCacheFileName());
+    std::ifstream in(persistent_store_path_, std::ios::binary);
+    if (!in.is_open()) { return; }
+    size_t num_loaded = 0;
+    CudnnConvAlgoCacheRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+      if (record.magic != kCudnnConvAlgoCacheRecordMagic) {
+        LOG(WARNING) << "Stop loading corrupted cudnn conv algo cache file "
+                     << persistent_store_path_ << " after " << num_loaded << " records";
+        break;
+      }
+      if (record.kind == kCudnnConvFwdAlgoRecord) {
+        std::unique_lock<std::mutex> lock(fwd_algo_store_mutex_);
+        AddCudnnConvAlgoCacheRecordToStore(record, &fwd_algo_store_);
+      } else if (record.kind == kCudnnConvBwdDataAlgoRecord) {
+        std::unique_lock<std::mutex> lock(bwd_data_algo_store_mutex_);
+        AddCudnnConvAlgoCacheRecordToStore(record, &bwd_data_algo_store_);
+      } else if (record.kind == kCudnnConvBwdFilterAlgoRecord) {
+        std::unique_lock<std::mutex> lock(bwd_filter_algo_cache_mutex_);
+        AddCudnnConvAlgoCacheRecordToStore(record, &bwd_filter_algo_store_);
+      } else {
+        continue;
+      }
+      num_loaded += 1;
+    }
+    VLOG(1) << "Loaded " << num_loaded << " cudnn conv algo records from "
+            << persistent_store_path_;
+  });
+}
+
+template<typename perf_t>
+void CudnnConvAlgoCache::AppendPersistentRecord(const CudnnConvParams& params_without_ws,
+                                                size_t max_ws_size, const perf_t& perf) {
+  if (persistent_store_path_.empty()) { return; }
+  const CudnnConvAlgoCacheRecord record =
+      MakeCudnnConvAlgoCacheRecord(params_without_ws, max_ws_size, perf);
+  std::unique_lock<std::mutex> lock(persistent_store_file_mutex_);
+  // A single O_APPEND write of one record keeps records from concurrent processes intact.
+  const int fd = open(persistent_store_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    PLOG(WARNING) << "Cannot open cudnn conv algo cache file " << persistent_store_path_;
+    return;
+  }
+  const ssize_t written = write(fd, &record, sizeof(record));
+  if (written != static_cast<ssize_t>(sizeof(record))) {
+    PLOG(WARNING) << "Cannot append to cudnn conv algo cache file " << persistent_store_path_;
+  }
+  close(fd);
+}
+
 template<>
 cudnnConvolutionFwdAlgoPerf_t CudnnConvAlgoCache::Remember(
     const CudnnConvParams& params,
-    const std::function<cudnnConvolutionFwdAlgoPerf_t(const CudnnConvParams&)>& InferFn) {
-  return CudnnConvAlgoGetOrInfer<cudnnConvolutionFwdAlgoPerf_t>(params, InferFn, &fwd_algo_store_,
-                                                                &fwd_algo_store_mutex_);
+    const std::function<cudnnConvolutionFwdAlgoPerf_t(const CudnnConvParams&)>& InferFn,
+    bool persistent) {
+  using perf_t = cudnnConvolutionFwdAlgoPerf_t;
+  LoadPersistentStoreOnce();
+  std::function<void(const CudnnConvParams&, size_t, const perf_t&)> OnInferred;
+  if (persistent) {
+    OnInferred = [this](const CudnnConvParams& p, size_t ws, const perf_t& perf) {
+      AppendPersistentRecord(p, ws, perf);
+    };
+  }
+  return CudnnConvAlgoGetOrInfer<perf_t>(params, InferFn, OnInferred, &fwd_algo_store_,
+                                         &fwd_algo_store_mutex_);
 }
 
 template<>
 cudnnConvolutionBwdDataAlgoPerf_t CudnnConvAlgoCache::Remember(
     const CudnnConvParams& params,
-    const std::function<cudnnConvolutionBwdDataAlgoPerf_t(const CudnnConvParams&)>& InferFn) {
-  return CudnnConvAlgoGetOrInfer<cudnnConvolutionBwdDataAlgoPerf_t>(
-      params, InferFn, &bwd_data_algo_store_, &bwd_data_algo_store_mutex_);
+    const std::function<cudnnConvolutionBwdDataAlgoPerf_t(const CudnnConvParams&)>& InferFn,
+    bool persistent) {
+  using perf_t = cudnnConvolutionBwdDataAlgoPerf_t;
+  LoadPersistentStoreOnce();
+  std::function<void(const CudnnConvParams&, size_t, const perf_t&)> OnInferred;
+  if (persistent) {
+    OnInferred = [this](const CudnnConvParams& p, size_t ws, const perf_t& perf) {
+      AppendPersistentRecord(p, ws, perf);
+    };
+  }
+  return CudnnConvAlgoGetOrInfer<perf_t>(params, InferFn, OnInferred, &bwd_data_algo_store_,
+                                         &bwd_data_algo_store_mutex_);
 }
 
 template<>
 cudnnConvolutionBwdFilterAlgoPerf_t CudnnConvAlgoCache::Remember(
     const CudnnConvParams& params,
-    const std::function<cudnnConvolutionBwdFilterAlgoPerf_t(const CudnnConvParams&)>& InferFn) {
-  return CudnnConvAlgoGetOrInfer<cudnnConvolutionBwdFilterAlgoPerf_t>(
-      params, InferFn, &bwd_filter_algo_store_, &bwd_filter_algo_cache_mutex_);
+    const std::function<cudnnConvolutionBwdFilterAlgoPerf_t(const CudnnConvParams&)>& InferFn,
+    bool persistent) {
+  using perf_t = cudnnConvolutionBwdFilterAlgoPerf_t;
+  LoadPersistentStoreOnce();
+  std::function<void(const CudnnConvParams&, size_t, const perf_t&)> OnInferred;
+  if (persistent) {
+    OnInferred = [this](const CudnnConvParams& p, size_t ws, const perf_t& perf) {
+      AppendPersistentRecord(p, ws, perf);
+    };
+  }
+  return CudnnConvAlgoGetOrInfer<perf_t>(params, InferFn, OnInferred, &bwd_filter_algo_store_,
+                                         &bwd_filter_algo_cache_mutex_);
 }
 
 CudnnConvDesc::~CudnnConvDesc() { OF_CUDNN_CHECK(cudnnDestroyConvolutionDescriptor(val_)); }
@@ -539,7 +714,9 @@ perf_t FindCudnnConvAlgorithmWithResource(CudnnConvArgs* args, CudnnConvResource
     }
     return GetBestAlgorithm<perf_t>(*args, res, perf_vec);
   };
-  return Global<CudnnConvAlgoCache>::Get()->Remember<perf_t>(args->params, Infer);
+  // Only exhaustive search results are worth persisting, heuristic search is cheap to redo.
+  return Global<CudnnConvAlgoCache>::Get()->Remember<perf_t>(args->params, Infer,
+                                                             !args->heuristic);
 }
 
 template<typename perf_t, typename algo_t>
@@ -219,11 +219,23 @@ class CudnnConvAlgoCache final {
   template<typename perf_t>
   using Store = HashMap<CudnnConvParams, std::list<WorkspaceSizeAndPerfT<perf_t>>>;
 
+  // When `persistent` is true and ONEFLOW_CUDNN_CONV_ALGO_CACHE_DIR is set, newly inferred
+  // results are appended to an on-disk cache file keyed by GPU model, compute capability and
+  // cuDNN version, and results stored there by earlier processes are reused.
   template<typename perf_t>
   perf_t Remember(const CudnnConvParams& params,
-                  const std::function<perf_t(const CudnnConvParams& param)>& InferFn);
+                  const std::function<perf_t(const CudnnConvParams& param)>& InferFn,
+                  bool persistent);
 
  private:
+  void LoadPersistentStoreOnce();
+  template<typename perf_t>
+  void AppendPersistentRecord(const CudnnConvParams& params_without_ws, size_t max_ws_size,
+                              const perf_t& perf);
+
+  std::once_flag persistent_store_load_flag_;
+  std::string persistent_store_path_;
+  std::mutex persistent_store_file_mutex_;
   Store<cudnnConvolutionFwdAlgoPerf_t> fwd_algo_store_;
   std::mutex fwd_algo_store_mutex_;
   Store<cudnnConvolutionBwdDataAlgoPerf_t> bwd_data_algo_store_;
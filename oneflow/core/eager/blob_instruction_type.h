@@ -26,6 +26,7 @@ class TensorViewInstructionType : public vm::InstructionType {
 
   void Compute(vm::Instruction* instruction) const override;
   void ComputeInFuseMode(vm::InstructionMsg* instr_msg) const override;
+  bool SupportComputeInFuseMode() const override { return true; }
 
  private:
   void ComputeInstrMsg(const vm::InstructionMsg& instr_msg) const;
@@ -38,6 +39,7 @@ class AccessBlobByCallbackInstructionType : public vm::InstructionType {
 
   void Compute(vm::Instruction* instruction) const override;
   void ComputeInFuseMode(vm::InstructionMsg* instruction_msg) const override;
+  bool SupportComputeInFuseMode() const override { return true; }
 
  private:
   void ComputeInstrMsg(const vm::InstructionMsg& instruction_msg) const;
@@ -29,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/register/ofblob.h"
 #include "oneflow/core/vm/ref_cnt_instruction_status_querier.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/job/step_telemetry.h"
 
 namespace oneflow {
 
@@ -54,6 +55,10 @@ class CriticalSectionBeginInstructionType final : public InstructionType {
       CHECK_NOTNULL(phy_instr_operand);
       const auto& critical_section_instance = MakeCriticalSectionInstance(phy_instr_operand);
       const auto& job_name = critical_section_instance->job_name();
+      if (StepTelemetry::Enabled()
+          && dynamic_cast<const InputCriticalSectionBeginPhyInstrOperand*>(ptr.get()) != nullptr) {
+        StepTelemetry::Get()->OnInputReady(job_name);
+      }
       auto* buffer_mgr = Global<BufferMgr<std::shared_ptr<CriticalSectionInstance>>>::Get();
       for (int i = 0; i < phy_instr_operand->interfaces_op_names().size(); ++i) {
         if (phy_instr_operand->interfaces_valid().at(i)) {
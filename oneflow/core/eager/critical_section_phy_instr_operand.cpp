@@ -22,10 +22,17 @@ limitations under the License.
 #include "oneflow/core/device/ep_based_event_record.h"
 #include "oneflow/core/register/ofblob.h"
 #include "oneflow/core/common/container_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/memory/memory_case_util.h"
 
 namespace oneflow {
 namespace vm {
 
+bool IsNNGraphInputZeroCopyEnabled() {
+  static const bool kEnabled = ParseBooleanFromEnv("ONEFLOW_GRAPH_ZERO_COPY_INPUT", false);
+  return kEnabled;
+}
+
 void CriticalSectionBeginPhyInstrOperand::ForEachMirroredObject(
     const std::function<void(vm::MirroredObject* compute)>& DoEach) const {
   for (const auto& eager_blob_object : *eager_blob_objects_) {
@@ -84,6 +91,12 @@ void InputCriticalSectionBeginPhyInstrOperand::AccessBlobByOpName(uint64_t of_bl
   const auto& end_event_record = op_name2end_event_record_->at(op_name);
   if (blob->dptr() == nullptr) {
     end_event_record->Init(std::make_shared<NaiveEventRecord>());
+  } else if (IsNNGraphInputZeroCopyEnabled() && blob->mem_case() == of_blob->blob().mem_case()
+             && blob->ByteSizeOfBlobBody() == of_blob->blob().ByteSizeOfBlobBody()) {
+    // NOTE: the LaunchLazyJob instruction reads the eager blob until the job finishes, so it is
+    //   neither freed nor written by eager ops while the register aliases it.
+    of_blob->mut_blob()->reset_dptr(const_cast<char*>(blob->dptr<char>()));
+    end_event_record->Init(std::make_shared<NaiveEventRecord>());
   } else {
     AutoMemcpy(of_blob->stream(), of_blob->mut_blob(), blob);
     end_event_record->Init(EpBasedEventRecord::MakeEventRecord(of_blob->stream()));
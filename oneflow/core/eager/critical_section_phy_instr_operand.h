@@ -33,6 +33,10 @@ using EagerBlobObjectListPtr =
 
 namespace vm {
 
+// Whether the input registers of nn.Graph alias the memory of the eager input tensors when the
+// memory case and size match, instead of copying them in each step.
+bool IsNNGraphInputZeroCopyEnabled();
+
 class CriticalSectionBeginPhyInstrOperand : public PhyInstrOperand {
  public:
   CriticalSectionBeginPhyInstrOperand(const CriticalSectionBeginPhyInstrOperand&) = delete;
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/framework/to_string.h"
 #include "oneflow/core/framework/shut_down_util.h"
 #include "oneflow/core/common/shape_vec.h"
+#include "oneflow/core/profiler/memory_trace.h"
 
 namespace oneflow {
 namespace vm {
@@ -74,7 +75,10 @@ Maybe<void> EagerBlobObject::TryAllocateBlobBodyMemory(DeviceCtx* device_ctx) {
       allocator->Deallocate(dptr, required_body_bytes);
     };
     char* dptr = nullptr;
-    allocator->Allocate(&dptr, required_body_bytes);
+    {
+      profiler::MemoryBlobGuard memory_blob_guard(this);
+      allocator->Allocate(&dptr, required_body_bytes);
+    }
     tensor_storage_->set_blob_dptr(std::unique_ptr<char, std::function<void(char*)>>(dptr, Free),
                                    required_body_bytes);
 
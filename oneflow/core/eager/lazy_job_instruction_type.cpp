@@ -22,6 +22,8 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.h"
 #include "oneflow/core/vm/instruction_type.h"
 #include "oneflow/core/job/job_instance.h"
+#include "oneflow/core/job/pipeline_bubble_profile.h"
+#include "oneflow/core/job/step_telemetry.h"
 #include "oneflow/core/common/buffer_manager.h"
 #include "oneflow/core/common/global.h"
 #include "oneflow/core/vm/stream.h"
@@ -87,6 +89,10 @@ class LaunchLazyJobInstructionType final : public InstructionType {  // NOLINT
       OF_PROFILER_RANGE_POP();  // MakeJobInstance
       OF_PROFILER_RANGE_PUSH("Send all buffers to BufferMgr");
       const auto& job_name = job_instance->job_name();
+      if (PipelineBubbleProfile::Enabled()) {
+        PipelineBubbleProfile::Get()->OnStepLaunch(job_name);
+      }
+      if (StepTelemetry::Enabled()) { StepTelemetry::Get()->OnStepLaunch(job_name); }
       auto* buffer_mgr = Global<BufferMgr<std::shared_ptr<JobInstance>>>::Get();
       buffer_mgr->Get(GetCallbackNotifierBufferName(job_name))->Push(job_instance);
       buffer_mgr->Get(GetSourceTickBufferName(job_name))->Push(job_instance);
@@ -117,7 +123,11 @@ class LaunchLazyJobInstructionType final : public InstructionType {  // NOLINT
     const auto* phy_instr_operand = dynamic_cast<const LaunchLazyJobPhyInstrOperand*>(ptr);
     CHECK_NOTNULL(phy_instr_operand);
     const auto& nn_graph = phy_instr_operand->nn_graph();
-    const auto& FinishCb = [this, instruction]() {
+    const auto& FinishCb = [this, instruction, job_name = nn_graph->job_name()]() {
+      if (PipelineBubbleProfile::Enabled()) {
+        PipelineBubbleProfile::Get()->OnStepFinish(job_name);
+      }
+      if (StepTelemetry::Enabled()) { StepTelemetry::Get()->OnStepFinish(job_name); }
       auto* device_ctx = GetLazyJobDeviceCtx(instruction);
       device_ctx->DequeueNNGraph();
       auto* status_buffer = instruction->mut_status_buffer();
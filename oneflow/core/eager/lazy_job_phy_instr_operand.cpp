@@ -43,6 +43,13 @@ static constexpr auto* GetEagerNcclLocalDepObject =
 
 }  // namespace
 
+void LaunchLazyJobPhyInstrOperand::ForEachConstMirroredObject(
+    const std::function<void(vm::MirroredObject* compute)>& DoEach) const {
+  for (const auto& eager_blob_object : *input_blob_objects_) {
+    DoEach(CHECK_JUST(eager_blob_object->compute_local_dep_object()));
+  }
+}
+
 void LaunchLazyJobPhyInstrOperand::ForEachMutMirroredObject(
     const std::function<void(vm::MirroredObject* compute)>& DoEach) const {
   for (const auto& eager_blob_object : *param_blob_objects_) {
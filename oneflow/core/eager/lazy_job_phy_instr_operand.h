@@ -42,8 +42,18 @@ class LaunchLazyJobPhyInstrOperand final : public PhyInstrOperand {
 
   LaunchLazyJobPhyInstrOperand(const std::shared_ptr<NNGraphIf>& nn_graph,
                                const one::EagerBlobObjectListPtr& param_blob_objects)
+      : LaunchLazyJobPhyInstrOperand(
+          nn_graph, param_blob_objects,
+          std::make_shared<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>()) {}
+
+  // The input blob objects are read until the job finishes, for the input registers may alias
+  // them.
+  LaunchLazyJobPhyInstrOperand(const std::shared_ptr<NNGraphIf>& nn_graph,
+                               const one::EagerBlobObjectListPtr& param_blob_objects,
+                               const one::EagerBlobObjectListPtr& input_blob_objects)
       : nn_graph_(nn_graph),
         param_blob_objects_(param_blob_objects),
+        input_blob_objects_(input_blob_objects),
         input_dependences_(),
         output_dependences_() {
     ForEachConstMirroredObject(SetInserter(&input_dependences_));
@@ -57,7 +67,7 @@ class LaunchLazyJobPhyInstrOperand final : public PhyInstrOperand {
   const DependenceVector& input_dependences() const override { return input_dependences_; }
   const DependenceVector& output_dependences() const override { return output_dependences_; }
 
-  void ForEachConstMirroredObject(const std::function<void(vm::MirroredObject* compute)>&) const {}
+  void ForEachConstMirroredObject(const std::function<void(vm::MirroredObject* compute)>&) const;
 
   void ForEachMutMirroredObject(const std::function<void(vm::MirroredObject* compute)>&) const;
 
@@ -66,6 +76,7 @@ class LaunchLazyJobPhyInstrOperand final : public PhyInstrOperand {
  private:
   std::shared_ptr<NNGraphIf> nn_graph_;
   one::EagerBlobObjectListPtr param_blob_objects_;
+  one::EagerBlobObjectListPtr input_blob_objects_;
   DependenceVector input_dependences_;
   DependenceVector output_dependences_;
 };
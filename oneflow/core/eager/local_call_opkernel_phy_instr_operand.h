@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_EAGER_LOCAL_CALL_OPKERNEL_PHY_INSTR_OPERAND_H_
 #define ONEFLOW_CORE_EAGER_LOCAL_CALL_OPKERNEL_PHY_INSTR_OPERAND_H_
 
+#include "oneflow/core/common/cross_thread_obj_pool.h"
 #include "oneflow/core/vm/phy_instr_operand.h"
 #include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
 #include "oneflow/core/eager/eager_blob_object.h"
@@ -50,9 +51,9 @@ class LocalCallOpKernelPhyInstrOperand final : public vm::PhyInstrOperand {
 
   template<typename... Args>
   static Maybe<LocalCallOpKernelPhyInstrOperand> New(Args&&... args) {
-    auto* ptr = new LocalCallOpKernelPhyInstrOperand(std::forward<Args>(args)...);
+    auto ptr = obj_pool::make_shared<LocalCallOpKernelPhyInstrOperand>(std::forward<Args>(args)...);
     JUST(ptr->Init());
-    return std::shared_ptr<LocalCallOpKernelPhyInstrOperand>(ptr);
+    return ptr;
   }
 
   const one::StatefulLocalOpKernel& opkernel() const { return *opkernel_; }
@@ -90,6 +91,9 @@ class LocalCallOpKernelPhyInstrOperand final : public vm::PhyInstrOperand {
   }
 
  private:
+  template<typename T>
+  friend class obj_pool::CrossThreadPoolAllocator;
+
   LocalCallOpKernelPhyInstrOperand(
       const std::shared_ptr<one::StatefulLocalOpKernel>& opkernel,
       const one::EagerBlobObjectListPtr& inputs, const one::EagerBlobObjectListPtr& outputs,
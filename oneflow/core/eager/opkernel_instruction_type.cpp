@@ -35,7 +35,10 @@ limitations under the License.
 #include "oneflow/core/operator/op_conf_symbol.h"
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/event_trace.h"
 #include "oneflow/core/common/cpp_attribute.h"
+#include "oneflow/core/vm/cuda_graph_key.h"
+#include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
 namespace vm {
@@ -64,6 +67,12 @@ struct LocalCallOpKernelUtil final {
       TryInitOpKernelStateAndCache(operand, device_ctx, &state, &cache);
       OF_PROFILER_RANGE_POP();
     }
+    // Unified memory is prefetched ahead of the kernels. The cuda graph mode goes without, the
+    // prefetches captured would replay regardless of where the memory is.
+    if (unlikely(device_ctx->device_type() == DeviceType::kCUDA
+                 && device_ctx->mut_allocator()->NeedsAccessHints())) {
+      HintBlobsAccess(operand, device_ctx->mut_allocator());
+    }
     OpKernelCompute(operand, device_ctx, state, cache);
     if (unlikely(operand->need_temp_storage())) {
       OF_PROFILER_RANGE_PUSH("DeallocateTempStorageBlobMemory");
@@ -73,6 +82,72 @@ struct LocalCallOpKernelUtil final {
     return Maybe<void>::Ok();
   }
 
+  // Compute split around the kernel launches, see InstructionType::PrepareInCudaGraphMode.
+  static inline Maybe<bool> PrepareInCudaGraphMode(const vm::InstructionMsg& instr_msg,
+                                                   CudaGraphKey* key) {
+    auto* operand = LocalCallOpKernelUtil::GetLocalCallOpKernelPhyInstrOperand(instr_msg);
+    // The temp storage of the op kernel is still held by an earlier instruction of the sequence.
+    auto* temp_blob_object = operand->mut_opkernel()->mut_temp_blob_object();
+    if (operand->need_temp_storage()
+        && temp_blob_object->tensor_storage()->blob_dptr() != nullptr) {
+      return false;
+    }
+    operand->mut_opkernel()->composed_attrs_for_scheduler_thread()->ResetPrior(operand->attrs());
+    DeviceCtx* device_ctx = instr_msg.phy_instr_stream()->device_ctx().get();
+    JUST(AllocateOutputBlobsMemory(operand, device_ctx));
+    user_op::OpKernelState* state = nullptr;
+    user_op::OpKernelCache* cache = nullptr;
+    if (operand->user_opkernel()->has_state_or_cache()) {
+      TryInitOpKernelStateAndCache(operand, device_ctx, &state, &cache);
+    }
+    if (!operand->mut_opkernel()->IsCudaGraphSupported(
+            operand->user_opkernel(), device_ctx, operand->inputs().get(),
+            operand->outputs().get(), operand->consistent_tensor_infer_result().get(), state)) {
+      return false;
+    }
+    key->AppendKernel(operand->user_opkernel(), operand->attrs());
+    for (const auto& blob_object : *operand->inputs()) {
+      key->AppendBlob(blob_object->blob().raw_dptr(), blob_object->blob().shape());
+    }
+    for (const auto& blob_object : *operand->outputs()) {
+      key->AppendBlob(blob_object->blob().raw_dptr(), blob_object->blob().shape());
+    }
+    if (unlikely(operand->need_temp_storage())) {
+      InferTempStorageBlobDesc(operand);
+      JUST(ResetTempStorageBlob(operand));
+      JUST(TryAllocateTempStorageBlobMemory(operand, device_ctx));
+      key->AppendBlob(temp_blob_object->blob().raw_dptr(), temp_blob_object->blob().shape());
+    }
+    return true;
+  }
+
+  static inline void LaunchInCudaGraphMode(const vm::InstructionMsg& instr_msg) {
+    auto* operand = LocalCallOpKernelUtil::GetLocalCallOpKernelPhyInstrOperand(instr_msg);
+    // Instructions sharing the op kernel may have reset its attrs since it was prepared.
+    operand->mut_opkernel()->composed_attrs_for_scheduler_thread()->ResetPrior(operand->attrs());
+    DeviceCtx* device_ctx = instr_msg.phy_instr_stream()->device_ctx().get();
+    user_op::OpKernelState* state = nullptr;
+    user_op::OpKernelCache* cache = nullptr;
+    if (operand->user_opkernel()->has_state_or_cache()) {
+      if (operand->op_interp_ctx().state) {
+        state = operand->op_interp_ctx().state.get();
+      } else {
+        state = operand->opkernel().LookupOpKernelState(operand->user_opkernel());
+      }
+      cache = operand->opkernel().LookupOpKernelCache(operand->user_opkernel());
+    }
+    OpKernelCompute(operand, device_ctx, state, cache);
+  }
+
+  static inline Maybe<void> FinishInCudaGraphMode(const vm::InstructionMsg& instr_msg) {
+    auto* operand = LocalCallOpKernelUtil::GetLocalCallOpKernelPhyInstrOperand(instr_msg);
+    if (unlikely(operand->need_temp_storage())) {
+      DeviceCtx* device_ctx = instr_msg.phy_instr_stream()->device_ctx().get();
+      JUST(DeallocateTempStorageBlobMemory(operand, device_ctx));
+    }
+    return Maybe<void>::Ok();
+  }
+
   static inline LocalCallOpKernelPhyInstrOperand* GetLocalCallOpKernelPhyInstrOperand(
       const vm::InstructionMsg& instr_msg) {
     auto* operand = CHECK_NOTNULL(instr_msg.phy_instr_operand().get());
@@ -127,6 +202,19 @@ struct LocalCallOpKernelUtil final {
     return operand->mut_opkernel()->mut_temp_blob_object()->TryAllocateBlobBodyMemory(device_ctx);
   }
 
+  static inline void HintBlobsAccess(LocalCallOpKernelPhyInstrOperand* operand,
+                                     vm::Allocator* allocator) {
+    const auto HintAccess = [&](const Blob& blob, bool write) {
+      allocator->HintAccess(static_cast<const char*>(blob.dptr()), blob.ByteSizeOfBlobBody(),
+                            write);
+    };
+    for (const auto& blob_object : *operand->inputs()) { HintAccess(blob_object->blob(), false); }
+    for (const auto& blob_object : *operand->outputs()) { HintAccess(blob_object->blob(), true); }
+    if (operand->need_temp_storage()) {
+      HintAccess(operand->mut_opkernel()->mut_temp_blob_object()->blob(), true);
+    }
+  }
+
   static inline void OpKernelCompute(LocalCallOpKernelPhyInstrOperand* operand,
                                      DeviceCtx* device_ctx, user_op::OpKernelState* state,
                                      const user_op::OpKernelCache* cache) {
@@ -135,7 +223,11 @@ struct LocalCallOpKernelUtil final {
         opkernel->UpdateComputeContext(operand->inputs().get(), operand->outputs().get(),
                                        operand->consistent_tensor_infer_result().get(), device_ctx);
     OF_PROFILER_RANGE_PUSH("Compute");
-    operand->user_opkernel()->Compute(compute_ctx, state, cache);
+    {
+      profiler::OpComputeEventGuard compute_event_guard(opkernel->op_type_name(),
+                                                        opkernel->op_conf().name());
+      operand->user_opkernel()->Compute(compute_ctx, state, cache);
+    }
     OF_PROFILER_RANGE_POP();
     // tensor tuples are not allowed to be hold by StatefulLocalOpKernel
     opkernel->UpdateComputeContext(nullptr, nullptr, nullptr, nullptr);
@@ -155,6 +247,19 @@ void LocalCallOpKernelInstructionType::ComputeInFuseMode(vm::InstructionMsg* ins
   CHECK_JUST(LocalCallOpKernelUtil::Compute(*instr_msg));
 }
 
+bool LocalCallOpKernelInstructionType::PrepareInCudaGraphMode(vm::InstructionMsg* instr_msg,
+                                                              vm::CudaGraphKey* key) const {
+  return CHECK_JUST(LocalCallOpKernelUtil::PrepareInCudaGraphMode(*instr_msg, key));
+}
+
+void LocalCallOpKernelInstructionType::LaunchInCudaGraphMode(vm::InstructionMsg* instr_msg) const {
+  LocalCallOpKernelUtil::LaunchInCudaGraphMode(*instr_msg);
+}
+
+void LocalCallOpKernelInstructionType::FinishInCudaGraphMode(vm::InstructionMsg* instr_msg) const {
+  CHECK_JUST(LocalCallOpKernelUtil::FinishInCudaGraphMode(*instr_msg));
+}
+
 std::string LocalCallOpKernelInstructionType::DebugOpTypeName(
     const vm::InstructionMsg& instr_msg) const {
   auto* operand = CHECK_NOTNULL(instr_msg.phy_instr_operand().get());
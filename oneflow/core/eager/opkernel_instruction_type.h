@@ -28,6 +28,10 @@ class LocalCallOpKernelInstructionType : public vm::InstructionType {
  public:
   void Compute(vm::Instruction* instruction) const override;
   void ComputeInFuseMode(vm::InstructionMsg* instr_msg) const override;
+  bool PrepareInCudaGraphMode(vm::InstructionMsg* instr_msg,
+                              vm::CudaGraphKey* key) const override;
+  void LaunchInCudaGraphMode(vm::InstructionMsg* instr_msg) const override;
+  void FinishInCudaGraphMode(vm::InstructionMsg* instr_msg) const override;
 
   InstructionFuseType fuse_type() const override { return kEnableInstructionFuseAtAnyPosition; }
 
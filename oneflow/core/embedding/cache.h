@@ -28,6 +28,7 @@ struct CacheOptions {
   enum class Policy {
     kLRU,
     kFull,
+    kLFU,
   };
   enum class MemoryKind {
     kDevice,
@@ -39,8 +40,57 @@ struct CacheOptions {
   uint32_t key_size{};
   uint32_t value_size{};
   float load_factor = 0.75;
+  // Only used by the full cache, which grows online up to max_capacity when it is larger than
+  // capacity.
+  uint64_t max_capacity{};
 };
 
+// Optimizer applied by Cache::Update. A row holds embedding_size floats of embedding followed by
+// the optimizer states, embedding_size floats each: none for SGD, the momentum for Momentum, m and
+// v for Adam and the sum of squared gradients for Adagrad. The updates follow the dense
+// momentum_update, adam_update and adagrad_update kernels, the bias corrections of Adam are
+// 1 - beta^step computed by the caller. The learning rate and the bias corrections may instead be
+// read from device memory when the pointers are set, so that they can change between steps
+// without a sync.
+struct SparseUpdateOptions {
+  enum class Optimizer {
+    kSGD,
+    kMomentum,
+    kAdam,
+    kAdagrad,
+  };
+  Optimizer optimizer = Optimizer::kSGD;
+  uint32_t embedding_size{};
+  float learning_rate{};
+  float scale = 1.0;
+  float weight_decay{};
+  float beta{};
+  float beta1{};
+  float beta2{};
+  float epsilon{};
+  float bias_correction1 = 1.0;
+  float bias_correction2 = 1.0;
+  const float* learning_rate_ptr = nullptr;
+  const float* bias_correction1_ptr = nullptr;
+  const float* bias_correction2_ptr = nullptr;
+};
+
+// Number of embedding_size floats of optimizer states stored after the embedding in a row.
+inline uint32_t NumOptimizerStates(SparseUpdateOptions::Optimizer optimizer) {
+  if (optimizer == SparseUpdateOptions::Optimizer::kSGD) {
+    return 0;
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kMomentum) {
+    return 1;
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kAdam) {
+    return 2;
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kAdagrad) {
+    return 1;
+  } else {
+    UNIMPLEMENTED();
+    return 0;
+  }
+}
+
 class Cache {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Cache);
@@ -62,6 +112,16 @@ class Cache {
                    uint32_t* n_evicted, void* evicted_keys, void* evicted_values) = 0;
   virtual void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
                     uint32_t* n_dumped, void* keys, void* values) = 0;
+  // Applies the float gradients of unique keys to their rows and optimizer states in place, in
+  // one pass instead of Get, an update kernel and Put. Keys not in the cache are reported as by
+  // Get and left to the caller. The rows stay dirty in the cache until written back on eviction
+  // or Dump like any Put.
+  virtual bool SupportsUpdate() const { return false; }
+  virtual void Update(ep::Stream* stream, uint32_t n_keys, const void* keys,
+                      const float* model_diff, const SparseUpdateOptions& options,
+                      uint32_t* n_missing, void* missing_keys, uint32_t* missing_indices) {
+    UNIMPLEMENTED();
+  }
   virtual void Clear() = 0;
 };
 
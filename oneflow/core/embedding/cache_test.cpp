@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/embedding/cache.h"
+#include "oneflow/core/embedding/cached_key_value_store.h"
+#include "oneflow/core/embedding/persistent_table_key_value_store.h"
 #include "oneflow/core/device/cuda_util.h"
 #include <gtest/gtest.h>
 #include "oneflow/core/ep/include/device_manager_registry.h"
@@ -220,6 +222,183 @@ TEST(Cache, FullCache) {
   TestCache(cache.get(), line_size);
 }
 
+TEST(Cache, GrowableFullCache) {
+  if (!HasCudaDevice()) { return; }
+
+  CacheOptions options{};
+  options.policy = CacheOptions::Policy::kFull;
+  const uint32_t line_size = 128;
+  options.value_size = 512;
+  options.capacity = 4096;
+  options.max_capacity = 65536;
+  options.key_size = 8;
+  options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+  std::unique_ptr<Cache> cache(NewCache(options));
+  cache->ReserveQueryLength(65536);
+  TestCache(cache.get(), line_size);
+  ASSERT_GT(cache->Capacity(), options.capacity);
+}
+
+TEST(Cache, LfuCache) {
+  if (!HasCudaDevice()) { return; }
+
+  CacheOptions options{};
+  options.policy = CacheOptions::Policy::kLFU;
+  const uint32_t line_size = 128;
+  options.value_size = 512;
+  options.capacity = 8192;
+  options.key_size = 8;
+  options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+  std::unique_ptr<Cache> cache(NewCache(options));
+  cache->ReserveQueryLength(65536);
+  TestCache(cache.get(), line_size);
+}
+
+// Value files are opened with O_DIRECT, which tmpfs does not support, so stay off /tmp.
+std::string CreateTempDirectory() {
+  char tmpl[] = "cache_test_XXXXXX";
+  CHECK(mkdtemp(tmpl) != nullptr);
+  return tmpl;
+}
+
+std::unique_ptr<Cache> NewTierCache(CacheOptions::MemoryKind memory_kind, uint64_t capacity,
+                                    uint32_t value_size) {
+  CacheOptions options{};
+  options.policy = CacheOptions::Policy::kLRU;
+  options.value_size = value_size;
+  options.capacity = capacity;
+  options.key_size = sizeof(int64_t);
+  options.value_memory_kind = memory_kind;
+  return NewCache(options);
+}
+
+TEST(Cache, MultiTierKeyValueStore) {
+  if (!HasCudaDevice()) { return; }
+
+  Global<ep::DeviceManagerRegistry>::New();
+  {
+    auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA, 0);
+    ep::Stream* stream = device->CreateStream();
+    const uint32_t line_size = 128;
+    const uint32_t value_size = line_size * sizeof(float);
+    PersistentTableKeyValueStoreOptions table_options{};
+    table_options.table_options.path = CreateTempDirectory();
+    table_options.table_options.key_size = sizeof(int64_t);
+    table_options.table_options.value_size = value_size;
+    table_options.table_options.physical_block_size = 512;
+    // Both tiers are much smaller than the keys put, so rows are evicted from the device tier to
+    // the host tier and from the host tier to the table.
+    std::vector<std::unique_ptr<Cache>> caches;
+    caches.emplace_back(NewTierCache(CacheOptions::MemoryKind::kDevice, 2048, value_size));
+    caches.emplace_back(NewTierCache(CacheOptions::MemoryKind::kHost, 8192, value_size));
+    std::unique_ptr<KeyValueStore> store = NewMultiTierKeyValueStore(
+        NewPersistentTableKeyValueStore(table_options), std::move(caches));
+    ASSERT_EQ(store->ValueSize(), value_size);
+
+    const uint32_t n_keys = 1024;
+    const uint32_t n_batches = 16;
+    store->ReserveQueryLength(n_keys);
+    std::vector<int64_t> all_keys(n_keys * n_batches);
+    std::iota(all_keys.begin(), all_keys.end(), 1);
+    std::mt19937 g(std::random_device{}());
+    std::shuffle(all_keys.begin(), all_keys.end(), g);
+    const size_t keys_size = n_keys * sizeof(int64_t);
+    const size_t values_size = n_keys * value_size;
+    int64_t* d_keys;
+    float* d_values;
+    uint32_t* d_n_missing;
+    uint32_t* d_missing_indices;
+    OF_CUDA_CHECK(cudaMalloc(&d_keys, keys_size));
+    OF_CUDA_CHECK(cudaMalloc(&d_values, values_size));
+    OF_CUDA_CHECK(cudaMalloc(&d_n_missing, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_missing_indices, n_keys * sizeof(uint32_t)));
+    std::vector<int64_t> keys(n_keys);
+    std::vector<float> values(n_keys * line_size);
+
+    // put
+    for (uint32_t batch = 0; batch < n_batches; ++batch) {
+      std::copy(all_keys.begin() + batch * n_keys, all_keys.begin() + (batch + 1) * n_keys,
+                keys.begin());
+      for (size_t i = 0; i < n_keys; ++i) {
+        for (size_t j = 0; j < line_size; ++j) {
+          values.at(i * line_size + j) = static_cast<float>(keys.at(i) * line_size + j);
+        }
+      }
+      OF_CUDA_CHECK(cudaMemcpy(d_keys, keys.data(), keys_size, cudaMemcpyDefault));
+      OF_CUDA_CHECK(cudaMemcpy(d_values, values.data(), values_size, cudaMemcpyDefault));
+      store->Put(stream, n_keys, d_keys, d_values);
+      CHECK_JUST(stream->Sync());
+    }
+    KeyValueStoreStatistics statistics;
+    store->GetStatistics(&statistics);
+    ASSERT_EQ(statistics.caches.size(), 2);
+    ASSERT_GT(statistics.caches.at(0).num_evictions, 0);
+    ASSERT_GT(statistics.caches.at(1).num_evictions, 0);
+    ASSERT_GT(statistics.num_store_block_writes, 0);
+
+    // get, every row put is found in one of the tiers
+    std::shuffle(all_keys.begin(), all_keys.end(), g);
+    for (uint32_t batch = 0; batch < n_batches; ++batch) {
+      std::copy(all_keys.begin() + batch * n_keys, all_keys.begin() + (batch + 1) * n_keys,
+                keys.begin());
+      OF_CUDA_CHECK(cudaMemcpy(d_keys, keys.data(), keys_size, cudaMemcpyDefault));
+      store->Get(stream, n_keys, d_keys, d_values, d_n_missing, d_missing_indices);
+      CHECK_JUST(stream->Sync());
+      uint32_t n_missing = 0;
+      OF_CUDA_CHECK(cudaMemcpy(&n_missing, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+      OF_CUDA_CHECK(cudaMemcpy(values.data(), d_values, values_size, cudaMemcpyDefault));
+      ASSERT_EQ(n_missing, 0);
+      for (size_t i = 0; i < n_keys; ++i) {
+        for (size_t j = 0; j < line_size; ++j) {
+          ASSERT_EQ(values.at(i * line_size + j), static_cast<float>(keys.at(i) * line_size + j))
+              << "batch " << batch << " i " << i << " j " << j;
+        }
+      }
+    }
+
+    // get, keys never put are reported missing
+    for (size_t i = 0; i < n_keys; ++i) { keys.at(i) = all_keys.size() + 1 + i; }
+    OF_CUDA_CHECK(cudaMemcpy(d_keys, keys.data(), keys_size, cudaMemcpyDefault));
+    store->Get(stream, n_keys, d_keys, d_values, d_n_missing, d_missing_indices);
+    CHECK_JUST(stream->Sync());
+    uint32_t n_missing = 0;
+    OF_CUDA_CHECK(cudaMemcpy(&n_missing, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+    ASSERT_EQ(n_missing, n_keys);
+
+    // snapshot, the rows still held by the caches are flushed into it
+    store->SaveSnapshot("multi_tier");
+    ASSERT_TRUE(store->SnapshotExists("multi_tier"));
+    std::set<int64_t> iterated_keys;
+    store->LoadSnapshot("multi_tier", [&](KVIterator* iter) {
+      while (true) {
+        iter->NextN(stream, n_keys, d_n_missing, d_keys, d_values);
+        CHECK_JUST(stream->Sync());
+        uint32_t n_result = 0;
+        OF_CUDA_CHECK(cudaMemcpy(&n_result, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+        if (n_result == 0) { break; }
+        OF_CUDA_CHECK(cudaMemcpy(keys.data(), d_keys, keys_size, cudaMemcpyDefault));
+        OF_CUDA_CHECK(cudaMemcpy(values.data(), d_values, values_size, cudaMemcpyDefault));
+        for (size_t i = 0; i < n_result; ++i) {
+          ASSERT_TRUE(iterated_keys.emplace(keys.at(i)).second);
+          for (size_t j = 0; j < line_size; ++j) {
+            ASSERT_EQ(values.at(i * line_size + j),
+                      static_cast<float>(keys.at(i) * line_size + j));
+          }
+        }
+      }
+    });
+    ASSERT_EQ(iterated_keys, std::set<int64_t>(all_keys.begin(), all_keys.end()));
+
+    OF_CUDA_CHECK(cudaFree(d_keys));
+    OF_CUDA_CHECK(cudaFree(d_values));
+    OF_CUDA_CHECK(cudaFree(d_n_missing));
+    OF_CUDA_CHECK(cudaFree(d_missing_indices));
+    store.reset();
+    device->DestroyStream(stream);
+  }
+  Global<ep::DeviceManagerRegistry>::Delete();
+}
+
 #endif  // WITH_CUDA
 
 }  // namespace
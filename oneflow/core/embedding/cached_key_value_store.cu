@@ -0,0 +1,394 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/cached_key_value_store.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr uint32_t kStoreMissing = 1;
+constexpr uint32_t kInvalidPosition = 0xFFFFFFFFU;
+
+__global__ void MarkStoreMissingKernel(uint32_t num_cache_missing, const uint32_t* n_store_missing,
+                                       const uint32_t* store_missing_indices,
+                                       uint32_t* positions) {
+  const uint32_t num_store_missing = *n_store_missing;
+  CUDA_1D_KERNEL_LOOP(i, num_cache_missing) {
+    if (i < num_store_missing) { positions[store_missing_indices[i]] = kStoreMissing; }
+  }
+}
+
+template<typename Key>
+__global__ void CompactStoreFoundKernel(uint32_t num_cache_missing, const Key* cache_missing_keys,
+                                        const uint32_t* cache_missing_indices,
+                                        uint32_t* positions, uint32_t* n_missing,
+                                        uint32_t* missing_indices, uint32_t* n_found,
+                                        Key* found_keys) {
+  CUDA_1D_KERNEL_LOOP(i, num_cache_missing) {
+    if (positions[i] == kStoreMissing) {
+      if (n_missing != nullptr) {
+        const uint32_t missing_idx = atomicAdd(n_missing, 1U);
+        missing_indices[missing_idx] = cache_missing_indices[i];
+      }
+      positions[i] = kInvalidPosition;
+    } else {
+      const uint32_t found_idx = atomicAdd(n_found, 1U);
+      found_keys[found_idx] = cache_missing_keys[i];
+      positions[i] = found_idx;
+    }
+  }
+}
+
+template<typename Elem>
+__global__ void ScatterStoreFoundKernel(uint32_t value_length, uint32_t values_elem_cnt,
+                                        const uint32_t* cache_missing_indices,
+                                        const uint32_t* positions, const Elem* store_values,
+                                        Elem* values, Elem* found_values) {
+  CUDA_1D_KERNEL_LOOP(i, values_elem_cnt) {
+    const uint32_t row = i / value_length;
+    const uint32_t position = positions[row];
+    if (position == kInvalidPosition) { continue; }
+    const uint32_t col = i - row * value_length;
+    const Elem elem = store_values[i];
+    if (values != nullptr) { values[cache_missing_indices[row] * value_length + col] = elem; }
+    found_values[position * value_length + col] = elem;
+  }
+}
+
+template<typename Key, typename Elem>
+class CachedKeyValueStoreImpl : public KeyValueStore {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CachedKeyValueStoreImpl);
+  CachedKeyValueStoreImpl(std::unique_ptr<KeyValueStore>&& store, std::unique_ptr<Cache>&& cache)
+      : store_(std::move(store)),
+        cache_(std::move(cache)),
+        device_index_(-1),
+        max_query_length_(0) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    CHECK_EQ(store_->KeySize(), cache_->KeySize());
+    CHECK_EQ(store_->ValueSize(), cache_->ValueSize());
+    CHECK_EQ(cache_->KeySize(), sizeof(Key));
+    value_length_ = cache_->ValueSize() / sizeof(Elem);
+    OF_CUDA_CHECK(cudaMalloc(&num_buffer_, kNumCounters * sizeof(uint32_t)));
+    OF_CUDA_CHECK(NumaAwareCudaMallocHost(device_index_,
+                                          reinterpret_cast<void**>(&host_num_buffer_),
+                                          kNumCounters * sizeof(uint32_t)));
+  }
+  ~CachedKeyValueStoreImpl() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+    OF_CUDA_CHECK(cudaFree(num_buffer_));
+    OF_CUDA_CHECK(cudaFreeHost(host_num_buffer_));
+  }
+
+  uint32_t KeySize() const override { return sizeof(Key); }
+
+  uint32_t ValueSize() const override { return sizeof(Elem) * value_length_; }
+
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (query_length <= max_query_length_) { return; }
+    cache_->ReserveQueryLength(query_length);
+    store_->ReserveQueryLength(query_length);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+    OF_CUDA_CHECK(cudaMalloc(&keys_buffer_, query_length * sizeof(Key)));
+    OF_CUDA_CHECK(cudaMalloc(&values_buffer_, query_length * ValueSize()));
+    OF_CUDA_CHECK(cudaMalloc(&found_keys_buffer_, query_length * sizeof(Key)));
+    OF_CUDA_CHECK(cudaMalloc(&found_values_buffer_, query_length * ValueSize()));
+    OF_CUDA_CHECK(cudaMalloc(&indices_buffer_, query_length * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&store_missing_indices_buffer_, query_length * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&positions_buffer_, query_length * sizeof(uint32_t)));
+    max_query_length_ = query_length;
+  }
+
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint32_t* n_missing, uint32_t* missing_indices) override;
+  void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override;
+  void Prefetch(ep::Stream* stream, uint32_t num_keys, const void* keys) override;
+  bool SupportsUpdate() const override { return cache_->SupportsUpdate(); }
+  void Update(ep::Stream* stream, uint32_t num_keys, const void* keys, const float* model_diff,
+              const SparseUpdateOptions& options, uint32_t* n_missing,
+              uint32_t* missing_indices) override;
+  bool SnapshotExists(const std::string& name) override;
+  void LoadSnapshot(const std::string& name) override;
+  void LoadSnapshot(const std::string& name,
+                    const std::function<void(KVIterator* iter)>& Hook) override;
+  void SaveSnapshot(const std::string& name) override;
+  void GetStatistics(KeyValueStoreStatistics* statistics) const override {
+    store_->GetStatistics(statistics);
+    CacheStatistics cache_statistics;
+    cache_statistics.num_queries = num_queries_.load(std::memory_order_relaxed);
+    cache_statistics.num_misses = num_misses_.load(std::memory_order_relaxed);
+    cache_statistics.num_hits =
+        cache_statistics.num_queries - std::min(cache_statistics.num_queries,
+                                                cache_statistics.num_misses);
+    cache_statistics.num_evictions = num_evictions_.load(std::memory_order_relaxed);
+    statistics->caches.insert(statistics->caches.begin(), cache_statistics);
+  }
+  void ResetStatistics() override {
+    num_queries_.store(0, std::memory_order_relaxed);
+    num_misses_.store(0, std::memory_order_relaxed);
+    num_evictions_.store(0, std::memory_order_relaxed);
+    store_->ResetStatistics();
+  }
+  void SetCurrentStep(uint64_t step) override { store_->SetCurrentStep(step); }
+  uint64_t EvictExpired() override { return store_->EvictExpired(); }
+
+ private:
+  enum Counter {
+    kCacheMissing = 0,
+    kStoreMissing,
+    kFound,
+    kEvicted,
+    kNumCounters,
+  };
+
+  void FreeQueryBuffers() {
+    OF_CUDA_CHECK(cudaFree(keys_buffer_));
+    OF_CUDA_CHECK(cudaFree(values_buffer_));
+    OF_CUDA_CHECK(cudaFree(found_keys_buffer_));
+    OF_CUDA_CHECK(cudaFree(found_values_buffer_));
+    OF_CUDA_CHECK(cudaFree(indices_buffer_));
+    OF_CUDA_CHECK(cudaFree(store_missing_indices_buffer_));
+    OF_CUDA_CHECK(cudaFree(positions_buffer_));
+  }
+
+  uint32_t SyncCounter(ep::Stream* stream, Counter counter) {
+    OF_CUDA_CHECK(cudaMemcpyAsync(host_num_buffer_ + counter, num_buffer_ + counter,
+                                  sizeof(uint32_t), cudaMemcpyDefault,
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+    CHECK_JUST(stream->Sync());
+    return host_num_buffer_[counter];
+  }
+
+  // Looks up the keys in keys_buffer_ missed by the cache in the store and promotes the rows found.
+  // If values is not null, the rows found are also scattered to values by indices_buffer_.
+  void FetchFromStore(ep::Stream* stream, uint32_t num_cache_missing, void* values,
+                      uint32_t* n_missing, uint32_t* missing_indices);
+
+  // Puts rows into the cache and writes the rows evicted by the cache down to the store.
+  void PutAndWriteBack(ep::Stream* stream, uint32_t num_keys, const void* keys,
+                       const void* values) {
+    cache_->Put(stream, num_keys, keys, values, num_buffer_ + kEvicted, keys_buffer_,
+                values_buffer_);
+    const uint32_t num_evicted = SyncCounter(stream, kEvicted);
+    num_evictions_.fetch_add(num_evicted, std::memory_order_relaxed);
+    store_->Put(stream, num_evicted, keys_buffer_, values_buffer_);
+  }
+
+  std::unique_ptr<KeyValueStore> store_;
+  std::unique_ptr<Cache> cache_;
+  int device_index_;
+  uint32_t max_query_length_;
+  uint32_t value_length_;
+  uint32_t* num_buffer_{};
+  uint32_t* host_num_buffer_{};
+  Key* keys_buffer_{};
+  Elem* values_buffer_{};
+  Key* found_keys_buffer_{};
+  Elem* found_values_buffer_{};
+  uint32_t* indices_buffer_{};
+  uint32_t* store_missing_indices_buffer_{};
+  uint32_t* positions_buffer_{};
+  std::mutex mutex_;
+  // Accumulated from the counters synced to host anyway, so the statistics cost no extra copy.
+  std::atomic<uint64_t> num_queries_{0};
+  std::atomic<uint64_t> num_misses_{0};
+  std::atomic<uint64_t> num_evictions_{0};
+};
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::FetchFromStore(ep::Stream* stream,
+                                                        uint32_t num_cache_missing, void* values,
+                                                        uint32_t* n_missing,
+                                                        uint32_t* missing_indices) {
+  auto cuda_stream = stream->As<ep::CudaStream>();
+  store_->Get(stream, num_cache_missing, keys_buffer_, values_buffer_, num_buffer_ + kStoreMissing,
+              store_missing_indices_buffer_);
+  OF_CUDA_CHECK(cudaMemsetAsync(positions_buffer_, 0, num_cache_missing * sizeof(uint32_t),
+                                cuda_stream->cuda_stream()));
+  OF_CUDA_CHECK(
+      cudaMemsetAsync(num_buffer_ + kFound, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+  RUN_CUDA_KERNEL(MarkStoreMissingKernel, stream, num_cache_missing, num_cache_missing,
+                  num_buffer_ + kStoreMissing, store_missing_indices_buffer_, positions_buffer_);
+  RUN_CUDA_KERNEL((CompactStoreFoundKernel<Key>), stream, num_cache_missing, num_cache_missing,
+                  keys_buffer_, indices_buffer_, positions_buffer_, n_missing, missing_indices,
+                  num_buffer_ + kFound, found_keys_buffer_);
+  const uint32_t values_elem_cnt = num_cache_missing * value_length_;
+  RUN_CUDA_KERNEL((ScatterStoreFoundKernel<Elem>), stream, values_elem_cnt, value_length_,
+                  values_elem_cnt, indices_buffer_, positions_buffer_, values_buffer_,
+                  static_cast<Elem*>(values), found_values_buffer_);
+  // Promote the rows found in the store, keys_buffer_ and values_buffer_ are free to hold the
+  // rows evicted from the cache from now on.
+  const uint32_t num_found = SyncCounter(stream, kFound);
+  PutAndWriteBack(stream, num_found, found_keys_buffer_, found_values_buffer_);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::Get(ep::Stream* stream, uint32_t num_keys,
+                                             const void* keys, void* values, uint32_t* n_missing,
+                                             uint32_t* missing_indices) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LE(num_keys, max_query_length_);
+  auto cuda_stream = stream->As<ep::CudaStream>();
+  OF_CUDA_CHECK(cudaMemsetAsync(n_missing, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+  if (num_keys == 0) { return; }
+  cache_->Get(stream, num_keys, keys, values, num_buffer_ + kCacheMissing, keys_buffer_,
+              indices_buffer_);
+  const uint32_t num_cache_missing = SyncCounter(stream, kCacheMissing);
+  num_queries_.fetch_add(num_keys, std::memory_order_relaxed);
+  num_misses_.fetch_add(num_cache_missing, std::memory_order_relaxed);
+  if (num_cache_missing == 0) { return; }
+  FetchFromStore(stream, num_cache_missing, values, n_missing, missing_indices);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::Put(ep::Stream* stream, uint32_t num_keys,
+                                             const void* keys, const void* values) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LE(num_keys, max_query_length_);
+  if (num_keys == 0) { return; }
+  PutAndWriteBack(stream, num_keys, keys, values);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::Prefetch(ep::Stream* stream, uint32_t num_keys,
+                                                  const void* keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LE(num_keys, max_query_length_);
+  if (num_keys == 0) { return; }
+  cache_->Test(stream, num_keys, keys, num_buffer_ + kCacheMissing, keys_buffer_, indices_buffer_);
+  const uint32_t num_cache_missing = SyncCounter(stream, kCacheMissing);
+  if (num_cache_missing == 0) { return; }
+  // Let the slower tiers pull the rows up first, so that a miss in this tier is served from the
+  // nearest tier below it.
+  store_->Prefetch(stream, num_cache_missing, keys_buffer_);
+  FetchFromStore(stream, num_cache_missing, nullptr, nullptr, nullptr);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::Update(ep::Stream* stream, uint32_t num_keys,
+                                                const void* keys, const float* model_diff,
+                                                const SparseUpdateOptions& options,
+                                                uint32_t* n_missing, uint32_t* missing_indices) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LE(num_keys, max_query_length_);
+  // Only the indices of the keys missed are handed back, their keys land in keys_buffer_.
+  cache_->Update(stream, num_keys, keys, model_diff, options, n_missing, keys_buffer_,
+                 missing_indices);
+}
+
+template<typename Key, typename Elem>
+bool CachedKeyValueStoreImpl<Key, Elem>::SnapshotExists(const std::string& name) {
+  return store_->SnapshotExists(name);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::LoadSnapshot(const std::string& name) {
+  LoadSnapshot(name, nullptr);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::LoadSnapshot(
+    const std::string& name, const std::function<void(KVIterator* iter)>& Hook) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_->Clear();
+  store_->LoadSnapshot(name, Hook);
+}
+
+template<typename Key, typename Elem>
+void CachedKeyValueStoreImpl<Key, Elem>::SaveSnapshot(const std::string& name) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_GT(max_query_length_, 0);
+  auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA,
+                                                                      device_index_);
+  CHECK(device);
+  auto* stream = device->CreateStream();
+  // The cache is write-back, flush the dirty rows to the store before taking the snapshot.
+  const uint64_t dump_capacity = cache_->DumpCapacity();
+  for (uint64_t start_key_index = 0; start_key_index < dump_capacity;
+       start_key_index += max_query_length_) {
+    cache_->Dump(stream, start_key_index,
+                 std::min(start_key_index + max_query_length_, dump_capacity),
+                 num_buffer_ + kEvicted, keys_buffer_, values_buffer_);
+    const uint32_t num_dumped = SyncCounter(stream, kEvicted);
+    store_->Put(stream, num_dumped, keys_buffer_, values_buffer_);
+  }
+  CHECK_JUST(stream->Sync());
+  device->DestroyStream(stream);
+  store_->SaveSnapshot(name);
+}
+
+template<typename Key>
+std::unique_ptr<KeyValueStore> DispatchValueType(std::unique_ptr<KeyValueStore>&& store,
+                                                 std::unique_ptr<Cache>&& cache) {
+  const uint32_t value_size = cache->ValueSize();
+  if (value_size % sizeof(uint4) == 0) {
+    return std::unique_ptr<KeyValueStore>(
+        new CachedKeyValueStoreImpl<Key, uint4>(std::move(store), std::move(cache)));
+  } else if (value_size % sizeof(uint64_t) == 0) {
+    return std::unique_ptr<KeyValueStore>(
+        new CachedKeyValueStoreImpl<Key, uint64_t>(std::move(store), std::move(cache)));
+  } else if (value_size % sizeof(uint32_t) == 0) {
+    return std::unique_ptr<KeyValueStore>(
+        new CachedKeyValueStoreImpl<Key, uint32_t>(std::move(store), std::move(cache)));
+  } else if (value_size % sizeof(uint16_t) == 0) {
+    return std::unique_ptr<KeyValueStore>(
+        new CachedKeyValueStoreImpl<Key, uint16_t>(std::move(store), std::move(cache)));
+  } else {
+    return std::unique_ptr<KeyValueStore>(
+        new CachedKeyValueStoreImpl<Key, uint8_t>(std::move(store), std::move(cache)));
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<KeyValueStore> NewCachedKeyValueStore(std::unique_ptr<KeyValueStore>&& store,
+                                                      std::unique_ptr<Cache>&& cache) {
+  const uint32_t key_size = cache->KeySize();
+  if (key_size == sizeof(uint32_t)) {
+    return DispatchValueType<uint32_t>(std::move(store), std::move(cache));
+  } else if (key_size == sizeof(uint64_t)) {
+    return DispatchValueType<uint64_t>(std::move(store), std::move(cache));
+  } else {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+}
+
+std::unique_ptr<KeyValueStore> NewMultiTierKeyValueStore(
+    std::unique_ptr<KeyValueStore>&& store, std::vector<std::unique_ptr<Cache>>&& caches) {
+  std::unique_ptr<KeyValueStore> tiered_store = std::move(store);
+  // Wrap from the slowest tier, so that lookups fall through from caches.front() down to the store
+  // and the rows evicted from each tier are written to the tier below it.
+  for (auto it = caches.rbegin(); it != caches.rend(); ++it) {
+    tiered_store = NewCachedKeyValueStore(std::move(tiered_store), std::move(*it));
+  }
+  caches.clear();
+  return tiered_store;
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,353 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/cache.h"
+#include "oneflow/core/embedding/persistent_table_key_value_store.h"
+#include "oneflow/core/embedding/posix_file.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+// Measures the throughput of the embedding caches and of the persistent table store, the records
+// are printed as a json array. Configured through the environment:
+//   ONEFLOW_EMBEDDING_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_EMBEDDING_BENCHMARK_TABLE_PATH: directory of the persistent tables, it should be on the
+//     device under test and is removed afterwards.
+//   ONEFLOW_EMBEDDING_BENCHMARK_KEY_SPACE: number of distinct keys, 4194304 by default.
+//   ONEFLOW_EMBEDDING_BENCHMARK_NUM_KEYS: keys per query before deduplication, 65536 by default.
+//   ONEFLOW_EMBEDDING_BENCHMARK_NUM_BATCHES: queries timed per operation, 64 by default.
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef WITH_CUDA
+
+struct Distribution {
+  std::string name;
+  double alpha;
+};
+
+// Draws keys in [1, key_space], key 1 is the most frequent one of a zipf distribution.
+class KeyGenerator final {
+ public:
+  KeyGenerator(const Distribution& distribution, uint64_t key_space)
+      : key_space_(key_space), uniform_(1, key_space), engine_(0) {
+    if (distribution.name == "zipf") {
+      cdf_.resize(key_space);
+      double sum = 0;
+      for (uint64_t i = 0; i < key_space; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), distribution.alpha);
+        cdf_[i] = sum;
+      }
+      for (auto& p : cdf_) { p /= sum; }
+    } else {
+      CHECK_EQ(distribution.name, "uniform");
+    }
+  }
+
+  uint64_t Next() {
+    if (cdf_.empty()) { return uniform_(engine_); }
+    const double p = std::uniform_real_distribution<double>(0, 1)(engine_);
+    const auto it = std::lower_bound(cdf_.cbegin(), cdf_.cend(), p);
+    return std::min<uint64_t>(it - cdf_.cbegin(), key_space_ - 1) + 1;
+  }
+
+ private:
+  uint64_t key_space_;
+  std::vector<double> cdf_;
+  std::uniform_int_distribution<uint64_t> uniform_;
+  std::mt19937_64 engine_;
+};
+
+// Batches of unique keys, as the lookups of the embedding ops are deduplicated.
+class Batches final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Batches);
+  Batches(KeyGenerator* generator, uint32_t num_batches, uint32_t num_keys)
+      : num_keys_per_batch_(num_keys) {
+    OF_CUDA_CHECK(cudaMalloc(&keys_, num_batches * num_keys * sizeof(uint64_t)));
+    std::vector<uint64_t> host_keys(num_keys);
+    for (uint32_t i = 0; i < num_batches; ++i) {
+      std::unordered_set<uint64_t> unique_keys;
+      for (uint32_t j = 0; j < num_keys; ++j) { unique_keys.insert(generator->Next()); }
+      const uint32_t n = unique_keys.size();
+      std::copy(unique_keys.cbegin(), unique_keys.cend(), host_keys.begin());
+      OF_CUDA_CHECK(cudaMemcpy(keys_ + i * num_keys, host_keys.data(), n * sizeof(uint64_t),
+                               cudaMemcpyDefault));
+      num_keys_.push_back(n);
+    }
+  }
+  ~Batches() { OF_CUDA_CHECK(cudaFree(keys_)); }
+
+  uint32_t Size() const { return num_keys_.size(); }
+  uint32_t NumKeys(uint32_t i) const { return num_keys_.at(i); }
+  const uint64_t* Keys(uint32_t i) const { return keys_ + i * num_keys_per_batch_; }
+  uint64_t TotalNumKeys() const {
+    return std::accumulate(num_keys_.cbegin(), num_keys_.cend(), static_cast<uint64_t>(0));
+  }
+
+ private:
+  uint32_t num_keys_per_batch_;
+  uint64_t* keys_{};
+  std::vector<uint32_t> num_keys_;
+};
+
+// Output buffers of one query.
+struct QueryBuffers {
+  explicit QueryBuffers(uint32_t num_keys, uint32_t value_size) {
+    OF_CUDA_CHECK(cudaMalloc(&values, num_keys * value_size));
+    OF_CUDA_CHECK(cudaMemset(values, 0, num_keys * value_size));
+    OF_CUDA_CHECK(cudaMalloc(&evicted_values, num_keys * value_size));
+    OF_CUDA_CHECK(cudaMalloc(&keys, num_keys * sizeof(uint64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&indices, num_keys * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&n, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMallocHost(&host_n, sizeof(uint32_t)));
+  }
+  ~QueryBuffers() {
+    OF_CUDA_CHECK(cudaFree(values));
+    OF_CUDA_CHECK(cudaFree(evicted_values));
+    OF_CUDA_CHECK(cudaFree(keys));
+    OF_CUDA_CHECK(cudaFree(indices));
+    OF_CUDA_CHECK(cudaFree(n));
+    OF_CUDA_CHECK(cudaFreeHost(host_n));
+  }
+  void* values{};
+  void* evicted_values{};
+  void* keys{};
+  uint32_t* indices{};
+  uint32_t* n{};
+  uint32_t* host_n{};
+};
+
+// Runs fn on every batch and returns the seconds taken and the sum of *n after each query.
+template<typename F>
+std::pair<double, uint64_t> Time(ep::Stream* stream, const Batches& batches, QueryBuffers* buffers,
+                                 const F& fn) {
+  CHECK_JUST(stream->Sync());
+  uint64_t total_n = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < batches.Size(); ++i) {
+    fn(batches.NumKeys(i), batches.Keys(i));
+    OF_CUDA_CHECK(cudaMemcpyAsync(buffers->host_n, buffers->n, sizeof(uint32_t),
+                                  cudaMemcpyDefault, stream->As<ep::CudaStream>()->cuda_stream()));
+    CHECK_JUST(stream->Sync());
+    total_n += *buffers->host_n;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::make_pair(std::chrono::duration<double>(end - start).count(), total_n);
+}
+
+nlohmann::json MakeRecord(const nlohmann::json& config, const std::string& op,
+                          const Batches& batches, uint32_t value_size, double seconds,
+                          uint64_t num_missing) {
+  nlohmann::json record = config;
+  const uint64_t total_keys = batches.TotalNumKeys();
+  record["op"] = op;
+  record["num_keys"] = total_keys;
+  record["seconds"] = seconds;
+  record["keys_per_second"] = total_keys / seconds;
+  record["gigabytes_per_second"] = total_keys * value_size / seconds / 1e9;
+  record["missing_ratio"] = static_cast<double>(num_missing) / total_keys;
+  return record;
+}
+
+void BenchmarkCache(ep::Stream* stream, const CacheOptions& options, uint32_t max_query_length,
+                    const Batches& warmup, const Batches& batches, const nlohmann::json& config,
+                    std::vector<nlohmann::json>* records) {
+  std::unique_ptr<Cache> cache = NewCache(options);
+  cache->ReserveQueryLength(max_query_length);
+  QueryBuffers buffers(max_query_length, options.value_size);
+  const auto Put = [&](uint32_t n_keys, const uint64_t* keys) {
+    cache->Put(stream, n_keys, keys, buffers.values, buffers.n, buffers.keys,
+               buffers.evicted_values);
+  };
+  const auto Get = [&](uint32_t n_keys, const uint64_t* keys) {
+    cache->Get(stream, n_keys, keys, buffers.values, buffers.n, buffers.keys, buffers.indices);
+  };
+  const auto Test = [&](uint32_t n_keys, const uint64_t* keys) {
+    cache->Test(stream, n_keys, keys, buffers.n, buffers.keys, buffers.indices);
+  };
+  Time(stream, warmup, &buffers, Put);
+  const auto put = Time(stream, batches, &buffers, Put);
+  records->push_back(MakeRecord(config, "put", batches, options.value_size, put.first, 0));
+  const auto get = Time(stream, batches, &buffers, Get);
+  records->push_back(
+      MakeRecord(config, "get", batches, options.value_size, get.first, get.second));
+  const auto test = Time(stream, batches, &buffers, Test);
+  records->push_back(
+      MakeRecord(config, "test", batches, options.value_size, test.first, test.second));
+}
+
+void BenchmarkStore(ep::Stream* stream, const PersistentTableKeyValueStoreOptions& options,
+                    uint32_t max_query_length, const Batches& warmup, const Batches& batches,
+                    const nlohmann::json& config, std::vector<nlohmann::json>* records) {
+  const uint32_t value_size = options.table_options.value_size;
+  std::unique_ptr<KeyValueStore> store = NewPersistentTableKeyValueStore(options);
+  store->ReserveQueryLength(max_query_length);
+  QueryBuffers buffers(max_query_length, value_size);
+  const auto Put = [&](uint32_t n_keys, const uint64_t* keys) {
+    OF_CUDA_CHECK(cudaMemsetAsync(buffers.n, 0, sizeof(uint32_t),
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+    store->Put(stream, n_keys, keys, buffers.values);
+  };
+  const auto Get = [&](uint32_t n_keys, const uint64_t* keys) {
+    store->Get(stream, n_keys, keys, buffers.values, buffers.n, buffers.indices);
+  };
+  Time(stream, warmup, &buffers, Put);
+  const auto put = Time(stream, batches, &buffers, Put);
+  records->push_back(MakeRecord(config, "put", batches, value_size, put.first, 0));
+  const auto get = Time(stream, batches, &buffers, Get);
+  records->push_back(MakeRecord(config, "get", batches, value_size, get.first, get.second));
+}
+
+std::string MemoryKindName(CacheOptions::MemoryKind kind) {
+  return kind == CacheOptions::MemoryKind::kDevice ? "device" : "host";
+}
+
+std::string IoEngineName(PersistentTableOptions::IoEngine io_engine) {
+  return io_engine == PersistentTableOptions::IoEngine::kAio ? "aio" : "ring";
+}
+
+bool IsRingEngineAvailable() {
+#ifdef WITH_LIBURING
+  return true;
+#else
+  return false;
+#endif  // WITH_LIBURING
+}
+
+int Main() {
+  int device_count = 0;
+  if (cudaGetDeviceCount(&device_count) != cudaSuccess || device_count <= 0) {
+    LOG(ERROR) << "no cuda device";
+    return 1;
+  }
+  std::unique_ptr<ep::DeviceManagerRegistry> device_manager_registry(
+      new ep::DeviceManagerRegistry());
+  auto device = device_manager_registry->GetDevice(DeviceType::kCUDA, 0);
+  ep::Stream* stream = device->CreateStream();
+
+  const uint64_t key_space = ParseIntegerFromEnv("ONEFLOW_EMBEDDING_BENCHMARK_KEY_SPACE", 4194304);
+  const uint32_t num_keys = ParseIntegerFromEnv("ONEFLOW_EMBEDDING_BENCHMARK_NUM_KEYS", 65536);
+  const uint32_t num_batches = ParseIntegerFromEnv("ONEFLOW_EMBEDDING_BENCHMARK_NUM_BATCHES", 64);
+  const std::string table_path =
+      GetStringFromEnv("ONEFLOW_EMBEDDING_BENCHMARK_TABLE_PATH", "embedding_benchmark_tables");
+  const std::vector<Distribution> distributions{
+      {"uniform", 0}, {"zipf", 0.8}, {"zipf", 1.05}, {"zipf", 1.2}};
+  const std::vector<uint32_t> value_sizes{64, 128, 512};
+  const std::vector<double> cache_ratios{0.01, 0.1, 0.5};
+  const std::vector<CacheOptions::MemoryKind> memory_kinds{CacheOptions::MemoryKind::kDevice,
+                                                           CacheOptions::MemoryKind::kHost};
+  std::vector<PersistentTableOptions::IoEngine> io_engines{PersistentTableOptions::IoEngine::kAio};
+  if (IsRingEngineAvailable()) { io_engines.push_back(PersistentTableOptions::IoEngine::kRing); }
+
+  std::vector<nlohmann::json> records;
+  for (const auto& distribution : distributions) {
+    KeyGenerator generator(distribution, key_space);
+    Batches warmup(&generator, num_batches, num_keys);
+    Batches batches(&generator, num_batches, num_keys);
+    nlohmann::json base;
+    base["distribution"] = distribution.name;
+    base["alpha"] = distribution.alpha;
+    base["key_space"] = key_space;
+    base["num_keys_per_query"] = num_keys;
+    for (const uint32_t value_size : value_sizes) {
+      for (const auto memory_kind : memory_kinds) {
+        for (const double cache_ratio : cache_ratios) {
+          CacheOptions options{};
+          options.policy = CacheOptions::Policy::kLRU;
+          options.key_size = sizeof(uint64_t);
+          options.value_size = value_size;
+          options.value_memory_kind = memory_kind;
+          options.capacity = key_space * cache_ratio;
+          nlohmann::json config = base;
+          config["target"] = "lru_cache";
+          config["value_size"] = value_size;
+          config["memory_kind"] = MemoryKindName(memory_kind);
+          config["cache_ratio"] = cache_ratio;
+          BenchmarkCache(stream, options, num_keys, warmup, batches, config, &records);
+        }
+        // The full cache holds every key, so it is only run with a ratio of 1.
+        CacheOptions options{};
+        options.policy = CacheOptions::Policy::kFull;
+        options.key_size = sizeof(uint64_t);
+        options.value_size = value_size;
+        options.value_memory_kind = memory_kind;
+        options.capacity = key_space + 1;
+        nlohmann::json config = base;
+        config["target"] = "full_cache";
+        config["value_size"] = value_size;
+        config["memory_kind"] = MemoryKindName(memory_kind);
+        config["cache_ratio"] = 1.0;
+        BenchmarkCache(stream, options, num_keys, warmup, batches, config, &records);
+      }
+      for (const auto io_engine : io_engines) {
+        const std::string path = table_path + "/" + std::to_string(records.size());
+        {
+          PersistentTableKeyValueStoreOptions options{};
+          options.table_options.path = path;
+          options.table_options.key_size = sizeof(uint64_t);
+          options.table_options.value_size = value_size;
+          options.table_options.io_engine = io_engine;
+          nlohmann::json config = base;
+          config["target"] = "persistent_table_key_value_store";
+          config["value_size"] = value_size;
+          config["io_engine"] = IoEngineName(io_engine);
+          BenchmarkStore(stream, options, num_keys, warmup, batches, config, &records);
+        }
+        PosixFile::RecursiveDelete(path);
+      }
+    }
+  }
+  device->DestroyStream(stream);
+
+  const std::string output = GetStringFromEnv("ONEFLOW_EMBEDDING_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+int main() {
+#ifdef WITH_CUDA
+  return oneflow::embedding::Main();
+#else
+  LOG(ERROR) << "embedding benchmark requires CUDA";
+  return 1;
+#endif  // WITH_CUDA
+}
@@ -0,0 +1,158 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/embedding/cached_key_value_store.h"
+#include "oneflow/core/embedding/persistent_table_key_value_store.h"
+#include "oneflow/core/embedding/quantized_key_value_store.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+#ifdef WITH_CUDA
+
+namespace {
+
+// The stores leave work in flight on the stream of a call when it returns. Calls coming from
+// different streams, such as the prefetch running on a stream of its own and the lookups on the
+// compute stream, are ordered by making each stream wait for the last call of the other.
+class StreamOrderedKeyValueStore final : public KeyValueStore {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StreamOrderedKeyValueStore);
+  explicit StreamOrderedKeyValueStore(std::unique_ptr<KeyValueStore>&& store)
+      : store_(std::move(store)), device_index_(-1), last_stream_(nullptr) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    OF_CUDA_CHECK(cudaEventCreateWithFlags(&last_call_done_, cudaEventDisableTiming));
+  }
+  ~StreamOrderedKeyValueStore() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    OF_CUDA_CHECK(cudaEventDestroy(last_call_done_));
+  }
+
+  uint32_t KeySize() const override { return store_->KeySize(); }
+  uint32_t ValueSize() const override { return store_->ValueSize(); }
+  uint32_t MaxQueryLength() const override { return store_->MaxQueryLength(); }
+  void ReserveQueryLength(uint32_t query_length) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    store_->ReserveQueryLength(query_length);
+  }
+
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint32_t* n_missing, uint32_t* missing_indices) override {
+    RunOrdered(stream, [&]() {
+      store_->Get(stream, num_keys, keys, values, n_missing, missing_indices);
+    });
+  }
+  void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override {
+    RunOrdered(stream, [&]() { store_->Put(stream, num_keys, keys, values); });
+  }
+  void Prefetch(ep::Stream* stream, uint32_t num_keys, const void* keys) override {
+    RunOrdered(stream, [&]() { store_->Prefetch(stream, num_keys, keys); });
+  }
+  bool SupportsUpdate() const override { return store_->SupportsUpdate(); }
+  void Update(ep::Stream* stream, uint32_t num_keys, const void* keys, const float* model_diff,
+              const SparseUpdateOptions& options, uint32_t* n_missing,
+              uint32_t* missing_indices) override {
+    RunOrdered(stream, [&]() {
+      store_->Update(stream, num_keys, keys, model_diff, options, n_missing, missing_indices);
+    });
+  }
+  bool SnapshotExists(const std::string& name) override { return store_->SnapshotExists(name); }
+  void LoadSnapshot(const std::string& name) override { store_->LoadSnapshot(name); }
+  void LoadSnapshot(const std::string& name,
+                    const std::function<void(KVIterator* iter)>& Hook) override {
+    store_->LoadSnapshot(name, Hook);
+  }
+  void SaveSnapshot(const std::string& name) override { store_->SaveSnapshot(name); }
+  void GetStatistics(KeyValueStoreStatistics* statistics) const override {
+    store_->GetStatistics(statistics);
+  }
+  void ResetStatistics() override { store_->ResetStatistics(); }
+  void SetCurrentStep(uint64_t step) override { store_->SetCurrentStep(step); }
+  uint64_t EvictExpired() override { return store_->EvictExpired(); }
+
+ private:
+  template<typename F>
+  void RunOrdered(ep::Stream* stream, const F& f) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+    if (last_stream_ != nullptr && last_stream_ != cuda_stream) {
+      OF_CUDA_CHECK(cudaStreamWaitEvent(cuda_stream, last_call_done_, 0));
+    }
+    f();
+    OF_CUDA_CHECK(cudaEventRecord(last_call_done_, cuda_stream));
+    last_stream_ = cuda_stream;
+  }
+
+  std::unique_ptr<KeyValueStore> store_;
+  int device_index_;
+  std::mutex mutex_;
+  cudaStream_t last_stream_;
+  cudaEvent_t last_call_done_{};
+};
+
+}  // namespace
+
+KeyValueStore* EmbeddingManager::GetKeyValueStore(const std::string& embedding_name,
+                                                  int64_t rank_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = key_value_store_map_.find(std::make_pair(embedding_name, rank_id));
+  CHECK(it != key_value_store_map_.end())
+      << "Can not find embedding: " << embedding_name << "-" << rank_id;
+  return it->second.get();
+}
+
+KeyValueStore* EmbeddingManager::GetOrCreateKeyValueStore(const KeyValueStoreOptions& options,
+                                                          int64_t rank_id, int64_t world_size,
+                                                          uint32_t max_query_length) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = std::make_pair(options.Name(), rank_id);
+  auto it = key_value_store_map_.find(key);
+  if (it == key_value_store_map_.end()) {
+    PersistentTableKeyValueStoreOptions store_options{};
+    store_options.table_options.path = options.PersistentTablePath(rank_id, world_size);
+    store_options.table_options.value_paths =
+        options.PersistentTableValuePaths(rank_id, world_size);
+    store_options.table_options.key_size = options.KeySize();
+    store_options.table_options.value_size = options.StoredValueSize();
+    store_options.table_options.physical_block_size = options.PersistentTablePhysicalBlockSize();
+    store_options.table_options.incremental_snapshot = options.PersistentTableIncrementalSnapshot();
+    store_options.table_options.max_snapshot_chain_length =
+        options.PersistentTableMaxSnapshotChainLength();
+    store_options.table_options.ttl = options.PersistentTableTtl();
+    std::unique_ptr<KeyValueStore> store = NewPersistentTableKeyValueStore(store_options);
+    std::vector<std::unique_ptr<Cache>> caches;
+    for (const auto& cache_options : options.Caches()) {
+      caches.push_back(NewCache(cache_options));
+    }
+    if (!caches.empty()) { store = NewMultiTierKeyValueStore(std::move(store), std::move(caches)); }
+    if (options.IsQuantized()) {
+      store = NewQuantizedKeyValueStore(std::move(store), options.QuantizedOptions());
+    }
+    store.reset(new StreamOrderedKeyValueStore(std::move(store)));
+    it = key_value_store_map_.emplace(key, std::move(store)).first;
+  }
+  it->second->ReserveQueryLength(max_query_length);
+  return it->second.get();
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace embedding
+
+}  // namespace oneflow
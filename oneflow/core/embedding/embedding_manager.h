@@ -0,0 +1,52 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_EMBEDDING_MANAGER_H_
+#define ONEFLOW_CORE_EMBEDDING_EMBEDDING_MANAGER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/embedding/key_value_store.h"
+#include "oneflow/core/embedding/key_value_store_options.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+#ifdef WITH_CUDA
+
+// Owns the stores of the embedding tables of this process, so that all the ops of one embedding
+// (prefetch, lookup, update, ...) running on the same rank share one store.
+class EmbeddingManager final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(EmbeddingManager);
+  EmbeddingManager() = default;
+  ~EmbeddingManager() = default;
+
+  KeyValueStore* GetKeyValueStore(const std::string& embedding_name, int64_t rank_id);
+  KeyValueStore* GetOrCreateKeyValueStore(const KeyValueStoreOptions& options, int64_t rank_id,
+                                          int64_t world_size, uint32_t max_query_length);
+
+ private:
+  HashMap<std::pair<std::string, int64_t>, std::unique_ptr<KeyValueStore>> key_value_store_map_;
+  std::mutex mutex_;
+};
+
+#endif  // WITH_CUDA
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_EMBEDDING_MANAGER_H_
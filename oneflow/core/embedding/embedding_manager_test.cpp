@@ -0,0 +1,141 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/device/cuda_util.h"
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef WITH_CUDA
+
+bool HasCudaDevice() {
+  int device_count = 0;
+  if (cudaGetDeviceCount(&device_count) != cudaSuccess) { return false; }
+  if (device_count <= 0) { return false; }
+  return true;
+}
+
+// Value files are opened with O_DIRECT, which tmpfs does not support, so stay off /tmp.
+std::string CreateTempDirectory() {
+  char tmpl[] = "embedding_manager_test_XXXXXX";
+  CHECK(mkdtemp(tmpl) != nullptr);
+  return tmpl;
+}
+
+KeyValueStoreOptions GetOptions(const std::string& name, const std::string& path) {
+  const std::string json = "{\"name\": \"" + name + "\", \"key_size\": 8, \"value_size\": 64, "
+                           "\"caches\": [{\"policy\": \"lru\", \"capacity\": 65536, "
+                           "\"value_memory_kind\": \"device\"}], "
+                           "\"persistent_table\": {\"path\": \"" + path + "\", "
+                           "\"physical_block_size\": 512}}";
+  return KeyValueStoreOptions(json);
+}
+
+TEST(EmbeddingManager, GetOrCreateKeyValueStore) {
+  if (!HasCudaDevice()) { return; }
+  Global<ep::DeviceManagerRegistry>::New();
+  {
+    const std::string path = CreateTempDirectory();
+    EmbeddingManager manager;
+    const KeyValueStoreOptions options = GetOptions("embedding", path);
+    KeyValueStore* store = manager.GetOrCreateKeyValueStore(options, 0, 2, 128);
+    ASSERT_EQ(store->KeySize(), 8);
+    ASSERT_EQ(store->ValueSize(), 64);
+    ASSERT_GE(store->MaxQueryLength(), 128);
+    ASSERT_EQ(manager.GetOrCreateKeyValueStore(options, 0, 2, 256), store);
+    ASSERT_GE(store->MaxQueryLength(), 256);
+    ASSERT_EQ(manager.GetKeyValueStore("embedding", 0), store);
+    KeyValueStore* other_rank_store = manager.GetOrCreateKeyValueStore(options, 1, 2, 128);
+    ASSERT_NE(other_rank_store, store);
+    ASSERT_EQ(manager.GetKeyValueStore("embedding", 1), other_rank_store);
+  }
+  Global<ep::DeviceManagerRegistry>::Delete();
+}
+
+TEST(EmbeddingManager, PrefetchOnSideStream) {
+  if (!HasCudaDevice()) { return; }
+  Global<ep::DeviceManagerRegistry>::New();
+  {
+    auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA, 0);
+    ep::Stream* stream = device->CreateStream();
+    ep::Stream* prefetch_stream = device->CreateStream();
+    const std::string path = CreateTempDirectory();
+    EmbeddingManager manager;
+    const uint32_t num_keys = 1024;
+    const uint32_t num_elems = 16;
+    KeyValueStore* store =
+        manager.GetOrCreateKeyValueStore(GetOptions("embedding", path), 0, 1, num_keys);
+    std::vector<int64_t> keys(num_keys);
+    std::vector<float> values(num_keys * num_elems);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+      keys.at(i) = i * 7 + 1;
+      for (uint32_t j = 0; j < num_elems; ++j) { values.at(i * num_elems + j) = i + j * 0.5f; }
+    }
+    const size_t values_size = values.size() * sizeof(float);
+    int64_t* d_keys;
+    float* d_values;
+    uint32_t* d_n_missing;
+    uint32_t* d_missing_indices;
+    OF_CUDA_CHECK(cudaMalloc(&d_keys, num_keys * sizeof(int64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_values, values_size));
+    OF_CUDA_CHECK(cudaMalloc(&d_n_missing, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_missing_indices, num_keys * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMemcpy(d_keys, keys.data(), num_keys * sizeof(int64_t), cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(d_values, values.data(), values_size, cudaMemcpyDefault));
+    store->Put(stream, num_keys, d_keys, d_values);
+    CHECK_JUST(stream->Sync());
+    // Round trip through a snapshot leaves the rows in the table only, with the cache empty.
+    store->SaveSnapshot("prefetch");
+    store->LoadSnapshot("prefetch");
+    store->ResetStatistics();
+    OF_CUDA_CHECK(cudaMemset(d_values, 0, values_size));
+    // The prefetch is issued on its own stream, the store orders the Get after it.
+    store->Prefetch(prefetch_stream, num_keys, d_keys);
+    store->Get(stream, num_keys, d_keys, d_values, d_n_missing, d_missing_indices);
+    CHECK_JUST(stream->Sync());
+    uint32_t n_missing = 0;
+    OF_CUDA_CHECK(cudaMemcpy(&n_missing, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+    ASSERT_EQ(n_missing, 0);
+    std::vector<float> got(values.size());
+    OF_CUDA_CHECK(cudaMemcpy(got.data(), d_values, values_size, cudaMemcpyDefault));
+    ASSERT_EQ(got, values);
+    KeyValueStoreStatistics statistics;
+    store->GetStatistics(&statistics);
+    ASSERT_EQ(statistics.caches.size(), 1);
+    ASSERT_EQ(statistics.caches.at(0).num_queries, num_keys);
+    ASSERT_EQ(statistics.caches.at(0).num_misses, 0);
+    OF_CUDA_CHECK(cudaFree(d_keys));
+    OF_CUDA_CHECK(cudaFree(d_values));
+    OF_CUDA_CHECK(cudaFree(d_n_missing));
+    OF_CUDA_CHECK(cudaFree(d_missing_indices));
+    device->DestroyStream(prefetch_stream);
+    device->DestroyStream(stream);
+  }
+  Global<ep::DeviceManagerRegistry>::Delete();
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace
+
+}  // namespace embedding
+
+}  // namespace oneflow
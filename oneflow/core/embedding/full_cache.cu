@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/embedding/full_cache.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/embedding/sparse_update.cuh"
 #include "oneflow/core/cuda/atomic.cuh"
 
 namespace oneflow {
@@ -99,13 +100,36 @@ __device__ bool GetOne(const size_t capacity, TableEntry<Key, Index>* table, Key
   return false;
 }
 
+template<typename Key, typename Index>
+__device__ void InsertOne(const size_t capacity, TableEntry<Key, Index>* table, Key entry_key,
+                          Index entry_index, size_t hash) {
+  const size_t start_idx = hash % capacity;
+  for (size_t count = 0; count < capacity; ++count) {
+    const size_t idx = (start_idx + count) % capacity;
+    Key old_entry_key = cuda::atomic::CAS(&table[idx].key, static_cast<Key>(0), entry_key);
+    if (old_entry_key == static_cast<Key>(0)) {
+      *static_cast<volatile Index*>(&table[idx].index) = entry_index;
+      return;
+    }
+  }
+  assert(false);
+}
+
+// While the encoder is growing, keys not yet migrated are only in old_table, which is no longer
+// inserted into, so looking it up first keeps every key encoded once.
 template<typename Key, typename Index>
 __global__ void OrdinalEncodeKernel(uint64_t capacity, TableEntry<Key, Index>* table,
+                                    uint64_t old_capacity, const TableEntry<Key, Index>* old_table,
                                     uint64_t* table_size, uint32_t num_keys, const Key* keys,
                                     uint64_t* context) {
   CUDA_1D_KERNEL_LOOP(i, num_keys) {
     Key key = keys[i];
     uint64_t hash = FullCacheHash()(key);
+    if (old_table != nullptr
+        && GetOne<Key, Index>(old_capacity, const_cast<TableEntry<Key, Index>*>(old_table), key,
+                              hash, context + i)) {
+      continue;
+    }
     bool success = GetOrInsertOne<Key, Index>(capacity, table, table_size, key, hash, context + i);
     assert(success);
   }
@@ -113,11 +137,29 @@ __global__ void OrdinalEncodeKernel(uint64_t capacity, TableEntry<Key, Index>* t
 
 template<typename Key, typename Index>
 __global__ void OrdinalEncodeLookupKernel(uint64_t capacity, TableEntry<Key, Index>* table,
+                                          uint64_t old_capacity,
+                                          const TableEntry<Key, Index>* old_table,
                                           uint32_t num_keys, const Key* keys, uint64_t* context) {
   CUDA_1D_KERNEL_LOOP(i, num_keys) {
     Key key = keys[i];
     uint64_t hash = FullCacheHash()(key);
-    GetOne<Key, Index>(capacity, table, key, hash, context + i);
+    if (!GetOne<Key, Index>(capacity, table, key, hash, context + i) && old_table != nullptr) {
+      GetOne<Key, Index>(old_capacity, const_cast<TableEntry<Key, Index>*>(old_table), key, hash,
+                         context + i);
+    }
+  }
+}
+
+template<typename Key, typename Index>
+__global__ void OrdinalEncodeMigrateKernel(const TableEntry<Key, Index>* old_table,
+                                           uint64_t start_index, uint64_t end_index,
+                                           uint64_t capacity, TableEntry<Key, Index>* table) {
+  CUDA_1D_KERNEL_LOOP(i, (end_index - start_index)) {
+    TableEntry<Key, Index> entry = old_table[i + start_index];
+    if (entry.index != 0) {
+      const Key key = ((entry.key ^ 0x1) | (entry.index & 0x1));
+      InsertOne<Key, Index>(capacity, table, entry.key, entry.index, FullCacheHash()(key));
+    }
   }
 }
 
@@ -135,11 +177,25 @@ __global__ void OrdinalEncodeDumpKernel(const TableEntry<Key, Index>* table,
   }
 }
 
+// The values are kept in segments of equal rows that never move, so that growing the cache only
+// allocates new segments.
+template<typename Elem>
+struct SegmentedValues {
+  Elem* const* segments;
+  uint64_t segment_rows;
+  uint32_t value_length;
+
+  __device__ Elem* Row(uint64_t row_id) const {
+    const uint64_t segment_id = row_id / segment_rows;
+    return segments[segment_id] + (row_id - segment_id * segment_rows) * value_length;
+  }
+};
+
 template<typename Key, typename Elem, bool return_value>
-__global__ void LookupKernel(uint32_t value_length, const Elem* cache_values,
-                             uint32_t values_elem_cnt, const Key* keys, const uint64_t* context,
-                             Elem* values, uint32_t* n_missing, Key* missing_keys,
-                             uint32_t* missing_indices) {
+__global__ void LookupKernel(SegmentedValues<Elem> cache_values, uint32_t values_elem_cnt,
+                             const Key* keys, const uint64_t* context, Elem* values,
+                             uint32_t* n_missing, Key* missing_keys, uint32_t* missing_indices) {
+  const uint32_t value_length = cache_values.value_length;
   CUDA_1D_KERNEL_LOOP(i, values_elem_cnt) {
     const uint64_t key_id = i / value_length;
     const uint64_t ctx = context[key_id];
@@ -154,13 +210,14 @@ __global__ void LookupKernel(uint32_t value_length, const Elem* cache_values,
       }
       continue;
     }
-    if (return_value) { values[i] = cache_values[row_id * value_length + col_id]; }
+    if (return_value) { values[i] = cache_values.Row(row_id)[col_id]; }
   }
 }
 
 template<typename Elem>
-__global__ void UpdateKernel(uint32_t value_length, Elem* cache_values, uint32_t values_elem_cnt,
+__global__ void UpdateKernel(SegmentedValues<Elem> cache_values, uint32_t values_elem_cnt,
                              const uint64_t* context, const Elem* values) {
+  const uint32_t value_length = cache_values.value_length;
   CUDA_1D_KERNEL_LOOP(i, values_elem_cnt) {
     const uint64_t key_id = i / value_length;
     const uint64_t ctx = context[key_id];
@@ -168,28 +225,62 @@ __global__ void UpdateKernel(uint32_t value_length, Elem* cache_values, uint32_t
     const uint64_t row_id = ctx - 1;
     const uint64_t col_id = i - key_id * value_length;
     const Elem elem = values[i];
-    cache_values[row_id * value_length + col_id] = elem;
+    cache_values.Row(row_id)[col_id] = elem;
+  }
+}
+
+template<typename Key, typename Elem, SparseUpdateOptions::Optimizer optimizer>
+__global__ void SparseUpdateKernel(SegmentedValues<Elem> cache_values, uint32_t diff_elem_cnt,
+                                   SparseUpdateOptions options, const Key* keys,
+                                   const uint64_t* context, const float* model_diff,
+                                   uint32_t* n_missing, Key* missing_keys,
+                                   uint32_t* missing_indices) {
+  const uint32_t embedding_size = options.embedding_size;
+  CUDA_1D_KERNEL_LOOP(i, diff_elem_cnt) {
+    const uint64_t key_id = i / embedding_size;
+    const uint64_t ctx = context[key_id];
+    const uint64_t col_id = i - key_id * embedding_size;
+    if (ctx == 0) {
+      if (col_id == 0) {
+        const uint32_t old_n_missing = cuda::atomic::Add(n_missing, static_cast<uint32_t>(1));
+        missing_keys[old_n_missing] = keys[key_id];
+        missing_indices[old_n_missing] = key_id;
+      }
+      continue;
+    }
+    float* row = reinterpret_cast<float*>(cache_values.Row(ctx - 1));
+    SparseUpdateElem<optimizer>(options, row + col_id, model_diff[i]);
   }
 }
 
 template<typename Key, typename Elem>
-__global__ void DumpValueKernel(uint32_t value_length, const uint32_t* n_dumped,
-                                const uint64_t* context, const Elem* cache_values, Elem* values) {
+__global__ void DumpValueKernel(SegmentedValues<Elem> cache_values, const uint32_t* n_dumped,
+                                const uint64_t* context, Elem* values) {
+  const uint32_t value_length = cache_values.value_length;
   CUDA_1D_KERNEL_LOOP(i, *n_dumped * value_length) {
     const uint64_t key_id = i / value_length;
     const uint64_t ctx = context[key_id];
     const uint64_t row_id = ctx - 1;
     const uint64_t col_id = i - key_id * value_length;
-    values[i] = cache_values[row_id * value_length + col_id];
+    values[i] = cache_values.Row(row_id)[col_id];
   }
 }
 
+// Buckets of the old table migrated by each query while the encoder is growing.
+constexpr uint64_t kMinMigrationBucketsPerStep = 1 << 20;
+constexpr uint64_t kNumMigrationSteps = 32;
+
 template<typename Key, typename Index>
 class OrdinalEncoder {
  public:
   OF_DISALLOW_COPY_AND_MOVE(OrdinalEncoder);
   explicit OrdinalEncoder(uint64_t capacity, float load_factor)
-      : capacity_(capacity), table_capacity_(capacity / load_factor) {
+      : capacity_(capacity),
+        load_factor_(load_factor),
+        table_capacity_(capacity / load_factor),
+        old_table_(nullptr),
+        old_table_capacity_(0),
+        migration_cursor_(0) {
     OF_CUDA_CHECK(cudaGetDevice(&device_index_));
     OF_CUDA_CHECK(cudaMalloc(&table_size_, sizeof(uint64_t)));
     OF_CUDA_CHECK(cudaMallocHost(&table_size_host_, sizeof(uint64_t)));
@@ -201,13 +292,16 @@ class OrdinalEncoder {
     OF_CUDA_CHECK(cudaFree(table_size_));
     OF_CUDA_CHECK(cudaFreeHost(table_size_host_));
     OF_CUDA_CHECK(cudaFree(table_));
+    if (old_table_ != nullptr) { OF_CUDA_CHECK(cudaFree(old_table_)); }
   }
 
   template<bool insert>
   void Encode(ep::Stream* stream, uint32_t num_keys, const Key* keys, uint64_t* context) {
+    MigrateStep(stream, false);
     if (insert) {
       RUN_CUDA_KERNEL((OrdinalEncodeKernel<Key, uint64_t>), stream, num_keys, table_capacity_,
-                      table_, table_size_, num_keys, keys, context);
+                      table_, old_table_capacity_, old_table_, table_size_, num_keys, keys,
+                      context);
       OF_CUDA_CHECK(cudaMemcpyAsync(table_size_host_, table_size_, sizeof(uint64_t),
                                     cudaMemcpyDefault,
                                     stream->As<ep::CudaStream>()->cuda_stream()));
@@ -216,12 +310,28 @@ class OrdinalEncoder {
           << "The number of key is larger than cache size, please enlarge cache_memory_budget. ";
     } else {
       RUN_CUDA_KERNEL((OrdinalEncodeLookupKernel<Key, uint64_t>), stream, num_keys, table_capacity_,
-                      table_, num_keys, keys, context);
+                      table_, old_table_capacity_, old_table_, num_keys, keys, context);
     }
   }
 
+  // Grows the table to hold capacity keys, the keys are migrated to the new table a few buckets
+  // per query, so that the lookups never stop for a full rehash.
+  void Reserve(ep::Stream* stream, uint64_t capacity) {
+    if (capacity <= capacity_) { return; }
+    MigrateStep(stream, true);
+    old_table_ = table_;
+    old_table_capacity_ = table_capacity_;
+    migration_cursor_ = 0;
+    capacity_ = capacity;
+    table_capacity_ = capacity / load_factor_;
+    OF_CUDA_CHECK(cudaMalloc(&table_, table_capacity_ * sizeof(TableEntry<Key, Index>)));
+    OF_CUDA_CHECK(cudaMemsetAsync(table_, 0, table_capacity_ * sizeof(TableEntry<Key, Index>),
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+  }
+
   void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
             uint32_t* n_dumped, Key* keys, uint64_t* context) {
+    MigrateStep(stream, true);
     OF_CUDA_CHECK(cudaMemsetAsync(n_dumped, 0, sizeof(uint32_t),
                                   stream->As<ep::CudaStream>()->cuda_stream()));
     RUN_CUDA_KERNEL((OrdinalEncodeDumpKernel<Key, uint64_t>), stream,
@@ -230,21 +340,57 @@ class OrdinalEncoder {
   }
 
   void Clear() {
+    if (old_table_ != nullptr) {
+      OF_CUDA_CHECK(cudaFree(old_table_));
+      old_table_ = nullptr;
+      old_table_capacity_ = 0;
+    }
     OF_CUDA_CHECK(cudaMemset(table_size_, 0, sizeof(uint64_t)));
+    *table_size_host_ = 0;
     OF_CUDA_CHECK(cudaMemset(table_, 0, table_capacity_ * sizeof(TableEntry<Key, Index>)));
   }
 
   uint64_t TableCapacity() const { return table_capacity_; }
 
+  uint64_t Capacity() const { return capacity_; }
+
+  // The number of keys encoded as of the last insertion.
+  uint64_t TableSize() const { return *table_size_host_; }
+
  private:
+  void MigrateStep(ep::Stream* stream, bool finish) {
+    if (old_table_ == nullptr) { return; }
+    const uint64_t step = finish ? old_table_capacity_ - migration_cursor_
+                                 : std::max(old_table_capacity_ / kNumMigrationSteps,
+                                            kMinMigrationBucketsPerStep);
+    const uint64_t end = std::min(migration_cursor_ + step, old_table_capacity_);
+    if (end > migration_cursor_) {
+      RUN_CUDA_KERNEL((OrdinalEncodeMigrateKernel<Key, uint64_t>), stream, end - migration_cursor_,
+                      old_table_, migration_cursor_, end, table_capacity_, table_);
+    }
+    migration_cursor_ = end;
+    if (migration_cursor_ == old_table_capacity_) {
+      CHECK_JUST(stream->Sync());
+      OF_CUDA_CHECK(cudaFree(old_table_));
+      old_table_ = nullptr;
+      old_table_capacity_ = 0;
+    }
+  }
+
   int device_index_{};
   TableEntry<Key, Index>* table_;
   uint64_t capacity_;
+  float load_factor_;
   uint64_t table_capacity_;
+  TableEntry<Key, Index>* old_table_;
+  uint64_t old_table_capacity_;
+  uint64_t migration_cursor_;
   uint64_t* table_size_{};
   uint64_t* table_size_host_{};
 };
 
+constexpr uint32_t kMaxNumValueSegments = 1024;
+
 template<typename Key, typename Elem>
 class CacheImpl : public Cache {
  public:
@@ -255,30 +401,33 @@ class CacheImpl : public Cache {
         options_(options),
         max_query_length_(0) {
     OF_CUDA_CHECK(cudaGetDevice(&device_index_));
-    const uint64_t values_size = options.capacity * options.value_size;
-    if (options.value_memory_kind == CacheOptions::MemoryKind::kDevice) {
-      OF_CUDA_CHECK(cudaMalloc(&values_, values_size));
-    } else if (options.value_memory_kind == CacheOptions::MemoryKind::kHost) {
-      OF_CUDA_CHECK(
-          NumaAwareCudaMallocHost(device_index_, reinterpret_cast<void**>(&values_), values_size));
-    } else {
-      UNIMPLEMENTED();
-    }
+    CHECK_GT(options.capacity, 0);
+    max_capacity_ = std::max(options.capacity, options.max_capacity);
+    CHECK_LE(RoundUp(max_capacity_, options.capacity) / options.capacity, kMaxNumValueSegments);
+    OF_CUDA_CHECK(cudaMalloc(&segments_, kMaxNumValueSegments * sizeof(Elem*)));
+    OF_CUDA_CHECK(cudaMallocHost(&host_segments_, kMaxNumValueSegments * sizeof(Elem*)));
+    num_segments_ = 0;
+    AllocateSegments(1);
+    OF_CUDA_CHECK(cudaMemcpy(segments_, host_segments_, sizeof(Elem*), cudaMemcpyDefault));
     num_elem_per_value_ = options_.value_size / sizeof(Elem);
   }
   ~CacheImpl() {
     CudaCurrentDeviceGuard guard(device_index_);
-    if (options_.value_memory_kind == CacheOptions::MemoryKind::kDevice) {
-      OF_CUDA_CHECK(cudaFree(values_));
-    } else if (options_.value_memory_kind == CacheOptions::MemoryKind::kHost) {
-      OF_CUDA_CHECK(cudaFreeHost(values_));
-    } else {
-      UNIMPLEMENTED();
+    for (uint32_t i = 0; i < num_segments_; ++i) {
+      if (options_.value_memory_kind == CacheOptions::MemoryKind::kDevice) {
+        OF_CUDA_CHECK(cudaFree(host_segments_[i]));
+      } else if (options_.value_memory_kind == CacheOptions::MemoryKind::kHost) {
+        OF_CUDA_CHECK(cudaFreeHost(host_segments_[i]));
+      } else {
+        UNIMPLEMENTED();
+      }
     }
+    OF_CUDA_CHECK(cudaFree(segments_));
+    OF_CUDA_CHECK(cudaFreeHost(host_segments_));
     if (max_query_length_ > 0) { OF_CUDA_CHECK(cudaFree(encoding_buffer_)); }
   }
 
-  uint64_t Capacity() const override { return options_.capacity; }
+  uint64_t Capacity() const override { return encoder_.Capacity(); }
   uint64_t DumpCapacity() const override { return encoder_.TableCapacity(); }
   uint32_t KeySize() const override { return options_.key_size; }
 
@@ -308,13 +457,57 @@ class CacheImpl : public Cache {
   void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
             uint32_t* n_dumped, void* keys, void* values) override;
 
+  bool SupportsUpdate() const override { return true; }
+
+  void Update(ep::Stream* stream, uint32_t n_keys, const void* keys, const float* model_diff,
+              const SparseUpdateOptions& options, uint32_t* n_missing, void* missing_keys,
+              uint32_t* missing_indices) override;
+
   void Clear() override;
 
  private:
+  SegmentedValues<Elem> Values() const {
+    return SegmentedValues<Elem>{segments_, options_.capacity, num_elem_per_value_};
+  }
+
+  void AllocateSegments(uint32_t num_segments) {
+    const uint64_t segment_size = options_.capacity * options_.value_size;
+    for (; num_segments_ < num_segments; ++num_segments_) {
+      void* ptr = nullptr;
+      if (options_.value_memory_kind == CacheOptions::MemoryKind::kDevice) {
+        OF_CUDA_CHECK(cudaMalloc(&ptr, segment_size));
+      } else if (options_.value_memory_kind == CacheOptions::MemoryKind::kHost) {
+        OF_CUDA_CHECK(NumaAwareCudaMallocHost(device_index_, &ptr, segment_size));
+      } else {
+        UNIMPLEMENTED();
+      }
+      host_segments_[num_segments_] = static_cast<Elem*>(ptr);
+    }
+  }
+
+  // Doubles the capacity until the keys to be inserted fit, up to max_capacity.
+  void MaybeGrow(ep::Stream* stream, uint32_t n_keys) {
+    const uint64_t required = encoder_.TableSize() + n_keys + 1;
+    if (required <= encoder_.Capacity() || encoder_.Capacity() >= max_capacity_) { return; }
+    uint64_t capacity = encoder_.Capacity();
+    while (capacity < required && capacity < max_capacity_) {
+      capacity = std::min(capacity * 2, max_capacity_);
+    }
+    const uint32_t old_num_segments = num_segments_;
+    AllocateSegments(RoundUp(capacity, options_.capacity) / options_.capacity);
+    OF_CUDA_CHECK(cudaMemcpyAsync(segments_ + old_num_segments, host_segments_ + old_num_segments,
+                                  (num_segments_ - old_num_segments) * sizeof(Elem*),
+                                  cudaMemcpyDefault, stream->As<ep::CudaStream>()->cuda_stream()));
+    encoder_.Reserve(stream, capacity);
+  }
+
   OrdinalEncoder<Key, uint64_t> encoder_;
   int device_index_;
   uint32_t num_elem_per_value_{};
-  Elem* values_;
+  Elem** segments_{};
+  Elem** host_segments_{};
+  uint32_t num_segments_{};
+  uint64_t max_capacity_{};
   uint64_t* encoding_buffer_{};
   CacheOptions options_;
   uint32_t max_query_length_;
@@ -330,9 +523,9 @@ void CacheImpl<Key, Elem>::Test(ep::Stream* stream, uint32_t n_keys, const void*
   CHECK_LE(n_keys, max_query_length_);
   encoder_.template Encode<false>(stream, n_keys, static_cast<const Key*>(keys), encoding_buffer_);
   const uint32_t values_elem_cnt = n_keys * num_elem_per_value_;
-  RUN_CUDA_KERNEL((LookupKernel<Key, Elem, false>), stream, values_elem_cnt, num_elem_per_value_,
-                  values_, values_elem_cnt, static_cast<const Key*>(keys), encoding_buffer_,
-                  nullptr, n_missing, static_cast<Key*>(missing_keys), missing_indices);
+  RUN_CUDA_KERNEL((LookupKernel<Key, Elem, false>), stream, values_elem_cnt, Values(),
+                  values_elem_cnt, static_cast<const Key*>(keys), encoding_buffer_, nullptr,
+                  n_missing, static_cast<Key*>(missing_keys), missing_indices);
 }
 
 template<typename Key, typename Elem>
@@ -344,8 +537,8 @@ void CacheImpl<Key, Elem>::Get(ep::Stream* stream, uint32_t n_keys, const void*
   CHECK_LE(n_keys, max_query_length_);
   encoder_.template Encode<false>(stream, n_keys, static_cast<const Key*>(keys), encoding_buffer_);
   const uint32_t values_elem_cnt = n_keys * num_elem_per_value_;
-  RUN_CUDA_KERNEL((LookupKernel<Key, Elem, true>), stream, values_elem_cnt, num_elem_per_value_,
-                  values_, values_elem_cnt, static_cast<const Key*>(keys), encoding_buffer_,
+  RUN_CUDA_KERNEL((LookupKernel<Key, Elem, true>), stream, values_elem_cnt, Values(),
+                  values_elem_cnt, static_cast<const Key*>(keys), encoding_buffer_,
                   static_cast<Elem*>(values), n_missing, static_cast<Key*>(missing_keys),
                   missing_indices);
 }
@@ -358,10 +551,11 @@ void CacheImpl<Key, Elem>::Put(ep::Stream* stream, uint32_t n_keys, const void*
       cudaMemsetAsync(n_evicted, 0, sizeof(uint32_t), stream->As<ep::CudaStream>()->cuda_stream()));
   if (n_keys == 0) { return; }
   CHECK_LE(n_keys, max_query_length_);
+  MaybeGrow(stream, n_keys);
   encoder_.template Encode<true>(stream, n_keys, static_cast<const Key*>(keys), encoding_buffer_);
   const uint32_t values_elem_cnt = n_keys * num_elem_per_value_;
-  RUN_CUDA_KERNEL((UpdateKernel<Elem>), stream, values_elem_cnt, num_elem_per_value_, values_,
-                  values_elem_cnt, encoding_buffer_, static_cast<const Elem*>(values));
+  RUN_CUDA_KERNEL((UpdateKernel<Elem>), stream, values_elem_cnt, Values(), values_elem_cnt,
+                  encoding_buffer_, static_cast<const Elem*>(values));
 }
 
 template<typename Key, typename Elem>
@@ -371,8 +565,40 @@ void CacheImpl<Key, Elem>::Dump(ep::Stream* stream, uint64_t start_key_index,
   encoder_.Dump(stream, start_key_index, end_key_index, n_dumped, static_cast<Key*>(keys),
                 encoding_buffer_);
   RUN_CUDA_KERNEL((DumpValueKernel<Key, Elem>), stream,
-                  num_elem_per_value_ * (end_key_index - start_key_index), num_elem_per_value_,
-                  n_dumped, encoding_buffer_, values_, static_cast<Elem*>(values));
+                  num_elem_per_value_ * (end_key_index - start_key_index), Values(), n_dumped,
+                  encoding_buffer_, static_cast<Elem*>(values));
+}
+
+template<typename Key, typename Elem>
+void CacheImpl<Key, Elem>::Update(ep::Stream* stream, uint32_t n_keys, const void* keys,
+                                  const float* model_diff, const SparseUpdateOptions& options,
+                                  uint32_t* n_missing, void* missing_keys,
+                                  uint32_t* missing_indices) {
+  OF_CUDA_CHECK(
+      cudaMemsetAsync(n_missing, 0, sizeof(uint32_t), stream->As<ep::CudaStream>()->cuda_stream()));
+  if (n_keys == 0) { return; }
+  CHECK_LE(n_keys, max_query_length_);
+  CHECK_GT(options.embedding_size, 0);
+  CHECK_LE((1 + NumOptimizerStates(options.optimizer)) * options.embedding_size * sizeof(float),
+           options_.value_size);
+  encoder_.template Encode<false>(stream, n_keys, static_cast<const Key*>(keys), encoding_buffer_);
+  const uint32_t diff_elem_cnt = n_keys * options.embedding_size;
+#define LAUNCH_SPARSE_UPDATE_KERNEL(optimizer)                                                    \
+  RUN_CUDA_KERNEL((SparseUpdateKernel<Key, Elem, optimizer>), stream, diff_elem_cnt, Values(),   \
+                  diff_elem_cnt, options, static_cast<const Key*>(keys), encoding_buffer_,       \
+                  model_diff, n_missing, static_cast<Key*>(missing_keys), missing_indices)
+  if (options.optimizer == SparseUpdateOptions::Optimizer::kSGD) {
+    LAUNCH_SPARSE_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kSGD);
+  } else if (options.optimizer == SparseUpdateOptions::Optimizer::kMomentum) {
+    LAUNCH_SPARSE_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kMomentum);
+  } else if (options.optimizer == SparseUpdateOptions::Optimizer::kAdam) {
+    LAUNCH_SPARSE_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kAdam);
+  } else if (options.optimizer == SparseUpdateOptions::Optimizer::kAdagrad) {
+    LAUNCH_SPARSE_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kAdagrad);
+  } else {
+    UNIMPLEMENTED();
+  }
+#undef LAUNCH_SPARSE_UPDATE_KERNEL
 }
 
 template<typename Key, typename Elem>
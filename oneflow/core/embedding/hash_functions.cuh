@@ -64,6 +64,8 @@ static const size_t kLocalUniqueHashSeed = 2;
 static const size_t kGlobalUniqueHashSeed = 3;
 static const size_t kFullCacheHashSeed = 4;
 static const size_t kLruCacheHashSeed = 5;
+static const size_t kLfuCacheHashSeed = 6;
+static const size_t kLfuSketchHashSeed = 7;
 
 }  // namespace
 
@@ -97,6 +99,18 @@ struct LruCacheHash {
   }
 };
 
+struct LfuCacheHash {
+  __device__ __host__ __forceinline__ size_t operator()(uint64_t v) {
+    return xxh64_uint64(v, kLfuCacheHashSeed);
+  }
+};
+
+struct LfuSketchHash {
+  __device__ __host__ __forceinline__ size_t operator()(uint64_t v, uint32_t row) {
+    return xxh64_uint64(v, kLfuSketchHashSeed + row);
+  }
+};
+
 }  // namespace embedding
 }  // namespace oneflow
 #endif  // ONEFLOW_CORE_EMBEDDING_HASH_FUNCTION_H_
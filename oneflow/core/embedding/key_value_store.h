@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_EMBEDDING_KEY_VALUE_STORE_H_
 
 #include "oneflow/core/embedding/kv_iterator.h"
+#include "oneflow/core/embedding/cache.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/ep/include/stream.h"
 
@@ -24,6 +25,21 @@ namespace oneflow {
 
 namespace embedding {
 
+// Lookups received by one cache tier through Get, the ones of Prefetch are not counted.
+struct CacheStatistics {
+  uint64_t num_queries = 0;
+  uint64_t num_hits = 0;
+  uint64_t num_misses = 0;
+  uint64_t num_evictions = 0;
+};
+
+struct KeyValueStoreStatistics {
+  // One entry for each cache tier, from the first tier to be queried.
+  std::vector<CacheStatistics> caches;
+  uint64_t num_store_block_reads = 0;
+  uint64_t num_store_block_writes = 0;
+};
+
 class KeyValueStore {
  public:
   OF_DISALLOW_COPY_AND_MOVE(KeyValueStore);
@@ -38,11 +54,33 @@ class KeyValueStore {
   virtual void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
                    uint32_t* n_missing, uint32_t* missing_indices) = 0;
   virtual void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) = 0;
+  // Brings the rows of the keys into the faster tiers of the store ahead of the Get that needs
+  // them, keys not in the store are ignored. The stores of EmbeddingManager order the calls made
+  // from different streams, so the prefetch may run on a stream of its own.
+  virtual void Prefetch(ep::Stream* stream, uint32_t num_keys, const void* keys) = 0;
+  // Applies the sparse optimizer update of unique keys in place when the first tier can, see
+  // Cache::Update. The keys it does not hold are reported as by Get, the caller updates them
+  // through Get and Put.
+  virtual bool SupportsUpdate() const { return false; }
+  virtual void Update(ep::Stream* stream, uint32_t num_keys, const void* keys,
+                      const float* model_diff, const SparseUpdateOptions& options,
+                      uint32_t* n_missing, uint32_t* missing_indices) {
+    UNIMPLEMENTED();
+  }
   virtual bool SnapshotExists(const std::string& name) = 0;
   virtual void LoadSnapshot(const std::string& name) = 0;
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(KVIterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  // Counters accumulated since construction or the last ResetStatistics, both are cheap and safe
+  // to call from other threads while the store is serving.
+  virtual void GetStatistics(KeyValueStoreStatistics* statistics) const = 0;
+  virtual void ResetStatistics() = 0;
+  // Expiry of the rows not accessed in the last ttl steps of the persistent table. Only the table
+  // expires rows, the cache tiers keep every key until it is evicted by capacity, and rows
+  // resident in a cache are written back with the current step and so never expire.
+  virtual void SetCurrentStep(uint64_t step) = 0;
+  virtual uint64_t EvictExpired() = 0;
 };
 
 }  // namespace embedding
@@ -0,0 +1,212 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_KEY_VALUE_STORE_OPTIONS_H_
+#define ONEFLOW_CORE_EMBEDDING_KEY_VALUE_STORE_OPTIONS_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/embedding/cache.h"
+#include "oneflow/core/embedding/quantized_key_value_store.h"
+#include "nlohmann/json.hpp"
+
+namespace oneflow {
+
+namespace embedding {
+
+// Options of the store of one embedding table, deserialized from json like
+// {
+//   "name": "sparse_embedding",
+//   "key_size": 8,
+//   "value_size": 512,
+//   "storage_type": "float16",
+//   "quantized_length": 64,
+//   "caches": [
+//     {"policy": "lru", "capacity": 1048576, "value_memory_kind": "device"},
+//     {"policy": "full", "capacity": 67108864, "max_capacity": 268435456,
+//      "value_memory_kind": "host"}
+//   ],
+//   "persistent_table": {"path": "/data/embedding", "physical_block_size": 4096,
+//                        "incremental_snapshot": true, "max_snapshot_chain_length": 8,
+//                        "ttl": 0, "value_paths": ["/nvme0/embedding", "/nvme1/embedding"]}
+// }
+// caches are optional and listed from the fastest tier to the slowest one, a full cache with
+// max_capacity grows online from capacity up to it. storage_type is one of
+// float32 (default), float16, bfloat16 and int8, only the first quantized_length (default all)
+// floats of each row are stored so, then the caches and the table hold StoredValueSize() bytes.
+// A non-zero ttl expires the table rows not accessed in the last ttl steps, the caches never
+// expire rows. The optional value_paths stripe the value chunks of the table across drives.
+class KeyValueStoreOptions final {
+ public:
+  explicit KeyValueStoreOptions(const std::string& json_serialized) {
+    auto json_object = nlohmann::json::parse(json_serialized);
+    CHECK(json_object.contains("name"));
+    name_ = json_object["name"].get<std::string>();
+    CHECK(json_object.contains("key_size"));
+    key_size_ = json_object["key_size"].get<uint32_t>();
+    CHECK(json_object.contains("value_size"));
+    value_size_ = json_object["value_size"].get<uint32_t>();
+    storage_type_ = DataType::kFloat;
+    if (json_object.contains("storage_type")) {
+      storage_type_ = ParseStorageType(json_object["storage_type"].get<std::string>());
+    }
+    if (storage_type_ != DataType::kFloat) {
+      CHECK_EQ(value_size_ % sizeof(float), 0);
+      quantized_options_.storage_type = storage_type_;
+      quantized_options_.value_length = value_size_ / sizeof(float);
+      if (json_object.contains("quantized_length")) {
+        quantized_options_.quantized_length = json_object["quantized_length"].get<uint32_t>();
+        CHECK_LE(quantized_options_.quantized_length, quantized_options_.value_length);
+      } else {
+        quantized_options_.quantized_length = quantized_options_.value_length;
+      }
+    }
+    if (json_object.contains("caches")) {
+      for (const auto& cache_object : json_object["caches"]) {
+        CacheOptions cache_options;
+        cache_options.key_size = key_size_;
+        cache_options.value_size = StoredValueSize();
+        cache_options.policy = ParsePolicy(cache_object["policy"].get<std::string>());
+        cache_options.capacity = cache_object["capacity"].get<uint64_t>();
+        if (cache_object.contains("value_memory_kind")) {
+          cache_options.value_memory_kind =
+              ParseMemoryKind(cache_object["value_memory_kind"].get<std::string>());
+        }
+        if (cache_object.contains("load_factor")) {
+          cache_options.load_factor = cache_object["load_factor"].get<float>();
+        }
+        if (cache_object.contains("max_capacity")) {
+          cache_options.max_capacity = cache_object["max_capacity"].get<uint64_t>();
+        }
+        cache_options_.push_back(cache_options);
+      }
+    }
+    CHECK(json_object.contains("persistent_table"));
+    const auto& table_object = json_object["persistent_table"];
+    persistent_table_path_ = table_object["path"].get<std::string>();
+    if (table_object.contains("physical_block_size")) {
+      persistent_table_physical_block_size_ = table_object["physical_block_size"].get<uint16_t>();
+    } else {
+      persistent_table_physical_block_size_ = 4096;
+    }
+    persistent_table_incremental_snapshot_ = table_object.contains("incremental_snapshot")
+                                             && table_object["incremental_snapshot"].get<bool>();
+    if (table_object.contains("max_snapshot_chain_length")) {
+      persistent_table_max_snapshot_chain_length_ =
+          table_object["max_snapshot_chain_length"].get<uint32_t>();
+    } else {
+      persistent_table_max_snapshot_chain_length_ = 8;
+    }
+    if (table_object.contains("ttl")) {
+      persistent_table_ttl_ = table_object["ttl"].get<uint64_t>();
+    } else {
+      persistent_table_ttl_ = 0;
+    }
+    if (table_object.contains("value_paths")) {
+      persistent_table_value_paths_ = table_object["value_paths"].get<std::vector<std::string>>();
+    }
+  }
+  ~KeyValueStoreOptions() = default;
+
+  const std::string& Name() const { return name_; }
+  uint32_t KeySize() const { return key_size_; }
+  uint32_t ValueSize() const { return value_size_; }
+  bool IsQuantized() const { return storage_type_ != DataType::kFloat; }
+  const QuantizedKeyValueStoreOptions& QuantizedOptions() const { return quantized_options_; }
+  uint32_t StoredValueSize() const {
+    return IsQuantized() ? QuantizedValueSize(quantized_options_) : value_size_;
+  }
+  const std::vector<CacheOptions>& Caches() const { return cache_options_; }
+  uint16_t PersistentTablePhysicalBlockSize() const {
+    return persistent_table_physical_block_size_;
+  }
+  bool PersistentTableIncrementalSnapshot() const { return persistent_table_incremental_snapshot_; }
+  uint32_t PersistentTableMaxSnapshotChainLength() const {
+    return persistent_table_max_snapshot_chain_length_;
+  }
+  uint64_t PersistentTableTtl() const { return persistent_table_ttl_; }
+  // Each rank owns a table under the path, the tables of different world sizes never mix.
+  std::string PersistentTablePath(int64_t rank_id, int64_t world_size) const {
+    return JoinPath(persistent_table_path_,
+                    "rank-" + std::to_string(rank_id) + "-of-" + std::to_string(world_size));
+  }
+  std::vector<std::string> PersistentTableValuePaths(int64_t rank_id, int64_t world_size) const {
+    std::vector<std::string> paths;
+    for (const auto& path : persistent_table_value_paths_) {
+      paths.push_back(JoinPath(
+          path, "rank-" + std::to_string(rank_id) + "-of-" + std::to_string(world_size)));
+    }
+    return paths;
+  }
+
+ private:
+  static CacheOptions::Policy ParsePolicy(const std::string& policy) {
+    if (policy == "lru") {
+      return CacheOptions::Policy::kLRU;
+    } else if (policy == "lfu") {
+      return CacheOptions::Policy::kLFU;
+    } else if (policy == "full") {
+      return CacheOptions::Policy::kFull;
+    } else {
+      UNIMPLEMENTED() << "unsupported cache policy " << policy;
+      return CacheOptions::Policy::kLRU;
+    }
+  }
+
+  static DataType ParseStorageType(const std::string& storage_type) {
+    if (storage_type == "float32") {
+      return DataType::kFloat;
+    } else if (storage_type == "float16") {
+      return DataType::kFloat16;
+    } else if (storage_type == "bfloat16") {
+      return DataType::kBFloat16;
+    } else if (storage_type == "int8") {
+      return DataType::kInt8;
+    } else {
+      UNIMPLEMENTED() << "unsupported storage type " << storage_type;
+      return DataType::kFloat;
+    }
+  }
+
+  static CacheOptions::MemoryKind ParseMemoryKind(const std::string& memory_kind) {
+    if (memory_kind == "device") {
+      return CacheOptions::MemoryKind::kDevice;
+    } else if (memory_kind == "host") {
+      return CacheOptions::MemoryKind::kHost;
+    } else {
+      UNIMPLEMENTED() << "unsupported cache value memory kind " << memory_kind;
+      return CacheOptions::MemoryKind::kDevice;
+    }
+  }
+
+  std::string name_;
+  uint32_t key_size_;
+  uint32_t value_size_;
+  DataType storage_type_;
+  QuantizedKeyValueStoreOptions quantized_options_;
+  std::vector<CacheOptions> cache_options_;
+  std::string persistent_table_path_;
+  uint16_t persistent_table_physical_block_size_;
+  bool persistent_table_incremental_snapshot_;
+  uint32_t persistent_table_max_snapshot_chain_length_;
+  uint64_t persistent_table_ttl_;
+  std::vector<std::string> persistent_table_value_paths_;
+};
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_KEY_VALUE_STORE_OPTIONS_H_
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/key_value_store_options.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+TEST(KeyValueStoreOptions, Defaults) {
+  KeyValueStoreOptions options(R"({
+    "name": "embedding",
+    "key_size": 8,
+    "value_size": 512,
+    "persistent_table": {"path": "/data/embedding"}
+  })");
+  ASSERT_EQ(options.Name(), "embedding");
+  ASSERT_EQ(options.KeySize(), 8);
+  ASSERT_EQ(options.ValueSize(), 512);
+  ASSERT_FALSE(options.IsQuantized());
+  ASSERT_EQ(options.StoredValueSize(), 512);
+  ASSERT_TRUE(options.Caches().empty());
+  ASSERT_EQ(options.PersistentTablePhysicalBlockSize(), 4096);
+  ASSERT_FALSE(options.PersistentTableIncrementalSnapshot());
+  ASSERT_EQ(options.PersistentTableMaxSnapshotChainLength(), 8);
+  ASSERT_EQ(options.PersistentTableTtl(), 0);
+  ASSERT_EQ(options.PersistentTablePath(1, 4), "/data/embedding/rank-1-of-4");
+  ASSERT_TRUE(options.PersistentTableValuePaths(1, 4).empty());
+}
+
+TEST(KeyValueStoreOptions, CachesAndTable) {
+  KeyValueStoreOptions options(R"({
+    "name": "embedding",
+    "key_size": 4,
+    "value_size": 256,
+    "caches": [
+      {"policy": "lru", "capacity": 1024, "value_memory_kind": "device"},
+      {"policy": "full", "capacity": 4096, "max_capacity": 16384, "load_factor": 0.5,
+       "value_memory_kind": "host"}
+    ],
+    "persistent_table": {"path": "/data/embedding", "physical_block_size": 512,
+                         "incremental_snapshot": true, "max_snapshot_chain_length": 4,
+                         "ttl": 100, "value_paths": ["/nvme0/embedding", "/nvme1/embedding"]}
+  })");
+  ASSERT_EQ(options.Caches().size(), 2);
+  const CacheOptions& lru = options.Caches().at(0);
+  ASSERT_EQ(lru.policy, CacheOptions::Policy::kLRU);
+  ASSERT_EQ(lru.capacity, 1024);
+  ASSERT_EQ(lru.value_memory_kind, CacheOptions::MemoryKind::kDevice);
+  ASSERT_EQ(lru.key_size, 4);
+  ASSERT_EQ(lru.value_size, 256);
+  const CacheOptions& full = options.Caches().at(1);
+  ASSERT_EQ(full.policy, CacheOptions::Policy::kFull);
+  ASSERT_EQ(full.capacity, 4096);
+  ASSERT_EQ(full.max_capacity, 16384);
+  ASSERT_FLOAT_EQ(full.load_factor, 0.5);
+  ASSERT_EQ(full.value_memory_kind, CacheOptions::MemoryKind::kHost);
+  ASSERT_EQ(options.PersistentTablePhysicalBlockSize(), 512);
+  ASSERT_TRUE(options.PersistentTableIncrementalSnapshot());
+  ASSERT_EQ(options.PersistentTableMaxSnapshotChainLength(), 4);
+  ASSERT_EQ(options.PersistentTableTtl(), 100);
+  const std::vector<std::string> value_paths = options.PersistentTableValuePaths(0, 2);
+  ASSERT_EQ(value_paths.size(), 2);
+  ASSERT_EQ(value_paths.at(0), "/nvme0/embedding/rank-0-of-2");
+  ASSERT_EQ(value_paths.at(1), "/nvme1/embedding/rank-0-of-2");
+}
+
+TEST(KeyValueStoreOptions, Quantized) {
+  KeyValueStoreOptions options(R"({
+    "name": "embedding",
+    "key_size": 8,
+    "value_size": 512,
+    "storage_type": "int8",
+    "quantized_length": 64,
+    "caches": [{"policy": "lru", "capacity": 1024}],
+    "persistent_table": {"path": "/data/embedding"}
+  })");
+  ASSERT_TRUE(options.IsQuantized());
+  ASSERT_EQ(options.QuantizedOptions().storage_type, DataType::kInt8);
+  ASSERT_EQ(options.QuantizedOptions().value_length, 128);
+  ASSERT_EQ(options.QuantizedOptions().quantized_length, 64);
+  // A float scale, 64 int8 and 64 floats.
+  ASSERT_EQ(options.StoredValueSize(), 4 + 64 + 64 * 4);
+  // The caches hold the stored rows.
+  ASSERT_EQ(options.Caches().at(0).value_size, options.StoredValueSize());
+  KeyValueStoreOptions half_options(R"({
+    "name": "embedding",
+    "key_size": 8,
+    "value_size": 512,
+    "storage_type": "float16",
+    "persistent_table": {"path": "/data/embedding"}
+  })");
+  ASSERT_EQ(half_options.QuantizedOptions().quantized_length, 128);
+  ASSERT_EQ(half_options.StoredValueSize(), 128 * 2);
+}
+
+}  // namespace
+
+}  // namespace embedding
+
+}  // namespace oneflow
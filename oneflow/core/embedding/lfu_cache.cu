@@ -0,0 +1,540 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Set-associative LFU cache with a TinyLFU style admission filter.
+// See https://arxiv.org/abs/1512.00727
+
+#include "oneflow/core/embedding/lfu_cache.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+#include <new>
+#include <cuda.h>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr int kWarpSize = 32;
+constexpr int kNumWarpPerBlock = 4;
+constexpr int kBlockSize = kNumWarpPerBlock * kWarpSize;
+constexpr uint32_t kFullMask = 0xFFFFFFFFU;
+constexpr uint32_t kSketchDepth = 4;
+constexpr uint32_t kMaxFrequency = 0xFFFFFFFEU;
+// Counters are halved every kAgingPeriodFactor * capacity accesses, so that keys which were hot
+// long ago do not stay in the cache forever.
+constexpr uint64_t kAgingPeriodFactor = 8;
+
+ep::CudaLaunchConfig GetLaunchConfig(uint32_t n_keys) {
+  return ep::CudaLaunchConfig((n_keys + kNumWarpPerBlock - 1) / kNumWarpPerBlock,
+                              kWarpSize * kNumWarpPerBlock, 0);
+}
+
+struct ThreadContext {
+  __device__ ThreadContext() {
+    const uint32_t global_thread_id = blockIdx.x * blockDim.x + threadIdx.x;
+    global_warp_id = global_thread_id / kWarpSize;
+    warp_id_in_block = global_warp_id % kNumWarpPerBlock;  // NOLINT
+    num_warps = gridDim.x * kNumWarpPerBlock;              // NOLINT
+    lane_id = global_thread_id % kWarpSize;
+  }
+
+  uint32_t global_warp_id;
+  uint32_t warp_id_in_block;
+  uint32_t num_warps;
+  uint32_t lane_id;
+};
+
+class WarpMutex {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WarpMutex);
+  __device__ WarpMutex() = default;
+  __device__ ~WarpMutex() = default;
+
+  __device__ void Lock(const ThreadContext& thread_ctx) {
+    if (thread_ctx.lane_id == 0) {
+      while (atomicCAS(&flag_, 0, 1) != 0)
+        ;
+    }
+    __threadfence();
+    __syncwarp();
+  }
+
+  __device__ void Unlock(const ThreadContext& thread_ctx) {
+    __syncwarp();
+    __threadfence();
+    if (thread_ctx.lane_id == 0) { atomicExch(&flag_, 0); }
+  }
+
+ private:
+  int32_t flag_;
+};
+
+template<typename Key, typename Elem>
+struct LfuCacheContext {
+  Key* keys;
+  Elem* lines;
+  // Access frequency of each way, zero means the way is empty.
+  uint32_t* counts;
+  WarpMutex* mutex;
+  // Count-Min sketch of kSketchDepth rows used to estimate the frequency of keys not in the cache.
+  uint32_t* sketch;
+  uint64_t n_set;
+  uint64_t sketch_width;
+  uint32_t line_size;
+};
+
+__global__ void InitCacheSetMutex(uint32_t n_set, WarpMutex* mutex) {
+  const uint32_t idx = blockIdx.x * blockDim.x + threadIdx.x;
+  if (idx < n_set) { new (mutex + idx) WarpMutex; }
+}
+
+__global__ void AgingKernel(uint64_t n_counts, uint32_t* counts, uint64_t n_sketch,
+                            uint32_t* sketch) {
+  CUDA_1D_KERNEL_LOOP_T(uint64_t, i, n_counts) {
+    const uint32_t count = counts[i];
+    if (count != 0) { counts[i] = max(count >> 1U, 1U); }
+  }
+  CUDA_1D_KERNEL_LOOP_T(uint64_t, i, n_sketch) { sketch[i] >>= 1U; }
+}
+
+template<typename Key>
+__device__ uint32_t SketchEstimate(const uint32_t* sketch, uint64_t sketch_width, Key key) {
+  uint32_t estimate = kMaxFrequency;
+  for (uint32_t row = 0; row < kSketchDepth; ++row) {
+    const uint64_t col = LfuSketchHash()(key, row) & (sketch_width - 1);
+    estimate = min(estimate, sketch[row * sketch_width + col]);
+  }
+  return estimate;
+}
+
+template<typename Key>
+__device__ void SketchIncrement(uint32_t* sketch, uint64_t sketch_width, Key key) {
+  for (uint32_t row = 0; row < kSketchDepth; ++row) {
+    const uint64_t col = LfuSketchHash()(key, row) & (sketch_width - 1);
+    uint32_t* counter = sketch + row * sketch_width + col;
+    if (*counter < kMaxFrequency) { atomicAdd(counter, 1U); }
+  }
+}
+
+template<typename Key, typename Elem>
+void ClearLfuCacheContext(LfuCacheContext<Key, Elem>* ctx) {
+  OF_CUDA_CHECK(cudaMemset(ctx->keys, 0, ctx->n_set * kWarpSize * sizeof(Key)));
+  OF_CUDA_CHECK(cudaMemset(ctx->counts, 0, ctx->n_set * kWarpSize * sizeof(uint32_t)));
+  OF_CUDA_CHECK(cudaMemset(ctx->sketch, 0, kSketchDepth * ctx->sketch_width * sizeof(uint32_t)));
+  InitCacheSetMutex<<<(ctx->n_set - 1 + 256) / 256, 256>>>(ctx->n_set, ctx->mutex);
+}
+
+template<typename Key, typename Elem>
+void InitLfuCacheContext(const CacheOptions& options, LfuCacheContext<Key, Elem>* ctx) {
+  const size_t keys_size_per_set = kWarpSize * sizeof(Key);
+  const uint32_t line_size = options.value_size / sizeof(Elem);
+  const size_t lines_size_per_set = kWarpSize * line_size * sizeof(Elem);
+  const size_t counts_size_per_set = kWarpSize * sizeof(uint32_t);
+  const size_t mutex_size_per_set = sizeof(WarpMutex);
+  const size_t n_set = (options.capacity - 1 + kWarpSize) / kWarpSize;
+  CHECK_GT(n_set, 0);
+  ctx->n_set = n_set;
+  ctx->line_size = line_size;
+  uint64_t sketch_width = 1;
+  while (sketch_width < n_set * kWarpSize) { sketch_width <<= 1U; }
+  ctx->sketch_width = sketch_width;
+  const size_t keys_size = n_set * keys_size_per_set;
+  OF_CUDA_CHECK(cudaMalloc(&(ctx->keys), keys_size));
+  const size_t lines_size = n_set * lines_size_per_set;
+  OF_CUDA_CHECK(cudaMalloc(&(ctx->lines), lines_size));
+  const size_t counts_size = n_set * counts_size_per_set;
+  OF_CUDA_CHECK(cudaMalloc(&(ctx->counts), counts_size));
+  const size_t mutex_size = n_set * mutex_size_per_set;
+  OF_CUDA_CHECK(cudaMalloc(&(ctx->mutex), mutex_size));
+  const size_t sketch_size = kSketchDepth * sketch_width * sizeof(uint32_t);
+  OF_CUDA_CHECK(cudaMalloc(&(ctx->sketch), sketch_size));
+
+  ClearLfuCacheContext(ctx);
+}
+
+template<typename Key, typename Elem>
+void DestroyLfuCacheContext(LfuCacheContext<Key, Elem>* ctx) {
+  OF_CUDA_CHECK(cudaFree(ctx->keys));
+  OF_CUDA_CHECK(cudaFree(ctx->lines));
+  OF_CUDA_CHECK(cudaFree(ctx->counts));
+  OF_CUDA_CHECK(cudaFree(ctx->mutex));
+  OF_CUDA_CHECK(cudaFree(ctx->sketch));
+}
+
+template<typename Key, typename Elem>
+struct SetContext {
+  __device__ SetContext(const LfuCacheContext<Key, Elem>& ctx, uint32_t set_id)
+      : keys(ctx.keys + set_id * kWarpSize),
+        mutex(ctx.mutex + set_id),
+        counts(ctx.counts + set_id * kWarpSize),
+        lines(ctx.lines + set_id * kWarpSize * ctx.line_size) {}
+
+  __device__ int Lookup(const ThreadContext& thread_ctx, Key key) {
+    const Key lane_key = keys[thread_ctx.lane_id];
+    const uint32_t lane_count = counts[thread_ctx.lane_id];
+    const bool lane_hit = (lane_key == key && lane_count != 0);
+    const unsigned hit_mask = __ballot_sync(kFullMask, lane_hit);
+    if (hit_mask != 0) {
+      return __ffs(static_cast<int>(hit_mask)) - 1;
+    } else {
+      return -1;
+    }
+  }
+
+  __device__ void Touch(const ThreadContext& thread_ctx, int way) {
+    if (thread_ctx.lane_id == way && counts[way] < kMaxFrequency) { atomicAdd(counts + way, 1U); }
+    __syncwarp();
+  }
+
+  __device__ void Read(const LfuCacheContext<Key, Elem>& cache_ctx, const ThreadContext& thread_ctx,
+                       int way, Elem* line) {
+    const Elem* from_line = lines + way * cache_ctx.line_size;
+    for (int i = thread_ctx.lane_id; i < cache_ctx.line_size; i += kWarpSize) {
+      line[i] = from_line[i];
+    }
+  }
+
+  // Returns the way the key should be written to, or -1 if the admission filter rejects the key.
+  // When a resident key has to make room, it is reported through `evicted_way`.
+  __device__ int Insert(const LfuCacheContext<Key, Elem>& cache_ctx,
+                        const ThreadContext& thread_ctx, Key key, int* evicted_way,
+                        Key* evicted_key) {
+    *evicted_way = -1;
+    const Key lane_key = keys[thread_ctx.lane_id];
+    const uint32_t lane_count = counts[thread_ctx.lane_id];
+    const unsigned hit_mask = __ballot_sync(kFullMask, lane_key == key && lane_count != 0);
+    if (hit_mask != 0) { return __ffs(static_cast<int>(hit_mask)) - 1; }
+    const uint32_t estimate =
+        max(SketchEstimate(cache_ctx.sketch, cache_ctx.sketch_width, key), 1U);
+    const unsigned valid_mask = __ballot_sync(kFullMask, lane_count != 0);
+    int insert_way = -1;
+    if (valid_mask != kFullMask) {
+      insert_way = __ffs(static_cast<int>(~valid_mask)) - 1;
+    } else {
+      uint32_t min_count = lane_count;
+      for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+        min_count = min(min_count, __shfl_xor_sync(kFullMask, min_count, offset));
+      }
+      if (estimate < min_count) { return -1; }
+      insert_way = __ffs(static_cast<int>(__ballot_sync(kFullMask, lane_count == min_count))) - 1;
+      *evicted_way = insert_way;
+      *evicted_key = __shfl_sync(kFullMask, lane_key, insert_way);
+    }
+    if (thread_ctx.lane_id == insert_way) {
+      keys[insert_way] = key;
+      counts[insert_way] = estimate;
+    }
+    __syncwarp();
+    return insert_way;
+  }
+
+  __device__ void Write(const LfuCacheContext<Key, Elem>& cache_ctx,
+                        const ThreadContext& thread_ctx, int way, const Elem* line) {
+    Elem* to_line = lines + way * cache_ctx.line_size;
+    for (int i = thread_ctx.lane_id; i < cache_ctx.line_size; i += kWarpSize) {
+      to_line[i] = line[i];
+    }
+  }
+
+  __device__ void Lock(const ThreadContext& thread_ctx) { mutex->Lock(thread_ctx); }
+
+  __device__ void Unlock(const ThreadContext& thread_ctx) { mutex->Unlock(thread_ctx); }
+
+  Key* keys;
+  Elem* lines;
+  uint32_t* counts;
+  WarpMutex* mutex;
+};
+
+template<typename Key, typename Elem, bool test_only>
+__global__ void GetKernel(LfuCacheContext<Key, Elem> cache_ctx, uint32_t num_keys, const Key* keys,
+                          Elem* values, uint32_t* n_missing_keys, Key* missing_keys,
+                          uint32_t* missing_indices) {
+  ThreadContext thread_ctx{};
+  __shared__ Key block_keys[kNumWarpPerBlock][kWarpSize];
+  __shared__ size_t block_set_ids[kNumWarpPerBlock][kWarpSize];
+  for (uint32_t batch_offset = thread_ctx.global_warp_id * kWarpSize; batch_offset < num_keys;
+       batch_offset += thread_ctx.num_warps * kWarpSize) {
+    const uint32_t n_batch_keys = min(kWarpSize, num_keys - batch_offset);
+    if (thread_ctx.lane_id < n_batch_keys) {
+      const Key key = keys[batch_offset + thread_ctx.lane_id];
+      const size_t hash = LfuCacheHash()(key);
+      const uint32_t set_id = hash % cache_ctx.n_set;
+      block_keys[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = key;
+      block_set_ids[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = set_id;
+      if (!test_only) { SketchIncrement(cache_ctx.sketch, cache_ctx.sketch_width, key); }
+    }
+    __syncwarp();
+    uint32_t n_warp_missing = 0;
+    Key warp_missing_key = 0;
+    uint32_t warp_missing_index = 0;
+    for (uint32_t i = 0; i < n_batch_keys; ++i) {
+      const uint32_t key_idx = batch_offset + i;
+      const Key key = block_keys[thread_ctx.warp_id_in_block][i];
+      const size_t set_id = block_set_ids[thread_ctx.warp_id_in_block][i];
+      SetContext<Key, Elem> set_ctx(cache_ctx, set_id);
+      const int way = set_ctx.Lookup(thread_ctx, key);
+      if (way < 0) {
+        if (thread_ctx.lane_id == n_warp_missing) {
+          warp_missing_key = key;
+          warp_missing_index = key_idx;
+        }
+        __syncwarp();
+        n_warp_missing += 1;
+      } else if (!test_only) {
+        set_ctx.Touch(thread_ctx, way);
+        set_ctx.Read(cache_ctx, thread_ctx, way, values + key_idx * cache_ctx.line_size);
+      }
+    }
+    if (n_warp_missing > 0) {
+      uint32_t base_missing_idx = 0;
+      if (thread_ctx.lane_id == 0) { base_missing_idx = atomicAdd(n_missing_keys, n_warp_missing); }
+      __syncwarp();
+      base_missing_idx = __shfl_sync(kFullMask, base_missing_idx, 0);
+      if (thread_ctx.lane_id < n_warp_missing) {
+        missing_keys[base_missing_idx + thread_ctx.lane_id] = warp_missing_key;
+        missing_indices[base_missing_idx + thread_ctx.lane_id] = warp_missing_index;
+      }
+      __syncwarp();
+    }
+    __syncwarp();
+  }
+}
+
+template<typename Key, typename Elem>
+__global__ void PutKernel(LfuCacheContext<Key, Elem> cache_ctx, uint32_t num_keys,
+                          const Key* keys, const Elem* values, uint32_t* n_evicted,
+                          Key* evicted_keys, Elem* evicted_values) {
+  ThreadContext thread_ctx{};
+  __shared__ Key block_keys[kNumWarpPerBlock][kWarpSize];
+  __shared__ size_t block_set_ids[kNumWarpPerBlock][kWarpSize];
+  for (uint32_t batch_offset = thread_ctx.global_warp_id * kWarpSize; batch_offset < num_keys;
+       batch_offset += thread_ctx.num_warps * kWarpSize) {
+    const uint32_t n_batch_keys = min(kWarpSize, num_keys - batch_offset);
+    if (thread_ctx.lane_id < n_batch_keys) {
+      const Key key = keys[batch_offset + thread_ctx.lane_id];
+      const size_t hash = LfuCacheHash()(key);
+      const uint32_t set_id = hash % cache_ctx.n_set;
+      block_keys[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = key;
+      block_set_ids[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = set_id;
+    }
+    __syncwarp();
+    for (uint32_t i = 0; i < n_batch_keys; ++i) {
+      const uint32_t key_idx = batch_offset + i;
+      const Key key = block_keys[thread_ctx.warp_id_in_block][i];
+      const size_t set_id = block_set_ids[thread_ctx.warp_id_in_block][i];
+      const Elem* line = values + cache_ctx.line_size * key_idx;
+      SetContext<Key, Elem> set_ctx(cache_ctx, set_id);
+      set_ctx.Lock(thread_ctx);
+      int evicted_way = -1;
+      Key evicted_key = 0;
+      const int insert_way = set_ctx.Insert(cache_ctx, thread_ctx, key, &evicted_way, &evicted_key);
+      if (insert_way < 0 || evicted_way >= 0) {
+        uint32_t evicted_idx = 0;
+        if (thread_ctx.lane_id == 0) { evicted_idx = atomicAdd(n_evicted, 1U); }
+        evicted_idx = __shfl_sync(kFullMask, evicted_idx, 0);
+        Elem* evicted_line = evicted_values + cache_ctx.line_size * evicted_idx;
+        if (insert_way < 0) {
+          // Rejected by the admission filter, hand the incoming row back to the caller.
+          if (thread_ctx.lane_id == 0) { evicted_keys[evicted_idx] = key; }
+          for (int j = thread_ctx.lane_id; j < cache_ctx.line_size; j += kWarpSize) {
+            evicted_line[j] = line[j];
+          }
+        } else {
+          if (thread_ctx.lane_id == 0) { evicted_keys[evicted_idx] = evicted_key; }
+          set_ctx.Read(cache_ctx, thread_ctx, evicted_way, evicted_line);
+        }
+        __syncwarp();
+      }
+      if (insert_way >= 0) { set_ctx.Write(cache_ctx, thread_ctx, insert_way, line); }
+      set_ctx.Unlock(thread_ctx);
+    }
+  }
+}
+
+template<typename Key, typename Elem>
+__global__ void DumpKernel(LfuCacheContext<Key, Elem> cache_ctx, size_t start_key_index,
+                           size_t end_key_index, uint32_t* n_dumped, Key* keys, Elem* values) {
+  ThreadContext thread_ctx{};
+  __shared__ Key warp_keys[kNumWarpPerBlock][kWarpSize];
+  __shared__ uint32_t warp_counts[kNumWarpPerBlock][kWarpSize];
+  for (uint32_t warp_start_key_index = start_key_index + thread_ctx.global_warp_id * kWarpSize;
+       warp_start_key_index < end_key_index;
+       warp_start_key_index += thread_ctx.num_warps * kWarpSize) {
+    Key lane_key = 0;
+    uint32_t lane_count = 0;
+    if (warp_start_key_index + thread_ctx.lane_id < end_key_index) {
+      lane_key = cache_ctx.keys[warp_start_key_index + thread_ctx.lane_id];
+      lane_count = cache_ctx.counts[warp_start_key_index + thread_ctx.lane_id];
+    }
+    __syncwarp();
+    warp_keys[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = lane_key;
+    warp_counts[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = lane_count;
+    const int key_count = __popc(__ballot_sync(kFullMask, lane_count != 0));
+    if (key_count == 0) { continue; }
+    uint32_t offset = 0;
+    if (thread_ctx.lane_id == 0) { offset = atomicAdd(n_dumped, key_count); }
+    offset = __shfl_sync(kFullMask, offset, 0);
+    __syncwarp();
+    for (uint32_t i = 0; i < kWarpSize; ++i) {
+      const Key key = warp_keys[thread_ctx.warp_id_in_block][i];
+      const uint32_t count = warp_counts[thread_ctx.warp_id_in_block][i];
+      if (count == 0) { continue; }
+      if (thread_ctx.lane_id == 0) { keys[offset] = key; }
+      __syncwarp();
+      for (uint32_t j = thread_ctx.lane_id; j < cache_ctx.line_size; j += kWarpSize) {
+        values[offset * cache_ctx.line_size + j] =
+            cache_ctx.lines[(warp_start_key_index + i) * cache_ctx.line_size + j];
+      }
+      __syncwarp();
+      offset += 1;
+    }
+  }
+}
+
+template<typename Key, typename Elem>
+class LfuCache : public Cache {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LfuCache);
+  explicit LfuCache(const CacheOptions& options)
+      : device_index_{}, max_query_length_(0), n_access_since_aging_(0) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    InitLfuCacheContext(options, &ctx_);
+    aging_period_ = Capacity() * kAgingPeriodFactor;
+  }
+  ~LfuCache() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    DestroyLfuCacheContext(&ctx_);
+  }
+
+  uint32_t KeySize() const override { return sizeof(Key); }
+  uint32_t ValueSize() const override { return sizeof(Elem) * ctx_.line_size; }
+  uint64_t Capacity() const override { return ctx_.n_set * kWarpSize; }
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    if (query_length < max_query_length_) { return; }
+    max_query_length_ = query_length;
+  }
+
+  CacheOptions::Policy Policy() const override { return CacheOptions::Policy::kLFU; }
+
+  void Test(ep::Stream* stream, uint32_t n_keys, const void* keys, uint32_t* n_missing,
+            void* missing_keys, uint32_t* missing_indices) override {
+    CHECK_LE(n_keys, max_query_length_);
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    OF_CUDA_CHECK(cudaMemsetAsync(n_missing, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+    if (n_keys == 0) { return; }
+    cuda_stream->LaunchKernel(GetKernel<Key, Elem, true>, GetLaunchConfig(n_keys), ctx_, n_keys,
+                              static_cast<const Key*>(keys), nullptr, n_missing,
+                              static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  void Get(ep::Stream* stream, uint32_t n_keys, const void* keys, void* values, uint32_t* n_missing,
+           void* missing_keys, uint32_t* missing_indices) override {
+    CHECK_LE(n_keys, max_query_length_);
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    OF_CUDA_CHECK(cudaMemsetAsync(n_missing, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+    if (n_keys == 0) { return; }
+    MaybeAging(stream, n_keys);
+    cuda_stream->LaunchKernel(GetKernel<Key, Elem, false>, GetLaunchConfig(n_keys), ctx_, n_keys,
+                              static_cast<const Key*>(keys), static_cast<Elem*>(values), n_missing,
+                              static_cast<Key*>(missing_keys), missing_indices);
+  }
+
+  void Put(ep::Stream* stream, uint32_t n_keys, const void* keys, const void* values,
+           uint32_t* n_evicted, void* evicted_keys, void* evicted_values) override {
+    CHECK_LE(n_keys, max_query_length_);
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    OF_CUDA_CHECK(cudaMemsetAsync(n_evicted, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+    if (n_keys == 0) { return; }
+    cuda_stream->LaunchKernel(PutKernel<Key, Elem>, GetLaunchConfig(n_keys), ctx_, n_keys,
+                              static_cast<const Key*>(keys), static_cast<const Elem*>(values),
+                              n_evicted, static_cast<Key*>(evicted_keys),
+                              static_cast<Elem*>(evicted_values));
+  }
+
+  void Dump(ep::Stream* stream, uint64_t start_key_index, uint64_t end_key_index,
+            uint32_t* n_dumped, void* keys, void* values) override {
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    OF_CUDA_CHECK(cudaMemsetAsync(n_dumped, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+    const uint64_t max_dump_keys = end_key_index - start_key_index;
+    cuda_stream->LaunchKernel(
+        DumpKernel<Key, Elem>,
+        ep::CudaLaunchConfig((max_dump_keys + kNumWarpPerBlock - 1) / kNumWarpPerBlock, kBlockSize,
+                             0),
+        ctx_, start_key_index, end_key_index, n_dumped, static_cast<Key*>(keys),
+        static_cast<Elem*>(values));
+  }
+
+  void Clear() override {
+    n_access_since_aging_ = 0;
+    ClearLfuCacheContext<Key, Elem>(&ctx_);
+  }
+
+ private:
+  void MaybeAging(ep::Stream* stream, uint32_t n_keys) {
+    n_access_since_aging_ += n_keys;
+    if (n_access_since_aging_ < aging_period_) { return; }
+    n_access_since_aging_ = 0;
+    const uint64_t n_counts = ctx_.n_set * kWarpSize;
+    const uint64_t n_sketch = kSketchDepth * ctx_.sketch_width;
+    RUN_CUDA_KERNEL(AgingKernel, stream, std::max(n_counts, n_sketch), n_counts, ctx_.counts,
+                    n_sketch, ctx_.sketch);
+  }
+
+  int device_index_;
+  uint32_t max_query_length_;
+  LfuCacheContext<Key, Elem> ctx_;
+  uint64_t n_access_since_aging_;
+  uint64_t aging_period_;
+};
+
+template<typename Key>
+std::unique_ptr<Cache> DispatchValueType(const CacheOptions& options) {
+  if (options.value_size % sizeof(ulonglong2) == 0) {
+    return std::unique_ptr<Cache>(new LfuCache<Key, ulonglong2>(options));
+  } else if (options.value_size % sizeof(uint64_t) == 0) {
+    return std::unique_ptr<Cache>(new LfuCache<Key, uint64_t>(options));
+  } else if (options.value_size % sizeof(uint32_t) == 0) {
+    return std::unique_ptr<Cache>(new LfuCache<Key, uint32_t>(options));
+  } else if (options.value_size % sizeof(uint16_t) == 0) {
+    return std::unique_ptr<Cache>(new LfuCache<Key, uint16_t>(options));
+  } else {
+    return std::unique_ptr<Cache>(new LfuCache<Key, uint8_t>(options));
+  }
+}
+
+std::unique_ptr<Cache> DispatchKeyType(const CacheOptions& options) {
+  if (options.key_size == sizeof(uint32_t)) {
+    return DispatchValueType<uint32_t>(options);
+  } else if (options.key_size == sizeof(uint64_t)) {
+    return DispatchValueType<uint64_t>(options);
+  } else {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Cache> NewLfuCache(const CacheOptions& options) { return DispatchKeyType(options); }
+
+}  // namespace embedding
+
+}  // namespace oneflow
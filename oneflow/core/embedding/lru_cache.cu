@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/embedding/lru_cache.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/embedding/sparse_update.cuh"
 #include <new>
 #include <cuda.h>
 
@@ -280,6 +281,66 @@ __global__ void GetKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_key
   }
 }
 
+template<typename Key, typename Elem, SparseUpdateOptions::Optimizer optimizer>
+__global__ void UpdateKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_keys,
+                             const Key* keys, const float* model_diff, SparseUpdateOptions options,
+                             uint32_t* n_missing_keys, Key* missing_keys,
+                             uint32_t* missing_indices) {
+  ThreadContext thread_ctx{};
+  __shared__ Key block_keys[kNumWarpPerBlock][kWarpSize];
+  __shared__ size_t block_set_ids[kNumWarpPerBlock][kWarpSize];
+  for (uint32_t batch_offset = thread_ctx.global_warp_id * kWarpSize; batch_offset < num_keys;
+       batch_offset += thread_ctx.num_warps * kWarpSize) {
+    const uint32_t n_batch_keys = min(kWarpSize, num_keys - batch_offset);
+    if (thread_ctx.lane_id < n_batch_keys) {
+      const Key key = keys[batch_offset + thread_ctx.lane_id];
+      const size_t hash = LruCacheHash()(key);
+      const uint32_t set_id = hash % cache_ctx.n_set;
+      block_keys[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = key;
+      block_set_ids[thread_ctx.warp_id_in_block][thread_ctx.lane_id] = set_id;
+    }
+    __syncwarp();
+    uint32_t n_warp_missing = 0;
+    Key warp_missing_key = 0;
+    uint32_t warp_missing_index = 0;
+    for (uint32_t i = 0; i < n_batch_keys; ++i) {
+      const uint32_t key_idx = batch_offset + i;
+      const Key key = block_keys[thread_ctx.warp_id_in_block][i];
+      const size_t set_id = block_set_ids[thread_ctx.warp_id_in_block][i];
+      SetContext<Key, Elem> set_ctx(cache_ctx, set_id);
+      const int way = set_ctx.Lookup(thread_ctx, key);
+      if (way < 0) {
+        if (thread_ctx.lane_id == n_warp_missing) {
+          warp_missing_key = key;
+          warp_missing_index = key_idx;
+        }
+        __syncwarp();
+        n_warp_missing += 1;
+      } else {
+        // The keys are unique, so the lanes of this warp are the only writers of the line.
+        float* line = reinterpret_cast<float*>(set_ctx.lines + way * cache_ctx.line_size);
+        const float* diff = model_diff + key_idx * options.embedding_size;
+        for (uint32_t j = thread_ctx.lane_id; j < options.embedding_size; j += kWarpSize) {
+          SparseUpdateElem<optimizer>(options, line + j, diff[j]);
+        }
+        __syncwarp();
+      }
+    }
+    if (n_warp_missing > 0) {
+      uint32_t base_missing_idx = 0;
+      if (thread_ctx.lane_id == 0) { base_missing_idx = atomicAdd(n_missing_keys, n_warp_missing); }
+      __syncwarp();
+      base_missing_idx = __shfl_sync(kFullMask, base_missing_idx, 0);
+      if (thread_ctx.lane_id < n_warp_missing) {
+        missing_keys[base_missing_idx + thread_ctx.lane_id] = warp_missing_key;
+        missing_indices[base_missing_idx + thread_ctx.lane_id] = warp_missing_index;
+      }
+      __syncwarp();
+    }
+    __syncwarp();
+  }
+}
+
 template<typename Key, typename Elem>
 __global__ void PutWithoutEvictingKernel(LruCacheContext<Key, Elem> cache_ctx, uint32_t num_keys,
                                          const Key* keys, const Elem* values, uint32_t* n_missing,
@@ -505,6 +566,36 @@ class LruCache : public Cache {
         static_cast<Elem*>(values));
   }
 
+  bool SupportsUpdate() const override { return true; }
+
+  void Update(ep::Stream* stream, uint32_t n_keys, const void* keys, const float* model_diff,
+              const SparseUpdateOptions& options, uint32_t* n_missing, void* missing_keys,
+              uint32_t* missing_indices) override {
+    CHECK_LE(n_keys, max_query_length_);
+    CHECK_GT(options.embedding_size, 0);
+    CHECK_LE((1 + NumOptimizerStates(options.optimizer)) * options.embedding_size * sizeof(float),
+             ValueSize());
+    auto cuda_stream = stream->As<ep::CudaStream>();
+    OF_CUDA_CHECK(cudaMemsetAsync(n_missing, 0, sizeof(uint32_t), cuda_stream->cuda_stream()));
+    if (n_keys == 0) { return; }
+#define LAUNCH_UPDATE_KERNEL(optimizer)                                                           \
+  cuda_stream->LaunchKernel(UpdateKernel<Key, Elem, optimizer>, GetLaunchConfig(n_keys), ctx_,    \
+                            n_keys, static_cast<const Key*>(keys), model_diff, options,           \
+                            n_missing, static_cast<Key*>(missing_keys), missing_indices)
+    if (options.optimizer == SparseUpdateOptions::Optimizer::kSGD) {
+      LAUNCH_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kSGD);
+    } else if (options.optimizer == SparseUpdateOptions::Optimizer::kMomentum) {
+      LAUNCH_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kMomentum);
+    } else if (options.optimizer == SparseUpdateOptions::Optimizer::kAdam) {
+      LAUNCH_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kAdam);
+    } else if (options.optimizer == SparseUpdateOptions::Optimizer::kAdagrad) {
+      LAUNCH_UPDATE_KERNEL(SparseUpdateOptions::Optimizer::kAdagrad);
+    } else {
+      UNIMPLEMENTED();
+    }
+#undef LAUNCH_UPDATE_KERNEL
+  }
+
   void Clear() override { ClearLruCacheContext<Key, Elem>(&ctx_); }
 
  private:
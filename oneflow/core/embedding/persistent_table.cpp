@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/common/channel.h"
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
 #include <robin_hood.h>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -28,9 +29,8 @@ limitations under the License.
 #include <sys/syscall.h>
 #include <linux/aio_abi.h>
 #include <unistd.h>
-#ifdef WITH_LIBURING
-#include <liburing.h>
-#endif  // WITH_LIBURING
+#include <map>
+#include "oneflow/core/persistence/posix/ring_engine.h"
 
 #endif  // __linux__
 
@@ -43,8 +43,6 @@ namespace embedding {
 namespace {
 
 constexpr uint32_t kNumWorkerThreads = 4;
-constexpr uint32_t kRingQueueDepth = 128;
-constexpr uint32_t kRingSubmitBatch = 32;
 constexpr uint32_t kAioQueueDepth = 128;
 constexpr uint32_t kChunkNameSuffixLength = 12;
 constexpr char const* kKeyFileNamePrefix = "key-";
@@ -55,10 +53,12 @@ constexpr char const* kKeySizeFileName = "KEY_SIZE";
 constexpr char const* kValueSizeFileName = "VALUE_SIZE";
 constexpr char const* kPhysicalBlockSizeFileName = "PHYSICAL_BLOCK_SIZE";
 constexpr char const* kNumLogicalBlocksPerChunkFileName = "NUM_LOGICAL_BLOCKS_PER_CHUNK";
+constexpr char const* kNumValueDirsFileName = "NUM_VALUE_DIRS";
 constexpr char const* kKeysDirName = "keys";
 constexpr char const* kValuesDirName = "values";
 constexpr char const* kSnapshotsDirName = "snapshots";
 constexpr char const* kSnapshotListFileName = "LIST";
+constexpr char const* kSnapshotParentFileName = "PARENT";
 constexpr size_t kParallelForStride = 256;
 
 template<typename T>
@@ -124,6 +124,70 @@ uint32_t GetLogicalBlockSize(uint32_t physical_block_size, uint32_t value_size)
                                            : RoundUp(value_size, physical_block_size);
 }
 
+// An incremental snapshot only lists the index files of the chunks changed since its parent, the
+// name of which is recorded in the PARENT file, and an empty index file shadows a chunk without
+// live rows. Walks the chain from the named snapshot to the full one, the newest index file of
+// each chunk wins.
+void ResolveSnapshotChain(const std::string& snapshots_dir, const std::string& name,
+                          std::vector<std::string>* chain,
+                          std::map<uint64_t, std::string>* chunk_index_files) {
+  chain->clear();
+  chunk_index_files->clear();
+  std::string current = name;
+  while (true) {
+    CHECK(std::find(chain->cbegin(), chain->cend(), current) == chain->cend())
+        << "Cyclic snapshot chain at " << current;
+    chain->push_back(current);
+    const std::string snapshot_base = PosixFile::JoinPath(snapshots_dir, current);
+    const std::string snapshot_list = PosixFile::JoinPath(snapshot_base, kSnapshotListFileName);
+    if (current != name) { CHECK(PosixFile::FileExists(snapshot_list)) << snapshot_list; }
+    std::ifstream list_if(snapshot_list);
+    std::string index_filename;
+    while (std::getline(list_if, index_filename)) {
+      const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
+      chunk_index_files->emplace(chunk_id, PosixFile::JoinPath(snapshot_base, index_filename));
+    }
+    const std::string parent_filename =
+        PosixFile::JoinPath(snapshot_base, kSnapshotParentFileName);
+    if (!PosixFile::FileExists(parent_filename)) { break; }
+    std::ifstream parent_if(parent_filename);
+    CHECK(std::getline(parent_if, current)) << parent_filename;
+  }
+}
+
+void CopyFile(const std::string& src, const std::string& dst) {
+  std::ifstream ifs(src, std::ios::binary);
+  CHECK(ifs.is_open()) << src;
+  std::ofstream ofs(dst, std::ios::binary | std::ios::trunc);
+  std::copy(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>(),
+            std::ostreambuf_iterator<char>(ofs));
+  CHECK(ofs.good()) << dst;
+}
+
+void CompactSnapshot(const std::string& snapshots_dir, const std::string& name) {
+  std::vector<std::string> chain;
+  std::map<uint64_t, std::string> chunk_index_files;
+  ResolveSnapshotChain(snapshots_dir, name, &chain, &chunk_index_files);
+  if (chain.size() == 1) { return; }
+  const std::string snapshot_base = PosixFile::JoinPath(snapshots_dir, name);
+  const std::string snapshot_list = PosixFile::JoinPath(snapshot_base, kSnapshotListFileName);
+  const std::string tmp_snapshot_list = snapshot_list + ".tmp";
+  {
+    std::ofstream list_ofs(tmp_snapshot_list);
+    for (const auto& pair : chunk_index_files) {
+      const std::string index_filename = kIndexFileNamePrefix + GetChunkName(pair.first);
+      const std::string index_path = PosixFile::JoinPath(snapshot_base, index_filename);
+      if (pair.second != index_path) { CopyFile(pair.second, index_path); }
+      // Empty index files are kept, so the new list is also valid with the PARENT file.
+      list_ofs << index_filename << std::endl;
+    }
+    CHECK(list_ofs.good()) << tmp_snapshot_list;
+  }
+  PCHECK(std::rename(tmp_snapshot_list.c_str(), snapshot_list.c_str()) == 0);
+  const std::string parent_filename = PosixFile::JoinPath(snapshot_base, kSnapshotParentFileName);
+  PCHECK(unlink(parent_filename.c_str()) == 0);
+}
+
 class AlignedBuffer final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(AlignedBuffer);
@@ -196,59 +260,6 @@ class ChunkIteratorImpl : public PersistentTable::Iterator {
   uint64_t chunk_index_offset_;
 };
 
-#ifdef WITH_LIBURING
-
-class RingEngine final {
- public:
-  OF_DISALLOW_COPY_AND_MOVE(RingEngine);
-  RingEngine() : ring_{}, pending_submit_(0), num_readings_(0) {
-    PCHECK(io_uring_queue_init(kRingQueueDepth, &ring_, 0) == 0);
-  }
-  ~RingEngine() {
-    WaitUntilDone();
-    io_uring_queue_exit(&ring_);
-  }
-
-  void AsyncPread(int fd, void* buf, size_t count, off_t offset) {
-    if (num_readings_ == kRingQueueDepth) {
-      struct io_uring_cqe* cqe = nullptr;
-      PCHECK(io_uring_wait_cqe(&ring_, &cqe) == 0);
-      CHECK_GE(cqe->res, 0);
-      io_uring_cqe_seen(&ring_, cqe);
-    } else {
-      num_readings_ += 1;
-    }
-    io_uring_sqe* sqe = CHECK_NOTNULL(io_uring_get_sqe(&ring_));
-    io_uring_prep_read(sqe, fd, buf, count, offset);
-    pending_submit_ += 1;
-    if (pending_submit_ == kRingSubmitBatch) {
-      PCHECK(io_uring_submit(&ring_) == pending_submit_);
-      pending_submit_ = 0;
-    }
-  }
-
-  void WaitUntilDone() {
-    if (pending_submit_ > 0) {
-      PCHECK(io_uring_submit(&ring_) == pending_submit_);
-      pending_submit_ = 0;
-    }
-    while (num_readings_ != 0) {
-      struct io_uring_cqe* cqe = nullptr;
-      PCHECK(io_uring_wait_cqe(&ring_, &cqe) == 0);
-      CHECK_GE(cqe->res, 0);
-      io_uring_cqe_seen(&ring_, cqe);
-      num_readings_ -= 1;
-    }
-  }
-
- private:
-  io_uring ring_;
-  uint32_t pending_submit_;
-  uint32_t num_readings_;
-};
-
-#endif  // WITH_LIBURING
-
 class AioEngine final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(AioEngine);
@@ -295,10 +306,33 @@ class AioEngine final {
   std::vector<struct io_event> events_;
 };
 
+// One engine per value directory, so the reads of a drive are queued and reaped on their own.
+template<typename Engine>
+class StripedEngine final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StripedEngine);
+  explicit StripedEngine(size_t num_stripes) {
+    engines_.resize(num_stripes);
+    for (auto& engine : engines_) { engine.reset(new Engine); }
+  }
+  ~StripedEngine() = default;
+
+  void AsyncPread(size_t stripe, int fd, void* buf, size_t count, off_t offset) {
+    engines_.at(stripe)->AsyncPread(fd, buf, count, offset);
+  }
+
+  void WaitUntilDone() {
+    for (auto& engine : engines_) { engine->WaitUntilDone(); }
+  }
+
+ private:
+  std::vector<std::unique_ptr<Engine>> engines_;
+};
+
 constexpr size_t kCacheLineSize = 64;
 
 template<typename Engine>
-using ForRange = std::function<void(Engine* engine, size_t start, size_t end)>;
+using ForRange = std::function<void(StripedEngine<Engine>* engine, size_t start, size_t end)>;
 
 template<typename Engine>
 struct ParallelForTask {
@@ -316,7 +350,9 @@ template<typename Engine>
 class Worker final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Worker);
-  Worker() { thread_ = std::thread(&Worker<Engine>::PullTask, this); }
+  explicit Worker(size_t num_stripes) : engine_(num_stripes) {
+    thread_ = std::thread(&Worker<Engine>::PullTask, this);
+  }
   ~Worker() {
     Shutdown();
     thread_.join();
@@ -345,7 +381,7 @@ class Worker final {
     }
   }
   Channel<ParallelForTask<Engine>*> tasks_;
-  Engine engine_;
+  StripedEngine<Engine> engine_;
   std::thread thread_;
 };
 
@@ -371,6 +407,16 @@ class PersistentTableImpl : public PersistentTable {
   void LoadSnapshot(const std::string& name,
                     const std::function<void(Iterator* iter)>& Hook) override;
   void SaveSnapshot(const std::string& name) override;
+  void GetStatistics(PersistentTableStatistics* statistics) const override {
+    statistics->num_block_reads = num_block_reads_.load(std::memory_order_relaxed);
+    statistics->num_block_writes = num_block_writes_.load(std::memory_order_relaxed);
+  }
+  void ResetStatistics() override {
+    num_block_reads_.store(0, std::memory_order_relaxed);
+    num_block_writes_.store(0, std::memory_order_relaxed);
+  }
+  void SetCurrentStep(uint64_t step) override;
+  uint64_t EvictExpired() override;
 
  private:
   std::string KeyFilePath(uint64_t chunk_id) const;
@@ -378,13 +424,17 @@ class PersistentTableImpl : public PersistentTable {
   std::string IndexFilePath(const std::string& name, uint64_t chunk_id) const;
   std::string SnapshotDirPath(const std::string& name) const;
   std::string SnapshotListFilePath(const std::string& name) const;
-  void LoadSnapshotImpl(const std::string& name);
+  std::string SnapshotParentFilePath(const std::string& name) const;
+  void LoadSnapshotImpl(const std::string& name, const std::function<void(Iterator* iter)>& Hook);
   void SaveSnapshotImpl(const std::string& name);
+  void MarkChunkDirty(uint64_t chunk_id);
+  bool IsExpired(uint64_t row_id) const;
+  void PutReusedRows(uint32_t begin, uint32_t end, const void* keys, const void* blocks);
   void ParallelFor(size_t total, const ForRange<Engine>& for_range);
 
   std::string root_dir_;
   std::string keys_dir_;
-  std::string values_dir_;
+  std::vector<std::string> values_dirs_;
   std::string snapshots_dir_;
   uint32_t key_size_;
   uint32_t value_size_;
@@ -392,15 +442,32 @@ class PersistentTableImpl : public PersistentTable {
   uint64_t num_values_per_chunk_;
   uint32_t num_values_per_block_;
   uint32_t logical_block_size_;
+  bool incremental_snapshot_;
+  uint32_t max_snapshot_chain_length_;
+  uint64_t ttl_;
 
   std::vector<std::unique_ptr<Worker<Engine>>> workers_;
 
   std::vector<uint32_t> offsets_buffer_;
   AlignedBuffer blocks_buffer_;
+  AlignedBuffer reused_block_buffer_;
 
   std::recursive_mutex mutex_;
   uint64_t physical_table_size_;
   robin_hood::unordered_flat_map<Key, uint64_t> row_id_mapping_;
+  // The snapshot chain last saved or loaded, newest first, and the chunks changed since then.
+  std::vector<std::string> snapshot_chain_;
+  std::vector<bool> dirty_chunks_;
+  // The step each physical row was last accessed at, only kept when ttl is set. Steps are not
+  // saved in snapshots, the rows loaded are stamped with the current step.
+  uint64_t current_step_;
+  std::vector<uint64_t> last_access_steps_;
+  // Rows of expired and overwritten keys, only kept when ttl is set. The last snapshot may still
+  // reference them, so they wait in pending_free_row_ids_ until the next one is saved.
+  std::vector<uint64_t> pending_free_row_ids_;
+  std::vector<uint64_t> free_row_ids_;
+  std::atomic<uint64_t> num_block_reads_{0};
+  std::atomic<uint64_t> num_block_writes_{0};
   std::vector<PosixFile> value_files_;
   PosixFile writable_key_file_;
   uint64_t writable_key_file_chunk_id_;
@@ -413,7 +480,12 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
       key_size_(options.key_size),
       value_size_(options.value_size),
       logical_block_size_(GetLogicalBlockSize(options.physical_block_size, value_size_)),
+      incremental_snapshot_(options.incremental_snapshot),
+      max_snapshot_chain_length_(options.max_snapshot_chain_length),
+      ttl_(options.ttl),
+      current_step_(0),
       blocks_buffer_(options.physical_block_size),
+      reused_block_buffer_(options.physical_block_size),
       writable_key_file_chunk_id_(-1) {
   PosixFile::RecursiveCreateDirectory(options.path, 0755);
   const std::string lock_filename = PosixFile::JoinPath(options.path, kLockFileName);
@@ -431,18 +503,39 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
   InitOrCheckMetaValue(PosixFile::JoinPath(options.path, kNumLogicalBlocksPerChunkFileName),
                        num_logical_blocks_per_chunk_, init);
   keys_dir_ = PosixFile::JoinPath(options.path, kKeysDirName);
-  values_dir_ = PosixFile::JoinPath(options.path, kValuesDirName);
+  if (options.value_paths.empty()) {
+    values_dirs_.push_back(PosixFile::JoinPath(options.path, kValuesDirName));
+  } else {
+    values_dirs_ = options.value_paths;
+  }
+  const std::string num_value_dirs_filename =
+      PosixFile::JoinPath(options.path, kNumValueDirsFileName);
+  if (init || PosixFile::FileExists(num_value_dirs_filename)) {
+    InitOrCheckMetaValue(num_value_dirs_filename, values_dirs_.size(), init);
+  } else {
+    // Tables created before striping keep their values under path.
+    CHECK(options.value_paths.empty()) << options.path << " is not striped";
+  }
   snapshots_dir_ = PosixFile::JoinPath(options.path, kSnapshotsDirName);
   if (init) {
     PosixFile::RecursiveCreateDirectory(keys_dir_, 0755);
-    PosixFile::RecursiveCreateDirectory(values_dir_, 0755);
+    for (const auto& values_dir : values_dirs_) {
+      PosixFile::RecursiveCreateDirectory(values_dir, 0755);
+    }
   }
   workers_.resize(kNumWorkerThreads);
   for (uint32_t tid = 0; tid < kNumWorkerThreads; ++tid) {
-    workers_.at(tid).reset(new Worker<Engine>);
+    workers_.at(tid).reset(new Worker<Engine>(values_dirs_.size()));
   }
   std::unordered_map<uint64_t, std::string> chunks;
-  ListChunkFiles(values_dir_, kValueFileNamePrefix, &chunks);
+  for (size_t i = 0; i < values_dirs_.size(); ++i) {
+    std::unordered_map<uint64_t, std::string> dir_chunks;
+    ListChunkFiles(values_dirs_.at(i), kValueFileNamePrefix, &dir_chunks);
+    for (auto& chunk : dir_chunks) {
+      CHECK_EQ(chunk.first % values_dirs_.size(), i) << chunk.second;
+      CHECK(chunks.emplace(chunk.first, std::move(chunk.second)).second);
+    }
+  }
   for (auto& chunk : chunks) {
     if (value_files_.size() <= chunk.first) { value_files_.resize(chunk.first + 1); }
     CHECK_EQ(value_files_.at(chunk.first).fd(), -1);
@@ -456,6 +549,7 @@ PersistentTableImpl<Key, Engine>::PersistentTableImpl(const PersistentTableOptio
   } else {
     physical_table_size_ = 0;
   }
+  if (ttl_ > 0) { last_access_steps_.resize(physical_table_size_, current_step_); }
 }
 
 template<typename Key, typename Engine>
@@ -472,7 +566,8 @@ template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void* keys, void* blocks,
                                                  uint32_t* offsets) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  ParallelFor(num_keys, [&](Engine* engine, size_t start, size_t end) {
+  ParallelFor(num_keys, [&](StripedEngine<Engine>* engine, size_t start, size_t end) {
+    uint64_t num_reads = 0;
     for (uint64_t i = start; i < end; ++i) {
       const Key key = static_cast<const Key*>(keys)[i];
       auto it = row_id_mapping_.find(key);
@@ -480,6 +575,7 @@ void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void*
         offsets[i] = logical_block_size_;
       } else {
         const uint64_t id = it->second;
+        if (ttl_ > 0) { last_access_steps_[id] = current_step_; }
         const uint64_t block_id = id / num_values_per_block_;
         const uint32_t id_in_block = id - block_id * num_values_per_block_;
         const uint32_t offset_in_block = id_in_block * value_size_;
@@ -488,10 +584,13 @@ void PersistentTableImpl<Key, Engine>::GetBlocks(uint32_t num_keys, const void*
         const uint64_t block_offset = block_in_chunk * logical_block_size_;
         PosixFile& file = value_files_.at(chunk_id);
         offsets[i] = offset_in_block;
-        engine->AsyncPread(file.fd(), BytesOffset(blocks, i * logical_block_size_),
-                           logical_block_size_, block_offset);
+        engine->AsyncPread(chunk_id % values_dirs_.size(), file.fd(),
+                           BytesOffset(blocks, i * logical_block_size_), logical_block_size_,
+                           block_offset);
+        num_reads += 1;
       }
     }
+    num_block_reads_.fetch_add(num_reads, std::memory_order_relaxed);
   });
 }
 
@@ -527,14 +626,27 @@ template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void* keys,
                                                  const void* blocks) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_);
+  // The tail of the batch takes the free rows, the rest is appended block by block.
+  const uint32_t num_reused_keys =
+      std::min(static_cast<uint64_t>(num_keys), static_cast<uint64_t>(free_row_ids_.size()));
+  PutReusedRows(num_keys - num_reused_keys, num_keys, keys, blocks);
+  num_keys -= num_reused_keys;
+  if (num_keys == 0) { return; }
+  const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_) / num_values_per_block_;
   const uint32_t num_padded_keys = num_blocks * num_values_per_block_;
   const uint64_t start_index = physical_table_size_;
   physical_table_size_ += num_padded_keys;
   CHECK_EQ(start_index % num_values_per_block_, 0);
   const uint64_t start_block_id = start_index / num_values_per_block_;
+  num_block_writes_.fetch_add(num_blocks, std::memory_order_relaxed);
+  if (ttl_ > 0) { last_access_steps_.resize(physical_table_size_, current_step_); }
   for (uint64_t i = 0; i < num_keys; ++i) {
-    row_id_mapping_[static_cast<const Key*>(keys)[i]] = start_index + i;
+    auto it = row_id_mapping_.emplace(static_cast<const Key*>(keys)[i], start_index + i);
+    if (!it.second) {
+      MarkChunkDirty(it.first->second / num_values_per_chunk_);
+      if (ttl_ > 0) { pending_free_row_ids_.push_back(it.first->second); }
+      it.first->second = start_index + i;
+    }
   }
   uint64_t written_blocks = 0;
   const uint64_t block_keys_size = num_values_per_block_ * sizeof(Key);
@@ -549,6 +661,7 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
     if ((!writable_key_file_.IsOpen()) || writable_key_file_chunk_id_ != batch_chunk_id) {
       writable_key_file_ = PosixFile(KeyFilePath(batch_chunk_id), O_CREAT | O_RDWR, 0644);
     }
+    MarkChunkDirty(batch_chunk_id);
     PosixFile& value_file = value_files_.at(batch_chunk_id);
     const uint64_t block_id_in_chunk =
         batch_start_block_id - batch_chunk_id * num_logical_blocks_per_chunk_;
@@ -574,6 +687,65 @@ void PersistentTableImpl<Key, Engine>::PutBlocks(uint32_t num_keys, const void*
   }
 }
 
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::PutReusedRows(uint32_t begin, uint32_t end,
+                                                     const void* keys, const void* blocks) {
+  if (begin == end) { return; }
+  std::vector<std::pair<uint64_t, uint32_t>> rows;
+  rows.reserve(end - begin);
+  for (uint32_t i = begin; i < end; ++i) {
+    const uint64_t id = free_row_ids_.back();
+    free_row_ids_.pop_back();
+    const Key key = static_cast<const Key*>(keys)[i];
+    auto it = row_id_mapping_.emplace(key, id);
+    if (!it.second) {
+      MarkChunkDirty(it.first->second / num_values_per_chunk_);
+      if (ttl_ > 0) { pending_free_row_ids_.push_back(it.first->second); }
+      it.first->second = id;
+    }
+    if (ttl_ > 0) { last_access_steps_[id] = current_step_; }
+    rows.emplace_back(id, i);
+  }
+  // Rows sharing a block are patched with a single read and write of it.
+  std::sort(rows.begin(), rows.end());
+  reused_block_buffer_.Resize(logical_block_size_);
+  void* block = reused_block_buffer_.ptr();
+  PosixFile key_file;
+  uint64_t key_file_chunk_id = -1;
+  for (size_t i = 0; i < rows.size();) {
+    const uint64_t block_id = rows.at(i).first / num_values_per_block_;
+    const uint64_t chunk_id = block_id / num_logical_blocks_per_chunk_;
+    const uint64_t block_offset =
+        (block_id - chunk_id * num_logical_blocks_per_chunk_) * logical_block_size_;
+    if (key_file_chunk_id != chunk_id) {
+      key_file = PosixFile(KeyFilePath(chunk_id), O_RDWR, 0644);
+      key_file_chunk_id = chunk_id;
+    }
+    MarkChunkDirty(chunk_id);
+    PosixFile& value_file = value_files_.at(chunk_id);
+    PCHECK(pread(value_file.fd(), block, logical_block_size_, block_offset)
+           == logical_block_size_);
+    for (; i < rows.size() && rows.at(i).first / num_values_per_block_ == block_id; ++i) {
+      const uint64_t id = rows.at(i).first;
+      const uint32_t key_index = rows.at(i).second;
+      const uint32_t id_in_block = id - block_id * num_values_per_block_;
+      const uint32_t index_in_block = key_index % num_values_per_block_;
+      MemcpyOffset(block, id_in_block * value_size_, blocks,
+                   (key_index - index_in_block) / num_values_per_block_ * logical_block_size_
+                       + index_in_block * value_size_,
+                   value_size_);
+      const uint64_t key_offset = (id - chunk_id * num_values_per_chunk_) * sizeof(Key);
+      PCHECK(pwrite(key_file.fd(), static_cast<const Key*>(keys) + key_index, sizeof(Key),
+                    key_offset)
+             == sizeof(Key));
+    }
+    PCHECK(pwrite(value_file.fd(), block, logical_block_size_, block_offset)
+           == logical_block_size_);
+    num_block_reads_.fetch_add(1, std::memory_order_relaxed);
+    num_block_writes_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::Put(uint32_t num_keys, const void* keys,
                                            const void* values) {
@@ -582,7 +754,7 @@ void PersistentTableImpl<Key, Engine>::Put(uint32_t num_keys, const void* keys,
   if (value_size_ == logical_block_size_) {
     blocks_ptr = values;
   } else {
-    const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_);
+    const uint32_t num_blocks = RoundUp(num_keys, num_values_per_block_) / num_values_per_block_;
     blocks_buffer_.Resize(num_blocks * logical_block_size_);
     for (uint32_t i = 0; i < num_keys; i += num_values_per_block_) {
       const uint32_t block_id = i / num_values_per_block_;
@@ -604,7 +776,8 @@ std::string PersistentTableImpl<Key, Engine>::KeyFilePath(uint64_t chunk_id) con
 
 template<typename Key, typename Engine>
 std::string PersistentTableImpl<Key, Engine>::ValueFilePath(uint64_t chunk_id) const {
-  return PosixFile::JoinPath(values_dir_, kValueFileNamePrefix + GetChunkName(chunk_id));
+  return PosixFile::JoinPath(values_dirs_.at(chunk_id % values_dirs_.size()),
+                             kValueFileNamePrefix + GetChunkName(chunk_id));
 }
 
 template<typename Key, typename Engine>
@@ -624,23 +797,68 @@ std::string PersistentTableImpl<Key, Engine>::SnapshotListFilePath(const std::st
 }
 
 template<typename Key, typename Engine>
-void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name) {
+std::string PersistentTableImpl<Key, Engine>::SnapshotParentFilePath(
+    const std::string& name) const {
+  return PosixFile::JoinPath(SnapshotDirPath(name), kSnapshotParentFileName);
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::MarkChunkDirty(uint64_t chunk_id) {
+  if (chunk_id >= dirty_chunks_.size()) { dirty_chunks_.resize(chunk_id + 1); }
+  dirty_chunks_[chunk_id] = true;
+}
+
+template<typename Key, typename Engine>
+bool PersistentTableImpl<Key, Engine>::IsExpired(uint64_t row_id) const {
+  const uint64_t last_access_step = last_access_steps_[row_id];
+  return last_access_step < current_step_ && current_step_ - last_access_step > ttl_;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::SetCurrentStep(uint64_t step) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  current_step_ = step;
+}
+
+template<typename Key, typename Engine>
+uint64_t PersistentTableImpl<Key, Engine>::EvictExpired() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (ttl_ == 0) { return 0; }
+  // Only the live rows are visited, the free ones have no key left to expire.
+  uint64_t num_evicted = 0;
+  for (auto it = row_id_mapping_.begin(); it != row_id_mapping_.end();) {
+    if (IsExpired(it->second)) {
+      MarkChunkDirty(it->second / num_values_per_chunk_);
+      pending_free_row_ids_.push_back(it->second);
+      it = row_id_mapping_.erase(it);
+      num_evicted += 1;
+    } else {
+      ++it;
+    }
+  }
+  return num_evicted;
+}
+
+template<typename Key, typename Engine>
+void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(
+    const std::string& name, const std::function<void(Iterator* iter)>& Hook) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
+  profiler::CheckpointIOPhaseTimer timer("persistent_table_load", "load", 0);
+  int64_t loaded_bytes = 0;
   row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
+  std::map<uint64_t, std::string> chunk_index_files;
+  ResolveSnapshotChain(snapshots_dir_, name, &snapshot_chain_, &chunk_index_files);
+  for (const auto& pair : chunk_index_files) {
+    const uint64_t chunk_id = pair.first;
+    PosixFile index_file(pair.second, O_RDONLY, 0644);
     const size_t index_file_size = index_file.Size();
     CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
+    if (index_file_size == 0) { continue; }
     const size_t n_entries = index_file_size / sizeof(uint64_t);
     PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
     PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
     PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
+    loaded_bytes += index_file_size + n_entries * sizeof(Key);
     const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
     const Key* keys = static_cast<const Key*>(mapped_key.ptr());
     const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
@@ -648,42 +866,104 @@ void PersistentTableImpl<Key, Engine>::LoadSnapshotImpl(const std::string& name)
     for (size_t i = 0; i < n_entries; ++i) {
       CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
     }
+    if (Hook) {
+      PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
+      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ);
+      ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
+                                            num_values_per_chunk_, chunk_id, n_entries, keys,
+                                            indices, mapped_value.ptr());
+      Hook(&chunk_iterator);
+      loaded_bytes += n_entries * value_size_;
+    }
+  }
+  timer.set_bytes(loaded_bytes);
+  std::fill(dirty_chunks_.begin(), dirty_chunks_.end(), false);
+  if (ttl_ > 0) {
+    last_access_steps_.assign(physical_table_size_, current_step_);
+    // Every row the loaded snapshot does not reference may be reused.
+    std::vector<bool> referenced(physical_table_size_);
+    for (const auto& pair : row_id_mapping_) { referenced[pair.second] = true; }
+    pending_free_row_ids_.clear();
+    free_row_ids_.clear();
+    for (uint64_t i = physical_table_size_; i > 0; --i) {
+      if (!referenced[i - 1]) { free_row_ids_.push_back(i - 1); }
+    }
   }
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::SaveSnapshotImpl(const std::string& name) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  EvictExpired();
+  const bool incremental =
+      incremental_snapshot_ && !snapshot_chain_.empty()
+      && snapshot_chain_.size() < max_snapshot_chain_length_
+      && std::find(snapshot_chain_.cbegin(), snapshot_chain_.cend(), name) == snapshot_chain_.cend()
+      && SnapshotExists(snapshot_chain_.front());
+  const auto IsChunkSaved = [&](uint64_t chunk_id) {
+    return !incremental || (chunk_id < dirty_chunks_.size() && dirty_chunks_[chunk_id]);
+  };
   PosixFile::RecursiveCreateDirectory(SnapshotDirPath(name), 0755);
+  const std::string parent_filename = SnapshotParentFilePath(name);
+  if (incremental) {
+    std::ofstream parent_ofs(parent_filename);
+    parent_ofs << snapshot_chain_.front() << std::endl;
+  } else if (PosixFile::FileExists(parent_filename)) {
+    PCHECK(unlink(parent_filename.c_str()) == 0);
+  }
   std::ofstream list_ofs(SnapshotListFilePath(name));
-  if (row_id_mapping_.empty()) { return; }
   std::vector<PosixMappedFile> index_files(value_files_.size());
   std::vector<uint64_t> counters(value_files_.size());
   const uint64_t max_index_file_size = num_values_per_chunk_ * sizeof(uint64_t);
-  for (const auto& pair : row_id_mapping_) {
-    const uint64_t chunk_id = pair.second / num_values_per_chunk_;
-    CHECK(chunk_id < value_files_.size());
-    if (index_files[chunk_id].ptr() == nullptr) {
-      PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
-      snapshot_file.Truncate(max_index_file_size);
-      index_files[chunk_id] =
-          PosixMappedFile(std::move(snapshot_file), max_index_file_size, PROT_READ | PROT_WRITE);
+  // The values stay in the chunk files, a snapshot only writes the row ids of the saved chunks.
+  {
+    profiler::CheckpointIOPhaseTimer timer("persistent_table_save", "serialize", 0);
+    for (const auto& pair : row_id_mapping_) {
+      const uint64_t chunk_id = pair.second / num_values_per_chunk_;
+      CHECK(chunk_id < value_files_.size());
+      if (!IsChunkSaved(chunk_id)) { continue; }
+      if (index_files[chunk_id].ptr() == nullptr) {
+        PosixFile snapshot_file(IndexFilePath(name, chunk_id), O_CREAT | O_RDWR, 0644);
+        snapshot_file.Truncate(max_index_file_size);
+        index_files[chunk_id] = PosixMappedFile(std::move(snapshot_file), max_index_file_size,
+                                                PROT_READ | PROT_WRITE);
+      }
+      uint64_t* indices = static_cast<uint64_t*>(index_files[chunk_id].ptr());
+      uint64_t& count = counters[chunk_id];
+      CHECK_LT(count, num_values_per_chunk_);
+      indices[count] = pair.second;
+      count += 1;
     }
-    uint64_t* indices = static_cast<uint64_t*>(index_files[chunk_id].ptr());
-    uint64_t& count = counters[chunk_id];
-    CHECK_LT(count, num_values_per_chunk_);
-    indices[count] = pair.second;
-    count += 1;
-  }
-  for (size_t i = 0; i < value_files_.size(); ++i) {
-    const uint64_t count = counters[i];
-    if (count > 0) {
-      index_files[i].file().Truncate(count * sizeof(uint64_t));
-      list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
-    } else {
-      CHECK(index_files[i].ptr() == nullptr);
+    int64_t index_bytes = 0;
+    for (uint64_t count : counters) { index_bytes += count * sizeof(uint64_t); }
+    timer.set_bytes(index_bytes);
+  }
+  {
+    profiler::CheckpointIOPhaseTimer timer("persistent_table_save", "close", 0);
+    for (size_t i = 0; i < value_files_.size(); ++i) {
+      const uint64_t count = counters[i];
+      if (count > 0) {
+        index_files[i].file().Truncate(count * sizeof(uint64_t));
+        list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
+      } else {
+        CHECK(index_files[i].ptr() == nullptr);
+        if (incremental && IsChunkSaved(i)) {
+          // All rows of the chunk have been overwritten, shadow the index file of the parent.
+          PosixFile(IndexFilePath(name, i), O_CREAT | O_RDWR | O_TRUNC, 0644);
+          list_ofs << kIndexFileNamePrefix + GetChunkName(i) << std::endl;
+        }
+      }
     }
+    // Unmaps and closes the index files.
+    index_files.clear();
+    list_ofs.close();
   }
+  if (!incremental) { snapshot_chain_.clear(); }
+  snapshot_chain_.insert(snapshot_chain_.begin(), name);
+  std::fill(dirty_chunks_.begin(), dirty_chunks_.end(), false);
+  free_row_ids_.insert(free_row_ids_.end(), pending_free_row_ids_.cbegin(),
+                       pending_free_row_ids_.cend());
+  pending_free_row_ids_.clear();
 }
 
 template<typename Key, typename Engine>
@@ -694,44 +974,13 @@ bool PersistentTableImpl<Key, Engine>::SnapshotExists(const std::string& name) {
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::LoadSnapshot(const std::string& name) {
-  LoadSnapshotImpl(name);
+  LoadSnapshotImpl(name, nullptr);
 }
 
 template<typename Key, typename Engine>
 void PersistentTableImpl<Key, Engine>::LoadSnapshot(
     const std::string& name, const std::function<void(Iterator* iter)>& Hook) {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  const std::string snapshot_base = SnapshotDirPath(name);
-  const std::string snapshot_list = SnapshotListFilePath(name);
-  row_id_mapping_.clear();
-  std::ifstream list_if(snapshot_list);
-  std::string index_filename;
-  while (std::getline(list_if, index_filename)) {
-    const uint64_t chunk_id = GetChunkId(index_filename, kIndexFileNamePrefix);
-    PosixFile index_file(PosixFile::JoinPath(snapshot_base, index_filename), O_RDONLY, 0644);
-    const size_t index_file_size = index_file.Size();
-    CHECK_EQ(index_file_size % sizeof(uint64_t), 0);
-    if (index_file_size == 0) { return; }
-    const size_t n_entries = index_file_size / sizeof(uint64_t);
-    PosixMappedFile mapped_index(std::move(index_file), index_file_size, PROT_READ);
-    PosixFile key_file(KeyFilePath(chunk_id), O_RDONLY, 0644);
-    PosixMappedFile mapped_key(std::move(key_file), key_file.Size(), PROT_READ);
-    const uint64_t* indices = static_cast<const uint64_t*>(mapped_index.ptr());
-    const Key* keys = static_cast<const Key*>(mapped_key.ptr());
-    const uint64_t chunk_start_index = chunk_id * num_values_per_chunk_;
-    row_id_mapping_.reserve(row_id_mapping_.size() + n_entries);
-    for (size_t i = 0; i < n_entries; ++i) {
-      CHECK(row_id_mapping_.emplace(keys[indices[i] - chunk_start_index], indices[i]).second);
-    }
-    if (Hook) {
-      PosixFile value_file(ValueFilePath(chunk_id), O_RDONLY, 0644);
-      PosixMappedFile mapped_value(std::move(value_file), value_file.Size(), PROT_READ);
-      ChunkIteratorImpl<Key> chunk_iterator(value_size_, logical_block_size_, num_values_per_block_,
-                                            num_values_per_chunk_, chunk_id, n_entries, keys,
-                                            indices, mapped_value.ptr());
-      Hook(&chunk_iterator);
-    }
-  }
+  LoadSnapshotImpl(name, Hook);
 }
 
 template<typename Key, typename Engine>
@@ -774,14 +1023,22 @@ bool IsRingIOSupported() {
 }
 
 std::unique_ptr<PersistentTable> DispatchEngine(const PersistentTableOptions& options) {
+  if (options.io_engine == PersistentTableOptions::IoEngine::kAio) {
+    return DispatchKeyType<AioEngine>(options);
+  }
 #ifdef WITH_LIBURING
   static bool ring_io_supported = IsRingIOSupported();
+  if (options.io_engine == PersistentTableOptions::IoEngine::kRing) {
+    CHECK(ring_io_supported) << "io_uring is not supported";
+  }
   if (ring_io_supported) {
     return DispatchKeyType<RingEngine>(options);
   } else {
     return DispatchKeyType<AioEngine>(options);
   }
 #else
+  CHECK(options.io_engine != PersistentTableOptions::IoEngine::kRing)
+      << "OneFlow is not built with liburing";
   return DispatchKeyType<AioEngine>(options);
 #endif
 }
@@ -804,6 +1061,15 @@ std::unique_ptr<PersistentTable> NewPersistentTable(const PersistentTableOptions
 #endif  // __linux__
 }
 
+void CompactPersistentTableSnapshot(const std::string& path, const std::string& name) {
+#ifdef __linux__
+  CHECK(!path.empty());
+  CompactSnapshot(PosixFile::JoinPath(path, kSnapshotsDirName), name);
+#else
+  UNIMPLEMENTED();
+#endif  // __linux__
+}
+
 }  // namespace embedding
 
 }  // namespace oneflow
@@ -22,12 +22,37 @@ namespace oneflow {
 
 namespace embedding {
 
+struct PersistentTableStatistics {
+  uint64_t num_block_reads = 0;
+  uint64_t num_block_writes = 0;
+};
+
 struct PersistentTableOptions {
+  enum class IoEngine {
+    kAuto,
+    kAio,
+    kRing,
+  };
   std::string path;
+  // Directories the value chunk files are striped across, chunk i lives in
+  // value_paths[i % value_paths.size()], each is meant to be on its own drive. The workers keep an
+  // io engine per directory. Empty keeps the values under path, the keys, the metadata and the
+  // snapshots always stay there. A table has to be reopened with the same number of directories.
+  std::vector<std::string> value_paths;
   uint32_t key_size = 0;
   uint32_t value_size = 0;
   uint64_t target_chunk_size_mb = 4 * 1024;
   uint16_t physical_block_size = 4096;
+  // When enabled, a snapshot only records the chunks changed since the last snapshot saved or
+  // loaded (its parent), a full snapshot is written once the chain reaches the length limit.
+  bool incremental_snapshot = false;
+  uint32_t max_snapshot_chain_length = 8;
+  // Rows not accessed in the last ttl steps are expired, 0 disables expiry. Once a snapshot no
+  // longer references them, the rows of expired and overwritten keys are reused by later puts, so
+  // with a ttl only the snapshot last saved or loaded is guaranteed to stay loadable.
+  uint64_t ttl = 0;
+  // kAuto uses io_uring when it is built with and supported by the kernel, and Linux AIO otherwise.
+  IoEngine io_engine = IoEngine::kAuto;
 };
 
 class PersistentTable {
@@ -59,10 +84,21 @@ class PersistentTable {
   virtual void LoadSnapshot(const std::string& name,
                             const std::function<void(Iterator* iter)>& Hook) = 0;
   virtual void SaveSnapshot(const std::string& name) = 0;
+  virtual void GetStatistics(PersistentTableStatistics* statistics) const = 0;
+  virtual void ResetStatistics() = 0;
+  // Sets the step stamped on the rows read or written from now on.
+  virtual void SetCurrentStep(uint64_t step) = 0;
+  // Removes the expired rows and returns their number, SaveSnapshot does it before saving. The
+  // rows are reused by the puts after the next SaveSnapshot.
+  virtual uint64_t EvictExpired() = 0;
 };
 
 std::unique_ptr<PersistentTable> NewPersistentTable(const PersistentTableOptions& options);
 
+// Merges the chain of incremental snapshots ending at the named snapshot back into a full one in
+// place, snapshots derived from it stay valid.
+void CompactPersistentTableSnapshot(const std::string& path, const std::string& name);
+
 }  // namespace embedding
 
 }  // namespace oneflow
@@ -131,11 +131,24 @@ class KeyValueStoreImpl : public KeyValueStore {
   void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
            uint32_t* n_missing, uint32_t* missing_indices) override;
   void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override;
+  void Prefetch(ep::Stream* stream, uint32_t num_keys, const void* keys) override {
+    // All reads are served by the table directly, there is no faster tier to fill.
+  }
   bool SnapshotExists(const std::string& name) override;
   void LoadSnapshot(const std::string& name) override;
   void LoadSnapshot(const std::string& name,
                     const std::function<void(KVIterator* iter)>& Hook) override;
   void SaveSnapshot(const std::string& name) override;
+  void GetStatistics(KeyValueStoreStatistics* statistics) const override {
+    PersistentTableStatistics table_statistics;
+    table_->GetStatistics(&table_statistics);
+    statistics->caches.clear();
+    statistics->num_store_block_reads = table_statistics.num_block_reads;
+    statistics->num_store_block_writes = table_statistics.num_block_writes;
+  }
+  void ResetStatistics() override { table_->ResetStatistics(); }
+  void SetCurrentStep(uint64_t step) override { table_->SetCurrentStep(step); }
+  uint64_t EvictExpired() override { return table_->EvictExpired(); }
 
  private:
   int device_index_;
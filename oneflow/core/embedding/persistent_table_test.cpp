@@ -0,0 +1,228 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/persistent_table.h"
+#include "oneflow/core/embedding/posix_file.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef __linux__
+
+// Value files are opened with O_DIRECT, which tmpfs does not support, so stay off /tmp.
+std::string CreateTempDirectory() {
+  char tmpl[] = "persistent_table_test_XXXXXX";
+  CHECK(mkdtemp(tmpl) != nullptr);
+  return tmpl;
+}
+
+PersistentTableOptions GetOptions(const std::string& path) {
+  PersistentTableOptions options;
+  options.path = path;
+  options.key_size = sizeof(uint64_t);
+  options.value_size = sizeof(float) * 4;
+  options.target_chunk_size_mb = 1;
+  options.physical_block_size = 512;
+  options.incremental_snapshot = true;
+  options.max_snapshot_chain_length = 4;
+  return options;
+}
+
+void PutRange(PersistentTable* table, uint64_t begin, uint64_t end, float base) {
+  std::vector<uint64_t> keys;
+  std::vector<float> values;
+  for (uint64_t key = begin; key < end; ++key) {
+    keys.push_back(key);
+    for (uint32_t j = 0; j < 4; ++j) { values.push_back(base + key); }
+  }
+  table->Put(keys.size(), keys.data(), values.data());
+}
+
+void CheckRange(PersistentTable* table, uint64_t begin, uint64_t end, float base) {
+  std::vector<uint64_t> keys;
+  for (uint64_t key = begin; key < end; ++key) { keys.push_back(key); }
+  std::vector<float> values(keys.size() * 4);
+  std::vector<uint32_t> missing_indices(keys.size());
+  uint32_t n_missing = 0;
+  table->Get(keys.size(), keys.data(), values.data(), &n_missing, missing_indices.data());
+  ASSERT_EQ(n_missing, 0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    for (uint32_t j = 0; j < 4; ++j) { ASSERT_EQ(values[i * 4 + j], base + keys[i]); }
+  }
+}
+
+void CheckMissing(PersistentTable* table, uint64_t begin, uint64_t end) {
+  std::vector<uint64_t> keys;
+  for (uint64_t key = begin; key < end; ++key) { keys.push_back(key); }
+  std::vector<float> values(keys.size() * 4);
+  std::vector<uint32_t> missing_indices(keys.size());
+  uint32_t n_missing = 0;
+  table->Get(keys.size(), keys.data(), values.data(), &n_missing, missing_indices.data());
+  ASSERT_EQ(n_missing, keys.size());
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+#ifdef __linux__
+
+TEST(PersistentTable, IncrementalSnapshot) {
+  const std::string path = CreateTempDirectory();
+  // 1MB chunks of 512B blocks hold 65536 values of 16B each.
+  const uint64_t n_keys = 65536 * 3;
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(GetOptions(path));
+    PutRange(table.get(), 0, n_keys, 0);
+    table->SaveSnapshot("s0");
+    PutRange(table.get(), 0, 1024, 1);
+    table->SaveSnapshot("s1");
+    // Moves every row of the first chunk, so its index is shadowed by an empty one.
+    PutRange(table.get(), 1024, 65536, 2);
+    table->SaveSnapshot("s2");
+    PutRange(table.get(), n_keys, n_keys + 1024, 3);
+    table->SaveSnapshot("s3");
+  }
+  ASSERT_TRUE(PosixFile::FileExists(path + "/snapshots/s3/PARENT"));
+  ASSERT_FALSE(PosixFile::FileExists(path + "/snapshots/s0/PARENT"));
+  const auto CheckS3 = [&](PersistentTable* table) {
+    CheckRange(table, 0, 1024, 1);
+    CheckRange(table, 1024, 65536, 2);
+    CheckRange(table, 65536, n_keys, 0);
+    CheckRange(table, n_keys, n_keys + 1024, 3);
+  };
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(GetOptions(path));
+    table->LoadSnapshot("s1");
+    CheckRange(table.get(), 0, 1024, 1);
+    CheckRange(table.get(), 1024, n_keys, 0);
+    CheckMissing(table.get(), n_keys, n_keys + 1024);
+    table->LoadSnapshot("s3");
+    CheckS3(table.get());
+    // The chain has reached max_snapshot_chain_length, a full snapshot is written.
+    table->SaveSnapshot("s4");
+    ASSERT_FALSE(PosixFile::FileExists(path + "/snapshots/s4/PARENT"));
+  }
+  CompactPersistentTableSnapshot(path, "s2");
+  ASSERT_FALSE(PosixFile::FileExists(path + "/snapshots/s2/PARENT"));
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(GetOptions(path));
+    table->LoadSnapshot("s3");
+    CheckS3(table.get());
+    table->LoadSnapshot("s4");
+    CheckS3(table.get());
+  }
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, ExpireRows) {
+  const std::string path = CreateTempDirectory();
+  PersistentTableOptions options = GetOptions(path);
+  options.ttl = 10;
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    table->SetCurrentStep(0);
+    PutRange(table.get(), 0, 2048, 0);
+    table->SetCurrentStep(8);
+    CheckRange(table.get(), 0, 1024, 0);
+    table->SetCurrentStep(10);
+    ASSERT_EQ(table->EvictExpired(), 0);
+    table->SetCurrentStep(11);
+    ASSERT_EQ(table->EvictExpired(), 1024);
+    CheckRange(table.get(), 0, 1024, 0);
+    CheckMissing(table.get(), 1024, 2048);
+    table->SetCurrentStep(30);
+    table->SaveSnapshot("s0");
+  }
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    table->LoadSnapshot("s0");
+    CheckMissing(table.get(), 0, 2048);
+  }
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, ReuseExpiredRows) {
+  const std::string path = CreateTempDirectory();
+  PersistentTableOptions options = GetOptions(path);
+  options.ttl = 10;
+  const std::string value_file = path + "/values/value-000000000000";
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    table->SetCurrentStep(0);
+    PutRange(table.get(), 0, 2048, 0);
+    const size_t size = PosixFile(value_file, O_RDONLY, 0644).Size();
+    table->SetCurrentStep(20);
+    // The rows evicted by s0 are left out of it and reused once it is saved.
+    table->SaveSnapshot("s0");
+    PutRange(table.get(), 4096, 4096 + 1000, 1);
+    PutRange(table.get(), 8192, 8192 + 1048, 2);
+    ASSERT_EQ(PosixFile(value_file, O_RDONLY, 0644).Size(), size);
+    // No row is left free, the batch is appended.
+    PutRange(table.get(), 16384, 16384 + 100, 3);
+    ASSERT_GT(PosixFile(value_file, O_RDONLY, 0644).Size(), size);
+    CheckMissing(table.get(), 0, 2048);
+    CheckRange(table.get(), 4096, 4096 + 1000, 1);
+    CheckRange(table.get(), 8192, 8192 + 1048, 2);
+    CheckRange(table.get(), 16384, 16384 + 100, 3);
+    table->SaveSnapshot("s1");
+  }
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    table->SetCurrentStep(20);
+    table->LoadSnapshot("s1");
+    CheckRange(table.get(), 4096, 4096 + 1000, 1);
+    CheckRange(table.get(), 8192, 8192 + 1048, 2);
+    CheckRange(table.get(), 16384, 16384 + 100, 3);
+    // The padding of the last block is free after loading.
+    const size_t size = PosixFile(value_file, O_RDONLY, 0644).Size();
+    PutRange(table.get(), 32768, 32768 + 4, 4);
+    ASSERT_EQ(PosixFile(value_file, O_RDONLY, 0644).Size(), size);
+    CheckRange(table.get(), 32768, 32768 + 4, 4);
+  }
+  PosixFile::RecursiveDelete(path);
+}
+
+TEST(PersistentTable, StripedValuePaths) {
+  const std::string path = CreateTempDirectory();
+  PersistentTableOptions options = GetOptions(path);
+  options.value_paths = {path + "/stripe-0", path + "/stripe-1", path + "/stripe-2"};
+  const uint64_t n_keys = 65536 * 4;
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    PutRange(table.get(), 0, n_keys, 0);
+    table->SaveSnapshot("s0");
+    CheckRange(table.get(), 0, n_keys, 0);
+  }
+  ASSERT_TRUE(PosixFile::FileExists(path + "/stripe-0/value-000000000000"));
+  ASSERT_TRUE(PosixFile::FileExists(path + "/stripe-1/value-000000000001"));
+  ASSERT_TRUE(PosixFile::FileExists(path + "/stripe-0/value-000000000003"));
+  {
+    std::unique_ptr<PersistentTable> table = NewPersistentTable(options);
+    table->LoadSnapshot("s0");
+    CheckRange(table.get(), 0, n_keys, 0);
+  }
+  PosixFile::RecursiveDelete(path);
+}
+
+#endif  // __linux__
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,318 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/quantized_key_value_store.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <cuda_fp16.h>
+#if CUDA_VERSION >= 11000
+#include <cuda_bf16.h>
+#endif  // CUDA_VERSION >= 11000
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr int kWarpSize = 32;
+constexpr float kInt8MaxValue = 127.0F;
+
+template<typename T>
+struct Codec;
+
+template<>
+struct Codec<half> {
+  static constexpr bool kScaled = false;
+  __device__ static half Encode(float value, float inv_scale) { return __float2half(value); }
+  __device__ static float Decode(half value, float scale) { return __half2float(value); }
+};
+
+#if CUDA_VERSION >= 11000
+
+template<>
+struct Codec<nv_bfloat16> {
+  static constexpr bool kScaled = false;
+  __device__ static nv_bfloat16 Encode(float value, float inv_scale) {
+    return __float2bfloat16(value);
+  }
+  __device__ static float Decode(nv_bfloat16 value, float scale) {
+    return __bfloat162float(value);
+  }
+};
+
+#endif  // CUDA_VERSION >= 11000
+
+// Symmetric per row quantization, scale = max(|x|) / 127.
+template<>
+struct Codec<int8_t> {
+  static constexpr bool kScaled = true;
+  __device__ static int8_t Encode(float value, float inv_scale) {
+    const int quantized = __float2int_rn(value * inv_scale);
+    return static_cast<int8_t>(max(-127, min(127, quantized)));
+  }
+  __device__ static float Decode(int8_t value, float scale) {
+    return static_cast<float>(value) * scale;
+  }
+};
+
+struct RowLayout {
+  uint32_t value_length;
+  uint32_t quantized_length;
+  uint32_t quantized_offset;
+  uint32_t float_offset;
+  uint32_t stored_size;
+};
+
+// One warp per row, the scale of a row needs a reduction over its quantized part.
+template<typename T>
+__global__ void QuantizeKernel(uint32_t num_rows, RowLayout layout, const float* values,
+                               unsigned char* stored_values) {
+  const uint32_t lane = threadIdx.x % kWarpSize;
+  const uint32_t global_warp_id = (blockIdx.x * blockDim.x + threadIdx.x) / kWarpSize;
+  const uint32_t num_warps = gridDim.x * blockDim.x / kWarpSize;
+  for (uint32_t row = global_warp_id; row < num_rows; row += num_warps) {
+    const float* src = values + static_cast<size_t>(row) * layout.value_length;
+    unsigned char* dst = stored_values + static_cast<size_t>(row) * layout.stored_size;
+    float inv_scale = 1;
+    if (Codec<T>::kScaled) {
+      float abs_max = 0;
+      for (uint32_t col = lane; col < layout.quantized_length; col += kWarpSize) {
+        abs_max = fmaxf(abs_max, fabsf(src[col]));
+      }
+      for (int offset = kWarpSize / 2; offset > 0; offset /= 2) {
+        abs_max = fmaxf(abs_max, __shfl_xor_sync(0xFFFFFFFF, abs_max, offset));
+      }
+      const float scale = abs_max / kInt8MaxValue;
+      inv_scale = abs_max > 0 ? kInt8MaxValue / abs_max : 0;
+      if (lane == 0) { *reinterpret_cast<float*>(dst) = scale; }
+    }
+    T* quantized = reinterpret_cast<T*>(dst + layout.quantized_offset);
+    for (uint32_t col = lane; col < layout.quantized_length; col += kWarpSize) {
+      quantized[col] = Codec<T>::Encode(src[col], inv_scale);
+    }
+    float* floats = reinterpret_cast<float*>(dst + layout.float_offset);
+    for (uint32_t col = layout.quantized_length + lane; col < layout.value_length;
+         col += kWarpSize) {
+      floats[col - layout.quantized_length] = src[col];
+    }
+  }
+}
+
+__global__ void MarkMissingKernel(uint32_t num_keys, const uint32_t* n_missing,
+                                  const uint32_t* missing_indices, bool* missing) {
+  const uint32_t num_missing = *n_missing;
+  CUDA_1D_KERNEL_LOOP(i, num_keys) {
+    if (i < num_missing) { missing[missing_indices[i]] = true; }
+  }
+}
+
+// Rows missing in the store are left untouched, as every other store does.
+template<typename T>
+__global__ void DequantizeKernel(uint32_t num_rows, RowLayout layout,
+                                 const unsigned char* stored_values, const bool* missing,
+                                 float* values) {
+  const uint32_t lane = threadIdx.x % kWarpSize;
+  const uint32_t global_warp_id = (blockIdx.x * blockDim.x + threadIdx.x) / kWarpSize;
+  const uint32_t num_warps = gridDim.x * blockDim.x / kWarpSize;
+  for (uint32_t row = global_warp_id; row < num_rows; row += num_warps) {
+    if (missing != nullptr && missing[row]) { continue; }
+    const unsigned char* src = stored_values + static_cast<size_t>(row) * layout.stored_size;
+    float* dst = values + static_cast<size_t>(row) * layout.value_length;
+    const float scale = Codec<T>::kScaled ? *reinterpret_cast<const float*>(src) : 1;
+    const T* quantized = reinterpret_cast<const T*>(src + layout.quantized_offset);
+    for (uint32_t col = lane; col < layout.quantized_length; col += kWarpSize) {
+      dst[col] = Codec<T>::Decode(quantized[col], scale);
+    }
+    const float* floats = reinterpret_cast<const float*>(src + layout.float_offset);
+    for (uint32_t col = layout.quantized_length + lane; col < layout.value_length;
+         col += kWarpSize) {
+      dst[col] = floats[col - layout.quantized_length];
+    }
+  }
+}
+
+template<typename T>
+class QuantizedKeyValueStoreImpl : public KeyValueStore {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(QuantizedKeyValueStoreImpl);
+  QuantizedKeyValueStoreImpl(std::unique_ptr<KeyValueStore>&& store,
+                             const QuantizedKeyValueStoreOptions& options)
+      : store_(std::move(store)), device_index_(-1), max_query_length_(0) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    CHECK_GT(options.value_length, 0);
+    CHECK_LE(options.quantized_length, options.value_length);
+    layout_.value_length = options.value_length;
+    layout_.quantized_length = options.quantized_length;
+    layout_.quantized_offset = Codec<T>::kScaled ? sizeof(float) : 0;
+    layout_.float_offset =
+        layout_.quantized_offset + RoundUp(options.quantized_length * sizeof(T), sizeof(float));
+    layout_.stored_size = QuantizedValueSize(options);
+    CHECK_EQ(layout_.stored_size,
+             layout_.float_offset
+                 + (options.value_length - options.quantized_length) * sizeof(float));
+    CHECK_EQ(store_->ValueSize(), layout_.stored_size);
+  }
+  ~QuantizedKeyValueStoreImpl() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+  }
+
+  uint32_t KeySize() const override { return store_->KeySize(); }
+
+  uint32_t ValueSize() const override { return layout_.value_length * sizeof(float); }
+
+  uint32_t MaxQueryLength() const override { return max_query_length_; }
+
+  void ReserveQueryLength(uint32_t query_length) override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    if (query_length <= max_query_length_) { return; }
+    store_->ReserveQueryLength(query_length);
+    if (max_query_length_ != 0) { FreeQueryBuffers(); }
+    OF_CUDA_CHECK(cudaMalloc(&stored_values_buffer_, query_length * layout_.stored_size));
+    OF_CUDA_CHECK(cudaMalloc(&missing_buffer_, query_length * sizeof(bool)));
+    max_query_length_ = query_length;
+  }
+
+  void Get(ep::Stream* stream, uint32_t num_keys, const void* keys, void* values,
+           uint32_t* n_missing, uint32_t* missing_indices) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_LE(num_keys, max_query_length_);
+    store_->Get(stream, num_keys, keys, stored_values_buffer_, n_missing, missing_indices);
+    if (num_keys == 0) { return; }
+    OF_CUDA_CHECK(cudaMemsetAsync(missing_buffer_, 0, num_keys * sizeof(bool),
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+    RUN_CUDA_KERNEL(MarkMissingKernel, stream, num_keys, num_keys, n_missing, missing_indices,
+                    missing_buffer_);
+    RUN_CUDA_KERNEL((DequantizeKernel<T>), stream, num_keys * kWarpSize, num_keys, layout_,
+                    stored_values_buffer_, missing_buffer_, static_cast<float*>(values));
+  }
+
+  void Put(ep::Stream* stream, uint32_t num_keys, const void* keys, const void* values) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_LE(num_keys, max_query_length_);
+    if (num_keys == 0) { return; }
+    RUN_CUDA_KERNEL((QuantizeKernel<T>), stream, num_keys * kWarpSize, num_keys, layout_,
+                    static_cast<const float*>(values), stored_values_buffer_);
+    store_->Put(stream, num_keys, keys, stored_values_buffer_);
+  }
+
+  void Prefetch(ep::Stream* stream, uint32_t num_keys, const void* keys) override {
+    store_->Prefetch(stream, num_keys, keys);
+  }
+
+  bool SnapshotExists(const std::string& name) override { return store_->SnapshotExists(name); }
+
+  void LoadSnapshot(const std::string& name) override { LoadSnapshot(name, nullptr); }
+
+  void LoadSnapshot(const std::string& name,
+                    const std::function<void(KVIterator* iter)>& Hook) override;
+
+  void SaveSnapshot(const std::string& name) override { store_->SaveSnapshot(name); }
+
+  void GetStatistics(KeyValueStoreStatistics* statistics) const override {
+    store_->GetStatistics(statistics);
+  }
+
+  void ResetStatistics() override { store_->ResetStatistics(); }
+
+  void SetCurrentStep(uint64_t step) override { store_->SetCurrentStep(step); }
+
+  uint64_t EvictExpired() override { return store_->EvictExpired(); }
+
+ private:
+  class IteratorImpl : public KVIterator {
+   public:
+    OF_DISALLOW_COPY_AND_MOVE(IteratorImpl);
+    IteratorImpl(KVIterator* base_iter, const RowLayout& layout, uint32_t max_query_length,
+                 unsigned char* stored_values_buffer)
+        : base_iter_(base_iter),
+          layout_(layout),
+          max_query_length_(max_query_length),
+          stored_values_buffer_(stored_values_buffer) {}
+    ~IteratorImpl() override = default;
+
+    void NextN(ep::Stream* stream, uint32_t n_request, uint32_t* n_result, void* keys,
+               void* values) override {
+      CHECK_LE(n_request, max_query_length_);
+      base_iter_->NextN(stream, n_request, n_result, keys, stored_values_buffer_);
+      if (n_request == 0) { return; }
+      // Rows beyond *n_result are decoded from stale data and ignored by the caller.
+      RUN_CUDA_KERNEL((DequantizeKernel<T>), stream, n_request * kWarpSize, n_request, layout_,
+                      stored_values_buffer_, nullptr, static_cast<float*>(values));
+    }
+    void Reset() override { base_iter_->Reset(); }
+
+   private:
+    KVIterator* base_iter_;
+    RowLayout layout_;
+    uint32_t max_query_length_;
+    unsigned char* stored_values_buffer_;
+  };
+
+  void FreeQueryBuffers() {
+    OF_CUDA_CHECK(cudaFree(stored_values_buffer_));
+    OF_CUDA_CHECK(cudaFree(missing_buffer_));
+  }
+
+  std::unique_ptr<KeyValueStore> store_;
+  int device_index_;
+  uint32_t max_query_length_;
+  RowLayout layout_{};
+  unsigned char* stored_values_buffer_{};
+  bool* missing_buffer_{};
+  std::mutex mutex_;
+};
+
+template<typename T>
+void QuantizedKeyValueStoreImpl<T>::LoadSnapshot(
+    const std::string& name, const std::function<void(KVIterator* iter)>& Hook) {
+  CudaCurrentDeviceGuard guard(device_index_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (Hook) {
+    CHECK_GT(max_query_length_, 0);
+    store_->LoadSnapshot(name, [&](KVIterator* base_iter) {
+      IteratorImpl iterator(base_iter, layout_, max_query_length_, stored_values_buffer_);
+      Hook(&iterator);
+    });
+  } else {
+    store_->LoadSnapshot(name);
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<KeyValueStore> NewQuantizedKeyValueStore(
+    std::unique_ptr<KeyValueStore>&& store, const QuantizedKeyValueStoreOptions& options) {
+  if (options.storage_type == DataType::kFloat16) {
+    return std::unique_ptr<KeyValueStore>(
+        new QuantizedKeyValueStoreImpl<half>(std::move(store), options));
+#if CUDA_VERSION >= 11000
+  } else if (options.storage_type == DataType::kBFloat16) {
+    return std::unique_ptr<KeyValueStore>(
+        new QuantizedKeyValueStoreImpl<nv_bfloat16>(std::move(store), options));
+#endif  // CUDA_VERSION >= 11000
+  } else if (options.storage_type == DataType::kInt8) {
+    return std::unique_ptr<KeyValueStore>(
+        new QuantizedKeyValueStoreImpl<int8_t>(std::move(store), options));
+  } else {
+    UNIMPLEMENTED() << "unsupported storage type " << DataType_Name(options.storage_type);
+    return nullptr;
+  }
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,58 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_QUANTIZED_KEY_VALUE_STORE_H_
+#define ONEFLOW_CORE_EMBEDDING_QUANTIZED_KEY_VALUE_STORE_H_
+
+#include "oneflow/core/embedding/key_value_store.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+// Users of the store see rows of value_length floats, the first quantized_length elements of each
+// row are stored as storage_type and the rest, e.g. the optimizer states, stay in float. An int8
+// row is stored with a float scale of its own.
+struct QuantizedKeyValueStoreOptions {
+  DataType storage_type = DataType::kFloat16;
+  uint32_t value_length = 0;
+  uint32_t quantized_length = 0;
+};
+
+// The size of the rows held by the underlying store, [scale][quantized][float], the quantized part
+// is padded to 4 bytes to keep the floats aligned.
+inline uint32_t QuantizedValueSize(const QuantizedKeyValueStoreOptions& options) {
+  const size_t scale_size = options.storage_type == DataType::kInt8 ? sizeof(float) : 0;
+  const size_t quantized_size =
+      RoundUp(options.quantized_length * GetSizeOfDataType(options.storage_type), sizeof(float));
+  return scale_size + quantized_size
+         + (options.value_length - options.quantized_length) * sizeof(float);
+}
+
+#ifdef WITH_CUDA
+
+// Quantizes the rows on Put and dequantizes them on Get, the underlying store and all of its cache
+// tiers hold QuantizedValueSize(options) bytes per row.
+std::unique_ptr<KeyValueStore> NewQuantizedKeyValueStore(
+    std::unique_ptr<KeyValueStore>&& store, const QuantizedKeyValueStoreOptions& options);
+
+#endif  // WITH_CUDA
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_QUANTIZED_KEY_VALUE_STORE_H_
@@ -0,0 +1,224 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/quantized_key_value_store.h"
+#include "oneflow/core/embedding/cached_key_value_store.h"
+#include "oneflow/core/embedding/persistent_table_key_value_store.h"
+#include "oneflow/core/device/cuda_util.h"
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+#ifdef WITH_CUDA
+
+bool HasCudaDevice() {
+  int device_count = 0;
+  if (cudaGetDeviceCount(&device_count) != cudaSuccess) { return false; }
+  if (device_count <= 0) { return false; }
+  return true;
+}
+
+// Value files are opened with O_DIRECT, which tmpfs does not support, so stay off /tmp.
+std::string CreateTempDirectory() {
+  char tmpl[] = "quantized_key_value_store_test_XXXXXX";
+  CHECK(mkdtemp(tmpl) != nullptr);
+  return tmpl;
+}
+
+constexpr uint32_t kValueLength = 24;
+constexpr uint32_t kQuantizedLength = 16;
+
+float GetValue(int64_t key, uint32_t col) {
+  if (col < kQuantizedLength) {
+    return std::sin(static_cast<float>(key * kValueLength + col)) * (1 + key % 5);
+  } else {
+    return static_cast<float>(key * kValueLength + col);
+  }
+}
+
+// The largest error decoding a quantized element of the row of key may have.
+float GetMaxError(DataType storage_type, int64_t key, float value) {
+  if (storage_type == DataType::kFloat16) {
+    return std::abs(value) / 2048 + 1e-7F;
+  } else if (storage_type == DataType::kBFloat16) {
+    return std::abs(value) / 256 + 1e-7F;
+  } else {
+    float abs_max = 0;
+    for (uint32_t col = 0; col < kQuantizedLength; ++col) {
+      abs_max = std::max(abs_max, std::abs(GetValue(key, col)));
+    }
+    return abs_max / 127 / 2 * 1.01F;
+  }
+}
+
+void CheckRow(DataType storage_type, int64_t key, const float* row) {
+  for (uint32_t col = 0; col < kQuantizedLength; ++col) {
+    const float value = GetValue(key, col);
+    ASSERT_LE(std::abs(row[col] - value), GetMaxError(storage_type, key, value))
+        << "key " << key << " col " << col;
+  }
+  // The columns past the quantized part are kept in float.
+  for (uint32_t col = kQuantizedLength; col < kValueLength; ++col) {
+    ASSERT_EQ(row[col], GetValue(key, col)) << "key " << key << " col " << col;
+  }
+}
+
+void TestQuantizedKeyValueStore(DataType storage_type) {
+  Global<ep::DeviceManagerRegistry>::New();
+  {
+    auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA, 0);
+    ep::Stream* stream = device->CreateStream();
+    QuantizedKeyValueStoreOptions options;
+    options.storage_type = storage_type;
+    options.value_length = kValueLength;
+    options.quantized_length = kQuantizedLength;
+    const uint32_t stored_size = QuantizedValueSize(options);
+    PersistentTableKeyValueStoreOptions table_options{};
+    table_options.table_options.path = CreateTempDirectory();
+    table_options.table_options.key_size = sizeof(int64_t);
+    table_options.table_options.value_size = stored_size;
+    table_options.table_options.physical_block_size = 512;
+    CacheOptions cache_options{};
+    cache_options.policy = CacheOptions::Policy::kFull;
+    cache_options.capacity = 65536;
+    cache_options.key_size = sizeof(int64_t);
+    cache_options.value_size = stored_size;
+    cache_options.value_memory_kind = CacheOptions::MemoryKind::kDevice;
+    std::unique_ptr<KeyValueStore> store = NewQuantizedKeyValueStore(
+        NewCachedKeyValueStore(NewPersistentTableKeyValueStore(table_options),
+                               NewCache(cache_options)),
+        options);
+    ASSERT_EQ(store->ValueSize(), kValueLength * sizeof(float));
+
+    // The first half of the keys is put, the second half is only looked up.
+    const uint32_t num_keys = 1024;
+    const uint32_t num_put_keys = num_keys / 2;
+    const float kUntouched = -1024;
+    store->ReserveQueryLength(num_keys);
+    std::vector<int64_t> keys(num_keys);
+    std::vector<float> values(num_keys * kValueLength, kUntouched);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+      keys.at(i) = i * 3 + 1;
+      if (i < num_put_keys) {
+        for (uint32_t j = 0; j < kValueLength; ++j) {
+          values.at(i * kValueLength + j) = GetValue(keys.at(i), j);
+        }
+      }
+    }
+    const size_t values_size = values.size() * sizeof(float);
+    int64_t* d_keys;
+    float* d_values;
+    uint32_t* d_n_missing;
+    uint32_t* d_missing_indices;
+    OF_CUDA_CHECK(cudaMalloc(&d_keys, num_keys * sizeof(int64_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_values, values_size));
+    OF_CUDA_CHECK(cudaMalloc(&d_n_missing, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMalloc(&d_missing_indices, num_keys * sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMemcpy(d_keys, keys.data(), num_keys * sizeof(int64_t), cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(d_values, values.data(), values_size, cudaMemcpyDefault));
+    store->Put(stream, num_put_keys, d_keys, d_values);
+    CHECK_JUST(stream->Sync());
+
+    // get
+    OF_CUDA_CHECK(cudaMemcpy(d_values, values.data(), values_size, cudaMemcpyDefault));
+    store->Get(stream, num_keys, d_keys, d_values, d_n_missing, d_missing_indices);
+    CHECK_JUST(stream->Sync());
+    uint32_t n_missing = 0;
+    std::vector<uint32_t> missing_indices(num_keys);
+    std::vector<float> got(values.size());
+    OF_CUDA_CHECK(cudaMemcpy(&n_missing, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(missing_indices.data(), d_missing_indices,
+                             num_keys * sizeof(uint32_t), cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(got.data(), d_values, values_size, cudaMemcpyDefault));
+    ASSERT_EQ(n_missing, num_keys - num_put_keys);
+    std::set<uint32_t> missing_set(missing_indices.begin(), missing_indices.begin() + n_missing);
+    ASSERT_EQ(missing_set.size(), n_missing);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+      if (i < num_put_keys) {
+        ASSERT_EQ(missing_set.count(i), 0);
+        CheckRow(storage_type, keys.at(i), got.data() + i * kValueLength);
+      } else {
+        // Missing rows are left as they were.
+        ASSERT_EQ(missing_set.count(i), 1);
+        for (uint32_t j = 0; j < kValueLength; ++j) {
+          ASSERT_EQ(got.at(i * kValueLength + j), kUntouched);
+        }
+      }
+    }
+
+    // snapshot
+    store->SaveSnapshot("quantized");
+    std::set<int64_t> iterated_keys;
+    store->LoadSnapshot("quantized", [&](KVIterator* iter) {
+      while (true) {
+        iter->NextN(stream, num_keys, d_n_missing, d_keys, d_values);
+        CHECK_JUST(stream->Sync());
+        uint32_t n_result = 0;
+        OF_CUDA_CHECK(cudaMemcpy(&n_result, d_n_missing, sizeof(uint32_t), cudaMemcpyDefault));
+        if (n_result == 0) { break; }
+        std::vector<int64_t> result_keys(n_result);
+        OF_CUDA_CHECK(cudaMemcpy(result_keys.data(), d_keys, n_result * sizeof(int64_t),
+                                 cudaMemcpyDefault));
+        OF_CUDA_CHECK(cudaMemcpy(got.data(), d_values, n_result * kValueLength * sizeof(float),
+                                 cudaMemcpyDefault));
+        for (uint32_t i = 0; i < n_result; ++i) {
+          ASSERT_TRUE(iterated_keys.emplace(result_keys.at(i)).second);
+          CheckRow(storage_type, result_keys.at(i), got.data() + i * kValueLength);
+        }
+      }
+    });
+    ASSERT_EQ(iterated_keys, std::set<int64_t>(keys.begin(), keys.begin() + num_put_keys));
+
+    OF_CUDA_CHECK(cudaFree(d_keys));
+    OF_CUDA_CHECK(cudaFree(d_values));
+    OF_CUDA_CHECK(cudaFree(d_n_missing));
+    OF_CUDA_CHECK(cudaFree(d_missing_indices));
+    store.reset();
+    device->DestroyStream(stream);
+  }
+  Global<ep::DeviceManagerRegistry>::Delete();
+}
+
+TEST(QuantizedKeyValueStore, Float16) {
+  if (!HasCudaDevice()) { return; }
+  TestQuantizedKeyValueStore(DataType::kFloat16);
+}
+
+#if CUDA_VERSION >= 11000
+
+TEST(QuantizedKeyValueStore, BFloat16) {
+  if (!HasCudaDevice()) { return; }
+  TestQuantizedKeyValueStore(DataType::kBFloat16);
+}
+
+#endif  // CUDA_VERSION >= 11000
+
+TEST(QuantizedKeyValueStore, Int8) {
+  if (!HasCudaDevice()) { return; }
+  TestQuantizedKeyValueStore(DataType::kInt8);
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/sharding_planner.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+int64_t TableBytes(const TableStats& table) { return table.num_rows * table.row_bytes; }
+
+// Bytes a rank sends and receives per step to shuffle the ids and rows of the lookups, forward
+// and backward, when the table lives on other ranks.
+double ShuffleBytesPerRank(const TableStats& table, int64_t parallel_num) {
+  const double remote_fraction = static_cast<double>(parallel_num - 1) / parallel_num;
+  return 2 * table.lookups_per_step / parallel_num * table.row_bytes * remote_fraction;
+}
+
+// Bytes a rank sends and receives per step in a ring all-reduce of the table gradient.
+double AllReduceBytesPerRank(const TableStats& table, int64_t parallel_num) {
+  return 2 * static_cast<double>(TableBytes(table)) * (parallel_num - 1) / parallel_num;
+}
+
+}  // namespace
+
+Maybe<std::vector<TableShardingPlan>> PlanEmbeddingSharding(const std::vector<TableStats>& tables,
+                                                            const ShardingPlannerOptions& options) {
+  const int64_t parallel_num = options.parallel_num;
+  CHECK_GT_OR_RETURN(parallel_num, 0);
+  std::vector<TableShardingPlan> plans(tables.size());
+  std::vector<int64_t> free_bytes(parallel_num, options.memory_budget_per_rank);
+  std::vector<double> lookup_load(parallel_num, 0);
+  std::vector<size_t> table_wise_candidates;
+  for (size_t i = 0; i < tables.size(); ++i) {
+    const TableStats& table = tables.at(i);
+    CHECK_GE_OR_RETURN(table.num_rows, 0) << table.name;
+    CHECK_GT_OR_RETURN(table.row_bytes, 0) << table.name;
+    plans.at(i).name = table.name;
+    const int64_t table_bytes = TableBytes(table);
+    if (parallel_num == 1 || table_bytes > options.max_replicated_table_bytes
+        || AllReduceBytesPerRank(table, parallel_num) >= ShuffleBytesPerRank(table, parallel_num)
+        || table_bytes > free_bytes.front()) {
+      table_wise_candidates.push_back(i);
+      continue;
+    }
+    plans.at(i).placement = TablePlacement::kReplicated;
+    for (auto& bytes : free_bytes) { bytes -= table_bytes; }
+  }
+  std::sort(table_wise_candidates.begin(), table_wise_candidates.end(), [&](size_t a, size_t b) {
+    return tables.at(a).lookups_per_step > tables.at(b).lookups_per_step;
+  });
+  std::vector<size_t> row_wise_tables;
+  for (size_t i : table_wise_candidates) {
+    const TableStats& table = tables.at(i);
+    const int64_t table_bytes = TableBytes(table);
+    int64_t parallel_id = -1;
+    if (table_bytes <= options.max_table_wise_table_bytes) {
+      for (int64_t id = 0; id < parallel_num; ++id) {
+        if (free_bytes.at(id) < table_bytes) { continue; }
+        if (parallel_id == -1 || lookup_load.at(id) < lookup_load.at(parallel_id)) {
+          parallel_id = id;
+        }
+      }
+    }
+    if (parallel_id == -1) {
+      row_wise_tables.push_back(i);
+      continue;
+    }
+    plans.at(i).placement = TablePlacement::kTableWise;
+    plans.at(i).parallel_id = parallel_id;
+    free_bytes.at(parallel_id) -= table_bytes;
+    lookup_load.at(parallel_id) += table.lookups_per_step;
+  }
+  for (size_t i : row_wise_tables) {
+    const TableStats& table = tables.at(i);
+    const int64_t shard_bytes = (TableBytes(table) + parallel_num - 1) / parallel_num;
+    for (auto& bytes : free_bytes) {
+      CHECK_GE_OR_RETURN(bytes, shard_bytes)
+          << "embedding table " << table.name << " does not fit in the memory budget";
+      bytes -= shard_bytes;
+    }
+    plans.at(i).placement = TablePlacement::kRowWise;
+  }
+  return plans;
+}
+
+Maybe<std::vector<int64_t>> GetIdShuffleColumnParallelIds(
+    const std::vector<TableShardingPlan>& plans) {
+  std::vector<int64_t> column_parallel_ids;
+  column_parallel_ids.reserve(plans.size());
+  for (const auto& plan : plans) {
+    CHECK_OR_RETURN(plan.placement != TablePlacement::kReplicated)
+        << "id_shuffle can not serve the replicated embedding table " << plan.name;
+    column_parallel_ids.push_back(plan.placement == TablePlacement::kTableWise ? plan.parallel_id
+                                                                               : -1);
+  }
+  return column_parallel_ids;
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_SHARDING_PLANNER_H_
+#define ONEFLOW_CORE_EMBEDDING_SHARDING_PLANNER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+enum class TablePlacement {
+  // every rank holds the whole table, lookups stay local and gradients are all-reduced
+  kReplicated,
+  // one rank holds the whole table, lookups of the other ranks are shuffled to it
+  kTableWise,
+  // rows are partitioned by key hash over all ranks, the id shuffle layout of today
+  kRowWise,
+};
+
+struct TableStats {
+  std::string name;
+  int64_t num_rows = 0;
+  // bytes of one row including the optimizer states stored next to it
+  int64_t row_bytes = 0;
+  // keys looked up in the table per step, summed over all ranks
+  double lookups_per_step = 0;
+};
+
+struct ShardingPlannerOptions {
+  int64_t parallel_num = 1;
+  // device memory each rank may give to embedding tables
+  int64_t memory_budget_per_rank = 0;
+  // tables larger than this are never replicated, whatever their traffic
+  int64_t max_replicated_table_bytes = 0;
+  // tables larger than this are never placed on a single rank
+  int64_t max_table_wise_table_bytes = 0;
+};
+
+struct TableShardingPlan {
+  std::string name;
+  TablePlacement placement = TablePlacement::kRowWise;
+  // the rank holding a kTableWise table, -1 otherwise
+  int64_t parallel_id = -1;
+};
+
+// Plans the placement of every table. A table is replicated when all-reducing it moves fewer
+// bytes than shuffling its lookups, i.e. when each rank looks up more keys per step than the table
+// has rows. The remaining tables that fit on one rank are placed table-wise, hottest first on the
+// rank with the least lookup load, so small tables stop paying an exchange with every rank. The
+// rest are sharded row-wise. Fails if the tables do not fit in the memory budget.
+Maybe<std::vector<TableShardingPlan>> PlanEmbeddingSharding(const std::vector<TableStats>& tables,
+                                                            const ShardingPlannerOptions& options);
+
+// The column_parallel_ids attr of id_shuffle for the plans, where table i is looked up with column
+// id i: the rank holding each table-wise table, -1 for row-wise tables. id_shuffle has no
+// replicated layout, as that needs the gradients of the table all-reduced, so plans with
+// replicated tables are an error and should be made with max_replicated_table_bytes set to 0.
+Maybe<std::vector<int64_t>> GetIdShuffleColumnParallelIds(
+    const std::vector<TableShardingPlan>& plans);
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_SHARDING_PLANNER_H_
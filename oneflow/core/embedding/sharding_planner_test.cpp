@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/embedding/sharding_planner.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace embedding {
+
+namespace {
+
+constexpr int64_t kMiB = 1024 * 1024;
+
+ShardingPlannerOptions GetOptions(int64_t parallel_num) {
+  ShardingPlannerOptions options;
+  options.parallel_num = parallel_num;
+  options.memory_budget_per_rank = 1024 * kMiB;
+  options.max_replicated_table_bytes = 64 * kMiB;
+  options.max_table_wise_table_bytes = 256 * kMiB;
+  return options;
+}
+
+TableStats MakeTable(const std::string& name, int64_t num_rows, double lookups_per_step) {
+  TableStats table;
+  table.name = name;
+  table.num_rows = num_rows;
+  table.row_bytes = 128 * sizeof(float);
+  table.lookups_per_step = lookups_per_step;
+  return table;
+}
+
+}  // namespace
+
+TEST(ShardingPlanner, PlacesTablesBySizeAndTraffic) {
+  const std::vector<TableStats> tables{
+      MakeTable("hot_small", 1000, 65536),     // rows looked up many times per step
+      MakeTable("cold_small", 100000, 1024),   // fits on one rank, little traffic
+      MakeTable("warm_medium", 200000, 8192),  // fits on one rank
+      MakeTable("huge", 4000000, 65536),       // larger than a single rank may hold
+  };
+  const auto plans = CHECK_JUST(PlanEmbeddingSharding(tables, GetOptions(4)));
+  ASSERT_EQ(plans.size(), tables.size());
+  ASSERT_EQ(plans.at(0).placement, TablePlacement::kReplicated);
+  ASSERT_EQ(plans.at(1).placement, TablePlacement::kTableWise);
+  ASSERT_EQ(plans.at(2).placement, TablePlacement::kTableWise);
+  // the hotter table goes first, the other one lands on a less loaded rank
+  ASSERT_NE(plans.at(1).parallel_id, plans.at(2).parallel_id);
+  ASSERT_EQ(plans.at(3).placement, TablePlacement::kRowWise);
+  ASSERT_EQ(plans.at(3).parallel_id, -1);
+}
+
+TEST(ShardingPlanner, SingleRankNeverReplicates) {
+  const std::vector<TableStats> tables{MakeTable("hot_small", 1000, 65536)};
+  const auto plans = CHECK_JUST(PlanEmbeddingSharding(tables, GetOptions(1)));
+  ASSERT_EQ(plans.at(0).placement, TablePlacement::kTableWise);
+  ASSERT_EQ(plans.at(0).parallel_id, 0);
+}
+
+TEST(ShardingPlanner, IdShuffleColumnParallelIds) {
+  const std::vector<TableStats> tables{
+      MakeTable("hot_small", 1000, 65536),
+      MakeTable("cold_small", 100000, 1024),
+      MakeTable("huge", 4000000, 65536),
+  };
+  ShardingPlannerOptions options = GetOptions(4);
+  ASSERT_FALSE(
+      GetIdShuffleColumnParallelIds(CHECK_JUST(PlanEmbeddingSharding(tables, options))).IsOk());
+  options.max_replicated_table_bytes = 0;
+  const auto plans = CHECK_JUST(PlanEmbeddingSharding(tables, options));
+  const auto column_parallel_ids = CHECK_JUST(GetIdShuffleColumnParallelIds(plans));
+  ASSERT_EQ(column_parallel_ids.size(), tables.size());
+  ASSERT_EQ(plans.at(0).placement, TablePlacement::kTableWise);
+  ASSERT_EQ(column_parallel_ids.at(0), plans.at(0).parallel_id);
+  ASSERT_EQ(plans.at(1).placement, TablePlacement::kTableWise);
+  ASSERT_EQ(column_parallel_ids.at(1), plans.at(1).parallel_id);
+  ASSERT_NE(column_parallel_ids.at(0), column_parallel_ids.at(1));
+  ASSERT_EQ(column_parallel_ids.at(2), -1);
+}
+
+TEST(ShardingPlanner, FailsBeyondMemoryBudget) {
+  const std::vector<TableStats> tables{MakeTable("too_large", 100000000, 65536)};
+  ASSERT_FALSE(PlanEmbeddingSharding(tables, GetOptions(2)).IsOk());
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
@@ -0,0 +1,71 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EMBEDDING_SPARSE_UPDATE_CUH_
+#define ONEFLOW_CORE_EMBEDDING_SPARSE_UPDATE_CUH_
+
+#include "oneflow/core/embedding/cache.h"
+
+namespace oneflow {
+
+namespace embedding {
+
+// Applies the gradient of one element of the embedding of a row laid out as described by
+// SparseUpdateOptions, the optimizer states of the element are found embedding_size floats apart.
+template<SparseUpdateOptions::Optimizer optimizer>
+__device__ __forceinline__ void SparseUpdateElem(const SparseUpdateOptions& options, float* model,
+                                                 float model_diff) {
+  const float model_val = *model;
+  const float diff = model_diff * options.scale;
+  const float lr =
+      options.learning_rate_ptr != nullptr ? *options.learning_rate_ptr : options.learning_rate;
+  const uint32_t embedding_size = options.embedding_size;
+  if (optimizer == SparseUpdateOptions::Optimizer::kSGD) {
+    *model = model_val - lr * (diff + options.weight_decay * model_val);
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kMomentum) {
+    float* momentum = model + embedding_size;
+    const float next_momentum = options.beta * *momentum - lr * diff;
+    *momentum = next_momentum;
+    *model = model_val + next_momentum - lr * options.weight_decay * model_val;
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kAdam) {
+    const float bias_correction1 = options.bias_correction1_ptr != nullptr
+                                       ? *options.bias_correction1_ptr
+                                       : options.bias_correction1;
+    const float bias_correction2 = options.bias_correction2_ptr != nullptr
+                                       ? *options.bias_correction2_ptr
+                                       : options.bias_correction2;
+    float* m = model + embedding_size;
+    float* v = m + embedding_size;
+    const float next_m = options.beta1 * *m + (1 - options.beta1) * diff;
+    const float next_v = options.beta2 * *v + (1 - options.beta2) * diff * diff;
+    *m = next_m;
+    *v = next_v;
+    const float denom = sqrtf(next_v) / sqrtf(bias_correction2) + options.epsilon;
+    *model = model_val - lr / bias_correction1 * (next_m / denom)
+             - lr * options.weight_decay * model_val;
+  } else if (optimizer == SparseUpdateOptions::Optimizer::kAdagrad) {
+    float* sum = model + embedding_size;
+    const float next_sum = *sum + diff * diff;
+    *sum = next_sum;
+    *model = model_val - lr * (diff / (sqrtf(next_sum) + options.epsilon))
+             - lr * options.weight_decay * model_val;
+  }
+}
+
+}  // namespace embedding
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EMBEDDING_SPARSE_UPDATE_CUH_
@@ -0,0 +1,108 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/memset.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace {
+
+void TestStreamAndEvent(Device* device) {
+  Stream* stream = device->CreateStream();
+  ASSERT_NE(stream, nullptr);
+  ASSERT_EQ(stream->device_type(), device->device_type());
+  ASSERT_EQ(stream->device(), device);
+  Event* event = device->CreateEvent();
+  ASSERT_NE(event, nullptr);
+  stream->RecordEvent(event);
+  ASSERT_TRUE(event->Sync().IsOk());
+  ASSERT_TRUE(CHECK_JUST(event->QueryDone()));
+  ASSERT_TRUE(stream->Sync().IsOk());
+  device->DestroyEvent(event);
+  device->DestroyStream(stream);
+}
+
+void TestMemory(Device* device) {
+  const size_t size = 1 << 20;
+  const DeviceType device_type = device->device_type();
+  std::unique_ptr<primitive::Memset> memset =
+      primitive::NewPrimitive<primitive::MemsetFactory>(device_type);
+  ASSERT_TRUE(memset);
+  std::unique_ptr<primitive::Memcpy> h2d =
+      primitive::NewPrimitive<primitive::MemcpyFactory>(device_type, primitive::MemcpyKind::kHtoD);
+  ASSERT_TRUE(h2d);
+  std::unique_ptr<primitive::Memcpy> d2h =
+      primitive::NewPrimitive<primitive::MemcpyFactory>(device_type, primitive::MemcpyKind::kDtoH);
+  ASSERT_TRUE(d2h);
+  std::unique_ptr<primitive::Memcpy> d2d =
+      primitive::NewPrimitive<primitive::MemcpyFactory>(device_type, primitive::MemcpyKind::kDtoD);
+  ASSERT_TRUE(d2d);
+
+  AllocationOptions options{};
+  void* src = nullptr;
+  void* dst = nullptr;
+  ASSERT_TRUE(device->Alloc(options, &src, size).IsOk());
+  ASSERT_TRUE(device->Alloc(options, &dst, size).IsOk());
+  ASSERT_TRUE(reinterpret_cast<uintptr_t>(src) % kMaxAlignmentRequirement == 0);
+  ASSERT_TRUE(reinterpret_cast<uintptr_t>(dst) % kMaxAlignmentRequirement == 0);
+
+  std::vector<uint8_t> host_in(size);
+  std::vector<uint8_t> host_out(size, 0);
+  for (size_t i = 0; i < size; ++i) { host_in[i] = static_cast<uint8_t>(i * 7 + 3); }
+  Stream* stream = device->CreateStream();
+  memset->Launch(stream, dst, 0xff, size);
+  h2d->Launch(stream, src, host_in.data(), size);
+  d2d->Launch(stream, dst, src, size / 2);
+  d2h->Launch(stream, host_out.data(), dst, size);
+  ASSERT_TRUE(stream->Sync().IsOk());
+  for (size_t i = 0; i < size / 2; ++i) { ASSERT_EQ(host_out[i], host_in[i]); }
+  for (size_t i = size / 2; i < size; ++i) { ASSERT_EQ(host_out[i], 0xff); }
+  device->DestroyStream(stream);
+  device->Free(options, src);
+  device->Free(options, dst);
+}
+
+}  // namespace
+
+TEST(DeviceConformance, RegisteredBackends) {
+  std::unique_ptr<DeviceManagerRegistry> registry(new DeviceManagerRegistry());
+  const std::vector<DeviceType> device_types = DeviceManagerRegistry::GetRegisteredDeviceTypes();
+  ASSERT_TRUE(DeviceManagerRegistry::IsDeviceTypeRegistered(DeviceType::kCPU));
+  for (DeviceType device_type : device_types) {
+    const std::string name = DeviceManagerRegistry::GetDeviceTypeNameByDeviceType(device_type);
+    ASSERT_FALSE(name.empty());
+    ASSERT_EQ(DeviceManagerRegistry::GetDeviceTypeByDeviceTypeName(name), device_type);
+    DeviceManager* manager = registry->GetDeviceManager(device_type);
+    ASSERT_EQ(manager->registry(), registry.get());
+    const size_t device_count = manager->GetDeviceCount();
+    for (size_t i = 0; i < device_count; ++i) {
+      std::shared_ptr<Device> device = registry->GetDevice(device_type, i);
+      ASSERT_TRUE(device);
+      ASSERT_EQ(device->device_type(), device_type);
+      ASSERT_EQ(device->device_index(), i);
+      TestStreamAndEvent(device.get());
+      TestMemory(device.get());
+    }
+  }
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
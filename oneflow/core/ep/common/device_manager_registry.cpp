@@ -34,7 +34,7 @@ class DeviceManagerRegistry::Impl {
     if (!managers_.at(device_type)) {
       std::lock_guard<std::mutex> factories_lock(factories_mutex_);
       auto& factory = factories_.at(device_type);
-      CHECK(factory);
+      CHECK(factory) << "no ep backend is registered for device type " << device_type;
       managers_.at(device_type) = factory->NewDeviceManager(registry_);
     }
     return managers_.at(device_type).get();
@@ -72,6 +72,20 @@ class DeviceManagerRegistry::Impl {
     }
   }
 
+  static bool IsDeviceTypeRegistered(DeviceType device_type) {
+    std::lock_guard<std::mutex> factories_lock(factories_mutex_);
+    return factories_.size() > device_type && factories_.at(device_type);
+  }
+
+  static std::vector<DeviceType> GetRegisteredDeviceTypes() {
+    std::lock_guard<std::mutex> factories_lock(factories_mutex_);
+    std::vector<DeviceType> device_types;
+    for (const auto& factory : factories_) {
+      if (factory) { device_types.push_back(factory->device_type()); }
+    }
+    return device_types;
+  }
+
   static void RegisterDeviceManagerFactory(std::unique_ptr<DeviceManagerFactory>&& factory) {
     CHECK(factory);
     const DeviceType device_type = factory->device_type();
@@ -127,6 +141,14 @@ std::shared_ptr<Device> DeviceManagerRegistry::GetDevice(DeviceType device_type,
   return Impl::GetDeviceTypeByDeviceTypeName(device_type_name);
 }
 
+/*static*/ bool DeviceManagerRegistry::IsDeviceTypeRegistered(DeviceType device_type) {
+  return Impl::IsDeviceTypeRegistered(device_type);
+}
+
+/*static*/ std::vector<DeviceType> DeviceManagerRegistry::GetRegisteredDeviceTypes() {
+  return Impl::GetRegisteredDeviceTypes();
+}
+
 }  // namespace ep
 
 }  // namespace oneflow
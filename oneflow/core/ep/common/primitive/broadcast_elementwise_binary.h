@@ -48,6 +48,40 @@ inline bool IsDimsEquals(size_t num_src0_dims, const int64_t* src0_dims, size_t
   return true;
 }
 
+struct StridedDims {
+  size_t num_dims;
+  int64_t dims[kMaxNumDims];
+  int64_t src0_strides[kMaxNumDims];
+  int64_t src1_strides[kMaxNumDims];
+  int64_t dst_strides[kMaxNumDims];
+
+  StridedDims(size_t num_dims_arg, const int64_t* dims_arg, const int64_t* src0_strides_arg,
+              const int64_t* src1_strides_arg, const int64_t* dst_strides_arg) {
+    const int64_t* strides[3] = {dst_strides_arg, src0_strides_arg, src1_strides_arg};
+    int64_t* simplified_strides[3] = {dst_strides, src0_strides, src1_strides};
+    SimplifyStridedDims<kMaxNumDims>(num_dims_arg, dims_arg, 3, strides, &num_dims, dims,
+                                     simplified_strides);
+  }
+
+  int64_t elem_cnt() const { return GetElementCount(num_dims, dims); }
+  // Returns true with the dims of the sources if the launch is a broadcast launch on contiguous
+  // tensors, which covers all the tensors sharing a dense layout.
+  bool GetBroadcastDims(int64_t* src0_dims, int64_t* src1_dims) const {
+    int64_t dst_dims[kMaxNumDims];
+    if (!IsContiguousOrBroadcast(num_dims, dims, dst_strides, dst_dims)
+        || !IsDimsEquals(num_dims, dims, num_dims, dst_dims)
+        || !IsContiguousOrBroadcast(num_dims, dims, src0_strides, src0_dims)
+        || !IsContiguousOrBroadcast(num_dims, dims, src1_strides, src1_dims)) {
+      return false;
+    }
+    // The broadcast launch infers the destination dims from the sources.
+    for (size_t i = 0; i < num_dims; ++i) {
+      if (std::max(src0_dims[i], src1_dims[i]) != dims[i]) { return false; }
+    }
+    return true;
+  }
+};
+
 #define BINARY_MATH_OP_SEQ             \
   OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd) \
   OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kSub) \
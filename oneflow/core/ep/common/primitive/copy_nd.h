@@ -97,6 +97,12 @@ constexpr size_t kMaxNumDims = 8;
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params);
 
+// Copies the simplified copy with the device's plain memory copy routines when its shape allows
+// it, e.g. one contiguous range or evenly pitched rows, and returns false otherwise.
+bool TryLaunchMemcpy(Stream* stream, size_t movement_size, size_t num_dims, void* dst,
+                     const int64_t* dst_dims, const int64_t* dst_pos, const void* src,
+                     const int64_t* src_dims, const int64_t* src_pos, const int64_t* extent);
+
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, void* dst, const int64_t* dst_dims, const int64_t* dst_pos,
                   const void* src, const int64_t* src_dims, const int64_t* src_pos,
@@ -218,6 +224,14 @@ void SimplifyThenLaunch(Stream* stream, DataType data_type, size_t num_dims, voi
                                    &simplified_num_dims, simplified_dst_dims, simplified_dst_pos,
                                    simplified_src_dims, simplified_src_pos, simplified_extent,
                                    GetSizeOfDataType(data_type), dst, src, &movement_size);
+  for (size_t i = 0; i < simplified_num_dims; ++i) {
+    if (simplified_extent[i] == 0) { return; }
+  }
+  if (TryLaunchMemcpy(stream, movement_size, simplified_num_dims, dst, simplified_dst_dims,
+                      simplified_dst_pos, src, simplified_src_dims, simplified_src_pos,
+                      simplified_extent)) {
+    return;
+  }
   LaunchWithSimplified(stream, movement_size, simplified_num_dims, dst, simplified_dst_dims,
                        simplified_dst_pos, src, simplified_src_dims, simplified_src_pos,
                        simplified_extent);
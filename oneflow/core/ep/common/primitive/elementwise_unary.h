@@ -17,13 +17,16 @@ limitations under the License.
 #define ONEFLOW_CORE_EP_COMMON_PRIMITIVE_ELEMENTWISE_UNARY_H_
 
 #include "oneflow/core/ep/include/primitive/elementwise_unary.h"
+#include "oneflow/core/ep/common/primitive/util.h"
 
 namespace oneflow {
 
 namespace ep {
 namespace primitive {
 
-#define UNARY_MATH_OP_SEQ OF_PP_MAKE_TUPLE_SEQ(UnaryOp::kRelu)
+#define UNARY_MATH_OP_SEQ                  \
+  OF_PP_MAKE_TUPLE_SEQ(UnaryOp::kIdentity) \
+  OF_PP_MAKE_TUPLE_SEQ(UnaryOp::kRelu)
 
 #define UNARY_FLOATING_MATH_OP_SEQ     \
   OF_PP_MAKE_TUPLE_SEQ(UnaryOp::kGelu) \
@@ -31,6 +34,38 @@ namespace primitive {
 
 #define UNARY_LOGICAL_OP_SEQ OF_PP_MAKE_TUPLE_SEQ(UnaryOp::kLogicalNot)
 
+namespace elementwise_unary {
+
+constexpr size_t kMaxNumDims = 8;
+
+struct StridedDims {
+  size_t num_dims;
+  int64_t dims[kMaxNumDims];
+  int64_t src_strides[kMaxNumDims];
+  int64_t dst_strides[kMaxNumDims];
+
+  StridedDims(size_t num_dims_arg, const int64_t* dims_arg, const int64_t* src_strides_arg,
+              const int64_t* dst_strides_arg) {
+    const int64_t* strides[2] = {dst_strides_arg, src_strides_arg};
+    int64_t* simplified_strides[2] = {dst_strides, src_strides};
+    SimplifyStridedDims<kMaxNumDims>(num_dims_arg, dims_arg, 2, strides, &num_dims, dims,
+                                     simplified_strides);
+  }
+
+  int64_t elem_cnt() const { return GetElementCount(num_dims, dims); }
+  bool IsContiguous() const {
+    return num_dims == 1 && src_strides[0] == 1 && dst_strides[0] == 1;
+  }
+  // The innermost dim of the destination is the outermost but one dim of the source, i.e. the
+  // source is a batch of transposed matrices.
+  bool IsTransposed() const {
+    return (num_dims == 2 || num_dims == 3) && dst_strides[num_dims - 1] == 1
+           && src_strides[num_dims - 2] == 1;
+  }
+};
+
+}  // namespace elementwise_unary
+
 }  // namespace primitive
 }  // namespace ep
 }  // namespace oneflow
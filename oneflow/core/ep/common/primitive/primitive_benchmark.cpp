@@ -0,0 +1,411 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/broadcast_elementwise_binary.h"
+#include "oneflow/core/ep/include/primitive/cast.h"
+#include "oneflow/core/ep/include/primitive/elementwise_unary.h"
+#include "oneflow/core/ep/include/primitive/fill.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/permute.h"
+#include "oneflow/core/ep/include/primitive/softmax.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#ifdef WITH_CUDA
+#include <cuda_runtime.h>
+#endif  // WITH_CUDA
+#include "oneflow/core/common/data_type.h"
+#include "nlohmann/json.hpp"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+// Times ep primitives over a sweep of shapes and data types on each available device, and
+// reports the time per launch, the achieved memory bandwidth and its ratio to the peak bandwidth
+// of the device. Configured through the environment:
+//   ONEFLOW_PRIMITIVE_BENCHMARK_OUTPUT: file the records are written to, stdout by default.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_FORMAT: "json" (default) or "csv".
+//   ONEFLOW_PRIMITIVE_BENCHMARK_DEVICES: comma separated device types, "cpu,cuda" by default.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_FILTER: only primitives whose name contains it are run.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_WARMUP: untimed launches per case, 5 by default.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_ITERS: timed launches per case, 20 by default.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_CPU_THREADS: threads of the cpu device, all cores by default.
+//   ONEFLOW_PRIMITIVE_BENCHMARK_CPU_PEAK_GBPS: peak memory bandwidth of the host, the percentage
+//     of peak is not reported for the cpu without it.
+
+namespace oneflow {
+
+namespace ep {
+
+namespace primitive {
+
+namespace {
+
+// Device buffers of one case, filled with ones so that no primitive runs into NaNs or denormals.
+class Buffers final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Buffers);
+  explicit Buffers(Device* device) : device_(device) {}
+  ~Buffers() {
+    for (void* ptr : ptrs_) { device_->Free(AllocationOptions(), ptr); }
+  }
+
+  void* New(Stream* stream, DataType data_type, size_t count) {
+    void* ptr = nullptr;
+    CHECK_JUST(device_->Alloc(AllocationOptions(), &ptr,
+                              std::max<size_t>(count * GetSizeOfDataType(data_type), 1)));
+    ptrs_.push_back(ptr);
+    std::unique_ptr<Fill> fill = NewPrimitive<FillFactory>(device_->device_type(), data_type);
+    if (fill) { fill->Launch(stream, ptr, 1, count); }
+    return ptr;
+  }
+
+ private:
+  Device* device_;
+  std::vector<void*> ptrs_;
+};
+
+struct BenchmarkCase {
+  std::string primitive;
+  DataType data_type;
+  std::string shape;
+  // Bytes read and written by one launch, and floating point operations for the blas cases.
+  double bytes;
+  double flops;
+  std::function<void(Stream*)> launch;
+};
+
+std::string ShapeString(const std::vector<int64_t>& dims) {
+  std::ostringstream ss;
+  for (size_t i = 0; i < dims.size(); ++i) { ss << (i == 0 ? "" : "x") << dims.at(i); }
+  return ss.str();
+}
+
+int64_t ElemCnt(const std::vector<int64_t>& dims) {
+  return std::accumulate(dims.cbegin(), dims.cend(), static_cast<int64_t>(1),
+                         std::multiplies<int64_t>());
+}
+
+// Each method allocates the buffers of one case and runs it right away, so that only the buffers
+// of a single case are alive at a time. Primitives the device does not implement are skipped.
+class CaseBuilder final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CaseBuilder);
+  CaseBuilder(Device* device, Stream* stream, std::function<void(const BenchmarkCase&)> run)
+      : device_(device),
+        device_type_(device->device_type()),
+        stream_(stream),
+        run_(std::move(run)),
+        buffers_(new Buffers(device)) {}
+
+  void Fill(DataType data_type, int64_t count) {
+    std::shared_ptr<primitive::Fill> fill = NewPrimitive<FillFactory>(device_type_, data_type);
+    if (!fill) { return; }
+    void* dst = buffers_->New(stream_, data_type, count);
+    const double size = GetSizeOfDataType(data_type);
+    Add({"fill", data_type, ShapeString({count}), count * size, 0,
+         [=](Stream* stream) { fill->Launch(stream, dst, 0, count); }});
+  }
+
+  void Memcpy(int64_t bytes) {
+    std::shared_ptr<primitive::Memcpy> memcpy =
+        NewPrimitive<MemcpyFactory>(device_type_, MemcpyKind::kDtoD);
+    if (!memcpy) { return; }
+    const void* src = buffers_->New(stream_, DataType::kChar, bytes);
+    void* dst = buffers_->New(stream_, DataType::kChar, bytes);
+    Add({"memcpy", DataType::kChar, ShapeString({bytes}), 2.0 * bytes, 0,
+         [=](Stream* stream) { memcpy->Launch(stream, dst, src, bytes); }});
+  }
+
+  void ElementwiseUnary(UnaryOp op, const std::string& name, DataType data_type, int64_t count) {
+    std::shared_ptr<primitive::ElementwiseUnary> unary =
+        NewPrimitive<ElementwiseUnaryFactory>(device_type_, op, data_type, data_type);
+    if (!unary) { return; }
+    const void* src = buffers_->New(stream_, data_type, count);
+    void* dst = buffers_->New(stream_, data_type, count);
+    const double size = GetSizeOfDataType(data_type);
+    Add({"elementwise_unary_" + name, data_type, ShapeString({count}), 2 * count * size, 0,
+         [=](Stream* stream) { unary->Launch(stream, src, dst, count); }});
+  }
+
+  void Cast(DataType from, DataType to, int64_t count) {
+    std::shared_ptr<primitive::Cast> cast = NewPrimitive<CastFactory>(device_type_, from, to);
+    if (!cast) { return; }
+    const void* src = buffers_->New(stream_, from, count);
+    void* dst = buffers_->New(stream_, to, count);
+    const double bytes =
+        count * static_cast<double>(GetSizeOfDataType(from) + GetSizeOfDataType(to));
+    Add({"cast_to_" + DataType_Name(to), from, ShapeString({count}), bytes, 0,
+         [=](Stream* stream) { cast->Launch(stream, src, dst, count); }});
+  }
+
+  void BroadcastElementwiseBinary(BinaryOp op, const std::string& name, DataType data_type,
+                                  const std::vector<int64_t>& src0_dims,
+                                  const std::vector<int64_t>& src1_dims) {
+    CHECK_EQ(src0_dims.size(), src1_dims.size());
+    std::shared_ptr<primitive::BroadcastElementwiseBinary> binary =
+        NewPrimitive<BroadcastElementwiseBinaryFactory>(device_type_, op, data_type, data_type,
+                                                        src0_dims.size());
+    if (!binary) { return; }
+    std::vector<int64_t> dst_dims(src0_dims.size());
+    for (size_t i = 0; i < dst_dims.size(); ++i) {
+      dst_dims.at(i) = std::max(src0_dims.at(i), src1_dims.at(i));
+    }
+    const void* src0 = buffers_->New(stream_, data_type, ElemCnt(src0_dims));
+    const void* src1 = buffers_->New(stream_, data_type, ElemCnt(src1_dims));
+    void* dst = buffers_->New(stream_, data_type, ElemCnt(dst_dims));
+    const double bytes = static_cast<double>(ElemCnt(src0_dims) + ElemCnt(src1_dims)
+                                             + ElemCnt(dst_dims))
+                         * GetSizeOfDataType(data_type);
+    Add({"broadcast_elementwise_binary_" + name, data_type,
+         ShapeString(src0_dims) + "|" + ShapeString(src1_dims), bytes, 0,
+         [=](Stream* stream) {
+           binary->Launch(stream, src0_dims.size(), src0_dims.data(), src0, src1_dims.size(),
+                          src1_dims.data(), src1, dst);
+         }});
+  }
+
+  void Permute(DataType data_type, const std::vector<int64_t>& dims,
+               const std::vector<int>& permutation) {
+    CHECK_EQ(dims.size(), permutation.size());
+    std::shared_ptr<primitive::Permute> permute =
+        NewPrimitive<PermuteFactory>(device_type_, dims.size());
+    if (!permute) { return; }
+    const int64_t count = ElemCnt(dims);
+    const void* src = buffers_->New(stream_, data_type, count);
+    void* dst = buffers_->New(stream_, data_type, count);
+    std::ostringstream perm;
+    for (size_t i = 0; i < permutation.size(); ++i) {
+      perm << (i == 0 ? "" : "-") << permutation.at(i);
+    }
+    Add({"permute", data_type, ShapeString(dims) + ":" + perm.str(),
+         2.0 * count * GetSizeOfDataType(data_type), 0, [=](Stream* stream) {
+           permute->Launch(stream, data_type, dims.size(), dims.data(), src, permutation.data(),
+                           dst);
+         }});
+  }
+
+  void Softmax(DataType data_type, int64_t rows, int64_t cols) {
+    std::shared_ptr<primitive::Softmax> softmax =
+        NewPrimitive<SoftmaxFactory>(device_type_, data_type);
+    if (!softmax) { return; }
+    const void* x = buffers_->New(stream_, data_type, rows * cols);
+    void* y = buffers_->New(stream_, data_type, rows * cols);
+    Add({"softmax", data_type, ShapeString({rows, cols}),
+         2.0 * rows * cols * GetSizeOfDataType(data_type), 0,
+         [=](Stream* stream) { softmax->Launch(stream, rows, cols, x, y); }});
+  }
+
+  void Matmul(DataType data_type, int64_t m, int64_t n, int64_t k) {
+    std::shared_ptr<primitive::Matmul> matmul = NewPrimitive<MatmulFactory>(
+        device_type_, data_type, BlasTransposeType::N, BlasTransposeType::N);
+    if (!matmul) { return; }
+    const void* a = buffers_->New(stream_, data_type, m * k);
+    const void* b = buffers_->New(stream_, data_type, k * n);
+    void* c = buffers_->New(stream_, data_type, m * n);
+    const double bytes = static_cast<double>(m * k + k * n + m * n) * GetSizeOfDataType(data_type);
+    Add({"matmul", data_type, ShapeString({m, n, k}), bytes, 2.0 * m * n * k,
+         [=](Stream* stream) { matmul->Launch(stream, m, n, k, 1.0, a, b, 0.0, c); }});
+  }
+
+
+ private:
+  void Add(const BenchmarkCase& benchmark_case) {
+    run_(benchmark_case);
+    CHECK_JUST(stream_->Sync());
+    buffers_.reset(new Buffers(device_));
+  }
+
+  Device* device_;
+  DeviceType device_type_;
+  Stream* stream_;
+  std::function<void(const BenchmarkCase&)> run_;
+  std::unique_ptr<Buffers> buffers_;
+};
+
+void BuildCases(CaseBuilder* builder) {
+  const std::vector<DataType> data_types{DataType::kFloat, DataType::kFloat16};
+  const std::vector<int64_t> counts{1 << 16, 1 << 20, 1 << 24};
+  for (const int64_t count : counts) { builder->Memcpy(count * 4); }
+  for (const DataType data_type : data_types) {
+    for (const int64_t count : counts) {
+      builder->Fill(data_type, count);
+      builder->ElementwiseUnary(UnaryOp::kRelu, "relu", data_type, count);
+      builder->ElementwiseUnary(UnaryOp::kGelu, "gelu", data_type, count);
+    }
+    // Bias add, same shape add, and the outer broadcast of an attention mask.
+    builder->BroadcastElementwiseBinary(BinaryOp::kAdd, "add", data_type, {8192, 1024},
+                                        {1, 1024});
+    builder->BroadcastElementwiseBinary(BinaryOp::kAdd, "add", data_type, {8192, 1024},
+                                        {8192, 1024});
+    builder->BroadcastElementwiseBinary(BinaryOp::kMul, "mul", data_type, {32, 16, 128, 128},
+                                        {32, 1, 1, 128});
+    // Transposes of the last two axes and of the heads of an attention layer.
+    builder->Permute(data_type, {64, 512, 512}, {0, 2, 1});
+    builder->Permute(data_type, {32, 128, 16, 64}, {0, 2, 1, 3});
+    builder->Permute(data_type, {32, 16, 128, 64}, {0, 1, 3, 2});
+    for (const int64_t cols : {128, 1024, 8192}) {
+      builder->Softmax(data_type, (1 << 23) / cols, cols);
+    }
+    for (const int64_t size : {512, 2048}) { builder->Matmul(data_type, size, size, size); }
+  }
+  for (const int64_t count : counts) {
+    builder->Cast(DataType::kFloat, DataType::kFloat16, count);
+    builder->Cast(DataType::kFloat16, DataType::kFloat, count);
+  }
+}
+
+// Peak memory bandwidth of the device in GB/s, 0 if unknown.
+double GetPeakGigabytesPerSecond(Device* device) {
+#ifdef WITH_CUDA
+  if (device->device_type() == DeviceType::kCUDA) {
+    int memory_clock_khz = 0;
+    int bus_width_bits = 0;
+    OF_CUDA_CHECK(cudaDeviceGetAttribute(&memory_clock_khz, cudaDevAttrMemoryClockRate,
+                                         device->device_index()));
+    OF_CUDA_CHECK(cudaDeviceGetAttribute(&bus_width_bits, cudaDevAttrGlobalMemoryBusWidth,
+                                         device->device_index()));
+    // Double data rate.
+    return 2.0 * memory_clock_khz * 1e3 * (bus_width_bits / 8) / 1e9;
+  }
+#endif  // WITH_CUDA
+  if (device->device_type() == DeviceType::kCPU) {
+    return ParseIntegerFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_CPU_PEAK_GBPS", 0);
+  }
+  return 0;
+}
+
+nlohmann::json RunCase(const std::string& device_name, double peak_gigabytes_per_second,
+                       Stream* stream, const BenchmarkCase& benchmark_case) {
+  const int64_t warmup = ParseIntegerFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_WARMUP", 5);
+  const int64_t iters = ParseIntegerFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_ITERS", 20);
+  CHECK_GT(iters, 0);
+  for (int64_t i = 0; i < warmup; ++i) { benchmark_case.launch(stream); }
+  CHECK_JUST(stream->Sync());
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < iters; ++i) { benchmark_case.launch(stream); }
+  CHECK_JUST(stream->Sync());
+  const auto end = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(end - start).count() / iters;
+  const double gigabytes_per_second = benchmark_case.bytes / seconds / 1e9;
+  nlohmann::json record;
+  record["device"] = device_name;
+  record["primitive"] = benchmark_case.primitive;
+  record["data_type"] = DataType_Name(benchmark_case.data_type);
+  record["shape"] = benchmark_case.shape;
+  record["iterations"] = iters;
+  record["time_us"] = seconds * 1e6;
+  record["gigabytes_per_second"] = gigabytes_per_second;
+  record["gflops"] = benchmark_case.flops / seconds / 1e9;
+  record["percent_of_peak_bandwidth"] =
+      peak_gigabytes_per_second > 0
+          ? nlohmann::json(gigabytes_per_second / peak_gigabytes_per_second * 100)
+          : nlohmann::json();
+  return record;
+}
+
+std::string ToCsv(const std::vector<nlohmann::json>& records) {
+  const std::vector<std::string> columns{
+      "device",  "primitive",           "data_type", "shape", "iterations",
+      "time_us", "gigabytes_per_second", "gflops",   "percent_of_peak_bandwidth"};
+  std::ostringstream ss;
+  for (size_t i = 0; i < columns.size(); ++i) { ss << (i == 0 ? "" : ",") << columns.at(i); }
+  ss << "\n";
+  for (const auto& record : records) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+      const nlohmann::json& value = record.at(columns.at(i));
+      ss << (i == 0 ? "" : ",");
+      if (value.is_string()) {
+        ss << value.get<std::string>();
+      } else if (!value.is_null()) {
+        ss << value.dump();
+      }
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+int Main() {
+  std::unique_ptr<DeviceManagerRegistry> device_manager_registry(new DeviceManagerRegistry());
+  const std::string device_names =
+      GetStringFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_DEVICES", "cpu,cuda");
+  const std::string filter = GetStringFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_FILTER", "");
+  std::vector<nlohmann::json> records;
+  std::istringstream device_names_stream(device_names);
+  std::string device_name;
+  while (std::getline(device_names_stream, device_name, ',')) {
+    const DeviceType device_type =
+        DeviceManagerRegistry::GetDeviceTypeByDeviceTypeName(device_name);
+    if (device_type == DeviceType::kInvalidDevice) {
+      LOG(WARNING) << "unknown device " << device_name;
+      continue;
+    }
+    DeviceManager* device_manager = device_manager_registry->GetDeviceManager(device_type);
+    if (device_manager == nullptr || device_manager->GetDeviceCount() == 0) {
+      LOG(WARNING) << "no " << device_name << " device";
+      continue;
+    }
+    std::shared_ptr<Device> device = device_manager->GetDevice(0);
+    if (device_type == DeviceType::kCPU) {
+      const int64_t num_threads = ParseIntegerFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_CPU_THREADS",
+                                                      std::thread::hardware_concurrency());
+      static_cast<CpuDevice*>(device.get())->SetNumThreads(std::max<int64_t>(num_threads, 1));
+    }
+    device->SetAsActiveDevice();
+    Stream* stream = device->CreateStream();
+    const double peak_gigabytes_per_second = GetPeakGigabytesPerSecond(device.get());
+    {
+      CaseBuilder builder(device.get(), stream, [&](const BenchmarkCase& benchmark_case) {
+        if (benchmark_case.primitive.find(filter) == std::string::npos) { return; }
+        records.push_back(
+            RunCase(device_name, peak_gigabytes_per_second, stream, benchmark_case));
+      });
+      BuildCases(&builder);
+    }
+    device->DestroyStream(stream);
+  }
+
+  const std::string format = GetStringFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_FORMAT", "json");
+  const std::string output = GetStringFromEnv("ONEFLOW_PRIMITIVE_BENCHMARK_OUTPUT", "");
+  std::string result;
+  if (format == "csv") {
+    result = ToCsv(records);
+  } else {
+    CHECK_EQ(format, "json") << "unsupported format " << format;
+    result = nlohmann::json(records).dump(2) + "\n";
+  }
+  if (output.empty()) {
+    std::cout << result;
+  } else {
+    std::ofstream ofs(output);
+    ofs << result;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace primitive
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+int main() { return oneflow::ep::primitive::Main(); }
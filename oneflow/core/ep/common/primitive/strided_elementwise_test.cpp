@@ -0,0 +1,216 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/broadcast_elementwise_binary.h"
+#include "oneflow/core/ep/include/primitive/elementwise_unary.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/permute.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+constexpr size_t kMaxNumDims = 8;
+
+// The strided launches are checked against the same op launched on a contiguous copy made by the
+// permute primitive.
+class StridedElementwiseTester {
+ public:
+  explicit StridedElementwiseTester(Device* device)
+      : device_(device), device_type_(device->device_type()), stream_(device->CreateStream()) {
+    h2d_ = NewPrimitive<MemcpyFactory>(device_type_, MemcpyKind::kHtoD);
+    d2h_ = NewPrimitive<MemcpyFactory>(device_type_, MemcpyKind::kDtoH);
+    permute_ = NewPrimitive<PermuteFactory>(device_type_, kMaxNumDims);
+    CHECK(h2d_);
+    CHECK(d2h_);
+    CHECK(permute_);
+  }
+  ~StridedElementwiseTester() {
+    CHECK_JUST(stream_->Sync());
+    for (void* ptr : buffers_) { device_->Free(AllocationOptions{}, ptr); }
+    device_->DestroyStream(stream_);
+  }
+
+  // Applies relu to the view of a contiguous `src_dims` tensor permuted by `permutation`.
+  void TestUnary(size_t num_dims, const int64_t* src_dims, const int* permutation) {
+    std::unique_ptr<ElementwiseUnary> relu = NewPrimitive<ElementwiseUnaryFactory>(
+        device_type_, UnaryOp::kRelu, DataType::kFloat, DataType::kFloat);
+    ASSERT_TRUE(relu);
+    int64_t dims[kMaxNumDims];
+    int64_t src_strides[kMaxNumDims];
+    int64_t dst_strides[kMaxNumDims];
+    const int64_t elem_cnt = GetPermutedView(num_dims, src_dims, permutation, dims, src_strides);
+    GetContiguousStrides(num_dims, dims, dst_strides);
+    void* src = NewInput(elem_cnt);
+    void* dst = NewBuffer(elem_cnt);
+    void* contiguous_src = NewBuffer(elem_cnt);
+    void* expected_dst = NewBuffer(elem_cnt);
+
+    relu->Launch(stream_, num_dims, dims, src_strides, src, dst_strides, dst);
+    permute_->Launch(stream_, DataType::kFloat, num_dims, src_dims, src, permutation,
+                     contiguous_src);
+    relu->Launch(stream_, contiguous_src, expected_dst, elem_cnt);
+    CheckEqual(dst, expected_dst, elem_cnt);
+  }
+
+  // Adds a second source broadcast along the dims where `broadcast` is set to the view of a
+  // contiguous `src0_dims` tensor permuted by `permutation`.
+  void TestBinary(size_t num_dims, const int64_t* src0_dims, const int* permutation,
+                  const bool* broadcast) {
+    std::unique_ptr<BroadcastElementwiseBinary> add =
+        NewPrimitive<BroadcastElementwiseBinaryFactory>(device_type_, BinaryOp::kAdd,
+                                                        DataType::kFloat, DataType::kFloat,
+                                                        kMaxNumDims);
+    ASSERT_TRUE(add);
+    int64_t dims[kMaxNumDims];
+    int64_t src0_strides[kMaxNumDims];
+    int64_t src1_dims[kMaxNumDims];
+    int64_t src1_strides[kMaxNumDims];
+    int64_t dst_strides[kMaxNumDims];
+    const int64_t elem_cnt = GetPermutedView(num_dims, src0_dims, permutation, dims, src0_strides);
+    for (size_t i = 0; i < num_dims; ++i) { src1_dims[i] = broadcast[i] ? 1 : dims[i]; }
+    const int64_t src1_elem_cnt = GetContiguousStrides(num_dims, src1_dims, src1_strides);
+    for (size_t i = 0; i < num_dims; ++i) {
+      if (broadcast[i]) { src1_strides[i] = 0; }
+    }
+    GetContiguousStrides(num_dims, dims, dst_strides);
+    void* src0 = NewInput(elem_cnt);
+    void* src1 = NewInput(src1_elem_cnt);
+    void* dst = NewBuffer(elem_cnt);
+    void* contiguous_src0 = NewBuffer(elem_cnt);
+    void* expected_dst = NewBuffer(elem_cnt);
+
+    add->Launch(stream_, num_dims, dims, src0_strides, src0, src1_strides, src1, dst_strides, dst);
+    permute_->Launch(stream_, DataType::kFloat, num_dims, src0_dims, src0, permutation,
+                     contiguous_src0);
+    add->Launch(stream_, num_dims, dims, contiguous_src0, num_dims, src1_dims, src1,
+                expected_dst);
+    CheckEqual(dst, expected_dst, elem_cnt);
+  }
+
+ private:
+  static int64_t GetContiguousStrides(size_t num_dims, const int64_t* dims, int64_t* strides) {
+    int64_t stride = 1;
+    for (int64_t i = static_cast<int64_t>(num_dims) - 1; i >= 0; --i) {
+      strides[i] = stride;
+      stride *= dims[i];
+    }
+    return stride;
+  }
+
+  static int64_t GetPermutedView(size_t num_dims, const int64_t* src_dims, const int* permutation,
+                                 int64_t* dims, int64_t* strides) {
+    int64_t src_strides[kMaxNumDims];
+    const int64_t elem_cnt = GetContiguousStrides(num_dims, src_dims, src_strides);
+    for (size_t i = 0; i < num_dims; ++i) {
+      dims[i] = src_dims[permutation[i]];
+      strides[i] = src_strides[permutation[i]];
+    }
+    return elem_cnt;
+  }
+
+  void* NewBuffer(int64_t elem_cnt) {
+    void* ptr = nullptr;
+    CHECK_JUST(device_->Alloc(AllocationOptions{}, &ptr, elem_cnt * sizeof(float)));
+    buffers_.push_back(ptr);
+    return ptr;
+  }
+
+  void* NewInput(int64_t elem_cnt) {
+    std::vector<float> host(elem_cnt);
+    for (int64_t i = 0; i < elem_cnt; ++i) { host[i] = static_cast<float>((i * 37) % 101 - 50); }
+    void* ptr = NewBuffer(elem_cnt);
+    h2d_->Launch(stream_, ptr, host.data(), elem_cnt * sizeof(float));
+    CHECK_JUST(stream_->Sync());
+    return ptr;
+  }
+
+  void CheckEqual(const void* dst, const void* expected_dst, int64_t elem_cnt) {
+    std::vector<float> host_dst(elem_cnt);
+    std::vector<float> host_expected_dst(elem_cnt);
+    d2h_->Launch(stream_, host_dst.data(), dst, elem_cnt * sizeof(float));
+    d2h_->Launch(stream_, host_expected_dst.data(), expected_dst, elem_cnt * sizeof(float));
+    CHECK_JUST(stream_->Sync());
+    for (int64_t i = 0; i < elem_cnt; ++i) { ASSERT_EQ(host_dst[i], host_expected_dst[i]) << i; }
+  }
+
+  Device* device_;
+  DeviceType device_type_;
+  Stream* stream_;
+  std::unique_ptr<Memcpy> h2d_;
+  std::unique_ptr<Memcpy> d2h_;
+  std::unique_ptr<Permute> permute_;
+  std::vector<void*> buffers_;
+};
+
+template<typename Fn>
+void ForEachDevice(const Fn& fn) {
+  std::unique_ptr<DeviceManagerRegistry> registry(new DeviceManagerRegistry());
+  for (DeviceType device_type : DeviceManagerRegistry::GetRegisteredDeviceTypes()) {
+    if (registry->GetDeviceManager(device_type)->GetDeviceCount() == 0) { continue; }
+    std::shared_ptr<Device> device = registry->GetDevice(device_type, 0);
+    StridedElementwiseTester tester(device.get());
+    fn(&tester);
+  }
+}
+
+TEST(StridedElementwise, Unary) {
+  ForEachDevice([](StridedElementwiseTester* tester) {
+    // A transposed matrix and a batch of them, which take the tiled kernel on CUDA.
+    const int64_t dims_1[]{37, 45};
+    const int permutation_1[]{1, 0};
+    tester->TestUnary(2, dims_1, permutation_1);
+    const int64_t dims_2[]{3, 37, 45};
+    const int permutation_2[]{0, 2, 1};
+    tester->TestUnary(3, dims_2, permutation_2);
+    // A general permutation, which takes the strided loop.
+    const int64_t dims_3[]{2, 3, 4, 5};
+    const int permutation_3[]{3, 1, 0, 2};
+    tester->TestUnary(4, dims_3, permutation_3);
+    // An identity permutation, which collapses to the contiguous launch.
+    const int64_t dims_4[]{2, 1, 7};
+    const int permutation_4[]{0, 1, 2};
+    tester->TestUnary(3, dims_4, permutation_4);
+  });
+}
+
+TEST(StridedElementwise, Binary) {
+  ForEachDevice([](StridedElementwiseTester* tester) {
+    const int64_t dims_1[]{4, 33, 17};
+    const int permutation_1[]{0, 2, 1};
+    const bool broadcast_1[]{true, true, false};
+    tester->TestBinary(3, dims_1, permutation_1, broadcast_1);
+    const int64_t dims_2[]{2, 3, 4, 5};
+    const int permutation_2[]{3, 1, 0, 2};
+    const bool broadcast_2[]{false, true, false, true};
+    tester->TestBinary(4, dims_2, permutation_2, broadcast_2);
+    const int64_t dims_3[]{6, 5};
+    const int permutation_3[]{0, 1};
+    const bool broadcast_3[]{false, false};
+    tester->TestBinary(2, dims_3, permutation_3, broadcast_3);
+  });
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
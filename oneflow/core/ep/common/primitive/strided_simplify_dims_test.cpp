@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/common/primitive/util.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+constexpr size_t kMaxNumDims = 8;
+
+void TestSimplifyStridedDims(size_t num_dims, const int64_t* dims, const int64_t* dst_strides,
+                             const int64_t* src_strides, size_t expected_num_dims,
+                             const int64_t* expected_dims, const int64_t* expected_dst_strides,
+                             const int64_t* expected_src_strides) {
+  size_t simplified_num_dims = 0;
+  int64_t simplified_dims[kMaxNumDims]{};
+  int64_t simplified_dst_strides[kMaxNumDims]{};
+  int64_t simplified_src_strides[kMaxNumDims]{};
+  const int64_t* strides[2] = {dst_strides, src_strides};
+  int64_t* simplified_strides[2] = {simplified_dst_strides, simplified_src_strides};
+  SimplifyStridedDims<kMaxNumDims>(num_dims, dims, 2, strides, &simplified_num_dims,
+                                   simplified_dims, simplified_strides);
+  ASSERT_EQ(simplified_num_dims, expected_num_dims);
+  for (size_t i = 0; i < simplified_num_dims; ++i) {
+    ASSERT_EQ(simplified_dims[i], expected_dims[i]);
+    ASSERT_EQ(simplified_dst_strides[i], expected_dst_strides[i]);
+    ASSERT_EQ(simplified_src_strides[i], expected_src_strides[i]);
+  }
+}
+
+TEST(Strided, SimplifyStridedDims) {
+  // Contiguous tensors merge into one dim.
+  const int64_t dims_1[]{2, 3, 4};
+  const int64_t strides_1[]{12, 4, 1};
+  const int64_t simplified_dims_1[]{24};
+  const int64_t simplified_strides_1[]{1};
+  TestSimplifyStridedDims(3, dims_1, strides_1, strides_1, 1, simplified_dims_1,
+                          simplified_strides_1, simplified_strides_1);
+
+  // Tensors sharing a transposed layout merge into one dim too.
+  const int64_t dims_2[]{3, 4};
+  const int64_t strides_2[]{1, 3};
+  const int64_t simplified_dims_2[]{12};
+  TestSimplifyStridedDims(2, dims_2, strides_2, strides_2, 1, simplified_dims_2,
+                          simplified_strides_1, simplified_strides_1);
+
+  // A batch of transposed matrices, the dims of size 1 being dropped.
+  const int64_t dims_3[]{5, 1, 3, 4};
+  const int64_t dst_strides_3[]{12, 12, 4, 1};
+  const int64_t src_strides_3[]{12, 7, 1, 3};
+  const int64_t simplified_dims_3[]{5, 3, 4};
+  const int64_t simplified_dst_strides_3[]{12, 4, 1};
+  const int64_t simplified_src_strides_3[]{12, 1, 3};
+  TestSimplifyStridedDims(4, dims_3, dst_strides_3, src_strides_3, 3, simplified_dims_3,
+                          simplified_dst_strides_3, simplified_src_strides_3);
+
+  // The dims are ordered by the destination strides, broadcast dims are not merged.
+  const int64_t dims_4[]{4, 2, 3};
+  const int64_t dst_strides_4[]{1, 12, 4};
+  const int64_t src_strides_4[]{1, 0, 0};
+  const int64_t simplified_dims_4[]{6, 4};
+  const int64_t simplified_dst_strides_4[]{4, 1};
+  const int64_t simplified_src_strides_4[]{0, 1};
+  TestSimplifyStridedDims(3, dims_4, dst_strides_4, src_strides_4, 2, simplified_dims_4,
+                          simplified_dst_strides_4, simplified_src_strides_4);
+
+  // Empty tensors.
+  const int64_t dims_5[]{2, 0, 3};
+  const int64_t strides_5[]{0, 3, 1};
+  const int64_t simplified_dims_5[]{0};
+  TestSimplifyStridedDims(3, dims_5, strides_5, strides_5, 1, simplified_dims_5,
+                          simplified_strides_1, simplified_strides_1);
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
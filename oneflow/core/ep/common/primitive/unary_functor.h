@@ -27,6 +27,11 @@ namespace primitive {
 template<DeviceType device, UnaryOp unary_op, typename Dst, typename Src>
 struct UnaryFunctor;
 
+template<DeviceType device, typename Dst, typename Src>
+struct UnaryFunctor<device, UnaryOp::kIdentity, Dst, Src> {
+  OF_DEVICE_FUNC Dst operator()(Src src) const { return static_cast<Dst>(src); }
+};
+
 template<DeviceType device, typename Dst, typename Src>
 struct UnaryFunctor<device, UnaryOp::kRelu, Dst, Src> {
   OF_DEVICE_FUNC Dst operator()(Src src) const {
@@ -0,0 +1,172 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/unique.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+// Runs the primitive on a device and checks its outputs on the host. unique_out is only checked
+// as a set, its order is implementation defined.
+class UniqueTester {
+ public:
+  explicit UniqueTester(Device* device)
+      : device_(device), device_type_(device->device_type()), stream_(device->CreateStream()) {
+    h2d_ = NewPrimitive<MemcpyFactory>(device_type_, MemcpyKind::kHtoD);
+    d2h_ = NewPrimitive<MemcpyFactory>(device_type_, MemcpyKind::kDtoH);
+    CHECK(h2d_);
+    CHECK(d2h_);
+  }
+  ~UniqueTester() {
+    CHECK_JUST(stream_->Sync());
+    for (void* ptr : buffers_) { device_->Free(AllocationOptions{}, ptr); }
+    device_->DestroyStream(stream_);
+  }
+
+  template<typename K, typename I>
+  void Test(const std::vector<K>& keys, bool with_inverse_indices, bool with_counts) {
+    std::unique_ptr<Unique> unique =
+        NewPrimitive<UniqueFactory>(device_type_, GetDataType<K>::value, GetDataType<I>::value);
+    ASSERT_TRUE(unique);
+    const size_t n = keys.size();
+    // Buffers of at least one element, so that empty inputs get valid pointers too.
+    const size_t buffer_n = std::max<size_t>(n, 1);
+    void* in = NewBuffer(buffer_n * sizeof(K));
+    void* num_unique = NewBuffer(sizeof(I));
+    void* unique_out = NewBuffer(buffer_n * sizeof(K));
+    void* inverse_indices = with_inverse_indices ? NewBuffer(buffer_n * sizeof(I)) : nullptr;
+    void* counts = with_counts ? NewBuffer(buffer_n * sizeof(I)) : nullptr;
+    const size_t workspace_size = unique->GetWorkspaceSizeInBytes(n, with_counts);
+    void* workspace = NewBuffer(std::max<size_t>(workspace_size, 1));
+    if (n > 0) { h2d_->Launch(stream_, in, keys.data(), n * sizeof(K)); }
+    // A stale count, which an empty input has to overwrite.
+    const I stale_num_unique = static_cast<I>(n + 1);
+    h2d_->Launch(stream_, num_unique, &stale_num_unique, sizeof(I));
+    unique->Launch(stream_, n, in, num_unique, unique_out, inverse_indices, counts, workspace,
+                   workspace_size);
+
+    I host_num_unique = 0;
+    std::vector<K> host_unique_out(buffer_n);
+    std::vector<I> host_inverse_indices(buffer_n);
+    std::vector<I> host_counts(buffer_n);
+    d2h_->Launch(stream_, &host_num_unique, num_unique, sizeof(I));
+    d2h_->Launch(stream_, host_unique_out.data(), unique_out, buffer_n * sizeof(K));
+    if (with_inverse_indices) {
+      d2h_->Launch(stream_, host_inverse_indices.data(), inverse_indices, buffer_n * sizeof(I));
+    }
+    if (with_counts) {
+      d2h_->Launch(stream_, host_counts.data(), counts, buffer_n * sizeof(I));
+    }
+    CHECK_JUST(stream_->Sync());
+
+    std::map<K, int64_t> expected_counts;
+    for (const K& key : keys) { expected_counts[key] += 1; }
+    ASSERT_EQ(static_cast<size_t>(host_num_unique), expected_counts.size());
+    std::map<K, int64_t> key2index;
+    for (int64_t i = 0; i < host_num_unique; ++i) {
+      const K key = host_unique_out.at(i);
+      ASSERT_TRUE(expected_counts.count(key) == 1) << "unexpected key " << key;
+      ASSERT_TRUE(key2index.emplace(key, i).second) << "duplicated key " << key;
+      if (with_counts) { ASSERT_EQ(host_counts.at(i), expected_counts.at(key)) << key; }
+    }
+    if (with_inverse_indices) {
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(host_inverse_indices.at(i), key2index.at(keys.at(i))) << i;
+      }
+    }
+  }
+
+ private:
+  void* NewBuffer(size_t size) {
+    void* ptr = nullptr;
+    CHECK_JUST(device_->Alloc(AllocationOptions{}, &ptr, size));
+    buffers_.push_back(ptr);
+    return ptr;
+  }
+
+  Device* device_;
+  DeviceType device_type_;
+  Stream* stream_;
+  std::unique_ptr<Memcpy> h2d_;
+  std::unique_ptr<Memcpy> d2h_;
+  std::vector<void*> buffers_;
+};
+
+template<typename Fn>
+void ForEachDevice(const Fn& fn) {
+  std::unique_ptr<DeviceManagerRegistry> registry(new DeviceManagerRegistry());
+  for (DeviceType device_type : DeviceManagerRegistry::GetRegisteredDeviceTypes()) {
+    if (registry->GetDeviceManager(device_type)->GetDeviceCount() == 0) { continue; }
+    std::shared_ptr<Device> device = registry->GetDevice(device_type, 0);
+    UniqueTester tester(device.get());
+    fn(&tester);
+  }
+}
+
+template<typename K, typename I>
+void TestAllOutputs(UniqueTester* tester, const std::vector<K>& keys) {
+  tester->Test<K, I>(keys, true, true);
+  tester->Test<K, I>(keys, true, false);
+  tester->Test<K, I>(keys, false, true);
+  tester->Test<K, I>(keys, false, false);
+}
+
+TEST(Unique, Small) {
+  ForEachDevice([](UniqueTester* tester) {
+    const std::vector<int64_t> keys{5, 3, 5, 7, 3, 5, -1};
+    TestAllOutputs<int64_t, int32_t>(tester, keys);
+    TestAllOutputs<int64_t, int64_t>(tester, keys);
+    TestAllOutputs<int32_t, int32_t>(tester, {2, 2, 2, 2});
+    TestAllOutputs<int32_t, int32_t>(tester, {9});
+  });
+}
+
+TEST(Unique, Large) {
+  ForEachDevice([](UniqueTester* tester) {
+    // Far more keys than distinct ones, spread over several blocks of the CUDA kernels.
+    std::vector<int32_t> keys(100000);
+    for (size_t i = 0; i < keys.size(); ++i) { keys[i] = static_cast<int32_t>((i * 7919) % 997); }
+    TestAllOutputs<int32_t, int64_t>(tester, keys);
+    std::vector<int64_t> distinct_keys(4096);
+    for (size_t i = 0; i < distinct_keys.size(); ++i) {
+      distinct_keys[i] = static_cast<int64_t>(distinct_keys.size() - i) << 33;
+    }
+    TestAllOutputs<int64_t, int32_t>(tester, distinct_keys);
+  });
+}
+
+TEST(Unique, Empty) {
+  ForEachDevice([](UniqueTester* tester) {
+    TestAllOutputs<int64_t, int32_t>(tester, {});
+    TestAllOutputs<int32_t, int64_t>(tester, {});
+  });
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
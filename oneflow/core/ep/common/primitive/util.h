@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_EP_COMMON_PRIMITIVE_UTIL_H_
 #define ONEFLOW_CORE_EP_COMMON_PRIMITIVE_UTIL_H_
 
+#include <algorithm>
 #include "oneflow/core/common/util.h"
 
 namespace oneflow {
@@ -121,6 +122,100 @@ inline void SimplifyBroadcastDims(size_t num_src0_dims, const int64_t* src0_dims
   }
 }
 
+// Simplifies the iteration space of an elementwise op on strided tensors, `strides[0]` being the
+// strides of the destination and the others those of the sources. Broadcast sources have stride 0
+// in the broadcast dims. The dims of size 1 are dropped, the others are ordered by the destination
+// strides from the outermost to the innermost, and adjacent dims are merged if they are contiguous
+// to each other in all tensors. So contiguous tensors and tensors sharing a permuted dense layout
+// end up with a single dim of stride 1.
+template<size_t max_num_dims>
+inline void SimplifyStridedDims(size_t num_dims, const int64_t* dims, size_t num_tensors,
+                                const int64_t* const* strides, size_t* simplified_num_dims,
+                                int64_t* simplified_dims, int64_t* const* simplified_strides) {
+  CHECK_LE(num_dims, max_num_dims);
+  if (GetElementCount(num_dims, dims) == 0) {
+    *simplified_num_dims = 1;
+    simplified_dims[0] = 0;
+    for (size_t t = 0; t < num_tensors; ++t) { simplified_strides[t][0] = 1; }
+    return;
+  }
+  size_t order[max_num_dims];
+  size_t num_non_one_dims = 0;
+  for (size_t i = 0; i < num_dims; ++i) {
+    if (dims[i] != 1) { order[num_non_one_dims++] = i; }
+  }
+  std::stable_sort(order, order + num_non_one_dims,
+                   [&](size_t a, size_t b) { return strides[0][a] > strides[0][b]; });
+  *simplified_num_dims = 0;
+  for (size_t k = 0; k < num_non_one_dims; ++k) {
+    const size_t dim = order[k];
+    if (*simplified_num_dims != 0) {
+      const size_t last = *simplified_num_dims - 1;
+      bool mergeable = true;
+      for (size_t t = 0; t < num_tensors; ++t) {
+        if (simplified_strides[t][last] != strides[t][dim] * dims[dim]) { mergeable = false; }
+      }
+      if (mergeable) {
+        simplified_dims[last] *= dims[dim];
+        for (size_t t = 0; t < num_tensors; ++t) { simplified_strides[t][last] = strides[t][dim]; }
+        continue;
+      }
+    }
+    simplified_dims[*simplified_num_dims] = dims[dim];
+    for (size_t t = 0; t < num_tensors; ++t) {
+      simplified_strides[t][*simplified_num_dims] = strides[t][dim];
+    }
+    *simplified_num_dims += 1;
+  }
+  if (*simplified_num_dims == 0) {
+    *simplified_num_dims = 1;
+    simplified_dims[0] = 1;
+    for (size_t t = 0; t < num_tensors; ++t) { simplified_strides[t][0] = 1; }
+  }
+}
+
+// Returns whether `strides` are the contiguous strides of `dims` with the dims of stride 0
+// broadcast, and fills `broadcast_dims` with 1 for those dims and `dims` for the others.
+inline bool IsContiguousOrBroadcast(size_t num_dims, const int64_t* dims, const int64_t* strides,
+                                    int64_t* broadcast_dims) {
+  int64_t contiguous_stride = 1;
+  for (int64_t i = static_cast<int64_t>(num_dims) - 1; i >= 0; --i) {
+    if (strides[i] == 0) {
+      broadcast_dims[i] = 1;
+    } else if (strides[i] == contiguous_stride) {
+      broadcast_dims[i] = dims[i];
+      contiguous_stride *= dims[i];
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Calls `func(offsets)` with the offsets of the elements [begin, end) in each of `num_tensors`
+// strided tensors, the elements being numbered in the row major order of `dims`.
+template<size_t num_tensors, size_t max_num_dims, typename F>
+void ForEachStridedOffsets(size_t num_dims, const int64_t* dims, const int64_t* const* strides,
+                           int64_t begin, int64_t end, const F& func) {
+  int64_t index[max_num_dims];
+  int64_t offsets[num_tensors]{};
+  int64_t remaining = begin;
+  for (int64_t i = static_cast<int64_t>(num_dims) - 1; i >= 0; --i) {
+    index[i] = remaining % dims[i];
+    remaining /= dims[i];
+    for (size_t t = 0; t < num_tensors; ++t) { offsets[t] += index[i] * strides[t][i]; }
+  }
+  for (int64_t n = begin; n < end; ++n) {
+    func(offsets);
+    for (int64_t i = static_cast<int64_t>(num_dims) - 1; i >= 0; --i) {
+      for (size_t t = 0; t < num_tensors; ++t) { offsets[t] += strides[t][i]; }
+      if (++index[i] < dims[i]) { break; }
+      for (size_t t = 0; t < num_tensors; ++t) { offsets[t] -= strides[t][i] * dims[i]; }
+      index[i] = 0;
+    }
+  }
+}
+
 }  // namespace primitive
 }  // namespace ep
 
@@ -24,7 +24,15 @@ namespace ep {
 
 void CpuDevice::SetAsActiveDevice() {}
 
-Stream* CpuDevice::CreateStream() { return new CpuStream(this); }
+std::shared_ptr<CpuThreadPool> CpuDevice::GetThreadPool() {
+  std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+  if (!thread_pool_ || thread_pool_->num_threads() < num_threads_) {
+    thread_pool_ = std::make_shared<CpuThreadPool>(num_threads_);
+  }
+  return thread_pool_;
+}
+
+Stream* CpuDevice::CreateStream(StreamPriority priority) { return new CpuStream(this); }
 
 void CpuDevice::DestroyStream(Stream* stream) { delete stream; }
 
@@ -17,6 +17,8 @@ limitations under the License.
 #define ONEFLOW_CORE_EP_CPU_CPU_DEVICE_H_
 
 #include "oneflow/core/ep/include/device.h"
+#include "oneflow/core/ep/cpu/cpu_isa.h"
+#include "oneflow/core/ep/cpu/cpu_thread_pool.h"
 
 namespace oneflow {
 
@@ -26,18 +28,22 @@ class CpuDevice : public Device {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuDevice);
   explicit CpuDevice(DeviceManager* device_manager)
-      : device_manager_(device_manager), num_threads_(1) {}
+      : device_manager_(device_manager), num_threads_(1), isa_(GetCpuIsa()) {}
   ~CpuDevice() override = default;
 
   void SetAsActiveDevice() override;
   void SetNumThreads(size_t num_threads) { num_threads_ = num_threads; }
   size_t GetNumThreads() { return num_threads_; }
+  // Intra-op pool shared by the streams of this device, rebuilt when the number of threads grows.
+  std::shared_ptr<CpuThreadPool> GetThreadPool();
+  // Instruction set the primitives of this device are dispatched to.
+  CpuIsa isa() const { return isa_; }
 
   DeviceType device_type() const override { return DeviceType::kCPU; }
   size_t device_index() const override { return 0; }
   DeviceManager* device_manager() const override { return device_manager_; }
 
-  Stream* CreateStream() override;
+  Stream* CreateStream(StreamPriority priority = StreamPriority::kNormal) override;
   void DestroyStream(Stream* stream) override;
 
   void CreateEvents(Event** events, size_t count) override;
@@ -51,6 +57,9 @@ class CpuDevice : public Device {
  private:
   DeviceManager* device_manager_;
   size_t num_threads_;
+  CpuIsa isa_;
+  std::mutex thread_pool_mutex_;
+  std::shared_ptr<CpuThreadPool> thread_pool_;
 };
 
 }  // namespace ep
@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/cpu_isa.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace {
+
+CpuIsa DetectCpuIsa() {
+#if OF_CPU_ISA_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+      && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")) {
+    return CpuIsa::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return CpuIsa::kAvx2; }
+  if (__builtin_cpu_supports("sse4.2")) { return CpuIsa::kSse4; }
+#endif  // OF_CPU_ISA_DISPATCH
+  return CpuIsa::kDefault;
+}
+
+CpuIsa MaxCpuIsaFromEnv() {
+  const std::string max_isa = GetStringFromEnv("ONEFLOW_EP_CPU_MAX_ISA", "avx512");
+  if (max_isa == "default") {
+    return CpuIsa::kDefault;
+  } else if (max_isa == "sse4") {
+    return CpuIsa::kSse4;
+  } else if (max_isa == "avx2") {
+    return CpuIsa::kAvx2;
+  } else if (max_isa == "avx512") {
+    return CpuIsa::kAvx512;
+  } else {
+    LOG(WARNING) << "Unknown ONEFLOW_EP_CPU_MAX_ISA " << max_isa << ", ignored";
+    return CpuIsa::kAvx512;
+  }
+}
+
+}  // namespace
+
+CpuIsa GetCpuIsa() {
+  static const CpuIsa isa = std::min(DetectCpuIsa(), MaxCpuIsaFromEnv());
+  return isa;
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
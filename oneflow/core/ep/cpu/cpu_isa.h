@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
+#define ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
+
+#include "oneflow/core/common/util.h"
+
+// Kernels are compiled once per instruction set with OF_CPU_TARGET_* and the variant to run is
+// picked at runtime with GetCpuIsa(), so a single binary uses AVX-512 where available without
+// requiring it at build time.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define OF_CPU_ISA_DISPATCH 1
+#define OF_CPU_TARGET_SSE4 __attribute__((target("sse4.2")))
+#define OF_CPU_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define OF_CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,avx2,fma")))
+#else
+#define OF_CPU_ISA_DISPATCH 0
+#endif
+
+namespace oneflow {
+
+namespace ep {
+
+enum class CpuIsa {
+  kDefault = 0,
+  kSse4 = 1,
+  kAvx2 = 2,
+  kAvx512 = 3,
+};
+
+// The widest instruction set supported by the running cpu, capped by the environment variable
+// ONEFLOW_EP_CPU_MAX_ISA ("default", "sse4", "avx2" or "avx512").
+CpuIsa GetCpuIsa();
+
+#if OF_CPU_ISA_DISPATCH
+
+namespace cpu_isa_internal {
+
+template<typename Functor, typename... Args>
+OF_CPU_TARGET_SSE4 void InvokeSse4(Args&&... args) {
+  Functor::template Invoke<CpuIsa::kSse4>(std::forward<Args>(args)...);
+}
+
+template<typename Functor, typename... Args>
+OF_CPU_TARGET_AVX2 void InvokeAvx2(Args&&... args) {
+  Functor::template Invoke<CpuIsa::kAvx2>(std::forward<Args>(args)...);
+}
+
+template<typename Functor, typename... Args>
+OF_CPU_TARGET_AVX512 void InvokeAvx512(Args&&... args) {
+  Functor::template Invoke<CpuIsa::kAvx512>(std::forward<Args>(args)...);
+}
+
+}  // namespace cpu_isa_internal
+
+#endif  // OF_CPU_ISA_DISPATCH
+
+// Runs Functor::Invoke<isa>(args...) compiled for `isa`. Invoke must be an ALWAYS_INLINE static
+// member template so that its body is generated inside the per instruction set wrapper.
+template<typename Functor, typename... Args>
+void CpuIsaInvoke(CpuIsa isa, Args&&... args) {
+#if OF_CPU_ISA_DISPATCH
+  if (isa == CpuIsa::kAvx512) {
+    cpu_isa_internal::InvokeAvx512<Functor>(std::forward<Args>(args)...);
+    return;
+  } else if (isa == CpuIsa::kAvx2) {
+    cpu_isa_internal::InvokeAvx2<Functor>(std::forward<Args>(args)...);
+    return;
+  } else if (isa == CpuIsa::kSse4) {
+    cpu_isa_internal::InvokeSse4<Functor>(std::forward<Args>(args)...);
+    return;
+  }
+#endif  // OF_CPU_ISA_DISPATCH
+  Functor::template Invoke<CpuIsa::kDefault>(std::forward<Args>(args)...);
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
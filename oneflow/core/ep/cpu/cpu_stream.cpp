@@ -27,6 +27,15 @@ Maybe<void> CpuStream::Sync() { return Maybe<void>::Ok(); }
 
 void CpuStream::RecordEvent(Event* /*event*/) {}
 
+CpuThreadPool* CpuStream::intra_op_thread_pool() {
+  auto* cpu_device = static_cast<CpuDevice*>(device_);
+  if (!intra_op_thread_pool_
+      || intra_op_thread_pool_->num_threads() < cpu_device->GetNumThreads()) {
+    intra_op_thread_pool_ = cpu_device->GetThreadPool();
+  }
+  return intra_op_thread_pool_.get();
+}
+
 }  // namespace ep
 
 }  // namespace oneflow
@@ -22,6 +22,7 @@ limitations under the License.
 #define OF_RUNTIME_SEQ 0u
 #define OF_RUNTIME_OMP 1u
 #define OF_RUNTIME_TBB 2u
+#define OF_RUNTIME_THREAD_POOL 3u
 
 #if OF_CPU_THREADING_RUNTIME == OF_RUNTIME_OMP
 #include <omp.h>
@@ -29,6 +30,8 @@ limitations under the License.
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
 #include <tbb/global_control.h>
+#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_THREAD_POOL
+#include "oneflow/core/ep/cpu/cpu_thread_pool.h"
 #elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ
 // Nothing
 #else
@@ -37,6 +40,8 @@ limitations under the License.
 
 #ifdef WITH_ONEDNN
 #include <oneapi/dnnl/dnnl.hpp>
+#include "oneflow/core/common/env_var.h"
+#include "oneflow/core/ep/cpu/onednn_primitive_cache.h"
 #endif
 
 namespace oneflow {
@@ -57,7 +62,8 @@ class CpuNumThreadsGuard {
   }
   ~CpuNumThreadsGuard() { omp_set_num_threads(saved_num_threads_); }
 
-#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ
+#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ \
+    || OF_CPU_THREADING_RUNTIME == OF_RUNTIME_THREAD_POOL
   explicit CpuNumThreadsGuard(size_t num_threads) {}
   ~CpuNumThreadsGuard() {}
 #else
@@ -70,7 +76,8 @@ class CpuNumThreadsGuard {
 #elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_OMP
   size_t set_num_threads_;
   size_t saved_num_threads_;
-#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ
+#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ \
+    || OF_CPU_THREADING_RUNTIME == OF_RUNTIME_THREAD_POOL
 
 #else
 #error OF_CPU_THREADING_RUNTIME Error setting
@@ -84,6 +91,8 @@ class CpuStream : public Stream {
 #ifdef WITH_ONEDNN
     onednn_engine_.reset(new dnnl::engine(dnnl::engine::kind::cpu, 0));
     onednn_stream_.reset(new dnnl::stream(*onednn_engine_));
+    onednn_primitive_cache_.reset(
+        new OneDnnPrimitiveCache(EnvInteger<ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY>()));
 #endif
   }
 
@@ -101,8 +110,10 @@ class CpuStream : public Stream {
 
   template<typename F>
   void ParallelFor(int64_t begin, int64_t end, const F& func, size_t grain_size) {
-#if OF_CPU_THREADING_RUNTIME != OF_RUNTIME_SEQ
+#if OF_CPU_THREADING_RUNTIME == OF_RUNTIME_OMP || OF_CPU_THREADING_RUNTIME == OF_RUNTIME_TBB
     auto DivUp = [](int64_t x, int64_t y) { return (x + y - 1) / y; };
+#endif
+#if OF_CPU_THREADING_RUNTIME != OF_RUNTIME_SEQ
     size_t num_threads = dynamic_cast<CpuDevice*>(device())->GetNumThreads();
 #endif
     if (begin >= end) { return; }
@@ -132,6 +143,8 @@ class CpuStream : public Stream {
         tbb::blocked_range<int64_t>(begin, end, chunk_size),
         [func](const tbb::blocked_range<int64_t>& r) { func(r.begin(), r.end()); },
         tbb::static_partitioner{});
+#elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_THREAD_POOL
+    intra_op_thread_pool()->ParallelFor(begin, end, func, grain_size, num_threads);
 #elif OF_CPU_THREADING_RUNTIME == OF_RUNTIME_SEQ
     func(begin, end);
 #else
@@ -139,18 +152,26 @@ class CpuStream : public Stream {
 #endif
   }
 
+  // Elements per task below which ParallelFor does not split further.
+  static constexpr size_t kParallelForDefaultGrain = 32768;
+
+  // Pool the loops of ParallelFor run on, shared with the other streams of the device.
+  CpuThreadPool* intra_op_thread_pool();
+
 #ifdef WITH_ONEDNN
   dnnl::engine* onednn_engine() const { return onednn_engine_.get(); }
   dnnl::stream* onednn_stream() const { return onednn_stream_.get(); }
+  OneDnnPrimitiveCache* onednn_primitive_cache() const { return onednn_primitive_cache_.get(); }
 #endif
 
  private:
 #ifdef WITH_ONEDNN
   std::unique_ptr<dnnl::engine> onednn_engine_;
   std::unique_ptr<dnnl::stream> onednn_stream_;
+  std::unique_ptr<OneDnnPrimitiveCache> onednn_primitive_cache_;
 #endif
   Device* device_;
-  static constexpr size_t kParallelForDefaultGrain = 32768;
+  std::shared_ptr<CpuThreadPool> intra_op_thread_pool_;
 };
 
 }  // namespace ep
@@ -0,0 +1,253 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/cpu_thread_pool.h"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace oneflow {
+
+namespace ep {
+
+namespace {
+
+// Set in the workers and in a thread while it runs chunks, nested loops run sequentially.
+thread_local bool in_parallel_region = false;
+
+int64_t DivUp(int64_t x, int64_t y) { return (x + y - 1) / y; }
+
+std::string ReadFirstLine(const std::string& path) {
+  std::ifstream ifs(path);
+  std::string line;
+  if (ifs.is_open()) { std::getline(ifs, line); }
+  return line;
+}
+
+#ifdef __linux__
+
+std::vector<int> GetAllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) { return cpus; }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) { cpus.push_back(cpu); }
+  }
+  return cpus;
+}
+
+// The NUMA node of a cpu is the nodeN entry of its sysfs directory, 0 without NUMA.
+int GetNumaNodeOfCpu(int cpu) {
+  if (cpu < 0) { return 0; }
+  DIR* dir = opendir(("/sys/devices/system/cpu/cpu" + std::to_string(cpu)).c_str());
+  if (dir == nullptr) { return 0; }
+  int node = 0;
+  while (const dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(0, 4, "node") == 0
+        && std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+      node = std::atoi(name.c_str() + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+// Cpu sets of the workers, empty to leave them unbound.
+std::vector<cpu_set_t> GetWorkerAffinity(size_t num_workers) {
+  const std::string mode = GetStringFromEnv("ONEFLOW_CPU_THREAD_POOL_AFFINITY", "none");
+  if (mode == "none" || num_workers == 0) { return {}; }
+  if (mode != "numa" && mode != "core") {
+    LOG(WARNING) << "Unknown ONEFLOW_CPU_THREAD_POOL_AFFINITY " << mode << ", ignored";
+    return {};
+  }
+  const std::vector<int> cpus = GetAllowedCpus();
+  if (cpus.empty()) { return {}; }
+  std::vector<int> nodes(cpus.size());
+  std::transform(cpus.begin(), cpus.end(), nodes.begin(), GetNumaNodeOfCpu);
+  const int home_node = GetNumaNodeOfCpu(sched_getcpu());
+  std::vector<size_t> order(cpus.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return std::make_pair(nodes[lhs] != home_node, nodes[lhs])
+           < std::make_pair(nodes[rhs] != home_node, nodes[rhs]);
+  });
+  std::vector<cpu_set_t> cpu_sets(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) {
+    // The first cpu is left to the issuing thread.
+    const size_t cpu_idx = order.at((i + 1) % order.size());
+    CPU_ZERO(&cpu_sets[i]);
+    if (mode == "core") {
+      CPU_SET(cpus[cpu_idx], &cpu_sets[i]);
+    } else {
+      for (size_t j = 0; j < cpus.size(); ++j) {
+        if (nodes[j] == nodes[cpu_idx]) { CPU_SET(cpus[j], &cpu_sets[i]); }
+      }
+    }
+  }
+  return cpu_sets;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+size_t GetCgroupCpuQuota(const std::string& cgroup_root) {
+  int64_t quota = -1;
+  int64_t period = 0;
+  const std::string cpu_max = ReadFirstLine(cgroup_root + "/cpu.max");
+  if (!cpu_max.empty()) {
+    // cgroup v2, "max 100000" when unlimited
+    std::istringstream iss(cpu_max);
+    std::string quota_str;
+    iss >> quota_str >> period;
+    if (quota_str != "max") { quota = std::atoll(quota_str.c_str()); }
+  } else {
+    // cgroup v1, a quota of -1 when unlimited
+    const std::string quota_str = ReadFirstLine(cgroup_root + "/cpu/cpu.cfs_quota_us");
+    const std::string period_str = ReadFirstLine(cgroup_root + "/cpu/cpu.cfs_period_us");
+    if (!quota_str.empty() && !period_str.empty()) {
+      quota = std::atoll(quota_str.c_str());
+      period = std::atoll(period_str.c_str());
+    }
+  }
+  if (quota <= 0 || period <= 0) { return 0; }
+  return static_cast<size_t>(DivUp(quota, period));
+}
+
+size_t GetNumAvailableCpus() {
+  size_t num_cpus = std::thread::hardware_concurrency();
+#ifdef __linux__
+  const size_t num_allowed_cpus = GetAllowedCpus().size();
+  if (num_allowed_cpus > 0) { num_cpus = num_allowed_cpus; }
+  const size_t cgroup_cpu_quota = GetCgroupCpuQuota("/sys/fs/cgroup");
+  if (cgroup_cpu_quota > 0) { num_cpus = std::min(num_cpus, cgroup_cpu_quota); }
+#endif  // __linux__
+  return std::max<size_t>(num_cpus, 1);
+}
+
+struct CpuThreadPool::Loop {
+  const std::function<void(int64_t, int64_t)>* func = nullptr;
+  int64_t begin = 0;
+  int64_t end = 0;
+  int64_t chunk_size = 0;
+  int64_t num_chunks = 0;
+  std::atomic<int64_t> next_chunk{0};
+  std::atomic<int64_t> num_done_chunks{0};
+
+  // Claims chunks until none is left. A thread joining late claims nothing, so func is not
+  // touched once the issuing thread has seen all the chunks done.
+  void Run() {
+    while (true) {
+      const int64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= num_chunks) { return; }
+      const int64_t chunk_begin = begin + chunk * chunk_size;
+      (*func)(chunk_begin, std::min(end, chunk_begin + chunk_size));
+      num_done_chunks.fetch_add(1, std::memory_order_release);
+    }
+  }
+};
+
+CpuThreadPool::CpuThreadPool(size_t num_threads) : generation_(0), shutdown_(false) {
+  const size_t num_workers = std::max<size_t>(num_threads, 1) - 1;
+#ifdef __linux__
+  const std::vector<cpu_set_t> worker_affinity = GetWorkerAffinity(num_workers);
+#endif  // __linux__
+  workers_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(&CpuThreadPool::WorkerMain, this);
+#ifdef __linux__
+    if (!worker_affinity.empty()
+        && pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpu_set_t),
+                                  &worker_affinity[i])
+               != 0) {
+      LOG(WARNING) << "Failed to set the cpu affinity of intra-op worker " << i;
+    }
+#endif  // __linux__
+  }
+}
+
+CpuThreadPool::~CpuThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cond_.notify_all();
+  for (auto& worker : workers_) { worker.join(); }
+}
+
+void CpuThreadPool::WorkerMain() {
+  in_parallel_region = true;
+  uint64_t seen_generation = 0;
+  while (true) {
+    std::shared_ptr<Loop> loop;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [&]() { return shutdown_ || generation_ != seen_generation; });
+      if (shutdown_) { return; }
+      seen_generation = generation_;
+      loop = loop_;
+    }
+    if (loop) { loop->Run(); }
+  }
+}
+
+void CpuThreadPool::ParallelFor(int64_t begin, int64_t end,
+                                const std::function<void(int64_t, int64_t)>& func,
+                                size_t grain_size, size_t num_threads) {
+  if (begin >= end) { return; }
+  const int64_t num_elems = end - begin;
+  const int64_t max_num_chunks =
+      std::min(static_cast<int64_t>(std::min(num_threads, this->num_threads())),
+               DivUp(num_elems, std::max<int64_t>(grain_size, 1)));
+  if (max_num_chunks <= 1 || in_parallel_region) {
+    func(begin, end);
+    return;
+  }
+  std::unique_lock<std::mutex> loop_lock(loop_mutex_, std::try_to_lock);
+  if (!loop_lock.owns_lock()) {
+    func(begin, end);
+    return;
+  }
+  auto loop = std::make_shared<Loop>();
+  loop->func = &func;
+  loop->begin = begin;
+  loop->end = end;
+  loop->chunk_size = DivUp(num_elems, max_num_chunks);
+  loop->num_chunks = DivUp(num_elems, loop->chunk_size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop_ = loop;
+    generation_ += 1;
+  }
+  cond_.notify_all();
+  in_parallel_region = true;
+  loop->Run();
+  in_parallel_region = false;
+  while (loop->num_done_chunks.load(std::memory_order_acquire) < loop->num_chunks) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
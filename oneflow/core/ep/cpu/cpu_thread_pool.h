@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_CPU_THREAD_POOL_H_
+#define ONEFLOW_CORE_EP_CPU_CPU_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace ep {
+
+// Number of cpus the process may run on: its affinity mask, bounded by the cpu quota of its
+// cgroup so that a container limited to a few cores does not oversubscribe them.
+size_t GetNumAvailableCpus();
+
+// Whole cpus granted by the cfs quota of the cgroup mounted at cgroup_root, read from cpu.max
+// (v2) or cpu/cpu.cfs_quota_us and cpu/cpu.cfs_period_us (v1). 0 if unlimited or unknown.
+size_t GetCgroupCpuQuota(const std::string& cgroup_root);
+
+// Intra-op workers of the cpu streams. The thread issuing a loop works on it too, so a pool of n
+// threads owns n - 1 workers. A loop issued from inside a worker, or while the pool is busy with
+// the loop of another stream, runs sequentially on the issuing thread.
+//
+// ONEFLOW_CPU_THREAD_POOL_AFFINITY binds the workers: "numa" to the cpus of a NUMA node, filling
+// the node of the issuing thread first, "core" to a single cpu each, "none" (default) not at all.
+class CpuThreadPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuThreadPool);
+  explicit CpuThreadPool(size_t num_threads);
+  ~CpuThreadPool();
+
+  size_t num_threads() const { return workers_.size() + 1; }
+
+  // Splits [begin, end) into at most num_threads chunks of at least grain_size elements.
+  void ParallelFor(int64_t begin, int64_t end, const std::function<void(int64_t, int64_t)>& func,
+                   size_t grain_size, size_t num_threads);
+
+ private:
+  struct Loop;
+  void WorkerMain();
+
+  std::vector<std::thread> workers_;
+  std::mutex loop_mutex_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::shared_ptr<Loop> loop_;
+  uint64_t generation_;
+  bool shutdown_;
+};
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_CPU_THREAD_POOL_H_
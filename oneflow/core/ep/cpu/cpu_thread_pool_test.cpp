@@ -0,0 +1,252 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/cpu_thread_pool.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // __linux__
+
+namespace oneflow {
+
+namespace ep {
+
+namespace test {
+
+namespace {
+
+struct Call {
+  std::thread::id thread_id;
+  int64_t begin;
+  int64_t end;
+};
+
+// Records the chunks a loop is split into and the threads running them.
+class CallRecorder final {
+ public:
+  void Record(int64_t begin, int64_t end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_.push_back(Call{std::this_thread::get_id(), begin, end});
+  }
+
+  std::vector<Call> calls() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return calls_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<Call> calls_;
+};
+
+// Blocks the chunks of a loop until released, to keep a pool busy.
+class Gate final {
+ public:
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_waiting_;
+    cond_.notify_all();
+    cond_.wait(lock, [&]() { return released_; });
+  }
+
+  void WaitForWaiting(int64_t n) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return num_waiting_ >= n; });
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_ = true;
+    cond_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int64_t num_waiting_ = 0;
+  bool released_ = false;
+};
+
+void CheckCovered(const std::vector<Call>& calls, int64_t begin, int64_t end) {
+  std::vector<int64_t> counts(end - begin, 0);
+  for (const Call& call : calls) {
+    for (int64_t i = call.begin; i < call.end; ++i) { counts.at(i - begin) += 1; }
+  }
+  for (int64_t count : counts) { ASSERT_EQ(count, 1); }
+}
+
+}  // namespace
+
+TEST(CpuThreadPool, ParallelFor) {
+  CpuThreadPool pool(4);
+  ASSERT_EQ(pool.num_threads(), 4);
+  CallRecorder recorder;
+  pool.ParallelFor(
+      0, 1000, [&](int64_t begin, int64_t end) { recorder.Record(begin, end); }, 1, 4);
+  const std::vector<Call> calls = recorder.calls();
+  ASSERT_EQ(calls.size(), 4);
+  CheckCovered(calls, 0, 1000);
+  // Fewer chunks than threads when the grain is large.
+  CallRecorder grain_recorder;
+  pool.ParallelFor(
+      0, 1000, [&](int64_t begin, int64_t end) { grain_recorder.Record(begin, end); }, 600, 4);
+  ASSERT_EQ(grain_recorder.calls().size(), 2);
+  CheckCovered(grain_recorder.calls(), 0, 1000);
+}
+
+TEST(CpuThreadPool, NestedLoopRunsSequentially) {
+  CpuThreadPool pool(4);
+  CallRecorder outer_recorder;
+  std::mutex inner_mutex;
+  std::vector<std::pair<Call, std::vector<Call>>> outer2inner_calls;
+  pool.ParallelFor(
+      0, 8,
+      [&](int64_t begin, int64_t end) {
+        outer_recorder.Record(begin, end);
+        CallRecorder inner_recorder;
+        pool.ParallelFor(
+            0, 100, [&](int64_t b, int64_t e) { inner_recorder.Record(b, e); }, 1, 4);
+        std::lock_guard<std::mutex> lock(inner_mutex);
+        outer2inner_calls.emplace_back(Call{std::this_thread::get_id(), begin, end},
+                                       inner_recorder.calls());
+      },
+      1, 4);
+  CheckCovered(outer_recorder.calls(), 0, 8);
+  ASSERT_EQ(outer2inner_calls.size(), outer_recorder.calls().size());
+  for (const auto& pair : outer2inner_calls) {
+    // One call over the whole range, on the thread running the outer chunk.
+    ASSERT_EQ(pair.second.size(), 1);
+    ASSERT_EQ(pair.second.front().thread_id, pair.first.thread_id);
+    ASSERT_EQ(pair.second.front().begin, 0);
+    ASSERT_EQ(pair.second.front().end, 100);
+  }
+}
+
+TEST(CpuThreadPool, BusyPoolRunsSequentially) {
+  CpuThreadPool pool(4);
+  Gate gate;
+  std::thread busy_thread([&]() {
+    pool.ParallelFor(
+        0, 4, [&](int64_t, int64_t) { gate.Wait(); }, 1, 4);
+  });
+  // The busy thread holds the pool until its chunks are released.
+  gate.WaitForWaiting(1);
+  CallRecorder recorder;
+  pool.ParallelFor(
+      0, 1000, [&](int64_t begin, int64_t end) { recorder.Record(begin, end); }, 1, 4);
+  const std::vector<Call> calls = recorder.calls();
+  ASSERT_EQ(calls.size(), 1);
+  ASSERT_EQ(calls.front().thread_id, std::this_thread::get_id());
+  CheckCovered(calls, 0, 1000);
+  gate.Release();
+  busy_thread.join();
+}
+
+TEST(CpuThreadPool, RebuiltWhileOldPoolIsHeld) {
+  CpuDevice device(nullptr);
+  device.SetNumThreads(2);
+  std::shared_ptr<CpuThreadPool> old_pool = device.GetThreadPool();
+  ASSERT_EQ(old_pool->num_threads(), 2);
+  Gate gate;
+  std::thread old_pool_thread([&]() {
+    old_pool->ParallelFor(
+        0, 2, [&](int64_t, int64_t) { gate.Wait(); }, 1, 2);
+  });
+  gate.WaitForWaiting(2);
+  device.SetNumThreads(4);
+  std::shared_ptr<CpuThreadPool> new_pool = device.GetThreadPool();
+  ASSERT_NE(new_pool, old_pool);
+  ASSERT_EQ(new_pool->num_threads(), 4);
+  ASSERT_EQ(device.GetThreadPool(), new_pool);
+  // The new pool runs its loops in parallel while the old one is still busy.
+  CallRecorder recorder;
+  new_pool->ParallelFor(
+      0, 1000, [&](int64_t begin, int64_t end) { recorder.Record(begin, end); }, 1, 4);
+  ASSERT_EQ(recorder.calls().size(), 4);
+  CheckCovered(recorder.calls(), 0, 1000);
+  gate.Release();
+  old_pool_thread.join();
+  // The stream holding the old pool drops it last.
+  std::weak_ptr<CpuThreadPool> weak_old_pool = old_pool;
+  old_pool.reset();
+  ASSERT_TRUE(weak_old_pool.expired());
+}
+
+#ifdef __linux__
+
+namespace {
+
+std::string CreateTempDirectory() {
+  char tmpl[] = "/tmp/cpu_thread_pool_test_XXXXXX";
+  CHECK(mkdtemp(tmpl) != nullptr);
+  return tmpl;
+}
+
+void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream ofs(path);
+  CHECK(ofs.is_open()) << path;
+  ofs << content << "\n";
+}
+
+}  // namespace
+
+TEST(CpuThreadPool, CgroupV2CpuQuota) {
+  const std::string root = CreateTempDirectory();
+  WriteFile(root + "/cpu.max", "max 100000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 0);
+  WriteFile(root + "/cpu.max", "200000 100000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 2);
+  // Partial cpus round up.
+  WriteFile(root + "/cpu.max", "150000 100000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 2);
+  WriteFile(root + "/cpu.max", "50000 100000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 1);
+  unlink((root + "/cpu.max").c_str());
+  rmdir(root.c_str());
+}
+
+TEST(CpuThreadPool, CgroupV1CpuQuota) {
+  const std::string root = CreateTempDirectory();
+  ASSERT_EQ(GetCgroupCpuQuota(root), 0);
+  CHECK_EQ(mkdir((root + "/cpu").c_str(), 0755), 0);
+  WriteFile(root + "/cpu/cpu.cfs_period_us", "100000");
+  WriteFile(root + "/cpu/cpu.cfs_quota_us", "-1");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 0);
+  WriteFile(root + "/cpu/cpu.cfs_quota_us", "400000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 4);
+  WriteFile(root + "/cpu/cpu.cfs_quota_us", "250000");
+  ASSERT_EQ(GetCgroupCpuQuota(root), 3);
+  unlink((root + "/cpu/cpu.cfs_quota_us").c_str());
+  unlink((root + "/cpu/cpu.cfs_period_us").c_str());
+  rmdir((root + "/cpu").c_str());
+  rmdir(root.c_str());
+}
+
+#endif  // __linux__
+
+TEST(CpuThreadPool, NumAvailableCpus) {
+  const size_t num_cpus = GetNumAvailableCpus();
+  ASSERT_GE(num_cpus, 1);
+  ASSERT_LE(num_cpus, std::max<size_t>(std::thread::hardware_concurrency(), 1));
+}
+
+}  // namespace test
+
+}  // namespace ep
+
+}  // namespace oneflow
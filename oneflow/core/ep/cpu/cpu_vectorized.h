@@ -0,0 +1,182 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_CPU_VECTORIZED_H_
+#define ONEFLOW_CORE_EP_CPU_CPU_VECTORIZED_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ep/cpu/cpu_isa.h"
+
+namespace oneflow {
+
+namespace ep {
+
+// Row helpers for kernels that are compiled once per instruction set. Reductions use the
+// gcc/clang vector extension with two independent accumulators, because without -ffast-math the
+// compiler may not reassociate a scalar max or sum loop into vector lanes. Element wise loops are
+// left to the auto vectorizer. Callers use the helpers from a functor run through CpuIsaInvoke
+// to get the matching vector width.
+
+template<typename T, CpuIsa isa>
+struct VectorizedLanes {
+  static constexpr int kVectorBytes =
+      isa == CpuIsa::kAvx512 ? 64 : (isa == CpuIsa::kAvx2 ? 32 : 16);
+  static constexpr int value = kVectorBytes / sizeof(T);
+};
+
+template<typename T, int kLanes>
+struct VectorizedPack {
+  typedef T type __attribute__((vector_size(kLanes * sizeof(T))));
+};
+
+// Packs are passed by pointer: returning a 32 or 64 byte vector by value from a function that is
+// not itself compiled for AVX changes the calling convention and makes gcc warn.
+template<typename T, int kLanes>
+ALWAYS_INLINE inline void VectorizedLoad(const T* x, typename VectorizedPack<T, kLanes>::type* v) {
+  std::memcpy(v, x, sizeof(*v));
+}
+
+template<typename T, int kLanes>
+ALWAYS_INLINE inline T VectorizedRowMax(const T* x, int64_t n) {
+  using Pack = typename VectorizedPack<T, kLanes>::type;
+  Pack acc0 = Pack{} - std::numeric_limits<T>::infinity();
+  Pack acc1 = acc0;
+  int64_t i = 0;
+  for (; i + 2 * kLanes <= n; i += 2 * kLanes) {
+    Pack v0;
+    Pack v1;
+    VectorizedLoad<T, kLanes>(x + i, &v0);
+    VectorizedLoad<T, kLanes>(x + i + kLanes, &v1);
+    acc0 = v0 > acc0 ? v0 : acc0;
+    acc1 = v1 > acc1 ? v1 : acc1;
+  }
+  acc0 = acc1 > acc0 ? acc1 : acc0;
+  T result = acc0[0];
+  for (int l = 1; l < kLanes; ++l) { result = acc0[l] > result ? acc0[l] : result; }
+  for (; i < n; ++i) { result = x[i] > result ? x[i] : result; }
+  return result;
+}
+
+template<typename T, int kLanes>
+ALWAYS_INLINE inline T VectorizedRowSum(const T* x, int64_t n) {
+  using Pack = typename VectorizedPack<T, kLanes>::type;
+  Pack acc0 = Pack{};
+  Pack acc1 = Pack{};
+  int64_t i = 0;
+  for (; i + 2 * kLanes <= n; i += 2 * kLanes) {
+    Pack v0;
+    Pack v1;
+    VectorizedLoad<T, kLanes>(x + i, &v0);
+    VectorizedLoad<T, kLanes>(x + i + kLanes, &v1);
+    acc0 += v0;
+    acc1 += v1;
+  }
+  acc0 += acc1;
+  T result = 0;
+  for (int l = 0; l < kLanes; ++l) { result += acc0[l]; }
+  for (; i < n; ++i) { result += x[i]; }
+  return result;
+}
+
+template<typename T, int kLanes>
+ALWAYS_INLINE inline T VectorizedRowSquaredDeviationSum(const T* x, int64_t n, T mean) {
+  using Pack = typename VectorizedPack<T, kLanes>::type;
+  Pack acc0 = Pack{};
+  Pack acc1 = Pack{};
+  int64_t i = 0;
+  for (; i + 2 * kLanes <= n; i += 2 * kLanes) {
+    Pack d0;
+    Pack d1;
+    VectorizedLoad<T, kLanes>(x + i, &d0);
+    VectorizedLoad<T, kLanes>(x + i + kLanes, &d1);
+    d0 -= mean;
+    d1 -= mean;
+    acc0 += d0 * d0;
+    acc1 += d1 * d1;
+  }
+  acc0 += acc1;
+  T result = 0;
+  for (int l = 0; l < kLanes; ++l) { result += acc0[l]; }
+  for (; i < n; ++i) {
+    const T diff = x[i] - mean;
+    result += diff * diff;
+  }
+  return result;
+}
+
+template<typename T>
+struct VectorizedExpRange;
+
+template<>
+struct VectorizedExpRange<float> {
+  static constexpr float kMin = -87.3365447504f;
+  static constexpr float kMax = 88.3762626647949f;
+};
+
+template<>
+struct VectorizedExpRange<double> {
+  static constexpr double kMin = -708.396418532264;
+  static constexpr double kMax = 709.782712893384;
+};
+
+// Cephes expf: exp(x) = 2^n * exp(r) with |r| <= ln2 / 2, max relative error about 2 ulp. The
+// input must already lie in VectorizedExpRange<float>. Callers clamp in a separate loop: gcc
+// turns an inline clamp into branches to constant folded results, which keeps the loop from
+// being if-converted and vectorized.
+ALWAYS_INLINE inline float VectorizedExp(float x) {
+  const float fx = x * 1.44269504088896341f + 0.5f;
+  int32_t n = static_cast<int32_t>(fx);
+  n -= static_cast<int32_t>(static_cast<float>(n) > fx);
+  const float n_f = static_cast<float>(n);
+  const float r = x - n_f * 0.693359375f + n_f * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  const int32_t bits = (n + 127) << 23;
+  float pow2n;
+  std::memcpy(&pow2n, &bits, sizeof(float));
+  return p * pow2n;
+}
+
+ALWAYS_INLINE inline double VectorizedExp(double x) { return std::exp(x); }
+
+// Sum of exp(x[i]) for x already in VectorizedExpRange<T>, evaluated in blocks through a stack
+// buffer so that the exp loop stays a plain element wise loop.
+template<typename T, int kLanes>
+ALWAYS_INLINE inline T VectorizedRowExpSum(const T* x, int64_t n) {
+  constexpr int64_t kBlockSize = 256;
+  T buf[kBlockSize];
+  T result = 0;
+  for (int64_t i = 0; i < n; i += kBlockSize) {
+    const int64_t block_size = std::min(kBlockSize, n - i);
+    for (int64_t j = 0; j < block_size; ++j) { buf[j] = VectorizedExp(x[i + j]); }
+    result += VectorizedRowSum<T, kLanes>(buf, block_size);
+  }
+  return result;
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_CPU_VECTORIZED_H_
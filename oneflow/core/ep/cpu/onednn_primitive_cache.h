@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_ONEDNN_PRIMITIVE_CACHE_H_
+#define ONEFLOW_CORE_EP_CPU_ONEDNN_PRIMITIVE_CACHE_H_
+
+#ifdef WITH_ONEDNN
+
+#include <list>
+#include <oneapi/dnnl/dnnl.hpp>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace ep {
+
+// The oneDNN primitives created for the engine of a stream, keyed by what they compute, e.g. the
+// op and the shapes of its tensors, so that creating the primitive descriptor, which searches the
+// implementations, happens once per shape. The least recently used ones are evicted beyond the
+// capacity. Only used by the thread of the stream.
+class OneDnnPrimitiveCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OneDnnPrimitiveCache);
+  explicit OneDnnPrimitiveCache(size_t capacity) : capacity_(capacity) {}
+  ~OneDnnPrimitiveCache() = default;
+
+  template<typename CreateFn>
+  const dnnl::primitive& GetOrCreate(const std::string& key, const CreateFn& Create) {
+    auto it = key2entry_.find(key);
+    if (it != key2entry_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+    entries_.emplace_front(key, Create());
+    key2entry_.emplace(key, entries_.begin());
+    if (entries_.size() > capacity_) {
+      key2entry_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    return entries_.front().second;
+  }
+
+ private:
+  using Entry = std::pair<std::string, dnnl::primitive>;
+
+  size_t capacity_;
+  std::list<Entry> entries_;
+  HashMap<std::string, std::list<Entry>::iterator> key2entry_;
+};
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
+
+#endif  // ONEFLOW_CORE_EP_CPU_ONEDNN_PRIMITIVE_CACHE_H_
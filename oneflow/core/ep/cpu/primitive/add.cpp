@@ -25,22 +25,28 @@ namespace primitive {
 namespace {
 
 template<typename T, size_t arity>
-void AddCpu(const T* const* srcs, T* dst, size_t count) {
-  for (size_t i = 0; i < count; ++i) {
-    T sum = T(0);
-    for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
-    dst[i] = sum;
+struct AddFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(const T* const* srcs, T* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      T sum = T(0);
+      for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
+      dst[i] = sum;
+    }
   }
-}
+};
 
 template<typename T>
-void AddCpu(const T* const* srcs, size_t arity, T* dst, size_t count) {
-  for (size_t i = 0; i < count; ++i) {
-    T sum = T(0);
-    for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
-    dst[i] = sum;
+struct DynamicArityAddFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(const T* const* srcs, size_t arity, T* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      T sum = T(0);
+      for (size_t a = 0; a < arity; ++a) { sum += srcs[a][i]; }
+      dst[i] = sum;
+    }
   }
-}
+};
 
 template<typename T>
 class AddDefaultImpl : public Add {
@@ -52,14 +58,17 @@ class AddDefaultImpl : public Add {
   using Add::Launch;
   void Launch(Stream* stream, const void* const* srcs, size_t arity, void* dst,
               size_t count) override {
-#define ONE_IF(a)                                                                            \
-  if (arity == a) {                                                                          \
-    AddCpu<T, a>(reinterpret_cast<const T* const*>(srcs), reinterpret_cast<T*>(dst), count); \
+    const CpuIsa isa = static_cast<CpuDevice*>(stream->As<CpuStream>()->device())->isa();
+#define ONE_IF(a)                                                                \
+  if (arity == a) {                                                              \
+    CpuIsaInvoke<AddFunctor<T, a>>(isa, reinterpret_cast<const T* const*>(srcs), \
+                                   reinterpret_cast<T*>(dst), count);            \
   }
 #define ONE_ELIF(a) else ONE_IF(a)
-#define ONE_ELSE                                                                                 \
-  else {                                                                                         \
-    AddCpu<T>(reinterpret_cast<const T* const*>(srcs), arity, reinterpret_cast<T*>(dst), count); \
+#define ONE_ELSE                                                                          \
+  else {                                                                                  \
+    CpuIsaInvoke<DynamicArityAddFunctor<T>>(isa, reinterpret_cast<const T* const*>(srcs), \
+                                            arity, reinterpret_cast<T*>(dst), count);     \
   }
     ONE_IF(0)
     ONE_ELIF(1)
@@ -42,6 +42,50 @@ float16 GetValue<float16>(Scalar value) {
   return static_cast<float16>(GetValue<float>(value));
 }
 
+// Loops for the cases that need no index arithmetic: one side is a scalar or both sides have the
+// same shape. They are run through CpuIsaInvoke; everything else goes to NdarrayUtil.
+template<BinaryOp binary_op, typename Src, typename Dst>
+struct ElementwiseBinaryFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end, const Src* src0, bool src0_scalar,
+                                   const Src* src1, bool src1_scalar, Dst* dst) {
+    BinaryFunctor<DeviceType::kCPU, binary_op, Src, Dst> functor;
+    if (src0_scalar) {
+      const Src src0_val = *src0;
+      for (int64_t i = begin; i < end; ++i) { dst[i] = functor(src0_val, src1[i]); }
+    } else if (src1_scalar) {
+      const Src src1_val = *src1;
+      for (int64_t i = begin; i < end; ++i) { dst[i] = functor(src0[i], src1_val); }
+    } else {
+      for (int64_t i = begin; i < end; ++i) { dst[i] = functor(src0[i], src1[i]); }
+    }
+  }
+};
+
+template<BinaryOp binary_op, typename Src, typename Dst>
+void LaunchElementwiseBinary(Stream* stream, int64_t elem_cnt, const Src* src0, bool src0_scalar,
+                             const Src* src1, bool src1_scalar, Dst* dst) {
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  const CpuIsa isa = static_cast<CpuDevice*>(cpu_stream->device())->isa();
+  cpu_stream->ParallelFor(0, elem_cnt, [&](int64_t begin, int64_t end) {
+    CpuIsaInvoke<ElementwiseBinaryFunctor<binary_op, Src, Dst>>(isa, begin, end, src0, src0_scalar,
+                                                                src1, src1_scalar, dst);
+  });
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst>
+void LaunchStridedElementwiseBinary(Stream* stream, const StridedDims& strided, const Src* src0,
+                                    const Src* src1, Dst* dst) {
+  const int64_t* strides[3] = {strided.dst_strides, strided.src0_strides, strided.src1_strides};
+  stream->As<CpuStream>()->ParallelFor(0, strided.elem_cnt(), [&](int64_t begin, int64_t end) {
+    BinaryFunctor<DeviceType::kCPU, binary_op, Src, Dst> functor;
+    ForEachStridedOffsets<3, kMaxNumDims>(
+        strided.num_dims, strided.dims, strides, begin, end, [&](const int64_t* offsets) {
+          dst[offsets[0]] = functor(src0[offsets[1]], src1[offsets[2]]);
+        });
+  });
+}
+
 template<BinaryOp binary_op, typename Src, typename Dst,
          void (*binary_func)(ep::Stream* stream, const XpuVarNdarray<Dst>& z,
                              const XpuVarNdarray<const Src>& x, const XpuVarNdarray<const Src>& y)>
@@ -55,17 +99,17 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
               const void* src1, void* dst) override {
     int64_t elem_cnt = GetElementCount(num_src1_dims, src1_dims);
     Src src0_val = GetValue<Src>(src0);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src0_val, 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src1), 1));
+    LaunchElementwiseBinary<binary_op, Src, Dst>(stream, elem_cnt, &src0_val, true,
+                                                 reinterpret_cast<const Src*>(src1), false,
+                                                 reinterpret_cast<Dst*>(dst));
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               Scalar src1, void* dst) override {
     int64_t elem_cnt = GetElementCount(num_src0_dims, src0_dims);
     Src src1_val = GetValue<Src>(src1);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src0), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src1_val, 1));
+    LaunchElementwiseBinary<binary_op, Src, Dst>(stream, elem_cnt,
+                                                 reinterpret_cast<const Src*>(src0), false,
+                                                 &src1_val, true, reinterpret_cast<Dst*>(dst));
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               size_t num_src1_dims, const int64_t* src1_dims, const void* src1,
@@ -82,6 +126,14 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
                                        simplified_dst_dims);
     CheckInplace(num_dims, simplified_src0_dims, src0, simplified_src1_dims, src1,
                  simplified_dst_dims, dst);
+    if (num_dims == 1) {
+      const int64_t elem_cnt = simplified_dst_dims[0];
+      LaunchElementwiseBinary<binary_op, Src, Dst>(
+          stream, elem_cnt, reinterpret_cast<const Src*>(src0), simplified_src0_dims[0] == 1,
+          reinterpret_cast<const Src*>(src1), simplified_src1_dims[0] == 1,
+          reinterpret_cast<Dst*>(dst));
+      return;
+    }
     for (int64_t i = 0; i < num_dims; ++i) {
       src0_dim_vec.push_back(simplified_src0_dims[i]);
       src1_dim_vec.push_back(simplified_src1_dims[i]);
@@ -93,6 +145,22 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
         XpuVarNdarray<const Src>(Shape(src1_dim_vec), reinterpret_cast<const Src*>(src1),
                                  num_dims));
   }
+  void Launch(Stream* stream, size_t num_dims, const int64_t* dims, const int64_t* src0_strides,
+              const void* src0, const int64_t* src1_strides, const void* src1,
+              const int64_t* dst_strides, void* dst) override {
+    const StridedDims strided(num_dims, dims, src0_strides, src1_strides, dst_strides);
+    if (strided.elem_cnt() == 0) { return; }
+    int64_t src0_dims[kMaxNumDims];
+    int64_t src1_dims[kMaxNumDims];
+    if (strided.GetBroadcastDims(src0_dims, src1_dims)) {
+      Launch(stream, strided.num_dims, src0_dims, src0, strided.num_dims, src1_dims, src1, dst);
+      return;
+    }
+    LaunchStridedElementwiseBinary<binary_op, Src, Dst>(stream, strided,
+                                                        reinterpret_cast<const Src*>(src0),
+                                                        reinterpret_cast<const Src*>(src1),
+                                                        reinterpret_cast<Dst*>(dst));
+  }
 };
 
 template<BinaryOp binary_op, typename Src, typename Dst,
@@ -229,6 +297,58 @@ class OneDnnBroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
     auto binary_pd = dnnl::binary::primitive_desc(binary_d, *onednn_engine);
     auto binary_prim = dnnl::binary(binary_pd);
 
+    std::unordered_map<int, dnnl::memory> binary_args{
+        {DNNL_ARG_SRC_0, src_0_mem}, {DNNL_ARG_SRC_1, src_1_mem}, {DNNL_ARG_DST, dst_mem}};
+
+    binary_prim.execute(*onednn_stream, binary_args);
+    onednn_stream->wait();
+  }
+  void Launch(Stream* stream, size_t num_dims, const int64_t* dims, const int64_t* src0_strides,
+              const void* src0, const int64_t* src1_strides, const void* src1,
+              const int64_t* dst_strides, void* dst) override {
+    const StridedDims strided(num_dims, dims, src0_strides, src1_strides, dst_strides);
+    if (strided.elem_cnt() == 0) { return; }
+    int64_t src0_bcast_dims[kMaxNumDims];
+    int64_t src1_bcast_dims[kMaxNumDims];
+    if (strided.GetBroadcastDims(src0_bcast_dims, src1_bcast_dims)) {
+      Launch(stream, strided.num_dims, src0_bcast_dims, src0, strided.num_dims, src1_bcast_dims,
+             src1, dst);
+      return;
+    }
+    // OneDNN inplace operations only support src_0
+    CHECK(src1 != dst || src0 == dst);
+    CpuStream* cpu_stream = stream->As<CpuStream>();
+    size_t num_threads = static_cast<CpuDevice*>(cpu_stream->device())->GetNumThreads();
+    CpuNumThreadsGuard guard(num_threads);
+
+    dnnl::engine* onednn_engine = cpu_stream->onednn_engine();
+    dnnl::stream* onednn_stream = cpu_stream->onednn_stream();
+    // Memory descriptors with explicit strides, the broadcast dims having size 1.
+    dnnl::memory::dims dst_dims(strided.dims, strided.dims + strided.num_dims);
+    dnnl::memory::dims src_0_dims(dst_dims);
+    dnnl::memory::dims src_1_dims(dst_dims);
+    for (size_t i = 0; i < strided.num_dims; ++i) {
+      if (strided.src0_strides[i] == 0) { src_0_dims[i] = 1; }
+      if (strided.src1_strides[i] == 0) { src_1_dims[i] = 1; }
+    }
+    auto src_0_md = dnnl::memory::desc(
+        src_0_dims, src_onednn,
+        dnnl::memory::dims(strided.src0_strides, strided.src0_strides + strided.num_dims));
+    auto src_1_md = dnnl::memory::desc(
+        src_1_dims, src_onednn,
+        dnnl::memory::dims(strided.src1_strides, strided.src1_strides + strided.num_dims));
+    auto dst_md = dnnl::memory::desc(
+        dst_dims, dst_onednn,
+        dnnl::memory::dims(strided.dst_strides, strided.dst_strides + strided.num_dims));
+
+    auto src_0_mem = dnnl::memory(src_0_md, *onednn_engine, const_cast<void*>(src0));
+    auto src_1_mem = dnnl::memory(src_1_md, *onednn_engine, const_cast<void*>(src1));
+    auto dst_mem = dnnl::memory(dst_md, *onednn_engine, dst);
+
+    auto binary_d = dnnl::binary::desc(algorithm, src_0_md, src_1_md, dst_md);
+    auto binary_pd = dnnl::binary::primitive_desc(binary_d, *onednn_engine);
+    auto binary_prim = dnnl::binary(binary_pd);
+
     std::unordered_map<int, dnnl::memory> binary_args{
         {DNNL_ARG_SRC_0, src_0_mem}, {DNNL_ARG_SRC_1, src_1_mem}, {DNNL_ARG_DST, dst_mem}};
 
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/cast.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -24,9 +25,12 @@ namespace primitive {
 namespace {
 
 template<typename From, typename To>
-void CastCpu(const From* from, To* to, size_t count) {
-  for (size_t i = 0; i < count; ++i) { to[i] = static_cast<To>(from[i]); }
-}
+struct CastFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(const From* from, To* to, size_t count) {
+    for (size_t i = 0; i < count; ++i) { to[i] = static_cast<To>(from[i]); }
+  }
+};
 
 template<typename From, typename To>
 class CastImpl : public Cast {
@@ -36,7 +40,13 @@ class CastImpl : public Cast {
   ~CastImpl() override = default;
 
   void Launch(Stream* stream, const void* from, void* to, size_t count) override {
-    CastCpu(reinterpret_cast<const From*>(from), reinterpret_cast<To*>(to), count);
+    CpuStream* cpu_stream = stream->As<CpuStream>();
+    const CpuIsa isa = static_cast<CpuDevice*>(cpu_stream->device())->isa();
+    const From* from_ptr = reinterpret_cast<const From*>(from);
+    To* to_ptr = reinterpret_cast<To*>(to);
+    cpu_stream->ParallelFor(0, count, [&](int64_t begin, int64_t end) {
+      CpuIsaInvoke<CastFunctor<From, To>>(isa, from_ptr + begin, to_ptr + begin, end - begin);
+    });
   }
 };
 
@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/copy_nd.h"
 #include "oneflow/core/ep/common/primitive/copy_nd.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include <cstring>
 
 namespace oneflow {
 
@@ -24,28 +26,60 @@ namespace primitive {
 namespace {
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void CopyNdKernel(CopyNdKernelParams<num_dims, IndexType> params) {
-  using T = typename std::aligned_storage<movement_size, movement_size>::type;
-  const T* src = reinterpret_cast<const T*>(params.src);
-  T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType copy_index[num_dims];
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.copy_index_helper.OffsetToNdIndex(i, copy_index);
-    for (size_t j = 0; j < num_dims; ++j) {
-      src_index[j] = params.src_pos[j] + copy_index[j];
-      dst_index[j] = params.dst_pos[j] + copy_index[j];
+struct CopyNdKernel {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(const CopyNdKernelParams<num_dims, IndexType>& params) {
+    using T = typename std::aligned_storage<movement_size, movement_size>::type;
+    const T* src = reinterpret_cast<const T*>(params.src);
+    T* dst = reinterpret_cast<T*>(params.dst);
+    for (IndexType i = 0; i < params.count; ++i) {
+      IndexType copy_index[num_dims];
+      IndexType src_index[num_dims];
+      IndexType dst_index[num_dims];
+      params.copy_index_helper.OffsetToNdIndex(i, copy_index);
+      for (size_t j = 0; j < num_dims; ++j) {
+        src_index[j] = params.src_pos[j] + copy_index[j];
+        dst_index[j] = params.dst_pos[j] + copy_index[j];
+      }
+      const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+      const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
+      dst[dst_offset] = src[src_offset];
     }
-    const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
-    dst[dst_offset] = src[src_offset];
   }
-}
+};
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
-  CopyNdKernel<num_dims, movement_size, IndexType>(params);
+  const CpuIsa isa = static_cast<CpuDevice*>(stream->As<CpuStream>()->device())->isa();
+  CpuIsaInvoke<CopyNdKernel<num_dims, movement_size, IndexType>>(isa, params);
+}
+
+// Narrower rows are left to CopyNdKernel since a memcpy call per row costs more than it saves.
+constexpr int64_t kMinMemcpyRowBytes = 64;
+
+bool TryLaunchMemcpy(Stream* stream, size_t movement_size, size_t num_dims, void* dst,
+                     const int64_t* dst_dims, const int64_t* dst_pos, const void* src,
+                     const int64_t* src_dims, const int64_t* src_pos, const int64_t* extent) {
+  if (num_dims == 1) {
+    std::memcpy(static_cast<char*>(dst) + dst_pos[0] * movement_size,
+                static_cast<const char*>(src) + src_pos[0] * movement_size,
+                extent[0] * movement_size);
+    return true;
+  } else if (num_dims == 2) {
+    const int64_t row_bytes = extent[1] * movement_size;
+    if (row_bytes < kMinMemcpyRowBytes) { return false; }
+    const int64_t dst_pitch = dst_dims[1] * movement_size;
+    const int64_t src_pitch = src_dims[1] * movement_size;
+    char* dst_row = static_cast<char*>(dst) + dst_pos[0] * dst_pitch + dst_pos[1] * movement_size;
+    const char* src_row =
+        static_cast<const char*>(src) + src_pos[0] * src_pitch + src_pos[1] * movement_size;
+    for (int64_t i = 0; i < extent[0]; ++i) {
+      std::memcpy(dst_row + i * dst_pitch, src_row + i * src_pitch, row_bytes);
+    }
+    return true;
+  } else {
+    return false;
+  }
 }
 
 class CopyNdImpl : public CopyNd {
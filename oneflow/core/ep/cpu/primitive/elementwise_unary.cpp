@@ -26,6 +26,15 @@ namespace primitive {
 
 namespace {
 
+template<UnaryOp unary_op, typename Src, typename Dst>
+struct ElementwiseUnaryFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end, const Src* src, Dst* dst) {
+    UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src> functor;
+    for (int64_t i = begin; i < end; i++) { dst[i] = functor(src[i]); }
+  }
+};
+
 template<UnaryOp unary_op, typename Src, typename Dst>
 class ElementwiseUnaryImpl : public ElementwiseUnary {
  public:
@@ -35,13 +44,30 @@ class ElementwiseUnaryImpl : public ElementwiseUnary {
 
   void Launch(Stream* stream, const void* src_ptr, void* dst_ptr, size_t count) override {
     CpuStream* cpu_stream = stream->As<CpuStream>();
+    const CpuIsa isa = static_cast<CpuDevice*>(cpu_stream->device())->isa();
+
+    Dst* dst = reinterpret_cast<Dst*>(dst_ptr);
+    const Src* src = reinterpret_cast<const Src*>(src_ptr);
+    cpu_stream->ParallelFor(0, count, [isa, src, dst](int64_t begin, int64_t end) {
+      CpuIsaInvoke<ElementwiseUnaryFunctor<unary_op, Src, Dst>>(isa, begin, end, src, dst);
+    });
+  }
 
+  void Launch(Stream* stream, size_t num_dims, const int64_t* dims, const int64_t* src_strides,
+              const void* src_ptr, const int64_t* dst_strides, void* dst_ptr) override {
+    const elementwise_unary::StridedDims strided(num_dims, dims, src_strides, dst_strides);
+    if (strided.IsContiguous()) {
+      Launch(stream, src_ptr, dst_ptr, strided.elem_cnt());
+      return;
+    }
     Dst* dst = reinterpret_cast<Dst*>(dst_ptr);
     const Src* src = reinterpret_cast<const Src*>(src_ptr);
-    cpu_stream->ParallelFor(0, count, [src, dst](int64_t begin, int64_t end) {
-      for (int64_t i = begin; i < end; i++) {
-        dst[i] = UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src>()(src[i]);
-      }
+    const int64_t* strides[2] = {strided.dst_strides, strided.src_strides};
+    stream->As<CpuStream>()->ParallelFor(0, strided.elem_cnt(), [&](int64_t begin, int64_t end) {
+      UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src> functor;
+      ForEachStridedOffsets<2, elementwise_unary::kMaxNumDims>(
+          strided.num_dims, strided.dims, strides, begin, end,
+          [&](const int64_t* offsets) { dst[offsets[0]] = functor(src[offsets[1]]); });
     });
   }
 };
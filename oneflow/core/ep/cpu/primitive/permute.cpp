@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/permute.h"
 #include "oneflow/core/ep/common/primitive/permute_impl.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -28,29 +29,39 @@ namespace internal {
 namespace {
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
-  using T = typename std::aligned_storage<movement_size, movement_size>::type;
-  const T* src = reinterpret_cast<const T*>(params.src);
-  T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
+struct PermuteKernel {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(const PermuteKernelParams<num_dims, IndexType>& params,
+                                   IndexType begin, IndexType end) {
+    using T = typename std::aligned_storage<movement_size, movement_size>::type;
+    const T* src = reinterpret_cast<const T*>(params.src);
+    T* dst = reinterpret_cast<T*>(params.dst);
+    for (IndexType i = begin; i < end; ++i) {
+      IndexType src_index[num_dims];
+      IndexType dst_index[num_dims];
+      params.dst_index_helper.OffsetToNdIndex(i, dst_index);
+      for (size_t dim = 0; dim < num_dims; ++dim) {
+        src_index[params.permutation[dim]] = dst_index[dim];
+      }
+      IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+      dst[i] = src[src_offset];
     }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
   }
-}
+};
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, const int64_t* src_dims, const void* src, const int* permutation,
                   void* dst, size_t count) {
   PermuteKernelParams<num_dims, IndexType> params =
       MakePermuteParams<num_dims, IndexType>(src_dims, src, permutation, dst, count);
-  PermuteKernel<num_dims, movement_size, IndexType>(params);
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  const CpuIsa isa = static_cast<CpuDevice*>(cpu_stream->device())->isa();
+  cpu_stream->ParallelFor(0, count, [&](int64_t begin, int64_t end) {
+    CpuIsaInvoke<PermuteKernel<num_dims, movement_size, IndexType>>(
+        isa, params, static_cast<IndexType>(begin), static_cast<IndexType>(end));
+  });
 }
+
 class PermuteImpl : public Permute {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PermuteImpl);
@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/softmax.h"
 #include "oneflow/core/ep/include/primitive/log_softmax.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_vectorized.h"
 
 namespace oneflow {
 
@@ -30,35 +32,43 @@ enum class Algorithm {
 };
 
 template<Algorithm algorithm, typename T>
-void SoftmaxCpu(size_t rows, size_t cols, const T* x, T* y) {
-  for (size_t i = 0; i < rows; ++i) {
-    size_t row_offset = i * cols;
-    const T* row_x = x + row_offset;
-    T* row_y = y + row_offset;
-    const T row_max = *std::max_element(row_x, row_x + cols);
-    T row_sum = 0;
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        T exp_x = std::exp(row_x[j] - row_max);
-        row_sum += exp_x;
-        row_y[j] = exp_x;
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_y[j] = row_x[j] - row_max;
-        row_sum += std::exp(row_y[j]);
-      } else {
-        UNIMPLEMENTED();
+struct SoftmaxRowsFunctor {
+  template<CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end, int64_t cols, const T* x, T* y) {
+    constexpr int kLanes = VectorizedLanes<T, isa>::value;
+    for (int64_t i = begin; i < end; ++i) {
+      const T* row_x = x + i * cols;
+      T* row_y = y + i * cols;
+      const T row_max = VectorizedRowMax<T, kLanes>(row_x, cols);
+      for (int64_t j = 0; j < cols; ++j) {
+        row_y[j] = std::max(row_x[j] - row_max, VectorizedExpRange<T>::kMin);
       }
-    }
-    for (size_t j = 0; j < cols; ++j) {
       if (algorithm == Algorithm::kSoftmax) {
-        row_y[j] /= row_sum;
+        for (int64_t j = 0; j < cols; ++j) { row_y[j] = VectorizedExp(row_y[j]); }
+        const T inv_row_sum = static_cast<T>(1) / VectorizedRowSum<T, kLanes>(row_y, cols);
+        for (int64_t j = 0; j < cols; ++j) { row_y[j] *= inv_row_sum; }
       } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_y[j] -= std::log(row_sum);
+        const T log_row_sum = std::log(VectorizedRowExpSum<T, kLanes>(row_y, cols));
+        for (int64_t j = 0; j < cols; ++j) { row_y[j] -= log_row_sum; }
       } else {
         UNIMPLEMENTED();
       }
     }
   }
+};
+
+template<Algorithm algorithm, typename T>
+void SoftmaxCpu(Stream* stream, size_t rows, size_t cols, const T* x, T* y) {
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  const CpuIsa isa = static_cast<CpuDevice*>(cpu_stream->device())->isa();
+  const int64_t num_cols = cols;
+  const size_t grain_size = std::max<size_t>(1, CpuStream::kParallelForDefaultGrain / cols);
+  cpu_stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        CpuIsaInvoke<SoftmaxRowsFunctor<algorithm, T>>(isa, begin, end, num_cols, x, y);
+      },
+      grain_size);
 }
 
 template<typename SoftmaxBase, Algorithm algorithm, typename T>
@@ -69,7 +79,9 @@ class SoftmaxImpl : public SoftmaxBase {
   ~SoftmaxImpl() override = default;
 
   void Launch(Stream* stream, size_t rows, size_t cols, const void* x, void* y) override {
-    SoftmaxCpu<algorithm, T>(rows, cols, reinterpret_cast<const T*>(x), reinterpret_cast<T*>(y));
+    if (rows == 0 || cols == 0) { return; }
+    SoftmaxCpu<algorithm, T>(stream, rows, cols, reinterpret_cast<const T*>(x),
+                             reinterpret_cast<T*>(y));
   }
 };
 
@@ -0,0 +1,102 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/unique.h"
+#include "oneflow/core/common/data_type_seq.h"
+#include "oneflow/core/common/hash_container.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+template<typename K, typename I>
+class UniqueImpl : public Unique {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueImpl);
+  UniqueImpl() = default;
+  ~UniqueImpl() override = default;
+
+  size_t GetWorkspaceSizeInBytes(size_t n, bool with_counts) override { return 1; }
+
+  void Launch(Stream* stream, size_t n, const void* in, void* num_unique, void* unique_out,
+              void* inverse_indices, void* counts, void* workspace,
+              size_t workspace_size) override {
+    const K* in_ptr = reinterpret_cast<const K*>(in);
+    K* unique_ptr = reinterpret_cast<K*>(unique_out);
+    I* inverse_indices_ptr = reinterpret_cast<I*>(inverse_indices);
+    I* counts_ptr = reinterpret_cast<I*>(counts);
+    HashMap<K, I> key2index;
+    key2index.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      const K key = in_ptr[i];
+      auto it = key2index.find(key);
+      I index = 0;
+      if (it == key2index.end()) {
+        index = static_cast<I>(key2index.size());
+        key2index.emplace(key, index);
+        unique_ptr[index] = key;
+        if (counts_ptr != nullptr) { counts_ptr[index] = 1; }
+      } else {
+        index = it->second;
+        if (counts_ptr != nullptr) { counts_ptr[index] += 1; }
+      }
+      if (inverse_indices_ptr != nullptr) { inverse_indices_ptr[i] = index; }
+    }
+    *reinterpret_cast<I*>(num_unique) = static_cast<I>(key2index.size());
+  }
+};
+
+template<typename K, typename I>
+std::unique_ptr<Unique> NewUnique() {
+  return std::unique_ptr<Unique>(new UniqueImpl<K, I>());
+}
+
+class UniqueFactoryImpl : public UniqueFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueFactoryImpl);
+  UniqueFactoryImpl() = default;
+  ~UniqueFactoryImpl() override = default;
+
+  std::unique_ptr<Unique> New(DataType key_type, DataType index_type) override {
+#define MAKE_NEW_UNIQUE_ENTRY(key_pair, index_pair)                            \
+  {std::make_pair(OF_PP_PAIR_SECOND(key_pair), OF_PP_PAIR_SECOND(index_pair)), \
+   NewUnique<OF_PP_PAIR_FIRST(key_pair), OF_PP_PAIR_FIRST(index_pair)>},
+
+    static const std::map<std::pair<DataType, DataType>, std::function<std::unique_ptr<Unique>()>>
+        new_unique_handle{OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+            MAKE_NEW_UNIQUE_ENTRY, ARITHMETIC_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ)};
+
+#undef MAKE_NEW_UNIQUE_ENTRY
+
+    const auto it = new_unique_handle.find(std::make_pair(key_type, index_type));
+    if (it != new_unique_handle.end()) {
+      return it->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, UniqueFactory, UniqueFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/weight_only_quant_matmul.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+template<int num_bits>
+int QuantizedValue(const int8_t* q, int64_t l) {
+  if (num_bits == 8) { return q[l]; }
+  const int8_t packed = q[l / 2];
+  return (l % 2 == 0) ? (static_cast<int8_t>(packed << 4) >> 4) : (packed >> 4);
+}
+
+// Dequantizes one row of the weight at a time and takes its dot products with all the rows of a,
+// so the weight is read once whatever m is.
+template<typename T, int num_bits>
+class WeightOnlyQuantMatmulImpl : public WeightOnlyQuantMatmul {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmulImpl);
+  WeightOnlyQuantMatmulImpl() = default;
+  ~WeightOnlyQuantMatmulImpl() override = default;
+
+  size_t GetWorkspaceSizeInBytes(size_t m, size_t n, size_t k) override { return 0; }
+
+  void Launch(Stream* stream, size_t m, size_t n, size_t k, size_t group_size, const void* a,
+              const void* b, const void* scales, const void* bias, void* c, void* workspace,
+              size_t workspace_size) override {
+    const T* a_ptr = reinterpret_cast<const T*>(a);
+    const int8_t* b_ptr = reinterpret_cast<const int8_t*>(b);
+    const T* scales_ptr = reinterpret_cast<const T*>(scales);
+    const T* bias_ptr = reinterpret_cast<const T*>(bias);
+    T* c_ptr = reinterpret_cast<T*>(c);
+    const int64_t row_bytes = k * num_bits / 8;
+    const int64_t num_groups = k / group_size;
+    stream->As<CpuStream>()->ParallelFor(
+        0, n,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> weight(k);
+          for (int64_t j = begin; j < end; ++j) {
+            const int8_t* q = b_ptr + j * row_bytes;
+            const T* scale = scales_ptr + j * num_groups;
+            for (int64_t l = 0; l < k; ++l) {
+              weight[l] = static_cast<T>(QuantizedValue<num_bits>(q, l)) * scale[l / group_size];
+            }
+            for (int64_t i = 0; i < m; ++i) {
+              const T* a_row = a_ptr + i * k;
+              T sum = bias_ptr == nullptr ? static_cast<T>(0) : bias_ptr[j];
+              for (int64_t l = 0; l < k; ++l) { sum += a_row[l] * weight[l]; }
+              c_ptr[i * n + j] = sum;
+            }
+          }
+        },
+        1);
+  }
+};
+
+template<typename T, int num_bits>
+std::unique_ptr<WeightOnlyQuantMatmul> NewWeightOnlyQuantMatmul() {
+  return std::unique_ptr<WeightOnlyQuantMatmul>(new WeightOnlyQuantMatmulImpl<T, num_bits>());
+}
+
+class WeightOnlyQuantMatmulFactoryImpl : public WeightOnlyQuantMatmulFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmulFactoryImpl);
+  WeightOnlyQuantMatmulFactoryImpl() = default;
+  ~WeightOnlyQuantMatmulFactoryImpl() override = default;
+
+  std::unique_ptr<WeightOnlyQuantMatmul> New(DataType data_type, int num_bits) override {
+#define MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY(type_pair, num_bits) \
+  {std::make_pair(OF_PP_PAIR_SECOND(type_pair), num_bits),           \
+   NewWeightOnlyQuantMatmul<OF_PP_PAIR_FIRST(type_pair), num_bits>},
+
+    static const std::map<std::pair<DataType, int>,
+                          std::function<std::unique_ptr<WeightOnlyQuantMatmul>()>>
+        new_weight_only_quant_matmul_handle{
+            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY,
+                                             CPU_PRIMITIVE_FLOATING_TYPE_SEQ, (4)(8))};
+
+#undef MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY
+
+    const auto it = new_weight_only_quant_matmul_handle.find(std::make_pair(data_type, num_bits));
+    if (it != new_weight_only_quant_matmul_handle.end()) {
+      return it->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, WeightOnlyQuantMatmulFactory,
+                           WeightOnlyQuantMatmulFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -84,9 +84,9 @@ CudaDevice::~CudaDevice() {
 
 void CudaDevice::SetAsActiveDevice() { OF_CUDA_CHECK(cudaSetDevice(device_index_)); }
 
-Stream* CudaDevice::CreateStream() {
+Stream* CudaDevice::CreateStream(StreamPriority priority) {
   CudaCurrentDeviceGuard guard(device_index_);
-  return new CudaStream(this);
+  return new CudaStream(this, priority);
 }
 
 void CudaDevice::DestroyStream(Stream* stream) {
@@ -39,7 +39,7 @@ class CudaDevice : public Device {
   size_t device_index() const override { return device_index_; }
   DeviceManager* device_manager() const override { return device_manager_; }
 
-  Stream* CreateStream() override;
+  Stream* CreateStream(StreamPriority priority = StreamPriority::kNormal) override;
   void DestroyStream(Stream* stream) override;
 
   void CreateEvents(Event** events, size_t count) override;
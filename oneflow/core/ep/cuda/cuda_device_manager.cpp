@@ -46,7 +46,12 @@ size_t CudaDeviceManager::GetDeviceCount(size_t primary_device_index) {
 
 size_t CudaDeviceManager::GetDeviceCount() {
   int count = 0;
-  OF_CUDA_CHECK(cudaGetDeviceCount(&count));
+  const cudaError_t err = cudaGetDeviceCount(&count);
+  if (err == cudaErrorNoDevice || err == cudaErrorInsufficientDriver) {
+    (void)cudaGetLastError();
+    return 0;
+  }
+  OF_CUDA_CHECK(err);
   return count;
 }
 
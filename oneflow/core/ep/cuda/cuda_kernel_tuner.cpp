@@ -0,0 +1,168 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cuda/cuda_kernel_tuner.h"
+
+#ifdef WITH_CUDA
+
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+
+namespace oneflow {
+
+namespace ep {
+
+namespace {
+
+constexpr int kKernelTuningDatabaseFormatVersion = 1;
+
+// Every record is a line "<kernel> <key> <num_candidates> <candidate>", later lines overriding
+// earlier ones. A record is appended by a single write, so several processes may share a file.
+std::string GetKernelTuningDatabaseFileName(const cudaDeviceProp& prop) {
+  std::string gpu_name(prop.name);
+  for (char& c : gpu_name) {
+    if (!std::isalnum(static_cast<unsigned char>(c))) { c = '_'; }
+  }
+  int runtime_version = 0;
+  OF_CUDA_CHECK(cudaRuntimeGetVersion(&runtime_version));
+  return "kernel_tuning_db.v" + std::to_string(kKernelTuningDatabaseFormatVersion) + "."
+         + gpu_name + ".sm" + std::to_string(prop.major) + std::to_string(prop.minor) + ".cuda"
+         + std::to_string(runtime_version) + ".txt";
+}
+
+bool HasWhitespace(const std::string& str) {
+  return std::any_of(str.cbegin(), str.cend(),
+                     [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+}
+
+}  // namespace
+
+CudaKernelTuner::CudaKernelTuner()
+    : enabled_(ParseBooleanFromEnv("ONEFLOW_KERNEL_TUNING", false)),
+      num_iters_(std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_KERNEL_TUNING_NUM_ITERS", 5), 1)),
+      cache_dir_(GetStringFromEnv("ONEFLOW_KERNEL_TUNING_CACHE_DIR", "")) {}
+
+int32_t CudaKernelTuner::Tune(CudaStream* stream, const std::string& kernel,
+                              const std::string& key, int32_t num_candidates,
+                              const std::function<bool(int32_t candidate)>& Launch) {
+  CHECK_GT(num_candidates, 0);
+  CHECK(!HasWhitespace(kernel) && !HasWhitespace(key))
+      << "kernel tuning keys should not contain whitespace: " << kernel << " " << key;
+  if (!enabled_) { return -1; }
+#ifdef WITH_CUDA_GRAPHS
+  if (stream->IsGraphCapturing()) { return -1; }
+#endif  // WITH_CUDA_GRAPHS
+  const std::string record_key = kernel + " " + key;
+  DeviceDatabase* database = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    database = GetOrLoadDeviceDatabase(stream);
+    const auto it = database->winners.find(record_key);
+    // A record of another number of candidates is of another version of the kernel.
+    if (it != database->winners.end() && it->second.num_candidates == num_candidates) {
+      return it->second.candidate;
+    }
+  }
+  // Two threads racing on a new problem both measure it, and the later winner is kept.
+  const Winner winner{num_candidates, Benchmark(stream, num_candidates, Launch)};
+  VLOG(1) << "Tuned " << record_key << ": candidate " << winner.candidate << " of "
+          << num_candidates;
+  std::lock_guard<std::mutex> lock(mutex_);
+  database->winners[record_key] = winner;
+  AppendRecord(*database, record_key, winner);
+  return winner.candidate;
+}
+
+CudaKernelTuner::DeviceDatabase* CudaKernelTuner::GetOrLoadDeviceDatabase(CudaStream* stream) {
+  const int64_t device_index = stream->device()->device_index();
+  auto it = device_databases_.find(device_index);
+  if (it != device_databases_.end()) { return &it->second; }
+  DeviceDatabase* database = &device_databases_[device_index];
+  if (cache_dir_.empty()) { return database; }
+  database->path =
+      JoinPath(cache_dir_, GetKernelTuningDatabaseFileName(stream->device_properties()));
+  std::ifstream in(database->path);
+  if (!in.is_open()) { return database; }
+  std::string kernel;
+  std::string key;
+  Winner winner{};
+  size_t num_loaded = 0;
+  while (in >> kernel >> key >> winner.num_candidates >> winner.candidate) {
+    if (winner.candidate < 0 || winner.candidate >= winner.num_candidates) { continue; }
+    database->winners[kernel + " " + key] = winner;
+    num_loaded += 1;
+  }
+  VLOG(1) << "Loaded " << num_loaded << " kernel tuning records from " << database->path;
+  return database;
+}
+
+int32_t CudaKernelTuner::Benchmark(CudaStream* stream, int32_t num_candidates,
+                                   const std::function<bool(int32_t candidate)>& Launch) {
+  cudaStream_t cuda_stream = stream->cuda_stream();
+  cudaEvent_t start{};
+  cudaEvent_t end{};
+  OF_CUDA_CHECK(cudaEventCreate(&start));
+  OF_CUDA_CHECK(cudaEventCreate(&end));
+  int32_t best_candidate = -1;
+  float best_time = std::numeric_limits<float>::infinity();
+  for (int32_t candidate = 0; candidate < num_candidates; ++candidate) {
+    // The first launch warms the candidate up and tells whether it applies.
+    if (!Launch(candidate)) { continue; }
+    OF_CUDA_CHECK(cudaEventRecord(start, cuda_stream));
+    for (int64_t i = 0; i < num_iters_; ++i) { CHECK(Launch(candidate)); }
+    OF_CUDA_CHECK(cudaEventRecord(end, cuda_stream));
+    OF_CUDA_CHECK(cudaEventSynchronize(end));
+    float time = 0;
+    OF_CUDA_CHECK(cudaEventElapsedTime(&time, start, end));
+    if (time < best_time) {
+      best_time = time;
+      best_candidate = candidate;
+    }
+  }
+  OF_CUDA_CHECK(cudaEventDestroy(start));
+  OF_CUDA_CHECK(cudaEventDestroy(end));
+  CHECK_GE(best_candidate, 0) << "no kernel candidate applies to the problem";
+  return best_candidate;
+}
+
+void CudaKernelTuner::AppendRecord(const DeviceDatabase& database, const std::string& record_key,
+                                   const Winner& winner) {
+  if (database.path.empty()) { return; }
+  const std::string line = record_key + " " + std::to_string(winner.num_candidates) + " "
+                           + std::to_string(winner.candidate) + "\n";
+  const int fd = open(database.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    PLOG(WARNING) << "Cannot open kernel tuning database " << database.path;
+    return;
+  }
+  const ssize_t written = write(fd, line.data(), line.size());
+  if (written != static_cast<ssize_t>(line.size())) {
+    PLOG(WARNING) << "Cannot append to kernel tuning database " << database.path;
+  }
+  close(fd);
+}
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CUDA_CUDA_KERNEL_TUNER_H_
+#define ONEFLOW_CORE_EP_CUDA_CUDA_KERNEL_TUNER_H_
+
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+
+#ifdef WITH_CUDA
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace oneflow {
+
+namespace ep {
+
+// Chooses among the candidate configurations of a kernel by timing all of them on the first
+// call for a problem, when ONEFLOW_KERNEL_TUNING is set. The winners are kept for every device.
+// With ONEFLOW_KERNEL_TUNING_CACHE_DIR set, they are also appended to a database file keyed by
+// GPU model, compute capability and CUDA runtime version, which is loaded by later processes on
+// their first call, so a problem is only measured once on a machine.
+class CudaKernelTuner final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CudaKernelTuner);
+  ~CudaKernelTuner() = default;
+
+  static CudaKernelTuner* Get() {
+    static CudaKernelTuner tuner;
+    return &tuner;
+  }
+
+  // Returns the fastest candidate in [0, num_candidates) for problem `key` of `kernel`, or -1
+  // when tuning is disabled or the stream is capturing a CUDA graph, in which case the caller
+  // falls back to its heuristic. Launch(candidate) enqueues the kernel configured by the
+  // candidate on the stream, or returns false without enqueuing anything if the candidate does
+  // not apply to the problem. Every candidate is launched several times while tuning, so the
+  // launches must not update their inputs in place. `kernel` and `key` must not contain
+  // whitespace.
+  int32_t Tune(CudaStream* stream, const std::string& kernel, const std::string& key,
+               int32_t num_candidates, const std::function<bool(int32_t candidate)>& Launch);
+
+ private:
+  struct Winner {
+    int32_t num_candidates;
+    int32_t candidate;
+  };
+
+  struct DeviceDatabase {
+    std::string path;
+    std::unordered_map<std::string, Winner> winners;
+  };
+
+  CudaKernelTuner();
+  DeviceDatabase* GetOrLoadDeviceDatabase(CudaStream* stream);
+  int32_t Benchmark(CudaStream* stream, int32_t num_candidates,
+                    const std::function<bool(int32_t candidate)>& Launch);
+  void AppendRecord(const DeviceDatabase& database, const std::string& record_key,
+                    const Winner& winner);
+
+  bool enabled_;
+  int64_t num_iters_;
+  std::string cache_dir_;
+  std::mutex mutex_;
+  std::unordered_map<int64_t, DeviceDatabase> device_databases_;
+};
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
+
+#endif  // ONEFLOW_CORE_EP_CUDA_CUDA_KERNEL_TUNER_H_
@@ -84,11 +84,19 @@ void CudaGraphExecutable::Reset() {
 
 #endif  // WITH_CUDA_GRAPHS
 
-CudaStream::CudaStream(CudaDevice* device)
+CudaStream::CudaStream(CudaDevice* device, StreamPriority priority)
     : device_index_(device->device_index()), device_(device) {
   CudaCurrentDeviceGuard guard(device_index_);
   // cuda_stream
-  OF_CUDA_CHECK(cudaStreamCreate(&cuda_stream_));
+  if (priority == StreamPriority::kHigh) {
+    // the greatest priority is the numerically lowest one
+    int greatest_priority = 0;
+    OF_CUDA_CHECK(cudaDeviceGetStreamPriorityRange(nullptr, &greatest_priority));
+    OF_CUDA_CHECK(
+        cudaStreamCreateWithPriority(&cuda_stream_, cudaStreamDefault, greatest_priority));
+  } else {
+    OF_CUDA_CHECK(cudaStreamCreate(&cuda_stream_));
+  }
   // cublas_handle
   OF_CUBLAS_CHECK(cublasCreate(&cublas_handle_));
   OF_CUBLAS_CHECK(cublasSetStream(cublas_handle_, cuda_stream_));
@@ -69,7 +69,7 @@ struct CudaLaunchConfig {
 class CudaStream : public Stream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CudaStream);
-  explicit CudaStream(CudaDevice* device);
+  explicit CudaStream(CudaDevice* device, StreamPriority priority = StreamPriority::kNormal);
   ~CudaStream() override;
 
   static constexpr uint32_t kDefaultBlockSize = 256;
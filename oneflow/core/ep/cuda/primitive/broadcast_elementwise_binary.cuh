@@ -309,6 +309,88 @@ void DispatchLaunch(Stream* stream, size_t num_src0_dims, const int64_t* src0_di
   }
 }
 
+template<size_t max_dims, typename IndexType>
+struct StridedElementwiseBinaryParams {
+  NdIndexOffsetHelper<IndexType, max_dims> index_helper;
+  size_t num_dims;
+  IndexType src0_strides[max_dims];
+  IndexType src1_strides[max_dims];
+  IndexType dst_strides[max_dims];
+  IndexType count{};
+  const void* src0{};
+  const void* src1{};
+  void* dst{};
+};
+
+template<BinaryOp binary_op, typename Src, typename Dst, size_t max_dims, typename IndexType>
+__global__ void StridedElementwiseBinaryGpu(
+    StridedElementwiseBinaryParams<max_dims, IndexType> params) {
+  const Src* src0 = reinterpret_cast<const Src*>(params.src0);
+  const Src* src1 = reinterpret_cast<const Src*>(params.src1);
+  Dst* dst = reinterpret_cast<Dst*>(params.dst);
+  BinaryFunctor<DeviceType::kCUDA, binary_op, Src, Dst> functor;
+  IndexType index[max_dims];
+  CUDA_1D_KERNEL_LOOP_T(IndexType, i, params.count) {
+    params.index_helper.OffsetToNdIndex(i, index, params.num_dims);
+    IndexType src0_offset = 0;
+    IndexType src1_offset = 0;
+    IndexType dst_offset = 0;
+#pragma unroll
+    for (int dim = 0; dim < max_dims; ++dim) {
+      if (dim < params.num_dims) {
+        src0_offset += index[dim] * params.src0_strides[dim];
+        src1_offset += index[dim] * params.src1_strides[dim];
+        dst_offset += index[dim] * params.dst_strides[dim];
+      }
+    }
+    dst[dst_offset] = functor(src0[src0_offset], src1[src1_offset]);
+  }
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst, size_t max_dims, typename IndexType>
+void LaunchStridedKernel(Stream* stream, const StridedDims& strided, const void* src0,
+                         const void* src1, void* dst) {
+  StridedElementwiseBinaryParams<max_dims, IndexType> params;
+  params.index_helper = NdIndexOffsetHelper<IndexType, max_dims>(strided.dims, strided.num_dims);
+  params.num_dims = strided.num_dims;
+  for (size_t i = 0; i < strided.num_dims; ++i) {
+    params.src0_strides[i] = strided.src0_strides[i];
+    params.src1_strides[i] = strided.src1_strides[i];
+    params.dst_strides[i] = strided.dst_strides[i];
+  }
+  params.count = strided.elem_cnt();
+  params.src0 = src0;
+  params.src1 = src1;
+  params.dst = dst;
+  StridedElementwiseBinaryGpu<binary_op, Src, Dst, max_dims, IndexType>
+      <<<BlocksNum4ThreadsNum(params.count), kCudaThreadsNumPerBlock, 0,
+         stream->As<CudaStream>()->cuda_stream()>>>(params);
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst>
+void LaunchStrided(Stream* stream, const StridedDims& strided, const void* src0, const void* src1,
+                   void* dst) {
+  // The largest offset reached in any of the tensors decides the index type.
+  int64_t max_offset = strided.elem_cnt();
+  const int64_t* all_strides[3] = {strided.src0_strides, strided.src1_strides, strided.dst_strides};
+  for (const int64_t* strides : all_strides) {
+    int64_t offset = 0;
+    for (size_t i = 0; i < strided.num_dims; ++i) { offset += (strided.dims[i] - 1) * strides[i]; }
+    max_offset = std::max(max_offset, offset);
+  }
+  if (max_offset < GetMaxVal<int32_t>()) {
+    if (strided.num_dims <= 4) {
+      LaunchStridedKernel<binary_op, Src, Dst, 4, int32_t>(stream, strided, src0, src1, dst);
+    } else {
+      LaunchStridedKernel<binary_op, Src, Dst, kMaxNumDims, int32_t>(stream, strided, src0, src1,
+                                                                     dst);
+    }
+  } else {
+    LaunchStridedKernel<binary_op, Src, Dst, kMaxNumDims, int64_t>(stream, strided, src0, src1,
+                                                                   dst);
+  }
+}
+
 template<typename T>
 T GetValue(Scalar value) {
   return value.Value<T>();
@@ -360,6 +442,19 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
         stream, num_src0_dims, src0_dims, reinterpret_cast<const Src*>(src0), num_src1_dims,
         src1_dims, reinterpret_cast<const Src*>(src1), reinterpret_cast<Dst*>(dst));
   }
+  void Launch(Stream* stream, size_t num_dims, const int64_t* dims, const int64_t* src0_strides,
+              const void* src0, const int64_t* src1_strides, const void* src1,
+              const int64_t* dst_strides, void* dst) override {
+    const StridedDims strided(num_dims, dims, src0_strides, src1_strides, dst_strides);
+    if (strided.elem_cnt() == 0) { return; }
+    int64_t src0_dims[kMaxNumDims];
+    int64_t src1_dims[kMaxNumDims];
+    if (strided.GetBroadcastDims(src0_dims, src1_dims)) {
+      Launch(stream, strided.num_dims, src0_dims, src0, strided.num_dims, src1_dims, src1, dst);
+      return;
+    }
+    LaunchStrided<binary_op, Src, Dst>(stream, strided, src0, src1, dst);
+  }
 };
 
 }  // namespace
@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/common/optional.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/cuda/primitive/cublas_lt_matmul.h"
 #include <cuda.h>
 
 namespace oneflow {
@@ -125,6 +126,22 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     UNIMPLEMENTED();
   }
   const int cublas_ldc = n;
+#if CUDA_VERSION >= 11040
+  const bool use_cublas_lt =
+      IsCublasLtMatmulEnabled() && IsCublasLtMatmulDataTypeSupported(data_type);
+  CublasLtMatmulProblem lt_problem{};
+  lt_problem.data_type = data_type;
+  lt_problem.trans_a = cublas_trans_a;
+  lt_problem.trans_b = cublas_trans_b;
+  lt_problem.m = cublas_m;
+  lt_problem.n = cublas_n;
+  lt_problem.k = cublas_k;
+  lt_problem.lda = cublas_lda;
+  lt_problem.ldb = cublas_ldb;
+  lt_problem.ldc = cublas_ldc;
+  lt_problem.batch_count = 1;
+  lt_problem.epilogue = CUBLASLT_EPILOGUE_DEFAULT;
+#endif  // CUDA_VERSION >= 11040
   CublasMathModeGuard guard(cuda_stream->cublas_handle());
   if (data_type == DataType::kFloat16) {
 #if CUDA_VERSION < 11000
@@ -152,6 +169,18 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     const long long int cublas_stride_a = b_batch_count == 1 ? 0 : cublas_m * cublas_k;
     const long long int cublas_stride_b = a_batch_count == 1 ? 0 : cublas_k * cublas_n;
     const long long int cublas_stride_c = cublas_m * cublas_n;
+#if CUDA_VERSION >= 11040
+    if (use_cublas_lt) {
+      lt_problem.batch_count = batch_count;
+      lt_problem.stride_a = cublas_stride_a;
+      lt_problem.stride_b = cublas_stride_b;
+      lt_problem.stride_c = cublas_stride_c;
+      if (LaunchCublasLtMatmul(cuda_stream, lt_problem, alpha, cublas_a, cublas_b, beta,
+                               cublas_c, nullptr)) {
+        return;
+      }
+    }
+#endif  // CUDA_VERSION >= 11040
     const auto sp_beta = GetCublasScalarParameter(beta, compute_type);
     OF_CUBLAS_CHECK(cublasGemmStridedBatchedEx(
         cuda_stream->cublas_handle(), cublas_trans_a, cublas_trans_b, cublas_m, cublas_n, cublas_k,
@@ -160,10 +189,17 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
         cublas_stride_c, batch_count, compute_type, algo));
   } else {
     auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
-      const auto sp_beta = GetCublasScalarParameter(batch_beta, compute_type);
       const void* cublas_a = batch_b;
       const void* cublas_b = batch_a;
       void* cublas_c = batch_c;
+#if CUDA_VERSION >= 11040
+      if (use_cublas_lt
+          && LaunchCublasLtMatmul(cuda_stream, lt_problem, alpha, cublas_a, cublas_b, batch_beta,
+                                  cublas_c, nullptr)) {
+        return;
+      }
+#endif  // CUDA_VERSION >= 11040
+      const auto sp_beta = GetCublasScalarParameter(batch_beta, compute_type);
       OF_CUBLAS_CHECK(cublasGemmEx(
           cuda_stream->cublas_handle(), cublas_trans_a, cublas_trans_b, cublas_m, cublas_n,
           cublas_k, &sp_alpha, cublas_a, cuda_data_type, cublas_lda, cublas_b, cuda_data_type,
@@ -54,6 +54,34 @@ void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params
       <<<BlocksNum4ThreadsNum(params.count), kCudaThreadsNumPerBlock, 0, cuda_stream>>>(params);
 }
 
+// Narrower pitched rows are left to CopyNdKernel, which keeps more bytes in flight for them.
+constexpr int64_t kMinMemcpy2DRowBytes = 512;
+
+bool TryLaunchMemcpy(Stream* stream, size_t movement_size, size_t num_dims, void* dst,
+                     const int64_t* dst_dims, const int64_t* dst_pos, const void* src,
+                     const int64_t* src_dims, const int64_t* src_pos, const int64_t* extent) {
+  cudaStream_t cuda_stream = stream->As<CudaStream>()->cuda_stream();
+  if (num_dims == 1) {
+    OF_CUDA_CHECK(cudaMemcpyAsync(
+        static_cast<char*>(dst) + dst_pos[0] * movement_size,
+        static_cast<const char*>(src) + src_pos[0] * movement_size, extent[0] * movement_size,
+        cudaMemcpyDefault, cuda_stream));
+    return true;
+  } else if (num_dims == 2) {
+    const int64_t row_bytes = extent[1] * movement_size;
+    if (row_bytes < kMinMemcpy2DRowBytes) { return false; }
+    const int64_t dst_pitch = dst_dims[1] * movement_size;
+    const int64_t src_pitch = src_dims[1] * movement_size;
+    OF_CUDA_CHECK(cudaMemcpy2DAsync(
+        static_cast<char*>(dst) + dst_pos[0] * dst_pitch + dst_pos[1] * movement_size, dst_pitch,
+        static_cast<const char*>(src) + src_pos[0] * src_pitch + src_pos[1] * movement_size,
+        src_pitch, row_bytes, extent[0], cudaMemcpyDefault, cuda_stream));
+    return true;
+  } else {
+    return false;
+  }
+}
+
 class CopyNdImpl : public CopyNd {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CopyNdImpl);
@@ -0,0 +1,328 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_CUDA
+
+#include "oneflow/core/ep/cuda/primitive/cublas_lt_matmul.h"
+#include "oneflow/core/ep/include/device.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#if CUDA_VERSION >= 11040
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+constexpr uint32_t kMaxCublasLtAlignment = 16;
+
+cudaDataType_t GetCudaDataType(DataType data_type) {
+  switch (data_type) {
+    case kFloat: return CUDA_R_32F;
+    case kDouble: return CUDA_R_64F;
+    case kFloat16: return CUDA_R_16F;
+    case kBFloat16: return CUDA_R_16BF;
+    case kInt8: return CUDA_R_8I;
+    case kInt32: return CUDA_R_32I;
+#if CUDA_VERSION >= 11080
+    case kFloat8E4M3: return CUDA_R_8F_E4M3;
+    case kFloat8E5M2: return CUDA_R_8F_E5M2;
+#endif  // CUDA_VERSION >= 11080
+    default: UNIMPLEMENTED(); return CUDA_R_32F;
+  }
+}
+
+bool IsTf32ExecutionEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EP_CUDA_ENABLE_TF32_EXECUTION", true);
+  return enabled;
+}
+
+cublasComputeType_t GetCublasComputeType(DataType data_type) {
+  switch (data_type) {
+    // Same as cublasGemmEx with the CUBLAS_TF32_TENSOR_OP_MATH mode set on the stream handle.
+    case kFloat:
+      return IsTf32ExecutionEnabled() ? CUBLAS_COMPUTE_32F_FAST_TF32 : CUBLAS_COMPUTE_32F;
+    case kDouble: return CUBLAS_COMPUTE_64F;
+    case kFloat16: return CUBLAS_COMPUTE_32F;
+    case kBFloat16: return CUBLAS_COMPUTE_32F;
+    case kInt8: return CUBLAS_COMPUTE_32I;
+    case kFloat8E4M3: return CUBLAS_COMPUTE_32F;
+    case kFloat8E5M2: return CUBLAS_COMPUTE_32F;
+    default: UNIMPLEMENTED(); return CUBLAS_COMPUTE_32F;
+  }
+}
+
+cudaDataType_t GetCublasScaleType(cublasComputeType_t compute_type) {
+  switch (compute_type) {
+    case CUBLAS_COMPUTE_64F: return CUDA_R_64F;
+    case CUBLAS_COMPUTE_32I: return CUDA_R_32I;
+    default: return CUDA_R_32F;
+  }
+}
+
+// The int8 matmul accumulates into an int32 C by default.
+DataType GetCDataType(const CublasLtMatmulProblem& problem) {
+  if (problem.c_data_type != kInvalidDataType) { return problem.c_data_type; }
+  return problem.data_type == kInt8 ? kInt32 : problem.data_type;
+}
+
+union CublasScalarParameter {
+  double d;
+  float s;
+  int32_t i;
+};
+
+CublasScalarParameter GetCublasScalarParameter(Scalar scalar, cudaDataType_t scale_type) {
+  CublasScalarParameter sp{};
+  if (scale_type == CUDA_R_64F) {
+    sp.d = scalar.Value<double>();
+  } else if (scale_type == CUDA_R_32I) {
+    sp.i = scalar.Value<int32_t>();
+  } else {
+    sp.s = scalar.Value<float>();
+  }
+  return sp;
+}
+
+uint32_t GetAlignment(const void* ptr) {
+  const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  uint32_t alignment = kMaxCublasLtAlignment;
+  while (alignment > 1 && address % alignment != 0) { alignment /= 2; }
+  return alignment;
+}
+
+struct CublasLtMatmulAlgoKey {
+  CublasLtMatmulProblem problem;
+  uint64_t workspace_size;
+  int32_t device_index;
+  uint32_t alignment_a;
+  uint32_t alignment_b;
+  uint32_t alignment_c;
+  uint32_t alignment_bias;
+};
+
+bool operator==(const CublasLtMatmulAlgoKey& lhs, const CublasLtMatmulAlgoKey& rhs) {
+  return std::memcmp(&lhs, &rhs, sizeof(CublasLtMatmulAlgoKey)) == 0;
+}
+
+// Keys are zero-filled before being set, so hashing and comparing the bytes is well defined.
+struct CublasLtMatmulAlgoKeyHash {
+  static_assert(std::is_pod<CublasLtMatmulAlgoKey>::value, "CublasLtMatmulAlgoKey is not POD");
+
+  size_t operator()(const CublasLtMatmulAlgoKey& key) const {
+    const auto* ptr = reinterpret_cast<const uint8_t*>(&key);
+    uint32_t value = 0x811C9DC5;
+    for (size_t i = 0; i < sizeof(CublasLtMatmulAlgoKey); ++i) {
+      value ^= ptr[i];
+      value *= 0x01000193;
+    }
+    return static_cast<size_t>(value);
+  }
+};
+
+struct CublasLtMatmulAlgoResult {
+  bool found;
+  cublasLtMatmulAlgo_t algo;
+};
+
+class CublasLtMatmulAlgoCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CublasLtMatmulAlgoCache);
+  CublasLtMatmulAlgoCache() = default;
+  ~CublasLtMatmulAlgoCache() = default;
+
+  static CublasLtMatmulAlgoCache* Get() {
+    static CublasLtMatmulAlgoCache cache;
+    return &cache;
+  }
+
+  CublasLtMatmulAlgoResult GetOrInfer(const CublasLtMatmulAlgoKey& key,
+                                      const std::function<CublasLtMatmulAlgoResult()>& Infer) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = key2result_.find(key);
+      if (it != key2result_.end()) { return it->second; }
+    }
+    // The heuristic only reads the descriptors, two threads racing on a new shape both run it
+    // and store the same result.
+    const CublasLtMatmulAlgoResult result = Infer();
+    std::lock_guard<std::mutex> lock(mutex_);
+    key2result_.emplace(key, result);
+    return result;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<CublasLtMatmulAlgoKey, CublasLtMatmulAlgoResult, CublasLtMatmulAlgoKeyHash>
+      key2result_;
+};
+
+class CublasLtMatmulDescriptors final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CublasLtMatmulDescriptors);
+  CublasLtMatmulDescriptors(const CublasLtMatmulProblem& problem, cublasComputeType_t compute_type,
+                            cudaDataType_t scale_type, const void* bias,
+                            const CublasLtMatmulScales* scales) {
+    const cudaDataType_t cuda_data_type = GetCudaDataType(problem.data_type);
+    OF_CUBLAS_CHECK(cublasLtMatmulDescCreate(&operation_desc_, compute_type, scale_type));
+    SetDescAttribute(CUBLASLT_MATMUL_DESC_TRANSA, problem.trans_a);
+    SetDescAttribute(CUBLASLT_MATMUL_DESC_TRANSB, problem.trans_b);
+    if (problem.epilogue != CUBLASLT_EPILOGUE_DEFAULT) {
+      SetDescAttribute(CUBLASLT_MATMUL_DESC_EPILOGUE, problem.epilogue);
+      SetDescAttribute(CUBLASLT_MATMUL_DESC_BIAS_POINTER, bias);
+    }
+#if CUDA_VERSION >= 11080
+    if (scales != nullptr) {
+      SetDescAttribute(CUBLASLT_MATMUL_DESC_A_SCALE_POINTER, scales->a_scale);
+      SetDescAttribute(CUBLASLT_MATMUL_DESC_B_SCALE_POINTER, scales->b_scale);
+    }
+    if (problem.fast_accumulation != 0) {
+      const int8_t fast_accumulation = 1;
+      SetDescAttribute(CUBLASLT_MATMUL_DESC_FAST_ACCUM, fast_accumulation);
+    }
+#else
+    CHECK(scales == nullptr) << "scaled cuBLASLt matmuls need CUDA 11.8";
+#endif  // CUDA_VERSION >= 11080
+    const bool a_trans = problem.trans_a != CUBLAS_OP_N;
+    const bool b_trans = problem.trans_b != CUBLAS_OP_N;
+    a_desc_ = CreateLayout(cuda_data_type, a_trans ? problem.k : problem.m,
+                           a_trans ? problem.m : problem.k, problem.lda, problem.batch_count,
+                           problem.stride_a);
+    b_desc_ = CreateLayout(cuda_data_type, b_trans ? problem.n : problem.k,
+                           b_trans ? problem.k : problem.n, problem.ldb, problem.batch_count,
+                           problem.stride_b);
+    c_desc_ = CreateLayout(GetCudaDataType(GetCDataType(problem)), problem.m, problem.n,
+                           problem.ldc, problem.batch_count, problem.stride_c);
+  }
+  ~CublasLtMatmulDescriptors() {
+    OF_CUBLAS_CHECK(cublasLtMatrixLayoutDestroy(c_desc_));
+    OF_CUBLAS_CHECK(cublasLtMatrixLayoutDestroy(b_desc_));
+    OF_CUBLAS_CHECK(cublasLtMatrixLayoutDestroy(a_desc_));
+    OF_CUBLAS_CHECK(cublasLtMatmulDescDestroy(operation_desc_));
+  }
+
+  cublasLtMatmulDesc_t operation_desc() const { return operation_desc_; }
+  cublasLtMatrixLayout_t a_desc() const { return a_desc_; }
+  cublasLtMatrixLayout_t b_desc() const { return b_desc_; }
+  cublasLtMatrixLayout_t c_desc() const { return c_desc_; }
+
+ private:
+  template<typename T>
+  void SetDescAttribute(cublasLtMatmulDescAttributes_t attr, const T& value) {
+    OF_CUBLAS_CHECK(cublasLtMatmulDescSetAttribute(operation_desc_, attr, &value, sizeof(value)));
+  }
+
+  static cublasLtMatrixLayout_t CreateLayout(cudaDataType_t data_type, int64_t rows, int64_t cols,
+                                             int64_t ld, int64_t batch_count, int64_t stride) {
+    cublasLtMatrixLayout_t layout{};
+    OF_CUBLAS_CHECK(cublasLtMatrixLayoutCreate(&layout, data_type, rows, cols, ld));
+    if (batch_count > 1) {
+      const int32_t batch_count_i32 = static_cast<int32_t>(batch_count);
+      OF_CUBLAS_CHECK(cublasLtMatrixLayoutSetAttribute(layout, CUBLASLT_MATRIX_LAYOUT_BATCH_COUNT,
+                                                       &batch_count_i32,
+                                                       sizeof(batch_count_i32)));
+      OF_CUBLAS_CHECK(cublasLtMatrixLayoutSetAttribute(
+          layout, CUBLASLT_MATRIX_LAYOUT_STRIDED_BATCH_OFFSET, &stride, sizeof(stride)));
+    }
+    return layout;
+  }
+
+  cublasLtMatmulDesc_t operation_desc_{};
+  cublasLtMatrixLayout_t a_desc_{};
+  cublasLtMatrixLayout_t b_desc_{};
+  cublasLtMatrixLayout_t c_desc_{};
+};
+
+CublasLtMatmulAlgoResult InferCublasLtMatmulAlgo(CudaStream* cuda_stream,
+                                                 const CublasLtMatmulDescriptors& descs,
+                                                 const CublasLtMatmulAlgoKey& key) {
+  cublasLtMatmulPreference_t preference{};
+  OF_CUBLAS_CHECK(cublasLtMatmulPreferenceCreate(&preference));
+  const auto SetPreference = [&](cublasLtMatmulPreferenceAttributes_t attr, const auto& value) {
+    OF_CUBLAS_CHECK(cublasLtMatmulPreferenceSetAttribute(preference, attr, &value, sizeof(value)));
+  };
+  SetPreference(CUBLASLT_MATMUL_PREF_MAX_WORKSPACE_BYTES, key.workspace_size);
+  SetPreference(CUBLASLT_MATMUL_PREF_MIN_ALIGNMENT_A_BYTES, key.alignment_a);
+  SetPreference(CUBLASLT_MATMUL_PREF_MIN_ALIGNMENT_B_BYTES, key.alignment_b);
+  SetPreference(CUBLASLT_MATMUL_PREF_MIN_ALIGNMENT_C_BYTES, key.alignment_c);
+  SetPreference(CUBLASLT_MATMUL_PREF_MIN_ALIGNMENT_D_BYTES, key.alignment_c);
+  cublasLtMatmulHeuristicResult_t heuristic_result{};
+  int num_results = 0;
+  const cublasStatus_t status = cublasLtMatmulAlgoGetHeuristic(
+      cuda_stream->cublas_lt_handle(), descs.operation_desc(), descs.a_desc(), descs.b_desc(),
+      descs.c_desc(), descs.c_desc(), preference, 1, &heuristic_result, &num_results);
+  OF_CUBLAS_CHECK(cublasLtMatmulPreferenceDestroy(preference));
+  CublasLtMatmulAlgoResult result{};
+  result.found = status == CUBLAS_STATUS_SUCCESS && num_results > 0
+                 && heuristic_result.state == CUBLAS_STATUS_SUCCESS;
+  if (result.found) { result.algo = heuristic_result.algo; }
+  return result;
+}
+
+}  // namespace
+
+bool IsCublasLtMatmulEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EP_CUDA_ENABLE_CUBLASLT_MATMUL", true);
+  return enabled;
+}
+
+bool IsCublasLtMatmulDataTypeSupported(DataType data_type) {
+  return data_type == kFloat || data_type == kDouble || data_type == kFloat16
+         || data_type == kBFloat16;
+}
+
+bool LaunchCublasLtMatmul(CudaStream* cuda_stream, const CublasLtMatmulProblem& problem,
+                          Scalar alpha, const void* a, const void* b, Scalar beta, void* c,
+                          const void* bias, const CublasLtMatmulScales* scales) {
+  const cublasComputeType_t compute_type = GetCublasComputeType(problem.data_type);
+  const cudaDataType_t scale_type = GetCublasScaleType(compute_type);
+  CublasLtMatmulDescriptors descs(problem, compute_type, scale_type, bias, scales);
+  CublasLtMatmulAlgoKey key;
+  std::memset(&key, 0, sizeof(key));
+  key.device_index = static_cast<int32_t>(cuda_stream->device()->device_index());
+  key.problem = problem;
+  key.workspace_size = cuda_stream->cublas_workspace_size();
+  key.alignment_a = GetAlignment(a);
+  key.alignment_b = GetAlignment(b);
+  key.alignment_c = GetAlignment(c);
+  key.alignment_bias = bias == nullptr ? kMaxCublasLtAlignment : GetAlignment(bias);
+  const CublasLtMatmulAlgoResult result = CublasLtMatmulAlgoCache::Get()->GetOrInfer(
+      key, [&]() { return InferCublasLtMatmulAlgo(cuda_stream, descs, key); });
+  if (!result.found) { return false; }
+  const auto sp_alpha = GetCublasScalarParameter(alpha, scale_type);
+  const auto sp_beta = GetCublasScalarParameter(beta, scale_type);
+  OF_CUBLAS_CHECK(cublasLtMatmul(cuda_stream->cublas_lt_handle(), descs.operation_desc(),
+                                 &sp_alpha, a, descs.a_desc(), b, descs.b_desc(), &sp_beta, c,
+                                 descs.c_desc(), c, descs.c_desc(), &result.algo,
+                                 cuda_stream->cublas_workspace(),
+                                 cuda_stream->cublas_workspace_size(), cuda_stream->cuda_stream()));
+  return true;
+}
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // CUDA_VERSION >= 11040
+
+#endif  // WITH_CUDA
@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CUDA_PRIMITIVE_CUBLAS_LT_MATMUL_H_
+#define ONEFLOW_CORE_EP_CUDA_PRIMITIVE_CUBLAS_LT_MATMUL_H_
+
+#ifdef WITH_CUDA
+
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/common/scalar.h"
+#include <cuda.h>
+
+// The bias and activation epilogues of cuBLASLt are usable from CUDA 11.4, the same bound as
+// cublas_fused_mlp.
+#if CUDA_VERSION >= 11040
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// A column-major, optionally strided batched matmul
+// D = epilogue(alpha * op(A) * op(B) + beta * C + bias) with D in place of C, in the terms
+// of cuBLAS. A batch stride of 0 broadcasts the operand over the batch. The fields are laid
+// out without padding since the struct is hashed byte-wise as part of the algo cache key. For
+// kInt8, A and B are int8 while C, alpha and beta are int32 unless c_data_type says otherwise.
+// The fp8 types need CUDA 11.8 and a Hopper GPU, their A and B are scaled by CublasLtMatmulScales.
+struct CublasLtMatmulProblem {
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  int64_t lda;
+  int64_t ldb;
+  int64_t ldc;
+  int64_t batch_count;
+  int64_t stride_a;
+  int64_t stride_b;
+  int64_t stride_c;
+  DataType data_type;
+  cublasOperation_t trans_a;
+  cublasOperation_t trans_b;
+  cublasLtEpilogue_t epilogue;
+  // Type of C and D, kInvalidDataType for the default of data_type.
+  DataType c_data_type;
+  // Non-zero lets fp8 matmuls skip the periodic promotion of partial sums to full precision.
+  int32_t fast_accumulation;
+};
+
+// Device pointers to the float factors A and B are multiplied with before the product, such as
+// the inverse of the scales they were quantized with.
+struct CublasLtMatmulScales {
+  const float* a_scale;
+  const float* b_scale;
+};
+
+// Whether BroadcastMatmul, and Matmul and BatchMatmul on top of it, go through cuBLASLt. On by
+// default, ONEFLOW_EP_CUDA_ENABLE_CUBLASLT_MATMUL=0 falls back to cublasGemmEx.
+bool IsCublasLtMatmulEnabled();
+
+bool IsCublasLtMatmulDataTypeSupported(DataType data_type);
+
+// Runs the problem with the workspace of the stream. The algorithm picked by the cuBLASLt
+// heuristic is cached per device, problem, workspace size and pointer alignment, so the
+// heuristic runs once per shape. Returns false without launching anything if cuBLASLt has no
+// algorithm for the problem, the caller is expected to fall back.
+bool LaunchCublasLtMatmul(CudaStream* cuda_stream, const CublasLtMatmulProblem& problem,
+                          Scalar alpha, const void* a, const void* b, Scalar beta, void* c,
+                          const void* bias, const CublasLtMatmulScales* scales = nullptr);
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // CUDA_VERSION >= 11040
+
+#endif  // WITH_CUDA
+
+#endif  // ONEFLOW_CORE_EP_CUDA_PRIMITIVE_CUBLAS_LT_MATMUL_H_
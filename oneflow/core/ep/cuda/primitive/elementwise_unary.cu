@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ep/common/primitive/elementwise_unary.h"
 #include "oneflow/core/ep/cuda/primitive/unary_functor.cuh"
+#include "oneflow/core/common/nd_index_offset_helper.h"
 
 namespace oneflow {
 
@@ -23,6 +24,153 @@ namespace primitive {
 
 namespace {
 
+using elementwise_unary::kMaxNumDims;
+using elementwise_unary::StridedDims;
+
+constexpr int32_t kTileSize = 32;
+constexpr int32_t kBlockRows = 8;
+
+template<size_t max_dims, typename IndexType>
+struct StridedUnaryParams {
+  NdIndexOffsetHelper<IndexType, max_dims> index_helper;
+  size_t num_dims;
+  IndexType src_strides[max_dims];
+  IndexType dst_strides[max_dims];
+  IndexType count{};
+  const void* src{};
+  void* dst{};
+};
+
+template<UnaryOp unary_op, typename Src, typename Dst, size_t max_dims, typename IndexType>
+__global__ void StridedUnaryGpu(StridedUnaryParams<max_dims, IndexType> params) {
+  UnaryFunctor<DeviceType::kCUDA, unary_op, Dst, Src> functor;
+  const Src* src = reinterpret_cast<const Src*>(params.src);
+  Dst* dst = reinterpret_cast<Dst*>(params.dst);
+  IndexType index[max_dims];
+  CUDA_1D_KERNEL_LOOP_T(IndexType, i, params.count) {
+    params.index_helper.OffsetToNdIndex(i, index, params.num_dims);
+    IndexType src_offset = 0;
+    IndexType dst_offset = 0;
+#pragma unroll
+    for (int dim = 0; dim < max_dims; ++dim) {
+      if (dim < params.num_dims) {
+        src_offset += index[dim] * params.src_strides[dim];
+        dst_offset += index[dim] * params.dst_strides[dim];
+      }
+    }
+    dst[dst_offset] = functor(src[src_offset]);
+  }
+}
+
+// dst[b][r][c] = f(src[b * src_batch_stride + r + c * src_col_stride]). The source is read along
+// the rows and the destination is written along the cols through a shared memory tile, so both
+// are coalesced.
+// refer from https://developer.nvidia.com/blog/efficient-matrix-transpose-cuda-cc/
+template<UnaryOp unary_op, typename Src, typename Dst, typename IndexType>
+__global__ void TransposedUnaryGpu(IndexType batch, IndexType rows, IndexType cols, const Src* src,
+                                   IndexType src_batch_stride, IndexType src_col_stride, Dst* dst,
+                                   IndexType dst_batch_stride, IndexType dst_row_stride) {
+  using Storage = typename std::aligned_storage<sizeof(Src), alignof(Src)>::type;
+  __shared__ Storage tile[kTileSize][kTileSize + 1];  // To avoid bank conflict.
+  UnaryFunctor<DeviceType::kCUDA, unary_op, Dst, Src> functor;
+  const IndexType num_tile_rows = (rows + kTileSize - 1) / kTileSize;
+  const IndexType num_tile_cols = (cols + kTileSize - 1) / kTileSize;
+  const IndexType batch_num_tiles = num_tile_rows * num_tile_cols;
+  for (IndexType i = blockIdx.x, step = gridDim.x; i < batch * batch_num_tiles; i += step) {
+    const IndexType batch_index = i / batch_num_tiles;
+    const IndexType tile_index = i - batch_index * batch_num_tiles;
+    const IndexType row_begin = (tile_index / num_tile_cols) * kTileSize;
+    const IndexType col_begin = (tile_index - (tile_index / num_tile_cols) * num_tile_cols)
+                                * kTileSize;
+    const Src* batch_src = src + batch_index * src_batch_stride;
+    Dst* batch_dst = dst + batch_index * dst_batch_stride;
+    {
+      const IndexType row = row_begin + threadIdx.x;
+#pragma unroll
+      for (IndexType col_in_tile = threadIdx.y; col_in_tile < kTileSize;
+           col_in_tile += kBlockRows) {
+        const IndexType col = col_begin + col_in_tile;
+        if (row < rows && col < cols) {
+          *reinterpret_cast<Src*>(&tile[col_in_tile][threadIdx.x]) =
+              batch_src[row + col * src_col_stride];
+        }
+      }
+    }
+    __syncthreads();
+    {
+      const IndexType col = col_begin + threadIdx.x;
+#pragma unroll
+      for (IndexType row_in_tile = threadIdx.y; row_in_tile < kTileSize;
+           row_in_tile += kBlockRows) {
+        const IndexType row = row_begin + row_in_tile;
+        if (row < rows && col < cols) {
+          batch_dst[row * dst_row_stride + col] =
+              functor(*reinterpret_cast<const Src*>(&tile[threadIdx.x][row_in_tile]));
+        }
+      }
+    }
+    __syncthreads();
+  }
+}
+
+template<UnaryOp unary_op, typename Src, typename Dst, typename IndexType>
+void LaunchTransposed(CudaStream* cuda_stream, const StridedDims& strided, const Src* src,
+                      Dst* dst) {
+  const bool has_batch = strided.num_dims == 3;
+  const IndexType batch = has_batch ? strided.dims[0] : 1;
+  const IndexType rows = strided.dims[strided.num_dims - 2];
+  const IndexType cols = strided.dims[strided.num_dims - 1];
+  const int64_t num_tiles =
+      batch * ((rows + kTileSize - 1) / kTileSize) * ((cols + kTileSize - 1) / kTileSize);
+  const int32_t num_blocks = std::min<int64_t>(num_tiles, kCudaMaxBlocksNum);
+  TransposedUnaryGpu<unary_op, Src, Dst, IndexType>
+      <<<num_blocks, dim3(kTileSize, kBlockRows), 0, cuda_stream->cuda_stream()>>>(
+          batch, rows, cols, src, has_batch ? strided.src_strides[0] : 0,
+          strided.src_strides[strided.num_dims - 1], dst, has_batch ? strided.dst_strides[0] : 0,
+          strided.dst_strides[strided.num_dims - 2]);
+}
+
+template<UnaryOp unary_op, typename Src, typename Dst, size_t max_dims, typename IndexType>
+void LaunchStrided(CudaStream* cuda_stream, const StridedDims& strided, const Src* src,
+                   Dst* dst) {
+  StridedUnaryParams<max_dims, IndexType> params;
+  params.index_helper = NdIndexOffsetHelper<IndexType, max_dims>(strided.dims, strided.num_dims);
+  params.num_dims = strided.num_dims;
+  for (size_t i = 0; i < strided.num_dims; ++i) {
+    params.src_strides[i] = strided.src_strides[i];
+    params.dst_strides[i] = strided.dst_strides[i];
+  }
+  params.count = strided.elem_cnt();
+  params.src = src;
+  params.dst = dst;
+  StridedUnaryGpu<unary_op, Src, Dst, max_dims, IndexType>
+      <<<BlocksNum4ThreadsNum(params.count), kCudaThreadsNumPerBlock, 0,
+         cuda_stream->cuda_stream()>>>(params);
+}
+
+// The largest offset reached in any of the tensors, which decides the index type.
+inline int64_t GetMaxOffset(const StridedDims& strided) {
+  int64_t src_max_offset = 0;
+  int64_t dst_max_offset = 0;
+  for (size_t i = 0; i < strided.num_dims; ++i) {
+    src_max_offset += (strided.dims[i] - 1) * strided.src_strides[i];
+    dst_max_offset += (strided.dims[i] - 1) * strided.dst_strides[i];
+  }
+  return std::max(std::max(src_max_offset, dst_max_offset), strided.elem_cnt());
+}
+
+template<UnaryOp unary_op, typename Src, typename Dst, typename IndexType>
+void DispatchNumDims(CudaStream* cuda_stream, const StridedDims& strided, const Src* src,
+                     Dst* dst) {
+  if (strided.IsTransposed()) {
+    LaunchTransposed<unary_op, Src, Dst, IndexType>(cuda_stream, strided, src, dst);
+  } else if (strided.num_dims <= 4) {
+    LaunchStrided<unary_op, Src, Dst, 4, IndexType>(cuda_stream, strided, src, dst);
+  } else {
+    LaunchStrided<unary_op, Src, Dst, kMaxNumDims, IndexType>(cuda_stream, strided, src, dst);
+  }
+}
+
 template<UnaryOp unary_op, typename Src, typename Dst>
 class ElementwiseUnaryImpl : public ElementwiseUnary {
  public:
@@ -38,6 +186,25 @@ class ElementwiseUnaryImpl : public ElementwiseUnary {
             reinterpret_cast<Dst*>(dst), reinterpret_cast<const Src*>(src),
             cuda_stream->cuda_stream())));
   }
+
+  void Launch(Stream* stream, size_t num_dims, const int64_t* dims, const int64_t* src_strides,
+              const void* src, const int64_t* dst_strides, void* dst) override {
+    const StridedDims strided(num_dims, dims, src_strides, dst_strides);
+    if (strided.IsContiguous()) {
+      Launch(stream, src, dst, strided.elem_cnt());
+      return;
+    }
+    auto* cuda_stream = stream->As<CudaStream>();
+    if (GetMaxOffset(strided) < GetMaxVal<int32_t>()) {
+      DispatchNumDims<unary_op, Src, Dst, int32_t>(cuda_stream, strided,
+                                                   reinterpret_cast<const Src*>(src),
+                                                   reinterpret_cast<Dst*>(dst));
+    } else {
+      DispatchNumDims<unary_op, Src, Dst, int64_t>(cuda_stream, strided,
+                                                   reinterpret_cast<const Src*>(src),
+                                                   reinterpret_cast<Dst*>(dst));
+    }
+  }
 };
 
 template<UnaryOp unary_op, typename Src, typename Dst>
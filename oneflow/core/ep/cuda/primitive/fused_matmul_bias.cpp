@@ -0,0 +1,121 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_CUDA
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+#include "oneflow/core/ep/include/primitive/fused_matmul_bias.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/cuda/primitive/cublas_lt_matmul.h"
+#include <cuda.h>
+
+#if CUDA_VERSION >= 11040
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+cublasOperation_t GetCublasOperation(BlasTransposeType transpose_type) {
+  if (transpose_type == BlasTransposeType::N) {
+    return CUBLAS_OP_N;
+  } else if (transpose_type == BlasTransposeType::T) {
+    return CUBLAS_OP_T;
+  } else {
+    UNIMPLEMENTED();
+    return CUBLAS_OP_N;
+  }
+}
+
+cublasLtEpilogue_t GetCublasLtEpilogue(MatmulEpilogue epilogue) {
+  switch (epilogue) {
+    case MatmulEpilogue::kBias: return CUBLASLT_EPILOGUE_BIAS;
+    case MatmulEpilogue::kBiasRelu: return CUBLASLT_EPILOGUE_RELU_BIAS;
+    case MatmulEpilogue::kBiasGelu: return CUBLASLT_EPILOGUE_GELU_BIAS;
+    default: UNIMPLEMENTED(); return CUBLASLT_EPILOGUE_DEFAULT;
+  }
+}
+
+class FusedMatmulBiasImpl : public FusedMatmulBias {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FusedMatmulBiasImpl);
+  FusedMatmulBiasImpl(DataType data_type, BlasTransposeType transpose_a,
+                      BlasTransposeType transpose_b, MatmulEpilogue epilogue)
+      : data_type_(data_type),
+        transpose_a_(transpose_a),
+        transpose_b_(transpose_b),
+        epilogue_(epilogue) {}
+  ~FusedMatmulBiasImpl() override = default;
+
+  void Launch(Stream* stream, size_t m, size_t n, size_t k, Scalar alpha, const void* a,
+              const void* b, const void* bias, Scalar beta, void* c) override {
+    // Row-major c = a * b is computed as the column-major c^T = b^T * a^T, the bias then runs
+    // along the rows of c^T as cuBLASLt expects.
+    CublasLtMatmulProblem problem{};
+    problem.data_type = data_type_;
+    problem.trans_a = GetCublasOperation(transpose_b_);
+    problem.trans_b = GetCublasOperation(transpose_a_);
+    problem.m = n;
+    problem.n = m;
+    problem.k = k;
+    problem.lda = transpose_b_ == BlasTransposeType::N ? n : k;
+    problem.ldb = transpose_a_ == BlasTransposeType::N ? k : m;
+    problem.ldc = n;
+    problem.batch_count = 1;
+    problem.epilogue = GetCublasLtEpilogue(epilogue_);
+    CHECK(LaunchCublasLtMatmul(stream->As<CudaStream>(), problem, alpha, b, a, beta, c, bias))
+        << "cuBLASLt has no algorithm for the fused matmul (m=" << m << ", n=" << n
+        << ", k=" << k << ")";
+  }
+
+ private:
+  DataType data_type_;
+  BlasTransposeType transpose_a_;
+  BlasTransposeType transpose_b_;
+  MatmulEpilogue epilogue_;
+};
+
+class FusedMatmulBiasFactoryImpl : public FusedMatmulBiasFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FusedMatmulBiasFactoryImpl);
+  FusedMatmulBiasFactoryImpl() = default;
+  ~FusedMatmulBiasFactoryImpl() override = default;
+
+  std::unique_ptr<FusedMatmulBias> New(DataType data_type, BlasTransposeType transpose_a,
+                                       BlasTransposeType transpose_b,
+                                       MatmulEpilogue epilogue) override {
+    // The bias epilogues of cuBLASLt do not support double.
+    if (data_type != DataType::kFloat && data_type != DataType::kFloat16
+        && data_type != DataType::kBFloat16) {
+      return nullptr;
+    }
+    return std::make_unique<FusedMatmulBiasImpl>(data_type, transpose_a, transpose_b, epilogue);
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCUDA, FusedMatmulBiasFactory, FusedMatmulBiasFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // CUDA_VERSION >= 11040
+
+#endif  // WITH_CUDA
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/ep/cuda/primitive/type_seq.h"
 #include "oneflow/core/cuda/softmax.cuh"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/cuda/cuda_kernel_tuner.h"
 
 namespace oneflow {
 
@@ -32,11 +33,30 @@ enum class Algorithm {
 };
 
 template<Algorithm algorithm, typename T>
-void SoftmaxGpu(cudaStream_t cuda_stream, size_t rows, size_t cols, const T* x, T* y) {
+void SoftmaxGpu(CudaStream* stream, DataType data_type, size_t rows, size_t cols, const T* x,
+                T* y) {
   using ComputeType = typename cuda::softmax::DefaultComputeType<T>::type;
+  cudaStream_t cuda_stream = stream->cuda_stream();
   oneflow::cuda::softmax::DirectLoad<T, ComputeType> load(x, cols);
   oneflow::cuda::softmax::DirectStore<ComputeType, T> store(y, cols);
-  if (algorithm == Algorithm::kSoftmax) {
+  constexpr cuda::softmax::Algorithm cuda_algorithm = algorithm == Algorithm::kSoftmax
+                                                          ? cuda::softmax::Algorithm::kSoftmax
+                                                          : cuda::softmax::Algorithm::kLogSoftmax;
+  const auto TryLaunch = [&](int32_t impl) -> bool {
+    bool success = false;
+    OF_CUDA_CHECK((cuda::softmax::TryDispatchSoftmaxImpl<decltype(load), decltype(store),
+                                                         ComputeType, cuda_algorithm>(
+        cuda_stream, load, store, rows, cols, static_cast<cuda::softmax::SoftmaxImpl>(impl),
+        &success)));
+    return success;
+  };
+  const int32_t impl = CudaKernelTuner::Get()->Tune(
+      stream, algorithm == Algorithm::kSoftmax ? "softmax" : "log_softmax",
+      DataType_Name(data_type) + "_" + std::to_string(rows) + "x" + std::to_string(cols),
+      cuda::softmax::kNumSoftmaxImpls, TryLaunch);
+  if (impl >= 0) {
+    CHECK(TryLaunch(impl));
+  } else if (algorithm == Algorithm::kSoftmax) {
     OF_CUDA_CHECK((cuda::softmax::DispatchSoftmax<decltype(load), decltype(store), ComputeType>(
         cuda_stream, load, store, rows, cols)));
   } else if (algorithm == Algorithm::kLogSoftmax) {
@@ -51,19 +71,21 @@ template<typename SoftmaxBase, Algorithm algorithm, typename T>
 class SoftmaxImpl : public SoftmaxBase {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SoftmaxImpl);
-  SoftmaxImpl() = default;
+  explicit SoftmaxImpl(DataType data_type) : data_type_(data_type) {}
   ~SoftmaxImpl() override = default;
 
   void Launch(Stream* stream, size_t rows, size_t cols, const void* x, void* y) override {
-    cudaStream_t cuda_stream = stream->As<CudaStream>()->cuda_stream();
-    SoftmaxGpu<algorithm, T>(cuda_stream, rows, cols, reinterpret_cast<const T*>(x),
-                             reinterpret_cast<T*>(y));
+    SoftmaxGpu<algorithm, T>(stream->As<CudaStream>(), data_type_, rows, cols,
+                             reinterpret_cast<const T*>(x), reinterpret_cast<T*>(y));
   }
+
+ private:
+  DataType data_type_;
 };
 
 template<typename SoftmaxBase, Algorithm algorithm, typename T>
-std::unique_ptr<SoftmaxBase> NewSoftmax() {
-  return std::unique_ptr<SoftmaxBase>(new SoftmaxImpl<SoftmaxBase, algorithm, T>());
+std::unique_ptr<SoftmaxBase> NewSoftmax(DataType data_type) {
+  return std::unique_ptr<SoftmaxBase>(new SoftmaxImpl<SoftmaxBase, algorithm, T>(data_type));
 }
 
 template<typename FactoryBase, typename SoftmaxBase, Algorithm algorithm>
@@ -77,7 +99,7 @@ class GenericSoftmaxFactoryImpl : public FactoryBase {
 #define MAKE_NEW_SOFTMAX_ENTRY(type_cpp, type_proto) \
   {type_proto, NewSoftmax<SoftmaxBase, algorithm, type_cpp>},
 
-    static const std::map<DataType, std::function<std::unique_ptr<SoftmaxBase>()>>
+    static const std::map<DataType, std::function<std::unique_ptr<SoftmaxBase>(DataType)>>
         new_softmax_handle{
             OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_ENTRY, CUDA_PRIMITIVE_FLOATING_TYPE_SEQ)};
 
@@ -85,7 +107,7 @@ class GenericSoftmaxFactoryImpl : public FactoryBase {
 
     const auto it = new_softmax_handle.find(data_type);
     if (it != new_softmax_handle.end()) {
-      return it->second();
+      return it->second(data_type);
     } else {
       return nullptr;
     }
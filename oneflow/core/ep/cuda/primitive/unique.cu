@@ -0,0 +1,107 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/unique.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/unique.cuh"
+#include "oneflow/core/common/data_type_seq.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+cuda::unique::Flag GetFlag(bool with_inverse_indices, bool with_counts) {
+  cuda::unique::Flag flag = cuda::unique::kDefault;
+  if (with_inverse_indices) { flag |= cuda::unique::kOutputInverseIndices; }
+  if (with_counts) { flag |= cuda::unique::kOutputCounts; }
+  return flag;
+}
+
+// Sorts the keys with a radix sort and run-length encodes them, so unique_out is in ascending
+// order.
+template<typename K, typename I>
+class UniqueImpl : public Unique {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueImpl);
+  UniqueImpl() = default;
+  ~UniqueImpl() override = default;
+
+  size_t GetWorkspaceSizeInBytes(size_t n, bool with_counts) override {
+    // with the inverse indices, which need the larger workspace whether requested or not
+    size_t workspace_size = 0;
+    OF_CUDA_CHECK(
+        (cuda::unique::GetWorkspaceSize<K, I>(GetFlag(true, with_counts), n, &workspace_size)));
+    return workspace_size;
+  }
+
+  void Launch(Stream* stream, size_t n, const void* in, void* num_unique, void* unique_out,
+              void* inverse_indices, void* counts, void* workspace,
+              size_t workspace_size) override {
+    cudaStream_t cuda_stream = stream->As<CudaStream>()->cuda_stream();
+    if (n == 0) {
+      // Nothing to sort, the sort would launch an empty grid.
+      OF_CUDA_CHECK(cudaMemsetAsync(num_unique, 0, sizeof(I), cuda_stream));
+      return;
+    }
+    OF_CUDA_CHECK((cuda::unique::Launch<K, I>(
+        GetFlag(inverse_indices != nullptr, counts != nullptr), n, reinterpret_cast<const K*>(in),
+        reinterpret_cast<K*>(unique_out), reinterpret_cast<I*>(num_unique),
+        reinterpret_cast<I*>(inverse_indices), reinterpret_cast<I*>(counts), workspace,
+        workspace_size, cuda_stream)));
+  }
+};
+
+template<typename K, typename I>
+std::unique_ptr<Unique> NewUnique() {
+  return std::unique_ptr<Unique>(new UniqueImpl<K, I>());
+}
+
+class UniqueFactoryImpl : public UniqueFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueFactoryImpl);
+  UniqueFactoryImpl() = default;
+  ~UniqueFactoryImpl() override = default;
+
+  std::unique_ptr<Unique> New(DataType key_type, DataType index_type) override {
+#define MAKE_NEW_UNIQUE_ENTRY(key_pair, index_pair)                            \
+  {std::make_pair(OF_PP_PAIR_SECOND(key_pair), OF_PP_PAIR_SECOND(index_pair)), \
+   NewUnique<OF_PP_PAIR_FIRST(key_pair), OF_PP_PAIR_FIRST(index_pair)>},
+
+    static const std::map<std::pair<DataType, DataType>, std::function<std::unique_ptr<Unique>()>>
+        new_unique_handle{OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+            MAKE_NEW_UNIQUE_ENTRY, ARITHMETIC_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ)};
+
+#undef MAKE_NEW_UNIQUE_ENTRY
+
+    const auto it = new_unique_handle.find(std::make_pair(key_type, index_type));
+    if (it != new_unique_handle.end()) {
+      return it->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCUDA, UniqueFactory, UniqueFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
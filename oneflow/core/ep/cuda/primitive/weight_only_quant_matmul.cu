@@ -0,0 +1,218 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/weight_only_quant_matmul.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/ep/include/primitive/fused_matmul_bias.h"
+#include "oneflow/core/ep/cuda/primitive/type_seq.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+// Up to this many rows of a share one read of the weight in the gemv kernel, larger m dequantize
+// the weight into the workspace and run a regular GEMM.
+constexpr int kMaxGemvRows = 8;
+constexpr int kGemvBlockSize = 256;
+
+template<typename T>
+__device__ __forceinline__ T WarpAllReduceSum(T val) {
+  for (int mask = kCudaWarpSize / 2; mask > 0; mask /= 2) {
+    val += __shfl_xor_sync(0xffffffff, val, mask);
+  }
+  return val;
+}
+
+template<int num_bits>
+__device__ __forceinline__ int UnpackQuantizedValue(int8_t packed, int v) {
+  if (num_bits == 8) { return packed; }
+  return v == 0 ? (static_cast<int8_t>(packed << 4) >> 4) : (packed >> 4);
+}
+
+// One warp for each output column. The lanes walk the packed weight row pack_bytes at a time, so
+// a warp reads 32 * pack_bytes contiguous bytes per step, and dequantize in registers.
+template<typename T, int num_bits, int pack_bytes>
+__global__ void WeightOnlyQuantGemvGpu(int64_t m, int64_t n, int64_t k, int64_t group_size,
+                                       const T* a, const int8_t* b, const T* scales,
+                                       const T* bias, T* c) {
+  constexpr int kValuesPerByte = 8 / num_bits;
+  const int64_t row_bytes = k / kValuesPerByte;
+  const int64_t num_groups = k / group_size;
+  const int lane = threadIdx.x % kCudaWarpSize;
+  const int64_t num_warps = static_cast<int64_t>(gridDim.x) * blockDim.x / kCudaWarpSize;
+  for (int64_t j = (static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kCudaWarpSize;
+       j < n; j += num_warps) {
+    const int8_t* b_row = b + j * row_bytes;
+    const T* scale_row = scales + j * num_groups;
+    float acc[kMaxGemvRows];
+#pragma unroll
+    for (int r = 0; r < kMaxGemvRows; ++r) { acc[r] = 0; }
+    for (int64_t byte = lane * pack_bytes; byte < row_bytes;
+         byte += kCudaWarpSize * pack_bytes) {
+      int8_t packed[pack_bytes];
+      if (pack_bytes == 4) {
+        *reinterpret_cast<int32_t*>(packed) = *reinterpret_cast<const int32_t*>(b_row + byte);
+      } else {
+        packed[0] = b_row[byte];
+      }
+#pragma unroll
+      for (int p = 0; p < pack_bytes; ++p) {
+#pragma unroll
+        for (int v = 0; v < kValuesPerByte; ++v) {
+          const int64_t l = (byte + p) * kValuesPerByte + v;
+          const float w = static_cast<float>(UnpackQuantizedValue<num_bits>(packed[p], v))
+                          * static_cast<float>(scale_row[l / group_size]);
+#pragma unroll
+          for (int r = 0; r < kMaxGemvRows; ++r) {
+            if (r < m) { acc[r] += static_cast<float>(a[r * k + l]) * w; }
+          }
+        }
+      }
+    }
+#pragma unroll
+    for (int r = 0; r < kMaxGemvRows; ++r) {
+      if (r < m) {
+        const float sum = WarpAllReduceSum(acc[r]);
+        if (lane == 0) {
+          c[r * n + j] =
+              static_cast<T>(bias == nullptr ? sum : sum + static_cast<float>(bias[j]));
+        }
+      }
+    }
+  }
+}
+
+template<typename T, int num_bits>
+__global__ void DequantizeWeightGpu(int64_t elem_cnt, int64_t k, int64_t group_size,
+                                    const int8_t* b, const T* scales, T* weight) {
+  constexpr int kValuesPerByte = 8 / num_bits;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t j = i / k;
+    const int64_t l = i - j * k;
+    const int q = UnpackQuantizedValue<num_bits>(b[i / kValuesPerByte],
+                                                 static_cast<int>(i % kValuesPerByte));
+    weight[i] = static_cast<T>(static_cast<float>(q)
+                               * static_cast<float>(scales[j * (k / group_size) + l / group_size]));
+  }
+}
+
+template<typename T, int num_bits>
+class WeightOnlyQuantMatmulImpl : public WeightOnlyQuantMatmul {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmulImpl);
+  explicit WeightOnlyQuantMatmulImpl(DataType data_type)
+      : matmul_(NewPrimitive<MatmulFactory>(DeviceType::kCUDA, data_type, BlasTransposeType::N,
+                                            BlasTransposeType::T)),
+        matmul_bias_(NewPrimitive<FusedMatmulBiasFactory>(DeviceType::kCUDA, data_type,
+                                                          BlasTransposeType::N,
+                                                          BlasTransposeType::T,
+                                                          MatmulEpilogue::kBias)) {}
+  ~WeightOnlyQuantMatmulImpl() override = default;
+
+  size_t GetWorkspaceSizeInBytes(size_t m, size_t n, size_t k) override {
+    if (m <= kMaxGemvRows) { return 0; }
+    return GetCudaAlignedSize(n * k * sizeof(T));
+  }
+
+  void Launch(Stream* stream, size_t m, size_t n, size_t k, size_t group_size, const void* a,
+              const void* b, const void* scales, const void* bias, void* c, void* workspace,
+              size_t workspace_size) override {
+    if (m == 0 || n == 0) { return; }
+    const T* a_ptr = reinterpret_cast<const T*>(a);
+    const int8_t* b_ptr = reinterpret_cast<const int8_t*>(b);
+    const T* scales_ptr = reinterpret_cast<const T*>(scales);
+    const T* bias_ptr = reinterpret_cast<const T*>(bias);
+    T* c_ptr = reinterpret_cast<T*>(c);
+    if (m > kMaxGemvRows) {
+      CHECK_GE(workspace_size, GetWorkspaceSizeInBytes(m, n, k));
+      T* weight = reinterpret_cast<T*>(workspace);
+      const int64_t elem_cnt = n * k;
+      RUN_CUDA_KERNEL((DequantizeWeightGpu<T, num_bits>), stream, elem_cnt, elem_cnt, k,
+                      group_size, b_ptr, scales_ptr, weight);
+      if (bias == nullptr) {
+        CHECK(matmul_);
+        matmul_->Launch(stream, m, n, k, 1.0, a, weight, 0.0, c);
+      } else {
+        CHECK(matmul_bias_);
+        matmul_bias_->Launch(stream, m, n, k, 1.0, a, weight, bias, 0.0, c);
+      }
+      return;
+    }
+    const int64_t num_blocks = std::min<int64_t>(
+        (n * kCudaWarpSize + kGemvBlockSize - 1) / kGemvBlockSize, kCudaMaxBlocksNum);
+    const cudaStream_t cuda_stream = stream->As<CudaStream>()->cuda_stream();
+    const int64_t row_bytes = k * num_bits / 8;
+    if (row_bytes % 4 == 0 && reinterpret_cast<uintptr_t>(b) % 4 == 0) {
+      WeightOnlyQuantGemvGpu<T, num_bits, 4><<<num_blocks, kGemvBlockSize, 0, cuda_stream>>>(
+          m, n, k, group_size, a_ptr, b_ptr, scales_ptr, bias_ptr, c_ptr);
+    } else {
+      WeightOnlyQuantGemvGpu<T, num_bits, 1><<<num_blocks, kGemvBlockSize, 0, cuda_stream>>>(
+          m, n, k, group_size, a_ptr, b_ptr, scales_ptr, bias_ptr, c_ptr);
+    }
+  }
+
+ private:
+  std::unique_ptr<Matmul> matmul_;
+  std::unique_ptr<FusedMatmulBias> matmul_bias_;
+};
+
+template<typename T, int num_bits>
+std::unique_ptr<WeightOnlyQuantMatmul> NewWeightOnlyQuantMatmul(DataType data_type) {
+  return std::unique_ptr<WeightOnlyQuantMatmul>(
+      new WeightOnlyQuantMatmulImpl<T, num_bits>(data_type));
+}
+
+class WeightOnlyQuantMatmulFactoryImpl : public WeightOnlyQuantMatmulFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmulFactoryImpl);
+  WeightOnlyQuantMatmulFactoryImpl() = default;
+  ~WeightOnlyQuantMatmulFactoryImpl() override = default;
+
+  std::unique_ptr<WeightOnlyQuantMatmul> New(DataType data_type, int num_bits) override {
+#define MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY(type_pair, num_bits) \
+  {std::make_pair(OF_PP_PAIR_SECOND(type_pair), num_bits),           \
+   NewWeightOnlyQuantMatmul<OF_PP_PAIR_FIRST(type_pair), num_bits>},
+
+    static const std::map<std::pair<DataType, int>,
+                          std::function<std::unique_ptr<WeightOnlyQuantMatmul>(DataType)>>
+        new_weight_only_quant_matmul_handle{OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
+            MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY,
+            CUDA_PRIMITIVE_FLOAT_TYPE_SEQ CUDA_PRIMITIVE_FLOAT16_TYPE_SEQ, (4)(8))};
+
+#undef MAKE_NEW_WEIGHT_ONLY_QUANT_MATMUL_ENTRY
+
+    const auto it = new_weight_only_quant_matmul_handle.find(std::make_pair(data_type, num_bits));
+    if (it != new_weight_only_quant_matmul_handle.end()) {
+      return it->second(data_type);
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCUDA, WeightOnlyQuantMatmulFactory,
+                           WeightOnlyQuantMatmulFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
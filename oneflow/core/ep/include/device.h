@@ -42,7 +42,7 @@ class Device {
   virtual size_t device_index() const = 0;
   virtual DeviceManager* device_manager() const = 0;
 
-  virtual Stream* CreateStream() = 0;
+  virtual Stream* CreateStream(StreamPriority priority = StreamPriority::kNormal) = 0;
   virtual void DestroyStream(Stream* stream) = 0;
 
   virtual Event* CreateEvent();
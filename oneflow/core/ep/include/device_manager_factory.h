@@ -26,6 +26,12 @@ namespace ep {
 
 class DeviceManagerRegistry;
 
+// Entry point of an ep backend. A backend registers one factory for its DeviceType with
+// DeviceManagerRegistry::RegisterDeviceManagerFactory at static initialization, and registers its
+// primitives with REGISTER_PRIMITIVE_FACTORY under the same DeviceType. The DeviceManager it
+// creates reports zero devices rather than failing when the runtime finds none, and its Device
+// provides streams, events and memory; ep/common/device_conformance_test.cpp checks that contract
+// for every registered backend.
 class DeviceManagerFactory {
  public:
   OF_DISALLOW_COPY_AND_MOVE(DeviceManagerFactory);
@@ -38,6 +38,8 @@ class DeviceManagerRegistry {
   static void DumpVersionInfo();
   static std::string GetDeviceTypeNameByDeviceType(DeviceType device_type);
   static DeviceType GetDeviceTypeByDeviceTypeName(const std::string& device_type_name);
+  static bool IsDeviceTypeRegistered(DeviceType device_type);
+  static std::vector<DeviceType> GetRegisteredDeviceTypes();
 
  private:
   class Impl;
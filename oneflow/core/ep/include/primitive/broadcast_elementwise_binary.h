@@ -38,6 +38,10 @@ class BroadcastElementwiseBinary : public Primitive {
                       const void* src1, void* dst) = 0;
   virtual void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims,
                       const void* src0, Scalar src1, void* dst) = 0;
+  // Strides are in elements, the sources are broadcast along the dims where their strides are 0.
+  virtual void Launch(Stream* stream, size_t num_dims, const int64_t* dims,
+                      const int64_t* src0_strides, const void* src0, const int64_t* src1_strides,
+                      const void* src1, const int64_t* dst_strides, void* dst) = 0;
 };
 
 class BroadcastElementwiseBinaryFactory : public Factory<BroadcastElementwiseBinary> {
@@ -31,6 +31,10 @@ class ElementwiseUnary : public Primitive {
   ~ElementwiseUnary() override = default;
 
   virtual void Launch(Stream* stream, const void* src, void* dst, size_t count) = 0;
+  // Strides are in elements. `dst` must not overlap `src` unless they have the same strides.
+  virtual void Launch(Stream* stream, size_t num_dims, const int64_t* dims,
+                      const int64_t* src_strides, const void* src, const int64_t* dst_strides,
+                      void* dst) = 0;
 };
 
 class ElementwiseUnaryFactory : public Factory<ElementwiseUnary> {
@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_PRIMITIVE_FUSED_MATMUL_BIAS_H_
+#define ONEFLOW_CORE_EP_PRIMITIVE_FUSED_MATMUL_BIAS_H_
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+#include "oneflow/core/ep/include/primitive/blas.h"
+#include "oneflow/core/common/scalar.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+enum class MatmulEpilogue {
+  kBias = 0,
+  kBiasRelu,
+  // Tanh approximation of gelu.
+  kBiasGelu,
+};
+
+// c = epilogue(alpha * op(a) * op(b) + beta * c + bias), where bias is a vector of n elements
+// broadcast along the rows of the m x n matrix c.
+class FusedMatmulBias : public Primitive {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FusedMatmulBias);
+  FusedMatmulBias() = default;
+  ~FusedMatmulBias() override = default;
+
+  virtual void Launch(Stream* stream, size_t m, size_t n, size_t k, Scalar alpha, const void* a,
+                      const void* b, const void* bias, Scalar beta, void* c) = 0;
+};
+
+class FusedMatmulBiasFactory : public Factory<FusedMatmulBias> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FusedMatmulBiasFactory);
+  FusedMatmulBiasFactory() = default;
+  ~FusedMatmulBiasFactory() override = default;
+
+  virtual std::unique_ptr<FusedMatmulBias> New(DataType data_type, BlasTransposeType transpose_a,
+                                               BlasTransposeType transpose_b,
+                                               MatmulEpilogue epilogue) = 0;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_PRIMITIVE_FUSED_MATMUL_BIAS_H_
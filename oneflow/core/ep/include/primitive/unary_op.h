@@ -22,6 +22,7 @@ namespace ep {
 namespace primitive {
 
 enum class UnaryOp {
+  kIdentity,
   kRelu,
   kGelu,
   kTanh,
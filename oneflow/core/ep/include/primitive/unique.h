@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_PRIMITIVE_UNIQUE_H_
+#define ONEFLOW_CORE_EP_PRIMITIVE_UNIQUE_H_
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// Deduplicates n keys. num_unique receives the number of distinct keys, unique_out the distinct
+// keys, inverse_indices the position in unique_out of every input key and counts the number of
+// occurrences of every distinct key. inverse_indices and counts may be nullptr when not needed.
+// The order of unique_out is implementation defined.
+class Unique : public Primitive {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Unique);
+  Unique() = default;
+  ~Unique() override = default;
+
+  virtual size_t GetWorkspaceSizeInBytes(size_t n, bool with_counts) = 0;
+  virtual void Launch(Stream* stream, size_t n, const void* in, void* num_unique,
+                      void* unique_out, void* inverse_indices, void* counts, void* workspace,
+                      size_t workspace_size) = 0;
+};
+
+class UniqueFactory : public Factory<Unique> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueFactory);
+  UniqueFactory() = default;
+  ~UniqueFactory() override = default;
+
+  virtual std::unique_ptr<Unique> New(DataType key_type, DataType index_type) = 0;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_PRIMITIVE_UNIQUE_H_
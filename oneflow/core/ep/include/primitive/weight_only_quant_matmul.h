@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_PRIMITIVE_WEIGHT_ONLY_QUANT_MATMUL_H_
+#define ONEFLOW_CORE_EP_PRIMITIVE_WEIGHT_ONLY_QUANT_MATMUL_H_
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// c = a * dequantize(b)^T + bias, with a an m x k matrix and b an n x k weight quantized
+// symmetrically along k in groups of group_size, that is b[j][l] = q[j][l] * scales[j][l / g].
+// With 8 bits q is int8 of [n, k]. With 4 bits two signed values are packed per byte, the even l
+// in the low nibble, so q is [n, k / 2]. scales is [n, k / group_size] of the data type of a,
+// bias of n elements may be nullptr. k must be a multiple of group_size, and of 2 with 4 bits.
+// Implementations are meant for the small m of decoding, where reading the weight dominates, and
+// may use a workspace for larger m.
+class WeightOnlyQuantMatmul : public Primitive {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmul);
+  WeightOnlyQuantMatmul() = default;
+  ~WeightOnlyQuantMatmul() override = default;
+
+  virtual size_t GetWorkspaceSizeInBytes(size_t m, size_t n, size_t k) = 0;
+  virtual void Launch(Stream* stream, size_t m, size_t n, size_t k, size_t group_size,
+                      const void* a, const void* b, const void* scales, const void* bias, void* c,
+                      void* workspace, size_t workspace_size) = 0;
+};
+
+class WeightOnlyQuantMatmulFactory : public Factory<WeightOnlyQuantMatmul> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WeightOnlyQuantMatmulFactory);
+  WeightOnlyQuantMatmulFactory() = default;
+  ~WeightOnlyQuantMatmulFactory() override = default;
+
+  virtual std::unique_ptr<WeightOnlyQuantMatmul> New(DataType data_type, int num_bits) = 0;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_PRIMITIVE_WEIGHT_ONLY_QUANT_MATMUL_H_
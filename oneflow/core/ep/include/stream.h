@@ -27,6 +27,12 @@ namespace ep {
 
 class Device;
 
+// Devices without stream priorities treat every stream as kNormal.
+enum class StreamPriority {
+  kNormal,
+  kHigh,
+};
+
 class Stream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Stream);
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <mutex>
+#include <unordered_map>
 #include "oneflow/core/framework/attr_map.h"
 #include "oneflow/core/framework/attr_value.h"
 #include "oneflow/core/framework/attr_value_accessor.h"
@@ -34,6 +36,102 @@ size_t HashAttrName2AttrValWrapper(const oneflow::AttrName2AttrValWrapper& attr_
   return hash_value;
 }
 
+bool AttrName2AttrValEqual(const AttrName2AttrVal& lhs, const AttrName2AttrVal& rhs) {
+  if (lhs.size() != rhs.size()) { return false; }
+  for (auto lhs_iter = lhs.begin(), rhs_iter = rhs.begin(); lhs_iter != lhs.end();
+       ++lhs_iter, ++rhs_iter) {
+    if (lhs_iter->first != rhs_iter->first) { return false; }
+    if (*lhs_iter->second != *rhs_iter->second) { return false; }
+  }
+  return true;
+}
+
+// Attr maps are interned in a table sharded by hash, so that all the live attr maps with equal
+// attrs share one storage and compare by pointer. The table holds weak references, the storage
+// unregisters itself once the last AttrMap referring to it is gone, which keeps attrs that change
+// every step (learning rates, random seeds) from accumulating.
+//
+// AttrMaps are built on every eager op call, so each thread looks up a thread local copy of the
+// table first. Attrs seen before by the thread are found without taking a lock.
+class AttrName2AttrValInternTable final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AttrName2AttrValInternTable);
+  AttrName2AttrValInternTable() = default;
+  ~AttrName2AttrValInternTable() = default;
+
+  std::shared_ptr<const AttrName2AttrVal> GetOrCreate(
+      const std::shared_ptr<const AttrName2AttrVal>& attrs, size_t hash_value) {
+    // Expired entries of attrs that change every step are only dropped on a clear.
+    static constexpr size_t kMaxThreadLocalEntries = 4096;
+    thread_local std::unordered_multimap<size_t, std::weak_ptr<const AttrName2AttrVal>>
+        thread_local_entries;
+    const auto& range = thread_local_entries.equal_range(hash_value);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      auto candidate = iter->second.lock();
+      if (candidate && AttrName2AttrValEqual(*candidate, *attrs)) { return candidate; }
+    }
+    auto interned = SharedGetOrCreate(attrs, hash_value);
+    if (thread_local_entries.size() >= kMaxThreadLocalEntries) { thread_local_entries.clear(); }
+    thread_local_entries.emplace(hash_value, interned);
+    return interned;
+  }
+
+ private:
+  std::shared_ptr<const AttrName2AttrVal> SharedGetOrCreate(
+      const std::shared_ptr<const AttrName2AttrVal>& attrs, size_t hash_value) {
+    // Candidates are released after the lock, dropping the last reference runs the deleter which
+    // takes the lock again.
+    std::vector<std::shared_ptr<const AttrName2AttrVal>> candidates;
+    auto* shard = MutShard(hash_value);
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& range = shard->entries.equal_range(hash_value);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      candidates.emplace_back(iter->second.second.lock());
+      const auto& candidate = candidates.back();
+      if (candidate && AttrName2AttrValEqual(*candidate, *attrs)) { return candidate; }
+    }
+    // The storage keeps the passed attrs alive and aliases it, only the deleter is new.
+    const AttrName2AttrVal* ptr = attrs.get();
+    std::shared_ptr<const AttrName2AttrVal> interned(
+        ptr, [this, attrs, hash_value](const AttrName2AttrVal* raw) { Erase(raw, hash_value); });
+    shard->entries.emplace(hash_value, std::make_pair(ptr, interned));
+    return interned;
+  }
+
+  using Entry = std::pair<const AttrName2AttrVal*, std::weak_ptr<const AttrName2AttrVal>>;
+
+  static constexpr size_t kNumShards = 64;
+
+  struct Shard final {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, Entry> entries;
+  };
+
+  Shard* MutShard(size_t hash_value) {
+    return &shards_[(hash_value ^ (hash_value >> 17) ^ (hash_value >> 31)) % kNumShards];
+  }
+
+  void Erase(const AttrName2AttrVal* ptr, size_t hash_value) {
+    auto* shard = MutShard(hash_value);
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto& range = shard->entries.equal_range(hash_value);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      if (iter->second.first == ptr) {
+        shard->entries.erase(iter);
+        return;
+      }
+    }
+  }
+
+  Shard shards_[kNumShards];
+};
+
+AttrName2AttrValInternTable* GlobalAttrName2AttrValInternTable() {
+  // Never destructed, attr maps of static storage may be released after it.
+  static auto* table = new AttrName2AttrValInternTable();
+  return table;
+}
+
 const AttrName2AttrValWrapper& EmptyAttrName2AttrVal() {
   static const auto empty = std::make_shared<AttrName2AttrVal>();
   static const AttrName2AttrValWrapper empty_symbol(empty);
@@ -46,16 +144,12 @@ AttrName2AttrValWrapper::AttrName2AttrValWrapper(
     const std::shared_ptr<const AttrName2AttrVal>& attrs)
     : attrs_(attrs) {
   hash_value_ = HashAttrName2AttrValWrapper(*this);
+  attrs_ = GlobalAttrName2AttrValInternTable()->GetOrCreate(attrs_, hash_value_);
 }
 
 bool AttrName2AttrValWrapper::operator==(const AttrName2AttrValWrapper& other) const {
-  if (this->size() != other.size()) { return false; }
-  for (const_iterator this_iter = this->begin(), that_iter = other.begin();
-       this_iter != this->end(); ++this_iter, ++that_iter) {
-    if (this_iter->first != that_iter->first) { return false; }
-    if (*this_iter->second != *that_iter->second) { return false; }
-  }
-  return true;
+  // Interned, equal attrs share one storage.
+  return attrs_ == other.attrs_;
 }
 
 AttrMap::AttrMap() : attrs_(EmptyAttrName2AttrVal()) {}
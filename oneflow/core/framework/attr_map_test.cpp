@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <thread>
 #include "gtest/gtest.h"
 #include "oneflow/core/framework/attr_map.h"
 #include "oneflow/core/framework/attr_value.h"
@@ -83,5 +84,36 @@ TEST(AttrMap, hash_map) {
   ASSERT_EQ(attr_map2int_value.at(AttrMap(mut_attr_map)), 4);
 }
 
+TEST(AttrMap, interned) {
+  MutableAttrMap mut_attr_map{};
+  CHECK_JUST(mut_attr_map.SetAttr<int32_t>("zero", 0));
+  CHECK_JUST(mut_attr_map.SetAttr<std::vector<int64_t>>("ones", std::vector<int64_t>{1}));
+  MutableAttrMap other_mut_attr_map{};
+  CHECK_JUST(other_mut_attr_map.SetAttr<std::vector<int64_t>>("ones", std::vector<int64_t>{1}));
+  CHECK_JUST(other_mut_attr_map.SetAttr<int32_t>("zero", 0));
+  const AttrMap attr_map(mut_attr_map);
+  const AttrMap other_attr_map(other_mut_attr_map);
+  ASSERT_TRUE(attr_map == other_attr_map);
+  ASSERT_EQ(&*attr_map.begin(), &*other_attr_map.begin());
+  CHECK_JUST(other_mut_attr_map.SetAttr<int32_t>("zero", 1));
+  const AttrMap changed_attr_map(other_mut_attr_map);
+  ASSERT_FALSE(attr_map == changed_attr_map);
+  ASSERT_NE(&*attr_map.begin(), &*changed_attr_map.begin());
+}
+
+TEST(AttrMap, interned_across_threads) {
+  MutableAttrMap mut_attr_map{};
+  CHECK_JUST(mut_attr_map.SetAttr<int32_t>("axis", 1));
+  // Seen by this thread before the other thread builds it, then again from the thread local table.
+  const AttrMap attr_map(mut_attr_map);
+  const AttrMap same_thread_attr_map(mut_attr_map);
+  ASSERT_EQ(&*attr_map.begin(), &*same_thread_attr_map.begin());
+  std::unique_ptr<AttrMap> other_thread_attr_map;
+  std::thread thread([&]() { other_thread_attr_map.reset(new AttrMap(mut_attr_map)); });
+  thread.join();
+  ASSERT_TRUE(attr_map == *other_thread_attr_map);
+  ASSERT_EQ(&*attr_map.begin(), &*other_thread_attr_map->begin());
+}
+
 }  // namespace test
 }  // namespace oneflow
@@ -0,0 +1,121 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/batched_consistency_check.h"
+#include "oneflow/core/framework/transport_util.h"
+#include "oneflow/core/job/rank_group_scope.h"
+#include "oneflow/core/common/constant.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct ConsistencyDigest {
+  uint64_t digest;
+  uint64_t num_checks;
+};
+
+struct PendingDigestCheck {
+  ConsistencyDigest local;
+  ConsistencyDigest remote;
+  std::shared_ptr<AsyncTransportCtx> ctx;
+};
+
+struct BatchedConsistencyCheckState {
+  ConsistencyDigest digest{0, 0};
+  std::shared_ptr<PendingDigestCheck> pending;
+};
+
+BatchedConsistencyCheckState* MutThreadLocalBatchedConsistencyCheckState() {
+  static thread_local BatchedConsistencyCheckState state;
+  return &state;
+}
+
+int64_t ConsistencyCheckBatchSize() {
+  static const int64_t batch_size = ParseIntegerFromEnv("ONEFLOW_CONSISTENCY_CHECK_BATCH_SIZE", 1);
+  return batch_size;
+}
+
+Maybe<void> WaitPendingDigestCheck(BatchedConsistencyCheckState* state) {
+  if (!state->pending) { return Maybe<void>::Ok(); }
+  const std::shared_ptr<PendingDigestCheck> pending = std::move(state->pending);
+  JUST_MSG(pending->ctx->WaitDone(), kAsymmetricCodeErrorMsg);
+  CHECK_EQ_OR_RETURN(pending->remote.num_checks, pending->local.num_checks)
+      << "Each rank must run the same number of consistent ops";
+  CHECK_EQ_OR_RETURN(pending->remote.digest, pending->local.digest)
+      << "Each rank must run the same consistent ops with the same placement, sbp and tensor "
+         "meta, found a mismatch within the last "
+      << pending->local.num_checks << " checked ops";
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> LaunchDigestCheck(BatchedConsistencyCheckState* state) {
+  JUST(WaitPendingDigestCheck(state));
+  const auto& pending = std::make_shared<PendingDigestCheck>();
+  pending->local = state->digest;
+  state->digest = ConsistencyDigest{0, 0};
+  const auto& rank_group = JUST(RankGroupScope::RootRankGroup());
+  const auto& transport_token =
+      JUST(TransportToken::NewTransportToken(kTransportTokenTypeCheckTensorConsistency));
+  // The buffers are owned by pending, which owns the ctx.
+  PendingDigestCheck* raw_pending = pending.get();
+  pending->ctx = std::make_shared<NaiveAsyncTransportCtx>(
+      transport_token,
+      [raw_pending](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = &raw_pending->local;
+        *size = sizeof(ConsistencyDigest);
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      },
+      [raw_pending](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = &raw_pending->remote;
+        *size = sizeof(ConsistencyDigest);
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      });
+  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, pending->ctx.get()));
+  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, pending->ctx.get()));
+  state->pending = pending;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+Maybe<bool> IsConsistencyCheckBatched() {
+  if (ConsistencyCheckBatchSize() <= 1) { return false; }
+  return JUST(RankGroupScope::CurrentRankGroup()) == JUST(RankGroupScope::RootRankGroup());
+}
+
+Maybe<void> FoldIntoConsistencyDigest(std::initializer_list<uint64_t> synced_ids) {
+  auto* state = MutThreadLocalBatchedConsistencyCheckState();
+  size_t digest = state->digest.digest;
+  HashCombine(&digest, synced_ids.size());
+  for (uint64_t synced_id : synced_ids) { HashCombine(&digest, std::hash<uint64_t>()(synced_id)); }
+  state->digest.digest = digest;
+  state->digest.num_checks += 1;
+  if (state->digest.num_checks >= ConsistencyCheckBatchSize()) { JUST(LaunchDigestCheck(state)); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> FlushBatchedConsistencyChecks() {
+  if (ConsistencyCheckBatchSize() <= 1) { return Maybe<void>::Ok(); }
+  auto* state = MutThreadLocalBatchedConsistencyCheckState();
+  if (state->digest.num_checks > 0) { JUST(LaunchDigestCheck(state)); }
+  JUST(WaitPendingDigestCheck(state));
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_BATCHED_CONSISTENCY_CHECK_H_
+#define ONEFLOW_CORE_FRAMEWORK_BATCHED_CONSISTENCY_CHECK_H_
+
+#include <initializer_list>
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+// With ONEFLOW_CONSISTENCY_CHECK_BATCH_SIZE = N > 1, the meta consistency checks of eager
+// consistent ops run in the root rank group do not do a round trip per op. Instead the synced ids
+// each of them would have sent are folded into a digest of the current thread, and every N checks
+// the digest is sent through the rank ring. The comparison of a batch is awaited when the next
+// batch is sent or at a sync point, so an inconsistency is reported at most 2N ops late.
+
+// Returns false if the checks of the current rank group are done right away.
+Maybe<bool> IsConsistencyCheckBatched();
+
+Maybe<void> FoldIntoConsistencyDigest(std::initializer_list<uint64_t> synced_ids);
+
+// Compares the digests of all the checks folded so far.
+Maybe<void> FlushBatchedConsistencyChecks();
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_BATCHED_CONSISTENCY_CHECK_H_
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/intrusive/flat_msg.h"
 #include "oneflow/core/job/rank_group.h"
 #include "oneflow/core/framework/transport_util.h"
+#include "oneflow/core/framework/batched_consistency_check.h"
 #include "oneflow/core/job/rank_group_scope.h"
 #include "oneflow/core/framework/synced_symbol_map.h"
 #include "oneflow/core/framework/sync_symbol_nd_sbp.h"
@@ -187,6 +188,19 @@ namespace {
 Maybe<void> MetaInfoConsistencyCheckUtil(const Symbol<ParallelDesc>& placement,
                                          const Optional<Symbol<NdSbp>>& nd_sbp,
                                          const Optional<Symbol<NdSbp>>& grad_nd_sbp) {
+  if (JUST(IsConsistencyCheckBatched())) {
+    const auto& flat_meta_info_consistency =
+        JUST(FlatMetaInfoConsistency::New(placement, nd_sbp, grad_nd_sbp));
+    JUST(FoldIntoConsistencyDigest(
+        {flat_meta_info_consistency->placement_symbol_id(),
+         flat_meta_info_consistency->has_nd_sbp_symbol_id()
+             ? flat_meta_info_consistency->nd_sbp_symbol_id() + 1
+             : 0,
+         flat_meta_info_consistency->has_grad_nd_sbp_symbol_id()
+             ? flat_meta_info_consistency->grad_nd_sbp_symbol_id() + 1
+             : 0}));
+    return Maybe<void>::Ok();
+  }
   const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
   const auto& transport_token =
       JUST(TransportToken::NewTransportToken(kTransportTokenTypeCheckRankGroupConsistency));
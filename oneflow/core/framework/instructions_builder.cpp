@@ -31,6 +31,7 @@ limitations under the License.
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/decorator.h"
 #include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/cross_thread_obj_pool.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/vm/no_arg_cb_phy_instr_operand.h"
 #include "oneflow/core/vm/access_blob_arg_cb_phy_instr_operand.h"
@@ -68,7 +69,7 @@ static constexpr auto* GetCriticalSectionStream =
 template<typename PhyInstrOperandT>
 Maybe<void> InstructionsBuilder::MakeCriticalSectionBegin(
     const std::shared_ptr<PhyInstrOperandT>& phy_instr_operand) {
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), "CriticalSectionBegin",
       std::shared_ptr<const ParallelDesc>(), phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
@@ -78,7 +79,7 @@ Maybe<void> InstructionsBuilder::MakeCriticalSectionBegin(
 template<typename PhyInstrOperandT>
 Maybe<void> InstructionsBuilder::MakeCriticalSectionEnd(
     const std::shared_ptr<PhyInstrOperandT>& phy_instr_operand) {
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), "CriticalSectionEnd",
       std::shared_ptr<const ParallelDesc>(), phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
@@ -163,8 +164,10 @@ Maybe<void> InstructionsBuilder::LaunchLazyJob(const one::EagerBlobObjectListPtr
     }
     {
       const auto& phy_instr_operand =
-          std::make_shared<vm::LaunchLazyJobPhyInstrOperand>(nn_graph, parameters);
-      auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+          vm::IsNNGraphInputZeroCopyEnabled()
+              ? std::make_shared<vm::LaunchLazyJobPhyInstrOperand>(nn_graph, parameters, inputs)
+              : std::make_shared<vm::LaunchLazyJobPhyInstrOperand>(nn_graph, parameters);
+      auto instruction = vm::NewInstructionMsg(
           Global<VirtualMachine>::Get()->mut_vm(), "LaunchLazyJob",
           std::shared_ptr<const ParallelDesc>(), phy_instr_operand);
       instruction_list_->EmplaceBack(std::move(instruction));
@@ -358,7 +361,7 @@ Maybe<void> InstructionsBuilder::LocalCallOpKernel(
       ctx, *one::CurrentDevVmDepObjectConsumeMode()));
   const auto& instruction_name = JUST(StreamRoleSwitch<GetCallInstructionName>(
       stream->stream_role(), stream->device()->enum_type()));
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), instruction_name, parallel_desc_sym,
       phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
@@ -396,11 +399,11 @@ Maybe<void> InstructionsBuilder::ReleaseTensor(
     stream = producer_stream;
   }
   const auto& phy_instr_operand =
-      std::make_shared<vm::ReleaseTensorArgPhyInstrOperand>(eager_blob_object, stream);
+      obj_pool::make_shared<vm::ReleaseTensorArgPhyInstrOperand>(eager_blob_object, stream);
   DeviceType device_type = producer_stream->device()->enum_type();
   const auto& instruction_name = JUST(
       StreamRoleSwitch<GetReleaseInstructionName>(producer_stream->stream_role(), device_type));
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), instruction_name, parallel_desc, phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
   return Maybe<void>::Ok();
@@ -442,7 +445,7 @@ Maybe<void> InstructionsBuilder::SoftSyncStream(
   const auto& parallel_desc = JUST(Placement4Device(stream->device())).shared_from_symbol();
   const auto& phy_instr_operand = std::make_shared<vm::ConsumeLocalDepObjectPhyInstrOperand>(
       std::move(compute_local_dep_objects), modifier);
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), parallel_desc->device_tag() + ".RecordEvent",
       parallel_desc, phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
@@ -486,7 +489,7 @@ Maybe<void> InstructionsBuilder::TensorView(const T input_tensor, const T view_t
   const auto& phy_instr_operand =
       std::make_shared<vm::TensorViewOperand>(eager_blob_object, view_eager_blob_object);
   // prepare instruction
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), parallel_desc->device_tag() + ".TensorView",
       parallel_desc, phy_instr_operand);
   // assign the data pointer to output view blob
@@ -558,7 +561,7 @@ Maybe<void> InstructionsBuilder::AccessBlobByCallback(const T tensor,
   const std::shared_ptr<vm::EagerBlobObject>& eager_blob_object = JUST(tensor->eager_blob_object());
   const auto& phy_instr_operand =
       std::make_shared<vm::AccessBlobArgCbPhyInstrOperand>(eager_blob_object, callback, modifier);
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(),
       parallel_desc->device_tag() + ".AccessBlobByCallback", parallel_desc, phy_instr_operand);
   instruction_list_->EmplaceBack(std::move(instruction));
@@ -576,7 +579,7 @@ template Maybe<void> InstructionsBuilder::AccessBlobByCallback(
 Maybe<void> InstructionsBuilder::ComputeRankFrontSeqCallback(
     const std::function<void()>& callback) {
   const auto& phy_instr_operand = std::make_shared<vm::NoArgCbPhyInstrOperand>(callback);
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), "ComputeRankFrontSeqCallback",
       std::shared_ptr<const ParallelDesc>(), phy_instr_operand);
   instruction_list_->PushBack(instruction.Mutable());
@@ -585,7 +588,7 @@ Maybe<void> InstructionsBuilder::ComputeRankFrontSeqCallback(
 
 Maybe<void> InstructionsBuilder::ComputeGlobalFrontSeqBarrier() {
   const auto& phy_instr_operand = std::make_shared<vm::NoArgCbPhyInstrOperand>([] {});
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       Global<VirtualMachine>::Get()->mut_vm(), "ComputeGlobalFrontSeqBarrier",
       std::shared_ptr<const ParallelDesc>(), phy_instr_operand);
   instruction_list_->PushBack(instruction.Mutable());
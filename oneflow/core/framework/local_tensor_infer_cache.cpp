@@ -0,0 +1,99 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_impl.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/user/kernels/stateful_local_opkernel.h"
+
+namespace oneflow {
+namespace one {
+
+size_t LocalTensorMetaInferArgs::hash_value() const {
+  size_t hash_value = std::hash<AttrMap>()(attrs_);
+  HashCombine(&hash_value, std::hash<Symbol<Device>>()(default_device_));
+  for (const auto& tensor_meta : input_tensor_metas_) {
+    HashCombine(&hash_value, tensor_meta.CalcHashValue());
+  }
+  return hash_value;
+}
+
+bool LocalTensorMetaInferArgs::operator==(const LocalTensorMetaInferArgs& other) const {
+  return this->attrs_ == other.attrs_ && this->default_device_ == other.default_device_
+         && this->input_tensor_metas_ == other.input_tensor_metas_;
+}
+
+Maybe<void> LocalTensorMetaInferArgs::Init(const AttrMap& attrs, Symbol<Device> default_device,
+                                           const TensorTuple& input_tensors) {
+  attrs_ = attrs;
+  default_device_ = default_device;
+  input_tensor_metas_.clear();
+  input_tensor_metas_.reserve(input_tensors.size());
+  for (int i = 0; i < input_tensors.size(); ++i) {
+    auto* tensor_impl = JUST(input_tensors.at(i)->mut_eager_mirrored_tensor_impl());
+    input_tensor_metas_.emplace_back(*tensor_impl->mut_tensor_meta());
+  }
+  return Maybe<void>::Ok();
+}
+
+LocalTensorInferResult::LocalTensorInferResult(size_t output_size) {
+  output_tensor_metas_.reserve(output_size);
+  for (int i = 0; i < output_size; ++i) {
+    output_tensor_metas_.emplace_back(std::make_shared<Shape>(), DataType::kInvalidDataType);
+  }
+}
+
+/* static */ Maybe<const LocalTensorInferResult> LocalTensorInferCache::Infer(
+    const UserOpExpr& user_op_expr, const LocalTensorMetaInferArgs& infer_args) {
+  CHECK_OR_RETURN(!user_op_expr.has_device_and_stream_infer_fn());
+  auto result = std::make_shared<LocalTensorInferResult>(user_op_expr.output_size());
+  const auto& stream = GetDefaultStreamByDevice(infer_args.default_device());
+  result->set_stream(stream);
+  const auto& device_tag = JUST(stream->device()->of_type());
+  auto* output_tensor_metas = result->mut_output_tensor_metas();
+  JUST(user_op_expr.InferPhysicalShapeAndDType(
+      infer_args.attrs(), device_tag,
+      [&](int32_t i) -> const TensorMeta* { return &infer_args.input_tensor_metas().at(i); },
+      [&](int32_t i) -> TensorMeta* { return &output_tensor_metas->at(i); }));
+  result->set_kernel(JUST(user_op_expr.MutKernel4Stream(stream)));
+  return std::shared_ptr<const LocalTensorInferResult>(result);
+}
+
+Maybe<const LocalTensorInferResult> LocalTensorInferCache::GetOrInfer(
+    const LocalTensorMetaInferArgs& infer_args) {
+  static const size_t kMaxCacheSize =
+      ParseIntegerFromEnv("ONEFLOW_EAGER_LOCAL_TENSOR_INFER_CACHE_SIZE", 128);
+  auto iter = cache_.find(infer_args);
+  if (iter == cache_.end()) {
+    const auto& user_op_expr = user_op_expr_.lock();
+    CHECK_OR_RETURN(static_cast<bool>(user_op_expr));
+    const auto& result = JUST(Infer(*user_op_expr, infer_args));
+    // Ops called with ever changing shapes would grow the cache without bound.
+    if (cache_.size() >= kMaxCacheSize) { cache_.clear(); }
+    iter = cache_.emplace(infer_args, result).first;
+  }
+  return iter->second;
+}
+
+bool LocalTensorInferCacheEnabled() {
+  static const bool enabled =
+      ParseBooleanFromEnv("ONEFLOW_EAGER_ENABLE_LOCAL_TENSOR_INFER_CACHE", true);
+  return enabled;
+}
+
+}  // namespace one
+}  // namespace oneflow
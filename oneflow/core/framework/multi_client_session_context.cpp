@@ -125,21 +125,32 @@ Maybe<void> MultiClientSessionContext::UpdateResource(const Resource& reso_proto
 
 Maybe<void> MultiClientSessionContext::AddCGraph(
     const std::shared_ptr<oneflow::NNGraph>& c_graph_ptr) {
+  std::lock_guard<std::mutex> lock(graphs_mutex_);
   graphs_.emplace_back(c_graph_ptr);
   return Maybe<void>::Ok();
 }
 
+Maybe<void> MultiClientSessionContext::RemoveCGraph(
+    const std::shared_ptr<oneflow::NNGraph>& c_graph_ptr) {
+  std::lock_guard<std::mutex> lock(graphs_mutex_);
+  graphs_.erase(std::remove(graphs_.begin(), graphs_.end(), c_graph_ptr), graphs_.end());
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> MultiClientSessionContext::TryClose() {
   if (is_inited_) {
     VLOG(1) << "Try to delete multi client session context." << std::endl;
 
     // sync before NNGraph release to ensure LaunchLazyJob instruction was completed and released
     JUST(vm::ClusterSync());
-    for (const auto& graph : graphs_) {
-      VLOG(1) << "Try to close graph: " << graph->job_name() << std::endl;
-      JUST(graph->Close());
+    {
+      std::lock_guard<std::mutex> lock(graphs_mutex_);
+      for (const auto& graph : graphs_) {
+        VLOG(1) << "Try to close graph: " << graph->job_name() << std::endl;
+        JUST(graph->Close());
+      }
+      graphs_.clear();
     }
-    graphs_.clear();
     {
       // NOTE(chengcheng): delete runtime global objects
       Global<boxing::collective::Scheduler>::Delete();
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_FRAMEWORK_MULTI_CLIENT_SESSION_CONTEXT_H_
 #define ONEFLOW_CORE_FRAMEWORK_MULTI_CLIENT_SESSION_CONTEXT_H_
 
+#include <mutex>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/common/maybe.h"
@@ -33,6 +34,7 @@ class MultiClientSessionContext {
   Maybe<void> TryInit(const ConfigProto& config_proto);
   Maybe<void> UpdateResource(const Resource& reso_proto);
   Maybe<void> AddCGraph(const std::shared_ptr<oneflow::NNGraph>& c_graph_ptr);
+  Maybe<void> RemoveCGraph(const std::shared_ptr<oneflow::NNGraph>& c_graph_ptr);
   Maybe<void> TryClose();
 
   // NOTE(chengcheng): for nn.Graph catch free EagerTensor in Graph.build().
@@ -52,6 +54,8 @@ class MultiClientSessionContext {
   HashMap<std::string, std::vector<std::pair<std::string, std::shared_ptr<one::Tensor>>>>
       graph_name2free_eager_tensors_;
   std::vector<std::shared_ptr<NNGraph>> graphs_;
+  // Graphs may be added by the threads serving them.
+  std::mutex graphs_mutex_;
 };
 
 }  // namespace oneflow
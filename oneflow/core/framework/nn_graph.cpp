@@ -25,10 +25,15 @@ limitations under the License.
 #include "oneflow/core/framework/instructions_builder.h"
 #include "oneflow/core/framework/multi_client_session_context.h"
 #include "oneflow/core/framework/nd_sbp.h"
+#include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/framework/tensor_name_scope.h"
 #include "oneflow/core/functional/functional.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job/compiler.h"
+#include "oneflow/core/job/compile_time_profile.h"
+#include "oneflow/core/job/compiled_plan_cache.h"
 #include "oneflow/core/job/job_build_and_infer_ctx_mgr.h"
 #include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/job/job_instance.h"
@@ -36,8 +41,10 @@ limitations under the License.
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/core/job/plan_util.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/profiler/profiler.h"
+#include <zlib.h>
 
 namespace oneflow {
 
@@ -67,6 +74,101 @@ Maybe<std::string> GetTensorMetaString(const std::shared_ptr<one::Tensor>& tenso
   return ret;
 }
 
+std::string RankPlanKey(const std::string& plan_name, int64_t rank) {
+  return plan_name + "/rank_" + std::to_string(rank);
+}
+
+// Plans are mostly repeated names and ids, so even the fastest zlib level shrinks them a lot.
+// The size of the serialized plan is prepended to the compressed bytes.
+std::string CompressPlan(const Plan& plan) {
+  std::string serialized;
+  CHECK(plan.SerializePartialToString(&serialized));
+  const uint64_t serialized_size = serialized.size();
+  uLongf compressed_size = compressBound(serialized_size);
+  std::string compressed(sizeof(serialized_size) + compressed_size, '\0');
+  std::memcpy(&compressed[0], &serialized_size, sizeof(serialized_size));
+  CHECK_EQ(compress2(reinterpret_cast<Bytef*>(&compressed[sizeof(serialized_size)]),
+                     &compressed_size, reinterpret_cast<const Bytef*>(serialized.data()),
+                     serialized_size, Z_BEST_SPEED),
+           Z_OK);
+  compressed.resize(sizeof(serialized_size) + compressed_size);
+  return compressed;
+}
+
+void DecompressPlan(const std::string& compressed, Plan* plan) {
+  uint64_t serialized_size = 0;
+  CHECK_GE(compressed.size(), sizeof(serialized_size));
+  std::memcpy(&serialized_size, compressed.data(), sizeof(serialized_size));
+  std::string serialized(serialized_size, '\0');
+  uLongf size = serialized_size;
+  CHECK_EQ(uncompress(reinterpret_cast<Bytef*>(&serialized[0]), &size,
+                      reinterpret_cast<const Bytef*>(compressed.data() + sizeof(serialized_size)),
+                      compressed.size() - sizeof(serialized_size)),
+           Z_OK);
+  CHECK_EQ(size, serialized_size);
+  CHECK(plan->ParsePartialFromString(serialized));
+}
+
+// Runs the ops of a constant folded by InferenceGraphOptimizationPass with eager consistent
+// tensors, on the placement of the variable it is folded into.
+Maybe<one::Tensor> ComputeFoldedConstant(
+    const FoldedConstant& folded_constant,
+    const HashMap<std::string, std::shared_ptr<one::Tensor>>& variable_op_name2tensor,
+    Symbol<ParallelDesc> placement) {
+  NdSbp broadcast_nd_sbp;
+  for (int64_t i = 0; i < placement->hierarchy()->NumAxes(); ++i) {
+    broadcast_nd_sbp.add_sbp_parallel()->mutable_broadcast_parallel();
+  }
+  const auto& broadcast_sbp_tuple = JUST(GetSbpList(SymbolOf(broadcast_nd_sbp)));
+  HashMap<std::string, std::shared_ptr<one::Tensor>> lbn2tensor;
+  const auto Tensor4Lbn = [&](const std::string& lbn) -> Maybe<one::Tensor> {
+    const auto it = lbn2tensor.find(lbn);
+    if (it != lbn2tensor.end()) { return it->second; }
+    const std::string& var_name = GenLogicalBlobId(lbn).op_name();
+    std::shared_ptr<one::Tensor> tensor = JUST(MapAt(variable_op_name2tensor, var_name));
+    CHECK_OR_RETURN(tensor) << "folded constant " << folded_constant.lbn()
+                            << " depends on variable " << var_name << " without tensor";
+    if (!tensor->is_consistent()) {
+      tensor = JUST(one::functional::ToConsistent(tensor, placement, *broadcast_sbp_tuple, {}));
+    }
+    lbn2tensor.emplace(lbn, tensor);
+    return tensor;
+  };
+  for (const OperatorConf& op_conf : folded_constant.op()) {
+    const UserOpConf& user_conf = op_conf.user_conf();
+    std::vector<std::string> indexed_ibns;
+    std::vector<std::string> indexed_obns;
+    one::TensorTuple inputs;
+    for (const std::string& arg_name : user_conf.input_order()) {
+      const auto& lbns = JUST(MapAt(user_conf.input(), arg_name)).s();
+      for (int32_t i = 0; i < lbns.size(); ++i) {
+        indexed_ibns.emplace_back(arg_name + "_" + std::to_string(i));
+        inputs.emplace_back(JUST(Tensor4Lbn(lbns.Get(i))));
+      }
+    }
+    for (const std::string& arg_name : user_conf.output_order()) {
+      const auto& lbns = JUST(MapAt(user_conf.output(), arg_name)).s();
+      for (int32_t i = 0; i < lbns.size(); ++i) {
+        indexed_obns.emplace_back(arg_name + "_" + std::to_string(i));
+      }
+    }
+    UserOpConf op_proto = user_conf;
+    const auto& op_expr =
+        JUST(one::UserOpExpr::New(op_conf.name(), std::move(op_proto), indexed_ibns, indexed_obns));
+    // Source ops like constant take the placement from the context instead of the inputs.
+    const one::OpExprInterpContext ctx(AttrMap{}, placement, SymbolOf(broadcast_nd_sbp));
+    const auto& outputs =
+        JUST(one::OpInterpUtil::Dispatch<one::TensorTuple>(*op_expr, inputs, ctx));
+    int64_t output_index = 0;
+    for (const std::string& arg_name : user_conf.output_order()) {
+      for (const std::string& lbn : JUST(MapAt(user_conf.output(), arg_name)).s()) {
+        lbn2tensor[lbn] = outputs->at(output_index++);
+      }
+    }
+  }
+  return JUST(MapAt(lbn2tensor, folded_constant.lbn()));
+}
+
 }  // namespace
 
 NNGraph::~NNGraph() {
@@ -104,6 +206,41 @@ const std::vector<std::string>& NNGraph::outputs_tensor_meta_str() const {
 
 int64_t NNGraph::variable_op_size() const { return variable_op_names_.size(); }
 
+/* static */ Maybe<NNGraph::TensorMeta> NNGraph::MakeTensorMeta(
+    const std::shared_ptr<one::Tensor>& tensor) {
+  TensorMeta meta;
+  meta.shape = tensor->shape();
+  meta.dtype = tensor->dtype();
+  if (tensor->is_consistent()) {
+    meta.placement = JUST(tensor->parallel_desc());
+    meta.nd_sbp = JUST(tensor->nd_sbp());
+  } else {
+    meta.device = JUST(tensor->device());
+  }
+  return meta;
+}
+
+/* static */ Maybe<bool> NNGraph::TensorMetaMatched(const TensorMeta& meta,
+                                                    const std::shared_ptr<one::Tensor>& tensor) {
+  if (tensor->dtype() != meta.dtype || *tensor->shape() != *meta.shape) { return false; }
+  if (tensor->is_consistent()) {
+    return JUST(tensor->parallel_desc()) == meta.placement
+           && JUST(tensor->nd_sbp()) == meta.nd_sbp;
+  } else {
+    return JUST(tensor->device()) == meta.device;
+  }
+}
+
+Maybe<bool> NNGraph::InputTensorMetaMatched(int64_t i,
+                                            const std::shared_ptr<one::Tensor>& tensor) const {
+  return TensorMetaMatched(JUST(VectorAt(inputs_tensor_meta_, i)), tensor);
+}
+
+Maybe<bool> NNGraph::OutputTensorMetaMatched(int64_t i,
+                                             const std::shared_ptr<one::Tensor>& tensor) const {
+  return TensorMetaMatched(JUST(VectorAt(outputs_tensor_meta_, i)), tensor);
+}
+
 Maybe<void> NNGraph::RegisterAdditionalVarOpNamesAndTensorsToBeLoaded(
     const std::vector<std::string>& additional_var_names,
     const std::vector<std::shared_ptr<one::Tensor>>& additional_var_tensors) {
@@ -134,6 +271,7 @@ Maybe<void> NNGraph::RegisterInputOpNamesAndTensors(
   for (const auto& input_tensor : input_tensors) {
     input_tensors_valid_.emplace_back(JUST(GetTensorValidInCurRank(input_tensor)));
     inputs_tensor_meta_str_.emplace_back(*JUST(GetTensorMetaString(input_tensor)));
+    inputs_tensor_meta_.emplace_back(*JUST(MakeTensorMeta(input_tensor)));
   }
   CHECK_EQ_OR_RETURN(input_tensors_valid_.size(), input_tensors.size());
   return Maybe<void>::Ok();
@@ -153,6 +291,7 @@ Maybe<void> NNGraph::RegisterOutputOpNamesAndTensors(
   for (const auto& output_tensor : output_tensors) {
     output_tensors_valid_.emplace_back(JUST(GetTensorValidInCurRank(output_tensor)));
     outputs_tensor_meta_str_.emplace_back(*JUST(GetTensorMetaString(output_tensor)));
+    outputs_tensor_meta_.emplace_back(*JUST(MakeTensorMeta(output_tensor)));
   }
   CHECK_EQ_OR_RETURN(output_tensors_valid_.size(), output_tensors.size());
   return Maybe<void>::Ok();
@@ -206,6 +345,29 @@ Maybe<std::vector<std::shared_ptr<one::Tensor>>> NNGraph::GetAdditionalVarOpTens
   return tensors;
 }
 
+Maybe<void> NNGraph::UpdateFoldedVariables() {
+  const auto& folded_constants = job_.helper().folded_variable_op_name2constant();
+  if (folded_constants.empty()) { return Maybe<void>::Ok(); }
+  CHECK_OR_RETURN(runtime_inited_) << "nn.Graph " << name_ << " has not been compiled.";
+  auto lazy_mode_disabled_guard = LazyMode::Guard(/*is_enabled*/ false);
+  const auto& assign_op = JUST(one::OpBuilder("assign").Input("ref").Input("value").Build());
+  // Wait for the running jobs, which read the folded variables without the vm knowing it.
+  JUST(vm::CurrentRankSync());
+  for (const auto& pair : folded_constants) {
+    const std::shared_ptr<one::Tensor>& tensor = JUST(MapAt(variable_op_name2tensor_, pair.first));
+    const auto& placement = JUST(tensor->parallel_desc());
+    const auto& sbp_tuple = JUST(GetSbpList(JUST(tensor->nd_sbp())));
+    const auto& folded_tensor =
+        JUST(ComputeFoldedConstant(pair.second, variable_op_name2tensor_, placement));
+    const auto& value =
+        JUST(one::functional::ToConsistent(folded_tensor, placement, *sbp_tuple, {}));
+    JUST(one::OpInterpUtil::Dispatch<one::TensorTuple>(
+        *assign_op, {JUST(tensor->cur_rank_phy_tensor()), JUST(value->cur_rank_phy_tensor())}));
+  }
+  JUST(vm::CurrentRankSync());
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> NNGraph::RegisterNewVariableOpInJobPass() {
   OpGraph op_graph(job_);
   JUST(op_graph.MaybeForEachNode([&](OpNode* op_node) -> Maybe<void> {
@@ -256,37 +418,97 @@ Maybe<void> NNGraph::CompileAndInitRuntime() {
   if (Global<JobDesc>::Get() != nullptr) { Global<JobDesc>::Delete(); }
 
   auto scope = std::make_unique<GlobalJobDescScope>(job_.job_conf(), job_ctx->job_id());
-  if (GlobalProcessCtx::IsThisProcessMaster()) {
+  // NOTE: With rank local compile every rank compiles its own plan, otherwise the master compiles
+  //     the plan of all ranks and sends every rank its part.
+  const bool rank_local_compile =
+      Compiler::RankLocalCompileEnabled() && GlobalProcessCtx::WorldSize() > 1;
+  if (GlobalProcessCtx::IsThisProcessMaster() || rank_local_compile) {
     double start = GetCurTime();
-    // TODO(chengcheng): new memory reused by chunk
-    Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
-    PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
-
-    VLOG(1) << "Graph name: " << name_ << " compile time: " << (GetCurTime() - start) / 1000000000.0
-            << " seconds.";
-    if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
-      TeePersistentLogStream::Create("job_" + name_ + "_plan")->Write(plan_);
-      PlanUtil::ToDotFile(plan_, "job_" + name_ + "_plan.dot");
+    CompileTimeProfile profile("plan of graph " + name_);
+    std::string plan_fingerprint;
+    if (CompiledPlanCache::Enabled()) {
+      plan_fingerprint =
+          CompiledPlanCache::Fingerprint4Job(job_, job_ctx->job_id(), variable_op_names_);
+      profile.Tick("Fingerprint4Job");
+    }
+    if (!plan_fingerprint.empty() && CompiledPlanCache::Load(plan_fingerprint, &plan_)) {
+      profile.Tick("LoadCompiledPlanCache");
+    } else {
+      // TODO(chengcheng): new memory reused by chunk
+      if (rank_local_compile) {
+        Compiler().CompileForThisRank(&job_, &plan_, /* need_job_complete */ true);
+      } else {
+        Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
+      }
+      profile.Tick("Compile");
+      PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
+      profile.Tick("GenMemBlockAndChunkWithVariableOpNames4Plan");
+
+      VLOG(1) << "Graph name: " << name_
+              << " compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.";
+      if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
+        TeePersistentLogStream::Create("job_" + name_ + "_plan")->Write(plan_);
+        PlanUtil::ToDotFile(plan_, "job_" + name_ + "_plan.dot");
+        profile.Tick("DumpPlan");
+      }
+      PlanUtil::GenRegisterHint(&plan_);
+      profile.Tick("GenRegisterHint");
+      PlanUtil::GenStreamCudaGraphHint(&plan_);
+      profile.Tick("GenStreamCudaGraphHint");
+      // TODO(chengcheng): test collective boxing for multi-job.
+      PlanUtil::GenCollectiveBoxingPlan(&job_, &plan_);
+      profile.Tick("GenCollectiveBoxingPlan");
+      // PlanUtil::SetForceInplaceMemBlock(&plan_); NOTE(chengcheng): only for ssp.
+      PlanUtil::DumpCtrlRegstInfoToPlan(&plan_);
+      profile.Tick("DumpCtrlRegstInfoToPlan");
+      PlanUtil::PlanMemoryLog(&plan_, name_);
+      profile.Tick("PlanMemoryLog");
+      if (!plan_fingerprint.empty()) {
+        CompiledPlanCache::Save(plan_fingerprint, plan_);
+        profile.Tick("SaveCompiledPlanCache");
+      }
     }
-    PlanUtil::GenRegisterHint(&plan_);
-    // TODO(chengcheng): test collective boxing for multi-job.
-    PlanUtil::GenCollectiveBoxingPlan(&job_, &plan_);
-    // PlanUtil::SetForceInplaceMemBlock(&plan_); NOTE(chengcheng): only for ssp.
-    PlanUtil::DumpCtrlRegstInfoToPlan(&plan_);
-    PlanUtil::PlanMemoryLog(&plan_, name_);
   }
-  if (GlobalProcessCtx::WorldSize() > 1) {
+  // NOTE: The tasks of the other ranks are only needed by the passes above.
+  plan_.clear_remote_task();
+  if (GlobalProcessCtx::WorldSize() > 1 && rank_local_compile) {
+    OF_SESSION_BARRIER();
+  } else if (GlobalProcessCtx::WorldSize() > 1) {
     std::string plan_name = "plan:" + job_name();
+    // NOTE: Every rank only receives its own tasks and mem blocks, compressed. The rank parts are
+    //     spread over the ctrl servers of all ranks by their keys, and the part shared by all
+    //     ranks is relayed down a tree of ranks, so neither is served by the master alone.
+    const int64_t world_size = GlobalProcessCtx::WorldSize();
+    std::string shared_plan;
     if (GlobalProcessCtx::IsThisProcessMaster()) {
-      // TODO(chengcheng): split plan for each rank.
-      Global<CtrlClient>::Get()->PushKV(plan_name, plan_);
-    } else {
-      Global<CtrlClient>::Get()->PullKV(plan_name, &plan_);
+      Plan shared_part;
+      std::vector<Plan> rank_parts;
+      PlanUtil::SplitPlanByRank(plan_, &shared_part, &rank_parts);
+      shared_plan = CompressPlan(shared_part);
+      MultiThreadLoop(world_size - 1, [&](size_t i) {
+        const int64_t rank = i + 1;
+        Global<CtrlClient>::Get()->PushKV(RankPlanKey(plan_name, rank),
+                                          CompressPlan(rank_parts.at(rank)));
+      });
+    }
+    Global<CtrlClient>::Get()->BroadcastKV(plan_name, 0, &shared_plan);
+    if (!GlobalProcessCtx::IsThisProcessMaster()) {
+      std::string rank_plan;
+      Global<CtrlClient>::Get()->PullKV(RankPlanKey(plan_name, GlobalProcessCtx::Rank()),
+                                        &rank_plan);
+      DecompressPlan(shared_plan, &plan_);
+      Plan rank_part;
+      DecompressPlan(rank_plan, &rank_part);
+      plan_.MergeFrom(rank_part);
     }
     OF_SESSION_BARRIER();
     // NOTE(zwx): After barrier plan is synchronized between all ranks,
     //     then it can be cleared for saving mem.
-    if (GlobalProcessCtx::IsThisProcessMaster()) { Global<CtrlClient>::Get()->ClearKV(plan_name); }
+    if (GlobalProcessCtx::IsThisProcessMaster()) {
+      for (int64_t rank = 1; rank < world_size; ++rank) {
+        Global<CtrlClient>::Get()->ClearKV(RankPlanKey(plan_name, rank));
+      }
+    }
   }
   // NOTE(chengcheng): recovery op_attr
   PlanUtil::PopulateOpAttribute(&plan_, plan_.job_id2op_attribute_ref_table());
@@ -324,8 +546,20 @@ Maybe<void> NNGraph::GetVariableRealBlobAfterSyncPlan() {
       std::shared_ptr<std::vector<Symbol<SbpParallel>>> sbp_tuple =
           JUST(GetSbpList(Symbol<NdSbp>(nd_sbp)));
 
+      const auto& folded_constants = job_.helper().folded_variable_op_name2constant();
+      auto folded_constant_iter = folded_constants.find(var_name);
       auto load_tensor_iter = additional_variable_op_tobe_loaded_name2tensor_.find(var_name);
-      if (load_tensor_iter == additional_variable_op_tobe_loaded_name2tensor_.end()) {
+      if (folded_constant_iter != folded_constants.end()) {
+        // Compute a folded constant from the current variables of the module
+        auto lazy_mode_disabled_guard = LazyMode::Guard(/*is_enabled*/ false);
+        const auto& folded_tensor = JUST(ComputeFoldedConstant(
+            folded_constant_iter->second, variable_op_name2tensor_, placement));
+        tensor = JUST(one::functional::ToConsistent(folded_tensor, placement, *sbp_tuple, {}));
+        JUST(vm::CurrentRankSync());
+        VLOG(2) << "Lazy nn.Graph name " << name_ << " op: " << op_attribute.op_conf().name()
+                << " created in JobPass, nn.Graph has computed the constant folded into this "
+                   "variable.\n";
+      } else if (load_tensor_iter == additional_variable_op_tobe_loaded_name2tensor_.end()) {
         // Create a additional variable tensor
         Scalar value;
         const VariableOpConf& var_conf = op_attribute.op_conf().variable_conf();
@@ -453,22 +687,39 @@ void NNGraph::CloseRuntimeBuffers() {
 
 namespace {
 
+Maybe<vm::EagerBlobObject> GetEagerBlobObject(const std::shared_ptr<one::Tensor>& tensor) {
+  CHECK_OR_RETURN(tensor->is_eager());
+  if (tensor->is_consistent()) { return JUST(tensor->cur_rank_phy_tensor())->eager_blob_object(); }
+  return tensor->eager_blob_object();
+}
+
 Maybe<void> MakeEagerBlobObjectList(std::vector<std::shared_ptr<vm::EagerBlobObject>>* blob_list,
                                     const one::TensorTuple& tensor_list) {
   blob_list->reserve(tensor_list.size());
   for (const auto& tensor : tensor_list) {
-    CHECK_OR_RETURN(tensor->is_eager());
-    if (tensor->is_consistent()) {
-      blob_list->emplace_back(JUST(JUST(tensor->cur_rank_phy_tensor())->eager_blob_object()));
-    } else {
-      blob_list->emplace_back(JUST(tensor->eager_blob_object()));
-    }
+    blob_list->emplace_back(JUST(GetEagerBlobObject(tensor)));
   }
   return Maybe<void>::Ok();
 }
 
 }  // namespace
 
+Maybe<std::shared_ptr<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>>
+NNGraph::GetParameterEagerBlobObjects(const one::TensorTuple& parameters) {
+  // Compared by blob rather than by tensor, `param.data = x` swaps the blob of a tensor in place.
+  bool same_blobs = parameter_blobs_ && parameter_blobs_->size() == parameters.size();
+  for (int64_t i = 0; same_blobs && i < parameters.size(); ++i) {
+    same_blobs = JUST(GetEagerBlobObject(parameters.at(i))).get() == parameter_blobs_->at(i).get();
+  }
+  if (!same_blobs) {
+    std::vector<std::shared_ptr<vm::EagerBlobObject>> var_blobs;
+    JUST(MakeEagerBlobObjectList(&var_blobs, parameters));
+    parameter_blobs_ = std::make_shared<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>(
+        std::move(var_blobs));
+  }
+  return parameter_blobs_;
+}
+
 Maybe<void> RunLazyNNGraph(const one::TensorTuple& inputs, const one::TensorTuple& outputs,
                            const one::TensorTuple& parameters,
                            const std::shared_ptr<NNGraph>& nn_graph) {
@@ -480,35 +731,33 @@ Maybe<void> RunLazyNNGraph(const one::TensorTuple& inputs, const one::TensorTupl
   //   but the NNGraph::variable_op_size may has FreeEagerTensor as sepcial variable op.
   CHECK_LE_OR_RETURN(parameters.size(), nn_graph->variable_op_size());
   for (int i = 0; i < inputs.size(); ++i) {
-    // TODO(chengcheng, liufengwei):
-    //   use TensorMeta.to_string and equal.
+    // NOTE: the meta strings are only built for the error message, the per step check compares
+    //   the shape, dtype and symbols registered in the first call.
+    if (JUST(nn_graph->InputTensorMetaMatched(i, inputs.at(i)))) { continue; }
     std::string tensor_meta_str = *JUST(GetTensorMetaString(inputs.at(i)));
     const std::string& static_meta_str = nn_graph->inputs_tensor_meta_str().at(i);
-    CHECK_OR_RETURN(static_meta_str == tensor_meta_str)
-        << "\n  nn.Graph ONLY accepts static inputs tensor meta, please check whether your input "
-        << "tensor meta each step is the same as the input of first call graph. \n  The excepted "
-        << "tensor meta is : ( \n  " << static_meta_str
-        << " \n) , but the actual tensor meta is : ( \n  " << tensor_meta_str << " \n)";
+    return Error::RuntimeError()
+           << "\n  nn.Graph ONLY accepts static inputs tensor meta, please check whether your "
+           << "input tensor meta each step is the same as the input of first call graph. \n  The "
+           << "excepted tensor meta is : ( \n  " << static_meta_str
+           << " \n) , but the actual tensor meta is : ( \n  " << tensor_meta_str << " \n)";
   }
   for (int i = 0; i < outputs.size(); ++i) {
-    CHECK_OR_RETURN(nn_graph->outputs_tensor_meta_str().at(i)
-                    == *JUST(GetTensorMetaString(outputs.at(i))));
+    CHECK_OR_RETURN(JUST(nn_graph->OutputTensorMetaMatched(i, outputs.at(i))))
+        << "the meta of output " << i << " is " << *JUST(GetTensorMetaString(outputs.at(i)))
+        << ", but " << nn_graph->outputs_tensor_meta_str().at(i) << " is expected";
   }
   std::vector<std::shared_ptr<vm::EagerBlobObject>> input_blobs;
   std::vector<std::shared_ptr<vm::EagerBlobObject>> output_blobs;
-  std::vector<std::shared_ptr<vm::EagerBlobObject>> var_blobs;
   JUST(MakeEagerBlobObjectList(&input_blobs, inputs));
   JUST(MakeEagerBlobObjectList(&output_blobs, outputs));
-  JUST(MakeEagerBlobObjectList(&var_blobs, parameters));
   const auto& input_blob_list_ptr =
       std::make_shared<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>(
           std::move(input_blobs));
   const auto& output_blob_list_ptr =
       std::make_shared<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>(
           std::move(output_blobs));
-  const auto& var_blob_list_ptr =
-      std::make_shared<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>(
-          std::move(var_blobs));
+  const auto& var_blob_list_ptr = JUST(nn_graph->GetParameterEagerBlobObjects(parameters));
   JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
     return builder->LaunchLazyJob(input_blob_list_ptr, output_blob_list_ptr, var_blob_list_ptr,
                                   nn_graph);
@@ -27,6 +27,10 @@ namespace oneflow {
 
 class Blob;
 
+namespace vm {
+class EagerBlobObject;
+}  // namespace vm
+
 class NNGraph final : public NNGraphIf {
  public:
   explicit NNGraph(const std::string& name)
@@ -41,6 +45,15 @@ class NNGraph final : public NNGraphIf {
   const std::vector<std::string>& inputs_tensor_meta_str() const;
   const std::vector<std::string>& outputs_tensor_meta_str() const;
   int64_t variable_op_size() const;
+  // Whether the tensor has the static meta of the i-th input or output, compared without
+  // building the meta strings.
+  Maybe<bool> InputTensorMetaMatched(int64_t i, const std::shared_ptr<one::Tensor>& tensor) const;
+  Maybe<bool> OutputTensorMetaMatched(int64_t i, const std::shared_ptr<one::Tensor>& tensor) const;
+  // The eager blob objects of the parameters, made once and reused while the parameters passed
+  // in each run still have the same blobs. Blobs replaced through set_data are held by the list
+  // until the next run.
+  Maybe<std::shared_ptr<const std::vector<std::shared_ptr<vm::EagerBlobObject>>>>
+  GetParameterEagerBlobObjects(const one::TensorTuple& parameters);
 
   Maybe<void> RegisterAdditionalVarOpNamesAndTensorsToBeLoaded(
       const std::vector<std::string>& additional_var_names,
@@ -56,6 +69,9 @@ class NNGraph final : public NNGraphIf {
       const std::vector<std::shared_ptr<one::Tensor>>& variable_tensors);
   Maybe<std::vector<std::string>> GetAdditionalVarOpNames() const;
   Maybe<std::vector<std::shared_ptr<one::Tensor>>> GetAdditionalVarOpTensors() const;
+  // Recomputes the variables folded by InferenceGraphOptimizationPass from the current module
+  // variables, in place, so the runtime keeps using the same blobs.
+  Maybe<void> UpdateFoldedVariables();
   Maybe<void> CompileAndInitRuntime();
   Maybe<void> Close();
 
@@ -67,6 +83,17 @@ class NNGraph final : public NNGraphIf {
   void NewRuntimeBuffers();
   void CloseRuntimeBuffers();
 
+  struct TensorMeta {
+    std::shared_ptr<const Shape> shape;
+    Symbol<DType> dtype;
+    Symbol<ParallelDesc> placement;
+    Symbol<NdSbp> nd_sbp;
+    Symbol<Device> device;
+  };
+  static Maybe<TensorMeta> MakeTensorMeta(const std::shared_ptr<one::Tensor>& tensor);
+  static Maybe<bool> TensorMetaMatched(const TensorMeta& meta,
+                                       const std::shared_ptr<one::Tensor>& tensor);
+
   std::string name_;
   std::vector<std::string> inputs_op_names_;
   std::vector<std::string> outputs_op_names_;
@@ -74,6 +101,9 @@ class NNGraph final : public NNGraphIf {
   std::vector<bool> output_tensors_valid_;
   std::vector<std::string> inputs_tensor_meta_str_;
   std::vector<std::string> outputs_tensor_meta_str_;
+  std::vector<TensorMeta> inputs_tensor_meta_;
+  std::vector<TensorMeta> outputs_tensor_meta_;
+  std::shared_ptr<const std::vector<std::shared_ptr<vm::EagerBlobObject>>> parameter_blobs_;
   HashMap<std::string, std::shared_ptr<one::Tensor>> variable_op_name2tensor_;
   // Additional variables are variable other than model states, such as states in
   // optimizers/lr schedulers or free eager tensors.
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/framework/op_interpreter/dispatch_frame.h"
 #include "oneflow/core/framework/user_op_registry_manager.h"
 #include "oneflow/core/framework/consistent_tensor_infer_cache.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
 
@@ -421,6 +422,7 @@ Maybe<void> UserOpExpr::Init(const std::shared_ptr<const UserOpExpr>& self) {
     device_and_stream_infer_fn_ = registry->device_and_stream_infer_fn;
   }
   consistent_tensor_infer_cache_.reset(new ConsistentTensorInferCache(self));
+  local_tensor_infer_cache_.reset(new LocalTensorInferCache(self));
   return Maybe<void>::Ok();
 }
 
@@ -555,6 +557,10 @@ Maybe<void> BuiltinOpExprImpl<ImageDecoderRandomCropResizeOpConf>::BuildOpConf(
   proto->set_random_area_max(JUST(attrs.GetAttr<float>("random_area_max")));
   proto->set_random_aspect_ratio_min(JUST(attrs.GetAttr<float>("random_aspect_ratio_min")));
   proto->set_random_aspect_ratio_max(JUST(attrs.GetAttr<float>("random_aspect_ratio_max")));
+  proto->clear_mean();
+  for (float mean : JUST(attrs.GetAttr<std::vector<float>>("mean"))) { proto->add_mean(mean); }
+  proto->clear_std();
+  for (float std : JUST(attrs.GetAttr<std::vector<float>>("std"))) { proto->add_std(std); }
   return Maybe<void>::Ok();
 }
 
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_expr_grad_function.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_util.h"
+
+namespace oneflow {
+namespace one {
+
+size_t AutoGradCaptureState::SaveTensorForBackward(const std::shared_ptr<Tensor>& tensor) {
+  size_t offset = saved_tensors_.size();
+  const auto& creator = CurrentSavedTensorHookCreator();
+  if (!creator || !tensor) {
+    saved_tensors_.emplace_back(tensor);
+    return offset;
+  }
+  std::unique_ptr<SavedTensorHook> hook = creator->NewHook();
+  {
+    // Ops launched by the hook are neither recorded nor packed again.
+    autograd::AutoGradMode mode(false);
+    DisableSavedTensorHookGuard guard;
+    const auto& status = hook->Pack(tensor);
+    if (!status.IsOk()) {
+      // Saving can not fail, the error is returned once the capture is done.
+      if (!pack_error_) { pack_error_ = status.error(); }
+      SaveTensorVersion(offset, *tensor);
+      saved_tensors_.emplace_back(tensor);
+      return offset;
+    }
+  }
+  saved_tensors_.emplace_back(nullptr);
+  packed_tensors_.emplace_back(PackedTensor{offset, tensor->requires_grad(), std::move(hook)});
+  return offset;
+}
+
+void AutoGradCaptureState::SaveTensorVersion(size_t offset, const Tensor& tensor) {
+  const auto& version = TensorVersion(tensor);
+  if (!version.IsOk()) {
+    if (!pack_error_) { pack_error_ = version.error(); }
+    return;
+  }
+  // Tensors packed by hooks are copies owned by the hooks, only the others are checked.
+  saved_versions_.emplace_back(SavedVersion{offset, CHECK_JUST(version)});
+}
+
+Maybe<void> AutoGradCaptureState::CheckSavedVersions() const {
+  for (const auto& saved : saved_versions_) {
+    const auto& tensor = saved_tensors_.at(saved.offset);
+    const int64_t version = JUST(TensorVersion(*tensor));
+    CHECK_EQ_OR_RETURN(version, saved.version)
+        << "one of the variables needed for gradient computation has been modified by an "
+           "inplace operation: the saved tensor "
+        << saved.offset << " with shape " << tensor->shape()->ToString() << " is at version "
+        << version << "; expected version " << saved.version << " instead";
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> AutoGradCaptureState::CheckPackedTensors() const {
+  if (pack_error_) { return pack_error_; }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> AutoGradCaptureState::UnpackSavedTensors() const {
+  JUST(CheckPackedTensors());
+  JUST(CheckSavedVersions());
+  if (packed_tensors_.empty()) { return Maybe<void>::Ok(); }
+  autograd::AutoGradMode mode(false);
+  DisableSavedTensorHookGuard guard;
+  for (const auto& packed : packed_tensors_) {
+    const auto& tensor = JUST(packed.hook->Unpack());
+    CHECK_OR_RETURN(tensor) << "the unpack hook of saved tensors returns None";
+    if (tensor->requires_grad() != packed.requires_grad) {
+      JUST(tensor->set_requires_grad(packed.requires_grad));
+    }
+    saved_tensors_.at(packed.offset) = tensor;
+  }
+  // The unpacked tensors are kept for the next backward if the graph is retained.
+  packed_tensors_.clear();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -18,6 +18,7 @@ limitations under the License.
 #define ONEFLOW_CORE_FRAMEWORK_OP_EXPR_GRAD_FUNCTION_H_
 
 #include "oneflow/core/common/auto_registration_factory.h"
+#include "oneflow/core/autograd/saved_tensor_hooks.h"
 #include "oneflow/core/framework/op_interpreter.h"
 
 namespace oneflow {
@@ -32,14 +33,32 @@ class AutoGradCaptureState {
 
   const TensorTuple& SavedTensors() const { return saved_tensors_; }
 
-  size_t SaveTensorForBackward(const std::shared_ptr<Tensor>& tensor) {
-    size_t offset = saved_tensors_.size();
-    saved_tensors_.emplace_back(tensor);
-    return offset;
-  }
+  // The tensor is packed by the saved tensor hook of the current thread if there is one.
+  size_t SaveTensorForBackward(const std::shared_ptr<Tensor>& tensor);
+  // Unpacks the packed tensors, called before backward reads the saved tensors.
+  Maybe<void> UnpackSavedTensors() const;
+  Maybe<void> CheckPackedTensors() const;
 
  protected:
-  TensorTuple saved_tensors_;
+  struct PackedTensor {
+    size_t offset;
+    bool requires_grad;
+    std::unique_ptr<SavedTensorHook> hook;
+  };
+
+  struct SavedVersion {
+    size_t offset;
+    int64_t version;
+  };
+
+  void SaveTensorVersion(size_t offset, const Tensor& tensor);
+  Maybe<void> CheckSavedVersions() const;
+
+  mutable TensorTuple saved_tensors_;
+  mutable std::vector<PackedTensor> packed_tensors_;
+  // Versions of the saved tensors when they are saved, to reject the inplace modifications.
+  std::vector<SavedVersion> saved_versions_;
+  std::shared_ptr<cfg::ErrorProto> pack_error_;
 };
 
 class FunctionAutoGradCaptureState final
@@ -105,13 +124,15 @@ class OpExprGradFunction : public OpExprGradFunctionIf {
       detach_outputs.at(i) = JUST(outputs.at(i)->detach());
       JUST(detach_outputs.at(i)->set_requires_grad(outputs.at(i)->requires_grad()));
     }
-    return Capture(state, detach_inputs, detach_outputs, interp_ctx);
+    JUST(Capture(state, detach_inputs, detach_outputs, interp_ctx));
+    return state->CheckPackedTensors();
   }
 
   Maybe<void> ApplyIf(const AutoGradCaptureState* ctx, const TensorTuple& out_grads,
                       TensorTuple* in_grads) const override {
     const StateT* state = dynamic_cast<const StateT*>(ctx);
     CHECK_NOTNULL_OR_RETURN(state);
+    JUST(state->UnpackSavedTensors());
     return Apply(state, out_grads, in_grads);
   }
 
@@ -162,6 +183,7 @@ class FunctionOpExprGradFunction final : public OpExprGradFunctionIf {
     const FunctionAutoGradCaptureState* func_ctx =
         dynamic_cast<const FunctionAutoGradCaptureState*>(ctx);
     CHECK_NOTNULL_OR_RETURN(func_ctx);
+    JUST(func_ctx->UnpackSavedTensors());
     const std::shared_ptr<TensorTuple>& out = backward_fn_(
         const_cast<FunctionAutoGradCaptureState*>(func_ctx)->GetSharedFromThis(), out_grads);
     in_grads->assign(out->begin(), out->end());
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/framework/scope_util.h"
 #include "oneflow/core/framework/session_util.h"
 #include "oneflow/core/framework/symbol_storage_util.h"
+#include "oneflow/core/framework/symbol_sync_burst.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_name_scope.h"
 #include "oneflow/core/framework/tensor_tuple.h"
@@ -179,7 +180,8 @@ Maybe<void> Interpret(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
   return Maybe<void>::Ok();
 }
 
-auto* InterpretThenInitConsistentId = DECORATE(&Interpret, NonRecursiveInitConsistentId);
+auto* InterpretThenInitConsistentId =
+    DECORATE(DECORATE(&Interpret, NonRecursiveInitConsistentId), BatchSymbolSyncs);
 
 }  // namespace
 
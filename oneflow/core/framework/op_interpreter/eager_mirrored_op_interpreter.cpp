@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_name_scope.h"
 #include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/framework/local_tensor_infer_cache.h"
 #include "oneflow/core/framework/stride.h"
 #include "oneflow/core/eager/foreign_boxing_util.h"
 #include "oneflow/core/memory/memory_case_util.h"
@@ -37,6 +38,8 @@ limitations under the License.
 #include "oneflow/core/framework/tensor_rpc_util.h"
 #include "oneflow/core/framework/tensor_consistent_id.h"
 #include "oneflow/core/framework/op_builder.h"
+#include "oneflow/core/framework/op_interpreter/dispatch_frame.h"
+#include "oneflow/core/profiler/memory_trace.h"
 #include "oneflow/core/framework/id_util.h"
 #include "oneflow/core/functional/functional.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
@@ -85,6 +88,7 @@ std::vector<TensorMeta*>* ThreadLocalDefaultOutputMutTensorMetas(int64_t size) {
 Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
                            const Symbol<Device>& default_device, TensorTuple* outputs,
                            const OpExprInterpContext& ctx) {
+  std::unique_lock<std::mutex> lock(*user_op_expr.mut_interpret_mutex());
   const auto& attrs = ctx.attrs;
   std::shared_ptr<EagerBlobObjectList> input_eager_blob_objects =
       std::make_shared<EagerBlobObjectList>(inputs.size());
@@ -111,31 +115,54 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
   }
   Symbol<Stream> stream;
   bool need_check_mem_case = true;
-
-  // Infer devices
-  if (!user_op_expr.has_device_and_stream_infer_fn()) {
-    stream = GetDefaultStreamByDevice(default_device);
+  std::shared_ptr<StatefulLocalOpKernel> kernel;
+
+  if (!user_op_expr.has_device_and_stream_infer_fn() && LocalTensorInferCacheEnabled()) {
+    // Devices, shapes, dtypes and the kernel only depend on the input metas and attrs.
+    static thread_local LocalTensorMetaInferArgs infer_args;
+    JUST(infer_args.Init(attrs, default_device, inputs));
+    const auto& infer_result =
+        JUST(user_op_expr.mut_local_tensor_infer_cache()->GetOrInfer(infer_args));
+    stream = infer_result->stream();
     for (int i = 0; i < outputs->size(); i++) {
       auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
       *JUST(tensor_impl->mut_device()) = default_device;
+      const auto& tensor_meta = infer_result->output_tensor_metas().at(i);
+      // using thread_local TensorMeta pointer if inplace.
+      // using tensor_impl TensorMeta pointer if not inplace.
+      TensorMeta* output_tensor_meta = output_tensor_metas->at(i);
+      *output_tensor_meta->mut_shape() = tensor_meta.shape();
+      output_tensor_meta->set_dtype(tensor_meta.dtype());
+      output_tensor_meta->set_is_dynamic(tensor_meta.is_dynamic());
     }
+    kernel = infer_result->kernel();
   } else {
-    need_check_mem_case = false;
-    stream = JUST(user_op_expr.InferDeviceAndStream(attrs, inputs, outputs));
-  }
+    // Infer devices
+    if (!user_op_expr.has_device_and_stream_infer_fn()) {
+      stream = GetDefaultStreamByDevice(default_device);
+      for (int i = 0; i < outputs->size(); i++) {
+        auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
+        *JUST(tensor_impl->mut_device()) = default_device;
+      }
+    } else {
+      need_check_mem_case = false;
+      stream = JUST(user_op_expr.InferDeviceAndStream(attrs, inputs, outputs));
+    }
 
-  // Infer shapes and dtypes
-  const auto& device_tag = JUST(stream->device()->of_type());
-  JUST(user_op_expr.InferPhysicalShapeAndDType(
-      attrs, device_tag,
-      [&](int32_t i) -> const TensorMeta* {
-        return CHECK_JUST(TensorImpl4Tensor(inputs.at(i)))->mut_tensor_meta();
-      },
-      [&](int32_t i) -> TensorMeta* {
-        // using thread_local TensorMeta pointer if inplace.
-        // using tensor_impl TensorMeta pointer if not inplace.
-        return output_tensor_metas->at(i);
-      }));
+    // Infer shapes and dtypes
+    const auto& device_tag = JUST(stream->device()->of_type());
+    JUST(user_op_expr.InferPhysicalShapeAndDType(
+        attrs, device_tag,
+        [&](int32_t i) -> const TensorMeta* {
+          return CHECK_JUST(TensorImpl4Tensor(inputs.at(i)))->mut_tensor_meta();
+        },
+        [&](int32_t i) -> TensorMeta* {
+          // using thread_local TensorMeta pointer if inplace.
+          // using tensor_impl TensorMeta pointer if not inplace.
+          return output_tensor_metas->at(i);
+        }));
+    kernel = JUST(user_op_expr.MutKernel4Stream(stream));
+  }
 
   for (int i = 0; i < output_eager_blob_objects->size(); i++) {
     auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
@@ -152,9 +179,16 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
     }
   }
 
-  const auto& kernel = JUST(user_op_expr.MutKernel4Stream(stream));
   kernel->set_need_check_mem_case(need_check_mem_case);
 
+  if (profiler::MemoryTraceEnabled()) {
+    const std::string stack = profiler::MemoryTraceStackEnabled() ? DispatchFrame::get_str() : "";
+    for (const auto& blob_object : *output_eager_blob_objects) {
+      profiler::RecordMemoryBlobOrigin(blob_object.get(), user_op_expr.op_type_name(),
+                                       user_op_expr.op_name(), stack);
+    }
+  }
+
   for (int64_t index : kernel->output_tuple_indexes4mut2_obns()) {
     output_eager_blob_objects->at(index)->set_is_shape_synced(false);
   }
@@ -17,13 +17,16 @@ limitations under the License.
 
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/autograd/checkpoint.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/framework/instructions_builder.h"
 #include "oneflow/core/framework/op_arg_util.h"
 #include "oneflow/core/framework/op_expr_grad_function.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/framework/tensor_util.h"
 #include "oneflow/core/job/lazy_mode.h"
+#include "oneflow/core/profiler/event_trace.h"
 
 namespace oneflow {
 namespace one {
@@ -85,16 +88,31 @@ Maybe<void> EagerInterpreter::ApplyImpl(const FunctionOpExpr& op_expr, const Ten
 
 Maybe<void> AutogradInterpreter::Apply(const OpExpr& op_expr, const TensorTuple& inputs,
                                        TensorTuple* outputs, const OpExprInterpContext& ctx) const {
+  profiler::OpDispatchEventGuard dispatch_event_guard(op_expr.op_type_name());
+  if (auto* recorder = CurrentCheckpointRecorder()) {
+    if (!LazyMode::is_enabled()) {
+      // The backward of the checkpointed segment is bound to its outputs at the end.
+      JUST(recorder->RecordAndApply(*internal_, op_expr, inputs, outputs, ctx));
+      for (auto& output : *outputs) { output->set_is_leaf(true); }
+      return Maybe<void>::Ok();
+    }
+  }
   bool requires_grad = false;
   if (autograd::GradMode::is_enabled() && !JUST(op_expr.IsGradDisabled())) {
     requires_grad =
         std::any_of(inputs.begin(), inputs.end(),
                     [](const std::shared_ptr<Tensor>& tensor) { return tensor->requires_grad(); });
   }
+  // Outputs given by the caller are inplaced, their storages are modified by this op.
+  std::vector<bool> inplaced(outputs->size());
+  for (int i = 0; i < outputs->size(); ++i) { inplaced[i] = static_cast<bool>(outputs->at(i)); }
   {
     autograd::AutoGradMode mode(false);
     JUST(internal_->Apply(op_expr, inputs, outputs, ctx));
   }
+  for (int i = 0; i < outputs->size(); ++i) {
+    if (inplaced[i]) { JUST(BumpTensorVersion(*outputs->at(i))); }
+  }
   // Lazy mode will construct backward compute graph in passes, so disable autograd if lazy mode.
   if (requires_grad && !LazyMode::is_enabled()) {
     const auto& grad_closure = JUST(op_expr.GetOrCreateOpGradClosure());
@@ -152,17 +152,14 @@ CUDAGeneratorImpl::CUDAGeneratorImpl(uint64_t seed, int device_index)
   max_thread_num_ = GetThreadNum(prop);
 
   CudaCurrentDeviceGuard dev_guard(device_index);
-  OF_CUDA_CHECK(
-      cudaMalloc(&curand_states_, max_block_num_ * max_thread_num_ * sizeof(curandState)));
   OF_CUDA_CHECK(cudaMalloc(&cuda_gen_state_, sizeof(CUDAGeneratorState)));
-  detail::InitCurandStates(seed, max_block_num_, max_thread_num_, curand_states_, cuda_gen_state_);
+  OF_CUDA_CHECK(cudaMemset(cuda_gen_state_, 0, sizeof(CUDAGeneratorState)));
 }
 
 CUDAGeneratorImpl::~CUDAGeneratorImpl() {
   // Skip if cuda runtime has been deinitialized.
   if (cudaErrorCudartUnloading == cudaSetDevice(this->device_index())) { return; }
   CudaCurrentDeviceGuard dev_guard(this->device_index());
-  OF_CUDA_CHECK(cudaFree(curand_states_));
   OF_CUDA_CHECK(cudaFree(cuda_gen_state_));
 }
 
@@ -170,21 +167,23 @@ void CUDAGeneratorImpl::set_current_seed(uint64_t seed) {
   CudaCurrentDeviceGuard dev_guard(this->device_index());
   CHECK_JUST(CUDASynchronize());
   seed_ = seed;
-  detail::InitCurandStates(seed_, max_block_num_, max_thread_num_, curand_states_, cuda_gen_state_);
+  // Philox numbers only depend on the seed and the offset, there is no state to initialize.
+  OF_CUDA_CHECK(cudaMemset(cuda_gen_state_, 0, sizeof(CUDAGeneratorState)));
 }
 
 Maybe<Tensor> CUDAGeneratorImpl::GetState() const {
   CudaCurrentDeviceGuard dev_guard(this->device_index());
   JUST(CUDASynchronize());
-  int64_t state_size = max_block_num_ * max_thread_num_ * sizeof(curandState);
+  // The Philox offset followed by the seed.
+  int64_t state_size = sizeof(uint64_t);
   int64_t total_size = state_size + sizeof(int64_t);
   const auto& device = JUST(Device::New("cpu"));
   const auto& tensor_state = JUST(functional::Empty(Shape{total_size}, DType::UInt8(), device));
 
   const auto& callback = [&](uint64_t of_blob_ptr) {
     auto* of_blob = reinterpret_cast<OfBlob*>(of_blob_ptr);
-    OF_CUDA_CHECK(cudaMemcpy(of_blob->mut_blob()->mut_dptr<uint8_t>(), curand_states_, state_size,
-                             cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(of_blob->mut_blob()->mut_dptr<uint8_t>(),
+                             &cuda_gen_state_->dev_offset, state_size, cudaMemcpyDefault));
     memcpy(of_blob->mut_blob()->mut_dptr<uint8_t>() + state_size, &seed_, sizeof(int64_t));
   };
   JUST(SyncAccessTensorWithTimeOut(tensor_state, callback, "mut"));
@@ -199,7 +198,7 @@ Maybe<void> CUDAGeneratorImpl::SetState(const std::shared_ptr<Tensor>& tensor_st
   if (tensor_state->dtype() != DType::UInt8()) {
     return Error::RuntimeError() << "Generator state should be dtype=flow.uint8";
   }
-  int64_t state_size = max_block_num_ * max_thread_num_ * sizeof(curandState);
+  int64_t state_size = sizeof(uint64_t);
   int64_t total_size = state_size + sizeof(int64_t);
   if (tensor_state->shape()->elem_cnt() != total_size) {
     return Error::RuntimeError() << "Tensor state size is not match for CUDA generator. It needs "
@@ -213,7 +212,8 @@ Maybe<void> CUDAGeneratorImpl::SetState(const std::shared_ptr<Tensor>& tensor_st
     const uint8_t* data = of_blob->blob().dptr<uint8_t>();
     // Do not use set_current_seed() since synchronization will lead to deadlock.
     seed_ = *((uint64_t*)(data + state_size));
-    OF_CUDA_CHECK(cudaMemcpy(curand_states_, data, state_size, cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemcpy(&cuda_gen_state_->dev_offset, data, state_size, cudaMemcpyDefault));
+    OF_CUDA_CHECK(cudaMemset(&cuda_gen_state_->dev_counter, 0, sizeof(int32_t)));
   };
   JUST(SyncAccessTensorWithTimeOut(tensor_state, callback, "const"));
   return Maybe<void>::Ok();
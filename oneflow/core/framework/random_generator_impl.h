@@ -23,10 +23,6 @@ limitations under the License.
 #include "oneflow/core/common/device_type.h"
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/framework/device.h"
-#ifdef WITH_CUDA
-#include <curand.h>
-#include <curand_kernel.h>
-#endif  // WITH_CUDA
 
 namespace oneflow {
 namespace one {
@@ -112,6 +108,8 @@ class CPUGeneratorImpl : public DeviceGeneratorImpl {
 };
 
 #ifdef WITH_CUDA
+// The Philox offset the next kernel drawing from the generator starts at, and the number of blocks
+// of the running kernel that are done drawing, see oneflow/core/cuda/philox.cuh.
 struct CUDAGeneratorState {
   uint64_t dev_offset;
   int32_t dev_counter;
@@ -125,7 +123,6 @@ class CUDAGeneratorImpl : public DeviceGeneratorImpl {
   int32_t max_block_num() const { return max_block_num_; }
   int32_t max_thread_num() const { return max_thread_num_; }
 
-  curandState* curand_states() const { return curand_states_; }
   CUDAGeneratorState* cuda_gen_state() const { return cuda_gen_state_; }
 
   void set_current_seed(uint64_t seed) override;
@@ -138,16 +135,8 @@ class CUDAGeneratorImpl : public DeviceGeneratorImpl {
  private:
   int32_t max_block_num_;
   int32_t max_thread_num_;
-  curandState* curand_states_;
   CUDAGeneratorState* cuda_gen_state_;
 };
-
-namespace detail {
-
-void InitCurandStates(uint64_t seed, int32_t block_num, int32_t thread_num, curandState* states,
-                      CUDAGeneratorState* cuda_gen_state);
-
-}  // namespace detail
 #endif  // WITH_CUDA
 
 class AutoGeneratorImpl : public GeneratorImpl {
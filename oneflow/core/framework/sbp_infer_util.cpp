@@ -21,6 +21,8 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
 
 namespace oneflow {
 
@@ -198,6 +200,17 @@ Maybe<double> ComputCopyCostBetweenTwoNdSbp(const NdSbp& producer_nd_sbp,
           logical_blob_size, hierarchy->At(dim_diff_sbp), on_same_devices);
     }
   }
+  if (on_same_devices && producer_sbp_size == 2 && consumer_sbp_size == 2
+      && IsBoxingBy2DSendRecvEnabled() && CanBoxingBy2DSendRecv(producer_nd_sbp, consumer_nd_sbp)) {
+    // Each rank receives its consumer slice except for about 1/parallel_num of it held locally
+    double num_consumer_slices = 1;
+    for (int32_t i = 0; i < 2; i++) {
+      if (consumer_nd_sbp.sbp_parallel(i).has_split_parallel()) {
+        num_consumer_slices *= hierarchy->At(i);
+      }
+    }
+    return logical_blob_size * (hierarchy->elem_cnt() - 1) / num_consumer_slices;
+  }
   return kUnsupportedBoxing;
 }
 
@@ -407,6 +420,27 @@ double GetTransferCost() {
   return kTransferCost;
 }
 
+bool IsBoxingBy2DSendRecvEnabled() {
+  // Only the nccl logical ops carry out such a transition, the sub task graph builders do not.
+  static const bool kEnabled = ParseBooleanFromEnv("ONEFLOW_BOXING_ENABLE_2D_SEND_RECV", false);
+  return kEnabled && Global<ResourceDesc, ForSession>::Get() != nullptr
+         && Global<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream();
+}
+
+bool CanBoxingBy2DSendRecv(const NdSbp& producer_nd_sbp, const NdSbp& consumer_nd_sbp) {
+  if (producer_nd_sbp.sbp_parallel_size() != 2 || consumer_nd_sbp.sbp_parallel_size() != 2) {
+    return false;
+  }
+  for (int32_t i = 0; i < 2; i++) {
+    if (producer_nd_sbp.sbp_parallel(i) == consumer_nd_sbp.sbp_parallel(i)) { return false; }
+    if (producer_nd_sbp.sbp_parallel(i).has_partial_sum_parallel()
+        || consumer_nd_sbp.sbp_parallel(i).has_partial_sum_parallel()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void ResizeNdSbpSignature(NdSbpSignature& nd_sbp_sig, int32_t size) {
   for (auto& pair : *nd_sbp_sig.mutable_bn_in_op2nd_sbp()) {
     if (pair.second.sbp_parallel_size() > size) { pair.second.clear_sbp_parallel(); }
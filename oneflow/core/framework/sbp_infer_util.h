@@ -25,6 +25,13 @@ double GetValidMaxCopyCost();
 
 double GetTransferCost();
 
+// Whether a 2D transition between split/broadcast nd_sbps that differ on both hierarchy dims is
+// done by one direct nccl send/recv instead of boxing through a middle nd_sbp
+bool IsBoxingBy2DSendRecvEnabled();
+
+// (S/B, S/B) -> (S/B, S/B) on the same 2D hierarchy, where both dims change
+bool CanBoxingBy2DSendRecv(const NdSbp& producer_nd_sbp, const NdSbp& consumer_nd_sbp);
+
 void ResizeNdSbpSignature(NdSbpSignature& nd_sbp_sig, int32_t size);
 
 void SetNdSbpSignature(NdSbpSignature* nd_sbp_signature, const SbpSignature& sbp_signature,
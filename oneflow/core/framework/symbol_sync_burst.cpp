@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/symbol_sync_burst.h"
+#include "oneflow/core/job/rank_group_scope.h"
+#include "oneflow/core/common/constant.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct DeferredSymbolSync {
+  std::shared_ptr<AsyncTransportCtx> ctx;
+  std::function<Maybe<void>()> Check;
+};
+
+std::vector<DeferredSymbolSync>* MutThreadLocalDeferredSymbolSyncs() {
+  static thread_local std::vector<DeferredSymbolSync> deferred_syncs;
+  return &deferred_syncs;
+}
+
+bool IsSymbolSyncBatchingEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_ENABLE_SYMBOL_SYNC_BATCHING", true);
+  return enabled;
+}
+
+}  // namespace
+
+namespace private_details {
+
+int64_t* MutThreadLocalSymbolSyncBurstDepth() {
+  static thread_local int64_t depth = 0;
+  return &depth;
+}
+
+Maybe<void> WaitDeferredSymbolSyncs() {
+  std::vector<DeferredSymbolSync> deferred_syncs;
+  deferred_syncs.swap(*MutThreadLocalDeferredSymbolSyncs());
+  for (const auto& deferred_sync : deferred_syncs) {
+    JUST_MSG(deferred_sync.ctx->WaitDone(), kAsymmetricCodeErrorMsg);
+  }
+  for (const auto& deferred_sync : deferred_syncs) { JUST(deferred_sync.Check()); }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace private_details
+
+Maybe<void> WaitOrDeferSymbolSync(const std::shared_ptr<AsyncTransportCtx>& ctx,
+                                  const std::function<Maybe<void>()>& Check) {
+  if (IsSymbolSyncBatchingEnabled() && *private_details::MutThreadLocalSymbolSyncBurstDepth() > 0
+      && JUST(RankGroupScope::CurrentRankGroup()) == JUST(RankGroupScope::RootRankGroup())) {
+    MutThreadLocalDeferredSymbolSyncs()->emplace_back(DeferredSymbolSync{ctx, Check});
+    return Maybe<void>::Ok();
+  }
+  JUST_MSG(ctx->WaitDone(), kAsymmetricCodeErrorMsg);
+  JUST(Check());
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
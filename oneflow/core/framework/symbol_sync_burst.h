@@ -0,0 +1,61 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_SYMBOL_SYNC_BURST_H_
+#define ONEFLOW_CORE_FRAMEWORK_SYMBOL_SYNC_BURST_H_
+
+#include <functional>
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/transport_util.h"
+
+namespace oneflow {
+
+namespace private_details {
+
+int64_t* MutThreadLocalSymbolSyncBurstDepth();
+
+Maybe<void> WaitDeferredSymbolSyncs();
+
+}  // namespace private_details
+
+// A symbol sync only verifies that every rank assigned the same id to the same symbol, the id is
+// usable as soon as the sync is launched. Within a burst (a call decorated with
+// BatchSymbolSyncs) the syncs of new symbols of the root rank group are launched without waiting
+// for each other, and all of them are awaited and checked together when the burst ends. So the
+// first calls of an op with many new placements, sbps and tensor metas pay one round trip instead
+// of one per symbol. Disabled with ONEFLOW_ENABLE_SYMBOL_SYNC_BATCHING=0.
+Maybe<void> WaitOrDeferSymbolSync(const std::shared_ptr<AsyncTransportCtx>& ctx,
+                                  const std::function<Maybe<void>()>& Check);
+
+template<typename... Args>
+struct BatchSymbolSyncs;
+
+template<typename... Args>
+struct BatchSymbolSyncs<Maybe<void>, Args...> {
+  template<Maybe<void> (*func)(Args...)>
+  static Maybe<void> Call(Args... args) {
+    int64_t* depth = private_details::MutThreadLocalSymbolSyncBurstDepth();
+    ++*depth;
+    Maybe<void> ret = func(args...);
+    --*depth;
+    // Always check the launched syncs even if `func` failed.
+    if (*depth == 0) { JUST(private_details::WaitDeferredSymbolSyncs()); }
+    return ret;
+  }
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_SYMBOL_SYNC_BURST_H_
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/sync_symbol_consistent_tensor_meta.h"
+#include "oneflow/core/framework/symbol_sync_burst.h"
 #include "oneflow/core/framework/sync_symbol_parallel_desc.h"
 #include "oneflow/core/framework/sync_symbol_nd_sbp.h"
 #include "oneflow/core/framework/rank_group_rpc_util.h"
@@ -69,9 +70,10 @@ Maybe<void> SyncSymbolConsistentTensorMeta(
   const auto& transport_token =
       JUST(TransportToken::NewTransportToken(kTransportTokenTypeSyncSymbolConsistentTensorMeta));
   const auto& recv_buffer = std::make_shared<FlatConsistentTensorMeta>();
-  NaiveAsyncTransportCtx ctx(
+  const auto& ctx = std::make_shared<NaiveAsyncTransportCtx>(
       transport_token,
-      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+      [symbol_id, consistent_tensor_meta](void** buffer, std::size_t* size,
+                                         std::function<void()>* Cb) -> Maybe<void> {
         const auto& send_buffer =
             JUST(FlatConsistentTensorMeta::New(symbol_id, consistent_tensor_meta));
         *buffer = send_buffer.get();
@@ -86,10 +88,12 @@ Maybe<void> SyncSymbolConsistentTensorMeta(
         return Maybe<void>::Ok();
       });
   const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
-  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-  JUST(ctx.WaitDone());
-  JUST(recv_buffer->Check(symbol_id, consistent_tensor_meta));
+  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(WaitOrDeferSymbolSync(ctx,
+                             [recv_buffer, symbol_id, consistent_tensor_meta]() -> Maybe<void> {
+                               return recv_buffer->Check(symbol_id, consistent_tensor_meta);
+                             }));
   return Maybe<void>::Ok();
 }
 
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/intrusive/flat_msg.h"
 #include "oneflow/core/framework/sync_symbol_nd_sbp.h"
+#include "oneflow/core/framework/symbol_sync_burst.h"
 #include "oneflow/core/framework/rank_group_rpc_util.h"
 #include "oneflow/core/job/rank_group_scope.h"
 #include "oneflow/core/job/sbp_parallel.h"
@@ -147,11 +148,11 @@ Maybe<void> SyncSymbolNdSbp(uint64_t symbol_id, Symbol<NdSbp> symbol) {
   const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
   const auto& transport_token =
       JUST(TransportToken::NewTransportToken(kTransportTokenTypeSyncSymbolNdSbp));
-  FlatNdSbpAsyncTransportCtx ctx(transport_token, symbol_id, symbol);
-  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-  JUST_MSG(ctx.WaitDone(), kAsymmetricCodeErrorMsg);
-  JUST(ctx.Check());
+  const auto& ctx =
+      std::make_shared<FlatNdSbpAsyncTransportCtx>(transport_token, symbol_id, symbol);
+  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(WaitOrDeferSymbolSync(ctx, [ctx]() -> Maybe<void> { return ctx->Check(); }));
   return Maybe<void>::Ok();
 }
 
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/sync_symbol_parallel_desc.h"
+#include "oneflow/core/framework/symbol_sync_burst.h"
 #include "oneflow/core/framework/rank_group_rpc_util.h"
 #include "oneflow/core/job/rank_group_scope.h"
 #include "oneflow/core/job/parallel_desc.h"
@@ -72,9 +73,10 @@ Maybe<void> SyncSymbolParallelDesc(uint64_t symbol_id, Symbol<ParallelDesc> para
   const auto& transport_token =
       JUST(TransportToken::NewTransportToken(kTransportTokenTypeSyncSymbolParallelDesc));
   const auto& recv_buffer = std::make_shared<FlatParallelConf>();
-  NaiveAsyncTransportCtx ctx(
+  const auto& ctx = std::make_shared<NaiveAsyncTransportCtx>(
       transport_token,
-      [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
+      [symbol_id, parallel_desc](void** buffer, std::size_t* size,
+                                std::function<void()>* Cb) -> Maybe<void> {
         const auto& send_buffer = JUST(FlatParallelConf::New(symbol_id, parallel_desc));
         *buffer = send_buffer.get();
         *size = send_buffer->available_size();
@@ -88,10 +90,11 @@ Maybe<void> SyncSymbolParallelDesc(uint64_t symbol_id, Symbol<ParallelDesc> para
         return Maybe<void>::Ok();
       });
   const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
-  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-  JUST_MSG(ctx.WaitDone(), kAsymmetricCodeErrorMsg);
-  JUST(recv_buffer->Check(symbol_id, parallel_desc));
+  JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, ctx.get()));
+  JUST(WaitOrDeferSymbolSync(ctx, [recv_buffer, symbol_id, parallel_desc]() -> Maybe<void> {
+    return recv_buffer->Check(symbol_id, parallel_desc);
+  }));
   return Maybe<void>::Ok();
 }
 
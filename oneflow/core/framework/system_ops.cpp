@@ -91,6 +91,10 @@ Maybe<AttrVal> ImageDecoderRandomCropResizeOp::GetAttr(const std::string& attr_n
     return CastAttrValue(&random_aspect_ratio_min);
   } else if (attr_name == "random_aspect_ratio_max") {
     return CastAttrValue(&random_aspect_ratio_max);
+  } else if (attr_name == "mean") {
+    return CastAttrValue(&mean);
+  } else if (attr_name == "std") {
+    return CastAttrValue(&std);
   } else {
     return Error::RuntimeError() << "FeedVariable op has no attribute named " << attr_name;
   }
@@ -107,7 +111,9 @@ const HashSet<std::string>& ImageDecoderRandomCropResizeOp::AttrNames() const {
                                          "random_area_min",
                                          "random_area_max",
                                          "random_aspect_ratio_min",
-                                         "random_aspect_ratio_max"};
+                                         "random_aspect_ratio_max",
+                                         "mean",
+                                         "std"};
   return attr_names;
 }
 
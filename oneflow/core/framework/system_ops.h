@@ -81,6 +81,8 @@ class ImageDecoderRandomCropResizeOp : public OpBase {
   float random_area_max;
   float random_aspect_ratio_min;
   float random_aspect_ratio_max;
+  std::vector<float> mean;
+  std::vector<float> std;
 };
 
 }  // namespace schema
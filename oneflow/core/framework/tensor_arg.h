@@ -18,6 +18,7 @@ limitations under the License.
 #define ONEFLOW_CORE_FRAMEWORK_TENSOR_ARG_H_
 
 #include <memory>
+#include <mutex>
 #include <vector>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/autograd/autograd_meta.h"
@@ -28,7 +29,7 @@ namespace one {
 class Tensor;
 
 // This class will be used in TensorImpl and Autograd. It will share data with different
-// FunctionNodes.
+// FunctionNodes, which may run on different threads in a parallel backward.
 class TensorArg final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(TensorArg);
@@ -41,6 +42,7 @@ class TensorArg final {
   Maybe<Tensor> GetAccTensor(const std::vector<AutogradMeta::Hook>& hooks);
 
  private:
+  mutable std::mutex mutex_;
   std::shared_ptr<Tensor> acc_tensor_;
 };
 
@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/framework/tensor_methods.h"
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/autograd/checkpoint.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/eager/eager_blob_object.h"
@@ -38,6 +39,8 @@ bool IsEnvViewDisabled() {
 
 bool IsViewApplicable(const std::shared_ptr<Tensor>& input) {
   if (IsEnvViewDisabled()) { return false; }
+  // Views bypass the interpreter, so they can not be recorded by checkpointed segments.
+  if (CurrentCheckpointRecorder()) { return false; }
   // NOTE: only eager local tensor support view for now
   // elem_cnt() >= 1  used to excluding 0 shape tensor
   if (input->is_local() && !(LazyMode::is_enabled()) && input->shape()->elem_cnt() >= 1) {
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/sync_symbol_nd_sbp.h"
 #include "oneflow/core/framework/synced_symbol_map.h"
 #include "oneflow/core/framework/rank_group_rpc_util.h"
+#include "oneflow/core/framework/batched_consistency_check.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/common/flat_shape.h"
 #include "oneflow/core/common/shape_vec.h"
@@ -158,12 +159,23 @@ int64_t* MutThreadLocalTensorMetaCheckDepth() {
 
 Maybe<CheckConsistencyAsyncTransportCtx> LaunchTensorMetaConsistencyCheck(
     const one::Tensor& tensor) {
-  const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
-  const auto& transport_token =
-      JUST(TransportToken::NewTransportToken(kTransportTokenTypeCheckTensorConsistency));
   const auto& tensor_meta = JUST(tensor.consistent_tensor_meta());
   const auto& constaint = JUST(tensor.consumer_nd_sbp_constraint());
   const TransportToken& tensor_transport_token = JUST(tensor.transport_token());
+  if (JUST(IsConsistencyCheckBatched())) {
+    const auto& flat_tensor_consistency =
+        JUST(FlatTensorConsistency::New(tensor_meta, constaint, tensor_transport_token));
+    JUST(FoldIntoConsistencyDigest(
+        {flat_tensor_consistency->synced_tensor_meta_symbol_id(),
+         flat_tensor_consistency->has_consumer_nd_sbp_constraint_symbol_id()
+             ? flat_tensor_consistency->consumer_nd_sbp_constraint_symbol_id() + 1
+             : 0,
+         flat_tensor_consistency->tensor_transport_token()}));
+    return std::shared_ptr<CheckConsistencyAsyncTransportCtx>();
+  }
+  const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
+  const auto& transport_token =
+      JUST(TransportToken::NewTransportToken(kTransportTokenTypeCheckTensorConsistency));
   const auto& ctx = std::make_shared<CheckConsistencyAsyncTransportCtx>(
       transport_token, tensor_meta, constaint, tensor_transport_token);
   JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, ctx.get()));
@@ -172,6 +184,8 @@ Maybe<CheckConsistencyAsyncTransportCtx> LaunchTensorMetaConsistencyCheck(
 }
 
 Maybe<void> BusyWaitAndCheck(std::shared_ptr<CheckConsistencyAsyncTransportCtx>& ctx) {
+  // The check was folded into the batched consistency digest.
+  if (!ctx) { return Maybe<void>::Ok(); }
   JUST_MSG(ctx->WaitDone(), kAsymmetricCodeErrorMsg);
   JUST(ctx->Check());
   return Maybe<void>::Ok();
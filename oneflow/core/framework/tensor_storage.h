@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_FRAMEWORK_TENSOR_STORAGE_H_
 #define ONEFLOW_CORE_FRAMEWORK_TENSOR_STORAGE_H_
 
+#include <atomic>
 #include <memory>
 #include <functional>
 
@@ -45,9 +46,14 @@ class TensorStorage final {
     releaser_hook_ = std::make_shared<ReleaserHookT>(releaser_hook);
   }
 
+  // Counts the inplace modifications of the storage, shared by all views of it.
+  int64_t version() const { return version_.load(std::memory_order_relaxed); }
+  void bump_version() { version_.fetch_add(1, std::memory_order_relaxed); }
+
  private:
   std::shared_ptr<vm::TensorStorage> storage_;
   std::shared_ptr<ReleaserHookT> releaser_hook_;
+  std::atomic<int64_t> version_{0};
 };
 
 }  // namespace one
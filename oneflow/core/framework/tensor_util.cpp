@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/common/blocking_then_busy.h"
 #include "oneflow/core/vm/virtual_machine.h"
 #include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/tensor.h"
 
 namespace oneflow {
 namespace one {
@@ -34,5 +35,25 @@ Maybe<void> SyncAccessTensorWithTimeOut(const std::shared_ptr<Tensor>& tensor,
   return Maybe<void>::Ok();
 }
 
+namespace {
+
+Maybe<bool> IsVersionedTensor(const Tensor& tensor) {
+  if (dynamic_cast<const StaticZerosTensor*>(&tensor) != nullptr) { return false; }
+  if (!tensor.is_local() || tensor.is_lazy()) { return false; }
+  return tensor.has_eager_blob_object();
+}
+
+}  // namespace
+
+Maybe<int64_t> TensorVersion(const Tensor& tensor) {
+  if (!JUST(IsVersionedTensor(tensor))) { return 0; }
+  return JUST(tensor.tensor_storage())->version();
+}
+
+Maybe<void> BumpTensorVersion(const Tensor& tensor) {
+  if (JUST(IsVersionedTensor(tensor))) { JUST(tensor.tensor_storage())->bump_version(); }
+  return Maybe<void>::Ok();
+}
+
 }  // namespace one
 }  // namespace oneflow
@@ -25,5 +25,10 @@ class Tensor;
 Maybe<void> SyncAccessTensorWithTimeOut(const std::shared_ptr<Tensor>& tensor,
                                         const std::function<void(uint64_t)>& callback,
                                         const std::string& modifier);
+
+// The version of the storage of eager local tensors, it is always 0 for other tensors.
+Maybe<int64_t> TensorVersion(const Tensor& tensor);
+Maybe<void> BumpTensorVersion(const Tensor& tensor);
+
 }  // namespace one
 }  // namespace oneflow
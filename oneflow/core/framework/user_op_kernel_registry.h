@@ -65,6 +65,11 @@ using AddInplaceArgPair = std::function<Maybe<void>(
 using InplaceProposalFn = std::function<Maybe<void>(const InferContext&, AddInplaceArgPair)>;
 using IsMatchedHob = std::shared_ptr<hob::BaseExpr<user_op::KernelRegContext, bool>>;
 
+// Among the kernels matching an op, the one of the highest priority is chosen, e.g. a kernel of a
+// vendor library is registered above the generic kernel it can replace.
+constexpr int32_t kKernelPriorityDefault = 0;
+constexpr int32_t kKernelPriorityOptimized = 1;
+
 struct OpKernelRegistryResult {
   std::string op_type_name;
 
@@ -73,6 +78,7 @@ struct OpKernelRegistryResult {
   InferTmpSizeFn infer_tmp_size_fn;
   InplaceProposalFn inplace_proposal_fn;
   IsMatchedHob is_matched_hob;
+  int32_t priority = kKernelPriorityDefault;
 };
 
 class OpKernelRegistry final {
@@ -90,6 +96,7 @@ class OpKernelRegistry final {
   }
   OpKernelRegistry& SetInferTmpSizeFn(InferTmpSizeFn fn);
   OpKernelRegistry& SetInplaceProposalFn(InplaceProposalFn fn);
+  OpKernelRegistry& SetPriority(int32_t priority);
 
   Maybe<OpKernelRegistry&> Finish();
   OpKernelRegistryResult GetResult() { return result_; }
@@ -20,36 +20,101 @@ limitations under the License.
 #include "oneflow/core/framework/tensor_desc.h"
 #include "oneflow/core/kernel/kernel.pb.h"
 #include "oneflow/core/operator/operator.h"
+#include <iomanip>
 
 namespace oneflow {
 
 namespace user_op {
 
+int64_t* MutRegistrationStartNs() {
+  static thread_local int64_t start_ns = 0;
+  return &start_ns;
+}
+
 UserOpRegistryMgr& UserOpRegistryMgr::Get() {
   static UserOpRegistryMgr mgr;
   return mgr;
 }
 
+// Only called by the registrations at static initialization, which run on a single thread.
 OpRegistry UserOpRegistryMgr::CheckAndGetOpRegistry(const std::string& op_type_name) {
+  *MutRegistrationStartNs() = RegistrationNowNs();
   CHECK(!op_type_name.empty());
-  auto it = op_reg_result_.find(op_type_name);
-  CHECK(it == op_reg_result_.end());
+  CHECK(op_reg_result_.find(op_type_name) == op_reg_result_.end());
+  CHECK(op_type_name2lazy_fill_fn_.find(op_type_name) == op_type_name2lazy_fill_fn_.end());
   return OpRegistry().Name(op_type_name);
 }
 
 Maybe<void> UserOpRegistryMgr::Register(OpRegistryResult result) {
   CHECK_OR_RETURN(result.data_type_infer_fn);
+  std::unique_lock<std::mutex> lock(op_reg_result_mutex_);
+  CHECK_OR_RETURN(op_type_name2lazy_fill_fn_.find(result.op_type_name)
+                  == op_type_name2lazy_fill_fn_.end());
   CHECK_OR_RETURN(op_reg_result_.emplace(result.op_type_name, result).second);
   return Maybe<void>::Ok();
 }
 
+Maybe<void> UserOpRegistryMgr::RegisterLazy(const std::string& op_type_name,
+                                            OpRegistryFillFn fill_fn) {
+  CHECK_OR_RETURN(!op_type_name.empty());
+  std::unique_lock<std::mutex> lock(op_reg_result_mutex_);
+  CHECK_OR_RETURN(op_reg_result_.find(op_type_name) == op_reg_result_.end())
+      << "op " << op_type_name << " is registered twice";
+  CHECK_OR_RETURN(op_type_name2lazy_fill_fn_.emplace(op_type_name, fill_fn).second)
+      << "op " << op_type_name << " is registered twice";
+  return Maybe<void>::Ok();
+}
+
 const OpRegistryResult* UserOpRegistryMgr::GetOpRegistryResult(const std::string& op_type_name) {
+  std::unique_lock<std::mutex> lock(op_reg_result_mutex_);
   auto it = op_reg_result_.find(op_type_name);
+  // The elements of a HashMap do not move on insertion, so the result stays valid after unlock.
   if (it != op_reg_result_.end()) { return &(it->second); }
-  return nullptr;
+  return MaterializeLazyOp(op_type_name);
+}
+
+const HashMap<std::string, OpRegistryResult>& UserOpRegistryMgr::GetAllOpRegistryResults() {
+  std::unique_lock<std::mutex> lock(op_reg_result_mutex_);
+  std::vector<std::string> lazy_op_type_names;
+  for (const auto& pair : op_type_name2lazy_fill_fn_) { lazy_op_type_names.push_back(pair.first); }
+  for (const auto& op_type_name : lazy_op_type_names) { MaterializeLazyOp(op_type_name); }
+  return op_reg_result_;
+}
+
+// Called with op_reg_result_mutex_ held.
+const OpRegistryResult* UserOpRegistryMgr::MaterializeLazyOp(const std::string& op_type_name) {
+  auto it = op_type_name2lazy_fill_fn_.find(op_type_name);
+  if (it == op_type_name2lazy_fill_fn_.end()) { return nullptr; }
+  const int64_t start_ns = RegistrationNowNs();
+  OpRegistry registry = it->second(OpRegistry().Name(op_type_name));
+  OpRegistryResult result = CHECK_JUST(registry.Finish()).GetResult();
+  CHECK(result.data_type_infer_fn) << "No DataTypeInfer function for " << op_type_name;
+  op_type_name2lazy_fill_fn_.erase(it);
+  const OpRegistryResult* ret = &op_reg_result_.emplace(op_type_name, result).first->second;
+  RecordRegistrationTime("lazy op built on first use", RegistrationNowNs() - start_ns);
+  return ret;
+}
+
+void UserOpRegistryMgr::RecordRegistrationTime(const std::string& kind, int64_t elapsed_ns) {
+  std::unique_lock<std::mutex> lock(registration_time_mutex_);
+  auto* count_and_ns = &kind2registration_count_and_ns_[kind];
+  count_and_ns->first += 1;
+  count_and_ns->second += elapsed_ns;
+}
+
+std::string UserOpRegistryMgr::GetRegistrationTimeSummary() {
+  std::unique_lock<std::mutex> lock(registration_time_mutex_);
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  for (const auto& pair : kind2registration_count_and_ns_) {
+    ss << pair.first << ": " << pair.second.first << " registrations in "
+       << pair.second.second / 1e6 << " ms\n";
+  }
+  return ss.str();
 }
 
 OpGradRegistry UserOpRegistryMgr::CheckAndGetOpGradRegistry(const std::string& op_type_name) {
+  *MutRegistrationStartNs() = RegistrationNowNs();
   CHECK(!op_type_name.empty());
   auto it = op_grad_reg_result_.find(op_type_name);
   CHECK(it == op_grad_reg_result_.end());
@@ -69,15 +134,28 @@ const OpGradRegistryResult* UserOpRegistryMgr::GetOpGradRegistryResult(
 }
 
 OpKernelRegistry UserOpRegistryMgr::CheckAndGetOpKernelRegistry(const std::string& op_type_name) {
+  *MutRegistrationStartNs() = RegistrationNowNs();
   CHECK(!op_type_name.empty());
   return OpKernelRegistry().Name(op_type_name);
 }
 
 Maybe<void> UserOpRegistryMgr::Register(OpKernelRegistryResult result) {
-  op_kernel_reg_result_[result.op_type_name].emplace_back(result);
+  // Kept in descending priority, the kernels of the same priority in registration order.
+  auto* results = &op_kernel_reg_result_[result.op_type_name];
+  auto it = std::upper_bound(results->begin(), results->end(), result.priority,
+                             [](int32_t priority, const OpKernelRegistryResult& other) {
+                               return priority > other.priority;
+                             });
+  results->insert(it, result);
   return Maybe<void>::Ok();
 }
 
+int32_t UserOpRegistryMgr::GetOpKernelMaxPriority(const std::string& op_type_name) {
+  auto it = op_kernel_reg_result_.find(op_type_name);
+  if (it == op_kernel_reg_result_.end() || it->second.empty()) { return kKernelPriorityDefault; }
+  return it->second.front().priority;
+}
+
 namespace {
 
 std::string GetErrorMsgOfSearchedOp(const KernelRegContext& ctx) {
@@ -110,11 +188,13 @@ Maybe<const OpKernelRegistryResult*> UserOpRegistryMgr::GetOpKernelRegistryResul
 
   const OpKernelRegistryResult* ret = nullptr;
   for (const auto& reg_val : it->second) {
+    // A kernel of lower priority is only the fallback of the matched one.
+    if (ret != nullptr && reg_val.priority < ret->priority) { break; }
     if (reg_val.is_matched_hob->get(ctx)) {
       if (ret != nullptr) {
         std::vector<std::string> debug_msgs;
         for (const auto& local_reg_val : it->second) {
-          if (local_reg_val.is_matched_hob->get(ctx)) {
+          if (local_reg_val.priority == ret->priority && local_reg_val.is_matched_hob->get(ctx)) {
             debug_msgs.emplace_back(local_reg_val.is_matched_hob->DebugStr(ctx));
           }
         }
@@ -21,14 +21,20 @@ limitations under the License.
 #include "oneflow/core/framework/user_op_grad_registry.h"
 #include "oneflow/core/framework/user_op_kernel_registry.h"
 #include "oneflow/core/common/registry_error.h"
+#include <chrono>
+#include <map>
+#include <mutex>
 
 namespace oneflow {
 
 namespace user_op {
 
+// Fills an OpRegistry named by the op type, registered by REGISTER_LAZY_USER_OP.
+using OpRegistryFillFn = OpRegistry (*)(OpRegistry registry);
+
 class UserOpRegistryMgr final {
  private:
-  UserOpRegistryMgr() {}
+  UserOpRegistryMgr() = default;
 
  public:
   UserOpRegistryMgr(UserOpRegistryMgr const&) = delete;
@@ -38,6 +44,10 @@ class UserOpRegistryMgr final {
  public:
   OpRegistry CheckAndGetOpRegistry(const std::string& op_type_name);
   Maybe<void> Register(OpRegistryResult result);
+  // Only the name is registered at static initialization, the OpRegistryResult with its infer
+  // functions and attr definitions is built by `fill_fn` the first time the op is looked up.
+  Maybe<void> RegisterLazy(const std::string& op_type_name, OpRegistryFillFn fill_fn);
+  // Thread safe, the results of the lazy ops are built on demand.
   const OpRegistryResult* GetOpRegistryResult(const std::string& op_type_name);
 
   OpGradRegistry CheckAndGetOpGradRegistry(const std::string& op_type_name);
@@ -48,23 +58,59 @@ class UserOpRegistryMgr final {
   Maybe<void> Register(OpKernelRegistryResult result);
   Maybe<const OpKernelRegistryResult*> GetOpKernelRegistryResult(const std::string& op_type_name,
                                                                  const KernelRegContext& ctx);
+  int32_t GetOpKernelMaxPriority(const std::string& op_type_name);
+
+  // Builds the results of all the lazy ops.
+  const HashMap<std::string, OpRegistryResult>& GetAllOpRegistryResults();
 
-  const HashMap<std::string, OpRegistryResult>& GetAllOpRegistryResults() {
-    return op_reg_result_;
-  };
+  // Time spent in the registrations at static initialization, and in building the results of the
+  // lazy ops since, one line per kind.
+  void RecordRegistrationTime(const std::string& kind, int64_t elapsed_ns);
+  std::string GetRegistrationTimeSummary();
 
  private:
+  const OpRegistryResult* MaterializeLazyOp(const std::string& op_type_name);
+
+  std::mutex op_reg_result_mutex_;
   HashMap<std::string, OpRegistryResult> op_reg_result_;
+  HashMap<std::string, OpRegistryFillFn> op_type_name2lazy_fill_fn_;
+  std::mutex registration_time_mutex_;
+  std::map<std::string, std::pair<int64_t, int64_t>> kind2registration_count_and_ns_;
   HashMap<std::string, OpGradRegistryResult> op_grad_reg_result_;
   HashMap<std::string, std::vector<OpKernelRegistryResult>> op_kernel_reg_result_;
 };
 
+inline int64_t RegistrationNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// When the registration running on this thread started, set by UserOpRegistryMgr::CheckAndGet*.
+int64_t* MutRegistrationStartNs();
+
+inline const char* RegistrationKind(const OpRegistry&) { return "op"; }
+inline const char* RegistrationKind(const OpGradRegistry&) { return "op grad"; }
+inline const char* RegistrationKind(const OpKernelRegistry&) { return "op kernel"; }
+
 template<typename RegistryT>
 struct UserOpRegisterTrigger final {
   UserOpRegisterTrigger(RegistryT& registry) {
     CatchRegistryError([&]() -> Maybe<void> {
       return UserOpRegistryMgr::Get().Register(JUST(registry.Finish()).GetResult());
     });
+    UserOpRegistryMgr::Get().RecordRegistrationTime(
+        RegistrationKind(registry), RegistrationNowNs() - *MutRegistrationStartNs());
+  }
+};
+
+struct LazyUserOpRegisterTrigger final {
+  LazyUserOpRegisterTrigger(const std::string& op_type_name, OpRegistryFillFn fill_fn) {
+    const int64_t start = RegistrationNowNs();
+    CatchRegistryError([&]() -> Maybe<void> {
+      return UserOpRegistryMgr::Get().RegisterLazy(op_type_name, fill_fn);
+    });
+    UserOpRegistryMgr::Get().RecordRegistrationTime("lazy op", RegistrationNowNs() - start);
   }
 };
 
@@ -77,6 +123,14 @@ struct UserOpRegisterTrigger final {
       g_register_trigger, __COUNTER__) =                                                      \
       ::oneflow::user_op::UserOpRegistryMgr::Get().CheckAndGetOpRegistry(name)
 
+// `fill_fn` is a function, or a lambda without captures, taking and returning an OpRegistry, e.g.
+//   REGISTER_LAZY_USER_OP("relu", [](user_op::OpRegistry registry) {
+//     return registry.Input("x").Output("y").SetGetSbpFn(...)...;
+//   });
+#define REGISTER_LAZY_USER_OP(name, fill_fn)                                        \
+  static ::oneflow::user_op::LazyUserOpRegisterTrigger OF_PP_CAT(g_register_trigger, \
+                                                                 __COUNTER__)(name, fill_fn)
+
 #define REGISTER_CPU_ONLY_USER_OP(name) REGISTER_USER_OP(name).SupportCpuOnly()
 
 #define REGISTER_NO_GRAD_USER_OP(name) REGISTER_USER_OP(name).NoGrad()
@@ -2284,6 +2284,42 @@ class UnsortedBatchSegmentSumFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class PaddedToPackedFunctor {
+ public:
+  PaddedToPackedFunctor() {
+    op_ = CHECK_JUST(
+        one::OpBuilder("padded_to_packed").Input("in").Input("cu_seqlens").Output("out").Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
+                           const std::shared_ptr<one::Tensor>& cu_seqlens,
+                           const int64_t& total_len) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("total_len", total_len));
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {input, cu_seqlens}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class PackedToPaddedFunctor {
+ public:
+  PackedToPaddedFunctor() {
+    op_ = CHECK_JUST(
+        one::OpBuilder("packed_to_padded").Input("in").Input("cu_seqlens").Output("out").Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
+                           const std::shared_ptr<one::Tensor>& cu_seqlens,
+                           const int64_t& max_seqlen) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("max_seqlen", max_seqlen));
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {input, cu_seqlens}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
 class MaskedFillFunctor {
  public:
   MaskedFillFunctor() {
@@ -2808,6 +2844,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::SplitWithSizeFunctor>("SplitWithSize");
   m.add_functor<impl::BatchGatherFunctor>("BatchGather");
   m.add_functor<impl::UnsortedBatchSegmentSumFunctor>("UnsortedBatchSegmentSum");
+  m.add_functor<impl::PaddedToPackedFunctor>("PaddedToPacked");
+  m.add_functor<impl::PackedToPaddedFunctor>("PackedToPadded");
   m.add_functor<impl::MaskedFillFunctor>("MaskedFill");
   m.add_functor<impl::MeshgridFunctor>("Meshgrid");
   m.add_functor<impl::ToFunctor, impl::To2Functor, impl::To3Functor, impl::To4Functor>("To");
@@ -35,8 +35,10 @@ limitations under the License.
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/user/kernels/random_mask_like_kernel.h"
 #include "oneflow/user/kernels/dropout_kernel.h"
+#include "oneflow/user/kernels/distributions/common.h"
 #include "oneflow/core/register/ofblob.h"
 #include "oneflow/core/common/container_util.h"
+#include "oneflow/core/autograd/autograd_mode.h"
 
 namespace oneflow {
 namespace one {
@@ -264,6 +266,58 @@ class BatchMatMulFunctor {
   std::shared_ptr<OpExpr> batch_matmul_op_;
 };
 
+class QuantizedMatmulFunctor {
+ public:
+  QuantizedMatmulFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("quantized_matmul")
+                         .Input("a")
+                         .Input("b")
+                         .Input("a_scale")
+                         .Input("b_scale")
+                         .Output("out")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& a,
+                           const std::shared_ptr<one::Tensor>& b,
+                           const std::shared_ptr<one::Tensor>& a_scale,
+                           const std::shared_ptr<one::Tensor>& b_scale, const bool& transpose_b,
+                           const double& alpha) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<bool>("transpose_b", transpose_b));
+    JUST(attrs.SetAttr<double>("alpha", alpha));
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {a, b, a_scale, b_scale}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class Fp8MatmulFunctor {
+ public:
+  Fp8MatmulFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("fp8_matmul")
+                         .Input("a")
+                         .Input("b")
+                         .Input("a_amax_history")
+                         .Input("b_amax_history")
+                         .Output("out")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& a,
+                           const std::shared_ptr<one::Tensor>& b,
+                           const std::shared_ptr<one::Tensor>& a_amax_history,
+                           const std::shared_ptr<one::Tensor>& b_amax_history,
+                           const bool& transpose_b, const double& alpha) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<bool>("transpose_b", transpose_b));
+    JUST(attrs.SetAttr<double>("alpha", alpha));
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {a, b, a_amax_history, b_amax_history}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
 class FusedMLPFunctor {
  public:
   FusedMLPFunctor() {
@@ -2158,6 +2212,433 @@ class FusedScaleMaskSoftmaxDropoutFunctor {
   std::shared_ptr<OpExpr> fused_scale_mask_softmax_dropout_op_;
 };
 
+class FusedAttentionFunctor {
+ public:
+  FusedAttentionFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("fused_attention")
+                         .Input("query")
+                         .Input("key")
+                         .Input("value")
+                         .Output("out")
+                         .Output("softmax_lse")
+                         .Output("rng_state")
+                         .Build());
+    masked_op_ = CHECK_JUST(one::OpBuilder("fused_attention")
+                                .Input("query")
+                                .Input("key")
+                                .Input("value")
+                                .Input("key_mask")
+                                .Output("out")
+                                .Output("softmax_lse")
+                                .Output("rng_state")
+                                .Build());
+    packed_op_ = CHECK_JUST(one::OpBuilder("fused_attention")
+                                .Input("query")
+                                .Input("key")
+                                .Input("value")
+                                .Input("cu_seqlens_q")
+                                .Input("cu_seqlens_k")
+                                .Output("out")
+                                .Output("softmax_lse")
+                                .Output("rng_state")
+                                .Build());
+  }
+  Maybe<Tensor> operator()(
+      const std::shared_ptr<one::Tensor>& query, const std::shared_ptr<one::Tensor>& key,
+      const std::shared_ptr<one::Tensor>& value, const Optional<one::Tensor>& key_mask,
+      const Optional<float>& scale, const bool& causal, const float& p, const bool& training,
+      const Optional<one::Generator>& generator, const Optional<one::Tensor>& cu_seqlens_q,
+      const Optional<one::Tensor>& cu_seqlens_k, const int64_t& max_seqlen_q,
+      const int64_t& max_seqlen_k) const {
+    CHECK_EQ_OR_RETURN(query->ndim(), 4)
+        << "fused_attention expects query of shape [batch, num_heads, seq_len, head_size]";
+    CHECK_EQ_OR_RETURN(cu_seqlens_q.has_value(), cu_seqlens_k.has_value())
+        << "fused_attention expects both cu_seqlens_q and cu_seqlens_k for packed sequences";
+    const int64_t head_size = query->shape()->At(3);
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>(
+        "scale", scale ? JUST(scale) : 1.0f / std::sqrt(static_cast<float>(head_size))));
+    JUST(attrs.SetAttr<bool>("causal", causal));
+    JUST(attrs.SetAttr<float>("dropout_rate", training ? p : 0.0f));
+    JUST(attrs.SetAttr<int64_t>("max_seqlen_q", max_seqlen_q));
+    JUST(attrs.SetAttr<int64_t>("max_seqlen_k", max_seqlen_k));
+    const auto gen = generator.value_or(JUST(one::DefaultAutoGenerator()));
+    const auto& dropout_state = std::make_shared<FusedDropoutKernelState>(gen);
+    std::shared_ptr<TensorTuple> outputs;
+    if (cu_seqlens_q) {
+      CHECK_OR_RETURN(!key_mask) << "fused_attention does not take key_mask for packed sequences";
+      outputs = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *packed_op_, {query, key, value, JUST(cu_seqlens_q), JUST(cu_seqlens_k)},
+          OpExprInterpContext(attrs, dropout_state)));
+    } else if (key_mask) {
+      outputs = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *masked_op_, {query, key, value, JUST(key_mask)},
+          OpExprInterpContext(attrs, dropout_state)));
+    } else {
+      outputs = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *op_, {query, key, value}, OpExprInterpContext(attrs, dropout_state)));
+    }
+    return outputs->at(0);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> masked_op_;
+  std::shared_ptr<OpExpr> packed_op_;
+};
+
+class EmbeddingBagFunctor {
+ public:
+  EmbeddingBagFunctor() {
+    op_ = CHECK_JUST(
+        one::OpBuilder("embedding_bag").Input("weight").Input("indices").Output("out").Build());
+    weighted_op_ = CHECK_JUST(one::OpBuilder("embedding_bag")
+                                  .Input("weight")
+                                  .Input("indices")
+                                  .Input("per_sample_weights")
+                                  .Output("out")
+                                  .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& indices,
+                           const std::shared_ptr<one::Tensor>& weight,
+                           const Optional<one::Tensor>& per_sample_weights,
+                           const std::string& mode, const int64_t& padding_idx) const {
+    CHECK_EQ_OR_RETURN(indices->ndim(), 2)
+        << "embedding_bag expects indices of shape [batch_size, bag_size]";
+    CHECK_EQ_OR_RETURN(weight->ndim(), 2)
+        << "embedding_bag expects weight of shape [num_embeddings, embedding_dim]";
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("mode", mode));
+    JUST(attrs.SetAttr<int64_t>("padding_idx", padding_idx));
+    if (per_sample_weights) {
+      return OpInterpUtil::Dispatch<Tensor>(*weighted_op_,
+                                            {weight, indices, JUST(per_sample_weights)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {weight, indices}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> weighted_op_;
+};
+
+class FusedLinearCrossEntropyFunctor {
+ public:
+  FusedLinearCrossEntropyFunctor() {
+    stat_op_ = CHECK_JUST(one::OpBuilder("fused_linear_cross_entropy_stat")
+                              .Input("x")
+                              .Input("weight")
+                              .Output("max")
+                              .Output("sum_exp")
+                              .Build());
+    op_ = CHECK_JUST(one::OpBuilder("fused_linear_cross_entropy")
+                         .Input("x")
+                         .Input("weight")
+                         .Input("label")
+                         .Input("log_sum_exp")
+                         .Output("out")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x,
+                           const std::shared_ptr<one::Tensor>& weight,
+                           const std::shared_ptr<one::Tensor>& label, const int64_t& ignore_index,
+                           const int64_t& chunk_size) const {
+    CHECK_GE_OR_RETURN(x->ndim(), 1)
+        << "fused_linear_cross_entropy expects x of shape [..., hidden_size]";
+    CHECK_EQ_OR_RETURN(weight->ndim(), 2)
+        << "fused_linear_cross_entropy expects weight of shape [num_classes, hidden_size]";
+    const int64_t hidden_size = x->shape()->At(x->ndim() - 1);
+    const auto& flat_x = JUST(functional::Reshape(x, Shape({-1, hidden_size})));
+    const auto& flat_label = JUST(functional::Flatten(label, 0, -1));
+    MutableAttrMap stat_attrs;
+    JUST(stat_attrs.SetAttr<int64_t>("chunk_size", chunk_size));
+    std::shared_ptr<one::Tensor> log_sum_exp;
+    {
+      // The statistics of every part of the classes are merged into log_sum_exp, which the loss
+      // only reads, so the merge needs no backward.
+      autograd::AutoGradMode mode(false);
+      const auto& stat = JUST(OpInterpUtil::Dispatch<TensorTuple>(*stat_op_, {flat_x, weight},
+                                                                  stat_attrs));
+      const auto& max = JUST(functional::ReduceMax(stat->at(0), {1}, /*keepdims=*/true));
+      const auto& sum_exp = JUST(functional::ReduceSum(
+          JUST(functional::Mul(stat->at(1),
+                               JUST(functional::Exp(JUST(functional::Sub(
+                                   stat->at(0), max, /*inplace=*/false)))))),
+          {1}, /*keepdims=*/false));
+      log_sum_exp = JUST(functional::Add(JUST(functional::Flatten(max, 0, -1)),
+                                         JUST(functional::Log(sum_exp)), /*alpha=*/1,
+                                         /*inplace=*/false));
+    }
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("chunk_size", chunk_size));
+    JUST(attrs.SetAttr<int64_t>("ignore_index", ignore_index));
+    const auto& out = JUST(
+        OpInterpUtil::Dispatch<Tensor>(*op_, {flat_x, weight, flat_label, log_sum_exp}, attrs));
+    return functional::Reshape(out, *label->shape());
+  }
+
+ private:
+  std::shared_ptr<OpExpr> stat_op_;
+  std::shared_ptr<OpExpr> op_;
+};
+
+class MoeGatingFunctor {
+ public:
+  MoeGatingFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("moe_gating")
+                         .Input("logits")
+                         .Output("expert_indices")
+                         .Output("locations")
+                         .Output("gates")
+                         .Output("probs")
+                         .Output("aux_loss")
+                         .Build());
+  }
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& logits, const int64_t& top_k,
+                                const int64_t& capacity) const {
+    CHECK_EQ_OR_RETURN(logits->ndim(), 2)
+        << "moe_gating expects logits of shape [num_tokens, num_experts]";
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("top_k", top_k));
+    JUST(attrs.SetAttr<int64_t>("capacity", capacity));
+    return OpInterpUtil::Dispatch<TensorTuple>(*op_, {logits}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class MoeRoutingFunctor {
+ public:
+  explicit MoeRoutingFunctor(const std::string& op_type_name) {
+    op_ = CHECK_JUST(one::OpBuilder(op_type_name)
+                         .Input("in")
+                         .Input("expert_indices")
+                         .Input("locations")
+                         .Output("out")
+                         .Build());
+    gated_op_ = CHECK_JUST(one::OpBuilder(op_type_name)
+                               .Input("in")
+                               .Input("expert_indices")
+                               .Input("locations")
+                               .Input("gates")
+                               .Output("out")
+                               .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x,
+                           const std::shared_ptr<one::Tensor>& expert_indices,
+                           const std::shared_ptr<one::Tensor>& locations,
+                           const Optional<one::Tensor>& gates, const int64_t& num_experts,
+                           const int64_t& capacity) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("num_experts", num_experts));
+    JUST(attrs.SetAttr<int64_t>("capacity", capacity));
+    if (gates) {
+      return OpInterpUtil::Dispatch<Tensor>(*gated_op_,
+                                            {x, expert_indices, locations, JUST(gates)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {x, expert_indices, locations}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> gated_op_;
+};
+
+class MoeDispatchFunctor : public MoeRoutingFunctor {
+ public:
+  MoeDispatchFunctor() : MoeRoutingFunctor("moe_dispatch") {}
+};
+
+class MoeCombineFunctor : public MoeRoutingFunctor {
+ public:
+  MoeCombineFunctor() : MoeRoutingFunctor("moe_combine") {}
+};
+
+class PagedKvCacheAppendFunctor {
+ public:
+  PagedKvCacheAppendFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("paged_kv_cache_append")
+                         .Input("key_cache")
+                         .Input("value_cache")
+                         .Input("key")
+                         .Input("value")
+                         .Input("slot_mapping")
+                         .Build());
+  }
+  Maybe<void> operator()(const std::shared_ptr<one::Tensor>& key_cache,
+                         const std::shared_ptr<one::Tensor>& value_cache,
+                         const std::shared_ptr<one::Tensor>& key,
+                         const std::shared_ptr<one::Tensor>& value,
+                         const std::shared_ptr<one::Tensor>& slot_mapping) const {
+    JUST(OpInterpUtil::Dispatch<TensorTuple>(*op_,
+                                             {key_cache, value_cache, key, value, slot_mapping}));
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class PagedDecodeAttentionFunctor {
+ public:
+  PagedDecodeAttentionFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("paged_decode_attention")
+                         .Input("query")
+                         .Input("key_cache")
+                         .Input("value_cache")
+                         .Input("block_tables")
+                         .Input("context_lens")
+                         .Output("out")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& query,
+                           const std::shared_ptr<one::Tensor>& key_cache,
+                           const std::shared_ptr<one::Tensor>& value_cache,
+                           const std::shared_ptr<one::Tensor>& block_tables,
+                           const std::shared_ptr<one::Tensor>& context_lens,
+                           const Optional<float>& scale) const {
+    CHECK_EQ_OR_RETURN(query->ndim(), 3)
+        << "query should be of shape [batch_size, num_heads, head_dim]";
+    const int64_t head_size = query->shape()->At(2);
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>(
+        "scale", scale ? JUST(scale) : 1.0f / std::sqrt(static_cast<float>(head_size))));
+    return OpInterpUtil::Dispatch<Tensor>(
+        *op_, {query, key_cache, value_cache, block_tables, context_lens}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class PagedKvCacheReorderBeamsFunctor {
+ public:
+  PagedKvCacheReorderBeamsFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("paged_kv_cache_reorder_beams")
+                         .Input("key_cache")
+                         .Input("value_cache")
+                         .Input("block_tables")
+                         .Input("context_lens")
+                         .Input("parent_beams")
+                         .Build());
+  }
+  Maybe<void> operator()(const std::shared_ptr<one::Tensor>& key_cache,
+                         const std::shared_ptr<one::Tensor>& value_cache,
+                         const std::shared_ptr<one::Tensor>& block_tables,
+                         const std::shared_ptr<one::Tensor>& context_lens,
+                         const std::shared_ptr<one::Tensor>& parent_beams) const {
+    JUST(OpInterpUtil::Dispatch<TensorTuple>(
+        *op_, {key_cache, value_cache, block_tables, context_lens, parent_beams}));
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class FusedDecodeStepFunctor {
+ public:
+  FusedDecodeStepFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("fused_decode_step")
+                         .Input("logits")
+                         .Input("scores")
+                         .Input("finished")
+                         .Input("lengths")
+                         .Output("next_tokens")
+                         .Output("out_scores")
+                         .Output("out_finished")
+                         .Output("out_lengths")
+                         .Output("parent_beams")
+                         .Build());
+  }
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& logits,
+                                const std::shared_ptr<one::Tensor>& scores,
+                                const std::shared_ptr<one::Tensor>& finished,
+                                const std::shared_ptr<one::Tensor>& lengths,
+                                const std::string& mode, const float& temperature,
+                                const int64_t& top_k, const float& top_p,
+                                const float& length_penalty, const int64_t& eos_token_id,
+                                const int64_t& pad_token_id,
+                                const Optional<one::Generator>& generator) const {
+    CHECK_EQ_OR_RETURN(logits->ndim(), 3)
+        << "logits should be of shape [batch_size, num_beams, vocab_size]";
+    const auto gen = generator.value_or(JUST(one::DefaultAutoGenerator()));
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("mode", mode));
+    JUST(attrs.SetAttr<float>("temperature", temperature));
+    JUST(attrs.SetAttr<int64_t>("top_k", top_k));
+    JUST(attrs.SetAttr<float>("top_p", top_p));
+    JUST(attrs.SetAttr<float>("length_penalty", length_penalty));
+    JUST(attrs.SetAttr<int64_t>("eos_token_id", eos_token_id));
+    JUST(attrs.SetAttr<int64_t>("pad_token_id", pad_token_id));
+    JUST(attrs.SetAttr<int64_t>("seed", gen->current_seed()));
+    const auto& distribution_state = std::make_shared<DistributionKernelState>(gen);
+    return OpInterpUtil::Dispatch<TensorTuple>(*op_, {logits, scores, finished, lengths},
+                                               OpExprInterpContext(attrs, distribution_state));
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class FusedResidualNormFunctor {
+ public:
+  FusedResidualNormFunctor() {
+    // One op expr for each combination of the optional residual, bias, gamma and beta.
+    for (size_t mask = 0; mask < ops_.size(); ++mask) {
+      one::OpBuilder builder("fused_residual_norm");
+      builder.Input("x");
+      if (mask & kHasResidual) { builder.Input("residual"); }
+      if (mask & kHasBias) { builder.Input("bias"); }
+      if (mask & kHasGamma) { builder.Input("gamma"); }
+      if (mask & kHasBeta) { builder.Input("beta"); }
+      ops_.at(mask) = CHECK_JUST(
+          builder.Output("y").Output("sum").Output("mean").Output("inv_variance").Build());
+    }
+  }
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& x,
+                                const Optional<one::Tensor>& residual,
+                                const Optional<one::Tensor>& bias,
+                                const Optional<one::Tensor>& gamma,
+                                const Optional<one::Tensor>& beta, const std::string& norm_type,
+                                const std::string& activation, const int64_t& begin_norm_axis,
+                                const double& epsilon) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("norm_type", norm_type));
+    JUST(attrs.SetAttr<std::string>("activation", activation));
+    JUST(attrs.SetAttr<int64_t>("begin_norm_axis", begin_norm_axis));
+    JUST(attrs.SetAttr<double>("epsilon", epsilon));
+    int mask = 0;
+    TensorTuple inputs{x};
+    if (residual) {
+      mask |= kHasResidual;
+      inputs.emplace_back(JUST(residual));
+    }
+    if (bias) {
+      mask |= kHasBias;
+      inputs.emplace_back(JUST(bias));
+    }
+    if (gamma) {
+      mask |= kHasGamma;
+      inputs.emplace_back(JUST(gamma));
+    }
+    if (beta) {
+      mask |= kHasBeta;
+      inputs.emplace_back(JUST(beta));
+    }
+    const auto& outputs = JUST(OpInterpUtil::Dispatch<TensorTuple>(*ops_.at(mask), inputs, attrs));
+    return TensorTuple{outputs->at(0), outputs->at(1)};
+  }
+
+ private:
+  static constexpr int kHasResidual = 1;
+  static constexpr int kHasBias = 2;
+  static constexpr int kHasGamma = 4;
+  static constexpr int kHasBeta = 8;
+  std::array<std::shared_ptr<OpExpr>, 16> ops_;
+};
+
 class CtcGreedyDecoderFunctor {
  public:
   CtcGreedyDecoderFunctor() {
@@ -2215,6 +2696,37 @@ class NmsFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class BatchedNmsFunctor {
+ public:
+  BatchedNmsFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("batched_nms")
+                         .Input("boxes")
+                         .Input("scores")
+                         .Output("out_boxes")
+                         .Output("out_scores")
+                         .Output("out_classes")
+                         .Output("out_indices")
+                         .Output("num_detections")
+                         .Build());
+  }
+
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& boxes,
+                                const std::shared_ptr<one::Tensor>& scores,
+                                const float& iou_threshold, const float& score_threshold,
+                                const int32_t& pre_nms_top_n,
+                                const int32_t& max_output_per_image) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>("iou_threshold", iou_threshold));
+    JUST(attrs.SetAttr<float>("score_threshold", score_threshold));
+    JUST(attrs.SetAttr<int32_t>("pre_nms_top_n", pre_nms_top_n));
+    JUST(attrs.SetAttr<int32_t>("max_output_per_image", max_output_per_image));
+    return OpInterpUtil::Dispatch<TensorTuple>(*op_, {boxes, scores}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
 class RoiAlignFunctor {
  public:
   RoiAlignFunctor() {
@@ -2341,9 +2853,13 @@ class OneEmbeddingIdShuffleFunctor {
 
   Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& ids,
                                 const Optional<one::Tensor>& column_ids,
-                                const int32_t& num_columns) const {
+                                const int32_t& num_columns,
+                                const Optional<std::vector<int64_t>>& column_parallel_ids) const {
     MutableAttrMap attrs;
     JUST(attrs.SetAttr<int32_t>("num_columns", num_columns));
+    if (column_parallel_ids) {
+      JUST(attrs.SetAttr<std::vector<int64_t>>("column_parallel_ids", *JUST(column_parallel_ids)));
+    }
     if (column_ids) {
       return OpInterpUtil::Dispatch<TensorTuple>(*op_column_ids_has_in_out_,
                                                  {ids, JUST(column_ids)}, attrs);
@@ -2409,6 +2925,120 @@ class OneEmbeddingEmbeddingGradientShuffleFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class OneEmbeddingPrefetchFunctor {
+ public:
+  OneEmbeddingPrefetchFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_prefetch")
+                         .Input("num_unique_ids")
+                         .Input("unique_ids")
+                         .Output("context")
+                         .Build());
+  }
+
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& num_unique_ids,
+                           const std::shared_ptr<one::Tensor>& unique_ids,
+                           const std::string& key_value_store_options) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("key_value_store_options", key_value_store_options));
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {num_unique_ids, unique_ids}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class OneEmbeddingLookupShuffleFunctor {
+ public:
+  OneEmbeddingLookupShuffleFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_lookup_shuffle")
+                         .Input("num_unique_matrix")
+                         .Input("cur_rank_num_unique")
+                         .Input("cur_rank_unique_ids")
+                         .Input("cur_rank_inverse_indices")
+                         .Input("inverse_unique_partition_indices")
+                         .Output("embeddings")
+                         .Build());
+  }
+
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& num_unique_matrix,
+                           const std::shared_ptr<one::Tensor>& cur_rank_num_unique,
+                           const std::shared_ptr<one::Tensor>& cur_rank_unique_ids,
+                           const std::shared_ptr<one::Tensor>& cur_rank_inverse_indices,
+                           const std::shared_ptr<one::Tensor>& inverse_unique_partition_indices,
+                           const std::string& key_value_store_options,
+                           const Symbol<DType>& dtype) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("key_value_store_options", key_value_store_options));
+    JUST(attrs.SetAttr<DataType>("dtype", dtype->data_type()));
+    return OpInterpUtil::Dispatch<Tensor>(
+        *op_,
+        {num_unique_matrix, cur_rank_num_unique, cur_rank_unique_ids, cur_rank_inverse_indices,
+         inverse_unique_partition_indices},
+        attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class OneEmbeddingUpdateFunctor {
+ public:
+  OneEmbeddingUpdateFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_update")
+                         .Input("num_unique_ids")
+                         .Input("unique_ids")
+                         .Input("embedding_diff")
+                         .Input("learning_rate")
+                         .Build());
+    op_with_bias_correction_ = CHECK_JUST(one::OpBuilder("embedding_update")
+                                              .Input("num_unique_ids")
+                                              .Input("unique_ids")
+                                              .Input("embedding_diff")
+                                              .Input("learning_rate")
+                                              .Input("bias_correction1")
+                                              .Input("bias_correction2")
+                                              .Build());
+  }
+
+  Maybe<void> operator()(const std::shared_ptr<one::Tensor>& num_unique_ids,
+                         const std::shared_ptr<one::Tensor>& unique_ids,
+                         const std::shared_ptr<one::Tensor>& embedding_diff,
+                         const std::shared_ptr<one::Tensor>& learning_rate,
+                         const Optional<one::Tensor>& bias_correction1,
+                         const Optional<one::Tensor>& bias_correction2,
+                         const std::string& key_value_store_options,
+                         const std::string& optimizer, const double& scale,
+                         const float& weight_decay, const float& beta, const float& beta1,
+                         const float& beta2, const float& epsilon) const {
+    CHECK_EQ_OR_RETURN(bias_correction1.has_value(), bias_correction2.has_value())
+        << "bias_correction1 and bias_correction2 must be given together";
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("key_value_store_options", key_value_store_options));
+    JUST(attrs.SetAttr<std::string>("optimizer", optimizer));
+    JUST(attrs.SetAttr<double>("scale", scale));
+    JUST(attrs.SetAttr<float>("weight_decay", weight_decay));
+    JUST(attrs.SetAttr<float>("beta", beta));
+    JUST(attrs.SetAttr<float>("beta1", beta1));
+    JUST(attrs.SetAttr<float>("beta2", beta2));
+    JUST(attrs.SetAttr<float>("epsilon", epsilon));
+    if (bias_correction1) {
+      JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *op_with_bias_correction_,
+          {num_unique_ids, unique_ids, embedding_diff, learning_rate, JUST(bias_correction1),
+           JUST(bias_correction2)},
+          attrs));
+    } else {
+      JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *op_, {num_unique_ids, unique_ids, embedding_diff, learning_rate}, attrs));
+    }
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> op_with_bias_correction_;
+};
+
 }  // namespace impl
 
 ONEFLOW_FUNCTION_LIBRARY(m) {
@@ -2421,6 +3051,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::DeConv3dFunctor>("Deconv3d");
   m.add_functor<impl::MatMulFunctor>("MatMul");
   m.add_functor<impl::BatchMatMulFunctor>("BatchMatMul");
+  m.add_functor<impl::QuantizedMatmulFunctor>("QuantizedMatmul");
+  m.add_functor<impl::Fp8MatmulFunctor>("Fp8Matmul");
   m.add_functor<impl::FusedMLPFunctor>("FusedMLP");
   m.add_functor<impl::LayerNormFunctor>("LayerNorm");
   m.add_functor<impl::LayerNormAffineFunctor>("LayerNormAffine");
@@ -2471,11 +3103,23 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::FusedBiasAddDropoutFunctor>("FusedBiasAddDropout");
   m.add_functor<impl::FusedScaleMaskSoftmaxFunctor>("FusedScaleMaskSoftmax");
   m.add_functor<impl::FusedScaleMaskSoftmaxDropoutFunctor>("FusedScaleMaskSoftmaxDropout");
+  m.add_functor<impl::FusedAttentionFunctor>("FusedAttention");
+  m.add_functor<impl::EmbeddingBagFunctor>("EmbeddingBag");
+  m.add_functor<impl::FusedLinearCrossEntropyFunctor>("FusedLinearCrossEntropy");
+  m.add_functor<impl::MoeGatingFunctor>("MoeGating");
+  m.add_functor<impl::MoeDispatchFunctor>("MoeDispatch");
+  m.add_functor<impl::MoeCombineFunctor>("MoeCombine");
+  m.add_functor<impl::PagedKvCacheAppendFunctor>("PagedKvCacheAppend");
+  m.add_functor<impl::PagedDecodeAttentionFunctor>("PagedDecodeAttention");
+  m.add_functor<impl::PagedKvCacheReorderBeamsFunctor>("PagedKvCacheReorderBeams");
+  m.add_functor<impl::FusedDecodeStepFunctor>("FusedDecodeStep");
+  m.add_functor<impl::FusedResidualNormFunctor>("FusedResidualNorm");
   m.add_functor<impl::FusedScaleTrilSoftmaxMaskScaleFunctor>("FusedScaleTrilSoftmaxMaskScale");
   m.add_functor<impl::FusedScaleTrilFunctor>("FusedScaleTril");
   m.add_functor<impl::CtcGreedyDecoderFunctor>("CtcGreedyDecoder");
   m.add_functor<impl::PariticalFCSampleDisableBoxing>("DistributedPariticalFCSampleDisableBoxing");
   m.add_functor<impl::NmsFunctor>("Nms");
+  m.add_functor<impl::BatchedNmsFunctor>("BatchedNms");
   m.add_functor<impl::RoiAlignFunctor>("RoiAlign");
   m.add_functor<impl::RoiAlignGradFunctor>("RoiAlignGrad");
   m.add_functor<impl::FusedDotFeatureInteractionFunctor>("FusedDotFeatureInteraction");
@@ -2483,6 +3127,9 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::OneEmbeddingEmbeddingShuffleFunctor>("OneEmbeddingEmbeddingShuffle");
   m.add_functor<impl::OneEmbeddingEmbeddingGradientShuffleFunctor>(
       "OneEmbeddingEmbeddingGradientShuffle");
+  m.add_functor<impl::OneEmbeddingPrefetchFunctor>("OneEmbeddingPrefetch");
+  m.add_functor<impl::OneEmbeddingLookupShuffleFunctor>("OneEmbeddingLookupShuffle");
+  m.add_functor<impl::OneEmbeddingUpdateFunctor>("OneEmbeddingUpdate");
 };
 
 }  // namespace functional
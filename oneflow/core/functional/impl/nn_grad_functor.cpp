@@ -921,6 +921,282 @@ class FusedScaleMaskSoftmaxDropoutGradFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class FusedAttentionGradFunctor {
+ public:
+  FusedAttentionGradFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("fused_attention_grad")
+                         .Input("query")
+                         .Input("key")
+                         .Input("value")
+                         .Input("out")
+                         .Input("out_grad")
+                         .Input("softmax_lse")
+                         .Input("rng_state")
+                         .Output("query_grad")
+                         .Output("key_grad")
+                         .Output("value_grad")
+                         .Build());
+    masked_op_ = CHECK_JUST(one::OpBuilder("fused_attention_grad")
+                                .Input("query")
+                                .Input("key")
+                                .Input("value")
+                                .Input("out")
+                                .Input("out_grad")
+                                .Input("softmax_lse")
+                                .Input("rng_state")
+                                .Input("key_mask")
+                                .Output("query_grad")
+                                .Output("key_grad")
+                                .Output("value_grad")
+                                .Build());
+    packed_op_ = CHECK_JUST(one::OpBuilder("fused_attention_grad")
+                                .Input("query")
+                                .Input("key")
+                                .Input("value")
+                                .Input("out")
+                                .Input("out_grad")
+                                .Input("softmax_lse")
+                                .Input("rng_state")
+                                .Input("cu_seqlens_q")
+                                .Input("cu_seqlens_k")
+                                .Output("query_grad")
+                                .Output("key_grad")
+                                .Output("value_grad")
+                                .Build());
+  }
+  Maybe<TensorTuple> operator()(
+      const std::shared_ptr<one::Tensor>& query, const std::shared_ptr<one::Tensor>& key,
+      const std::shared_ptr<one::Tensor>& value, const std::shared_ptr<one::Tensor>& out,
+      const std::shared_ptr<one::Tensor>& out_grad, const std::shared_ptr<one::Tensor>& softmax_lse,
+      const std::shared_ptr<one::Tensor>& rng_state, const Optional<one::Tensor>& key_mask,
+      const float& scale, const bool& causal, const float& dropout_rate,
+      const Optional<one::Tensor>& cu_seqlens_q, const Optional<one::Tensor>& cu_seqlens_k,
+      const int64_t& max_seqlen_q, const int64_t& max_seqlen_k) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<float>("scale", scale));
+    JUST(attrs.SetAttr<bool>("causal", causal));
+    JUST(attrs.SetAttr<float>("dropout_rate", dropout_rate));
+    JUST(attrs.SetAttr<int64_t>("max_seqlen_q", max_seqlen_q));
+    JUST(attrs.SetAttr<int64_t>("max_seqlen_k", max_seqlen_k));
+    if (cu_seqlens_q) {
+      return OpInterpUtil::Dispatch<TensorTuple>(*packed_op_,
+                                                 {query, key, value, out, out_grad, softmax_lse,
+                                                  rng_state, JUST(cu_seqlens_q),
+                                                  JUST(cu_seqlens_k)},
+                                                 attrs);
+    }
+    if (key_mask) {
+      return OpInterpUtil::Dispatch<TensorTuple>(
+          *masked_op_,
+          {query, key, value, out, out_grad, softmax_lse, rng_state, JUST(key_mask)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<TensorTuple>(
+        *op_, {query, key, value, out, out_grad, softmax_lse, rng_state}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> masked_op_;
+  std::shared_ptr<OpExpr> packed_op_;
+};
+
+class EmbeddingBagGradFunctor {
+ public:
+  EmbeddingBagGradFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_bag_grad")
+                         .Input("out_grad")
+                         .Input("weight")
+                         .Input("indices")
+                         .Output("values")
+                         .Build());
+    weighted_op_ = CHECK_JUST(one::OpBuilder("embedding_bag_grad")
+                                  .Input("out_grad")
+                                  .Input("weight")
+                                  .Input("indices")
+                                  .Input("per_sample_weights")
+                                  .Output("values")
+                                  .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& out_grad,
+                           const std::shared_ptr<one::Tensor>& weight,
+                           const std::shared_ptr<one::Tensor>& indices,
+                           const Optional<one::Tensor>& per_sample_weights,
+                           const std::string& mode, const int64_t& padding_idx) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("mode", mode));
+    JUST(attrs.SetAttr<int64_t>("padding_idx", padding_idx));
+    if (per_sample_weights) {
+      return OpInterpUtil::Dispatch<Tensor>(
+          *weighted_op_, {out_grad, weight, indices, JUST(per_sample_weights)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {out_grad, weight, indices}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> weighted_op_;
+};
+
+class FusedLinearCrossEntropyGradFunctor {
+ public:
+  FusedLinearCrossEntropyGradFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("fused_linear_cross_entropy_grad")
+                         .Input("dy")
+                         .Input("x")
+                         .Input("weight")
+                         .Input("label")
+                         .Input("log_sum_exp")
+                         .Output("x_diff")
+                         .Output("weight_diff")
+                         .Build());
+  }
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& dy,
+                                const std::shared_ptr<one::Tensor>& x,
+                                const std::shared_ptr<one::Tensor>& weight,
+                                const std::shared_ptr<one::Tensor>& label,
+                                const std::shared_ptr<one::Tensor>& log_sum_exp,
+                                const int64_t& ignore_index, const int64_t& chunk_size) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int64_t>("chunk_size", chunk_size));
+    JUST(attrs.SetAttr<int64_t>("ignore_index", ignore_index));
+    return OpInterpUtil::Dispatch<TensorTuple>(*op_, {dy, x, weight, label, log_sum_exp}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class MoeGatingGradFunctor {
+ public:
+  MoeGatingGradFunctor() {
+    gates_grad_op_ = CHECK_JUST(one::OpBuilder("moe_gating_grad")
+                                    .Input("probs")
+                                    .Input("expert_indices")
+                                    .Input("gates")
+                                    .Input("gates_grad")
+                                    .Output("logits_grad")
+                                    .Build());
+    aux_loss_grad_op_ = CHECK_JUST(one::OpBuilder("moe_gating_grad")
+                                       .Input("probs")
+                                       .Input("expert_indices")
+                                       .Input("gates")
+                                       .Input("aux_loss_grad")
+                                       .Output("logits_grad")
+                                       .Build());
+    op_ = CHECK_JUST(one::OpBuilder("moe_gating_grad")
+                         .Input("probs")
+                         .Input("expert_indices")
+                         .Input("gates")
+                         .Input("gates_grad")
+                         .Input("aux_loss_grad")
+                         .Output("logits_grad")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& probs,
+                           const std::shared_ptr<one::Tensor>& expert_indices,
+                           const std::shared_ptr<one::Tensor>& gates,
+                           const Optional<one::Tensor>& gates_grad,
+                           const Optional<one::Tensor>& aux_loss_grad) const {
+    CHECK_OR_RETURN(gates_grad || aux_loss_grad)
+        << "moe_gating_grad expects at least one of gates_grad and aux_loss_grad";
+    if (!aux_loss_grad) {
+      return OpInterpUtil::Dispatch<Tensor>(*gates_grad_op_,
+                                            {probs, expert_indices, gates, JUST(gates_grad)});
+    }
+    if (!gates_grad) {
+      return OpInterpUtil::Dispatch<Tensor>(*aux_loss_grad_op_,
+                                            {probs, expert_indices, gates, JUST(aux_loss_grad)});
+    }
+    return OpInterpUtil::Dispatch<Tensor>(
+        *op_, {probs, expert_indices, gates, JUST(gates_grad), JUST(aux_loss_grad)});
+  }
+
+ private:
+  std::shared_ptr<OpExpr> gates_grad_op_;
+  std::shared_ptr<OpExpr> aux_loss_grad_op_;
+  std::shared_ptr<OpExpr> op_;
+};
+
+class MoeGatesGradFunctor {
+ public:
+  MoeGatesGradFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("moe_gates_grad")
+                         .Input("tokens")
+                         .Input("expert_buffer")
+                         .Input("expert_indices")
+                         .Input("locations")
+                         .Output("gates_grad")
+                         .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& tokens,
+                           const std::shared_ptr<one::Tensor>& expert_buffer,
+                           const std::shared_ptr<one::Tensor>& expert_indices,
+                           const std::shared_ptr<one::Tensor>& locations) const {
+    return OpInterpUtil::Dispatch<Tensor>(*op_,
+                                          {tokens, expert_buffer, expert_indices, locations});
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
+class FusedResidualNormGradFunctor {
+ public:
+  FusedResidualNormGradFunctor() {
+    // gamma_diff and beta_diff are produced whenever gamma and beta are given.
+    for (size_t mask = 0; mask < ops_.size(); ++mask) {
+      one::OpBuilder builder("fused_residual_norm_grad");
+      builder.Input("y_grad");
+      if (mask & kHasSumGrad) { builder.Input("sum_grad"); }
+      builder.Input("sum").Input("mean").Input("inv_variance");
+      if (mask & kHasGamma) { builder.Input("gamma"); }
+      if (mask & kHasBeta) { builder.Input("beta"); }
+      builder.Output("sum_diff");
+      if (mask & kHasGamma) { builder.Output("gamma_diff"); }
+      if (mask & kHasBeta) { builder.Output("beta_diff"); }
+      ops_.at(mask) = CHECK_JUST(builder.Build());
+    }
+  }
+  Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& y_grad,
+                                const std::shared_ptr<one::Tensor>& sum,
+                                const std::shared_ptr<one::Tensor>& mean,
+                                const std::shared_ptr<one::Tensor>& inv_variance,
+                                const Optional<one::Tensor>& sum_grad,
+                                const Optional<one::Tensor>& gamma,
+                                const Optional<one::Tensor>& beta, const std::string& norm_type,
+                                const std::string& activation,
+                                const int64_t& begin_norm_axis) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<std::string>("norm_type", norm_type));
+    JUST(attrs.SetAttr<std::string>("activation", activation));
+    JUST(attrs.SetAttr<int64_t>("begin_norm_axis", begin_norm_axis));
+    int mask = 0;
+    TensorTuple inputs{y_grad};
+    if (sum_grad) {
+      mask |= kHasSumGrad;
+      inputs.emplace_back(JUST(sum_grad));
+    }
+    inputs.emplace_back(sum);
+    inputs.emplace_back(mean);
+    inputs.emplace_back(inv_variance);
+    if (gamma) {
+      mask |= kHasGamma;
+      inputs.emplace_back(JUST(gamma));
+    }
+    if (beta) {
+      mask |= kHasBeta;
+      inputs.emplace_back(JUST(beta));
+    }
+    return OpInterpUtil::Dispatch<TensorTuple>(*ops_.at(mask), inputs, attrs);
+  }
+
+ private:
+  static constexpr int kHasSumGrad = 1;
+  static constexpr int kHasGamma = 2;
+  static constexpr int kHasBeta = 4;
+  std::array<std::shared_ptr<OpExpr>, 8> ops_;
+};
+
 class CublasBiasAddReluMatmulGradFunctor {
  public:
   CublasBiasAddReluMatmulGradFunctor() {
@@ -1032,6 +1308,12 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       "FusedScaleTrilSoftmaxMaskScaleGrad");
   m.add_functor<impl::FusedScaleMaskSoftmaxGradFunctor>("FusedScaleMaskSoftmaxGrad");
   m.add_functor<impl::FusedScaleMaskSoftmaxDropoutGradFunctor>("FusedScaleMaskSoftmaxDropoutGrad");
+  m.add_functor<impl::FusedAttentionGradFunctor>("FusedAttentionGrad");
+  m.add_functor<impl::EmbeddingBagGradFunctor>("EmbeddingBagGrad");
+  m.add_functor<impl::FusedLinearCrossEntropyGradFunctor>("FusedLinearCrossEntropyGrad");
+  m.add_functor<impl::MoeGatingGradFunctor>("MoeGatingGrad");
+  m.add_functor<impl::MoeGatesGradFunctor>("MoeGatesGrad");
+  m.add_functor<impl::FusedResidualNormGradFunctor>("FusedResidualNormGrad");
   m.add_functor<impl::CublasBiasAddReluMatmulGradFunctor>("CublasBiasAddReluMatmulGrad");
   m.add_functor<impl::FusedDotFeatureInteractionGradFunctor>("FusedDotFeatureInteractionGrad");
 };
@@ -143,6 +143,42 @@ class QuantizationFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class WeightOnlyQuantMatmulFunctor {
+ public:
+  WeightOnlyQuantMatmulFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("weight_only_quant_matmul")
+                         .Input("x")
+                         .Input("weight")
+                         .Input("scale")
+                         .Output("out")
+                         .Build());
+    bias_op_ = CHECK_JUST(one::OpBuilder("weight_only_quant_matmul")
+                              .Input("x")
+                              .Input("weight")
+                              .Input("scale")
+                              .Input("bias")
+                              .Output("out")
+                              .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x,
+                           const std::shared_ptr<one::Tensor>& weight,
+                           const std::shared_ptr<one::Tensor>& scale,
+                           const Optional<one::Tensor>& bias, const int32_t& num_bits,
+                           const int64_t& group_size) const {
+    MutableAttrMap attrs;
+    JUST(attrs.SetAttr<int32_t>("num_bits", num_bits));
+    JUST(attrs.SetAttr<int64_t>("group_size", group_size));
+    if (bias) {
+      return OpInterpUtil::Dispatch<Tensor>(*bias_op_, {x, weight, scale, JUST(bias)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {x, weight, scale}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> bias_op_;
+};
+
 }  // namespace impl
 
 ONEFLOW_FUNCTION_LIBRARY(m) { m.add_functor<impl::FakeQuantizationFunctor>("FakeQuantization"); };
@@ -151,6 +187,9 @@ ONEFLOW_FUNCTION_LIBRARY(m) { m.add_functor<impl::MinMaxObserverFunctor>("MinMax
 ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::MovingAverageMinMaxObserverFunctor>("MovingAverageMinMaxObserver");
 };
+ONEFLOW_FUNCTION_LIBRARY(m) {
+  m.add_functor<impl::WeightOnlyQuantMatmulFunctor>("WeightOnlyQuantMatmul");
+};
 
 }  // namespace functional
 }  // namespace one
@@ -27,9 +27,23 @@ namespace functional {
 
 namespace impl {
 
-#define INPLACE_UNARY_FLOAT_FUNC_SEQ      \
-  OF_PP_MAKE_TUPLE_SEQ("sin", InplaceSin) \
-  OF_PP_MAKE_TUPLE_SEQ("floor", InplaceFloor)
+#define INPLACE_UNARY_FUNC_SEQ                \
+  OF_PP_MAKE_TUPLE_SEQ("abs", InplaceAbs)     \
+  OF_PP_MAKE_TUPLE_SEQ("ceil", InplaceCeil)   \
+  OF_PP_MAKE_TUPLE_SEQ("round", InplaceRound)
+
+#define INPLACE_UNARY_FLOAT_FUNC_SEQ                    \
+  OF_PP_MAKE_TUPLE_SEQ("sin", InplaceSin)               \
+  OF_PP_MAKE_TUPLE_SEQ("floor", InplaceFloor)           \
+  OF_PP_MAKE_TUPLE_SEQ("exp", InplaceExp)               \
+  OF_PP_MAKE_TUPLE_SEQ("log", InplaceLog)               \
+  OF_PP_MAKE_TUPLE_SEQ("negative", InplaceNegative)     \
+  OF_PP_MAKE_TUPLE_SEQ("reciprocal", InplaceReciprocal) \
+  OF_PP_MAKE_TUPLE_SEQ("rsqrt", InplaceRsqrt)           \
+  OF_PP_MAKE_TUPLE_SEQ("sigmoid_v2", InplaceSigmoid)    \
+  OF_PP_MAKE_TUPLE_SEQ("sqrt", InplaceSqrt)             \
+  OF_PP_MAKE_TUPLE_SEQ("square", InplaceSquare)         \
+  OF_PP_MAKE_TUPLE_SEQ("tanh", InplaceTanh)
 
 #define UNARY_FUNC_SEQ                                       \
   OF_PP_MAKE_TUPLE_SEQ("abs", Abs)                           \
@@ -92,7 +106,7 @@ namespace impl {
     }                                                                           \
   };
 
-#define INPLACE_UNARY_FUNCOTRS(op_type_name, class_name) \
+#define INPLACE_UNARY_FUNCOTRS(op_type_name, class_name)                   \
   UNARY_ELEMENTWISE_FUNCTOR(op_type_name, class_name, InplaceUnaryFunctor)
 #define INPLACE_FLOAT_UNARY_FUNCOTRS(op_type_name, class_name) \
   UNARY_ELEMENTWISE_FUNCTOR(op_type_name, class_name, InplaceFloatUnaryFunctor)
@@ -105,6 +119,7 @@ namespace impl {
   UNARY_ELEMENTWISE_FUNCTOR(op_type_name, class_name, FloatUnaryFunctor) \
   UNARY_ELEMENTWISE_GRAD_FUNCTOR(op_type_name, class_name, BinaryFunctor)
 
+OF_PP_FOR_EACH_TUPLE(INPLACE_UNARY_FUNCOTRS, INPLACE_UNARY_FUNC_SEQ);
 OF_PP_FOR_EACH_TUPLE(INPLACE_FLOAT_UNARY_FUNCOTRS, INPLACE_UNARY_FLOAT_FUNC_SEQ);
 OF_PP_FOR_EACH_TUPLE(UNARY_FUNCOTRS, UNARY_FUNC_SEQ);
 OF_PP_FOR_EACH_TUPLE(FLOAT_UNARY_FUNCOTRS, FLOAT_UNARY_FUNC_SEQ);
@@ -156,6 +171,18 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<LogicalNotFunctor>("LogicalNot");
   m.add_functor<InplaceSinFunctor>("Sin_");
   m.add_functor<InplaceFloorFunctor>("Floor_");
+  m.add_functor<InplaceAbsFunctor>("Abs_");
+  m.add_functor<InplaceCeilFunctor>("Ceil_");
+  m.add_functor<InplaceRoundFunctor>("Round_");
+  m.add_functor<InplaceExpFunctor>("Exp_");
+  m.add_functor<InplaceLogFunctor>("Log_");
+  m.add_functor<InplaceNegativeFunctor>("Negative_");
+  m.add_functor<InplaceReciprocalFunctor>("Reciprocal_");
+  m.add_functor<InplaceRsqrtFunctor>("Rsqrt_");
+  m.add_functor<InplaceSigmoidFunctor>("Sigmoid_");
+  m.add_functor<InplaceSqrtFunctor>("Sqrt_");
+  m.add_functor<InplaceSquareFunctor>("Square_");
+  m.add_functor<InplaceTanhFunctor>("Tanh_");
 };
 
 #undef ADD_UNARY_FUNCTOR
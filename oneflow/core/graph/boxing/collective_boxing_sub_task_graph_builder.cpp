@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/graph/collective_boxing_unpack_task_node.h"
 #include "oneflow/core/graph/task_stream_id.h"
 #include "oneflow/core/job/nd_sbp_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
 #ifdef WITH_CUDA
 #include <nccl.h>
 #endif
@@ -35,7 +36,8 @@ namespace {
 void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
                             const ParallelDesc& parallel_desc, int64_t parallel_id,
                             const std::string& name, const LogicalBlobId& lbi,
-                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root,
+                            const std::vector<int64_t>& split_elem_cnt = {}) {
   OperatorConf op_conf;
   op_conf.set_name(name);
   op_conf.set_device_tag(*CHECK_JUST(DeviceTag4DeviceType(DeviceType::kCUDA)));
@@ -59,6 +61,10 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   } else {
     CHECK_EQ(root, -1);
   }
+  if (!split_elem_cnt.empty()) {
+    CHECK_EQ(op_type, OpType::kOpTypeAll2All);
+    *op_desc->mutable_split_elem_cnt() = {split_elem_cnt.begin(), split_elem_cnt.end()};
+  }
   op_desc->set_backend(Backend::kBackendNCCL);
   rank_desc->set_rank(parallel_id);
 
@@ -498,11 +504,26 @@ class NcclCollectiveBoxingAll2AllSubTskGphBuilder final : public SubTskGphBuilde
         && out_parallel_desc.device_type() == DeviceType::kCUDA
         && out_parallel_desc.parallel_num() > 1
         && shape.NumAxes() > std::max(in_split_axis, out_split_axis)
-        && shape.At(in_split_axis) % in_parallel_desc.parallel_num() == 0
-        && shape.At(out_split_axis) % out_parallel_desc.parallel_num() == 0
         && in_sbp_parallel.split_parallel().axis() != out_sbp_parallel.split_parallel().axis()
         && SubTskGphBuilderUtil::IsBoxingS2S(in_sbp_parallel, out_sbp_parallel)) {
       const std::string op_name = "System-Boxing-NcclCollectiveBoxingAll2All-" + NewUniqueId();
+      const int64_t parallel_num = in_parallel_desc.parallel_num();
+      // Split axes not divisible by the parallel num are split by BalancedSplitter, the elem cnt
+      // exchanged by each pair of ranks then has to be given explicitly.
+      std::vector<int64_t> split_elem_cnt;
+      if (shape.At(in_split_axis) % parallel_num != 0
+          || shape.At(out_split_axis) % parallel_num != 0) {
+        const BalancedSplitter in_bs(shape.At(in_split_axis), parallel_num);
+        const BalancedSplitter out_bs(shape.At(out_split_axis), parallel_num);
+        const int64_t inner_elem_cnt =
+            shape.elem_cnt() / (shape.At(in_split_axis) * shape.At(out_split_axis));
+        FOR_RANGE(int64_t, src, 0, parallel_num) {
+          FOR_RANGE(int64_t, dst, 0, parallel_num) {
+            split_elem_cnt.emplace_back(inner_elem_cnt * in_bs.At(src).size()
+                                        * out_bs.At(dst).size());
+          }
+        }
+      }
       FOR_RANGE(int64_t, i, 0, in_parallel_desc.parallel_num()) {
         const int64_t machine_id = CHECK_JUST(in_parallel_desc.MachineId4ParallelId(i));
         const int64_t device_index = CHECK_JUST(in_parallel_desc.DeviceId4ParallelId(i));
@@ -512,18 +533,18 @@ class NcclCollectiveBoxingAll2AllSubTskGphBuilder final : public SubTskGphBuilde
         CollectiveBoxingPackTaskNode* pack_node =
             ctx->task_graph()->NewNode<CollectiveBoxingPackTaskNode>();
         pack_node->Init(machine_id, thrd_id, lbi, logical_blob_desc.shape(), in_sbp_parallel,
-                        out_sbp_parallel, in_parallel_desc.parallel_num());
+                        out_sbp_parallel, parallel_num, i);
         ctx->task_graph()->ConnectWithLbi(in_node, pack_node, lbi);
 
         auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
         NcclInitCollectiveNode(collective_node, out_parallel_desc, i, op_name, lbi,
-                               logical_blob_desc, OpType::kOpTypeAll2All, -1);
+                               logical_blob_desc, OpType::kOpTypeAll2All, -1, split_elem_cnt);
         ctx->task_graph()->ConnectWithLbi(pack_node, collective_node, lbi);
 
         CollectiveBoxingUnpackTaskNode* unpack_node =
             ctx->task_graph()->NewNode<CollectiveBoxingUnpackTaskNode>();
         unpack_node->Init(machine_id, thrd_id, lbi, logical_blob_desc.shape(), in_sbp_parallel,
-                          out_sbp_parallel, in_parallel_desc.parallel_num());
+                          out_sbp_parallel, parallel_num, i);
         ctx->task_graph()->ConnectWithLbi(collective_node, unpack_node, lbi);
         sorted_out_tasks->emplace_back(unpack_node);
       }
@@ -39,6 +39,17 @@ Shape GetFlattenSplitShape(const RankDesc& rank_desc) {
   return return_shape;
 }
 
+Shape GetAll2AllShape(const RankDesc& rank_desc, bool is_input) {
+  const OpDesc& op_desc = rank_desc.op_desc();
+  if (op_desc.split_elem_cnt_size() == 0) { return GetFlattenSplitShape(rank_desc); }
+  int64_t elem_cnt = 0;
+  FOR_RANGE(int64_t, peer, 0, op_desc.num_ranks()) {
+    elem_cnt += is_input ? GetAll2AllSplitElemCnt(op_desc, rank_desc.rank(), peer)
+                         : GetAll2AllSplitElemCnt(op_desc, peer, rank_desc.rank());
+  }
+  return Shape({elem_cnt});
+}
+
 }  // namespace
 
 bool GenericOpHasInput(const RankDesc& rank_desc) {
@@ -80,7 +91,7 @@ Shape GenericOpGetInputShape(const RankDesc& rank_desc) {
   } else if (op_type == OpType::kOpTypeAllGather) {
     return GetSplitShape(rank_desc);
   } else if (op_type == OpType::kOpTypeAll2All) {
-    return GetFlattenSplitShape(rank_desc);
+    return GetAll2AllShape(rank_desc, true);
   } else {
     UNIMPLEMENTED();
     return Shape();
@@ -96,13 +107,30 @@ Shape GenericOpGetOutputShape(const RankDesc& rank_desc) {
   } else if (op_type == OpType::kOpTypeReduceScatter) {
     return GetSplitShape(rank_desc);
   } else if (op_type == OpType::kOpTypeAll2All) {
-    return GetFlattenSplitShape(rank_desc);
+    return GetAll2AllShape(rank_desc, false);
   } else {
     UNIMPLEMENTED();
     return Shape();
   }
 }
 
+int64_t GetAll2AllSplitElemCnt(const OpDesc& op_desc, int64_t src_rank, int64_t dst_rank) {
+  CHECK_EQ(op_desc.op_type(), OpType::kOpTypeAll2All);
+  const int64_t num_ranks = op_desc.num_ranks();
+  CHECK_GE(src_rank, 0);
+  CHECK_LT(src_rank, num_ranks);
+  CHECK_GE(dst_rank, 0);
+  CHECK_LT(dst_rank, num_ranks);
+  if (op_desc.split_elem_cnt_size() == 0) {
+    const int64_t elem_cnt = Shape(op_desc.shape()).elem_cnt();
+    CHECK_EQ(elem_cnt % (num_ranks * num_ranks), 0);
+    return elem_cnt / (num_ranks * num_ranks);
+  } else {
+    CHECK_EQ(op_desc.split_elem_cnt_size(), num_ranks * num_ranks);
+    return op_desc.split_elem_cnt(src_rank * num_ranks + dst_rank);
+  }
+}
+
 }  // namespace collective
 
 }  // namespace boxing
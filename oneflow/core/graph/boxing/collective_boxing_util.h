@@ -49,6 +49,9 @@ Shape GenericOpGetInputShape(const RankDesc& rank_desc);
 
 Shape GenericOpGetOutputShape(const RankDesc& rank_desc);
 
+// Elem cnt sent from src_rank to dst_rank by an All2All.
+int64_t GetAll2AllSplitElemCnt(const OpDesc& op_desc, int64_t src_rank, int64_t dst_rank);
+
 }  // namespace collective
 
 }  // namespace boxing
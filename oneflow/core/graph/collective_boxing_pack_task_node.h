@@ -29,6 +29,11 @@ class CollectiveBoxingPackTaskNode : public TransportTaskNode {
   void Init(int64_t machine_id, int64_t thrd_id, const LogicalBlobId& lbi,
             const Shape& logical_shape, const SbpParallel& src_sbp_parallel,
             const SbpParallel& dst_sbp_parallel, const int64_t parallel_num);
+  // parallel_id is required if the split axes are not divisible by parallel_num.
+  void Init(int64_t machine_id, int64_t thrd_id, const LogicalBlobId& lbi,
+            const Shape& logical_shape, const SbpParallel& src_sbp_parallel,
+            const SbpParallel& dst_sbp_parallel, const int64_t parallel_num,
+            const int64_t parallel_id);
   TaskType GetTaskType() const override { return TaskType::kCollectiveBoxingPack; }
 
  private:
@@ -41,6 +46,7 @@ class CollectiveBoxingPackTaskNode : public TransportTaskNode {
   SbpParallel src_sbp_parallel_;
   SbpParallel dst_sbp_parallel_;
   int64_t parallel_num_;
+  int64_t parallel_id_;
 };
 
 }  // namespace oneflow
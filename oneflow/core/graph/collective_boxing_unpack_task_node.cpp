@@ -23,11 +23,21 @@ void CollectiveBoxingUnpackTaskNode::Init(int64_t machine_id, int64_t thrd_id,
                                           const SbpParallel& src_sbp_parallel,
                                           const SbpParallel& dst_sbp_parallel,
                                           const int64_t parallel_num) {
+  Init(machine_id, thrd_id, lbi, logical_shape, src_sbp_parallel, dst_sbp_parallel, parallel_num,
+       -1);
+}
+
+void CollectiveBoxingUnpackTaskNode::Init(int64_t machine_id, int64_t thrd_id,
+                                          const LogicalBlobId& lbi, const Shape& logical_shape,
+                                          const SbpParallel& src_sbp_parallel,
+                                          const SbpParallel& dst_sbp_parallel,
+                                          const int64_t parallel_num, const int64_t parallel_id) {
   set_machine_id(machine_id);
   set_thrd_id(thrd_id);
   set_lbi(lbi);
   logical_shape_ = logical_shape;
   parallel_num_ = parallel_num;
+  parallel_id_ = parallel_id;
   src_sbp_parallel_ = src_sbp_parallel;
   dst_sbp_parallel_ = dst_sbp_parallel;
 }
@@ -53,6 +63,7 @@ void CollectiveBoxingUnpackTaskNode::BuildExecGphAndRegst() {
   *collective_boxing_unpack_conf->mutable_src_sbp_parallel() = src_sbp_parallel_;
   *collective_boxing_unpack_conf->mutable_dst_sbp_parallel() = dst_sbp_parallel_;
   collective_boxing_unpack_conf->set_num_ranks(parallel_num_);
+  if (parallel_id_ >= 0) { collective_boxing_unpack_conf->set_rank(parallel_id_); }
   std::shared_ptr<Operator> sole_op = CHECK_JUST(ConstructOp(op_conf));
   node->mut_op() = sole_op;
   node->BindBnWithRegst(sole_op->SoleIbn(), GetSoleConsumedRegst("in"));
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/graph/copy_task_node.h"
 #include "oneflow/core/graph/task_stream_id.h"
+#include "oneflow/core/graph/compute_task_node.h"
 
 namespace oneflow {
 
@@ -53,6 +54,22 @@ void CopyHdTaskNode::Init(CopyHdOpConf::Type copy_type, const DeviceId& device_i
   set_lbi(lbi);
 }
 
+void CopyHdTaskNode::BuildExecGphAndRegst() {
+  CopyTaskNode::BuildExecGphAndRegst();
+  if (copy_type_ != CopyHdOpConf::H2D) { return; }
+  // Double buffers both sides of an H2D copy, so that the producer fills the next pinned batch
+  // while it is copied on the H2D stream, and the copy runs one batch ahead of the consumer.
+  // Variables are skipped, their copies are not on the critical path of every step.
+  static const int32_t min_register_num =
+      ParseIntegerFromEnv("ONEFLOW_H2D_COPY_MIN_REGISTER_NUM", 2);
+  auto in_regst = GetSoleConsumedRegst("copy_in");
+  const auto* producer = dynamic_cast<const CompTaskNode*>(in_regst->producer());
+  if (producer != nullptr && producer->op()->op_conf().has_variable_conf()) { return; }
+  for (const auto& regst : {in_regst, GetProducedRegst("copy_out")}) {
+    regst->UpdtMinRegstNumIfNeed(std::min(min_register_num, regst->max_register_num()));
+  }
+}
+
 void CopyHdTaskNode::InitProducedRegstMemCase(MemoryCase* mem_case) {
   if (copy_type_ == CopyHdOpConf::H2D) {
     TaskNode::InitProducedRegstMemCase(mem_case);
@@ -79,12 +96,27 @@ OperatorConf CopyHdTaskNode::NewCopyOpConf() {
 }
 
 void CopyCommNetTaskNode::Init(int64_t machine_id, const LogicalBlobId& lbi) {
+  Init(GetNodeCPUMemZoneId(machine_id), lbi);
+}
+
+void CopyCommNetTaskNode::Init(const MemZoneId& dst_mem_zone_id, const LogicalBlobId& lbi) {
+  const int64_t machine_id = dst_mem_zone_id.rank();
+  dst_mem_zone_id_ = dst_mem_zone_id;
   set_machine_id(machine_id);
   set_thrd_id(EncodeStreamIdToInt64(
       GenerateNamedTaskStreamId(machine_id, DeviceType::kCPU, 0, "COMM_NET")));
   set_lbi(lbi);
 }
 
+void CopyCommNetTaskNode::InitProducedRegstMemCase(MemoryCase* mem_case) {
+  if (dst_mem_zone_id_.device_type() == DeviceType::kCUDA) {
+    mem_case->mutable_device_cuda_mem()->set_device_id(dst_mem_zone_id_.device_index());
+  } else {
+    CHECK(dst_mem_zone_id_.device_type() == DeviceType::kCPU);
+    TaskNode::InitProducedRegstMemCase(mem_case);
+  }
+}
+
 OperatorConf CopyCommNetTaskNode::NewCopyOpConf() {
   OperatorConf conf;
   conf.set_name("copy_comm_net_" + NewUniqueId());
@@ -48,6 +48,7 @@ class CopyHdTaskNode final : public CopyTaskNode {
   void Init(CopyHdOpConf::Type, const DeviceId& device_id, const LogicalBlobId& lbi);
 
   CopyHdOpConf::Type copy_type() const { return copy_type_; }
+  void BuildExecGphAndRegst() override;
   MemZoneId MemZoneId121() const override {
     if (copy_type_ == CopyHdOpConf::H2D) {
       return TaskNode::MemZoneId121();
@@ -69,15 +70,22 @@ class CopyHdTaskNode final : public CopyTaskNode {
 class CopyCommNetTaskNode final : public CopyTaskNode {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CopyCommNetTaskNode);
-  CopyCommNetTaskNode() = default;
+  CopyCommNetTaskNode() : dst_mem_zone_id_(kInvalidMemZoneId) {}
   ~CopyCommNetTaskNode() = default;
 
   TaskType GetTaskType() const override { return TaskType::kCopyCommNet; }
 
   void Init(int64_t machine_id, const LogicalBlobId& lbi);
+  // Reads into the memory of `dst_mem_zone_id` directly, which may be device memory if the comm
+  // net supports it.
+  void Init(const MemZoneId& dst_mem_zone_id, const LogicalBlobId& lbi);
+  MemZoneId MemZoneId121() const override { return dst_mem_zone_id_; }
 
  private:
+  void InitProducedRegstMemCase(MemoryCase*) override;
   OperatorConf NewCopyOpConf() override;
+
+  MemZoneId dst_mem_zone_id_;
 };
 
 }  // namespace oneflow
@@ -34,6 +34,11 @@ void PlanTaskGraph::InitNodes() {
     task_id2plan_task_node_.insert({task.task_id(), plan_task_node});
     AddAllocatedNode(plan_task_node);
   }
+  for (const auto& task : plan_->remote_task()) {
+    PlanTaskNode* plan_task_node = new PlanTaskNode(task);
+    task_id2plan_task_node_.insert({task.task_id(), plan_task_node});
+    AddAllocatedNode(plan_task_node);
+  }
 }
 
 void PlanTaskGraph::InitEdges() {
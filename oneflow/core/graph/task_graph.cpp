@@ -29,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/graph/boxing/hierarchical_sub_task_graph_builder_impl.h"
 #include "oneflow/core/graph/task_stream_index_manager.h"
 #include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/comm_network/comm_network.h"
 
 namespace oneflow {
 
@@ -417,6 +418,19 @@ void ForEachOpGraphNecessaryCtrlEdge(
   });
 }
 
+bool IsCommNetDeviceToDeviceReadable(const MemZoneId& src_mem_zone_id,
+                                     const MemZoneId& dst_mem_zone_id, const LogicalBlobId& lbi) {
+  if (src_mem_zone_id.rank() == dst_mem_zone_id.rank()) { return false; }
+  if (src_mem_zone_id.device_type() != dst_mem_zone_id.device_type()) { return false; }
+  const CommNet* comm_net = Global<CommNet>::Get();
+  if (comm_net == nullptr || !comm_net->IsDeviceMemorySupported(dst_mem_zone_id.device_type())) {
+    return false;
+  }
+  // Headers of device regsts are separated in host memory and not read by the comm net, so
+  // only blobs of static shapes can be read into device memory.
+  return !Global<OpGraph>::Get()->GetLogicalBlobDesc(lbi).is_dynamic();
+}
+
 }  // namespace
 
 TaskGraph::TaskGraph() {
@@ -502,6 +516,13 @@ TaskNode* TaskGraph::GetProxyNode(TaskNode* src_node, const LogicalBlobId& lbi,
         proxy2node[key] = copy_comm_net_task;
         return copy_comm_net_task;
       }
+    } else if (IsCommNetDeviceToDeviceReadable(src_mem_zone_id, dst_mem_zone_id, lbi)) {
+      // read from the device of src into the device of dst, without host proxies
+      CopyCommNetTaskNode* copy_comm_net_task = NewNode<CopyCommNetTaskNode>();
+      copy_comm_net_task->Init(dst_mem_zone_id, lbi);
+      Connect<TaskNode>(src_node, NewTaskEdgeWithLbi(lbi), copy_comm_net_task);
+      proxy2node[key] = copy_comm_net_task;
+      return copy_comm_net_task;
     } else {
       TaskNode* proxy_on_dst_host =
           GetProxyNode(src_node, lbi, GetNodeCPUMemZoneId(dst_mem_zone_id.rank()));
@@ -30,6 +30,13 @@ class TaskIdGenerator final {
 
   TaskId Generate(const StreamId& stream_id);
 
+  const HashMap<StreamId, task_index_t>& stream_id2task_index_counter() const {
+    return stream_id2task_index_counter_;
+  }
+  void SetTaskIndexCounter(const StreamId& stream_id, task_index_t counter) {
+    stream_id2task_index_counter_[stream_id] = counter;
+  }
+
  private:
   HashMap<StreamId, task_index_t> stream_id2task_index_counter_;
 };
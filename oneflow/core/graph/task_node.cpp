@@ -234,6 +234,40 @@ void TaskNode::ToProto(TaskProto* task_proto) const {
   }
 }
 
+void TaskNode::ToRemoteProto(TaskProto* task_proto) const {
+  CHECK_NE(chain_id_, -1);
+  task_proto->set_task_type(GetTaskType());
+  task_proto->set_machine_id(machine_id_);
+  task_proto->set_thrd_id(thrd_id_);
+  task_proto->set_task_id(task_id_);
+  task_proto->set_job_id(GlobalJobDesc().job_id());
+  task_proto->mutable_task_set_info()->set_chain_id(chain_id_);
+  task_proto->mutable_task_set_info()->set_order_in_graph(order_in_graph_);
+  // The collective boxing plan is built from the op confs of the collective boxing tasks.
+  if (GetTaskType() == TaskType::kCollectiveBoxingGeneric) {
+    exec_gph_.ToExecSequence(parallel_ctx(), task_proto->mutable_exec_sequence());
+  } else {
+    task_proto->mutable_exec_sequence();
+  }
+  auto* produced_regst_proto = task_proto->mutable_produced_regst_desc();
+  for (auto& pair : produced_regsts_) {
+    RegstDescProto regst_desc_proto;
+    pair.second->ToProto(&regst_desc_proto);
+    if (regst_desc_proto.regst_desc_type().has_data_regst_desc()) {
+      regst_desc_proto.mutable_regst_desc_type()->mutable_data_regst_desc()->clear_lbi2blob_desc();
+    }
+    CHECK(produced_regst_proto->insert({pair.first, regst_desc_proto}).second);
+  }
+  auto* consumed_regst_proto = task_proto->mutable_consumed_regst_desc_id();
+  for (const auto& pair : consumed_regsts_) {
+    RegstDescIdSet regst_desc_ids;
+    for (const std::shared_ptr<RegstDesc>& regst : pair.second) {
+      regst_desc_ids.add_regst_desc_id(regst->regst_desc_id());
+    }
+    CHECK(consumed_regst_proto->insert({pair.first, regst_desc_ids}).second);
+  }
+}
+
 MemZoneId TaskNode::MemZoneId121() const {
   StreamId stream_id = DecodeStreamIdFromInt64(thrd_id_);
   return stream_id.device_id();
@@ -21,6 +21,13 @@ limitations under the License.
 #ifdef WITH_HWLOC
 #include <hwloc.h>
 #endif  // WITH_HWLOC
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <sstream>
+#endif  // __linux__
 
 namespace oneflow {
 
@@ -69,6 +76,8 @@ class DummyTopologyDescriptor : public TopologyDescriptor {
     return std::make_shared<const DummyMemoryAffinityDescriptor>();
   }
 
+  int32_t GetNumaNodeByPCIBusID(const std::string& bus_id) const override { return -1; }
+
   void SetCPUAffinity(
       const std::shared_ptr<const TopologyCPUAffinityDescriptor>& affinity) const override {}
 
@@ -87,6 +96,14 @@ class HWLocCPUAffinityDescriptor : public TopologyCPUAffinityDescriptor {
 
   hwloc_cpuset_t HWLocCPUSet() const { return hwloc_cpu_set_; }
 
+  std::string ToString() const override {
+    char* buffer = nullptr;
+    if (hwloc_bitmap_list_asprintf(&buffer, hwloc_cpu_set_) < 0) { return ""; }
+    std::string str(buffer);
+    free(buffer);  // NOLINT
+    return str;
+  }
+
  private:
   hwloc_cpuset_t hwloc_cpu_set_;
 };
@@ -144,6 +161,14 @@ class HWLocTopologyDescriptor : public TopologyDescriptor {
         hwloc_bitmap_dup(non_io_ancestor->cpuset), HWLOC_MEMBIND_BIND);
   }
 
+  int32_t GetNumaNodeByPCIBusID(const std::string& bus_id) const override {
+    if (bus_id.empty()) { return -1; }
+    hwloc_obj_t non_io_ancestor = GetNonIOAncestorByPCIBusID(bus_id);
+    if (non_io_ancestor == nullptr) { return -1; }
+    if (non_io_ancestor->nodeset == nullptr) { return -1; }
+    return hwloc_bitmap_first(non_io_ancestor->nodeset);
+  }
+
   void SetCPUAffinity(
       const std::shared_ptr<const TopologyCPUAffinityDescriptor>& affinity) const override {
     auto hwloc_affinity = std::dynamic_pointer_cast<const HWLocCPUAffinityDescriptor>(affinity);
@@ -212,11 +237,172 @@ class HWLocTopologyDescriptor : public TopologyDescriptor {
 
 #endif  // WITH_HWLOC
 
+#ifdef __linux__
+
+// Node masks passed to the kernel cover this many NUMA nodes.
+constexpr unsigned long kSysfsMaxNumaNodes = 1024;
+constexpr size_t kSysfsNodeMaskWords = kSysfsMaxNumaNodes / (8 * sizeof(unsigned long));
+
+std::string ReadSysfsLine(const std::string& path) {
+  std::ifstream ifs(path);
+  std::string line;
+  if (ifs.is_open()) { std::getline(ifs, line); }
+  return line;
+}
+
+std::string SysfsPCIDevicePath(const std::string& bus_id) {
+  std::string lower_bus_id = bus_id;
+  std::transform(lower_bus_id.begin(), lower_bus_id.end(), lower_bus_id.begin(), ::tolower);
+  return "/sys/bus/pci/devices/" + lower_bus_id;
+}
+
+// Parses a cpu list like "0-23,48-71".
+bool ParseCPUList(const std::string& cpu_list, cpu_set_t* cpu_set) {
+  CPU_ZERO(cpu_set);
+  bool has_cpu = false;
+  std::istringstream iss(cpu_list);
+  std::string range;
+  while (std::getline(iss, range, ',')) {
+    int first = -1;
+    int last = -1;
+    const int num_parsed = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (num_parsed == 1) { last = first; }
+    if (num_parsed < 1 || first < 0 || last < first) { return false; }
+    for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, cpu_set);
+      has_cpu = true;
+    }
+  }
+  return has_cpu;
+}
+
+std::string CPUListString(const cpu_set_t& cpu_set) {
+  std::string cpu_list;
+  int cpu = 0;
+  while (cpu < CPU_SETSIZE) {
+    if (!CPU_ISSET(cpu, &cpu_set)) {
+      cpu += 1;
+      continue;
+    }
+    int last = cpu;
+    while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpu_set)) { last += 1; }
+    if (!cpu_list.empty()) { cpu_list += ","; }
+    cpu_list += std::to_string(cpu);
+    if (last != cpu) { cpu_list += "-" + std::to_string(last); }
+    cpu = last + 1;
+  }
+  return cpu_list;
+}
+
+class SysfsCPUAffinityDescriptor : public TopologyCPUAffinityDescriptor {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SysfsCPUAffinityDescriptor);
+  explicit SysfsCPUAffinityDescriptor(const cpu_set_t& cpu_set) : cpu_set_(cpu_set) {}
+  ~SysfsCPUAffinityDescriptor() override = default;
+
+  const cpu_set_t& CPUSet() const { return cpu_set_; }
+
+  std::string ToString() const override { return CPUListString(cpu_set_); }
+
+ private:
+  cpu_set_t cpu_set_;
+};
+
+class SysfsMemoryAffinityDescriptor : public TopologyMemoryAffinityDescriptor {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SysfsMemoryAffinityDescriptor);
+  SysfsMemoryAffinityDescriptor(int mode, std::vector<unsigned long> node_mask)
+      : mode_(mode), node_mask_(std::move(node_mask)) {}
+  ~SysfsMemoryAffinityDescriptor() override = default;
+
+  int Mode() const { return mode_; }
+  const std::vector<unsigned long>& NodeMask() const { return node_mask_; }
+
+ private:
+  int mode_;
+  std::vector<unsigned long> node_mask_;
+};
+
+// Reads the locality of PCI devices from sysfs and binds with the syscalls hwloc uses, for builds
+// without hwloc. It can not be serialized, the topology of other nodes is unknown.
+class SysfsTopologyDescriptor : public TopologyDescriptor {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SysfsTopologyDescriptor);
+  SysfsTopologyDescriptor() = default;
+  ~SysfsTopologyDescriptor() override = default;
+
+  std::shared_ptr<const TopologyCPUAffinityDescriptor> GetCPUAffinity() const override {
+    cpu_set_t cpu_set;
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) { return nullptr; }
+    return std::make_shared<const SysfsCPUAffinityDescriptor>(cpu_set);
+  }
+
+  std::shared_ptr<const TopologyMemoryAffinityDescriptor> GetMemoryAffinity() const override {
+    int mode = MPOL_DEFAULT;
+    std::vector<unsigned long> node_mask(kSysfsNodeMaskWords, 0);
+    if (syscall(SYS_get_mempolicy, &mode, node_mask.data(), kSysfsMaxNumaNodes, nullptr, 0UL)
+        != 0) {
+      return nullptr;
+    }
+    return std::make_shared<const SysfsMemoryAffinityDescriptor>(mode, std::move(node_mask));
+  }
+
+  std::shared_ptr<const TopologyCPUAffinityDescriptor> GetCPUAffinityByPCIBusID(
+      const std::string& bus_id) const override {
+    if (bus_id.empty()) { return nullptr; }
+    cpu_set_t cpu_set;
+    if (!ParseCPUList(ReadSysfsLine(SysfsPCIDevicePath(bus_id) + "/local_cpulist"), &cpu_set)) {
+      return nullptr;
+    }
+    return std::make_shared<const SysfsCPUAffinityDescriptor>(cpu_set);
+  }
+
+  std::shared_ptr<const TopologyMemoryAffinityDescriptor> GetMemoryAffinityByPCIBusID(
+      const std::string& bus_id) const override {
+    const int32_t numa_node = GetNumaNodeByPCIBusID(bus_id);
+    if (numa_node < 0 || numa_node >= static_cast<int64_t>(kSysfsMaxNumaNodes)) {
+      return nullptr;
+    }
+    std::vector<unsigned long> node_mask(kSysfsNodeMaskWords, 0);
+    const size_t word_bits = 8 * sizeof(unsigned long);
+    node_mask.at(numa_node / word_bits) |= 1UL << (numa_node % word_bits);
+    return std::make_shared<const SysfsMemoryAffinityDescriptor>(MPOL_BIND, std::move(node_mask));
+  }
+
+  int32_t GetNumaNodeByPCIBusID(const std::string& bus_id) const override {
+    if (bus_id.empty()) { return -1; }
+    const std::string numa_node = ReadSysfsLine(SysfsPCIDevicePath(bus_id) + "/numa_node");
+    if (numa_node.empty()) { return -1; }
+    // Machines with a single NUMA node report -1.
+    return std::max(std::atoi(numa_node.c_str()), -1);
+  }
+
+  void SetCPUAffinity(
+      const std::shared_ptr<const TopologyCPUAffinityDescriptor>& affinity) const override {
+    auto sysfs_affinity = std::dynamic_pointer_cast<const SysfsCPUAffinityDescriptor>(affinity);
+    if (!sysfs_affinity) { return; }
+    sched_setaffinity(0, sizeof(cpu_set_t), &sysfs_affinity->CPUSet());
+  }
+
+  void SetMemoryAffinity(
+      const std::shared_ptr<const TopologyMemoryAffinityDescriptor>& affinity) const override {
+    auto sysfs_affinity = std::dynamic_pointer_cast<const SysfsMemoryAffinityDescriptor>(affinity);
+    if (!sysfs_affinity) { return; }
+    syscall(SYS_set_mempolicy, sysfs_affinity->Mode(), sysfs_affinity->NodeMask().data(),
+            kSysfsMaxNumaNodes);
+  }
+};
+
+#endif  // __linux__
+
 std::shared_ptr<const TopologyDescriptor> QueryTopologyDescriptor() {
   std::shared_ptr<const TopologyDescriptor> topology;
 #ifdef WITH_HWLOC
   topology = HWLocTopologyDescriptor::Query();
 #endif  // WITH_HWLOC
+#ifdef __linux__
+  if (!topology) { topology.reset(new SysfsTopologyDescriptor()); }
+#endif  // __linux__
   if (!topology) { topology.reset(new DummyTopologyDescriptor()); }
   return topology;
 }
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/hardware/node_device_descriptor_manager.h"
+#include "oneflow/core/hardware/cuda_device_descriptor.h"
+#include "oneflow/core/hardware/topology_descriptor.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
@@ -28,6 +30,27 @@ std::string MakeNodeDeviceDescriptorRpcKey(const int64_t rank) {
   return "NodeDeviceDescriptorRpcKey/" + std::to_string(rank);
 }
 
+// Logs the NUMA node and cpus each local GPU binds its stream threads and pinned memory to.
+void LogCudaDeviceAffinity(int64_t rank, const NodeDeviceDescriptor& node_desc) {
+#ifdef WITH_CUDA
+  auto cuda_devices = node_desc.GetDeviceDescriptorList(kCudaDeviceDescriptorClassName);
+  if (!cuda_devices) { return; }
+  const auto& topology = node_desc.Topology();
+  for (size_t i = 0; i < cuda_devices->DeviceCount(); ++i) {
+    auto cuda_device =
+        std::dynamic_pointer_cast<const CudaDeviceDescriptor>(cuda_devices->GetDevice(i));
+    if (!cuda_device) { continue; }
+    const std::string& bus_id = cuda_device->PCIBusID();
+    const int32_t numa_node = topology->GetNumaNodeByPCIBusID(bus_id);
+    const auto cpu_affinity = topology->GetCPUAffinityByPCIBusID(bus_id);
+    const std::string cpu_list = cpu_affinity ? cpu_affinity->ToString() : "";
+    LOG(INFO) << "rank " << rank << " cuda:" << i << " (" << bus_id << ") binds to numa node "
+              << (numa_node < 0 ? "unknown" : std::to_string(numa_node)) << ", cpus "
+              << (cpu_list.empty() ? "unknown" : cpu_list);
+  }
+#endif  // WITH_CUDA
+}
+
 }  // namespace
 
 struct NodeDeviceDescriptorManager::Impl {
@@ -40,6 +63,7 @@ NodeDeviceDescriptorManager::NodeDeviceDescriptorManager() {
   impl_.reset(new Impl(GlobalProcessCtx::Rank(), GlobalProcessCtx::WorldSize()));
   std::shared_ptr<const NodeDeviceDescriptor> local = NodeDeviceDescriptor::Query();
   impl_->nodes.at(impl_->rank) = local;
+  LogCudaDeviceAffinity(impl_->rank, *local);
   if (impl_->nodes.size() > 1) {
     std::string serialized_local_node;
     local->Serialize(&serialized_local_node);
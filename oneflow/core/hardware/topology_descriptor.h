@@ -29,6 +29,9 @@ class TopologyCPUAffinityDescriptor {
   OF_DISALLOW_COPY_AND_MOVE(TopologyCPUAffinityDescriptor);
   TopologyCPUAffinityDescriptor() = default;
   virtual ~TopologyCPUAffinityDescriptor() = default;
+
+  // A cpu list like "0-23,48-71", empty if unknown.
+  virtual std::string ToString() const { return ""; }
 };
 
 class TopologyMemoryAffinityDescriptor {
@@ -50,6 +53,8 @@ class TopologyDescriptor {
       const std::string& bus_id) const = 0;
   virtual std::shared_ptr<const TopologyMemoryAffinityDescriptor> GetMemoryAffinityByPCIBusID(
       const std::string& bus_id) const = 0;
+  // Returns -1 if the NUMA node of the device is unknown.
+  virtual int32_t GetNumaNodeByPCIBusID(const std::string& bus_id) const = 0;
   virtual void SetCPUAffinity(
       const std::shared_ptr<const TopologyCPUAffinityDescriptor>& affinity) const = 0;
   virtual void SetMemoryAffinity(
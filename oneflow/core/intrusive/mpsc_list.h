@@ -0,0 +1,133 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_INTRUSIVE_MPSC_LIST_H_
+#define ONEFLOW_CORE_INTRUSIVE_MPSC_LIST_H_
+
+#include <atomic>
+#include "oneflow/core/intrusive/list.h"
+
+namespace oneflow {
+
+namespace intrusive {
+
+struct MpscListHook {
+ public:
+  MpscListHook() : next_(nullptr) {}
+
+  MpscListHook* next() const { return next_; }
+  void set_next(MpscListHook* next) { next_ = next; }
+
+ private:
+  MpscListHook* next_;
+};
+
+// Lock-free multi-producer single-consumer list. It is a drop-in replacement of MutexedList for
+// the case that only one thread calls MoveTo/Clear.
+// Producers link elements into a stack through MpscListHook and publish a whole batch with a
+// single compare-and-swap. The consumer detaches the stack with a single exchange and restores
+// the FIFO order before splicing elements into a List.
+// An element must not be in any List while it is in a MpscList, and vice versa.
+template<typename ListHookField, typename MpscHookField>
+class MpscList {
+ public:
+  using value_type = typename ListHookField::struct_type;
+  using list_type = List<ListHookField>;
+  static_assert(std::is_same<typename MpscHookField::struct_type, value_type>::value, "");
+  static_assert(std::is_same<typename MpscHookField::field_type, MpscListHook>::value,
+                "no MpscListHook found");
+
+  MpscList(const MpscList&) = delete;
+  MpscList(MpscList&&) = delete;
+  MpscList() : top_(nullptr), size_(0) {}
+  ~MpscList() { this->Clear(); }
+
+  // size_ is increased before a batch is published, so size() may be greater than the number of
+  // elements MoveTo gets, but never less than zero.
+  std::size_t thread_unsafe_size() const { return size_.load(std::memory_order_relaxed); }
+  std::size_t size() const { return size_.load(std::memory_order_acquire); }
+  bool empty() const { return top_.load(std::memory_order_acquire) == nullptr; }
+
+  void EmplaceBack(intrusive::shared_ptr<value_type>&& ptr) {
+    value_type* raw_ptr = nullptr;
+    ptr.__UnsafeMoveTo__(&raw_ptr);
+    MpscListHook* hook = MpscHookField::FieldPtr4StructPtr(raw_ptr);
+    Push(hook, hook, 1);
+  }
+  void PushBack(value_type* ptr) { EmplaceBack(intrusive::shared_ptr<value_type>(ptr)); }
+
+  // Returns true if old list is empty.
+  bool MoveFrom(list_type* src) {
+    if (src->empty()) { return empty(); }
+    const std::size_t size = src->size();
+    // Link elements in reversed order, so that `first` points to the newest one.
+    MpscListHook* first = nullptr;
+    MpscListHook* last = nullptr;
+    while (!src->empty()) {
+      value_type* raw_ptr = nullptr;
+      // The reference held by `src` is transferred to this list.
+      src->PopFront().__UnsafeMoveTo__(&raw_ptr);
+      MpscListHook* hook = MpscHookField::FieldPtr4StructPtr(raw_ptr);
+      hook->set_next(first);
+      first = hook;
+      if (last == nullptr) { last = hook; }
+    }
+    return Push(first, last, size);
+  }
+
+  // Only one thread is allowed to call MoveTo.
+  void MoveTo(list_type* dst) {
+    MpscListHook* hook = top_.exchange(nullptr, std::memory_order_acquire);
+    if (hook == nullptr) { return; }
+    list_type list;
+    std::size_t size = 0;
+    while (hook != nullptr) {
+      MpscListHook* next = hook->next();
+      hook->set_next(nullptr);
+      value_type* raw_ptr = MpscHookField::StructPtr4FieldPtr(hook);
+      list.EmplaceFront(intrusive::shared_ptr<value_type>::__UnsafeMove__(raw_ptr));
+      ++size;
+      hook = next;
+    }
+    size_.fetch_sub(size, std::memory_order_relaxed);
+    list.MoveToDstBack(dst);
+  }
+
+  void Clear() {
+    list_type list;
+    MoveTo(&list);
+  }
+
+ private:
+  // Returns true if old list is empty.
+  bool Push(MpscListHook* first, MpscListHook* last, std::size_t size) {
+    size_.fetch_add(size, std::memory_order_relaxed);
+    MpscListHook* old_top = top_.load(std::memory_order_relaxed);
+    do {
+      last->set_next(old_top);
+    } while (!top_.compare_exchange_weak(old_top, first, std::memory_order_release,
+                                         std::memory_order_relaxed));
+    return old_top == nullptr;
+  }
+
+  std::atomic<MpscListHook*> top_;
+  std::atomic<std::size_t> size_;
+};
+
+}  // namespace intrusive
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_INTRUSIVE_MPSC_LIST_H_
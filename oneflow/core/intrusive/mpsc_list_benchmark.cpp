@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/intrusive/intrusive.h"
+#include "oneflow/core/intrusive/mutexed_list.h"
+#include "oneflow/core/intrusive/mpsc_list.h"
+
+// Compares the throughput of MpscList and MutexedList under the access pattern of
+// VirtualMachineEngine: several producers publish batches with MoveFrom while a single consumer
+// drains the list with MoveTo in a busy loop. The records are printed as a json array.
+// Configured through the environment:
+//   ONEFLOW_MPSC_LIST_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_MPSC_LIST_BENCHMARK_NUM_ITEMS: items published by each producer, 1048576 by default.
+
+namespace oneflow {
+
+namespace intrusive {
+
+namespace {
+
+class BenchmarkItem : public intrusive::Base {
+ public:
+  void __Init__() {}
+
+  intrusive::ListHook list_hook_;
+  intrusive::MpscListHook mpsc_hook_;
+
+ private:
+  friend class intrusive::Ref;
+  intrusive::Ref* mut_intrusive_ref() { return &intrusive_ref_; }
+
+  BenchmarkItem() : list_hook_(), mpsc_hook_(), intrusive_ref_() {}
+  intrusive::Ref intrusive_ref_;
+};
+
+using BenchmarkList = List<INTRUSIVE_FIELD(BenchmarkItem, list_hook_)>;
+using BenchmarkMutexedList = MutexedList<INTRUSIVE_FIELD(BenchmarkItem, list_hook_)>;
+using BenchmarkMpscList = MpscList<INTRUSIVE_FIELD(BenchmarkItem, list_hook_),
+                                   INTRUSIVE_FIELD(BenchmarkItem, mpsc_hook_)>;
+
+// Items are allocated before timing, so only the list operations are measured.
+template<typename SharedList>
+double RunProducersAndConsumer(SharedList* shared_list, int num_producers, int64_t num_items,
+                               int64_t batch_size) {
+  std::vector<std::unique_ptr<BenchmarkList>> inputs(num_producers);
+  for (auto& input : inputs) {
+    input.reset(new BenchmarkList());
+    for (int64_t i = 0; i < num_items; ++i) {
+      input->EmplaceBack(intrusive::make_shared<BenchmarkItem>());
+    }
+  }
+  const size_t total_items = num_producers * num_items;
+  BenchmarkList output;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      BenchmarkList batch;
+      while (!inputs.at(p)->empty()) {
+        inputs.at(p)->MoveFrontToDstBack(&batch);
+        if (batch.size() >= static_cast<size_t>(batch_size)) { shared_list->MoveFrom(&batch); }
+      }
+      shared_list->MoveFrom(&batch);
+    });
+  }
+  while (output.size() < total_items) {
+    if (shared_list->thread_unsafe_size() > 0) { shared_list->MoveTo(&output); }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  for (auto& producer : producers) { producer.join(); }
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  return total_items / seconds;
+}
+
+int Main() {
+  const int64_t num_items = ParseIntegerFromEnv("ONEFLOW_MPSC_LIST_BENCHMARK_NUM_ITEMS", 1 << 20);
+  const int max_producers =
+      std::max<int>(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+  std::vector<nlohmann::json> records;
+  for (int num_producers = 1; num_producers <= max_producers; num_producers *= 2) {
+    for (const int64_t batch_size : {1, 8, 64}) {
+      nlohmann::json record;
+      record["num_producers"] = num_producers;
+      record["batch_size"] = batch_size;
+      record["num_items_per_producer"] = num_items;
+      {
+        std::mutex mutex;
+        BenchmarkMutexedList mutexed_list(&mutex);
+        record["mutexed_list_items_per_second"] =
+            RunProducersAndConsumer(&mutexed_list, num_producers, num_items, batch_size);
+      }
+      {
+        BenchmarkMpscList mpsc_list;
+        record["mpsc_list_items_per_second"] =
+            RunProducersAndConsumer(&mpsc_list, num_producers, num_items, batch_size);
+      }
+      records.push_back(record);
+    }
+  }
+  const std::string output = GetStringFromEnv("ONEFLOW_MPSC_LIST_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace intrusive
+
+}  // namespace oneflow
+
+int main() { return oneflow::intrusive::Main(); }
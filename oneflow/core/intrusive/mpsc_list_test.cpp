@@ -0,0 +1,132 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/intrusive/intrusive.h"
+#include "oneflow/core/intrusive/mpsc_list.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+class TestMpscItem : public intrusive::Base {
+ public:
+  void __Init__(int64_t value) { value_ = value; }
+
+  int64_t value() const { return value_; }
+  size_t ref_cnt() const { return intrusive_ref_.ref_cnt(); }
+
+  intrusive::ListHook list_hook_;
+  intrusive::MpscListHook mpsc_hook_;
+
+ private:
+  friend class intrusive::Ref;
+  intrusive::Ref* mut_intrusive_ref() { return &intrusive_ref_; }
+
+  TestMpscItem() : list_hook_(), mpsc_hook_(), intrusive_ref_(), value_() {}
+  intrusive::Ref intrusive_ref_;
+  int64_t value_;
+};
+
+using TestList = intrusive::List<INTRUSIVE_FIELD(TestMpscItem, list_hook_)>;
+using TestMpscList = intrusive::MpscList<INTRUSIVE_FIELD(TestMpscItem, list_hook_),
+                                         INTRUSIVE_FIELD(TestMpscItem, mpsc_hook_)>;
+
+TEST(MpscList, empty) {
+  TestMpscList mpsc_list;
+  ASSERT_TRUE(mpsc_list.empty());
+  ASSERT_EQ(mpsc_list.size(), 0);
+  TestList list;
+  mpsc_list.MoveTo(&list);
+  ASSERT_TRUE(list.empty());
+}
+
+TEST(MpscList, MoveFrom_MoveTo_keep_order) {
+  TestMpscList mpsc_list;
+  TestList src;
+  for (int64_t i = 0; i < 3; ++i) { src.EmplaceBack(intrusive::make_shared<TestMpscItem>(i)); }
+  ASSERT_TRUE(mpsc_list.MoveFrom(&src));
+  ASSERT_TRUE(src.empty());
+  for (int64_t i = 3; i < 5; ++i) { src.EmplaceBack(intrusive::make_shared<TestMpscItem>(i)); }
+  ASSERT_FALSE(mpsc_list.MoveFrom(&src));
+  mpsc_list.EmplaceBack(intrusive::make_shared<TestMpscItem>(5));
+  ASSERT_EQ(mpsc_list.size(), 6);
+  TestList dst;
+  mpsc_list.MoveTo(&dst);
+  ASSERT_TRUE(mpsc_list.empty());
+  ASSERT_EQ(mpsc_list.size(), 0);
+  ASSERT_EQ(dst.size(), 6);
+  int64_t expected = 0;
+  INTRUSIVE_FOR_EACH_PTR(item, &dst) {
+    ASSERT_EQ(item->value(), expected);
+    ASSERT_EQ(item->ref_cnt(), 1);
+    ++expected;
+  }
+}
+
+TEST(MpscList, Clear) {
+  auto item = intrusive::make_shared<TestMpscItem>(0);
+  {
+    TestMpscList mpsc_list;
+    mpsc_list.PushBack(item.Mutable());
+    ASSERT_EQ(item->ref_cnt(), 2);
+  }
+  ASSERT_EQ(item->ref_cnt(), 1);
+}
+
+TEST(MpscList, multi_producer) {
+  constexpr int kNumProducers = 4;
+  constexpr int64_t kNumItemsPerProducer = 10000;
+  constexpr int64_t kBatchSize = 7;
+  TestMpscList mpsc_list;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; ++p) {
+    producers.emplace_back([&, p]() {
+      TestList batch;
+      for (int64_t i = 0; i < kNumItemsPerProducer; ++i) {
+        batch.EmplaceBack(intrusive::make_shared<TestMpscItem>(p * kNumItemsPerProducer + i));
+        if (batch.size() == kBatchSize) { mpsc_list.MoveFrom(&batch); }
+      }
+      mpsc_list.MoveFrom(&batch);
+    });
+  }
+  std::vector<int64_t> last_value(kNumProducers, -1);
+  int64_t num_received = 0;
+  TestList dst;
+  while (num_received < kNumProducers * kNumItemsPerProducer) {
+    mpsc_list.MoveTo(&dst);
+    INTRUSIVE_FOR_EACH_PTR(item, &dst) {
+      const int p = item->value() / kNumItemsPerProducer;
+      // Items from the same producer are received in FIFO order.
+      EXPECT_LT(last_value.at(p), item->value());
+      last_value.at(p) = item->value();
+      ++num_received;
+      dst.Erase(item);
+    }
+  }
+  for (auto& producer : producers) { producer.join(); }
+  ASSERT_TRUE(mpsc_list.empty());
+  ASSERT_EQ(mpsc_list.size(), 0);
+}
+
+}  // namespace
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_INTRUSIVE_OBJECT_POOL_H_
 #define ONEFLOW_CORE_INTRUSIVE_OBJECT_POOL_H_
 
+#include <atomic>
 #include <vector>
 #include "oneflow/core/intrusive/cpp_attribute.h"
 
@@ -24,6 +25,8 @@ namespace intrusive {
 
 enum ObjectPoolStrategey {
   kThreadUnsafeAndDisableDestruct,
+  // Objects are allocated by the thread owning the pool and may be released by any other thread.
+  kCrossThreadReturnAndDisableDestruct,
 };
 
 template<typename T, ObjectPoolStrategey object_pool_strategy>
@@ -45,6 +48,26 @@ class EnableObjectPool {
   object_pool_type* object_pool_;
 };
 
+template<typename T>
+class EnableObjectPool<T, kCrossThreadReturnAndDisableDestruct> {
+ public:
+  EnableObjectPool() = default;
+  EnableObjectPool(const EnableObjectPool&) = default;
+  EnableObjectPool(EnableObjectPool&&) = default;
+  ~EnableObjectPool() = default;
+
+  using object_pool_type = ObjectPool<T, kCrossThreadReturnAndDisableDestruct>;
+  object_pool_type* mut_object_pool() { return object_pool_; }
+  void set_object_pool(object_pool_type* val) { object_pool_ = val; }
+  T* object_pool_next() const { return object_pool_next_; }
+  void set_object_pool_next(T* val) { object_pool_next_ = val; }
+
+ private:
+  object_pool_type* object_pool_;
+  // link of the stack of objects returned by other threads.
+  T* object_pool_next_;
+};
+
 template<typename T>
 class ObjectPool<T, kThreadUnsafeAndDisableDestruct> {
  public:
@@ -85,6 +108,96 @@ class ObjectPool<T, kThreadUnsafeAndDisableDestruct> {
   std::vector<T*> container_;
 };
 
+// Each thread allocates from its own pool, see ThreadLocal(). Released objects are pushed onto a
+// lock-free stack of the pool they come from, which the owner thread takes over as a whole once its
+// own free list runs dry, so neither side takes a lock. __Delete__ is called on release, the
+// references an object holds are dropped by the releasing thread instead of lingering in the pool.
+template<typename T>
+class ObjectPool<T, kCrossThreadReturnAndDisableDestruct> {
+ public:
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool(ObjectPool&&) = delete;
+
+  static ObjectPool* ThreadLocal() {
+    static thread_local Owner owner;
+    return owner.object_pool;
+  }
+
+  template<typename... Args>
+  intrusive::shared_ptr<T> make_shared(Args&&... args) {
+    if (INTRUSIVE_PREDICT_FALSE(container_.empty())) { ReclaimReturned(); }
+    if (INTRUSIVE_PREDICT_FALSE(container_.empty())) {
+      auto ptr = intrusive::make_shared<T>(std::forward<Args>(args)...);
+      InitObjectPoolFields4Element(ptr.get());
+      return ptr;
+    } else {
+      auto* ptr = container_.back();
+      container_.pop_back();
+      ptr->__Init__(std::forward<Args>(args)...);
+      return intrusive::shared_ptr<T>(ptr);
+    }
+  }
+
+  static void Put(void* raw_ptr) {
+    T* ptr = reinterpret_cast<T*>(raw_ptr);
+    ptr->__Delete__();
+    ptr->mut_object_pool()->Return(ptr);
+  }
+
+ private:
+  // The pool outlives its thread, objects may still be released after the thread exits. It is
+  // orphaned then, the objects returned to it are deleted from that point on.
+  struct Owner final {
+    Owner() : object_pool(new ObjectPool()) {}
+    ~Owner() { object_pool->Orphan(); }
+    ObjectPool* object_pool;
+  };
+
+  ObjectPool() : returned_(nullptr), orphaned_(false) { container_.reserve(kObjectPoolInitCap); }
+  ~ObjectPool() = delete;
+
+  inline void InitObjectPoolFields4Element(T* ptr) {
+    ptr->set_object_pool(this);
+    ptr->mut_intrusive_ref()->set_deleter(&ObjectPool::Put);
+  }
+
+  void Return(T* ptr) {
+    T* head = returned_.load(std::memory_order_relaxed);
+    do { ptr->set_object_pool_next(head); } while (!returned_.compare_exchange_weak(head, ptr));
+    // Either the owner sees this object when it deletes the returned ones, or this thread sees
+    // the pool orphaned.
+    if (INTRUSIVE_PREDICT_FALSE(orphaned_.load())) { DeleteReturned(); }
+  }
+
+  void ReclaimReturned() {
+    for (T* ptr = returned_.exchange(nullptr); ptr != nullptr; ptr = ptr->object_pool_next()) {
+      container_.push_back(ptr);
+    }
+  }
+
+  void DeleteReturned() {
+    T* ptr = returned_.exchange(nullptr);
+    while (ptr != nullptr) {
+      T* next = ptr->object_pool_next();
+      delete ptr;
+      ptr = next;
+    }
+  }
+
+  void Orphan() {
+    orphaned_.store(true);
+    for (auto* elem : container_) { delete elem; }
+    container_.clear();
+    container_.shrink_to_fit();
+    DeleteReturned();
+  }
+
+  static constexpr int kObjectPoolInitCap = 1024;
+  std::vector<T*> container_;
+  std::atomic<T*> returned_;
+  std::atomic<bool> orphaned_;
+};
+
 }  // namespace intrusive
 }  // namespace oneflow
 
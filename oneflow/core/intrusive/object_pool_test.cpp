@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <sstream>
+#include <thread>
 #include "gtest/gtest.h"
 #define private public
 #include "oneflow/core/common/util.h"
@@ -53,6 +54,50 @@ TEST(ObjectPool_kThreadUnsafeAndDisableDestruct, recycle) {
   ASSERT_EQ(ptr, object_pool.make_shared().get());
 }
 
+class IntrusiveBar final  // NOLINT
+    : public intrusive::Base,
+      public intrusive::EnableObjectPool<IntrusiveBar,
+                                         kCrossThreadReturnAndDisableDestruct> {  // NOLINT
+ public:
+  IntrusiveBar() = default;  // NOLINT
+
+  void __Init__() { value_ = std::make_shared<int>(0); }
+  void __Delete__() { value_.reset(); }
+
+  const std::shared_ptr<int>& value() const { return value_; }
+  intrusive::Ref* mut_intrusive_ref() { return &intrusive_ref_; }
+
+ private:
+  intrusive::Ref intrusive_ref_;
+  std::shared_ptr<int> value_;
+};
+
+TEST(ObjectPool_kCrossThreadReturnAndDisableDestruct, append_to_pool) {
+  auto* object_pool = ObjectPool<IntrusiveBar, kCrossThreadReturnAndDisableDestruct>::ThreadLocal();
+  IntrusiveBar* ptr = nullptr;
+  { ptr = object_pool->make_shared().get(); }
+  ASSERT_EQ(ptr, object_pool->make_shared().get());
+}
+
+TEST(ObjectPool_kCrossThreadReturnAndDisableDestruct, return_from_other_thread) {
+  auto* object_pool = ObjectPool<IntrusiveBar, kCrossThreadReturnAndDisableDestruct>::ThreadLocal();
+  auto object = object_pool->make_shared();
+  auto* ptr = object.get();
+  std::weak_ptr<int> value = object->value();
+  std::thread([&]() { object.Reset(); }).join();
+  ASSERT_TRUE(value.expired());
+  ASSERT_EQ(ptr, object_pool->make_shared().get());
+}
+
+TEST(ObjectPool_kCrossThreadReturnAndDisableDestruct, return_after_owner_exit) {
+  intrusive::shared_ptr<IntrusiveBar> object;
+  std::thread([&]() {
+    object = ObjectPool<IntrusiveBar, kCrossThreadReturnAndDisableDestruct>::ThreadLocal()
+                 ->make_shared();
+  }).join();
+  object.Reset();
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace intrusive
@@ -0,0 +1,114 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ipc/cuda_ipc_memory.h"
+
+#ifdef WITH_CUDA
+
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+namespace ipc {
+
+namespace {
+
+std::atomic<int64_t>* RefCount4Block(SharedMemory* ref_counts, int64_t block_id) {
+  return reinterpret_cast<std::atomic<int64_t>*>(ref_counts->mut_buf()) + block_id;
+}
+
+size_t BlockSize4Request(size_t size) {
+  // Device allocations are 2MB-granular anyway.
+  static constexpr size_t kMinBlockSize = 2 * 1024 * 1024;
+  size_t block_size = kMinBlockSize;
+  while (block_size < size) { block_size *= 2; }
+  return block_size;
+}
+
+}  // namespace
+
+CudaIpcMemoryPool& CudaIpcMemoryPool::get() {
+  static CudaIpcMemoryPool cuda_ipc_memory_pool;
+  return cuda_ipc_memory_pool;
+}
+
+Maybe<void> CudaIpcMemoryPool::InitRefCounts() {
+  if (ref_counts_) { return Maybe<void>::Ok(); }
+  const size_t ref_counts_size = kMaxBlocks * sizeof(std::atomic<int64_t>);
+  ref_counts_ = JUST(SharedMemory::Open(ref_counts_size, /*create=*/true));
+  return Maybe<void>::Ok();
+}
+
+Maybe<CudaIpcMemoryDesc> CudaIpcMemoryPool::Acquire(int64_t device_id, size_t size,
+                                                    void** dptr) {
+  const size_t block_size = BlockSize4Request(size);
+  std::unique_lock<std::mutex> lock(mutex_);
+  JUST(InitRefCounts());
+  int64_t block_id = -1;
+  const int64_t num_blocks = blocks_.size();
+  for (int64_t i = 0; i < num_blocks; ++i) {
+    if (blocks_.at(i).device_id != device_id || blocks_.at(i).size != block_size) { continue; }
+    int64_t expected = 0;
+    if (RefCount4Block(ref_counts_.get(), i)->compare_exchange_strong(expected, 1)) {
+      block_id = i;
+      break;
+    }
+  }
+  if (block_id == -1) {
+    CHECK_LT_OR_RETURN(num_blocks, kMaxBlocks)
+        << "all " << kMaxBlocks << " CUDA IPC blocks are still held by the receivers";
+    CudaCurrentDeviceGuard guard(device_id);
+    Block block{device_id, block_size, nullptr, {}};
+    OF_CUDA_CHECK(cudaMalloc(&block.dptr, block_size));
+    OF_CUDA_CHECK(cudaIpcGetMemHandle(&block.mem_handle, block.dptr));
+    block_id = num_blocks;
+    RefCount4Block(ref_counts_.get(), block_id)->store(1);
+    blocks_.emplace_back(block);
+  }
+  const Block& block = blocks_.at(block_id);
+  *dptr = block.dptr;
+  CudaIpcMemoryDesc desc;
+  desc.mem_handle = std::string(block.mem_handle.reserved, CUDA_IPC_HANDLE_SIZE);
+  desc.ref_counts_name = ref_counts_->name();
+  desc.device_id = device_id;
+  desc.block_id = block_id;
+  desc.size = block_size;
+  return desc;
+}
+
+Maybe<CudaIpcMemory> CudaIpcMemory::Open(const CudaIpcMemoryDesc& desc) {
+  // cudaIpcOpenMemHandle can't map the same allocation twice in a process, and the sender hands
+  // the same blocks out again and again.
+  static std::mutex mutex;
+  static std::map<std::string, void*> key2dptr;
+  CHECK_EQ_OR_RETURN(desc.mem_handle.size(), CUDA_IPC_HANDLE_SIZE);
+  const auto& ref_counts = JUST(SharedMemoryPool::get().Open(desc.ref_counts_name));
+  const std::string key = desc.ref_counts_name + std::to_string(desc.block_id) + desc.mem_handle;
+  std::unique_lock<std::mutex> lock(mutex);
+  void*& dptr = key2dptr[key];
+  if (dptr == nullptr) {
+    cudaIpcMemHandle_t mem_handle;
+    std::memcpy(mem_handle.reserved, desc.mem_handle.data(), CUDA_IPC_HANDLE_SIZE);
+    CudaCurrentDeviceGuard guard(desc.device_id);
+    OF_CUDA_CHECK(cudaIpcOpenMemHandle(&dptr, mem_handle, cudaIpcMemLazyEnablePeerAccess));
+  }
+  return std::shared_ptr<CudaIpcMemory>(new CudaIpcMemory(dptr, ref_counts, desc.block_id));
+}
+
+CudaIpcMemory::~CudaIpcMemory() { RefCount4Block(ref_counts_.get(), block_id_)->fetch_sub(1); }
+
+}  // namespace ipc
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
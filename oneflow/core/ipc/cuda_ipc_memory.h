@@ -0,0 +1,99 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_IPC_CUDA_IPC_MEMORY_H_
+#define ONEFLOW_CORE_IPC_CUDA_IPC_MEMORY_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/ipc/shared_memory.h"
+
+#ifdef WITH_CUDA
+
+#include <cuda_runtime.h>
+
+namespace oneflow {
+namespace ipc {
+
+// Everything a receiver needs to map a block exported by CudaIpcMemoryPool.
+struct CudaIpcMemoryDesc {
+  std::string mem_handle;
+  std::string ref_counts_name;
+  int64_t device_id;
+  int64_t block_id;
+  size_t size;
+};
+
+// Device blocks that other processes map with cudaIpcOpenMemHandle, so that a tensor produced on
+// the device in one process reaches another one without going through the host. A block is
+// cudaMalloc-ed by the pool itself, because an IPC handle always maps a whole allocation and the
+// caching allocator hands out pieces of larger ones. The reference count of every block lives in
+// a shared memory segment, and the sender reuses a block once the receivers have dropped it.
+// The sender has to outlive the receivers' use of the blocks.
+class CudaIpcMemoryPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CudaIpcMemoryPool);
+  ~CudaIpcMemoryPool() = default;
+
+  static constexpr int64_t kMaxBlocks = 1024;
+
+  // Sender side. Returns a block of at least `size` bytes on `device_id` with one reference taken
+  // on behalf of the receiver, and fails once all kMaxBlocks blocks are in use.
+  Maybe<CudaIpcMemoryDesc> Acquire(int64_t device_id, size_t size, void** dptr);
+
+  static CudaIpcMemoryPool& get();
+
+ private:
+  struct Block {
+    int64_t device_id;
+    size_t size;
+    void* dptr;
+    cudaIpcMemHandle_t mem_handle;
+  };
+
+  CudaIpcMemoryPool() = default;
+  Maybe<void> InitRefCounts();
+
+  std::vector<Block> blocks_;
+  std::shared_ptr<SharedMemory> ref_counts_;
+  std::mutex mutex_;
+};
+
+// Receiver side view of a block. The block is mapped at most once per process, and destroying
+// the view drops the reference the sender took for it.
+class CudaIpcMemory final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CudaIpcMemory);
+  ~CudaIpcMemory();
+
+  static Maybe<CudaIpcMemory> Open(const CudaIpcMemoryDesc& desc);
+
+  void* mut_dptr() const { return dptr_; }
+
+ private:
+  CudaIpcMemory(void* dptr, const std::shared_ptr<SharedMemory>& ref_counts, int64_t block_id)
+      : dptr_(dptr), ref_counts_(ref_counts), block_id_(block_id) {}
+
+  void* dptr_;
+  std::shared_ptr<SharedMemory> ref_counts_;
+  int64_t block_id_;
+};
+
+}  // namespace ipc
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
+
+#endif  // ONEFLOW_CORE_IPC_CUDA_IPC_MEMORY_H_
@@ -110,6 +110,20 @@ Maybe<std::set<std::string>> GetContentsOfShmDirectory() {
   TODO_THEN_RETURN();
 #endif
 }
+
+std::atomic<int64_t>* RefCount4Segment(SharedMemory* shm) {
+  static_assert(sizeof(std::atomic<int64_t>) <= SharedMemoryPool::kHeaderSize, "");
+  return reinterpret_cast<std::atomic<int64_t>*>(shm->mut_buf());
+}
+
+size_t SegmentSize4Request(size_t size) {
+  // Rounds up to a power of two so that batches of slightly different sizes share segments.
+  static constexpr size_t kMinSegmentSize = 4096;
+  size_t segment_size = kMinSegmentSize;
+  while (segment_size < size + SharedMemoryPool::kHeaderSize) { segment_size *= 2; }
+  return segment_size;
+}
+
 }  // namespace
 
 SharedMemoryManager& SharedMemoryManager::get() {
@@ -204,5 +218,67 @@ Maybe<void> SharedMemory::Unlink() {
 #endif
 }
 
+SharedMemoryPool& SharedMemoryPool::get() {
+  // Same as SharedMemoryManager, subprocesses don't have chance to delete a Global.
+  static SharedMemoryPool shared_memory_pool;
+  return shared_memory_pool;
+}
+
+Maybe<SharedMemory> SharedMemoryPool::Acquire(size_t size) {
+  const size_t segment_size = SegmentSize4Request(size);
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& shm : size2segments_[segment_size]) {
+    int64_t expected = 0;
+    if (RefCount4Segment(shm.get())->compare_exchange_strong(expected, 1)) { return shm; }
+  }
+  const size_t max_bytes = static_cast<size_t>(EnvInteger<ONEFLOW_SHARED_MEMORY_POOL_MAX_BYTES>());
+  if (pooled_bytes_ + segment_size > max_bytes) {
+    TrimIdleSegments(max_bytes > segment_size ? max_bytes - segment_size : 0);
+  }
+  const auto& shm = JUST(SharedMemory::Open(segment_size, /*create=*/true));
+  RefCount4Segment(shm.get())->store(1);
+  size2segments_[segment_size].emplace_back(shm);
+  pooled_bytes_ += segment_size;
+  return shm;
+}
+
+void SharedMemoryPool::TrimIdleSegments(size_t max_bytes) {
+  for (auto& pair : size2segments_) {
+    auto& segments = pair.second;
+    for (auto it = segments.begin(); it != segments.end() && pooled_bytes_ > max_bytes;) {
+      // Only unlinks the segments no receiver holds any more.
+      if (RefCount4Segment(it->get())->load() == 0) {
+        pooled_bytes_ -= (*it)->size();
+        CHECK_JUST((*it)->Unlink());
+        it = segments.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+Maybe<SharedMemory> SharedMemoryPool::Open(const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = name2opened_.find(name);
+  if (it != name2opened_.end()) { return it->second; }
+  const size_t max_opened = EnvInteger<ONEFLOW_SHARED_MEMORY_POOL_MAX_OPENED>();
+  if (name2opened_.size() >= max_opened) {
+    // Unmaps the segments no tensor of this process still lives in.
+    for (auto iter = name2opened_.begin(); iter != name2opened_.end();) {
+      if (iter->second.use_count() == 1) {
+        iter = name2opened_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+  const auto& shm = JUST(SharedMemory::Open(name, /*create=*/false));
+  name2opened_.emplace(name, shm);
+  return shm;
+}
+
+void SharedMemoryPool::Release(SharedMemory* shm) { RefCount4Segment(shm)->fetch_sub(1); }
+
 }  // namespace ipc
 }  // namespace oneflow
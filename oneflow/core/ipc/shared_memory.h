@@ -68,6 +68,36 @@ class SharedMemory final {
   size_t size_;
 };
 
+// Keeps the segments a process sends to others so that sharing a tensor doesn't cost a shm_open
+// and mmap every time. The first kHeaderSize bytes of a pooled segment count the references the
+// receivers still hold, and the sender takes a segment again once that count drops to zero.
+class SharedMemoryPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SharedMemoryPool);
+  ~SharedMemoryPool() = default;
+
+  static constexpr size_t kHeaderSize = 64;
+
+  // Sender side. Returns a segment with at least `size` bytes after the header and one reference
+  // taken on behalf of the receiver.
+  Maybe<SharedMemory> Acquire(size_t size);
+  // Receiver side. Maps the segment `name` at most once per process.
+  Maybe<SharedMemory> Open(const std::string& name);
+  // Receiver side. Drops the reference taken by Acquire.
+  static void Release(SharedMemory* shm);
+
+  static SharedMemoryPool& get();
+
+ private:
+  SharedMemoryPool() = default;
+  void TrimIdleSegments(size_t max_bytes);
+
+  std::map<size_t, std::vector<std::shared_ptr<SharedMemory>>> size2segments_;
+  size_t pooled_bytes_ = 0;
+  std::map<std::string, std::shared_ptr<SharedMemory>> name2opened_;
+  std::mutex mutex_;
+};
+
 }  // namespace ipc
 }  // namespace oneflow
 
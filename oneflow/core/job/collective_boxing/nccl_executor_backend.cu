@@ -23,10 +23,16 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/profiler/collective_trace.h"
+#include "oneflow/core/job/step_telemetry.h"
 
 #include <nccl.h>
+#include <cuda_fp16.h>
 
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 namespace oneflow {
@@ -106,6 +112,89 @@ void MultiCopy(cudaStream_t stream, const MultiCopyParams& multi_params) {
       multi_params);
 }
 
+template<typename T>
+__device__ T FloatTo(float v);
+
+template<>
+__device__ half FloatTo<half>(float v) {
+  return __float2half(v);
+}
+
+__device__ float ToFloat(half v) { return __half2float(v); }
+
+#if defined(__CUDA_BF16_TYPES_EXIST__)
+
+template<>
+__device__ nv_bfloat16 FloatTo<nv_bfloat16>(float v) {
+  return __float2bfloat16(v);
+}
+
+__device__ float ToFloat(nv_bfloat16 v) { return __bfloat162float(v); }
+
+#endif  // defined(__CUDA_BF16_TYPES_EXIST__)
+
+template<typename T>
+struct CompressParams {
+  const float* src;
+  float* residual;
+  T* dst;
+  int64_t count;
+};
+
+template<typename T>
+struct DecompressParams {
+  const T* src;
+  float* dst;
+  int64_t count;
+};
+
+constexpr int64_t kMultiCompressParamsMaxSize = 64;
+
+template<typename P>
+struct MultiCompressParams {
+  P params[kMultiCompressParamsMaxSize];
+  int64_t count;
+};
+
+template<typename T>
+__global__ void MultiCompressGpu(MultiCompressParams<CompressParams<T>> multi_params) {
+  for (int64_t p = 0; p < multi_params.count; ++p) {
+    const CompressParams<T> params = multi_params.params[p];
+    CUDA_1D_KERNEL_LOOP_T(int64_t, i, params.count) {
+      float v = params.src[i];
+      if (params.residual != nullptr) { v += params.residual[i]; }
+      const T compressed = FloatTo<T>(v);
+      params.dst[i] = compressed;
+      if (params.residual != nullptr) { params.residual[i] = v - ToFloat(compressed); }
+    }
+  }
+}
+
+template<typename T>
+__global__ void MultiDecompressGpu(MultiCompressParams<DecompressParams<T>> multi_params) {
+  for (int64_t p = 0; p < multi_params.count; ++p) {
+    const DecompressParams<T> params = multi_params.params[p];
+    CUDA_1D_KERNEL_LOOP_T(int64_t, i, params.count) { params.dst[i] = ToFloat(params.src[i]); }
+  }
+}
+
+// Kernel parameters are limited to 4KB, so params are launched in batches.
+template<typename P>
+void LaunchMultiCompress(cudaStream_t stream, const std::vector<P>& params,
+                         void (*kernel)(MultiCompressParams<P>)) {
+  for (size_t begin = 0; begin < params.size(); begin += kMultiCompressParamsMaxSize) {
+    MultiCompressParams<P> multi_params{};
+    multi_params.count = std::min<int64_t>(params.size() - begin, kMultiCompressParamsMaxSize);
+    int64_t max_count = 0;
+    for (int64_t i = 0; i < multi_params.count; ++i) {
+      multi_params.params[i] = params.at(begin + i);
+      max_count = std::max(max_count, multi_params.params[i].count);
+    }
+    if (max_count == 0) { continue; }
+    kernel<<<BlocksNum4ThreadsNum(max_count), kCudaThreadsNumPerBlock, 0, stream>>>(multi_params);
+  }
+}
+
 class CommRank final {
  public:
   OF_DISALLOW_COPY(CommRank);
@@ -202,14 +291,65 @@ class CommGroup final {
   int32_t global_rank_count_ = 0;
 };
 
+// Communicators of the devices of this node for the hierarchical all-reduce: a reduce-scatter
+// inside the node, an all-reduce across nodes for each local rank and an all-gather inside the
+// node.
+struct HierarchicalCommGroup {
+  CommGroup intra_node_group;
+  std::vector<CommGroup> local_rank2inter_node_group;
+};
+
+// Every node must hold the same number, more than one, of the devices.
+bool IsHierarchicalAllReduceSupported(const DeviceSet& device_set) {
+  std::map<int64_t, int64_t> machine_id2device_cnt;
+  for (const auto& device : device_set.device()) {
+    machine_id2device_cnt[device.machine_id()] += 1;
+  }
+  if (machine_id2device_cnt.size() <= 1) { return false; }
+  const int64_t device_cnt = machine_id2device_cnt.begin()->second;
+  if (device_cnt <= 1) { return false; }
+  for (const auto& pair : machine_id2device_cnt) {
+    if (pair.second != device_cnt) { return false; }
+  }
+  return true;
+}
+
+void InitHierarchicalCommGroup(const DeviceSet& device_set, const std::string& unique_name,
+                               HierarchicalCommGroup* hierarchical_comm_group) {
+  CHECK(IsHierarchicalAllReduceSupported(device_set));
+  std::map<int64_t, std::vector<int32_t>> machine_id2global_ranks;
+  for (int32_t i = 0; i < device_set.device_size(); ++i) {
+    machine_id2global_ranks[device_set.device(i).machine_id()].emplace_back(i);
+  }
+  const int64_t this_machine_id = GlobalProcessCtx::Rank();
+  DeviceSet intra_node_device_set;
+  for (const int32_t global_rank : machine_id2global_ranks.at(this_machine_id)) {
+    *intra_node_device_set.add_device() = device_set.device(global_rank);
+  }
+  hierarchical_comm_group->intra_node_group.InitGroup(
+      intra_node_device_set, unique_name + "-intra-" + std::to_string(this_machine_id));
+  const int32_t local_rank_count = intra_node_device_set.device_size();
+  hierarchical_comm_group->local_rank2inter_node_group.resize(local_rank_count);
+  for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+    DeviceSet inter_node_device_set;
+    for (const auto& pair : machine_id2global_ranks) {
+      *inter_node_device_set.add_device() = device_set.device(pair.second.at(local_rank));
+    }
+    hierarchical_comm_group->local_rank2inter_node_group.at(local_rank).InitGroup(
+        inter_node_device_set, unique_name + "-inter-" + std::to_string(local_rank));
+  }
+}
+
 class StreamCtx {
  public:
   OF_DISALLOW_COPY(StreamCtx);
   StreamCtx(int32_t device_id, size_t fusion_buffer_size)
       : device_id_(device_id), fusion_buffer_size_(fusion_buffer_size) {
     CudaCurrentDeviceGuard guard(device_id_);
-    int priority;
-    OF_CUDA_CHECK(cudaDeviceGetStreamPriorityRange(nullptr, &priority));
+    int priority = 0;
+    if (ParseBooleanFromEnv("ONEFLOW_COLLECTIVE_BOXING_STREAM_HIGH_PRIORITY", true)) {
+      OF_CUDA_CHECK(cudaDeviceGetStreamPriorityRange(nullptr, &priority));
+    }
     OF_CUDA_CHECK(cudaStreamCreateWithPriority(&stream_, cudaStreamNonBlocking, priority));
     OF_CUDA_CHECK(cudaMalloc(&fusion_buffer_, fusion_buffer_size_));
     cb_event_poller_ = std::thread(&StreamCtx::PollEvent, this);
@@ -260,7 +400,142 @@ class StreamCtx {
   std::thread cb_event_poller_;
 };
 
+// The cast error of a compressed all-reduce request on one device, added back to the request
+// before it is compressed again.
+class CompressionResidual final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompressionResidual);
+  CompressionResidual(int32_t device_id, int64_t elem_cnt, cudaStream_t stream)
+      : device_id_(device_id) {
+    CudaCurrentDeviceGuard guard(device_id_);
+    OF_CUDA_CHECK(cudaMalloc(&residual_, elem_cnt * sizeof(float)));
+    OF_CUDA_CHECK(cudaMemsetAsync(residual_, 0, elem_cnt * sizeof(float), stream));
+    OF_CUDA_CHECK(cudaEventCreateWithFlags(&event_, cudaEventDisableTiming));
+    OF_CUDA_CHECK(cudaEventRecord(event_, stream));
+  }
+  ~CompressionResidual() {
+    CudaCurrentDeviceGuard guard(device_id_);
+    OF_CUDA_CHECK(cudaEventSynchronize(event_));
+    OF_CUDA_CHECK(cudaEventDestroy(event_));
+    OF_CUDA_CHECK(cudaFree(residual_));
+  }
+
+  // Successive executions of a request may run on different streams.
+  float* Acquire(cudaStream_t stream) {
+    OF_CUDA_CHECK(cudaStreamWaitEvent(stream, event_, 0));
+    return residual_;
+  }
+
+  void Release(cudaStream_t stream) { OF_CUDA_CHECK(cudaEventRecord(event_, stream)); }
+
+ private:
+  int32_t device_id_;
+  float* residual_ = nullptr;
+  cudaEvent_t event_ = nullptr;
+};
+
+struct AllReduceArgs {
+  const void* send_buff;
+  void* recv_buff;
+  int64_t elem_cnt;
+  ncclDataType_t data_type;
+  int64_t size_of_data_type;
+  ncclRedOp_t reduce_op;
+};
+
+// Launches `local_rank2args` flat, or hierarchically if `hierarchical_comm_group` is not null.
+// Arguments whose elem_cnt is not divisible by the number of local ranks always run flat.
+void LaunchAllReduce(const CommGroup& comm_group,
+                     const HierarchicalCommGroup* hierarchical_comm_group,
+                     const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
+                     const std::vector<std::vector<AllReduceArgs>>& local_rank2args) {
+  const int32_t local_rank_count = comm_group.local_rank_count();
+  CHECK_EQ(local_rank2args.size(), static_cast<size_t>(local_rank_count));
+  const auto IsHierarchical = [&](const AllReduceArgs& args) {
+    return hierarchical_comm_group != nullptr && args.elem_cnt % local_rank_count == 0;
+  };
+  const auto ChunkPtr = [&](const AllReduceArgs& args, int32_t local_rank) {
+    return reinterpret_cast<char*>(args.recv_buff)
+           + local_rank * (args.elem_cnt / local_rank_count) * args.size_of_data_type;
+  };
+  if (hierarchical_comm_group != nullptr) {
+    CHECK_EQ(hierarchical_comm_group->intra_node_group.local_rank_count(), local_rank_count);
+    OF_NCCL_CHECK(ncclGroupStart());
+    for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+      const CommRank& comm_rank = hierarchical_comm_group->intra_node_group.GetCommRank(local_rank);
+      const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+      OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+      for (const AllReduceArgs& args : local_rank2args.at(local_rank)) {
+        if (!IsHierarchical(args)) { continue; }
+        OF_NCCL_CHECK(ncclReduceScatter(args.send_buff, ChunkPtr(args, local_rank),
+                                        args.elem_cnt / local_rank_count, args.data_type,
+                                        args.reduce_op, comm_rank.nccl_comm(),
+                                        stream_ctx->stream()));
+      }
+    }
+    OF_NCCL_CHECK(ncclGroupEnd());
+  }
+  OF_NCCL_CHECK(ncclGroupStart());
+  for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+    for (const AllReduceArgs& args : local_rank2args.at(local_rank)) {
+      if (IsHierarchical(args)) {
+        const CommRank& inter_node_comm_rank =
+            hierarchical_comm_group->local_rank2inter_node_group.at(local_rank).GetCommRank(0);
+        CHECK_EQ(inter_node_comm_rank.device_id(), comm_rank.device_id());
+        void* chunk = ChunkPtr(args, local_rank);
+        OF_NCCL_CHECK(ncclAllReduce(chunk, chunk, args.elem_cnt / local_rank_count,
+                                    args.data_type, args.reduce_op,
+                                    inter_node_comm_rank.nccl_comm(), stream_ctx->stream()));
+      } else {
+        OF_NCCL_CHECK(ncclAllReduce(args.send_buff, args.recv_buff, args.elem_cnt, args.data_type,
+                                    args.reduce_op, comm_rank.nccl_comm(), stream_ctx->stream()));
+      }
+    }
+  }
+  OF_NCCL_CHECK(ncclGroupEnd());
+  if (hierarchical_comm_group != nullptr) {
+    OF_NCCL_CHECK(ncclGroupStart());
+    for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+      const CommRank& comm_rank = hierarchical_comm_group->intra_node_group.GetCommRank(local_rank);
+      const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+      OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+      for (const AllReduceArgs& args : local_rank2args.at(local_rank)) {
+        if (!IsHierarchical(args)) { continue; }
+        OF_NCCL_CHECK(ncclAllGather(ChunkPtr(args, local_rank), args.recv_buff,
+                                    args.elem_cnt / local_rank_count, args.data_type,
+                                    comm_rank.nccl_comm(), stream_ctx->stream()));
+      }
+    }
+    OF_NCCL_CHECK(ncclGroupEnd());
+  }
+}
+
+void LaunchAllReduceRequests(const CommGroup& comm_group,
+                             const HierarchicalCommGroup* hierarchical_comm_group,
+                             const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
+                             const std::shared_ptr<RequestStore>& request_store,
+                             const std::vector<RequestId>& request_ids) {
+  std::vector<std::vector<AllReduceArgs>> local_rank2args(comm_group.local_rank_count());
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          const auto& op_desc = request_entry->desc().op_desc();
+          CHECK_EQ(op_desc.op_type(), OpType::kOpTypeAllReduce);
+          const auto& runtime_request_info = request_entry->GetRuntimeRequest(local_rank);
+          local_rank2args.at(local_rank).emplace_back(AllReduceArgs{
+              runtime_request_info->send_buff, runtime_request_info->recv_buff,
+              request_entry->elem_cnt(), GetNcclDataType(op_desc.data_type()),
+              GetSizeOfDataType(op_desc.data_type()), GetNcclReduceOp(op_desc.reduce_method())});
+        });
+  }
+  LaunchAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx, local_rank2args);
+}
+
 void LaunchFusedAllReduce(const CommGroup& comm_group,
+                          const HierarchicalCommGroup* hierarchical_comm_group,
                           const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
                           const std::shared_ptr<RequestStore>& request_store,
                           const std::vector<RequestId>& request_ids) {
@@ -296,16 +571,15 @@ void LaunchFusedAllReduce(const CommGroup& comm_group,
     MultiCopy(stream_ctx->stream(), copy_in_params);
   }
 
-  OF_NCCL_CHECK(ncclGroupStart());
+  std::vector<std::vector<AllReduceArgs>> local_rank2args(comm_group.local_rank_count());
   for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
     const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
     const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
-    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
-    OF_NCCL_CHECK(ncclAllReduce(stream_ctx->fusion_buffer(), stream_ctx->fusion_buffer(), elem_cnt,
-                                nccl_data_type, nccl_reduce_op, comm_rank.nccl_comm(),
-                                stream_ctx->stream()));
+    local_rank2args.at(local_rank).emplace_back(
+        AllReduceArgs{stream_ctx->fusion_buffer(), stream_ctx->fusion_buffer(), elem_cnt,
+                      nccl_data_type, size_of_data_type, nccl_reduce_op});
   }
-  OF_NCCL_CHECK(ncclGroupEnd());
+  LaunchAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx, local_rank2args);
 
   for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
     MultiCopyParams copy_out_params;
@@ -322,6 +596,78 @@ void LaunchFusedAllReduce(const CommGroup& comm_group,
   }
 }
 
+template<typename T>
+void LaunchCompressedFusedAllReduce(
+    const CommGroup& comm_group, const HierarchicalCommGroup* hierarchical_comm_group,
+    const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
+    const std::shared_ptr<RequestStore>& request_store, const std::vector<RequestId>& request_ids,
+    ncclDataType_t nccl_compressed_data_type,
+    const std::function<CompressionResidual*(const RequestId&, int32_t, const StreamCtx*)>&
+        GetResidual) {
+  RequestEntry* first_request_entry = request_store->MutRequestEntry(request_ids.front());
+  CHECK_EQ(first_request_entry->desc().op_desc().data_type(), DataType::kFloat);
+  const ncclRedOp_t nccl_reduce_op =
+      GetNcclReduceOp(first_request_entry->desc().op_desc().reduce_method());
+  std::vector<int64_t> offset_vec;
+  offset_vec.reserve(request_ids.size());
+  int64_t offset = 0;
+  request_store->ForEachMutRequestEntryForIdsInJob(
+      request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+        offset_vec.emplace_back(offset);
+        offset += GetMultiCopyAlignedSize(request_entry->elem_cnt() * sizeof(T));
+      });
+  const int64_t elem_cnt = offset / sizeof(T);
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    CHECK_LE(offset, stream_ctx->fusion_buffer_size());
+    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+    std::vector<CompressionResidual*> residuals(request_ids.size());
+    std::vector<CompressParams<T>> compress_params(request_ids.size());
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          residuals.at(i) = GetResidual(request_id, local_rank, stream_ctx);
+          CompressParams<T>& params = compress_params.at(i);
+          params.src = reinterpret_cast<const float*>(
+              request_entry->GetRuntimeRequest(local_rank)->send_buff);
+          params.residual =
+              residuals.at(i) == nullptr ? nullptr : residuals.at(i)->Acquire(stream_ctx->stream());
+          params.dst = reinterpret_cast<T*>(stream_ctx->fusion_buffer() + offset_vec.at(i));
+          params.count = request_entry->elem_cnt();
+        });
+    LaunchMultiCompress(stream_ctx->stream(), compress_params, MultiCompressGpu<T>);
+    for (CompressionResidual* residual : residuals) {
+      if (residual != nullptr) { residual->Release(stream_ctx->stream()); }
+    }
+  }
+
+  std::vector<std::vector<AllReduceArgs>> local_rank2args(comm_group.local_rank_count());
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    local_rank2args.at(local_rank).emplace_back(
+        AllReduceArgs{stream_ctx->fusion_buffer(), stream_ctx->fusion_buffer(), elem_cnt,
+                      nccl_compressed_data_type, sizeof(T), nccl_reduce_op});
+  }
+  LaunchAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx, local_rank2args);
+
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    std::vector<DecompressParams<T>> decompress_params(request_ids.size());
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          DecompressParams<T>& params = decompress_params.at(i);
+          params.src = reinterpret_cast<const T*>(stream_ctx->fusion_buffer() + offset_vec.at(i));
+          params.dst =
+              reinterpret_cast<float*>(request_entry->GetRuntimeRequest(local_rank)->recv_buff);
+          params.count = request_entry->elem_cnt();
+        });
+    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+    LaunchMultiCompress(stream_ctx->stream(), decompress_params, MultiDecompressGpu<T>);
+  }
+}
+
 void LaunchAggregatedOps(const CommGroup& comm_group,
                          const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
                          const std::shared_ptr<RequestStore>& request_store,
@@ -365,18 +711,23 @@ void LaunchAggregatedOps(const CommGroup& comm_group,
                                         op_desc.root(), comm, stream_ctx->stream()));
           } else if (op_type == OpType::kOpTypeAll2All) {
 #if NCCL_VERSION_CODE > 2700
-            const int64_t elem_per_rank = elem_cnt / num_ranks;
-            const int64_t elem_per_chunk = elem_per_rank / num_ranks;
+            // Blocks to and from the peers are laid out by peer rank, their sizes may differ.
+            const int64_t rank = request_entry->LocalRankToGlobalRank(local_rank);
             const int64_t dtype_size = GetSizeOfDataType(op_desc.data_type());
-            const int64_t chunk_size = elem_per_chunk * dtype_size;
+            int64_t send_offset = 0;
+            int64_t recv_offset = 0;
             for (int64_t j = 0; j < num_ranks; ++j) {
+              const int64_t send_elem_cnt = GetAll2AllSplitElemCnt(op_desc, rank, j);
+              const int64_t recv_elem_cnt = GetAll2AllSplitElemCnt(op_desc, j, rank);
               OF_NCCL_CHECK(ncclSend(reinterpret_cast<const void*>(
-                                         reinterpret_cast<const char*>(send_buff) + j * chunk_size),
-                                     elem_per_chunk, nccl_data_type, j, comm,
+                                         reinterpret_cast<const char*>(send_buff) + send_offset),
+                                     send_elem_cnt, nccl_data_type, j, comm,
                                      stream_ctx->stream()));
               OF_NCCL_CHECK(ncclRecv(
-                  reinterpret_cast<void*>(reinterpret_cast<char*>(recv_buff) + j * chunk_size),
-                  elem_per_chunk, nccl_data_type, j, comm, stream_ctx->stream()));
+                  reinterpret_cast<void*>(reinterpret_cast<char*>(recv_buff) + recv_offset),
+                  recv_elem_cnt, nccl_data_type, j, comm, stream_ctx->stream()));
+              send_offset += send_elem_cnt * dtype_size;
+              recv_offset += recv_elem_cnt * dtype_size;
             }
 #else
         UNIMPLEMENTED();
@@ -389,6 +740,88 @@ void LaunchAggregatedOps(const CommGroup& comm_group,
   OF_NCCL_CHECK(ncclGroupEnd());
 }
 
+// Bytes and bus bandwidth factor of a request the way nccl-tests reports them.
+profiler::CollectiveRequestRecord GetCollectiveRequestRecord(const RequestEntry* request_entry) {
+  const auto& op_desc = request_entry->desc().op_desc();
+  const int64_t num_ranks = op_desc.num_ranks();
+  const double ring_factor = static_cast<double>(num_ranks - 1) / num_ranks;
+  profiler::CollectiveRequestRecord record;
+  record.name = op_desc.name();
+  record.op_type = OpType_Name(op_desc.op_type());
+  record.size_in_bytes = request_entry->size_in_bytes();
+  if (op_desc.op_type() == OpType::kOpTypeAllReduce) {
+    record.bus_bandwidth_factor = 2 * ring_factor;
+  } else if (op_desc.op_type() == OpType::kOpTypeReduceScatter
+             || op_desc.op_type() == OpType::kOpTypeAllGather) {
+    record.bus_bandwidth_factor = ring_factor;
+  } else if (op_desc.op_type() == OpType::kOpTypeAll2All) {
+    // The logical blob is spread over the ranks, each of them sends and receives its part.
+    record.size_in_bytes /= num_ranks;
+    record.bus_bandwidth_factor = ring_factor;
+  } else {
+    record.bus_bandwidth_factor = 1;
+  }
+  return record;
+}
+
+std::vector<cudaEvent_t> RecordCollectiveTraceStartEvents(
+    const CommGroup& comm_group,
+    const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx) {
+  std::vector<cudaEvent_t> start_events(comm_group.local_rank_count());
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    const StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+    OF_CUDA_CHECK(cudaEventCreate(&start_events.at(local_rank)));
+    OF_CUDA_CHECK(cudaEventRecord(start_events.at(local_rank), stream_ctx->stream()));
+  }
+  return start_events;
+}
+
+// The device time of the group on each local rank is measured between the start events and end
+// events recorded here, and reported when the stream reaches the end event. The step telemetry
+// takes that of the first local rank only, as a step of the process spans all its devices.
+void AddCollectiveTraceCallback(const CommGroup& comm_group,
+                                const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
+                                const std::shared_ptr<RequestStore>& request_store,
+                                const std::vector<RequestId>& request_ids,
+                                const std::vector<cudaEvent_t>& start_events) {
+  auto requests = std::make_shared<std::vector<profiler::CollectiveRequestRecord>>();
+  request_store->ForEachMutRequestEntryForIdsInJob(
+      request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+        requests->emplace_back(GetCollectiveRequestRecord(request_entry));
+      });
+  const int64_t job_id = request_ids.front().job_id;
+  for (int32_t local_rank = 0; local_rank < comm_group.local_rank_count(); ++local_rank) {
+    const CommRank& comm_rank = comm_group.GetCommRank(local_rank);
+    StreamCtx* stream_ctx = device_id2stream_ctx.at(comm_rank.device_id()).get();
+    OF_CUDA_CHECK(cudaSetDevice(comm_rank.device_id()));
+    cudaEvent_t start_event = start_events.at(local_rank);
+    cudaEvent_t end_event;
+    OF_CUDA_CHECK(cudaEventCreate(&end_event));
+    OF_CUDA_CHECK(cudaEventRecord(end_event, stream_ctx->stream()));
+    const int64_t device_id = comm_rank.device_id();
+    const bool is_first_local_rank = local_rank == 0;
+    stream_ctx->AddCallback([job_id, device_id, requests, start_event, end_event,
+                             is_first_local_rank]() {
+      const int64_t end_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+      float elapsed_ms = 0;
+      OF_CUDA_CHECK(cudaEventElapsedTime(&elapsed_ms, start_event, end_event));
+      OF_CUDA_CHECK(cudaEventDestroy(start_event));
+      OF_CUDA_CHECK(cudaEventDestroy(end_event));
+      if (profiler::CollectiveTraceEnabled()) {
+        profiler::RecordCollectiveGroup(job_id, device_id, *requests, end_ns,
+                                        static_cast<int64_t>(elapsed_ms * 1e6));
+      }
+      if (is_first_local_rank && StepTelemetry::Enabled()) {
+        StepTelemetry::Get()->OnCollectiveGroup(elapsed_ms * 1e6);
+      }
+    });
+  }
+}
+
 void AddCallbackAndResetRuntimeRequest(
     const CommGroup& comm_group,
     const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
@@ -429,8 +862,16 @@ struct NcclExecutorBackend::Impl {
     fusion_threshold = conf.nccl_fusion_threshold_mb() * 1024 * 1024;
     num_streams = conf.nccl_num_streams();
     current_stream_id = 0;
-    enable_mixed_fusion =
-        (!conf.nccl_fusion_all_reduce_use_buffer()) && conf.nccl_enable_mixed_fusion();
+    compression = conf.nccl_all_reduce_compression();
+#if !defined(__CUDA_BF16_TYPES_EXIST__) || NCCL_VERSION_CODE < 21003
+    CHECK_NE(compression, NcclAllReduceCompression::kNcclAllReduceCompressionBFloat16)
+        << "bfloat16 all-reduce compression requires CUDA 11 and NCCL 2.10.3 or later";
+#endif
+    fusion_all_reduce_use_buffer =
+        conf.nccl_fusion_all_reduce_use_buffer()
+        || compression != NcclAllReduceCompression::kNcclAllReduceCompressionNone;
+    enable_mixed_fusion = (!fusion_all_reduce_use_buffer) && conf.nccl_enable_mixed_fusion();
+    enable_hierarchical_all_reduce = conf.nccl_enable_hierarchical_all_reduce();
     int nccl_version;
     OF_NCCL_CHECK(ncclGetVersion(&nccl_version));
     if (nccl_version == 21003) {
@@ -443,7 +884,9 @@ struct NcclExecutorBackend::Impl {
     InitIsOpTypeFusionEnabled();
   }
   ~Impl() {
+    job_id2compression_residuals.clear();
     stream_id2device_id2stream_ctx.clear();
+    device_set2stream_id2hierarchical_comm_group.clear();
     device_set2stream_id2comm_group.clear();
   }
 
@@ -455,6 +898,19 @@ struct NcclExecutorBackend::Impl {
           if (request.op_desc().backend() != Backend::kBackendNCCL) { return; }
           if (!request_entry->HasRankOnThisNode()) { return; }
           const DeviceSet& device_set = request.device_set();
+          if (enable_hierarchical_all_reduce
+              && request.op_desc().op_type() == OpType::kOpTypeAllReduce
+              && IsHierarchicalAllReduceSupported(device_set)
+              && device_set2stream_id2hierarchical_comm_group.count(device_set) == 0) {
+            auto& stream_id2hierarchical_comm_group =
+                device_set2stream_id2hierarchical_comm_group[device_set];
+            stream_id2hierarchical_comm_group.resize(num_streams);
+            for (int32_t stream_id = 0; stream_id < num_streams; ++stream_id) {
+              InitHierarchicalCommGroup(
+                  device_set, GetNcclUniqueIdRpcKey(request.op_desc().name(), stream_id),
+                  &stream_id2hierarchical_comm_group.at(stream_id));
+            }
+          }
           if (device_set2stream_id2comm_group.count(device_set) > 0) { return; }
           auto& stream_id2comm_group = device_set2stream_id2comm_group[device_set];
           stream_id2comm_group.resize(num_streams);
@@ -476,6 +932,153 @@ struct NcclExecutorBackend::Impl {
     }
   }
 
+  int64_t FusionThreshold4DeviceSet(const DeviceSet& device_set) const {
+    auto it = device_set2fusion_threshold.find(device_set);
+    if (it == device_set2fusion_threshold.end()) { return fusion_threshold; }
+    return it->second;
+  }
+
+  // Measures all-reduce of every device set of the job on the ranks holding it, so it has to be
+  // called at the same point on all ranks like InitCommGroup.
+  void TuneFusionThreshold(int64_t job_id) {
+    if (!conf.nccl_fusion_threshold_auto_tune()) { return; }
+    request_store->ForEachMutRequestEntryInJob(
+        job_id, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          const auto& request = request_entry->desc();
+          if (request.op_desc().backend() != Backend::kBackendNCCL) { return; }
+          if (!request_entry->HasRankOnThisNode()) { return; }
+          if (request.op_desc().op_type() != OpType::kOpTypeAllReduce) { return; }
+          const DeviceSet& device_set = request.device_set();
+          if (device_set2fusion_threshold.count(device_set) > 0) { return; }
+          device_set2fusion_threshold[device_set] =
+              TuneFusionThreshold4DeviceSet(device_set, request.op_desc().name());
+        });
+  }
+
+  // Fits the all-reduce time of the device set to latency + size / bandwidth and returns the
+  // smallest bucket size which spends no more than 10% of its time in latency, larger buckets
+  // only delay the start of the communication behind backward compute.
+  int64_t TuneFusionThreshold4DeviceSet(const DeviceSet& device_set, const std::string& name) {
+    constexpr int64_t kMinTuneSize = 64 * 1024;
+    constexpr double kLatencyRatio = 0.1;
+    std::vector<int64_t> sizes;
+    for (int64_t size = kMinTuneSize; size <= fusion_threshold; size *= 4) {
+      sizes.emplace_back(size);
+    }
+    if (sizes.size() < 2) { return fusion_threshold; }
+    const int64_t num_iters = conf.nccl_fusion_auto_tune_iters();
+    CHECK_GT(num_iters, 0);
+    const CommGroup& comm_group = device_set2stream_id2comm_group.at(device_set).at(0);
+    auto hierarchical_it = device_set2stream_id2hierarchical_comm_group.find(device_set);
+    const HierarchicalCommGroup* hierarchical_comm_group =
+        hierarchical_it == device_set2stream_id2hierarchical_comm_group.end()
+            ? nullptr
+            : &hierarchical_it->second.at(0);
+    const auto& device_id2stream_ctx = stream_id2device_id2stream_ctx.at(0);
+    const int32_t local_rank_count = comm_group.local_rank_count();
+    const auto StreamCtx4LocalRank = [&](int32_t local_rank) {
+      const int32_t device_id = comm_group.GetCommRank(local_rank).device_id();
+      OF_CUDA_CHECK(cudaSetDevice(device_id));
+      return device_id2stream_ctx.at(device_id).get();
+    };
+    std::vector<cudaEvent_t> start_events(local_rank_count);
+    std::vector<cudaEvent_t> end_events(local_rank_count);
+    for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+      const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+      OF_CUDA_CHECK(cudaEventCreate(&start_events.at(local_rank)));
+      OF_CUDA_CHECK(cudaEventCreate(&end_events.at(local_rank)));
+      OF_CUDA_CHECK(cudaMemsetAsync(stream_ctx->fusion_buffer(), 0,
+                                    stream_ctx->fusion_buffer_size(), stream_ctx->stream()));
+    }
+    std::vector<float> size_index2elapsed_ms(sizes.size(), 0);
+    for (size_t size_index = 0; size_index < sizes.size(); ++size_index) {
+      std::vector<std::vector<AllReduceArgs>> local_rank2args(local_rank_count);
+      for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+        const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+        local_rank2args.at(local_rank).emplace_back(
+            AllReduceArgs{stream_ctx->fusion_buffer(), stream_ctx->fusion_buffer(),
+                          static_cast<int64_t>(sizes.at(size_index) / sizeof(float)), ncclFloat,
+                          sizeof(float), ncclSum});
+      }
+      // Warm up.
+      LaunchAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx, local_rank2args);
+      for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+        const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+        OF_CUDA_CHECK(cudaEventRecord(start_events.at(local_rank), stream_ctx->stream()));
+      }
+      for (int64_t iter = 0; iter < num_iters; ++iter) {
+        LaunchAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx,
+                        local_rank2args);
+      }
+      for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+        const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+        OF_CUDA_CHECK(cudaEventRecord(end_events.at(local_rank), stream_ctx->stream()));
+      }
+      for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+        StreamCtx4LocalRank(local_rank);
+        OF_CUDA_CHECK(cudaEventSynchronize(end_events.at(local_rank)));
+        float elapsed_ms = 0;
+        OF_CUDA_CHECK(cudaEventElapsedTime(&elapsed_ms, start_events.at(local_rank),
+                                           end_events.at(local_rank)));
+        size_index2elapsed_ms.at(size_index) =
+            std::max(size_index2elapsed_ms.at(size_index), elapsed_ms / num_iters);
+      }
+    }
+    // All ranks must pick the same threshold, so they agree on the time of the slowest one.
+    OF_NCCL_CHECK(ncclGroupStart());
+    for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+      const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+      OF_CUDA_CHECK(cudaMemcpyAsync(stream_ctx->fusion_buffer(), size_index2elapsed_ms.data(),
+                                    size_index2elapsed_ms.size() * sizeof(float),
+                                    cudaMemcpyHostToDevice, stream_ctx->stream()));
+      OF_NCCL_CHECK(ncclAllReduce(stream_ctx->fusion_buffer(), stream_ctx->fusion_buffer(),
+                                  size_index2elapsed_ms.size(), ncclFloat, ncclMax,
+                                  comm_group.GetCommRank(local_rank).nccl_comm(),
+                                  stream_ctx->stream()));
+    }
+    OF_NCCL_CHECK(ncclGroupEnd());
+    for (int32_t local_rank = 0; local_rank < local_rank_count; ++local_rank) {
+      const StreamCtx* stream_ctx = StreamCtx4LocalRank(local_rank);
+      if (local_rank == 0) {
+        OF_CUDA_CHECK(cudaMemcpyAsync(size_index2elapsed_ms.data(), stream_ctx->fusion_buffer(),
+                                      size_index2elapsed_ms.size() * sizeof(float),
+                                      cudaMemcpyDeviceToHost, stream_ctx->stream()));
+      }
+      OF_CUDA_CHECK(cudaStreamSynchronize(stream_ctx->stream()));
+      OF_CUDA_CHECK(cudaEventDestroy(start_events.at(local_rank)));
+      OF_CUDA_CHECK(cudaEventDestroy(end_events.at(local_rank)));
+    }
+    // Least squares fit of elapsed_s = latency_s + size / bandwidth.
+    double mean_size = 0;
+    double mean_elapsed_s = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      mean_size += static_cast<double>(sizes.at(i)) / sizes.size();
+      mean_elapsed_s += size_index2elapsed_ms.at(i) / 1e3 / sizes.size();
+    }
+    double cov = 0;
+    double var = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      const double size_diff = sizes.at(i) - mean_size;
+      cov += size_diff * (size_index2elapsed_ms.at(i) / 1e3 - mean_elapsed_s);
+      var += size_diff * size_diff;
+    }
+    if (cov <= 0) {
+      LOG(INFO) << "collective boxing fusion threshold of " << name << ": " << fusion_threshold
+                << " bytes, all-reduce time does not grow with size";
+      return fusion_threshold;
+    }
+    const double seconds_per_byte = cov / var;
+    const double latency_s = std::max(mean_elapsed_s - seconds_per_byte * mean_size, 0.0);
+    const double optimal_size = latency_s / seconds_per_byte * (1 - kLatencyRatio) / kLatencyRatio;
+    int64_t threshold = kMinTuneSize;
+    while (threshold < optimal_size && threshold < fusion_threshold) { threshold *= 2; }
+    threshold = std::min(threshold, fusion_threshold);
+    LOG(INFO) << "collective boxing fusion threshold of " << name << ": " << threshold
+              << " bytes, all-reduce latency " << latency_s * 1e6 << " us, bandwidth "
+              << 1 / seconds_per_byte / 1e9 << " GB/s";
+    return threshold;
+  }
+
   void InitStreamCtx() {
     int32_t num_devices;
     OF_CUDA_CHECK(cudaGetDeviceCount(&num_devices));
@@ -492,7 +1095,7 @@ struct NcclExecutorBackend::Impl {
     op_type2fusion_enabled.at(OpType::kOpTypeReduceScatter) = conf.nccl_fusion_reduce_scatter();
     op_type2fusion_enabled.at(OpType::kOpTypeReduce) = conf.nccl_fusion_reduce();
     op_type2fusion_enabled.at(OpType::kOpTypeBroadcast) = conf.nccl_fusion_broadcast();
-    op_type2fusion_enabled.at(OpType::kOpTypeAll2All) = false;
+    op_type2fusion_enabled.at(OpType::kOpTypeAll2All) = conf.nccl_fusion_all_to_all();
   }
 
   int32_t NextStreamId() {
@@ -522,7 +1125,7 @@ struct NcclExecutorBackend::Impl {
         && lhs->desc().op_desc().op_type() != rhs->desc().op_desc().op_type()) {
       return false;
     }
-    if (conf.nccl_fusion_all_reduce_use_buffer()) {
+    if (fusion_all_reduce_use_buffer) {
       if (lhs->desc().op_desc().op_type() == OpType::kOpTypeAllReduce
           && rhs->desc().op_desc().op_type() == OpType::kOpTypeAllReduce) {
         CHECK(lhs->desc().op_desc().has_reduce_method());
@@ -545,13 +1148,15 @@ struct NcclExecutorBackend::Impl {
     std::vector<RequestId> group;
     int64_t group_size = 0;
     const int64_t fusion_max_ops = std::min(conf.nccl_fusion_max_ops(), kMultiCopyParamsMaxSize);
+    const int64_t group_fusion_threshold = FusionThreshold4DeviceSet(
+        request_store->MutRequestEntry(request_ids.front())->desc().device_set());
     request_store->ForEachMutRequestEntryForIdsInJob(
         request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
           const auto& request = request_entry->desc();
           const int64_t size = GetMultiCopyAlignedSize(request_entry->size_in_bytes());
           if (group.empty()
               || !CanRequestEntryFuse(request_store->MutRequestEntry(group.back()), request_entry)
-              || group_size + size > fusion_threshold || group.size() >= fusion_max_ops) {
+              || group_size + size > group_fusion_threshold || group.size() >= fusion_max_ops) {
             if (!group.empty()) {
               void* token = CreateGroupToken(group);
               Handler(std::move(group), token);
@@ -569,12 +1174,81 @@ struct NcclExecutorBackend::Impl {
   }
 
   struct GroupToken {
-    GroupToken(const std::vector<RequestId>& group, std::vector<CommGroup>* stream_id2comm_group)
-        : request_ids(group), stream_id2comm_group(stream_id2comm_group) {}
+    GroupToken(const std::vector<RequestId>& group, std::vector<CommGroup>* stream_id2comm_group,
+               std::vector<HierarchicalCommGroup>* stream_id2hierarchical_comm_group)
+        : request_ids(group),
+          stream_id2comm_group(stream_id2comm_group),
+          stream_id2hierarchical_comm_group(stream_id2hierarchical_comm_group) {}
     std::vector<RequestId> request_ids;
     std::vector<CommGroup>* stream_id2comm_group;
+    // nullptr if the device set does not run the hierarchical all-reduce.
+    std::vector<HierarchicalCommGroup>* stream_id2hierarchical_comm_group;
   };
 
+  bool IsAllReduceGroup(const std::vector<RequestId>& request_ids) const {
+    bool all_reduce = true;
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          all_reduce =
+              all_reduce && request_entry->desc().op_desc().op_type() == OpType::kOpTypeAllReduce;
+        });
+    return all_reduce;
+  }
+
+  void DeinitJob(int64_t job_id) {
+    std::lock_guard<std::mutex> lock(compression_residual_mutex);
+    job_id2compression_residuals.erase(job_id);
+  }
+
+  bool IsCompressionEnabled(const RequestEntry* entry) const {
+    if (compression == NcclAllReduceCompression::kNcclAllReduceCompressionNone) { return false; }
+    const auto& op_desc = entry->desc().op_desc();
+    return op_desc.op_type() == OpType::kOpTypeAllReduce
+           && op_desc.data_type() == DataType::kFloat
+           && op_desc.reduce_method() == kReduceMethodSum;
+  }
+
+  CompressionResidual* GetCompressionResidual(const RequestId& request_id, int32_t local_rank,
+                                              const StreamCtx* stream_ctx) {
+    if (!conf.nccl_all_reduce_compression_error_feedback()) { return nullptr; }
+    std::lock_guard<std::mutex> lock(compression_residual_mutex);
+    auto& local_rank2residual =
+        job_id2compression_residuals[request_id.job_id][request_id.request_index];
+    if (local_rank2residual.size() <= static_cast<size_t>(local_rank)) {
+      local_rank2residual.resize(local_rank + 1);
+    }
+    auto& residual = local_rank2residual.at(local_rank);
+    if (!residual) {
+      residual = std::make_unique<CompressionResidual>(
+          stream_ctx->device_id(), request_store->MutRequestEntry(request_id)->elem_cnt(),
+          stream_ctx->stream());
+    }
+    return residual.get();
+  }
+
+  void LaunchCompressedAllReduce(
+      const CommGroup& comm_group, const HierarchicalCommGroup* hierarchical_comm_group,
+      const std::vector<std::unique_ptr<StreamCtx>>& device_id2stream_ctx,
+      const std::vector<RequestId>& request_ids) {
+    const auto GetResidual = [this](const RequestId& request_id, int32_t local_rank,
+                                    const StreamCtx* stream_ctx) {
+      return GetCompressionResidual(request_id, local_rank, stream_ctx);
+    };
+    if (compression == NcclAllReduceCompression::kNcclAllReduceCompressionFloat16) {
+      LaunchCompressedFusedAllReduce<half>(comm_group, hierarchical_comm_group,
+                                           device_id2stream_ctx, request_store, request_ids,
+                                           GetNcclDataType(DataType::kFloat16), GetResidual);
+#if defined(__CUDA_BF16_TYPES_EXIST__) && NCCL_VERSION_CODE >= 21003
+    } else if (compression == NcclAllReduceCompression::kNcclAllReduceCompressionBFloat16) {
+      LaunchCompressedFusedAllReduce<nv_bfloat16>(
+          comm_group, hierarchical_comm_group, device_id2stream_ctx, request_store, request_ids,
+          GetNcclDataType(DataType::kBFloat16), GetResidual);
+#endif
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+
   void* CreateGroupToken(const std::vector<RequestId>& group) {
     CHECK_GT(group.size(), 0);
     void* group_token;
@@ -582,7 +1256,12 @@ struct NcclExecutorBackend::Impl {
         request_store->MutRequestEntry(group.front())->desc().device_set();
     auto it = device_set2stream_id2comm_group.find(first_device_set);
     CHECK(it != device_set2stream_id2comm_group.end());
-    group_token = new GroupToken(group, &it->second);
+    auto hierarchical_it = device_set2stream_id2hierarchical_comm_group.find(first_device_set);
+    std::vector<HierarchicalCommGroup>* stream_id2hierarchical_comm_group =
+        hierarchical_it == device_set2stream_id2hierarchical_comm_group.end()
+            ? nullptr
+            : &hierarchical_it->second;
+    group_token = new GroupToken(group, &it->second, stream_id2hierarchical_comm_group);
     request_store->ForEachMutRequestEntryForIdsInJob(
         group, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
           const DeviceSet& device_set = request_entry->desc().device_set();
@@ -604,13 +1283,39 @@ struct NcclExecutorBackend::Impl {
     CudaCurrentDeviceGuard device_guard;
     const auto& comm_group = token->stream_id2comm_group->at(stream_id);
     auto& device_id2stream_ctx = stream_id2device_id2stream_ctx.at(stream_id);
-    if (request_store->MutRequestEntry(request_ids.front())->desc().op_desc().op_type()
-            == OpType::kOpTypeAllReduce
-        && conf.nccl_fusion_all_reduce_use_buffer() && request_ids.size() > 1) {
-      LaunchFusedAllReduce(comm_group, device_id2stream_ctx, request_store, request_ids);
+    const HierarchicalCommGroup* hierarchical_comm_group =
+        token->stream_id2hierarchical_comm_group == nullptr
+            ? nullptr
+            : &token->stream_id2hierarchical_comm_group->at(stream_id);
+    RequestEntry* first_request_entry = request_store->MutRequestEntry(request_ids.front());
+    const bool collective_trace_enabled =
+        profiler::CollectiveTraceEnabled() || StepTelemetry::Enabled();
+    std::vector<cudaEvent_t> collective_trace_start_events;
+    if (collective_trace_enabled) {
+      collective_trace_start_events =
+          RecordCollectiveTraceStartEvents(comm_group, device_id2stream_ctx);
+    }
+    // A single request larger than the fusion buffer is never compressed.
+    if (IsCompressionEnabled(first_request_entry)
+        && (request_ids.size() > 1
+            || GetMultiCopyAlignedSize(first_request_entry->elem_cnt() * sizeof(half))
+                   <= fusion_threshold)) {
+      LaunchCompressedAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx,
+                                request_ids);
+    } else if (first_request_entry->desc().op_desc().op_type() == OpType::kOpTypeAllReduce
+               && fusion_all_reduce_use_buffer && request_ids.size() > 1) {
+      LaunchFusedAllReduce(comm_group, hierarchical_comm_group, device_id2stream_ctx,
+                           request_store, request_ids);
+    } else if (hierarchical_comm_group != nullptr && IsAllReduceGroup(request_ids)) {
+      LaunchAllReduceRequests(comm_group, hierarchical_comm_group, device_id2stream_ctx,
+                              request_store, request_ids);
     } else {
       LaunchAggregatedOps(comm_group, device_id2stream_ctx, request_store, request_ids);
     }
+    if (collective_trace_enabled) {
+      AddCollectiveTraceCallback(comm_group, device_id2stream_ctx, request_store, request_ids,
+                                 collective_trace_start_events);
+    }
     AddCallbackAndResetRuntimeRequest(comm_group, device_id2stream_ctx, request_store, request_ids);
   }
 
@@ -618,11 +1323,20 @@ struct NcclExecutorBackend::Impl {
   int64_t fusion_threshold;
   int32_t num_streams;
   int32_t current_stream_id;
+  NcclAllReduceCompression compression;
+  bool fusion_all_reduce_use_buffer;
   bool enable_mixed_fusion;
+  bool enable_hierarchical_all_reduce;
   std::vector<bool> op_type2fusion_enabled;
   std::shared_ptr<RequestStore> request_store;
   HashMap<DeviceSet, std::vector<CommGroup>> device_set2stream_id2comm_group;
+  HashMap<DeviceSet, std::vector<HierarchicalCommGroup>>
+      device_set2stream_id2hierarchical_comm_group;
+  HashMap<DeviceSet, int64_t> device_set2fusion_threshold;
   std::vector<std::vector<std::unique_ptr<StreamCtx>>> stream_id2device_id2stream_ctx;
+  std::mutex compression_residual_mutex;
+  HashMap<int64_t, HashMap<int32_t, std::vector<std::unique_ptr<CompressionResidual>>>>
+      job_id2compression_residuals;
 };
 
 NcclExecutorBackend::NcclExecutorBackend() = default;
@@ -637,9 +1351,10 @@ void NcclExecutorBackend::Init(std::shared_ptr<RequestStore> request_store) {
 void NcclExecutorBackend::InitJob(int64_t job_id) {
   CudaCurrentDeviceGuard guard;
   impl_->InitCommGroup(job_id);
+  impl_->TuneFusionThreshold(job_id);
 }
 
-void NcclExecutorBackend::DeinitJob(int64_t job_id) {}
+void NcclExecutorBackend::DeinitJob(int64_t job_id) { impl_->DeinitJob(job_id); }
 
 void NcclExecutorBackend::GroupRequests(
     const std::vector<RequestId>& request_ids,
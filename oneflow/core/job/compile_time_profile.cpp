@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/compile_time_profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace oneflow {
+
+CompileTimeProfile::CompileTimeProfile(const std::string& name)
+    : name_(name), enabled_(Enabled()), start_time_(0), last_time_(0) {
+  if (enabled_) {
+    start_time_ = GetCurTime();
+    last_time_ = start_time_;
+  }
+}
+
+CompileTimeProfile::~CompileTimeProfile() {
+  if (!enabled_) { return; }
+  const double total = GetCurTime() - start_time_;
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "compile time of " << name_ << ": " << total / 1e6 << " ms";
+  for (const auto& pair : step2elapsed_) {
+    ss << "\n  " << pair.first << ": " << pair.second / 1e6 << " ms ("
+       << (total > 0 ? pair.second * 100 / total : 0) << "%)";
+  }
+  LOG(INFO) << ss.str();
+}
+
+bool CompileTimeProfile::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_PROFILE_COMPILE_TIME", false);
+  return enabled;
+}
+
+void CompileTimeProfile::Tick(const std::string& step) {
+  if (!enabled_) { return; }
+  const double now = GetCurTime();
+  auto it =
+      std::find_if(step2elapsed_.begin(), step2elapsed_.end(),
+                   [&](const std::pair<std::string, double>& pair) { return pair.first == step; });
+  if (it == step2elapsed_.end()) {
+    step2elapsed_.emplace_back(step, now - last_time_);
+  } else {
+    it->second += now - last_time_;
+  }
+  last_time_ = now;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_COMPILE_TIME_PROFILE_H_
+#define ONEFLOW_CORE_JOB_COMPILE_TIME_PROFILE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Breaks the wall time of compiling a job down into named steps, such as job passes. Each Tick()
+// accounts the time since the previous one, or since the construction, to the step. The summary
+// is logged at destruction if ONEFLOW_PROFILE_COMPILE_TIME is set, otherwise Tick() is a no-op.
+class CompileTimeProfile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompileTimeProfile);
+  explicit CompileTimeProfile(const std::string& name);
+  ~CompileTimeProfile();
+
+  static bool Enabled();
+
+  void Tick(const std::string& step);
+
+ private:
+  const std::string name_;
+  const bool enabled_;
+  double start_time_;
+  double last_time_;
+  // In the order the steps are first ticked, repeated steps are accumulated.
+  std::vector<std::pair<std::string, double>> step2elapsed_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_COMPILE_TIME_PROFILE_H_
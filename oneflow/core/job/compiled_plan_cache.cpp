@@ -0,0 +1,148 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/compiled_plan_cache.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <vector>
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/compiler.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/register_num_tuner.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/memory/chunk_manager.h"
+#include "oneflow/core/persistence/file_system.h"
+
+extern char** environ;
+
+namespace oneflow {
+
+namespace {
+
+constexpr char kPlanCacheDirEnv[] = "ONEFLOW_PLAN_CACHE_DIR";
+
+std::string PlanCacheDir() { return GetStringFromEnv(kPlanCacheDirEnv, ""); }
+
+std::string CachePath4Fingerprint(const std::string& fingerprint) {
+  return JoinPath(PlanCacheDir(), "plan_" + fingerprint + ".pb");
+}
+
+// Environment variables tune many passes, take all of them that might into account.
+std::vector<std::string> SortedOneFlowEnvVars() {
+  std::vector<std::string> env_vars;
+  for (char** env = environ; env != nullptr && *env != nullptr; ++env) {
+    const std::string env_var(*env);
+    if (env_var.rfind("ONEFLOW_", 0) != 0 && env_var.rfind("AUTO_PARALLEL_", 0) != 0) { continue; }
+    if (env_var.rfind(std::string(kPlanCacheDirEnv) + "=", 0) == 0) { continue; }
+    env_vars.emplace_back(env_var);
+  }
+  std::sort(env_vars.begin(), env_vars.end());
+  return env_vars;
+}
+
+}  // namespace
+
+bool CompiledPlanCache::Enabled() { return !PlanCacheDir().empty(); }
+
+std::string CompiledPlanCache::Fingerprint4Job(const Job& job, int64_t job_id,
+                                               const HashSet<std::string>& variable_op_names) {
+  // NOTE: TextFormat prints map fields sorted by key, so the text is stable across processes.
+  std::string text;
+  text += std::string("version: ") + GetOneFlowGitVersion() + "\n";
+  text += "world_size: " + std::to_string(GlobalProcessCtx::WorldSize()) + "\n";
+  // Every rank caches its own part of a plan compiled rank by rank.
+  if (Compiler::RankLocalCompileEnabled()) {
+    text += "rank: " + std::to_string(GlobalProcessCtx::Rank()) + "\n";
+  }
+  text += "job_id: " + std::to_string(job_id) + "\n";
+  for (const std::string& env_var : SortedOneFlowEnvVars()) { text += "env: " + env_var + "\n"; }
+  std::vector<std::string> sorted_variable_op_names(variable_op_names.begin(),
+                                                    variable_op_names.end());
+  std::sort(sorted_variable_op_names.begin(), sorted_variable_op_names.end());
+  for (const std::string& name : sorted_variable_op_names) { text += "variable: " + name + "\n"; }
+  text += "resource {\n" + PbMessage2TxtString(Global<ResourceDesc, ForSession>::Get()->resource())
+          + "}\n";
+  IdState id_state;
+  Global<IDMgr>::Get()->SaveIdState(&id_state);
+  text += "id_state {\n" + PbMessage2TxtString(id_state) + "}\n";
+  std::vector<const ChunkProto*> chunks;
+  Global<ChunkMgr>::Get()->GetAllChunkProtos(&chunks);
+  for (const ChunkProto* chunk : chunks) {
+    text += "chunk {\n" + PbMessage2TxtString(*chunk) + "}\n";
+  }
+  text += "job {\n" + PbMessage2TxtString(job) + "}\n";
+  text += "register_num_hints {\n" + RegisterNumTuner::HintsText4Job(job.job_conf().job_name())
+          + "}\n";
+  char fingerprint[64];
+  std::snprintf(fingerprint, sizeof(fingerprint), "%016zx_%zu", std::hash<std::string>()(text),
+                text.size());
+  return fingerprint;
+}
+
+bool CompiledPlanCache::Load(const std::string& fingerprint, Plan* plan) {
+  const std::string path = CachePath4Fingerprint(fingerprint);
+  if (!LocalFS()->FileExists(path)) { return false; }
+  CompiledPlanCacheEntry cache;
+  if (!TryParseProtoFromPbFile(path, &cache) || cache.fingerprint() != fingerprint) {
+    LOG(WARNING) << "Ignore the mismatched compiled plan cache " << path;
+    return false;
+  }
+  IdState id_state;
+  Global<IDMgr>::Get()->SaveIdState(&id_state);
+  // Chunks created by compiling the plan are known by the following graphs for memory reuse.
+  for (const ChunkProto& chunk : cache.plan().block_chunk_list().chunk()) {
+    if (Global<ChunkMgr>::Get()->HasChunkProto(chunk.chunk_id())) { continue; }
+    CHECK_GE(chunk.chunk_id(), id_state.chunk_id_count());
+    Global<ChunkMgr>::Get()->AddChunkProto(chunk);
+  }
+  Global<IDMgr>::Get()->LoadIdState(cache.id_state());
+  plan->Swap(cache.mutable_plan());
+  LOG(INFO) << "Load the compiled plan cache " << path;
+  return true;
+}
+
+void CompiledPlanCache::Save(const std::string& fingerprint, const Plan& plan) {
+  const std::string path = CachePath4Fingerprint(fingerprint);
+  LocalFS()->RecursivelyCreateDirIfNotExist(Dirname(path));
+  CompiledPlanCacheEntry cache;
+  cache.set_fingerprint(fingerprint);
+  Global<IDMgr>::Get()->SaveIdState(cache.mutable_id_state());
+  *cache.mutable_plan() = plan;
+  // Several processes might write the same cache, rename the complete file into place.
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    const bool serialized = cache.SerializeToOstream(&out);
+    out.close();
+    if (!serialized || !out.good()) {
+      LOG(WARNING) << "Failed to write the compiled plan cache " << tmp_path;
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to write the compiled plan cache " << path;
+    std::remove(tmp_path.c_str());
+  }
+}
+
+}  // namespace oneflow
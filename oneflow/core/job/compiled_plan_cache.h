@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_COMPILED_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_COMPILED_PLAN_CACHE_H_
+
+#include <string>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// Caches the plans compiled by nn.Graph in ONEFLOW_PLAN_CACHE_DIR, so that a restarted process
+// loads the plan instead of compiling the same job again.
+//
+// A plan depends on more than the job: ids and memory chunks are allocated from the session, so
+// the fingerprint also covers the state of IDMgr and ChunkMgr left by the graphs compiled before.
+// The graphs of a restarted process hit the cache as long as they are compiled in the same order.
+class CompiledPlanCache final {
+ public:
+  static bool Enabled();
+
+  // Covers the job, the job id, the variables bound to eager tensors, the resource, the world
+  // size, the OneFlow version, the ONEFLOW_* environment variables, the session ids in use and the
+  // register num hints of the job.
+  static std::string Fingerprint4Job(const Job& job, int64_t job_id,
+                                     const HashSet<std::string>& variable_op_names);
+
+  // Returns false if no plan is cached under the fingerprint. On success, IDMgr and ChunkMgr are
+  // updated as if the plan is compiled in this process.
+  static bool Load(const std::string& fingerprint, Plan* plan);
+  static void Save(const std::string& fingerprint, const Plan& plan);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_COMPILED_PLAN_CACHE_H_
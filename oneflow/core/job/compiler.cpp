@@ -14,14 +14,18 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job/compiler.h"
+#include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/compile_time_profile.h"
 #include "oneflow/core/job/intra_job_mem_sharing_util.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/register_num_tuner.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -45,9 +49,24 @@ void CreateOpAttributeRef(Plan* plan, int64_t job_id, TaskProto* task_proto) {
   kernel_conf->set_allocated_op_attribute(nullptr);
 }
 
+bool Compiler::RankLocalCompileEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_LAZY_ENABLE_RANK_LOCAL_COMPILE", false);
+  return enabled;
+}
+
 void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
+  Compile(job, plan, need_job_complete, /*this_rank_only=*/false);
+}
+
+void Compiler::CompileForThisRank(Job* job, Plan* plan, bool need_job_complete) const {
+  Compile(job, plan, need_job_complete, /*this_rank_only=*/true);
+}
+
+void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete, bool this_rank_only) const {
+  CompileTimeProfile profile("compiler of " + job->job_conf().job_name());
   // Step1: ensure job is completed.
   if (need_job_complete) { CHECK_JUST(JobCompleter().Complete(job)); }
+  profile.Tick("JobCompleter");
 
   // Step2: new Global<OpGraph> and set log configs.
   Global<OpGraph>::New(*job);
@@ -58,6 +77,7 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
     Global<OpGraph>::Get()->ToDotWithFilePath("optimized_dlnet_" + std::to_string(job_desc.job_id())
                                               + "_op_graph.dot");
   }
+  profile.Tick("OpGraph");
 
   // Step3: build task_gph.
   // TODO(levi): we can rewrite this part of code in visitor pattern.
@@ -66,13 +86,19 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
   task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
+  profile.Tick("TaskGraph");
   task_gph->TopoForEachNode(&TaskNode::Build);
+  profile.Tick("TaskNode::Build");
   task_gph->RemoveEmptyRegsts();
   task_gph->MergeChainAndAddOrderingCtrlEdgeInSameChain();
   auto IsReachable = Global<OpGraph>::Get()->MakePredicatorIsOpNameDataOrCtrlReachable();
   if (job_desc.enable_inplace()) { task_gph->EnableInplaceMemSharing(IsReachable); }
   task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
-  task_gph->ForEachEdge([&](TaskEdge* task_edge) { task_edge->CheckRegstLbiValid(); });
+  std::vector<TaskEdge*> task_edges;
+  task_edges.reserve(task_gph->edge_num());
+  task_gph->ForEachEdge([&](TaskEdge* task_edge) { task_edges.push_back(task_edge); });
+  MultiThreadLoop(task_edges.size(), [&](size_t i) { task_edges.at(i)->CheckRegstLbiValid(); });
+  profile.Tick("TaskGraph post-process");
 
   // Step4: put infomation from task_gph into plan.
   const int64_t node_num = task_gph->node_num();
@@ -81,9 +107,17 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
   BlockingCounter counter(node_num);
   std::mutex mtx;
   ThreadPool thread_pool(thread_pool_size);
+  const int64_t this_rank = GlobalProcessCtx::Rank();
   task_gph->ForEachNode([&](TaskNode* task_node) {
-    thread_pool.AddWork([task_node, plan, &job_desc, &counter, &mtx]() {
-      if (!task_node->IsMeaningLess()) {
+    thread_pool.AddWork([task_node, plan, this_rank_only, this_rank, &job_desc, &counter, &mtx]() {
+      if (this_rank_only && task_node->machine_id() != this_rank) {
+        if (!task_node->IsMeaningLess()) {
+          TaskProto task_proto;
+          task_node->ToRemoteProto(&task_proto);
+          std::unique_lock<std::mutex> guard(mtx);
+          plan->mutable_remote_task()->Add(std::move(task_proto));
+        }
+      } else if (!task_node->IsMeaningLess()) {
         TaskProto task_proto;
         task_node->ToProto(&task_proto);
         {
@@ -101,14 +135,20 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
   counter.WaitForeverUntilCntEqualZero();
   // NOTE(levi): release task_gph here to decrise memory peak.
   task_gph.reset();
+  profile.Tick("ToProto");
 
   // Step5: post-process for plan and delete Global<OpGraph>.
   auto* job_id2job_conf = plan->mutable_job_confs()->mutable_job_id2job_conf();
   (*job_id2job_conf)[GlobalJobDesc().job_id()] = GlobalJobDesc().job_conf();
+  if (RegisterNumTuner::Enabled() && !this_rank_only) {
+    RegisterNumTuner::Tune(job->job_conf().job_name(), plan);
+    profile.Tick("RegisterNumTuner");
+  }
   // NOTE(chengcheng): infer mem blob id & set inplace & add ctrl
   IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(plan, IsReachable);
   PlanUtil::SetUniqueMemBlockId4UnreusedMemRegst(plan);
   Global<OpGraph>::Delete();
+  profile.Tick("MemSharing");
 }
 
 }  // namespace oneflow
@@ -30,6 +30,19 @@ class Compiler final {
   ~Compiler() = default;
 
   void Compile(Job*, Plan*, bool need_job_complete) const;
+  // Every rank compiles the same job into the plan it runs: the tasks of this rank, and the tasks
+  // of the other ranks as Plan.remote_task. The task graph is still built for all ranks, since the
+  // ids and the blob descs crossing the ranks come from it, but the tasks of the other ranks are
+  // neither serialized nor given memory. The tasks and regsts get the same ids as in the plan
+  // compiled for all ranks as long as all the ranks compile the same jobs in the same order, so
+  // the plans of the ranks fit together without being exchanged.
+  // Register num tuning is skipped, it is not seen by the other ranks.
+  void CompileForThisRank(Job*, Plan*, bool need_job_complete) const;
+  // Set by ONEFLOW_LAZY_ENABLE_RANK_LOCAL_COMPILE, which has to be the same on all ranks.
+  static bool RankLocalCompileEnabled();
+
+ private:
+  void Compile(Job*, Plan*, bool need_job_complete, bool this_rank_only) const;
 };
 
 }  // namespace oneflow
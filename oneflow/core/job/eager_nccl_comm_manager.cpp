@@ -19,6 +19,8 @@ limitations under the License.
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/hardware/node_device_descriptor_manager.h"
+#include "oneflow/core/hardware/cuda_device_descriptor.h"
 
 #ifdef WITH_CUDA
 
@@ -50,6 +52,30 @@ bool CompareDeviceSetPair(const std::pair<int64_t, int64_t>& a,
   }
 }
 
+// Reports which node, GPU and NUMA node every rank of a new communicator lands on. The ranks
+// follow the device order of the placement because the collectives lay their outputs out by rank,
+// and NCCL orders the rings within a node by the PCI topology itself.
+void LogNcclCommLayout(const std::string& key,
+                       const std::vector<std::pair<int64_t, int64_t>>& device_vec) {
+  auto* manager = Global<hardware::NodeDeviceDescriptorManager>::Get();
+  std::ostringstream oss;
+  for (size_t rank = 0; rank < device_vec.size(); ++rank) {
+    const int64_t process = device_vec.at(rank).first;
+    const int64_t dev = device_vec.at(rank).second;
+    oss << "\n  rank " << rank << ": node " << GlobalProcessCtx::NodeId(process) << " process "
+        << process << " cuda:" << dev;
+    if (manager == nullptr) { continue; }
+    const auto& node_desc = manager->GetNodeDeviceDescriptor(process);
+    auto cuda_device = std::dynamic_pointer_cast<const hardware::CudaDeviceDescriptor>(
+        node_desc->GetDevice(hardware::kCudaDeviceDescriptorClassName, dev));
+    if (!cuda_device) { continue; }
+    const int32_t numa_node = node_desc->Topology()->GetNumaNodeByPCIBusID(cuda_device->PCIBusID());
+    oss << " (" << cuda_device->PCIBusID() << ", numa node "
+        << (numa_node < 0 ? "unknown" : std::to_string(numa_node)) << ")";
+  }
+  LOG(INFO) << "nccl communicator {" << key << "} layout:" << oss.str();
+}
+
 void CreateNcclComm(ncclComm_t* comm, const int dev, const std::string& key,
                     const std::vector<std::pair<int64_t, int64_t>>& device_vec) {
   ncclUniqueId nccl_unique_id{};
@@ -59,6 +85,7 @@ void CreateNcclComm(ncclComm_t* comm, const int dev, const std::string& key,
   CHECK(it != device_vec.end());
   int rank = std::distance(device_vec.cbegin(), it);
   if (rank == 0) {
+    LogNcclCommLayout(key, device_vec);
     OF_NCCL_CHECK(ncclGetUniqueId(&nccl_unique_id));
     Global<CtrlClient>::Get()->PushKV(key,
                                       std::string(nccl_unique_id.internal, NCCL_UNIQUE_ID_BYTES));
@@ -73,19 +100,53 @@ void CreateNcclComm(ncclComm_t* comm, const int dev, const std::string& key,
   OF_NCCL_CHECK(ncclCommInitRank(comm, device_vec.size(), nccl_unique_id, rank));
 }
 
+int64_t GetFreeDeviceMemory() {
+  size_t free_bytes = 0;
+  size_t total_bytes = 0;
+  OF_CUDA_CHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
+  return static_cast<int64_t>(free_bytes);
+}
+
+bool IsNcclCommSplitEnabled() {
+#if NCCL_VERSION_CODE >= 21800
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_NCCL_COMM_SPLIT", true);
+  return enabled;
+#else
+  return false;
+#endif  // NCCL_VERSION_CODE >= 21800
+}
+
+std::string GetNcclCommSplitRpcKey(const std::string& device_set_key, int64_t split_index) {
+  return device_set_key + "-split:" + std::to_string(split_index);
+}
+
 }  // namespace
 
 EagerNcclCommMgr::~EagerNcclCommMgr() {
-  for (auto& device_set7device_id2comm : device_set2device_id2comm_) {
-    for (auto& device_id7comm : device_set7device_id2comm.second) {
-      OF_NCCL_CHECK(ncclCommDestroy(device_id7comm.second));
+  // The communicators split from a device set go before the one they share resources with. A
+  // split may not have been asked for on this rank yet, so they are destroyed from the splits.
+  for (auto& pair : device_set_key2device_id2split_state_) {
+    for (auto& device_id7state : pair.second) {
+      for (auto& stream_name7comm : device_id7state.second.stream_name2comm) {
+        OF_NCCL_CHECK(ncclCommDestroy(stream_name7comm.second));
+      }
+    }
+  }
+  if (!IsNcclCommSplitEnabled()) {
+    for (auto& pair : device7stream2device_id2comm_) {
+      for (auto& device_id7comm : pair.second) {
+        OF_NCCL_CHECK(ncclCommDestroy(device_id7comm.second));
+      }
     }
   }
-  for (auto& pair : device7stream2device_id2comm_) {
-    for (auto& device_id7comm : pair.second) {
+  for (auto& device_set7device_id2comm : device_set2device_id2comm_) {
+    for (auto& device_id7comm : device_set7device_id2comm.second) {
       OF_NCCL_CHECK(ncclCommDestroy(device_id7comm.second));
     }
   }
+  LOG(INFO) << "Destroyed " << stats_.num_comms << " nccl communicators ("
+            << stats_.num_split_comms << " split) of about "
+            << stats_.memory_bytes / (1024 * 1024) << " MiB";
 }
 
 ncclComm_t EagerNcclCommMgr::GetCommForDevice(
@@ -102,7 +163,9 @@ ncclComm_t EagerNcclCommMgr::GetCommForDevice(
 
   ncclComm_t comm;
   std::string nccl_unique_id_rpc_key = GetNcclUniqueIdRpcKey(device_vec);
+  const int64_t free_memory = GetFreeDeviceMemory();
   CreateNcclComm(&comm, dev, nccl_unique_id_rpc_key, device_vec);
+  AddCommToStats(nccl_unique_id_rpc_key, false, free_memory - GetFreeDeviceMemory());
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -118,7 +181,8 @@ ncclComm_t EagerNcclCommMgr::GetCommForDeviceAndStreamName(
 
   std::vector<std::pair<int64_t, int64_t>> device_vec(device_set.cbegin(), device_set.cend());
   std::sort(device_vec.begin(), device_vec.end(), CompareDeviceSetPair);
-  std::string key = GetNcclUniqueIdRpcKey(device_vec) + "-stream_name_hint:" + stream_name;
+  const std::string device_set_key = GetNcclUniqueIdRpcKey(device_vec);
+  std::string key = device_set_key + "-stream_name_hint:" + stream_name;
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -127,7 +191,13 @@ ncclComm_t EagerNcclCommMgr::GetCommForDeviceAndStreamName(
   }
 
   ncclComm_t comm;
-  CreateNcclComm(&comm, dev, key, device_vec);
+  if (IsNcclCommSplitEnabled()) {
+    comm = SplitCommForStream(device_set, device_vec, device_set_key, stream_name, dev);
+  } else {
+    const int64_t free_memory = GetFreeDeviceMemory();
+    CreateNcclComm(&comm, dev, key, device_vec);
+    AddCommToStats(key, false, free_memory - GetFreeDeviceMemory());
+  }
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -136,6 +206,76 @@ ncclComm_t EagerNcclCommMgr::GetCommForDeviceAndStreamName(
   return comm;
 }
 
+ncclComm_t EagerNcclCommMgr::SplitCommForStream(
+    const std::set<std::pair<int64_t, int64_t>>& device_set,
+    const std::vector<std::pair<int64_t, int64_t>>& device_vec, const std::string& device_set_key,
+    const std::string& stream_name, int dev) {
+#if NCCL_VERSION_CODE >= 21800
+  ncclComm_t parent = GetCommForDevice(device_set);
+  const std::pair<int64_t, int64_t> this_device(GlobalProcessCtx::Rank(), dev);
+  const int rank =
+      std::distance(device_vec.cbegin(), std::find(device_vec.cbegin(), device_vec.cend(),
+                                                   this_device));
+  std::unique_lock<std::mutex> lock(mutex_);
+  SplitState* state = &device_set_key2device_id2split_state_[device_set_key][dev];
+  if (rank == 0 && state->stream_name2split_index.count(stream_name) == 0) {
+    const int64_t split_index = state->stream_name2split_index.size();
+    state->stream_name2split_index.emplace(stream_name, split_index);
+    Global<CtrlClient>::Get()->PushKV(GetNcclCommSplitRpcKey(device_set_key, split_index),
+                                      stream_name);
+  }
+  // ncclCommSplit is collective over the parent, so every rank performs the splits in the order
+  // published by the first rank, one at a time, whichever stream it is asked for first.
+  while (true) {
+    const auto it = state->stream_name2comm.find(stream_name);
+    if (it != state->stream_name2comm.end()) { return it->second; }
+    if (state->splitting) {
+      split_cond_.wait(lock);
+      continue;
+    }
+    state->splitting = true;
+    const int64_t split_index = state->num_splits;
+    lock.unlock();
+    std::string split_stream_name;
+    Global<CtrlClient>::Get()->PullKV(
+        GetNcclCommSplitRpcKey(device_set_key, split_index),
+        [&split_stream_name](const std::string& val) { split_stream_name = val; });
+    const int64_t free_memory = GetFreeDeviceMemory();
+    ncclConfig_t config = NCCL_CONFIG_INITIALIZER;
+    config.splitShare = 1;
+    ncclComm_t comm = nullptr;
+    OF_NCCL_CHECK(ncclCommSplit(parent, 0, rank, &comm, &config));
+    AddCommToStats(device_set_key + "-stream_name_hint:" + split_stream_name, true,
+                   free_memory - GetFreeDeviceMemory());
+    lock.lock();
+    state->stream_name2comm.emplace(split_stream_name, comm);
+    state->num_splits += 1;
+    state->splitting = false;
+    split_cond_.notify_all();
+  }
+#else
+  UNIMPLEMENTED();
+  return nullptr;
+#endif  // NCCL_VERSION_CODE >= 21800
+}
+
+EagerNcclCommStats EagerNcclCommMgr::GetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void EagerNcclCommMgr::AddCommToStats(const std::string& key, bool is_split,
+                                      int64_t memory_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.num_comms += 1;
+  if (is_split) { stats_.num_split_comms += 1; }
+  stats_.memory_bytes += std::max<int64_t>(memory_bytes, 0);
+  LOG(INFO) << "nccl communicator {" << key << "} " << (is_split ? "split" : "created")
+            << " with about " << std::max<int64_t>(memory_bytes, 0) / (1024 * 1024)
+            << " MiB, " << stats_.num_comms << " communicators of about "
+            << stats_.memory_bytes / (1024 * 1024) << " MiB in total";
+}
+
 }  // namespace oneflow
 
 #endif  // WITH_CUDA
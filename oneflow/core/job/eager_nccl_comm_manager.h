@@ -22,9 +22,23 @@ limitations under the License.
 #ifdef WITH_CUDA
 
 #include "oneflow/core/device/cuda_util.h"
+#include <condition_variable>
 
 namespace oneflow {
 
+// Communicators created by this process. The memory is the drop of free device memory around
+// the creation of every communicator, so it is only approximate while other threads allocate.
+struct EagerNcclCommStats {
+  int64_t num_comms = 0;
+  int64_t num_split_comms = 0;
+  int64_t memory_bytes = 0;
+};
+
+// Communicators are created lazily, on the first request for a device set. The communicators of
+// a device set for independent streams are split from the communicator of the device set with
+// ncclCommSplit, sharing its resources, unless ONEFLOW_NCCL_COMM_SPLIT is off or NCCL is older
+// than 2.18. The ranks of a device set may ask for the streams in different orders, so the first
+// rank of the device set publishes the order of the splits and all the ranks follow it.
 class EagerNcclCommMgr final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(EagerNcclCommMgr);
@@ -34,14 +48,33 @@ class EagerNcclCommMgr final {
   ncclComm_t GetCommForDeviceAndStreamName(const std::set<std::pair<int64_t, int64_t>>& device_set,
                                            const std::string& stream_name);
 
+  EagerNcclCommStats GetStats();
+
  private:
   friend class Global<EagerNcclCommMgr>;
   EagerNcclCommMgr() = default;
 
+  // The splits of the communicator of a device set on one of its devices.
+  struct SplitState {
+    HashMap<std::string, int64_t> stream_name2split_index;  // only kept by the first rank
+    HashMap<std::string, ncclComm_t> stream_name2comm;
+    int64_t num_splits = 0;
+    bool splitting = false;
+  };
+
+  ncclComm_t SplitCommForStream(const std::set<std::pair<int64_t, int64_t>>& device_set,
+                                const std::vector<std::pair<int64_t, int64_t>>& device_vec,
+                                const std::string& device_set_key, const std::string& stream_name,
+                                int dev);
+  void AddCommToStats(const std::string& key, bool is_split, int64_t memory_bytes);
+
   std::map<std::set<std::pair<int64_t, int64_t>>, HashMap<int64_t, ncclComm_t>>
       device_set2device_id2comm_;
   std::map<std::string, HashMap<int64_t, ncclComm_t>> device7stream2device_id2comm_;
+  std::map<std::string, HashMap<int64_t, SplitState>> device_set_key2device_id2split_state_;
+  EagerNcclCommStats stats_;
   std::mutex mutex_;
+  std::condition_variable split_cond_;
 };
 
 }  // namespace oneflow
@@ -28,6 +28,8 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/persistence/peer_snapshot_store.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/vm/virtual_machine_scope.h"
 #include "oneflow/core/job/job_build_and_infer_ctx_mgr.h"
@@ -48,11 +50,14 @@ limitations under the License.
 #include "oneflow/core/kernel/sync_check_kernel_observer.h"
 #include "oneflow/core/kernel/blob_access_checker_kernel_observer.h"
 #include "oneflow/core/kernel/profiler_kernel_observer.h"
+#include "oneflow/core/kernel/kernel_metrics_kernel_observer.h"
 #ifdef WITH_RDMA
 #include "oneflow/core/platform/include/ibv.h"
 #endif  // WITH_RDMA
 #include "oneflow/core/ep/include/device_manager_registry.h"
 #include "oneflow/core/ep/cpu/cpu_device_manager.h"
+#include "oneflow/core/ep/cpu/cpu_thread_pool.h"
+#include "oneflow/core/embedding/embedding_manager.h"
 
 namespace oneflow {
 
@@ -102,9 +107,10 @@ void SetCpuDeviceManagerNumThreads() {
   ep::CpuDeviceManager* cpu_device_manager = dynamic_cast<ep::CpuDeviceManager*>(
       Global<ep::DeviceManagerRegistry>::Get()->GetDeviceManager(DeviceType::kCPU));
   constexpr size_t kDefaultUsedNumThreads = 2;
-  int64_t cpu_logic_core = std::thread::hardware_concurrency();
-  int64_t default_num_threads =
-      (cpu_logic_core / GlobalProcessCtx::NumOfProcessPerNode()) - kDefaultUsedNumThreads;
+  // Only the cpus of the affinity mask and the cgroup quota, not all the cores of the host.
+  int64_t cpu_logic_core = ep::GetNumAvailableCpus();
+  int64_t default_num_threads = std::max<int64_t>(
+      (cpu_logic_core / GlobalProcessCtx::NumOfProcessPerNode()) - kDefaultUsedNumThreads, 1);
   int64_t num_threads = ParseIntegerFromEnv("OMP_NUM_THREADS", default_num_threads);
   cpu_device_manager->SetDeviceNumThreads(num_threads);
 }
@@ -183,10 +189,15 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
   }
   Global<ep::DeviceManagerRegistry>::New();
   Global<ThreadPool>::New(Global<ResourceDesc, ForSession>::Get()->ComputeThreadPoolSize());
+  Global<AsyncSnapshotWriter>::New(
+      ParseIntegerFromEnv("ONEFLOW_ASYNC_SNAPSHOT_WRITER_NUM_THREADS", 4));
+  Global<PeerSnapshotStore>::New(
+      GetStringFromEnv("ONEFLOW_PEER_SNAPSHOT_DIR", "/dev/shm/oneflow_peer_snapshot"));
   SetCpuDeviceManagerNumThreads();
 #ifdef WITH_CUDA
   Global<EagerNcclCommMgr>::New();
   Global<CudnnConvAlgoCache>::New();
+  Global<embedding::EmbeddingManager>::New();
 #endif
   Global<vm::VirtualMachineScope>::New(Global<ResourceDesc, ForSession>::Get()->resource());
   Global<EagerJobBuildAndInferCtxMgr>::New();
@@ -220,6 +231,7 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
       kernel_observers.emplace_back(new BlobAccessCheckerKernelObserver());
     }
     kernel_observers.emplace_back(new ProfilerKernelObserver());
+    kernel_observers.emplace_back(new KernelMetricsKernelObserver());
     Global<KernelObserver>::SetAllocated(new ChainKernelObserver(kernel_observers));
   }
   TensorBufferPool::New();
@@ -232,6 +244,9 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
     VLOG(1) << "Multi client session has not closed , env close it at env scope destruction.";
     CHECK_JUST(session_ctx->TryClose());
   }
+  // Finishes the snapshots still being written or replicated.
+  Global<PeerSnapshotStore>::Delete();
+  Global<AsyncSnapshotWriter>::Delete();
   TensorBufferPool::Delete();
   Global<KernelObserver>::Delete();
   if (!Global<ResourceDesc, ForSession>::Get()->enable_dry_run()) {
@@ -248,6 +263,7 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
   Global<EagerJobBuildAndInferCtxMgr>::Delete();
   Global<vm::VirtualMachineScope>::Delete();
 #ifdef WITH_CUDA
+  Global<embedding::EmbeddingManager>::Delete();
   Global<CudnnConvAlgoCache>::Delete();
   Global<EagerNcclCommMgr>::Delete();
 #endif
@@ -24,6 +24,8 @@ limitations under the License.
 
 namespace oneflow {
 
+class IdState;
+
 class IDMgr final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(IDMgr);
@@ -35,6 +37,11 @@ class IDMgr final {
 
   TaskIdGenerator* GetTaskIdGenerator() { return &task_id_gen_; }
 
+  // Save and restore all counters, so that a plan cached by another process can be loaded as if
+  // it is compiled in this process.
+  void SaveIdState(IdState* id_state) const;
+  void LoadIdState(const IdState& id_state);
+
  private:
   friend class Global<IDMgr>;
   IDMgr();
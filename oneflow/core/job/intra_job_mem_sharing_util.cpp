@@ -22,6 +22,9 @@ limitations under the License.
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/job/plan_util.h"
+#include <limits>
+#include <numeric>
+#include <random>
 
 namespace oneflow {
 
@@ -29,6 +32,7 @@ enum MemAllocAlgoType {
   kMemSizeFirstAlgo = 0,
   kMutualExclusionFirstAlgo = 1,
   kTimeLineAlgo = 2,
+  kBestFitAlgo = 3,
 };
 
 }  // namespace oneflow
@@ -693,11 +697,104 @@ void MemReusedAlgorithm_TimeLineAlgo(
   result->mem_block_size = bfc_allocator.buffer_size();
 }
 
+void MemReusedAlgorithm_BestFitAlgo(
+    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
+    int64_t lower_bound, MemBlockResultInfo* result) {
+  std::vector<RegstDescProto*> regsts;
+  HashMap<RegstDescProto*, int64_t> regst2index;
+  for (const auto& pair : regst2mutual_exclusion_regsts) {
+    regst2index.emplace(pair.first, regsts.size());
+    regsts.emplace_back(pair.first);
+  }
+  const int64_t regst_num = regsts.size();
+  std::vector<int64_t> sizes(regst_num);
+  std::vector<std::vector<int64_t>> mutual_exclusions(regst_num);
+  for (int64_t i = 0; i < regst_num; ++i) {
+    sizes.at(i) = RtRegstDesc(*regsts.at(i)).TotalMainByteSize4AllRegst();
+    for (RegstDescProto* mutual_regst : regst2mutual_exclusion_regsts.at(regsts.at(i))) {
+      mutual_exclusions.at(i).emplace_back(regst2index.at(mutual_regst));
+    }
+  }
+  std::vector<int64_t> best_order(regst_num);
+  std::iota(best_order.begin(), best_order.end(), 0);
+  std::stable_sort(best_order.begin(), best_order.end(),
+                   [&](int64_t lhs, int64_t rhs) { return sizes.at(lhs) > sizes.at(rhs); });
+  std::vector<int64_t> best_offsets;
+  int64_t best_size = IntraJobMemSharingUtil::PlaceByOrderWithBestFit(
+      best_order, sizes, mutual_exclusions, &best_offsets);
+
+  // Refine by moving a regst reaching the top of the mem block ahead in the order, so that it is
+  // placed before the regsts that pushed it up. The rounds are bounded and the random engine is
+  // seeded, so the plan is reproducible.
+  const int64_t round_num =
+      GlobalJobDesc().job_conf().memory_allocation_algorithm_conf().best_fit_refine_round_num();
+  std::mt19937 random_engine(0);
+  std::vector<int64_t> order;
+  std::vector<int64_t> offsets;
+  std::vector<int64_t> top_positions;
+  for (int64_t round = 0; round < round_num && best_size > lower_bound; ++round) {
+    top_positions.clear();
+    for (int64_t pos = 0; pos < regst_num; ++pos) {
+      const int64_t i = best_order.at(pos);
+      if (pos > 0 && best_offsets.at(i) + sizes.at(i) == best_size) {
+        top_positions.emplace_back(pos);
+      }
+    }
+    if (top_positions.empty()) { break; }
+    const int64_t from =
+        top_positions.at(std::uniform_int_distribution<int64_t>(0, top_positions.size() - 1)(
+            random_engine));
+    const int64_t to = std::uniform_int_distribution<int64_t>(0, from - 1)(random_engine);
+    order = best_order;
+    std::rotate(order.begin() + to, order.begin() + from, order.begin() + from + 1);
+    const int64_t size =
+        IntraJobMemSharingUtil::PlaceByOrderWithBestFit(order, sizes, mutual_exclusions, &offsets);
+    if (size < best_size) {
+      best_size = size;
+      best_order.swap(order);
+      best_offsets.swap(offsets);
+    }
+  }
+  for (int64_t i = 0; i < regst_num; ++i) {
+    CHECK(result->regst_desc2offset.emplace(regsts.at(i), best_offsets.at(i)).second);
+  }
+  result->mem_block_size = std::max<int64_t>(best_size, 1);
+}
+
+// The peak of the bytes of the regsts alive at the same time, no mem block can be smaller.
+int64_t PeakLiveBytes(const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+                      const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline) {
+  int64_t live_bytes = 0;
+  int64_t peak_live_bytes = 0;
+  CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
+  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
+    for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
+      live_bytes += RtRegstDesc(*alloc_regst).TotalMainByteSize4AllRegst();
+    }
+    peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+    for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
+      live_bytes -= RtRegstDesc(*free_regst).TotalMainByteSize4AllRegst();
+    }
+  }
+  return peak_live_bytes;
+}
+
+std::string MemAllocAlgoName(MemAllocAlgoType algo_id) {
+  switch (algo_id) {
+    case kMemSizeFirstAlgo: return "MemSizeFirstAlgo";
+    case kMutualExclusionFirstAlgo: return "MutualExclusionFirstAlgo";
+    case kTimeLineAlgo: return "TimeLineAlgo";
+    case kBestFitAlgo: return "BestFitAlgo";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
 void SelectAlgorithmGenMemBlockOffset4Regsts(
     MemAllocAlgoType algo_id, const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
     const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
     const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    MemBlockResultInfo* result) {
+    int64_t lower_bound, MemBlockResultInfo* result) {
   CHECK_EQ(result->mem_block_size, 0);
   CHECK(result->regst_desc2offset.empty());
   switch (algo_id) {
@@ -710,6 +807,9 @@ void SelectAlgorithmGenMemBlockOffset4Regsts(
     case kTimeLineAlgo:
       MemReusedAlgorithm_TimeLineAlgo(alloc_regsts_timeline, free_regsts_timeline, result);
       break;
+    case kBestFitAlgo:
+      MemReusedAlgorithm_BestFitAlgo(regst2mutual_exclusion_regsts, lower_bound, result);
+      break;
     default: UNIMPLEMENTED();
   }
   CHECK_GT(result->mem_block_size, 0);
@@ -723,6 +823,7 @@ int64_t CountMemAllocAlgoNum() {
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_time_line_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_best_fit_algo()) { ++ret; }
   CHECK_GE(ret, 0);
   return ret;
 }
@@ -740,10 +841,44 @@ void InitAlgo2Result(HashMap<MemAllocAlgoType, MemBlockResultInfo>* algo2result)
   if (mem_alloc_algo_conf.use_time_line_algo()) {
     CHECK(algo2result->emplace(kTimeLineAlgo, MemBlockResultInfo()).second);
   }
+  if (mem_alloc_algo_conf.use_best_fit_algo()) {
+    CHECK(algo2result->emplace(kBestFitAlgo, MemBlockResultInfo()).second);
+  }
 }
 
 }  // namespace
 
+int64_t IntraJobMemSharingUtil::PlaceByOrderWithBestFit(
+    const std::vector<int64_t>& order, const std::vector<int64_t>& sizes,
+    const std::vector<std::vector<int64_t>>& mutual_exclusions, std::vector<int64_t>* offsets) {
+  offsets->assign(sizes.size(), -1);
+  int64_t buffer_size = 0;
+  std::vector<std::pair<int64_t, int64_t>> occupied;
+  for (int64_t i : order) {
+    occupied.clear();
+    for (int64_t j : mutual_exclusions.at(i)) {
+      const int64_t offset = offsets->at(j);
+      if (offset != -1) { occupied.emplace_back(offset, offset + sizes.at(j)); }
+    }
+    std::sort(occupied.begin(), occupied.end());
+    int64_t best_offset = -1;
+    int64_t best_gap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    for (const auto& interval : occupied) {
+      const int64_t gap = interval.first - cursor;
+      if (gap >= sizes.at(i) && gap < best_gap) {
+        best_offset = cursor;
+        best_gap = gap;
+      }
+      cursor = std::max(cursor, interval.second);
+    }
+    if (best_offset == -1) { best_offset = cursor; }
+    offsets->at(i) = best_offset;
+    buffer_size = std::max(buffer_size, best_offset + sizes.at(i));
+  }
+  return buffer_size;
+}
+
 void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
     Plan* plan, const std::function<bool(const std::string&, const std::string&)>&
                     IsOpNameDataOrCtrlReachable) {
@@ -774,6 +909,12 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
         &mem_chain2consumer2inplaced_regst[pair.first]);
   }
 
+  HashMap<int64_t, int64_t> mem_chain2lower_bound;
+  for (int64_t mem_chain_id : mem_chains) {
+    mem_chain2lower_bound[mem_chain_id] = PeakLiveBytes(
+        mem_chain2task2alloc_regsts.at(mem_chain_id), mem_chain2task2free_regsts.at(mem_chain_id));
+  }
+
   // step 2: multi-thread run several algorithm for each mem chain
   HashMap<int64_t, HashMap<MemAllocAlgoType, MemBlockResultInfo>> mem_chain2algo2result;
   {
@@ -788,11 +929,12 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
         MemBlockResultInfo* result = &pair.second;
         thread_pool.AddWork([algo_id, mem_chain_id, &mem_chain2task2alloc_regsts,
                              &mem_chain2task2free_regsts, &mem_chain2regst2mutual_exclusion_regsts,
-                             result, &counter]() {
+                             &mem_chain2lower_bound, result, &counter]() {
           SelectAlgorithmGenMemBlockOffset4Regsts(
               algo_id, mem_chain2task2alloc_regsts.at(mem_chain_id),
               mem_chain2task2free_regsts.at(mem_chain_id),
-              mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id), result);
+              mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id),
+              mem_chain2lower_bound.at(mem_chain_id), result);
           counter.Decrease();
         });
       }
@@ -803,12 +945,23 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
   // step 3: choose best one for each mem chain and set offset for inplace consumer regst
   for (const auto& pair : mem_chain2algo2result) {
     const MemBlockResultInfo* best_result = nullptr;
+    MemAllocAlgoType best_algo_id = kMemSizeFirstAlgo;
     for (const auto& algo_result_pair : pair.second) {
       if (!best_result || algo_result_pair.second.mem_block_size < best_result->mem_block_size) {
         best_result = &algo_result_pair.second;
+        best_algo_id = algo_result_pair.first;
       }
     }
     CHECK(best_result != nullptr);
+    const int64_t lower_bound = mem_chain2lower_bound.at(pair.first);
+    const double gap =
+        lower_bound > 0
+            ? (static_cast<double>(best_result->mem_block_size) - lower_bound) * 100 / lower_bound
+            : 0;
+    VLOG(1) << "mem chain " << pair.first << " of job " << GlobalJobDesc().job_name()
+            << " chooses " << MemAllocAlgoName(best_algo_id) << ", mem block size "
+            << best_result->mem_block_size << ", lower bound " << lower_bound << ", gap " << gap
+            << "%";
     int64_t mem_block_id = Global<IDMgr>::Get()->NewMemBlockId();
     CHECK_EQ(mem_chain2mem_reused_regsts.at(pair.first).size(),
              (best_result->regst_desc2offset.size()
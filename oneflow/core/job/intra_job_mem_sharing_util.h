@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/job/plan.pb.h"
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace oneflow {
 
@@ -26,6 +27,13 @@ struct IntraJobMemSharingUtil {
   static void InferMemBlockId4MemReusedRegst(
       Plan* plan, const std::function<bool(const std::string&, const std::string&)>&
                       IsOpNameDataOrCtrlReachable);
+
+  // Places the regsts in order, each one into the smallest gap between the mutual exclusion regsts
+  // placed before it, or on top of them if no gap fits. Returns the size of the mem block.
+  static int64_t PlaceByOrderWithBestFit(const std::vector<int64_t>& order,
+                                         const std::vector<int64_t>& sizes,
+                                         const std::vector<std::vector<int64_t>>& mutual_exclusions,
+                                         std::vector<int64_t>* offsets);
 };
 
 }  // namespace oneflow
@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/job/intra_job_mem_sharing_util.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace oneflow {
+namespace test {
+
+namespace {
+
+void CheckMutualExclusionsNeverOverlap(const std::vector<int64_t>& sizes,
+                                       const std::vector<std::vector<int64_t>>& mutual_exclusions,
+                                       const std::vector<int64_t>& offsets,
+                                       int64_t mem_block_size) {
+  ASSERT_EQ(offsets.size(), sizes.size());
+  int64_t top = 0;
+  for (int64_t i = 0; i < sizes.size(); ++i) {
+    ASSERT_GE(offsets.at(i), 0);
+    top = std::max(top, offsets.at(i) + sizes.at(i));
+    for (int64_t j : mutual_exclusions.at(i)) {
+      const bool disjoint = offsets.at(i) + sizes.at(i) <= offsets.at(j)
+                            || offsets.at(j) + sizes.at(j) <= offsets.at(i);
+      ASSERT_TRUE(disjoint) << "regst " << i << " at [" << offsets.at(i) << ", "
+                            << offsets.at(i) + sizes.at(i) << ") overlaps regst " << j << " at ["
+                            << offsets.at(j) << ", " << offsets.at(j) + sizes.at(j) << ")";
+    }
+  }
+  ASSERT_EQ(mem_block_size, top);
+}
+
+}  // namespace
+
+TEST(IntraJobMemSharingUtil, place_into_smallest_gap) {
+  // Regsts 0 to 3 and 5 are stacked as [0, 2), [2, 6), [6, 7), [7, 9) and [9, 12). Regst 4 only
+  // excludes 1, 3 and 5, so both [0, 2) and [6, 7) are free for it, and the smaller one is taken.
+  const std::vector<int64_t> sizes{2, 4, 1, 2, 1, 3};
+  const std::vector<std::vector<int64_t>> mutual_exclusions{
+      {1, 2, 3, 5}, {0, 2, 3, 4, 5}, {0, 1, 3, 5}, {0, 1, 2, 4, 5}, {1, 3, 5}, {0, 1, 2, 3, 4}};
+  std::vector<int64_t> offsets;
+  const int64_t mem_block_size = IntraJobMemSharingUtil::PlaceByOrderWithBestFit(
+      {0, 1, 2, 3, 5, 4}, sizes, mutual_exclusions, &offsets);
+  ASSERT_EQ(offsets, std::vector<int64_t>({0, 2, 6, 7, 6, 9}));
+  ASSERT_EQ(mem_block_size, 12);
+  CheckMutualExclusionsNeverOverlap(sizes, mutual_exclusions, offsets, mem_block_size);
+}
+
+TEST(IntraJobMemSharingUtil, mutual_exclusions_never_overlap) {
+  std::mt19937 random_engine(0);
+  std::uniform_int_distribution<int64_t> size_distribution(1, 1024);
+  std::bernoulli_distribution mutual_exclusion_distribution(0.3);
+  for (int64_t round = 0; round < 100; ++round) {
+    const int64_t regst_num = 1 + round % 40;
+    std::vector<int64_t> sizes(regst_num);
+    for (int64_t& size : sizes) { size = size_distribution(random_engine); }
+    std::vector<std::vector<int64_t>> mutual_exclusions(regst_num);
+    for (int64_t i = 0; i < regst_num; ++i) {
+      for (int64_t j = i + 1; j < regst_num; ++j) {
+        if (mutual_exclusion_distribution(random_engine)) {
+          mutual_exclusions.at(i).push_back(j);
+          mutual_exclusions.at(j).push_back(i);
+        }
+      }
+    }
+    std::vector<int64_t> order(regst_num);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), random_engine);
+    std::vector<int64_t> offsets;
+    const int64_t mem_block_size = IntraJobMemSharingUtil::PlaceByOrderWithBestFit(
+        order, sizes, mutual_exclusions, &offsets);
+    CheckMutualExclusionsNeverOverlap(sizes, mutual_exclusions, offsets, mem_block_size);
+  }
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/framework/scope_util.h"
 #include "oneflow/core/job/foreign_callback.h"
 #include "oneflow/core/job/job_build_and_infer_ctx.h"
+#include "oneflow/core/job/compile_time_profile.h"
 #include "oneflow/core/job/mirrored_sig_infer_hint.h"
 #include "oneflow/core/job/scope.h"
 #include "oneflow/core/job_rewriter/autograd.h"
@@ -997,15 +998,19 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
     }
   };
   int32_t pass_cnt = 0;
+  CompileTimeProfile profile("job passes of " + job().job_conf().job_name());
   auto DoPass = [&](const std::string& pass_name, int32_t cnt = 0) -> Maybe<void> {
     if (unlikely(NeedLogJob(pass_name))) {
       std::string cnt_str = cnt > 0 ? std::to_string(cnt) : "";
       LogJob("pass_cnt_" + std::to_string(pass_cnt) + "-" + pass_name + cnt_str + "-before");
+      profile.Tick("LogJob");
     }
     JUST(JobPass4Name(pass_name)(mut_job(), &job_pass_ctx));
+    profile.Tick(pass_name);
     if (unlikely(NeedLogJob(pass_name))) {
       std::string cnt_str = cnt > 0 ? std::to_string(cnt) : "";
       LogJob("pass_cnt_" + std::to_string(pass_cnt) + "-" + pass_name + cnt_str + "-after");
+      profile.Tick("LogJob");
     }
     ++pass_cnt;
     return Maybe<void>::Ok();
@@ -1024,26 +1029,38 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
     JUST(DoPass("ModelUpdateConfCompatiblePass"));
     JUST(DoPass("AddInputOutputOpsPass"));
     JUST(DoPass("NormalizationExponentialAverageAutoTickPass"));
+    // Search the sbp signatures on the forward graph, the backward ones follow them.
+    JUST(DoPass("AutoParallelPass"));
 #ifdef WITH_CUDA
     JUST(DoPass("AutoMixedPrecision"));
     JUST(DoPass("PruneAmpWhiteIdentityOpPass"));
+    JUST(DoPass("Fp8MatmulPass"));
 #endif
+    JUST(DoPass("SequenceParallelPass"));
+    JUST(DoPass("TensorParallelCommOverlapPass"));
     JUST(DoPass("OptimizerPlacementOptimizationPass"));
     JUST(DoPass("DynamicLossScaleSchedulePass"));
     JUST(DoPass("AutoTrainStep"));
     JUST(DoPass("AutoLearningRate"));
     JUST(DoPass("QuantAwareTraining"));
+    JUST(DoPass("QuantizedInferencePass"));
+    JUST(DoPass("InferenceGraphOptimizationPass"));
+    JUST(DoPass("ChannelsLastPass"));
 #ifdef WITH_MLIR
     JUST(DoPass("IRRoundTripBeforeAD"));
 #endif  // WITH_MLIR
     JUST(DoPass("GenerateBackwardAndOptimizerOpConfs"));
     JUST(DoPass("AddSspVariableProxy"));
     JUST(DoPass("CheckpointingPass"));
+    JUST(DoPass("ActivationOffloadPass"));
+    JUST(DoPass("OptimizerPlacementOptimizationBackwardRestorePass"));
     JUST(DoPass("CudnnFusedNormalizationAddReluPass"));
     JUST(DoPass("PruneCastToStaticShapeOpsPass"));
 #ifdef WITH_MLIR
     JUST(DoPass("IRRoundTrip"));
 #endif  // WITH_MLIR
+    JUST(DoPass("FuseMatmulBiasActivationPass"));
+    JUST(DoPass("FuseResidualNormPass"));
     JUST(DoPass("FuseAddToOutputPass"));
     // run this pass again to fuse ops created in the first run.
     // TODO(guoran): loop multiple times inside the pass
@@ -1053,8 +1070,12 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
     JUST(DoPass("DoParallelCastBeforeWideningTypeCast"));
     JUST(DoPass("AddLbiDiffWatcherOpConfs"));
     JUST(DoPass("FuseCastScalePass"));
+    JUST(DoPass("FuseElementwiseChainPass"));
     JUST(DoPass("PruneParallelCastOpsPass"));
     JUST(DoPass("FuseUpdateOpsPass"));
+    JUST(DoPass("MultiTensorModelUpdatePass"));
+    JUST(DoPass("DeferAccBoxingPass"));
+    JUST(DoPass("MultiComputeStreamPass"));
     JUST(DoPass("FixPipelineStageIdPass"));
     JUST(DoPass("PipelineBufferPass"));
     JUST(DoPass("DumpVariableInfoPass"));
@@ -57,6 +57,8 @@ class JobDesc final {
   bool enable_reuse_mem() const { return job_conf_.enable_reuse_mem(); }
   bool enable_inplace() const { return job_conf_.enable_inplace(); }
   bool enable_auto_mixed_precision() const { return job_conf_.enable_auto_mixed_precision(); }
+  DataType mixed_precision_data_type() const { return job_conf_.mixed_precision_data_type(); }
+  bool enable_auto_parallel() const { return job_conf_.enable_auto_parallel(); }
   bool do_parallel_cast_before_widening_type_cast() const {
     return job_conf_.do_parallel_cast_before_widening_type_cast();
   };
@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/pipeline_bubble_profile.h"
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/operator/op_conf.pb.h"
+#include "oneflow/core/vm/symbol_storage.h"
+
+namespace oneflow {
+
+bool PipelineBubbleProfile::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_PROFILE_PIPELINE_BUBBLE", false);
+  return enabled;
+}
+
+PipelineBubbleProfile* PipelineBubbleProfile::Get() {
+  static PipelineBubbleProfile profile;
+  return &profile;
+}
+
+int64_t PipelineBubbleProfile::StageId4ActorOpConf(const OperatorConf& op_conf) {
+  if (!Enabled() || !op_conf.has_scope_symbol_id()) { return -1; }
+  const auto* scope_storage = Global<symbol::Storage<Scope>>::Get();
+  if (scope_storage == nullptr || !scope_storage->Has(op_conf.scope_symbol_id())) { return -1; }
+  return scope_storage->Get(op_conf.scope_symbol_id()).Int64("pipeline_stage_id_hint");
+}
+
+void PipelineBubbleProfile::OnStepLaunch(const std::string& job_name) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_name2record_[job_name].launch_times.emplace_back(now);
+}
+
+void PipelineBubbleProfile::OnStageAct(const std::string& job_name, int64_t stage_id) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& stage_id2act_span = job_name2record_[job_name].stage_id2act_span;
+  auto it = stage_id2act_span.find(stage_id);
+  if (it == stage_id2act_span.end()) {
+    stage_id2act_span.emplace(stage_id, std::make_pair(now, now));
+  } else {
+    it->second.second = now;
+  }
+}
+
+void PipelineBubbleProfile::OnStepFinish(const std::string& job_name) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  JobRecord* record = &job_name2record_[job_name];
+  if (record->launch_times.empty()) { return; }
+  const double start_time = std::max(record->launch_times.front(), record->last_finish_time);
+  record->launch_times.pop_front();
+  record->last_finish_time = now;
+  const int64_t step = record->step++;
+  const double elapsed = now - start_time;
+  if (record->stage_id2act_span.size() > 1 && elapsed > 0) {
+    std::vector<std::pair<int64_t, double>> stage_id2ratio;
+    double total_ratio = 0;
+    for (const auto& pair : record->stage_id2act_span) {
+      const double busy = pair.second.second - std::max(pair.second.first, start_time);
+      const double ratio = 1 - std::min(std::max(busy, 0.0), elapsed) / elapsed;
+      stage_id2ratio.emplace_back(pair.first, ratio);
+      total_ratio += ratio;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "pipeline bubble of job " << job_name << " step " << step << ": "
+       << total_ratio * 100 / stage_id2ratio.size() << "% in " << elapsed / 1e6 << " ms";
+    for (const auto& pair : stage_id2ratio) {
+      ss << ", stage " << pair.first << ": " << pair.second * 100 << "%";
+    }
+    LOG(INFO) << ss.str();
+  }
+  record->stage_id2act_span.clear();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PIPELINE_BUBBLE_PROFILE_H_
+#define ONEFLOW_CORE_JOB_PIPELINE_BUBBLE_PROFILE_H_
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Reports the pipeline bubble ratio realised by each step of the lazy jobs if
+// ONEFLOW_PROFILE_PIPELINE_BUBBLE is set. A step spans from its launch, or the finish of the
+// previous step if later, to its finish. The bubble of a pipeline stage is the part of the step
+// before its actors first act and after they last act, which is where the warmup and the cooldown
+// of the schedule idle the stage.
+class OperatorConf;
+
+class PipelineBubbleProfile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PipelineBubbleProfile);
+  ~PipelineBubbleProfile() = default;
+
+  static bool Enabled();
+  static PipelineBubbleProfile* Get();
+  // The pipeline stage of the actor running `op_conf`, -1 if not profiled.
+  static int64_t StageId4ActorOpConf(const OperatorConf& op_conf);
+
+  void OnStepLaunch(const std::string& job_name);
+  void OnStageAct(const std::string& job_name, int64_t stage_id);
+  void OnStepFinish(const std::string& job_name);
+
+ private:
+  PipelineBubbleProfile() = default;
+
+  struct JobRecord {
+    int64_t step = 0;
+    double last_finish_time = 0;
+    std::deque<double> launch_times;
+    // The first and the last act time of each stage in the current step.
+    std::map<int64_t, std::pair<double, double>> stage_id2act_span;
+  };
+
+  std::mutex mutex_;
+  HashMap<std::string, JobRecord> job_name2record_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PIPELINE_BUBBLE_PROFILE_H_
@@ -0,0 +1,315 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_memory_report.h"
+#include <iomanip>
+#include <map>
+#include <queue>
+#include <sstream>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/register/runtime_register_desc.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr char kReportDir[] = "plan_memory_report";
+
+std::string MemZoneName(const MemoryCase& mem_case) {
+  if (mem_case.has_device_cuda_mem()) {
+    return "cuda:" + std::to_string(mem_case.device_cuda_mem().device_id());
+  } else if (mem_case.has_host_mem() && mem_case.host_mem().has_cuda_pinned_mem()) {
+    return "cpu pinned for cuda:"
+           + std::to_string(mem_case.host_mem().cuda_pinned_mem().device_id());
+  } else {
+    return "cpu";
+  }
+}
+
+std::string BytesToMiB(int64_t bytes) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+  return ss.str();
+}
+
+struct RegstRecord {
+  const RegstDescProto* regst_desc;
+  std::string op_name;
+  int64_t size;
+  int64_t lifetime_begin;
+  int64_t lifetime_end;
+};
+
+struct MemBlockRecord {
+  const MemBlockProto* mem_block;
+  std::vector<RegstRecord> regsts;
+  // The most bytes of its regsts alive at the same time.
+  int64_t peak_live_bytes = 0;
+};
+
+struct ZoneRecord {
+  std::vector<const ChunkProto*> chunks;
+  std::vector<MemBlockRecord> mem_blocks;
+  int64_t allocated_bytes = 0;
+  // The bytes the regsts and their separated headers would need without any reuse.
+  int64_t needed_bytes = 0;
+  HashMap<std::string, int64_t> op_name2activation_bytes;
+};
+
+// The position of each task in a topological order of the tasks along their regsts. The tasks on
+// cycles, like those closed by reentrant locks, follow in the order of their ids.
+HashMap<int64_t, int64_t> TaskId2Order(const Plan& plan) {
+  HashMap<int64_t, int64_t> task_id2in_degree;
+  HashMap<int64_t, std::vector<int64_t>> task_id2consumers;
+  std::vector<int64_t> task_ids;
+  for (const TaskProto& task : plan.task()) {
+    task_id2in_degree.emplace(task.task_id(), 0);
+    task_ids.emplace_back(task.task_id());
+  }
+  std::sort(task_ids.begin(), task_ids.end());
+  for (const TaskProto& task : plan.task()) {
+    for (const auto& pair : task.produced_regst_desc()) {
+      for (int64_t consumer : pair.second.consumer_task_id()) {
+        auto it = task_id2in_degree.find(consumer);
+        if (it == task_id2in_degree.end()) { continue; }
+        it->second += 1;
+        task_id2consumers[task.task_id()].emplace_back(consumer);
+      }
+    }
+  }
+  HashMap<int64_t, int64_t> task_id2order;
+  std::queue<int64_t> queue;
+  for (int64_t task_id : task_ids) {
+    if (task_id2in_degree.at(task_id) == 0) { queue.push(task_id); }
+  }
+  size_t next_unordered = 0;
+  while (task_id2order.size() < task_ids.size()) {
+    if (queue.empty()) {
+      while (task_id2order.count(task_ids.at(next_unordered)) > 0) { next_unordered += 1; }
+      queue.push(task_ids.at(next_unordered));
+    }
+    const int64_t task_id = queue.front();
+    queue.pop();
+    if (!task_id2order.emplace(task_id, task_id2order.size()).second) { continue; }
+    auto it = task_id2consumers.find(task_id);
+    if (it == task_id2consumers.end()) { continue; }
+    for (int64_t consumer : it->second) {
+      if (task_id2order.count(consumer) > 0) { continue; }
+      if (--task_id2in_degree.at(consumer) == 0) { queue.push(consumer); }
+    }
+  }
+  return task_id2order;
+}
+
+int64_t PeakLiveBytes(const std::vector<RegstRecord>& regsts) {
+  std::map<int64_t, int64_t> order2delta;
+  for (const RegstRecord& regst : regsts) {
+    order2delta[regst.lifetime_begin] += regst.size;
+    order2delta[regst.lifetime_end + 1] -= regst.size;
+  }
+  int64_t live_bytes = 0;
+  int64_t peak_live_bytes = 0;
+  for (const auto& pair : order2delta) {
+    live_bytes += pair.second;
+    peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+  }
+  return peak_live_bytes;
+}
+
+std::vector<std::pair<std::string, int64_t>> TopOps(const ZoneRecord& zone, int64_t top_n) {
+  std::vector<std::pair<std::string, int64_t>> ops(zone.op_name2activation_bytes.cbegin(),
+                                                   zone.op_name2activation_bytes.cend());
+  std::sort(ops.begin(), ops.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+  });
+  if (ops.size() > static_cast<size_t>(top_n)) { ops.resize(top_n); }
+  return ops;
+}
+
+}  // namespace
+
+bool PlanMemoryReport::Enabled() {
+  if (ParseBooleanFromEnv("ONEFLOW_DUMP_PLAN_MEMORY_REPORT", false)) { return true; }
+  auto* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  return resource_desc != nullptr && resource_desc->enable_debug_mode();
+}
+
+void PlanMemoryReport::Dump(const Plan& plan, const std::string& plan_name) {
+  const int64_t top_n = ParseIntegerFromEnv("ONEFLOW_PLAN_MEMORY_REPORT_TOP_N", 20);
+  const HashMap<int64_t, int64_t> task_id2order = TaskId2Order(plan);
+  std::map<std::pair<int64_t, std::string>, ZoneRecord> zones;
+  auto Zone4 = [&](int64_t rank, const MemoryCase& mem_case) -> ZoneRecord* {
+    return &zones[std::make_pair(rank, MemZoneName(mem_case))];
+  };
+  for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+    ZoneRecord* zone = Zone4(chunk.machine_id(), chunk.mem_case());
+    zone->chunks.emplace_back(&chunk);
+    zone->allocated_bytes += chunk.mem_size();
+  }
+  HashMap<int64_t, MemBlockRecord*> mem_block_id2record;
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    ZoneRecord* zone = Zone4(mem_block.machine_id(), mem_block.mem_case());
+    zone->mem_blocks.emplace_back();
+    zone->mem_blocks.back().mem_block = &mem_block;
+    if (!mem_block.has_chunk_id() && !mem_block.has_chunk_offset()) {
+      zone->allocated_bytes += mem_block.mem_size();
+    }
+    if (mem_block.is_separated_header()) { zone->needed_bytes += mem_block.mem_size(); }
+  }
+  // The records are not moved any more.
+  for (auto& pair : zones) {
+    for (MemBlockRecord& record : pair.second.mem_blocks) {
+      mem_block_id2record.emplace(record.mem_block->mem_block_id(), &record);
+    }
+  }
+  for (const TaskProto& task : plan.task()) {
+    std::string op_name = TaskType_Name(task.task_type());
+    bool is_variable = false;
+    if (task.exec_sequence().exec_node_size() > 0) {
+      const OperatorConf& op_conf =
+          PlanUtil::GetOpAttribute(&plan, task.job_id(),
+                                   task.exec_sequence().exec_node(0).kernel_conf())
+              .op_conf();
+      op_name = op_conf.name();
+      is_variable = op_conf.has_variable_conf();
+    }
+    const int64_t order = task_id2order.at(task.task_id());
+    for (const auto& pair : task.produced_regst_desc()) {
+      const RegstDescProto& regst_desc = pair.second;
+      if (!regst_desc.regst_desc_type().has_data_regst_desc()) { continue; }
+      RegstRecord regst{&regst_desc, op_name, 0, order, order};
+      regst.size = RtRegstDesc(regst_desc).TotalMainByteSize4AllRegst();
+      for (int64_t consumer : regst_desc.consumer_task_id()) {
+        auto it = task_id2order.find(consumer);
+        if (it != task_id2order.end()) {
+          regst.lifetime_end = std::max(regst.lifetime_end, it->second);
+        }
+      }
+      ZoneRecord* zone = Zone4(task.machine_id(), regst_desc.mem_case());
+      zone->needed_bytes += regst.size;
+      if (task.task_type() == TaskType::kNormalForward && !is_variable) {
+        zone->op_name2activation_bytes[op_name] += regst.size;
+      }
+      auto it = mem_block_id2record.find(regst_desc.mem_block_id());
+      if (it != mem_block_id2record.end()) { it->second->regsts.emplace_back(std::move(regst)); }
+    }
+  }
+
+  nlohmann::json json_zones = nlohmann::json::array();
+  std::ostringstream summary;
+  summary << "Memory report of plan " << plan_name << "\n";
+  for (auto& pair : zones) {
+    const int64_t rank = pair.first.first;
+    const std::string& zone_name = pair.first.second;
+    ZoneRecord& zone = pair.second;
+    const int64_t saved_bytes = std::max<int64_t>(zone.needed_bytes - zone.allocated_bytes, 0);
+    nlohmann::json json_zone;
+    json_zone["rank"] = rank;
+    json_zone["memory_zone"] = zone_name;
+    json_zone["allocated_bytes"] = zone.allocated_bytes;
+    json_zone["bytes_without_reuse"] = zone.needed_bytes;
+    json_zone["reuse_saved_bytes"] = saved_bytes;
+    json_zone["chunks"] = nlohmann::json::array();
+    for (const ChunkProto* chunk : zone.chunks) {
+      json_zone["chunks"].push_back({{"chunk_id", chunk->chunk_id()},
+                                     {"mem_size", chunk->mem_size()},
+                                     {"job_ids", std::vector<int64_t>(chunk->job_id().cbegin(),
+                                                                      chunk->job_id().cend())}});
+    }
+    json_zone["mem_blocks"] = nlohmann::json::array();
+    for (MemBlockRecord& record : zone.mem_blocks) {
+      const MemBlockProto& mem_block = *record.mem_block;
+      std::sort(record.regsts.begin(), record.regsts.end(),
+                [](const RegstRecord& lhs, const RegstRecord& rhs) {
+                  return lhs.regst_desc->mem_block_offset() < rhs.regst_desc->mem_block_offset();
+                });
+      record.peak_live_bytes = PeakLiveBytes(record.regsts);
+      nlohmann::json json_block;
+      json_block["mem_block_id"] = mem_block.mem_block_id();
+      json_block["mem_size"] = mem_block.mem_size();
+      json_block["chunk_id"] = mem_block.chunk_id();
+      json_block["chunk_offset"] = mem_block.chunk_offset();
+      json_block["enable_reuse_mem"] = mem_block.enable_reuse_mem();
+      json_block["is_separated_header"] = mem_block.is_separated_header();
+      json_block["variable_op_name"] = mem_block.variable_op_name();
+      json_block["peak_live_bytes"] = record.peak_live_bytes;
+      json_block["regsts"] = nlohmann::json::array();
+      for (const RegstRecord& regst : record.regsts) {
+        json_block["regsts"].push_back(
+            {{"regst_desc_id", regst.regst_desc->regst_desc_id()},
+             {"producer_op_name", regst.op_name},
+             {"register_num", regst.regst_desc->register_num()},
+             {"offset", regst.regst_desc->mem_block_offset()},
+             {"size", regst.size},
+             {"lifetime", {regst.lifetime_begin, regst.lifetime_end}}});
+      }
+      json_zone["mem_blocks"].push_back(json_block);
+    }
+    const auto top_ops = TopOps(zone, top_n);
+    json_zone["top_ops_by_activation_bytes"] = nlohmann::json::array();
+    for (const auto& op : top_ops) {
+      json_zone["top_ops_by_activation_bytes"].push_back(
+          {{"op_name", op.first}, {"bytes", op.second}});
+    }
+    json_zones.push_back(json_zone);
+
+    summary << "\nrank " << rank << " " << zone_name << ": allocates "
+            << BytesToMiB(zone.allocated_bytes) << " in " << zone.chunks.size() << " chunks and "
+            << zone.mem_blocks.size() << " mem blocks, " << BytesToMiB(zone.needed_bytes)
+            << " without reuse, reuse saves " << BytesToMiB(saved_bytes) << "\n";
+    if (!top_ops.empty()) {
+      summary << "  top " << top_ops.size() << " ops by activation bytes:\n";
+      for (const auto& op : top_ops) {
+        summary << "    " << std::setw(12) << BytesToMiB(op.second) << "  " << op.first << "\n";
+      }
+    }
+    std::vector<const MemBlockRecord*> blocks;
+    for (const MemBlockRecord& record : zone.mem_blocks) { blocks.emplace_back(&record); }
+    std::sort(blocks.begin(), blocks.end(),
+              [](const MemBlockRecord* lhs, const MemBlockRecord* rhs) {
+                return lhs->mem_block->mem_size() > rhs->mem_block->mem_size();
+              });
+    if (blocks.size() > static_cast<size_t>(top_n)) { blocks.resize(top_n); }
+    if (!blocks.empty()) {
+      summary << "  top " << blocks.size() << " mem blocks by size:\n";
+      for (const MemBlockRecord* record : blocks) {
+        const MemBlockProto& mem_block = *record->mem_block;
+        summary << "    " << std::setw(12) << BytesToMiB(mem_block.mem_size()) << "  block "
+                << mem_block.mem_block_id();
+        if (mem_block.chunk_id() >= 0) { summary << " in chunk " << mem_block.chunk_id(); }
+        summary << ", " << record->regsts.size() << " regsts, peak live "
+                << BytesToMiB(record->peak_live_bytes);
+        if (mem_block.enable_reuse_mem()) { summary << ", reused"; }
+        if (!mem_block.variable_op_name().empty()) {
+          summary << ", variable " << mem_block.variable_op_name();
+        }
+        summary << "\n";
+      }
+    }
+  }
+  nlohmann::json json_report;
+  json_report["plan_name"] = plan_name;
+  json_report["memory_zones"] = json_zones;
+  TeePersistentLogStream::Create(JoinPath(kReportDir, plan_name + ".json"))
+      ->Write(json_report.dump(2));
+  TeePersistentLogStream::Create(JoinPath(kReportDir, plan_name + ".txt"))->Write(summary.str());
+}
+
+}  // namespace oneflow
@@ -0,0 +1,39 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_MEMORY_REPORT_H_
+#define ONEFLOW_CORE_JOB_PLAN_MEMORY_REPORT_H_
+
+#include <string>
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// Explains where the memory of a plan goes, per rank and memory zone: the chunks, the mem blocks
+// with the regsts in them and their lifetimes, the ops producing the most bytes and how much the
+// reuse of mem blocks saved. Lifetimes are spans of a topological order of the tasks, regsts of a
+// reused block whose lifetimes overlap can not share its memory.
+struct PlanMemoryReport final {
+  // Whether ONEFLOW_DUMP_PLAN_MEMORY_REPORT is set or the session is in debug mode.
+  static bool Enabled();
+  // Writes plan_memory_report/<plan_name>.json and a summary in
+  // plan_memory_report/<plan_name>.txt to the log directory. Must be called after the mem blocks
+  // and chunks of the plan are generated.
+  static void Dump(const Plan& plan, const std::string& plan_name);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_MEMORY_REPORT_H_
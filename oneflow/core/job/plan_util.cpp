@@ -16,13 +16,16 @@ limitations under the License.
 #include "oneflow/core/common/constant.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/plan_memory_report.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/graph/plan_task_graph.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/memory/chunk_manager.h"
 #include "oneflow/core/memory/memory_case_util.h"
 #include "oneflow/core/register/runtime_register_desc.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -206,7 +209,8 @@ void PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(
     return true;
   };
 
-  auto GenMemBlock4RegstIfNeed = [&](RegstDescProto* regst_desc, const TaskProto* task) {
+  auto GenMemBlock4RegstIfNeed = [&](RegstDescProto* regst_desc, const TaskProto* task,
+                                     int64_t regst_main_size, int64_t regst_separated_size) {
     const int64_t job_id = task->job_id();
     const int64_t machine_id = task->machine_id();
     const int64_t thrd_id = task->thrd_id();
@@ -227,10 +231,6 @@ void PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(
       regst_desc->set_variable_op_name(var_name);
     }
 
-    RtRegstDesc rt_regst_desc(*regst_desc);
-    int64_t regst_main_size = rt_regst_desc.TotalMainByteSize4AllRegst();
-    int64_t regst_separated_size = rt_regst_desc.TotalSeparatedHeaderByteSize4AllRegst();
-
     if (mem_block_id2mem_block.find(mem_block_id) == mem_block_id2mem_block.end()) {
       MemBlockProto mem_block;
       mem_block.set_mem_block_id(mem_block_id);
@@ -279,11 +279,27 @@ void PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(
     }
   };
 
+  // NOTE(chengcheng): building RtRegstDesc of every regst is the costly part, so the regst sizes
+  //   are computed in parallel and merged into mem blocks sequentially.
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> task_id2regst_sizes(plan->task_size());
+  MultiThreadLoop(plan->task_size(), [&](size_t i) {
+    std::vector<std::pair<int64_t, int64_t>>* regst_sizes = &task_id2regst_sizes.at(i);
+    for (const auto& pair : plan->task(i).produced_regst_desc()) {
+      RtRegstDesc rt_regst_desc(pair.second);
+      regst_sizes->emplace_back(rt_regst_desc.TotalMainByteSize4AllRegst(),
+                                rt_regst_desc.TotalSeparatedHeaderByteSize4AllRegst());
+    }
+  });
+
   for (int i = 0; i < plan->task_size(); i++) {
     TaskProto* task = plan->mutable_task(i);
+    const std::vector<std::pair<int64_t, int64_t>>& regst_sizes = task_id2regst_sizes.at(i);
+    int64_t regst_idx = 0;
     for (auto& pair : *task->mutable_produced_regst_desc()) {
-      GenMemBlock4RegstIfNeed(&pair.second, task);
+      const std::pair<int64_t, int64_t>& size = regst_sizes.at(regst_idx++);
+      GenMemBlock4RegstIfNeed(&pair.second, task, size.first, size.second);
     }
+    CHECK_EQ(regst_idx, regst_sizes.size());
   }
 
   GenChunkForMultiNNGraphMemoryReuseInMultiClient(plan, &mem_block_id2mem_block);
@@ -660,17 +676,40 @@ void PlanUtil::SetForceInplaceMemBlock(Plan* plan) {
   }
 }
 
+void PlanUtil::SplitPlanByRank(const Plan& plan, Plan* shared_plan,
+                               std::vector<Plan>* rank_plans) {
+  shared_plan->mutable_block_chunk_list();
+  *shared_plan->mutable_job_confs() = plan.job_confs();
+  *shared_plan->mutable_collective_boxing_plan() = plan.collective_boxing_plan();
+  *shared_plan->mutable_ctrl_regst_desc_info() = plan.ctrl_regst_desc_info();
+  *shared_plan->mutable_job_id2op_attribute_ref_table() = plan.job_id2op_attribute_ref_table();
+  rank_plans->clear();
+  rank_plans->resize(GlobalProcessCtx::WorldSize());
+  for (const TaskProto& task : plan.task()) {
+    *rank_plans->at(task.machine_id()).add_task() = task;
+  }
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    *rank_plans->at(mem_block.machine_id()).mutable_block_chunk_list()->add_mem_block() =
+        mem_block;
+  }
+  for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+    *rank_plans->at(chunk.machine_id()).mutable_block_chunk_list()->add_chunk() = chunk;
+  }
+}
+
 void PlanUtil::DumpCtrlRegstInfoToPlan(Plan* plan) {
   auto* ctrl_regst_desc_id2producer_task_id =
       plan->mutable_ctrl_regst_desc_info()->mutable_ctrl_regst_desc_id2producer_task_id();
-  for (const TaskProto& task : plan->task()) {
+  auto DumpCtrlRegstInfo = [&](const TaskProto& task) {
     for (const auto& pair : task.produced_regst_desc()) {
       if (pair.second.regst_desc_type().has_ctrl_regst_desc()) {
         ctrl_regst_desc_id2producer_task_id->insert(
             {pair.second.regst_desc_id(), pair.second.producer_task_id()});
       }
     }
-  }
+  };
+  for (const TaskProto& task : plan->task()) { DumpCtrlRegstInfo(task); }
+  for (const TaskProto& task : plan->remote_task()) { DumpCtrlRegstInfo(task); }
 }
 
 namespace {
@@ -721,9 +760,13 @@ void PlanUtil::GenCollectiveBoxingPlan(Job* job, Plan* plan) {
 
   RequestSet* request_set = &(*plan->mutable_collective_boxing_plan()
                                    ->mutable_job_id2request_set())[GlobalJobDesc().job_id()];
-  const int64_t cb_task_count = std::count_if(
-      plan->task().cbegin(), plan->task().cend(),
-      [](const TaskProto& task) { return IsCollectiveBoxingTaskType(task.task_type()); });
+  const auto IsCollectiveBoxingTask = [](const TaskProto& task) {
+    return IsCollectiveBoxingTaskType(task.task_type());
+  };
+  const int64_t cb_task_count =
+      std::count_if(plan->task().cbegin(), plan->task().cend(), IsCollectiveBoxingTask)
+      + std::count_if(plan->remote_task().cbegin(), plan->remote_task().cend(),
+                      IsCollectiveBoxingTask);
   if (cb_task_count == 0) { return; }
 
   PlanTaskGraph plan_task_graph(*plan);
@@ -824,13 +867,15 @@ void PlanUtil::GenCollectiveBoxingPlan(Job* job, Plan* plan) {
 
 void PlanUtil::GenRegisterHint(Plan* plan) {
   HashSet<int64_t> multi_regst_regst_desc_ids;
-  for (const TaskProto& task : plan->task()) {
+  auto CollectMultiRegstRegstDescIds = [&](const TaskProto& task) {
     for (const auto& pair : task.produced_regst_desc()) {
       if (pair.second.register_num() != 1 || task.task_type() == TaskType::kRepeat) {
         multi_regst_regst_desc_ids.emplace(pair.second.regst_desc_id());
       }
     }
-  }
+  };
+  for (const TaskProto& task : plan->task()) { CollectMultiRegstRegstDescIds(task); }
+  for (const TaskProto& task : plan->remote_task()) { CollectMultiRegstRegstDescIds(task); }
   for (TaskProto& task : *(plan->mutable_task())) {
     bool all_register_num_eq_one = true;
     for (const auto& pair : task.produced_regst_desc()) {
@@ -852,6 +897,119 @@ void PlanUtil::GenRegisterHint(Plan* plan) {
   }
 }
 
+void PlanUtil::GenStreamCudaGraphHint(Plan* plan) {
+  if (!ParseBooleanFromEnv("ONEFLOW_LAZY_ENABLE_STREAM_CUDA_GRAPH", false)) { return; }
+  HashMap<int64_t, const TaskProto*> task_id2task;
+  HashMap<int64_t, const RegstDescProto*> regst_desc_id2regst_desc;
+  // The tasks a job runs on a cuda stream of a rank.
+  std::map<std::tuple<int64_t, int64_t, int64_t>, std::vector<TaskProto*>> stream2tasks;
+  for (TaskProto& task : *(plan->mutable_task())) {
+    task_id2task.emplace(task.task_id(), &task);
+    for (const auto& pair : task.produced_regst_desc()) {
+      regst_desc_id2regst_desc.emplace(pair.second.regst_desc_id(), &pair.second);
+    }
+    if (GetStreamId(task).device_id().device_type() != DeviceType::kCUDA) { continue; }
+    stream2tasks[std::make_tuple(task.machine_id(), task.thrd_id(), task.job_id())].emplace_back(
+        &task);
+  }
+  for (const TaskProto& task : plan->remote_task()) {
+    task_id2task.emplace(task.task_id(), &task);
+    for (const auto& pair : task.produced_regst_desc()) {
+      regst_desc_id2regst_desc.emplace(pair.second.regst_desc_id(), &pair.second);
+    }
+  }
+  // Only the tasks run by light actors without inplace regsts, see light_actor.cpp.
+  auto IsLightTask = [](const TaskProto& task) {
+    if (!task.all_register_num_eq_one_hint()) { return false; }
+    if (task.exec_sequence().exec_node_size() != 1) { return false; }
+    if (task.task_type() == TaskType::kNormalForward) {
+      if (!task.exec_sequence().exec_node(0).kernel_conf().all_blobs_are_static()) {
+        return false;
+      }
+    } else if (task.task_type() != TaskType::kTick && task.task_type() != TaskType::kDeviceTick) {
+      return false;
+    }
+    for (const auto& pair : task.produced_regst_desc()) {
+      if (pair.second.has_inplace_consumed_regst_desc_id()) { return false; }
+    }
+    return true;
+  };
+  auto ForEachRegstDescId = [](const TaskProto& task,
+                               const std::function<void(int64_t)>& Handler) {
+    for (const auto& pair : task.produced_regst_desc()) { Handler(pair.second.regst_desc_id()); }
+    for (const auto& pair : task.consumed_regst_desc_id()) {
+      for (int64_t regst_desc_id : pair.second.regst_desc_id()) { Handler(regst_desc_id); }
+    }
+  };
+  // Every member acts once per iteration of the segment.
+  auto IsSameTimeShape = [&](const std::vector<TaskProto*>& tasks) {
+    const ShapeProto* time_shape = nullptr;
+    bool same = true;
+    for (const TaskProto* task : tasks) {
+      ForEachRegstDescId(*task, [&](int64_t regst_desc_id) {
+        auto it = regst_desc_id2regst_desc.find(regst_desc_id);
+        if (it == regst_desc_id2regst_desc.end()) { return; }
+        const RegstDescTypeProto& type = it->second->regst_desc_type();
+        if (!type.has_data_regst_desc()) { return; }
+        const ShapeProto& cur = type.data_regst_desc().time_shape();
+        if (time_shape == nullptr) {
+          time_shape = &cur;
+        } else if (!PbMd::Equals(*time_shape, cur)) {
+          same = false;
+        }
+      });
+    }
+    return same;
+  };
+  // The messages of a segment to other actors are held back until the whole iteration is done,
+  // so no other actor may be both fed by the segment and feed it in the same iteration. The edges
+  // into reentrant locks close the critical sections, they feed the next iteration.
+  auto IsReenteredByOtherTasks = [&](const HashSet<int64_t>& member_ids) {
+    std::queue<int64_t> queue;
+    HashSet<int64_t> visited;
+    auto VisitConsumers = [&](int64_t task_id) {
+      for (const auto& pair : task_id2task.at(task_id)->produced_regst_desc()) {
+        for (int64_t consumer : pair.second.consumer_task_id()) {
+          if (member_ids.count(consumer) > 0) { continue; }
+          if (!visited.emplace(consumer).second) { continue; }
+          auto it = task_id2task.find(consumer);
+          if (it == task_id2task.end()) { continue; }
+          if (it->second->task_type() == TaskType::kReentrantLock) { continue; }
+          queue.push(consumer);
+        }
+      }
+    };
+    for (int64_t task_id : member_ids) { VisitConsumers(task_id); }
+    while (!queue.empty()) {
+      const int64_t task_id = queue.front();
+      queue.pop();
+      for (const auto& pair : task_id2task.at(task_id)->produced_regst_desc()) {
+        for (int64_t consumer : pair.second.consumer_task_id()) {
+          if (member_ids.count(consumer) > 0) { return true; }
+        }
+      }
+      VisitConsumers(task_id);
+    }
+    return false;
+  };
+  for (const auto& pair : stream2tasks) {
+    const std::vector<TaskProto*>& tasks = pair.second;
+    if (tasks.size() < 2) { continue; }
+    if (!std::all_of(tasks.cbegin(), tasks.cend(),
+                     [&](const TaskProto* task) { return IsLightTask(*task); })) {
+      continue;
+    }
+    if (!IsSameTimeShape(tasks)) { continue; }
+    HashSet<int64_t> member_ids;
+    for (const TaskProto* task : tasks) { member_ids.emplace(task->task_id()); }
+    if (IsReenteredByOtherTasks(member_ids)) { continue; }
+    VLOG(1) << "Stream cuda graph of job " << std::get<2>(pair.first) << " on thread "
+            << std::get<1>(pair.first) << " of rank " << std::get<0>(pair.first) << ": "
+            << tasks.size() << " tasks";
+    for (TaskProto* task : tasks) { task->set_stream_cuda_graph_size(tasks.size()); }
+  }
+}
+
 void PlanUtil::PlanMemoryLog(Plan* plan, const std::string& plan_name) {
   HashMap<std::pair<int64_t, int64_t>, int64_t> rank_device2size;
   auto AddMemSizeByRankDeviceIds = [&](int64_t rank_id, int64_t device_id, int64_t mem_size) {
@@ -884,6 +1042,7 @@ void PlanUtil::PlanMemoryLog(Plan* plan, const std::string& plan_name) {
     LOG(INFO) << "Graph name " << plan_name << " needs to allocate [ " << mem_size
               << " MiB ] device memory in Rank: " << rank_id << " , Device: " << device_id << ".";
   }
+  if (PlanMemoryReport::Enabled()) { PlanMemoryReport::Dump(*plan, plan_name); }
 }
 
 const oneflow::OpAttribute& PlanUtil::GetOpAttribute(const Plan* plan, int64_t job_id,
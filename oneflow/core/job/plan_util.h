@@ -39,7 +39,14 @@ struct PlanUtil {
   static void DumpCtrlRegstInfoToPlan(Plan* plan);
   static void GenCollectiveBoxingPlan(Job* job, Plan* plan);
   static void GenRegisterHint(Plan* plan);
+  // Marks the tasks a job runs on a cuda stream to be replayed as one cuda graph, see
+  // StreamCudaGraph. Does nothing unless ONEFLOW_LAZY_ENABLE_STREAM_CUDA_GRAPH is set. Must be
+  // called after GenRegisterHint().
+  static void GenStreamCudaGraphHint(Plan* plan);
   static void PlanMemoryLog(Plan* plan, const std::string& plan_name);
+  // Splits the plan into the part every rank needs and, for each rank, the tasks, mem blocks and
+  // chunks on it. Merging rank_plans->at(i) into shared_plan gives the plan rank i runs.
+  static void SplitPlanByRank(const Plan& plan, Plan* shared_plan, std::vector<Plan>* rank_plans);
   static const oneflow::OpAttribute& GetOpAttribute(const Plan* plan, int64_t job_id,
                                                     const oneflow::KernelConf& kernel_conf);
   // NOTE(chengcheng): recovery op_attr
@@ -0,0 +1,161 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/register_num_tuner.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/memory/memory_case_util.h"
+#include "oneflow/core/register/runtime_register_desc.h"
+
+namespace oneflow {
+
+namespace {
+
+struct RegisterNumHint {
+  std::string op_name;
+  int64_t parallel_id;
+  std::string regst_name;
+  int64_t register_num;
+  int64_t suggested_register_num;
+  double stall_ratio;
+};
+
+std::string HintsDir() { return GetStringFromEnv("ONEFLOW_REGISTER_NUM_TUNING_HINTS_DIR", ""); }
+
+// Same format as written by ActorRuntimeStats, a header line then one tab separated hint a line.
+std::vector<RegisterNumHint> ParseHints(const std::string& text) {
+  std::vector<RegisterNumHint> hints;
+  std::istringstream lines(text);
+  std::string line;
+  bool is_header = true;
+  while (std::getline(lines, line)) {
+    if (is_header) {
+      is_header = false;
+      continue;
+    }
+    std::vector<std::string> fields;
+    Split(line, "\t", [&](std::string&& field) { fields.emplace_back(std::move(field)); });
+    if (fields.size() != 6) {
+      if (!line.empty()) { LOG(WARNING) << "ignore the malformed register num hint: " << line; }
+      continue;
+    }
+    hints.emplace_back(RegisterNumHint{fields.at(0), std::stoll(fields.at(1)), fields.at(2),
+                                       std::stoll(fields.at(3)), std::stoll(fields.at(4)),
+                                       std::stod(fields.at(5))});
+  }
+  std::sort(hints.begin(), hints.end(), [](const RegisterNumHint& a, const RegisterNumHint& b) {
+    return a.stall_ratio > b.stall_ratio;
+  });
+  return hints;
+}
+
+std::string OpName4Task(const TaskProto& task) {
+  if (task.exec_sequence().exec_node_size() == 0) { return ""; }
+  const KernelConf& kernel_conf = task.exec_sequence().exec_node(0).kernel_conf();
+  if (kernel_conf.has_op_attribute_ref()) { return kernel_conf.op_attribute_ref(); }
+  return kernel_conf.op_attribute().op_conf().name();
+}
+
+std::string HintKey(const std::string& op_name, int64_t parallel_id,
+                    const std::string& regst_name) {
+  return op_name + "\t" + std::to_string(parallel_id) + "\t" + regst_name;
+}
+
+}  // namespace
+
+bool RegisterNumTuner::Enabled() { return !HintsDir().empty(); }
+
+std::string RegisterNumTuner::HintsText4Job(const std::string& job_name) {
+  if (!Enabled()) { return ""; }
+  std::ifstream ifs(JoinPath(HintsDir(), "register_num_hints_" + job_name));
+  if (!ifs.is_open()) { return ""; }
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+void RegisterNumTuner::Tune(const std::string& job_name, Plan* plan) {
+  const std::vector<RegisterNumHint> hints = ParseHints(HintsText4Job(job_name));
+  if (hints.empty()) { return; }
+  HashMap<std::string, std::pair<TaskProto*, RegstDescProto*>> key2regst;
+  HashSet<int64_t> inplace_regst_desc_ids;
+  for (TaskProto& task : *plan->mutable_task()) {
+    const std::string op_name = OpName4Task(task);
+    const int64_t parallel_id = task.has_parallel_ctx() ? task.parallel_ctx().parallel_id() : -1;
+    for (auto& pair : *task.mutable_produced_regst_desc()) {
+      RegstDescProto* regst_desc = &pair.second;
+      if (regst_desc->has_inplace_consumed_regst_desc_id()) {
+        inplace_regst_desc_ids.insert(regst_desc->regst_desc_id());
+        inplace_regst_desc_ids.insert(regst_desc->inplace_consumed_regst_desc_id());
+      }
+      if (op_name.empty()) { continue; }
+      key2regst.emplace(HintKey(op_name, parallel_id, pair.first),
+                        std::make_pair(&task, regst_desc));
+    }
+  }
+  const int64_t max_extra_mem_bytes =
+      ParseIntegerFromEnv("ONEFLOW_REGISTER_NUM_TUNING_MAX_EXTRA_MEM_MB", 1024) * 1024 * 1024;
+  const bool dry_run = ParseBooleanFromEnv("ONEFLOW_REGISTER_NUM_TUNING_DRY_RUN", false);
+  HashMap<int64_t, int64_t> mem_zone_id2extra_mem_bytes;
+  std::vector<std::pair<RegstDescProto*, int64_t>> regst_desc2register_num;
+  int64_t total_extra_mem_bytes = 0;
+  for (const RegisterNumHint& hint : hints) {
+    const auto it = key2regst.find(HintKey(hint.op_name, hint.parallel_id, hint.regst_name));
+    if (it == key2regst.end()) { continue; }
+    const TaskProto* task = it->second.first;
+    RegstDescProto* regst_desc = it->second.second;
+    // Inplace pairs must keep the same register_num.
+    if (inplace_regst_desc_ids.count(regst_desc->regst_desc_id()) > 0
+        || !regst_desc->regst_desc_type().has_data_regst_desc()) {
+      continue;
+    }
+    const int64_t register_num =
+        std::min<int64_t>(hint.suggested_register_num, regst_desc->max_register_num());
+    if (register_num <= regst_desc->register_num()) { continue; }
+    const int64_t regst_bytes = RtRegstDesc(*regst_desc).MainByteSize4OneRegst();
+    const bool lose_mem_reuse = regst_desc->register_num() == 1 && regst_desc->enable_reuse_mem();
+    const int64_t extra_regst_num =
+        lose_mem_reuse ? register_num : register_num - regst_desc->register_num();
+    const int64_t extra_mem_bytes = extra_regst_num * regst_bytes;
+    const int64_t mem_zone_id =
+        MemoryCaseUtil::GenMemZoneUniqueId(task->machine_id(), regst_desc->mem_case());
+    int64_t* zone_extra_mem_bytes = &mem_zone_id2extra_mem_bytes[mem_zone_id];
+    if (*zone_extra_mem_bytes + extra_mem_bytes > max_extra_mem_bytes) {
+      LOG(INFO) << "skip the register num hint of " << hint.op_name << " " << hint.regst_name
+                << " on parallel " << hint.parallel_id << " for lack of memory";
+      continue;
+    }
+    *zone_extra_mem_bytes += extra_mem_bytes;
+    total_extra_mem_bytes += extra_mem_bytes;
+    LOG(INFO) << "register num of " << hint.op_name << " " << hint.regst_name << " on parallel "
+              << hint.parallel_id << ": " << regst_desc->register_num() << " -> " << register_num
+              << ", stalled its producer " << hint.stall_ratio * 100 << "% of the profiled time, "
+              << "extra memory " << extra_mem_bytes / 1024.0 / 1024.0 << " MB";
+    regst_desc2register_num.emplace_back(regst_desc, register_num);
+  }
+  LOG(INFO) << "register num tuning of job " << job_name << " "
+            << (dry_run ? "would change " : "changes ") << regst_desc2register_num.size()
+            << " registers with " << total_extra_mem_bytes / 1024.0 / 1024.0
+            << " MB extra memory at most";
+  if (dry_run) { return; }
+  for (const auto& pair : regst_desc2register_num) {
+    pair.first->set_min_register_num(pair.second);
+    pair.first->set_register_num(pair.second);
+  }
+}
+
+}  // namespace oneflow
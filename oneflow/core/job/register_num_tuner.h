@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_REGISTER_NUM_TUNER_H_
+#define ONEFLOW_CORE_JOB_REGISTER_NUM_TUNER_H_
+
+#include <string>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// Profile guided register_num. A run with ONEFLOW_ACTOR_ENABLE_RUNTIME_STATS writes the produced
+// registers whose lack of free slots stalls their producer to register_num_hints_<job_name> in
+// the log dir, see actor_runtime_stats.h. If ONEFLOW_REGISTER_NUM_TUNING_HINTS_DIR points at that
+// log dir, the next compilation of the job gives those registers the suggested register_num.
+//
+// The hints are applied by decreasing stall ratio while the extra memory of each memory zone stays
+// within ONEFLOW_REGISTER_NUM_TUNING_MAX_EXTRA_MEM_MB, 1024 by default. A register of more than
+// one slot no longer shares memory with others, so the whole register is counted as extra memory
+// if it did. The stalls and the memory delta are logged before the plan is changed, and nothing is
+// changed with ONEFLOW_REGISTER_NUM_TUNING_DRY_RUN.
+class RegisterNumTuner final {
+ public:
+  static bool Enabled();
+  // The content of the hints of the job, empty if there is none.
+  static std::string HintsText4Job(const std::string& job_name);
+  // Must be called before the memory blocks of the plan are inferred.
+  static void Tune(const std::string& job_name, Plan* plan);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_REGISTER_NUM_TUNER_H_
@@ -0,0 +1,175 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/step_telemetry.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <sstream>
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+
+namespace oneflow {
+
+namespace {
+
+// The means per step of a window, in milliseconds.
+constexpr int kNumMetrics = 4;
+const char* const kMetricNames[kNumMetrics] = {"step", "input wait", "collective", "compute"};
+
+std::string WindowKey(const std::string& job_name, int64_t window, int64_t rank) {
+  return "step_telemetry/" + job_name + "/" + std::to_string(window) + "/" + std::to_string(rank);
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return (values.at((n - 1) / 2) + values.at(n / 2)) / 2;
+}
+
+}  // namespace
+
+bool StepTelemetry::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_PROFILE_STEP_TELEMETRY", false);
+  return enabled;
+}
+
+StepTelemetry* StepTelemetry::Get() {
+  static StepTelemetry telemetry;
+  return &telemetry;
+}
+
+StepTelemetry::StepTelemetry()
+    : interval_(std::max<int64_t>(
+        ParseIntegerFromEnv("ONEFLOW_PROFILE_STEP_TELEMETRY_INTERVAL", 100), 1)),
+      outlier_ratio_(ParseFloatFromEnv("ONEFLOW_PROFILE_STEP_TELEMETRY_OUTLIER_RATIO", 1.2)),
+      collective_ns_(0) {}
+
+std::vector<int64_t> StepTelemetry::FindStragglers(const std::vector<double>& values,
+                                                   double ratio, double min_gap) {
+  std::vector<int64_t> stragglers;
+  if (values.empty()) { return stragglers; }
+  const double median = Median(values);
+  for (int64_t i = 0; i < values.size(); ++i) {
+    if (values.at(i) > median * ratio && values.at(i) - median > min_gap) {
+      stragglers.push_back(i);
+    }
+  }
+  return stragglers;
+}
+
+void StepTelemetry::OnStepLaunch(const std::string& job_name) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_name2record_[job_name].launch_times.emplace_back(now);
+}
+
+void StepTelemetry::OnInputReady(const std::string& job_name) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_name2record_[job_name].input_ready_times.emplace_back(now);
+}
+
+void StepTelemetry::OnCollectiveGroup(double elapsed_ns) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  collective_ns_ += elapsed_ns;
+}
+
+void StepTelemetry::OnStepFinish(const std::string& job_name) {
+  const double now = GetCurTime();
+  std::unique_lock<std::mutex> lock(mutex_);
+  JobRecord* record = &job_name2record_[job_name];
+  if (record->launch_times.empty()) { return; }
+  const double launch_time = record->launch_times.front();
+  record->launch_times.pop_front();
+  // The first step starts at its launch.
+  const double start_time = record->step == 0 ? launch_time : record->last_finish_time;
+  double input_ready_time = start_time;
+  if (!record->input_ready_times.empty()) {
+    input_ready_time = std::max(record->input_ready_times.front(), start_time);
+    record->input_ready_times.pop_front();
+  }
+  record->last_finish_time = now;
+  const double step_ns = now - start_time;
+  const double input_wait_ns = std::min(input_ready_time - start_time, step_ns);
+  // Collectives of all the jobs, which usually do not overlap on a rank.
+  const double collective_ns = std::min(collective_ns_, step_ns - input_wait_ns);
+  collective_ns_ = 0;
+  WindowStats* stats = &record->window_stats;
+  stats->num_steps += 1;
+  stats->step_ns += step_ns;
+  stats->input_wait_ns += input_wait_ns;
+  stats->collective_ns += collective_ns;
+  stats->compute_ns += step_ns - input_wait_ns - collective_ns;
+  const int64_t step = record->step++;
+  if ((step + 1) % interval_ != 0) { return; }
+  const WindowStats window_stats = *stats;
+  *stats = WindowStats();
+  lock.unlock();
+  ReportWindow(job_name, step / interval_, window_stats);
+}
+
+void StepTelemetry::ReportWindow(const std::string& job_name, int64_t window,
+                                 const WindowStats& stats) {
+  const std::array<double, kNumMetrics> means = {
+      stats.step_ns / stats.num_steps / 1e6, stats.input_wait_ns / stats.num_steps / 1e6,
+      stats.collective_ns / stats.num_steps / 1e6, stats.compute_ns / stats.num_steps / 1e6};
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  const int64_t world_size = GlobalProcessCtx::WorldSize();
+  const int64_t rank = GlobalProcessCtx::Rank();
+  if (world_size == 1) {
+    ss << "step telemetry of job " << job_name << " window " << window << ":";
+    for (int i = 0; i < kNumMetrics; ++i) { ss << " " << kMetricNames[i] << " " << means[i]; }
+    LOG(INFO) << ss.str() << " ms";
+    return;
+  }
+  {
+    std::ostringstream value;
+    value << std::setprecision(17);
+    for (double mean : means) { value << mean << " "; }
+    Global<CtrlClient>::Get()->PushKV(WindowKey(job_name, window, rank), value.str());
+  }
+  if (rank != 0 || window == 0) { return; }
+  std::vector<std::vector<double>> metric2values(kNumMetrics, std::vector<double>(world_size));
+  for (int64_t i = 0; i < world_size; ++i) {
+    const std::string key = WindowKey(job_name, window - 1, i);
+    std::string value;
+    Global<CtrlClient>::Get()->PullKV(key, &value);
+    Global<CtrlClient>::Get()->ClearKV(key);
+    std::istringstream iss(value);
+    for (int j = 0; j < kNumMetrics; ++j) { iss >> metric2values.at(j).at(i); }
+  }
+  ss << "step telemetry of job " << job_name << " window " << window - 1 << ", median of "
+     << world_size << " ranks:";
+  for (int i = 0; i < kNumMetrics; ++i) {
+    ss << " " << kMetricNames[i] << " " << Median(metric2values.at(i));
+  }
+  LOG(INFO) << ss.str() << " ms";
+  // Every rank waits in the collectives for the slowest one, so a straggler shows up as the rank
+  // spending longer in its own input wait or compute.
+  const double min_gap = 0.05 * Median(metric2values.at(0));
+  for (int i : {1, 3}) {
+    const std::vector<double>& values = metric2values.at(i);
+    for (int64_t straggler : FindStragglers(values, outlier_ratio_, min_gap)) {
+      LOG(WARNING) << std::fixed << std::setprecision(3) << "rank " << straggler
+                   << " straggles in job " << job_name << " window " << window - 1 << ": "
+                   << kMetricNames[i] << " " << values.at(straggler) << " ms per step, median "
+                   << Median(values) << " ms";
+    }
+  }
+}
+
+}  // namespace oneflow
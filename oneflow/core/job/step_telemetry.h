@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_STEP_TELEMETRY_H_
+#define ONEFLOW_CORE_JOB_STEP_TELEMETRY_H_
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Times each step of the lazy jobs on every rank if ONEFLOW_PROFILE_STEP_TELEMETRY is set, and
+// reports the ranks straggling behind the others. A step spans from the finish of the previous
+// step to its finish and is split into
+//   input wait: until the input critical section of the step begins, i.e. its inputs are ready,
+//   collective: the device time of the collective boxing groups, including waiting for peers,
+//   compute: the rest.
+// Every ONEFLOW_PROFILE_STEP_TELEMETRY_INTERVAL steps each rank pushes its means over the window
+// to the control plane, and rank 0 pulls those of the previous window, which every rank has long
+// pushed, so no rank ever blocks on a slower one.
+class StepTelemetry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StepTelemetry);
+  ~StepTelemetry() = default;
+
+  static bool Enabled();
+  static StepTelemetry* Get();
+
+  // The indices of `values` above `ratio` times their median by more than `min_gap`.
+  static std::vector<int64_t> FindStragglers(const std::vector<double>& values, double ratio,
+                                             double min_gap);
+
+  void OnStepLaunch(const std::string& job_name);
+  void OnInputReady(const std::string& job_name);
+  void OnCollectiveGroup(double elapsed_ns);
+  void OnStepFinish(const std::string& job_name);
+
+ private:
+  StepTelemetry();
+
+  // Sums over the steps of a window.
+  struct WindowStats {
+    int64_t num_steps = 0;
+    double step_ns = 0;
+    double input_wait_ns = 0;
+    double collective_ns = 0;
+    double compute_ns = 0;
+  };
+
+  struct JobRecord {
+    int64_t step = 0;
+    double last_finish_time = 0;
+    std::deque<double> launch_times;
+    std::deque<double> input_ready_times;
+    WindowStats window_stats;
+  };
+
+  void ReportWindow(const std::string& job_name, int64_t window, const WindowStats& stats);
+
+  const int64_t interval_;
+  const double outlier_ratio_;
+  std::mutex mutex_;
+  double collective_ns_;
+  HashMap<std::string, JobRecord> job_name2record_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_STEP_TELEMETRY_H_
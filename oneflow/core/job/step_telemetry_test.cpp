@@ -0,0 +1,38 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/job/step_telemetry.h"
+
+namespace oneflow {
+namespace test {
+
+TEST(StepTelemetry, find_stragglers) {
+  const std::vector<double> compute_ms = {100, 101, 99, 140, 100, 102, 98, 100};
+  ASSERT_EQ(StepTelemetry::FindStragglers(compute_ms, 1.2, 5), std::vector<int64_t>({3}));
+  ASSERT_TRUE(StepTelemetry::FindStragglers(compute_ms, 1.5, 5).empty());
+  ASSERT_TRUE(StepTelemetry::FindStragglers(compute_ms, 1.2, 50).empty());
+}
+
+TEST(StepTelemetry, find_stragglers_of_small_values) {
+  // Input waits close to zero are not worth reporting however uneven they are.
+  const std::vector<double> input_wait_ms = {0.01, 0.02, 0.5, 0.01};
+  ASSERT_TRUE(StepTelemetry::FindStragglers(input_wait_ms, 1.2, 5).empty());
+  ASSERT_EQ(StepTelemetry::FindStragglers(input_wait_ms, 1.2, 0.1), std::vector<int64_t>({2}));
+  ASSERT_TRUE(StepTelemetry::FindStragglers({}, 1.2, 0).empty());
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -0,0 +1,187 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/sbp_infer_util.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+// Offloads large forward activations to host memory while they are idle. Each one is copied to
+// host by an identity op on the cpu placement right after it is produced, and copied back by an
+// identity op on the original placement some ops before its first backward consumer. The copies
+// are CopyHd tasks, which run on the copy streams.
+class ActivationOffloadPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActivationOffloadPass);
+  ActivationOffloadPass() = default;
+  ~ActivationOffloadPass() = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain() && ctx.job_desc().job_conf().enable_activation_offload();
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+};
+
+const std::string kOffloadD2HOpNamePrefix = "System-Activation-Offload-D2H_";
+const std::string kOffloadH2DOpNamePrefix = "System-Activation-Offload-H2D_";
+
+bool IsForwardOrBackwardPass(const OpNode* op_node, const std::string& calculation_pass_name) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_scope_symbol_id()
+      || !Global<symbol::Storage<Scope>>::Get()->Has(op_conf.scope_symbol_id())) {
+    return false;
+  }
+  const Scope& scope = Global<symbol::Storage<Scope>>::Get()->Get(op_conf.scope_symbol_id());
+  return scope.scope_proto().calculation_pass_name() == calculation_pass_name;
+}
+
+double BytesPerDevice(const OpNode* op_node, const LogicalBlobId& lbi) {
+  const BlobDesc& logical_blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+  Shape logical_shape = logical_blob_desc.shape();
+  const double elem_cnt = Storage4NdSbp(op_node->NdSbp4Lbi(lbi), logical_shape,
+                                        *op_node->parallel_desc().hierarchy());
+  return elem_cnt * GetSizeOfDataType(logical_blob_desc.data_type());
+}
+
+Maybe<void> ActivationOffloadPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+  const JobConfigProto& job_conf = GlobalJobDesc().job_conf();
+  const double threshold = job_conf.activation_offload_threshold_mbyte() * 1024.0 * 1024.0;
+  const int64_t prefetch_distance = job_conf.activation_offload_prefetch_distance();
+  CHECK_GE_OR_RETURN(prefetch_distance, 1);
+
+  std::vector<const OpNode*> sorted_nodes;
+  HashMap<const OpNode*, int64_t> node2order;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    CHECK(node2order.emplace(op_node, sorted_nodes.size()).second);
+    sorted_nodes.emplace_back(op_node);
+  });
+
+  HashMap<std::string, OperatorConf> mut_op_name2conf;
+  int64_t offloaded_num = 0;
+  double offloaded_bytes = 0;
+  for (const OpNode* node : sorted_nodes) {
+    if (!IsForwardOrBackwardPass(node, kForwardPass)) { continue; }
+    if (node->parallel_desc().device_type() != DeviceType::kCUDA) { continue; }
+    const OperatorConf& op_conf = node->op().op_conf();
+    if (op_conf.has_variable_conf()) { continue; }
+    const int64_t order = node2order.at(node);
+    for (const std::string& obn : node->op().output_bns()) {
+      const LogicalBlobId& lbi = node->op().BnInOp2Lbi(obn);
+      if (BytesPerDevice(node, lbi) < threshold) { continue; }
+      int64_t last_forward_use = order;
+      int64_t first_backward_use = std::numeric_limits<int64_t>::max();
+      std::vector<const OpEdge*> backward_edges;
+      bool offloadable = true;
+      for (const OpEdge* edge : node->out_edges()) {
+        if (std::find(edge->lbis().begin(), edge->lbis().end(), lbi) == edge->lbis().end()) {
+          continue;
+        }
+        const OpNode* consumer = edge->dst_node();
+        const int64_t consumer_order = node2order.at(consumer);
+        if (IsForwardOrBackwardPass(consumer, kForwardPass)) {
+          last_forward_use = std::max(last_forward_use, consumer_order);
+        } else if (IsForwardOrBackwardPass(consumer, kBackwardPass)
+                   && consumer->parallel_desc() == node->parallel_desc()) {
+          first_backward_use = std::min(first_backward_use, consumer_order);
+          backward_edges.emplace_back(edge);
+        } else {
+          offloadable = false;
+        }
+      }
+      // Only offload the activations idle long enough for both copies to hide behind compute.
+      if (!offloadable || backward_edges.empty()
+          || first_backward_use - last_forward_use <= 2 * prefetch_distance) {
+        continue;
+      }
+      // The prefetch waits for an op of the same placement ahead of the first backward use, which
+      // can not depend on the prefetch since it is before all the consumers in topological order.
+      const OpNode* prefetch_after = nullptr;
+      for (int64_t i = first_backward_use - prefetch_distance; i > last_forward_use; --i) {
+        if (sorted_nodes.at(i)->parallel_desc() == node->parallel_desc()) {
+          prefetch_after = sorted_nodes.at(i);
+          break;
+        }
+      }
+      if (prefetch_after == nullptr) { continue; }
+
+      const std::string lbn = GenLogicalBlobName(lbi);
+      const std::string suffix = lbi.op_name() + "-" + lbi.blob_name();
+      ParallelConf host_parallel_conf = node->parallel_desc().parallel_conf();
+      host_parallel_conf.set_device_tag("cpu");
+      const auto d2h_op = user_op::UserOpConfWrapperBuilder(kOffloadD2HOpNamePrefix + suffix)
+                              .Op("identity")
+                              .Input("in", lbn)
+                              .Output("out")
+                              .ScopeSymbolId(op_conf.scope_symbol_id())
+                              .Build();
+      const OpNode* first_backward_consumer = sorted_nodes.at(first_backward_use);
+      OperatorConf h2d_op_conf =
+          user_op::UserOpConfWrapperBuilder(kOffloadH2DOpNamePrefix + suffix)
+              .Op("identity")
+              .Input("in", d2h_op.output("out", 0))
+              .Output("out")
+              .ScopeSymbolId(first_backward_consumer->op().op_conf().scope_symbol_id())
+              .Build()
+              .op_conf();
+      h2d_op_conf.add_ctrl_in_op_name(prefetch_after->op().op_name());
+      const std::string h2d_out = user_op::UserOpConfWrapper(h2d_op_conf).output("out", 0);
+      JUST(job_builder->AddOp(host_parallel_conf, d2h_op.op_conf()));
+      JUST(job_builder->AddOp(node->parallel_desc().parallel_conf(), h2d_op_conf));
+
+      for (const OpEdge* edge : backward_edges) {
+        const OpNode* consumer = edge->dst_node();
+        const std::string& consumer_name = consumer->op().op_name();
+        auto it = mut_op_name2conf.find(consumer_name);
+        if (it == mut_op_name2conf.end()) {
+          it = mut_op_name2conf.emplace(consumer_name, consumer->op().op_conf()).first;
+        }
+        for (const std::string& ibn : edge->lbi2ibns().at(lbi)) {
+          const std::string old_lbn = ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, h2d_out);
+          CHECK_EQ_OR_RETURN(old_lbn, lbn);
+        }
+      }
+      ++offloaded_num;
+      offloaded_bytes += BytesPerDevice(node, lbi);
+    }
+  }
+  for (const auto& pair : mut_op_name2conf) { JUST(job_builder->MutOpOnlyOnce(pair.second)); }
+  if (offloaded_num > 0) {
+    LOG(INFO) << "activation offload of job " << job_conf.job_name() << ": " << offloaded_num
+              << " blobs, " << offloaded_bytes / 1024 / 1024 << " MB per device";
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("ActivationOffloadPass", ActivationOffloadPass);
+
+}  // namespace oneflow
@@ -63,7 +63,7 @@ std::function<bool(OpNode*)> MakePredicatorIsAllowedToRunWithHalf(const OpGraph&
 }
 
 void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                      JobBuilder* job_builder) {
+                      DataType half_data_type, JobBuilder* job_builder) {
   HashSet<OpEdge*> white_set_edges;
   {
     std::function<const std::unordered_set<OpEdge*>&(OpNode*)> Node2Edges =
@@ -104,7 +104,7 @@ void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>&
     if (blob_desc.data_type() != DataType::kFloat) { continue; }
 
     std::string cast_suffix = f2h ? "-cast_f2h" : "-cast_h2f";
-    DataType cast_data_type = f2h ? DataType::kFloat16 : DataType::kFloat;
+    DataType cast_data_type = f2h ? half_data_type : DataType::kFloat;
     auto cast_op = user_op::UserOpConfWrapperBuilder(ReplaceSlashToDash4Lbn(lbn) + cast_suffix)
                        .Op("cast")
                        .Input("in", lbn)
@@ -154,54 +154,82 @@ void InsertCastOpImpl(bool f2h, const OpGraph& op_graph, const HashSet<OpNode*>&
   job_builder->MutOpsOnlyOnce(dst_op_confs);
 }
 
+// The default lists with the overrides of the job applied.
+struct AMPLists {
+  AMPList white_list;
+  AMPList black_list;
+  AMPList gray_list;
+  AMPList clear_list;
+};
+
+AMPLists MakeAMPLists(const JobConfigProto& job_conf) {
+  AMPLists lists{AutoMixedPrecisionLists::WhiteList(), AutoMixedPrecisionLists::BlackList(),
+                 AutoMixedPrecisionLists::GrayList(), AutoMixedPrecisionLists::ClearList()};
+  const auto MoveTo = [&](const std::string& op_type, AMPList* list) {
+    for (AMPList* l : {&lists.white_list, &lists.black_list, &lists.gray_list, &lists.clear_list}) {
+      l->erase(op_type);
+    }
+    list->insert(op_type);
+  };
+  for (const auto& op_type : job_conf.amp_white_list_override()) {
+    MoveTo(op_type, &lists.white_list);
+  }
+  for (const auto& op_type : job_conf.amp_black_list_override()) {
+    MoveTo(op_type, &lists.black_list);
+  }
+  return lists;
+}
+
 class AutoMixedPrecision final : public JobPass {
  public:
   OF_DISALLOW_COPY_AND_MOVE(AutoMixedPrecision);
-  AutoMixedPrecision()
-      : white_list_(AutoMixedPrecisionLists::WhiteList()),
-        black_list_(AutoMixedPrecisionLists::BlackList()),
-        gray_list_(AutoMixedPrecisionLists::GrayList()),
-        clear_list_(AutoMixedPrecisionLists::ClearList()) {}
+  AutoMixedPrecision() = default;
   ~AutoMixedPrecision() = default;
 
   bool IsEnabled(const JobPassCtx& ctx) const {
     return ctx.job_desc().enable_auto_mixed_precision();
   }
 
-  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+  Maybe<void> Apply(const OpGraph& op_graph, const AMPLists& lists, DataType half_data_type,
+                    JobBuilder* job_builder) const;
 
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
     const OpGraph op_graph(*job);
     JobBuilder job_builder(job);
-    return Apply(op_graph, &job_builder);
+    return Apply(op_graph, MakeAMPLists(ctx->job_desc().job_conf()),
+                 ctx->job_desc().mixed_precision_data_type(), &job_builder);
   }
 
  private:
-  void FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>* black_set) const;
-  void FillWhiteSet(const OpGraph& op_graph, std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
+  void FillBlackSet(const OpGraph& op_graph, const AMPLists& lists,
+                    HashSet<OpNode*>* black_set) const;
+  void FillWhiteSet(const OpGraph& op_graph, const AMPLists& lists,
+                    std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
                     const HashSet<OpNode*>& black_set, HashSet<OpNode*>* white_set) const;
-  void PropagateWhiteThroughClearNodes(const OpGraph& op_graph,
+  void PropagateWhiteThroughClearNodes(const OpGraph& op_graph, const AMPLists& lists,
                                        std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
                                        const HashSet<OpNode*>& black_set,
                                        HashSet<OpNode*>* white_set) const;
   void InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                    JobBuilder* job_builder) const;
-
-  const AMPList& white_list_;
-  const AMPList& black_list_;
-  const AMPList& gray_list_;
-  const AMPList& clear_list_;
+                    DataType half_data_type, JobBuilder* job_builder) const;
 };
 
-Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, const AMPLists& lists,
+                                      DataType half_data_type, JobBuilder* job_builder) const {
   CHECK_GE(CUDA_VERSION, 10000);
   CHECK(GlobalJobDesc().DefaultDataType() == DataType::kFloat);
+  if (half_data_type == DataType::kBFloat16) {
+    CHECK_GE_OR_RETURN(CUDA_VERSION, 11000) << "bfloat16 mixed precision needs CUDA 11 or later";
+  } else {
+    CHECK_EQ_OR_RETURN(half_data_type, DataType::kFloat16)
+        << "mixed precision only supports float16 and bfloat16";
+  }
 
-  VerifyAMPList(white_list_);
-  VerifyAMPList(black_list_);
-  VerifyAMPList(gray_list_);
-  VerifyAMPList(clear_list_);
+  VerifyAMPList(lists.white_list);
+  VerifyAMPList(lists.black_list);
+  VerifyAMPList(lists.gray_list);
+  VerifyAMPList(lists.clear_list);
 
   std::function<std::string(OpNode* const&)> OpName4Node = [](OpNode* const& node) {
     return node->op().op_name();
@@ -209,30 +237,31 @@ Maybe<void> AutoMixedPrecision::Apply(const OpGraph& op_graph, JobBuilder* job_b
   HashSet<OpNode*> black_set;
   HashSet<OpNode*> white_set;
 
-  FillBlackSet(op_graph, &black_set);
+  FillBlackSet(op_graph, lists, &black_set);
   VLOG(3) << "BlackSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(black_set, OpName4Node);
 
   auto IsAllowedToRunWithHalf = MakePredicatorIsAllowedToRunWithHalf(op_graph);
-  FillWhiteSet(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
+  FillWhiteSet(op_graph, lists, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(3) << "WhiteSet Before Propagate include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
-  PropagateWhiteThroughClearNodes(op_graph, IsAllowedToRunWithHalf, black_set, &white_set);
+  PropagateWhiteThroughClearNodes(op_graph, lists, IsAllowedToRunWithHalf, black_set, &white_set);
   VLOG(2) << "WhiteSet include: "
           << Container2Str<HashSet<OpNode*>, OpNode*>(white_set, OpName4Node);
 
-  InsertCastOp(op_graph, white_set, job_builder);
+  InsertCastOp(op_graph, white_set, half_data_type, job_builder);
   return Maybe<void>::Ok();
 }
 
-void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>* black_set) const {
+void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, const AMPLists& lists,
+                                      HashSet<OpNode*>* black_set) const {
   HashSet<OpNode*> upstream_or_part_of_black_and_gray;
   DfsTopoGraphTraversal(
       op_graph, true,
       [&](OpNode* node) {
-        return IsNodeInList(black_list_, node) || IsNodeInList(gray_list_, node);
+        return IsNodeInList(lists.black_list, node) || IsNodeInList(lists.gray_list, node);
       },
-      [&](OpNode* node) { return IsNodeInList(clear_list_, node); },
+      [&](OpNode* node) { return IsNodeInList(lists.clear_list, node); },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_black_and_gray, node); },
       [&](OpNode* node) {
         INSERT_CHECK(upstream_or_part_of_black_and_gray.insert(node));
@@ -242,7 +271,7 @@ void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>*
 
   // propagate black through upstream_or_part_of_black_and_gray
   DfsTopoGraphTraversal(
-      op_graph, false, [&](OpNode* node) { return IsNodeInList(black_list_, node); },
+      op_graph, false, [&](OpNode* node) { return IsNodeInList(lists.black_list, node); },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_black_and_gray, node); },
       [&](OpNode* node) { return IsKeyFound(*black_set, node); },
       [&](OpNode* node) {
@@ -251,19 +280,19 @@ void AutoMixedPrecision::FillBlackSet(const OpGraph& op_graph, HashSet<OpNode*>*
       });
 }
 
-void AutoMixedPrecision::FillWhiteSet(const OpGraph& op_graph,
+void AutoMixedPrecision::FillWhiteSet(const OpGraph& op_graph, const AMPLists& lists,
                                       std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
                                       const HashSet<OpNode*>& black_set,
                                       HashSet<OpNode*>* white_set) const {
   HashSet<OpNode*> upstream_or_part_of_white;
   auto IsWhiteAndAllowedToRunHalf = [&](OpNode* node) {
-    return IsAllowedToRunWithHalf(node) && IsNodeInList(white_list_, node);
+    return IsAllowedToRunWithHalf(node) && IsNodeInList(lists.white_list, node);
   };
   DfsTopoGraphTraversal(
       op_graph, true, IsWhiteAndAllowedToRunHalf,
       [&](OpNode* node) {
         return !IsKeyFound(black_set, node) && IsAllowedToRunWithHalf(node)
-               && (IsNodeInList(gray_list_, node) || IsNodeInList(clear_list_, node));
+               && (IsNodeInList(lists.gray_list, node) || IsNodeInList(lists.clear_list, node));
       },
       [&](OpNode* node) { return IsKeyFound(upstream_or_part_of_white, node); },
       [&](OpNode* node) {
@@ -283,14 +312,15 @@ void AutoMixedPrecision::FillWhiteSet(const OpGraph& op_graph,
 }
 
 void AutoMixedPrecision::PropagateWhiteThroughClearNodes(
-    const OpGraph& op_graph, std::function<bool(OpNode*)> IsAllowedToRunWithHalf,
-    const HashSet<OpNode*>& black_set, HashSet<OpNode*>* white_set) const {
+    const OpGraph& op_graph, const AMPLists& lists,
+    std::function<bool(OpNode*)> IsAllowedToRunWithHalf, const HashSet<OpNode*>& black_set,
+    HashSet<OpNode*>* white_set) const {
   auto PropagateIntoOneDirection = [&](bool is_downward) {
     DfsTopoGraphTraversal(
         op_graph, !is_downward, [&](OpNode* node) { return false; },
         [&](OpNode* node) {
           return !IsKeyFound(*white_set, node) && !IsKeyFound(black_set, node)
-                 && IsNodeInList(clear_list_, node) && IsAllowedToRunWithHalf(node);
+                 && IsNodeInList(lists.clear_list, node) && IsAllowedToRunWithHalf(node);
         },
         [&](OpNode* node) { return IsKeyFound(*white_set, node); },
         [&](OpNode* node) {
@@ -304,9 +334,9 @@ void AutoMixedPrecision::PropagateWhiteThroughClearNodes(
 }
 
 void AutoMixedPrecision::InsertCastOp(const OpGraph& op_graph, const HashSet<OpNode*>& white_set,
-                                      JobBuilder* job_builder) const {
-  InsertCastOpImpl(true, op_graph, white_set, job_builder);
-  InsertCastOpImpl(false, op_graph, white_set, job_builder);
+                                      DataType half_data_type, JobBuilder* job_builder) const {
+  InsertCastOpImpl(true, op_graph, white_set, half_data_type, job_builder);
+  InsertCastOpImpl(false, op_graph, white_set, half_data_type, job_builder);
 }
 
 REGISTER_JOB_PASS("AutoMixedPrecision", AutoMixedPrecision);
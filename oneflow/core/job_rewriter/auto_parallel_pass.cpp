@@ -0,0 +1,223 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/sbp_infer_util.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/core/auto_parallel/sbp_searcher.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace {
+
+// Whether the sbp signature of the op could be chosen by the search. Source ops, system ops, ops
+// inferring their signatures by custom functions and mirrored ops keep the inferred ones.
+bool IsSbpSearchable(const OpNode* op_node, const Job& job) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (op_node->op().input_bns().empty()) { return false; }
+  if (op_node->parallel_desc().parallel_num() <= 1) { return false; }
+  const auto& op_name2is_mirrored =
+      job.job_parallel_view_conf().op_name2is_mirrored_parallel_view();
+  const auto& mirrored_it = op_name2is_mirrored.find(op_conf.name());
+  if (mirrored_it != op_name2is_mirrored.end() && mirrored_it->second) { return false; }
+  const user_op::OpRegistryResult* val =
+      user_op::UserOpRegistryMgr::Get().GetOpRegistryResult(op_conf.user_conf().op_type_name());
+  if (val == nullptr || val->nd_sbp_infer_fn || val->sbp_signature_infer_fn) { return false; }
+  return true;
+}
+
+// The first candidate is always the signature inferred greedily.
+Maybe<void> GetCandidateNdSbpSignatures(const OpNode* op_node, const Job& job,
+                                        std::vector<NdSbpSignature>* candidates) {
+  const NdSbpSignature& inferred = op_node->nd_sbp_signature();
+  candidates->emplace_back(inferred);
+  if (!IsSbpSearchable(op_node, job)) { return Maybe<void>::Ok(); }
+  const auto LogicalBlobDesc4Ibn = [&](const std::string& ibn) -> Maybe<const BlobDesc&> {
+    return op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(ibn));
+  };
+  std::vector<NdSbpSignature> nd_sbp_sig_list;
+  JUST(op_node->op().GetValidNdSbpSignatureList(LogicalBlobDesc4Ibn, op_node->parallel_desc(),
+                                                &nd_sbp_sig_list));
+  for (auto& nd_sbp_sig : nd_sbp_sig_list) {
+    // Blobs added by the system, such as the tick input, keep their inferred sbp.
+    auto* bn2nd_sbp = nd_sbp_sig.mutable_bn_in_op2nd_sbp();
+    for (const auto& pair : inferred.bn_in_op2nd_sbp()) {
+      if (bn2nd_sbp->find(pair.first) == bn2nd_sbp->end()) {
+        (*bn2nd_sbp)[pair.first] = pair.second;
+      }
+    }
+    if (nd_sbp_sig != inferred) { candidates->emplace_back(std::move(nd_sbp_sig)); }
+  }
+  return Maybe<void>::Ok();
+}
+
+double BytesPerDevice(const NdSbp& nd_sbp, const BlobDesc& logical_blob_desc,
+                      const ParallelDesc& parallel_desc) {
+  Shape logical_shape = logical_blob_desc.shape();
+  const double elem_cnt = Storage4NdSbp(nd_sbp, logical_shape, *parallel_desc.hierarchy());
+  if (elem_cnt > GetValidMaxCopyCost()) { return GetValidMaxCopyCost(); }
+  return elem_cnt * GetSizeOfDataType(logical_blob_desc.data_type());
+}
+
+// The computation is taken proportional to the bytes each device reads and writes, so that
+// broadcast blobs, which are computed redundantly, cost more; the memory is the bytes of outputs.
+void ComputeNodeCosts(const OpNode* op_node, const std::vector<NdSbpSignature>& candidates,
+                      double computation_cost_ratio, std::vector<double>* compute_costs,
+                      std::vector<double>* memory_costs) {
+  const Operator& op = op_node->op();
+  for (const auto& candidate : candidates) {
+    const auto& bn2nd_sbp = candidate.bn_in_op2nd_sbp();
+    double input_bytes = 0;
+    for (const auto& ibn : op.input_bns()) {
+      const auto& blob_desc = op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(ibn));
+      input_bytes += BytesPerDevice(bn2nd_sbp.at(ibn), blob_desc, op_node->parallel_desc());
+    }
+    double output_bytes = 0;
+    for (const auto& obn : op.output_bns()) {
+      const auto& blob_desc = op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(obn));
+      output_bytes += BytesPerDevice(bn2nd_sbp.at(obn), blob_desc, op_node->parallel_desc());
+    }
+    compute_costs->emplace_back(computation_cost_ratio * (input_bytes + output_bytes));
+    memory_costs->emplace_back(output_bytes);
+  }
+}
+
+// Returns the index of nd_sbp in unique_nd_sbps, appending it if absent.
+int32_t UniqueNdSbpIndex(const NdSbp& nd_sbp, std::vector<NdSbp>* unique_nd_sbps) {
+  const auto& it = std::find(unique_nd_sbps->begin(), unique_nd_sbps->end(), nd_sbp);
+  if (it != unique_nd_sbps->end()) { return it - unique_nd_sbps->begin(); }
+  unique_nd_sbps->emplace_back(nd_sbp);
+  return unique_nd_sbps->size() - 1;
+}
+
+Maybe<void> ComputeEdgeCopyCosts(const OpEdge* op_edge,
+                                 const std::vector<NdSbpSignature>& src_candidates,
+                                 const std::vector<NdSbpSignature>& dst_candidates,
+                                 std::vector<std::vector<double>>* copy_costs) {
+  const OpNode* src_node = op_edge->src_node();
+  const OpNode* dst_node = op_edge->dst_node();
+  copy_costs->assign(src_candidates.size(), std::vector<double>(dst_candidates.size(), 0));
+  for (const LogicalBlobId& lbi : op_edge->lbis()) {
+    const std::string& obn = op_edge->lbi2obn().at(lbi);
+    const BlobDesc& logical_blob_desc = src_node->LogicalBlobDesc4Lbi(lbi);
+    for (const std::string& ibn : op_edge->lbi2ibns().at(lbi)) {
+      const auto& blob_modifier = dst_node->op().InputBlobModifier4Ibn(ibn);
+      const bool requires_same_sbp = (blob_modifier.has_is_mutable() && blob_modifier.is_mutable())
+                                     || NotSupportBoxingDataType(logical_blob_desc.data_type());
+      // Candidates share a few distinct sbp for each blob, compute the cost once per pair.
+      std::vector<NdSbp> src_nd_sbps;
+      std::vector<int32_t> src_index(src_candidates.size());
+      for (int32_t p = 0; p < src_candidates.size(); ++p) {
+        src_index[p] = UniqueNdSbpIndex(src_candidates[p].bn_in_op2nd_sbp().at(obn), &src_nd_sbps);
+      }
+      std::vector<NdSbp> dst_nd_sbps;
+      std::vector<int32_t> dst_index(dst_candidates.size());
+      for (int32_t c = 0; c < dst_candidates.size(); ++c) {
+        dst_index[c] = UniqueNdSbpIndex(dst_candidates[c].bn_in_op2nd_sbp().at(ibn), &dst_nd_sbps);
+      }
+      std::vector<std::vector<double>> pair_costs(src_nd_sbps.size(),
+                                                  std::vector<double>(dst_nd_sbps.size()));
+      for (int32_t i = 0; i < src_nd_sbps.size(); ++i) {
+        for (int32_t j = 0; j < dst_nd_sbps.size(); ++j) {
+          pair_costs[i][j] = JUST(ComputeLazyCopyCostBetweenNdSbp(
+              src_nd_sbps[i], dst_nd_sbps[j], logical_blob_desc, src_node->parallel_desc(),
+              dst_node->parallel_desc(), requires_same_sbp));
+        }
+      }
+      for (int32_t p = 0; p < src_candidates.size(); ++p) {
+        for (int32_t c = 0; c < dst_candidates.size(); ++c) {
+          (*copy_costs)[p][c] += pair_costs[src_index[p]][dst_index[c]];
+        }
+      }
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+class AutoParallelPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AutoParallelPass);
+  AutoParallelPass() = default;
+  ~AutoParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const { return ctx.job_desc().enable_auto_parallel(); }
+  Maybe<void> Apply(const OpGraph& op_graph, Job* job) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    return Apply(op_graph, job);
+  }
+};
+
+Maybe<void> AutoParallelPass::Apply(const OpGraph& op_graph, Job* job) const {
+  const JobConfigProto& job_conf = job->job_conf();
+  std::vector<const OpNode*> op_nodes;
+  HashMap<const OpNode*, int32_t> op_node2id;
+  std::vector<std::vector<NdSbpSignature>> candidates;
+  SbpSearcher searcher;
+  JUST(op_graph.TopoForEachNodeWithErrorCaptured([&](const OpNode* op_node) -> Maybe<void> {
+    std::vector<NdSbpSignature> node_candidates;
+    JUST(GetCandidateNdSbpSignatures(op_node, *job, &node_candidates));
+    std::vector<double> compute_costs;
+    std::vector<double> memory_costs;
+    ComputeNodeCosts(op_node, node_candidates, job_conf.auto_parallel_computation_cost_ratio(),
+                     &compute_costs, &memory_costs);
+    const int32_t node_id = searcher.AddNode(std::move(compute_costs), std::move(memory_costs));
+    for (const OpEdge* op_edge : op_node->in_edges()) {
+      const int32_t src_id = op_node2id.at(op_edge->src_node());
+      std::vector<std::vector<double>> copy_costs;
+      JUST(ComputeEdgeCopyCosts(op_edge, candidates.at(src_id), node_candidates, &copy_costs));
+      JUST(searcher.AddEdge(src_id, node_id, std::move(copy_costs)));
+    }
+    op_nodes.emplace_back(op_node);
+    op_node2id.emplace(op_node, node_id);
+    candidates.emplace_back(std::move(node_candidates));
+    return Maybe<void>::Ok();
+  }));
+
+  const double memory_budget = job_conf.auto_parallel_memory_budget_mbyte() * 1024.0 * 1024.0;
+  std::vector<int32_t> choices;
+  JUST(searcher.Search(memory_budget, &choices));
+  const std::vector<int32_t> inferred_choices(op_nodes.size(), 0);
+  LOG(INFO) << "auto parallel of job " << job_conf.job_name() << ": cost "
+            << searcher.ComputeAndCopyCost(inferred_choices) << " -> "
+            << searcher.ComputeAndCopyCost(choices) << ", memory "
+            << searcher.MemoryCost(inferred_choices) << " -> " << searcher.MemoryCost(choices);
+
+  auto* job_parallel_view_conf = job->mutable_job_parallel_view_conf();
+  for (int32_t i = 0; i < op_nodes.size(); ++i) {
+    if (choices.at(i) == 0) { continue; }
+    const std::string& op_name = op_nodes.at(i)->op().op_name();
+    const NdSbpSignature& nd_sbp_signature = candidates.at(i).at(choices.at(i));
+    (*job_parallel_view_conf->mutable_op_name2nd_sbp_signature_conf())[op_name] = nd_sbp_signature;
+    if (op_nodes.at(i)->parallel_desc().hierarchy()->NumAxes() == 1) {
+      SbpSignature sbp_signature;
+      NdSbpSignatureToSbpSignature(nd_sbp_signature, &sbp_signature);
+      (*job_parallel_view_conf->mutable_op_name2sbp_signature_conf())[op_name] = sbp_signature;
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_JOB_PASS("AutoParallelPass", AutoParallelPass);
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,313 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/user/ops/fused_elementwise_chain_util.h"
+#include "oneflow/user/ops/math_binary_broadcast_seq.h"
+#include "oneflow/user/ops/math_unary_elementwise_seq.h"
+
+namespace oneflow {
+
+namespace {
+
+// Converts the connected regions of 4-D convs, pools, batch norms and elementwise ops on GPUs from
+// NCHW to NHWC, in which the tensor cores run the convs without cudnn transposing their inputs and
+// outputs. The blobs entering a region and those leaving it are transposed, so a region is only
+// converted when the transposes of its convs cudnn saves outweigh the ones inserted.
+class ChannelsLastPass final : public JobPass {
+ public:
+  ChannelsLastPass() = default;
+  ~ChannelsLastPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_channels_last();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+constexpr int64_t kNumAxes = 4;
+// Tensor cores take channels in multiples of 8 halfs.
+constexpr int64_t kTensorCoreChannelAlignment = 8;
+
+// Ops of which each output element only depends on the input elements at the same position, so
+// they run the same in any layout.
+bool IsElementwiseOpTypeName(const std::string& op_type_name) {
+#define MAKE_OP_TYPE_NAME(op_type_name, ...) op_type_name,
+  static const HashSet<std::string> op_type_names{
+      OF_PP_FOR_EACH_TUPLE(MAKE_OP_TYPE_NAME, MATH_UNARY_ELEMENTWISE_FUNC_SEQ)
+      OF_PP_FOR_EACH_TUPLE(MAKE_OP_TYPE_NAME, MATH_BINARY_BROADCAST_FUNC_SEQ)
+      OF_PP_FOR_EACH_TUPLE(MAKE_OP_TYPE_NAME, FUSED_ELEMENTWISE_CHAIN_OP_SEQ)
+      "fused_elementwise_chain", "gelu", "tanh", "sigmoid_v2", "scalar_pow", "cast", "identity",
+      "amp_white_identity", "dropout", "add_n"};
+#undef MAKE_OP_TYPE_NAME
+  return op_type_names.count(op_type_name) > 0;
+}
+
+const BlobDesc& BlobDesc4Bn(const OpNode* op_node, const std::string& bn) {
+  return op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(bn));
+}
+
+bool IsLbiConsumed(const OpNode* op_node, const LogicalBlobId& lbi) {
+  for (const OpEdge* edge : op_node->out_edges()) {
+    for (const LogicalBlobId& edge_lbi : edge->lbis()) {
+      if (edge_lbi == lbi) { return true; }
+    }
+  }
+  return false;
+}
+
+// The ops having a channels last variant, and the elementwise ops of 4-D blobs.
+bool IsChannelsLastConvertible(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (op_node->parallel_desc().device_type() != DeviceType::kCUDA) { return false; }
+  const user_op::UserOpConfWrapper user_op_conf(op_conf);
+  const std::string& op_type_name = user_op_conf.op_type_name();
+  if (op_type_name == "conv2d" || op_type_name == "maxpool_2d" || op_type_name == "tf_max_pool_2d"
+      || op_type_name == "tf_avg_pool_2d") {
+    if (user_op_conf.attr<std::string>("data_format") != "channels_first") { return false; }
+    // The indices of max pooling are positions in the layout of its input.
+    if (op_type_name == "maxpool_2d"
+        && IsLbiConsumed(op_node, op_node->op().BnInOp2Lbi(GenRepeatedBn("indice", 0)))) {
+      return false;
+    }
+  } else if (op_type_name == "normalization" || op_type_name == "normalization_add_relu"
+             || op_type_name == "bias_add") {
+    if (user_op_conf.attr<int32_t>("axis") != 1) { return false; }
+  } else if (IsElementwiseOpTypeName(op_type_name)) {
+    for (const std::string& bn : op_node->op().input_bns()) {
+      if (BlobDesc4Bn(op_node, bn).shape().NumAxes() != kNumAxes) { return false; }
+    }
+  } else {
+    return false;
+  }
+  // The 4-D blobs of the op, activations and the OIHW weights of conv, take the same permutation.
+  for (const std::string& obn : op_node->op().output_bns()) {
+    if (BlobDesc4Bn(op_node, obn).shape().NumAxes() != kNumAxes
+        && !(op_type_name == "normalization" || op_type_name == "normalization_add_relu")) {
+      return false;
+    }
+  }
+  const std::string& in_bn = op_node->op().input_bns().Get(0);
+  return BlobDesc4Bn(op_node, in_bn).shape().NumAxes() == kNumAxes;
+}
+
+int64_t BlobBytes(const BlobDesc& blob_desc) {
+  return blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+}
+
+// cudnn runs a half conv in NCHW by transposing its input and output to NHWC around an NHWC kernel,
+// which the conv saves in channels last. Those of other data types or channel counts do not run
+// on tensor cores and save nothing.
+int64_t SavedTransposeBytes(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (op_conf.user_conf().op_type_name() != "conv2d") { return 0; }
+  const user_op::UserOpConfWrapper conv(op_conf);
+  const BlobDesc& in = BlobDesc4Bn(op_node, GenRepeatedBn("in", 0));
+  const BlobDesc& out = BlobDesc4Bn(op_node, GenRepeatedBn("out", 0));
+  if (in.data_type() != DataType::kFloat16 && in.data_type() != DataType::kBFloat16) { return 0; }
+  const int64_t groups = conv.attr<int32_t>("groups");
+  if ((in.shape().At(1) / groups) % kTensorCoreChannelAlignment != 0
+      || (out.shape().At(1) / groups) % kTensorCoreChannelAlignment != 0) {
+    return 0;
+  }
+  // A transpose reads and writes the blob.
+  return 2 * (BlobBytes(in) + BlobBytes(out));
+}
+
+OperatorConf ToChannelsLast(const OpNode* op_node) {
+  OperatorConf op_conf = op_node->op().op_conf();
+  auto* attr = op_conf.mutable_user_conf()->mutable_attr();
+  if (attr->count("data_format") > 0) {
+    (*attr)["data_format"].set_at_string("channels_last");
+  } else if (attr->count("axis") > 0) {
+    (*attr)["axis"].set_at_int32(kNumAxes - 1);
+  }
+  return op_conf;
+}
+
+OperatorConf GenTransposeOpConf(const std::string& op_name, const std::string& in_lbn,
+                                const std::vector<int32_t>& perm, int64_t scope_symbol_id) {
+  return user_op::UserOpConfWrapperBuilder(op_name)
+      .Op("transpose")
+      .Input("input", in_lbn)
+      .Output("output")
+      .Attr<std::vector<int32_t>>("perm", perm)
+      .ScopeSymbolId(scope_symbol_id)
+      .Build()
+      .op_conf();
+}
+
+struct ChannelsLastRegion {
+  std::vector<const OpNode*> op_nodes;
+  int64_t saved_bytes = 0;
+  // The 4-D blobs transposed on their way into and out of the region.
+  HashSet<LogicalBlobId> in_lbis;
+  HashSet<LogicalBlobId> out_lbis;
+  int64_t transpose_bytes = 0;
+};
+
+// Regions are the connected components of the convertible ops on the same placement.
+std::vector<ChannelsLastRegion> FindRegions(const OpGraph& op_graph) {
+  std::vector<const OpNode*> op_nodes;
+  HashMap<const OpNode*, int64_t> op_node2index;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (!IsChannelsLastConvertible(op_node)) { return; }
+    op_node2index.emplace(op_node, op_nodes.size());
+    op_nodes.emplace_back(op_node);
+  });
+  std::vector<int64_t> parents(op_nodes.size());
+  std::iota(parents.begin(), parents.end(), 0);
+  const std::function<int64_t(int64_t)> Find = [&](int64_t i) -> int64_t {
+    if (parents.at(i) != i) { parents.at(i) = Find(parents.at(i)); }
+    return parents.at(i);
+  };
+  for (const OpNode* op_node : op_nodes) {
+    for (const OpEdge* edge : op_node->in_edges()) {
+      auto it = op_node2index.find(edge->src_node());
+      if (it == op_node2index.end()) { continue; }
+      if (edge->src_node()->parallel_desc() != op_node->parallel_desc()) { continue; }
+      parents.at(Find(it->second)) = Find(op_node2index.at(op_node));
+    }
+  }
+  HashMap<int64_t, int64_t> root2region;
+  std::vector<ChannelsLastRegion> regions;
+  for (int64_t i = 0; i < op_nodes.size(); ++i) {
+    auto it = root2region.emplace(Find(i), regions.size()).first;
+    if (it->second == regions.size()) { regions.emplace_back(); }
+    regions.at(it->second).op_nodes.emplace_back(op_nodes.at(i));
+  }
+  for (ChannelsLastRegion& region : regions) {
+    const HashSet<const OpNode*> region_op_nodes(region.op_nodes.begin(), region.op_nodes.end());
+    for (const OpNode* op_node : region.op_nodes) {
+      region.saved_bytes += SavedTransposeBytes(op_node);
+      for (const std::string& ibn : op_node->op().input_bns()) {
+        const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(ibn);
+        if (region_op_nodes.count(&op_node->SrcNode4Ibn(ibn)) > 0) { continue; }
+        const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+        if (blob_desc.shape().NumAxes() != kNumAxes) { continue; }
+        if (region.in_lbis.insert(lbi).second) {
+          region.transpose_bytes += 2 * BlobBytes(blob_desc);
+        }
+      }
+      for (const OpEdge* edge : op_node->out_edges()) {
+        if (region_op_nodes.count(edge->dst_node()) > 0) { continue; }
+        for (const LogicalBlobId& lbi : edge->lbis()) {
+          const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+          if (blob_desc.shape().NumAxes() != kNumAxes) { continue; }
+          if (region.out_lbis.insert(lbi).second) {
+            region.transpose_bytes += 2 * BlobBytes(blob_desc);
+          }
+        }
+      }
+    }
+  }
+  return regions;
+}
+
+Maybe<void> ChannelsLastPass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  const OpGraph op_graph(*job);
+  HashMap<const OpNode*, const ChannelsLastRegion*> op_node2region;
+  const std::vector<ChannelsLastRegion> regions = FindRegions(op_graph);
+  for (const ChannelsLastRegion& region : regions) {
+    const bool convert = region.saved_bytes > region.transpose_bytes;
+    VLOG(1) << (convert ? "converts" : "keeps") << " the region of " << region.op_nodes.size()
+            << " ops from " << region.op_nodes.front()->op().op_name() << " to channels last, "
+            << "saving " << region.saved_bytes << " bytes of cudnn transposes for "
+            << region.transpose_bytes << " bytes of inserted ones";
+    if (!convert) { continue; }
+    for (const OpNode* op_node : region.op_nodes) { op_node2region.emplace(op_node, &region); }
+  }
+  if (op_node2region.empty()) { return Maybe<void>::Ok(); }
+
+  JobBuilder job_builder(job);
+  HashMap<std::string, OperatorConf> op_name2op_conf;
+  const auto MutOpConf4OpNode = [&](const OpNode* op_node) -> OperatorConf* {
+    const std::string& op_name = op_node->op().op_name();
+    auto it = op_name2op_conf.find(op_name);
+    if (it == op_name2op_conf.end()) {
+      it = op_name2op_conf.emplace(op_name, op_node->op().op_conf()).first;
+    }
+    return &it->second;
+  };
+  for (const auto& pair : op_node2region) {
+    op_name2op_conf[pair.first->op().op_name()] = ToChannelsLast(pair.first);
+  }
+  for (const ChannelsLastRegion& region : regions) {
+    if (op_node2region.count(region.op_nodes.front()) == 0) { continue; }
+    const ParallelConf& parallel_conf = region.op_nodes.front()->parallel_desc().parallel_conf();
+    // Blobs produced in channels last by another region are taken as they are.
+    for (const LogicalBlobId& lbi : region.in_lbis) {
+      if (op_node2region.count(op_graph.OpNode4OpName(lbi.op_name())) > 0) { continue; }
+      std::string transpose_lbn;
+      for (const OpNode* op_node : region.op_nodes) {
+        for (const std::string& ibn : op_node->op().input_bns()) {
+          if (op_node->op().BnInOp2Lbi(ibn) != lbi) { continue; }
+          if (transpose_lbn.empty()) {
+            const OperatorConf transpose_op_conf = GenTransposeOpConf(
+                lbi.op_name() + "-" + lbi.blob_name() + "-to_channels_last",
+                GenLogicalBlobName(lbi), {0, 2, 3, 1}, op_node->op().op_conf().scope_symbol_id());
+            job_builder.AddOps(parallel_conf, {transpose_op_conf});
+            transpose_lbn = GenLogicalBlobName(transpose_op_conf.name(), "output_0");
+          }
+          ReplaceInputLbnInOpCustomizedConf(MutOpConf4OpNode(op_node), ibn, transpose_lbn);
+        }
+      }
+    }
+    for (const LogicalBlobId& lbi : region.out_lbis) {
+      const OpNode* producer = op_graph.OpNode4OpName(lbi.op_name());
+      std::string transpose_lbn;
+      for (const OpEdge* edge : producer->out_edges()) {
+        const OpNode* consumer = edge->dst_node();
+        if (op_node2region.count(consumer) > 0) { continue; }
+        for (const std::string& ibn : consumer->op().input_bns()) {
+          if (consumer->op().BnInOp2Lbi(ibn) != lbi) { continue; }
+          if (transpose_lbn.empty()) {
+            const OperatorConf transpose_op_conf = GenTransposeOpConf(
+                lbi.op_name() + "-" + lbi.blob_name() + "-to_channels_first",
+                GenLogicalBlobName(lbi), {0, 3, 1, 2}, producer->op().op_conf().scope_symbol_id());
+            job_builder.AddOps(parallel_conf, {transpose_op_conf});
+            transpose_lbn = GenLogicalBlobName(transpose_op_conf.name(), "output_0");
+          }
+          ReplaceInputLbnInOpCustomizedConf(MutOpConf4OpNode(consumer), ibn, transpose_lbn);
+        }
+      }
+    }
+  }
+  // The sbp signatures searched for the channels first ops do not hold any more.
+  auto* job_parallel_view_conf = job_builder.mutable_job_parallel_view_conf();
+  for (const auto& pair : op_node2region) {
+    const std::string& op_name = pair.first->op().op_name();
+    job_parallel_view_conf->mutable_op_name2sbp_signature_conf()->erase(op_name);
+    job_parallel_view_conf->mutable_op_name2nd_sbp_signature_conf()->erase(op_name);
+  }
+  std::vector<OperatorConf> mut_op_confs;
+  mut_op_confs.reserve(op_name2op_conf.size());
+  for (const auto& pair : op_name2op_conf) { mut_op_confs.emplace_back(pair.second); }
+  job_builder.MutOpsOnlyOnce(mut_op_confs);
+  VLOG(1) << "converted " << op_node2region.size() << " ops to channels last in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("ChannelsLastPass", ChannelsLastPass);
+
+}  // namespace oneflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/calculation_pass.h"
 #include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/sbp_infer_util.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 
@@ -38,12 +39,16 @@ class CheckpointingPass final : public JobPass {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
     const OpGraph op_graph(*job);
     JobBuilder job_builder(job);
-    return Apply(op_graph, &job_builder);
+    return Apply(op_graph, &job_builder,
+                 job->job_conf().auto_checkpointing_memory_budget_mbyte() * 1024.0 * 1024.0);
   }
 
   bool IsEnabled(const JobPassCtx& ctx) const { return ctx.job_desc().IsTrain(); }
 
-  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+  // Ops are recomputed automatically for a positive memory budget, besides the ones marked by
+  // checkpointing scopes.
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder,
+                    double auto_memory_budget) const;
 };
 
 const std::string kCheckpointingFakeOpNamePrefix = "OneFlow-System-Checkpointing-Fake-Fw-Op_";
@@ -65,28 +70,291 @@ bool IsForwardPass7CheckpointingScope(const Scope& scope) {
   return IsForwardPassScope(scope) && scope.Bool("checkpointing");
 }
 
-void CollectAllCheckpointingOpsInForwardPass(
-    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+bool IsIgnoredOp4Checkpointing(const OperatorConf& op_conf) {
   // NOTE(chengcheng):
   //   ignore batch_norm ops because of recompute bn will repeat the calculation of 'm' and 'v'.
   //   in the future, we need to support the recomputation version of batch_norm which do NOT
   //   update forward variables.
-  HashSet<std::string> ignore_op_type_names = {"normalization", "normalization_add_relu",
-                                               "cudnn_fused_normalization_add_relu", "repeat",
-                                               "unpack"};
+  static const HashSet<std::string> ignore_op_type_names = {
+      "normalization", "normalization_add_relu", "cudnn_fused_normalization_add_relu", "repeat",
+      "unpack"};
+  if (!op_conf.has_user_conf()) { return true; }
+  return ignore_op_type_names.find(op_conf.user_conf().op_type_name())
+         != ignore_op_type_names.end();
+}
+
+void CollectAllCheckpointingOpsInForwardPass(
+    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
   op_graph.ForEachNode([&](const OpNode* op_node) {
     const OperatorConf& op_conf = op_node->op().op_conf();
-    if (!op_conf.has_user_conf()) { return; }
-    if (ignore_op_type_names.find(op_conf.user_conf().op_type_name())
-        != ignore_op_type_names.end()) {
-      return;
-    }
+    if (IsIgnoredOp4Checkpointing(op_conf)) { return; }
     if (IsForwardPass7CheckpointingScope(Scope4OpNode(op_node))) {
       CHECK(checkpointing_op_name2op_node->emplace(op_conf.name(), op_node).second);
     }
   });
 }
 
+// Recomputing these ops costs much more than the memory of their outputs is worth.
+bool IsComputeBoundOp(const OperatorConf& op_conf) {
+  static const HashSet<std::string> compute_bound_op_type_names = {
+      "matmul", "batch_matmul", "broadcast_matmul", "conv1d",  "conv2d",
+      "conv3d", "deconv1d",     "deconv2d",         "deconv3d"};
+  return compute_bound_op_type_names.find(op_conf.user_conf().op_type_name())
+         != compute_bound_op_type_names.end();
+}
+
+bool IsForwardPassOp(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_scope_symbol_id()
+      || !Global<symbol::Storage<Scope>>::Get()->Has(op_conf.scope_symbol_id())) {
+    return false;
+  }
+  return IsForwardPassScope(Scope4OpNode(op_node));
+}
+
+double BytesPerDevice(const OpNode* op_node, const LogicalBlobId& lbi) {
+  const BlobDesc& logical_blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+  Shape logical_shape = logical_blob_desc.shape();
+  const double elem_cnt = Storage4NdSbp(op_node->NdSbp4Lbi(lbi), logical_shape,
+                                        *op_node->parallel_desc().hierarchy());
+  return elem_cnt * GetSizeOfDataType(logical_blob_desc.data_type());
+}
+
+// Estimates the memory of blobs by their lifetimes in the topological order of ops, and drops the
+// outputs of forward ops from the end of their forward consumers to their first backward consumer,
+// where they are recomputed.
+class RecomputationPlanner final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RecomputationPlanner);
+  // The ops marked by checkpointing scopes are dropped already.
+  RecomputationPlanner(const OpGraph& op_graph,
+                       const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node);
+  ~RecomputationPlanner() = default;
+
+  // Drops the candidate with the most memory saved at the peak for its recomputation cost, until
+  // the peak fits the budget or no candidate helps. Returns the estimated peak.
+  double Plan(double memory_budget);
+
+  double Peak() const;
+  void ForEachDroppedOp(const std::function<void(const OpNode*)>& Handler) const;
+
+ private:
+  struct Blob {
+    int64_t producer;
+    double bytes;
+    std::vector<int64_t> consumers;
+  };
+
+  // Fills the memory at each time step and the end of the first live interval of each blob.
+  void GenMemoryTimeline(std::vector<double>* memory, std::vector<int64_t>* blob_end) const;
+
+  std::vector<const OpNode*> nodes_;
+  std::vector<bool> is_forward_;
+  std::vector<bool> dropped_;
+  std::vector<bool> is_candidate_;
+  // The first backward consumer of the outputs of each forward op.
+  std::vector<int64_t> recompute_time_;
+  // The bytes each op reads and writes, as the proxy of its recomputation cost.
+  std::vector<double> recompute_cost_;
+  std::vector<std::vector<int64_t>> node2in_blobs_;
+  std::vector<std::vector<int64_t>> node2out_blobs_;
+  std::vector<Blob> blobs_;
+};
+
+RecomputationPlanner::RecomputationPlanner(
+    const OpGraph& op_graph,
+    const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node) {
+  HashMap<const OpNode*, int64_t> node2time;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    CHECK(node2time.emplace(op_node, nodes_.size()).second);
+    nodes_.emplace_back(op_node);
+  });
+  const int64_t node_num = nodes_.size();
+  is_forward_.resize(node_num, false);
+  dropped_.resize(node_num, false);
+  is_candidate_.resize(node_num, false);
+  recompute_time_.resize(node_num, node_num);
+  recompute_cost_.resize(node_num, 0);
+  node2in_blobs_.resize(node_num);
+  node2out_blobs_.resize(node_num);
+  for (int64_t i = 0; i < node_num; ++i) {
+    is_forward_[i] = IsForwardPassOp(nodes_[i]);
+    dropped_[i] = checkpointing_op_name2op_node.find(nodes_[i]->op().op_name())
+                  != checkpointing_op_name2op_node.end();
+  }
+  for (int64_t i = 0; i < node_num; ++i) {
+    const OpNode* op_node = nodes_[i];
+    const Operator& op = op_node->op();
+    // Variables are not reused by the memory sharing, leave them out of the timeline.
+    if (op.op_conf().has_variable_conf()) { continue; }
+    HashMap<LogicalBlobId, int64_t> lbi2blob;
+    for (const std::string& obn : op.output_bns()) {
+      const LogicalBlobId& lbi = op.BnInOp2Lbi(obn);
+      if (lbi2blob.find(lbi) != lbi2blob.end()) { continue; }
+      lbi2blob.emplace(lbi, blobs_.size());
+      node2out_blobs_[i].emplace_back(blobs_.size());
+      blobs_.emplace_back(Blob{i, BytesPerDevice(op_node, lbi), {}});
+      recompute_cost_[i] += blobs_.back().bytes;
+    }
+    for (const OpEdge* edge : op_node->out_edges()) {
+      const int64_t consumer = node2time.at(edge->dst_node());
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        const auto& it = lbi2blob.find(lbi);
+        if (it == lbi2blob.end()) { continue; }
+        blobs_[it->second].consumers.emplace_back(consumer);
+        node2in_blobs_[consumer].emplace_back(it->second);
+        recompute_cost_[consumer] += blobs_[it->second].bytes;
+        if (is_forward_[i] && !is_forward_[consumer]) {
+          recompute_time_[i] = std::min(recompute_time_[i], consumer);
+        }
+      }
+    }
+  }
+  for (int64_t i = 0; i < node_num; ++i) {
+    const OpNode* op_node = nodes_[i];
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!is_forward_[i] || recompute_time_[i] == node_num) { continue; }
+    if (IsIgnoredOp4Checkpointing(op_conf) || IsComputeBoundOp(op_conf)) { continue; }
+    // Source ops and random ops can not be recomputed to the same outputs.
+    if (op_node->in_edges().empty()
+        || op_conf.user_conf().op_type_name().find("random") != std::string::npos) {
+      continue;
+    }
+    // The checkpointing pass redirects the backward consumers, which has to be user ops.
+    bool all_backward_consumers_are_user_ops = true;
+    op_node->ForEachNodeOnOutEdge([&](const OpNode* out_node) {
+      if (!IsForwardPassOp(out_node) && !out_node->op().op_conf().has_user_conf()) {
+        all_backward_consumers_are_user_ops = false;
+      }
+    });
+    if (!all_backward_consumers_are_user_ops) { continue; }
+    is_candidate_[i] = true;
+  }
+}
+
+void RecomputationPlanner::GenMemoryTimeline(std::vector<double>* memory,
+                                             std::vector<int64_t>* blob_end) const {
+  const int64_t node_num = nodes_.size();
+  std::vector<double> diff(node_num + 1, 0);
+  auto AddLiveInterval = [&](int64_t begin, int64_t end, double bytes) {
+    diff[begin] += bytes;
+    diff[end + 1] -= bytes;
+  };
+  blob_end->assign(blobs_.size(), 0);
+  for (int64_t b = 0; b < blobs_.size(); ++b) {
+    const Blob& blob = blobs_[b];
+    int64_t last_forward_consumer = blob.producer;
+    int64_t last_consumer = blob.producer;
+    // The recomputed consumers read the blob again before the first backward consumer of theirs.
+    int64_t last_recompute = -1;
+    int64_t first_recompute = recompute_time_[blob.producer];
+    for (int64_t consumer : blob.consumers) {
+      if (is_forward_[consumer]) {
+        last_forward_consumer = std::max(last_forward_consumer, consumer);
+      }
+      last_consumer = std::max(last_consumer, consumer);
+      if (dropped_[consumer]) {
+        last_recompute = std::max(last_recompute, recompute_time_[consumer]);
+        first_recompute = std::min(first_recompute, recompute_time_[consumer]);
+      }
+    }
+    if (!dropped_[blob.producer]) {
+      blob_end->at(b) = std::max(last_consumer, last_recompute);
+      AddLiveInterval(blob.producer, blob_end->at(b), blob.bytes);
+    } else {
+      blob_end->at(b) = last_forward_consumer;
+      AddLiveInterval(blob.producer, last_forward_consumer, blob.bytes);
+      const int64_t recomputed_end = std::max(last_consumer, last_recompute);
+      if (recomputed_end >= first_recompute) {
+        AddLiveInterval(first_recompute, recomputed_end, blob.bytes);
+      }
+    }
+  }
+  memory->resize(node_num);
+  double cur = 0;
+  for (int64_t t = 0; t < node_num; ++t) {
+    cur += diff[t];
+    memory->at(t) = cur;
+  }
+}
+
+double RecomputationPlanner::Peak() const {
+  std::vector<double> memory;
+  std::vector<int64_t> blob_end;
+  GenMemoryTimeline(&memory, &blob_end);
+  return memory.empty() ? 0 : *std::max_element(memory.begin(), memory.end());
+}
+
+double RecomputationPlanner::Plan(double memory_budget) {
+  std::vector<double> memory;
+  std::vector<int64_t> blob_end;
+  while (true) {
+    GenMemoryTimeline(&memory, &blob_end);
+    if (memory.empty()) { return 0; }
+    const int64_t peak_time = std::max_element(memory.begin(), memory.end()) - memory.begin();
+    if (memory.at(peak_time) <= memory_budget) { return memory.at(peak_time); }
+    int64_t best = -1;
+    double best_score = 0;
+    for (int64_t i = 0; i < nodes_.size(); ++i) {
+      if (!is_candidate_[i] || dropped_[i]) { continue; }
+      // Only the outputs alive across the peak both before and after the drop are saved, and the
+      // inputs are kept alive until the recomputation.
+      if (recompute_time_[i] <= peak_time) { continue; }
+      double saved = 0;
+      for (int64_t b : node2out_blobs_[i]) {
+        const Blob& blob = blobs_[b];
+        if (blob_end[b] < peak_time) { continue; }
+        int64_t last_forward_consumer = blob.producer;
+        for (int64_t consumer : blob.consumers) {
+          if (is_forward_[consumer]) {
+            last_forward_consumer = std::max(last_forward_consumer, consumer);
+          }
+        }
+        if (last_forward_consumer < peak_time) { saved += blob.bytes; }
+      }
+      for (int64_t b : node2in_blobs_[i]) {
+        if (blob_end[b] < peak_time) { saved -= blobs_[b].bytes; }
+      }
+      if (saved <= 0) { continue; }
+      const double score = saved / (1 + recompute_cost_[i]);
+      if (score > best_score) {
+        best = i;
+        best_score = score;
+      }
+    }
+    if (best == -1) { return memory.at(peak_time); }
+    dropped_[best] = true;
+  }
+}
+
+void RecomputationPlanner::ForEachDroppedOp(
+    const std::function<void(const OpNode*)>& Handler) const {
+  for (int64_t i = 0; i < nodes_.size(); ++i) {
+    if (dropped_[i]) { Handler(nodes_[i]); }
+  }
+}
+
+void CollectAutoCheckpointingOps(
+    const OpGraph& op_graph, double memory_budget,
+    HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+  RecomputationPlanner planner(op_graph, *checkpointing_op_name2op_node);
+  const double peak = planner.Peak();
+  const double planned_peak = planner.Plan(memory_budget);
+  int64_t dropped_op_num = 0;
+  planner.ForEachDroppedOp([&](const OpNode* op_node) {
+    if (checkpointing_op_name2op_node->emplace(op_node->op().op_name(), op_node).second) {
+      ++dropped_op_num;
+    }
+  });
+  const double mbyte = 1024.0 * 1024.0;
+  LOG(INFO) << "auto checkpointing recomputes " << dropped_op_num
+            << " ops, estimated peak memory per device " << peak / mbyte << " MB -> "
+            << planned_peak / mbyte << " MB, budget " << memory_budget / mbyte << " MB";
+  if (planned_peak > memory_budget) {
+    LOG(WARNING) << "auto checkpointing can not fit the estimated peak memory into the budget";
+  }
+}
+
 void GenConnectedCheckpointingSubgraphs(
     const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node,
     std::vector<HashSet<const OpNode*>>* checkpointing_subgraphs) {
@@ -125,10 +393,14 @@ void GenConnectedCheckpointingSubgraphs(
   }
 }
 
-Maybe<void> CheckpointingPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+Maybe<void> CheckpointingPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder,
+                                     double auto_memory_budget) const {
   // step 1. collect all checkpointing ops in forwardpass.
   HashMap<std::string, const OpNode*> checkpointing_op_name2op_node;
   CollectAllCheckpointingOpsInForwardPass(op_graph, &checkpointing_op_name2op_node);
+  if (auto_memory_budget > 0) {
+    CollectAutoCheckpointingOps(op_graph, auto_memory_budget, &checkpointing_op_name2op_node);
+  }
   if (checkpointing_op_name2op_node.empty()) { return Maybe<void>::Ok(); }
 
   // step 2. get all connected subgraphs in checkpointing ops.
@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace {
+
+// With gradient accumulation, the gradients of broadcast variables are partial sums accumulated
+// by acc ops over the micro-batches. An acc that got broadcast in and out all-reduces every
+// micro-batch. This pass turns such an acc into partial sum in and out, so the boxing to
+// broadcast moves behind the acc and runs once per step. Accs taking split gradients are left
+// as they are, since their sharded buffers are kept on purpose, e.g. by optimizer placement
+// optimization.
+class DeferAccBoxingPass final : public JobPass {
+ public:
+  DeferAccBoxingPass() = default;
+  ~DeferAccBoxingPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain() && ctx.job_desc().job_conf().enable_defer_acc_boxing()
+           && ctx.job_desc().job_conf().num_gradient_accumulation_steps() > 1;
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> DeferAccBoxingPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+  int64_t num_deferred = 0;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf() || op_conf.user_conf().op_type_name() != "acc") { return; }
+    const std::string& ibn = op_node->op().SoleIbn();
+    const std::string& obn = op_node->op().SoleObn();
+    const LogicalBlobId& in_lbi = op_node->op().BnInOp2Lbi(ibn);
+    const OpNode& producer = op_node->ProducerOpNode4Lbi(in_lbi);
+    if (producer.parallel_desc() != op_node->parallel_desc()) { return; }
+    const NdSbp& producer_nd_sbp = producer.NdSbp4Lbi(in_lbi);
+    NdSbpSignature nd_sbp_signature = op_node->nd_sbp_signature();
+    NdSbp* in_nd_sbp = &(*nd_sbp_signature.mutable_bn_in_op2nd_sbp())[ibn];
+    NdSbp* out_nd_sbp = &(*nd_sbp_signature.mutable_bn_in_op2nd_sbp())[obn];
+    bool changed = false;
+    FOR_RANGE(int64_t, i, 0, producer_nd_sbp.sbp_parallel_size()) {
+      if (!producer_nd_sbp.sbp_parallel(i).has_partial_sum_parallel()) { continue; }
+      if (!in_nd_sbp->sbp_parallel(i).has_broadcast_parallel()) { continue; }
+      in_nd_sbp->mutable_sbp_parallel(i)->mutable_partial_sum_parallel();
+      out_nd_sbp->mutable_sbp_parallel(i)->mutable_partial_sum_parallel();
+      changed = true;
+    }
+    if (!changed) { return; }
+    job_builder->AddNdSbpSignature4OpName(op_conf.name(), nd_sbp_signature);
+    ++num_deferred;
+  });
+  if (num_deferred > 0) {
+    VLOG(1) << "moved the boxing of " << num_deferred << " acc ops behind the accumulation";
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("DeferAccBoxingPass", DeferAccBoxingPass);
+
+}  // namespace oneflow
@@ -90,6 +90,8 @@ Maybe<void> FixPipelineStageIdPass::Apply(const OpGraph& op_graph, JobBuilder* j
   if (GlobalJobDesc().job_conf().num_gradient_accumulation_steps() <= 1) {
     return Maybe<void>::Ok();
   }
+  // Stages of the same placement are virtual stages of the interleaved schedule.
+  if (GlobalJobDesc().job_conf().pipeline_schedule() == "interleaved") { return Maybe<void>::Ok(); }
   int64_t max_stage_id = 0;
   op_graph.ForEachNode([&](const OpNode* this_node) {
     if (!OpNodeHasScope(this_node)) {
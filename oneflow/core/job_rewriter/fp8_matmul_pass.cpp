@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace {
+
+// Replaces the 2D matmuls on GPUs with fp8_matmul, which runs the forward GEMM in fp8 with
+// scales derived from the amax history of its inputs. The histories are zero-initialized float
+// variables added next to each fp8_matmul, so they are saved and restored with the model.
+class Fp8MatmulPass final : public JobPass {
+ public:
+  Fp8MatmulPass() = default;
+  ~Fp8MatmulPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_fp8_matmul();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+// The fp8 GEMMs of cuBLASLt need the leading dimensions of the fp8 operands, which are both k,
+// and of the output, which is n, to be multiples of 16.
+constexpr int64_t kFp8MatmulDimAlignment = 16;
+
+bool IsFp8MatmulDataType(DataType data_type) {
+  return data_type == DataType::kFloat || data_type == DataType::kFloat16
+         || data_type == DataType::kBFloat16;
+}
+
+OperatorConf GenAmaxHistoryVariableOpConf(const std::string& name, const int64_t scope_symbol_id,
+                                          const int64_t history_len) {
+  OperatorConf variable_op_conf{};
+  variable_op_conf.set_name(name);
+  variable_op_conf.set_scope_symbol_id(scope_symbol_id);
+  VariableOpConf* variable_conf = variable_op_conf.mutable_variable_conf();
+  variable_conf->set_out("out");
+  *variable_conf->mutable_shape()->mutable_dim()->Add() = history_len;
+  variable_conf->set_data_type(DataType::kFloat);
+  variable_conf->mutable_initializer()->mutable_constant_conf()->set_value(0);
+  return variable_op_conf;
+}
+
+Maybe<void> Fp8MatmulPass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  const int64_t history_len = ctx->job_desc().job_conf().fp8_amax_history_len();
+  CHECK_GT_OR_RETURN(history_len, 0) << "fp8_amax_history_len should be positive";
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  std::vector<OperatorConf> fp8_matmul_op_confs;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf() || op_conf.user_conf().op_type_name() != "matmul") { return; }
+    if (op_node->parallel_desc().device_type() != DeviceType::kCUDA) { return; }
+    const user_op::UserOpConfWrapper matmul(op_conf);
+    if (matmul.attr<bool>("transpose_a") || matmul.has_input("_add_to_output", 0)) { return; }
+    const BlobDesc& a_desc = op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(matmul.input("a", 0)));
+    const BlobDesc& out_desc =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(matmul.output("out", 0)));
+    if (a_desc.shape().NumAxes() != 2 || !IsFp8MatmulDataType(a_desc.data_type())) { return; }
+    const int64_t k = a_desc.shape().At(1);
+    const int64_t n = out_desc.shape().At(1);
+    if (k == 0 || k % kFp8MatmulDimAlignment != 0 || n % kFp8MatmulDimAlignment != 0) { return; }
+
+    const OperatorConf a_history_op_conf = GenAmaxHistoryVariableOpConf(
+        op_conf.name() + "-fp8_a_amax_history", op_conf.scope_symbol_id(), history_len);
+    const OperatorConf b_history_op_conf = GenAmaxHistoryVariableOpConf(
+        op_conf.name() + "-fp8_b_amax_history", op_conf.scope_symbol_id(), history_len);
+    job_builder.AddOps(op_node->parallel_desc().parallel_conf(),
+                       {a_history_op_conf, b_history_op_conf});
+    OperatorConf fp8_matmul_op_conf =
+        user_op::UserOpConfWrapperBuilder(op_conf.name())
+            .Op("fp8_matmul")
+            .Input("a", matmul.input("a", 0))
+            .Input("b", matmul.input("b", 0))
+            .Input("a_amax_history", GenLogicalBlobName(a_history_op_conf.name(), "out"))
+            .Input("b_amax_history", GenLogicalBlobName(b_history_op_conf.name(), "out"))
+            .Output("out")
+            .Attr<bool>("transpose_b", matmul.attr<bool>("transpose_b"))
+            .Attr<double>("alpha", matmul.attr<double>("alpha"))
+            .ScopeSymbolId(op_conf.scope_symbol_id())
+            .Build()
+            .op_conf();
+    *fp8_matmul_op_conf.mutable_ctrl_in_op_name() = op_conf.ctrl_in_op_name();
+    fp8_matmul_op_confs.emplace_back(std::move(fp8_matmul_op_conf));
+  });
+  if (fp8_matmul_op_confs.empty()) { return Maybe<void>::Ok(); }
+  // The outputs keep their names, so the consumers of the matmuls are intact.
+  job_builder.MutOpsOnlyOnce(fp8_matmul_op_confs);
+  VLOG(1) << "replaced " << fp8_matmul_op_confs.size() << " matmuls with fp8_matmul in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("Fp8MatmulPass", Fp8MatmulPass);
+
+}  // namespace oneflow
@@ -0,0 +1,257 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/ops/fused_elementwise_chain_util.h"
+
+namespace oneflow {
+
+namespace {
+
+std::function<bool(const OpNode* op_node)> MakePredicatorIsSafeToDelete(const OpGraph& op_graph) {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  return [=](const OpNode* op_node) {
+    if (op_node->out_edges().size() > 1) { return false; }
+    if (!op_node->op().op_conf().ctrl_in_op_name().empty()) { return false; }
+    if (ctrl_in_op_names.find(op_node->op().op_conf().name()) != ctrl_in_op_names.end()) {
+      return false;
+    }
+    return true;
+  };
+}
+
+struct ElementwiseChainStep {
+  std::string op_type;
+  float param0;
+  float param1;
+  std::string ibn;
+  std::string obn;
+};
+
+float ScalarOperand(const user_op::UserOpConfWrapper& user_op_conf) {
+  if (user_op_conf.attr<bool>("has_int_operand")) {
+    return static_cast<float>(user_op_conf.attr<int64_t>("int_operand"));
+  } else {
+    return static_cast<float>(user_op_conf.attr<double>("float_operand"));
+  }
+}
+
+bool IsSplitOrBroadcast(const NdSbp& nd_sbp) {
+  for (const SbpParallel& sbp : nd_sbp.sbp_parallel()) {
+    if (!sbp.has_split_parallel() && !sbp.has_broadcast_parallel()) { return false; }
+  }
+  return true;
+}
+
+// Returns false if the op can not be a step of fused_elementwise_chain.
+bool GetElementwiseChainStep(const OpNode* op_node, ElementwiseChainStep* step) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  ElementwiseChainOp op{};
+  if (!ElementwiseChainOp4OpTypeName(op_conf.user_conf().op_type_name(), &op)) { return false; }
+  if (op_node->op().input_bns().size() != 1 || op_node->op().output_bns().size() != 1) {
+    return false;
+  }
+  if (op_node->parallel_desc().device_type() != DeviceType::kCPU
+      && op_node->parallel_desc().device_type() != DeviceType::kCUDA) {
+    return false;
+  }
+  step->ibn = op_node->op().SoleIbn();
+  step->obn = op_node->op().SoleObn();
+  const BlobDesc& in = op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(step->ibn));
+  const BlobDesc& out = op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(step->obn));
+  if (in.data_type() != DataType::kFloat || out.data_type() != DataType::kFloat) { return false; }
+  if (in.shape() != out.shape()) { return false; }
+  // The fused op only splits or broadcasts, like most of the activations.
+  if (!IsSplitOrBroadcast(op_node->NdSbp4BnInOp(step->ibn))
+      || !IsSplitOrBroadcast(op_node->NdSbp4BnInOp(step->obn))) {
+    return false;
+  }
+  const user_op::UserOpConfWrapper user_op_conf(op_conf);
+  step->op_type = op_conf.user_conf().op_type_name();
+  step->param0 = 0;
+  step->param1 = 0;
+  if (op == ElementwiseChainOp::kScalarAdd || op == ElementwiseChainOp::kScalarMul
+      || op == ElementwiseChainOp::kScalarDiv) {
+    if (!user_op_conf.attr<bool>("has_int_operand")
+        && !user_op_conf.attr<bool>("has_float_operand")) {
+      return false;
+    }
+    step->param0 = ScalarOperand(user_op_conf);
+  } else if (op == ElementwiseChainOp::kElu || op == ElementwiseChainOp::kCelu) {
+    step->param0 = static_cast<float>(user_op_conf.attr<double>("alpha"));
+  } else if (op == ElementwiseChainOp::kLeakyRelu) {
+    step->param0 = user_op_conf.attr<float>("alpha");
+  } else if (op == ElementwiseChainOp::kHardtanh) {
+    step->param0 = static_cast<float>(user_op_conf.attr<double>("min_val"));
+    step->param1 = static_cast<float>(user_op_conf.attr<double>("max_val"));
+  }
+  return true;
+}
+
+class FuseElementwiseChainPass final : public JobPass {
+ public:
+  FuseElementwiseChainPass() = default;
+  ~FuseElementwiseChainPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_fuse_elementwise_chain();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> FuseElementwiseChainPass::Apply(const OpGraph& op_graph,
+                                            JobBuilder* job_builder) const {
+  const auto IsSafeToDelete = MakePredicatorIsSafeToDelete(op_graph);
+  HashSet<std::string> loss_lbns;
+  for (const std::string& loss_lbn : job_builder->job().job_conf().train_conf().loss_lbn()) {
+    loss_lbns.insert(loss_lbn);
+  }
+  HashMap<const OpNode*, ElementwiseChainStep> node2step;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    ElementwiseChainStep step;
+    if (!GetElementwiseChainStep(op_node, &step)) { return; }
+    // The fused op takes the name of the last step, the blobs of the others disappear.
+    if (loss_lbns.count(GenLogicalBlobName(op_node->op().BnInOp2Lbi(step.obn))) > 0) { return; }
+    node2step.emplace(op_node, step);
+  });
+  // The sole consumer of each step, if both can be fused without changing any other op.
+  HashMap<const OpNode*, const OpNode*> node2next;
+  HashSet<const OpNode*> has_prev;
+  for (const auto& pair : node2step) {
+    const OpNode* node = pair.first;
+    if (!IsSafeToDelete(node) || node->out_edges().size() != 1) { continue; }
+    const OpNode* next = node->SoleOutEdge()->dst_node();
+    auto next_it = node2step.find(next);
+    if (next_it == node2step.end()) { continue; }
+    const LogicalBlobId& lbi = node->op().BnInOp2Lbi(pair.second.obn);
+    if (next->op().BnInOp2Lbi(next_it->second.ibn) != lbi) { continue; }
+    if (node->parallel_desc() != next->parallel_desc()) { continue; }
+    if (node->op().op_conf().scope_symbol_id() != next->op().op_conf().scope_symbol_id()) {
+      continue;
+    }
+    // A boxing in between is kept.
+    if (node->NdSbp4Lbi(lbi) != next->NdSbp4BnInOp(next_it->second.ibn)) { continue; }
+    node2next.emplace(node, next);
+    has_prev.insert(next);
+  }
+  std::vector<std::vector<const OpNode*>> chains;
+  op_graph.TopoForEachNode([&](const OpNode* node) {
+    if (has_prev.count(node) > 0 || node2next.count(node) == 0) { return; }
+    std::vector<const OpNode*> chain{node};
+    while (true) {
+      auto it = node2next.find(chain.back());
+      const bool is_full = chain.size() == static_cast<size_t>(kMaxElementwiseChainLength);
+      if (it == node2next.end() || is_full) {
+        if (chain.size() > 1) { chains.emplace_back(std::move(chain)); }
+        if (it == node2next.end()) { break; }
+        chain = {it->second};
+      } else {
+        chain.emplace_back(it->second);
+      }
+    }
+  });
+  if (chains.empty()) { return Maybe<void>::Ok(); }
+
+  HashMap<std::string, std::string> old_lbn2new_lbn;
+  HashSet<std::string> deleted_op_names;
+  std::vector<std::string> delete_ops;
+  std::vector<OperatorConf> fused_op_confs;
+  for (const auto& chain : chains) {
+    const OpNode* head = chain.front();
+    const OpNode* tail = chain.back();
+    std::vector<std::string> op_types;
+    std::vector<float> params;
+    for (const OpNode* node : chain) {
+      const ElementwiseChainStep& step = node2step.at(node);
+      op_types.emplace_back(step.op_type);
+      params.emplace_back(step.param0);
+      params.emplace_back(step.param1);
+      if (node != tail) {
+        delete_ops.emplace_back(node->op().op_name());
+        deleted_op_names.insert(node->op().op_name());
+      }
+    }
+    const ElementwiseChainStep& head_step = node2step.at(head);
+    const ElementwiseChainStep& tail_step = node2step.at(tail);
+    user_op::UserOpConfWrapperBuilder fused_op_builder(tail->op().op_name());
+    fused_op_builder.OpTypeName("fused_elementwise_chain")
+        .Input("in", GenLogicalBlobName(head->op().BnInOp2Lbi(head_step.ibn)))
+        .Output("out")
+        .Attr<std::vector<std::string>>("op_types", op_types)
+        .Attr<std::vector<float>>("params", params);
+    OperatorConf fused_op_conf = tail->op().op_conf();
+    *fused_op_conf.mutable_user_conf() = fused_op_builder.Build().op_conf().user_conf();
+    const std::string old_lbn = GenLogicalBlobName(tail->op().BnInOp2Lbi(tail_step.obn));
+    const std::string new_lbn = user_op::UserOpConfWrapper(fused_op_conf).output("out", 0);
+    if (new_lbn != old_lbn) { old_lbn2new_lbn.emplace(old_lbn, new_lbn); }
+    fused_op_confs.emplace_back(fused_op_conf);
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "in_0"),
+                              head->NdSbp4BnInOp(head_step.ibn));
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "out_0"),
+                              tail->NdSbp4BnInOp(tail_step.obn));
+  }
+  // Relu and leaky_relu name their output y, the consumers of chains ending with them are
+  // rewritten. The tails keep their input from the chain, a fused op takes the input of its head.
+  HashSet<std::string> tail_op_names;
+  for (OperatorConf& fused_op_conf : fused_op_confs) {
+    tail_op_names.insert(fused_op_conf.name());
+    auto* in = &(*fused_op_conf.mutable_user_conf()->mutable_input())["in"];
+    auto it = old_lbn2new_lbn.find(in->s(0));
+    if (it != old_lbn2new_lbn.end()) { in->set_s(0, it->second); }
+  }
+  HashMap<std::string, OperatorConf> mut_op_name2conf;
+  if (!old_lbn2new_lbn.empty()) {
+    op_graph.ForEachNode([&](const OpNode* node) {
+      const std::string& op_name = node->op().op_name();
+      if (deleted_op_names.count(op_name) > 0 || tail_op_names.count(op_name) > 0) { return; }
+      for (const std::string& ibn : node->op().input_bns()) {
+        const std::string lbn = GenLogicalBlobName(node->op().BnInOp2Lbi(ibn));
+        auto lbn_it = old_lbn2new_lbn.find(lbn);
+        if (lbn_it == old_lbn2new_lbn.end()) { continue; }
+        auto it = mut_op_name2conf.find(op_name);
+        if (it == mut_op_name2conf.end()) {
+          it = mut_op_name2conf.emplace(op_name, node->op().op_conf()).first;
+        }
+        CHECK_EQ(ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, lbn_it->second), lbn);
+      }
+    });
+  }
+  for (auto& pair : mut_op_name2conf) { fused_op_confs.emplace_back(std::move(pair.second)); }
+  job_builder->MutOpsOnlyOnce(fused_op_confs);
+  job_builder->DelOps(delete_ops);
+  VLOG(1) << "fuse elementwise chain: " << chains.size() << " chains of "
+          << delete_ops.size() + chains.size() << " ops";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("FuseElementwiseChainPass", FuseElementwiseChainPass);
+
+}  // namespace oneflow
@@ -0,0 +1,262 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+std::function<bool(const OpNode* op_node)> MakePredicatorIsSafeToDelete(const OpGraph& op_graph) {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  return [=](const OpNode* op_node) {
+    if (op_node->out_edges().size() > 1) { return false; }
+    if (!op_node->op().op_conf().ctrl_in_op_name().empty()) { return false; }
+    if (ctrl_in_op_names.find(op_node->op().op_conf().name()) != ctrl_in_op_names.end()) {
+      return false;
+    }
+    return true;
+  };
+}
+
+bool IsUserOpWithTypeName(const OpNode* node, const std::string& op_type_name) {
+  const OperatorConf& op_conf = node->op().op_conf();
+  return op_conf.has_user_conf() && op_conf.user_conf().op_type_name() == op_type_name;
+}
+
+bool HasPartialSum(const NdSbp& nd_sbp) {
+  for (const SbpParallel& sbp : nd_sbp.sbp_parallel()) {
+    if (sbp.has_partial_sum_parallel()) { return true; }
+  }
+  return false;
+}
+
+// matmul of 2-D a and b, or broadcast_matmul of an N-D a and a 2-D b, computed by cuBLASLt.
+bool IsFusableMatmul(const OpNode* node) {
+  if (!IsUserOpWithTypeName(node, "matmul") && !IsUserOpWithTypeName(node, "broadcast_matmul")) {
+    return false;
+  }
+  if (node->parallel_desc().device_type() != DeviceType::kCUDA) { return false; }
+  const user_op::UserOpConfWrapper user_op_conf(node->op().op_conf());
+  if (user_op_conf.has_input("_add_to_output", 0)) { return false; }
+  const BlobDesc& b = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi("b_0"));
+  if (b.shape().NumAxes() != 2) { return false; }
+  const BlobDesc& out = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi("out_0"));
+  if (out.data_type() != DataType::kFloat && out.data_type() != DataType::kFloat16
+      && out.data_type() != DataType::kBFloat16) {
+    return false;
+  }
+  return true;
+}
+
+// Whether the output of producer flows into consumer_ibn of consumer only, with the same
+// placement, scope and nd_sbp on both ends.
+bool IsSoleConsumer(const OpNode* producer, const std::string& producer_obn,
+                    const OpNode* consumer, const std::string& consumer_ibn) {
+  if (producer->out_edges().size() != 1) { return false; }
+  if (producer->SoleOutEdge()->dst_node() != consumer) { return false; }
+  const LogicalBlobId& lbi = producer->op().BnInOp2Lbi(producer_obn);
+  for (const std::string& ibn : consumer->op().input_bns()) {
+    if (consumer->op().BnInOp2Lbi(ibn) == lbi && ibn != consumer_ibn) { return false; }
+  }
+  if (consumer->op().BnInOp2Lbi(consumer_ibn) != lbi) { return false; }
+  if (producer->parallel_desc() != consumer->parallel_desc()) { return false; }
+  if (producer->op().op_conf().scope_symbol_id() != consumer->op().op_conf().scope_symbol_id()) {
+    return false;
+  }
+  return producer->NdSbp4Lbi(lbi) == consumer->NdSbp4BnInOp(consumer_ibn);
+}
+
+// bias_add along the last axis, or broadcast_add of a 1-D bias as nn.Linear does, of the
+// output of a matmul.
+struct MatmulBiasActivation {
+  const OpNode* matmul;
+  const OpNode* bias_add;
+  std::string bias_ibn;
+  std::string bias_add_obn;
+  const OpNode* activation;
+};
+
+// Sets the input of bias_add that is the bias and its output, returns false if the op does not
+// add a bias along the last axis to matmul_lbi.
+bool GetBiasAddArgs(const OpNode* node, const LogicalBlobId& matmul_lbi, std::string* matmul_ibn,
+                    std::string* bias_ibn, std::string* obn) {
+  if (IsUserOpWithTypeName(node, "bias_add")) {
+    *matmul_ibn = "a_0";
+    *bias_ibn = "b_0";
+    *obn = "out_0";
+    const user_op::UserOpConfWrapper user_op_conf(node->op().op_conf());
+    const BlobDesc& out = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(*obn));
+    if (user_op_conf.attr<int32_t>("axis") != out.shape().NumAxes() - 1) { return false; }
+  } else if (IsUserOpWithTypeName(node, "broadcast_add")) {
+    *matmul_ibn = node->op().BnInOp2Lbi("x_0") == matmul_lbi ? "x_0" : "y_0";
+    *bias_ibn = *matmul_ibn == "x_0" ? "y_0" : "x_0";
+    *obn = "z_0";
+    const BlobDesc& bias = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(*bias_ibn));
+    const BlobDesc& out = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(*obn));
+    if (bias.shape().NumAxes() != 1
+        || bias.shape().At(0) != out.shape().At(out.shape().NumAxes() - 1)) {
+      return false;
+    }
+    if (bias.data_type() != out.data_type()) { return false; }
+  } else {
+    return false;
+  }
+  return node->op().BnInOp2Lbi(*matmul_ibn) == matmul_lbi;
+}
+
+class FuseMatmulBiasActivationPass final : public JobPass {
+ public:
+  FuseMatmulBiasActivationPass() = default;
+  ~FuseMatmulBiasActivationPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_fuse_matmul_bias_activation();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> FuseMatmulBiasActivationPass::Apply(const OpGraph& op_graph,
+                                                JobBuilder* job_builder) const {
+  const auto IsSafeToDelete = MakePredicatorIsSafeToDelete(op_graph);
+  HashSet<std::string> loss_lbns;
+  for (const std::string& loss_lbn : job_builder->job().job_conf().train_conf().loss_lbn()) {
+    loss_lbns.insert(loss_lbn);
+  }
+  const auto IsLoss = [&](const OpNode* node, const std::string& obn) {
+    return loss_lbns.count(GenLogicalBlobName(node->op().BnInOp2Lbi(obn))) > 0;
+  };
+  std::vector<MatmulBiasActivation> patterns;
+  op_graph.ForEachNode([&](const OpNode* matmul) {
+    if (!IsFusableMatmul(matmul) || !IsSafeToDelete(matmul) || IsLoss(matmul, "out_0")) { return; }
+    if (matmul->out_edges().size() != 1) { return; }
+    const OpNode* bias_add = matmul->SoleOutEdge()->dst_node();
+    std::string matmul_ibn;
+    MatmulBiasActivation pattern{matmul, bias_add, "", "", nullptr};
+    if (!GetBiasAddArgs(bias_add, matmul->op().BnInOp2Lbi("out_0"), &matmul_ibn,
+                        &pattern.bias_ibn, &pattern.bias_add_obn)) {
+      return;
+    }
+    if (!IsSoleConsumer(matmul, "out_0", bias_add, matmul_ibn)) { return; }
+    // The bias and the activation can not be applied to partial sums.
+    if (HasPartialSum(bias_add->NdSbp4BnInOp(matmul_ibn))
+        || HasPartialSum(bias_add->NdSbp4BnInOp(pattern.bias_ibn))) {
+      return;
+    }
+    // Relu is fused when it is the only consumer of the bias add. Gelu is not, the epilogue of
+    // cuBLASLt approximates it by tanh while the gelu op computes erf.
+    if (IsSafeToDelete(bias_add) && bias_add->out_edges().size() == 1
+        && !IsLoss(bias_add, pattern.bias_add_obn)) {
+      const OpNode* consumer = bias_add->SoleOutEdge()->dst_node();
+      if (IsUserOpWithTypeName(consumer, "relu")
+          && IsSoleConsumer(bias_add, pattern.bias_add_obn, consumer, "x_0")) {
+        pattern.activation = consumer;
+      }
+    }
+    patterns.emplace_back(pattern);
+  });
+  if (patterns.empty()) { return Maybe<void>::Ok(); }
+
+  HashMap<std::string, std::string> old_lbn2new_lbn;
+  HashSet<std::string> fused_op_names;
+  std::vector<std::string> delete_ops;
+  std::vector<OperatorConf> fused_op_confs;
+  for (const MatmulBiasActivation& pattern : patterns) {
+    const user_op::UserOpConfWrapper matmul_conf(pattern.matmul->op().op_conf());
+    // The fused op takes the name of the last op of the pattern, the others are deleted.
+    const OpNode* tail = pattern.activation != nullptr ? pattern.activation : pattern.bias_add;
+    const std::string tail_obn = pattern.activation != nullptr ? "y_0" : pattern.bias_add_obn;
+    user_op::UserOpConfWrapperBuilder fused_op_builder(tail->op().op_name());
+    fused_op_builder.OpTypeName("fused_matmul_bias")
+        .Input("a", GenLogicalBlobName(pattern.matmul->op().BnInOp2Lbi("a_0")))
+        .Input("b", GenLogicalBlobName(pattern.matmul->op().BnInOp2Lbi("b_0")))
+        .Input("bias", GenLogicalBlobName(pattern.bias_add->op().BnInOp2Lbi(pattern.bias_ibn)))
+        .Output("out")
+        .Attr<bool>("transpose_a", matmul_conf.attr<bool>("transpose_a"))
+        .Attr<bool>("transpose_b", matmul_conf.attr<bool>("transpose_b"))
+        .Attr<double>("alpha", matmul_conf.attr<double>("alpha"))
+        .Attr<std::string>("activation", pattern.activation != nullptr ? "relu" : "none");
+    OperatorConf fused_op_conf = tail->op().op_conf();
+    *fused_op_conf.mutable_user_conf() = fused_op_builder.Build().op_conf().user_conf();
+    const std::string old_lbn = GenLogicalBlobName(tail->op().BnInOp2Lbi(tail_obn));
+    const std::string new_lbn = user_op::UserOpConfWrapper(fused_op_conf).output("out", 0);
+    if (new_lbn != old_lbn) { old_lbn2new_lbn.emplace(old_lbn, new_lbn); }
+    fused_op_names.insert(fused_op_conf.name());
+    fused_op_confs.emplace_back(fused_op_conf);
+    delete_ops.emplace_back(pattern.matmul->op().op_name());
+    if (pattern.activation != nullptr) {
+      delete_ops.emplace_back(pattern.bias_add->op().op_name());
+    }
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "a_0"),
+                              pattern.matmul->NdSbp4BnInOp("a_0"));
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "b_0"),
+                              pattern.matmul->NdSbp4BnInOp("b_0"));
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "bias_0"),
+                              pattern.bias_add->NdSbp4BnInOp(pattern.bias_ibn));
+    job_builder->SetNdSbp4Oba(GenOpBlobArg(tail->op().op_name(), "out_0"),
+                              tail->NdSbp4BnInOp(tail_obn));
+  }
+  // Relu and broadcast_add name their outputs y and z, the consumers of patterns ending with them
+  // are rewritten. An input of a fused op may itself be the output of another fused pattern.
+  const HashSet<std::string> deleted_op_names(delete_ops.begin(), delete_ops.end());
+  for (OperatorConf& fused_op_conf : fused_op_confs) {
+    for (const std::string& arg_name : {"a", "b", "bias"}) {
+      auto* arg = &(*fused_op_conf.mutable_user_conf()->mutable_input())[arg_name];
+      auto it = old_lbn2new_lbn.find(arg->s(0));
+      if (it != old_lbn2new_lbn.end()) { arg->set_s(0, it->second); }
+    }
+  }
+  HashMap<std::string, OperatorConf> mut_op_name2conf;
+  if (!old_lbn2new_lbn.empty()) {
+    op_graph.ForEachNode([&](const OpNode* node) {
+      const std::string& op_name = node->op().op_name();
+      if (deleted_op_names.count(op_name) > 0 || fused_op_names.count(op_name) > 0) { return; }
+      for (const std::string& ibn : node->op().input_bns()) {
+        const std::string lbn = GenLogicalBlobName(node->op().BnInOp2Lbi(ibn));
+        auto lbn_it = old_lbn2new_lbn.find(lbn);
+        if (lbn_it == old_lbn2new_lbn.end()) { continue; }
+        auto it = mut_op_name2conf.find(op_name);
+        if (it == mut_op_name2conf.end()) {
+          it = mut_op_name2conf.emplace(op_name, node->op().op_conf()).first;
+        }
+        CHECK_EQ(ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, lbn_it->second), lbn);
+      }
+    });
+  }
+  for (auto& pair : mut_op_name2conf) { fused_op_confs.emplace_back(std::move(pair.second)); }
+  job_builder->MutOpsOnlyOnce(fused_op_confs);
+  job_builder->DelOps(delete_ops);
+  VLOG(1) << "fuse matmul bias activation: " << patterns.size() << " patterns";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("FuseMatmulBiasActivationPass", FuseMatmulBiasActivationPass);
+
+}  // namespace oneflow
@@ -0,0 +1,310 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+bool IsUserOpWithTypeName(const OpNode* node, const std::string& op_type_name) {
+  const OperatorConf& op_conf = node->op().op_conf();
+  return op_conf.has_user_conf() && op_conf.user_conf().op_type_name() == op_type_name;
+}
+
+bool HasPartialSum(const NdSbp& nd_sbp) {
+  for (const SbpParallel& sbp : nd_sbp.sbp_parallel()) {
+    if (sbp.has_partial_sum_parallel()) { return true; }
+  }
+  return false;
+}
+
+// Whether producer and consumer can be merged into one op: same placement and scope, and the
+// blob flows between them without boxing.
+bool IsFusableEdge(const OpNode* producer, const std::string& producer_obn,
+                   const OpNode* consumer, const std::string& consumer_ibn) {
+  const LogicalBlobId& lbi = producer->op().BnInOp2Lbi(producer_obn);
+  if (consumer->op().BnInOp2Lbi(consumer_ibn) != lbi) { return false; }
+  if (producer->parallel_desc() != consumer->parallel_desc()) { return false; }
+  if (producer->op().op_conf().scope_symbol_id() != consumer->op().op_conf().scope_symbol_id()) {
+    return false;
+  }
+  return producer->NdSbp4Lbi(lbi) == consumer->NdSbp4BnInOp(consumer_ibn);
+}
+
+// Whether consumer_ibn of consumer is the only reader of producer_obn of producer.
+bool IsSoleConsumer(const OpNode* producer, const std::string& producer_obn,
+                    const OpNode* consumer, const std::string& consumer_ibn) {
+  if (producer->out_edges().size() != 1) { return false; }
+  if (producer->SoleOutEdge()->dst_node() != consumer) { return false; }
+  const LogicalBlobId& lbi = producer->op().BnInOp2Lbi(producer_obn);
+  for (const std::string& ibn : consumer->op().input_bns()) {
+    if (consumer->op().BnInOp2Lbi(ibn) == lbi && ibn != consumer_ibn) { return false; }
+  }
+  return IsFusableEdge(producer, producer_obn, consumer, consumer_ibn);
+}
+
+bool IsConsumed(const OpNode* node, const std::string& obn) {
+  const LogicalBlobId& lbi = node->op().BnInOp2Lbi(obn);
+  for (const OpEdge* edge : node->out_edges()) {
+    if (edge->lbi2ibns().find(lbi) != edge->lbi2ibns().end()) { return true; }
+  }
+  return false;
+}
+
+// A layer_norm with x = [bias_add(x, bias)] + residual, and an optional gelu or silu of y.
+struct ResidualNormPattern {
+  const OpNode* layer_norm;
+  const OpNode* add;
+  std::string add_obn;
+  std::string x_ibn;
+  std::string residual_ibn;
+  const OpNode* bias_add;
+  const OpNode* activation;
+};
+
+// Sets the inputs of add that are x and the residual, and absorbs a bias_add along the last axis
+// feeding x when the add is its only consumer.
+void MatchResidualAdd(const OpNode* add, const std::string& lhs_ibn, const std::string& rhs_ibn,
+                      int64_t begin_norm_axis, ResidualNormPattern* pattern) {
+  pattern->x_ibn = lhs_ibn;
+  pattern->residual_ibn = rhs_ibn;
+  pattern->bias_add = nullptr;
+  for (const auto& ibns : {std::make_pair(lhs_ibn, rhs_ibn), std::make_pair(rhs_ibn, lhs_ibn)}) {
+    const OpNode* producer = add->MutSrcNode4Ibn(ibns.first);
+    if (!IsUserOpWithTypeName(producer, "bias_add")) { continue; }
+    const user_op::UserOpConfWrapper bias_add_conf(producer->op().op_conf());
+    const BlobDesc& out = producer->LogicalBlobDesc4Lbi(producer->op().BnInOp2Lbi("out_0"));
+    if (bias_add_conf.attr<int32_t>("axis") != out.shape().NumAxes() - 1) { continue; }
+    if (begin_norm_axis != out.shape().NumAxes() - 1) { continue; }
+    if (!IsSoleConsumer(producer, "out_0", add, ibns.first)) { continue; }
+    if (HasPartialSum(producer->NdSbp4BnInOp("b_0"))) { continue; }
+    pattern->bias_add = producer;
+    pattern->x_ibn = ibns.first;
+    pattern->residual_ibn = ibns.second;
+    return;
+  }
+}
+
+class FuseResidualNormPass final : public JobPass {
+ public:
+  FuseResidualNormPass() = default;
+  ~FuseResidualNormPass() override = default;
+
+  // The fused op saves the sum for the backward pass instead of x, so only inference jobs are
+  // rewritten for now.
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_fuse_residual_norm() && !ctx.job_desc().IsTrain();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> FuseResidualNormPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  const auto HasCtrlEdge = [&](const OpNode* node) {
+    return !node->op().op_conf().ctrl_in_op_name().empty()
+           || ctrl_in_op_names.count(node->op().op_name()) > 0;
+  };
+  std::vector<ResidualNormPattern> patterns;
+  HashSet<const OpNode*> fused_adds;
+  op_graph.ForEachNode([&](const OpNode* layer_norm) {
+    if (!IsUserOpWithTypeName(layer_norm, "layer_norm") || HasCtrlEdge(layer_norm)) { return; }
+    if (layer_norm->parallel_desc().device_type() != DeviceType::kCUDA) { return; }
+    if (IsConsumed(layer_norm, "mean_0") || IsConsumed(layer_norm, "inv_variance_0")) { return; }
+    const user_op::UserOpConfWrapper conf(layer_norm->op().op_conf());
+    const BlobDesc& x = layer_norm->LogicalBlobDesc4Lbi(layer_norm->op().BnInOp2Lbi("x_0"));
+    const int64_t num_axes = x.shape().NumAxes();
+    int64_t begin_norm_axis = conf.attr<int64_t>("begin_norm_axis");
+    if (begin_norm_axis < 0) { begin_norm_axis += num_axes; }
+    int64_t begin_params_axis = conf.attr<int64_t>("begin_params_axis");
+    if (begin_params_axis < 0) { begin_params_axis += num_axes; }
+    if (begin_norm_axis != begin_params_axis) { return; }
+    // The fused op splits only the leading axes, which layer_norm does too.
+    if (HasPartialSum(layer_norm->NdSbp4BnInOp("x_0"))) { return; }
+    ResidualNormPattern pattern{layer_norm, nullptr, "", "", "", nullptr, nullptr};
+    const OpNode* add = layer_norm->MutSrcNode4Ibn("x_0");
+    // An add feeding several layer_norms is fused into the first one only.
+    if (!HasCtrlEdge(add) && fused_adds.count(add) == 0) {
+      std::string lhs_ibn;
+      std::string rhs_ibn;
+      if (IsUserOpWithTypeName(add, "add_n") && add->op().input_bns().size() == 2) {
+        lhs_ibn = "in_0";
+        rhs_ibn = "in_1";
+        pattern.add_obn = "out_0";
+      } else if (IsUserOpWithTypeName(add, "broadcast_add")) {
+        lhs_ibn = "x_0";
+        rhs_ibn = "y_0";
+        pattern.add_obn = "z_0";
+      }
+      const bool is_residual_add =
+          !lhs_ibn.empty()
+          && add->LogicalBlobDesc4Lbi(add->op().BnInOp2Lbi(lhs_ibn)).shape() == x.shape()
+          && add->LogicalBlobDesc4Lbi(add->op().BnInOp2Lbi(rhs_ibn)).shape() == x.shape()
+          && !HasPartialSum(add->NdSbp4BnInOp(lhs_ibn))
+          && !HasPartialSum(add->NdSbp4BnInOp(rhs_ibn))
+          && IsFusableEdge(add, pattern.add_obn, layer_norm, "x_0");
+      if (is_residual_add) {
+        pattern.add = add;
+        fused_adds.insert(add);
+        MatchResidualAdd(add, lhs_ibn, rhs_ibn, begin_norm_axis, &pattern);
+      }
+    }
+    if (layer_norm->out_edges().size() == 1) {
+      const OpNode* consumer = layer_norm->SoleOutEdge()->dst_node();
+      if ((IsUserOpWithTypeName(consumer, "gelu") || IsUserOpWithTypeName(consumer, "silu"))
+          && IsSoleConsumer(layer_norm, "y_0", consumer, "in_0")) {
+        pattern.activation = consumer;
+      }
+    }
+    if (pattern.add == nullptr && pattern.activation == nullptr) { return; }
+    patterns.emplace_back(pattern);
+  });
+  if (patterns.empty()) { return Maybe<void>::Ok(); }
+
+  // y of the fused op keeps the lbn of the tail of the pattern, consumers of the add are
+  // redirected to sum. The input of one pattern is often the add of the previous one.
+  HashMap<std::string, std::string> old_lbn2new_lbn;
+  HashSet<std::string> fused_op_names;
+  std::vector<std::string> delete_ops;
+  std::vector<OperatorConf> fused_op_confs;
+  for (const ResidualNormPattern& pattern : patterns) {
+    const OpNode* layer_norm = pattern.layer_norm;
+    const user_op::UserOpConfWrapper layer_norm_conf(layer_norm->op().op_conf());
+    const OpNode* tail = pattern.activation != nullptr ? pattern.activation : layer_norm;
+    const std::string& fused_op_name = tail->op().op_name();
+    user_op::UserOpConfWrapperBuilder fused_op_builder(fused_op_name);
+    fused_op_builder.OpTypeName("fused_residual_norm")
+        .Output("y")
+        .Output("sum")
+        .Output("mean")
+        .Output("inv_variance")
+        .Attr<std::string>("norm_type", "layer_norm")
+        .Attr<int64_t>("begin_norm_axis", layer_norm_conf.attr<int64_t>("begin_norm_axis"))
+        .Attr<double>("epsilon", layer_norm_conf.attr<double>("epsilon"));
+    fused_op_builder.Attr<std::string>(
+        "activation", pattern.activation != nullptr
+                          ? pattern.activation->op().op_conf().user_conf().op_type_name()
+                          : "none");
+    if (pattern.add != nullptr) {
+      const OpNode* x_producer = pattern.bias_add != nullptr ? pattern.bias_add : pattern.add;
+      const std::string x_ibn = pattern.bias_add != nullptr ? "a_0" : pattern.x_ibn;
+      fused_op_builder.Input("x", GenLogicalBlobName(x_producer->op().BnInOp2Lbi(x_ibn)))
+          .Input("residual",
+                 GenLogicalBlobName(pattern.add->op().BnInOp2Lbi(pattern.residual_ibn)));
+      if (pattern.bias_add != nullptr) {
+        fused_op_builder.Input("bias",
+                               GenLogicalBlobName(pattern.bias_add->op().BnInOp2Lbi("b_0")));
+      }
+    } else {
+      fused_op_builder.Input("x", layer_norm_conf.input("x", 0));
+    }
+    if (layer_norm_conf.has_input("gamma", 0)) {
+      fused_op_builder.Input("gamma", layer_norm_conf.input("gamma", 0));
+    }
+    if (layer_norm_conf.has_input("beta", 0)) {
+      fused_op_builder.Input("beta", layer_norm_conf.input("beta", 0));
+    }
+    OperatorConf fused_op_conf = tail->op().op_conf();
+    *fused_op_conf.mutable_user_conf() = fused_op_builder.Build().op_conf().user_conf();
+    const user_op::UserOpConfWrapper fused_conf(fused_op_conf);
+    const std::string tail_obn = pattern.activation != nullptr ? "out_0" : "y_0";
+    const std::string old_y_lbn = GenLogicalBlobName(tail->op().BnInOp2Lbi(tail_obn));
+    if (old_y_lbn != fused_conf.output("y", 0)) {
+      old_lbn2new_lbn.emplace(old_y_lbn, fused_conf.output("y", 0));
+    }
+    fused_op_names.insert(fused_op_name);
+    fused_op_confs.emplace_back(fused_op_conf);
+    if (pattern.activation != nullptr) { delete_ops.emplace_back(layer_norm->op().op_name()); }
+
+    const auto SetNdSbp = [&](const std::string& bn, const NdSbp& nd_sbp) {
+      job_builder->SetNdSbp4Oba(GenOpBlobArg(fused_op_name, bn), nd_sbp);
+    };
+    if (pattern.add != nullptr) {
+      const std::string add_lbn = GenLogicalBlobName(pattern.add->op().BnInOp2Lbi(pattern.add_obn));
+      old_lbn2new_lbn.emplace(add_lbn, fused_conf.output("sum", 0));
+      delete_ops.emplace_back(pattern.add->op().op_name());
+      SetNdSbp("residual_0", pattern.add->NdSbp4BnInOp(pattern.residual_ibn));
+      SetNdSbp("sum_0", pattern.add->NdSbp4BnInOp(pattern.add_obn));
+      if (pattern.bias_add != nullptr) {
+        delete_ops.emplace_back(pattern.bias_add->op().op_name());
+        SetNdSbp("x_0", pattern.bias_add->NdSbp4BnInOp("a_0"));
+        SetNdSbp("bias_0", pattern.bias_add->NdSbp4BnInOp("b_0"));
+      } else {
+        SetNdSbp("x_0", pattern.add->NdSbp4BnInOp(pattern.x_ibn));
+      }
+    } else {
+      SetNdSbp("x_0", layer_norm->NdSbp4BnInOp("x_0"));
+      SetNdSbp("sum_0", layer_norm->NdSbp4BnInOp("x_0"));
+    }
+    if (layer_norm_conf.has_input("gamma", 0)) {
+      SetNdSbp("gamma_0", layer_norm->NdSbp4BnInOp("gamma_0"));
+    }
+    if (layer_norm_conf.has_input("beta", 0)) {
+      SetNdSbp("beta_0", layer_norm->NdSbp4BnInOp("beta_0"));
+    }
+    SetNdSbp("y_0", tail->NdSbp4BnInOp(tail_obn));
+    SetNdSbp("mean_0", layer_norm->NdSbp4BnInOp("mean_0"));
+    SetNdSbp("inv_variance_0", layer_norm->NdSbp4BnInOp("inv_variance_0"));
+  }
+  const HashSet<std::string> deleted_op_names(delete_ops.begin(), delete_ops.end());
+  for (OperatorConf& fused_op_conf : fused_op_confs) {
+    for (const std::string& arg_name : {"x", "residual"}) {
+      auto* input = fused_op_conf.mutable_user_conf()->mutable_input();
+      if (input->find(arg_name) == input->end()) { continue; }
+      auto* arg = &(*input)[arg_name];
+      auto it = old_lbn2new_lbn.find(arg->s(0));
+      if (it != old_lbn2new_lbn.end()) { arg->set_s(0, it->second); }
+    }
+  }
+  HashMap<std::string, OperatorConf> mut_op_name2conf;
+  op_graph.ForEachNode([&](const OpNode* node) {
+    const std::string& op_name = node->op().op_name();
+    if (deleted_op_names.count(op_name) > 0 || fused_op_names.count(op_name) > 0) { return; }
+    for (const std::string& ibn : node->op().input_bns()) {
+      const std::string lbn = GenLogicalBlobName(node->op().BnInOp2Lbi(ibn));
+      auto lbn_it = old_lbn2new_lbn.find(lbn);
+      if (lbn_it == old_lbn2new_lbn.end()) { continue; }
+      auto it = mut_op_name2conf.find(op_name);
+      if (it == mut_op_name2conf.end()) {
+        it = mut_op_name2conf.emplace(op_name, node->op().op_conf()).first;
+      }
+      CHECK_EQ(ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, lbn_it->second), lbn);
+    }
+  });
+  for (auto& pair : mut_op_name2conf) { fused_op_confs.emplace_back(std::move(pair.second)); }
+  job_builder->MutOpsOnlyOnce(fused_op_confs);
+  job_builder->DelOps(delete_ops);
+  VLOG(1) << "fuse residual norm: " << patterns.size() << " patterns";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("FuseResidualNormPass", FuseResidualNormPass);
+
+}  // namespace oneflow
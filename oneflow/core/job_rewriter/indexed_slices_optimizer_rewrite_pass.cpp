@@ -18,6 +18,33 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// A broadcast model takes broadcast slices in the indexed slices update, so with data parallelism
+// the slices of all the ranks are all-gathered, where the dense gradient used to be all-reduced.
+// The update deduplicates the gathered indices with indexed_slices_reduce_sum. A ring all-reduce
+// moves about twice the model and an all-gather the slices once, so the slices have to be
+// smaller than that to pay off, which holds for large tables with few rows touched per step.
+bool IsSparseGradientCommCheaper(const OpNode& src_node, const OpNode& dst_node,
+                                 const std::string& indices_lbn, const std::string& values_lbn,
+                                 const LogicalBlobId& model_lbi) {
+  if (dst_node.parallel_desc().parallel_num() == 1) { return true; }
+  const NdSbp& model_nd_sbp = dst_node.NdSbp4Lbi(model_lbi);
+  for (const auto& sbp : model_nd_sbp.sbp_parallel()) {
+    if (!sbp.has_broadcast_parallel()) { return true; }
+  }
+  const auto BlobBytes = [&](const std::string& lbn) -> int64_t {
+    const BlobDesc& blob_desc = src_node.LogicalBlobDesc4Lbi(GenLogicalBlobId(lbn));
+    return blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+  };
+  const BlobDesc& model_desc = dst_node.LogicalBlobDesc4Lbi(model_lbi);
+  const int64_t model_bytes =
+      model_desc.shape().elem_cnt() * GetSizeOfDataType(model_desc.data_type());
+  return BlobBytes(indices_lbn) + BlobBytes(values_lbn) < 2 * model_bytes;
+}
+
+}  // namespace
+
 class IndexedSlicesOptimizerRewritePass final : public JobPass {
  public:
   IndexedSlicesOptimizerRewritePass() = default;
@@ -102,6 +129,11 @@ Maybe<void> IndexedSlicesOptimizerRewritePass::Apply(const OpGraph& op_graph,
       return;
     }
     model_op_name = model_lbi.op_name();
+    if (!IsSparseGradientCommCheaper(*src_node, *dst_node, indices_lbn, values_lbn, model_lbi)) {
+      VLOG(1) << "keep the dense gradient of " << model_op_name
+              << " since gathering its slices costs more than reducing it";
+      return;
+    }
     user_op::UserOpConfWrapperBuilder indexed_slices_op_builder("System-Optimizer-IndexedSlices-"
                                                                 + model_op_name);
     indexed_slices_op_builder.OpTypeName("indexed_slices_" + user_op_conf.op_type_name())
@@ -0,0 +1,580 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/framework/nd_sbp.h"
+#include "oneflow/core/common/protobuf.h"
+
+namespace oneflow {
+
+namespace {
+
+class InferenceGraphOptimizationPass final : public JobPass {
+ public:
+  InferenceGraphOptimizationPass() = default;
+  ~InferenceGraphOptimizationPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_inference_graph_optimization()
+           && !ctx.job_desc().IsTrain();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+// Ops of which the outputs are not a function of the inputs alone, or which depend on the time
+// shape of the job.
+const HashSet<std::string>& ImpureOpTypeNames() {
+  static const HashSet<std::string> op_type_names{
+      "dropout", "random_mask_like", "identity_buffer", "repeat", "acc", "pack", "unpack",
+      "ssp_variable_proxy"};
+  return op_type_names;
+}
+
+HashSet<std::string> GetCtrlRelatedOpNames(const OpGraph& op_graph) {
+  HashSet<std::string> op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (op_conf.ctrl_in_op_name().empty()) { return; }
+    op_names.insert(op_conf.name());
+    op_names.insert(op_conf.ctrl_in_op_name().begin(), op_conf.ctrl_in_op_name().end());
+  });
+  return op_names;
+}
+
+// A pure op computes its outputs from its inputs only, so it can be removed when they are not
+// used, merged with an op computing the same thing or computed ahead of time.
+bool IsPureUserOp(const OpNode* op_node, const HashSet<std::string>& ctrl_related_op_names) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (ctrl_related_op_names.count(op_conf.name()) > 0) { return false; }
+  const std::string& op_type_name = op_conf.user_conf().op_type_name();
+  if (ImpureOpTypeNames().count(op_type_name) > 0) { return false; }
+  if (op_conf.user_conf().attr().count("seed") > 0) { return false; }
+  if (op_node->op().output_bns().empty()) { return false; }
+  if (op_node->op().input_bns().empty() && op_type_name != "constant") { return false; }
+  for (const std::string& ibn : op_node->op().input_bns()) {
+    if (op_node->op().InputBlobModifier4Ibn(ibn).is_mutable()) { return false; }
+  }
+  return true;
+}
+
+// The variables of nn.Graph are initialized by the eager tensors of the module, so only they can
+// be read when the folded constants are computed.
+bool IsModuleVariableOp(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  return op_conf.has_variable_conf() && op_conf.variable_conf().has_initializer()
+         && op_conf.variable_conf().initializer().has_empty_conf();
+}
+
+// Finds the pure ops which only depend on the variables of the module and the constant ops,
+// on the same placement, so they compute the same blobs in each step of an inference job.
+HashSet<const OpNode*> FindConstantOpNodes(const OpGraph& op_graph) {
+  const HashSet<std::string> ctrl_related_op_names = GetCtrlRelatedOpNames(op_graph);
+  HashSet<const OpNode*> constant_op_nodes;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (IsModuleVariableOp(op_node)) {
+      constant_op_nodes.insert(op_node);
+      return;
+    }
+    if (!IsPureUserOp(op_node, ctrl_related_op_names)) { return; }
+    // Folded constants are computed by eager ops, which do not run the ops of nn.Graph only.
+    if (op_node->op().op_conf().user_conf().op_type_name() == "hierarchical_parallel_cast") {
+      return;
+    }
+    for (const std::string& ibn : op_node->op().input_bns()) {
+      const OpNode& producer = op_node->SrcNode4Ibn(ibn);
+      if (constant_op_nodes.count(&producer) == 0) { return; }
+      if (producer.parallel_desc() != op_node->parallel_desc()) { return; }
+    }
+    constant_op_nodes.insert(op_node);
+  });
+  return constant_op_nodes;
+}
+
+// Points the inputs of the ops left at the replacing blobs, and deletes the replaced ops.
+// The ops mutated by the caller are passed in op_name2op_conf, since an op is mutated once.
+void ReplaceLbnsAndDelOps(const OpGraph& op_graph, const HashMap<std::string, std::string>& lbn2new,
+                          const HashSet<std::string>& del_op_names,
+                          HashMap<std::string, OperatorConf>* op_name2op_conf,
+                          JobBuilder* job_builder) {
+  const auto NewLbn4Lbn = [&](std::string lbn) -> std::string {
+    auto it = lbn2new.find(lbn);
+    while (it != lbn2new.end()) {
+      lbn = it->second;
+      it = lbn2new.find(lbn);
+    }
+    return lbn;
+  };
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const std::string& op_name = op_node->op().op_name();
+    if (del_op_names.count(op_name) > 0) { return; }
+    for (const std::string& ibn : op_node->op().input_bns()) {
+      const std::string lbn = GenLogicalBlobName(op_node->op().BnInOp2Lbi(ibn));
+      const std::string new_lbn = NewLbn4Lbn(lbn);
+      if (new_lbn == lbn) { continue; }
+      auto it = op_name2op_conf->find(op_name);
+      if (it == op_name2op_conf->end()) {
+        it = op_name2op_conf->emplace(op_name, op_node->op().op_conf()).first;
+      }
+      ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, new_lbn);
+    }
+  });
+  std::vector<OperatorConf> mut_op_confs;
+  for (const auto& pair : *op_name2op_conf) {
+    if (del_op_names.count(pair.first) == 0) { mut_op_confs.emplace_back(pair.second); }
+  }
+  job_builder->MutOpsOnlyOnce(mut_op_confs);
+  job_builder->DelOps(std::vector<std::string>(del_op_names.begin(), del_op_names.end()));
+}
+
+bool IsIdentityOp(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  const std::string& op_type_name = op_conf.user_conf().op_type_name();
+  if (op_type_name == "identity" || op_type_name == "amp_white_identity") { return true; }
+  if (op_type_name != "cast" && op_type_name != "reshape") { return false; }
+  const BlobDesc& in_desc = op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi("in_0"));
+  const BlobDesc& out_desc = op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi("out_0"));
+  return in_desc.data_type() == out_desc.data_type() && in_desc.shape() == out_desc.shape()
+         && in_desc.is_dynamic() == out_desc.is_dynamic();
+}
+
+Maybe<void> EliminateIdentityOps(Job* job) {
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  const HashSet<std::string> ctrl_related_op_names = GetCtrlRelatedOpNames(op_graph);
+  HashMap<std::string, std::string> lbn2new;
+  HashSet<std::string> del_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    if (!IsIdentityOp(op_node)) { return; }
+    if (ctrl_related_op_names.count(op_node->op().op_name()) > 0) { return; }
+    const LogicalBlobId& in_lbi = op_node->op().BnInOp2Lbi("in_0");
+    const LogicalBlobId& out_lbi = op_node->op().BnInOp2Lbi("out_0");
+    // An identity changing the placement or the sbp of a blob is a boxing.
+    if (op_node->SrcNode4Ibn("in_0").parallel_desc() != op_node->parallel_desc()) { return; }
+    if (op_node->NdSbp4Lbi(in_lbi) != op_node->NdSbp4Lbi(out_lbi)) { return; }
+    lbn2new.emplace(GenLogicalBlobName(out_lbi), GenLogicalBlobName(in_lbi));
+    del_op_names.insert(op_node->op().op_name());
+  });
+  if (del_op_names.empty()) { return Maybe<void>::Ok(); }
+  HashMap<std::string, OperatorConf> op_name2op_conf;
+  ReplaceLbnsAndDelOps(op_graph, lbn2new, del_op_names, &op_name2op_conf, &job_builder);
+  VLOG(1) << "eliminated " << del_op_names.size() << " identity ops in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+// The weight and the bias of a conv or a matmul followed by a batch norm in eval mode.
+struct BatchNormFoldingPattern {
+  const OpNode* main_node = nullptr;
+  const OpNode* bias_add_node = nullptr;
+  const OpNode* bn_node = nullptr;
+  std::string weight_ibn;
+  // The shape the per channel scale is reshaped to, to be broadcast to the weight.
+  DimVector weight_scale_dims;
+  // The bias is either the input of the bias_add op after the main op or the one of the conv.
+  std::string bias_lbn;
+  bool bias_of_conv = false;
+};
+
+bool IsSoleConsumer(const OpNode* producer, const OpNode* consumer) {
+  return producer->out_edges().size() == 1 && producer->SoleOutEdge()->dst_node() == consumer
+         && producer->SoleOutEdge()->lbis().size() == 1;
+}
+
+bool MatchBatchNormFoldingPattern(const OpGraph& op_graph, const OpNode* bn_node,
+                                  const HashSet<const OpNode*>& constant_op_nodes,
+                                  BatchNormFoldingPattern* pattern) {
+  const OperatorConf& bn_op_conf = bn_node->op().op_conf();
+  if (!bn_op_conf.has_user_conf() || bn_op_conf.user_conf().op_type_name() != "normalization") {
+    return false;
+  }
+  const user_op::UserOpConfWrapper bn(bn_op_conf);
+  if (bn.attr<bool>("training") || !bn.has_input("moving_mean", 0)
+      || !bn.has_input("moving_variance", 0) || bn.has_input("_add_to_output", 0)
+      || bn.has_output("mean", 0)) {
+    return false;
+  }
+  const int32_t bn_axis = bn.attr<int32_t>("axis");
+  const OpNode* producer = &bn_node->SrcNode4Ibn("x_0");
+  if (!IsSoleConsumer(producer, bn_node)) { return false; }
+  const OpNode* bias_add_node = nullptr;
+  if (producer->op().op_conf().has_user_conf()
+      && producer->op().op_conf().user_conf().op_type_name() == "bias_add") {
+    const user_op::UserOpConfWrapper bias_add(producer->op().op_conf());
+    if (bias_add.attr<int32_t>("axis") != bn_axis) { return false; }
+    bias_add_node = producer;
+    producer = &bias_add_node->SrcNode4Ibn("a_0");
+    if (!IsSoleConsumer(producer, bias_add_node)) { return false; }
+    pattern->bias_lbn = bias_add.input("b", 0);
+  }
+  const OperatorConf& main_op_conf = producer->op().op_conf();
+  if (!main_op_conf.has_user_conf()) { return false; }
+  const std::string& op_type_name = main_op_conf.user_conf().op_type_name();
+  const user_op::UserOpConfWrapper main_op(main_op_conf);
+  const BlobDesc& out_desc =
+      producer->LogicalBlobDesc4Lbi(GenLogicalBlobId(main_op.output("out", 0)));
+  if (op_type_name == "conv1d" || op_type_name == "conv2d" || op_type_name == "conv3d") {
+    const bool channels_first = main_op.attr<std::string>("data_format") == "channels_first";
+    if (bn_axis != (channels_first ? 1 : out_desc.shape().NumAxes() - 1)) { return false; }
+    if (main_op.has_input("bias_multiplier", 0)) { return false; }
+    if (main_op.has_input("bias", 0)) {
+      if (bias_add_node != nullptr) { return false; }
+      pattern->bias_lbn = main_op.input("bias", 0);
+      pattern->bias_of_conv = true;
+    }
+    pattern->weight_ibn = "weight_0";
+    // The output channels are the first axis of the weight in both data formats.
+    const int64_t weight_num_axes =
+        producer->LogicalBlobDesc4Lbi(producer->op().BnInOp2Lbi("weight_0")).shape().NumAxes();
+    pattern->weight_scale_dims.assign(weight_num_axes, 1);
+    pattern->weight_scale_dims.at(0) = out_desc.shape().At(bn_axis);
+  } else if (op_type_name == "matmul") {
+    if (out_desc.shape().NumAxes() != 2 || bn_axis != 1) { return false; }
+    if (main_op.has_input("_add_to_output", 0)) { return false; }
+    pattern->weight_ibn = "b_0";
+    const int64_t num_channels = out_desc.shape().At(1);
+    if (main_op.attr<bool>("transpose_b")) {
+      pattern->weight_scale_dims = {num_channels, 1};
+    } else {
+      pattern->weight_scale_dims = {1, num_channels};
+    }
+  } else {
+    return false;
+  }
+  const auto IsConstant = [&](const std::string& lbn) -> bool {
+    const LogicalBlobId lbi = GenLogicalBlobId(lbn);
+    return constant_op_nodes.count(op_graph.OpNode4OpName(lbi.op_name())) > 0;
+  };
+  if (!IsConstant(GenLogicalBlobName(producer->op().BnInOp2Lbi(pattern->weight_ibn)))) {
+    return false;
+  }
+  for (const std::string& arg : {"moving_mean", "moving_variance", "gamma", "beta"}) {
+    if (!IsConstant(bn.input(arg, 0))) { return false; }
+  }
+  if (!pattern->bias_lbn.empty() && !IsConstant(pattern->bias_lbn)) { return false; }
+  pattern->main_node = producer;
+  pattern->bias_add_node = bias_add_node;
+  pattern->bn_node = bn_node;
+  return true;
+}
+
+// Folds y = gamma * (x - mean) / sqrt(var + eps) + beta with x = w * in + b into
+// y = (w * scale) * in + (b * scale + beta - mean * scale), scale = gamma / sqrt(var + eps).
+// The new weight and bias only depend on constants, so they are folded in turn.
+Maybe<void> FoldBatchNorms(Job* job) {
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  const HashSet<const OpNode*> constant_op_nodes = FindConstantOpNodes(op_graph);
+  HashMap<std::string, std::string> lbn2new;
+  HashSet<std::string> del_op_names;
+  HashMap<std::string, OperatorConf> op_name2op_conf;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    BatchNormFoldingPattern pattern;
+    if (!MatchBatchNormFoldingPattern(op_graph, op_node, constant_op_nodes, &pattern)) { return; }
+    const OpNode* main_node = pattern.main_node;
+    // A conv followed by two batch norms is not folded twice.
+    if (op_name2op_conf.count(main_node->op().op_name()) > 0) { return; }
+    const user_op::UserOpConfWrapper bn(pattern.bn_node->op().op_conf());
+    const std::string& bn_name = bn.op_name();
+    const int64_t scope_symbol_id = main_node->op().op_conf().scope_symbol_id();
+    const DataType param_data_type =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(bn.input("gamma", 0))).data_type();
+    const DataType out_data_type =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(bn.output("y", 0))).data_type();
+    const LogicalBlobId& weight_lbi = main_node->op().BnInOp2Lbi(pattern.weight_ibn);
+    const DataType weight_data_type = main_node->LogicalBlobDesc4Lbi(weight_lbi).data_type();
+    std::vector<OperatorConf> new_op_confs;
+    const auto AddOp = [&](const user_op::UserOpConfWrapper& op,
+                           const std::string& output_arg_name) -> std::string {
+      new_op_confs.emplace_back(op.op_conf());
+      return op.output(output_arg_name, 0);
+    };
+    const auto Binary = [&](const std::string& op_type_name, const std::string& x,
+                            const std::string& y) -> std::string {
+      return AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_"
+                                                     + std::to_string(new_op_confs.size()))
+                       .Op(op_type_name)
+                       .Input("x", x)
+                       .Input("y", y)
+                       .Output("z")
+                       .ScopeSymbolId(scope_symbol_id)
+                       .Build(),
+                   "z");
+    };
+    const auto Cast = [&](const std::string& in, DataType from, DataType to) -> std::string {
+      if (from == to) { return in; }
+      return AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_"
+                                                     + std::to_string(new_op_confs.size()))
+                       .Op("cast")
+                       .Input("in", in)
+                       .Output("out")
+                       .Attr<DataType>("dtype", to)
+                       .ScopeSymbolId(scope_symbol_id)
+                       .Build(),
+                   "out");
+    };
+    const std::string var_eps =
+        AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_var_eps")
+                  .Op("scalar_add")
+                  .Input("in", bn.input("moving_variance", 0))
+                  .Output("out")
+                  .Attr<bool>("has_float_operand", true)
+                  .Attr<double>("float_operand", bn.attr<float>("epsilon"))
+                  .ScopeSymbolId(scope_symbol_id)
+                  .Build(),
+              "out");
+    const std::string inv_std = AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_inv_std")
+                                          .Op("rsqrt")
+                                          .Input("x", var_eps)
+                                          .Output("y")
+                                          .ScopeSymbolId(scope_symbol_id)
+                                          .Build(),
+                                      "y");
+    const std::string scale = Binary("broadcast_mul", bn.input("gamma", 0), inv_std);
+    std::string shift = Binary("broadcast_sub", bn.input("beta", 0),
+                               Binary("broadcast_mul", bn.input("moving_mean", 0), scale));
+    if (!pattern.bias_lbn.empty()) {
+      const DataType bias_data_type =
+          op_graph.OpNode4OpName(GenLogicalBlobId(pattern.bias_lbn).op_name())
+              ->LogicalBlobDesc4Lbi(GenLogicalBlobId(pattern.bias_lbn))
+              .data_type();
+      const std::string bias = Cast(pattern.bias_lbn, bias_data_type, param_data_type);
+      shift = Binary("broadcast_add", Binary("broadcast_mul", bias, scale), shift);
+    }
+    shift = Cast(shift, param_data_type, out_data_type);
+    const std::string weight_scale =
+        AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_weight_scale")
+                  .Op("reshape")
+                  .Input("in", scale)
+                  .Output("out")
+                  .Attr<Shape>("shape", Shape(pattern.weight_scale_dims))
+                  .ScopeSymbolId(scope_symbol_id)
+                  .Build(),
+              "out");
+    const std::string weight =
+        Binary("broadcast_mul", GenLogicalBlobName(weight_lbi),
+               Cast(weight_scale, param_data_type, weight_data_type));
+
+    OperatorConf& main_op_conf =
+        op_name2op_conf.emplace(main_node->op().op_name(), main_node->op().op_conf())
+            .first->second;
+    ReplaceInputLbnInOpCustomizedConf(&main_op_conf, pattern.weight_ibn, weight);
+    const std::string main_out_lbn = GenLogicalBlobName(main_node->op().BnInOp2Lbi("out_0"));
+    std::string new_bn_out_lbn;
+    if (pattern.bias_add_node != nullptr) {
+      OperatorConf& bias_add_op_conf =
+          op_name2op_conf
+              .emplace(pattern.bias_add_node->op().op_name(), pattern.bias_add_node->op().op_conf())
+              .first->second;
+      ReplaceInputLbnInOpCustomizedConf(&bias_add_op_conf, "b_0", shift);
+      new_bn_out_lbn = GenLogicalBlobName(pattern.bias_add_node->op().BnInOp2Lbi("out_0"));
+    } else if (pattern.bias_of_conv) {
+      ReplaceInputLbnInOpCustomizedConf(&main_op_conf, "bias_0", shift);
+      new_bn_out_lbn = main_out_lbn;
+    } else {
+      new_bn_out_lbn = AddOp(user_op::UserOpConfWrapperBuilder(bn_name + "-fold_bias_add")
+                                 .Op("bias_add")
+                                 .Input("a", main_out_lbn)
+                                 .Input("b", shift)
+                                 .Output("out")
+                                 .Attr<int32_t>("axis", bn.attr<int32_t>("axis"))
+                                 .ScopeSymbolId(pattern.bn_node->op().op_conf().scope_symbol_id())
+                                 .Build(),
+                             "out");
+    }
+    job_builder.AddOps(main_node->parallel_desc().parallel_conf(), new_op_confs);
+    lbn2new.emplace(bn.output("y", 0), new_bn_out_lbn);
+    del_op_names.insert(bn_name);
+  });
+  if (del_op_names.empty()) { return Maybe<void>::Ok(); }
+  ReplaceLbnsAndDelOps(op_graph, lbn2new, del_op_names, &op_name2op_conf, &job_builder);
+  VLOG(1) << "folded " << del_op_names.size() << " batch norms in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+bool IsFoldableBlob(const OpNode* op_node, const LogicalBlobId& lbi) {
+  const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+  if (blob_desc.is_dynamic()) { return false; }
+  for (const auto& sbp_parallel : op_node->NdSbp4Lbi(lbi).sbp_parallel()) {
+    if (sbp_parallel.has_partial_sum_parallel()) { return false; }
+  }
+  return true;
+}
+
+// Replaces the constant blobs consumed by the other ops with variables, which nn.Graph computes
+// once after compiling from the ops recorded in the job helper. The constant ops are then dead.
+Maybe<void> FoldConstants(Job* job) {
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  const HashSet<const OpNode*> constant_op_nodes = FindConstantOpNodes(op_graph);
+  std::vector<const OpNode*> topo_constant_op_nodes;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (constant_op_nodes.count(op_node) > 0 && op_node->op().op_conf().has_user_conf()) {
+      topo_constant_op_nodes.emplace_back(op_node);
+    }
+  });
+  auto* folded_constants = job->mutable_helper()->mutable_folded_variable_op_name2constant();
+  HashMap<std::string, std::string> lbn2new;
+  for (const OpNode* op_node : topo_constant_op_nodes) {
+    HashSet<LogicalBlobId> consumed_lbis;
+    for (const OpEdge* out_edge : op_node->out_edges()) {
+      if (constant_op_nodes.count(out_edge->dst_node()) > 0) { continue; }
+      consumed_lbis.insert(out_edge->lbis().begin(), out_edge->lbis().end());
+    }
+    if (consumed_lbis.empty()) { continue; }
+    HashSet<const OpNode*> ancestors{op_node};
+    std::vector<const OpNode*> stack{op_node};
+    while (!stack.empty()) {
+      const OpNode* cur = stack.back();
+      stack.pop_back();
+      for (const OpEdge* in_edge : cur->in_edges()) {
+        const OpNode* src = in_edge->src_node();
+        if (src->op().op_conf().has_user_conf() && ancestors.insert(src).second) {
+          stack.emplace_back(src);
+        }
+      }
+    }
+    FoldedConstant folded_constant;
+    for (const OpNode* node : topo_constant_op_nodes) {
+      if (ancestors.count(node) > 0) { *folded_constant.add_op() = node->op().op_conf(); }
+    }
+    for (const std::string& obn : op_node->op().output_bns()) {
+      const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(obn);
+      if (consumed_lbis.count(lbi) == 0 || !IsFoldableBlob(op_node, lbi)) { continue; }
+      const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+      OperatorConf variable_op_conf{};
+      variable_op_conf.set_name(op_node->op().op_name() + "-folded_" + obn);
+      variable_op_conf.set_scope_symbol_id(op_node->op().op_conf().scope_symbol_id());
+      VariableOpConf* variable_conf = variable_op_conf.mutable_variable_conf();
+      variable_conf->set_out("out");
+      blob_desc.shape().ToProto(variable_conf->mutable_shape());
+      variable_conf->set_data_type(blob_desc.data_type());
+      variable_conf->set_trainable(false);
+      // The value is set by nn.Graph, the initializer only marks it as created by a job pass.
+      variable_conf->mutable_initializer()->mutable_constant_conf()->set_value(0);
+      for (const auto& sbp_parallel : op_node->NdSbp4Lbi(lbi).sbp_parallel()) {
+        variable_conf->add_nd_sbp(SbpParallelToString(sbp_parallel));
+      }
+      JUST(job_builder.AddOp(op_node->parallel_desc().parallel_conf(), variable_op_conf));
+      folded_constant.set_lbn(GenLogicalBlobName(lbi));
+      (*folded_constants)[variable_op_conf.name()] = folded_constant;
+      lbn2new.emplace(GenLogicalBlobName(lbi),
+                      GenLogicalBlobName(variable_op_conf.name(), variable_conf->out()));
+    }
+  }
+  if (lbn2new.empty()) { return Maybe<void>::Ok(); }
+  HashMap<std::string, OperatorConf> op_name2op_conf;
+  ReplaceLbnsAndDelOps(op_graph, lbn2new, {}, &op_name2op_conf, &job_builder);
+  VLOG(1) << "folded " << lbn2new.size() << " constant blobs into variables in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+std::string OpSignature(const OpNode* op_node,
+                        const std::function<std::string(const std::string&)>& NewLbn4Lbn) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  const UserOpConf& user_conf = op_conf.user_conf();
+  std::string signature = user_conf.op_type_name() + "\n";
+  const std::map<std::string, AttrValue> attrs(user_conf.attr().begin(), user_conf.attr().end());
+  for (const auto& pair : attrs) {
+    signature += pair.first + ":" + PbMessage2TxtString(pair.second) + "\n";
+  }
+  for (const std::string& ibn : op_node->op().input_bns()) {
+    signature += ibn + ":" + NewLbn4Lbn(GenLogicalBlobName(op_node->op().BnInOp2Lbi(ibn))) + "\n";
+  }
+  for (const std::string& obn : op_node->op().output_bns()) {
+    signature += obn + ":" + NdSbpToString(op_node->NdSbp4BnInOp(obn)) + "\n";
+  }
+  signature += PbMessage2TxtString(op_node->parallel_desc().parallel_conf());
+  return signature;
+}
+
+// Merges the pure ops with the same type, attrs, inputs, placement and output sbp into the
+// first of them in topological order.
+Maybe<void> EliminateCommonSubexpressions(Job* job) {
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  const HashSet<std::string> ctrl_related_op_names = GetCtrlRelatedOpNames(op_graph);
+  HashMap<std::string, std::string> lbn2new;
+  HashSet<std::string> del_op_names;
+  HashMap<std::string, const OpNode*> signature2op_node;
+  const auto NewLbn4Lbn = [&](const std::string& lbn) -> std::string {
+    const auto it = lbn2new.find(lbn);
+    return it == lbn2new.end() ? lbn : it->second;
+  };
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (!IsPureUserOp(op_node, ctrl_related_op_names)) { return; }
+    const auto it = signature2op_node.emplace(OpSignature(op_node, NewLbn4Lbn), op_node).first;
+    const OpNode* first_op_node = it->second;
+    if (first_op_node == op_node) { return; }
+    for (const std::string& obn : op_node->op().output_bns()) {
+      lbn2new.emplace(GenLogicalBlobName(op_node->op().BnInOp2Lbi(obn)),
+                      GenLogicalBlobName(first_op_node->op().BnInOp2Lbi(obn)));
+    }
+    del_op_names.insert(op_node->op().op_name());
+  });
+  if (del_op_names.empty()) { return Maybe<void>::Ok(); }
+  HashMap<std::string, OperatorConf> op_name2op_conf;
+  ReplaceLbnsAndDelOps(op_graph, lbn2new, del_op_names, &op_name2op_conf, &job_builder);
+  VLOG(1) << "merged " << del_op_names.size() << " common subexpressions in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+// Deletes the pure ops none of the outputs of which is consumed, in reverse topological order so
+// the ops only feeding them are deleted as well.
+Maybe<void> EliminateDeadOps(Job* job) {
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  const HashSet<std::string> ctrl_related_op_names = GetCtrlRelatedOpNames(op_graph);
+  HashSet<const OpNode*> dead_op_nodes;
+  op_graph.ReverseTopoForEachNode([&](const OpNode* op_node) {
+    if (!IsPureUserOp(op_node, ctrl_related_op_names)) { return; }
+    for (const OpEdge* out_edge : op_node->out_edges()) {
+      if (dead_op_nodes.count(out_edge->dst_node()) == 0) { return; }
+    }
+    dead_op_nodes.insert(op_node);
+  });
+  if (dead_op_nodes.empty()) { return Maybe<void>::Ok(); }
+  std::vector<std::string> del_op_names;
+  for (const OpNode* op_node : dead_op_nodes) {
+    del_op_names.emplace_back(op_node->op().op_name());
+  }
+  job_builder.DelOps(del_op_names);
+  VLOG(1) << "eliminated " << del_op_names.size() << " dead ops in job "
+          << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferenceGraphOptimizationPass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  JUST(EliminateIdentityOps(job));
+  JUST(FoldBatchNorms(job));
+  JUST(EliminateCommonSubexpressions(job));
+  JUST(FoldConstants(job));
+  JUST(EliminateDeadOps(job));
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("InferenceGraphOptimizationPass", InferenceGraphOptimizationPass);
+
+}  // namespace oneflow
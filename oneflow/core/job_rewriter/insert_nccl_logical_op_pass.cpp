@@ -14,9 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #ifdef WITH_CUDA
+#include <numeric>
+#include <queue>
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/framework/nd_sbp.h"
 #include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/sbp_infer_util.h"
 #include "oneflow/core/job/scope.h"
 #include "oneflow/core/job/sbp_parallel.h"
 #include "oneflow/core/job/job.pb.h"
@@ -330,6 +333,26 @@ bool TryBuildNcclBy2DHierarchySameDim1(OperatorConf* ret, const NdSbp& src_nd_sb
   return false;
 }
 
+bool TryBuildNcclBy2DHierarchySendRecv(OperatorConf* ret, const NdSbp& src_nd_sbp,
+                                       const NdSbp& dst_nd_sbp, const std::string& lbn,
+                                       const int64_t scope_symbol_id) {
+  if (!IsBoxingBy2DSendRecvEnabled() || !CanBoxingBy2DSendRecv(src_nd_sbp, dst_nd_sbp)) {
+    return false;
+  }
+  // (S/B, S/B) -> (S/B, S/B) : one send/recv among all the ranks instead of two steps
+  *ret = user_op::UserOpConfWrapperBuilder(kNcclLogicalOpNamePrefix + "-(SB)2(SB)-"
+                                           + NewUniqueId())
+             .Op("_nccl_logical_2D_send_recv")
+             .Input("in", lbn)
+             .Output("out")
+             .Attr<std::vector<std::string>>("src_reduced_nd_sbp", NdSbpToStringList(src_nd_sbp))
+             .Attr<std::vector<std::string>>("dst_reduced_nd_sbp", NdSbpToStringList(dst_nd_sbp))
+             .ScopeSymbolId(scope_symbol_id)
+             .Build()
+             .op_conf();
+  return true;
+}
+
 Maybe<int64_t> BuildScopeWithReducedParallelDesc(int64_t old_scope_symbol_id,
                                                  const ParallelDesc& parallel_desc) {
   auto* scope_storage = Global<symbol::Storage<Scope>>::Get();
@@ -395,6 +418,9 @@ bool TryBuildNcclLogicalOpConf(OperatorConf* ret, const OpNode* src_node, const
                                                  src_reduced_hierarchy, lbn, scope_symbol_id,
                                                  logical_blob_desc);
       }
+    } else {
+      return TryBuildNcclBy2DHierarchySendRecv(ret, *src_reduced_nd_sbp, *dst_reduced_nd_sbp, lbn,
+                                               scope_symbol_id);
     }
   }
   return false;
@@ -687,6 +713,195 @@ constexpr uint32_t kMaxNcclComputeStreamCount = 8;
 
 std::string GetStreamIndexName(uint32_t id) { return "NCCL_COMPUTE_" + std::to_string(id); }
 
+// NOTE: The costs are in the units of the auto parallel search. Computing a node costs
+//   auto_parallel_computation_cost_ratio times the bytes each device reads and writes, and the
+//   nccl logical ops after a node cost the lazy copy cost of the blobs it sends to the nodes of the
+//   subgraph with another nd_sbp.
+double BytesPerDevice(const OpNode* node, const std::string& bn) {
+  const BlobDesc& blob_desc = node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(bn));
+  Shape logical_shape = blob_desc.shape();
+  double elem_cnt =
+      Storage4NdSbp(node->NdSbp4BnInOp(bn), logical_shape, *node->parallel_desc().hierarchy());
+  if (elem_cnt > GetValidMaxCopyCost()) { elem_cnt = blob_desc.shape().elem_cnt(); }
+  return elem_cnt * GetSizeOfDataType(blob_desc.data_type());
+}
+
+double EstimateComputeCost(const OpNode* node, double computation_cost_ratio) {
+  double bytes = 0;
+  for (const auto& ibn : node->op().input_bns()) { bytes += BytesPerDevice(node, ibn); }
+  for (const auto& obn : node->op().output_bns()) { bytes += BytesPerDevice(node, obn); }
+  return computation_cost_ratio * bytes;
+}
+
+double EstimateCommCost(const OpNode* src_node,
+                        const HashMap<const OpNode*, int64_t>& node2subgraph_order) {
+  double cost = 0;
+  for (const OpEdge* op_edge : src_node->out_edges()) {
+    const OpNode* dst_node = op_edge->dst_node();
+    if (node2subgraph_order.find(dst_node) == node2subgraph_order.end()) { continue; }
+    for (const LogicalBlobId& lbi : op_edge->lbis()) {
+      const double copy_cost = CHECK_JUST(ComputeLazyCopyCostBetweenNdSbp(
+          src_node->NdSbp4Lbi(lbi), dst_node->NdSbp4Lbi(lbi), src_node->LogicalBlobDesc4Lbi(lbi),
+          src_node->parallel_desc(), dst_node->parallel_desc(), /*requires_same_sbp=*/false));
+      if (copy_cost < GetValidMaxCopyCost()) { cost += copy_cost; }
+    }
+  }
+  return cost;
+}
+
+struct SubgraphCommSchedule {
+  std::vector<double> compute_costs;
+  std::vector<double> comm_costs;
+  // indexed by the topological order of the nodes in the subgraph
+  std::vector<std::vector<int64_t>> preds;
+  std::vector<std::vector<int64_t>> succs;
+};
+
+void InitSubgraphCommSchedule(
+    const std::vector<const OpNode*>& topo_order,
+    const HashMap<const OpNode*, int64_t>& node2topo_order,
+    const std::function<bool(const std::string&, const std::string&)>& IsReachable,
+    double computation_cost_ratio, SubgraphCommSchedule* schedule) {
+  const int64_t num_nodes = topo_order.size();
+  HashMap<std::string, int64_t> op_name2topo_order;
+  for (int64_t i = 0; i < num_nodes; ++i) {
+    op_name2topo_order.emplace(topo_order.at(i)->op().op_name(), i);
+  }
+  schedule->preds.assign(num_nodes, std::vector<int64_t>());
+  schedule->succs.assign(num_nodes, std::vector<int64_t>());
+  for (int64_t i = 0; i < num_nodes; ++i) {
+    const OpNode* node = topo_order.at(i);
+    schedule->compute_costs.emplace_back(EstimateComputeCost(node, computation_cost_ratio));
+    schedule->comm_costs.emplace_back(EstimateCommCost(node, node2topo_order));
+    HashSet<int64_t> preds;
+    bool depends_on_outside = false;
+    for (const OpEdge* op_edge : node->in_edges()) {
+      const auto& it = node2topo_order.find(op_edge->src_node());
+      if (it == node2topo_order.end()) {
+        depends_on_outside = true;
+      } else {
+        preds.insert(it->second);
+      }
+    }
+    for (const std::string& ctrl_in_op_name : node->op().op_conf().ctrl_in_op_name()) {
+      const auto& it = op_name2topo_order.find(ctrl_in_op_name);
+      if (it == op_name2topo_order.end()) {
+        depends_on_outside = true;
+      } else {
+        preds.insert(it->second);
+      }
+    }
+    if (depends_on_outside) {
+      // NOTE: the node may depend on others of the subgraph through nodes outside of it
+      for (int64_t j = 0; j < i; ++j) {
+        if (IsReachable(topo_order.at(j)->op().op_name(), node->op().op_name())) {
+          preds.insert(j);
+        }
+      }
+    }
+    for (int64_t pred : preds) {
+      CHECK_LT(pred, i);
+      schedule->preds.at(i).emplace_back(pred);
+      schedule->succs.at(pred).emplace_back(i);
+    }
+  }
+}
+
+// Makespan of the order when the nccl logical ops after a node are issued on a stream of their own
+// and the consumers of the node wait for them, along with the part of it the comm is exposed.
+std::pair<double, double> SimulateCommOverlap(const SubgraphCommSchedule& schedule,
+                                              const std::vector<int64_t>& order) {
+  const int64_t num_nodes = order.size();
+  std::vector<double> ready_times(num_nodes, 0);
+  double compute_free_time = 0;
+  double comm_free_time = 0;
+  double total_compute_cost = 0;
+  for (int64_t i : order) {
+    const double finish_time = std::max(compute_free_time, ready_times.at(i))
+                               + schedule.compute_costs.at(i);
+    compute_free_time = finish_time;
+    total_compute_cost += schedule.compute_costs.at(i);
+    double output_ready_time = finish_time;
+    if (schedule.comm_costs.at(i) > 0) {
+      comm_free_time = std::max(comm_free_time, finish_time) + schedule.comm_costs.at(i);
+      output_ready_time = comm_free_time;
+    }
+    for (int64_t succ : schedule.succs.at(i)) {
+      ready_times.at(succ) = std::max(ready_times.at(succ), output_ready_time);
+    }
+  }
+  const double makespan = std::max(compute_free_time, comm_free_time);
+  return std::make_pair(makespan, makespan - total_compute_cost);
+}
+
+// NOTE: List scheduling by the longest path of compute and comm to the end of the subgraph, so
+//   the nodes the nccl logical ops of which are on the critical path run as early as their inputs
+//   allow and their comm overlaps the compute of the independent nodes after them.
+void ReorderSubgraphForCommOverlap(
+    const std::vector<const OpNode*>& topo_order,
+    const std::function<bool(const std::string&, const std::string&)>& IsReachable,
+    double computation_cost_ratio, std::vector<const OpNode*>* subgraph_order) {
+  const int64_t num_nodes = topo_order.size();
+  HashMap<const OpNode*, int64_t> node2topo_order;
+  for (int64_t i = 0; i < num_nodes; ++i) { node2topo_order.emplace(topo_order.at(i), i); }
+  SubgraphCommSchedule schedule;
+  InitSubgraphCommSchedule(topo_order, node2topo_order, IsReachable, computation_cost_ratio,
+                           &schedule);
+  double total_comm_cost = 0;
+  for (double comm_cost : schedule.comm_costs) { total_comm_cost += comm_cost; }
+  if (total_comm_cost == 0) {
+    subgraph_order->assign(topo_order.begin(), topo_order.end());
+    return;
+  }
+
+  std::vector<double> bottom_levels(num_nodes, 0);
+  for (int64_t i = num_nodes - 1; i >= 0; --i) {
+    double max_succ_level = 0;
+    for (int64_t succ : schedule.succs.at(i)) {
+      max_succ_level = std::max(max_succ_level, bottom_levels.at(succ));
+    }
+    bottom_levels.at(i) = schedule.compute_costs.at(i) + schedule.comm_costs.at(i) + max_succ_level;
+  }
+  const auto Cmp = [&](int64_t lhs, int64_t rhs) {
+    if (bottom_levels.at(lhs) != bottom_levels.at(rhs)) {
+      return bottom_levels.at(lhs) < bottom_levels.at(rhs);
+    }
+    return lhs > rhs;
+  };
+  std::priority_queue<int64_t, std::vector<int64_t>, decltype(Cmp)> ready_nodes(Cmp);
+  std::vector<int64_t> num_unscheduled_preds(num_nodes);
+  for (int64_t i = 0; i < num_nodes; ++i) {
+    num_unscheduled_preds.at(i) = schedule.preds.at(i).size();
+    if (num_unscheduled_preds.at(i) == 0) { ready_nodes.push(i); }
+  }
+  std::vector<int64_t> order;
+  order.reserve(num_nodes);
+  while (!ready_nodes.empty()) {
+    const int64_t i = ready_nodes.top();
+    ready_nodes.pop();
+    order.emplace_back(i);
+    for (int64_t succ : schedule.succs.at(i)) {
+      if (--num_unscheduled_preds.at(succ) == 0) { ready_nodes.push(succ); }
+    }
+  }
+  CHECK_EQ(order.size(), topo_order.size());
+
+  std::vector<int64_t> original_order(num_nodes);
+  std::iota(original_order.begin(), original_order.end(), 0);
+  const auto original = SimulateCommOverlap(schedule, original_order);
+  const auto reordered = SimulateCommOverlap(schedule, order);
+  VLOG(1) << "nccl logical subgraph from " << topo_order.front()->op().op_name() << " of "
+          << num_nodes << " ops, estimated comm " << total_comm_cost << ", exposed comm "
+          << original.second << " -> " << reordered.second << ", makespan " << original.first
+          << " -> " << reordered.first;
+  if (reordered.first > original.first) {
+    subgraph_order->assign(topo_order.begin(), topo_order.end());
+    return;
+  }
+  subgraph_order->clear();
+  for (int64_t i : order) { subgraph_order->emplace_back(topo_order.at(i)); }
+}
+
 void InsertNcclLogicalOpsInSubGraph(
     const OpGraph& op_graph, JobBuilder* job_builder,
     const std::vector<const OpNode*>& subgraph_order,
@@ -950,6 +1165,7 @@ Maybe<void> InsertNcclLogicalOpPass::Apply(const OpGraph& op_graph, JobBuilder*
     }
   }
 
+  const JobConfigProto& job_conf = job_builder->job().job_conf();
   for (auto& pair : placement2subgraphs) {
     PlacementNcclSubGraghsInfo& info = pair.second;
     for (int i = 0; i < info.ordered_subgraph.size() - 1; i++) {
@@ -960,7 +1176,16 @@ Maybe<void> InsertNcclLogicalOpPass::Apply(const OpGraph& op_graph, JobBuilder*
     // NOTE(chengcheng): insert nccl ops for each subgraph
     uint32_t stream_offset = 0;
     for (int i = 0; i < info.ordered_subgraph.size(); i++) {
-      auto& ordered_op_nodes = info.ordered_subgraph.at(i)->ordered_op_nodes;
+      auto& subgraph = info.ordered_subgraph.at(i);
+      if (job_conf.enable_nccl_logical_op_comm_aware_order()) {
+        const std::vector<const OpNode*> topo_order = subgraph->ordered_op_nodes;
+        ReorderSubgraphForCommOverlap(topo_order, IsReachable,
+                                      job_conf.auto_parallel_computation_cost_ratio(),
+                                      &subgraph->ordered_op_nodes);
+        subgraph->begin_op = subgraph->ordered_op_nodes.front();
+        subgraph->end_op = subgraph->ordered_op_nodes.back();
+      }
+      auto& ordered_op_nodes = subgraph->ordered_op_nodes;
       InsertNcclLogicalOpsInSubGraph(op_graph, job_builder, ordered_op_nodes, IsReachable, i,
                                      &stream_offset);
     }
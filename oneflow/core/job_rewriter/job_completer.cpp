@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/autograd.h"
 #include "oneflow/core/job_rewriter/autotick.h"
 #include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/compile_time_profile.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/job_rewriter/group_boxing_by_dst_parallel.h"
 #include "oneflow/core/framework/config_def.h"
@@ -106,23 +107,35 @@ Maybe<void> SetCtrlInOpName4VariableOp(const OpGraph& op_graph, JobBuilder* job_
 
 Maybe<void> JobCompleter::Complete(Job* job) const {
   JobPassCtx job_pass_ctx(GlobalJobDesc());
+  CompileTimeProfile profile("job completer of " + job->job_conf().job_name());
   JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  profile.Tick("DumpBlobParallelConfPass");
   // NOTE(chengcheng): disable this pass for reduce boxing memory life cycle to memory cost.
   if (!Global<ResourceDesc, ForSession>::Get()->resource().disable_group_boxing_by_dst_parallel()) {
     JUST(WithOpGraphAndMutJobBuilder(job, &GroupBoxingByDstParallel));
+    profile.Tick("GroupBoxingByDstParallel");
   }
   JUST(WithOpGraphAndMutJobBuilder(job, &BoxingWithMiddleNodes));
+  profile.Tick("BoxingWithMiddleNodes");
   JUST(WithOpGraphAndMutJobBuilder(job, &SetCtrlInOpName4VariableOp));
+  profile.Tick("SetCtrlInOpName4VariableOp");
   // complete tick ops
   JUST(WithOpGraphAndMutJobBuilder(job, &AutoPrependTick));
+  profile.Tick("AutoPrependTick");
   JUST(WithOpGraphAndMutJobBuilder(job, &AddTickForTimeShape));
+  profile.Tick("AddTickForTimeShape");
   JUST(WithOpGraphAndMutJob(job, &MultiClientAutoSourceAndSinkTick));
+  profile.Tick("MultiClientAutoSourceAndSinkTick");
   JUST(WithOpGraphAndMutJob(job, &MultiClientAutoInterfaceCriticalSectionTick));
+  profile.Tick("MultiClientAutoInterfaceCriticalSectionTick");
   JUST(JobPass4Name("SystemOpFillJobNamePass")(job, &job_pass_ctx));
+  profile.Tick("SystemOpFillJobNamePass");
   JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+  profile.Tick("DumpBlobParallelConfPass");
   if (XrtCompilationEnabled(GlobalJobDesc())) {
 #ifdef OF_WITH_XRT
     JUST(WithOpGraphAndMutJob(job, &RebuildXrtCompiledJob));
+    profile.Tick("RebuildXrtCompiledJob");
 #else
     LOG(WARNING) << "It will not use XLA or TensorRT since WITH_XLA or "
                     "WITH_TENSORRT was not enabled when compiling the project.";
@@ -132,8 +145,10 @@ Maybe<void> JobCompleter::Complete(Job* job) const {
   if (Global<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream()) {
     // NOTE(chengcheng): this pass need as last pass for insert correct op with nccl boxing.
     JUST(JobPass4Name("InsertNcclLogicalOpPass")(job, &job_pass_ctx));
+    profile.Tick("InsertNcclLogicalOpPass");
     // NOTE(chengcheng): Becasue insert new logical nccl op, MUST dump time shape, sbp again.
     JUST(JobPass4Name("DumpBlobParallelConfPass")(job, &job_pass_ctx));
+    profile.Tick("DumpBlobParallelConfPass");
   }
 #endif  // WITH_CUDA
   JUST(CheckOpGraph(OpGraph(*job)));
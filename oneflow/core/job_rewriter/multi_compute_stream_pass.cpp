@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+namespace oneflow {
+
+namespace {
+
+// Spreads the independent branches of a job over several compute streams of each GPU. Ops are
+// visited in topological order and continue the stream of the first producer no other consumer
+// has continued yet, so a chain stays on one stream and the second consumer of an op forks a
+// branch onto the next stream. Only ops with small outputs move, since a large kernel fills the
+// GPU on its own. The ops of a stream form a chain of their own in the plan, and the actors
+// synchronize the streams through the regsts they pass each other.
+class MultiComputeStreamPass final : public JobPass {
+ public:
+  MultiComputeStreamPass() = default;
+  ~MultiComputeStreamPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    // Compute stream nccl orders all the ops of a placement strictly, leaving nothing to overlap.
+    return ctx.job_desc().job_conf().num_compute_streams() > 1
+           && !Global<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream();
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder,
+                    int64_t num_compute_streams) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder, ctx->job_desc().job_conf().num_compute_streams());
+  }
+};
+
+std::string GetComputeStreamName(int64_t stream) { return "COMPUTE_" + std::to_string(stream); }
+
+bool IsMovableOp(const OpNode* op_node, int64_t max_output_bytes) {
+  if (op_node->parallel_desc().device_type() != DeviceType::kCUDA) { return false; }
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf() || op_conf.has_stream_name_hint()) { return false; }
+  if (op_node->op().input_bns().empty() || op_node->op().output_bns().empty()) { return false; }
+  // Ops changing the time shape, like acc or repeat, pace the pipeline and stay where they are.
+  if (*CHECK_JUST(op_node->op().GetOpTimeShape())
+      != *CHECK_JUST(op_node->op().GetInputBlobFastestTimeShape())) {
+    return false;
+  }
+  const int64_t parallel_num = op_node->parallel_desc().parallel_num();
+  for (const std::string& obn : op_node->op().output_bns()) {
+    const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(obn));
+    const int64_t bytes = blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+    if (bytes / parallel_num > max_output_bytes) { return false; }
+  }
+  return true;
+}
+
+Maybe<void> MultiComputeStreamPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder,
+                                          int64_t num_compute_streams) const {
+  const int64_t max_output_bytes =
+      ParseIntegerFromEnv("ONEFLOW_MULTI_COMPUTE_STREAM_MAX_OUTPUT_MBYTE", 8) * 1024 * 1024;
+  HashMap<const OpNode*, int64_t> op_node2stream;
+  HashSet<const OpNode*> continued_op_nodes;
+  int64_t next_branch_stream = 0;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (!IsMovableOp(op_node, max_output_bytes)) { return; }
+    bool has_movable_producer = false;
+    for (const OpEdge* in_edge : op_node->in_edges()) {
+      const OpNode* producer = in_edge->src_node();
+      auto it = op_node2stream.find(producer);
+      if (it == op_node2stream.end()) { continue; }
+      if (producer->parallel_desc() != op_node->parallel_desc()) { continue; }
+      has_movable_producer = true;
+      if (continued_op_nodes.insert(producer).second) {
+        op_node2stream[op_node] = it->second;
+        return;
+      }
+    }
+    if (has_movable_producer) {
+      // Stream 0 is the default compute stream, the branches rotate over the others.
+      op_node2stream[op_node] = next_branch_stream % (num_compute_streams - 1) + 1;
+      ++next_branch_stream;
+    } else {
+      op_node2stream[op_node] = 0;
+    }
+  });
+  std::vector<OperatorConf> mut_op_confs;
+  for (const auto& pair : op_node2stream) {
+    if (pair.second == 0) { continue; }
+    OperatorConf op_conf = pair.first->op().op_conf();
+    op_conf.set_stream_name_hint(GetComputeStreamName(pair.second));
+    mut_op_confs.emplace_back(op_conf);
+  }
+  if (!mut_op_confs.empty()) {
+    VLOG(1) << "moved " << mut_op_confs.size() << " ops of " << next_branch_stream
+            << " branches off the default compute stream";
+    job_builder->MutOpsOnlyOnce(mut_op_confs);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("MultiComputeStreamPass", MultiComputeStreamPass);
+
+}  // namespace oneflow
@@ -0,0 +1,171 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/nd_sbp.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/vm/symbol_storage.h"
+
+namespace oneflow {
+
+namespace {
+
+HashSet<std::string> GetCtrlInOpNames(const OpGraph& op_graph) {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  return ctrl_in_op_names;
+}
+
+const std::vector<std::string>& StateArgNames4OpTypeName(const std::string& op_type_name) {
+  static const HashMap<std::string, std::vector<std::string>> op_type_name2state_arg_names{
+      {"sgd_update", {}},
+      {"momentum_update", {"momentum"}},
+      {"adam_update", {"m", "v"}},
+  };
+  return op_type_name2state_arg_names.at(op_type_name);
+}
+
+const std::vector<std::string>& ScalarArgNames() {
+  static const std::vector<std::string> scalar_arg_names{
+      "learning_rate", "scale_by_tensor", "skip_if", "bias_correction1", "bias_correction2"};
+  return scalar_arg_names;
+}
+
+int64_t GetStageIdHint(const OpNode* op_node) {
+  const int64_t scope_symbol_id = op_node->op().op_conf().scope_symbol_id();
+  CHECK(Global<symbol::Storage<Scope>>::Get()->Has(scope_symbol_id));
+  return Global<symbol::Storage<Scope>>::Get()->Get(scope_symbol_id).Int64(
+      "pipeline_stage_id_hint");
+}
+
+// Update ops can share one multi tensor op only if everything except the per tensor inputs is
+// identical: op type, placement, pipeline stage, sbp and data types of the tensors, the scalar
+// inputs (learning rate, skip_if, ...) and all attrs.
+std::string GenMultiTensorGroupKey(const OpNode* op_node,
+                                   const user_op::UserOpConfWrapper& user_op_conf) {
+  std::string key = user_op_conf.op_type_name();
+  key += "\n" + op_node->parallel_desc().parallel_conf().DebugString();
+  key += "\n" + std::to_string(GetStageIdHint(op_node));
+  key += "\n" + NdSbpToString(op_node->NdSbp4BnInOp(GenRepeatedBn("model", 0)));
+  for (const std::string& arg_name : {"model", "model_diff"}) {
+    const LogicalBlobId lbi = GenLogicalBlobId(user_op_conf.input(arg_name, 0));
+    key += "\n" + std::to_string(op_node->LogicalBlobDesc4Lbi(lbi).data_type());
+  }
+  for (const std::string& arg_name : ScalarArgNames()) {
+    if (user_op_conf.has_input(arg_name, 0)) {
+      key += "\n" + arg_name + ":" + user_op_conf.input(arg_name, 0);
+    }
+  }
+  const auto& attrs = user_op_conf.op_conf().user_conf().attr();
+  std::map<std::string, std::string> sorted_attrs;
+  for (const auto& pair : attrs) { sorted_attrs[pair.first] = pair.second.ShortDebugString(); }
+  for (const auto& pair : sorted_attrs) { key += "\n" + pair.first + "=" + pair.second; }
+  return key;
+}
+
+class MultiTensorModelUpdatePass final : public JobPass {
+ public:
+  MultiTensorModelUpdatePass() = default;
+  ~MultiTensorModelUpdatePass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain() && ctx.job_desc().job_conf().enable_multi_tensor_model_update();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+};
+
+Maybe<void> MultiTensorModelUpdatePass::Apply(const OpGraph& op_graph,
+                                              JobBuilder* job_builder) const {
+  const HashSet<std::string> ctrl_in_op_names = GetCtrlInOpNames(op_graph);
+  std::map<std::string, std::vector<const OpNode*>> key2update_op_nodes;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return; }
+    const user_op::UserOpConfWrapper user_op_conf(op_conf);
+    if (user_op_conf.op_type_name() != "sgd_update"
+        && user_op_conf.op_type_name() != "momentum_update"
+        && user_op_conf.op_type_name() != "adam_update") {
+      return;
+    }
+    if (op_node->parallel_desc().device_type() != DeviceType::kCUDA) { return; }
+    if (!op_conf.has_scope_symbol_id()) { return; }
+    if (!op_conf.ctrl_in_op_name().empty()) { return; }
+    if (ctrl_in_op_names.find(op_conf.name()) != ctrl_in_op_names.end()) { return; }
+    if (user_op_conf.op_type_name() == "adam_update"
+        && (user_op_conf.attr<bool>("amsgrad") || user_op_conf.has_input("max_v", 0))) {
+      return;
+    }
+    key2update_op_nodes[GenMultiTensorGroupKey(op_node, user_op_conf)].emplace_back(op_node);
+  });
+
+  std::vector<std::string> del_op_names;
+  for (auto& pair : key2update_op_nodes) {
+    std::vector<const OpNode*>& op_nodes = pair.second;
+    if (op_nodes.size() < 2) { continue; }
+    std::sort(op_nodes.begin(), op_nodes.end(), [](const OpNode* lhs, const OpNode* rhs) {
+      return lhs->op().op_name() < rhs->op().op_name();
+    });
+    const user_op::UserOpConfWrapper first_op_conf(op_nodes.front()->op().op_conf());
+    const std::string& op_type_name = first_op_conf.op_type_name();
+    const std::vector<std::string>& state_arg_names = StateArgNames4OpTypeName(op_type_name);
+    user_op::UserOpConfWrapperBuilder multi_tensor_op_builder(
+        "System-Optimizer-MultiTensor-" + op_type_name + "-" + NewUniqueId());
+    multi_tensor_op_builder.OpTypeName("multi_tensor_" + op_type_name);
+    for (const OpNode* op_node : op_nodes) {
+      const user_op::UserOpConfWrapper user_op_conf(op_node->op().op_conf());
+      multi_tensor_op_builder.Input("model", user_op_conf.input("model", 0))
+          .Input("model_diff", user_op_conf.input("model_diff", 0));
+      for (const std::string& state_arg_name : state_arg_names) {
+        multi_tensor_op_builder.Input(state_arg_name, user_op_conf.input(state_arg_name, 0));
+      }
+      del_op_names.emplace_back(op_node->op().op_name());
+    }
+    for (const std::string& arg_name : ScalarArgNames()) {
+      if (first_op_conf.has_input(arg_name, 0)) {
+        multi_tensor_op_builder.Input(arg_name, first_op_conf.input(arg_name, 0));
+      }
+    }
+    multi_tensor_op_builder.ScopeSymbolId(first_op_conf.op_conf().scope_symbol_id());
+    OperatorConf multi_tensor_op_conf = multi_tensor_op_builder.Build().op_conf();
+    // The group key guarantees all grouped ops share these attrs; attrs the multi tensor op does
+    // not have (amsgrad, which is always false here) are dropped.
+    auto* multi_tensor_attrs = multi_tensor_op_conf.mutable_user_conf()->mutable_attr();
+    for (const auto& attr : first_op_conf.op_conf().user_conf().attr()) {
+      auto it = multi_tensor_attrs->find(attr.first);
+      if (it != multi_tensor_attrs->end()) { it->second = attr.second; }
+    }
+    job_builder->AddOps(op_nodes.front()->parallel_desc().parallel_conf(), {multi_tensor_op_conf});
+  }
+  job_builder->DelOps(del_op_names);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("MultiTensorModelUpdatePass", MultiTensorModelUpdatePass);
+
+}  // namespace oneflow
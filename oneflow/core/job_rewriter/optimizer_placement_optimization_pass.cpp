@@ -17,11 +17,19 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/job_pass.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
 
 namespace oneflow {
 
 namespace {
 
+const std::string kRestoreOpNamePrefix = "System-Optimizer-Placement-Restore-";
+const std::string kBackwardRestoreOpNamePrefix = "System-Optimizer-Placement-Backward-Restore-";
+
 int64_t GetSoleOutBlobSize(const OpNode* node) {
   const BlobDesc& blob_desc =
       node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(node->op().SoleObn()));
@@ -101,16 +109,21 @@ Maybe<void> GetDataParallelVariableAndNaiveSuccNode(
   return Maybe<void>::Ok();
 }
 
-void SetBroadcastParallel4OpNodeIbn(JobBuilder* builder, const OpNode* node,
-                                    const std::string& ibn) {
+void SetBroadcastParallel4OpBn(JobBuilder* builder, const std::string& op_name,
+                               const std::string& bn) {
   OpBlobArg op_blob_arg;
-  op_blob_arg.set_op_name(node->op().op_name());
-  op_blob_arg.set_bn_in_op(ibn);
+  op_blob_arg.set_op_name(op_name);
+  op_blob_arg.set_bn_in_op(bn);
   SbpParallel sbp_parallel;
   sbp_parallel.mutable_broadcast_parallel();
   builder->SetSbpParallel4Oba(op_blob_arg, sbp_parallel);
 }
 
+void SetBroadcastParallel4OpNodeIbn(JobBuilder* builder, const OpNode* node,
+                                    const std::string& ibn) {
+  SetBroadcastParallel4OpBn(builder, node->op().op_name(), ibn);
+}
+
 void SetBroadcastParallel4Consumers(JobBuilder* builder, const SequencePtr& sequence) {
   const OpNode* node = sequence->GetLastNode();
   const LogicalBlobId& lbi = node->op().BnInOp2Lbi(node->op().SoleObn());
@@ -123,6 +136,55 @@ void SetBroadcastParallel4Consumers(JobBuilder* builder, const SequencePtr& sequ
   });
 }
 
+// Identity op gathering `in` to Broadcast on `parallel_conf`.
+Maybe<std::string> AddRestoreOp(JobBuilder* builder, const std::string& op_name,
+                                const std::string& in, int64_t scope_symbol_id,
+                                const ParallelConf& parallel_conf,
+                                const std::string& ctrl_in_op_name) {
+  OperatorConf op_conf = user_op::UserOpConfWrapperBuilder(op_name)
+                             .Op("identity")
+                             .Input("in", in)
+                             .Output("out")
+                             .ScopeSymbolId(scope_symbol_id)
+                             .Build()
+                             .op_conf();
+  if (!ctrl_in_op_name.empty()) { op_conf.add_ctrl_in_op_name(ctrl_in_op_name); }
+  JUST(builder->AddOp(parallel_conf, op_conf));
+  SetBroadcastParallel4OpBn(builder, op_name, GenRepeatedBn("in", 0));
+  SetBroadcastParallel4OpBn(builder, op_name, GenRepeatedBn("out", 0));
+  return user_op::UserOpConfWrapper(op_conf).output("out", 0);
+}
+
+// Lets the consumers of the sequence consume a gathered copy made by a restore op instead, so
+// that the backward consumers can be given a copy of their own later.
+Maybe<void> RedirectConsumersToRestoreOp(JobBuilder* builder, const SequencePtr& sequence,
+                                         HashMap<std::string, OperatorConf>* op_name2conf) {
+  const OpNode* node = sequence->GetLastNode();
+  const LogicalBlobId& lbi = node->op().BnInOp2Lbi(node->op().SoleObn());
+  const std::string lbn = GenLogicalBlobName(lbi);
+  std::vector<const OpNode*> consumers;
+  node->ForEachNodeOnOutEdge([&](const OpNode* out_node) { consumers.emplace_back(out_node); });
+  if (consumers.empty()) { return Maybe<void>::Ok(); }
+  const std::string& var_op_name = sequence->GetVariableNode()->op().op_name();
+  const std::string restore_lbn =
+      *JUST(AddRestoreOp(builder, kRestoreOpNamePrefix + var_op_name, lbn,
+                         consumers.front()->op().op_conf().scope_symbol_id(),
+                         sequence->parallel_desc().parallel_conf(), ""));
+  for (const OpNode* consumer : consumers) {
+    const std::string& consumer_name = consumer->op().op_name();
+    auto it = op_name2conf->find(consumer_name);
+    if (it == op_name2conf->end()) {
+      it = op_name2conf->emplace(consumer_name, consumer->op().op_conf()).first;
+    }
+    for (const std::string& ibn : consumer->op().input_bns()) {
+      if (consumer->op().BnInOp2Lbi(ibn) != lbi) { continue; }
+      const std::string old_lbn = ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, restore_lbn);
+      CHECK_EQ_OR_RETURN(old_lbn, lbn);
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
 std::function<int64_t(const OpNode*)> MakeGetterOpNode2TopoOrder(const OpGraph& op_graph) {
   HashMap<const OpNode*, int64_t> op_node2topo_order;
   int64_t node_cnt = 0;
@@ -224,6 +286,9 @@ void ForEachModelSizeBalancedPartition(
 
 Maybe<void> RewriteDistributedSplit(const OpGraph& op_graph, JobBuilder* builder) {
   const int64_t threshold = builder->job().job_conf().optimizer_placement_optimization_threshold();
+  const int64_t restore_level =
+      builder->job().job_conf().optimizer_placement_optimization_shard_restore_level();
+  HashMap<std::string, OperatorConf> consumer_op_name2conf;
   const auto IsAllowed = [threshold](const OpNode* n) -> bool {
     if (n->op().op_conf().has_variable_conf()) {
       const Shape shape(n->op().op_conf().variable_conf().shape());
@@ -252,12 +317,19 @@ Maybe<void> RewriteDistributedSplit(const OpGraph& op_graph, JobBuilder* builder
         new_var_op_conf.add_ctrl_in_op_name(prev_op_name);
       }
       builder->MutOpsOnlyOnce({new_var_op_conf});
-      // Set consumers to consum this variable op's cast op's output as Broadcast.
-      SetBroadcastParallel4Consumers(builder, sorted_sequences.at(i));
+      if (restore_level >= 2) {
+        // Consumers consume the output of a restore op, which gathers it as Broadcast.
+        CHECK_JUST(
+            RedirectConsumersToRestoreOp(builder, sorted_sequences.at(i), &consumer_op_name2conf));
+      } else {
+        // Set consumers to consum this variable op's cast op's output as Broadcast.
+        SetBroadcastParallel4Consumers(builder, sorted_sequences.at(i));
+      }
     }
   };
   ForEachParallelSortedNodeSequence(op_graph, IsAllowed, SequenceCompSortedByOrderAsc,
                                     PlacementSequencesAsSplitParallel);
+  for (const auto& pair : consumer_op_name2conf) { JUST(builder->MutOpOnlyOnce(pair.second)); }
   return Maybe<void>::Ok();
 }
 
@@ -329,7 +401,112 @@ class OptimizerPlacementOptimizationPass final : public JobPass {
   }
 };
 
+bool IsForwardOrBackwardPass(const OpNode* op_node, const std::string& calculation_pass_name) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_scope_symbol_id()
+      || !Global<symbol::Storage<Scope>>::Get()->Has(op_conf.scope_symbol_id())) {
+    return false;
+  }
+  const Scope& scope = Global<symbol::Storage<Scope>>::Get()->Get(op_conf.scope_symbol_id());
+  return scope.scope_proto().calculation_pass_name() == calculation_pass_name;
+}
+
+// Gathers the parameters split by distributed_split once more for their backward consumers, so
+// that the parameters gathered for the forward pass are freed after their last forward use. The
+// gather waits for an op some ops before the first backward consumer to overlap with compute.
+class OptimizerPlacementOptimizationBackwardRestorePass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OptimizerPlacementOptimizationBackwardRestorePass);
+  OptimizerPlacementOptimizationBackwardRestorePass() = default;
+  ~OptimizerPlacementOptimizationBackwardRestorePass() override = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    const JobConfigProto& job_conf = ctx.job_desc().job_conf();
+    return ctx.job_desc().IsTrain() && job_conf.has_optimizer_placement_optimization_mode()
+           && job_conf.optimizer_placement_optimization_mode() == "distributed_split"
+           && job_conf.optimizer_placement_optimization_shard_restore_level() >= 2;
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+};
+
+Maybe<void> OptimizerPlacementOptimizationBackwardRestorePass::Apply(
+    const OpGraph& op_graph, JobBuilder* job_builder) const {
+  const int64_t prefetch_distance =
+      job_builder->job().job_conf().optimizer_placement_optimization_prefetch_distance();
+  CHECK_GE_OR_RETURN(prefetch_distance, 1);
+
+  std::vector<const OpNode*> sorted_nodes;
+  HashMap<const OpNode*, int64_t> node2order;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    CHECK(node2order.emplace(op_node, sorted_nodes.size()).second);
+    sorted_nodes.emplace_back(op_node);
+  });
+
+  HashMap<std::string, OperatorConf> mut_op_name2conf;
+  for (const OpNode* node : sorted_nodes) {
+    const std::string& op_name = node->op().op_name();
+    if (op_name.rfind(kRestoreOpNamePrefix, 0) != 0) { continue; }
+    const LogicalBlobId& lbi = node->op().BnInOp2Lbi(node->op().SoleObn());
+    int64_t last_forward_use = node2order.at(node);
+    int64_t first_backward_use = std::numeric_limits<int64_t>::max();
+    std::vector<const OpNode*> backward_consumers;
+    node->ForEachNodeOnOutEdge([&](const OpNode* consumer) {
+      const int64_t consumer_order = node2order.at(consumer);
+      if (IsForwardOrBackwardPass(consumer, kForwardPass)) {
+        last_forward_use = std::max(last_forward_use, consumer_order);
+      } else if (IsForwardOrBackwardPass(consumer, kBackwardPass)) {
+        first_backward_use = std::min(first_backward_use, consumer_order);
+        backward_consumers.emplace_back(consumer);
+      }
+    });
+    if (backward_consumers.empty()) { continue; }
+    // Keep consuming the forward copy if no op is found to start the gather after, which also
+    // can not depend on the gather since it is before all the consumers in topological order.
+    const OpNode* prefetch_after = nullptr;
+    for (int64_t i = first_backward_use - prefetch_distance; i > last_forward_use; --i) {
+      if (sorted_nodes.at(i)->parallel_desc() == node->parallel_desc()) {
+        prefetch_after = sorted_nodes.at(i);
+        break;
+      }
+    }
+    if (prefetch_after == nullptr) { continue; }
+
+    const std::string lbn = GenLogicalBlobName(lbi);
+    const std::string split_lbn = user_op::UserOpConfWrapper(node->op().op_conf()).input("in", 0);
+    const OpNode* first_backward_consumer = sorted_nodes.at(first_backward_use);
+    const std::string restore_lbn = *JUST(AddRestoreOp(
+        job_builder, kBackwardRestoreOpNamePrefix + op_name.substr(kRestoreOpNamePrefix.size()),
+        split_lbn, first_backward_consumer->op().op_conf().scope_symbol_id(),
+        node->parallel_desc().parallel_conf(), prefetch_after->op().op_name()));
+    for (const OpNode* consumer : backward_consumers) {
+      const std::string& consumer_name = consumer->op().op_name();
+      auto it = mut_op_name2conf.find(consumer_name);
+      if (it == mut_op_name2conf.end()) {
+        it = mut_op_name2conf.emplace(consumer_name, consumer->op().op_conf()).first;
+      }
+      for (const std::string& ibn : consumer->op().input_bns()) {
+        if (consumer->op().BnInOp2Lbi(ibn) != lbi) { continue; }
+        const std::string old_lbn =
+            ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, restore_lbn);
+        CHECK_EQ_OR_RETURN(old_lbn, lbn);
+      }
+    }
+  }
+  for (const auto& pair : mut_op_name2conf) { JUST(job_builder->MutOpOnlyOnce(pair.second)); }
+  return Maybe<void>::Ok();
+}
+
 REGISTER_JOB_PASS("OptimizerPlacementOptimizationPass", OptimizerPlacementOptimizationPass);
+REGISTER_JOB_PASS("OptimizerPlacementOptimizationBackwardRestorePass",
+                  OptimizerPlacementOptimizationBackwardRestorePass);
 
 }  // namespace
 
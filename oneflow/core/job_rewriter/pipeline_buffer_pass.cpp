@@ -224,24 +224,62 @@ void TryInsertOrUseBufferOpBothSrcDst(
   }
 }
 
+// Stages of the same placement run interleaved on the same devices as virtual stages.
+int64_t GetPipelineDeviceGroupNum(
+    const std::map<int64_t, const ParallelDesc*>& stage_id2placement) {
+  std::vector<const ParallelDesc*> placements;
+  for (const auto& pair : stage_id2placement) {
+    const auto IsSamePlacement = [&](const ParallelDesc* placement) {
+      return placement->EqualsIgnoringHierarchy(*pair.second);
+    };
+    if (std::none_of(placements.cbegin(), placements.cend(), IsSamePlacement)) {
+      placements.emplace_back(pair.second);
+    }
+  }
+  return placements.size();
+}
+
 Maybe<void> PipelineBufferPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+  const JobConfigProto& job_conf = GlobalJobDesc().job_conf();
   // Pipeline optimization depends on gradient accumulatioin.
-  if (GlobalJobDesc().job_conf().num_gradient_accumulation_steps() <= 1) {
-    return Maybe<void>::Ok();
-  }
+  if (job_conf.num_gradient_accumulation_steps() <= 1) { return Maybe<void>::Ok(); }
+  const std::string& schedule = job_conf.pipeline_schedule();
+  CHECK_OR_RETURN(schedule.empty() || schedule == "1f1b" || schedule == "interleaved")
+      << "unsupported pipeline schedule: " << schedule;
+  const bool interleaved = schedule == "interleaved";
 
   int64_t max_stage_id = 0;
+  std::map<int64_t, const ParallelDesc*> stage_id2placement;
   op_graph.ForEachNode([&](const OpNode* this_node) {
     if (!OpNodeHasScope(this_node)) {
       LOG(WARNING) << " op : " << this_node->op().op_conf().DebugString() << " has NOT scope!";
       return;
     }
-    max_stage_id = std::max(max_stage_id, GetStageIdHint(this_node));
+    const int64_t stage_id = GetStageIdHint(this_node);
+    max_stage_id = std::max(max_stage_id, stage_id);
+    if (this_node->parallel_desc().device_type() == DeviceType::kCUDA) {
+      stage_id2placement.emplace(stage_id, &this_node->parallel_desc());
+    }
   });
 
   if (max_stage_id == 0) { return Maybe<void>::Ok(); }
   const int64_t total_stage_num = max_stage_id + 1;
   VLOG(3) << "total stage num = " << total_stage_num;
+  if (!schedule.empty()) {
+    // A micro-batch takes each stage once forward and once backward, the bubble is the warmup and
+    // the cooldown of the first and the last device group, shortened by the virtual stages.
+    const int64_t micro_batch_num = job_conf.num_gradient_accumulation_steps();
+    const int64_t device_group_num =
+        std::max<int64_t>(GetPipelineDeviceGroupNum(stage_id2placement), 1);
+    const double virtual_stage_num =
+        interleaved ? static_cast<double>(total_stage_num) / device_group_num : 1.0;
+    const double bubble_ratio =
+        (device_group_num - 1) / (micro_batch_num * virtual_stage_num + device_group_num - 1);
+    LOG(INFO) << "pipeline schedule " << schedule << " of job " << job_conf.job_name() << ": "
+              << total_stage_num << " stages on " << device_group_num << " device groups, "
+              << micro_batch_num << " micro-batches, expected bubble ratio "
+              << bubble_ratio * 100 << "%";
+  }
 
   HashMap<std::string, OperatorConf> buffer_op_name2op_conf;
   HashMap<std::string, ParallelConf> buffer_op_name2parallel_conf;
@@ -268,7 +306,13 @@ Maybe<void> PipelineBufferPass::Apply(const OpGraph& op_graph, JobBuilder* job_b
                        << "). Make sure to change the tensor's placment before it enter the module "
                           "of a next pipeline stage.\n";
         }
-        const int64_t buffer_size = total_stage_num * 2; /* NOTE(chengcheng): max buffer size */
+        /* NOTE(chengcheng): max buffer size */
+        int64_t buffer_size = total_stage_num * 2;
+        if (!schedule.empty()) {
+          // 1F1B: a stage starts the backward pass of a micro-batch once the stages after it
+          // have, so it keeps the activations of at most that many micro-batches.
+          buffer_size = total_stage_num - dst_stage_id;
+        }
         TryInsertOrUseBufferOpToDstNode(in_edge, buffer_size, &buffer_op_name2op_conf,
                                         &buffer_op_name2parallel_conf, &mut_op_name2conf);
       }
@@ -306,8 +350,15 @@ Maybe<void> PipelineBufferPass::Apply(const OpGraph& op_graph, JobBuilder* job_b
          *   dst_buffer_size = dst_stage_id - src_stage_id for pipeline.
          */
         const int64_t dst_buffer_size = dst_stage_id - src_stage_id;
-        TryInsertOrUseBufferOpBothSrcDst(edge, 1, dst_buffer_size, &buffer_op_name2op_conf,
-                                         &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        if (interleaved
+            && src_node->parallel_desc().EqualsIgnoringHierarchy(dst_node->parallel_desc())) {
+          // Virtual stages on the same devices have no copy to overlap.
+          TryInsertOrUseBufferOpToDstNode(edge, dst_buffer_size, &buffer_op_name2op_conf,
+                                          &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        } else {
+          TryInsertOrUseBufferOpBothSrcDst(edge, 1, dst_buffer_size, &buffer_op_name2op_conf,
+                                           &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        }
       }
     }
     if (OpNodeHasScope(src_node) && OpNodeHasScope(dst_node) && IsBackwardPass(src_node)
@@ -316,8 +367,14 @@ Maybe<void> PipelineBufferPass::Apply(const OpGraph& op_graph, JobBuilder* job_b
       const int64_t dst_stage_id = GetStageIdHint(dst_node);
       // NOTE(chengcheng): Backward ONLY need buffer size 1.
       if (src_stage_id > dst_stage_id) {
-        TryInsertOrUseBufferOpBothSrcDst(edge, 1, 1, &buffer_op_name2op_conf,
-                                         &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        if (interleaved
+            && src_node->parallel_desc().EqualsIgnoringHierarchy(dst_node->parallel_desc())) {
+          TryInsertOrUseBufferOpToDstNode(edge, 1, &buffer_op_name2op_conf,
+                                          &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        } else {
+          TryInsertOrUseBufferOpBothSrcDst(edge, 1, 1, &buffer_op_name2op_conf,
+                                           &buffer_op_name2parallel_conf, &mut_op_name2conf);
+        }
       }
     }
   });
@@ -276,7 +276,7 @@ Maybe<user_op::UserOpConfWrapper> MovingMinMaxObserver(
                  GenLogicalBlobName(moving_min_var.name(), moving_min_var.variable_conf().out()))
           .Output("scale")
           .Output("zero_point")
-          .Attr("training", GlobalJobDesc().IsTrain())
+          .Attr("training", GlobalJobDesc().IsTrain() || qat_config.calibration())
           .Attr("stop_update_after_iters", qat_config.moving_min_max_stop_update_after_iters())
           .Attr<std::string>("quantization_formula",
                              *JUST(QuantizationFormulaAttr4QatConfig(qat_config)))
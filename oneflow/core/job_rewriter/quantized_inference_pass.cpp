@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace {
+
+// Replaces the matmuls of an inference job whose inputs are both fake quantized, the activation
+// by a moving average observer and the weight by a min max observer of quantization aware
+// training or of a calibration run, with quantized_matmul computing in int8 with the observed
+// scales.
+class QuantizedInferencePass final : public JobPass {
+ public:
+  QuantizedInferencePass() = default;
+  ~QuantizedInferencePass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_quantization_aware_training()
+           && ctx.job_desc().job_conf().qat_config().int8_inference() && !ctx.job_desc().IsTrain();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+// quantized_matmul implements the symmetric 8 bit quantization of the google formula only.
+const OpNode* FindSymmetricInt8FakeQuantProducer(const OpGraph& op_graph, const std::string& lbn) {
+  const OpNode* producer = op_graph.OpNode4OpName(GenLogicalBlobId(lbn).op_name());
+  const OperatorConf& op_conf = producer->op().op_conf();
+  if (!op_conf.has_user_conf()) { return nullptr; }
+  if (op_conf.user_conf().op_type_name() != "fake_quantization") { return nullptr; }
+  const user_op::UserOpConfWrapper fake_quant(op_conf);
+  if (fake_quant.attr<std::string>("quantization_formula") != "google") { return nullptr; }
+  if (fake_quant.attr<std::string>("quantization_scheme") != "symmetric") { return nullptr; }
+  if (fake_quant.attr<int32_t>("quantization_bit") != 8) { return nullptr; }
+  return producer;
+}
+
+Maybe<void> QuantizedInferencePass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  const OpGraph op_graph(*job);
+  JobBuilder job_builder(job);
+  std::vector<OperatorConf> quantized_matmul_op_confs;
+  HashSet<const OpNode*> fake_quant_nodes;
+  HashSet<std::string> quantized_matmul_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf() || op_conf.user_conf().op_type_name() != "matmul") { return; }
+    const user_op::UserOpConfWrapper matmul(op_conf);
+    if (matmul.attr<bool>("transpose_a") || matmul.has_input("_add_to_output", 0)) { return; }
+    const BlobDesc& a_desc = op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(matmul.input("a", 0)));
+    if (a_desc.shape().NumAxes() != 2 || a_desc.data_type() != DataType::kFloat) { return; }
+    const OpNode* a_fake_quant_node =
+        FindSymmetricInt8FakeQuantProducer(op_graph, matmul.input("a", 0));
+    const OpNode* b_fake_quant_node =
+        FindSymmetricInt8FakeQuantProducer(op_graph, matmul.input("b", 0));
+    if (a_fake_quant_node == nullptr || b_fake_quant_node == nullptr) { return; }
+    const user_op::UserOpConfWrapper a_fake_quant(a_fake_quant_node->op().op_conf());
+    const user_op::UserOpConfWrapper b_fake_quant(b_fake_quant_node->op().op_conf());
+    // Per channel scales of the weight are along its first axis, which is the output channel
+    // only if the weight is transposed.
+    const bool transpose_b = matmul.attr<bool>("transpose_b");
+    const int64_t b_scale_size =
+        op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(b_fake_quant.input("scale", 0)))
+            .shape()
+            .elem_cnt();
+    if (b_scale_size > 1 && !transpose_b) { return; }
+    OperatorConf quantized_matmul_op_conf =
+        user_op::UserOpConfWrapperBuilder(op_conf.name())
+            .Op("quantized_matmul")
+            .Input("a", a_fake_quant.input("in", 0))
+            .Input("b", b_fake_quant.input("in", 0))
+            .Input("a_scale", a_fake_quant.input("scale", 0))
+            .Input("b_scale", b_fake_quant.input("scale", 0))
+            .Output("out")
+            .Attr<bool>("transpose_b", transpose_b)
+            .Attr<double>("alpha", matmul.attr<double>("alpha"))
+            .ScopeSymbolId(op_conf.scope_symbol_id())
+            .Build()
+            .op_conf();
+    *quantized_matmul_op_conf.mutable_ctrl_in_op_name() = op_conf.ctrl_in_op_name();
+    quantized_matmul_op_confs.emplace_back(std::move(quantized_matmul_op_conf));
+    quantized_matmul_op_names.insert(op_conf.name());
+    fake_quant_nodes.insert(a_fake_quant_node);
+    fake_quant_nodes.insert(b_fake_quant_node);
+  });
+  if (quantized_matmul_op_confs.empty()) { return Maybe<void>::Ok(); }
+  // The outputs keep their names, so the consumers of the matmuls are intact.
+  job_builder.MutOpsOnlyOnce(quantized_matmul_op_confs);
+  std::vector<std::string> del_op_names;
+  for (const OpNode* fake_quant_node : fake_quant_nodes) {
+    bool all_consumers_quantized = true;
+    for (const OpEdge* out_edge : fake_quant_node->out_edges()) {
+      if (quantized_matmul_op_names.count(out_edge->dst_node()->op().op_name()) == 0) {
+        all_consumers_quantized = false;
+      }
+    }
+    if (all_consumers_quantized) { del_op_names.emplace_back(fake_quant_node->op().op_name()); }
+  }
+  job_builder.DelOps(del_op_names);
+  VLOG(1) << "replaced " << quantized_matmul_op_confs.size()
+          << " matmuls with quantized_matmul in job " << job->job_conf().job_name();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("QuantizedInferencePass", QuantizedInferencePass);
+
+}  // namespace oneflow
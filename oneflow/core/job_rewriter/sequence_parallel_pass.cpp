@@ -0,0 +1,222 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+const std::string kScatterOpNamePrefix = "System-Sequence-Parallel-Scatter-";
+const std::string kGatherOpNamePrefix = "System-Sequence-Parallel-Gather-";
+
+// Ops computed independently at each position of the sequence, so each rank can run them on its
+// slice of the sequence. layer_norm and bias_add only touch the hidden axis.
+bool IsSequenceWiseOpType(const std::string& op_type_name) {
+  static const HashSet<std::string> op_type_names{
+      "layer_norm", "dropout", "fused_bias_add_mask_scale", "bias_add", "add_n",
+      "cast",       "identity", "scalar_mul"};
+  return op_type_names.find(op_type_name) != op_type_names.end();
+}
+
+bool IsBroadcast(const NdSbp& nd_sbp) {
+  return nd_sbp.sbp_parallel_size() == 1 && nd_sbp.sbp_parallel(0).has_broadcast_parallel();
+}
+
+bool IsPartialSum(const NdSbp& nd_sbp) {
+  return nd_sbp.sbp_parallel_size() == 1 && nd_sbp.sbp_parallel(0).has_partial_sum_parallel();
+}
+
+// Replaces the all-reduce (P to B boxing) after the row parallel matmuls of tensor parallel blocks
+// by a reduce-scatter along the sequence axis. The sequence-wise ops after it, typically the bias
+// add, dropout, residual add and layer norm, run on the slice of the sequence of each rank, and
+// the first consumer outside of them, the next column parallel matmul, gets the activation back
+// by an all-gather. Both are hierarchical_parallel_cast ops, which InsertNcclLogicalOpPass lowers
+// to _nccl_logical_reduce_scatter and _nccl_logical_all_gather when the sequence axis is 0. Their
+// gradients are cast the other way round, so the backward pass communicates the same way.
+class SequenceParallelPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SequenceParallelPass);
+  SequenceParallelPass() = default;
+  ~SequenceParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_sequence_parallel();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder, ctx->job_desc().job_conf().sequence_parallel_axis());
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder, int64_t axis) const;
+};
+
+Maybe<void> SequenceParallelPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder,
+                                        int64_t axis) const {
+  CHECK_GE_OR_RETURN(axis, 0);
+  // An activation has the axes of the blob reduced by the all-reduce, so the weights of the
+  // region are left alone.
+  const auto IsActivation = [&](const OpNode* node, const LogicalBlobId& lbi,
+                                const Shape& activation_shape) -> bool {
+    return node->LogicalBlobDesc4Lbi(lbi).shape() == activation_shape;
+  };
+  const auto IsCandidate = [&](const OpNode* node, const Shape& activation_shape) -> bool {
+    const OperatorConf& op_conf = node->op().op_conf();
+    if (!op_conf.has_user_conf() || !IsSequenceWiseOpType(op_conf.user_conf().op_type_name())) {
+      return false;
+    }
+    for (const std::string& ibn : node->op().input_bns()) {
+      const LogicalBlobId& lbi = node->op().BnInOp2Lbi(ibn);
+      if (IsActivation(node, lbi, activation_shape) && !IsBroadcast(node->NdSbp4BnInOp(ibn))) {
+        return false;
+      }
+    }
+    for (const std::string& obn : node->op().output_bns()) {
+      if (!IsBroadcast(node->NdSbp4BnInOp(obn))) { return false; }
+    }
+    return true;
+  };
+
+  // Seeds consume the output of a partial sum producer as broadcast, the regions grow from them
+  // through the consumers of the same placement.
+  HashMap<const OpNode*, Shape> region2activation_shape;
+  std::vector<const OpNode*> region_nodes;
+  op_graph.TopoForEachNode([&](const OpNode* node) {
+    const ParallelDesc& parallel_desc = node->parallel_desc();
+    if (parallel_desc.device_type() != DeviceType::kCUDA) { return; }
+    if (parallel_desc.hierarchy()->NumAxes() != 1 || parallel_desc.parallel_num() == 1) { return; }
+    for (const std::string& ibn : node->op().input_bns()) {
+      const LogicalBlobId& lbi = node->op().BnInOp2Lbi(ibn);
+      const OpNode& producer = node->SrcNode4Ibn(ibn);
+      if (producer.parallel_desc() != parallel_desc || !IsPartialSum(producer.NdSbp4Lbi(lbi))) {
+        continue;
+      }
+      const Shape& shape = node->LogicalBlobDesc4Lbi(lbi).shape();
+      if (shape.NumAxes() <= axis || shape.At(axis) % parallel_desc.parallel_num() != 0) {
+        continue;
+      }
+      if (region2activation_shape.find(node) != region2activation_shape.end()) { return; }
+      if (!IsCandidate(node, shape)) { return; }
+      std::vector<const OpNode*> stack{node};
+      region2activation_shape.emplace(node, shape);
+      region_nodes.push_back(node);
+      while (!stack.empty()) {
+        const OpNode* cur = stack.back();
+        stack.pop_back();
+        cur->ForEachNodeOnOutEdge([&](const OpNode* consumer) {
+          if (consumer->parallel_desc() != parallel_desc) { return; }
+          if (region2activation_shape.find(consumer) != region2activation_shape.end()) { return; }
+          if (!IsCandidate(consumer, shape)) { return; }
+          region2activation_shape.emplace(consumer, shape);
+          region_nodes.push_back(consumer);
+          stack.push_back(consumer);
+        });
+      }
+      return;
+    }
+  });
+  if (region2activation_shape.empty()) { return Maybe<void>::Ok(); }
+
+  const std::string split = "S(" + std::to_string(axis) + ")";
+  const auto AddCastOp = [&](const std::string& op_name, const std::string& in,
+                             const std::string& nd_sbp, const std::string& grad_nd_sbp,
+                             const OpNode* node) -> std::string {
+    auto cast_op = user_op::UserOpConfWrapperBuilder(op_name)
+                       .Op("hierarchical_parallel_cast")
+                       .Input("in", in)
+                       .Output("out")
+                       .Attr<std::vector<std::string>>("nd_sbp", {nd_sbp})
+                       .Attr<std::string>("grad_mode", "manual")
+                       .Attr<std::vector<std::string>>("grad_nd_sbp", {grad_nd_sbp})
+                       .ScopeSymbolId(node->op().op_conf().scope_symbol_id())
+                       .Build();
+    job_builder->AddOps(node->parallel_desc().parallel_conf(), {cast_op.op_conf()});
+    return cast_op.output("out", 0);
+  };
+  HashMap<std::string, OperatorConf> op_name2conf;
+  const auto MutOpConf = [&](const OpNode* node) -> OperatorConf* {
+    auto it = op_name2conf.find(node->op().op_name());
+    if (it == op_name2conf.end()) {
+      it = op_name2conf.emplace(node->op().op_name(), node->op().op_conf()).first;
+    }
+    return &it->second;
+  };
+  HashMap<std::string, std::string> lbn2scattered_lbn;
+  HashMap<std::string, std::string> lbn2gathered_lbn;
+  for (const OpNode* node : region_nodes) {
+    const Shape& activation_shape = region2activation_shape.at(node);
+    // Scatters the activations coming into the region, a reduce-scatter for partial sums and a
+    // slice for broadcast ones.
+    for (const std::string& ibn : node->op().input_bns()) {
+      const LogicalBlobId& lbi = node->op().BnInOp2Lbi(ibn);
+      if (!IsActivation(node, lbi, activation_shape)) { continue; }
+      const OpNode* producer = &node->SrcNode4Ibn(ibn);
+      if (region2activation_shape.find(producer) != region2activation_shape.end()) { continue; }
+      const std::string lbn = GenLogicalBlobName(lbi);
+      auto it = lbn2scattered_lbn.find(lbn);
+      if (it == lbn2scattered_lbn.end()) {
+        const std::string scattered_lbn =
+            AddCastOp(kScatterOpNamePrefix + lbi.op_name() + "-" + lbi.blob_name(), lbn, split,
+                      "B", node);
+        it = lbn2scattered_lbn.emplace(lbn, scattered_lbn).first;
+      }
+      const std::string old_lbn =
+          ReplaceInputLbnInOpCustomizedConf(MutOpConf(node), ibn, it->second);
+      CHECK_EQ_OR_RETURN(old_lbn, lbn);
+    }
+    // Gathers the outputs consumed outside of the region.
+    for (const std::string& obn : node->op().output_bns()) {
+      const LogicalBlobId& lbi = node->op().BnInOp2Lbi(obn);
+      const std::string lbn = GenLogicalBlobName(lbi);
+      std::vector<const OpNode*> consumers;
+      node->ForEachNodeOnOutEdge([&](const OpNode* consumer) {
+        if (region2activation_shape.find(consumer) != region2activation_shape.end()) { return; }
+        if (std::find(consumers.cbegin(), consumers.cend(), consumer) != consumers.cend()) {
+          return;
+        }
+        consumers.push_back(consumer);
+      });
+      for (const OpNode* consumer : consumers) {
+        for (const std::string& ibn : consumer->op().input_bns()) {
+          if (consumer->op().BnInOp2Lbi(ibn) != lbi) { continue; }
+          auto it = lbn2gathered_lbn.find(lbn);
+          if (it == lbn2gathered_lbn.end()) {
+            const std::string gathered_lbn =
+                AddCastOp(kGatherOpNamePrefix + lbi.op_name() + "-" + lbi.blob_name(), lbn, "B",
+                          split, node);
+            it = lbn2gathered_lbn.emplace(lbn, gathered_lbn).first;
+          }
+          const std::string old_lbn =
+              ReplaceInputLbnInOpCustomizedConf(MutOpConf(consumer), ibn, it->second);
+          CHECK_EQ_OR_RETURN(old_lbn, lbn);
+        }
+      }
+    }
+  }
+  VLOG(1) << "sequence parallel regions cover " << region_nodes.size() << " ops";
+  for (const auto& pair : op_name2conf) { JUST(job_builder->MutOpOnlyOnce(pair.second)); }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("SequenceParallelPass", SequenceParallelPass);
+
+}  // namespace oneflow
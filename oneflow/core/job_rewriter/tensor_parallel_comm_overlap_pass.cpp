@@ -0,0 +1,192 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+bool IsPartialSum(const NdSbp& nd_sbp) {
+  return nd_sbp.sbp_parallel_size() == 1 && nd_sbp.sbp_parallel(0).has_partial_sum_parallel();
+}
+
+bool IsBroadcast(const NdSbp& nd_sbp) {
+  return nd_sbp.sbp_parallel_size() == 1 && nd_sbp.sbp_parallel(0).has_broadcast_parallel();
+}
+
+bool IsSplitAxis0(const NdSbp& nd_sbp) {
+  return nd_sbp.sbp_parallel_size() == 1 && nd_sbp.sbp_parallel(0).has_split_parallel()
+         && nd_sbp.sbp_parallel(0).split_parallel().axis() == 0;
+}
+
+// Splits the row parallel matmuls of tensor parallel blocks, the output of which is a partial
+// sum all-reduced for its consumers, into chunks along the first axis of a. The output of each
+// chunk is all-reduced by a hierarchical_parallel_cast of its own, which InsertNcclLogicalOpPass
+// lowers to a _nccl_logical_all_reduce on the NCCL stream, so the all-reduce of a chunk overlaps
+// the matmul of the next one instead of waiting for the whole matmul. A concat puts the chunks
+// back together for the consumers. The number of chunks keeps each all-reduce at least
+// tensor_parallel_comm_overlap_min_chunk_mbyte, below which NCCL is latency bound.
+class TensorParallelCommOverlapPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TensorParallelCommOverlapPass);
+  TensorParallelCommOverlapPass() = default;
+  ~TensorParallelCommOverlapPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_tensor_parallel_comm_overlap();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, &job_builder);
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+};
+
+Maybe<void> TensorParallelCommOverlapPass::Apply(const OpGraph& op_graph,
+                                                 JobBuilder* job_builder) const {
+  const JobConfigProto& job_conf = job_builder->job().job_conf();
+  const int64_t max_num_chunks = job_conf.tensor_parallel_comm_overlap_max_num_chunks();
+  const int64_t min_chunk_bytes =
+      job_conf.tensor_parallel_comm_overlap_min_chunk_mbyte() * 1024 * 1024;
+  CHECK_GT_OR_RETURN(min_chunk_bytes, 0);
+  HashMap<std::string, OperatorConf> op_name2conf;
+  std::vector<OperatorConf> matmuls_to_delete;
+  op_graph.TopoForEachNode([&](const OpNode* node) {
+    const OperatorConf& op_conf = node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return; }
+    const std::string& op_type_name = op_conf.user_conf().op_type_name();
+    if (op_type_name != "matmul" && op_type_name != "broadcast_matmul") { return; }
+    const ParallelDesc& parallel_desc = node->parallel_desc();
+    if (parallel_desc.device_type() != DeviceType::kCUDA) { return; }
+    if (parallel_desc.hierarchy()->NumAxes() != 1 || parallel_desc.parallel_num() == 1) { return; }
+    // A matmul consuming the output of a rewritten one has had its input redirected already.
+    const auto conf_it = op_name2conf.find(op_conf.name());
+    const user_op::UserOpConfWrapper matmul_op(conf_it == op_name2conf.end() ? op_conf
+                                                                             : conf_it->second);
+    if (matmul_op.has_input("_add_to_output", 0) || matmul_op.attr<bool>("transpose_a")) {
+      return;
+    }
+    const LogicalBlobId out_lbi = GenLogicalBlobId(matmul_op.output("out", 0));
+    if (!IsPartialSum(node->NdSbp4Lbi(out_lbi))) { return; }
+    if (IsSplitAxis0(node->NdSbp4BnInOp(GenRepeatedBn("a", 0)))) { return; }
+    // All the consumers have to take the output all-reduced, so it can be done chunk by chunk.
+    std::vector<const OpNode*> consumers;
+    bool all_broadcast = true;
+    node->ForEachNodeOnOutEdge([&](const OpNode* consumer) {
+      if (std::find(consumers.cbegin(), consumers.cend(), consumer) != consumers.cend()) { return; }
+      consumers.push_back(consumer);
+      for (const std::string& ibn : consumer->op().input_bns()) {
+        if (consumer->op().BnInOp2Lbi(ibn) != out_lbi) { continue; }
+        if (consumer->parallel_desc() != parallel_desc
+            || !IsBroadcast(consumer->NdSbp4BnInOp(ibn))) {
+          all_broadcast = false;
+        }
+      }
+    });
+    if (consumers.empty() || !all_broadcast) { return; }
+    const BlobDesc& a_desc = node->LogicalBlobDesc4Lbi(GenLogicalBlobId(matmul_op.input("a", 0)));
+    const BlobDesc& out_desc = node->LogicalBlobDesc4Lbi(out_lbi);
+    const int64_t dim0 = a_desc.shape().At(0);
+    const int64_t out_bytes = out_desc.shape().elem_cnt() * GetSizeOfDataType(out_desc.data_type());
+    const int64_t num_chunks = std::min({max_num_chunks, out_bytes / min_chunk_bytes, dim0});
+    if (num_chunks <= 1) { return; }
+
+    const std::string op_name = matmul_op.op_name();
+    const int64_t scope_symbol_id = op_conf.scope_symbol_id();
+    const ParallelConf& parallel_conf = parallel_desc.parallel_conf();
+    const int64_t num_axes = a_desc.shape().NumAxes();
+    std::vector<std::string> chunk_lbns;
+    for (int64_t i = 0; i < num_chunks; ++i) {
+      const std::string suffix = "-overlap_chunk" + std::to_string(i);
+      std::vector<int64_t> start(num_axes, 0);
+      std::vector<int64_t> stop(a_desc.shape().dim_vec().cbegin(), a_desc.shape().dim_vec().cend());
+      const std::vector<int64_t> step(num_axes, 1);
+      start.at(0) = dim0 * i / num_chunks;
+      stop.at(0) = dim0 * (i + 1) / num_chunks;
+      auto slice_op = user_op::UserOpConfWrapperBuilder(op_name + suffix + "-slice")
+                          .Op("slice")
+                          .Input("x", matmul_op.input("a", 0))
+                          .Output("y")
+                          .Attr<std::vector<int64_t>>("start", start)
+                          .Attr<std::vector<int64_t>>("stop", stop)
+                          .Attr<std::vector<int64_t>>("step", step)
+                          .ScopeSymbolId(scope_symbol_id)
+                          .Build();
+      auto chunk_matmul_op = user_op::UserOpConfWrapperBuilder(op_name + suffix)
+                                 .Op(op_type_name)
+                                 .Input("a", slice_op.output("y", 0))
+                                 .Input("b", matmul_op.input("b", 0))
+                                 .Output("out")
+                                 .Attr<bool>("transpose_a", false)
+                                 .Attr<bool>("transpose_b", matmul_op.attr<bool>("transpose_b"))
+                                 .Attr<double>("alpha", matmul_op.attr<double>("alpha"))
+                                 .ScopeSymbolId(scope_symbol_id)
+                                 .Build();
+      auto all_reduce_op = user_op::UserOpConfWrapperBuilder(op_name + suffix + "-all_reduce")
+                               .Op("hierarchical_parallel_cast")
+                               .Input("in", chunk_matmul_op.output("out", 0))
+                               .Output("out")
+                               .Attr<std::vector<std::string>>("nd_sbp", {"B"})
+                               .Attr<std::string>("grad_mode", "manual")
+                               .Attr<std::vector<std::string>>("grad_nd_sbp", {"B"})
+                               .ScopeSymbolId(scope_symbol_id)
+                               .Build();
+      job_builder->AddOps(parallel_conf, {slice_op.op_conf(), chunk_matmul_op.op_conf(),
+                                          all_reduce_op.op_conf()});
+      chunk_lbns.push_back(all_reduce_op.output("out", 0));
+    }
+    auto concat_op = user_op::UserOpConfWrapperBuilder(op_name + "-overlap_concat")
+                         .Op("concat")
+                         .Input("in", chunk_lbns)
+                         .Output("out")
+                         .Attr<int64_t>("axis", 0)
+                         .Attr<int64_t>("max_dim_size", out_desc.shape().At(0))
+                         .ScopeSymbolId(scope_symbol_id)
+                         .Build();
+    job_builder->AddOps(parallel_conf, {concat_op.op_conf()});
+    const std::string out_lbn = GenLogicalBlobName(out_lbi);
+    for (const OpNode* consumer : consumers) {
+      auto it = op_name2conf.find(consumer->op().op_name());
+      if (it == op_name2conf.end()) {
+        it = op_name2conf.emplace(consumer->op().op_name(), consumer->op().op_conf()).first;
+      }
+      for (const std::string& ibn : consumer->op().input_bns()) {
+        if (consumer->op().BnInOp2Lbi(ibn) != out_lbi) { continue; }
+        const std::string old_lbn =
+            ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, concat_op.output("out", 0));
+        CHECK_EQ(old_lbn, out_lbn);
+      }
+    }
+    op_name2conf.erase(op_name);
+    matmuls_to_delete.push_back(op_conf);
+    VLOG(1) << "overlap the all-reduce of " << op_name << " in " << num_chunks << " chunks";
+  });
+  for (const auto& pair : op_name2conf) { JUST(job_builder->MutOpOnlyOnce(pair.second)); }
+  job_builder->DelOps(matmuls_to_delete);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("TensorParallelCommOverlapPass", TensorParallelCommOverlapPass);
+
+}  // namespace oneflow
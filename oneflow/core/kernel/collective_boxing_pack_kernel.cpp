@@ -16,9 +16,62 @@ limitations under the License.
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/ep/include/primitive/permute.h"
+#include "oneflow/core/ep/include/primitive/copy_nd.h"
+#include "oneflow/core/common/balanced_splitter.h"
 
 namespace oneflow {
 
+namespace {
+
+bool IsUnevenS2S(const CollectiveBoxingPackOpConf& pack_conf) {
+  if (!(pack_conf.src_sbp_parallel().has_split_parallel()
+        && pack_conf.dst_sbp_parallel().has_split_parallel())) {
+    return false;
+  }
+  const Shape logical_shape(pack_conf.logical_shape());
+  const int64_t num_ranks = pack_conf.num_ranks();
+  return logical_shape.At(pack_conf.src_sbp_parallel().split_parallel().axis()) % num_ranks != 0
+         || logical_shape.At(pack_conf.dst_sbp_parallel().split_parallel().axis()) % num_ranks != 0;
+}
+
+// Copies the slice of `in` for each dst rank into consecutive blocks of `out`.
+void UnevenS2SPack(ep::Stream* stream, const CollectiveBoxingPackOpConf& pack_conf, const Blob* in,
+                   Blob* out) {
+  CHECK(pack_conf.has_rank());
+  const int64_t num_ranks = pack_conf.num_ranks();
+  const int64_t src_split_axis = pack_conf.src_sbp_parallel().split_parallel().axis();
+  const int64_t dst_split_axis = pack_conf.dst_sbp_parallel().split_parallel().axis();
+  const Shape logical_shape(pack_conf.logical_shape());
+  const BalancedSplitter src_bs(logical_shape.At(src_split_axis), num_ranks);
+  const BalancedSplitter dst_bs(logical_shape.At(dst_split_axis), num_ranks);
+  DimVector in_dim_vec = logical_shape.dim_vec();
+  in_dim_vec[src_split_axis] = src_bs.At(pack_conf.rank()).size();
+  CHECK_EQ(Shape(in_dim_vec).elem_cnt(), in->shape().elem_cnt());
+  const int64_t num_dims = in_dim_vec.size();
+  auto copy_nd = ep::primitive::NewPrimitive<ep::primitive::CopyNdFactory>(stream->device_type(),
+                                                                            num_dims);
+  CHECK(copy_nd);
+  const DimVector zeros(num_dims, 0);
+  const int64_t size_of_data_type = GetSizeOfDataType(in->data_type());
+  int64_t offset = 0;
+  FOR_RANGE(int64_t, dst_rank, 0, num_ranks) {
+    DimVector block_dim_vec = in_dim_vec;
+    block_dim_vec[dst_split_axis] = dst_bs.At(dst_rank).size();
+    const int64_t block_elem_cnt = Shape(block_dim_vec).elem_cnt();
+    if (block_elem_cnt == 0) { continue; }
+    DimVector src_pos(num_dims, 0);
+    src_pos[dst_split_axis] = dst_bs.At(dst_rank).begin();
+    copy_nd->Launch(stream, in->data_type(), num_dims,
+                    out->mut_dptr<char>() + offset * size_of_data_type, block_dim_vec.data(),
+                    zeros.data(), in->dptr(), in_dim_vec.data(), src_pos.data(),
+                    block_dim_vec.data());
+    offset += block_elem_cnt;
+  }
+  CHECK_EQ(offset, out->shape().elem_cnt());
+}
+
+}  // namespace
+
 class CollectiveBoxingPackKernel final : public Kernel {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingPackKernel);
@@ -34,6 +87,10 @@ void CollectiveBoxingPackKernel::ForwardDataContent(KernelContext* ctx) const {
   const Blob* in = ctx->BnInOp2Blob("in");
   Blob* out = ctx->BnInOp2Blob("out");
   const CollectiveBoxingPackOpConf& pack_conf = this->op_conf().collective_boxing_pack_conf();
+  if (IsUnevenS2S(pack_conf)) {
+    UnevenS2SPack(ctx->stream(), pack_conf, in, out);
+    return;
+  }
   const int64_t num_ranks = pack_conf.num_ranks();
   const Shape logical_shape(pack_conf.logical_shape());
   const bool need_transpose = !((pack_conf.dst_sbp_parallel().has_split_parallel()
@@ -16,9 +16,62 @@ limitations under the License.
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/ep/include/primitive/permute.h"
+#include "oneflow/core/ep/include/primitive/copy_nd.h"
+#include "oneflow/core/common/balanced_splitter.h"
 
 namespace oneflow {
 
+namespace {
+
+bool IsUnevenS2S(const CollectiveBoxingUnpackOpConf& unpack_conf) {
+  if (!(unpack_conf.src_sbp_parallel().has_split_parallel()
+        && unpack_conf.dst_sbp_parallel().has_split_parallel())) {
+    return false;
+  }
+  const Shape logical_shape(unpack_conf.logical_shape());
+  const int64_t num_ranks = unpack_conf.num_ranks();
+  return logical_shape.At(unpack_conf.src_sbp_parallel().split_parallel().axis()) % num_ranks != 0
+         || logical_shape.At(unpack_conf.dst_sbp_parallel().split_parallel().axis()) % num_ranks
+                != 0;
+}
+
+// Copies the consecutive blocks of `in`, one from each src rank, into their slices of `out`.
+void UnevenS2SUnpack(ep::Stream* stream, const CollectiveBoxingUnpackOpConf& unpack_conf,
+                     const Blob* in, Blob* out) {
+  CHECK(unpack_conf.has_rank());
+  const int64_t num_ranks = unpack_conf.num_ranks();
+  const int64_t src_split_axis = unpack_conf.src_sbp_parallel().split_parallel().axis();
+  const int64_t dst_split_axis = unpack_conf.dst_sbp_parallel().split_parallel().axis();
+  const Shape logical_shape(unpack_conf.logical_shape());
+  const BalancedSplitter src_bs(logical_shape.At(src_split_axis), num_ranks);
+  const BalancedSplitter dst_bs(logical_shape.At(dst_split_axis), num_ranks);
+  DimVector out_dim_vec = logical_shape.dim_vec();
+  out_dim_vec[dst_split_axis] = dst_bs.At(unpack_conf.rank()).size();
+  CHECK_EQ(Shape(out_dim_vec).elem_cnt(), out->shape().elem_cnt());
+  const int64_t num_dims = out_dim_vec.size();
+  auto copy_nd = ep::primitive::NewPrimitive<ep::primitive::CopyNdFactory>(stream->device_type(),
+                                                                            num_dims);
+  CHECK(copy_nd);
+  const DimVector zeros(num_dims, 0);
+  const int64_t size_of_data_type = GetSizeOfDataType(in->data_type());
+  int64_t offset = 0;
+  FOR_RANGE(int64_t, src_rank, 0, num_ranks) {
+    DimVector block_dim_vec = out_dim_vec;
+    block_dim_vec[src_split_axis] = src_bs.At(src_rank).size();
+    const int64_t block_elem_cnt = Shape(block_dim_vec).elem_cnt();
+    if (block_elem_cnt == 0) { continue; }
+    DimVector dst_pos(num_dims, 0);
+    dst_pos[src_split_axis] = src_bs.At(src_rank).begin();
+    copy_nd->Launch(stream, in->data_type(), num_dims, out->mut_dptr(), out_dim_vec.data(),
+                    dst_pos.data(), in->dptr<char>() + offset * size_of_data_type,
+                    block_dim_vec.data(), zeros.data(), block_dim_vec.data());
+    offset += block_elem_cnt;
+  }
+  CHECK_EQ(offset, in->shape().elem_cnt());
+}
+
+}  // namespace
+
 class CollectiveBoxingUnpackKernel final : public Kernel {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CollectiveBoxingUnpackKernel);
@@ -34,6 +87,10 @@ void CollectiveBoxingUnpackKernel::ForwardDataContent(KernelContext* ctx) const
   const Blob* in = ctx->BnInOp2Blob("in");
   Blob* out = ctx->BnInOp2Blob("out");
   const CollectiveBoxingUnpackOpConf& unpack_conf = this->op_conf().collective_boxing_unpack_conf();
+  if (IsUnevenS2S(unpack_conf)) {
+    UnevenS2SUnpack(ctx->stream(), unpack_conf, in, out);
+    return;
+  }
   const int64_t num_ranks = unpack_conf.num_ranks();
   const Shape logical_shape(unpack_conf.logical_shape());
   const bool need_transpose = !((unpack_conf.src_sbp_parallel().has_split_parallel()
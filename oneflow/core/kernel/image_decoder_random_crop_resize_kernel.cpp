@@ -22,12 +22,14 @@ limitations under the License.
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/jpeg_decoder.h"
+#include "oneflow/user/image/image_normalize_util.h"
 #include <opencv2/opencv.hpp>
 #include <jpeglib.h>
 
 #ifdef WITH_CUDA
 
 #include <cuda.h>
+#include "oneflow/core/vm/cuda_host_allocator.h"
 
 #if CUDA_VERSION >= 10020
 
@@ -49,7 +51,7 @@ constexpr int kNumChannels = 3;
 struct Task {
   const unsigned char* data;
   size_t length;
-  unsigned char* dst;
+  void* dst;
   RandomCropGenerator* crop_generator;
 };
 
@@ -123,6 +125,10 @@ class DecodeHandle {
                                       RandomCropGenerator* crop_generator, unsigned char* workspace,
                                       size_t workspace_size, unsigned char* dst, int target_width,
                                       int target_height) = 0;
+  virtual void Normalize(const unsigned char* src, float* dst, int64_t num_pixels,
+                         const ImageNormalizeParam& param) = 0;
+  // A buffer of one target image on the device of the handle, the source of Normalize.
+  virtual unsigned char* MutStagingBuffer() = 0;
   virtual void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) = 0;
   virtual void Synchronize() = 0;
 };
@@ -135,18 +141,28 @@ class CpuDecodeHandle final : public DecodeHandle {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuDecodeHandle);
   CpuDecodeHandle() = default;
+  CpuDecodeHandle(int target_width, int target_height)
+      : staging_buffer_(target_width * target_height * kNumChannels) {}
   ~CpuDecodeHandle() override = default;
 
   void DecodeRandomCropResize(const unsigned char* data, size_t length,
                               RandomCropGenerator* crop_generator, unsigned char* workspace,
                               size_t workspace_size, unsigned char* dst, int target_width,
                               int target_height) override;
+  void Normalize(const unsigned char* src, float* dst, int64_t num_pixels,
+                 const ImageNormalizeParam& param) override {
+    NormalizeImageNHWC(src, dst, num_pixels, param);
+  }
+  unsigned char* MutStagingBuffer() override { return staging_buffer_.data(); }
   void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) override {
     // do nothing
   }
   void Synchronize() override {
     // do nothing
   }
+
+ private:
+  std::vector<unsigned char> staging_buffer_;
 };
 
 bool CpuJpegDecodeRandomCropResize(const unsigned char* data, size_t length,
@@ -200,7 +216,9 @@ void CpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t l
 template<>
 DecodeHandleFactory CreateDecodeHandleFactory<DeviceType::kCPU>(int target_width,
                                                                 int target_height) {
-  return []() -> std::shared_ptr<DecodeHandle> { return std::make_shared<CpuDecodeHandle>(); };
+  return [target_width, target_height]() -> std::shared_ptr<DecodeHandle> {
+    return std::make_shared<CpuDecodeHandle>(target_width, target_height);
+  };
 }
 
 #if defined(WITH_NVJPEG)
@@ -209,11 +227,28 @@ int GpuDeviceMalloc(void** p, size_t s) { return (int)cudaMalloc(p, s); }
 
 int GpuDeviceFree(void* p) { return (int)cudaFree(p); }
 
+// Pinned buffers of nvjpeg come from the host memory pool shared with the D2H streams, the pool is
+// kept alive by GpuDecodeHandle. Its memory is portable, which covers any `flags`.
 int GpuPinnedMalloc(void** p, size_t s, unsigned int flags) {
-  return (int)cudaHostAlloc(p, s, flags);
+  if (s == 0) {
+    *p = nullptr;
+    return 0;
+  }
+  int dev = 0;
+  OF_CUDA_CHECK(cudaGetDevice(&dev));
+  char* ptr = nullptr;
+  vm::GetSharedCudaHostAllocator(dev)->Allocate(&ptr, s);
+  *p = ptr;
+  return 0;
 }
 
-int GpuPinnedFree(void* p) { return (int)cudaFreeHost(p); }
+int GpuPinnedFree(void* p) {
+  if (p == nullptr) { return 0; }
+  int dev = 0;
+  OF_CUDA_CHECK(cudaGetDevice(&dev));
+  vm::GetSharedCudaHostAllocator(dev)->Deallocate(static_cast<char*>(p), 0);
+  return 0;
+}
 
 void InitNppStreamContext(NppStreamContext* ctx, int dev, cudaStream_t stream) {
   ctx->hStream = stream;
@@ -234,6 +269,8 @@ void InitNppStreamContext(NppStreamContext* ctx, int dev, cudaStream_t stream) {
   OF_CUDA_CHECK(cudaStreamGetFlags(stream, &ctx->nStreamFlags));
 }
 
+constexpr int kNumDecodeStages = 2;
+
 class GpuDecodeHandle final : public DecodeHandle {
  public:
   OF_DISALLOW_COPY_AND_MOVE(GpuDecodeHandle);
@@ -244,6 +281,11 @@ class GpuDecodeHandle final : public DecodeHandle {
                               RandomCropGenerator* crop_generator, unsigned char* workspace,
                               size_t workspace_size, unsigned char* dst, int target_width,
                               int target_height) override;
+  void Normalize(const unsigned char* src, float* dst, int64_t num_pixels,
+                 const ImageNormalizeParam& param) override {
+    NormalizeImageNHWC(cuda_stream_, src, dst, num_pixels, param);
+  }
+  unsigned char* MutStagingBuffer() override { return staging_buffer_; }
   void WarmupOnce(int warmup_size, unsigned char* workspace, size_t workspace_size) override;
   void Synchronize() override;
 
@@ -255,28 +297,37 @@ class GpuDecodeHandle final : public DecodeHandle {
   void CropResize(const unsigned char* src, int src_width, int src_height,
                   ROIGenerator* roi_generator, unsigned char* dst, int dst_width, int dst_height);
 
+  std::shared_ptr<vm::CudaHostAllocator> host_allocator_;
   cudaStream_t cuda_stream_ = nullptr;
   nvjpegHandle_t jpeg_handle_ = nullptr;
   nvjpegJpegState_t jpeg_state_ = nullptr;
   nvjpegJpegState_t hw_jpeg_state_ = nullptr;
-  nvjpegBufferPinned_t jpeg_pinned_buffer_ = nullptr;
+  // The host (Huffman) phase of an image runs while the device phase of the previous one is still
+  // in flight, each stage has its own bitstream and pinned buffer, guarded by an event recorded
+  // after the buffer is transferred to the device.
+  nvjpegBufferPinned_t jpeg_pinned_buffers_[kNumDecodeStages]{};
+  nvjpegJpegStream_t jpeg_streams_[kNumDecodeStages]{};
+  cudaEvent_t pinned_buffer_events_[kNumDecodeStages]{};
+  int stage_ = 0;
   nvjpegBufferDevice_t jpeg_device_buffer_ = nullptr;
   nvjpegDecodeParams_t jpeg_decode_params_ = nullptr;
   nvjpegJpegDecoder_t jpeg_decoder_ = nullptr;
   nvjpegJpegDecoder_t hw_jpeg_decoder_ = nullptr;
-  nvjpegJpegStream_t jpeg_stream_ = nullptr;
   NppStreamContext npp_stream_ctx_{};
   nvjpegDevAllocator_t dev_allocator_{};
   nvjpegPinnedAllocator_t pinned_allocator_{};
   CpuDecodeHandle fallback_handle_;
   unsigned char* fallback_buffer_;
   size_t fallback_buffer_size_;
+  unsigned char* staging_buffer_;
   bool warmup_done_;
   bool use_hardware_acceleration_;
 };
 
 GpuDecodeHandle::GpuDecodeHandle(int dev, int target_width, int target_height)
-    : warmup_done_(false), use_hardware_acceleration_(false) {
+    : host_allocator_(vm::GetSharedCudaHostAllocator(dev)),
+      warmup_done_(false),
+      use_hardware_acceleration_(false) {
   OF_CUDA_CHECK(cudaStreamCreateWithFlags(&cuda_stream_, cudaStreamNonBlocking));
   dev_allocator_.dev_malloc = &GpuDeviceMalloc;
   dev_allocator_.dev_free = &GpuDeviceFree;
@@ -297,21 +348,29 @@ GpuDecodeHandle::GpuDecodeHandle(int dev, int target_width, int target_height)
     hw_jpeg_state_ = nullptr;
   }
 #endif
-  OF_NVJPEG_CHECK(nvjpegBufferPinnedCreate(jpeg_handle_, &pinned_allocator_, &jpeg_pinned_buffer_));
+  for (int i = 0; i < kNumDecodeStages; ++i) {
+    OF_NVJPEG_CHECK(
+        nvjpegBufferPinnedCreate(jpeg_handle_, &pinned_allocator_, &jpeg_pinned_buffers_[i]));
+    OF_NVJPEG_CHECK(nvjpegJpegStreamCreate(jpeg_handle_, &jpeg_streams_[i]));
+    OF_CUDA_CHECK(cudaEventCreateWithFlags(&pinned_buffer_events_[i], cudaEventDisableTiming));
+  }
   OF_NVJPEG_CHECK(nvjpegBufferDeviceCreate(jpeg_handle_, &dev_allocator_, &jpeg_device_buffer_));
   OF_NVJPEG_CHECK(nvjpegDecodeParamsCreate(jpeg_handle_, &jpeg_decode_params_));
-  OF_NVJPEG_CHECK(nvjpegJpegStreamCreate(jpeg_handle_, &jpeg_stream_));
   InitNppStreamContext(&npp_stream_ctx_, dev, cuda_stream_);
   fallback_buffer_size_ = target_width * target_height * kNumChannels;
   OF_CUDA_CHECK(cudaMallocHost(&fallback_buffer_, fallback_buffer_size_));
+  OF_CUDA_CHECK(cudaMalloc(&staging_buffer_, fallback_buffer_size_));
 }
 
 GpuDecodeHandle::~GpuDecodeHandle() {
   OF_CUDA_CHECK(cudaStreamSynchronize(cuda_stream_));
-  OF_NVJPEG_CHECK(nvjpegJpegStreamDestroy(jpeg_stream_));
   OF_NVJPEG_CHECK(nvjpegDecodeParamsDestroy(jpeg_decode_params_));
   OF_NVJPEG_CHECK(nvjpegBufferDeviceDestroy(jpeg_device_buffer_));
-  OF_NVJPEG_CHECK(nvjpegBufferPinnedDestroy(jpeg_pinned_buffer_));
+  for (int i = 0; i < kNumDecodeStages; ++i) {
+    OF_NVJPEG_CHECK(nvjpegJpegStreamDestroy(jpeg_streams_[i]));
+    OF_NVJPEG_CHECK(nvjpegBufferPinnedDestroy(jpeg_pinned_buffers_[i]));
+    OF_CUDA_CHECK(cudaEventDestroy(pinned_buffer_events_[i]));
+  }
   OF_NVJPEG_CHECK(nvjpegJpegStateDestroy(jpeg_state_));
   OF_NVJPEG_CHECK(nvjpegDecoderDestroy(jpeg_decoder_));
   if (use_hardware_acceleration_) {
@@ -321,16 +380,20 @@ GpuDecodeHandle::~GpuDecodeHandle() {
   OF_NVJPEG_CHECK(nvjpegDestroy(jpeg_handle_));
   OF_CUDA_CHECK(cudaStreamDestroy(cuda_stream_));
   OF_CUDA_CHECK(cudaFreeHost(fallback_buffer_));
+  OF_CUDA_CHECK(cudaFree(staging_buffer_));
 }
 
 void GpuDecodeHandle::DecodeRandomCrop(const unsigned char* data, size_t length,
                                        ROIGenerator* roi_generator, unsigned char* dst,
                                        size_t dst_max_length, int* dst_width, int* dst_height) {
   // https://docs.nvidia.com/cuda/archive/10.2/nvjpeg/index.html#nvjpeg-decoupled-decode-api
-  OF_NVJPEG_CHECK(nvjpegJpegStreamParse(jpeg_handle_, data, length, 0, 0, jpeg_stream_));
+  const int stage = stage_;
+  stage_ = (stage_ + 1) % kNumDecodeStages;
+  nvjpegJpegStream_t jpeg_stream = jpeg_streams_[stage];
+  OF_NVJPEG_CHECK(nvjpegJpegStreamParse(jpeg_handle_, data, length, 0, 0, jpeg_stream));
   unsigned int orig_width;
   unsigned int orig_height;
-  OF_NVJPEG_CHECK(nvjpegJpegStreamGetFrameDimensions(jpeg_stream_, &orig_width, &orig_height));
+  OF_NVJPEG_CHECK(nvjpegJpegStreamGetFrameDimensions(jpeg_stream, &orig_width, &orig_height));
   ROI roi;
   roi_generator->Generate(static_cast<int>(orig_width), static_cast<int>(orig_height), &roi);
   CHECK_LE(roi.w * roi.h * kNumChannels, dst_max_length);
@@ -343,7 +406,7 @@ void GpuDecodeHandle::DecodeRandomCrop(const unsigned char* data, size_t length,
   nvjpegJpegState_t jpeg_state;
   int is_hardware_acceleration_supported = -1;
   if (use_hardware_acceleration_) {
-    nvjpegDecoderJpegSupported(hw_jpeg_decoder_, jpeg_stream_, jpeg_decode_params_,
+    nvjpegDecoderJpegSupported(hw_jpeg_decoder_, jpeg_stream, jpeg_decode_params_,
                                &is_hardware_acceleration_supported);
   }
   if (is_hardware_acceleration_supported == 0) {
@@ -357,12 +420,15 @@ void GpuDecodeHandle::DecodeRandomCrop(const unsigned char* data, size_t length,
     // hardware_acceleration not support nvjpegDecodeParamsSetROI
     OF_NVJPEG_CHECK(nvjpegDecodeParamsSetROI(jpeg_decode_params_, roi.x, roi.y, roi.w, roi.h));
   }
-  OF_NVJPEG_CHECK(nvjpegStateAttachPinnedBuffer(jpeg_state, jpeg_pinned_buffer_));
+  // Wait until the last transfer out of this pinned buffer is done before overwriting it.
+  OF_CUDA_CHECK(cudaEventSynchronize(pinned_buffer_events_[stage]));
+  OF_NVJPEG_CHECK(nvjpegStateAttachPinnedBuffer(jpeg_state, jpeg_pinned_buffers_[stage]));
   OF_NVJPEG_CHECK(nvjpegStateAttachDeviceBuffer(jpeg_state, jpeg_device_buffer_));
   OF_NVJPEG_CHECK(nvjpegDecodeJpegHost(jpeg_handle_, jpeg_decoder, jpeg_state, jpeg_decode_params_,
-                                       jpeg_stream_));
+                                       jpeg_stream));
   OF_NVJPEG_CHECK(nvjpegDecodeJpegTransferToDevice(jpeg_handle_, jpeg_decoder, jpeg_state,
-                                                   jpeg_stream_, cuda_stream_));
+                                                   jpeg_stream, cuda_stream_));
+  OF_CUDA_CHECK(cudaEventRecord(pinned_buffer_events_[stage], cuda_stream_));
   OF_NVJPEG_CHECK(
       nvjpegDecodeJpegDevice(jpeg_handle_, jpeg_decoder, jpeg_state, &image, cuda_stream_));
   *dst_width = roi.w;
@@ -420,6 +486,8 @@ void GpuDecodeHandle::DecodeRandomCropResize(const unsigned char* data, size_t l
                                              &subsampling, &width, &height);
   if (status != NVJPEG_STATUS_SUCCESS) {
     CHECK_LE(target_width * target_height * kNumChannels, fallback_buffer_size_);
+    // The previous copy out of the fallback buffer may still be in flight.
+    Synchronize();
     fallback_handle_.DecodeRandomCropResize(data, length, crop_generator, nullptr, 0,
                                             fallback_buffer_, target_width, target_height);
     OF_CUDA_CHECK(cudaMemcpyAsync(dst, fallback_buffer_,
@@ -482,7 +550,9 @@ class Worker final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Worker);
   Worker(const std::function<std::shared_ptr<DecodeHandle>()>& handle_factory, int target_width,
-         int target_height, int warmup_size) {
+         int target_height, int warmup_size, const ImageNormalizeParam* normalize_param)
+      : normalize_(normalize_param != nullptr) {
+    if (normalize_) { normalize_param_ = *normalize_param; }
     worker_thread_ = std::thread(&Worker::PollWork, this, handle_factory, target_width,
                                  target_height, warmup_size);
   }
@@ -496,6 +566,8 @@ class Worker final {
  private:
   Channel<std::shared_ptr<Work>> work_queue_;
   std::thread worker_thread_;
+  bool normalize_;
+  ImageNormalizeParam normalize_param_{};
 
   void PollWork(const std::function<std::shared_ptr<DecodeHandle>()>& handle_factory,
                 int target_width, int target_height, int warmup_size) {
@@ -511,10 +583,22 @@ class Worker final {
         const int task_id = work->task_counter->fetch_add(1, std::memory_order_relaxed);
         if (task_id >= work->tasks->size()) { break; }
         const Task& task = work->tasks->at(task_id);
-        handle->DecodeRandomCropResize(task.data, task.length, task.crop_generator, work->workspace,
-                                       work->workspace_size, task.dst, target_width, target_height);
-        handle->Synchronize();
+        if (normalize_) {
+          unsigned char* staging = handle->MutStagingBuffer();
+          handle->DecodeRandomCropResize(task.data, task.length, task.crop_generator,
+                                         work->workspace, work->workspace_size, staging,
+                                         target_width, target_height);
+          handle->Normalize(staging, static_cast<float*>(task.dst),
+                            static_cast<int64_t>(target_width) * target_height, normalize_param_);
+        } else {
+          handle->DecodeRandomCropResize(task.data, task.length, task.crop_generator,
+                                         work->workspace, work->workspace_size,
+                                         static_cast<unsigned char*>(task.dst), target_width,
+                                         target_height);
+        }
       }
+      // Images are decoded back to back on the stream of the handle, wait once per batch.
+      handle->Synchronize();
       work->done_counter->Decrease();
     }
   }
@@ -559,11 +643,22 @@ void ImageDecoderRandomCropResizeKernel<device_type>::VirtualKernelInit(KernelCo
     random_crop_generators_.at(i).reset(
         new RandomCropGenerator(aspect_ratio_range, area_range, seeds.at(i), conf.num_attempts()));
   }
+  ImageNormalizeParam normalize_param{};
+  const bool normalize = conf.mean_size() > 0;
+  if (normalize) {
+    CHECK_EQ(conf.mean_size(), kNumChannels);
+    CHECK_EQ(conf.std_size(), kNumChannels);
+    for (int c = 0; c < kNumChannels; ++c) {
+      normalize_param.mean[c] = conf.mean(c);
+      normalize_param.inv_std[c] = 1.0f / conf.std(c);
+    }
+  }
   workers_.resize(conf.num_workers());
   for (int64_t i = 0; i < conf.num_workers(); ++i) {
     workers_.at(i).reset(new Worker(
         CreateDecodeHandleFactory<device_type>(conf.target_width(), conf.target_height()),
-        conf.target_width(), conf.target_height(), conf.warmup_size()));
+        conf.target_width(), conf.target_height(), conf.warmup_size(),
+        normalize ? &normalize_param : nullptr));
   }
 }
 
@@ -575,7 +670,7 @@ void ImageDecoderRandomCropResizeKernel<device_type>::ForwardDataContent(KernelC
   Blob* out = ctx->BnInOp2Blob("out");
   Blob* tmp = ctx->BnInOp2Blob("tmp");
   CHECK_EQ(in->data_type(), DataType::kTensorBuffer);
-  CHECK_EQ(out->data_type(), DataType::kUInt8);
+  CHECK_EQ(out->data_type(), conf.mean_size() == 0 ? DataType::kUInt8 : DataType::kFloat);
   const ShapeView& in_shape = in->shape();
   const int64_t num_in_axes = in_shape.NumAxes();
   const ShapeView& out_shape = out->shape();
@@ -588,8 +683,9 @@ void ImageDecoderRandomCropResizeKernel<device_type>::ForwardDataContent(KernelC
   CHECK_EQ(tmp->data_type(), DataType::kUInt8);
   const int64_t batch_size = in_shape.elem_cnt();
   const auto* buffers = in->dptr<TensorBuffer>();
-  auto* out_ptr = out->mut_dptr<unsigned char>();
-  const int64_t out_instance_size = conf.target_height() * conf.target_width() * kNumChannels;
+  auto* out_ptr = static_cast<char*>(out->mut_dptr());
+  const int64_t out_instance_size = conf.target_height() * conf.target_width() * kNumChannels
+                                    * GetSizeOfDataType(out->data_type());
   auto* workspace_ptr = tmp->mut_dptr<unsigned char>();
   size_t workspace_size_per_worker = tmp->shape().elem_cnt() / workers_.size();
   std::shared_ptr<BlockingCounter> done_counter(new BlockingCounter(workers_.size()));
@@ -40,11 +40,21 @@ class InputKernel final : public Kernel {
     BufferStatus buffer_status = buffer->TryReceive(&critical_section_instance);
     CHECK_NE(buffer_status, kBufferStatusEmpty);
     if (buffer_status == kBufferStatusSuccess) {
-      OfBlob ofblob(ctx->stream(), ctx->BnInOp2Blob("out"));
+      Blob* out = ctx->BnInOp2Blob("out");
+      // NOTE: the register may alias the eager input of the last step it was used in.
+      const auto& it = out_blob2dptr_.find(out);
+      if (it == out_blob2dptr_.end()) {
+        out_blob2dptr_.emplace(out, out->mut_dptr<char>());
+      } else {
+        out->reset_dptr(it->second);
+      }
+      OfBlob ofblob(ctx->stream(), out);
       critical_section_instance->AccessBlobByOpName(reinterpret_cast<uint64_t>(&ofblob), op_name);
     }
   }
   void ForwardHeader(KernelContext* ctx) const override {}
+
+  mutable HashMap<const Blob*, char*> out_blob2dptr_;
 };
 
 }  // namespace
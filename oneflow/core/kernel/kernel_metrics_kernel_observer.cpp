@@ -0,0 +1,211 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/kernel_metrics_kernel_observer.h"
+#include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/profiler/kernel_metrics.h"
+#ifdef WITH_CUDA
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#endif  // WITH_CUDA
+#include <chrono>
+#include <deque>
+
+namespace oneflow {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string OpType4Kernel(const Kernel* kernel) {
+  const OperatorConf& op_conf = kernel->op_conf();
+  if (op_conf.has_user_conf()) { return op_conf.user_conf().op_type_name(); }
+  const auto* field = op_conf.GetDescriptor()->FindFieldByNumber(op_conf.op_type_case());
+  return field == nullptr ? "unknown" : field->name();
+}
+
+int64_t BlobBytes(KernelContext* kernel_ctx, const PbRpf<std::string>& bns) {
+  int64_t bytes = 0;
+  for (const std::string& bn : bns) {
+    const Blob* blob = kernel_ctx->BnInOp2Blob(bn);
+    if (blob == nullptr) { continue; }
+    bytes += blob->shape().elem_cnt() * GetSizeOfDataType(blob->data_type());
+  }
+  return bytes;
+}
+
+// Multiply-adds count two FLOPs.
+int64_t Flops4Kernel(KernelContext* kernel_ctx, const Kernel* kernel) {
+  const OperatorConf& op_conf = kernel->op_conf();
+  if (!op_conf.has_user_conf()) { return 0; }
+  const std::string& op_type = op_conf.user_conf().op_type_name();
+  if (op_type == "matmul" || op_type == "batch_matmul" || op_type == "broadcast_matmul") {
+    const Blob* a = kernel_ctx->BnInOp2Blob("a_0");
+    const Blob* out = kernel_ctx->BnInOp2Blob("out_0");
+    if (a == nullptr || out == nullptr || a->shape().NumAxes() < 2) { return 0; }
+    const auto& attrs = op_conf.user_conf().attr();
+    const auto it = attrs.find("transpose_a");
+    const bool transpose_a = it != attrs.end() && it->second.at_bool();
+    const int64_t num_axes = a->shape().NumAxes();
+    const int64_t k = a->shape().At(transpose_a ? num_axes - 2 : num_axes - 1);
+    return 2 * out->shape().elem_cnt() * k;
+  }
+  // Each element of `out` sums over a window of `weight` for one output channel.
+  auto ConvFlops = [&](const std::string& out_bn, const std::string& weight_bn) -> int64_t {
+    const Blob* out = kernel_ctx->BnInOp2Blob(out_bn);
+    const Blob* weight = kernel_ctx->BnInOp2Blob(weight_bn);
+    if (out == nullptr || weight == nullptr || weight->shape().NumAxes() == 0) { return 0; }
+    const int64_t out_channels = weight->shape().At(0);
+    if (out_channels == 0) { return 0; }
+    return 2 * out->shape().elem_cnt() * (weight->shape().elem_cnt() / out_channels);
+  };
+  if (op_type == "conv1d" || op_type == "conv2d" || op_type == "conv3d") {
+    return ConvFlops("out_0", "weight_0");
+  } else if (op_type == "conv_data_grad") {
+    return ConvFlops("dy_0", "filter_0");
+  } else if (op_type == "conv_filter_grad") {
+    return ConvFlops("dy_0", "filter_diff_0");
+  }
+  return 0;
+}
+
+// Kernels of a thread run one at a time.
+class ThreadLocalState final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ThreadLocalState);
+  ThreadLocalState() : started_(false), start_ns_(0) {}
+  ~ThreadLocalState() {
+#ifdef WITH_CUDA
+    // Not checked, the device may be torn down before the thread exits.
+    for (const PendingRun& run : pending_runs_) {
+      cudaEventDestroy(run.start_event);
+      cudaEventDestroy(run.end_event);
+    }
+    for (cudaEvent_t event : free_events_) { cudaEventDestroy(event); }
+#endif  // WITH_CUDA
+  }
+
+  void Start(ep::Stream* stream) {
+    Poll();
+    started_ = false;
+    if (!profiler::KernelMetricsEnabled()) { return; }
+#ifdef WITH_CUDA
+    start_event_ = nullptr;
+    if (stream->device_type() == DeviceType::kCUDA) {
+      cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+      cudaStreamCaptureStatus capture_status = cudaStreamCaptureStatusNone;
+      OF_CUDA_CHECK(cudaStreamIsCapturing(cuda_stream, &capture_status));
+      if (capture_status != cudaStreamCaptureStatusNone) { return; }
+      start_event_ = NewEvent();
+      OF_CUDA_CHECK(cudaEventRecord(start_event_, cuda_stream));
+    }
+#endif  // WITH_CUDA
+    start_ns_ = NowNs();
+    started_ = true;
+  }
+
+  void Finish(KernelContext* kernel_ctx, const Kernel* kernel) {
+    if (!started_) { return; }
+    started_ = false;
+    ep::Stream* stream = kernel_ctx->stream();
+    profiler::KernelRunRecord record{
+        OpType4Kernel(kernel),
+        DeviceTypeName(stream->device_type()),
+        0,
+        BlobBytes(kernel_ctx, kernel->op_attribute().input_bns()),
+        BlobBytes(kernel_ctx, kernel->op_attribute().output_bns()),
+        Flops4Kernel(kernel_ctx, kernel)};
+#ifdef WITH_CUDA
+    if (start_event_ != nullptr) {
+      cudaEvent_t end_event = NewEvent();
+      OF_CUDA_CHECK(cudaEventRecord(end_event, stream->As<ep::CudaStream>()->cuda_stream()));
+      pending_runs_.push_back(PendingRun{std::move(record), start_event_, end_event});
+      start_event_ = nullptr;
+      return;
+    }
+#endif  // WITH_CUDA
+    record.elapsed_ns = NowNs() - start_ns_;
+    profiler::RecordKernelRun(record);
+  }
+
+ private:
+#ifdef WITH_CUDA
+  struct PendingRun {
+    profiler::KernelRunRecord record;
+    cudaEvent_t start_event;
+    cudaEvent_t end_event;
+  };
+
+  cudaEvent_t NewEvent() {
+    if (free_events_.empty()) {
+      cudaEvent_t event = nullptr;
+      OF_CUDA_CHECK(cudaEventCreate(&event));
+      return event;
+    }
+    cudaEvent_t event = free_events_.back();
+    free_events_.pop_back();
+    return event;
+  }
+#endif  // WITH_CUDA
+
+  // Records the runs the device has finished, in the order they were launched.
+  void Poll() {
+#ifdef WITH_CUDA
+    while (!pending_runs_.empty()) {
+      PendingRun& run = pending_runs_.front();
+      const cudaError_t err = cudaEventQuery(run.end_event);
+      if (err == cudaErrorNotReady) { break; }
+      OF_CUDA_CHECK(err);
+      float elapsed_ms = 0;
+      OF_CUDA_CHECK(cudaEventElapsedTime(&elapsed_ms, run.start_event, run.end_event));
+      run.record.elapsed_ns = static_cast<int64_t>(elapsed_ms * 1e6);
+      profiler::RecordKernelRun(run.record);
+      free_events_.push_back(run.start_event);
+      free_events_.push_back(run.end_event);
+      pending_runs_.pop_front();
+    }
+#endif  // WITH_CUDA
+  }
+
+  bool started_;
+  int64_t start_ns_;
+#ifdef WITH_CUDA
+  cudaEvent_t start_event_ = nullptr;
+  std::deque<PendingRun> pending_runs_;
+  std::vector<cudaEvent_t> free_events_;
+#endif  // WITH_CUDA
+};
+
+ThreadLocalState* GetThreadLocalState() {
+  static thread_local ThreadLocalState state;
+  return &state;
+}
+
+}  // namespace
+
+void KernelMetricsKernelObserver::WillForwardDataContent(KernelContext* kernel_ctx,
+                                                         const Kernel* kernel) {
+  GetThreadLocalState()->Start(kernel_ctx->stream());
+}
+
+void KernelMetricsKernelObserver::DidForwardDataContent(KernelContext* kernel_ctx,
+                                                        const Kernel* kernel) {
+  GetThreadLocalState()->Finish(kernel_ctx, kernel);
+}
+
+}  // namespace oneflow
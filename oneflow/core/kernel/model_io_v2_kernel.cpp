@@ -20,9 +20,16 @@ limitations under the License.
 #include "oneflow/core/job/nd_sbp_util.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+#include "oneflow/core/persistence/sharded_snapshot.h"
+#include "oneflow/core/persistence/mapped_file.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
+#ifdef WITH_CUDA
+#include <unistd.h>
+#endif  // WITH_CUDA
 
 namespace oneflow {
 
@@ -122,6 +129,106 @@ void SyncCopyToDevice<DeviceType::kCUDA>(ep::Stream* stream, const void* src, vo
 }
 #endif
 
+// Copies from memory mapped file pages to the device, the pages are paged in on demand.
+template<DeviceType device_type>
+void CopyMappedToDevice(ep::Stream* stream, const char* src, void* dst, size_t size);
+
+template<>
+void CopyMappedToDevice<DeviceType::kCPU>(ep::Stream* stream, const char* src, void* dst,
+                                          size_t size) {
+  std::memcpy(dst, src, size);
+}
+
+#ifdef WITH_CUDA
+template<>
+void CopyMappedToDevice<DeviceType::kCUDA>(ep::Stream* stream, const char* src, void* dst,
+                                           size_t size) {
+  // Registering the mapped pages lets the DMA engine read them directly instead of bouncing
+  // through the staging buffer of a pageable copy, which only pays off for large copies.
+  constexpr size_t kMinRegisterSize = 1 << 20;
+  cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+  OF_CUDA_CHECK(cudaStreamSynchronize(cuda_stream));
+  if (size >= kMinRegisterSize) {
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(src) / page_size * page_size;
+    const uintptr_t end = RoundUp(reinterpret_cast<uintptr_t>(src) + size, page_size);
+    void* registered = reinterpret_cast<void*>(begin);
+    unsigned int flags = cudaHostRegisterDefault;
+#if CUDA_VERSION >= 11010
+    flags |= cudaHostRegisterReadOnly;
+#endif
+    if (cudaHostRegister(registered, end - begin, flags) == cudaSuccess) {
+      OF_CUDA_CHECK(cudaMemcpyAsync(dst, src, size, cudaMemcpyHostToDevice, cuda_stream));
+      OF_CUDA_CHECK(cudaStreamSynchronize(cuda_stream));
+      OF_CUDA_CHECK(cudaHostUnregister(registered));
+      return;
+    }
+    // Registration of read-only mappings is not supported by every driver, clear the error and
+    // fall back to a pageable copy.
+    cudaGetLastError();
+  }
+  OF_CUDA_CHECK(cudaMemcpyAsync(dst, src, size, cudaMemcpyHostToDevice, cuda_stream));
+  OF_CUDA_CHECK(cudaStreamSynchronize(cuda_stream));
+}
+#endif
+
+template<DeviceType device_type>
+void AsyncCopyToHost(ep::Stream* stream, const void* src, void* dst, size_t size);
+
+template<>
+void AsyncCopyToHost<DeviceType::kCPU>(ep::Stream* stream, const void* src, void* dst,
+                                       size_t size) {
+  std::memcpy(dst, src, size);
+}
+
+#ifdef WITH_CUDA
+template<>
+void AsyncCopyToHost<DeviceType::kCUDA>(ep::Stream* stream, const void* src, void* dst,
+                                        size_t size) {
+  OF_CUDA_CHECK(cudaMemcpyAsync(dst, src, size, cudaMemcpyDefault,
+                                stream->As<ep::CudaStream>()->cuda_stream()));
+}
+#endif
+
+// Pinned host copy of a blob taken without blocking the host, it is ready once the event has
+// been reached.
+class HostStagedBlob final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostStagedBlob);
+  template<DeviceType device_type>
+  static std::shared_ptr<HostStagedBlob> New(ep::Stream* stream, const Blob* blob) {
+    std::shared_ptr<HostStagedBlob> staged(
+        new HostStagedBlob(stream->device(), blob->ByteSizeOfBlobBody()));
+    AsyncCopyToHost<device_type>(stream, blob->dptr(), staged->data_, staged->size_);
+    stream->RecordEvent(staged->event_);
+    return staged;
+  }
+  ~HostStagedBlob() {
+    device_->DestroyEvents(&event_, 1);
+    device_->FreePinned(ep::AllocationOptions{}, data_);
+  }
+
+  // The time waited is the part of the device to host copy not overlapped with training.
+  const char* WaitData() const {
+    profiler::CheckpointIOPhaseTimer timer("model_io", "wait_staged_copy", size_);
+    CHECK_JUST(event_->Sync());
+    return static_cast<const char*>(data_);
+  }
+  size_t size() const { return size_; }
+
+ private:
+  HostStagedBlob(ep::Device* device, size_t size)
+      : device_(device), data_(nullptr), size_(size), event_(nullptr) {
+    CHECK_JUST(device_->AllocPinned(ep::AllocationOptions{}, &data_, std::max<size_t>(size_, 1)));
+    device_->CreateEvents(&event_, 1);
+  }
+
+  ep::Device* device_;
+  void* data_;
+  size_t size_;
+  ep::Event* event_;
+};
+
 template<DeviceType device_type>
 std::string SyncReadStringFromBlob(ep::Stream* stream, const Blob* blob) {
   std::vector<char> content;
@@ -162,12 +269,16 @@ class AutoSyncBlobAccessor final {
         write_sync_(write_sync),
         host_blob_(underlying) {
     if (read_sync_) {
+      profiler::CheckpointIOPhaseTimer timer("model_io", "copy_to_host",
+                                             underlying_->ByteSizeOfBlobBody());
       SyncCopyToHost<device_type>(stream_, underlying_->dptr(), host_blob_.blob()->mut_dptr(),
                                   underlying_->ByteSizeOfBlobBody());
     }
   }
   ~AutoSyncBlobAccessor() {
     if (write_sync_) {
+      profiler::CheckpointIOPhaseTimer timer("model_io", "copy_to_device",
+                                             underlying_->ByteSizeOfBlobBody());
       SyncCopyToDevice<device_type>(stream_, host_blob_.blob()->dptr(), underlying_->mut_dptr(),
                                     underlying_->ByteSizeOfBlobBody());
     }
@@ -197,6 +308,35 @@ class AutoSyncBlobAccessor<DeviceType::kCPU> final {
   Blob* underlying_;
 };
 
+// Writes the part of a variable held by this rank, the rank writing the last part of a split
+// variable merges all the parts.
+void WriteVariable(const std::string& snapshot_path, const std::string& var_lbn,
+                   const Shape& logical_blob_shape, DataType data_type,
+                   const std::vector<TensorSliceView>& part_id2slice_views, int64_t part_id,
+                   bool is_broadcast, int64_t counter, const char* data, size_t size) {
+  SnapshotWriter writer(snapshot_path);
+  SnapshotReader reader(snapshot_path);
+  const std::string key =
+      is_broadcast ? var_lbn : GetTmpPartKey(var_lbn, part_id, part_id2slice_views.size());
+  writer.Write(key, data, size);
+  if (is_broadcast) { return; }
+  const std::string rpc_key = snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(counter);
+  int32_t num_written_parts = Global<CtrlClient>::Get()->IncreaseCount(rpc_key);
+  if (num_written_parts < part_id2slice_views.size()) { return; }
+  TensorSliceView total_slice(logical_blob_shape);
+  OnDemandHostBlob total_blob(logical_blob_shape, data_type);
+  FOR_RANGE(int64_t, j, 0, part_id2slice_views.size()) {
+    const TensorSliceView part_slice = part_id2slice_views.at(j);
+    const std::string part_key = GetTmpPartKey(var_lbn, j, part_id2slice_views.size());
+    OnDemandHostBlob part_blob(part_slice.shape(), data_type);
+    reader.Read(part_key, part_blob.blob());
+    HostSliceCopy(total_blob.blob(), total_slice, part_blob.blob(), part_slice);
+    SnapshotFS()->RecursivelyDeleteDir(Dirname(JoinPath(snapshot_path, part_key)));
+  }
+  writer.Write(var_lbn, total_blob.blob());
+  Global<CtrlClient>::Get()->EraseCount(rpc_key);
+}
+
 }  // namespace
 
 template<DeviceType device_type>
@@ -317,8 +457,26 @@ class ModelLoadV2Kernel final : public Kernel {
       const Shape logical_blob_shape(original_variable_conf.shape());
       const std::string& var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
+      const TensorSliceView& slice = tensor_slice_views_.at(i);
+      if (logical_blob_shape.NumAxes() > 0
+          && slice.shape().Count(1) == logical_blob_shape.Count(1)) {
+        std::unique_ptr<MappedFile> mapped_file = reader.Map(var_lbn);
+        if (mapped_file) {
+          const size_t size_of_data_type = GetSizeOfDataType(ref->data_type());
+          CHECK_EQ(mapped_file->size(), logical_blob_shape.elem_cnt() * size_of_data_type)
+              << "unexpected model snapshot size, key: " << var_lbn;
+          const size_t offset = slice.At(0).begin() * slice.shape().Count(1) * size_of_data_type;
+          const size_t size = ref->ByteSizeOfBlobBody();
+          CHECK_EQ(size, slice.shape().elem_cnt() * size_of_data_type);
+          mapped_file->WillNeed(offset, size);
+          profiler::CheckpointIOPhaseTimer timer("model_io", "copy_mapped_to_device", size);
+          CopyMappedToDevice<device_type>(ctx->stream(), mapped_file->data() + offset,
+                                          ref->mut_dptr(), size);
+          continue;
+        }
+      }
       AutoSyncBlobAccessor<device_type> ref_accessor(ctx->stream(), ref, false, true);
-      reader.Read(var_lbn, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
+      reader.Read(var_lbn, logical_blob_shape, slice, ref_accessor.host_blob());
     }
   }
   std::vector<TensorSliceView> tensor_slice_views_;
@@ -358,6 +516,8 @@ class ModelSaveV2Kernel final : public Kernel {
     part_id2slice_views_.reserve(num_var);
     need_do_saves_.reserve(num_var);
     part_ids_.reserve(num_var);
+    async_save_ = ParseBooleanFromEnv("ONEFLOW_ENABLE_ASYNC_MODEL_SAVE", false);
+    sharded_save_ = ParseBooleanFromEnv("ONEFLOW_ENABLE_SHARDED_MODEL_SAVE", false);
     FOR_RANGE(int64_t, i, 0, num_var) {
       counters_.emplace_back(new int64_t(0));
       const NdSbp& nd_sbp = GetNdSbp(this->kernel_conf(), GenRepeatedBn("in", i));
@@ -389,46 +549,95 @@ class ModelSaveV2Kernel final : public Kernel {
     const ModelSaveV2OpConf& conf = this->op_conf().model_save_v2_conf();
     const Blob* path_blob = ctx->BnInOp2Blob("path");
     const std::string snapshot_path = SyncReadStringFromBlob<device_type>(ctx->stream(), path_blob);
-    SnapshotWriter writer(snapshot_path);
-    SnapshotReader reader(snapshot_path);
+    if (sharded_save_) {
+      SaveShard(ctx, snapshot_path);
+      return;
+    }
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       if (!need_do_saves_.at(i)) { continue; }
       *(counters_.at(i)) += 1;
+      const int64_t counter = *(counters_.at(i));
       const std::vector<TensorSliceView>& variable_part_id2slice_views = part_id2slice_views_.at(i);
+      const int64_t part_id = part_ids_.at(i);
       Blob* in_blob = ctx->BnInOp2Blob(GenRepeatedBn("in", i));
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       const Shape logical_blob_shape(original_variable_conf.shape());
       const DataType data_type = original_variable_conf.data_type();
-      AutoSyncBlobAccessor<device_type> in_accessor(ctx->stream(), in_blob, true, false);
       const std::string var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
       const bool is_broadcast = ShapeView(logical_blob_shape) == in_blob->shape();
       if (is_broadcast) { CHECK_EQ(variable_part_id2slice_views.size(), 1); }
-      const std::string key = is_broadcast ? var_lbn
-                                           : GetTmpPartKey(var_lbn, part_ids_.at(i),
-                                                           variable_part_id2slice_views.size());
-      writer.Write(key, in_accessor.host_blob());
-      if (!is_broadcast) {
-        const std::string rpc_key =
-            snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(*(counters_.at(i)));
-        int32_t counter = Global<CtrlClient>::Get()->IncreaseCount(rpc_key);
-        if (counter < variable_part_id2slice_views.size()) { continue; }
-        TensorSliceView total_slice(logical_blob_shape);
-        OnDemandHostBlob total_blob(logical_blob_shape, data_type);
-        FOR_RANGE(int64_t, j, 0, variable_part_id2slice_views.size()) {
-          const TensorSliceView part_slice = variable_part_id2slice_views.at(j);
-          const std::string part_key =
-              GetTmpPartKey(var_lbn, j, variable_part_id2slice_views.size());
-          OnDemandHostBlob part_blob(part_slice.shape(), data_type);
-          reader.Read(part_key, part_blob.blob());
-          HostSliceCopy(total_blob.blob(), total_slice, part_blob.blob(), part_slice);
-          SnapshotFS()->RecursivelyDeleteDir(Dirname(JoinPath(snapshot_path, part_key)));
-        }
-        writer.Write(var_lbn, total_blob.blob());
-        Global<CtrlClient>::Get()->EraseCount(rpc_key);
+      if (async_save_) {
+        // The variable is staged on host before the kernels after this one update it, then
+        // written out by the background writer, which must not refer to the kernel.
+        std::shared_ptr<HostStagedBlob> staged =
+            HostStagedBlob::New<device_type>(ctx->stream(), in_blob);
+        Global<AsyncSnapshotWriter>::Get()->Schedule(snapshot_path, [=]() {
+          WriteVariable(snapshot_path, var_lbn, logical_blob_shape, data_type,
+                        variable_part_id2slice_views, part_id, is_broadcast, counter,
+                        staged->WaitData(), staged->size());
+        });
+      } else {
+        AutoSyncBlobAccessor<device_type> in_accessor(ctx->stream(), in_blob, true, false);
+        const Blob* host_blob = in_accessor.host_blob();
+        WriteVariable(snapshot_path, var_lbn, logical_blob_shape, data_type,
+                      variable_part_id2slice_views, part_id, is_broadcast, counter,
+                      host_blob->dptr<char>(), host_blob->ByteSizeOfBlobBody());
+      }
+    }
+  }
+
+  // Writes the slices of the variables held by this rank into a shard of its own, without
+  // gathering them, see ShardedSnapshotWriter.
+  void SaveShard(KernelContext* ctx, const std::string& snapshot_path) const {
+    struct ShardEntry {
+      std::string key;
+      Shape logical_shape;
+      DataType data_type;
+      TensorSliceView slice;
+      std::shared_ptr<HostStagedBlob> staged;
+    };
+    const ModelSaveV2OpConf& conf = this->op_conf().model_save_v2_conf();
+    const int64_t parallel_id = this->kernel_conf().parallel_ctx().parallel_id();
+    const std::string shard_name = this->op_conf().name() + "-" + std::to_string(parallel_id);
+    std::unique_ptr<ShardedSnapshotWriter> writer;
+    if (!async_save_) { writer.reset(new ShardedSnapshotWriter(snapshot_path, shard_name)); }
+    std::vector<ShardEntry> entries;
+    FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
+      if (!need_do_saves_.at(i)) { continue; }
+      const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
+      ShardEntry entry;
+      entry.key = GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
+      entry.logical_shape = Shape(original_variable_conf.shape());
+      entry.data_type = original_variable_conf.data_type();
+      entry.slice = part_id2slice_views_.at(i).at(part_ids_.at(i));
+      Blob* in_blob = ctx->BnInOp2Blob(GenRepeatedBn("in", i));
+      CHECK_EQ(ShapeView(entry.slice.shape()), in_blob->shape());
+      if (async_save_) {
+        entry.staged = HostStagedBlob::New<device_type>(ctx->stream(), in_blob);
+        entries.emplace_back(std::move(entry));
+      } else {
+        AutoSyncBlobAccessor<device_type> in_accessor(ctx->stream(), in_blob, true, false);
+        writer->Write(entry.key, entry.logical_shape, entry.data_type, entry.slice,
+                      in_accessor.host_blob()->dptr<char>());
       }
     }
+    if (!async_save_) {
+      writer->Close();
+      return;
+    }
+    Global<AsyncSnapshotWriter>::Get()->Schedule(snapshot_path, [=]() {
+      ShardedSnapshotWriter async_writer(snapshot_path, shard_name);
+      for (const ShardEntry& entry : entries) {
+        async_writer.Write(entry.key, entry.logical_shape, entry.data_type, entry.slice,
+                           entry.staged->WaitData());
+      }
+      async_writer.Close();
+    });
   }
+
+  bool async_save_ = false;
+  bool sharded_save_ = false;
   std::vector<std::unique_ptr<int64_t>> counters_;
   std::vector<std::vector<TensorSliceView>> part_id2slice_views_;
   std::vector<bool> need_do_saves_;
@@ -16,16 +16,33 @@ limitations under the License.
 #include "oneflow/core/kernel/profiler_kernel_observer.h"
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/profiler/kernel.h"
+#include "oneflow/core/profiler/event_trace.h"
 
 namespace oneflow {
 
+namespace {
+
+// Kernels of an actor run one at a time on its thread.
+thread_local uint64_t op_compute_id = 0;
+
+}  // namespace
+
 void ProfilerKernelObserver::WillForwardDataContent(KernelContext* kernel_ctx,
                                                     const Kernel* kernel) {
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentStart(kernel_ctx, kernel));
+  if (profiler::EventTraceEnabled()) {
+    const OperatorConf& op_conf = kernel->op_conf();
+    op_compute_id = profiler::BeginOpComputeEvent(
+        op_conf.has_user_conf() ? op_conf.user_conf().op_type_name() : "system", op_conf.name());
+  }
 }
 
 void ProfilerKernelObserver::DidForwardDataContent(KernelContext* kernel_ctx,
                                                    const Kernel* kernel) {
+  if (op_compute_id != 0) {
+    profiler::EndOpComputeEvent(op_compute_id);
+    op_compute_id = 0;
+  }
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentEnd(kernel_ctx, kernel));
 }
 
@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/lazy/actor/actor.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/runtime_job_descs.h"
+#include "oneflow/core/job/pipeline_bubble_profile.h"
 #include "oneflow/core/stream/include/stream_context.h"
 
 namespace oneflow {
@@ -143,6 +144,13 @@ void Actor::Init(const JobDesc* job_desc, ActorContext* actor_ctx) {
       std::all_of(exec_kernel_vec_.cbegin(), exec_kernel_vec_.cend(),
                   [](const ExecKernel& ek) { return ek.kernel->IsKernelLaunchSynchronized(); });
   if (!is_kernel_launch_synchronized_) { CHECK_EQ(exec_kernel_vec_.size(), 1); }
+  pipeline_stage_id_ = -1;
+  if (!exec_kernel_vec_.empty()) {
+    pipeline_stage_id_ =
+        PipelineBubbleProfile::StageId4ActorOpConf(exec_kernel_vec_.front().kernel->op_conf());
+    if (pipeline_stage_id_ >= 0) { job_name_ = job_desc->job_name(); }
+  }
+  runtime_stats_ = ActorRuntimeStats::New(job_desc->job_name(), task_proto);
 
   remaining_eord_cnt_ = 0;
   msg_handler_ = nullptr;
@@ -421,7 +429,12 @@ int Actor::HandlerZombie(const ActorMsg& msg) {
 
 void Actor::ActUntilFail() {
   while (IsReadReady() && IsWriteReady()) {
+    if (runtime_stats_) { runtime_stats_->OnActBegin(); }
     Act();
+    if (runtime_stats_) { runtime_stats_->OnActEnd(); }
+    if (pipeline_stage_id_ >= 0) {
+      PipelineBubbleProfile::Get()->OnStageAct(job_name_, pipeline_stage_id_);
+    }
 
     AsyncSendCustomizedProducedRegstMsgToConsumer();
     AsyncSendNaiveProducedRegstMsgToConsumer();
@@ -435,6 +448,7 @@ void Actor::ActUntilFail() {
   }
   // NOTE(liujuncheng): return inplace consumed
   AsyncSendQueuedMsg();
+  if (runtime_stats_) { runtime_stats_->OnWait(IsReadReady(), BlockingProducedRegstDescId()); }
 }
 
 void Actor::AsyncSendNaiveProducedRegstMsgToConsumer() {
@@ -538,6 +552,19 @@ bool Actor::IsWriteReady() const {
          && IsCustomizedWriteReady();
 }
 
+int64_t Actor::BlockingProducedRegstDescId() const {
+  int64_t blocking_regst_desc_id = -1;
+  const auto FindEmpty = [&](int64_t regst_desc_id, const std::deque<Regst*>& regst_deq) {
+    if (blocking_regst_desc_id == -1 && regst_deq.empty()) {
+      blocking_regst_desc_id = regst_desc_id;
+    }
+  };
+  const auto All = [](int64_t) { return true; };
+  naive_produced_rs_.ForChosenRegstDeq(All, FindEmpty);
+  inplace_produced_rs_.ForChosenRegstDeq(All, FindEmpty);
+  return blocking_regst_desc_id;
+}
+
 void Actor::AsyncLaunchKernel(std::function<Regst*(int64_t)> Regst4RegstDescId) {
   for (const ExecKernel& ek : exec_kernel_vec_) {
     CHECK_NOTNULL(dynamic_cast<KernelContextImpl*>(ek.kernel_ctx.get()))
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/lazy/actor/actor_base.h"
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
+#include "oneflow/core/lazy/actor/actor_runtime_stats.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/kernel/kernel_context.h"
@@ -141,6 +142,8 @@ class Actor : public ActorBase {
   // Ready
   bool IsReadReady() const;
   bool IsWriteReady() const;
+  // A naive or inplace produced regst desc without free regst, -1 if none.
+  int64_t BlockingProducedRegstDescId() const;
 
   // Naive, Inplace Or Customized
   virtual void TakeOverInplaceConsumedAndProduced(
@@ -187,6 +190,11 @@ class Actor : public ActorBase {
   int64_t actor_id_;
   int64_t thrd_id_;
   int64_t job_id_;
+  // Set only if the pipeline bubble is profiled.
+  int64_t pipeline_stage_id_;
+  std::string job_name_;
+  // Set only if the runtime stats are enabled.
+  std::unique_ptr<ActorRuntimeStats> runtime_stats_;
   std::vector<ExecKernel> exec_kernel_vec_;
   HashMap<std::string, std::vector<int64_t>> name2regst_desc_id_;
   MsgHandler msg_handler_;
@@ -0,0 +1,283 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/lazy/actor/actor_runtime_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/job/task.pb.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* StateName(ActorRuntimeStats::State state) {
+  switch (state) {
+    case ActorRuntimeStats::kIdle: return "idle";
+    case ActorRuntimeStats::kActing: return "act";
+    case ActorRuntimeStats::kWaitingConsumed: return "wait consumed";
+    case ActorRuntimeStats::kWaitingProduced: return "wait produced";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
+struct ActorRow {
+  std::string op_name;
+  int64_t actor_id;
+  int64_t thrd_id;
+  int64_t act_cnt;
+  std::vector<int64_t> state2time_ns;
+};
+
+struct RegisterNumHint {
+  std::string op_name;
+  int64_t parallel_id;
+  std::string regst_name;
+  int64_t register_num;
+  int64_t suggested_register_num;
+  double stall_ratio;
+};
+
+struct JobRecord {
+  int64_t live_actor_cnt = 0;
+  std::vector<ActorRow> rows;
+  std::vector<RegisterNumHint> hints;
+  nlohmann::json trace_events = nlohmann::json::array();
+};
+
+std::string NsToMs(int64_t ns) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3) << ns / 1e6;
+  return ss.str();
+}
+
+std::string NsToUs(int64_t ns) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3) << ns / 1e3;
+  return ss.str();
+}
+
+void DumpJobRecord(const std::string& job_name, JobRecord* record) {
+  std::sort(record->rows.begin(), record->rows.end(), [](const ActorRow& a, const ActorRow& b) {
+    return a.state2time_ns.at(ActorRuntimeStats::kActing)
+           > b.state2time_ns.at(ActorRuntimeStats::kActing);
+  });
+  const std::string sep = "\t";
+  const std::string table_path = "actor_runtime_stats_" + job_name;
+  {
+    auto log_stream = TeePersistentLogStream::Create(table_path);
+    (*log_stream) << "op_name" << sep << "actor_id" << sep << "thrd_id" << sep << "act_cnt" << sep
+                  << "act_ms" << sep << "mean_act_us" << sep << "wait_consumed_ms" << sep
+                  << "wait_produced_ms" << sep << "idle_ms"
+                  << "\n";
+    for (const ActorRow& row : record->rows) {
+      const int64_t act_ns = row.state2time_ns.at(ActorRuntimeStats::kActing);
+      const int64_t mean_act_ns = row.act_cnt == 0 ? 0 : act_ns / row.act_cnt;
+      (*log_stream) << row.op_name << sep << std::to_string(row.actor_id) << sep
+                    << std::to_string(row.thrd_id) << sep << std::to_string(row.act_cnt) << sep
+                    << NsToMs(act_ns) << sep << NsToUs(mean_act_ns) << sep
+                    << NsToMs(row.state2time_ns.at(ActorRuntimeStats::kWaitingConsumed)) << sep
+                    << NsToMs(row.state2time_ns.at(ActorRuntimeStats::kWaitingProduced)) << sep
+                    << NsToMs(row.state2time_ns.at(ActorRuntimeStats::kIdle)) << "\n";
+    }
+  }
+  const std::string trace_path = "actor_runtime_trace_" + job_name + ".json";
+  {
+    nlohmann::json trace;
+    trace["traceEvents"] = std::move(record->trace_events);
+    trace["displayTimeUnit"] = "ms";
+    auto log_stream = TeePersistentLogStream::Create(trace_path);
+    (*log_stream) << trace.dump();
+  }
+  const std::string hints_path = "register_num_hints_" + job_name;
+  {
+    std::sort(record->hints.begin(), record->hints.end(),
+              [](const RegisterNumHint& a, const RegisterNumHint& b) {
+                return a.stall_ratio > b.stall_ratio;
+              });
+    auto log_stream = TeePersistentLogStream::Create(hints_path);
+    (*log_stream) << "op_name" << sep << "parallel_id" << sep << "regst_name" << sep
+                  << "register_num" << sep << "suggested_register_num" << sep << "stall_ratio"
+                  << "\n";
+    for (const RegisterNumHint& hint : record->hints) {
+      (*log_stream) << hint.op_name << sep << std::to_string(hint.parallel_id) << sep
+                    << hint.regst_name << sep << std::to_string(hint.register_num) << sep
+                    << std::to_string(hint.suggested_register_num) << sep
+                    << std::to_string(hint.stall_ratio) << "\n";
+    }
+  }
+  LOG(INFO) << "runtime stats of the " << record->rows.size() << " actors of job " << job_name
+            << " are written to " << table_path << " and " << trace_path << ", "
+            << record->hints.size() << " register num hints to " << hints_path;
+}
+
+class JobRecordMgr final {
+ public:
+  static JobRecordMgr* Get() {
+    static JobRecordMgr mgr;
+    return &mgr;
+  }
+
+  void AddActor(const std::string& job_name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_name2record_[job_name].live_actor_cnt += 1;
+  }
+
+  void RemoveActor(const std::string& job_name, ActorRow&& row, nlohmann::json&& trace_events,
+                   std::vector<RegisterNumHint>&& hints) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = job_name2record_.find(job_name);
+    CHECK(it != job_name2record_.end());
+    JobRecord* record = &it->second;
+    record->rows.emplace_back(std::move(row));
+    for (auto& hint : hints) { record->hints.emplace_back(std::move(hint)); }
+    for (auto& event : trace_events) { record->trace_events.emplace_back(std::move(event)); }
+    CHECK_GT(record->live_actor_cnt, 0);
+    record->live_actor_cnt -= 1;
+    if (record->live_actor_cnt == 0) {
+      DumpJobRecord(job_name, record);
+      job_name2record_.erase(it);
+    }
+  }
+
+ private:
+  JobRecordMgr() = default;
+
+  std::mutex mutex_;
+  HashMap<std::string, JobRecord> job_name2record_;
+};
+
+}  // namespace
+
+bool ActorRuntimeStats::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_RUNTIME_STATS", false);
+  return enabled;
+}
+
+std::unique_ptr<ActorRuntimeStats> ActorRuntimeStats::New(const std::string& job_name,
+                                                          const TaskProto& task_proto) {
+  if (!Enabled()) { return nullptr; }
+  return std::unique_ptr<ActorRuntimeStats>(new ActorRuntimeStats(job_name, task_proto));
+}
+
+ActorRuntimeStats::ActorRuntimeStats(const std::string& job_name, const TaskProto& task_proto)
+    : job_name_(job_name),
+      actor_id_(task_proto.task_id()),
+      thrd_id_(task_proto.thrd_id()),
+      parallel_id_(task_proto.has_parallel_ctx() ? task_proto.parallel_ctx().parallel_id() : -1),
+      act_cnt_(0),
+      state_(kIdle),
+      blocking_regst_desc_id_(-1),
+      state_begin_ns_(NowNs()),
+      first_act_ns_(-1),
+      state2time_ns_(kStateNum, 0),
+      trace_event_cnt_(0),
+      max_trace_event_num_(
+          ParseIntegerFromEnv("ONEFLOW_ACTOR_RUNTIME_STATS_MAX_TRACE_EVENT_NUM", 4096)) {
+  if (task_proto.exec_sequence().exec_node_size() > 0) {
+    op_name_ =
+        task_proto.exec_sequence().exec_node(0).kernel_conf().op_attribute().op_conf().name();
+    // Only the registers of ops can be found again in a plan compiled later.
+    for (const auto& pair : task_proto.produced_regst_desc()) {
+      regst_desc_id2produced_regst_.emplace(
+          pair.second.regst_desc_id(),
+          ProducedRegst{pair.first, pair.second.register_num(),
+                        pair.second.max_register_num(), 0});
+    }
+  } else {
+    op_name_ = TaskType_Name(task_proto.task_type()) + "-" + std::to_string(actor_id_);
+  }
+  JobRecordMgr::Get()->AddActor(job_name_);
+}
+
+ActorRuntimeStats::~ActorRuntimeStats() {
+  Transit(kIdle);
+  nlohmann::json trace_events = nlohmann::json::array();
+  trace_events.push_back({{"name", "thread_name"},
+                          {"ph", "M"},
+                          {"pid", thrd_id_},
+                          {"tid", actor_id_},
+                          {"args", {{"name", op_name_}}}});
+  for (const TraceEvent& event : trace_events_) {
+    trace_events.push_back({{"name", StateName(event.state)},
+                            {"ph", "X"},
+                            {"pid", thrd_id_},
+                            {"tid", actor_id_},
+                            {"ts", event.begin_ns / 1e3},
+                            {"dur", (event.end_ns - event.begin_ns) / 1e3}});
+  }
+  ActorRow row{op_name_, actor_id_, thrd_id_, act_cnt_, state2time_ns_};
+  std::vector<RegisterNumHint> hints;
+  const int64_t active_ns = first_act_ns_ < 0 ? 0 : state_begin_ns_ - first_act_ns_;
+  static const double min_stall_ratio =
+      ParseFloatFromEnv("ONEFLOW_REGISTER_NUM_TUNING_MIN_STALL_RATIO", 0.05);
+  for (const auto& pair : regst_desc_id2produced_regst_) {
+    const ProducedRegst& regst = pair.second;
+    if (active_ns <= 0) { continue; }
+    const double stall_ratio = static_cast<double>(regst.wait_ns) / active_ns;
+    int64_t suggested_register_num = regst.register_num;
+    if (stall_ratio >= min_stall_ratio && regst.register_num < regst.max_register_num) {
+      suggested_register_num += 1;
+    }
+    // Registers of more than one slot are listed as well, so that a plan tuned before keeps them
+    // when compiled with the hints of its own run.
+    if (suggested_register_num == 1) { continue; }
+    hints.emplace_back(RegisterNumHint{op_name_, parallel_id_, regst.name, regst.register_num,
+                                       suggested_register_num, stall_ratio});
+  }
+  JobRecordMgr::Get()->RemoveActor(job_name_, std::move(row), std::move(trace_events),
+                                   std::move(hints));
+}
+
+void ActorRuntimeStats::OnActEnd() {
+  act_cnt_ += 1;
+  Transit(kIdle);
+}
+
+void ActorRuntimeStats::Transit(State state, int64_t blocking_regst_desc_id) {
+  if (state == state_ && blocking_regst_desc_id == blocking_regst_desc_id_) { return; }
+  const int64_t now = NowNs();
+  state2time_ns_.at(state_) += now - state_begin_ns_;
+  if (state_ == kWaitingProduced && blocking_regst_desc_id_ != -1) {
+    auto it = regst_desc_id2produced_regst_.find(blocking_regst_desc_id_);
+    if (it != regst_desc_id2produced_regst_.end()) { it->second.wait_ns += now - state_begin_ns_; }
+  }
+  if (state == kActing && first_act_ns_ < 0) { first_act_ns_ = now; }
+  if (state_ != kIdle && max_trace_event_num_ > 0) {
+    // The latest events are kept, the early steps are usually not representative.
+    const TraceEvent event{state_, state_begin_ns_, now};
+    if (trace_events_.size() < max_trace_event_num_) {
+      trace_events_.emplace_back(event);
+    } else {
+      trace_events_.at(trace_event_cnt_ % max_trace_event_num_) = event;
+    }
+    trace_event_cnt_ += 1;
+  }
+  state_ = state;
+  blocking_regst_desc_id_ = blocking_regst_desc_id;
+  state_begin_ns_ = now;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_LAZY_ACTOR_ACTOR_RUNTIME_STATS_H_
+#define ONEFLOW_CORE_LAZY_ACTOR_ACTOR_RUNTIME_STATS_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+class TaskProto;
+
+// Counts the acts of an actor and splits the time it is not acting by what blocks it, if
+// ONEFLOW_ACTOR_ENABLE_RUNTIME_STATS is set. An actor waits for a consumed register while one of
+// its inputs is not ready, and for a produced register while all the slots of an output are still
+// read by its consumers. When the last actor of a job in this process is destroyed, the counters
+// of the job are written to the log dir as the table actor_runtime_stats_<job_name>, and the acts
+// and the waits as the chrome trace actor_runtime_trace_<job_name>.json. The trace keeps the
+// latest ONEFLOW_ACTOR_RUNTIME_STATS_MAX_TRACE_EVENT_NUM events of each actor, 4096 by default.
+// The produced registers whose lack of free slots stalls the producer for at least
+// ONEFLOW_REGISTER_NUM_TUNING_MIN_STALL_RATIO of its active time, 0.05 by default, are listed in
+// register_num_hints_<job_name> with one more slot suggested, see register_num_tuner.h. The
+// registers of more than one slot are listed with their register_num.
+// An instance is only used by the thread running its actor.
+class ActorRuntimeStats final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActorRuntimeStats);
+  ~ActorRuntimeStats();
+
+  // kIdle covers the time before the first message and the handling of the messages.
+  enum State { kIdle = 0, kActing, kWaitingConsumed, kWaitingProduced, kStateNum };
+
+  static bool Enabled();
+  // nullptr if not enabled.
+  static std::unique_ptr<ActorRuntimeStats> New(const std::string& job_name,
+                                                const TaskProto& task_proto);
+
+  void OnActBegin() { Transit(kActing); }
+  void OnActEnd();
+  // Called whenever the actor can not act after handling a message. The wait for consumed
+  // registers takes precedence if both are missing. `blocking_regst_desc_id` is a produced regst
+  // desc without free slot, -1 if unknown.
+  void OnWait(bool read_ready, int64_t blocking_regst_desc_id = -1) {
+    Transit(read_ready ? kWaitingProduced : kWaitingConsumed,
+            read_ready ? blocking_regst_desc_id : -1);
+  }
+
+ private:
+  ActorRuntimeStats(const std::string& job_name, const TaskProto& task_proto);
+
+  struct TraceEvent {
+    State state;
+    int64_t begin_ns;
+    int64_t end_ns;
+  };
+
+  struct ProducedRegst {
+    std::string name;
+    int64_t register_num;
+    int64_t max_register_num;
+    int64_t wait_ns;
+  };
+
+  void Transit(State state, int64_t blocking_regst_desc_id = -1);
+
+  std::string job_name_;
+  std::string op_name_;
+  int64_t actor_id_;
+  int64_t thrd_id_;
+  int64_t parallel_id_;
+  int64_t act_cnt_;
+  State state_;
+  int64_t blocking_regst_desc_id_;
+  int64_t state_begin_ns_;
+  int64_t first_act_ns_;
+  HashMap<int64_t, ProducedRegst> regst_desc_id2produced_regst_;
+  std::vector<int64_t> state2time_ns_;
+  std::vector<TraceEvent> trace_events_;
+  size_t trace_event_cnt_;
+  size_t max_trace_event_num_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_LAZY_ACTOR_ACTOR_RUNTIME_STATS_H_
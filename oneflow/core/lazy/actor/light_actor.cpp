@@ -25,6 +25,9 @@ limitations under the License.
 #include "oneflow/core/thread/thread.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/job/runtime_job_descs.h"
+#include "oneflow/core/job/pipeline_bubble_profile.h"
+#include "oneflow/core/lazy/actor/actor_runtime_stats.h"
+#include "oneflow/core/lazy/actor/stream_cuda_graph.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/kernel/user_kernel.h"
 #include "oneflow/core/stream/include/stream_context.h"
@@ -207,6 +210,8 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
   OF_DISALLOW_COPY_AND_MOVE(LightActor);
   explicit LightActor(ActorContext* actor_ctx)
       : thread_(nullptr),
+        pipeline_stage_id_(-1),
+        stream_cuda_graph_member_(-1),
         actor_ctx_(actor_ctx),
         stream_ctx_(actor_ctx->stream_ctx()),
         stream_kernel_observer_(nullptr) {
@@ -220,20 +225,34 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
   void Init(const JobDesc* job_desc, ActorContext* actor_ctx) override {
     const TaskProto& task_proto = actor_ctx->task_proto();
     CHECK_EQ(task_proto.exec_sequence().exec_node_size(), 1);
+    stream_cuda_graph_ = StreamCudaGraph::Get(task_proto, actor_ctx->stream_ctx());
+    bool capturable = true;
     if (exec_kernel) {
       kernel_info_[0].reset(new KernelInfo());
       const KernelConf& kernel_conf = task_proto.exec_sequence().exec_node(0).kernel_conf();
       kernel_info_[0]->kernel = ConstructKernel(kernel_conf, this);
+      capturable = false;
 #ifdef WITH_CUDA_GRAPHS
       auto* cuda_stream = dynamic_cast<ep::CudaStream*>(actor_ctx->stream_ctx()->stream());
       if (cuda_stream != nullptr && kernel_conf.all_blobs_are_static()
           && IsCUDAGraphSupported(kernel_info_[0]->kernel.get())) {
-        cuda_graph_exec_[0].reset(new ep::CudaGraphExecutable());
+        capturable = true;
+        // The kernel is captured with the whole stream.
+        if (!stream_cuda_graph_) { cuda_graph_exec_[0].reset(new ep::CudaGraphExecutable()); }
       }
 #endif
     }
+    if (stream_cuda_graph_) {
+      std::function<void()> launcher;
+      if (exec_kernel) { launcher = [this]() { kernel_info_[0]->kernel->Launch(this); }; }
+      stream_cuda_graph_member_ = stream_cuda_graph_->AddMember(std::move(launcher), capturable);
+    }
     const int64_t thrd_id = ThrdId4ActorId(task_proto.task_id());
     thread_ = Global<ThreadMgr>::Get()->GetThrd(thrd_id);
+    pipeline_stage_id_ = PipelineBubbleProfile::StageId4ActorOpConf(
+        task_proto.exec_sequence().exec_node(0).kernel_conf().op_attribute().op_conf());
+    if (pipeline_stage_id_ >= 0) { job_name_ = job_desc->job_name(); }
+    runtime_stats_ = ActorRuntimeStats::New(job_desc->job_name(), task_proto);
     total_reading_cnt_ = 0;
     max_total_reading_cnt_ = 0;
     remaining_eord_cnt_ = 0;
@@ -293,15 +312,24 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
 
   int ProcessMsg(const ActorMsg& msg) override {
     HandleActorMsg(msg);
-    if (total_reading_cnt_ != 0) { return 0; }
+    if (total_reading_cnt_ != 0) {
+      if (OF_PREDICT_FALSE(runtime_stats_)) {
+        runtime_stats_->OnWait(IsReadReady(), BlockingProducedRegstDescId());
+      }
+      return 0;
+    }
     if (ready_consumed_ == max_ready_consumed_) {
       ActOnce();
+      if (OF_PREDICT_FALSE(runtime_stats_)) {
+        runtime_stats_->OnWait(IsReadReady(), BlockingProducedRegstDescId());
+      }
       return 0;
     }
     if (OF_PREDICT_FALSE(ready_consumed_ == 0 && remaining_eord_cnt_ == 0)) {
       SendEORDMsg();
       return 1;
     }
+    if (OF_PREDICT_FALSE(runtime_stats_)) { runtime_stats_->OnWait(false); }
     return 0;
   }
 
@@ -443,15 +471,36 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
     }
   }
 
+  inline bool IsReadReady() const { return ready_consumed_ == max_ready_consumed_; }
+
+  int64_t BlockingProducedRegstDescId() {
+    for (IndexType i = 0; i < index2state_.Size(); ++i) {
+      const auto& state = index2state_.Get(i);
+      if (state.regst_type == RegstType::kProduced && state.produced.reading_cnt != 0) {
+        return state.regst->regst_desc_id();
+      }
+    }
+    return -1;
+  }
+
   inline void ActOnce() {
     if (OF_PREDICT_FALSE(sync_post_act_msgs_.empty() && async_post_act_msgs_.empty())) {
       InitBnInOp2Blob();
       InitActMsg();
     }
-    if (exec_kernel) { LaunchKernel(); }
+    if (OF_PREDICT_FALSE(runtime_stats_)) { runtime_stats_->OnActBegin(); }
+    // Launched and sent by the stream cuda graph once the iteration is complete.
+    const bool deferred = OF_PREDICT_FALSE(stream_cuda_graph_)
+                          && stream_cuda_graph_->Act(stream_cuda_graph_member_,
+                                                     async_post_act_msgs_);
+    if (exec_kernel && !deferred) { LaunchKernel(); }
+    if (OF_PREDICT_FALSE(runtime_stats_)) { runtime_stats_->OnActEnd(); }
+    if (OF_PREDICT_FALSE(pipeline_stage_id_ >= 0)) {
+      PipelineBubbleProfile::Get()->OnStageAct(job_name_, pipeline_stage_id_);
+    }
     ResetState();
     thread_->EnqueueActorMsg(sync_post_act_msgs_.cbegin(), sync_post_act_msgs_.cend());
-    if (!async_post_act_msgs_.empty()) {
+    if (!deferred && !async_post_act_msgs_.empty()) {
       actor_ctx_->AddCallback([this]() {
         for (const auto& msg : async_post_act_msgs_) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
       });
@@ -480,16 +529,28 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
   }
 
   void SendEORDMsg() {
+    std::vector<const RtRegstDesc*> regst_descs;
     for (IndexType i = 0; i < index2state_.Size(); ++i) {
       auto& state = index2state_.Get(i);
       if (state.regst_type != RegstType::kProduced) { continue; }
-      const RtRegstDesc* regst_desc = state.regst->regst_desc();
-      actor_ctx_->AddCallback([regst_desc]() {
-        for (int64_t consumer : regst_desc->consumers_actor_id()) {
-          Global<ActorMsgBus>::Get()->SendMsg(
-              ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
-        }
-      });
+      regst_descs.emplace_back(state.regst->regst_desc());
+    }
+    // Refers to the stream context only, this actor may be gone when the stream cuda graph runs it.
+    StreamContext* stream_ctx = stream_ctx_;
+    auto SendEORDMsgs = [stream_ctx, regst_descs]() {
+      for (const RtRegstDesc* regst_desc : regst_descs) {
+        CHECK_JUST(stream_ctx->AddCallback([regst_desc]() {
+          for (int64_t consumer : regst_desc->consumers_actor_id()) {
+            Global<ActorMsgBus>::Get()->SendMsg(
+                ActorMsg::BuildEordMsg(consumer, regst_desc->regst_desc_id()));
+          }
+        }));
+      }
+    };
+    if (stream_cuda_graph_) {
+      stream_cuda_graph_->SendEord(stream_cuda_graph_member_, SendEORDMsgs);
+    } else {
+      SendEORDMsgs();
     }
   }
 
@@ -577,6 +638,14 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
   IndexType inplace_consumed_index_[inplace];
   std::function<void()> return_inplace_consumed_fn_[inplace];
   Thread* thread_;
+  // Set only if the pipeline bubble is profiled.
+  int64_t pipeline_stage_id_;
+  std::string job_name_;
+  // Set only if the runtime stats are enabled.
+  std::unique_ptr<ActorRuntimeStats> runtime_stats_;
+  // Set only if the actor is in a stream cuda graph.
+  std::shared_ptr<StreamCudaGraph> stream_cuda_graph_;
+  int64_t stream_cuda_graph_member_;
   std::unique_ptr<KernelInfo> kernel_info_[exec_kernel];
 #ifdef WITH_CUDA_GRAPHS
   std::unique_ptr<ep::CudaGraphExecutable> cuda_graph_exec_[exec_kernel];
@@ -671,7 +740,8 @@ ActorBase* TryNewLightActorWithoutInit(ActorContext* actor_ctx) {
     }
   } else if (task_proto.task_type() == TaskType::kCopyHd) {
     return NewLightActorWithKernel(actor_ctx);
-  } else if (task_proto.task_type() == TaskType::kTick) {
+  } else if (task_proto.task_type() == TaskType::kTick
+             || task_proto.task_type() == TaskType::kDeviceTick) {
     return NewLightActorWithoutKernel(actor_ctx);
   } else if (task_proto.task_type() == TaskType::kCollectiveBoxingGeneric) {
     return NewLightActorWithKernel(actor_ctx);
@@ -0,0 +1,183 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <mutex>
+#include "oneflow/core/lazy/actor/stream_cuda_graph.h"
+#include "oneflow/core/lazy/actor/actor_message_bus.h"
+#include "oneflow/core/job/task.pb.h"
+#include "oneflow/core/stream/include/stream_context.h"
+
+#ifdef WITH_CUDA
+
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+
+#endif  // WITH_CUDA
+
+namespace oneflow {
+
+namespace {
+
+#ifdef WITH_CUDA_GRAPHS
+
+std::shared_ptr<StreamCudaGraph> GetOrCreate(
+    int64_t thrd_id, int64_t job_id,
+    const std::function<std::shared_ptr<StreamCudaGraph>()>& Create) {
+  static std::mutex mutex;
+  static HashMap<std::pair<int64_t, int64_t>, std::weak_ptr<StreamCudaGraph>> key2graph;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::weak_ptr<StreamCudaGraph>& weak_graph = key2graph[std::make_pair(thrd_id, job_id)];
+  std::shared_ptr<StreamCudaGraph> graph = weak_graph.lock();
+  if (!graph) {
+    graph = Create();
+    weak_graph = graph;
+  }
+  return graph;
+}
+
+#endif  // WITH_CUDA_GRAPHS
+
+}  // namespace
+
+StreamCudaGraph::StreamCudaGraph(int64_t size, StreamContext* stream_ctx)
+    : size_(size),
+      stream_ctx_(stream_ctx),
+      state_(kUndecided),
+      all_capturable_(true),
+      next_iteration_(1) {}
+
+StreamCudaGraph::~StreamCudaGraph() = default;
+
+/*static*/ std::shared_ptr<StreamCudaGraph> StreamCudaGraph::Get(const TaskProto& task_proto,
+                                                                 StreamContext* stream_ctx) {
+#ifdef WITH_CUDA_GRAPHS
+  if (task_proto.stream_cuda_graph_size() <= 0) { return nullptr; }
+  if (dynamic_cast<ep::CudaStream*>(stream_ctx->stream()) == nullptr) { return nullptr; }
+  const int64_t size = task_proto.stream_cuda_graph_size();
+  std::shared_ptr<StreamCudaGraph> graph =
+      GetOrCreate(task_proto.thrd_id(), task_proto.job_id(), [&]() {
+        return std::shared_ptr<StreamCudaGraph>(new StreamCudaGraph(size, stream_ctx));
+      });
+  CHECK_EQ(graph->size_, size);
+  CHECK(graph->stream_ctx_ == stream_ctx);
+  return graph;
+#else
+  return nullptr;
+#endif  // WITH_CUDA_GRAPHS
+}
+
+int64_t StreamCudaGraph::AddMember(std::function<void()> launcher, bool capturable) {
+  CHECK_EQ(state_, kUndecided);
+  members_.emplace_back(Member{std::move(launcher), nullptr, 0, false});
+  all_capturable_ = all_capturable_ && capturable;
+  return members_.size() - 1;
+}
+
+void StreamCudaGraph::Decide() {
+  // Every member is initialized before any actor of the job acts.
+  if (static_cast<int64_t>(members_.size()) != size_) {
+    LOG(WARNING) << "Stream cuda graph disabled, " << members_.size() << " of " << size_
+                 << " actors joined";
+    state_ = kDisabled;
+  } else if (!all_capturable_) {
+    VLOG(1) << "Stream cuda graph disabled, some kernel of the " << size_
+            << " actors can not be captured";
+    state_ = kDisabled;
+  } else {
+    VLOG(1) << "Stream cuda graph of " << size_ << " actors enabled";
+    state_ = kEnabled;
+  }
+}
+
+bool StreamCudaGraph::Act(int64_t member, const std::vector<ActorMsg>& async_msgs) {
+  if (OF_PREDICT_FALSE(state_ == kUndecided)) { Decide(); }
+  if (state_ == kDisabled) { return false; }
+  Member& m = members_.at(member);
+  const int64_t iteration = m.act_cnt++;
+  if (iteration == 0) {
+    act_order_.emplace_back(member);
+    m.async_msgs = std::make_shared<const std::vector<ActorMsg>>(async_msgs);
+    return false;
+  }
+  const int64_t offset = iteration - next_iteration_;
+  CHECK_GE(offset, 0);
+  while (static_cast<int64_t>(iterations_.size()) <= offset) {
+    iterations_.emplace_back(Iteration{0, {}, {}});
+  }
+  Iteration& current = iterations_.at(offset);
+  current.act_cnt += 1;
+  if (!m.async_msgs->empty()) { current.members_with_async_msgs.emplace_back(member); }
+  // An iteration is complete only after the previous ones, every member acts in order.
+  while (!iterations_.empty() && iterations_.front().act_cnt == size_) {
+    Launch(&iterations_.front());
+    iterations_.pop_front();
+    next_iteration_ += 1;
+  }
+  return true;
+}
+
+void StreamCudaGraph::SendEord(int64_t member, std::function<void()> send_eord) {
+  Member& m = members_.at(member);
+  const int64_t last_iteration = m.act_cnt - 1;
+  if (state_ != kEnabled || last_iteration < next_iteration_) {
+    send_eord();
+  } else {
+    // The launcher of the member is gone once it returns.
+    if (!graph_exec_) { Capture(); }
+    iterations_.at(last_iteration - next_iteration_).eord_fns.emplace_back(std::move(send_eord));
+  }
+  m.finished = true;
+}
+
+void StreamCudaGraph::Capture() {
+#ifdef WITH_CUDA_GRAPHS
+  CHECK_EQ(static_cast<int64_t>(act_order_.size()), size_)
+      << "a member finished before the first iteration of the stream cuda graph";
+  auto* cuda_stream = stream_ctx_->stream()->As<ep::CudaStream>();
+  graph_exec_.reset(new ep::CudaGraphExecutable());
+  cuda_stream->BeginGraphCapture();
+  for (int64_t member : act_order_) {
+    const Member& m = members_.at(member);
+    CHECK(!m.finished);
+    if (m.launcher) { m.launcher(); }
+  }
+  cuda_stream->EndGraphCapture(graph_exec_.get());
+#else
+  UNIMPLEMENTED();
+#endif  // WITH_CUDA_GRAPHS
+}
+
+void StreamCudaGraph::Launch(Iteration* iteration) {
+#ifdef WITH_CUDA_GRAPHS
+  if (!graph_exec_) { Capture(); }
+  stream_ctx_->stream()->As<ep::CudaStream>()->LaunchGraph(graph_exec_.get());
+#else
+  UNIMPLEMENTED();
+#endif  // WITH_CUDA_GRAPHS
+  if (!iteration->members_with_async_msgs.empty()) {
+    std::vector<std::shared_ptr<const std::vector<ActorMsg>>> async_msgs;
+    async_msgs.reserve(iteration->members_with_async_msgs.size());
+    for (int64_t member : iteration->members_with_async_msgs) {
+      async_msgs.emplace_back(members_.at(member).async_msgs);
+    }
+    CHECK_JUST(stream_ctx_->AddCallback([async_msgs]() {
+      for (const auto& msgs : async_msgs) {
+        for (const auto& msg : *msgs) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
+      }
+    }));
+  }
+  for (const auto& send_eord : iteration->eord_fns) { send_eord(); }
+}
+
+}  // namespace oneflow
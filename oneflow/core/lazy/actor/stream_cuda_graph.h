@@ -0,0 +1,106 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_LAZY_ACTOR_STREAM_CUDA_GRAPH_H_
+#define ONEFLOW_CORE_LAZY_ACTOR_STREAM_CUDA_GRAPH_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/lazy/actor/actor_message.h"
+
+namespace oneflow {
+
+class TaskProto;
+class StreamContext;
+
+namespace ep {
+
+class CudaGraphExecutable;
+
+}  // namespace ep
+
+// The device work of all the actors a job runs on one cuda stream, replayed as a single cuda
+// graph per iteration. PlanUtil::GenStreamCudaGraphHint() marks the tasks of such a segment if
+// ONEFLOW_LAZY_ENABLE_STREAM_CUDA_GRAPH is set. The members run their first iteration as usual,
+// the order of their acts is recorded. From then on they only handle their messages: the
+// messages to the actors of the same thread are sent at once, the others are held back until
+// every member has acted in the iteration. The kernels of the members are then launched by one
+// cudaGraphLaunch, captured in the recorded order at the second iteration, and the held back
+// messages are sent by a callback of the stream. The segment is disabled, its members acting as
+// usual, if a member can not be captured or did not join it.
+// An instance is only used by the thread running its members.
+class StreamCudaGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StreamCudaGraph);
+  ~StreamCudaGraph();
+
+  // nullptr if the task is not marked by the plan or cuda graphs are not built.
+  static std::shared_ptr<StreamCudaGraph> Get(const TaskProto& task_proto,
+                                              StreamContext* stream_ctx);
+
+  // Called by every member in Init(). `launcher` launches the kernel of the member, empty for
+  // members without kernel. Returns the index of the member.
+  int64_t AddMember(std::function<void()> launcher, bool capturable);
+
+  // Called by a member instead of launching its kernel and sending `async_msgs`, which must be the
+  // same at every act. Returns false if the member has to do both itself.
+  bool Act(int64_t member, const std::vector<ActorMsg>& async_msgs);
+  // Runs `send_eord` once the messages held back for the member are sent. The member may be
+  // destroyed right after, `send_eord` must not refer to it.
+  void SendEord(int64_t member, std::function<void()> send_eord);
+
+ private:
+  StreamCudaGraph(int64_t size, StreamContext* stream_ctx);
+
+  enum State { kUndecided = 0, kEnabled, kDisabled };
+
+  struct Member {
+    std::function<void()> launcher;
+    // Shared with the callbacks sending them, which may outlive this.
+    std::shared_ptr<const std::vector<ActorMsg>> async_msgs;
+    int64_t act_cnt;
+    bool finished;
+  };
+
+  struct Iteration {
+    int64_t act_cnt;
+    std::vector<int64_t> members_with_async_msgs;
+    std::vector<std::function<void()>> eord_fns;
+  };
+
+  void Decide();
+  void Capture();
+  void Launch(Iteration* iteration);
+
+  int64_t size_;
+  StreamContext* stream_ctx_;
+  State state_;
+  bool all_capturable_;
+  std::vector<Member> members_;
+  std::vector<int64_t> act_order_;
+  // The iterations not launched yet, the first one is next_iteration_.
+  std::deque<Iteration> iterations_;
+  int64_t next_iteration_;
+#ifdef WITH_CUDA_GRAPHS
+  std::unique_ptr<ep::CudaGraphExecutable> graph_exec_;
+#endif  // WITH_CUDA_GRAPHS
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_LAZY_ACTOR_STREAM_CUDA_GRAPH_H_
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <algorithm>
 #include "oneflow/core/memory/chunk_manager.h"
 #include "oneflow/core/memory/memory_allocator.h"
 #include "oneflow/core/memory/memory_case_util.h"
@@ -47,6 +48,19 @@ void ChunkMgr::AddChunkProto(const ChunkProto& chunk) {
   CHECK(chunk_ids_it->second.insert(chunk.chunk_id()).second);
 }
 
+bool ChunkMgr::HasChunkProto(int64_t chunk_id) const {
+  return chunk_id2chunk_proto_.find(chunk_id) != chunk_id2chunk_proto_.end();
+}
+
+void ChunkMgr::GetAllChunkProtos(std::vector<const ChunkProto*>* chunks) const {
+  chunks->clear();
+  chunks->reserve(chunk_id2chunk_proto_.size());
+  for (const auto& pair : chunk_id2chunk_proto_) { chunks->emplace_back(pair.second.get()); }
+  std::sort(chunks->begin(), chunks->end(), [](const ChunkProto* lhs, const ChunkProto* rhs) {
+    return lhs->chunk_id() < rhs->chunk_id();
+  });
+}
+
 char* ChunkMgr::FindOrCreateChunk(const ChunkProto& chunk) {
   CHECK_EQ(GlobalProcessCtx::Rank(), chunk.machine_id());
   auto it = chunk_id2chunk_.find(chunk.chunk_id());
@@ -34,6 +34,9 @@ class ChunkMgr final {
   void GetChunkProtosByMemZoneUniqueId(int64_t mem_zone_uid,
                                        std::vector<const ChunkProto*>* chunks) const;
   void AddChunkProto(const ChunkProto& chunk);
+  bool HasChunkProto(int64_t chunk_id) const;
+  // Sorted by chunk id.
+  void GetAllChunkProtos(std::vector<const ChunkProto*>* chunks) const;
 
   // Runtime
   char* FindOrCreateChunk(const ChunkProto& chunk);
@@ -20,11 +20,36 @@ limitations under the License.
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/record/record.pb.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif  // __linux__
 
 namespace oneflow {
 
 namespace {
 
+// Maps `size` bytes backed by explicit huge pages from the hugetlbfs pool, or by transparent huge
+// pages if the pool has too few. Returns nullptr if neither is possible.
+char* MapHugePages(size_t huge_page_size, size_t size) {
+#ifdef __linux__
+  const size_t mapped_size = RoundUp(size, huge_page_size);
+  const int huge_page_shift = __builtin_ctzll(huge_page_size);
+  void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (huge_page_shift << MAP_HUGE_SHIFT),
+                   -1, 0);
+  if (ptr != MAP_FAILED) { return static_cast<char*>(ptr); }
+  ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) { return nullptr; }
+  if (madvise(ptr, mapped_size, MADV_HUGEPAGE) != 0) {
+    munmap(ptr, mapped_size);
+    return nullptr;
+  }
+  return static_cast<char*>(ptr);
+#else
+  return nullptr;
+#endif  // __linux__
+}
+
 std::shared_ptr<ep::Device> GetAllocationDevice(const MemoryCase& mem_case) {
   DeviceType device_type = DeviceType::kInvalidDevice;
   size_t device_index = 0;
@@ -75,14 +100,26 @@ void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr) {
   free(ptr);  // NOLINT
 }
 
+MemoryAllocator::MemoryAllocator() {
+  host_huge_page_size_ = ParseIntegerFromEnv("ONEFLOW_HOST_MEM_HUGE_PAGE_SIZE_MB", 0) * 1024 * 1024;
+  CHECK_EQ(host_huge_page_size_ & (host_huge_page_size_ - 1), 0U)
+      << "ONEFLOW_HOST_MEM_HUGE_PAGE_SIZE_MB should be a power of 2, such as 2 or 1024";
+}
+
 MemoryAllocator::~MemoryAllocator() {
   for (const std::function<void()>& deleter : deleters_) { deleter(); }
 }
 
 char* MemoryAllocator::Allocate(const MemoryCase& mem_case, std::size_t size) {
   const int memset_val = 0;
-  char* dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
+  char* dptr = nullptr;
+  if (mem_case.has_host_mem() && !mem_case.host_mem().has_cuda_pinned_mem()) {
+    dptr = AllocateHugePageHostMem(size);
+  }
+  if (dptr != nullptr) { return dptr; }
+  dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
   if (mem_case.has_host_mem()) {
+    // Also faults in the pages, so that the first iterations do not.
     memset(dptr, memset_val, size);
   } else if (mem_case.has_device_cuda_mem()) {
 #ifdef WITH_CUDA
@@ -102,6 +139,24 @@ void MemoryAllocator::Deallocate(char* dptr, const MemoryCase& mem_case) {
   MemoryAllocatorImpl::Deallocate(static_cast<void*>(dptr), mem_case);
 }
 
+char* MemoryAllocator::AllocateHugePageHostMem(std::size_t size) {
+  if (host_huge_page_size_ == 0 || size < host_huge_page_size_) { return nullptr; }
+  char* dptr = MapHugePages(host_huge_page_size_, size);
+  if (dptr == nullptr) {
+    LOG(WARNING) << "huge pages are unavailable for " << size << " bytes of host memory";
+    return nullptr;
+  }
+  // Mapped memory is zeroed, touching it faults in the huge pages now.
+  memset(dptr, 0, size);
+  const size_t mapped_size = RoundUp(size, host_huge_page_size_);
+  deleters_.push_front([dptr, mapped_size]() {
+#ifdef __linux__
+    munmap(dptr, mapped_size);
+#endif  // __linux__
+  });
+  return dptr;
+}
+
 void InitNonPODTypeBlobIfNeed(MemoryAllocator* allocator, Blob* blob_ptr) {
   const BlobDesc& blob_desc = blob_ptr->blob_desc();
   if (blob_desc.data_type() == kOFRecord) {
@@ -24,7 +24,7 @@ namespace oneflow {
 class MemoryAllocator final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(MemoryAllocator);
-  MemoryAllocator() = default;
+  MemoryAllocator();
   ~MemoryAllocator();
 
   char* Allocate(const MemoryCase& mem_case, std::size_t size);
@@ -33,7 +33,12 @@ class MemoryAllocator final {
 
  private:
   void Deallocate(char* dptr, const MemoryCase& mem_case);
+  // Returns nullptr if huge pages are disabled, unavailable or larger than `size`.
+  char* AllocateHugePageHostMem(std::size_t size);
 
+  // Unpinned host memory of at least a huge page is backed by huge pages of this size, 0 disables
+  // it.
+  std::size_t host_huge_page_size_;
   std::mutex deleters_mutex_;
   std::list<std::function<void()>> deleters_;
 };
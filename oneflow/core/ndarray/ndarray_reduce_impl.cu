@@ -113,6 +113,7 @@ void MatrixColReduceBy1BlockLayer(ep::Stream* stream, K num_elems, K num_cols, c
 
 const static int32_t kNumRows4OneBlockLayer = kCudaWarpSize * kCudaWarpSize;
 const static int32_t kNumCols4OneBlockLayer = kCudaMaxBlocksNum * kCudaWarpSize / 2;
+const static int32_t kMaxNumSegments4TwoPassXZReduce = 4096;
 
 template<template<typename> class R, typename T, typename K>
 void MatrixColReduceK(ep::Stream* stream, K num_rows, K num_cols, const T* in,
@@ -306,6 +307,7 @@ struct NdarrayXYZCubeXZReduce<DeviceType::kCUDA, T, binary_func> final {
   static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
                      const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
     CHECK(Matched(y, x));
+    if (TryTwoPassReduce(stream, y, x, tmp_storage, std::is_same<RetT, T>())) { return; }
     int32_t num_rows = y.shape().ElemNum();
     int32_t num_cols = x.shape().ElemNum() / y.shape().ElemNum();
 
@@ -331,6 +333,37 @@ struct NdarrayXYZCubeXZReduce<DeviceType::kCUDA, T, binary_func> final {
     CHECK_GE(tmp_storage.shape().ElemNum() * sizeof(T), tmp_storage_bytes);
     DoReduce(tmp_storage.ptr());
   }
+
+ private:
+  // Reductions such as BN statistics keep few y of many x * z elements, so the segmented reduce
+  // above runs one block per y and leaves most of the device idle. Reducing the contiguous z
+  // rows first and then the x columns of the partial results keeps both passes wide.
+  static bool TryTwoPassReduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                               const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage,
+                               std::true_type) {
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    if (dim_y > kMaxNumSegments4TwoPassXZReduce || dim_x < kCudaWarpSize) { return false; }
+    if (!IsKernelSafeInt32(x.shape().ElemNum())) { return false; }
+    // the partial results, followed by scratch space at least as large for the column pass
+    const int64_t num_partials = dim_x * dim_y;
+    if (tmp_storage.shape().ElemNum() < 2 * num_partials) { return false; }
+    T* partials = tmp_storage.ptr();
+    XpuVarNdarray<T> scratch(Shape({tmp_storage.shape().ElemNum() - num_partials}),
+                             partials + num_partials);
+    NdarrayMatrixRowReduce<DeviceType::kCUDA, T, binary_func>::Reduce(
+        stream, XpuVarNdarray<T>(Shape({num_partials, 1}), partials),
+        XpuVarNdarray<const T>(Shape({num_partials, dim_z}), x.ptr()), scratch);
+    MatrixColReduce<binary_func, T>(stream, dim_x, dim_y, partials, y.ptr(), scratch.ptr());
+    return true;
+  }
+
+  static bool TryTwoPassReduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                               const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage,
+                               std::false_type) {
+    return false;
+  }
 };
 
 namespace {
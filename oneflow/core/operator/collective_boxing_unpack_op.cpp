@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/common/protobuf.h"
 #include "oneflow/core/register/tensor_slice_view.h"
+#include "oneflow/core/common/balanced_splitter.h"
 
 namespace oneflow {
 
@@ -66,7 +67,12 @@ Maybe<void> CollectiveBoxingUnpackOp::InferOutBlobDescs(
   Shape out_shape(unpack_conf.logical_shape());
   if (unpack_conf.dst_sbp_parallel().has_split_parallel()) {
     const int64_t dst_split_axis = unpack_conf.dst_sbp_parallel().split_parallel().axis();
-    out_shape.Set(dst_split_axis, out_shape.At(dst_split_axis) / unpack_conf.num_ranks());
+    if (unpack_conf.has_rank()) {
+      const BalancedSplitter bs(out_shape.At(dst_split_axis), unpack_conf.num_ranks());
+      out_shape.Set(dst_split_axis, bs.At(unpack_conf.rank()).size());
+    } else {
+      out_shape.Set(dst_split_axis, out_shape.At(dst_split_axis) / unpack_conf.num_ranks());
+    }
   }
   CHECK_EQ_OR_RETURN(out_shape.elem_cnt(), in_blob_desc->shape().elem_cnt());
   out_blob_desc->mut_shape() = out_shape;
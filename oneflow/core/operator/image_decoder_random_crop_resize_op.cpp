@@ -32,8 +32,11 @@ Maybe<void> InferBlobDescs(const OperatorConf& op_conf,
   const BlobDesc* in = BlobDesc4BnInOp("in");
   BlobDesc* out = BlobDesc4BnInOp("out");
   CHECK_EQ_OR_RETURN(in->data_type(), DataType::kTensorBuffer);
+  CHECK_EQ_OR_RETURN(conf.mean_size(), conf.std_size());
+  CHECK_OR_RETURN(conf.mean_size() == 0 || conf.mean_size() == 3)
+      << "mean and std should have 3 elements, one per channel";
   *out = *in;
-  out->set_data_type(DataType::kUInt8);
+  out->set_data_type(conf.mean_size() == 0 ? DataType::kUInt8 : DataType::kFloat);
   DimVector out_dim_vec = in->shape().dim_vec();
   out_dim_vec.emplace_back(conf.target_height());
   out_dim_vec.emplace_back(conf.target_width());
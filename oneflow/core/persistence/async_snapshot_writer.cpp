@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/async_snapshot_writer.h"
+
+namespace oneflow {
+
+AsyncSnapshotWriter::AsyncSnapshotWriter(int32_t num_threads)
+    : cur_snapshot_id_(0),
+      done_snapshot_id_(0),
+      num_pending_writes_(0),
+      thread_pool_(std::max(num_threads, 1)) {}
+
+AsyncSnapshotWriter::~AsyncSnapshotWriter() { WaitAll(); }
+
+int64_t AsyncSnapshotWriter::Schedule(const std::string& snapshot_root_path,
+                                      const std::function<void()>& write) {
+  int64_t snapshot_id = 0;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (cur_snapshot_id_ == 0 || snapshot_root_path != cur_root_path_) {
+      cond_.wait(lock, [this]() { return num_pending_writes_ == 0; });
+      cur_root_path_ = snapshot_root_path;
+      cur_snapshot_id_ += 1;
+    }
+    num_pending_writes_ += 1;
+    snapshot_id = cur_snapshot_id_;
+  }
+  thread_pool_.AddWork([this, write]() {
+    write();
+    OnWriteDone();
+  });
+  return snapshot_id;
+}
+
+void AsyncSnapshotWriter::OnWriteDone() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  num_pending_writes_ -= 1;
+  if (num_pending_writes_ == 0) {
+    if (done_snapshot_id_ != cur_snapshot_id_) {
+      LOG(INFO) << "snapshot written to " << cur_root_path_;
+      done_snapshot_id_ = cur_snapshot_id_;
+    }
+    cond_.notify_all();
+  }
+}
+
+bool AsyncSnapshotWriter::IsDone(int64_t snapshot_id) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (snapshot_id < cur_snapshot_id_) { return true; }
+  return snapshot_id == cur_snapshot_id_ && num_pending_writes_ == 0;
+}
+
+void AsyncSnapshotWriter::Wait(int64_t snapshot_id) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&]() {
+    return snapshot_id < cur_snapshot_id_
+           || (snapshot_id == cur_snapshot_id_ && num_pending_writes_ == 0);
+  });
+}
+
+void AsyncSnapshotWriter::WaitAll() const { Wait(last_snapshot_id()); }
+
+int64_t AsyncSnapshotWriter::last_snapshot_id() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return cur_snapshot_id_;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
+#define ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
+
+#include <condition_variable>
+#include <mutex>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Writes snapshots to storage on background threads. The callers stage the data in host memory
+// and schedule the writes, so that training goes on while the snapshot is streamed out.
+// A snapshot is identified by its root path, the writes of consecutive calls with the same root
+// path belong to the same snapshot.
+class AsyncSnapshotWriter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AsyncSnapshotWriter);
+  explicit AsyncSnapshotWriter(int32_t num_threads);
+  ~AsyncSnapshotWriter();
+
+  // Schedules a write of the snapshot at the root path and returns the id of the snapshot.
+  // If the writes of the previous snapshot are still in flight, waits for them first, which also
+  // bounds the host memory taken by the staged data to one snapshot.
+  int64_t Schedule(const std::string& snapshot_root_path, const std::function<void()>& write);
+  // Whether all the writes scheduled so far for the snapshot are done.
+  bool IsDone(int64_t snapshot_id) const;
+  void Wait(int64_t snapshot_id) const;
+  void WaitAll() const;
+  int64_t last_snapshot_id() const;
+
+ private:
+  void OnWriteDone();
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable cond_;
+  std::string cur_root_path_;
+  int64_t cur_snapshot_id_;
+  int64_t done_snapshot_id_;
+  int64_t num_pending_writes_;
+  ThreadPool thread_pool_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_WRITER_H_
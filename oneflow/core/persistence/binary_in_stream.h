@@ -33,6 +33,8 @@ class BinaryInStream {
   virtual uint64_t cur_file_pos() const = 0;
   virtual void set_cur_file_pos(uint64_t val) = 0;
   virtual bool IsEof() const = 0;
+  // Hints that the stream will be read soon from cur_file_pos.
+  virtual void Prefetch() {}
 
  protected:
   BinaryInStream() = default;
@@ -15,23 +15,106 @@ limitations under the License.
 */
 #include "oneflow/core/persistence/binary_in_stream_without_local_copy.h"
 #include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/thread/thread_pool.h"
 #include <cstring>
 
 namespace oneflow {
 
-int32_t BinaryInStreamWithoutLocalCopy::Read(char* s, size_t n) {
-  if (IsEof()) return -1;
-  CHECK_LE(cur_file_pos_ + n, file_size_);
-  file_->Read(cur_file_pos_, n, s);
-  cur_file_pos_ += n;
-  return 0;
+namespace {
+
+ThreadPool* ReadaheadThreadPool() {
+  static ThreadPool* pool = new ThreadPool(std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_NUM_READAHEAD_THREADS", 8), 1));
+  return pool;
 }
 
+}  // namespace
+
+struct BinaryInStreamWithoutLocalCopy::ReadaheadChunk {
+  uint64_t offset;
+  std::vector<char> data;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return done; });
+  }
+  void SetDone() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done = true;
+    cond.notify_all();
+  }
+};
+
 BinaryInStreamWithoutLocalCopy::BinaryInStreamWithoutLocalCopy(fs::FileSystem* fs,
                                                                const std::string& file_path)
-    : cur_file_pos_(0) {
+    : cur_file_pos_(0), readahead_pos_(0) {
   fs->NewRandomAccessFile(file_path, &file_);
   file_size_ = fs->GetFileSize(file_path);
+  readahead_chunk_size_ = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_CHUNK_BYTES", 0), 0);
+  readahead_depth_ = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_DEPTH", 4), 1);
+}
+
+BinaryInStreamWithoutLocalCopy::~BinaryInStreamWithoutLocalCopy() { ClearReadahead(); }
+
+int32_t BinaryInStreamWithoutLocalCopy::Read(char* s, size_t n) {
+  if (IsEof()) return -1;
+  CHECK_LE(cur_file_pos_ + n, file_size_);
+  if (readahead_chunk_size_ == 0) {
+    file_->Read(cur_file_pos_, n, s);
+    cur_file_pos_ += n;
+    return 0;
+  }
+  while (n > 0) {
+    IssueReadahead();
+    const std::shared_ptr<ReadaheadChunk>& chunk = readahead_chunks_.front();
+    chunk->Wait();
+    const uint64_t chunk_end = chunk->offset + chunk->data.size();
+    CHECK_LE(chunk->offset, cur_file_pos_);
+    CHECK_LT(cur_file_pos_, chunk_end);
+    const size_t copy_size = std::min<uint64_t>(chunk_end - cur_file_pos_, n);
+    std::memcpy(s, chunk->data.data() + (cur_file_pos_ - chunk->offset), copy_size);
+    s += copy_size;
+    n -= copy_size;
+    cur_file_pos_ += copy_size;
+    if (cur_file_pos_ == chunk_end) { readahead_chunks_.pop_front(); }
+  }
+  return 0;
+}
+
+void BinaryInStreamWithoutLocalCopy::set_cur_file_pos(uint64_t val) {
+  if (val != cur_file_pos_) {
+    ClearReadahead();
+    readahead_pos_ = val;
+  }
+  cur_file_pos_ = val;
+}
+
+void BinaryInStreamWithoutLocalCopy::IssueReadahead() {
+  if (readahead_chunk_size_ == 0) { return; }
+  if (readahead_chunks_.empty()) { readahead_pos_ = cur_file_pos_; }
+  while (readahead_chunks_.size() < readahead_depth_ && readahead_pos_ < file_size_) {
+    auto chunk = std::make_shared<ReadaheadChunk>();
+    chunk->offset = readahead_pos_;
+    chunk->data.resize(std::min<uint64_t>(readahead_chunk_size_, file_size_ - readahead_pos_));
+    readahead_pos_ += chunk->data.size();
+    readahead_chunks_.emplace_back(chunk);
+    const fs::RandomAccessFile* file = file_.get();
+    ReadaheadThreadPool()->AddWork([chunk, file]() {
+      file->Read(chunk->offset, chunk->data.size(), chunk->data.data());
+      chunk->SetDone();
+    });
+  }
+}
+
+void BinaryInStreamWithoutLocalCopy::ClearReadahead() {
+  // In-flight reads refer to file_, they must finish before the chunks are dropped.
+  for (const auto& chunk : readahead_chunks_) { chunk->Wait(); }
+  readahead_chunks_.clear();
 }
 
 }  // namespace oneflow
@@ -21,24 +21,38 @@ limitations under the License.
 
 namespace oneflow {
 
+// With ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_CHUNK_BYTES set, the stream keeps up to
+// ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_DEPTH chunks ahead of cur_file_pos in flight, read
+// concurrently by a thread pool shared by all streams. This hides the per-request latency of
+// network file systems.
 class BinaryInStreamWithoutLocalCopy final : public BinaryInStream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(BinaryInStreamWithoutLocalCopy);
   BinaryInStreamWithoutLocalCopy() = delete;
-  virtual ~BinaryInStreamWithoutLocalCopy() = default;
+  ~BinaryInStreamWithoutLocalCopy() override;
 
   BinaryInStreamWithoutLocalCopy(fs::FileSystem*, const std::string& file_path);
   int32_t Read(char* s, size_t n) override;
 
   uint64_t file_size() const override { return file_size_; }
   uint64_t cur_file_pos() const override { return cur_file_pos_; }
-  void set_cur_file_pos(uint64_t val) override { cur_file_pos_ = val; }
+  void set_cur_file_pos(uint64_t val) override;
   bool IsEof() const override { return cur_file_pos_ == file_size_; }
+  void Prefetch() override { IssueReadahead(); }
 
  private:
+  struct ReadaheadChunk;
+
+  void IssueReadahead();
+  void ClearReadahead();
+
   std::unique_ptr<fs::RandomAccessFile> file_;
   uint64_t file_size_;
   uint64_t cur_file_pos_;
+  size_t readahead_chunk_size_;
+  size_t readahead_depth_;
+  uint64_t readahead_pos_;
+  std::deque<std::shared_ptr<ReadaheadChunk>> readahead_chunks_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,345 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/block_compressed_file.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <cstring>
+#include <lz4.h>
+#include <zlib.h>
+
+namespace oneflow {
+
+namespace {
+
+constexpr uint64_t kBlockCompressedFileMagic = 0x245A4B4C42464F5E;  // '^OFBLKZ$', little endian
+constexpr size_t kMaxBlockSize = 1 << 30;
+
+struct FileHeader {
+  uint64_t magic;
+  int32_t codec;
+  int32_t reserved;
+};
+
+// A block whose stored_size equals raw_size is not compressed.
+struct BlockHeader {
+  uint32_t raw_size;
+  uint32_t stored_size;
+};
+
+struct FileFooter {
+  uint64_t index_offset;
+  uint64_t num_blocks;
+  uint64_t raw_size;
+  uint64_t magic;
+};
+
+ThreadPool* DecompressThreadPool() {
+  static ThreadPool* pool = new ThreadPool(std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_NUM_DECOMPRESS_THREADS", 4), 1));
+  return pool;
+}
+
+template<typename T>
+void ReadPod(BinaryInStream* in_stream, uint64_t offset, T* pod) {
+  in_stream->set_cur_file_pos(offset);
+  CHECK_EQ(in_stream->Read(reinterpret_cast<char*>(pod), sizeof(T)), 0);
+}
+
+}  // namespace
+
+CompressionCodec ParseCompressionCodec(const std::string& name) {
+  if (name.empty() || name == "none") {
+    return CompressionCodec::kNone;
+  } else if (name == "lz4") {
+    return CompressionCodec::kLz4;
+  } else if (name == "zlib") {
+    return CompressionCodec::kZlib;
+  } else {
+    LOG(FATAL) << "unknown compression codec " << name;
+    return CompressionCodec::kNone;
+  }
+}
+
+std::string CompressionCodecName(CompressionCodec codec) {
+  switch (codec) {
+    case CompressionCodec::kNone: return "none";
+    case CompressionCodec::kLz4: return "lz4";
+    case CompressionCodec::kZlib: return "zlib";
+    default: LOG(FATAL) << "invalid compression codec " << static_cast<int32_t>(codec);
+  }
+  return "";
+}
+
+bool CompressBlock(CompressionCodec codec, const char* src, size_t size, std::vector<char>* dst) {
+  CHECK_LE(size, kMaxBlockSize);
+  if (codec == CompressionCodec::kLz4) {
+    const int bound = LZ4_compressBound(static_cast<int>(size));
+    dst->resize(bound);
+    const int compressed_size =
+        LZ4_compress_default(src, dst->data(), static_cast<int>(size), bound);
+    CHECK_GT(compressed_size, 0);
+    if (static_cast<size_t>(compressed_size) >= size) { return false; }
+    dst->resize(compressed_size);
+    return true;
+  } else if (codec == CompressionCodec::kZlib) {
+    uLongf compressed_size = compressBound(size);
+    dst->resize(compressed_size);
+    CHECK_EQ(compress2(reinterpret_cast<Bytef*>(dst->data()), &compressed_size,
+                       reinterpret_cast<const Bytef*>(src), size, Z_BEST_SPEED),
+             Z_OK);
+    if (compressed_size >= size) { return false; }
+    dst->resize(compressed_size);
+    return true;
+  } else {
+    CHECK(codec == CompressionCodec::kNone);
+    return false;
+  }
+}
+
+void DecompressBlock(CompressionCodec codec, const char* src, size_t size, char* dst,
+                     size_t raw_size) {
+  if (codec == CompressionCodec::kLz4) {
+    CHECK_EQ(LZ4_decompress_safe(src, dst, static_cast<int>(size), static_cast<int>(raw_size)),
+             static_cast<int>(raw_size))
+        << "corrupted lz4 block";
+  } else if (codec == CompressionCodec::kZlib) {
+    uLongf decompressed_size = raw_size;
+    CHECK_EQ(uncompress(reinterpret_cast<Bytef*>(dst), &decompressed_size,
+                        reinterpret_cast<const Bytef*>(src), size),
+             Z_OK)
+        << "corrupted zlib block";
+    CHECK_EQ(decompressed_size, raw_size);
+  } else {
+    LOG(FATAL) << "invalid compression codec " << static_cast<int32_t>(codec);
+  }
+}
+
+bool IsBlockCompressedData(const char* data, size_t size) {
+  if (size < sizeof(FileHeader)) { return false; }
+  uint64_t magic = 0;
+  std::memcpy(&magic, data, sizeof(magic));
+  return magic == kBlockCompressedFileMagic;
+}
+
+BlockCompressedFileWriter::BlockCompressedFileWriter(fs::WritableFile* file,
+                                                     CompressionCodec codec, size_t block_size)
+    : file_(file), codec_(codec), block_size_(block_size), raw_pos_(0), closed_(false) {
+  CHECK_GT(block_size_, 0);
+  CHECK_LE(block_size_, kMaxBlockSize);
+  FileHeader header{};
+  header.magic = kBlockCompressedFileMagic;
+  header.codec = static_cast<int32_t>(codec_);
+  file_->Append(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_pos_ = sizeof(header);
+  buffer_.reserve(block_size_);
+}
+
+BlockCompressedFileWriter::~BlockCompressedFileWriter() {
+  if (!closed_) { Close(); }
+}
+
+void BlockCompressedFileWriter::Append(const char* s, size_t n) {
+  CHECK(!closed_);
+  while (n > 0) {
+    if (buffer_.empty() && n >= block_size_) {
+      WriteBlock(s, block_size_);
+      s += block_size_;
+      n -= block_size_;
+      continue;
+    }
+    const size_t copy_size = std::min(block_size_ - buffer_.size(), n);
+    buffer_.insert(buffer_.end(), s, s + copy_size);
+    s += copy_size;
+    n -= copy_size;
+    if (buffer_.size() == block_size_) { Flush(); }
+  }
+}
+
+void BlockCompressedFileWriter::Flush() {
+  if (buffer_.empty()) { return; }
+  WriteBlock(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+void BlockCompressedFileWriter::Close() {
+  CHECK(!closed_);
+  Flush();
+  FileFooter footer{};
+  footer.index_offset = file_pos_;
+  footer.num_blocks = raw_offsets_.size();
+  footer.raw_size = raw_pos_;
+  footer.magic = kBlockCompressedFileMagic;
+  file_->Append(reinterpret_cast<const char*>(raw_offsets_.data()),
+                raw_offsets_.size() * sizeof(uint64_t));
+  file_->Append(reinterpret_cast<const char*>(file_offsets_.data()),
+                file_offsets_.size() * sizeof(uint64_t));
+  file_->Append(reinterpret_cast<const char*>(&footer), sizeof(footer));
+  closed_ = true;
+}
+
+void BlockCompressedFileWriter::WriteBlock(const char* s, size_t n) {
+  raw_offsets_.push_back(raw_pos_);
+  file_offsets_.push_back(file_pos_);
+  BlockHeader header{};
+  header.raw_size = n;
+  header.stored_size = n;
+  const char* stored = s;
+  if (CompressBlock(codec_, s, n, &compressed_)) {
+    header.stored_size = compressed_.size();
+    stored = compressed_.data();
+  }
+  file_->Append(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_->Append(stored, header.stored_size);
+  raw_pos_ += n;
+  file_pos_ += sizeof(header) + header.stored_size;
+}
+
+struct BlockCompressedBinaryInStream::DecompressedBlock {
+  uint64_t raw_offset;
+  std::vector<char> stored;
+  std::vector<char> data;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return done; });
+  }
+  void SetDone() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done = true;
+    cond.notify_all();
+  }
+};
+
+BlockCompressedBinaryInStream::BlockCompressedBinaryInStream(
+    std::unique_ptr<BinaryInStream>&& in_stream)
+    : in_stream_(std::move(in_stream)), cur_file_pos_(0), next_block_(0) {
+  const uint64_t stored_file_size = in_stream_->file_size();
+  CHECK_GE(stored_file_size, sizeof(FileHeader) + sizeof(FileFooter));
+  FileHeader header{};
+  ReadPod(in_stream_.get(), 0, &header);
+  CHECK_EQ(header.magic, kBlockCompressedFileMagic);
+  codec_ = static_cast<CompressionCodec>(header.codec);
+  FileFooter footer{};
+  ReadPod(in_stream_.get(), stored_file_size - sizeof(FileFooter), &footer);
+  CHECK_EQ(footer.magic, kBlockCompressedFileMagic);
+  CHECK_EQ(footer.index_offset + footer.num_blocks * 2 * sizeof(uint64_t) + sizeof(FileFooter),
+           stored_file_size)
+      << "corrupted block compressed file";
+  raw_size_ = footer.raw_size;
+  index_file_offset_ = footer.index_offset;
+  raw_offsets_.resize(footer.num_blocks);
+  file_offsets_.resize(footer.num_blocks);
+  if (footer.num_blocks > 0) {
+    in_stream_->set_cur_file_pos(footer.index_offset);
+    CHECK_EQ(in_stream_->Read(reinterpret_cast<char*>(raw_offsets_.data()),
+                              footer.num_blocks * sizeof(uint64_t)),
+             0);
+    CHECK_EQ(in_stream_->Read(reinterpret_cast<char*>(file_offsets_.data()),
+                              footer.num_blocks * sizeof(uint64_t)),
+             0);
+  }
+  decompress_depth_ = std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_PERSISTENT_IN_STREAM_DECOMPRESS_DEPTH", 4), 1);
+}
+
+bool BlockCompressedBinaryInStream::IsBlockCompressed(BinaryInStream* in_stream) {
+  const uint64_t stored_file_size = in_stream->file_size();
+  if (stored_file_size < sizeof(FileHeader) + sizeof(FileFooter)) { return false; }
+  const uint64_t pos = in_stream->cur_file_pos();
+  FileHeader header{};
+  ReadPod(in_stream, 0, &header);
+  bool ret = header.magic == kBlockCompressedFileMagic;
+  if (ret) {
+    FileFooter footer{};
+    ReadPod(in_stream, stored_file_size - sizeof(FileFooter), &footer);
+    ret = footer.magic == kBlockCompressedFileMagic;
+  }
+  in_stream->set_cur_file_pos(pos);
+  return ret;
+}
+
+int32_t BlockCompressedBinaryInStream::Read(char* s, size_t n) {
+  if (IsEof()) { return -1; }
+  CHECK_LE(cur_file_pos_ + n, raw_size_);
+  while (n > 0) {
+    IssueDecompress();
+    const std::shared_ptr<DecompressedBlock>& block = blocks_.front();
+    block->Wait();
+    const uint64_t block_end = block->raw_offset + block->data.size();
+    CHECK_LE(block->raw_offset, cur_file_pos_);
+    CHECK_LT(cur_file_pos_, block_end);
+    const size_t copy_size = std::min<uint64_t>(block_end - cur_file_pos_, n);
+    std::memcpy(s, block->data.data() + (cur_file_pos_ - block->raw_offset), copy_size);
+    s += copy_size;
+    n -= copy_size;
+    cur_file_pos_ += copy_size;
+    if (cur_file_pos_ == block_end) { blocks_.pop_front(); }
+  }
+  return 0;
+}
+
+void BlockCompressedBinaryInStream::set_cur_file_pos(uint64_t val) {
+  CHECK_LE(val, raw_size_);
+  // Blocks in flight hold no reference to the stream, they can be dropped without waiting.
+  if (val != cur_file_pos_) { blocks_.clear(); }
+  cur_file_pos_ = val;
+}
+
+size_t BlockCompressedBinaryInStream::BlockIndex(uint64_t raw_pos) const {
+  auto it = std::upper_bound(raw_offsets_.begin(), raw_offsets_.end(), raw_pos);
+  CHECK(it != raw_offsets_.begin());
+  return std::distance(raw_offsets_.begin(), it) - 1;
+}
+
+void BlockCompressedBinaryInStream::IssueDecompress() {
+  if (blocks_.empty()) {
+    if (IsEof()) { return; }
+    next_block_ = BlockIndex(cur_file_pos_);
+  }
+  const size_t num_blocks = raw_offsets_.size();
+  while (blocks_.size() < decompress_depth_ && next_block_ < num_blocks) {
+    const size_t i = next_block_;
+    const uint64_t file_end = i + 1 < num_blocks ? file_offsets_[i + 1] : index_file_offset_;
+    const uint64_t raw_end = i + 1 < num_blocks ? raw_offsets_[i + 1] : raw_size_;
+    auto block = std::make_shared<DecompressedBlock>();
+    block->raw_offset = raw_offsets_[i];
+    BlockHeader header{};
+    ReadPod(in_stream_.get(), file_offsets_[i], &header);
+    CHECK_EQ(header.raw_size, raw_end - raw_offsets_[i]);
+    CHECK_EQ(sizeof(BlockHeader) + header.stored_size, file_end - file_offsets_[i]);
+    block->data.resize(header.raw_size);
+    next_block_ += 1;
+    blocks_.emplace_back(block);
+    if (header.stored_size == header.raw_size) {
+      CHECK_EQ(in_stream_->Read(block->data.data(), header.raw_size), 0);
+      block->SetDone();
+      continue;
+    }
+    block->stored.resize(header.stored_size);
+    CHECK_EQ(in_stream_->Read(block->stored.data(), header.stored_size), 0);
+    const CompressionCodec codec = codec_;
+    DecompressThreadPool()->AddWork([block, codec]() {
+      DecompressBlock(codec, block->stored.data(), block->stored.size(), block->data.data(),
+                      block->data.size());
+      std::vector<char>().swap(block->stored);
+      block->SetDone();
+    });
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,117 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_BLOCK_COMPRESSED_FILE_H_
+#define ONEFLOW_CORE_PERSISTENCE_BLOCK_COMPRESSED_FILE_H_
+
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/binary_in_stream.h"
+
+namespace oneflow {
+
+// A block compressed file is laid out as
+//   header | block 0 | ... | block n-1 | index | footer
+// where each block is a BlockHeader followed by the stored bytes. The index maps the raw offset
+// of every block to its file offset, so that readers can seek without decompressing the blocks
+// in front. A block the codec can not shrink is stored as is.
+
+enum class CompressionCodec : int32_t {
+  kNone = 0,
+  kLz4 = 1,
+  kZlib = 2,
+};
+
+// "none", "lz4" or "zlib".
+CompressionCodec ParseCompressionCodec(const std::string& name);
+std::string CompressionCodecName(CompressionCodec codec);
+
+// Returns false if the compressed block would not be smaller than the raw one.
+bool CompressBlock(CompressionCodec codec, const char* src, size_t size, std::vector<char>* dst);
+void DecompressBlock(CompressionCodec codec, const char* src, size_t size, char* dst,
+                     size_t raw_size);
+
+// Whether the first bytes of data are the header of a block compressed file.
+bool IsBlockCompressedData(const char* data, size_t size);
+
+class BlockCompressedFileWriter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BlockCompressedFileWriter);
+  BlockCompressedFileWriter(fs::WritableFile* file, CompressionCodec codec, size_t block_size);
+  ~BlockCompressedFileWriter();
+
+  void Append(const char* s, size_t n);
+  // Stores the buffered bytes as a block even if it is not full.
+  void Flush();
+  // Writes the index and the footer, the file must not be appended to afterwards.
+  void Close();
+
+ private:
+  void WriteBlock(const char* s, size_t n);
+
+  fs::WritableFile* file_;
+  CompressionCodec codec_;
+  size_t block_size_;
+  std::vector<char> buffer_;
+  std::vector<char> compressed_;
+  std::vector<uint64_t> raw_offsets_;
+  std::vector<uint64_t> file_offsets_;
+  uint64_t raw_pos_;
+  uint64_t file_pos_;
+  bool closed_;
+};
+
+// Reads the raw bytes of a block compressed file from the stream of the file. Up to
+// ONEFLOW_PERSISTENT_IN_STREAM_DECOMPRESS_DEPTH blocks ahead of cur_file_pos are decompressed
+// concurrently by a thread pool shared by all streams.
+class BlockCompressedBinaryInStream final : public BinaryInStream {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BlockCompressedBinaryInStream);
+  BlockCompressedBinaryInStream() = delete;
+  ~BlockCompressedBinaryInStream() override = default;
+
+  explicit BlockCompressedBinaryInStream(std::unique_ptr<BinaryInStream>&& in_stream);
+
+  // Checks the header and the footer of the file, the position of in_stream is restored.
+  static bool IsBlockCompressed(BinaryInStream* in_stream);
+
+  int32_t Read(char* s, size_t n) override;
+
+  uint64_t file_size() const override { return raw_size_; }
+  uint64_t cur_file_pos() const override { return cur_file_pos_; }
+  void set_cur_file_pos(uint64_t val) override;
+  bool IsEof() const override { return cur_file_pos_ == raw_size_; }
+  void Prefetch() override { IssueDecompress(); }
+
+ private:
+  struct DecompressedBlock;
+
+  size_t BlockIndex(uint64_t raw_pos) const;
+  void IssueDecompress();
+
+  std::unique_ptr<BinaryInStream> in_stream_;
+  CompressionCodec codec_;
+  std::vector<uint64_t> raw_offsets_;
+  std::vector<uint64_t> file_offsets_;
+  uint64_t raw_size_;
+  uint64_t index_file_offset_;
+  uint64_t cur_file_pos_;
+  size_t decompress_depth_;
+  size_t next_block_;
+  std::deque<std::shared_ptr<DecompressedBlock>> blocks_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_BLOCK_COMPRESSED_FILE_H_
@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/block_compressed_file.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+std::string GenContent(size_t size) {
+  std::string content;
+  for (size_t i = 0; i < size; ++i) { content.push_back('a' + (i / 5 + i * i % 3) % 26); }
+  return content;
+}
+
+}  // namespace
+
+TEST(BlockCompressedFile, compress_block) {
+  const std::string content = GenContent(4096);
+  for (CompressionCodec codec : {CompressionCodec::kLz4, CompressionCodec::kZlib}) {
+    std::vector<char> compressed;
+    ASSERT_TRUE(CompressBlock(codec, content.data(), content.size(), &compressed));
+    ASSERT_LT(compressed.size(), content.size());
+    std::string decompressed(content.size(), '\0');
+    DecompressBlock(codec, compressed.data(), compressed.size(), &decompressed[0],
+                    decompressed.size());
+    ASSERT_EQ(decompressed, content);
+  }
+  std::vector<char> compressed;
+  ASSERT_FALSE(CompressBlock(CompressionCodec::kNone, content.data(), content.size(), &compressed));
+  ASSERT_TRUE(ParseCompressionCodec("lz4") == CompressionCodec::kLz4);
+  ASSERT_EQ(CompressionCodecName(CompressionCodec::kZlib), "zlib");
+}
+
+TEST(BlockCompressedFile, read_with_persistent_in_stream) {
+#ifdef OF_PLATFORM_POSIX
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_DECOMPRESS_DEPTH", "3", 1);
+  fs::PosixFileSystem file_system;
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string content = GenContent(1000);
+  for (CompressionCodec codec :
+       {CompressionCodec::kNone, CompressionCodec::kLz4, CompressionCodec::kZlib}) {
+    const std::string file_name =
+        JoinPath(current_dir, "/tmp_test_block_compressed_" + CompressionCodecName(codec));
+    {
+      std::unique_ptr<fs::WritableFile> file;
+      file_system.NewWritableFile(file_name, &file);
+      BlockCompressedFileWriter writer(file.get(), codec, 64);
+      writer.Append(content.data(), 100);
+      // Flushing leaves a short block in the middle of the file.
+      writer.Flush();
+      writer.Append(content.data() + 100, content.size() - 100);
+      writer.Close();
+      file->Close();
+    }
+    {
+      PersistentInStream in_stream(&file_system, file_name);
+      std::string actual(content.size(), '\0');
+      for (size_t pos = 0; pos < actual.size(); pos += 7) {
+        ASSERT_EQ(in_stream.ReadFully(&actual[pos], std::min<size_t>(7, actual.size() - pos)),
+                  0);
+      }
+      ASSERT_EQ(actual, content);
+      char c = 0;
+      ASSERT_EQ(in_stream.ReadFully(&c, 1), -1);
+    }
+    {
+      PersistentInStream in_stream(&file_system, file_name, 130);
+      std::string actual(content.size() - 130, '\0');
+      ASSERT_EQ(in_stream.ReadFully(&actual[0], actual.size()), 0);
+      ASSERT_EQ(actual, content.substr(130));
+    }
+    file_system.DelFile(file_name);
+  }
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_DECOMPRESS_DEPTH");
+#endif
+}
+
+}  // namespace oneflow
@@ -0,0 +1,274 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/control/ctrl_bootstrap.h"
+#include "oneflow/core/control/ctrl_util.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/hadoop/hadoop_file_system.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/persistent_out_stream.h"
+#include "oneflow/core/persistence/sharded_snapshot.h"
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
+#include "oneflow/core/rpc/include/local.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "nlohmann/json.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+// Saves and loads a synthetic model, variables of random bytes, through each file system backend
+// and through the snapshot formats, and prints the GB/s of each as json next to the per-phase
+// breakdown of the checkpoint io metrics. It is configured through the environment:
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_DIR: local directory written to, a temporary one by default.
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_MODEL_MBYTE: size of the model, 1024 by default.
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_NUM_VARIABLES: number of variables, 64 by default.
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_HDFS_NAMENODE: namenode of hdfs, hdfs is skipped if unset.
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_HDFS_DIR: hdfs directory written to.
+//   ONEFLOW_CHECKPOINT_IO_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+// The snapshot formats go through SnapshotFS(), which ONEFLOW_SNAPSHOT_FILE_SYSTEM_TYPE selects.
+// The page cache is not dropped between saving and loading, loads of models that fit in it are
+// served from memory.
+
+namespace oneflow {
+
+namespace {
+
+// The writers coordinate through the control plane, this sets up a single process one.
+class ControlPlaneScope final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ControlPlaneScope);
+  ControlPlaneScope() {
+    Global<ProcessCtx>::New();
+#ifdef RPC_BACKEND_GRPC
+    EnvProto env_proto;
+    auto* machine = env_proto.add_machine();
+    machine->set_id(0);
+    machine->set_addr("127.0.0.1");
+    const int port = CtrlUtil().FindAvailablePort();
+    CHECK_NE(port, -1);
+    env_proto.set_ctrl_port(port);
+    Global<EnvDesc>::New(env_proto);
+    Global<CtrlServer>::New();
+    CHECK_JUST(HostListCtrlBootstrap(*Global<EnvDesc>::Get())
+                   .InitProcessCtx(Global<CtrlServer>::Get()->port(), Global<ProcessCtx>::Get()));
+    Global<CtrlClient>::SetAllocated(new GrpcCtrlClient(*Global<ProcessCtx>::Get()));
+#else
+    Address* addr = Global<ProcessCtx>::Get()->add_ctrl_addr();
+    addr->set_host("localhost");
+    Global<ProcessCtx>::Get()->set_rank(0);
+    Global<ProcessCtx>::Get()->set_node_size(1);
+    Global<CtrlClient>::SetAllocated(new LocalCtrlClient(*Global<ProcessCtx>::Get()));
+#endif
+    Global<ThreadPool>::New(4);
+    Global<ep::DeviceManagerRegistry>::New();
+  }
+  ~ControlPlaneScope() {
+    Global<ep::DeviceManagerRegistry>::Delete();
+    Global<ThreadPool>::Delete();
+    Global<CtrlClient>::Delete();
+#ifdef RPC_BACKEND_GRPC
+    Global<CtrlServer>::Delete();
+    Global<EnvDesc>::Delete();
+#endif
+    Global<ProcessCtx>::Delete();
+  }
+};
+
+struct SyntheticModel {
+  std::vector<std::string> keys;
+  std::vector<std::vector<char>> values;
+
+  int64_t ByteSize() const {
+    int64_t size = 0;
+    for (const auto& value : values) { size += value.size(); }
+    return size;
+  }
+};
+
+SyntheticModel NewSyntheticModel(int64_t model_bytes, int64_t num_variables) {
+  SyntheticModel model;
+  std::mt19937_64 gen(0);
+  const int64_t variable_bytes = RoundUp(model_bytes / num_variables, sizeof(uint64_t));
+  for (int64_t i = 0; i < num_variables; ++i) {
+    model.keys.emplace_back("variable_" + std::to_string(i) + "/out");
+    std::vector<char> value(variable_bytes);
+    uint64_t* words = reinterpret_cast<uint64_t*>(value.data());
+    for (size_t j = 0; j < value.size() / sizeof(uint64_t); ++j) { words[j] = gen(); }
+    model.values.emplace_back(std::move(value));
+  }
+  return model;
+}
+
+class Timer final {
+ public:
+  Timer(std::string backend, std::vector<nlohmann::json>* records)
+      : backend_(std::move(backend)), records_(records) {}
+  ~Timer() = default;
+
+  void Run(const std::string& stage, int64_t bytes, const std::function<void()>& Stage) {
+    const auto start = std::chrono::steady_clock::now();
+    Stage();
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    nlohmann::json record;
+    record["backend"] = backend_;
+    record["stage"] = stage;
+    record["bytes"] = bytes;
+    record["seconds"] = seconds;
+    record["gbps"] = seconds > 0 ? bytes / seconds / 1e9 : 0.0;
+    records_->emplace_back(std::move(record));
+  }
+
+ private:
+  std::string backend_;
+  std::vector<nlohmann::json>* records_;
+};
+
+// One file per variable, written with PersistentOutStream and read with PersistentInStream.
+void BenchmarkFileSystem(const std::string& backend, fs::FileSystem* fs, const std::string& dir,
+                         const SyntheticModel& model, std::vector<nlohmann::json>* records) {
+  Timer timer(backend, records);
+  fs->RecursivelyCreateDirIfNotExist(dir);
+  timer.Run("save", model.ByteSize(), [&]() {
+    for (size_t i = 0; i < model.keys.size(); ++i) {
+      PersistentOutStream out_stream(fs, JoinPath(dir, model.keys.at(i)));
+      out_stream.Write(model.values.at(i).data(), model.values.at(i).size());
+    }
+  });
+  std::vector<char> buffer(model.values.front().size());
+  timer.Run("load", model.ByteSize(), [&]() {
+    for (size_t i = 0; i < model.keys.size(); ++i) {
+      PersistentInStream in_stream(fs, JoinPath(dir, model.keys.at(i)));
+      CHECK_EQ(in_stream.ReadFully(buffer.data(), model.values.at(i).size()), 0);
+    }
+  });
+  fs->RecursivelyDeleteDir(dir);
+}
+
+void BenchmarkSnapshot(const std::string& dir, const SyntheticModel& model,
+                       std::vector<nlohmann::json>* records) {
+  Timer timer("snapshot", records);
+  timer.Run("save", model.ByteSize(), [&]() {
+    SnapshotWriter writer(dir);
+    for (size_t i = 0; i < model.keys.size(); ++i) {
+      writer.Write(model.keys.at(i), model.values.at(i).data(), model.values.at(i).size());
+    }
+    writer.Close();
+  });
+  std::vector<char> buffer(model.values.front().size());
+  timer.Run("load", model.ByteSize(), [&]() {
+    SnapshotReader reader(dir);
+    for (size_t i = 0; i < model.keys.size(); ++i) {
+      const Shape shape({static_cast<int64_t>(model.values.at(i).size())});
+      reader.Read(model.keys.at(i), shape, DataType::kChar, TensorSliceView(shape),
+                  buffer.data());
+    }
+  });
+  SnapshotFS()->RecursivelyDeleteDir(dir);
+}
+
+// Two shards holding the halves of every variable.
+void BenchmarkShardedSnapshot(const std::string& dir, const SyntheticModel& model,
+                              std::vector<nlohmann::json>* records) {
+  Timer timer("sharded_snapshot", records);
+  timer.Run("save", model.ByteSize(), [&]() {
+    for (int64_t shard = 0; shard < 2; ++shard) {
+      ShardedSnapshotWriter writer(dir, "shard-" + std::to_string(shard));
+      for (size_t i = 0; i < model.keys.size(); ++i) {
+        const int64_t size = model.values.at(i).size();
+        const Shape shape({size});
+        const TensorSliceView slice({Range(shard * size / 2, (shard + 1) * size / 2)});
+        writer.Write(model.keys.at(i), shape, DataType::kChar, slice,
+                     model.values.at(i).data() + slice.At(0).begin());
+      }
+      writer.Close();
+    }
+  });
+  std::vector<char> buffer(model.values.front().size());
+  timer.Run("load", model.ByteSize(), [&]() {
+    SnapshotReader reader(dir);
+    for (size_t i = 0; i < model.keys.size(); ++i) {
+      const Shape shape({static_cast<int64_t>(model.values.at(i).size())});
+      reader.Read(model.keys.at(i), shape, DataType::kChar, TensorSliceView(shape),
+                  buffer.data());
+    }
+  });
+  SnapshotFS()->RecursivelyDeleteDir(dir);
+}
+
+int Main() {
+  ControlPlaneScope control_plane_scope;
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir = GetStringFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_DIR",
+                                           JoinPath(current_dir, "tmp_checkpoint_io_benchmark"));
+  const int64_t model_mbyte =
+      ParseIntegerFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_MODEL_MBYTE", 1024);
+  const int64_t num_variables =
+      ParseIntegerFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_NUM_VARIABLES", 64);
+  CHECK_GT(model_mbyte, 0);
+  CHECK_GT(num_variables, 0);
+  const SyntheticModel model = NewSyntheticModel(model_mbyte << 20, num_variables);
+
+  std::vector<nlohmann::json> records;
+  profiler::ResetCheckpointIOMetrics();
+  {
+    fs::PosixFileSystem posix_fs(false);
+    BenchmarkFileSystem("posix", &posix_fs, JoinPath(dir, "posix"), model, &records);
+    fs::PosixFileSystem posix_direct_fs(true);
+    BenchmarkFileSystem("posix_direct_io", &posix_direct_fs, JoinPath(dir, "posix_direct_io"),
+                        model, &records);
+  }
+  const std::string hdfs_namenode =
+      GetStringFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_HDFS_NAMENODE", "");
+  if (!hdfs_namenode.empty()) {
+    fs::HadoopFileSystem hdfs(hdfs_namenode);
+    BenchmarkFileSystem("hdfs", &hdfs,
+                        GetStringFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_HDFS_DIR",
+                                         "/tmp/oneflow_checkpoint_io_benchmark"),
+                        model, &records);
+  }
+  BenchmarkSnapshot(JoinPath(dir, "snapshot"), model, &records);
+  BenchmarkShardedSnapshot(JoinPath(dir, "sharded_snapshot"), model, &records);
+
+  nlohmann::json result;
+  result["records"] = records;
+  result["phases"] = nlohmann::json::parse(profiler::GetCheckpointIOMetricsSummary());
+  const std::string output = GetStringFromEnv("ONEFLOW_CHECKPOINT_IO_BENCHMARK_OUTPUT", "");
+  const std::string json = result.dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main() { return oneflow::Main(); }
@@ -124,14 +124,16 @@ void FileSystem::RecursivelyCreateDir(const std::string& dirname) {
 
 }  // namespace fs
 
-void CreateLocalFS(std::unique_ptr<fs::FileSystem>& fs) {
+void CreateLocalFS(std::unique_ptr<fs::FileSystem>& fs, bool direct_io) {
 #ifdef OF_PLATFORM_POSIX
-  fs.reset(new fs::PosixFileSystem);
+  fs.reset(new fs::PosixFileSystem(direct_io));
 #else
   OF_UNIMPLEMENTED();
 #endif
 }
 
+void CreateLocalFS(std::unique_ptr<fs::FileSystem>& fs) { CreateLocalFS(fs, false); }
+
 void CreateHadoopFS(std::unique_ptr<fs::FileSystem>& fs, const std::string& namenode) {
   fs.reset(new fs::HadoopFileSystem(namenode));
 }
@@ -151,6 +153,8 @@ void CreateFileSystemFromEnv(std::unique_ptr<fs::FileSystem>& fs, const std::str
 
   if (fs_type_str == "local") {
     CreateLocalFS(fs);
+  } else if (fs_type_str == "local_direct") {
+    CreateLocalFS(fs, true);
   } else if (fs_type_str == "hdfs") {
     auto hdfs_nn_env = env_prefix + "_HDFS_NAMENODE";
     const char* hdfs_namenode = std::getenv(hdfs_nn_env.c_str());
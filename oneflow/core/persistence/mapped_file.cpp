@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/mapped_file.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+#ifdef OF_PLATFORM_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+#ifdef OF_PLATFORM_POSIX
+
+std::unique_ptr<MappedFile> MappedFile::Open(fs::FileSystem* file_system,
+                                             const std::string& path) {
+  if (dynamic_cast<fs::PosixFileSystem*>(file_system) == nullptr) { return nullptr; }
+  const size_t size = file_system->GetFileSize(path);
+  if (size == 0) { return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0)); }
+  const int fd = open(path.c_str(), O_RDONLY);
+  PCHECK(fd >= 0) << "Fail to open file " << path;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    PLOG(WARNING) << "Fail to map file " << path;
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(addr, size));
+}
+
+MappedFile::~MappedFile() {
+  if (addr_ != nullptr) { PCHECK(munmap(addr_, size_) == 0); }
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const {
+  if (size == 0) { return; }
+  CHECK_LE(offset + size, size_);
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t begin = offset / page_size * page_size;
+  madvise(static_cast<char*>(addr_) + begin, offset + size - begin, MADV_WILLNEED);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::Open(fs::FileSystem* file_system,
+                                             const std::string& path) {
+  return nullptr;
+}
+
+MappedFile::~MappedFile() = default;
+
+void MappedFile::WillNeed(size_t offset, size_t size) const {}
+
+#endif  // OF_PLATFORM_POSIX
+
+}  // namespace oneflow
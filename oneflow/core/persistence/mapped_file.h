@@ -0,0 +1,48 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_MAPPED_FILE_H_
+#define ONEFLOW_CORE_PERSISTENCE_MAPPED_FILE_H_
+
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+// Read-only memory mapping of a whole file. Pages are read from the page cache on first access,
+// so a rank copying out only its slice of a checkpoint file never reads the rest of it.
+class MappedFile final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedFile);
+  ~MappedFile();
+
+  // Returns nullptr if files of the file system can not be mapped.
+  static std::unique_ptr<MappedFile> Open(fs::FileSystem* file_system, const std::string& path);
+
+  const char* data() const { return static_cast<const char*>(addr_); }
+  size_t size() const { return size_; }
+
+  // Hints the kernel to read ahead the pages backing [offset, offset + size).
+  void WillNeed(size_t offset, size_t size) const;
+
+ private:
+  MappedFile(void* addr, size_t size) : addr_(addr), size_(size) {}
+
+  void* addr_;
+  size_t size_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_MAPPED_FILE_H_
@@ -0,0 +1,49 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/mapped_file.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+TEST(MappedFile, read_slice) {
+#ifdef OF_PLATFORM_POSIX
+  fs::PosixFileSystem file_system;
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string file_name = JoinPath(current_dir, "/tmp_test_mapped_file");
+  std::string content;
+  for (int i = 0; i < 10000; ++i) { content.push_back('a' + i % 26); }
+  {
+    std::unique_ptr<fs::WritableFile> file;
+    file_system.NewWritableFile(file_name, &file);
+    file->Append(content.data(), content.size());
+    file->Close();
+  }
+  {
+    std::unique_ptr<MappedFile> mapped_file = MappedFile::Open(&file_system, file_name);
+    ASSERT_TRUE(mapped_file);
+    ASSERT_EQ(mapped_file->size(), content.size());
+    mapped_file->WillNeed(5000, 3000);
+    ASSERT_EQ(std::string(mapped_file->data() + 5000, 3000), content.substr(5000, 3000));
+  }
+  file_system.DelFile(file_name);
+#endif
+}
+
+}  // namespace oneflow
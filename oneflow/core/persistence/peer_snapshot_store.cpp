@@ -0,0 +1,307 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/peer_snapshot_store.h"
+#include <cstring>
+#include <set>
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/persistence/file_system.h"
+#ifdef __linux__
+#include "oneflow/core/transport/transport.h"
+#endif  // __linux__
+
+namespace oneflow {
+
+namespace {
+
+constexpr char kOwnerDirPrefix[] = "rank_";
+constexpr char kStepFilePrefix[] = "step_";
+constexpr char kTmpFileSuffix[] = ".tmp";
+
+bool StartsWith(const std::string& str, const std::string& prefix) {
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size()
+         && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// The rank whose buddy is the rank.
+int64_t OwnerRank(int64_t rank, int64_t world_size, int64_t num_ranks_per_node) {
+  FOR_RANGE(int64_t, owner, 0, world_size) {
+    if (PeerSnapshotStore::BuddyRank(owner, world_size, num_ranks_per_node) == rank) {
+      return owner;
+    }
+  }
+  UNIMPLEMENTED();
+  return -1;
+}
+
+std::string GenCtrlKey(const std::string& name, const std::string& suffix) {
+  return "PeerSnapshotStore/" + name + "/" + suffix;
+}
+
+uint64_t GenTransportToken(const std::string& key) {
+  // The tokens of the Transport are global, keep these apart from the small sequential ones.
+  return std::hash<std::string>()(key) | (static_cast<uint64_t>(1) << 63);
+}
+
+std::string SerializeCopies(const std::vector<std::pair<int64_t, int64_t>>& copies) {
+  std::string serialized;
+  for (const auto& copy : copies) {
+    serialized += std::to_string(copy.first) + ":" + std::to_string(copy.second) + ";";
+  }
+  return serialized;
+}
+
+std::vector<std::pair<int64_t, int64_t>> DeserializeCopies(const std::string& serialized) {
+  std::vector<std::pair<int64_t, int64_t>> copies;
+  size_t begin = 0;
+  while (begin < serialized.size()) {
+    const size_t colon = serialized.find(':', begin);
+    const size_t end = serialized.find(';', begin);
+    CHECK(colon != std::string::npos && end != std::string::npos && colon < end);
+    copies.emplace_back(std::stoll(serialized.substr(begin, colon - begin)),
+                        std::stoll(serialized.substr(colon + 1, end - colon - 1)));
+    begin = end + 1;
+  }
+  return copies;
+}
+
+}  // namespace
+
+PeerSnapshotStore::PeerSnapshotStore(const std::string& root_dir)
+    : root_dir_(root_dir), replicating_(false), num_restores_(0) {}
+
+PeerSnapshotStore::~PeerSnapshotStore() {
+  WaitReplicated();
+  if (thread_.joinable()) { thread_.join(); }
+}
+
+int64_t PeerSnapshotStore::BuddyRank(int64_t rank, int64_t world_size,
+                                     int64_t num_ranks_per_node) {
+  CHECK_GE(rank, 0);
+  CHECK_LT(rank, world_size);
+  if (world_size > num_ranks_per_node) { return (rank + num_ranks_per_node) % world_size; }
+  return (rank + 1) % world_size;
+}
+
+int64_t PeerSnapshotStore::LatestRestorableStep(
+    const std::vector<std::vector<std::pair<int64_t, int64_t>>>& rank2copies,
+    int64_t world_size) {
+  std::vector<std::set<int64_t>> owner2steps(world_size);
+  for (const auto& copies : rank2copies) {
+    for (const auto& copy : copies) {
+      if (copy.first >= 0 && copy.first < world_size) {
+        owner2steps.at(copy.first).insert(copy.second);
+      }
+    }
+  }
+  for (auto it = owner2steps.at(0).rbegin(); it != owner2steps.at(0).rend(); ++it) {
+    const bool restorable =
+        std::all_of(owner2steps.cbegin(), owner2steps.cend(),
+                    [&](const std::set<int64_t>& steps) { return steps.count(*it) > 0; });
+    if (restorable) { return *it; }
+  }
+  return -1;
+}
+
+void PeerSnapshotStore::Replicate(const std::string& name, int64_t step, std::string&& shard) {
+  CHECK_GE(step, 0);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return !replicating_; });
+    replicating_ = true;
+  }
+  if (thread_.joinable()) { thread_.join(); }
+  thread_ = std::thread([this, name, step, shard = std::move(shard)]() {
+    DoReplicate(name, step, shard);
+    std::unique_lock<std::mutex> lock(mutex_);
+    replicating_ = false;
+    cond_.notify_all();
+  });
+}
+
+bool PeerSnapshotStore::IsReplicated() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !replicating_;
+}
+
+void PeerSnapshotStore::WaitReplicated() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this]() { return !replicating_; });
+}
+
+void PeerSnapshotStore::DoReplicate(const std::string& name, int64_t step,
+                                    const std::string& shard) {
+  const int64_t rank = GlobalProcessCtx::Rank();
+  const int64_t world_size = GlobalProcessCtx::WorldSize();
+  const int64_t num_ranks_per_node = GlobalProcessCtx::NumOfProcessPerNode();
+  WriteCopy(name, rank, step, shard.data(), shard.size());
+  std::vector<int64_t> owners{rank};
+  if (world_size > 1) {
+    const int64_t buddy = BuddyRank(rank, world_size, num_ranks_per_node);
+    const int64_t owner = OwnerRank(rank, world_size, num_ranks_per_node);
+    BlockingCounter counter(2);
+    std::string replica;
+    SendShard(GenCtrlKey(name, std::to_string(step) + "/" + std::to_string(rank)), buddy, shard,
+              &counter);
+    ReceiveShard(GenCtrlKey(name, std::to_string(step) + "/" + std::to_string(owner)), owner,
+                 &replica, &counter);
+    counter.WaitForeverUntilCntEqualZero();
+    WriteCopy(name, owner, step, replica.data(), replica.size());
+    owners.emplace_back(owner);
+  }
+  // Both copies of the shard of this rank and of its owner are complete, the older ones are no
+  // longer needed to restore. A replication cut off halfway leaves the older ones in place.
+  for (const auto& copy : ListCopies(name)) {
+    if (copy.second < step
+        && std::find(owners.cbegin(), owners.cend(), copy.first) != owners.cend()) {
+      LocalFS()->DelFile(CopyPath(name, copy.first, copy.second));
+    }
+  }
+  VLOG(1) << "peer snapshot " << name << " of step " << step << " replicated, size "
+          << shard.size();
+}
+
+Maybe<bool> PeerSnapshotStore::Restore(const std::string& name, int64_t* step,
+                                       std::string* shard) {
+  WaitReplicated();
+  const int64_t rank = GlobalProcessCtx::Rank();
+  const int64_t world_size = GlobalProcessCtx::WorldSize();
+  const std::string restore_key = GenCtrlKey(name, "restore-" + std::to_string(num_restores_));
+  num_restores_ += 1;
+  const std::vector<std::pair<int64_t, int64_t>> copies = ListCopies(name);
+  Global<CtrlClient>::Get()->PushKV(restore_key + "/" + std::to_string(rank),
+                                    SerializeCopies(copies));
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> rank2copies(world_size);
+  FOR_RANGE(int64_t, i, 0, world_size) {
+    std::string serialized;
+    Global<CtrlClient>::Get()->PullKV(restore_key + "/" + std::to_string(i), &serialized);
+    rank2copies.at(i) = DeserializeCopies(serialized);
+  }
+  *step = LatestRestorableStep(rank2copies, world_size);
+  if (*step < 0) {
+    LOG(WARNING) << "peer snapshot " << name << " can not be restored from the peers";
+    return false;
+  }
+  const auto HoldsCopy = [&](int64_t holder, int64_t owner) {
+    const auto& held = rank2copies.at(holder);
+    return std::find(held.cbegin(), held.cend(), std::make_pair(owner, *step)) != held.cend();
+  };
+  // The shards missing on their owners are sent by the first rank holding a copy.
+  std::vector<std::pair<int64_t, std::string>> sent_shards;
+  FOR_RANGE(int64_t, owner, 0, world_size) {
+    if (HoldsCopy(owner, owner)) { continue; }
+    int64_t holder = 0;
+    while (!HoldsCopy(holder, owner)) { holder += 1; }
+    if (holder == rank) { sent_shards.emplace_back(owner, ReadCopy(name, owner, *step)); }
+  }
+  const bool holds_own_copy = HoldsCopy(rank, rank);
+  BlockingCounter counter(sent_shards.size() + (holds_own_copy ? 0 : 1));
+  for (const auto& sent : sent_shards) {
+    SendShard(restore_key + "/shard/" + std::to_string(sent.first), sent.first, sent.second,
+              &counter);
+  }
+  if (holds_own_copy) {
+    *shard = ReadCopy(name, rank, *step);
+  } else {
+    int64_t holder = 0;
+    while (!HoldsCopy(holder, rank)) { holder += 1; }
+    ReceiveShard(restore_key + "/shard/" + std::to_string(rank), holder, shard, &counter);
+  }
+  counter.WaitForeverUntilCntEqualZero();
+  LOG(INFO) << "peer snapshot " << name << " of step " << *step << " restored"
+            << (holds_own_copy ? "" : " from a peer") << ", size " << shard->size();
+  return true;
+}
+
+std::vector<std::pair<int64_t, int64_t>> PeerSnapshotStore::ListCopies(
+    const std::string& name) const {
+  std::vector<std::pair<int64_t, int64_t>> copies;
+  const std::string dir = JoinPath(root_dir_, name);
+  if (!LocalFS()->IsDirectory(dir)) { return copies; }
+  for (const std::string& owner_dir : LocalFS()->ListDir(dir)) {
+    if (!StartsWith(owner_dir, kOwnerDirPrefix)) { continue; }
+    const int64_t owner = std::stoll(owner_dir.substr(std::strlen(kOwnerDirPrefix)));
+    for (const std::string& file : LocalFS()->ListDir(JoinPath(dir, owner_dir))) {
+      if (!StartsWith(file, kStepFilePrefix) || EndsWith(file, kTmpFileSuffix)) { continue; }
+      copies.emplace_back(owner, std::stoll(file.substr(std::strlen(kStepFilePrefix))));
+    }
+  }
+  std::sort(copies.begin(), copies.end());
+  return copies;
+}
+
+std::string PeerSnapshotStore::CopyPath(const std::string& name, int64_t owner,
+                                        int64_t step) const {
+  return JoinPath(root_dir_, name, kOwnerDirPrefix + std::to_string(owner),
+                  kStepFilePrefix + std::to_string(step));
+}
+
+void PeerSnapshotStore::WriteCopy(const std::string& name, int64_t owner, int64_t step,
+                                  const char* data, size_t size) const {
+  const std::string path = CopyPath(name, owner, step);
+  const std::string tmp_path = path + kTmpFileSuffix;
+  LocalFS()->RecursivelyCreateDirIfNotExist(Dirname(path));
+  {
+    std::unique_ptr<fs::WritableFile> file;
+    LocalFS()->NewWritableFile(tmp_path, &file);
+    file->Append(data, size);
+    file->Close();
+  }
+  // Restores never see a partial copy.
+  LocalFS()->RenameFile(tmp_path, path);
+}
+
+std::string PeerSnapshotStore::ReadCopy(const std::string& name, int64_t owner,
+                                        int64_t step) const {
+  const std::string path = CopyPath(name, owner, step);
+  std::string data(LocalFS()->GetFileSize(path), '\0');
+  std::unique_ptr<fs::RandomAccessFile> file;
+  LocalFS()->NewRandomAccessFile(path, &file);
+  file->Read(0, data.size(), &data[0]);
+  return data;
+}
+
+void PeerSnapshotStore::SendShard(const std::string& key, int64_t dst_rank,
+                                  const std::string& shard, BlockingCounter* counter) const {
+#ifdef __linux__
+  Global<CtrlClient>::Get()->PushKV(key + "/size", std::to_string(shard.size()));
+  Global<Transport>::Get()->Send(GenTransportToken(key), dst_rank, shard.data(), shard.size(),
+                                 [counter]() { counter->Decrease(); });
+#else
+  UNIMPLEMENTED() << "peer snapshots need the Transport";
+#endif  // __linux__
+}
+
+void PeerSnapshotStore::ReceiveShard(const std::string& key, int64_t src_rank, std::string* shard,
+                                     BlockingCounter* counter) const {
+#ifdef __linux__
+  std::string size;
+  Global<CtrlClient>::Get()->PullKV(key + "/size", &size);
+  Global<CtrlClient>::Get()->ClearKV(key + "/size");
+  shard->resize(std::stoull(size));
+  Global<Transport>::Get()->Receive(GenTransportToken(key), src_rank, &(*shard)[0], shard->size(),
+                                    [counter]() { counter->Decrease(); });
+#else
+  UNIMPLEMENTED() << "peer snapshots need the Transport";
+#endif  // __linux__
+}
+
+}  // namespace oneflow
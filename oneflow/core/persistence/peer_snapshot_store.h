@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_PEER_SNAPSHOT_STORE_H_
+#define ONEFLOW_CORE_PERSISTENCE_PEER_SNAPSHOT_STORE_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+// Keeps the latest checkpoint shard of every rank in host memory twice, once on the rank itself
+// and once on its buddy rank on another node, so that a job restarted after a node failure
+// restores the shards from the surviving peers at network speed instead of from the storage.
+//
+// The copies are files under a tmpfs directory, /dev/shm by default, which are in host memory
+// and outlive the processes, so that the ranks of the surviving nodes still hold them after the
+// restart. The shards of a checkpoint are opaque bytes identified by the name of the checkpoint
+// and the rank which produced them.
+class PeerSnapshotStore final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PeerSnapshotStore);
+  explicit PeerSnapshotStore(const std::string& root_dir);
+  ~PeerSnapshotStore();
+
+  // The rank holding the replica of the shards of the rank. It is the rank with the same local
+  // rank on the next node, or the next rank if all the ranks are on one node.
+  static int64_t BuddyRank(int64_t rank, int64_t world_size, int64_t num_ranks_per_node);
+  // The latest step of which every one of the ranks has a copy of its shard on some rank, given
+  // the (owner rank, step) copies held by each rank, or -1.
+  static int64_t LatestRestorableStep(
+      const std::vector<std::vector<std::pair<int64_t, int64_t>>>& rank2copies,
+      int64_t world_size);
+
+  // Collective. Stores the shard of this rank at the step on this rank and on the buddy rank in
+  // the background, after the previous replication is done. The older copies are dropped once
+  // the new ones are complete.
+  void Replicate(const std::string& name, int64_t step, std::string&& shard);
+  bool IsReplicated() const;
+  void WaitReplicated() const;
+  // Collective. Restores the shard of this rank at the latest step restorable from the copies
+  // held by all the ranks, which have to be as many as the ranks that produced them. Returns
+  // false if some shard has no copy left, then the checkpoint has to be loaded from storage.
+  Maybe<bool> Restore(const std::string& name, int64_t* step, std::string* shard);
+
+ private:
+  void DoReplicate(const std::string& name, int64_t step, const std::string& shard);
+  // The (owner rank, step) of the copies of the checkpoint held by this rank.
+  std::vector<std::pair<int64_t, int64_t>> ListCopies(const std::string& name) const;
+  std::string CopyPath(const std::string& name, int64_t owner, int64_t step) const;
+  void WriteCopy(const std::string& name, int64_t owner, int64_t step, const char* data,
+                 size_t size) const;
+  std::string ReadCopy(const std::string& name, int64_t owner, int64_t step) const;
+  // Sends the shard through the Transport, the size goes ahead through the control plane. The
+  // counter is decreased once the transfer is done.
+  void SendShard(const std::string& key, int64_t dst_rank, const std::string& shard,
+                 BlockingCounter* counter) const;
+  void ReceiveShard(const std::string& key, int64_t src_rank, std::string* shard,
+                    BlockingCounter* counter) const;
+
+  const std::string root_dir_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable cond_;
+  bool replicating_;
+  int64_t num_restores_;
+  std::thread thread_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_PEER_SNAPSHOT_STORE_H_
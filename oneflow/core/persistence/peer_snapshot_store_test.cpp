@@ -0,0 +1,49 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/persistence/peer_snapshot_store.h"
+
+namespace oneflow {
+
+TEST(PeerSnapshotStore, buddy_rank) {
+  // The buddy is on the next node.
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(0, 8, 4), 4);
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(5, 8, 4), 1);
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(3, 12, 4), 7);
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(11, 12, 4), 3);
+  // All the ranks are on one node.
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(2, 4, 4), 3);
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(3, 4, 4), 0);
+  ASSERT_EQ(PeerSnapshotStore::BuddyRank(0, 1, 1), 0);
+}
+
+TEST(PeerSnapshotStore, latest_restorable_step) {
+  // Rank 1 lost its own copies, rank 0 holds the replica of step 200 of rank 1, rank 1 was
+  // replicating step 300 when it failed.
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> rank2copies{
+      {{0, 200}, {0, 300}, {1, 200}}, {}};
+  ASSERT_EQ(PeerSnapshotStore::LatestRestorableStep(rank2copies, 2), 200);
+  rank2copies.at(1) = {{0, 300}, {1, 300}};
+  ASSERT_EQ(PeerSnapshotStore::LatestRestorableStep(rank2copies, 2), 300);
+  // No copy of rank 1 is left.
+  rank2copies = {{{0, 200}}, {}};
+  ASSERT_EQ(PeerSnapshotStore::LatestRestorableStep(rank2copies, 2), -1);
+  // The copies of ranks beyond the world are ignored.
+  rank2copies = {{{0, 100}, {2, 100}}};
+  ASSERT_EQ(PeerSnapshotStore::LatestRestorableStep(rank2copies, 1), 100);
+}
+
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/binary_in_stream_with_local_copy.h"
 #include "oneflow/core/persistence/binary_in_stream_without_local_copy.h"
+#include "oneflow/core/persistence/block_compressed_file.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include <cstring>
 #include "oneflow/core/common/constant.h"
@@ -57,7 +58,11 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
     if (with_local_copy) {
       streams.emplace_back(new BinaryInStreamWithLocalCopy(fs, file_path));
     } else {
-      streams.emplace_back(new BinaryInStreamWithoutLocalCopy(fs, file_path));
+      std::unique_ptr<BinaryInStream> stream(new BinaryInStreamWithoutLocalCopy(fs, file_path));
+      if (BlockCompressedBinaryInStream::IsBlockCompressed(stream.get())) {
+        stream.reset(new BlockCompressedBinaryInStream(std::move(stream)));
+      }
+      streams.emplace_back(std::move(stream));
     }
   }
   if (cyclic) {
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+void WriteFile(fs::FileSystem* file_system, const std::string& file_name,
+               const std::string& content) {
+  std::unique_ptr<fs::WritableFile> file;
+  file_system->NewWritableFile(file_name, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+}
+
+}  // namespace
+
+TEST(PersistentInStream, readahead_across_files) {
+#ifdef OF_PLATFORM_POSIX
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_CHUNK_BYTES", "7", 1);
+  setenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_DEPTH", "3", 1);
+  fs::PosixFileSystem file_system;
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::vector<std::string> file_names;
+  std::string expected;
+  for (int i = 0; i < 3; ++i) {
+    std::string content;
+    for (int j = 0; j < 20 + i * 13; ++j) { content.push_back('a' + (i * 7 + j) % 26); }
+    file_names.emplace_back(JoinPath(current_dir, "/tmp_test_readahead_" + std::to_string(i)));
+    WriteFile(&file_system, file_names.back(), content);
+    expected += content;
+  }
+  {
+    PersistentInStream in_stream(&file_system, file_names, 5, false, false);
+    std::string actual(expected.size() - 5, '\0');
+    for (size_t pos = 0; pos < actual.size(); pos += 3) {
+      ASSERT_EQ(in_stream.ReadFully(&actual[pos], std::min<size_t>(3, actual.size() - pos)), 0);
+    }
+    ASSERT_EQ(actual, expected.substr(5));
+    char c = 0;
+    ASSERT_EQ(in_stream.ReadFully(&c, 1), -1);
+  }
+  {
+    PersistentInStream in_stream(&file_system, file_names, 0, true, false);
+    std::string actual(expected.size() * 2, '\0');
+    ASSERT_EQ(in_stream.ReadFully(&actual[0], actual.size()), 0);
+    ASSERT_EQ(actual, expected + expected);
+  }
+  for (const auto& file_name : file_names) { file_system.DelFile(file_name); }
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_CHUNK_BYTES");
+  unsetenv("ONEFLOW_PERSISTENT_IN_STREAM_READAHEAD_DEPTH");
+#endif
+}
+
+}  // namespace oneflow
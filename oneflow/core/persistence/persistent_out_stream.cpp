@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
 
 namespace oneflow {
 
@@ -27,13 +28,36 @@ PersistentOutStream::PersistentOutStream(fs::FileSystem* fs, const std::string&
   fs->NewWritableFile(file_path, &file_);
 }
 
-PersistentOutStream::~PersistentOutStream() { file_->Close(); }
+PersistentOutStream::PersistentOutStream(fs::FileSystem* fs, const std::string& file_path,
+                                         CompressionCodec codec)
+    : PersistentOutStream(fs, file_path) {
+  if (codec != CompressionCodec::kNone) {
+    const int64_t block_size =
+        ParseIntegerFromEnv("ONEFLOW_PERSISTENT_OUT_STREAM_COMPRESSION_BLOCK_BYTES", 1 << 20);
+    compressed_writer_.reset(new BlockCompressedFileWriter(file_.get(), codec, block_size));
+  }
+}
+
+PersistentOutStream::~PersistentOutStream() {
+  profiler::CheckpointIOPhaseTimer timer("persistent_out_stream", "close", 0);
+  if (compressed_writer_) { compressed_writer_->Close(); }
+  file_->Close();
+}
 
 PersistentOutStream& PersistentOutStream::Write(const char* s, size_t n) {
-  file_->Append(s, n);
+  profiler::CheckpointIOPhaseTimer timer("persistent_out_stream", "write", n);
+  if (compressed_writer_) {
+    compressed_writer_->Append(s, n);
+  } else {
+    file_->Append(s, n);
+  }
   return *this;
 }
 
-void PersistentOutStream::Flush() { file_->Flush(); }
+void PersistentOutStream::Flush() {
+  profiler::CheckpointIOPhaseTimer timer("persistent_out_stream", "flush", 0);
+  if (compressed_writer_) { compressed_writer_->Flush(); }
+  file_->Flush();
+}
 
 }  // namespace oneflow
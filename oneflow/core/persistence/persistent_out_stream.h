@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/block_compressed_file.h"
 
 namespace oneflow {
 
@@ -28,6 +29,9 @@ class PersistentOutStream final {
   ~PersistentOutStream();
 
   PersistentOutStream(fs::FileSystem*, const std::string& file_path);
+  // Writes a block compressed file, see block_compressed_file.h. The blocks are
+  // ONEFLOW_PERSISTENT_OUT_STREAM_COMPRESSION_BLOCK_BYTES long, 1MB by default.
+  PersistentOutStream(fs::FileSystem*, const std::string& file_path, CompressionCodec codec);
 
   // Write block of data
   // Inserts the first n characters of the array pointed by s into the stream.
@@ -37,6 +41,7 @@ class PersistentOutStream final {
 
  private:
   std::unique_ptr<fs::WritableFile> file_;
+  std::unique_ptr<BlockCompressedFileWriter> compressed_writer_;
 };
 
 template<typename T>
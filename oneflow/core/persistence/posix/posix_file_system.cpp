@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/persistence/posix/ring_engine.h"
 
 #ifdef OF_PLATFORM_POSIX
 
@@ -27,6 +28,7 @@ limitations under the License.
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+#include <cstring>
 
 namespace oneflow {
 
@@ -62,6 +64,91 @@ class PosixRandomAccessFile : public RandomAccessFile {
   }
 };
 
+#ifdef O_DIRECT
+
+constexpr size_t kDirectIOAlignment = 4096;
+// Each read is split into segments of this size, submitted together.
+constexpr size_t kDirectIOSegmentSize = 1 << 20;
+// Reads larger than the bounce buffer are done window by window.
+constexpr size_t kDirectIOMaxBounceBufferSize = 16 << 20;
+
+class DirectIOBounceBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(DirectIOBounceBuffer);
+  DirectIOBounceBuffer() : ptr_(nullptr), size_(0) {}
+  ~DirectIOBounceBuffer() { free(ptr_); }
+
+  char* Reserve(size_t size) {
+    if (size > size_) {
+      free(ptr_);
+      ptr_ = nullptr;
+      PCHECK(posix_memalign(reinterpret_cast<void**>(&ptr_), kDirectIOAlignment, size) == 0);
+      size_ = size;
+    }
+    return ptr_;
+  }
+
+ private:
+  char* ptr_;
+  size_t size_;
+};
+
+class PosixDirectRandomAccessFile : public RandomAccessFile {
+ private:
+  std::string fname_;
+  int fd_;
+
+  // Reads the aligned range [begin, end) into buf, the range may run past the end of the file.
+  void ReadAligned(uint64_t begin, uint64_t end, char* buf) const {
+#ifdef WITH_LIBURING
+    thread_local RingEngine engine;
+    for (uint64_t pos = begin; pos < end; pos += kDirectIOSegmentSize) {
+      const size_t size = std::min<uint64_t>(kDirectIOSegmentSize, end - pos);
+      engine.AsyncPread(fd_, buf + (pos - begin), size, static_cast<off_t>(pos));
+    }
+    engine.WaitUntilDone();
+#else
+    uint64_t pos = begin;
+    while (pos < end) {
+      ssize_t r = pread(fd_, buf + (pos - begin), end - pos, static_cast<off_t>(pos));
+      if (r > 0) {
+        pos += r;
+      } else if (r == 0) {
+        // eof, the caller only asks for bytes inside of the file
+        return;
+      } else if (errno == EINTR || errno == EAGAIN) {
+        // Retry
+      } else {
+        PLOG(FATAL) << "Fail to read file " << fname_;
+        return;
+      }
+    }
+#endif  // WITH_LIBURING
+  }
+
+ public:
+  PosixDirectRandomAccessFile(const std::string& fname, int fd) : fname_(fname), fd_(fd) {}
+  ~PosixDirectRandomAccessFile() override { close(fd_); }
+
+  void Read(uint64_t offset, size_t n, char* result) const override {
+    thread_local DirectIOBounceBuffer bounce_buffer;
+    while (n > 0) {
+      const uint64_t begin = offset / kDirectIOAlignment * kDirectIOAlignment;
+      const uint64_t end =
+          std::min(RoundUp(offset + n, kDirectIOAlignment), begin + kDirectIOMaxBounceBufferSize);
+      char* buf = bounce_buffer.Reserve(end - begin);
+      ReadAligned(begin, end, buf);
+      const size_t copy_size = std::min<uint64_t>(end - offset, n);
+      std::memcpy(result, buf + (offset - begin), copy_size);
+      result += copy_size;
+      offset += copy_size;
+      n -= copy_size;
+    }
+  }
+};
+
+#endif  // O_DIRECT
+
 class PosixWritableFile : public WritableFile {
  private:
   std::string fname_;
@@ -93,6 +180,17 @@ class PosixWritableFile : public WritableFile {
 void PosixFileSystem::NewRandomAccessFile(const std::string& fname,
                                           std::unique_ptr<RandomAccessFile>* result) {
   std::string translated_fname = TranslateName(fname);
+#ifdef O_DIRECT
+  if (direct_io_) {
+    int fd = open(translated_fname.c_str(), O_RDONLY | O_DIRECT);
+    if (fd >= 0) {
+      result->reset(new PosixDirectRandomAccessFile(fname, fd));
+      return;
+    }
+    // Some file systems such as tmpfs do not support O_DIRECT.
+    PLOG(WARNING) << "Fail to open file " << fname << " with O_DIRECT, fall back to buffered io";
+  }
+#endif  // O_DIRECT
   int fd = open(translated_fname.c_str(), O_RDONLY);
   PCHECK(fd >= 0) << "Fail to open file " << fname << ", errno is " << errno;
   result->reset(new PosixRandomAccessFile(fname, fd));
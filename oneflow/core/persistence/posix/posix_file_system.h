@@ -27,7 +27,11 @@ namespace fs {
 class PosixFileSystem final : public FileSystem {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PosixFileSystem);
-  PosixFileSystem() = default;
+  PosixFileSystem() : PosixFileSystem(false) {}
+  // With direct_io, random access files are opened with O_DIRECT and read through aligned
+  // buffers, batched on an io_uring if OneFlow is built with liburing. Such reads bypass the page
+  // cache, so scanning a dataset does not evict other hot data.
+  explicit PosixFileSystem(bool direct_io) : direct_io_(direct_io) {}
   ~PosixFileSystem() = default;
 
   void NewRandomAccessFile(const std::string& fname,
@@ -56,6 +60,7 @@ class PosixFileSystem final : public FileSystem {
   bool IsDirectory(const std::string& fname) override;
 
  private:
+  bool direct_io_;
 };
 
 }  // namespace fs
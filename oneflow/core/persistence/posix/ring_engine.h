@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_POSIX_RING_ENGINE_H_
+#define ONEFLOW_CORE_PERSISTENCE_POSIX_RING_ENGINE_H_
+
+#include "oneflow/core/common/util.h"
+
+#ifdef WITH_LIBURING
+
+#include <liburing.h>
+
+namespace oneflow {
+
+// Batched asynchronous preads on an io_uring, shared by the embedding persistent table and the
+// direct-io local file system. Not thread safe, each thread keeps its own engine.
+class RingEngine final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RingEngine);
+  static constexpr uint32_t kDefaultQueueDepth = 128;
+  static constexpr uint32_t kDefaultSubmitBatch = 32;
+
+  RingEngine() : RingEngine(kDefaultQueueDepth, kDefaultSubmitBatch) {}
+  RingEngine(uint32_t queue_depth, uint32_t submit_batch)
+      : ring_{},
+        queue_depth_(queue_depth),
+        submit_batch_(submit_batch),
+        pending_submit_(0),
+        num_readings_(0) {
+    PCHECK(io_uring_queue_init(queue_depth_, &ring_, 0) == 0);
+  }
+  ~RingEngine() {
+    WaitUntilDone();
+    io_uring_queue_exit(&ring_);
+  }
+
+  void AsyncPread(int fd, void* buf, size_t count, off_t offset) {
+    if (num_readings_ == queue_depth_) {
+      struct io_uring_cqe* cqe = nullptr;
+      PCHECK(io_uring_wait_cqe(&ring_, &cqe) == 0);
+      CHECK_GE(cqe->res, 0);
+      io_uring_cqe_seen(&ring_, cqe);
+    } else {
+      num_readings_ += 1;
+    }
+    io_uring_sqe* sqe = CHECK_NOTNULL(io_uring_get_sqe(&ring_));
+    io_uring_prep_read(sqe, fd, buf, count, offset);
+    pending_submit_ += 1;
+    if (pending_submit_ == submit_batch_) {
+      PCHECK(io_uring_submit(&ring_) == pending_submit_);
+      pending_submit_ = 0;
+    }
+  }
+
+  void WaitUntilDone() {
+    if (pending_submit_ > 0) {
+      PCHECK(io_uring_submit(&ring_) == pending_submit_);
+      pending_submit_ = 0;
+    }
+    while (num_readings_ != 0) {
+      struct io_uring_cqe* cqe = nullptr;
+      PCHECK(io_uring_wait_cqe(&ring_, &cqe) == 0);
+      CHECK_GE(cqe->res, 0);
+      io_uring_cqe_seen(&ring_, cqe);
+      num_readings_ -= 1;
+    }
+  }
+
+ private:
+  io_uring ring_;
+  uint32_t queue_depth_;
+  uint32_t submit_batch_;
+  uint32_t pending_submit_;
+  uint32_t num_readings_;
+};
+
+}  // namespace oneflow
+
+#endif  // WITH_LIBURING
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_POSIX_RING_ENGINE_H_
@@ -0,0 +1,190 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/sharded_snapshot.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/register/tensor_slice_copier.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr char kShardsDirName[] = "shards";
+constexpr char kDataFileSuffix[] = ".data";
+constexpr char kIndexFileSuffix[] = ".index";
+
+std::string GenShardsDirPath(const std::string& root) { return JoinPath(root, kShardsDirName); }
+
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size()
+         && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+ShardedSnapshotWriter::ShardedSnapshotWriter(const std::string& snapshot_root_path,
+                                             const std::string& shard_name)
+    : root_path_(snapshot_root_path), shard_name_(shard_name), data_size_(0), closed_(false) {
+  const std::string shards_dir = GenShardsDirPath(root_path_);
+  SnapshotFS()->RecursivelyCreateDirIfNotExist(shards_dir);
+  const std::string data_file = shard_name_ + kDataFileSuffix;
+  const std::string data_path = JoinPath(shards_dir, data_file);
+  CHECK(!SnapshotFS()->FileExists(data_path)) << "shard already exists, path: " << data_path;
+  data_stream_.reset(new PersistentOutStream(SnapshotFS(), data_path));
+  index_.set_data_file(data_file);
+}
+
+ShardedSnapshotWriter::~ShardedSnapshotWriter() {
+  if (!closed_) { Close(); }
+}
+
+void ShardedSnapshotWriter::Write(const std::string& key, const Shape& logical_shape,
+                                  DataType data_type, const TensorSliceView& slice,
+                                  const char* data) {
+  CHECK(!closed_);
+  CHECK(TensorSliceView(logical_shape).Contains(slice));
+  const int64_t size = slice.shape().elem_cnt() * GetSizeOfDataType(data_type);
+  ShardedSnapshotEntry* entry = index_.add_entry();
+  entry->set_key(key);
+  logical_shape.ToProto(entry->mutable_logical_shape());
+  entry->set_data_type(data_type);
+  slice.ToProto(entry->mutable_slice());
+  entry->set_offset(data_size_);
+  entry->set_size(size);
+  profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_writer", "write", size);
+  data_stream_->Write(data, size);
+  data_size_ += size;
+}
+
+void ShardedSnapshotWriter::Close() {
+  CHECK(!closed_);
+  closed_ = true;
+  {
+    profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_writer", "close", data_size_);
+    data_stream_.reset();
+  }
+  const std::string index_path =
+      JoinPath(GenShardsDirPath(root_path_), shard_name_ + kIndexFileSuffix);
+  const std::string tmp_index_path = index_path + ".tmp";
+  std::string serialized_index;
+  {
+    profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_writer", "serialize", 0);
+    serialized_index = index_.SerializeAsString();
+    timer.set_bytes(serialized_index.size());
+  }
+  {
+    profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_writer", "write_index",
+                                           serialized_index.size());
+    PersistentOutStream out_stream(SnapshotFS(), tmp_index_path);
+    out_stream << serialized_index;
+  }
+  // Readers list the index files, so the index appears only once it is complete.
+  SnapshotFS()->RenameFile(tmp_index_path, index_path);
+}
+
+bool ShardedSnapshotReader::IsShardedSnapshot(const std::string& snapshot_root_path) {
+  const std::string shards_dir = GenShardsDirPath(snapshot_root_path);
+  return SnapshotFS()->FileExists(shards_dir) && SnapshotFS()->IsDirectory(shards_dir);
+}
+
+ShardedSnapshotReader::ShardedSnapshotReader(const std::string& snapshot_root_path)
+    : root_path_(snapshot_root_path) {
+  const std::string shards_dir = GenShardsDirPath(root_path_);
+  for (const std::string& file_name : SnapshotFS()->ListDir(shards_dir)) {
+    if (!EndsWith(file_name, kIndexFileSuffix)) { continue; }
+    const std::string index_path = JoinPath(shards_dir, file_name);
+    std::string content(SnapshotFS()->GetFileSize(index_path), '\0');
+    PersistentInStream in_stream(SnapshotFS(), index_path);
+    CHECK_EQ(in_stream.ReadFully(&content[0], content.size()), 0);
+    ShardedSnapshotIndex index;
+    CHECK(index.ParseFromString(content)) << "invalid shard index, path: " << index_path;
+    for (const ShardedSnapshotEntry& entry : index.entry()) {
+      StoredVariable& variable = key2variable_[entry.key()];
+      const Shape logical_shape(entry.logical_shape());
+      if (variable.slices.empty()) {
+        variable.logical_shape = logical_shape;
+        variable.data_type = entry.data_type();
+      } else {
+        CHECK_EQ(variable.logical_shape, logical_shape) << "key: " << entry.key();
+        CHECK_EQ(variable.data_type, entry.data_type()) << "key: " << entry.key();
+      }
+      variable.slices.emplace_back(StoredSlice{JoinPath(shards_dir, index.data_file()),
+                                               TensorSliceView(entry.slice()), entry.offset()});
+    }
+  }
+}
+
+bool ShardedSnapshotReader::HasKey(const std::string& key) const {
+  return key2variable_.find(key) != key2variable_.end();
+}
+
+void ShardedSnapshotReader::Read(const std::string& key, const Shape& logical_blob_shape,
+                                 DataType data_type, const TensorSliceView& slice,
+                                 char* dst) const {
+  const auto it = key2variable_.find(key);
+  CHECK(it != key2variable_.end()) << "key not found in sharded snapshot: " << key;
+  const StoredVariable& variable = it->second;
+  CHECK_EQ(variable.logical_shape, logical_blob_shape) << "key: " << key;
+  CHECK_EQ(variable.data_type, data_type) << "key: " << key;
+  CHECK(TensorSliceView(logical_blob_shape).Contains(slice));
+  const size_t size_of_data_type = GetSizeOfDataType(data_type);
+  if (logical_blob_shape.NumAxes() == 0) {
+    const StoredSlice& stored = variable.slices.front();
+    PersistentInStream in_stream(SnapshotFS(), stored.data_file, stored.offset);
+    CHECK_EQ(in_stream.ReadFully(dst, size_of_data_type), 0);
+    return;
+  }
+  std::vector<const StoredSlice*> overlapped;
+  int64_t covered_elem_cnt = 0;
+  for (const StoredSlice& stored : variable.slices) {
+    const TensorSliceView intersection = stored.slice.Intersect(slice);
+    if (intersection.IsEmpty()) { continue; }
+    overlapped.emplace_back(&stored);
+    covered_elem_cnt += intersection.shape().elem_cnt();
+  }
+  // The stored slices of a variable do not overlap, one of them is written per slice.
+  CHECK_EQ(covered_elem_cnt, slice.shape().elem_cnt()) << "key not fully stored: " << key;
+  const auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
+  CHECK(device);
+  MultiThreadLoop(overlapped.size(), [&](size_t i) {
+    const StoredSlice& stored = *overlapped.at(i);
+    const TensorSliceView intersection = stored.slice.Intersect(slice);
+    // Reads only the rows of the stored slice along the first axis which overlap.
+    std::vector<Range> read_ranges = stored.slice.range_vec();
+    read_ranges.front() = intersection.At(0);
+    const TensorSliceView read_slice(read_ranges);
+    const int64_t row_bytes = stored.slice.shape().Count(1) * size_of_data_type;
+    const int64_t row_offset = intersection.At(0).begin() - stored.slice.At(0).begin();
+    std::vector<char> buffer(read_slice.shape().elem_cnt() * size_of_data_type);
+    {
+      profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_reader", "read", buffer.size());
+      PersistentInStream in_stream(SnapshotFS(), stored.data_file,
+                                   stored.offset + row_offset * row_bytes);
+      CHECK_EQ(in_stream.ReadFully(buffer.data(), buffer.size()), 0);
+    }
+    profiler::CheckpointIOPhaseTimer timer("sharded_snapshot_reader", "copy",
+                                           intersection.shape().elem_cnt() * size_of_data_type);
+    TensorSliceCopier copier(slice, read_slice, data_type, DeviceType::kCPU);
+    auto* stream = device->CreateStream();
+    copier.Copy(stream, dst, buffer.data());
+    device->DestroyStream(stream);
+  });
+}
+
+}  // namespace oneflow
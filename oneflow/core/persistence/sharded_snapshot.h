@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_SHARDED_SNAPSHOT_H_
+#define ONEFLOW_CORE_PERSISTENCE_SHARDED_SNAPSHOT_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/persistence/persistent_out_stream.h"
+#include "oneflow/core/persistence/sharded_snapshot.pb.h"
+#include "oneflow/core/register/tensor_slice_view.h"
+
+namespace oneflow {
+
+// A snapshot storing the slices of the variables held by each rank instead of whole variables.
+// Each shard packs its slices into one data file and lists them in an index file, both under the
+// `shards` directory of the snapshot. The index files of all the shards form the manifest.
+class ShardedSnapshotWriter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShardedSnapshotWriter);
+  ShardedSnapshotWriter(const std::string& snapshot_root_path, const std::string& shard_name);
+  ~ShardedSnapshotWriter();
+
+  void Write(const std::string& key, const Shape& logical_shape, DataType data_type,
+             const TensorSliceView& slice, const char* data);
+  // Writes the index of the shard, the shard is not visible to readers before.
+  void Close();
+
+ private:
+  const std::string root_path_;
+  const std::string shard_name_;
+  std::unique_ptr<PersistentOutStream> data_stream_;
+  int64_t data_size_;
+  ShardedSnapshotIndex index_;
+  bool closed_;
+};
+
+// Reads any slice of a variable of a sharded snapshot, also when the slices differ from the
+// written ones such as on another placement. The parts of the overlapping written slices are
+// read in parallel.
+class ShardedSnapshotReader final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShardedSnapshotReader);
+  explicit ShardedSnapshotReader(const std::string& snapshot_root_path);
+  ~ShardedSnapshotReader() = default;
+
+  static bool IsShardedSnapshot(const std::string& snapshot_root_path);
+
+  bool HasKey(const std::string& key) const;
+  void Read(const std::string& key, const Shape& logical_blob_shape, DataType data_type,
+            const TensorSliceView& slice, char* dst) const;
+
+ private:
+  struct StoredSlice {
+    std::string data_file;
+    TensorSliceView slice;
+    int64_t offset;
+  };
+  struct StoredVariable {
+    Shape logical_shape;
+    DataType data_type;
+    std::vector<StoredSlice> slices;
+  };
+
+  const std::string root_path_;
+  HashMap<std::string, StoredVariable> key2variable_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_SHARDED_SNAPSHOT_H_
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/sharded_snapshot.h"
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+
+namespace oneflow {
+
+namespace {
+
+std::vector<float> ReadSlice(const SnapshotReader& reader, const std::string& key,
+                             const Shape& logical_shape, const TensorSliceView& slice) {
+  std::vector<float> values(slice.shape().elem_cnt());
+  reader.Read(key, logical_shape, DataType::kFloat, slice, reinterpret_cast<char*>(values.data()));
+  return values;
+}
+
+}  // namespace
+
+TEST(ShardedSnapshot, read_resharded) {
+#ifdef OF_PLATFORM_POSIX
+  Global<ThreadPool>::New(4);
+  Global<ep::DeviceManagerRegistry>::New();
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string root = JoinPath(current_dir, "tmp_test_sharded_snapshot");
+  const Shape logical_shape({4, 6});
+  std::vector<float> values(logical_shape.elem_cnt());
+  for (size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<float>(i); }
+  // Two shards holding the halves split along the columns.
+  for (int64_t shard = 0; shard < 2; ++shard) {
+    const TensorSliceView slice({Range(0, 4), Range(shard * 3, shard * 3 + 3)});
+    std::vector<float> part;
+    for (int64_t r = 0; r < 4; ++r) {
+      for (int64_t c = shard * 3; c < shard * 3 + 3; ++c) { part.push_back(values[r * 6 + c]); }
+    }
+    ShardedSnapshotWriter writer(root, "shard-" + std::to_string(shard));
+    writer.Write("w", logical_shape, DataType::kFloat, slice,
+                 reinterpret_cast<const char*>(part.data()));
+    writer.Close();
+  }
+  ASSERT_TRUE(ShardedSnapshotReader::IsShardedSnapshot(root));
+  SnapshotReader reader(root);
+  ASSERT_TRUE(reader.HasKey("w"));
+  ASSERT_FALSE(reader.HasKey("b"));
+  ASSERT_EQ(ReadSlice(reader, "w", logical_shape, TensorSliceView(logical_shape)), values);
+  // Reads the halves split along the rows instead.
+  for (int64_t half = 0; half < 2; ++half) {
+    const TensorSliceView slice({Range(half * 2, half * 2 + 2), Range(0, 6)});
+    const std::vector<float> expected(values.begin() + half * 12, values.begin() + half * 12 + 12);
+    ASSERT_EQ(ReadSlice(reader, "w", logical_shape, slice), expected);
+  }
+  const TensorSliceView center({Range(1, 3), Range(2, 4)});
+  ASSERT_EQ(ReadSlice(reader, "w", logical_shape, center),
+            std::vector<float>({values[8], values[9], values[14], values[15]}));
+  SnapshotFS()->RecursivelyDeleteDir(root);
+  Global<ep::DeviceManagerRegistry>::Delete();
+  Global<ThreadPool>::Delete();
+#endif
+}
+
+}  // namespace oneflow
@@ -14,12 +14,15 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/sharded_snapshot.h"
+#include "oneflow/core/persistence/mapped_file.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
 #include "oneflow/core/register/tensor_slice_copier.h"
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
 
 namespace oneflow {
 
@@ -32,13 +35,26 @@ std::string GenDataFilePath(const std::string& root, const std::string& key) {
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : root_path_(snapshot_root_path),
+      mmap_(ParseBooleanFromEnv("ONEFLOW_ENABLE_MMAP_MODEL_LOAD", false)) {
+  if (ShardedSnapshotReader::IsShardedSnapshot(root_path_)) {
+    sharded_reader_.reset(new ShardedSnapshotReader(root_path_));
+  }
+}
+
+SnapshotReader::~SnapshotReader() = default;
 
 bool SnapshotReader::HasKey(const std::string& key) const {
+  if (sharded_reader_) { return sharded_reader_->HasKey(key); }
   const std::string path = GenDataFilePath(root_path_, key);
   return SnapshotFS()->FileExists(path);
 }
 
+std::unique_ptr<MappedFile> SnapshotReader::Map(const std::string& key) const {
+  if (!mmap_ || sharded_reader_) { return nullptr; }
+  return MappedFile::Open(SnapshotFS(), GenDataFilePath(root_path_, key));
+}
+
 void SnapshotReader::Read(const std::string& key, Blob* blob) const {
   Shape shape;
   blob->shape().ToShape(&shape);
@@ -47,26 +63,48 @@ void SnapshotReader::Read(const std::string& key, Blob* blob) const {
 
 void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shape,
                           DataType data_type, const TensorSliceView& slice, char* dst) const {
+  profiler::CheckpointIOPhaseTimer timer("snapshot_reader", "read",
+                                         slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
+  if (sharded_reader_) {
+    sharded_reader_->Read(key, logical_blob_shape, data_type, slice, dst);
+    return;
+  }
   const TensorSliceView logical_blob_slice(logical_blob_shape);
   CHECK(logical_blob_slice.Contains(slice));
   const std::string path = GenDataFilePath(root_path_, key);
   const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
   CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
       << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
+  const bool contiguous = slice.shape().Count(1) == logical_blob_shape.Count(1);
+  std::unique_ptr<MappedFile> mapped_file = Map(key);
+  if (mapped_file && contiguous) {
+    const int64_t offset =
+        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type);
+    const int64_t size = slice.shape().elem_cnt() * GetSizeOfDataType(data_type);
+    mapped_file->WillNeed(offset, size);
+    std::memcpy(dst, mapped_file->data() + offset, size);
+  } else if (contiguous) {
     PersistentInStream in_stream(
         SnapshotFS(), path,
         slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
     in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
+    // Without a mapping the whole file is read, with one only the pages the slice touches are.
+    std::vector<char> buffer;
+    const char* src = nullptr;
+    if (mapped_file) {
+      src = mapped_file->data();
+    } else {
+      buffer.resize(logical_blob_size);
+      PersistentInStream in_stream(SnapshotFS(), path);
+      in_stream.ReadFully(buffer.data(), logical_blob_size);
+      src = buffer.data();
+    }
     TensorSliceCopier copier(slice, logical_blob_slice, data_type, DeviceType::kCPU);
     auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
     CHECK(device);
     auto* stream = device->CreateStream();
-    copier.Copy(stream, dst, buffer.data());
+    copier.Copy(stream, dst, src);
     device->DestroyStream(stream);
   }
 }
@@ -98,6 +136,7 @@ void SnapshotWriter::Write(const std::string& key, const char* data, size_t size
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
+  profiler::CheckpointIOPhaseTimer timer("snapshot_writer", "write", size);
   PersistentOutStream out_stream(SnapshotFS(), path);
   out_stream.Write(data, size);
 }
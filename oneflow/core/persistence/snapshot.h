@@ -23,13 +23,15 @@ limitations under the License.
 namespace oneflow {
 
 class Blob;
+class MappedFile;
+class ShardedSnapshotReader;
 
 class SnapshotReader final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotReader);
   SnapshotReader() = delete;
   explicit SnapshotReader(const std::string& snapshot_root_path);
-  ~SnapshotReader() = default;
+  ~SnapshotReader();
 
   void Read(const std::string& key, const Shape& logical_blob_shape, DataType data_type,
             const TensorSliceView& slice, char* dst) const;
@@ -37,10 +39,17 @@ class SnapshotReader final {
             Blob* blob) const;
   void Read(const std::string& key, Blob* blob) const;
   bool HasKey(const std::string& key) const;
+  // Maps the file of a key into memory, returns nullptr if memory mapped loading is disabled or
+  // not supported by the snapshot file system.
+  std::unique_ptr<MappedFile> Map(const std::string& key) const;
   void Close();
 
  private:
   const std::string root_path_;
+  // Read keys through mmap, which only pages in the requested slices.
+  const bool mmap_;
+  // Set if the snapshot was written by ShardedSnapshotWriter.
+  std::unique_ptr<ShardedSnapshotReader> sharded_reader_;
 };
 
 class SnapshotWriter final {
@@ -59,6 +59,13 @@ uint64_t StreamScanner::UpdateBuffer(std::vector<char>* buffer) {
       std::min<uint64_t>(buffer->size() - 1, streams_[cur_stream_id_]->file_size()
                                                  - streams_[cur_stream_id_]->cur_file_pos());
   if (n == 0) { return 0; }
+  // Let the next part file start reading ahead while this one is consumed.
+  const int64_t next_stream_id = cur_stream_id_ + 1;
+  if (next_stream_id < stream_num_) {
+    streams_[next_stream_id]->Prefetch();
+  } else if (IsCyclic() && stream_num_ > 1) {
+    streams_[0]->Prefetch();
+  }
   streams_[cur_stream_id_]->Read(buffer->data(), n);
   AddNForCurFilePos(n);
   return n;
@@ -35,6 +35,7 @@ class StreamScanner {
 
  protected:
   virtual void AddNForCurFilePos(uint64_t n) = 0;
+  virtual bool IsCyclic() const = 0;
 
   std::vector<std::shared_ptr<BinaryInStream>> streams_;
   uint64_t whole_file_size_;
@@ -56,6 +57,7 @@ class CyclicStreamScanner final : public StreamScanner {
 
  protected:
   void AddNForCurFilePos(uint64_t n) override;
+  bool IsCyclic() const override { return true; }
 };
 
 class AcyclicStreamScanner final : public StreamScanner {
@@ -67,6 +69,7 @@ class AcyclicStreamScanner final : public StreamScanner {
 
  protected:
   void AddNForCurFilePos(uint64_t n) override;
+  bool IsCyclic() const override { return false; }
 };
 
 }  // namespace oneflow
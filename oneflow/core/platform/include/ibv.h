@@ -49,9 +49,13 @@ extern "C" typedef struct IBV {
   struct ibv_mr* (*ibv_reg_mr_wrap)(struct ibv_pd* pd, void* addr, size_t length, int access);
   int (*ibv_query_port_wrap)(struct ibv_context* context, uint8_t port_num,
                              struct ibv_port_attr* port_attr);
+  // only in rdma-core 34 or later, check IsDmaBufMrAvailable() before calling it
+  struct ibv_mr* (*ibv_reg_dmabuf_mr_wrap)(struct ibv_pd* pd, uint64_t offset, size_t length,
+                                           uint64_t iova, int fd, int access);
 } IBV;
 
 bool IsAvailable();
+bool IsDmaBufMrAvailable();
 
 extern IBV wrapper;
 
@@ -29,6 +29,8 @@ class DynamicLibrary {
 
   static std::unique_ptr<DynamicLibrary> Load(const std::vector<std::string>& names);
   void* LoadSym(const char* name);
+  // Returns nullptr instead of aborting if the symbol is missing.
+  void* TryLoadSym(const char* name);
 #ifdef __linux__
   std::string AbsolutePath();
 #endif  // __linux__
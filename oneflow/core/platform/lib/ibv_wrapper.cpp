@@ -54,6 +54,10 @@ FUNC LoadSymbol(const char* name, FUNC* save) {
 
 bool IsAvailable() { return GetIBVLibraryPtr() != nullptr; }
 
+bool IsDmaBufMrAvailable() {
+  return IsAvailable() && GetIBVLibrary().TryLoadSym("ibv_reg_dmabuf_mr") != nullptr;
+}
+
 namespace _stubs {
 
 void ibv_free_device_list(struct ibv_device** list) {
@@ -64,6 +68,12 @@ struct ibv_mr* ibv_reg_mr_wrap(struct ibv_pd* pd, void* addr, size_t length, int
   return LoadSymbol("ibv_reg_mr", &wrapper.ibv_reg_mr_wrap)(pd, addr, length, access);
 }
 
+struct ibv_mr* ibv_reg_dmabuf_mr_wrap(struct ibv_pd* pd, uint64_t offset, size_t length,
+                                      uint64_t iova, int fd, int access) {
+  return LoadSymbol("ibv_reg_dmabuf_mr", &wrapper.ibv_reg_dmabuf_mr_wrap)(pd, offset, length, iova,
+                                                                          fd, access);
+}
+
 int ibv_destroy_qp(struct ibv_qp* qp) { return LoadSymbol(__func__, &wrapper.ibv_destroy_qp)(qp); }
 
 int ibv_query_gid(struct ibv_context* context, uint8_t port_num, int index, union ibv_gid* gid) {
@@ -124,7 +134,7 @@ IBV wrapper = {
     IBV_APIS(_REFERENCE_MEMBER)
 #undef _REFERENCE_MEMBER
         _stubs::ibv_reg_mr_wrap,
-    _stubs::ibv_query_port_wrap};
+    _stubs::ibv_query_port_wrap, _stubs::ibv_reg_dmabuf_mr_wrap};
 
 }  // namespace ibv
 }  // namespace oneflow
@@ -55,6 +55,8 @@ std::unique_ptr<DynamicLibrary> DynamicLibrary::Load(const std::vector<std::stri
 
 void* DynamicLibrary::LoadSym(const char* name) { return OpenSymbol(handle_, name); }
 
+void* DynamicLibrary::TryLoadSym(const char* name) { return dlsym(handle_, name); }
+
 #ifdef __linux__
 std::string DynamicLibrary::AbsolutePath() {
   struct link_map* map;
@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
+#include "oneflow/core/common/util.h"
+#include "nlohmann/json.hpp"
+#include <map>
+#include <mutex>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+struct CheckpointIOStat {
+  int64_t count = 0;
+  int64_t bytes = 0;
+  int64_t elapsed_ns = 0;
+
+  // Bytes per nanosecond are GB/s.
+  nlohmann::json ToJson() const {
+    nlohmann::json json;
+    json["count"] = count;
+    json["bytes"] = bytes;
+    json["elapsed_ns"] = elapsed_ns;
+    json["bandwidth_gbps"] = elapsed_ns == 0 ? 0.0 : static_cast<double>(bytes) / elapsed_ns;
+    return json;
+  }
+};
+
+class CheckpointIOMetrics final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CheckpointIOMetrics);
+  CheckpointIOMetrics() = default;
+  ~CheckpointIOMetrics() = default;
+
+  void Record(const std::string& channel, const std::string& phase, int64_t bytes,
+              int64_t elapsed_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CheckpointIOStat* stat = &channel2phase2stat_[channel][phase];
+    stat->count += 1;
+    stat->bytes += bytes;
+    stat->elapsed_ns += elapsed_ns;
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel2phase2stat_.clear();
+  }
+
+  std::string Summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : channel2phase2stat_) {
+      nlohmann::json phases = nlohmann::json::object();
+      for (const auto& phase_pair : pair.second) {
+        phases[phase_pair.first] = phase_pair.second.ToJson();
+      }
+      summary[pair.first] = phases;
+    }
+    return summary.dump(2);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::map<std::string, CheckpointIOStat>> channel2phase2stat_;
+};
+
+CheckpointIOMetrics* GetCheckpointIOMetrics() {
+  static CheckpointIOMetrics metrics;
+  return &metrics;
+}
+
+}  // namespace
+
+void RecordCheckpointIO(const std::string& channel, const std::string& phase, int64_t bytes,
+                        int64_t elapsed_ns) {
+  GetCheckpointIOMetrics()->Record(channel, phase, bytes, elapsed_ns);
+}
+
+void ResetCheckpointIOMetrics() { GetCheckpointIOMetrics()->Reset(); }
+
+std::string GetCheckpointIOMetricsSummary() { return GetCheckpointIOMetrics()->Summary(); }
+
+}  // namespace profiler
+
+}  // namespace oneflow
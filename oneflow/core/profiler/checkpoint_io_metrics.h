@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_CHECKPOINT_IO_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_CHECKPOINT_IO_METRICS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace oneflow {
+
+namespace profiler {
+
+// Records that a phase of saving or loading checkpoints moved `bytes` in `elapsed_ns`. The channel
+// is the code path, such as "snapshot_writer" or "persistent_table_save", the phase is one step of
+// it, such as "copy", "serialize", "write" or "close". Channels nest, the writes of
+// "snapshot_writer" are also recorded by "persistent_out_stream".
+void RecordCheckpointIO(const std::string& channel, const std::string& phase, int64_t bytes,
+                        int64_t elapsed_ns);
+
+// Records the time from its construction to its destruction as a phase.
+class CheckpointIOPhaseTimer final {
+ public:
+  CheckpointIOPhaseTimer(const char* channel, const char* phase, int64_t bytes)
+      : channel_(channel), phase_(phase), bytes_(bytes), start_(std::chrono::steady_clock::now()) {}
+  ~CheckpointIOPhaseTimer() {
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    RecordCheckpointIO(channel_, phase_, bytes_,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+  // For phases whose size is only known at the end.
+  void set_bytes(int64_t bytes) { bytes_ = bytes; }
+
+ private:
+  const char* channel_;
+  const char* phase_;
+  int64_t bytes_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Drops all the phases recorded.
+void ResetCheckpointIOMetrics();
+
+// Returns the calls, bytes, time and bandwidth per channel and phase as json.
+std::string GetCheckpointIOMetricsSummary();
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_CHECKPOINT_IO_METRICS_H_
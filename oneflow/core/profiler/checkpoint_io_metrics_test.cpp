@@ -0,0 +1,49 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/checkpoint_io_metrics.h"
+#include "nlohmann/json.hpp"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(CheckpointIOMetrics, Summary) {
+  ResetCheckpointIOMetrics();
+  RecordCheckpointIO("snapshot_writer", "write", 4000, 1000);
+  RecordCheckpointIO("snapshot_writer", "write", 2000, 2000);
+  RecordCheckpointIO("snapshot_writer", "close", 0, 500);
+  { CheckpointIOPhaseTimer timer("model_save", "copy", 64); }
+  const auto summary = nlohmann::json::parse(GetCheckpointIOMetricsSummary());
+  const auto& write = summary.at("snapshot_writer").at("write");
+  ASSERT_EQ(write.at("count").get<int64_t>(), 2);
+  ASSERT_EQ(write.at("bytes").get<int64_t>(), 6000);
+  ASSERT_EQ(write.at("elapsed_ns").get<int64_t>(), 3000);
+  ASSERT_DOUBLE_EQ(write.at("bandwidth_gbps").get<double>(), 2.0);
+  ASSERT_EQ(summary.at("snapshot_writer").at("close").at("bytes").get<int64_t>(), 0);
+  ASSERT_EQ(summary.at("model_save").at("copy").at("count").get<int64_t>(), 1);
+  ASSERT_EQ(summary.at("model_save").at("copy").at("bytes").get<int64_t>(), 64);
+  ResetCheckpointIOMetrics();
+  ASSERT_TRUE(nlohmann::json::parse(GetCheckpointIOMetricsSummary()).empty());
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,216 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/collective_trace.h"
+#include "oneflow/core/common/util.h"
+#include "nlohmann/json.hpp"
+#include <fstream>
+#include <map>
+#include <set>
+#include <mutex>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace detail {
+
+std::atomic<bool> collective_trace_enabled(false);
+
+}  // namespace detail
+
+namespace {
+
+class CollectiveStat final {
+ public:
+  CollectiveStat() : count_(0), elapsed_ns_(0), bytes_(0), bus_bytes_(0) {}
+  ~CollectiveStat() = default;
+
+  void Add(int64_t elapsed_ns, int64_t bytes, double bus_bytes) {
+    count_ += 1;
+    elapsed_ns_ += elapsed_ns;
+    bytes_ += bytes;
+    bus_bytes_ += bus_bytes;
+  }
+
+  // Bytes per nanosecond are GB/s.
+  nlohmann::json ToJson() const {
+    nlohmann::json json;
+    json["count"] = count_;
+    json["elapsed_ns"] = elapsed_ns_;
+    json["bytes"] = bytes_;
+    json["algbw_gbps"] = elapsed_ns_ == 0 ? 0.0 : static_cast<double>(bytes_) / elapsed_ns_;
+    json["busbw_gbps"] = elapsed_ns_ == 0 ? 0.0 : bus_bytes_ / elapsed_ns_;
+    return json;
+  }
+
+ private:
+  int64_t count_;
+  int64_t elapsed_ns_;
+  int64_t bytes_;
+  double bus_bytes_;
+};
+
+struct JobStat {
+  CollectiveStat group_stat;
+  std::map<std::string, std::pair<std::string, CollectiveStat>> request_name2op_type_and_stat;
+};
+
+struct CollectiveGroupEvent {
+  int64_t job_id;
+  int64_t device_id;
+  int64_t end_ns;
+  int64_t elapsed_ns;
+  std::vector<CollectiveRequestRecord> requests;
+};
+
+class CollectiveTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CollectiveTrace);
+  CollectiveTrace()
+      : max_num_events_(
+          ParseIntegerFromEnv("ONEFLOW_PROFILER_COLLECTIVE_TRACE_MAX_EVENTS", 1 << 20)) {}
+  ~CollectiveTrace() = default;
+
+  void Record(int64_t job_id, int64_t device_id,
+              const std::vector<CollectiveRequestRecord>& requests, int64_t end_ns,
+              int64_t elapsed_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JobStat* job_stat = &job_id2stat_[job_id];
+    int64_t group_bytes = 0;
+    double group_bus_bytes = 0;
+    for (const auto& request : requests) {
+      const double bus_bytes = request.size_in_bytes * request.bus_bandwidth_factor;
+      auto& op_type_and_stat = job_stat->request_name2op_type_and_stat[request.name];
+      op_type_and_stat.first = request.op_type;
+      op_type_and_stat.second.Add(elapsed_ns, request.size_in_bytes, bus_bytes);
+      group_bytes += request.size_in_bytes;
+      group_bus_bytes += bus_bytes;
+    }
+    job_stat->group_stat.Add(elapsed_ns, group_bytes, group_bus_bytes);
+    // Stats keep being updated after the event buffer is full.
+    if (events_.size() < max_num_events_) {
+      events_.push_back(CollectiveGroupEvent{job_id, device_id, end_ns, elapsed_ns, requests});
+    }
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_id2stat_.clear();
+    events_.clear();
+  }
+
+  std::string Summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : job_id2stat_) {
+      nlohmann::json job = pair.second.group_stat.ToJson();
+      nlohmann::json requests = nlohmann::json::object();
+      for (const auto& request_pair : pair.second.request_name2op_type_and_stat) {
+        nlohmann::json request = request_pair.second.second.ToJson();
+        request["op_type"] = request_pair.second.first;
+        requests[request_pair.first] = request;
+      }
+      job["requests"] = requests;
+      summary[std::to_string(pair.first)] = job;
+    }
+    return summary.dump(2);
+  }
+
+  // The device run of a group is placed to end when its completion was observed on the host, so
+  // it lines up with host side traces of the same process.
+  void DumpChromeTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json trace_events = nlohmann::json::array();
+    std::set<int64_t> device_ids;
+    for (const auto& event : events_) { device_ids.insert(event.device_id); }
+    for (const int64_t device_id : device_ids) {
+      const std::string thread_name = "collective:cuda:" + std::to_string(device_id);
+      trace_events.push_back({{"name", "thread_name"},
+                              {"ph", "M"},
+                              {"pid", 0},
+                              {"tid", device_id},
+                              {"args", {{"name", thread_name}}}});
+    }
+    const auto ToMicroseconds = [](int64_t ns) { return static_cast<double>(ns) / 1000; };
+    for (const auto& event : events_) {
+      std::string name;
+      int64_t bytes = 0;
+      nlohmann::json requests = nlohmann::json::array();
+      for (const auto& request : event.requests) {
+        if (!name.empty()) { name += ","; }
+        name += request.op_type;
+        bytes += request.size_in_bytes;
+        requests.push_back(request.name);
+      }
+      const double algbw =
+          event.elapsed_ns == 0 ? 0.0 : static_cast<double>(bytes) / event.elapsed_ns;
+      trace_events.push_back({{"name", name},
+                              {"cat", "collective"},
+                              {"ph", "X"},
+                              {"pid", 0},
+                              {"tid", event.device_id},
+                              {"ts", ToMicroseconds(event.end_ns - event.elapsed_ns)},
+                              {"dur", ToMicroseconds(event.elapsed_ns)},
+                              {"args",
+                               {{"job_id", event.job_id},
+                                {"bytes", bytes},
+                                {"algbw_gbps", algbw},
+                                {"requests", requests}}}});
+    }
+    std::ofstream ofs(path);
+    CHECK(ofs.is_open()) << "failed to open " << path;
+    ofs << nlohmann::json({{"traceEvents", trace_events}}).dump() << std::endl;
+  }
+
+ private:
+  const size_t max_num_events_;
+  std::mutex mutex_;
+  std::map<int64_t, JobStat> job_id2stat_;
+  std::vector<CollectiveGroupEvent> events_;
+};
+
+CollectiveTrace* GetCollectiveTrace() {
+  static CollectiveTrace trace;
+  return &trace;
+}
+
+}  // namespace
+
+void EnableCollectiveTrace() {
+  detail::collective_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableCollectiveTrace() {
+  detail::collective_trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+void ResetCollectiveTrace() { GetCollectiveTrace()->Reset(); }
+
+void RecordCollectiveGroup(int64_t job_id, int64_t device_id,
+                           const std::vector<CollectiveRequestRecord>& requests, int64_t end_ns,
+                           int64_t elapsed_ns) {
+  GetCollectiveTrace()->Record(job_id, device_id, requests, end_ns, elapsed_ns);
+}
+
+std::string GetCollectiveSummary() { return GetCollectiveTrace()->Summary(); }
+
+void DumpCollectiveChromeTrace(const std::string& path) {
+  GetCollectiveTrace()->DumpChromeTrace(path);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
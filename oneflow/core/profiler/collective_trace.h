@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_COLLECTIVE_TRACE_H_
+#define ONEFLOW_CORE_PROFILER_COLLECTIVE_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace oneflow {
+
+namespace profiler {
+
+// One request of a collective group launched together on a device.
+struct CollectiveRequestRecord {
+  std::string name;
+  std::string op_type;
+  // The bytes the algorithm bandwidth is computed from, as nccl-tests counts them.
+  int64_t size_in_bytes;
+  // Bus bandwidth is the algorithm bandwidth times this factor, e.g. 2 * (n - 1) / n for
+  // all-reduce over n ranks, so it is comparable with the peak bandwidth of the links.
+  double bus_bandwidth_factor;
+};
+
+namespace detail {
+
+extern std::atomic<bool> collective_trace_enabled;
+
+}  // namespace detail
+
+inline bool CollectiveTraceEnabled() {
+  return detail::collective_trace_enabled.load(std::memory_order_relaxed);
+}
+
+void EnableCollectiveTrace();
+
+void DisableCollectiveTrace();
+
+// Drops all the groups recorded.
+void ResetCollectiveTrace();
+
+// Records a group of requests of `job_id` which ran `elapsed_ns` on the device and was found done
+// at `end_ns`, a steady clock time in nanoseconds.
+void RecordCollectiveGroup(int64_t job_id, int64_t device_id,
+                           const std::vector<CollectiveRequestRecord>& requests, int64_t end_ns,
+                           int64_t elapsed_ns);
+
+// Returns the time, bytes, algorithm and bus bandwidth per job and per request as json. A request
+// fused with others is charged the time of the whole group.
+std::string GetCollectiveSummary();
+
+// Writes the recorded groups to `path` in the Chrome trace event format, one track per device.
+void DumpCollectiveChromeTrace(const std::string& path);
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_COLLECTIVE_TRACE_H_
@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/collective_trace.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(CollectiveTrace, Summary) {
+  ResetCollectiveTrace();
+  const std::vector<CollectiveRequestRecord> group{
+      {"grad-0", "kOpTypeAllReduce", 1000, 1.5},
+      {"grad-1", "kOpTypeAllReduce", 3000, 1.5},
+  };
+  RecordCollectiveGroup(1, 0, group, 10000, 2000);
+  RecordCollectiveGroup(1, 0, group, 20000, 2000);
+  RecordCollectiveGroup(2, 0, {{"shuffle", "kOpTypeAll2All", 500, 0.5}}, 30000, 1000);
+  const auto summary = nlohmann::json::parse(GetCollectiveSummary());
+  const auto& job = summary.at("1");
+  ASSERT_EQ(job.at("count").get<int64_t>(), 2);
+  ASSERT_EQ(job.at("elapsed_ns").get<int64_t>(), 4000);
+  ASSERT_EQ(job.at("bytes").get<int64_t>(), 8000);
+  ASSERT_DOUBLE_EQ(job.at("algbw_gbps").get<double>(), 2.0);
+  ASSERT_DOUBLE_EQ(job.at("busbw_gbps").get<double>(), 3.0);
+  const auto& request = job.at("requests").at("grad-1");
+  ASSERT_EQ(request.at("op_type").get<std::string>(), "kOpTypeAllReduce");
+  ASSERT_EQ(request.at("count").get<int64_t>(), 2);
+  ASSERT_DOUBLE_EQ(request.at("algbw_gbps").get<double>(), 1.5);
+  ASSERT_DOUBLE_EQ(summary.at("2").at("busbw_gbps").get<double>(), 0.25);
+  ResetCollectiveTrace();
+  ASSERT_TRUE(nlohmann::json::parse(GetCollectiveSummary()).empty());
+}
+
+TEST(CollectiveTrace, DumpChromeTrace) {
+  ResetCollectiveTrace();
+  RecordCollectiveGroup(1, 3, {{"grad-0", "kOpTypeAllReduce", 1000, 1.5}}, 5000, 2000);
+  char path[] = "/tmp/collective_trace_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  DumpCollectiveChromeTrace(path);
+  std::ifstream ifs(path);
+  const auto trace = nlohmann::json::parse(ifs);
+  std::remove(path);
+  int64_t num_complete_events = 0;
+  for (const auto& event : trace.at("traceEvents")) {
+    if (event.at("ph").get<std::string>() != "X") { continue; }
+    ++num_complete_events;
+    ASSERT_EQ(event.at("tid").get<int64_t>(), 3);
+    ASSERT_DOUBLE_EQ(event.at("ts").get<double>(), 3.0);
+    ASSERT_DOUBLE_EQ(event.at("dur").get<double>(), 2.0);
+    ASSERT_EQ(event.at("args").at("bytes").get<int64_t>(), 1000);
+  }
+  ASSERT_EQ(num_complete_events, 1);
+  ResetCollectiveTrace();
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,255 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/cupti_activity.h"
+#include "oneflow/core/profiler/event_trace.h"
+#include "oneflow/core/profiler/managed_memory_metrics.h"
+#include "oneflow/core/common/util.h"
+#ifdef WITH_CUDA
+#include <cupti.h>
+#include <cxxabi.h>
+#include <atomic>
+#include <cstdlib>
+#endif  // WITH_CUDA
+
+namespace oneflow {
+
+namespace profiler {
+
+#ifdef WITH_CUDA
+
+namespace {
+
+constexpr size_t kCuptiBufferSize = 8 * 1024 * 1024;
+constexpr size_t kCuptiBufferAlign = 8;
+
+const CUpti_ActivityKind kCuptiActivityKinds[] = {
+    CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL, CUPTI_ACTIVITY_KIND_MEMCPY,
+    CUPTI_ACTIVITY_KIND_MEMSET, CUPTI_ACTIVITY_KIND_EXTERNAL_CORRELATION};
+
+// Added to the CUPTI timestamps to put them on the clock of InstructionTraceNow().
+std::atomic<int64_t> cupti_clock_offset(0);
+
+bool CuptiOk(CUptiResult result, const char* call) {
+  if (result == CUPTI_SUCCESS) { return true; }
+  const char* message = nullptr;
+  cuptiGetResultString(result, &message);
+  LOG(WARNING) << call << " failed: " << (message == nullptr ? "unknown error" : message);
+  return false;
+}
+
+#define OF_CUPTI_OK(call) CuptiOk(call, #call)
+
+std::string Demangle(const char* name) {
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0 || demangled == nullptr) { return name; }
+  std::string ret(demangled);
+  free(demangled);
+  return ret;
+}
+
+const char* MemcpyName(uint8_t copy_kind) {
+  switch (copy_kind) {
+    case CUPTI_ACTIVITY_MEMCPY_KIND_HTOD: return "Memcpy HtoD";
+    case CUPTI_ACTIVITY_MEMCPY_KIND_DTOH: return "Memcpy DtoH";
+    case CUPTI_ACTIVITY_MEMCPY_KIND_DTOD: return "Memcpy DtoD";
+    case CUPTI_ACTIVITY_MEMCPY_KIND_HTOH: return "Memcpy HtoH";
+    case CUPTI_ACTIVITY_MEMCPY_KIND_PTOP: return "Memcpy PtoP";
+    default: return "Memcpy";
+  }
+}
+
+void CUPTIAPI BufferRequested(uint8_t** buffer, size_t* size, size_t* max_num_records) {
+  *buffer = static_cast<uint8_t*>(aligned_alloc(kCuptiBufferAlign, kCuptiBufferSize));
+  *size = *buffer == nullptr ? 0 : kCuptiBufferSize;
+  *max_num_records = 0;
+}
+
+template<typename RecordT>
+DeviceActivity MakeDeviceActivity(const RecordT* record, std::string name, const char* kind) {
+  const int64_t offset = cupti_clock_offset.load(std::memory_order_relaxed);
+  DeviceActivity activity;
+  activity.name = std::move(name);
+  activity.kind = kind;
+  activity.device_id = record->deviceId;
+  activity.stream_id = record->streamId;
+  activity.start = static_cast<int64_t>(record->start) + offset;
+  activity.end = static_cast<int64_t>(record->end) + offset;
+  activity.correlation_id = record->correlationId;
+  activity.bytes = 0;
+  return activity;
+}
+
+void RecordUnifiedMemoryCounter(const CUpti_ActivityUnifiedMemoryCounter2* counter) {
+  // The migrations carry their cause in the flags.
+  switch (counter->counterKind) {
+    case CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_BYTES_TRANSFER_HTOD:
+      RecordManagedMemoryMigration(
+          counter->flags == CUPTI_ACTIVITY_UNIFIED_MEMORY_MIGRATION_CAUSE_USER
+              ? ManagedMemoryMigration::kPrefetch
+              : ManagedMemoryMigration::kFault,
+          counter->value);
+      return;
+    case CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_BYTES_TRANSFER_DTOH:
+      RecordManagedMemoryMigration(
+          counter->flags == CUPTI_ACTIVITY_UNIFIED_MEMORY_MIGRATION_CAUSE_EVICTION
+              ? ManagedMemoryMigration::kEviction
+              : ManagedMemoryMigration::kHostFault,
+          counter->value);
+      return;
+    case CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_GPU_PAGE_FAULT:
+      RecordManagedMemoryPageFaults(true, counter->value);
+      return;
+    case CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_CPU_PAGE_FAULT_COUNT:
+      RecordManagedMemoryPageFaults(false, counter->value);
+      return;
+    default: return;
+  }
+}
+
+void RecordActivity(const CUpti_Activity* record) {
+  switch (record->kind) {
+    case CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL: {
+      // The leading fields of the kernel records stay the same in the later versions.
+      const auto* kernel = reinterpret_cast<const CUpti_ActivityKernel4*>(record);
+      RecordDeviceActivity(MakeDeviceActivity(kernel, Demangle(kernel->name), "kernel"));
+      return;
+    }
+    case CUPTI_ACTIVITY_KIND_MEMCPY: {
+      const auto* copy = reinterpret_cast<const CUpti_ActivityMemcpy*>(record);
+      DeviceActivity activity = MakeDeviceActivity(copy, MemcpyName(copy->copyKind), "memcpy");
+      activity.bytes = copy->bytes;
+      RecordDeviceActivity(activity);
+      return;
+    }
+    case CUPTI_ACTIVITY_KIND_MEMSET: {
+      const auto* set = reinterpret_cast<const CUpti_ActivityMemset*>(record);
+      DeviceActivity activity = MakeDeviceActivity(set, "Memset", "memset");
+      activity.bytes = set->bytes;
+      RecordDeviceActivity(activity);
+      return;
+    }
+    case CUPTI_ACTIVITY_KIND_EXTERNAL_CORRELATION: {
+      const auto* correlation = reinterpret_cast<const CUpti_ActivityExternalCorrelation*>(record);
+      if (correlation->externalKind == CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0) {
+        RecordDeviceActivityCorrelation(correlation->correlationId, correlation->externalId);
+      }
+      return;
+    }
+    case CUPTI_ACTIVITY_KIND_UNIFIED_MEMORY_COUNTER: {
+      const auto* counter = reinterpret_cast<const CUpti_ActivityUnifiedMemoryCounter2*>(record);
+      RecordUnifiedMemoryCounter(counter);
+      return;
+    }
+    default: return;
+  }
+}
+
+void CUPTIAPI BufferCompleted(CUcontext context, uint32_t stream_id, uint8_t* buffer, size_t size,
+                              size_t valid_size) {
+  CUpti_Activity* record = nullptr;
+  while (cuptiActivityGetNextRecord(buffer, valid_size, &record) == CUPTI_SUCCESS) {
+    RecordActivity(record);
+  }
+  size_t dropped = 0;
+  if (OF_CUPTI_OK(cuptiActivityGetNumDroppedRecords(context, stream_id, &dropped))
+      && dropped > 0) {
+    LOG(WARNING) << "CUPTI dropped " << dropped << " activity records";
+  }
+  free(buffer);
+}
+
+bool RegisterCuptiCallbacks() {
+  static const bool callbacks_registered =
+      OF_CUPTI_OK(cuptiActivityRegisterCallbacks(BufferRequested, BufferCompleted));
+  return callbacks_registered;
+}
+
+}  // namespace
+
+bool StartCuptiActivity() {
+  if (!RegisterCuptiCallbacks()) { return false; }
+  uint64_t cupti_now = 0;
+  if (!OF_CUPTI_OK(cuptiGetTimestamp(&cupti_now))) { return false; }
+  cupti_clock_offset.store(InstructionTraceNow() - static_cast<int64_t>(cupti_now),
+                           std::memory_order_relaxed);
+  for (CUpti_ActivityKind kind : kCuptiActivityKinds) {
+    if (!OF_CUPTI_OK(cuptiActivityEnable(kind))) {
+      StopCuptiActivity();
+      return false;
+    }
+  }
+  return true;
+}
+
+void StopCuptiActivity() {
+  for (CUpti_ActivityKind kind : kCuptiActivityKinds) { cuptiActivityDisable(kind); }
+  OF_CUPTI_OK(cuptiActivityFlushAll(CUPTI_ACTIVITY_FLAG_FLUSH_FORCED));
+}
+
+void PushCuptiCorrelationId(uint64_t op_compute_id) {
+  cuptiActivityPushExternalCorrelationId(CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0, op_compute_id);
+}
+
+void PopCuptiCorrelationId() {
+  uint64_t op_compute_id = 0;
+  cuptiActivityPopExternalCorrelationId(CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0, &op_compute_id);
+}
+
+bool StartCuptiUnifiedMemoryCounters(int64_t device_id) {
+  if (!RegisterCuptiCallbacks()) { return false; }
+  const CUpti_ActivityUnifiedMemoryCounterKind kinds[] = {
+      CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_BYTES_TRANSFER_HTOD,
+      CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_BYTES_TRANSFER_DTOH,
+      CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_GPU_PAGE_FAULT,
+      CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_KIND_CPU_PAGE_FAULT_COUNT};
+  constexpr size_t kNumKinds = sizeof(kinds) / sizeof(kinds[0]);
+  CUpti_ActivityUnifiedMemoryCounterConfig configs[kNumKinds];
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    configs[i].scope = CUPTI_ACTIVITY_UNIFIED_MEMORY_COUNTER_SCOPE_PROCESS_SINGLE_DEVICE;
+    configs[i].kind = kinds[i];
+    configs[i].deviceId = static_cast<uint32_t>(device_id);
+    configs[i].enable = 1;
+  }
+  if (!OF_CUPTI_OK(cuptiActivityConfigureUnifiedMemoryCounter(configs, kNumKinds))
+      || !OF_CUPTI_OK(cuptiActivityEnable(CUPTI_ACTIVITY_KIND_UNIFIED_MEMORY_COUNTER))) {
+    return false;
+  }
+  SetManagedMemoryPageFaultCountersEnabled(true);
+  return true;
+}
+
+void FlushCuptiActivity() { OF_CUPTI_OK(cuptiActivityFlushAll(0)); }
+
+#else
+
+bool StartCuptiActivity() { return false; }
+
+void StopCuptiActivity() {}
+
+void PushCuptiCorrelationId(uint64_t op_compute_id) {}
+
+void PopCuptiCorrelationId() {}
+
+bool StartCuptiUnifiedMemoryCounters(int64_t device_id) { return false; }
+
+void FlushCuptiActivity() {}
+
+#endif  // WITH_CUDA
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_CUPTI_ACTIVITY_H_
+#define ONEFLOW_CORE_PROFILER_CUPTI_ACTIVITY_H_
+
+#include <cstdint>
+
+namespace oneflow {
+
+namespace profiler {
+
+// Collects the kernels, memory copies and memory sets run by the devices with the CUPTI activity
+// API and hands them to RecordDeviceActivity(). All of them are no-ops without CUDA.
+
+// Returns false when CUPTI is unavailable, the event trace then goes without device activities.
+bool StartCuptiActivity();
+
+// Flushes the activities still buffered.
+void StopCuptiActivity();
+
+// The CUDA calls made by this thread until the pop are correlated to `op_compute_id`.
+void PushCuptiCorrelationId(uint64_t op_compute_id);
+
+void PopCuptiCorrelationId();
+
+// Counts the unified memory migrations and page faults of `device_id` into the managed memory
+// metrics, until the process exits. Returns false when CUPTI is unavailable.
+bool StartCuptiUnifiedMemoryCounters(int64_t device_id);
+
+// Hands the activities completed so far to their recorders.
+void FlushCuptiActivity();
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_CUPTI_ACTIVITY_H_
@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/data_reader_metrics.h"
+#include "oneflow/core/common/util.h"
+#include "nlohmann/json.hpp"
+#include <map>
+#include <mutex>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+struct DataReaderStat {
+  int64_t num_batches = 0;
+  int64_t num_stalls = 0;
+  int64_t stall_ns = 0;
+
+  nlohmann::json ToJson() const {
+    nlohmann::json json;
+    json["batches"] = num_batches;
+    json["stalls"] = num_stalls;
+    json["stall_ns"] = stall_ns;
+    json["avg_stall_ns"] = num_stalls == 0 ? 0.0 : static_cast<double>(stall_ns) / num_stalls;
+    json["stall_ratio"] = num_batches == 0 ? 0.0 : static_cast<double>(num_stalls) / num_batches;
+    return json;
+  }
+};
+
+class DataReaderMetrics final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(DataReaderMetrics);
+  DataReaderMetrics() = default;
+  ~DataReaderMetrics() = default;
+
+  void Record(const std::string& op_name, bool stalled, int64_t wait_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DataReaderStat* stat = &op_name2stat_[op_name];
+    stat->num_batches += 1;
+    if (stalled) {
+      stat->num_stalls += 1;
+      stat->stall_ns += wait_ns;
+    }
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    op_name2stat_.clear();
+  }
+
+  std::string Summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : op_name2stat_) { summary[pair.first] = pair.second.ToJson(); }
+    return summary.dump(2);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, DataReaderStat> op_name2stat_;
+};
+
+DataReaderMetrics* GetDataReaderMetrics() {
+  static DataReaderMetrics metrics;
+  return &metrics;
+}
+
+}  // namespace
+
+void RecordDataReaderFetch(const std::string& op_name, bool stalled, int64_t wait_ns) {
+  GetDataReaderMetrics()->Record(op_name, stalled, wait_ns);
+}
+
+void ResetDataReaderMetrics() { GetDataReaderMetrics()->Reset(); }
+
+std::string GetDataReaderMetricsSummary() { return GetDataReaderMetrics()->Summary(); }
+
+}  // namespace profiler
+
+}  // namespace oneflow
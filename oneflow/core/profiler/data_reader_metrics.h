@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_DATA_READER_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_DATA_READER_METRICS_H_
+
+#include <cstdint>
+#include <string>
+
+namespace oneflow {
+
+namespace profiler {
+
+// Records a batch a data reader op handed to its kernel. The batch stalled the kernel if it was
+// not prefetched yet, `wait_ns` is then the time the kernel waited for it.
+void RecordDataReaderFetch(const std::string& op_name, bool stalled, int64_t wait_ns);
+
+// Drops all the batches recorded.
+void ResetDataReaderMetrics();
+
+// Returns the batches, stalls and stall time per data reader op as json.
+std::string GetDataReaderMetricsSummary();
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_DATA_READER_METRICS_H_
@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/data_reader_metrics.h"
+#include "nlohmann/json.hpp"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(DataReaderMetrics, Summary) {
+  ResetDataReaderMetrics();
+  RecordDataReaderFetch("reader", false, 0);
+  RecordDataReaderFetch("reader", true, 3000);
+  RecordDataReaderFetch("reader", true, 1000);
+  RecordDataReaderFetch("reader", false, 0);
+  RecordDataReaderFetch("coco", false, 0);
+  const auto summary = nlohmann::json::parse(GetDataReaderMetricsSummary());
+  const auto& reader = summary.at("reader");
+  ASSERT_EQ(reader.at("batches").get<int64_t>(), 4);
+  ASSERT_EQ(reader.at("stalls").get<int64_t>(), 2);
+  ASSERT_EQ(reader.at("stall_ns").get<int64_t>(), 4000);
+  ASSERT_DOUBLE_EQ(reader.at("avg_stall_ns").get<double>(), 2000.0);
+  ASSERT_DOUBLE_EQ(reader.at("stall_ratio").get<double>(), 0.5);
+  ASSERT_EQ(summary.at("coco").at("stalls").get<int64_t>(), 0);
+  ASSERT_DOUBLE_EQ(summary.at("coco").at("avg_stall_ns").get<double>(), 0.0);
+  ResetDataReaderMetrics();
+  ASSERT_TRUE(nlohmann::json::parse(GetDataReaderMetricsSummary()).empty());
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,430 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/event_trace.h"
+#include "oneflow/core/profiler/cupti_activity.h"
+#include "nlohmann/json.hpp"
+#include <array>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace detail {
+
+std::atomic<bool> event_trace_enabled(false);
+
+}  // namespace detail
+
+namespace {
+
+struct OpDispatchEvent {
+  int64_t op_type_id;
+  int64_t thread_id;
+  int64_t begin;
+  int64_t end;
+};
+
+struct OpComputeEvent {
+  int64_t op_type_id;
+  std::string op_name;
+  int64_t thread_id;
+  int64_t begin;
+  int64_t end;
+  uint64_t op_compute_id;
+};
+
+struct InstructionEvent {
+  int64_t name_id;
+  int64_t stream_id;
+  int64_t dispatch;
+  int64_t complete;
+};
+
+// The op computes open on a thread, innermost last.
+struct OpComputeFrame {
+  uint64_t op_compute_id;
+  std::string op_type;
+  std::string op_name;
+  int64_t begin;
+};
+
+thread_local std::vector<OpComputeFrame> op_compute_frames;
+
+std::atomic<uint64_t> next_op_compute_id(1);
+
+std::atomic<int64_t> next_thread_id(0);
+
+int64_t ThisThreadId() {
+  static thread_local int64_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return thread_id;
+}
+
+double ToMicroseconds(int64_t ns) { return static_cast<double>(ns) / 1000; }
+
+class EventTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(EventTrace);
+  EventTrace()
+      : max_num_events_(ParseIntegerFromEnv("ONEFLOW_PROFILER_EVENT_TRACE_MAX_EVENTS", 1 << 20)),
+        instruction_trace_was_enabled_(false),
+        cupti_started_(false) {}
+  ~EventTrace() = default;
+
+  void Enable() {
+    std::lock_guard<std::mutex> lock(enable_mutex_);
+    if (EventTraceEnabled()) { return; }
+    instruction_trace_was_enabled_ = InstructionTraceEnabled();
+    EnableInstructionTrace();
+    cupti_started_ = StartCuptiActivity();
+    detail::event_trace_enabled.store(true, std::memory_order_relaxed);
+  }
+
+  void Disable() {
+    std::lock_guard<std::mutex> lock(enable_mutex_);
+    if (!EventTraceEnabled()) { return; }
+    detail::event_trace_enabled.store(false, std::memory_order_relaxed);
+    if (cupti_started_) { StopCuptiActivity(); }
+    cupti_started_ = false;
+    if (!instruction_trace_was_enabled_) { DisableInstructionTrace(); }
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    op_type2id_.clear();
+    op_types_.clear();
+    stream_name2id_.clear();
+    stream_names_.clear();
+    dispatch_events_.clear();
+    compute_events_.clear();
+    instruction_events_.clear();
+    device_activities_.clear();
+    correlation_id2op_compute_id_.clear();
+  }
+
+  void RecordOpDispatch(const std::string& op_type, int64_t begin, int64_t end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dispatch_events_.size() >= max_num_events_) { return; }
+    const int64_t op_type_id = Intern(op_type, &op_type2id_, &op_types_);
+    dispatch_events_.push_back(OpDispatchEvent{op_type_id, ThisThreadId(), begin, end});
+  }
+
+  void RecordOpCompute(const std::string& op_type, const std::string& op_name, int64_t begin,
+                       int64_t end, uint64_t op_compute_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (compute_events_.size() >= max_num_events_) { return; }
+    const int64_t op_type_id = Intern(op_type, &op_type2id_, &op_types_);
+    compute_events_.push_back(
+        OpComputeEvent{op_type_id, op_name, ThisThreadId(), begin, end, op_compute_id});
+  }
+
+  void RecordInstruction(const std::string& name, const std::string& stream_name,
+                         const InstructionTimestamps& timestamps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (instruction_events_.size() >= max_num_events_) { return; }
+    const int64_t name_id = Intern(name, &op_type2id_, &op_types_);
+    const int64_t stream_id = Intern(stream_name, &stream_name2id_, &stream_names_);
+    instruction_events_.push_back(
+        InstructionEvent{name_id, stream_id, timestamps.dispatch, timestamps.complete});
+  }
+
+  void RecordDeviceActivity(const DeviceActivity& activity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (device_activities_.size() >= max_num_events_) { return; }
+    device_activities_.push_back(activity);
+  }
+
+  void RecordCorrelation(uint64_t correlation_id, uint64_t op_compute_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    correlation_id2op_compute_id_[correlation_id] = op_compute_id;
+  }
+
+  std::string OpSummary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::array<std::pair<int64_t, int64_t>, 3>> op_type2stats;
+    for (const auto& event : dispatch_events_) {
+      auto* stat = &op_type2stats[op_types_.at(event.op_type_id)].at(0);
+      stat->first += 1;
+      stat->second += event.end - event.begin;
+    }
+    for (const auto& event : compute_events_) {
+      auto* stat = &op_type2stats[op_types_.at(event.op_type_id)].at(1);
+      stat->first += 1;
+      stat->second += event.end - event.begin;
+    }
+    const auto& op_compute_id2event = OpComputeId2Event();
+    for (const auto& activity : device_activities_) {
+      const OpComputeEvent* event = FindOpCompute(activity, op_compute_id2event);
+      if (event == nullptr) { continue; }
+      auto* stat = &op_type2stats[op_types_.at(event->op_type_id)].at(2);
+      stat->first += 1;
+      stat->second += activity.end - activity.start;
+    }
+    const char* const kStatNames[3] = {"dispatch", "compute", "device"};
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : op_type2stats) {
+      nlohmann::json op_summary;
+      for (int i = 0; i < 3; ++i) {
+        op_summary[kStatNames[i]] = {{"count", pair.second.at(i).first},
+                                     {"total_ns", pair.second.at(i).second}};
+      }
+      summary[pair.first] = op_summary;
+    }
+    return summary.dump(2);
+  }
+
+  std::string KernelSummary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    struct KernelStat {
+      std::string kind;
+      int64_t count = 0;
+      int64_t total_ns = 0;
+      int64_t min_ns = 0;
+      int64_t max_ns = 0;
+      int64_t bytes = 0;
+      std::set<std::string> op_types;
+    };
+    std::map<std::string, KernelStat> name2stat;
+    const auto& op_compute_id2event = OpComputeId2Event();
+    for (const auto& activity : device_activities_) {
+      KernelStat* stat = &name2stat[activity.name];
+      const int64_t elapsed = activity.end - activity.start;
+      stat->kind = activity.kind;
+      stat->min_ns = stat->count == 0 ? elapsed : std::min(stat->min_ns, elapsed);
+      stat->max_ns = std::max(stat->max_ns, elapsed);
+      stat->count += 1;
+      stat->total_ns += elapsed;
+      stat->bytes += activity.bytes;
+      const OpComputeEvent* event = FindOpCompute(activity, op_compute_id2event);
+      if (event != nullptr) { stat->op_types.insert(op_types_.at(event->op_type_id)); }
+    }
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : name2stat) {
+      const KernelStat& stat = pair.second;
+      summary[pair.first] = {{"kind", stat.kind},
+                             {"count", stat.count},
+                             {"total_ns", stat.total_ns},
+                             {"avg_ns", static_cast<double>(stat.total_ns) / stat.count},
+                             {"min_ns", stat.min_ns},
+                             {"max_ns", stat.max_ns},
+                             {"bytes", stat.bytes},
+                             {"op_types", stat.op_types}};
+    }
+    return summary.dump(2);
+  }
+
+  // The host threads are the threads of process 0, the streams of the virtual machine those of
+  // process 1 and the streams of device i those of process 2 + i.
+  void DumpChromeTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json trace_events = nlohmann::json::array();
+    const auto ProcessName = [&](int64_t pid, const std::string& name) {
+      trace_events.push_back(
+          {{"name", "process_name"}, {"ph", "M"}, {"pid", pid}, {"args", {{"name", name}}}});
+    };
+    ProcessName(0, "host");
+    ProcessName(1, "virtual machine");
+    for (size_t i = 0; i < stream_names_.size(); ++i) {
+      trace_events.push_back({{"name", "thread_name"},
+                              {"ph", "M"},
+                              {"pid", 1},
+                              {"tid", i},
+                              {"args", {{"name", stream_names_.at(i)}}}});
+    }
+    for (const auto& event : dispatch_events_) {
+      trace_events.push_back({{"name", op_types_.at(event.op_type_id)},
+                              {"cat", "op_dispatch"},
+                              {"ph", "X"},
+                              {"pid", 0},
+                              {"tid", event.thread_id},
+                              {"ts", ToMicroseconds(event.begin)},
+                              {"dur", ToMicroseconds(event.end - event.begin)}});
+    }
+    for (const auto& event : compute_events_) {
+      trace_events.push_back({{"name", op_types_.at(event.op_type_id)},
+                              {"cat", "op_compute"},
+                              {"ph", "X"},
+                              {"pid", 0},
+                              {"tid", event.thread_id},
+                              {"ts", ToMicroseconds(event.begin)},
+                              {"dur", ToMicroseconds(event.end - event.begin)},
+                              {"args", {{"op_name", event.op_name}}}});
+    }
+    for (const auto& event : instruction_events_) {
+      trace_events.push_back({{"name", op_types_.at(event.name_id)},
+                              {"cat", "instruction"},
+                              {"ph", "X"},
+                              {"pid", 1},
+                              {"tid", event.stream_id},
+                              {"ts", ToMicroseconds(event.dispatch)},
+                              {"dur", ToMicroseconds(event.complete - event.dispatch)}});
+    }
+    std::set<int64_t> device_ids;
+    std::set<uint64_t> flow_ids;
+    const auto& op_compute_id2event = OpComputeId2Event();
+    for (const auto& activity : device_activities_) {
+      const int64_t pid = 2 + activity.device_id;
+      if (device_ids.insert(activity.device_id).second) {
+        ProcessName(pid, "device " + std::to_string(activity.device_id));
+      }
+      nlohmann::json args = {{"correlation_id", activity.correlation_id}};
+      if (activity.bytes > 0) { args["bytes"] = activity.bytes; }
+      const OpComputeEvent* event = FindOpCompute(activity, op_compute_id2event);
+      if (event != nullptr) {
+        args["op_type"] = op_types_.at(event->op_type_id);
+        args["op_name"] = event->op_name;
+      }
+      trace_events.push_back({{"name", activity.name},
+                              {"cat", activity.kind},
+                              {"ph", "X"},
+                              {"pid", pid},
+                              {"tid", activity.stream_id},
+                              {"ts", ToMicroseconds(activity.start)},
+                              {"dur", ToMicroseconds(activity.end - activity.start)},
+                              {"args", args}});
+      if (event == nullptr) { continue; }
+      // A flow from the op compute to each device activity it launched.
+      if (flow_ids.insert(event->op_compute_id).second) {
+        trace_events.push_back({{"name", "launch"},
+                                {"cat", "launch"},
+                                {"ph", "s"},
+                                {"id", event->op_compute_id},
+                                {"pid", 0},
+                                {"tid", event->thread_id},
+                                {"ts", ToMicroseconds(event->begin)}});
+      }
+      trace_events.push_back({{"name", "launch"},
+                              {"cat", "launch"},
+                              {"ph", "f"},
+                              {"bp", "e"},
+                              {"id", event->op_compute_id},
+                              {"pid", pid},
+                              {"tid", activity.stream_id},
+                              {"ts", ToMicroseconds(activity.start)}});
+    }
+    std::ofstream ofs(path);
+    CHECK(ofs.is_open()) << "failed to open " << path;
+    ofs << nlohmann::json({{"traceEvents", trace_events}}).dump() << std::endl;
+  }
+
+ private:
+  static int64_t Intern(const std::string& name, HashMap<std::string, int64_t>* name2id,
+                        std::vector<std::string>* names) {
+    const auto& iter = name2id->find(name);
+    if (iter != name2id->end()) { return iter->second; }
+    const int64_t id = names->size();
+    name2id->emplace(name, id);
+    names->push_back(name);
+    return id;
+  }
+
+  HashMap<uint64_t, const OpComputeEvent*> OpComputeId2Event() const {
+    HashMap<uint64_t, const OpComputeEvent*> op_compute_id2event;
+    for (const auto& event : compute_events_) {
+      op_compute_id2event.emplace(event.op_compute_id, &event);
+    }
+    return op_compute_id2event;
+  }
+
+  const OpComputeEvent* FindOpCompute(
+      const DeviceActivity& activity,
+      const HashMap<uint64_t, const OpComputeEvent*>& op_compute_id2event) const {
+    const auto& correlation_iter = correlation_id2op_compute_id_.find(activity.correlation_id);
+    if (correlation_iter == correlation_id2op_compute_id_.end()) { return nullptr; }
+    const auto& event_iter = op_compute_id2event.find(correlation_iter->second);
+    if (event_iter == op_compute_id2event.end()) { return nullptr; }
+    return event_iter->second;
+  }
+
+  const size_t max_num_events_;
+  std::mutex enable_mutex_;
+  bool instruction_trace_was_enabled_;
+  bool cupti_started_;
+  std::mutex mutex_;
+  // Op types and instruction names.
+  HashMap<std::string, int64_t> op_type2id_;
+  std::vector<std::string> op_types_;
+  HashMap<std::string, int64_t> stream_name2id_;
+  std::vector<std::string> stream_names_;
+  std::vector<OpDispatchEvent> dispatch_events_;
+  std::vector<OpComputeEvent> compute_events_;
+  std::vector<InstructionEvent> instruction_events_;
+  std::vector<DeviceActivity> device_activities_;
+  HashMap<uint64_t, uint64_t> correlation_id2op_compute_id_;
+};
+
+EventTrace* GetEventTrace() {
+  static EventTrace trace;
+  return &trace;
+}
+
+}  // namespace
+
+void EnableEventTrace() { GetEventTrace()->Enable(); }
+
+void DisableEventTrace() { GetEventTrace()->Disable(); }
+
+void ResetEventTrace() { GetEventTrace()->Reset(); }
+
+void RecordOpDispatchEvent(const std::string& op_type, int64_t begin, int64_t end) {
+  GetEventTrace()->RecordOpDispatch(op_type, begin, end);
+}
+
+uint64_t BeginOpComputeEvent(const std::string& op_type, const std::string& op_name) {
+  const uint64_t op_compute_id = next_op_compute_id.fetch_add(1, std::memory_order_relaxed);
+  op_compute_frames.push_back(
+      OpComputeFrame{op_compute_id, op_type, op_name, InstructionTraceNow()});
+  PushCuptiCorrelationId(op_compute_id);
+  return op_compute_id;
+}
+
+void EndOpComputeEvent(uint64_t op_compute_id) {
+  CHECK(!op_compute_frames.empty());
+  const int64_t end = InstructionTraceNow();
+  const OpComputeFrame& frame = op_compute_frames.back();
+  CHECK_EQ(frame.op_compute_id, op_compute_id);
+  PopCuptiCorrelationId();
+  GetEventTrace()->RecordOpCompute(frame.op_type, frame.op_name, frame.begin, end, op_compute_id);
+  op_compute_frames.pop_back();
+}
+
+void RecordInstructionEvent(const std::string& name, const std::string& stream_name,
+                            const InstructionTimestamps& timestamps) {
+  GetEventTrace()->RecordInstruction(name, stream_name, timestamps);
+}
+
+void RecordDeviceActivity(const DeviceActivity& activity) {
+  GetEventTrace()->RecordDeviceActivity(activity);
+}
+
+void RecordDeviceActivityCorrelation(uint64_t correlation_id, uint64_t op_compute_id) {
+  GetEventTrace()->RecordCorrelation(correlation_id, op_compute_id);
+}
+
+std::string GetEventTraceOpSummary() { return GetEventTrace()->OpSummary(); }
+
+std::string GetEventTraceKernelSummary() { return GetEventTrace()->KernelSummary(); }
+
+void DumpEventTraceChromeTrace(const std::string& path) {
+  GetEventTrace()->DumpChromeTrace(path);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
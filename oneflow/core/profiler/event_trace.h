@@ -0,0 +1,126 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_EVENT_TRACE_H_
+#define ONEFLOW_CORE_PROFILER_EVENT_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/profiler/instruction_trace.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// The event trace puts on one timeline the ops dispatched by the interpreter, the ops computed on
+// the streams, the instructions of the virtual machine and the kernels and memory copies run by
+// the devices, which are collected by CUPTI. A device activity is attributed to the op whose
+// compute launched it by the CUPTI external correlation id, see OpComputeEventGuard.
+
+// A kernel, memory copy or memory set run by a device.
+struct DeviceActivity {
+  std::string name;
+  std::string kind;  // "kernel", "memcpy" or "memset"
+  int64_t device_id;
+  int64_t stream_id;
+  // On the clock of InstructionTraceNow().
+  int64_t start;
+  int64_t end;
+  // Of the CUDA call launching it.
+  uint64_t correlation_id;
+  int64_t bytes;
+};
+
+namespace detail {
+
+extern std::atomic<bool> event_trace_enabled;
+
+}  // namespace detail
+
+inline bool EventTraceEnabled() {
+  return detail::event_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Also enables the instruction trace and, with CUDA, starts collecting the device activities.
+void EnableEventTrace();
+
+// Flushes the device activities still buffered by CUPTI.
+void DisableEventTrace();
+
+// Drops all the events recorded.
+void ResetEventTrace();
+
+void RecordOpDispatchEvent(const std::string& op_type, int64_t begin, int64_t end);
+
+// Returns the id correlating the device activities launched until EndOpComputeEvent() on this
+// thread to the op.
+uint64_t BeginOpComputeEvent(const std::string& op_type, const std::string& op_name);
+
+void EndOpComputeEvent(uint64_t op_compute_id);
+
+void RecordInstructionEvent(const std::string& name, const std::string& stream_name,
+                            const InstructionTimestamps& timestamps);
+
+void RecordDeviceActivity(const DeviceActivity& activity);
+
+// The CUDA call of `correlation_id` was made by the op compute of `op_compute_id`.
+void RecordDeviceActivityCorrelation(uint64_t correlation_id, uint64_t op_compute_id);
+
+// Returns the dispatch, host compute and device time per op type as json.
+std::string GetEventTraceOpSummary();
+
+// Returns the runs, device time and launching op types per kernel or memory copy name as json.
+std::string GetEventTraceKernelSummary();
+
+// Writes the recorded events to `path` in the Chrome trace event format, with a flow from every
+// op compute to the device activities it launched.
+void DumpEventTraceChromeTrace(const std::string& path);
+
+class OpDispatchEventGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OpDispatchEventGuard);
+  explicit OpDispatchEventGuard(const std::string& op_type)
+      : op_type_(EventTraceEnabled() ? &op_type : nullptr),
+        begin_(op_type_ == nullptr ? 0 : InstructionTraceNow()) {}
+  ~OpDispatchEventGuard() {
+    if (op_type_ != nullptr) { RecordOpDispatchEvent(*op_type_, begin_, InstructionTraceNow()); }
+  }
+
+ private:
+  const std::string* op_type_;
+  int64_t begin_;
+};
+
+class OpComputeEventGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OpComputeEventGuard);
+  OpComputeEventGuard(const std::string& op_type, const std::string& op_name)
+      : enabled_(EventTraceEnabled()),
+        op_compute_id_(enabled_ ? BeginOpComputeEvent(op_type, op_name) : 0) {}
+  ~OpComputeEventGuard() {
+    if (enabled_) { EndOpComputeEvent(op_compute_id_); }
+  }
+
+ private:
+  bool enabled_;
+  uint64_t op_compute_id_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_EVENT_TRACE_H_
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/event_trace.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+namespace {
+
+DeviceActivity MakeKernel(const std::string& name, int64_t start, int64_t end,
+                          uint64_t correlation_id) {
+  return DeviceActivity{name, "kernel", 0, 7, start, end, correlation_id, 0};
+}
+
+}  // namespace
+
+TEST(EventTrace, Summary) {
+  ResetEventTrace();
+  RecordOpDispatchEvent("relu", 1000, 1500);
+  const uint64_t op_compute_id = BeginOpComputeEvent("relu", "relu-0");
+  EndOpComputeEvent(op_compute_id);
+  RecordDeviceActivityCorrelation(42, op_compute_id);
+  RecordDeviceActivity(MakeKernel("ReluKernel", 3000, 3400, 42));
+  RecordDeviceActivity(MakeKernel("ReluKernel", 4000, 4200, 42));
+  RecordDeviceActivity(MakeKernel("OrphanKernel", 5000, 5100, 43));
+  const auto op_summary = nlohmann::json::parse(GetEventTraceOpSummary());
+  const auto& relu = op_summary.at("relu");
+  ASSERT_EQ(relu.at("dispatch").at("count").get<int64_t>(), 1);
+  ASSERT_EQ(relu.at("dispatch").at("total_ns").get<int64_t>(), 500);
+  ASSERT_EQ(relu.at("compute").at("count").get<int64_t>(), 1);
+  ASSERT_EQ(relu.at("device").at("count").get<int64_t>(), 2);
+  ASSERT_EQ(relu.at("device").at("total_ns").get<int64_t>(), 600);
+  const auto kernel_summary = nlohmann::json::parse(GetEventTraceKernelSummary());
+  const auto& relu_kernel = kernel_summary.at("ReluKernel");
+  ASSERT_EQ(relu_kernel.at("count").get<int64_t>(), 2);
+  ASSERT_EQ(relu_kernel.at("min_ns").get<int64_t>(), 200);
+  ASSERT_EQ(relu_kernel.at("max_ns").get<int64_t>(), 400);
+  ASSERT_EQ(relu_kernel.at("op_types"), nlohmann::json({"relu"}));
+  ASSERT_TRUE(kernel_summary.at("OrphanKernel").at("op_types").empty());
+  ResetEventTrace();
+  ASSERT_TRUE(nlohmann::json::parse(GetEventTraceOpSummary()).empty());
+}
+
+TEST(EventTrace, DumpChromeTrace) {
+  ResetEventTrace();
+  const uint64_t op_compute_id = BeginOpComputeEvent("add", "add-0");
+  EndOpComputeEvent(op_compute_id);
+  RecordInstructionEvent("add:cuda.LocalCallOpKernel", "cuda:0",
+                         InstructionTimestamps{1000, 2000, 3000, 4000, 5000, 6000});
+  RecordDeviceActivityCorrelation(1, op_compute_id);
+  RecordDeviceActivity(MakeKernel("AddKernel", 3000, 4000, 1));
+  RecordDeviceActivity(MakeKernel("AddKernel", 5000, 6000, 1));
+  char path[] = "/tmp/event_trace_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  DumpEventTraceChromeTrace(path);
+  std::ifstream ifs(path);
+  const auto trace = nlohmann::json::parse(ifs);
+  std::remove(path);
+  int64_t num_kernel_events = 0;
+  int64_t num_flow_starts = 0;
+  int64_t num_flow_ends = 0;
+  for (const auto& event : trace.at("traceEvents")) {
+    const std::string ph = event.at("ph").get<std::string>();
+    if (ph == "X" && event.at("cat") == "kernel") {
+      ++num_kernel_events;
+      ASSERT_EQ(event.at("pid").get<int64_t>(), 2);
+      ASSERT_EQ(event.at("tid").get<int64_t>(), 7);
+      ASSERT_EQ(event.at("args").at("op_name"), "add-0");
+    } else if (ph == "X" && event.at("cat") == "instruction") {
+      ASSERT_DOUBLE_EQ(event.at("ts").get<double>(), 4.0);
+      ASSERT_DOUBLE_EQ(event.at("dur").get<double>(), 1.0);
+    } else if (ph == "s") {
+      ++num_flow_starts;
+    } else if (ph == "f") {
+      ++num_flow_ends;
+      ASSERT_EQ(event.at("id").get<uint64_t>(), op_compute_id);
+    }
+  }
+  ASSERT_EQ(num_kernel_events, 2);
+  ASSERT_EQ(num_flow_starts, 1);
+  ASSERT_EQ(num_flow_ends, 2);
+  ResetEventTrace();
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
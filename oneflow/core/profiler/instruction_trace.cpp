@@ -0,0 +1,252 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/instruction_trace.h"
+#include "oneflow/core/profiler/event_trace.h"
+#include "oneflow/core/common/util.h"
+#include "nlohmann/json.hpp"
+#include <array>
+#include <fstream>
+#include <mutex>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace detail {
+
+std::atomic<bool> instruction_trace_enabled(false);
+
+}  // namespace detail
+
+namespace {
+
+// queue:      enqueue  -> schedule, waiting in the pending list
+// dependence: schedule -> ready,    waiting for the instructions it depends on
+// dispatch:   ready    -> dispatch, waiting in the ready list
+// compute:    dispatch -> complete, running on the stream
+// release:    complete -> release,  releasing dependences
+constexpr int kNumPhases = 5;
+const char* const kPhaseNames[kNumPhases] = {"queue", "dependence", "dispatch", "compute",
+                                             "release"};
+
+int64_t PhaseBegin(const InstructionTimestamps& timestamps, int phase) {
+  const int64_t begins[kNumPhases] = {timestamps.enqueue, timestamps.schedule, timestamps.ready,
+                                      timestamps.dispatch, timestamps.complete};
+  return begins[phase];
+}
+
+int64_t PhaseEnd(const InstructionTimestamps& timestamps, int phase) {
+  const int64_t ends[kNumPhases] = {timestamps.schedule, timestamps.ready, timestamps.dispatch,
+                                    timestamps.complete, timestamps.release};
+  return ends[phase];
+}
+
+// Bucket i counts latencies in [2^(i-1), 2^i) nanoseconds, bucket 0 counts zero latencies.
+constexpr int kNumHistogramBuckets = 48;
+
+class Histogram final {
+ public:
+  Histogram() : count_(0), sum_(0), min_(0), max_(0), buckets_() {}
+  ~Histogram() = default;
+
+  void Add(int64_t latency) {
+    latency = std::max<int64_t>(latency, 0);
+    min_ = count_ == 0 ? latency : std::min(min_, latency);
+    max_ = std::max(max_, latency);
+    count_ += 1;
+    sum_ += latency;
+    int bucket = 0;
+    while (bucket < kNumHistogramBuckets - 1 && (latency >> bucket) != 0) { ++bucket; }
+    buckets_.at(bucket) += 1;
+  }
+
+  nlohmann::json ToJson() const {
+    nlohmann::json json;
+    json["count"] = count_;
+    json["sum_ns"] = sum_;
+    json["min_ns"] = min_;
+    json["max_ns"] = max_;
+    json["mean_ns"] = count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+    nlohmann::json buckets = nlohmann::json::array();
+    for (int i = 0; i < kNumHistogramBuckets; ++i) {
+      if (buckets_.at(i) == 0) { continue; }
+      buckets.push_back({{"lt_ns", int64_t(1) << i}, {"count", buckets_.at(i)}});
+    }
+    json["buckets"] = buckets;
+    return json;
+  }
+
+ private:
+  int64_t count_;
+  int64_t sum_;
+  int64_t min_;
+  int64_t max_;
+  std::array<int64_t, kNumHistogramBuckets> buckets_;
+};
+
+struct InstructionEvent {
+  int64_t name_id;
+  int64_t stream_id;
+  InstructionTimestamps timestamps;
+};
+
+class InstructionTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(InstructionTrace);
+  InstructionTrace()
+      : max_num_events_(
+          ParseIntegerFromEnv("ONEFLOW_PROFILER_INSTRUCTION_TRACE_MAX_EVENTS", 1 << 20)) {}
+  ~InstructionTrace() = default;
+
+  void Record(const std::string& name, const std::string& stream_name,
+              const InstructionTimestamps& timestamps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t name_id = Intern(name, &name2id_, &names_);
+    if (histograms_.size() < names_.size()) { histograms_.resize(names_.size()); }
+    for (int phase = 0; phase < kNumPhases; ++phase) {
+      histograms_.at(name_id).at(phase).Add(PhaseEnd(timestamps, phase)
+                                            - PhaseBegin(timestamps, phase));
+    }
+    // Histograms keep being updated after the event buffer is full.
+    if (events_.size() < max_num_events_) {
+      const int64_t stream_id = Intern(stream_name, &stream_name2id_, &stream_names_);
+      events_.push_back(InstructionEvent{name_id, stream_id, timestamps});
+    }
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    name2id_.clear();
+    names_.clear();
+    stream_name2id_.clear();
+    stream_names_.clear();
+    histograms_.clear();
+    events_.clear();
+  }
+
+  std::string Summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json summary = nlohmann::json::object();
+    for (size_t i = 0; i < names_.size(); ++i) {
+      nlohmann::json phases;
+      for (int phase = 0; phase < kNumPhases; ++phase) {
+        phases[kPhaseNames[phase]] = histograms_.at(i).at(phase).ToJson();
+      }
+      summary[names_.at(i)] = phases;
+    }
+    return summary.dump(2);
+  }
+
+  // Every stream is a thread of the trace. The compute phase is drawn on the stream, while the
+  // lifetime of an instruction is an async event since lifetimes overlap on the same stream.
+  void DumpChromeTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json trace_events = nlohmann::json::array();
+    for (size_t i = 0; i < stream_names_.size(); ++i) {
+      trace_events.push_back({{"name", "thread_name"},
+                              {"ph", "M"},
+                              {"pid", 0},
+                              {"tid", i},
+                              {"args", {{"name", stream_names_.at(i)}}}});
+    }
+    const auto ToMicroseconds = [](int64_t ns) { return static_cast<double>(ns) / 1000; };
+    for (size_t i = 0; i < events_.size(); ++i) {
+      const auto& event = events_.at(i);
+      const std::string& name = names_.at(event.name_id);
+      const auto& timestamps = event.timestamps;
+      nlohmann::json args;
+      for (int phase = 0; phase < kNumPhases; ++phase) {
+        args[std::string(kPhaseNames[phase]) + "_us"] =
+            ToMicroseconds(PhaseEnd(timestamps, phase) - PhaseBegin(timestamps, phase));
+      }
+      trace_events.push_back({{"name", name},
+                              {"cat", "compute"},
+                              {"ph", "X"},
+                              {"pid", 0},
+                              {"tid", event.stream_id},
+                              {"ts", ToMicroseconds(timestamps.dispatch)},
+                              {"dur", ToMicroseconds(timestamps.complete - timestamps.dispatch)},
+                              {"args", args}});
+      for (const char* ph : {"b", "e"}) {
+        const bool begin = ph[0] == 'b';
+        trace_events.push_back(
+            {{"name", name},
+             {"cat", "instruction"},
+             {"ph", ph},
+             {"id", i},
+             {"pid", 0},
+             {"tid", event.stream_id},
+             {"ts", ToMicroseconds(begin ? timestamps.enqueue : timestamps.release)}});
+      }
+    }
+    std::ofstream ofs(path);
+    CHECK(ofs.is_open()) << "failed to open " << path;
+    ofs << nlohmann::json({{"traceEvents", trace_events}}).dump() << std::endl;
+  }
+
+ private:
+  static int64_t Intern(const std::string& name, HashMap<std::string, int64_t>* name2id,
+                        std::vector<std::string>* names) {
+    const auto& iter = name2id->find(name);
+    if (iter != name2id->end()) { return iter->second; }
+    const int64_t id = names->size();
+    name2id->emplace(name, id);
+    names->push_back(name);
+    return id;
+  }
+
+  const size_t max_num_events_;
+  std::mutex mutex_;
+  HashMap<std::string, int64_t> name2id_;
+  std::vector<std::string> names_;
+  HashMap<std::string, int64_t> stream_name2id_;
+  std::vector<std::string> stream_names_;
+  std::vector<std::array<Histogram, kNumPhases>> histograms_;
+  std::vector<InstructionEvent> events_;
+};
+
+InstructionTrace* GetInstructionTrace() {
+  static InstructionTrace trace;
+  return &trace;
+}
+
+}  // namespace
+
+void EnableInstructionTrace() {
+  detail::instruction_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableInstructionTrace() {
+  detail::instruction_trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+void ResetInstructionTrace() { GetInstructionTrace()->Reset(); }
+
+void RecordInstruction(const std::string& name, const std::string& stream_name,
+                       const InstructionTimestamps& timestamps) {
+  GetInstructionTrace()->Record(name, stream_name, timestamps);
+  if (EventTraceEnabled()) { RecordInstructionEvent(name, stream_name, timestamps); }
+}
+
+std::string GetInstructionLatencySummary() { return GetInstructionTrace()->Summary(); }
+
+void DumpInstructionChromeTrace(const std::string& path) {
+  GetInstructionTrace()->DumpChromeTrace(path);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_INSTRUCTION_TRACE_H_
+#define ONEFLOW_CORE_PROFILER_INSTRUCTION_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace oneflow {
+
+namespace profiler {
+
+// Timestamps in nanoseconds of an instruction passing through the virtual machine.
+struct InstructionTimestamps {
+  int64_t enqueue;   // received by VirtualMachineEngine::Receive
+  int64_t schedule;  // taken out of the pending list by the scheduler
+  int64_t ready;     // all dependences resolved, put onto the ready list
+  int64_t dispatch;  // dispatched to its stream
+  int64_t complete;  // found done by the scheduler
+  int64_t release;   // dependences released
+};
+
+namespace detail {
+
+extern std::atomic<bool> instruction_trace_enabled;
+
+}  // namespace detail
+
+// It is the only cost on the scheduling path when the instruction trace is disabled.
+inline bool InstructionTraceEnabled() {
+  return detail::instruction_trace_enabled.load(std::memory_order_relaxed);
+}
+
+inline int64_t InstructionTraceNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void EnableInstructionTrace();
+
+void DisableInstructionTrace();
+
+// Drops all the histograms and events recorded.
+void ResetInstructionTrace();
+
+void RecordInstruction(const std::string& name, const std::string& stream_name,
+                       const InstructionTimestamps& timestamps);
+
+// Returns the latency histograms of every phase per instruction name as json.
+std::string GetInstructionLatencySummary();
+
+// Writes the recorded instructions to `path` in the Chrome trace event format.
+void DumpInstructionChromeTrace(const std::string& path);
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_INSTRUCTION_TRACE_H_
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/instruction_trace.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(InstructionTrace, Summary) {
+  ResetInstructionTrace();
+  InstructionTimestamps timestamps{1000, 1100, 1300, 1700, 2500, 2600};
+  RecordInstruction("relu:cuda.LocalCallOpKernel", "cuda:0", timestamps);
+  timestamps.complete = 1800;
+  timestamps.release = 1900;
+  RecordInstruction("relu:cuda.LocalCallOpKernel", "cuda:0", timestamps);
+  const auto summary = nlohmann::json::parse(GetInstructionLatencySummary());
+  const auto& compute = summary.at("relu:cuda.LocalCallOpKernel").at("compute");
+  ASSERT_EQ(compute.at("count").get<int64_t>(), 2);
+  ASSERT_EQ(compute.at("min_ns").get<int64_t>(), 100);
+  ASSERT_EQ(compute.at("max_ns").get<int64_t>(), 800);
+  ASSERT_EQ(compute.at("sum_ns").get<int64_t>(), 900);
+  int64_t bucket_count = 0;
+  for (const auto& bucket : compute.at("buckets")) {
+    bucket_count += bucket.at("count").get<int64_t>();
+  }
+  ASSERT_EQ(bucket_count, 2);
+  const auto& queue = summary.at("relu:cuda.LocalCallOpKernel").at("queue");
+  ASSERT_EQ(queue.at("min_ns").get<int64_t>(), 100);
+  ResetInstructionTrace();
+  ASSERT_TRUE(nlohmann::json::parse(GetInstructionLatencySummary()).empty());
+}
+
+TEST(InstructionTrace, DumpChromeTrace) {
+  ResetInstructionTrace();
+  RecordInstruction("add:cpu.LocalCallOpKernel", "cpu:0",
+                    InstructionTimestamps{1000, 2000, 3000, 4000, 5000, 6000});
+  char path[] = "/tmp/instruction_trace_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  DumpInstructionChromeTrace(path);
+  std::ifstream ifs(path);
+  const auto trace = nlohmann::json::parse(ifs);
+  std::remove(path);
+  int64_t num_complete_events = 0;
+  int64_t num_async_events = 0;
+  for (const auto& event : trace.at("traceEvents")) {
+    const std::string ph = event.at("ph").get<std::string>();
+    if (ph == "X") {
+      ++num_complete_events;
+      ASSERT_DOUBLE_EQ(event.at("ts").get<double>(), 4.0);
+      ASSERT_DOUBLE_EQ(event.at("dur").get<double>(), 1.0);
+    } else if (ph == "b" || ph == "e") {
+      ++num_async_events;
+    }
+  }
+  ASSERT_EQ(num_complete_events, 1);
+  ASSERT_EQ(num_async_events, 2);
+  ResetInstructionTrace();
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
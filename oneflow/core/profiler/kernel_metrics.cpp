@@ -0,0 +1,119 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/kernel_metrics.h"
+#include "oneflow/core/common/util.h"
+#include "nlohmann/json.hpp"
+#include <map>
+#include <mutex>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace detail {
+
+std::atomic<bool> kernel_metrics_enabled(false);
+
+}  // namespace detail
+
+namespace {
+
+struct KernelStat {
+  int64_t count = 0;
+  int64_t elapsed_ns = 0;
+  int64_t bytes_read = 0;
+  int64_t bytes_written = 0;
+  int64_t flops = 0;
+
+  // Bytes per nanosecond are GB/s, FLOPs per nanosecond are GFLOP/s.
+  nlohmann::json ToJson() const {
+    nlohmann::json json;
+    json["count"] = count;
+    json["elapsed_ns"] = elapsed_ns;
+    json["avg_elapsed_ns"] = count == 0 ? 0.0 : static_cast<double>(elapsed_ns) / count;
+    json["bytes_read"] = bytes_read;
+    json["bytes_written"] = bytes_written;
+    json["bandwidth_gbps"] =
+        elapsed_ns == 0 ? 0.0 : static_cast<double>(bytes_read + bytes_written) / elapsed_ns;
+    json["flops"] = flops;
+    json["gflops_per_second"] = elapsed_ns == 0 ? 0.0 : static_cast<double>(flops) / elapsed_ns;
+    return json;
+  }
+};
+
+class KernelMetrics final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(KernelMetrics);
+  KernelMetrics() = default;
+  ~KernelMetrics() = default;
+
+  void Record(const KernelRunRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    KernelStat* stat = &device_type2op_type2stat_[record.device_type][record.op_type];
+    stat->count += 1;
+    stat->elapsed_ns += record.elapsed_ns;
+    stat->bytes_read += record.bytes_read;
+    stat->bytes_written += record.bytes_written;
+    stat->flops += record.flops;
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    device_type2op_type2stat_.clear();
+  }
+
+  std::string Summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json summary = nlohmann::json::object();
+    for (const auto& pair : device_type2op_type2stat_) {
+      nlohmann::json op_types = nlohmann::json::object();
+      for (const auto& op_type_pair : pair.second) {
+        op_types[op_type_pair.first] = op_type_pair.second.ToJson();
+      }
+      summary[pair.first] = op_types;
+    }
+    return summary.dump(2);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::map<std::string, KernelStat>> device_type2op_type2stat_;
+};
+
+KernelMetrics* GetKernelMetrics() {
+  static KernelMetrics metrics;
+  return &metrics;
+}
+
+}  // namespace
+
+void EnableKernelMetrics() {
+  detail::kernel_metrics_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableKernelMetrics() {
+  detail::kernel_metrics_enabled.store(false, std::memory_order_relaxed);
+}
+
+void ResetKernelMetrics() { GetKernelMetrics()->Reset(); }
+
+void RecordKernelRun(const KernelRunRecord& record) { GetKernelMetrics()->Record(record); }
+
+std::string GetKernelMetricsSummary() { return GetKernelMetrics()->Summary(); }
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_KERNEL_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_KERNEL_METRICS_H_
+
+#include <atomic>
+#include <string>
+
+namespace oneflow {
+
+namespace profiler {
+
+// One run of a kernel of the lazy runtime.
+struct KernelRunRecord {
+  std::string op_type;
+  std::string device_type;
+  int64_t elapsed_ns;
+  // From the sizes of the input and the output blobs.
+  int64_t bytes_read;
+  int64_t bytes_written;
+  // 0 for the op types whose FLOPs are unknown.
+  int64_t flops;
+};
+
+namespace detail {
+
+extern std::atomic<bool> kernel_metrics_enabled;
+
+}  // namespace detail
+
+inline bool KernelMetricsEnabled() {
+  return detail::kernel_metrics_enabled.load(std::memory_order_relaxed);
+}
+
+void EnableKernelMetrics();
+
+void DisableKernelMetrics();
+
+// Drops all the runs recorded.
+void ResetKernelMetrics();
+
+void RecordKernelRun(const KernelRunRecord& record);
+
+// Returns the runs, time, bytes, achieved bandwidth and FLOP/s per device type and op type as
+// json.
+std::string GetKernelMetricsSummary();
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_KERNEL_METRICS_H_
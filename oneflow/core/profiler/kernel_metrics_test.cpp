@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/kernel_metrics.h"
+#include "nlohmann/json.hpp"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(KernelMetrics, Summary) {
+  ResetKernelMetrics();
+  RecordKernelRun({"matmul", "cuda", 2000, 3000, 1000, 8000});
+  RecordKernelRun({"matmul", "cuda", 2000, 3000, 1000, 8000});
+  RecordKernelRun({"relu", "cuda", 1000, 500, 500, 0});
+  RecordKernelRun({"relu", "cpu", 4000, 500, 500, 0});
+  const auto summary = nlohmann::json::parse(GetKernelMetricsSummary());
+  const auto& matmul = summary.at("cuda").at("matmul");
+  ASSERT_EQ(matmul.at("count").get<int64_t>(), 2);
+  ASSERT_EQ(matmul.at("elapsed_ns").get<int64_t>(), 4000);
+  ASSERT_DOUBLE_EQ(matmul.at("avg_elapsed_ns").get<double>(), 2000.0);
+  ASSERT_EQ(matmul.at("bytes_read").get<int64_t>(), 6000);
+  ASSERT_EQ(matmul.at("bytes_written").get<int64_t>(), 2000);
+  ASSERT_DOUBLE_EQ(matmul.at("bandwidth_gbps").get<double>(), 2.0);
+  ASSERT_DOUBLE_EQ(matmul.at("gflops_per_second").get<double>(), 4.0);
+  ASSERT_DOUBLE_EQ(summary.at("cuda").at("relu").at("gflops_per_second").get<double>(), 0.0);
+  ASSERT_DOUBLE_EQ(summary.at("cpu").at("relu").at("bandwidth_gbps").get<double>(), 0.25);
+  ResetKernelMetrics();
+  ASSERT_TRUE(nlohmann::json::parse(GetKernelMetricsSummary()).empty());
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
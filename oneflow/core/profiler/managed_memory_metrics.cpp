@@ -0,0 +1,137 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/managed_memory_metrics.h"
+#include "oneflow/core/profiler/cupti_activity.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+// Counted with atomics, the allocators record from the instructions of every stream and CUPTI
+// from its own thread.
+struct ManagedMemoryMetrics {
+  std::atomic<int64_t> managed_bytes{0};
+  std::atomic<int64_t> peak_managed_bytes{0};
+  std::atomic<int64_t> num_allocations{0};
+  std::atomic<int64_t> num_fallback_allocations{0};
+  std::atomic<int64_t> prefetch_requested_bytes{0};
+  std::atomic<int64_t> num_read_mostly_advices{0};
+  std::atomic<int64_t> prefetch_migrated_bytes{0};
+  std::atomic<int64_t> fault_migrated_bytes{0};
+  std::atomic<int64_t> evicted_bytes{0};
+  std::atomic<int64_t> host_fault_migrated_bytes{0};
+  std::atomic<int64_t> device_page_faults{0};
+  std::atomic<int64_t> host_page_faults{0};
+  std::atomic<bool> page_fault_counters_enabled{false};
+};
+
+ManagedMemoryMetrics* GetManagedMemoryMetrics() {
+  static ManagedMemoryMetrics metrics;
+  return &metrics;
+}
+
+void UpdatePeak(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t current = peak->load(std::memory_order_relaxed);
+  while (current < value && !peak->compare_exchange_weak(current, value)) {}
+}
+
+}  // namespace
+
+void RecordManagedMemoryAlloc(int64_t bytes, bool fallback) {
+  auto* metrics = GetManagedMemoryMetrics();
+  UpdatePeak(&metrics->peak_managed_bytes, metrics->managed_bytes.fetch_add(bytes) + bytes);
+  metrics->num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (fallback) { metrics->num_fallback_allocations.fetch_add(1, std::memory_order_relaxed); }
+}
+
+void RecordManagedMemoryFree(int64_t bytes) { GetManagedMemoryMetrics()->managed_bytes -= bytes; }
+
+void RecordManagedMemoryPrefetch(int64_t bytes) {
+  GetManagedMemoryMetrics()->prefetch_requested_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RecordManagedMemoryReadMostlyAdvice() {
+  GetManagedMemoryMetrics()->num_read_mostly_advices.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordManagedMemoryMigration(ManagedMemoryMigration migration, int64_t bytes) {
+  auto* metrics = GetManagedMemoryMetrics();
+  switch (migration) {
+    case ManagedMemoryMigration::kPrefetch: metrics->prefetch_migrated_bytes += bytes; break;
+    case ManagedMemoryMigration::kFault: metrics->fault_migrated_bytes += bytes; break;
+    case ManagedMemoryMigration::kEviction: metrics->evicted_bytes += bytes; break;
+    case ManagedMemoryMigration::kHostFault: metrics->host_fault_migrated_bytes += bytes; break;
+  }
+}
+
+void RecordManagedMemoryPageFaults(bool on_device, int64_t count) {
+  auto* metrics = GetManagedMemoryMetrics();
+  if (on_device) {
+    metrics->device_page_faults += count;
+  } else {
+    metrics->host_page_faults += count;
+  }
+}
+
+void SetManagedMemoryPageFaultCountersEnabled(bool enabled) {
+  GetManagedMemoryMetrics()->page_fault_counters_enabled = enabled;
+}
+
+void ResetManagedMemoryMetrics() {
+  auto* metrics = GetManagedMemoryMetrics();
+  if (metrics->page_fault_counters_enabled) { FlushCuptiActivity(); }
+  metrics->peak_managed_bytes = metrics->managed_bytes.load();
+  metrics->num_allocations = 0;
+  metrics->num_fallback_allocations = 0;
+  metrics->prefetch_requested_bytes = 0;
+  metrics->num_read_mostly_advices = 0;
+  metrics->prefetch_migrated_bytes = 0;
+  metrics->fault_migrated_bytes = 0;
+  metrics->evicted_bytes = 0;
+  metrics->host_fault_migrated_bytes = 0;
+  metrics->device_page_faults = 0;
+  metrics->host_page_faults = 0;
+}
+
+std::string GetManagedMemoryMetricsSummary() {
+  auto* metrics = GetManagedMemoryMetrics();
+  // The counters of CUPTI arrive when its buffers are handed over.
+  if (metrics->page_fault_counters_enabled) { FlushCuptiActivity(); }
+  nlohmann::json summary;
+  summary["managed_bytes"] = metrics->managed_bytes.load();
+  summary["peak_managed_bytes"] = metrics->peak_managed_bytes.load();
+  summary["allocations"] = metrics->num_allocations.load();
+  summary["fallback_allocations"] = metrics->num_fallback_allocations.load();
+  summary["prefetch_requested_bytes"] = metrics->prefetch_requested_bytes.load();
+  summary["read_mostly_advices"] = metrics->num_read_mostly_advices.load();
+  summary["page_fault_counters"] = metrics->page_fault_counters_enabled.load();
+  summary["prefetch_migrated_bytes"] = metrics->prefetch_migrated_bytes.load();
+  summary["fault_migrated_bytes"] = metrics->fault_migrated_bytes.load();
+  summary["evicted_bytes"] = metrics->evicted_bytes.load();
+  summary["host_fault_migrated_bytes"] = metrics->host_fault_migrated_bytes.load();
+  summary["device_page_faults"] = metrics->device_page_faults.load();
+  summary["host_page_faults"] = metrics->host_page_faults.load();
+  return summary.dump(2);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
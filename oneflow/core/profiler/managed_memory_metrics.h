@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_MANAGED_MEMORY_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_MANAGED_MEMORY_METRICS_H_
+
+#include <cstdint>
+#include <string>
+
+namespace oneflow {
+
+namespace profiler {
+
+// Records the CUDA unified memory of the VM allocators in oversubscription mode, see
+// vm::CudaManagedAllocator. `fallback` tells that the device memory had run out.
+void RecordManagedMemoryAlloc(int64_t bytes, bool fallback);
+void RecordManagedMemoryFree(int64_t bytes);
+// Prefetches issued ahead of instructions, most of them find the memory already on the device.
+void RecordManagedMemoryPrefetch(int64_t bytes);
+void RecordManagedMemoryReadMostlyAdvice();
+
+// The migrations and page faults the driver reports through the CUPTI unified memory counters.
+enum class ManagedMemoryMigration {
+  // To the device, requested by a prefetch.
+  kPrefetch,
+  // To the device, on page faults of kernels or speculatively around them.
+  kFault,
+  // To the host, to make room on the device.
+  kEviction,
+  // To the host, on page faults of the host.
+  kHostFault,
+};
+void RecordManagedMemoryMigration(ManagedMemoryMigration migration, int64_t bytes);
+void RecordManagedMemoryPageFaults(bool on_device, int64_t count);
+// Whether the migrations and page faults are counted at all.
+void SetManagedMemoryPageFaultCountersEnabled(bool enabled);
+
+// Drops the counts recorded, the managed bytes in use are kept and become the peak.
+void ResetManagedMemoryMetrics();
+
+// Returns the managed bytes, allocations, prefetches, migrations and page faults as json.
+std::string GetManagedMemoryMetricsSummary();
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_MANAGED_MEMORY_METRICS_H_
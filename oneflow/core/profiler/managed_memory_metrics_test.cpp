@@ -0,0 +1,66 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/managed_memory_metrics.h"
+#include "nlohmann/json.hpp"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(ManagedMemoryMetrics, Summary) {
+  ResetManagedMemoryMetrics();
+  RecordManagedMemoryAlloc(1024, false);
+  RecordManagedMemoryAlloc(4096, true);
+  RecordManagedMemoryFree(1024);
+  RecordManagedMemoryPrefetch(4096);
+  RecordManagedMemoryReadMostlyAdvice();
+  RecordManagedMemoryMigration(ManagedMemoryMigration::kPrefetch, 2048);
+  RecordManagedMemoryMigration(ManagedMemoryMigration::kFault, 512);
+  RecordManagedMemoryMigration(ManagedMemoryMigration::kFault, 512);
+  RecordManagedMemoryMigration(ManagedMemoryMigration::kEviction, 256);
+  RecordManagedMemoryPageFaults(true, 3);
+  RecordManagedMemoryPageFaults(false, 1);
+  auto summary = nlohmann::json::parse(GetManagedMemoryMetricsSummary());
+  ASSERT_EQ(summary.at("managed_bytes").get<int64_t>(), 4096);
+  ASSERT_EQ(summary.at("peak_managed_bytes").get<int64_t>(), 5120);
+  ASSERT_EQ(summary.at("allocations").get<int64_t>(), 2);
+  ASSERT_EQ(summary.at("fallback_allocations").get<int64_t>(), 1);
+  ASSERT_EQ(summary.at("prefetch_requested_bytes").get<int64_t>(), 4096);
+  ASSERT_EQ(summary.at("read_mostly_advices").get<int64_t>(), 1);
+  ASSERT_EQ(summary.at("prefetch_migrated_bytes").get<int64_t>(), 2048);
+  ASSERT_EQ(summary.at("fault_migrated_bytes").get<int64_t>(), 1024);
+  ASSERT_EQ(summary.at("evicted_bytes").get<int64_t>(), 256);
+  ASSERT_EQ(summary.at("host_fault_migrated_bytes").get<int64_t>(), 0);
+  ASSERT_EQ(summary.at("device_page_faults").get<int64_t>(), 3);
+  ASSERT_EQ(summary.at("host_page_faults").get<int64_t>(), 1);
+  ResetManagedMemoryMetrics();
+  summary = nlohmann::json::parse(GetManagedMemoryMetricsSummary());
+  ASSERT_EQ(summary.at("managed_bytes").get<int64_t>(), 4096);
+  ASSERT_EQ(summary.at("peak_managed_bytes").get<int64_t>(), 4096);
+  ASSERT_EQ(summary.at("allocations").get<int64_t>(), 0);
+  ASSERT_EQ(summary.at("fault_migrated_bytes").get<int64_t>(), 0);
+  RecordManagedMemoryFree(4096);
+  ResetManagedMemoryMetrics();
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,312 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/memory_trace.h"
+#include "oneflow/core/profiler/instruction_trace.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace detail {
+
+std::atomic<bool> memory_trace_enabled(false);
+std::atomic<bool> memory_trace_stack_enabled(false);
+
+}  // namespace detail
+
+namespace {
+
+constexpr int64_t kNoOrigin = -1;
+
+thread_local const void* current_blob_object = nullptr;
+
+struct MemoryOrigin {
+  std::string op_type;
+  std::string op_name;
+  std::string stack;
+};
+
+struct MemoryEvent {
+  int64_t time;
+  int64_t device_id;
+  bool is_alloc;
+  const void* ptr;
+  size_t size;
+  size_t allocated_bytes;
+  size_t reserved_bytes;
+  const void* blob_object;
+  int64_t origin_id;
+};
+
+struct MemoryBlock {
+  size_t size;
+  int64_t time;
+  const void* blob_object;
+  int64_t origin_id;
+};
+
+struct DeviceMemoryState {
+  size_t allocated_bytes = 0;
+  size_t reserved_bytes = 0;
+  size_t peak_allocated_bytes = 0;
+  size_t peak_reserved_bytes = 0;
+  int64_t peak_time = 0;
+  // Index in the events of the peak, -1 if it was not recorded.
+  int64_t peak_event_index = -1;
+  HashMap<const void*, MemoryBlock> ptr2block;
+};
+
+std::string PtrToString(const void* ptr) {
+  std::ostringstream ss;
+  ss << ptr;
+  return ss.str();
+}
+
+class MemoryTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MemoryTrace);
+  MemoryTrace()
+      : max_num_events_(ParseIntegerFromEnv("ONEFLOW_PROFILER_MEMORY_TRACE_MAX_EVENTS", 1 << 20)) {}
+  ~MemoryTrace() = default;
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    origins_.clear();
+    blob_object2origin_id_.clear();
+    events_.clear();
+    device_id2state_.clear();
+  }
+
+  void RecordBlobOrigin(const void* blob_object, const std::string& op_type,
+                        const std::string& op_name, const std::string& stack) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blob_object2origin_id_[blob_object] = origins_.size();
+    origins_.push_back(MemoryOrigin{op_type, op_name, stack});
+  }
+
+  void RecordAlloc(int64_t device_id, const void* ptr, size_t size, size_t allocated_bytes,
+                   size_t reserved_bytes, const void* blob_object) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t origin_id = kNoOrigin;
+    if (blob_object != nullptr) {
+      // The memory of a blob object is allocated once, so its origin is taken over by the block.
+      const auto& iter = blob_object2origin_id_.find(blob_object);
+      if (iter != blob_object2origin_id_.end()) {
+        origin_id = iter->second;
+        blob_object2origin_id_.erase(iter);
+      }
+    }
+    const int64_t time = InstructionTraceNow();
+    DeviceMemoryState* state = &device_id2state_[device_id];
+    state->ptr2block[ptr] = MemoryBlock{size, time, blob_object, origin_id};
+    const bool recorded =
+        Record(MemoryEvent{time, device_id, true, ptr, size, allocated_bytes, reserved_bytes,
+                           blob_object, origin_id});
+    UpdateState(state, time, allocated_bytes, reserved_bytes, recorded);
+  }
+
+  void RecordFree(int64_t device_id, const void* ptr, size_t allocated_bytes,
+                  size_t reserved_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t time = InstructionTraceNow();
+    DeviceMemoryState* state = &device_id2state_[device_id];
+    MemoryBlock block{0, time, nullptr, kNoOrigin};
+    const auto& iter = state->ptr2block.find(ptr);
+    // Blocks allocated before the trace was enabled are not known.
+    if (iter != state->ptr2block.end()) {
+      block = iter->second;
+      state->ptr2block.erase(iter);
+    }
+    const bool recorded =
+        Record(MemoryEvent{time, device_id, false, ptr, block.size, allocated_bytes,
+                           reserved_bytes, block.blob_object, block.origin_id});
+    UpdateState(state, time, allocated_bytes, reserved_bytes, recorded);
+  }
+
+  std::string Snapshot(bool at_peak) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json snapshot = nlohmann::json::object();
+    for (const auto& pair : device_id2state_) {
+      const DeviceMemoryState& state = pair.second;
+      nlohmann::json device_snapshot = {{"peak_allocated_bytes", state.peak_allocated_bytes},
+                                        {"peak_reserved_bytes", state.peak_reserved_bytes},
+                                        {"peak_time_ns", state.peak_time}};
+      HashMap<const void*, MemoryBlock> ptr2block;
+      if (at_peak) {
+        device_snapshot["allocated_bytes"] = state.peak_allocated_bytes;
+        device_snapshot["reserved_bytes"] = state.peak_reserved_bytes;
+        // Blocks allocated before the first event recorded are left out.
+        for (int64_t i = 0; i <= state.peak_event_index; ++i) {
+          const MemoryEvent& event = events_.at(i);
+          if (event.device_id != pair.first) { continue; }
+          if (event.is_alloc) {
+            ptr2block[event.ptr] =
+                MemoryBlock{event.size, event.time, event.blob_object, event.origin_id};
+          } else {
+            ptr2block.erase(event.ptr);
+          }
+        }
+      } else {
+        device_snapshot["allocated_bytes"] = state.allocated_bytes;
+        device_snapshot["reserved_bytes"] = state.reserved_bytes;
+        ptr2block = state.ptr2block;
+      }
+      std::vector<std::pair<const void*, MemoryBlock>> blocks(ptr2block.begin(),
+                                                              ptr2block.end());
+      std::sort(blocks.begin(), blocks.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs.second.size != rhs.second.size) { return lhs.second.size > rhs.second.size; }
+        return lhs.second.time < rhs.second.time;
+      });
+      nlohmann::json blocks_json = nlohmann::json::array();
+      for (const auto& block_pair : blocks) {
+        const MemoryBlock& block = block_pair.second;
+        nlohmann::json block_json = {{"ptr", PtrToString(block_pair.first)},
+                                     {"size", block.size},
+                                     {"time_ns", block.time}};
+        if (block.blob_object != nullptr) {
+          block_json["blob_object"] = PtrToString(block.blob_object);
+        }
+        if (block.origin_id != kNoOrigin) {
+          const MemoryOrigin& origin = origins_.at(block.origin_id);
+          block_json["op_type"] = origin.op_type;
+          block_json["op_name"] = origin.op_name;
+          if (!origin.stack.empty()) { block_json["stack"] = origin.stack; }
+        }
+        blocks_json.push_back(block_json);
+      }
+      device_snapshot["blocks"] = blocks_json;
+      snapshot[std::to_string(pair.first)] = device_snapshot;
+    }
+    return snapshot.dump(2);
+  }
+
+  // Each device is a process with the allocated and reserved bytes as counters.
+  void DumpTimelineChromeTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nlohmann::json trace_events = nlohmann::json::array();
+    for (const auto& pair : device_id2state_) {
+      trace_events.push_back({{"name", "process_name"},
+                              {"ph", "M"},
+                              {"pid", pair.first},
+                              {"args", {{"name", "device " + std::to_string(pair.first)}}}});
+      trace_events.push_back({{"name", "peak"},
+                              {"ph", "i"},
+                              {"s", "p"},
+                              {"pid", pair.first},
+                              {"tid", 0},
+                              {"ts", static_cast<double>(pair.second.peak_time) / 1000},
+                              {"args",
+                               {{"allocated_bytes", pair.second.peak_allocated_bytes},
+                                {"reserved_bytes", pair.second.peak_reserved_bytes}}}});
+    }
+    for (const auto& event : events_) {
+      trace_events.push_back({{"name", "memory"},
+                              {"ph", "C"},
+                              {"pid", event.device_id},
+                              {"ts", static_cast<double>(event.time) / 1000},
+                              {"args",
+                               {{"allocated_bytes", event.allocated_bytes},
+                                {"reserved_bytes", event.reserved_bytes}}}});
+    }
+    std::ofstream ofs(path);
+    CHECK(ofs.is_open()) << "failed to open " << path;
+    ofs << nlohmann::json({{"traceEvents", trace_events}}).dump() << std::endl;
+  }
+
+ private:
+  bool Record(const MemoryEvent& event) {
+    if (events_.size() >= max_num_events_) { return false; }
+    events_.push_back(event);
+    return true;
+  }
+
+  void UpdateState(DeviceMemoryState* state, int64_t time, size_t allocated_bytes,
+                   size_t reserved_bytes, bool recorded) {
+    state->allocated_bytes = allocated_bytes;
+    state->reserved_bytes = reserved_bytes;
+    if (allocated_bytes > state->peak_allocated_bytes) {
+      state->peak_allocated_bytes = allocated_bytes;
+      state->peak_reserved_bytes = reserved_bytes;
+      state->peak_time = time;
+      state->peak_event_index = recorded ? static_cast<int64_t>(events_.size()) - 1 : -1;
+    }
+  }
+
+  const size_t max_num_events_;
+  std::mutex mutex_;
+  std::vector<MemoryOrigin> origins_;
+  HashMap<const void*, int64_t> blob_object2origin_id_;
+  std::vector<MemoryEvent> events_;
+  std::map<int64_t, DeviceMemoryState> device_id2state_;
+};
+
+MemoryTrace* GetMemoryTrace() {
+  static MemoryTrace trace;
+  return &trace;
+}
+
+}  // namespace
+
+void EnableMemoryTrace(bool record_stack) {
+  detail::memory_trace_stack_enabled.store(record_stack, std::memory_order_relaxed);
+  detail::memory_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableMemoryTrace() {
+  detail::memory_trace_enabled.store(false, std::memory_order_relaxed);
+  detail::memory_trace_stack_enabled.store(false, std::memory_order_relaxed);
+}
+
+void ResetMemoryTrace() { GetMemoryTrace()->Reset(); }
+
+void RecordMemoryBlobOrigin(const void* blob_object, const std::string& op_type,
+                            const std::string& op_name, const std::string& stack) {
+  GetMemoryTrace()->RecordBlobOrigin(blob_object, op_type, op_name, stack);
+}
+
+void RecordMemoryAlloc(int64_t device_id, const void* ptr, size_t size, size_t allocated_bytes,
+                       size_t reserved_bytes) {
+  GetMemoryTrace()->RecordAlloc(device_id, ptr, size, allocated_bytes, reserved_bytes,
+                                current_blob_object);
+}
+
+void RecordMemoryFree(int64_t device_id, const void* ptr, size_t allocated_bytes,
+                      size_t reserved_bytes) {
+  GetMemoryTrace()->RecordFree(device_id, ptr, allocated_bytes, reserved_bytes);
+}
+
+std::string GetMemorySnapshot(bool at_peak) { return GetMemoryTrace()->Snapshot(at_peak); }
+
+void DumpMemoryTimelineChromeTrace(const std::string& path) {
+  GetMemoryTrace()->DumpTimelineChromeTrace(path);
+}
+
+MemoryBlobGuard::MemoryBlobGuard(const void* blob_object)
+    : prev_blob_object_(current_blob_object) {
+  current_blob_object = blob_object;
+}
+
+MemoryBlobGuard::~MemoryBlobGuard() { current_blob_object = prev_blob_object_; }
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_MEMORY_TRACE_H_
+#define ONEFLOW_CORE_PROFILER_MEMORY_TRACE_H_
+
+#include <atomic>
+#include <string>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// The memory trace records the allocations and frees of the device allocators, each tagged with
+// the blob object it backs and the op producing that blob, to tell which tensors were alive at
+// the peak or when the device ran out of memory.
+
+namespace detail {
+
+extern std::atomic<bool> memory_trace_enabled;
+extern std::atomic<bool> memory_trace_stack_enabled;
+
+}  // namespace detail
+
+inline bool MemoryTraceEnabled() {
+  return detail::memory_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Whether the Python frames dispatching the ops are recorded as well.
+inline bool MemoryTraceStackEnabled() {
+  return detail::memory_trace_stack_enabled.load(std::memory_order_relaxed);
+}
+
+void EnableMemoryTrace(bool record_stack);
+
+void DisableMemoryTrace();
+
+// Drops all the events recorded and forgets the blocks alive.
+void ResetMemoryTrace();
+
+// The op dispatched from `stack` produces `blob_object`, whose memory is allocated later by the
+// virtual machine.
+void RecordMemoryBlobOrigin(const void* blob_object, const std::string& op_type,
+                            const std::string& op_name, const std::string& stack);
+
+// `allocated_bytes` and `reserved_bytes` are those of the allocator after the event.
+void RecordMemoryAlloc(int64_t device_id, const void* ptr, size_t size, size_t allocated_bytes,
+                       size_t reserved_bytes);
+
+void RecordMemoryFree(int64_t device_id, const void* ptr, size_t allocated_bytes,
+                      size_t reserved_bytes);
+
+// Returns the blocks alive per device as json, now or at the peak of allocated bytes among the
+// events recorded.
+std::string GetMemorySnapshot(bool at_peak);
+
+// Writes the allocated and reserved bytes per device to `path` as counters in the Chrome trace
+// event format, with the peak marked.
+void DumpMemoryTimelineChromeTrace(const std::string& path);
+
+// Tags the allocations made on this thread until destruction with `blob_object`.
+class MemoryBlobGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MemoryBlobGuard);
+  explicit MemoryBlobGuard(const void* blob_object);
+  ~MemoryBlobGuard();
+
+ private:
+  const void* prev_blob_object_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_MEMORY_TRACE_H_
@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/memory_trace.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+TEST(MemoryTrace, Snapshot) {
+  ResetMemoryTrace();
+  int blob_objects[2];
+  char memory[4096];
+  RecordMemoryBlobOrigin(&blob_objects[0], "relu", "relu-0", "");
+  {
+    MemoryBlobGuard guard(&blob_objects[0]);
+    RecordMemoryAlloc(0, memory, 1024, 1024, 2048);
+  }
+  RecordMemoryAlloc(0, memory + 1024, 512, 1536, 2048);
+  RecordMemoryFree(0, memory + 1024, 1024, 2048);
+  RecordMemoryBlobOrigin(&blob_objects[1], "add", "add-0", "");
+  {
+    MemoryBlobGuard guard(&blob_objects[1]);
+    RecordMemoryAlloc(0, memory + 2048, 256, 1280, 4096);
+  }
+  const auto now = nlohmann::json::parse(GetMemorySnapshot(false)).at("0");
+  ASSERT_EQ(now.at("allocated_bytes").get<int64_t>(), 1280);
+  ASSERT_EQ(now.at("reserved_bytes").get<int64_t>(), 4096);
+  ASSERT_EQ(now.at("peak_allocated_bytes").get<int64_t>(), 1536);
+  const auto& blocks = now.at("blocks");
+  ASSERT_EQ(blocks.size(), 2U);
+  ASSERT_EQ(blocks.at(0).at("size").get<int64_t>(), 1024);
+  ASSERT_EQ(blocks.at(0).at("op_type"), "relu");
+  ASSERT_EQ(blocks.at(1).at("op_name"), "add-0");
+  const auto peak = nlohmann::json::parse(GetMemorySnapshot(true)).at("0");
+  ASSERT_EQ(peak.at("allocated_bytes").get<int64_t>(), 1536);
+  ASSERT_EQ(peak.at("blocks").size(), 2U);
+  ASSERT_EQ(peak.at("blocks").at(1).at("size").get<int64_t>(), 512);
+  ASSERT_FALSE(peak.at("blocks").at(1).contains("op_name"));
+  ResetMemoryTrace();
+  ASSERT_TRUE(nlohmann::json::parse(GetMemorySnapshot(false)).empty());
+}
+
+TEST(MemoryTrace, DumpTimelineChromeTrace) {
+  ResetMemoryTrace();
+  char memory[1024];
+  RecordMemoryAlloc(1, memory, 512, 512, 1024);
+  RecordMemoryFree(1, memory, 0, 1024);
+  char path[] = "/tmp/memory_trace_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  DumpMemoryTimelineChromeTrace(path);
+  std::ifstream ifs(path);
+  const auto trace = nlohmann::json::parse(ifs);
+  std::remove(path);
+  std::vector<int64_t> allocated_bytes;
+  int64_t num_peaks = 0;
+  for (const auto& event : trace.at("traceEvents")) {
+    const std::string ph = event.at("ph").get<std::string>();
+    if (ph == "C") {
+      ASSERT_EQ(event.at("pid").get<int64_t>(), 1);
+      allocated_bytes.push_back(event.at("args").at("allocated_bytes").get<int64_t>());
+    } else if (ph == "i") {
+      ++num_peaks;
+      ASSERT_EQ(event.at("args").at("allocated_bytes").get<int64_t>(), 512);
+    }
+  }
+  ASSERT_EQ(allocated_bytes, std::vector<int64_t>({512, 0}));
+  ASSERT_EQ(num_peaks, 1);
+  ResetMemoryTrace();
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -72,7 +72,12 @@ void* Regst::comm_net_token() {
     token = comm_net_token_;
     if (token != nullptr) { return token; }
     CHECK(main_mem_ptr() != nullptr);
-    CHECK(separated_header_mem_ptr() == nullptr);
+    if (separated_header_mem_ptr() != nullptr) {
+      // Only the main memory is read by the comm net, so the header must be static.
+      for (int64_t i = 0; i < regst_desc()->lbi_num(); ++i) {
+        CHECK(!regst_desc()->GetBlobDescByOrdinal(i)->is_dynamic());
+      }
+    }
     token = Global<CommNet>::Get()->RegisterMemory(main_mem_ptr(),
                                                    this->regst_desc()->MainByteSize4OneRegst());
     comm_net_token_ = token;
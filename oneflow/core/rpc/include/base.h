@@ -93,6 +93,9 @@ class CtrlClient {
   virtual void PullKV(const std::string& k, std::string* v) = 0;
   virtual void PullKV(const std::string& k, PbMessage* msg) = 0;
   virtual void PullMasterKV(const std::string& k, PbMessage* msg) = 0;
+  // Makes `v` of rank `root` the value of `v` on all ranks. Collective over all ranks.
+  virtual void BroadcastKV(const std::string& k, int64_t root, std::string* v) = 0;
+  virtual void BroadcastKV(const std::string& k, int64_t root, PbMessage* msg) = 0;
   template<typename T>
   typename std::enable_if<std::is_arithmetic<T>::value>::type PullKVT(const std::string& k, T* v) {
     std::string v_str;
@@ -132,6 +132,15 @@ void LocalCtrlClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   PullKV(k, [&](const std::string& i) { msg->ParseFromString(i); });
 }
 
+// There is only one rank, which is the root, so its value is already everywhere.
+void LocalCtrlClient::BroadcastKV(const std::string& k, int64_t root, std::string* v) {
+  CHECK_EQ(root, 0);
+}
+
+void LocalCtrlClient::BroadcastKV(const std::string& k, int64_t root, PbMessage* msg) {
+  CHECK_EQ(root, 0);
+}
+
 void LocalCtrlClient::Clear() {
   {
     std::unique_lock<std::mutex> lck(done_names_mtx_);
@@ -211,6 +220,12 @@ class DryRunCtrlClient : public CtrlClient {
   void PullMasterKV(const std::string& k, PbMessage* msg) override {
     local_ctrl_client_->PullMasterKV(k, msg);
   }
+  void BroadcastKV(const std::string& k, int64_t root, std::string* v) override {
+    local_ctrl_client_->BroadcastKV(k, root, v);
+  }
+  void BroadcastKV(const std::string& k, int64_t root, PbMessage* msg) override {
+    local_ctrl_client_->BroadcastKV(k, root, msg);
+  }
   void Clear() override { local_ctrl_client_->Clear(); }
   int32_t IncreaseCount(const std::string& k, int32_t v) override {
     return local_ctrl_client_->IncreaseCount(k, v);
@@ -0,0 +1,179 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/actor_thread_pool.h"
+#include "oneflow/core/hardware/node_device_descriptor_manager.h"
+#include "oneflow/core/hardware/cuda_device_descriptor.h"
+#include "oneflow/core/hardware/topology_descriptor.h"
+#include "oneflow/core/profiler/profiler.h"
+
+namespace oneflow {
+
+namespace {
+
+// Rounds a worker retries to pop before it sleeps.
+constexpr int kSpinRoundsBeforeSleep = 64;
+
+thread_local const ActorThreadPool* current_pool = nullptr;
+thread_local int64_t current_worker_id = -1;
+
+// The PCI bus id of a CUDA device on each NUMA node with one.
+std::vector<std::string> PCIBusIdPerNumaNode() {
+  std::vector<std::string> bus_ids;
+#ifdef WITH_CUDA
+  auto* node_device_desc_mgr = Global<hardware::NodeDeviceDescriptorManager>::Get();
+  if (node_device_desc_mgr == nullptr) { return bus_ids; }
+  auto node_device_desc = node_device_desc_mgr->GetLocalNodeDeviceDescriptor();
+  auto cuda_devices =
+      node_device_desc->GetDeviceDescriptorList(hardware::kCudaDeviceDescriptorClassName);
+  if (!cuda_devices) { return bus_ids; }
+  std::vector<int32_t> numa_nodes;
+  for (size_t i = 0; i < cuda_devices->DeviceCount(); ++i) {
+    auto cuda_device =
+        std::dynamic_pointer_cast<const hardware::CudaDeviceDescriptor>(cuda_devices->GetDevice(i));
+    if (!cuda_device) { continue; }
+    const int32_t numa_node =
+        node_device_desc->Topology()->GetNumaNodeByPCIBusID(cuda_device->PCIBusID());
+    if (numa_node < 0
+        || std::find(numa_nodes.cbegin(), numa_nodes.cend(), numa_node) != numa_nodes.cend()) {
+      continue;
+    }
+    numa_nodes.emplace_back(numa_node);
+    bus_ids.emplace_back(cuda_device->PCIBusID());
+  }
+#endif  // WITH_CUDA
+  return bus_ids;
+}
+
+void SetAffinityByPCIBusId(const std::string& bus_id) {
+  auto node_device_desc =
+      Global<hardware::NodeDeviceDescriptorManager>::Get()->GetLocalNodeDeviceDescriptor();
+  node_device_desc->Topology()->SetCPUAffinityByPCIBusID(bus_id);
+  node_device_desc->Topology()->SetMemoryAffinityByPCIBusID(bus_id);
+}
+
+}  // namespace
+
+ActorThreadPool::ActorThreadPool(int64_t worker_num, bool numa_affinity)
+    : queued_num_(0), sleeping_num_(0), next_worker_id_(0), stopped_(false) {
+  CHECK_GT(worker_num, 0);
+  const std::vector<std::string> bus_ids =
+      numa_affinity ? PCIBusIdPerNumaNode() : std::vector<std::string>();
+  for (int64_t i = 0; i < worker_num; ++i) {
+    workers_.emplace_back(new Worker());
+    if (!bus_ids.empty()) { workers_.back()->numa_group = i % bus_ids.size(); }
+  }
+  // Steal from the workers of the same NUMA node first, then from the others, in turn.
+  for (int64_t i = 0; i < worker_num; ++i) {
+    std::vector<int64_t>* victims = &workers_.at(i)->victims;
+    for (int64_t j = 1; j < worker_num; ++j) {
+      const int64_t victim = (i + j) % worker_num;
+      if (workers_.at(victim)->numa_group == workers_.at(i)->numa_group) {
+        victims->emplace_back(victim);
+      }
+    }
+    for (int64_t j = 1; j < worker_num; ++j) {
+      const int64_t victim = (i + j) % worker_num;
+      if (workers_.at(victim)->numa_group != workers_.at(i)->numa_group) {
+        victims->emplace_back(victim);
+      }
+    }
+  }
+  for (int64_t i = 0; i < worker_num; ++i) {
+    const std::string bus_id = bus_ids.empty() ? "" : bus_ids.at(workers_.at(i)->numa_group);
+    threads_.emplace_back([this, i, bus_id]() {
+      OF_PROFILER_NAME_THIS_HOST_THREAD("_actor_pool_" + std::to_string(i));
+      if (!bus_id.empty()) { SetAffinityByPCIBusId(bus_id); }
+      current_pool = this;
+      current_worker_id = i;
+      WorkerLoop(i);
+    });
+  }
+}
+
+ActorThreadPool::~ActorThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    stopped_ = true;
+  }
+  sleep_cond_.notify_all();
+  for (auto& thread : threads_) { thread.join(); }
+  CHECK_EQ(queued_num_.load(), 0);
+}
+
+void ActorThreadPool::Schedule(Strand* strand) {
+  const int64_t worker_id = current_pool == this
+                                ? current_worker_id
+                                : next_worker_id_.fetch_add(1, std::memory_order_relaxed)
+                                      % workers_.size();
+  Worker* worker = workers_.at(worker_id).get();
+  {
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    worker->strands.emplace_back(strand);
+  }
+  queued_num_.fetch_add(1);
+  if (sleeping_num_.load() > 0) {
+    // Locking pairs with the check of the sleeping worker, no wakeup is lost.
+    { std::unique_lock<std::mutex> lock(sleep_mutex_); }
+    sleep_cond_.notify_one();
+  }
+}
+
+ActorThreadPool::Strand* ActorThreadPool::TryPop(int64_t worker_id) {
+  Worker* worker = workers_.at(worker_id).get();
+  {
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    if (!worker->strands.empty()) {
+      Strand* strand = worker->strands.back();
+      worker->strands.pop_back();
+      return strand;
+    }
+  }
+  for (int64_t victim_id : worker->victims) {
+    Worker* victim = workers_.at(victim_id).get();
+    std::unique_lock<std::mutex> lock(victim->mutex, std::try_to_lock);
+    if (!lock.owns_lock() || victim->strands.empty()) { continue; }
+    Strand* strand = victim->strands.front();
+    victim->strands.pop_front();
+    return strand;
+  }
+  return nullptr;
+}
+
+void ActorThreadPool::WorkerLoop(int64_t worker_id) {
+  int spin_rounds = 0;
+  while (true) {
+    Strand* strand = TryPop(worker_id);
+    if (strand != nullptr) {
+      queued_num_.fetch_sub(1);
+      spin_rounds = 0;
+      if (strand->Run()) { Schedule(strand); }
+      continue;
+    }
+    if (spin_rounds < kSpinRoundsBeforeSleep) {
+      ++spin_rounds;
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleeping_num_.fetch_add(1);
+    sleep_cond_.wait(lock, [this]() { return stopped_ || queued_num_.load() > 0; });
+    sleeping_num_.fetch_sub(1);
+    if (stopped_ && queued_num_.load() == 0) { break; }
+    spin_rounds = 0;
+  }
+}
+
+}  // namespace oneflow
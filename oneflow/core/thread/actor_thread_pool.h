@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_ACTOR_THREAD_POOL_H_
+#define ONEFLOW_CORE_THREAD_ACTOR_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Runs strands, queues of work which must run serially, on a fixed number of workers. A strand
+// scheduled by a worker is queued to that worker, otherwise to the workers in turn. Workers run
+// their own queue newest first and steal the oldest strand of the other workers when it is empty,
+// those bound to the same NUMA node first. With NUMA affinity, workers are spread over the NUMA
+// nodes of the local CUDA devices and bound to their cpus.
+class ActorThreadPool final {
+ public:
+  class Strand {
+   public:
+    Strand() = default;
+    virtual ~Strand() = default;
+
+    // Runs a bounded amount of work. Returns true if work is left and the strand has to be
+    // scheduled again, in which case the pool schedules it.
+    virtual bool Run() = 0;
+  };
+
+  OF_DISALLOW_COPY_AND_MOVE(ActorThreadPool);
+  ActorThreadPool(int64_t worker_num, bool numa_affinity);
+  ~ActorThreadPool();
+
+  int64_t worker_num() const { return workers_.size(); }
+
+  // The strand must not be scheduled again before it runs.
+  void Schedule(Strand* strand);
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Strand*> strands;
+    // Numa group of the worker, -1 if not bound.
+    int64_t numa_group = -1;
+    std::vector<int64_t> victims;
+  };
+
+  void WorkerLoop(int64_t worker_id);
+  Strand* TryPop(int64_t worker_id);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<int64_t> queued_num_;
+  std::atomic<int64_t> sleeping_num_;
+  std::atomic<size_t> next_worker_id_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cond_;
+  bool stopped_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_ACTOR_THREAD_POOL_H_
@@ -0,0 +1,226 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/actor_thread_pool.h"
+#include "oneflow/core/common/channel.h"
+#include "nlohmann/json.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <queue>
+
+// Compares running the actors of each stream on a thread of its own with running them on an
+// ActorThreadPool, on a wide pipeline: `width` chains of `depth` streams each, every stream passes
+// the micro-batches it receives on to the next one after `work_ns` of compute. The records are
+// printed as a json array. Configured through the environment:
+//   ONEFLOW_ACTOR_THREAD_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+//   ONEFLOW_ACTOR_THREAD_BENCHMARK_WIDTH: number of chains, 32 by default.
+//   ONEFLOW_ACTOR_THREAD_BENCHMARK_DEPTH: number of streams per chain, 8 by default.
+//   ONEFLOW_ACTOR_THREAD_BENCHMARK_NUM_MICRO_BATCHES: micro-batches per chain, 2000 by default.
+//   ONEFLOW_ACTOR_THREAD_BENCHMARK_POOL_SIZE: workers of the pool, the number of cpus by default.
+
+namespace oneflow {
+
+namespace {
+
+struct PipelineConf {
+  int64_t width;
+  int64_t depth;
+  int64_t micro_batch_num;
+  // Micro-batches of a chain in flight, like the register number of the actors.
+  int64_t in_flight;
+  int64_t work_ns;
+};
+
+void Spin(int64_t ns) {
+  const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < end) {}
+}
+
+class Stream {
+ public:
+  Stream() = default;
+  virtual ~Stream() = default;
+  virtual void Send(int64_t chain_id) = 0;
+};
+
+// The current model, a thread polling a channel per stream.
+class ThreadStream final : public Stream {
+ public:
+  explicit ThreadStream(const std::function<void(int64_t)>& handler) : handler_(handler) {
+    thread_ = std::thread([this]() {
+      int64_t chain_id = 0;
+      while (channel_.Receive(&chain_id) == kChannelStatusSuccess) { handler_(chain_id); }
+    });
+  }
+  ~ThreadStream() override {
+    channel_.Close();
+    thread_.join();
+  }
+
+  void Send(int64_t chain_id) override { channel_.Send(chain_id); }
+
+ private:
+  std::function<void(int64_t)> handler_;
+  Channel<int64_t> channel_;
+  std::thread thread_;
+};
+
+// A strand of the pool scheduled like the pooled actor threads.
+class PooledStream final : public Stream, public ActorThreadPool::Strand {
+ public:
+  PooledStream(ActorThreadPool* pool, const std::function<void(int64_t)>& handler)
+      : pool_(pool), handler_(handler), scheduled_(false) {}
+  ~PooledStream() override = default;
+
+  void Send(int64_t chain_id) override {
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_.push(chain_id);
+      if (!scheduled_) {
+        scheduled_ = true;
+        schedule = true;
+      }
+    }
+    if (schedule) { pool_->Schedule(this); }
+  }
+
+  bool Run() override {
+    for (int i = 0; i < 64; ++i) {
+      int64_t chain_id = 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+          scheduled_ = false;
+          return false;
+        }
+        chain_id = queue_.front();
+        queue_.pop();
+      }
+      handler_(chain_id);
+    }
+    return true;
+  }
+
+ private:
+  ActorThreadPool* pool_;
+  std::function<void(int64_t)> handler_;
+  std::mutex mutex_;
+  std::queue<int64_t> queue_;
+  bool scheduled_;
+};
+
+// Returns the seconds to pass all the micro-batches through the pipeline, the streams run on a
+// pool of `pool_size` workers if it is positive.
+double RunPipeline(const PipelineConf& conf, int64_t pool_size) {
+  std::vector<std::unique_ptr<Stream>> streams(conf.width * conf.depth);
+  std::unique_ptr<ActorThreadPool> pool;
+  if (pool_size > 0) { pool.reset(new ActorThreadPool(pool_size, false)); }
+  std::vector<std::atomic<int64_t>> chain_id2launched(conf.width);
+  std::atomic<int64_t> finished_num(0);
+  std::mutex done_mutex;
+  std::condition_variable done_cond;
+  for (int64_t chain_id = 0; chain_id < conf.width; ++chain_id) {
+    chain_id2launched.at(chain_id) = 0;
+    for (int64_t stage = 0; stage < conf.depth; ++stage) {
+      const int64_t index = chain_id * conf.depth + stage;
+      const auto Handler = [&, index, stage](int64_t chain_id) {
+        Spin(conf.work_ns);
+        if (stage + 1 < conf.depth) {
+          streams.at(index + 1)->Send(chain_id);
+          return;
+        }
+        if (chain_id2launched.at(chain_id).fetch_add(1) < conf.micro_batch_num) {
+          streams.at(index - stage)->Send(chain_id);
+        }
+        if (finished_num.fetch_add(1) + 1 == conf.width * conf.micro_batch_num) {
+          { std::unique_lock<std::mutex> lock(done_mutex); }
+          done_cond.notify_all();
+        }
+      };
+      if (pool) {
+        streams.at(index).reset(new PooledStream(pool.get(), Handler));
+      } else {
+        streams.at(index).reset(new ThreadStream(Handler));
+      }
+    }
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t chain_id = 0; chain_id < conf.width; ++chain_id) {
+    const int64_t in_flight = std::min(conf.in_flight, conf.micro_batch_num);
+    chain_id2launched.at(chain_id) = in_flight;
+    for (int64_t i = 0; i < in_flight; ++i) { streams.at(chain_id * conf.depth)->Send(chain_id); }
+  }
+  {
+    std::unique_lock<std::mutex> lock(done_mutex);
+    const int64_t total_num = conf.width * conf.micro_batch_num;
+    done_cond.wait(lock, [&]() { return finished_num.load() == total_num; });
+  }
+  const auto end = std::chrono::steady_clock::now();
+  // The workers may still be returning from the last runs.
+  pool.reset();
+  streams.clear();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int Main() {
+  PipelineConf conf{};
+  conf.width = ParseIntegerFromEnv("ONEFLOW_ACTOR_THREAD_BENCHMARK_WIDTH", 32);
+  conf.depth = ParseIntegerFromEnv("ONEFLOW_ACTOR_THREAD_BENCHMARK_DEPTH", 8);
+  conf.micro_batch_num =
+      ParseIntegerFromEnv("ONEFLOW_ACTOR_THREAD_BENCHMARK_NUM_MICRO_BATCHES", 2000);
+  conf.in_flight = 2;
+  const int64_t pool_size = ParseIntegerFromEnv("ONEFLOW_ACTOR_THREAD_BENCHMARK_POOL_SIZE",
+                                                std::thread::hardware_concurrency());
+  CHECK_GT(conf.width, 0);
+  CHECK_GT(conf.depth, 0);
+  CHECK_GT(conf.micro_batch_num, 0);
+  CHECK_GT(pool_size, 0);
+
+  std::vector<nlohmann::json> records;
+  for (const int64_t work_ns : {0, 2000, 20000}) {
+    conf.work_ns = work_ns;
+    for (const bool pooled : {false, true}) {
+      const double seconds = RunPipeline(conf, pooled ? pool_size : 0);
+      nlohmann::json record;
+      record["model"] = pooled ? "actor_thread_pool" : "thread_per_stream";
+      record["threads"] = pooled ? pool_size : conf.width * conf.depth;
+      record["width"] = conf.width;
+      record["depth"] = conf.depth;
+      record["micro_batches"] = conf.micro_batch_num;
+      record["work_ns"] = work_ns;
+      record["seconds"] = seconds;
+      record["acts_per_second"] = conf.width * conf.depth * conf.micro_batch_num / seconds;
+      records.emplace_back(std::move(record));
+    }
+  }
+
+  const std::string output = GetStringFromEnv("ONEFLOW_ACTOR_THREAD_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main() { return oneflow::Main(); }
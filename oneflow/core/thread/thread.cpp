@@ -23,7 +23,22 @@ limitations under the License.
 
 namespace oneflow {
 
-Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(stream_id)) {
+namespace {
+
+// Messages a pooled thread processes before it yields the worker to the other threads.
+constexpr int64_t kMaxPooledMsgNumPerRun = 64;
+
+}  // namespace
+
+thread_local const Thread* Thread::running_thread_ = nullptr;
+
+Thread::Thread(const StreamId& stream_id)
+    : thrd_id_(EncodeStreamIdToInt64(stream_id)),
+      pool_(nullptr),
+      pooled_scheduled_(false),
+      pooled_stopped_(false) {
+  const int64_t ring_capacity = ParseIntegerFromEnv("ONEFLOW_THREAD_MSG_CHANNEL_CAPACITY", 0);
+  if (ring_capacity > 0) { ring_msg_channel_.reset(new MpscRingChannel<ActorMsg>(ring_capacity)); }
   local_msg_queue_enabled_ = ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", true);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", true);
   StreamContext* stream_ctx =
@@ -39,10 +54,29 @@ Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(strea
   });
 }
 
+Thread::Thread(const StreamId& stream_id, ActorThreadPool* pool)
+    : thrd_id_(EncodeStreamIdToInt64(stream_id)),
+      pool_(pool),
+      pooled_scheduled_(false),
+      pooled_stopped_(false) {
+  // Streams of other devices have to be set up on the thread running their actors.
+  CHECK(stream_id.device_id().device_type() == DeviceType::kCPU);
+  local_msg_queue_enabled_ = ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", true);
+  light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", true);
+  StreamContext* stream_ctx =
+      NewObj<int, StreamContext, const StreamId&>(stream_id.device_id().device_type(), stream_id);
+  stream_ctx_.reset(stream_ctx);
+}
+
 Thread::~Thread() {
-  actor_thread_.join();
+  if (pool_ != nullptr) {
+    while (!pooled_stopped_.load()) { std::this_thread::yield(); }
+  } else {
+    actor_thread_.join();
+  }
   CHECK(id2task_.empty());
   msg_channel_.Close();
+  if (ring_msg_channel_) { ring_msg_channel_->Close(); }
 }
 
 void Thread::AddTask(const TaskProto& task) {
@@ -53,36 +87,70 @@ void Thread::AddTask(const TaskProto& task) {
 void Thread::PollMsgChannel() {
   while (true) {
     if (local_msg_queue_.empty()) {
-      CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      if (ring_msg_channel_) {
+        CHECK_EQ(ring_msg_channel_->ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      } else {
+        CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      }
     }
     ActorMsg msg = std::move(local_msg_queue_.front());
     local_msg_queue_.pop();
-    if (msg.msg_type() == ActorMsgType::kCmdMsg) {
-      if (msg.actor_cmd() == ActorCmd::kStopThread) {
-        CHECK(id2actor_ptr_.empty());
-        break;
-      } else if (msg.actor_cmd() == ActorCmd::kConstructActor) {
-        ConstructActor(msg.dst_actor_id());
-        continue;
-      } else {
-        // do nothing
+    if (!ProcessActorMsg(msg)) { break; }
+  }
+}
+
+bool Thread::Run() {
+  running_thread_ = this;
+  for (int64_t i = 0; i < kMaxPooledMsgNumPerRun; ++i) {
+    if (local_msg_queue_.empty()) {
+      std::unique_lock<std::mutex> lock(pooled_msg_mutex_);
+      if (pooled_msg_queue_.empty()) {
+        pooled_scheduled_ = false;
+        running_thread_ = nullptr;
+        return false;
       }
+      std::swap(local_msg_queue_, pooled_msg_queue_);
+    }
+    ActorMsg msg = std::move(local_msg_queue_.front());
+    local_msg_queue_.pop();
+    if (!ProcessActorMsg(msg)) {
+      running_thread_ = nullptr;
+      // The thread may be destructed once stopped, it is not scheduled again.
+      pooled_stopped_.store(true);
+      return false;
     }
-    int64_t actor_id = msg.dst_actor_id();
-    auto actor_it = id2actor_ptr_.find(actor_id);
-    CHECK(actor_it != id2actor_ptr_.end());
-    int process_msg_ret = actor_it->second.second->ProcessMsg(msg);
-    if (process_msg_ret == 1) {
-      VLOG(3) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
-      auto job_id_it = id2job_id_.find(actor_id);
-      const int64_t job_id = job_id_it->second;
-      id2job_id_.erase(job_id_it);
-      id2actor_ptr_.erase(actor_it);
-      Global<RuntimeCtx>::Get()->DecreaseCounter(GetRunningActorCountKeyByJobId(job_id));
+  }
+  running_thread_ = nullptr;
+  return true;
+}
+
+bool Thread::ProcessActorMsg(const ActorMsg& msg) {
+  if (msg.msg_type() == ActorMsgType::kCmdMsg) {
+    if (msg.actor_cmd() == ActorCmd::kStopThread) {
+      CHECK(id2actor_ptr_.empty());
+      return false;
+    } else if (msg.actor_cmd() == ActorCmd::kConstructActor) {
+      ConstructActor(msg.dst_actor_id());
+      return true;
     } else {
-      CHECK_EQ(process_msg_ret, 0);
+      // do nothing
     }
   }
+  int64_t actor_id = msg.dst_actor_id();
+  auto actor_it = id2actor_ptr_.find(actor_id);
+  CHECK(actor_it != id2actor_ptr_.end());
+  int process_msg_ret = actor_it->second.second->ProcessMsg(msg);
+  if (process_msg_ret == 1) {
+    VLOG(3) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
+    auto job_id_it = id2job_id_.find(actor_id);
+    const int64_t job_id = job_id_it->second;
+    id2job_id_.erase(job_id_it);
+    id2actor_ptr_.erase(actor_it);
+    Global<RuntimeCtx>::Get()->DecreaseCounter(GetRunningActorCountKeyByJobId(job_id));
+  } else {
+    CHECK_EQ(process_msg_ret, 0);
+  }
+  return true;
 }
 
 void Thread::ConstructActor(int64_t actor_id) {
@@ -18,21 +18,27 @@ limitations under the License.
 
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_ring_channel.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/lazy/actor/actor.h"
 #include "oneflow/core/lazy/actor/actor_context.h"
+#include "oneflow/core/thread/actor_thread_pool.h"
 
 namespace oneflow {
 
 class StreamContext;
 
-class Thread {
+class Thread : public ActorThreadPool::Strand {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Thread);
   explicit Thread(const StreamId& stream_id);
+  // Runs the actors on the workers of `pool` instead of a thread of its own.
+  Thread(const StreamId& stream_id, ActorThreadPool* pool);
   virtual ~Thread();
 
+  bool is_pooled() const { return pool_ != nullptr; }
+
   void AddTask(const TaskProto&);
 
   Channel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
@@ -40,8 +46,10 @@ class Thread {
   inline void EnqueueActorMsg(const ActorMsg& msg) {
     if (UseLocalMsgQueue()) {
       local_msg_queue_.push(msg);
+    } else if (pool_ != nullptr) {
+      EnqueuePooledActorMsg(&msg, &msg + 1);
     } else {
-      msg_channel_.Send(msg);
+      SendToMsgChannel(msg);
     }
   }
 
@@ -49,26 +57,60 @@ class Thread {
   inline void EnqueueActorMsg(InputIt first, InputIt last) {
     if (UseLocalMsgQueue()) {
       for (auto it = first; it != last; ++it) { local_msg_queue_.push(*it); }
+    } else if (pool_ != nullptr) {
+      EnqueuePooledActorMsg(first, last);
     } else {
-      for (auto it = first; it != last; ++it) { msg_channel_.Send(*it); }
+      for (auto it = first; it != last; ++it) { SendToMsgChannel(*it); }
     }
   }
 
  protected:
   void PollMsgChannel();
+  bool Run() override;
 
  private:
   void ConstructActor(int64_t actor_id);
+  // Returns false if the message stops the thread.
+  bool ProcessActorMsg(const ActorMsg& msg);
+
+  template<typename InputIt>
+  void EnqueuePooledActorMsg(InputIt first, InputIt last) {
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> lock(pooled_msg_mutex_);
+      for (auto it = first; it != last; ++it) { pooled_msg_queue_.push(*it); }
+      if (!pooled_scheduled_) {
+        pooled_scheduled_ = true;
+        schedule = true;
+      }
+    }
+    if (schedule) { pool_->Schedule(this); }
+  }
+
+  inline void SendToMsgChannel(const ActorMsg& msg) {
+    if (ring_msg_channel_) {
+      ring_msg_channel_->Send(msg);
+    } else {
+      msg_channel_.Send(msg);
+    }
+  }
 
   inline bool UseLocalMsgQueue() const {
-    return local_msg_queue_enabled_ && std::this_thread::get_id() == actor_thread_.get_id();
+    if (!local_msg_queue_enabled_) { return false; }
+    if (pool_ != nullptr) { return running_thread_ == this; }
+    return std::this_thread::get_id() == actor_thread_.get_id();
   }
 
+  // The pooled thread run by the current worker.
+  static thread_local const Thread* running_thread_;
+
   HashMap<int64_t, TaskProto> id2task_;
   std::mutex id2task_mtx_;
 
   std::thread actor_thread_;
   Channel<ActorMsg> msg_channel_;
+  // Replaces msg_channel_ when ONEFLOW_THREAD_MSG_CHANNEL_CAPACITY is positive.
+  std::unique_ptr<MpscRingChannel<ActorMsg>> ring_msg_channel_;
   HashMap<int64_t, std::pair<std::unique_ptr<ActorContext>, std::unique_ptr<ActorBase>>>
       id2actor_ptr_;
   HashMap<int64_t, int64_t> id2job_id_;
@@ -77,6 +119,12 @@ class Thread {
   int64_t thrd_id_;
   bool light_actor_enabled_;
   std::unique_ptr<StreamContext> stream_ctx_;
+
+  ActorThreadPool* pool_;
+  std::mutex pooled_msg_mutex_;
+  std::queue<ActorMsg> pooled_msg_queue_;
+  bool pooled_scheduled_;
+  std::atomic<bool> pooled_stopped_;
 };
 
 }  // namespace oneflow
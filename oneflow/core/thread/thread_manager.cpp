@@ -21,10 +21,20 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// Actors which may block the thread running them are not run by the actor thread pool.
+bool IsBlockingTaskType(TaskType task_type) {
+  return task_type == TaskType::kWaitAndSendIds || task_type == TaskType::kCriticalSectionWaitTick
+         || task_type == TaskType::kForeignInput || task_type == TaskType::kForeignOutput;
+}
+
+}  // namespace
+
 ThreadMgr::~ThreadMgr() {
   for (auto& thread_pair : threads_) {
     ActorMsg msg = ActorMsg::BuildCommandMsg(-1, ActorCmd::kStopThread);
-    thread_pair.second->GetMsgChannelPtr()->Send(msg);
+    thread_pair.second->EnqueueActorMsg(msg);
     thread_pair.second.reset();
     VLOG(3) << "actor thread " << thread_pair.first << " finish";
   }
@@ -38,13 +48,37 @@ Thread* ThreadMgr::GetThrd(int64_t thrd_id) {
 
 void ThreadMgr::AddPlan(const Plan& plan) {
   const int64_t this_rank = GlobalProcessCtx::Rank();
+  const int64_t pool_size = ParseIntegerFromEnv("ONEFLOW_ACTOR_THREAD_POOL_SIZE", 0);
+  if (pool_size > 0 && !actor_thread_pool_) {
+    actor_thread_pool_.reset(new ActorThreadPool(
+        pool_size, ParseBooleanFromEnv("ONEFLOW_ACTOR_THREAD_POOL_NUMA_AFFINITY", true)));
+  }
+  HashSet<int64_t> blocking_thrd_ids;
+  for (const TaskProto& task : plan.task()) {
+    if (!IsBlockingTaskType(task.task_type())) { continue; }
+    const StreamId stream_id = DecodeTaskIdFromInt64(task.task_id()).stream_id();
+    blocking_thrd_ids.insert(EncodeStreamIdToInt64(stream_id));
+  }
   for (const TaskProto& task : plan.task()) {
     TaskId task_id = DecodeTaskIdFromInt64(task.task_id());
     StreamId stream_id = task_id.stream_id();
     if (stream_id.rank() != this_rank) { continue; }
     int64_t thrd_id = EncodeStreamIdToInt64(stream_id);
-    if (threads_.find(thrd_id) != threads_.end()) { continue; }
-    Thread* thread = new Thread(stream_id);
+    const bool blocking = blocking_thrd_ids.count(thrd_id) > 0;
+    auto it = threads_.find(thrd_id);
+    if (it != threads_.end()) {
+      CHECK(!(blocking && it->second->is_pooled()))
+          << "blocking actors are added to pooled actor thread " << thrd_id;
+      continue;
+    }
+    Thread* thread = nullptr;
+    if (actor_thread_pool_ && stream_id.device_id().device_type() == DeviceType::kCPU
+        && !blocking) {
+      thread = new Thread(stream_id, actor_thread_pool_.get());
+    } else {
+      // Device streams stay on threads of their own to keep their execution contexts.
+      thread = new Thread(stream_id);
+    }
     CHECK_NOTNULL(thread);
     threads_[thrd_id].reset(thread);
   }
@@ -24,6 +24,7 @@ limitations under the License.
 #include "oneflow/core/common/cpp_attribute.h"
 #include "oneflow/core/thread/thread.h"
 #include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/thread/actor_thread_pool.h"
 #include "oneflow/core/platform/include/pthread_fork.h"
 
 namespace oneflow {
@@ -42,6 +43,8 @@ class ThreadMgr final {
  private:
   friend class Global<ThreadMgr>;
 
+  // Runs the actors of cpu streams if ONEFLOW_ACTOR_THREAD_POOL_SIZE is positive.
+  std::unique_ptr<ActorThreadPool> actor_thread_pool_;
   HashMap<int64_t, std::unique_ptr<Thread>> threads_;
 };
 
@@ -20,19 +20,33 @@ limitations under the License.
 
 namespace oneflow {
 
-Transport::Transport() {
+namespace {
+
+constexpr int64_t kDefaultChunkSize = 16 * 1024 * 1024;
+constexpr int64_t kDefaultNumReadStreams = 4;
+
+}  // namespace
+
+Transport::Transport() : read_id_cnt_(0) {
   comm_net_ = Global<EpollCommNet>::Get();
   this_machine_id_ = GlobalProcessCtx::Rank();
   CHECK(comm_net_ != nullptr);
-  // maybe need new read id for each dst machine id, maybe need 2 * machine num read ids
-  read_id_ = comm_net_->NewActorReadId();
+  const int64_t chunk_size = ParseIntegerFromEnv("ONEFLOW_TRANSPORT_CHUNK_SIZE", kDefaultChunkSize);
+  CHECK_GT(chunk_size, 0);
+  chunk_size_ = chunk_size;
+  const int64_t num_read_streams =
+      ParseIntegerFromEnv("ONEFLOW_TRANSPORT_NUM_READ_STREAMS", kDefaultNumReadStreams);
+  CHECK_GT(num_read_streams, 0);
+  for (int64_t i = 0; i < num_read_streams; ++i) {
+    read_ids_.push_back(comm_net_->NewActorReadId());
+  }
   msg_poller_ = std::thread([this]() { PollMsgChannel(); });
 }
 
 Transport::~Transport() {
   msg_channel_.Close();
   msg_poller_.join();
-  comm_net_->DeleteActorReadId(read_id_);
+  for (void* read_id : read_ids_) { comm_net_->DeleteActorReadId(read_id); }
 }
 
 void Transport::EnqueueTransportMsg(const TransportMsg& msg) {
@@ -68,6 +82,8 @@ void Transport::HandlerAchievedTransportSendMsgFromSrcMachine(const TransportMsg
   CHECK_EQ(msg.type, TransportMsgType::kSend);
   CHECK(msg.src_mem_token != nullptr);
   CHECK(msg.dst_mem_token == nullptr);
+  CHECK_GE(msg.chunk_index, 0);
+  CHECK_LT(msg.chunk_index, msg.num_chunks);
   uint64_t token = msg.token;
   CHECK(token != -1);
 
@@ -81,12 +97,15 @@ void Transport::HandlerAchievedTransportSendMsgFromSrcMachine(const TransportMsg
   //
   // In either case, the earlier one is responsible for creating the TransportStatus, and the later
   // one is responsible for checking the TransportStatus and then calling the DoRead() operation.
+  //
+  // A chunked Send arrives as one msg per chunk, the send is ready only after the last of them.
 
   // prepare transport status for this token.
   // store callback.
   TransportStatus* stat = nullptr;
 
-  // if recv_before_send is true, it means the Receive() method has been called before this handler
+  // if recv_before_send is true, it means the Receive() method has been called before the msgs of
+  // all chunks are handled
   bool recv_before_send = false;
   {
     std::unique_lock<std::mutex> lock(status_mutex_);
@@ -102,16 +121,29 @@ void Transport::HandlerAchievedTransportSendMsgFromSrcMachine(const TransportMsg
       stat->src_machine_id = msg.src_machine_id;
       stat->dst_machine_id = msg.dst_machine_id;
     } else {
-      recv_before_send = true;
       stat = &(it->second);
-      CHECK_GE(stat->size, msg.size);  // NOTE(chengcheng): Recv size may larger than Send size.
-      stat->size = msg.size;           // NOTE(chengcheng): msg.size always is smaller one.
+      if (stat->chunks.empty()) {
+        // NOTE(chengcheng): Recv size may larger than Send size.
+        CHECK_GE(stat->size, msg.size);
+        stat->size = msg.size;  // NOTE(chengcheng): msg.size always is smaller one.
+      } else {
+        CHECK_EQ(stat->size, msg.size);
+      }
     }
+    if (stat->chunks.empty()) { stat->chunks.resize(msg.num_chunks); }
+    CHECK_EQ(stat->chunks.size(), msg.num_chunks);
 
-    stat->is_send_ready = true;
-    CHECK(stat->src_mem_token == nullptr);
+    TransportChunk* chunk = &stat->chunks.at(msg.chunk_index);
+    CHECK(chunk->src_mem_token == nullptr);
     // src_mem_token MUST init in the block protected by lock
-    stat->src_mem_token = msg.src_mem_token;
+    chunk->offset = msg.chunk_offset;
+    chunk->size = msg.chunk_size;
+    chunk->src_mem_token = msg.src_mem_token;
+    stat->num_arrived_chunks += 1;
+    if (stat->num_arrived_chunks == stat->chunks.size()) {
+      stat->is_send_ready = true;
+      recv_before_send = stat->is_recv_ready;
+    }
   }
 
   if (recv_before_send) {
@@ -134,6 +166,7 @@ void Transport::HandlerAchievedTransportAckMsgFromDstMachine(const TransportMsg&
   uint64_t token = msg.token;
   CHECK(token != -1);
   std::function<void()> callback;
+  std::vector<TransportChunk> chunks;
 
   // get status from map
   {
@@ -143,20 +176,22 @@ void Transport::HandlerAchievedTransportAckMsgFromDstMachine(const TransportMsg&
     TransportStatus* stat = &(it->second);
 
     // check msg == stat
-    CHECK_EQ(stat->src_mem_token, msg.src_mem_token);
+    CHECK(!stat->chunks.empty());
+    CHECK_EQ(stat->chunks.front().src_mem_token, msg.src_mem_token);
     CHECK_EQ(stat->size, msg.size);
     CHECK_EQ(stat->src_machine_id, msg.src_machine_id);
     CHECK_EQ(stat->dst_machine_id, msg.dst_machine_id);
     CHECK(stat->callback != nullptr);
 
     callback = stat->callback;
+    chunks.swap(stat->chunks);
 
     // Recovery status
     token2status_.erase(it);
   }
 
   // UnRegisterMemory
-  comm_net_->UnRegisterMemory(msg.src_mem_token);
+  for (const TransportChunk& chunk : chunks) { comm_net_->UnRegisterMemory(chunk.src_mem_token); }
 
   // Do Send callback
   callback();
@@ -185,29 +220,49 @@ void Transport::Send(uint64_t token, int64_t dst_machine_id, const void* ptr, st
   stat->callback = callback;
   stat->is_send_ready = true;
   stat->is_recv_ready = false;
-  stat->src_mem_token = comm_net_->RegisterMemory(mut_ptr, size);
-  stat->dst_mem_token = nullptr;
+  const int64_t num_chunks = std::max<int64_t>(RoundUp(size, chunk_size_) / chunk_size_, 1);
+  stat->chunks.resize(num_chunks);
+  for (int64_t i = 0; i < num_chunks; ++i) {
+    TransportChunk* chunk = &stat->chunks.at(i);
+    chunk->offset = i * chunk_size_;
+    chunk->size = std::min(size - chunk->offset, chunk_size_);
+    chunk->src_mem_token =
+        comm_net_->RegisterMemory(static_cast<char*>(mut_ptr) + chunk->offset, chunk->size);
+  }
   stat->size = size;
   stat->src_machine_id = this_machine_id_;
   stat->dst_machine_id = dst_machine_id;
 
-  // Send msg to dst machine
-  TransportMsg msg;
-  msg.token = token;
-  msg.src_machine_id = stat->src_machine_id;
-  msg.dst_machine_id = stat->dst_machine_id;
-  msg.size = size;
-  msg.src_mem_token = stat->src_mem_token;
-  msg.dst_mem_token = stat->dst_mem_token;
-  msg.type = TransportMsgType::kSend;
-  comm_net_->SendTransportMsg(msg.dst_machine_id, msg);
+  // Send msgs to dst machine, one for each chunk
+  for (int64_t i = 0; i < num_chunks; ++i) {
+    const TransportChunk& chunk = stat->chunks.at(i);
+    TransportMsg msg;
+    msg.token = token;
+    msg.src_machine_id = stat->src_machine_id;
+    msg.dst_machine_id = stat->dst_machine_id;
+    msg.size = size;
+    msg.chunk_offset = chunk.offset;
+    msg.chunk_size = chunk.size;
+    msg.chunk_index = i;
+    msg.num_chunks = num_chunks;
+    msg.src_mem_token = chunk.src_mem_token;
+    msg.dst_mem_token = nullptr;
+    msg.type = TransportMsgType::kSend;
+    comm_net_->SendTransportMsg(msg.dst_machine_id, msg);
+  }
+}
+
+void Transport::Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::size_t max_size,
+                        std::function<void()> callback) {
+  Receive(token, src_machine_id, ptr, max_size, nullptr, std::move(callback));
 }
 
 void Transport::Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::size_t max_size,
+                        std::function<void(std::size_t, std::size_t)> chunk_callback,
                         std::function<void()> callback) {
   // handler for receive from local machine
   if (src_machine_id == this_machine_id_) {
-    RecvFromLocalMachine(token, ptr, max_size, callback);
+    RecvFromLocalMachine(token, ptr, max_size, chunk_callback, callback);
     return;
   }
 
@@ -215,7 +270,8 @@ void Transport::Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::
   // store callback.
   TransportStatus* stat = nullptr;
 
-  // if recv_before_send is true, it means the SendMsg has been handled before this Receive called.
+  // if send_before_recv is true, it means the SendMsgs of all chunks have been handled before this
+  // Receive called.
   bool send_before_recv = false;
   {
     std::unique_lock<std::mutex> lock(status_mutex_);
@@ -231,11 +287,12 @@ void Transport::Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::
       stat->src_machine_id = src_machine_id;
       stat->dst_machine_id = this_machine_id_;
     } else {
-      send_before_recv = true;
       stat = &(it->second);
+      send_before_recv = stat->is_send_ready;
     }
 
     stat->callback = callback;
+    stat->chunk_callback = chunk_callback;
     stat->is_recv_ready = true;
     // NOTE(chengcheng): Store dst_ptr so that we can create dst_mem_token in DoRead()
     stat->dst_ptr = ptr;
@@ -263,44 +320,71 @@ void Transport::DoRead(uint64_t token) {
     stat = &(it->second);
 
     // dst_mem_token MUST init in the block protected by lock
-    CHECK(stat->dst_mem_token == nullptr);
     // NOTE(chengcheng): ONLY at this time, the stat->size is the real size assigned by Send
-    stat->dst_mem_token = comm_net_->RegisterMemory(stat->dst_ptr, stat->size);
+    for (TransportChunk& chunk : stat->chunks) {
+      CHECK(chunk.dst_mem_token == nullptr);
+      CHECK_LE(chunk.offset + chunk.size, stat->size);
+      chunk.dst_mem_token =
+          comm_net_->RegisterMemory(static_cast<char*>(stat->dst_ptr) + chunk.offset, chunk.size);
+    }
+    stat->num_unfinished_chunks = stat->chunks.size();
   }
   CHECK(stat->is_send_ready && stat->is_recv_ready);
-  CHECK(stat->src_mem_token != nullptr);
-  CHECK(stat->dst_mem_token != nullptr);
+  CHECK(!stat->chunks.empty());
   CHECK(stat->src_machine_id != -1);
   CHECK(stat->dst_machine_id != -1);
   CHECK(stat->size != -1);
   CHECK(stat->callback);
-  comm_net_->Read(read_id_, stat->src_machine_id, stat->src_mem_token, stat->dst_mem_token);
-  comm_net_->AddReadCallBack(read_id_, [stat, this]() {
-    // Send ack message to source machine
-    TransportMsg msg;
-    msg.token = stat->token;
-    msg.src_machine_id = stat->src_machine_id;
-    msg.dst_machine_id = stat->dst_machine_id;
-    msg.size = stat->size;
-    msg.src_mem_token = stat->src_mem_token;
-    msg.dst_mem_token = stat->dst_mem_token;
-    msg.type = TransportMsgType::kAck;
-    comm_net_->SendTransportMsg(msg.src_machine_id, msg);
-
-    // UnRegisterMemory
-    comm_net_->UnRegisterMemory(msg.dst_mem_token);
+  for (int64_t i = 0; i < stat->chunks.size(); ++i) {
+    const TransportChunk& chunk = stat->chunks.at(i);
+    CHECK(chunk.src_mem_token != nullptr);
+    CHECK(chunk.dst_mem_token != nullptr);
+    void* read_id = NextReadId();
+    comm_net_->Read(read_id, stat->src_machine_id, chunk.src_mem_token, chunk.dst_mem_token);
+    comm_net_->AddReadCallBack(read_id, [stat, i, this]() {
+      const TransportChunk& done_chunk = stat->chunks.at(i);
+      if (stat->chunk_callback) { stat->chunk_callback(done_chunk.offset, done_chunk.size); }
+
+      // UnRegisterMemory
+      comm_net_->UnRegisterMemory(done_chunk.dst_mem_token);
+
+      {
+        std::unique_lock<std::mutex> lock(status_mutex_);
+        stat->num_unfinished_chunks -= 1;
+        if (stat->num_unfinished_chunks > 0) { return; }
+      }
 
-    // Do Receive callback
-    stat->callback();
+      // Send ack message to source machine
+      TransportMsg msg;
+      msg.token = stat->token;
+      msg.src_machine_id = stat->src_machine_id;
+      msg.dst_machine_id = stat->dst_machine_id;
+      msg.size = stat->size;
+      msg.chunk_offset = 0;
+      msg.chunk_size = 0;
+      msg.chunk_index = 0;
+      msg.num_chunks = stat->chunks.size();
+      msg.src_mem_token = stat->chunks.front().src_mem_token;
+      msg.dst_mem_token = stat->chunks.front().dst_mem_token;
+      msg.type = TransportMsgType::kAck;
+      comm_net_->SendTransportMsg(msg.src_machine_id, msg);
+
+      // Do Receive callback
+      stat->callback();
+
+      // Recovery status
+      {
+        std::unique_lock<std::mutex> lock(status_mutex_);
+        auto it = token2status_.find(stat->token);
+        CHECK(it != token2status_.end());
+        token2status_.erase(it);
+      }
+    });
+  }
+}
 
-    // Recovery status
-    {
-      std::unique_lock<std::mutex> lock(status_mutex_);
-      auto it = token2status_.find(stat->token);
-      CHECK(it != token2status_.end());
-      token2status_.erase(it);
-    }
-  });
+void* Transport::NextReadId() {
+  return read_ids_.at(read_id_cnt_.fetch_add(1, std::memory_order_relaxed) % read_ids_.size());
 }
 
 void Transport::SendToLocalMachine(uint64_t token, void* ptr, std::size_t size,
@@ -308,16 +392,19 @@ void Transport::SendToLocalMachine(uint64_t token, void* ptr, std::size_t size,
   bool need_do_copy = false;
   bool need_do_callback = false;
   std::function<void()> receive_callback;
+  std::function<void(std::size_t, std::size_t)> receive_chunk_callback;
   void* dst_ptr = nullptr;
   {
     std::unique_lock<std::mutex> lock(local_copy_lock_);
     auto it = token2local_copy_status_.find(token);
     if (it == token2local_copy_status_.end()) {
       // init local copy status
-      token2local_copy_status_.emplace(token, CopyStatusOnLocalMachine(token, ptr, size, callback));
+      token2local_copy_status_.emplace(
+          token, CopyStatusOnLocalMachine(token, ptr, size, callback, nullptr));
     } else {
       need_do_callback = true;
       receive_callback = std::move(it->second.callback);
+      receive_chunk_callback = std::move(it->second.chunk_callback);
 
       dst_ptr = it->second.ptr;
       CHECK(size <= it->second.size);  // NOTE(chengcheng): Recv size may larger than Send size.
@@ -333,11 +420,13 @@ void Transport::SendToLocalMachine(uint64_t token, void* ptr, std::size_t size,
 
   if (need_do_callback) {
     callback();
+    if (receive_chunk_callback) { receive_chunk_callback(0, size); }
     receive_callback();
   }
 }
 
 void Transport::RecvFromLocalMachine(uint64_t token, void* ptr, std::size_t max_size,
+                                     std::function<void(std::size_t, std::size_t)> chunk_callback,
                                      std::function<void()> callback) {
   bool need_do_copy = false;
   bool need_do_callback = false;
@@ -349,8 +438,8 @@ void Transport::RecvFromLocalMachine(uint64_t token, void* ptr, std::size_t max_
     auto it = token2local_copy_status_.find(token);
     if (it == token2local_copy_status_.end()) {
       // init local copy status
-      token2local_copy_status_.emplace(token,
-                                       CopyStatusOnLocalMachine(token, ptr, max_size, callback));
+      token2local_copy_status_.emplace(
+          token, CopyStatusOnLocalMachine(token, ptr, max_size, callback, chunk_callback));
     } else {
       need_do_callback = true;
       send_callback = std::move(it->second.callback);
@@ -369,6 +458,7 @@ void Transport::RecvFromLocalMachine(uint64_t token, void* ptr, std::size_t max_
   if (need_do_copy) { memcpy(ptr, src_ptr, size); }
 
   if (need_do_callback) {
+    if (chunk_callback) { chunk_callback(0, size); }
     callback();
     send_callback();
   }
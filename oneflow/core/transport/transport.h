@@ -44,6 +44,12 @@ namespace oneflow {
 //
 // Transport supports send and receive data on local machine.
 //
+// A buffer larger than ONEFLOW_TRANSPORT_CHUNK_SIZE is split into chunks which are read over
+// ONEFLOW_TRANSPORT_NUM_READ_STREAMS concurrent CommNet read streams. Receive() accepts an optional
+// chunk_callback(offset, size) called as soon as each chunk has landed, so the receiver can consume
+// chunk i while chunk i + 1 is still on the wire. Chunks may complete out of order, and
+// chunk_callback runs on the CommNet callback thread, so it should hand heavy work off.
+//
 class Transport {
  public:
   OF_DISALLOW_COPY_AND_MOVE(Transport);
@@ -53,6 +59,9 @@ class Transport {
             std::function<void()> callback);
   void Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::size_t max_size,
                std::function<void()> callback);
+  void Receive(uint64_t token, int64_t src_machine_id, void* ptr, std::size_t max_size,
+               std::function<void(std::size_t, std::size_t)> chunk_callback,
+               std::function<void()> callback);
   void EnqueueTransportMsg(const TransportMsg& msg);
 
  private:
@@ -60,9 +69,11 @@ class Transport {
   void HandlerAchievedTransportSendMsgFromSrcMachine(const TransportMsg& msg);
   void HandlerAchievedTransportAckMsgFromDstMachine(const TransportMsg& msg);
   void DoRead(uint64_t token);
+  void* NextReadId();
   void SendToLocalMachine(uint64_t token, void* ptr, std::size_t size,
                           std::function<void()> callback);
   void RecvFromLocalMachine(uint64_t token, void* ptr, std::size_t max_size,
+                            std::function<void(std::size_t, std::size_t)> chunk_callback,
                             std::function<void()> callback);
 
   // TODO(chengcheng)
@@ -77,13 +88,25 @@ class Transport {
   //
   // In the process of one transmission between two machines, the TransportStatus will be created,
   // changed and finally deleted by sending and receiving messages for many times.
+  //
+  // The buffer is transferred in chunks, each with its own pair of mem tokens. At the receiver,
+  // is_send_ready becomes true once the Send msgs of all chunks have arrived.
+  struct TransportChunk {
+    std::size_t offset;
+    std::size_t size;
+    void* src_mem_token;
+    void* dst_mem_token;
+    TransportChunk() : offset(0), size(0), src_mem_token(nullptr), dst_mem_token(nullptr) {}
+  };
   struct TransportStatus {
     const uint64_t token;
     std::function<void()> callback;
+    std::function<void(std::size_t, std::size_t)> chunk_callback;
     bool is_send_ready;
     bool is_recv_ready;
-    void* src_mem_token;
-    void* dst_mem_token;
+    std::vector<TransportChunk> chunks;
+    int64_t num_arrived_chunks;
+    int64_t num_unfinished_chunks;
     // NOTE(chengcheng): must store dst_ptr in status when Receive max_size > Send size
     void* dst_ptr;
     std::size_t size;
@@ -92,10 +115,12 @@ class Transport {
     TransportStatus(uint64_t tk)
         : token(tk),
           callback(nullptr),
+          chunk_callback(nullptr),
           is_send_ready(false),
           is_recv_ready(false),
-          src_mem_token(nullptr),
-          dst_mem_token(nullptr),
+          num_arrived_chunks(0),
+          num_unfinished_chunks(0),
+          dst_ptr(nullptr),
           size(-1),
           src_machine_id(-1),
           dst_machine_id(-1) {}
@@ -115,8 +140,15 @@ class Transport {
     void* ptr;
     std::size_t size;
     std::function<void()> callback;
-    CopyStatusOnLocalMachine(uint64_t tk, void* p, std::size_t s, std::function<void()> cb)
-        : token(tk), ptr(p), size(s), callback(std::move(cb)) {}
+    // Only set by the receiver.
+    std::function<void(std::size_t, std::size_t)> chunk_callback;
+    CopyStatusOnLocalMachine(uint64_t tk, void* p, std::size_t s, std::function<void()> cb,
+                             std::function<void(std::size_t, std::size_t)> chunk_cb)
+        : token(tk),
+          ptr(p),
+          size(s),
+          callback(std::move(cb)),
+          chunk_callback(std::move(chunk_cb)) {}
   };
 
   // Store the TransportStatus for each token (Send/Receive pair).
@@ -129,7 +161,10 @@ class Transport {
   HashMap<uint64_t, CopyStatusOnLocalMachine> token2local_copy_status_;
 
   int64_t this_machine_id_;
-  void* read_id_;
+  std::size_t chunk_size_;
+  // Reads on one read id are serialized by CommNet, chunks are spread over all of them.
+  std::vector<void*> read_ids_;
+  std::atomic<uint64_t> read_id_cnt_;
   EpollCommNet* comm_net_;
 
   Channel<TransportMsg> msg_channel_;
@@ -29,11 +29,17 @@ enum class TransportMsgType {
   kAck = 2,   // this token transmission task is down
 };
 
+// A buffer larger than the chunk size is sent as several kSend msgs, one per chunk, each carrying
+// the mem token of its chunk. size is always the size of the whole buffer.
 struct TransportMsg {
   uint64_t token;
   void* src_mem_token;
   void* dst_mem_token;
   std::size_t size;
+  std::size_t chunk_offset;
+  std::size_t chunk_size;
+  int64_t chunk_index;
+  int64_t num_chunks;
   int64_t src_machine_id;
   int64_t dst_machine_id;
   TransportMsgType type;
@@ -17,16 +17,51 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_ALLOCATOR_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace oneflow {
 namespace vm {
 
+struct AllocatorStats {
+  // Bytes obtained from the device or the host, including cached free memory.
+  std::size_t reserved_bytes = 0;
+  // Bytes handed out by Allocate() and not deallocated yet.
+  std::size_t allocated_bytes = 0;
+  // Max allocated_bytes since construction or the last ResetPeakStats().
+  std::size_t peak_allocated_bytes = 0;
+  std::size_t largest_free_piece_bytes = 0;
+  // Number of cached free pieces of each bin, bin i of a caching allocator holds pieces of at
+  // least (min piece size << i) bytes. Empty if the allocator caches nothing.
+  std::vector<int64_t> num_free_pieces_per_bin;
+  // Number of times cached memory was returned to the device to satisfy an allocation.
+  int64_t num_gc = 0;
+  // Part of allocated_bytes in CUDA unified memory, which the driver pages between the device
+  // and the host.
+  std::size_t managed_bytes = 0;
+};
+
 class Allocator {
  public:
   virtual ~Allocator() = default;
 
   virtual void Allocate(char** mem_ptr, std::size_t size) = 0;
   virtual void Deallocate(char* mem_ptr, std::size_t size) = 0;
+  // Like Allocate, but returns false instead of failing when the memory runs out.
+  virtual bool TryAllocate(char** mem_ptr, std::size_t size) {
+    Allocate(mem_ptr, size);
+    return true;
+  }
+
+  // Allocators not tracking these report zeros.
+  virtual void GetStats(AllocatorStats* stats) { *stats = AllocatorStats(); }
+  virtual void ResetPeakStats() {}
+
+  // The VM calls HintAccess before an instruction on the stream of this allocator accesses
+  // [mem_ptr, mem_ptr + size), `write` tells whether it writes the memory. The memory may belong
+  // to another allocator. Only allocators returning true from NeedsAccessHints get the calls.
+  virtual bool NeedsAccessHints() const { return false; }
+  virtual void HintAccess(const char* mem_ptr, std::size_t size, bool write) {}
 
  protected:
   Allocator() = default;
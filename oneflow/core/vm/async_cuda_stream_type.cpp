@@ -27,7 +27,12 @@ namespace vm {
 
 void AsyncCudaStreamType::InitDeviceCtx(std::unique_ptr<DeviceCtx>* device_ctx,
                                         Stream* stream) const {
-  device_ctx->reset(new CudaStreamHandleDeviceCtx(stream->device_id()));
+  // The eager collectives launched here gate the compute of the other ranks, so by default their
+  // kernels are scheduled ahead of the compute kernels queued on the same device.
+  const bool high_priority = ParseBooleanFromEnv("ONEFLOW_EAGER_NCCL_STREAM_HIGH_PRIORITY", true);
+  device_ctx->reset(new CudaStreamHandleDeviceCtx(
+      stream->device_id(),
+      high_priority ? ep::StreamPriority::kHigh : ep::StreamPriority::kNormal));
 }
 
 void AsyncCudaStreamType::InitInstructionStatus(const Stream& stream,
@@ -72,7 +77,7 @@ intrusive::shared_ptr<StreamDesc> AsyncCudaStreamType::MakeStreamDesc(
   auto ret = intrusive::make_shared<StreamDesc>();
   ret->set_stream_type(StaticGlobalStreamType<AsyncCudaStreamType>());
   ret->set_num_streams_per_machine(device_num);
-  ret->set_num_streams_per_thread(device_num);
+  ret->set_num_streams_per_thread(NumCudaStreamsPerThread(device_num));
   return ret;
 }
 
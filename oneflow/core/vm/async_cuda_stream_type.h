@@ -45,8 +45,9 @@ class AsyncCudaStreamType final : public StreamType {
   void Compute(Instruction* instruction) const override;
   intrusive::shared_ptr<StreamDesc> MakeStreamDesc(const Resource& resource,
                                                    int64_t this_machine_id) const override;
-  bool OnSchedulerThread() const override { return true; }
+  bool OnSchedulerThread() const override { return !CudaStreamsOnWorkerThreads(); }
   bool SupportingTransportInstructions() const override { return true; }
+  bool CompletesInOrder() const override { return true; }
 };
 
 }  // namespace vm
@@ -22,9 +22,25 @@ namespace vm {
 
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
   *mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size));
+  const std::size_t allocated_bytes = allocated_bytes_.fetch_add(size) + size;
+  std::size_t peak_allocated_bytes = peak_allocated_bytes_.load();
+  while (peak_allocated_bytes < allocated_bytes
+         && !peak_allocated_bytes_.compare_exchange_weak(peak_allocated_bytes, allocated_bytes)) {}
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  std::free(mem_ptr);
+  allocated_bytes_.fetch_sub(size);
+}
+
+void CpuAllocator::GetStats(AllocatorStats* stats) {
+  *stats = AllocatorStats();
+  stats->allocated_bytes = allocated_bytes_.load();
+  stats->reserved_bytes = stats->allocated_bytes;
+  stats->peak_allocated_bytes = peak_allocated_bytes_.load();
+}
+
+void CpuAllocator::ResetPeakStats() { peak_allocated_bytes_.store(allocated_bytes_.load()); }
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
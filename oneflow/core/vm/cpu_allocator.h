@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 
 #include <cstdint>
+#include <atomic>
 #include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
@@ -24,11 +25,18 @@ namespace vm {
 
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
+  explicit CpuAllocator() : allocated_bytes_(0), peak_allocated_bytes_(0) {}
   ~CpuAllocator() override = default;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+  // Nothing is cached, so reserved bytes are the allocated ones.
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
+
+ private:
+  std::atomic<std::size_t> allocated_bytes_;
+  std::atomic<std::size_t> peak_allocated_bytes_;
 };
 
 }  // namespace vm
@@ -18,6 +18,9 @@ limitations under the License.
 
 #include "oneflow/core/vm/cuda_allocator.h"
 #include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/common/cpp_attribute.h"
+#include "oneflow/core/profiler/memory_trace.h"
+#include <fstream>
 #include <iostream>
 
 namespace oneflow {
@@ -31,10 +34,47 @@ inline bool IsAlignedSize(size_t size) { return size % kCudaMemAllocAlignSize ==
 
 static const size_t kPieceSplitThreshold = 128 << 20;  // 128MiB
 
+// Bytes to reserve from the device when no free Piece fits `aligned_size`.
+size_t ExtendBytes4AlignedSize(size_t aligned_size) {
+  size_t allocate_bytes = aligned_size;
+  if (allocate_bytes < 1048576) {
+    // Allocate 2MB if `allocate_bytes` is less than 1MB
+    allocate_bytes = 2097152;
+  } else if (allocate_bytes < 10485760) {
+    // Allocate 20MB if `allocate_bytes` is between 1MB and 10MB
+    allocate_bytes = 20971520;
+  } else {
+    // Round up to 2MB if `allocate_bytes` is larger than 10MB
+    allocate_bytes = RoundUp(allocate_bytes, 2097152);
+  }
+  return CudaMemAlignedBytes(allocate_bytes);
+}
+
+// Device memory left unallocated, at least 50MiB.
+size_t AvailableDeviceBytes(int64_t device_id) {
+  cudaSetDevice(device_id);
+  size_t free_bytes = -1;
+  size_t total_bytes = -1;
+  OF_CUDA_CHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
+  const size_t remain_bytes = 50 * 1048576;
+  return free_bytes > remain_bytes ? free_bytes - remain_bytes : 0;
+}
+
 }  // namespace
 
 CudaAllocator::CudaAllocator(int64_t device_id)
-    : Allocator(), device_id_(device_id), total_memory_bytes_(0), recycle_piece_list_(nullptr) {
+    : CudaAllocator(device_id,
+                    ParseBooleanFromEnv("ONEFLOW_VM_CUDA_ALLOCATOR_EXPANDABLE_SEGMENTS", false)) {}
+
+CudaAllocator::CudaAllocator(int64_t device_id, bool expandable_segment)
+    : Allocator(),
+      device_id_(device_id),
+      total_memory_bytes_(0),
+      allocated_memory_bytes_(0),
+      peak_allocated_memory_bytes_(0),
+      num_gc_(0),
+      recycle_piece_list_(nullptr),
+      stream_use_seq_(0) {
   bins_.resize(kBinNumSize);
   for (int i = 0; i < kBinNumSize; ++i) {
     size_t bin_size = BinSize4BinNum(i);
@@ -44,13 +84,33 @@ CudaAllocator::CudaAllocator(int64_t device_id)
     CHECK_EQ(BinNum4BinSize(bin_size * 2 - 1), i);
     CHECK_EQ(BinNum4BinSize(bin_size * 2), i == (kBinNumSize - 1) ? i : i + 1);
   }
+  if (expandable_segment) {
+    if (CudaExpandableSegment::IsSupported(device_id_)) {
+      CudaCurrentDeviceGuard guard(device_id_);
+      size_t free_bytes = -1;
+      size_t total_bytes = -1;
+      OF_CUDA_CHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
+      segment_.reset(new CudaExpandableSegment(device_id_, total_bytes));
+    } else {
+      LOG(WARNING) << "CudaAllocator falls back to discontiguous blocks because device "
+                   << device_id_ << " does not support virtual memory management.";
+    }
+  }
 }
 
 CudaAllocator::~CudaAllocator() {
+  // Events of stream uses are returned to free_events_ when the last reference is released.
+  for (auto& piece : pieces_) { piece->stream_uses.clear(); }
+  if (!free_events_.empty()) {
+    cudaSetDevice(device_id_);
+    for (cudaEvent_t event : free_events_) { OF_CUDA_CHECK(cudaEventDestroy(event)); }
+  }
   if (total_memory_bytes_ == 0) {
     CHECK_EQ(mem_ptr2block_.size(), 0);
     return;
   }
+  // Memory of the segment is unmapped by its destructor.
+  if (segment_) { return; }
   cudaSetDevice(device_id_);
   for (auto& pair : mem_ptr2block_) { OF_CUDA_CHECK(cudaFree(pair.first)); }
 }
@@ -87,6 +147,7 @@ void CudaAllocator::DeallocatePiece(Piece* piece) {
   piece->is_free = true;
   piece->prev = nullptr;
   piece->next = recycle_piece_list_;
+  piece->stream_uses.clear();
   recycle_piece_list_ = piece;
 }
 
@@ -129,6 +190,8 @@ CudaAllocator::Piece* CudaAllocator::FindPiece(size_t aligned_size) {
 
           new_piece->is_free = true;
           new_piece->bin_num = kInvalidBinNum;
+          // The rest of the Piece was freed by the same streams.
+          new_piece->stream_uses = piece->stream_uses;
           CHECK(IsAlignedSize(piece->size));
           CHECK(IsAlignedSize(new_piece->size));
           InsertPiece2Bin(new_piece);
@@ -150,6 +213,7 @@ void CudaAllocator::MergeNeighbourFreePiece(Piece* lhs, Piece* rhs) {
 
   lhs->size += rhs->size;
   lhs->next = rhs->next;
+  MergeStreamUses(&lhs->stream_uses, &rhs->stream_uses);
   if (rhs->next != nullptr) { rhs->next->prev = lhs; }
   UnMarkPiece(rhs);
   DeallocatePiece(rhs);
@@ -157,26 +221,10 @@ void CudaAllocator::MergeNeighbourFreePiece(Piece* lhs, Piece* rhs) {
 
 bool CudaAllocator::AllocateBlockToExtendTotalMem(size_t aligned_size) {
   CHECK(IsAlignedSize(aligned_size));
+  if (segment_) { return GrowSegmentToExtendTotalMem(aligned_size); }
 
-  cudaSetDevice(device_id_);
-  size_t free_bytes = -1;
-  size_t total_bytes = -1;
-  OF_CUDA_CHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
-  const size_t remain_bytes = 50 * 1048576;
-  const size_t available_bytes = free_bytes - remain_bytes;  // remain at least 50MiB memory
-
-  size_t allocate_bytes = aligned_size;
-  if (allocate_bytes < 1048576) {
-    // Allocate 2MB if `allocate_bytes` is less than 1MB
-    allocate_bytes = 2097152;
-  } else if (allocate_bytes < 10485760) {
-    // Allocate 20MB if `allocate_bytes` is between 1MB and 10MB
-    allocate_bytes = 20971520;
-  } else {
-    // Round up to 2MB if `allocate_bytes` is larger than 10MB
-    allocate_bytes = RoundUp(allocate_bytes, 2097152);
-  }
-  const size_t final_allocate_bytes = CudaMemAlignedBytes(allocate_bytes);
+  const size_t available_bytes = AvailableDeviceBytes(device_id_);
+  const size_t final_allocate_bytes = ExtendBytes4AlignedSize(aligned_size);
 
   if (final_allocate_bytes > available_bytes) { return false; }
 
@@ -203,7 +251,79 @@ bool CudaAllocator::AllocateBlockToExtendTotalMem(size_t aligned_size) {
   return true;
 }
 
+CudaAllocator::Piece* CudaAllocator::SegmentTailPiece() {
+  auto it = mem_ptr2block_.find(segment_->ptr());
+  if (it == mem_ptr2block_.end()) { return nullptr; }
+  Piece* piece = it->second.start_piece;
+  while (piece->next != nullptr) { piece = piece->next; }
+  CHECK_EQ(piece->ptr + piece->size, segment_->ptr() + segment_->mapped_bytes());
+  return piece;
+}
+
+bool CudaAllocator::GrowSegmentToExtendTotalMem(size_t aligned_size) {
+  Piece* tail = SegmentTailPiece();
+  // A free tail is merged with the memory newly mapped.
+  const size_t tail_free_bytes = (tail != nullptr && tail->is_free) ? tail->size : 0;
+  CHECK_LT(tail_free_bytes, aligned_size);
+  const size_t grow_bytes = ExtendBytes4AlignedSize(aligned_size - tail_free_bytes);
+  if (grow_bytes > AvailableDeviceBytes(device_id_)) { return false; }
+  char* mem_ptr = segment_->ptr() + segment_->mapped_bytes();
+  const size_t mapped_bytes = segment_->Grow(grow_bytes);
+  if (mapped_bytes == 0) { return false; }
+  total_memory_bytes_ += mapped_bytes;
+
+  if (tail_free_bytes > 0) {
+    RemovePieceFromBin(tail);
+    tail->size += mapped_bytes;
+    InsertPiece2Bin(tail);
+  } else {
+    Piece* piece = AllocatePiece();
+    piece->size = mapped_bytes;
+    piece->ptr = mem_ptr;
+    piece->prev = tail;
+    piece->next = nullptr;
+    piece->is_free = true;
+    piece->bin_num = kInvalidBinNum;
+    if (tail != nullptr) { tail->next = piece; }
+    InsertPiece2Bin(piece);
+    MarkPiece(piece);
+    if (tail == nullptr) { CHECK(mem_ptr2block_.emplace(mem_ptr, Block(piece)).second); }
+  }
+  mem_ptr2block_.at(segment_->ptr()).size = segment_->mapped_bytes();
+  return true;
+}
+
+bool CudaAllocator::ShrinkSegmentForGarbageCollection() {
+  Piece* tail = SegmentTailPiece();
+  if (tail == nullptr || !tail->is_free) { return false; }
+  const size_t unmapped_bytes = segment_->Shrink(tail->size);
+  if (unmapped_bytes == 0) { return false; }
+  ++num_gc_;
+  VLOG(3) << "CudaAllocator try unmap free tail of segment for garbage collection. "
+          << " unmap free bytes : " << unmapped_bytes;
+  total_memory_bytes_ -= unmapped_bytes;
+  RemovePieceFromBin(tail);
+  tail->size -= unmapped_bytes;
+  if (tail->size > 0) {
+    InsertPiece2Bin(tail);
+    mem_ptr2block_.at(segment_->ptr()).size = segment_->mapped_bytes();
+  } else {
+    Piece* prev = tail->prev;
+    UnMarkPiece(tail);
+    DeallocatePiece(tail);
+    if (prev != nullptr) {
+      prev->next = nullptr;
+      mem_ptr2block_.at(segment_->ptr()).size = segment_->mapped_bytes();
+    } else {
+      CHECK_EQ(segment_->mapped_bytes(), 0);
+      mem_ptr2block_.erase(segment_->ptr());
+    }
+  }
+  return true;
+}
+
 bool CudaAllocator::DeallocateFreeBlockForGarbageCollection() {
+  if (segment_) { return ShrinkSegmentForGarbageCollection(); }
   size_t total_free_bytes = 0;
   HashSet<char*> free_block_ptrs;
   for (const auto& pair : mem_ptr2block_) {
@@ -227,6 +347,7 @@ bool CudaAllocator::DeallocateFreeBlockForGarbageCollection() {
   total_memory_bytes_ -= total_free_bytes;
 
   if (total_free_bytes > 0) {
+    ++num_gc_;
     VLOG(3) << "CudaAllocator try deallocate free block for garbage collection. "
             << " deallocate free bytes : " << total_free_bytes;
     cudaSetDevice(device_id_);
@@ -258,10 +379,10 @@ bool CudaAllocator::DeallocateFreeBlockForGarbageCollection() {
   return total_free_bytes > 0;
 }
 
-void CudaAllocator::Allocate(char** mem_ptr, std::size_t size) {
+bool CudaAllocator::TryAllocate(char** mem_ptr, std::size_t size) {
   if (size == 0) {
     *mem_ptr = nullptr;
-    return;
+    return true;
   }
   size_t aligned_size = CudaMemAlignedBytes(size);
 
@@ -276,19 +397,141 @@ void CudaAllocator::Allocate(char** mem_ptr, std::size_t size) {
     }
   }
 
-  if (piece == nullptr) {
-    // NOTE(chengcheng): In some corner case on ubuntu, cuda memory not released even if OOM.
-    //   So there need release all cuda memory allocated by this process before core dump.
-    LOG(WARNING) << "OOM error is detected, process will exit. And it will start to reset CUDA "
-                 << "device for releasing device memory.";
-    OF_CUDA_CHECK(cudaDeviceReset());
-    LOG(FATAL) << "Error! : Out of memory when allocate size : " << size
-               << ".\n The total_memory_bytes allocated by this CudaAllocator is : "
-               << total_memory_bytes_;
-  }
+  if (piece == nullptr) { return false; }
   CHECK_NOTNULL(piece->ptr);
   CHECK(ptr2piece_.find(piece->ptr) != ptr2piece_.end());
   *mem_ptr = piece->ptr;
+  allocated_memory_bytes_ += piece->size;
+  peak_allocated_memory_bytes_ = std::max(peak_allocated_memory_bytes_, allocated_memory_bytes_);
+  if (profiler::MemoryTraceEnabled()) {
+    profiler::RecordMemoryAlloc(device_id_, piece->ptr, piece->size, allocated_memory_bytes_,
+                                total_memory_bytes_);
+  }
+  return true;
+}
+
+void CudaAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  if (!TryAllocate(mem_ptr, size)) { OnOutOfMemory(size); }
+}
+
+void CudaAllocator::OnOutOfMemory(std::size_t size) {
+  if (profiler::MemoryTraceEnabled()) {
+    const std::string path = GetStringFromEnv("ONEFLOW_PROFILER_MEMORY_TRACE_OOM_SNAPSHOT",
+                                              "oneflow_oom_memory_snapshot.json");
+    std::ofstream(path) << profiler::GetMemorySnapshot(/*at_peak=*/false);
+    LOG(WARNING) << "The blocks alive at the OOM error are written to " << path;
+  }
+  // NOTE(chengcheng): In some corner case on ubuntu, cuda memory not released even if OOM.
+  //   So there need release all cuda memory allocated by this process before core dump.
+  LOG(WARNING) << "OOM error is detected, process will exit. And it will start to reset CUDA "
+               << "device for releasing device memory.";
+  OF_CUDA_CHECK(cudaDeviceReset());
+  LOG(FATAL) << "Error! : Out of memory when allocate size : " << size
+             << ".\n The total_memory_bytes allocated by this CudaAllocator is : "
+             << total_memory_bytes_;
+}
+
+void CudaAllocator::MergeStreamUses(std::vector<StreamUse>* dst, std::vector<StreamUse>* src) {
+  for (auto& use : *src) {
+    auto it = std::find_if(dst->begin(), dst->end(),
+                           [&](const StreamUse& dst_use) { return dst_use.stream == use.stream; });
+    if (it == dst->end()) {
+      dst->push_back(std::move(use));
+    } else if (it->seq < use.seq) {
+      *it = std::move(use);
+    }
+  }
+  src->clear();
+}
+
+void CudaAllocator::RegisterStream(cudaStream_t stream) {
+  if (likely(std::find(streams_.begin(), streams_.end(), stream) != streams_.end())) { return; }
+  if (!streams_.empty()) {
+    cudaSetDevice(device_id_);
+    OF_CUDA_CHECK(cudaDeviceSynchronize());
+  }
+  for (auto& piece : pieces_) { piece->stream_uses.clear(); }
+  streams_.push_back(stream);
+}
+
+std::shared_ptr<cudaEvent_t> CudaAllocator::RecordEvent(cudaStream_t stream) {
+  cudaSetDevice(device_id_);
+  cudaEvent_t event;
+  if (free_events_.empty()) {
+    OF_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+  } else {
+    event = free_events_.back();
+    free_events_.pop_back();
+  }
+  OF_CUDA_CHECK(cudaEventRecord(event, stream));
+  // Deleters are called with mutex_ held, since pieces are only modified with mutex_ held.
+  return std::shared_ptr<cudaEvent_t>(new cudaEvent_t(event), [this](cudaEvent_t* event) {
+    free_events_.push_back(*event);
+    delete event;
+  });
+}
+
+bool CudaAllocator::TryAllocate(char** mem_ptr, std::size_t size, cudaStream_t stream) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  RegisterStream(stream);
+  if (!TryAllocate(mem_ptr, size)) { return false; }
+  if (*mem_ptr == nullptr) { return true; }
+  Piece* piece = ptr2piece_.at(*mem_ptr);
+  for (const auto& use : piece->stream_uses) {
+    if (use.stream != stream) { OF_CUDA_CHECK(cudaStreamWaitEvent(stream, *use.event, 0)); }
+  }
+  piece->stream_uses.clear();
+  return true;
+}
+
+void CudaAllocator::Allocate(char** mem_ptr, std::size_t size, cudaStream_t stream) {
+  if (!TryAllocate(mem_ptr, size, stream)) { OnOutOfMemory(size); }
+}
+
+void CudaAllocator::Deallocate(char* mem_ptr, std::size_t size, cudaStream_t stream) {
+  if (mem_ptr == nullptr) { return; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  RegisterStream(stream);
+  // No event is needed until another stream shows up.
+  if (streams_.size() > 1) {
+    Piece* piece = ptr2piece_.at(mem_ptr);
+    CHECK(piece->stream_uses.empty());
+    piece->stream_uses.push_back(StreamUse{stream, RecordEvent(stream), ++stream_use_seq_});
+  }
+  Deallocate(mem_ptr, size);
+}
+
+void CudaAllocator::GetStats(AllocatorStats* stats) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats->reserved_bytes = total_memory_bytes_;
+  stats->allocated_bytes = allocated_memory_bytes_;
+  stats->peak_allocated_bytes = peak_allocated_memory_bytes_;
+  stats->largest_free_piece_bytes = 0;
+  stats->num_free_pieces_per_bin.resize(kBinNumSize);
+  for (int32_t bin_num = 0; bin_num < kBinNumSize; ++bin_num) {
+    const auto& pieces = bins_.at(bin_num).pieces;
+    stats->num_free_pieces_per_bin.at(bin_num) = pieces.size();
+    // Pieces of a bin are ordered by size.
+    if (!pieces.empty()) { stats->largest_free_piece_bytes = (*pieces.rbegin())->size; }
+  }
+  stats->num_gc = num_gc_;
+}
+
+void CudaAllocator::ResetPeakStats() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  peak_allocated_memory_bytes_ = allocated_memory_bytes_;
+}
+
+std::shared_ptr<CudaAllocator> GetSharedCudaAllocator(int64_t device_id) {
+  static std::mutex mutex;
+  static HashMap<int64_t, std::weak_ptr<CudaAllocator>> device_id2allocator;
+  std::unique_lock<std::mutex> lock(mutex);
+  std::shared_ptr<CudaAllocator> allocator = device_id2allocator[device_id].lock();
+  if (!allocator) {
+    allocator = std::make_shared<CudaAllocator>(device_id);
+    device_id2allocator[device_id] = allocator;
+  }
+  return allocator;
 }
 
 void CudaAllocator::Deallocate(char* mem_ptr, std::size_t size) {
@@ -303,6 +546,10 @@ void CudaAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CHECK(!piece->is_free);
 
   piece->is_free = true;
+  allocated_memory_bytes_ -= piece->size;
+  if (profiler::MemoryTraceEnabled()) {
+    profiler::RecordMemoryFree(device_id_, mem_ptr, allocated_memory_bytes_, total_memory_bytes_);
+  }
 
   Piece* last_piece_insert_to_bin = piece;
   Piece* next_p = piece->next;
@@ -17,24 +17,56 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_CUDA_ALLOCATOR_H_
 
 #include <cstdint>
+#include <mutex>
 #include "oneflow/core/vm/allocator.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/vm/cuda_expandable_segment.h"
 
 namespace oneflow {
 namespace vm {
 
+#ifdef WITH_CUDA
+
 class CudaAllocator final : public Allocator {
  public:
+  // Expandable segments are enabled by env ONEFLOW_VM_CUDA_ALLOCATOR_EXPANDABLE_SEGMENTS.
   explicit CudaAllocator(int64_t device_id);
+  // With expandable segment, all memory is mapped into one reserved virtual address range which
+  // grows at its tail, so the free tail merges with newly mapped memory instead of leaving
+  // discontiguous blocks. Falls back to blocks if the device does not support it.
+  CudaAllocator(int64_t device_id, bool expandable_segment);
   ~CudaAllocator() override;
 
+  // Used by a single stream, memory freed is reusable immediately in the order of that stream.
   void Allocate(char** mem_ptr, std::size_t size) override;
+  bool TryAllocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
 
+  // Thread safe, used when the allocator is shared by several streams of the device.
+  // Deallocate records an event on `stream`. A stream allocating memory last freed on other
+  // streams waits on their events with cudaStreamWaitEvent, so memory is handed between streams
+  // without synchronizing the host.
+  void Allocate(char** mem_ptr, std::size_t size, cudaStream_t stream);
+  bool TryAllocate(char** mem_ptr, std::size_t size, cudaStream_t stream);
+  void Deallocate(char* mem_ptr, std::size_t size, cudaStream_t stream);
+
+  // Thread safe with respect to the stream-ordered interface.
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
+
  private:
   static constexpr int32_t kInvalidBinNum = -1;
   static constexpr int32_t kBinNumSize = 20;
 
+  // A stream that freed a Piece and may still access its memory on the device.
+  struct StreamUse {
+    cudaStream_t stream;
+    std::shared_ptr<cudaEvent_t> event;
+    // Later uses of the same stream supersede earlier ones.
+    uint64_t seq;
+  };
+
   // Piece is the basic memory unit of CudaAllocator.
   // A Piece is either is free(is_free = true) or in used(is_free = false).
   // If the Piece is_free = true, the pointer to the piece will be stored in the Bin structure of
@@ -47,6 +79,8 @@ class CudaAllocator final : public Allocator {
     Piece* prev = nullptr;
     Piece* next = nullptr;
     int32_t bin_num = kInvalidBinNum;
+    // Only used by the stream-ordered interface, empty if the Piece is in use.
+    std::vector<StreamUse> stream_uses;
   };
 
   // Bin is a structure that stores a set of pieces which is free and has similar size, and
@@ -81,6 +115,9 @@ class CudaAllocator final : public Allocator {
     Block(Piece* p) : size(p->size), ptr(p->ptr), start_piece(p) {}
   };
 
+  // Dumps the memory trace if enabled, resets the device and fails.
+  void OnOutOfMemory(std::size_t size);
+
   size_t BinSize4BinNum(int32_t bin_num) { return kCudaMemAllocAlignSize << bin_num; }
 
   int32_t BinNum4BinSize(size_t size) {
@@ -113,16 +150,69 @@ class CudaAllocator final : public Allocator {
   bool AllocateBlockToExtendTotalMem(size_t aligned_size);
   bool DeallocateFreeBlockForGarbageCollection();
 
+  // The Piece ending at the mapped tail of segment_, nullptr if nothing is mapped.
+  Piece* SegmentTailPiece();
+  bool GrowSegmentToExtendTotalMem(size_t aligned_size);
+  bool ShrinkSegmentForGarbageCollection();
+
+  // Memory freed before a second stream shows up is not tracked by events, so the device is
+  // synchronized once when a new stream uses the allocator. Streams are only compared by handle.
+  void RegisterStream(cudaStream_t stream);
+  std::shared_ptr<cudaEvent_t> RecordEvent(cudaStream_t stream);
+  static void MergeStreamUses(std::vector<StreamUse>* dst, std::vector<StreamUse>* src);
+
   int64_t device_id_;
   size_t total_memory_bytes_;
+  // If not nullptr, it is the only Block of mem_ptr2block_.
+  std::unique_ptr<CudaExpandableSegment> segment_;
+  // Sizes of the Pieces in use, which are aligned sizes rather than requested ones.
+  size_t allocated_memory_bytes_;
+  size_t peak_allocated_memory_bytes_;
+  int64_t num_gc_;
   HashMap<char*, Block> mem_ptr2block_;
 
   std::vector<Bin> bins_;
   std::vector<std::unique_ptr<Piece>> pieces_;
   HashMap<char*, Piece*> ptr2piece_;
   Piece* recycle_piece_list_;
+
+  std::mutex mutex_;
+  std::vector<cudaStream_t> streams_;
+  std::vector<cudaEvent_t> free_events_;
+  uint64_t stream_use_seq_;
+};
+
+// Front of the CudaAllocator shared by all streams of a device.
+class StreamOrderedCudaAllocator final : public Allocator {
+ public:
+  StreamOrderedCudaAllocator(const std::shared_ptr<CudaAllocator>& backend_allocator,
+                             const std::function<cudaStream_t()>& GetStream)
+      : Allocator(), backend_allocator_(backend_allocator), GetStream_(GetStream) {}
+  ~StreamOrderedCudaAllocator() override = default;
+
+  void Allocate(char** mem_ptr, std::size_t size) override {
+    backend_allocator_->Allocate(mem_ptr, size, GetStream_());
+  }
+  bool TryAllocate(char** mem_ptr, std::size_t size) override {
+    return backend_allocator_->TryAllocate(mem_ptr, size, GetStream_());
+  }
+  void Deallocate(char* mem_ptr, std::size_t size) override {
+    backend_allocator_->Deallocate(mem_ptr, size, GetStream_());
+  }
+  // Stats of the shared backend, i.e. of all streams of the device.
+  void GetStats(AllocatorStats* stats) override { backend_allocator_->GetStats(stats); }
+  void ResetPeakStats() override { backend_allocator_->ResetPeakStats(); }
+
+ private:
+  std::shared_ptr<CudaAllocator> backend_allocator_;
+  std::function<cudaStream_t()> GetStream_;
 };
 
+// Returns the CudaAllocator shared by the streams of `device_id`, it lives as long as any of them.
+std::shared_ptr<CudaAllocator> GetSharedCudaAllocator(int64_t device_id);
+
+#endif  // WITH_CUDA
+
 }  // namespace vm
 }  // namespace oneflow
 
@@ -16,6 +16,7 @@ limitations under the License.
 #ifdef WITH_CUDA
 #include "gtest/gtest.h"
 #include "oneflow/core/vm/cuda_allocator.h"
+#include "oneflow/core/vm/cuda_host_allocator.h"
 #include "oneflow/core/vm/thread_safe_allocator.h"
 #include "oneflow/core/device/cuda_util.h"
 
@@ -90,6 +91,142 @@ TEST(CudaAllocator, cuda_allocator) {
   a->Deallocate(data_ptr_1, 2048 * sizeof(float));
 }
 
+TEST(CudaAllocator, stream_ordered) {
+  int gpu_num = -1;
+  cudaGetDeviceCount(&gpu_num);
+  if (gpu_num <= 0) {
+    LOG(INFO) << "CudaAllocator Test: Skip because of non GPU device.";
+    return;
+  }
+  ASSERT_TRUE(cudaSuccess == cudaSetDevice(0));
+  cudaStream_t compute_stream;
+  cudaStream_t copy_stream;
+  ASSERT_TRUE(cudaSuccess == cudaStreamCreate(&compute_stream));
+  ASSERT_TRUE(cudaSuccess == cudaStreamCreate(&copy_stream));
+  {
+    auto backend = GetSharedCudaAllocator(0);
+    ASSERT_EQ(backend, GetSharedCudaAllocator(0));
+    StreamOrderedCudaAllocator compute_allocator(backend, [&]() { return compute_stream; });
+    StreamOrderedCudaAllocator copy_allocator(backend, [&]() { return copy_stream; });
+    const size_t size = 1 << 20;
+    char* ptr = nullptr;
+    compute_allocator.Allocate(&ptr, size);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_TRUE(cudaSuccess == cudaMemsetAsync(ptr, 0, size, compute_stream));
+    compute_allocator.Deallocate(ptr, size);
+    // Memory freed by the compute stream is handed to the copy stream.
+    char* copy_ptr = nullptr;
+    copy_allocator.Allocate(&copy_ptr, size);
+    ASSERT_EQ(copy_ptr, ptr);
+    ASSERT_TRUE(cudaSuccess == cudaMemsetAsync(copy_ptr, 1, size, copy_stream));
+    copy_allocator.Deallocate(copy_ptr, size);
+    compute_allocator.Allocate(&ptr, size);
+    ASSERT_EQ(copy_ptr, ptr);
+    compute_allocator.Deallocate(ptr, size);
+    ASSERT_TRUE(cudaSuccess == cudaDeviceSynchronize());
+  }
+  ASSERT_TRUE(cudaSuccess == cudaStreamDestroy(compute_stream));
+  ASSERT_TRUE(cudaSuccess == cudaStreamDestroy(copy_stream));
+}
+
+TEST(CudaAllocator, stats) {
+  int gpu_num = -1;
+  cudaGetDeviceCount(&gpu_num);
+  if (gpu_num <= 0) {
+    LOG(INFO) << "CudaAllocator Test: Skip because of non GPU device.";
+    return;
+  }
+  ASSERT_TRUE(cudaSuccess == cudaSetDevice(0));
+  CudaAllocator allocator(0);
+  AllocatorStats stats;
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.reserved_bytes, 0U);
+  ASSERT_EQ(stats.allocated_bytes, 0U);
+  ASSERT_EQ(stats.num_gc, 0);
+
+  char* ptr_1 = nullptr;
+  char* ptr_2 = nullptr;
+  allocator.Allocate(&ptr_1, 1);
+  allocator.Allocate(&ptr_2, 4096);
+  allocator.GetStats(&stats);
+  // A 2MiB block is reserved for small allocations.
+  ASSERT_EQ(stats.reserved_bytes, 2097152U);
+  ASSERT_EQ(stats.allocated_bytes, kCudaMemAllocAlignSize + 4096);
+  ASSERT_EQ(stats.peak_allocated_bytes, stats.allocated_bytes);
+  ASSERT_EQ(stats.largest_free_piece_bytes, stats.reserved_bytes - stats.allocated_bytes);
+  int64_t num_free_pieces = 0;
+  for (int64_t n : stats.num_free_pieces_per_bin) { num_free_pieces += n; }
+  ASSERT_EQ(num_free_pieces, 1);
+
+  allocator.Deallocate(ptr_1, 1);
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.allocated_bytes, 4096U);
+  ASSERT_EQ(stats.peak_allocated_bytes, kCudaMemAllocAlignSize + 4096);
+  allocator.ResetPeakStats();
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.peak_allocated_bytes, 4096U);
+  allocator.Deallocate(ptr_2, 4096);
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.allocated_bytes, 0U);
+  ASSERT_EQ(stats.largest_free_piece_bytes, stats.reserved_bytes);
+}
+
+TEST(CudaAllocator, expandable_segment) {
+  int gpu_num = -1;
+  cudaGetDeviceCount(&gpu_num);
+  if (gpu_num <= 0 || !CudaExpandableSegment::IsSupported(0)) {
+    LOG(INFO) << "CudaAllocator Test: Skip because of no GPU supporting virtual memory management.";
+    return;
+  }
+  ASSERT_TRUE(cudaSuccess == cudaSetDevice(0));
+  CudaAllocator allocator(0, true);
+  char* small_ptr = nullptr;
+  allocator.Allocate(&small_ptr, 1);
+  ASSERT_TRUE(small_ptr != nullptr);
+  // The free tail of the segment is merged with the memory mapped for the larger allocation.
+  char* large_ptr = nullptr;
+  allocator.Allocate(&large_ptr, 3 * 1048576);
+  ASSERT_EQ(large_ptr, small_ptr + kCudaMemAllocAlignSize);
+  ASSERT_TRUE(cudaSuccess == cudaMemset(large_ptr, 0, 3 * 1048576));
+  AllocatorStats stats;
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.reserved_bytes, 2097152U + 20971520U);
+  allocator.Deallocate(large_ptr, 3 * 1048576);
+  allocator.Deallocate(small_ptr, 1);
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.largest_free_piece_bytes, stats.reserved_bytes);
+}
+
+TEST(CudaHostAllocator, prewarm_and_cap) {
+  int gpu_num = -1;
+  cudaGetDeviceCount(&gpu_num);
+  if (gpu_num <= 0) {
+    LOG(INFO) << "CudaHostAllocator Test: Skip because of non GPU device.";
+    return;
+  }
+  CudaHostAllocator allocator(0, 1 << 20, 4096);
+  AllocatorStats stats;
+  char* ptr_1 = nullptr;
+  char* ptr_2 = nullptr;
+  allocator.Allocate(&ptr_1, 4096);
+  allocator.Allocate(&ptr_2, 4096);
+  // Both are carved from the pre-warmed memory.
+  ASSERT_EQ(ptr_2, ptr_1 + 4096);
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.reserved_bytes, 1U << 20);
+  char* large_ptr = nullptr;
+  allocator.Allocate(&large_ptr, 2 << 20);
+  allocator.Deallocate(ptr_1, 4096);
+  // Beyond the cap, but pre-warmed memory is never returned to the driver.
+  allocator.Deallocate(ptr_2, 4096);
+  // Beyond the cap and returned to the driver.
+  allocator.Deallocate(large_ptr, 2 << 20);
+  allocator.GetStats(&stats);
+  ASSERT_EQ(stats.reserved_bytes, 1U << 20);
+  ASSERT_EQ(stats.allocated_bytes, 0U);
+  ASSERT_EQ(stats.num_gc, 1);
+}
+
 }  // namespace vm
 }  // namespace oneflow
 
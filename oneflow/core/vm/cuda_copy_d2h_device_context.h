@@ -45,7 +45,7 @@ class CudaCopyD2HDeviceCtx : public DeviceCtx, public SingleThreadQueryCudaEvent
       : DeviceCtx(),
         SingleThreadQueryCudaEventProvider(device_id),
         stream_(nullptr),
-        cuda_allocator_(std::make_unique<CudaHostAllocator>(device_id)),
+        cuda_allocator_(GetSharedCudaHostAllocator(device_id)),
         device_id_(device_id) {}
 
   cudaStream_t cuda_stream() const override { return GetOrCreateCudaStream()->cuda_stream(); }
@@ -74,7 +74,7 @@ class CudaCopyD2HDeviceCtx : public DeviceCtx, public SingleThreadQueryCudaEvent
  protected:
   mutable std::shared_ptr<ep::CudaDevice> device_;
   mutable ep::CudaStream* stream_;
-  std::unique_ptr<CudaHostAllocator> cuda_allocator_;
+  std::shared_ptr<CudaHostAllocator> cuda_allocator_;
   int64_t device_id_;
 };
 
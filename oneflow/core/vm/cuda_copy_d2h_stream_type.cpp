@@ -72,7 +72,7 @@ intrusive::shared_ptr<StreamDesc> CudaCopyD2HStreamType::MakeStreamDesc(
   auto ret = intrusive::make_shared<StreamDesc>();
   ret->set_stream_type(StaticGlobalStreamType<CudaCopyD2HStreamType>());
   ret->set_num_streams_per_machine(device_num);
-  ret->set_num_streams_per_thread(device_num);
+  ret->set_num_streams_per_thread(NumCudaStreamsPerThread(device_num));
   return ret;
 }
 
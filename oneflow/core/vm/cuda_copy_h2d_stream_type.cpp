@@ -65,7 +65,7 @@ intrusive::shared_ptr<StreamDesc> CudaCopyH2DStreamType::MakeStreamDesc(
   auto ret = intrusive::make_shared<StreamDesc>();
   ret->set_stream_type(StaticGlobalStreamType<CudaCopyH2DStreamType>());
   ret->set_num_streams_per_machine(device_num);
-  ret->set_num_streams_per_thread(device_num);
+  ret->set_num_streams_per_thread(NumCudaStreamsPerThread(device_num));
   return ret;
 }
 
@@ -49,8 +49,9 @@ class CudaCopyH2DStreamType final : public StreamType {
   void Compute(Instruction* instruction) const override;
   intrusive::shared_ptr<StreamDesc> MakeStreamDesc(const Resource& resource,
                                                    int64_t this_machine_id) const override;
-  bool OnSchedulerThread() const override { return true; }
+  bool OnSchedulerThread() const override { return !CudaStreamsOnWorkerThreads(); }
   bool SupportingTransportInstructions() const override { return false; }
+  bool CompletesInOrder() const override { return true; }
 };
 
 }  // namespace vm
@@ -0,0 +1,195 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cuda_expandable_segment.h"
+
+namespace oneflow {
+namespace vm {
+
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11030
+
+namespace {
+
+struct DriverApi {
+  decltype(&cuGetErrorString) GetErrorString = nullptr;
+  decltype(&cuDeviceGet) DeviceGet = nullptr;
+  decltype(&cuDeviceGetAttribute) DeviceGetAttribute = nullptr;
+  decltype(&cuMemGetAllocationGranularity) MemGetAllocationGranularity = nullptr;
+  decltype(&cuMemAddressReserve) MemAddressReserve = nullptr;
+  decltype(&cuMemAddressFree) MemAddressFree = nullptr;
+  decltype(&cuMemCreate) MemCreate = nullptr;
+  decltype(&cuMemRelease) MemRelease = nullptr;
+  decltype(&cuMemMap) MemMap = nullptr;
+  decltype(&cuMemUnmap) MemUnmap = nullptr;
+  decltype(&cuMemSetAccess) MemSetAccess = nullptr;
+
+  bool IsComplete() const {
+    return GetErrorString && DeviceGet && DeviceGetAttribute && MemGetAllocationGranularity
+           && MemAddressReserve && MemAddressFree && MemCreate && MemRelease && MemMap && MemUnmap
+           && MemSetAccess;
+  }
+};
+
+template<typename T>
+void LoadDriverSymbol(const char* symbol, T* fn) {
+  void* ptr = nullptr;
+  if (cudaGetDriverEntryPoint(symbol, &ptr, cudaEnableDefault) == cudaSuccess) {
+    *fn = reinterpret_cast<T>(ptr);
+  } else {
+    // Clear the sticky error of the runtime.
+    cudaGetLastError();
+  }
+}
+
+const DriverApi& GetDriverApi() {
+  static const DriverApi api = []() {
+    DriverApi api;
+    LoadDriverSymbol("cuGetErrorString", &api.GetErrorString);
+    LoadDriverSymbol("cuDeviceGet", &api.DeviceGet);
+    LoadDriverSymbol("cuDeviceGetAttribute", &api.DeviceGetAttribute);
+    LoadDriverSymbol("cuMemGetAllocationGranularity", &api.MemGetAllocationGranularity);
+    LoadDriverSymbol("cuMemAddressReserve", &api.MemAddressReserve);
+    LoadDriverSymbol("cuMemAddressFree", &api.MemAddressFree);
+    LoadDriverSymbol("cuMemCreate", &api.MemCreate);
+    LoadDriverSymbol("cuMemRelease", &api.MemRelease);
+    LoadDriverSymbol("cuMemMap", &api.MemMap);
+    LoadDriverSymbol("cuMemUnmap", &api.MemUnmap);
+    LoadDriverSymbol("cuMemSetAccess", &api.MemSetAccess);
+    return api;
+  }();
+  return api;
+}
+
+const char* CuGetErrorString(CUresult result) {
+  const char* error = nullptr;
+  if (GetDriverApi().GetErrorString(result, &error) != CUDA_SUCCESS || error == nullptr) {
+    return "unknown error";
+  }
+  return error;
+}
+
+#define OF_CU_CHECK(condition)                                                                \
+  for (CUresult _of_cu_check_status = (condition); _of_cu_check_status != CUDA_SUCCESS;)      \
+  LOG(FATAL) << "Check failed: " #condition " : " << CuGetErrorString(_of_cu_check_status) \
+             << " (" << _of_cu_check_status << ") "
+
+CUmemAllocationProp MakeAllocationProp(int64_t device_id) {
+  CUmemAllocationProp prop = {};
+  prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+  prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+  prop.location.id = static_cast<int>(device_id);
+  return prop;
+}
+
+CUdeviceptr DevicePtr(char* ptr) { return reinterpret_cast<CUdeviceptr>(ptr); }
+
+}  // namespace
+
+CudaExpandableSegment::CudaExpandableSegment(int64_t device_id, size_t reserved_bytes)
+    : device_id_(device_id), ptr_(nullptr), reserved_bytes_(0), mapped_bytes_(0), granularity_(0) {
+  CHECK(IsSupported(device_id_)) << "virtual memory management is unsupported on device "
+                                 << device_id_;
+  const DriverApi& api = GetDriverApi();
+  CudaCurrentDeviceGuard guard(device_id_);
+  // Make sure the primary context of the device is created.
+  OF_CUDA_CHECK(cudaFree(nullptr));
+  const CUmemAllocationProp prop = MakeAllocationProp(device_id_);
+  OF_CU_CHECK(api.MemGetAllocationGranularity(&granularity_, &prop,
+                                              CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+  reserved_bytes_ = RoundUp(reserved_bytes, granularity_);
+  CUdeviceptr ptr = 0;
+  OF_CU_CHECK(api.MemAddressReserve(&ptr, reserved_bytes_, 0, 0, 0));
+  ptr_ = reinterpret_cast<char*>(ptr);
+}
+
+CudaExpandableSegment::~CudaExpandableSegment() {
+  Shrink(mapped_bytes_);
+  CHECK_EQ(mapped_bytes_, 0);
+  CudaCurrentDeviceGuard guard(device_id_);
+  OF_CU_CHECK(GetDriverApi().MemAddressFree(DevicePtr(ptr_), reserved_bytes_));
+}
+
+bool CudaExpandableSegment::IsSupported(int64_t device_id) {
+  const DriverApi& api = GetDriverApi();
+  if (!api.IsComplete()) { return false; }
+  CUdevice device;
+  if (api.DeviceGet(&device, static_cast<int>(device_id)) != CUDA_SUCCESS) { return false; }
+  int supported = 0;
+  if (api.DeviceGetAttribute(&supported, CU_DEVICE_ATTRIBUTE_VIRTUAL_MEMORY_MANAGEMENT_SUPPORTED,
+                             device)
+      != CUDA_SUCCESS) {
+    return false;
+  }
+  return supported != 0;
+}
+
+size_t CudaExpandableSegment::Grow(size_t bytes) {
+  const size_t size = RoundUp(std::max<size_t>(bytes, 1), granularity_);
+  if (size > reserved_bytes_ - mapped_bytes_) { return 0; }
+  const DriverApi& api = GetDriverApi();
+  CudaCurrentDeviceGuard guard(device_id_);
+  const CUmemAllocationProp prop = MakeAllocationProp(device_id_);
+  CUmemGenericAllocationHandle handle;
+  const CUresult result = api.MemCreate(&handle, size, &prop, 0);
+  if (result == CUDA_ERROR_OUT_OF_MEMORY) { return 0; }
+  OF_CU_CHECK(result);
+  char* chunk_ptr = ptr_ + mapped_bytes_;
+  OF_CU_CHECK(api.MemMap(DevicePtr(chunk_ptr), size, 0, handle, 0));
+  CUmemAccessDesc access_desc = {};
+  access_desc.location = prop.location;
+  access_desc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+  OF_CU_CHECK(api.MemSetAccess(DevicePtr(chunk_ptr), size, &access_desc, 1));
+  chunks_.emplace_back(Chunk{mapped_bytes_, size, handle});
+  mapped_bytes_ += size;
+  return size;
+}
+
+size_t CudaExpandableSegment::Shrink(size_t bytes) {
+  if (chunks_.empty() || chunks_.back().size > bytes) { return 0; }
+  const DriverApi& api = GetDriverApi();
+  CudaCurrentDeviceGuard guard(device_id_);
+  // Unmapping does not wait for kernels still accessing the memory.
+  OF_CUDA_CHECK(cudaDeviceSynchronize());
+  size_t unmapped_bytes = 0;
+  while (!chunks_.empty() && unmapped_bytes + chunks_.back().size <= bytes) {
+    const Chunk& chunk = chunks_.back();
+    OF_CU_CHECK(api.MemUnmap(DevicePtr(ptr_ + chunk.offset), chunk.size));
+    OF_CU_CHECK(api.MemRelease(chunk.handle));
+    unmapped_bytes += chunk.size;
+    mapped_bytes_ -= chunk.size;
+    chunks_.pop_back();
+  }
+  return unmapped_bytes;
+}
+
+#elif defined(WITH_CUDA)
+
+CudaExpandableSegment::CudaExpandableSegment(int64_t device_id, size_t reserved_bytes)
+    : device_id_(device_id), ptr_(nullptr), reserved_bytes_(0), mapped_bytes_(0), granularity_(0) {
+  LOG(FATAL) << "CudaExpandableSegment requires CUDA 11.3 or later";
+}
+
+CudaExpandableSegment::~CudaExpandableSegment() = default;
+
+bool CudaExpandableSegment::IsSupported(int64_t device_id) { return false; }
+
+size_t CudaExpandableSegment::Grow(size_t bytes) { return 0; }
+
+size_t CudaExpandableSegment::Shrink(size_t bytes) { return 0; }
+
+#endif  // defined(WITH_CUDA) && CUDA_VERSION >= 11030
+
+}  // namespace vm
+}  // namespace oneflow
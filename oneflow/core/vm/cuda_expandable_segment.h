@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_CUDA_EXPANDABLE_SEGMENT_H_
+#define ONEFLOW_CORE_VM_CUDA_EXPANDABLE_SEGMENT_H_
+
+#include <cstdint>
+#include <vector>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+namespace vm {
+
+#ifdef WITH_CUDA
+
+// A contiguous range of device virtual addresses backed by physical memory only at its head.
+// The mapped part grows and shrinks at its tail, so memory mapped later stays contiguous with
+// memory mapped earlier. The driver API is loaded with cudaGetDriverEntryPoint, no libcuda is
+// linked.
+class CudaExpandableSegment final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CudaExpandableSegment);
+  // Reserves at least `reserved_bytes` of virtual addresses on `device_id`, nothing is mapped.
+  CudaExpandableSegment(int64_t device_id, size_t reserved_bytes);
+  ~CudaExpandableSegment();
+
+  // Whether the driver and the device support virtual memory management, always false before
+  // CUDA 11.3.
+  static bool IsSupported(int64_t device_id);
+
+  char* ptr() const { return ptr_; }
+  size_t reserved_bytes() const { return reserved_bytes_; }
+  size_t mapped_bytes() const { return mapped_bytes_; }
+  // Sizes mapped and unmapped are multiples of granularity.
+  size_t granularity() const { return granularity_; }
+
+  // Maps at least `bytes` more physical memory at the tail. Returns the number of bytes mapped,
+  // 0 if the device is out of memory or the reserved range is exhausted.
+  size_t Grow(size_t bytes);
+  // Unmaps at most `bytes` at the tail. Memory is unmapped in the units it was mapped by Grow(),
+  // the device is synchronized before. Returns the number of bytes unmapped.
+  size_t Shrink(size_t bytes);
+
+ private:
+  struct Chunk {
+    size_t offset;
+    size_t size;
+#if CUDA_VERSION >= 11030
+    CUmemGenericAllocationHandle handle;
+#endif  // CUDA_VERSION >= 11030
+  };
+
+  int64_t device_id_;
+  char* ptr_;
+  size_t reserved_bytes_;
+  size_t mapped_bytes_;
+  size_t granularity_;
+  std::vector<Chunk> chunks_;
+};
+
+#endif  // WITH_CUDA
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_CUDA_EXPANDABLE_SEGMENT_H_
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_CUDA_GRAPH_KEY_H_
+#define ONEFLOW_CORE_VM_CUDA_GRAPH_KEY_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/shape_view.h"
+#include "oneflow/core/framework/attr_map.h"
+
+namespace oneflow {
+namespace vm {
+
+// What the kernel launches of a sequence of fused instructions depend on, the CUDA graph captured
+// from a sequence is only replayed for sequences of an equal key.
+class CudaGraphKey final {
+ public:
+  CudaGraphKey() : hash_value_(0) {}
+  ~CudaGraphKey() = default;
+
+  void AppendKernel(const void* kernel, const AttrMap& attrs) {
+    values_.push_back(reinterpret_cast<int64_t>(kernel));
+    attrs_.push_back(attrs);
+    HashCombine(&hash_value_, std::hash<const void*>()(kernel));
+    HashCombine(&hash_value_, attrs.hash_value());
+  }
+
+  void AppendBlob(const void* dptr, const ShapeView& shape) {
+    values_.push_back(reinterpret_cast<int64_t>(dptr));
+    values_.push_back(shape.NumAxes());
+    HashCombine(&hash_value_, std::hash<const void*>()(dptr));
+    for (int64_t i = 0; i < shape.NumAxes(); ++i) {
+      values_.push_back(shape.At(i));
+      HashCombine(&hash_value_, std::hash<int64_t>()(shape.At(i)));
+    }
+  }
+
+  void Clear() {
+    values_.clear();
+    attrs_.clear();
+    hash_value_ = 0;
+  }
+
+  bool operator==(const CudaGraphKey& other) const {
+    return hash_value_ == other.hash_value_ && values_ == other.values_ && attrs_ == other.attrs_;
+  }
+
+  size_t hash_value() const { return hash_value_; }
+
+ private:
+  std::vector<int64_t> values_;
+  std::vector<AttrMap> attrs_;
+  size_t hash_value_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+namespace std {
+
+template<>
+struct hash<oneflow::vm::CudaGraphKey> final {
+  size_t operator()(const oneflow::vm::CudaGraphKey& key) const { return key.hash_value(); }
+};
+
+}  // namespace std
+
+#endif  // ONEFLOW_CORE_VM_CUDA_GRAPH_KEY_H_
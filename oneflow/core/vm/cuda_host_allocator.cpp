@@ -17,34 +17,88 @@ limitations under the License.
 
 #include "oneflow/core/vm/cuda_host_allocator.h"
 #include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+std::size_t GranularityBytes(std::size_t granularity) {
+  return static_cast<std::size_t>(1) << granularity;
+}
+
+}  // namespace
+
+CudaHostAllocator::CudaHostAllocator(int64_t device_id)
+    : CudaHostAllocator(
+        device_id, ParseIntegerFromEnv("ONEFLOW_VM_CUDA_HOST_ALLOCATOR_PREWARM_BYTES", 0),
+        ParseIntegerFromEnv("ONEFLOW_VM_CUDA_HOST_ALLOCATOR_MAX_CACHED_BYTES", 0)) {}
+
+CudaHostAllocator::CudaHostAllocator(int64_t device_id, std::size_t prewarm_bytes,
+                                     std::size_t max_cached_bytes)
+    : Allocator(),
+      device_id_(device_id),
+      max_cached_bytes_(max_cached_bytes),
+      prewarmed_ptr_(nullptr),
+      prewarmed_bytes_(0),
+      prewarmed_used_bytes_(0),
+      reserved_bytes_(0),
+      allocated_bytes_(0),
+      peak_allocated_bytes_(0),
+      cached_bytes_(0),
+      num_gc_(0) {
+  if (prewarm_bytes > 0) {
+    CudaCurrentDeviceGuard guard(device_id_);
+    OF_CUDA_CHECK(cudaHostAlloc(&prewarmed_ptr_, prewarm_bytes, cudaHostAllocPortable));
+    prewarmed_bytes_ = prewarm_bytes;
+    reserved_bytes_ = prewarm_bytes;
+  }
+}
+
 CudaHostAllocator::~CudaHostAllocator() {
   CudaCurrentDeviceGuard guard(device_id_);
   for (const auto& ptr_vec : granularity2free_ptrs_) {
-    for (char* ptr : ptr_vec) { OF_CUDA_CHECK(cudaFreeHost(ptr)); }
+    for (char* ptr : ptr_vec) {
+      if (!IsPrewarmed(ptr)) { OF_CUDA_CHECK(cudaFreeHost(ptr)); }
+    }
   }
-  for (const auto& pair : occupied_ptr2granularity_) { OF_CUDA_CHECK(cudaFreeHost(pair.first)); }
+  for (const auto& pair : occupied_ptr2granularity_) {
+    if (!IsPrewarmed(pair.first)) { OF_CUDA_CHECK(cudaFreeHost(pair.first)); }
+  }
+  if (prewarmed_ptr_ != nullptr) { OF_CUDA_CHECK(cudaFreeHost(prewarmed_ptr_)); }
 }
 
 void CudaHostAllocator::Allocate(char** mem_ptr, std::size_t size) {
   std::size_t granularity = std::ceil(std::log2(size));
   CHECK_GE(granularity, 0);
   CHECK_LT(granularity, kMaxGranularity);
-  CHECK_LE(size, 1 << granularity);
+  CHECK_LE(size, GranularityBytes(granularity));
+  const std::size_t bytes = GranularityBytes(granularity);
   CudaCurrentDeviceGuard guard(device_id_);
   std::unique_lock<std::mutex> lock(mutex_);
   auto* vec = &granularity2free_ptrs_[granularity];
   if (vec->empty()) {
     char* ptr = nullptr;
-    OF_CUDA_CHECK(cudaMallocHost(&ptr, 1 << granularity));
+    // Carved pieces are kept aligned for the next ones.
+    const std::size_t carved_bytes = RoundUp(bytes, kHostAlignSize);
+    if (prewarmed_bytes_ - prewarmed_used_bytes_ >= carved_bytes) {
+      ptr = prewarmed_ptr_ + prewarmed_used_bytes_;
+      prewarmed_used_bytes_ += carved_bytes;
+    } else {
+      // Portable, so that the pool can be shared by the streams of all devices.
+      OF_CUDA_CHECK(cudaHostAlloc(&ptr, bytes, cudaHostAllocPortable));
+      reserved_bytes_ += bytes;
+    }
     vec->emplace_back(ptr);
+  } else {
+    cached_bytes_ -= bytes;
   }
   *mem_ptr = vec->back();
   vec->pop_back();
   occupied_ptr2granularity_[*mem_ptr] = granularity;
+  allocated_bytes_ += bytes;
+  peak_allocated_bytes_ = std::max(peak_allocated_bytes_, allocated_bytes_);
 }
 
 void CudaHostAllocator::Deallocate(char* mem_ptr, std::size_t size) {
@@ -53,7 +107,52 @@ void CudaHostAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CHECK(iter != occupied_ptr2granularity_.end());
   std::size_t granularity = iter->second;
   occupied_ptr2granularity_.erase(iter);
-  granularity2free_ptrs_[granularity].emplace_back(mem_ptr);
+  const std::size_t bytes = GranularityBytes(granularity);
+  allocated_bytes_ -= bytes;
+  if (max_cached_bytes_ > 0 && cached_bytes_ + bytes > max_cached_bytes_
+      && !IsPrewarmed(mem_ptr)) {
+    CudaCurrentDeviceGuard guard(device_id_);
+    OF_CUDA_CHECK(cudaFreeHost(mem_ptr));
+    reserved_bytes_ -= bytes;
+    ++num_gc_;
+  } else {
+    granularity2free_ptrs_[granularity].emplace_back(mem_ptr);
+    cached_bytes_ += bytes;
+  }
+}
+
+void CudaHostAllocator::GetStats(AllocatorStats* stats) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats->reserved_bytes = reserved_bytes_;
+  stats->allocated_bytes = allocated_bytes_;
+  stats->peak_allocated_bytes = peak_allocated_bytes_;
+  stats->largest_free_piece_bytes = 0;
+  stats->num_free_pieces_per_bin.resize(kMaxGranularity);
+  for (int granularity = 0; granularity < kMaxGranularity; ++granularity) {
+    const auto& free_ptrs = granularity2free_ptrs_[granularity];
+    stats->num_free_pieces_per_bin.at(granularity) = free_ptrs.size();
+    if (!free_ptrs.empty()) { stats->largest_free_piece_bytes = GranularityBytes(granularity); }
+  }
+  stats->largest_free_piece_bytes =
+      std::max(stats->largest_free_piece_bytes, prewarmed_bytes_ - prewarmed_used_bytes_);
+  stats->num_gc = num_gc_;
+}
+
+void CudaHostAllocator::ResetPeakStats() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  peak_allocated_bytes_ = allocated_bytes_;
+}
+
+std::shared_ptr<CudaHostAllocator> GetSharedCudaHostAllocator(int64_t device_id) {
+  static std::mutex mutex;
+  static std::weak_ptr<CudaHostAllocator> shared_allocator;
+  std::unique_lock<std::mutex> lock(mutex);
+  std::shared_ptr<CudaHostAllocator> allocator = shared_allocator.lock();
+  if (!allocator) {
+    allocator = std::make_shared<CudaHostAllocator>(device_id);
+    shared_allocator = allocator;
+  }
+  return allocator;
 }
 
 }  // namespace vm
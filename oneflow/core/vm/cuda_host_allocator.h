@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <memory>
 #include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
@@ -33,21 +34,48 @@ class CudaHostAllocator final : public Allocator {
   CudaHostAllocator& operator=(const CudaHostAllocator&) = delete;
   CudaHostAllocator& operator=(CudaHostAllocator&&) = delete;
 
-  explicit CudaHostAllocator(int64_t device_id) : Allocator(), device_id_(device_id) {}
+  // Pre-warmed and capped by env ONEFLOW_VM_CUDA_HOST_ALLOCATOR_PREWARM_BYTES and
+  // ONEFLOW_VM_CUDA_HOST_ALLOCATOR_MAX_CACHED_BYTES.
+  explicit CudaHostAllocator(int64_t device_id);
+  // `prewarm_bytes` of pinned memory are allocated at once, cache misses are carved from it before
+  // calling the driver. Freed memory is cached in size classes of powers of two, up to
+  // `max_cached_bytes` (0 for unlimited), memory beyond is returned to the driver unless it is
+  // carved from the pre-warmed memory.
+  CudaHostAllocator(int64_t device_id, std::size_t prewarm_bytes, std::size_t max_cached_bytes);
   ~CudaHostAllocator() override;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+  // Bin i holds the free pointers of granularity i, num_gc counts memory returned to the driver.
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
 
   static const int kMaxGranularity = 64;
 
  private:
+  bool IsPrewarmed(const char* ptr) const {
+    return ptr >= prewarmed_ptr_ && ptr < prewarmed_ptr_ + prewarmed_bytes_;
+  }
+
   int64_t device_id_;
+  std::size_t max_cached_bytes_;
+  char* prewarmed_ptr_;
+  std::size_t prewarmed_bytes_;
+  std::size_t prewarmed_used_bytes_;
   std::mutex mutex_;
   std::array<std::vector<char*>, kMaxGranularity> granularity2free_ptrs_;
   std::unordered_map<char*, size_t> occupied_ptr2granularity_;
+  std::size_t reserved_bytes_;
+  std::size_t allocated_bytes_;
+  std::size_t peak_allocated_bytes_;
+  std::size_t cached_bytes_;
+  int64_t num_gc_;
 };
 
+// The pool shared by the D2H streams of all devices and the data loaders. It allocates portable
+// pinned memory on `device_id` if created by this call, and lives as long as any of its users.
+std::shared_ptr<CudaHostAllocator> GetSharedCudaHostAllocator(int64_t device_id);
+
 }  // namespace vm
 }  // namespace oneflow
 
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cuda_malloc_async_allocator.h"
+
+namespace oneflow {
+namespace vm {
+
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11020
+
+CudaMallocAsyncAllocator::CudaMallocAsyncAllocator(int64_t device_id,
+                                                   const std::function<cudaStream_t()>& GetStream)
+    : Allocator(), device_id_(device_id), GetStream_(GetStream) {
+  CudaCurrentDeviceGuard guard(device_id_);
+  cudaMemPool_t mem_pool;
+  OF_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&mem_pool, device_id_));
+  // Keep freed memory in the pool instead of releasing it at every synchronization.
+  uint64_t release_threshold = UINT64_MAX;
+  OF_CUDA_CHECK(
+      cudaMemPoolSetAttribute(mem_pool, cudaMemPoolAttrReleaseThreshold, &release_threshold));
+}
+
+void CudaMallocAsyncAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  if (size == 0) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  CudaCurrentDeviceGuard guard(device_id_);
+  void* ptr = nullptr;
+  const cudaError_t err = cudaMallocAsync(&ptr, size, GetStream_());
+  if (err == cudaErrorMemoryAllocation) {
+    LOG(FATAL) << "Error! : Out of memory when allocate size : " << size
+               << " with cudaMallocAsync on device " << device_id_;
+  }
+  OF_CUDA_CHECK(err);
+  *mem_ptr = static_cast<char*>(ptr);
+}
+
+void CudaMallocAsyncAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  CudaCurrentDeviceGuard guard(device_id_);
+  OF_CUDA_CHECK(cudaFreeAsync(mem_ptr, GetStream_()));
+}
+
+void CudaMallocAsyncAllocator::GetStats(AllocatorStats* stats) {
+  *stats = AllocatorStats();
+#if CUDA_VERSION >= 11030
+  CudaCurrentDeviceGuard guard(device_id_);
+  cudaMemPool_t mem_pool;
+  OF_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&mem_pool, device_id_));
+  uint64_t value = 0;
+  OF_CUDA_CHECK(cudaMemPoolGetAttribute(mem_pool, cudaMemPoolAttrReservedMemCurrent, &value));
+  stats->reserved_bytes = value;
+  OF_CUDA_CHECK(cudaMemPoolGetAttribute(mem_pool, cudaMemPoolAttrUsedMemCurrent, &value));
+  stats->allocated_bytes = value;
+  OF_CUDA_CHECK(cudaMemPoolGetAttribute(mem_pool, cudaMemPoolAttrUsedMemHigh, &value));
+  stats->peak_allocated_bytes = value;
+#endif  // CUDA_VERSION >= 11030
+}
+
+void CudaMallocAsyncAllocator::ResetPeakStats() {
+#if CUDA_VERSION >= 11030
+  CudaCurrentDeviceGuard guard(device_id_);
+  cudaMemPool_t mem_pool;
+  OF_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&mem_pool, device_id_));
+  // The high watermark can only be reset to zero.
+  uint64_t value = 0;
+  OF_CUDA_CHECK(cudaMemPoolSetAttribute(mem_pool, cudaMemPoolAttrUsedMemHigh, &value));
+#endif  // CUDA_VERSION >= 11030
+}
+
+#endif  // defined(WITH_CUDA) && CUDA_VERSION >= 11020
+
+}  // namespace vm
+}  // namespace oneflow
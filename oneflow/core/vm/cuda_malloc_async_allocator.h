@@ -0,0 +1,52 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_CUDA_MALLOC_ASYNC_ALLOCATOR_H_
+#define ONEFLOW_CORE_VM_CUDA_MALLOC_ASYNC_ALLOCATOR_H_
+
+#include <functional>
+#include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+namespace vm {
+
+#if defined(WITH_CUDA) && CUDA_VERSION >= 11020
+
+// Allocates from the default memory pool of the device with cudaMallocAsync. The pool is shared
+// by all streams of the device, and the driver orders reuse across streams.
+class CudaMallocAsyncAllocator final : public Allocator {
+ public:
+  CudaMallocAsyncAllocator(int64_t device_id, const std::function<cudaStream_t()>& GetStream);
+  ~CudaMallocAsyncAllocator() override = default;
+
+  void Allocate(char** mem_ptr, std::size_t size) override;
+  void Deallocate(char* mem_ptr, std::size_t size) override;
+  // Stats of the whole pool, i.e. of all streams of the device. Only reserved, allocated and
+  // peak bytes are known to the driver.
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
+
+ private:
+  int64_t device_id_;
+  std::function<cudaStream_t()> GetStream_;
+};
+
+#endif  // defined(WITH_CUDA) && CUDA_VERSION >= 11020
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_CUDA_MALLOC_ASYNC_ALLOCATOR_H_
@@ -0,0 +1,242 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cuda_managed_allocator.h"
+#include "oneflow/core/profiler/cupti_activity.h"
+#include "oneflow/core/profiler/managed_memory_metrics.h"
+
+namespace oneflow {
+namespace vm {
+
+#ifdef WITH_CUDA
+
+namespace {
+
+// Managed memory is paged in units of up to 2MiB.
+constexpr std::size_t kManagedAlignSize = 2 * 1024 * 1024;
+
+struct ManagedBlock {
+  std::size_t size;
+  // Reads since the last write, counted by the hints of the instructions.
+  int64_t num_reads;
+  bool read_mostly;
+};
+
+// The hints of a stream cover memory allocated on the other streams too, so the blocks of all
+// allocators are looked up in one registry.
+class ManagedBlockRegistry final {
+ public:
+  void Add(char* ptr, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK(blocks_.emplace(ptr, ManagedBlock{size, 0, false}).second);
+  }
+
+  void Remove(char* ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(blocks_.erase(ptr), 1);
+  }
+
+  // Finds the block containing `ptr` and counts the access. `advice` tells whether the read
+  // mostly advice of the block has to be set (1) or unset (-1).
+  bool Access(const char* ptr, bool write, int64_t read_mostly_reads, const char** block_ptr,
+              std::size_t* block_size, int* advice) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.upper_bound(ptr);
+    if (it == blocks_.begin()) { return false; }
+    --it;
+    if (ptr >= it->first + it->second.size) { return false; }
+    *block_ptr = it->first;
+    *block_size = it->second.size;
+    ManagedBlock* block = &it->second;
+    *advice = 0;
+    if (write) {
+      block->num_reads = 0;
+      if (block->read_mostly) {
+        block->read_mostly = false;
+        *advice = -1;
+      }
+    } else if (read_mostly_reads > 0 && !block->read_mostly
+               && ++block->num_reads >= read_mostly_reads) {
+      block->read_mostly = true;
+      *advice = 1;
+    }
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<const char*, ManagedBlock> blocks_;
+};
+
+ManagedBlockRegistry* GetManagedBlockRegistry() {
+  static ManagedBlockRegistry registry;
+  return &registry;
+}
+
+// ONEFLOW_VM_CUDA_MANAGED_MEMORY_READ_MOSTLY_READS, the reads without a write after which a
+// block is advised as read mostly, 0 never advises.
+int64_t ReadMostlyReads() {
+  static const int64_t reads =
+      ParseIntegerFromEnv("ONEFLOW_VM_CUDA_MANAGED_MEMORY_READ_MOSTLY_READS", 8);
+  return reads;
+}
+
+}  // namespace
+
+CudaManagedAllocator::CudaManagedAllocator(std::unique_ptr<Allocator>&& backend,
+                                           int64_t device_id,
+                                           const std::function<cudaStream_t()>& GetStream,
+                                           std::size_t min_managed_bytes)
+    : Allocator(),
+      backend_(std::move(backend)),
+      device_id_(device_id),
+      GetStream_(GetStream),
+      min_managed_bytes_(min_managed_bytes),
+      managed_bytes_(0),
+      free_managed_bytes_(0) {
+  // ONEFLOW_VM_CUDA_MANAGED_MEMORY_COUNTERS counts the migrations and page faults of the first
+  // device with CUPTI, which slows down the migrations a bit.
+  static const bool counters_started =
+      ParseBooleanFromEnv("ONEFLOW_VM_CUDA_MANAGED_MEMORY_COUNTERS", true)
+      && profiler::StartCuptiUnifiedMemoryCounters(device_id);
+  (void)counters_started;
+}
+
+CudaManagedAllocator::~CudaManagedAllocator() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ReleaseFreeManaged();
+  CHECK(managed_ptr2size_.empty()) << "managed memory not deallocated";
+}
+
+bool CudaManagedAllocator::Enabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_VM_CUDA_MANAGED_MEMORY", false);
+  return enabled;
+}
+
+std::size_t CudaManagedAllocator::MinManagedBytes() {
+  static const int64_t min_bytes =
+      ParseIntegerFromEnv("ONEFLOW_VM_CUDA_MANAGED_MEMORY_MIN_BYTES", 64 * 1024 * 1024);
+  CHECK_GE(min_bytes, 0);
+  return static_cast<std::size_t>(min_bytes);
+}
+
+void CudaManagedAllocator::Allocate(char** mem_ptr, std::size_t size) {
+  if (size == 0) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  if (size < min_managed_bytes_ && backend_->TryAllocate(mem_ptr, size)) { return; }
+  *mem_ptr = AllocateManaged(size, size < min_managed_bytes_);
+}
+
+char* CudaManagedAllocator::AllocateManaged(std::size_t size, bool fallback) {
+  const std::size_t aligned_size = RoundUp(size, kManagedAlignSize);
+  std::lock_guard<std::mutex> lock(mutex_);
+  char* ptr = nullptr;
+  auto it = free_managed_.find(aligned_size);
+  if (it != free_managed_.end()) {
+    ptr = it->second;
+    free_managed_.erase(it);
+    free_managed_bytes_ -= aligned_size;
+  } else {
+    CudaCurrentDeviceGuard guard(device_id_);
+    void* new_ptr = nullptr;
+    cudaError_t err = cudaMallocManaged(&new_ptr, aligned_size);
+    if (err == cudaErrorMemoryAllocation && !free_managed_.empty()) {
+      (void)cudaGetLastError();
+      ReleaseFreeManaged();
+      err = cudaMallocManaged(&new_ptr, aligned_size);
+    }
+    if (err == cudaErrorMemoryAllocation) {
+      LOG(FATAL) << "Error! : Out of memory when allocate size : " << size
+                 << " with cudaMallocManaged on device " << device_id_;
+    }
+    OF_CUDA_CHECK(err);
+    ptr = static_cast<char*>(new_ptr);
+    // The memory lives on the device while it fits and stays mapped there when evicted.
+    OF_CUDA_CHECK(
+        cudaMemAdvise(ptr, aligned_size, cudaMemAdviseSetPreferredLocation, device_id_));
+    OF_CUDA_CHECK(cudaMemAdvise(ptr, aligned_size, cudaMemAdviseSetAccessedBy, device_id_));
+    GetManagedBlockRegistry()->Add(ptr, aligned_size);
+  }
+  CHECK(managed_ptr2size_.emplace(ptr, aligned_size).second);
+  managed_bytes_ += aligned_size;
+  profiler::RecordManagedMemoryAlloc(aligned_size, fallback);
+  return ptr;
+}
+
+void CudaManagedAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = managed_ptr2size_.find(mem_ptr);
+    if (it != managed_ptr2size_.end()) {
+      const std::size_t aligned_size = it->second;
+      managed_ptr2size_.erase(it);
+      managed_bytes_ -= aligned_size;
+      free_managed_.emplace(aligned_size, mem_ptr);
+      free_managed_bytes_ += aligned_size;
+      profiler::RecordManagedMemoryFree(aligned_size);
+      return;
+    }
+  }
+  backend_->Deallocate(mem_ptr, size);
+}
+
+void CudaManagedAllocator::ReleaseFreeManaged() {
+  if (free_managed_.empty()) { return; }
+  CudaCurrentDeviceGuard guard(device_id_);
+  for (const auto& pair : free_managed_) {
+    GetManagedBlockRegistry()->Remove(pair.second);
+    OF_CUDA_CHECK(cudaFree(pair.second));
+  }
+  free_managed_.clear();
+  free_managed_bytes_ = 0;
+}
+
+void CudaManagedAllocator::GetStats(AllocatorStats* stats) {
+  backend_->GetStats(stats);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats->reserved_bytes += managed_bytes_ + free_managed_bytes_;
+  stats->allocated_bytes += managed_bytes_;
+  stats->managed_bytes = managed_bytes_;
+}
+
+void CudaManagedAllocator::ResetPeakStats() { backend_->ResetPeakStats(); }
+
+void CudaManagedAllocator::HintAccess(const char* mem_ptr, std::size_t size, bool write) {
+  if (mem_ptr == nullptr || size == 0) { return; }
+  const char* block_ptr = nullptr;
+  std::size_t block_size = 0;
+  int advice = 0;
+  if (!GetManagedBlockRegistry()->Access(mem_ptr, write, ReadMostlyReads(), &block_ptr,
+                                         &block_size, &advice)) {
+    return;
+  }
+  CudaCurrentDeviceGuard guard(device_id_);
+  if (advice > 0) {
+    OF_CUDA_CHECK(cudaMemAdvise(block_ptr, block_size, cudaMemAdviseSetReadMostly, device_id_));
+    profiler::RecordManagedMemoryReadMostlyAdvice();
+  } else if (advice < 0) {
+    OF_CUDA_CHECK(cudaMemAdvise(block_ptr, block_size, cudaMemAdviseUnsetReadMostly, device_id_));
+  }
+  OF_CUDA_CHECK(cudaMemPrefetchAsync(mem_ptr, size, device_id_, GetStream_()));
+  profiler::RecordManagedMemoryPrefetch(size);
+}
+
+#endif  // WITH_CUDA
+
+}  // namespace vm
+}  // namespace oneflow
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_CUDA_MANAGED_ALLOCATOR_H_
+#define ONEFLOW_CORE_VM_CUDA_MANAGED_ALLOCATOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+namespace vm {
+
+#ifdef WITH_CUDA
+
+// Lets eager tensors oversubscribe the device memory with CUDA unified memory. Allocations of at
+// least `min_managed_bytes`, and those the backend fails for lack of device memory, come from
+// cudaMallocManaged, the driver pages them between the device and the host instead of failing
+// with OOM. Everything else goes to the backend.
+//
+// The VM hints the memory accessed by each instruction, the allocator prefetches it to the device
+// on its stream ahead of the kernels, and advises memory read many times without being written,
+// such as parameters, as read mostly so that the driver keeps a copy on the device.
+class CudaManagedAllocator final : public Allocator {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CudaManagedAllocator);
+  CudaManagedAllocator(std::unique_ptr<Allocator>&& backend, int64_t device_id,
+                       const std::function<cudaStream_t()>& GetStream,
+                       std::size_t min_managed_bytes);
+  ~CudaManagedAllocator() override;
+
+  // ONEFLOW_VM_CUDA_MANAGED_MEMORY, off by default.
+  static bool Enabled();
+  // ONEFLOW_VM_CUDA_MANAGED_MEMORY_MIN_BYTES, 64MiB by default.
+  static std::size_t MinManagedBytes();
+
+  void Allocate(char** mem_ptr, std::size_t size) override;
+  void Deallocate(char* mem_ptr, std::size_t size) override;
+  // Stats of the backend, with the managed memory added to the reserved and allocated bytes.
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
+
+  bool NeedsAccessHints() const override { return true; }
+  // Prefetches the managed memory to the device, ignores the rest.
+  void HintAccess(const char* mem_ptr, std::size_t size, bool write) override;
+
+ private:
+  char* AllocateManaged(std::size_t size, bool fallback);
+  void ReleaseFreeManaged();
+
+  std::unique_ptr<Allocator> backend_;
+  int64_t device_id_;
+  std::function<cudaStream_t()> GetStream_;
+  std::size_t min_managed_bytes_;
+
+  std::mutex mutex_;
+  // Managed memory in use to its rounded size.
+  HashMap<char*, std::size_t> managed_ptr2size_;
+  // Managed memory freed by Deallocate, reused on the stream of this allocator in stream order.
+  std::multimap<std::size_t, char*> free_managed_;
+  std::size_t managed_bytes_;
+  std::size_t free_managed_bytes_;
+};
+
+#endif  // WITH_CUDA
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_CUDA_MANAGED_ALLOCATOR_H_
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_CUDA
+#include "gtest/gtest.h"
+#include "oneflow/core/vm/cuda_managed_allocator.h"
+#include "oneflow/core/vm/cuda_allocator.h"
+#include "oneflow/core/vm/thread_safe_allocator.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+bool IsManaged(const char* ptr) {
+  cudaPointerAttributes attributes;
+  if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess) { return false; }
+  return attributes.type == cudaMemoryTypeManaged;
+}
+
+}  // namespace
+
+TEST(CudaManagedAllocator, cuda_managed_allocator) {
+  int gpu_num = -1;
+  cudaGetDeviceCount(&gpu_num);
+  if (gpu_num <= 0) {
+    LOG(INFO) << "CudaManagedAllocator Test: Skip because of non GPU device.";
+    return;
+  }
+  int managed_memory = 0;
+  ASSERT_TRUE(cudaSuccess == cudaDeviceGetAttribute(&managed_memory, cudaDevAttrManagedMemory, 0));
+  if (managed_memory == 0) {
+    LOG(INFO) << "CudaManagedAllocator Test: Skip because of no managed memory in GPU 0";
+    return;
+  }
+  ASSERT_TRUE(cudaSuccess == cudaSetDevice(0));
+  cudaStream_t stream;
+  ASSERT_TRUE(cudaSuccess == cudaStreamCreate(&stream));
+  const size_t min_managed_bytes = 4 * 1048576;
+  std::unique_ptr<Allocator> backend(
+      new ThreadSafeAllocator(std::unique_ptr<Allocator>(new CudaAllocator(0))));
+  std::unique_ptr<Allocator> a(new CudaManagedAllocator(
+      std::move(backend), 0, [stream]() { return stream; }, min_managed_bytes));
+  ASSERT_TRUE(a->NeedsAccessHints());
+
+  char* small_ptr = nullptr;
+  a->Allocate(&small_ptr, 1024);
+  ASSERT_TRUE(small_ptr != nullptr);
+  ASSERT_FALSE(IsManaged(small_ptr));
+
+  char* large_ptr = nullptr;
+  a->Allocate(&large_ptr, min_managed_bytes + 1);
+  ASSERT_TRUE(large_ptr != nullptr);
+  ASSERT_TRUE(IsManaged(large_ptr));
+
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  ASSERT_EQ(stats.managed_bytes, 6 * 1048576);
+  ASSERT_GE(stats.allocated_bytes, stats.managed_bytes + 1024);
+
+  // Hints of memory not managed are ignored, repeated reads advise read mostly.
+  a->HintAccess(small_ptr, 1024, false);
+  a->HintAccess(large_ptr, min_managed_bytes + 1, true);
+  for (int i = 0; i < 16; ++i) { a->HintAccess(large_ptr + 1024, 1024, false); }
+  ASSERT_TRUE(cudaSuccess == cudaMemsetAsync(large_ptr, 0, min_managed_bytes + 1, stream));
+  a->HintAccess(large_ptr, min_managed_bytes + 1, true);
+  ASSERT_TRUE(cudaSuccess == cudaStreamSynchronize(stream));
+
+  // Freed managed memory of the same rounded size is reused.
+  a->Deallocate(large_ptr, min_managed_bytes + 1);
+  a->GetStats(&stats);
+  ASSERT_EQ(stats.managed_bytes, 0);
+  char* reused_ptr = nullptr;
+  a->Allocate(&reused_ptr, min_managed_bytes + 2);
+  ASSERT_EQ(reused_ptr, large_ptr);
+  a->Deallocate(reused_ptr, min_managed_bytes + 2);
+  a->Deallocate(small_ptr, 1024);
+  a.reset();
+  ASSERT_TRUE(cudaSuccess == cudaStreamDestroy(stream));
+}
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
@@ -26,7 +26,8 @@ CudaOptionalEventRecordStatusQuerier::~CudaOptionalEventRecordStatusQuerier() {
 }
 
 bool CudaOptionalEventRecordStatusQuerier::event_completed() const {
-  cudaSetDevice(cuda_event_->device_id());
+  // cudaEventQuery does not depend on the current device, and switching it on every poll is a
+  // driver call of its own.
   return cuda_event_->Query();
 }
 
@@ -20,6 +20,8 @@ limitations under the License.
 #include "oneflow/core/device/device_context.h"
 #include "oneflow/core/device/cuda_event.h"
 #include "oneflow/core/vm/cuda_allocator.h"
+#include "oneflow/core/vm/cuda_malloc_async_allocator.h"
+#include "oneflow/core/vm/cuda_managed_allocator.h"
 #include "oneflow/core/vm/thread_safe_allocator.h"
 #include "oneflow/core/common/single_thread_obj_pool.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
@@ -43,13 +45,14 @@ class CudaStreamHandleDeviceCtx : public DeviceCtx, public SingleThreadQueryCuda
     }
   }
 
-  CudaStreamHandleDeviceCtx(int64_t device_id)
+  explicit CudaStreamHandleDeviceCtx(int64_t device_id,
+                                     ep::StreamPriority priority = ep::StreamPriority::kNormal)
       : DeviceCtx(),
         SingleThreadQueryCudaEventProvider(device_id),
         stream_(nullptr),
-        cuda_allocator_(
-            new ThreadSafeAllocator(std::unique_ptr<Allocator>(new CudaAllocator(device_id)))),
-        device_id_(device_id) {}
+        cuda_allocator_(NewAllocator(device_id, [this]() { return cuda_stream(); })),
+        device_id_(device_id),
+        priority_(priority) {}
 
   cudaStream_t cuda_stream() const override { return GetOrCreateCudaStream()->cuda_stream(); }
   cublasHandle_t cublas_handle() const override { return GetOrCreateCudaStream()->cublas_handle(); }
@@ -62,13 +65,42 @@ class CudaStreamHandleDeviceCtx : public DeviceCtx, public SingleThreadQueryCuda
   DeviceType device_type() const override { return DeviceType::kCUDA; }
 
  private:
+  // ONEFLOW_VM_CUDA_ALLOCATOR selects how streams of a device allocate memory:
+  //   "" (default): every stream owns a CudaAllocator.
+  //   "stream_ordered": streams share a CudaAllocator and hand memory to each other with events.
+  //   "cuda_malloc_async": streams share the default memory pool of cudaMallocAsync.
+  // ONEFLOW_VM_CUDA_MANAGED_MEMORY puts large allocations, and those not fitting in the device
+  // memory, of the first two in unified memory, see CudaManagedAllocator.
+  static Allocator* NewAllocator(int64_t device_id,
+                                 const std::function<cudaStream_t()>& GetStream) {
+    static const std::string allocator_kind = GetStringFromEnv("ONEFLOW_VM_CUDA_ALLOCATOR", "");
+    Allocator* allocator = nullptr;
+    if (allocator_kind == "stream_ordered") {
+      allocator = new StreamOrderedCudaAllocator(GetSharedCudaAllocator(device_id), GetStream);
+    } else if (allocator_kind == "cuda_malloc_async") {
+#if CUDA_VERSION >= 11020
+      return new CudaMallocAsyncAllocator(device_id, GetStream);
+#else
+      LOG(FATAL) << "cuda_malloc_async allocator requires CUDA 11.2 or later";
+#endif  // CUDA_VERSION >= 11020
+    } else {
+      CHECK(allocator_kind.empty()) << "invalid ONEFLOW_VM_CUDA_ALLOCATOR: " << allocator_kind;
+      allocator = new ThreadSafeAllocator(std::unique_ptr<Allocator>(new CudaAllocator(device_id)));
+    }
+    if (CudaManagedAllocator::Enabled()) {
+      allocator = new CudaManagedAllocator(std::unique_ptr<Allocator>(allocator), device_id,
+                                           GetStream, CudaManagedAllocator::MinManagedBytes());
+    }
+    return allocator;
+  }
+
   ep::CudaStream* GetOrCreateCudaStream() const {
     if (unlikely(stream_ == nullptr)) {
       CHECK(!device_);
       device_ = std::dynamic_pointer_cast<ep::CudaDevice>(
           Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA, device_id_));
       CHECK(device_);
-      stream_ = dynamic_cast<ep::CudaStream*>(device_->CreateStream());
+      stream_ = dynamic_cast<ep::CudaStream*>(device_->CreateStream(priority_));
       CHECK(stream_ != nullptr);
     }
     return stream_;
@@ -79,6 +111,7 @@ class CudaStreamHandleDeviceCtx : public DeviceCtx, public SingleThreadQueryCuda
   mutable ep::CudaStream* stream_;
   std::unique_ptr<Allocator> cuda_allocator_;
   int64_t device_id_;
+  ep::StreamPriority priority_;
 };
 
 #endif  // WITH_CUDA
@@ -72,7 +72,7 @@ intrusive::shared_ptr<StreamDesc> CudaStreamType::MakeStreamDesc(const Resource&
   auto ret = intrusive::make_shared<StreamDesc>();
   ret->set_stream_type(StaticGlobalStreamType<CudaStreamType>());
   ret->set_num_streams_per_machine(device_num);
-  ret->set_num_streams_per_thread(device_num);
+  ret->set_num_streams_per_thread(NumCudaStreamsPerThread(device_num));
   return ret;
 }
 
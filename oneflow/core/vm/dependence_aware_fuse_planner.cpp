@@ -0,0 +1,109 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/dependence_aware_fuse_planner.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+// The stream sequential dependence is accessed as a mutable operand, see
+// VirtualMachineEngine::ConsumeMirroredObjects.
+template<typename DoEachT>
+void ForEachMutDependence(const PhyInstrOperand& operand, const DoEachT& DoEach) {
+  if (operand.stream_sequential_dependence() != nullptr) {
+    DoEach(operand.stream_sequential_dependence());
+  }
+  for (auto* mirrored_object : operand.output_dependences()) { DoEach(mirrored_object); }
+}
+
+bool AccessedAfter(const std::unordered_map<MirroredObject*, size_t>& object2slot,
+                   MirroredObject* mirrored_object, size_t slot) {
+  const auto& iter = object2slot.find(mirrored_object);
+  return iter != object2slot.end() && iter->second > slot;
+}
+
+void UpdateSlot(std::unordered_map<MirroredObject*, size_t>* object2slot,
+                MirroredObject* mirrored_object, size_t slot) {
+  auto iter = object2slot->emplace(mirrored_object, slot).first;
+  iter->second = std::max(iter->second, slot);
+}
+
+}  // namespace
+
+size_t DependenceAwareFusePlanner::Add(InstructionKind kind, Stream* stream,
+                                       const PhyInstrOperand* operand) {
+  if (kind == InstructionKind::kBarrier) {
+    open_group2slot_.clear();
+    return NewSlot();
+  }
+  CHECK_NOTNULL(stream);
+  CHECK_NOTNULL(operand);
+  if (kind == InstructionKind::kUnfusable) {
+    // Keep the order of instructions on the same stream around unfusable ones.
+    CloseGroupsOnStream(stream);
+    const size_t slot = NewSlot();
+    Record(*operand, slot);
+    return slot;
+  }
+  const auto& group_key = std::make_pair(stream, operand->stream_sequential_dependence());
+  auto iter = open_group2slot_.find(group_key);
+  if (iter == open_group2slot_.end()) {
+    iter = open_group2slot_.emplace(group_key, NewSlot()).first;
+  } else if (!MovableTo(*operand, iter->second)) {
+    iter->second = NewSlot();
+  }
+  const size_t slot = iter->second;
+  Record(*operand, slot);
+  if (kind == InstructionKind::kFusableAsTail) { open_group2slot_.erase(iter); }
+  return slot;
+}
+
+// Returns true if `operand` can be moved backward into `slot` without crossing any conflicting
+// access recorded in later slots.
+bool DependenceAwareFusePlanner::MovableTo(const PhyInstrOperand& operand, size_t slot) const {
+  bool movable = true;
+  ForEachMutDependence(operand, [&](MirroredObject* mirrored_object) {
+    movable = movable && !AccessedAfter(last_mut_slot_, mirrored_object, slot)
+              && !AccessedAfter(last_const_slot_, mirrored_object, slot);
+  });
+  for (auto* mirrored_object : operand.input_dependences()) {
+    movable = movable && !AccessedAfter(last_mut_slot_, mirrored_object, slot);
+  }
+  return movable;
+}
+
+void DependenceAwareFusePlanner::Record(const PhyInstrOperand& operand, size_t slot) {
+  ForEachMutDependence(operand, [&](MirroredObject* mirrored_object) {
+    UpdateSlot(&last_mut_slot_, mirrored_object, slot);
+  });
+  for (auto* mirrored_object : operand.input_dependences()) {
+    UpdateSlot(&last_const_slot_, mirrored_object, slot);
+  }
+}
+
+void DependenceAwareFusePlanner::CloseGroupsOnStream(Stream* stream) {
+  for (auto iter = open_group2slot_.begin(); iter != open_group2slot_.end();) {
+    if (iter->first.first == stream) {
+      iter = open_group2slot_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}  // namespace vm
+}  // namespace oneflow
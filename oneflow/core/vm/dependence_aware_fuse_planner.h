@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_DEPENDENCE_AWARE_FUSE_PLANNER_H_
+#define ONEFLOW_CORE_VM_DEPENDENCE_AWARE_FUSE_PLANNER_H_
+
+#include <map>
+#include <unordered_map>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/vm/phy_instr_operand.h"
+
+namespace oneflow {
+namespace vm {
+
+class Stream;
+
+// Assigns the instructions of a pending window to slots for
+// VirtualMachineEngine::GetRewritedPendingInstructionsByDependence. Every slot holds either a fuse
+// group or a single instruction which is not fused, the slots are emitted in order.
+class DependenceAwareFusePlanner final {
+ public:
+  enum class InstructionKind {
+    // Nothing is moved across barriers or instructions with unknown dependences.
+    kBarrier,
+    kUnfusable,
+    kFusable,
+    // Fusable, but nothing is fused after it.
+    kFusableAsTail,
+  };
+
+  OF_DISALLOW_COPY_AND_MOVE(DependenceAwareFusePlanner);
+  DependenceAwareFusePlanner() : num_slots_(0) {}
+  ~DependenceAwareFusePlanner() = default;
+
+  // Returns the slot of the next instruction of the window, which is num_slots() - 1 when a new
+  // slot is opened for it. `stream` and `operand` are not used by kBarrier.
+  size_t Add(InstructionKind kind, Stream* stream, const PhyInstrOperand* operand);
+
+  size_t num_slots() const { return num_slots_; }
+
+ private:
+  bool MovableTo(const PhyInstrOperand& operand, size_t slot) const;
+  void Record(const PhyInstrOperand& operand, size_t slot);
+  void CloseGroupsOnStream(Stream* stream);
+  size_t NewSlot() { return num_slots_++; }
+
+  size_t num_slots_;
+  // The slot of the last access to every mirrored object in the window.
+  std::unordered_map<MirroredObject*, size_t> last_mut_slot_;
+  std::unordered_map<MirroredObject*, size_t> last_const_slot_;
+  // One open fuse group per stream and stream sequential dependence.
+  std::map<std::pair<Stream*, MirroredObject*>, size_t> open_group2slot_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_DEPENDENCE_AWARE_FUSE_PLANNER_H_
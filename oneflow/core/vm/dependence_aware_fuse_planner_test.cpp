@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/vm/dependence_aware_fuse_planner.h"
+#include "oneflow/core/vm/stream.h"
+#include "oneflow/core/vm/vm_object.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+using Kind = DependenceAwareFusePlanner::InstructionKind;
+
+class TestPhyInstrOperand final : public PhyInstrOperand {
+ public:
+  TestPhyInstrOperand(const DependenceVector& inputs, const DependenceVector& outputs)
+      : input_dependences_(inputs), output_dependences_(outputs) {}
+  ~TestPhyInstrOperand() override = default;
+
+  const DependenceVector& input_dependences() const override { return input_dependences_; }
+  const DependenceVector& output_dependences() const override { return output_dependences_; }
+
+ private:
+  DependenceVector input_dependences_;
+  DependenceVector output_dependences_;
+};
+
+class DependenceAwareFusePlannerTest : public testing::Test {
+ protected:
+  DependenceAwareFusePlannerTest()
+      : stream0_(intrusive::make_shared<Stream>()),
+        stream1_(intrusive::make_shared<Stream>()),
+        x_(intrusive::make_shared<MirroredObject>()),
+        y_(intrusive::make_shared<MirroredObject>()),
+        z_(intrusive::make_shared<MirroredObject>()) {}
+
+  size_t Add(Kind kind, Stream* stream, const DependenceVector& inputs,
+             const DependenceVector& outputs) {
+    operands_.emplace_back(new TestPhyInstrOperand(inputs, outputs));
+    return planner_.Add(kind, stream, operands_.back().get());
+  }
+
+  DependenceAwareFusePlanner planner_;
+  intrusive::shared_ptr<Stream> stream0_;
+  intrusive::shared_ptr<Stream> stream1_;
+  intrusive::shared_ptr<MirroredObject> x_;
+  intrusive::shared_ptr<MirroredObject> y_;
+  intrusive::shared_ptr<MirroredObject> z_;
+  std::vector<std::unique_ptr<TestPhyInstrOperand>> operands_;
+};
+
+}  // namespace
+
+TEST_F(DependenceAwareFusePlannerTest, fuse_across_independent_instructions) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {}, {y_.Mutable()}), 1);
+  // Moved backward into the first group since the instruction on stream1 does not touch x or z.
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {x_.Mutable()}, {z_.Mutable()}), 0);
+  ASSERT_EQ(planner_.num_slots(), 2);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, no_read_after_write_across_intervening_write) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {}, {x_.Mutable()}), 1);
+  // Fusing the read into slot 0 would make it observe the first write instead of the second one.
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {x_.Mutable()}, {}), 2);
+  ASSERT_EQ(planner_.num_slots(), 3);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, no_read_after_write_across_intervening_read_write) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {x_.Mutable()}, {y_.Mutable()}), 1);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {y_.Mutable()}, {}), 2);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, no_write_across_intervening_read) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {y_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {x_.Mutable()}, {}), 1);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 2);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, reads_are_fused_across_reads) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {x_.Mutable()}, {y_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {x_.Mutable()}, {z_.Mutable()}), 1);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {x_.Mutable()}, {}), 0);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, barrier_closes_all_groups) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(planner_.Add(Kind::kBarrier, nullptr, nullptr), 1);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {y_.Mutable()}), 2);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, unfusable_closes_groups_on_its_stream) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {}, {y_.Mutable()}), 1);
+  ASSERT_EQ(Add(Kind::kUnfusable, stream0_.Mutable(), {}, {z_.Mutable()}), 2);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {x_.Mutable()}, {}), 3);
+  ASSERT_EQ(Add(Kind::kFusable, stream1_.Mutable(), {y_.Mutable()}, {}), 1);
+}
+
+TEST_F(DependenceAwareFusePlannerTest, fusable_as_tail_closes_its_group) {
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {x_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusableAsTail, stream0_.Mutable(), {}, {y_.Mutable()}), 0);
+  ASSERT_EQ(Add(Kind::kFusable, stream0_.Mutable(), {}, {z_.Mutable()}), 1);
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -15,17 +15,82 @@ limitations under the License.
 */
 #include "oneflow/core/vm/instruction.h"
 #include "oneflow/core/vm/fuse_phy_instr_operand.h"
+#include "oneflow/core/vm/cuda_graph_key.h"
 #include "oneflow/core/vm/cuda_stream_type.h"
 #include "oneflow/core/vm/async_cuda_stream_type.h"
 #include "oneflow/core/vm/cuda_copy_h2d_stream_type.h"
 #include "oneflow/core/vm/cuda_copy_d2h_stream_type.h"
 #include "oneflow/core/vm/cpu_stream_type.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
 
 namespace oneflow {
 
 namespace vm {
 
+#ifdef WITH_CUDA_GRAPHS
+
+namespace {
+
+constexpr size_t kMaxNumCachedCudaGraphs = 128;
+
+bool IsEagerCudaGraphEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EAGER_ENABLE_CUDA_GRAPH", false);
+  return enabled;
+}
+
+// Replays the kernel launches of the fused instructions from a CUDA graph when all of them can be
+// captured, the graph is captured the first time the key of the instructions is seen and the
+// other work of the instructions, such as allocation, still runs every time. Instructions from the
+// first one that cannot be captured on are computed as usual.
+void ComputeInCudaGraphMode(Instruction* instruction, InstructionMsgList* instr_msg_list) {
+  // Each CUDA stream is driven by a single thread.
+  thread_local HashMap<ep::CudaStream*,
+                       HashMap<CudaGraphKey, std::unique_ptr<ep::CudaGraphExecutable>>>
+      stream2graphs;
+  auto* cuda_stream =
+      instruction->instr_msg().phy_instr_stream()->device_ctx()->stream()->As<ep::CudaStream>();
+  CudaGraphKey key;
+  InstructionMsg* unprepared = nullptr;
+  INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, instr_msg_list) {
+    if (!instr_msg->instr_type_id().instruction_type().PrepareInCudaGraphMode(instr_msg, &key)) {
+      unprepared = instr_msg;
+      break;
+    }
+  }
+  const bool prepared = (unprepared == nullptr);
+  if (prepared) {
+    auto& graphs = stream2graphs[cuda_stream];
+    auto it = graphs.find(key);
+    if (it == graphs.end()) {
+      if (graphs.size() >= kMaxNumCachedCudaGraphs) { graphs.clear(); }
+      std::unique_ptr<ep::CudaGraphExecutable> graph(new ep::CudaGraphExecutable());
+      cuda_stream->BeginGraphCapture();
+      INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, instr_msg_list) {
+        instr_msg->instr_type_id().instruction_type().LaunchInCudaGraphMode(instr_msg);
+      }
+      cuda_stream->EndGraphCapture(graph.get());
+      it = graphs.emplace(key, std::move(graph)).first;
+    }
+    cuda_stream->LaunchGraph(it->second.get());
+  }
+  bool after_unprepared = false;
+  INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, instr_msg_list) {
+    const auto& instruction_type = instr_msg->instr_type_id().instruction_type();
+    if (instr_msg == unprepared) { after_unprepared = true; }
+    if (after_unprepared) {
+      instruction_type.ComputeInFuseMode(instr_msg);
+    } else {
+      if (!prepared) { instruction_type.LaunchInCudaGraphMode(instr_msg); }
+      instruction_type.FinishInCudaGraphMode(instr_msg);
+    }
+  }
+}
+
+}  // namespace
+
+#endif  // WITH_CUDA_GRAPHS
+
 template<typename StreamT>
 class FuseInstructionType : public vm::InstructionType {
  public:
@@ -49,6 +114,14 @@ class FuseInstructionType : public vm::InstructionType {
     const auto& phy_instr_operand = instruction->instr_msg().phy_instr_operand();
     auto* ptr = dynamic_cast<vm::FusePhyInstrOperand*>(phy_instr_operand.get());
     auto* instr_msg_list = CHECK_NOTNULL(ptr)->mut_instr_msg_list();
+#ifdef WITH_CUDA_GRAPHS
+    if (std::is_same<StreamT, CudaStreamType>::value && IsEagerCudaGraphEnabled()) {
+      OF_PROFILER_RANGE_PUSH("F:CudaGraph");
+      ComputeInCudaGraphMode(instruction, instr_msg_list);
+      OF_PROFILER_RANGE_POP();
+      return;
+    }
+#endif  // WITH_CUDA_GRAPHS
     INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, instr_msg_list) {
       OF_PROFILER_RANGE_PUSH("F:" + instr_msg->DebugName());
       instr_msg->instr_type_id().instruction_type().ComputeInFuseMode(instr_msg);
@@ -31,7 +31,12 @@ std::string InstructionMsg::DebugName() const {
   return op_type_name + ":" + instr_type_name();
 }
 
-void InstructionMsg::__Init__() { *mut_instr_type_name() = ""; }
+void InstructionMsg::__Init__() {
+  mut_instr_type_id()->clear();
+  *mut_instr_type_name() = "";
+  phy_instr_stream_ = nullptr;
+  trace_timestamps_ = profiler::InstructionTimestamps();
+}
 
 void InstructionMsg::__Init__(const std::string& instr_type_name) {
   __Init__();
@@ -68,8 +73,13 @@ void InstructionMsg::__Init__(const InstructionMsg& instr_msg) {
   if (instr_msg.phy_instr_stream() != nullptr) { phy_instr_stream_ = instr_msg.phy_instr_stream(); }
 }
 
+void InstructionMsg::__Delete__() {
+  phy_instr_parallel_desc_.reset();
+  phy_instr_operand_.reset();
+}
+
 intrusive::shared_ptr<InstructionMsg> InstructionMsg::Clone() const {
-  return intrusive::make_shared<InstructionMsg>(*this);
+  return NewInstructionMsg(*this);
 }
 
 void Instruction::Init(InstructionMsg* instr_msg, Stream* stream,
@@ -30,13 +30,17 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.pb.h"
 #include "oneflow/core/vm/instruction.cfg.h"
 #include "oneflow/core/vm/phy_instr_operand.h"
+#include "oneflow/core/profiler/instruction_trace.h"
 
 namespace oneflow {
 namespace vm {
 
 class VirtualMachineEngine;
 
-class InstructionMsg final : public intrusive::Base {
+class InstructionMsg final
+    : public intrusive::Base,
+      public intrusive::EnableObjectPool<InstructionMsg,
+                                         intrusive::kCrossThreadReturnAndDisableDestruct> {
  public:
   // Getters
   const std::string& instr_type_name() const { return instr_type_name_; }
@@ -46,9 +50,11 @@ class InstructionMsg final : public intrusive::Base {
   }
   const std::shared_ptr<PhyInstrOperand>& phy_instr_operand() const { return phy_instr_operand_; }
   Stream* phy_instr_stream() const { return phy_instr_stream_; }
+  const profiler::InstructionTimestamps& trace_timestamps() const { return trace_timestamps_; }
   // Setters
   std::string* mut_instr_type_name() { return &instr_type_name_; }
   InstrTypeId* mut_instr_type_id() { return &instr_type_id_; }
+  profiler::InstructionTimestamps* mut_trace_timestamps() { return &trace_timestamps_; }
 
   // methods
   void __Init__();
@@ -57,14 +63,16 @@ class InstructionMsg final : public intrusive::Base {
                 const std::shared_ptr<const ParallelDesc>& phy_instr_parallel_desc,
                 const std::shared_ptr<PhyInstrOperand>& phy_instr_operand);
   void __Init__(const InstructionMsg& instr_msg);
+  void __Delete__();
 
   std::string DebugName() const;
 
   intrusive::shared_ptr<InstructionMsg> Clone() const;
 
+  intrusive::Ref* mut_intrusive_ref() { return &intrusive_ref_; }
+
  private:
   friend class intrusive::Ref;
-  intrusive::Ref* mut_intrusive_ref() { return &intrusive_ref_; }
 
   InstructionMsg()
       : intrusive_ref_(),
@@ -73,7 +81,9 @@ class InstructionMsg final : public intrusive::Base {
         phy_instr_parallel_desc_(),
         phy_instr_operand_(),
         phy_instr_stream_(),
-        instr_msg_hook_() {}
+        trace_timestamps_(),
+        instr_msg_hook_(),
+        instr_msg_mpsc_hook_() {}
   intrusive::Ref intrusive_ref_;
   // fields
   InstrTypeId instr_type_id_;
@@ -82,14 +92,25 @@ class InstructionMsg final : public intrusive::Base {
   std::shared_ptr<const ParallelDesc> phy_instr_parallel_desc_;
   std::shared_ptr<PhyInstrOperand> phy_instr_operand_;
   Stream* phy_instr_stream_;
+  // only written when profiler::InstructionTraceEnabled().
+  profiler::InstructionTimestamps trace_timestamps_;
 
  public:
   // list hooks
   intrusive::ListHook instr_msg_hook_;
+  // used by the lock-free pending/garbage lists of VirtualMachineEngine.
+  intrusive::MpscListHook instr_msg_mpsc_hook_;
 };
 
 using InstructionMsgList = intrusive::List<INTRUSIVE_FIELD(InstructionMsg, instr_msg_hook_)>;
 
+// Instruction messages are built by the threads issuing instructions and released by the vm, they
+// are recycled through a pool of the issuing thread.
+template<typename... Args>
+intrusive::shared_ptr<InstructionMsg> NewInstructionMsg(Args&&... args) {
+  return InstructionMsg::object_pool_type::ThreadLocal()->make_shared(std::forward<Args>(args)...);
+}
+
 static const int kInstructionStatusBufferBytes = 64;
 
 // clang-format off
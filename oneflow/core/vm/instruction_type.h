@@ -24,6 +24,7 @@ namespace vm {
 
 struct InstructionMsg;
 struct Instruction;
+class CudaGraphKey;
 
 enum InstructionFuseType {
   kInvalidInstructionFuseType = 0,
@@ -42,6 +43,23 @@ class InstructionType {
   virtual void Compute(Instruction* instruction) const = 0;
 
   virtual void ComputeInFuseMode(InstructionMsg* instr_msg) const { LOG(FATAL) << "UNIMPLEMENTED"; }
+  // Whether ComputeInFuseMode is implemented, which also lets the vm compute the instruction
+  // inline on the thread issuing it, see VirtualMachine::Receive.
+  virtual bool SupportComputeInFuseMode() const { return fuse_type() != kDisableInstructionFuse; }
+  // Fused instructions on a CUDA stream may be replayed from a captured CUDA graph, see
+  // FuseInstructionType. Prepare does everything of ComputeInFuseMode before the kernel launches
+  // and appends what the launches depend on to key. If the launches cannot be captured it returns
+  // false, having done no more than allocating outputs and initializing kernel states, so that
+  // ComputeInFuseMode can follow. Launch is captured, Finish is not.
+  virtual bool PrepareInCudaGraphMode(InstructionMsg* instr_msg, CudaGraphKey* key) const {
+    return false;
+  }
+  virtual void LaunchInCudaGraphMode(InstructionMsg* instr_msg) const {
+    LOG(FATAL) << "UNIMPLEMENTED";
+  }
+  virtual void FinishInCudaGraphMode(InstructionMsg* instr_msg) const {
+    LOG(FATAL) << "UNIMPLEMENTED";
+  }
   void InitInstructionStatusIf(Instruction* instruction) const {
     InitInstructionStatus(instruction);
   }
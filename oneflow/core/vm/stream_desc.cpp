@@ -14,10 +14,26 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/vm/stream_desc.h"
+#include "oneflow/core/common/env_var.h"
 
 namespace oneflow {
 namespace vm {
 
+bool CudaStreamsOnWorkerThreads() {
+  static const bool on_worker_threads =
+      EnvInteger<ONEFLOW_VM_NUM_CUDA_DEVICES_PER_WORKER_THREAD>() > 0;
+  return on_worker_threads;
+}
+
+int32_t NumCudaStreamsPerThread(int32_t device_num) {
+  if (!CudaStreamsOnWorkerThreads() || device_num == 0) { return device_num; }
+  int32_t devices_per_thread = std::min<int64_t>(
+      EnvInteger<ONEFLOW_VM_NUM_CUDA_DEVICES_PER_WORKER_THREAD>(), device_num);
+  // StreamDesc::num_threads requires streams to be evenly distributed over threads.
+  while (device_num % devices_per_thread != 0) { --devices_per_thread; }
+  return devices_per_thread;
+}
+
 void StreamDesc::__Init__(const StreamType* stream_type, int32_t num_streams_per_machine,
                           int32_t num_streams_per_thread) {
   set_stream_type(stream_type);
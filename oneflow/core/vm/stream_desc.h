@@ -56,6 +56,14 @@ class StreamId final {
   int64_t global_device_id_;
 };
 
+// CUDA streams are run on the scheduler thread by default. When
+// ONEFLOW_VM_NUM_CUDA_DEVICES_PER_WORKER_THREAD is positive, they are run on worker threads, each
+// of which launches instructions for a group of devices, so that launching scales with the number
+// of devices instead of being capped by the scheduler thread.
+bool CudaStreamsOnWorkerThreads();
+// Returns the number of streams of the same cuda stream type one thread serves.
+int32_t NumCudaStreamsPerThread(int32_t device_num);
+
 class StreamDesc final : public intrusive::Base {
  public:
   // Getters
@@ -58,6 +58,9 @@ class StreamType {
   virtual bool OnSchedulerThread() const = 0;
   virtual bool SupportingTransportInstructions() const = 0;
   virtual bool IsControlStreamType() const { return false; }
+  // Whether instructions finish in the order they were dispatched, so a finished instruction
+  // implies all the ones dispatched before it on the same stream have finished too.
+  virtual bool CompletesInOrder() const { return false; }
 
  protected:
   StreamType() = default;
@@ -24,21 +24,51 @@ void ThreadSafeAllocator::Allocate(char** mem_ptr, std::size_t size) {
   backend_allocator_->Allocate(mem_ptr, size);
 }
 
+bool ThreadSafeAllocator::TryAllocate(char** mem_ptr, std::size_t size) {
+  std::unique_lock<std::mutex> lock(mutex4backend_allocator_);
+  return backend_allocator_->TryAllocate(mem_ptr, size);
+}
+
 void ThreadSafeAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   std::unique_lock<std::mutex> lock(mutex4backend_allocator_);
   backend_allocator_->Deallocate(mem_ptr, size);
 }
 
+void ThreadSafeAllocator::GetStats(AllocatorStats* stats) {
+  std::unique_lock<std::mutex> lock(mutex4backend_allocator_);
+  backend_allocator_->GetStats(stats);
+}
+
+void ThreadSafeAllocator::ResetPeakStats() {
+  std::unique_lock<std::mutex> lock(mutex4backend_allocator_);
+  backend_allocator_->ResetPeakStats();
+}
+
 void SingleThreadOnlyAllocator::Allocate(char** mem_ptr, std::size_t size) {
   CheckUniqueThreadAccess();
   backend_allocator_->Allocate(mem_ptr, size);
 }
 
+bool SingleThreadOnlyAllocator::TryAllocate(char** mem_ptr, std::size_t size) {
+  CheckUniqueThreadAccess();
+  return backend_allocator_->TryAllocate(mem_ptr, size);
+}
+
 void SingleThreadOnlyAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   CheckUniqueThreadAccess();
   backend_allocator_->Deallocate(mem_ptr, size);
 }
 
+void SingleThreadOnlyAllocator::GetStats(AllocatorStats* stats) {
+  CheckUniqueThreadAccess();
+  backend_allocator_->GetStats(stats);
+}
+
+void SingleThreadOnlyAllocator::ResetPeakStats() {
+  CheckUniqueThreadAccess();
+  backend_allocator_->ResetPeakStats();
+}
+
 void SingleThreadOnlyAllocator::CheckUniqueThreadAccess() {
   std::unique_lock<std::mutex> lock(mutex4accessed_thread_id_);
   CHECK(accessed_thread_id_ == std::this_thread::get_id());
@@ -32,7 +32,10 @@ class ThreadSafeAllocator final : public Allocator {
   ~ThreadSafeAllocator() override = default;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
+  bool TryAllocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
 
  private:
   std::unique_ptr<Allocator> backend_allocator_;
@@ -48,7 +51,10 @@ class SingleThreadOnlyAllocator final : public Allocator {
   ~SingleThreadOnlyAllocator() override = default;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
+  bool TryAllocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+  void GetStats(AllocatorStats* stats) override;
+  void ResetPeakStats() override;
 
  private:
   void CheckUniqueThreadAccess();
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/vm/instruction_type.h"
 #include "oneflow/core/vm/no_arg_cb_phy_instr_operand.h"
 #include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/vm/cpu_stream_type.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/common/cpp_attribute.h"
 #include "oneflow/core/control/global_process_ctx.h"
@@ -52,6 +53,26 @@ Maybe<void> ForEachThreadCtx(vm::VirtualMachineEngine* vm,
   return Maybe<void>::Ok();
 }
 
+// Computes CPU instructions on the thread issuing them while the vm is idle, which saves the hops
+// to the scheduler, worker and callback threads that dominate small CPU inference. Multi-process
+// jobs keep the worker threads, their communications must not block the issuing thread.
+bool SyncCpuExecutionEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_EAGER_ENABLE_SYNC_CPU_EXECUTION", false)
+                              && GlobalProcessCtx::WorldSize() == 1;
+  return enabled;
+}
+
+bool ComputableInline(vm::InstructionMsgList* instr_list) {
+  INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, instr_list) {
+    const auto& instr_type_id = instr_msg->instr_type_id();
+    if (dynamic_cast<const vm::CpuStreamType*>(&instr_type_id.stream_type()) == nullptr) {
+      return false;
+    }
+    if (!instr_type_id.instruction_type().SupportComputeInFuseMode()) { return false; }
+  }
+  return true;
+}
+
 void GetSchedulerThreadInitializer(std::function<void()>* Initializer) {
   *Initializer = [&]() {
     CHECK_JUST(InitThisThreadUniqueConsistentId(kThreadConsistentIdScheduler, "scheduler"));
@@ -137,7 +158,7 @@ namespace {
 void MakeCtrlSeqInstructions(vm::VirtualMachineEngine* vm, vm::InstructionMsgList* list,
                              const std::function<void()>& ComputeCallback) {
   const auto& phy_instr_operand = std::make_shared<vm::NoArgCbPhyInstrOperand>(ComputeCallback);
-  auto instruction = intrusive::make_shared<vm::InstructionMsg>(
+  auto instruction = vm::NewInstructionMsg(
       vm, "CtrlComputeRankFrontSeqCallback", std::shared_ptr<const ParallelDesc>(),
       phy_instr_operand);
   list->EmplaceBack(std::move(instruction));
@@ -199,6 +220,9 @@ Maybe<void> VirtualMachine::Receive(vm::InstructionMsgList* instr_list) {
       // `ComputeInFuseMode` will be replaced by `Compute` soon.
       instr_msg->mut_instr_type_id()->instruction_type().ComputeInFuseMode(instr_msg);
     }
+  } else if (SyncCpuExecutionEnabled() && ComputableInline(instr_list)
+             && TryComputeInline(instr_list)) {
+    // Computed, and consumed as if received by the scheduler.
   } else {
     const int64_t kHighWaterMark = GetInstructionHighWaterMark();
     if (vm_->flying_instruction_cnt() > kHighWaterMark) {
@@ -223,6 +247,31 @@ Maybe<void> VirtualMachine::Receive(vm::InstructionMsgList* instr_list) {
   return Maybe<void>::Ok();
 }
 
+bool VirtualMachine::TryComputeInline(vm::InstructionMsgList* instr_list) {
+  // Idleness is claimed under the lock: the scheduler can not dispatch the instructions other
+  // threads issue from now on until the inline ones are computed, and the instructions it
+  // dispatched before are counted as unfinished.
+  std::unique_lock<std::mutex> lock(inline_compute_mutex_, std::try_to_lock);
+  if (!lock.owns_lock() || vm_->unfinished_instr_msg_cnt() != 0) { return false; }
+  // Nothing the instructions may depend on is pending, so they are computed in order right now.
+  INTRUSIVE_FOR_EACH_PTR(instr_msg, instr_list) {
+    OF_PROFILER_RANGE_PUSH("S:" + instr_msg->DebugName());
+    instr_msg->instr_type_id().instruction_type().ComputeInFuseMode(instr_msg);
+    OF_PROFILER_RANGE_POP();
+  }
+  instr_list->Clear();
+  return true;
+}
+
+void VirtualMachine::Schedule() {
+  if (SyncCpuExecutionEnabled()) {
+    std::unique_lock<std::mutex> lock(inline_compute_mutex_);
+    mut_vm()->Schedule();
+  } else {
+    mut_vm()->Schedule();
+  }
+}
+
 void VirtualMachine::ScheduleLoop(const std::function<void()>& Initializer) {
   Initializer();
   auto* vm = mut_vm();
@@ -241,24 +290,18 @@ void VirtualMachine::ScheduleLoop(const std::function<void()>& Initializer) {
       // about 10ns.
       int i = 0;
       do {
-        // Use ThreadUnsafeEmpty to avoid acquiring mutex lock.
+        // Use ThreadUnsafeEmpty to avoid reading the shared pending_msg_list.
         // It's safe to use ThreadUnsafeEmpty here. pending_notifier_.notified_cnt_ will be greater
-        // than zero when inconsistency between
-        // vm->pending_msg_list.list_head_.list_head_.container_ and
-        // vm->pending_msg_list.list_head_.list_head_.size_ occured. hence the pending
-        // instructions
-        // will get handled in the next iteration.
-        //  VirtualMachine::Receive may be less effiencient if the thread safe version `vm->Empty()`
-        // used
-        //  here, because VirtualMachine::ScheduleLoop is more likely to get the mutex lock.
-        do { vm->Schedule(); } while (!vm->ThreadUnsafeEmpty());
+        // than zero when instructions are published into vm->pending_msg_list, hence the pending
+        // instructions will get handled in the next iteration.
+        do { Schedule(); } while (!vm->ThreadUnsafeEmpty());
         vm->NotifyCallback();
       } while (++i < kNumSchedulingPerTimoutTest);
     } while (MicrosecondsFrom(start) < kWorkingMicroseconds);
     OF_PROFILER_RANGE_POP();
   }
   while (!(vm->Empty() && vm->CallbackEmpty())) {
-    vm->Schedule();
+    Schedule();
     vm->NotifyCallback();
   }
   CHECK_JUST(ForEachThreadCtx(vm_.Mutable(), [&](vm::ThreadCtx* thread_ctx) -> Maybe<void> {
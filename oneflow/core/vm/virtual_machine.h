@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_VM_VIRTUAL_MACHINE_H_
 #define ONEFLOW_CORE_VM_VIRTUAL_MACHINE_H_
 
+#include <mutex>
 #include "oneflow/core/common/notifier.h"
 #include "oneflow/core/vm/vm_desc.h"
 #include "oneflow/core/vm/virtual_machine_engine.h"
@@ -46,6 +47,9 @@ class VirtualMachine final {
 
   void ScheduleLoop(const std::function<void()>& Initializer);
   void CallbackLoop(const std::function<void()>& Initializer);
+  // Returns false if the instructions have to go through the scheduler.
+  bool TryComputeInline(vm::InstructionMsgList* instr_list);
+  void Schedule();
 
   vm::VirtualMachineEngine* mut_vm() { return vm_.Mutable(); }
   void ControlSync();
@@ -57,6 +61,9 @@ class VirtualMachine final {
   Notifier pending_notifier_;
   std::thread callback_thread_;
   Notifier callback_notifier_;
+  // Held by the scheduler while it schedules and by a thread computing instructions inline, so that
+  // nothing received from other threads meanwhile is dispatched before the inline ones are done.
+  std::mutex inline_compute_mutex_;
 };
 
 }  // namespace oneflow
@@ -17,19 +17,52 @@ limitations under the License.
 #include "oneflow/core/vm/vm_desc.h"
 #include "oneflow/core/vm/instruction_type.h"
 #include "oneflow/core/vm/fuse_phy_instr_operand.h"
+#include "oneflow/core/vm/dependence_aware_fuse_planner.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/cross_thread_obj_pool.h"
 #include "oneflow/core/common/cpp_attribute.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/platform/include/pthread_fork.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/instruction_trace.h"
 #include "oneflow/core/common/cpp_attribute.h"
 #include "oneflow/core/common/global.h"
 
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+void TraceTimestamp(InstructionMsg* instr_msg,
+                    int64_t profiler::InstructionTimestamps::*timestamp) {
+  if (unlikely(profiler::InstructionTraceEnabled())) {
+    instr_msg->mut_trace_timestamps()->*timestamp = profiler::InstructionTraceNow();
+  }
+}
+
+// Instructions which were partially traced because the trace was switched on or off in their
+// lifetime are skipped.
+void TraceReleasedInstruction(Instruction* instruction) {
+  if (likely(!profiler::InstructionTraceEnabled())) { return; }
+  auto* instr_msg = instruction->mut_instr_msg();
+  auto* timestamps = instr_msg->mut_trace_timestamps();
+  timestamps->release = profiler::InstructionTraceNow();
+  if (timestamps->enqueue <= 0 || timestamps->schedule < timestamps->enqueue
+      || timestamps->ready < timestamps->schedule || timestamps->dispatch < timestamps->ready
+      || timestamps->complete < timestamps->dispatch
+      || timestamps->release < timestamps->complete) {
+    return;
+  }
+  const Stream& stream = *instruction->mut_stream();
+  const std::string stream_name = std::string(stream.stream_type().stream_tag()) + ":"
+                                  + std::to_string(stream.global_device_id());
+  profiler::RecordInstruction(instr_msg->DebugName(), stream_name, *timestamps);
+}
+
+}  // namespace
+
 void VirtualMachineEngine::ReleaseInstruction(Instruction* instruction) {
   OF_PROFILER_RANGE_PUSH("R:" + instruction->instr_msg().DebugName());
   auto* access_list = instruction->mut_access_list();
@@ -49,6 +82,7 @@ void VirtualMachineEngine::ReleaseInstruction(Instruction* instruction) {
     out_instruction->mut_in_edges()->Erase(out_edge);
     if (Dispatchable(out_instruction)) {
       OF_PROFILER_RANGE_PUSH("E:" + out_instruction->instr_msg().DebugName());
+      TraceTimestamp(out_instruction->mut_instr_msg(), &profiler::InstructionTimestamps::ready);
       mut_ready_instruction_list()->PushBack(out_instruction);
       OF_PROFILER_RANGE_POP();
     }
@@ -57,11 +91,29 @@ void VirtualMachineEngine::ReleaseInstruction(Instruction* instruction) {
 }
 
 // Handle pending instructions, and try schedule them to ready list.
+namespace {
+
+bool DependenceAwareFuseEnabled() {
+  static const bool enabled =
+      ParseBooleanFromEnv("ONEFLOW_VM_ENABLE_DEPENDENCE_AWARE_FUSE", false);
+  return enabled;
+}
+
+size_t PendingHandleWindowSize() {
+  static const size_t window_size = ParseIntegerFromEnv("ONEFLOW_VM_PENDING_HANDLE_WINDOW", 10);
+  return window_size;
+}
+
+}  // namespace
+
 void VirtualMachineEngine::HandleLocalPending() {
   OF_PROFILER_RANGE_PUSH("HandleLocalPending");
   InstructionMsgList pending_instr_msgs;
-  constexpr static int kPendingHandleWindow = 10;
-  GetRewritedPendingInstructionsByWindowSize(kPendingHandleWindow, &pending_instr_msgs);
+  if (DependenceAwareFuseEnabled()) {
+    GetRewritedPendingInstructionsByDependence(PendingHandleWindowSize(), &pending_instr_msgs);
+  } else {
+    GetRewritedPendingInstructionsByWindowSize(PendingHandleWindowSize(), &pending_instr_msgs);
+  }
   InstructionList new_instruction_list;
   INTRUSIVE_FOR_EACH_PTR(instr_msg, &pending_instr_msgs) {
     MakeInstructions(instr_msg, /*out*/ &new_instruction_list);
@@ -69,6 +121,7 @@ void VirtualMachineEngine::HandleLocalPending() {
   INTRUSIVE_FOR_EACH_PTR(instruction, &new_instruction_list) {
     ConsumeMirroredObjects(instruction);
     if (likely(Dispatchable(instruction))) {
+      TraceTimestamp(instruction->mut_instr_msg(), &profiler::InstructionTimestamps::ready);
       mut_ready_instruction_list()->PushBack(instruction);
       new_instruction_list.Erase(instruction);
     }
@@ -97,6 +150,20 @@ bool FusableBetween(InstructionFuseType fuse_type, InstructionMsg* instr_msg,
   return true;
 }
 
+DependenceAwareFusePlanner::InstructionKind GetFuseInstructionKind(InstructionMsg* instr_msg) {
+  using InstructionKind = DependenceAwareFusePlanner::InstructionKind;
+  const auto& instruction_type = instr_msg->instr_type_id().instruction_type();
+  if (unlikely(instruction_type.IsFrontSequential() || instr_msg->phy_instr_operand() == nullptr
+               || instr_msg->phy_instr_stream() == nullptr)) {
+    return InstructionKind::kBarrier;
+  }
+  switch (instruction_type.fuse_type()) {
+    case kEnableInstructionFuseAtAnyPosition: return InstructionKind::kFusable;
+    case kEnableInstructionFuseAsTailOnly: return InstructionKind::kFusableAsTail;
+    default: return InstructionKind::kUnfusable;
+  }
+}
+
 }  // namespace
 
 void VirtualMachineEngine::MakeAndAppendFusedInstruction(
@@ -107,11 +174,23 @@ void VirtualMachineEngine::MakeAndAppendFusedInstruction(
     return;
   }
   auto* begin = fused_instr_msg_list.Begin();
-  auto phy_instr_operand = std::make_shared<FusePhyInstrOperand>(std::move(fused_instr_msg_list));
+  int64_t enqueue_timestamp = 0;
+  if (unlikely(profiler::InstructionTraceEnabled())) {
+    enqueue_timestamp = begin->trace_timestamps().enqueue;
+    INTRUSIVE_UNSAFE_FOR_EACH_PTR(instr_msg, &fused_instr_msg_list) {
+      enqueue_timestamp = std::min(enqueue_timestamp, instr_msg->trace_timestamps().enqueue);
+    }
+  }
+  const int64_t fused_instr_msg_cnt = fused_instr_msg_list.size();
+  auto phy_instr_operand =
+      obj_pool::make_shared<FusePhyInstrOperand>(std::move(fused_instr_msg_list));
   const auto* stream_tag = begin->phy_instr_stream()->stream_type().stream_tag();
-  auto instr_msg = intrusive::make_shared<InstructionMsg>(
+  auto instr_msg = NewInstructionMsg(
       this, std::string(stream_tag) + ".Fuse", begin->phy_instr_parallel_desc(), phy_instr_operand);
+  // The fused instruction is traced as if it was received with its earliest member.
+  instr_msg->mut_trace_timestamps()->enqueue = enqueue_timestamp;
   pending_instr_msgs->EmplaceBack(std::move(instr_msg));
+  unfinished_instr_msg_cnt_.fetch_sub(fused_instr_msg_cnt - 1, std::memory_order_relaxed);
 }
 
 void VirtualMachineEngine::GetRewritedPendingInstructionsByWindowSize(
@@ -136,6 +215,25 @@ void VirtualMachineEngine::GetRewritedPendingInstructionsByWindowSize(
   MakeAndAppendFusedInstruction(std::move(fused_instr_msg_list), pending_instr_msgs);
 }
 
+// Unlike GetRewritedPendingInstructionsByWindowSize, fusable instructions are not required to be
+// consecutive. An instruction joins the open fuse group of its stream and stream sequential
+// dependence as long as no instruction between them in the window conflicts with it, so
+// independent instructions interleaved with other streams are batched into one instruction.
+void VirtualMachineEngine::GetRewritedPendingInstructionsByDependence(
+    size_t window_size, InstructionMsgList* /*out*/ pending_instr_msgs) {
+  std::vector<std::unique_ptr<InstructionMsgList>> slots;
+  DependenceAwareFusePlanner planner;
+  INTRUSIVE_FOR_EACH_PTR(instr_msg, mut_local_pending_msg_list()) {
+    if (window_size-- <= 0) { break; }
+    const size_t slot =
+        planner.Add(GetFuseInstructionKind(instr_msg), instr_msg->phy_instr_stream(),
+                    instr_msg->phy_instr_operand().get());
+    if (slot == slots.size()) { slots.emplace_back(new InstructionMsgList()); }
+    mut_local_pending_msg_list()->MoveToDstBack(instr_msg, slots.at(slot).get());
+  }
+  for (auto& slot : slots) { MakeAndAppendFusedInstruction(std::move(*slot), pending_instr_msgs); }
+}
+
 std::string VirtualMachineEngine::GetLivelyInstructionListDebugString(int64_t debug_cnt) {
   std::stringstream ss;
   INTRUSIVE_UNSAFE_FOR_EACH_PTR(instruction, mut_lively_instruction_list()) {
@@ -171,6 +269,7 @@ void VirtualMachineEngine::HandleLocalProbe() {
 intrusive::shared_ptr<Instruction> VirtualMachineEngine::LivelyInstructionListErase(
     Instruction* instruction) {
   ++total_erased_lively_instruction_cnt_;
+  unfinished_instr_msg_cnt_.fetch_sub(1, std::memory_order_release);
   auto ret = mut_lively_instruction_list()->Erase(instruction);
   static constexpr int kProbeInterval = 20;
   if (unlikely(total_erased_lively_instruction_cnt_ % kProbeInterval) == 0) { HandleProbe(); }
@@ -180,10 +279,17 @@ intrusive::shared_ptr<Instruction> VirtualMachineEngine::LivelyInstructionListEr
 // Collect ready instructions onto ready_instruction_list_
 void VirtualMachineEngine::ReleaseFinishedInstructions() {
   INTRUSIVE_FOR_EACH_PTR(stream, mut_active_stream_list()) {
+    // When the device has caught up with an in-order stream, querying its last instruction
+    // releases the whole running list instead of querying every instruction's event.
+    const auto* last = stream->mut_running_instruction_list()->Last();
+    const bool all_done = stream->stream_type().CompletesInOrder() && last != nullptr
+                          && last->Done();
     while (true) {
       auto* instruction_ptr = stream->mut_running_instruction_list()->Begin();
-      if (instruction_ptr == nullptr || !instruction_ptr->Done()) { break; }
+      if (instruction_ptr == nullptr || !(all_done || instruction_ptr->Done())) { break; }
+      TraceTimestamp(instruction_ptr->mut_instr_msg(), &profiler::InstructionTimestamps::complete);
       ReleaseInstruction(instruction_ptr);
+      TraceReleasedInstruction(instruction_ptr);
       stream->mut_running_instruction_list()->Erase(instruction_ptr);
       // By referencing `instruction_ptr->mut_instr_msg()`, we can avoid instr_msg being destructed
       // in stream->DeleteInstruction(...)
@@ -200,7 +306,7 @@ void VirtualMachineEngine::MoveInstructionMsgToGarbageMsgList(
   local_garbage_msg_list_.EmplaceBack(std::move(instr_msg));
   static constexpr int kWindowSize = 32;
   // local_garbage_msg_list_ is the cache of garbage_msg_list_.
-  // `kWindowSize` controls the frequency of the usage of mutexed list.
+  // `kWindowSize` controls the frequency of the usage of the shared garbage_msg_list_.
   if (unlikely(local_garbage_msg_list_.size() > kWindowSize)) { MoveToGarbageMsgListAndNotifyGC(); }
 }
 
@@ -220,6 +326,7 @@ void VirtualMachineEngine::MakeInstructions(InstructionMsg* instr_msg,
   bool is_barrier_instruction = instruction_type.IsFrontSequential();
   Stream* stream = CHECK_NOTNULL(instr_msg->phy_instr_stream());
   const auto& pd = instr_msg->phy_instr_parallel_desc();
+  TraceTimestamp(instr_msg, &profiler::InstructionTimestamps::schedule);
   intrusive::shared_ptr<Instruction> instr = stream->NewInstruction(instr_msg, pd);
   LivelyInstructionListPushBack(instr.Mutable());
   if (unlikely(is_barrier_instruction)) {
@@ -323,6 +430,7 @@ void VirtualMachineEngine::DispatchAndPrescheduleInstructions() {
       auto* out_instruction = edge->mut_dst_instruction();
       if (Dispatchable(out_instruction)) {
         OF_PROFILER_RANGE_PUSH("P:" + out_instruction->instr_msg().DebugName());
+        TraceTimestamp(out_instruction->mut_instr_msg(), &profiler::InstructionTimestamps::ready);
         mut_ready_instruction_list()->PushBack(out_instruction);
         OF_PROFILER_RANGE_POP();
       }
@@ -333,6 +441,7 @@ void VirtualMachineEngine::DispatchAndPrescheduleInstructions() {
 }
 
 void VirtualMachineEngine::DispatchInstruction(Instruction* instruction) {
+  TraceTimestamp(instruction->mut_instr_msg(), &profiler::InstructionTimestamps::dispatch);
   auto* stream = instruction->mut_stream();
   stream->mut_running_instruction_list()->PushBack(instruction);
   if (stream->active_stream_hook().empty()) { mut_active_stream_list()->PushBack(stream); }
@@ -405,6 +514,14 @@ Maybe<bool> VirtualMachineEngine::Receive(InstructionMsgList* compute_instr_msg_
     OF_PROFILER_RANGE_PUSH(compute_instr_msg->DebugName());
     OF_PROFILER_RANGE_POP();
   }
+  if (unlikely(profiler::InstructionTraceEnabled())) {
+    const int64_t now = profiler::InstructionTraceNow();
+    INTRUSIVE_UNSAFE_FOR_EACH_PTR(compute_instr_msg, compute_instr_msg_list) {
+      *compute_instr_msg->mut_trace_timestamps() = profiler::InstructionTimestamps();
+      compute_instr_msg->mut_trace_timestamps()->enqueue = now;
+    }
+  }
+  unfinished_instr_msg_cnt_.fetch_add(compute_instr_msg_list->size(), std::memory_order_relaxed);
   bool old_list_empty = mut_pending_msg_list()->MoveFrom(compute_instr_msg_list);
   OF_PROFILER_RANGE_POP();
   return old_list_empty;
@@ -505,18 +622,14 @@ void VirtualMachineEngine::Schedule() {
   // Try run the first barrier instruction.
   if (unlikely(mut_barrier_instruction_list()->size())) { TryRunBarrierInstruction(); }
   // Handle pending instructions, and try schedule them to ready list.
-  // Use thread_unsafe_size to avoid acquiring mutex lock.
-  // The inconsistency between pending_msg_list.list_head_.list_head_.container_ and
-  // pending_msg_list.list_head_.list_head_.size_ is not a fatal error because
-  // VirtualMachineEngine::Schedule is always in a buzy loop. All instructions will get handled
-  // eventually.
-  //  VirtualMachineEngine::Receive may be less effiencient if the thread safe version
-  //  `pending_msg_list().size()` used here, because VirtualMachineEngine::Schedule is more likely
-  //  to get the mutex lock.
+  // Use thread_unsafe_size to avoid a memory fence.
+  // pending_msg_list().thread_unsafe_size() may be greater than the number of published
+  // instructions. It is not a fatal error because VirtualMachineEngine::Schedule is always in a
+  // buzy loop. All instructions will get handled eventually.
   if (unlikely(local_pending_msg_list().size())) {
     HandleLocalPending();
   } else if (unlikely(pending_msg_list().thread_unsafe_size())) {
-    // MoveTo is under a lock.
+    // MoveTo is lock-free.
     mut_pending_msg_list()->MoveTo(mut_local_pending_msg_list());
     HandleLocalPending();
   }
@@ -545,7 +658,6 @@ bool VirtualMachineEngine::ThreadUnsafeEmpty() const {
 }
 
 bool VirtualMachineEngine::Empty() const {
-  // hook and size will be check in pending_msg_list().empty().
   return pending_msg_list().empty() && ThreadUnsafeEmpty();
 }
 
@@ -28,6 +28,7 @@ limitations under the License.
 #include "oneflow/core/common/range.h"
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/intrusive/mutexed_list.h"
+#include "oneflow/core/intrusive/mpsc_list.h"
 #include "oneflow/core/intrusive/object_pool.h"
 #include "oneflow/core/vm/probe.h"
 
@@ -46,8 +47,9 @@ class VirtualMachineEngine final : public intrusive::Base {
       intrusive::List<INTRUSIVE_FIELD(Instruction, lively_instruction_hook_)>;
   using BarrierInstructionList =
       intrusive::List<INTRUSIVE_FIELD(Instruction, barrier_instruction_hook_)>;
-  using InstructionMsgMutexedList =
-      intrusive::MutexedList<INTRUSIVE_FIELD(InstructionMsg, InstructionMsg::instr_msg_hook_)>;
+  using InstructionMsgMpscList =
+      intrusive::MpscList<INTRUSIVE_FIELD(InstructionMsg, InstructionMsg::instr_msg_hook_),
+                          INTRUSIVE_FIELD(InstructionMsg, InstructionMsg::instr_msg_mpsc_hook_)>;
   using StreamType2StreamRtDesc =
       intrusive::SkipList<INTRUSIVE_FIELD(StreamRtDesc, stream_type_key_)>;
 
@@ -61,6 +63,11 @@ class VirtualMachineEngine final : public intrusive::Base {
   std::size_t flying_instruction_cnt() const {
     return pending_msg_list().thread_unsafe_size() + lively_instruction_list_.size();
   }
+  // Received instruction messages not finished yet, counted apart from the scheduler so that other
+  // threads can tell the vm is idle. The messages fused into one count as one once fused.
+  int64_t unfinished_instr_msg_cnt() const {
+    return unfinished_instr_msg_cnt_.load(std::memory_order_acquire);
+  }
   size_t total_inserted_lively_instruction_cnt() const {
     return total_inserted_lively_instruction_cnt_;
   }
@@ -74,7 +81,7 @@ class VirtualMachineEngine final : public intrusive::Base {
   const BarrierInstructionList& barrier_instruction_list() const {
     return barrier_instruction_list_;
   }
-  const InstructionMsgMutexedList& pending_msg_list() const { return pending_msg_list_; }
+  const InstructionMsgMpscList& pending_msg_list() const { return pending_msg_list_; }
   const InstructionMsgList& local_pending_msg_list() const { return local_pending_msg_list_; }
   const StreamType2StreamRtDesc& stream_type2stream_rt_desc() const {
     return stream_type2stream_rt_desc_;
@@ -89,9 +96,9 @@ class VirtualMachineEngine final : public intrusive::Base {
   ThreadCtxList* mut_thread_ctx_list() { return &thread_ctx_list_; }
   LivelyInstructionList* mut_lively_instruction_list() { return &lively_instruction_list_; }
   BarrierInstructionList* mut_barrier_instruction_list() { return &barrier_instruction_list_; }
-  InstructionMsgMutexedList* mut_pending_msg_list() { return &pending_msg_list_; }
+  InstructionMsgMpscList* mut_pending_msg_list() { return &pending_msg_list_; }
   InstructionMsgList* mut_local_pending_msg_list() { return &local_pending_msg_list_; }
-  InstructionMsgMutexedList* mut_garbage_msg_list() { return &garbage_msg_list_; }
+  InstructionMsgMpscList* mut_garbage_msg_list() { return &garbage_msg_list_; }
   StreamType2StreamRtDesc* mut_stream_type2stream_rt_desc() { return &stream_type2stream_rt_desc_; }
 
   // methods
@@ -134,6 +141,8 @@ class VirtualMachineEngine final : public intrusive::Base {
   void HandleLocalPending();
   void GetRewritedPendingInstructionsByWindowSize(size_t window_size,
                                                   InstructionMsgList* /*out*/ pending_instr_msgs);
+  void GetRewritedPendingInstructionsByDependence(size_t window_size,
+                                                  InstructionMsgList* /*out*/ pending_instr_msgs);
   void MakeAndAppendFusedInstruction(InstructionMsgList&& fused_instr_msg_list,
                                      InstructionMsgList* /*out*/ pending_instr_msgs);
   void TryRunBarrierInstruction();
@@ -170,17 +179,16 @@ class VirtualMachineEngine final : public intrusive::Base {
         active_stream_list_(),
         thread_ctx_list_(),
         stream_type2stream_rt_desc_(),
-        pending_msg_mutex_(),
-        pending_msg_list_(&pending_msg_mutex_),
+        pending_msg_list_(),
         local_pending_msg_list_(),
-        callback_msg_mutex_(),
-        garbage_msg_list_(&callback_msg_mutex_),
+        garbage_msg_list_(),
         local_garbage_msg_list_(),
         notify_callback_thread_([]() {}),
         ready_instruction_list_(),
         lively_instruction_list_(),
         total_inserted_lively_instruction_cnt_(0),
         total_erased_lively_instruction_cnt_(0),
+        unfinished_instr_msg_cnt_(0),
         probe_mutex_(),
         probe_list_(&probe_mutex_),
         local_probe_list_(),
@@ -195,12 +203,12 @@ class VirtualMachineEngine final : public intrusive::Base {
   ActiveStreamList active_stream_list_;
   ThreadCtxList thread_ctx_list_;
   StreamType2StreamRtDesc stream_type2stream_rt_desc_;
-  std::mutex pending_msg_mutex_;
-  InstructionMsgMutexedList pending_msg_list_;
+  // pending_msg_list_ is produced by VirtualMachineEngine::Receive and consumed by the scheduler.
+  InstructionMsgMpscList pending_msg_list_;
   // local_pending_msg_list_ should be consider as the cache of pending_msg_list_.
   InstructionMsgList local_pending_msg_list_;
-  std::mutex callback_msg_mutex_;
-  InstructionMsgMutexedList garbage_msg_list_;
+  // garbage_msg_list_ is produced by the scheduler and consumed by the callback thread.
+  InstructionMsgMpscList garbage_msg_list_;
   // local_garbage_msg_list_ should be consider as the cache of garbage_msg_list_.
   InstructionMsgList local_garbage_msg_list_;
   std::function<void()> notify_callback_thread_;
@@ -208,6 +216,7 @@ class VirtualMachineEngine final : public intrusive::Base {
   LivelyInstructionList lively_instruction_list_;
   size_t total_inserted_lively_instruction_cnt_;
   size_t total_erased_lively_instruction_cnt_;
+  std::atomic<int64_t> unfinished_instr_msg_cnt_;
   std::mutex probe_mutex_;
   intrusive::MutexedList<INTRUSIVE_FIELD(Probe, Probe::probe_hook_)> probe_list_;
   intrusive::List<INTRUSIVE_FIELD(Probe, Probe::probe_hook_)> local_probe_list_;
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_IR_INCLUDE_ONEFLOW_CONVERSION_ONEFLOWTOTOSA_H_
 
 #include "mlir/Dialect/Tosa/IR/TosaOps.h"
+#include "mlir/IR/PatternMatch.h"
 #include "mlir/Pass/Pass.h"
 
 namespace mlir {
@@ -24,6 +25,8 @@ namespace mlir {
 namespace oneflow {
 
 std::unique_ptr<mlir::Pass> createLowerOneFlowToTosaPass();
+// Lowerings of the element-wise and broadcast ops which the elementwise JIT fusion outlines.
+void populateLowerOneFlowElementwiseToTosaPatterns(RewritePatternSet& patterns);
 
 }  // namespace oneflow
 
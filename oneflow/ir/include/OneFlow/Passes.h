@@ -45,6 +45,9 @@ LogicalResult LowerModuleToLLVM(mlir::MLIRContext* context, ModuleOp module);
 LogicalResult LowerModuleToCUDALLVM(mlir::MLIRContext* context, ModuleOp module);
 #endif  // WITH_MLIR_CUDA_CODEGEN
 void populateFuserPasses(::mlir::RewritePatternSet& patterns);
+// Replaces every connected subgraph of element-wise and broadcast ops on a single GPU with a
+// mlir_jit op calling the outlined function.
+LogicalResult OutlineElementwiseSubgraphs(ModuleOp module);
 void populateFuserForExistingOp(::mlir::RewritePatternSet& patterns);
 void populateGpuHelperPatterns(::mlir::RewritePatternSet& patterns);
 
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "OneFlow/OneFlowOps.h"
 #include <iostream>
+#include <limits>
 #include <string>
 #include "OneFlow/OneFlowDialect.h"
 #include "OneFlow/Passes.h"
@@ -41,27 +42,28 @@ namespace mlir {
 
 namespace oneflow {
 
+// TOSA element-wise ops only broadcast between operands of the same rank, so prepend dimensions
+// of 1 to `value` until it has `rank` dimensions.
+Value ReshapeToRank(ConversionPatternRewriter& rewriter, Location loc, Value value, int64_t rank) {
+  auto value_type = value.getType().dyn_cast<RankedTensorType>();
+  if (!value_type || value_type.getRank() == rank) { return value; }
+  std::vector<int64_t> shape(rank - value_type.getRank(), 1);
+  shape.insert(shape.end(), value_type.getShape().begin(), value_type.getShape().end());
+  return rewriter
+      .create<tosa::ReshapeOp>(loc, RankedTensorType::get(shape, value_type.getElementType()),
+                               value, rewriter.getI64ArrayAttr(shape))
+      .output();
+}
+
+int64_t GetRank(Value value) { return value.getType().cast<RankedTensorType>().getRank(); }
+
 struct ScalarMulByTensorOpLowering final : public OpConversionPattern<ScalarMulByTensorOp> {
  public:
   using OpConversionPattern<ScalarMulByTensorOp>::OpConversionPattern;
 
   LogicalResult matchAndRewrite(ScalarMulByTensorOp op, OpAdaptor adaptor,
                                 ConversionPatternRewriter& rewriter) const override {
-    Value scalar = op.scalar();
-    if (auto scalar_type = scalar.getType().dyn_cast<RankedTensorType>()) {
-      auto rank = op.x().getType().dyn_cast<RankedTensorType>().getRank();
-      if (scalar_type.getRank() != rank) {
-        std::vector<int64_t> perm(rank);
-        std::fill(perm.begin(), perm.end(), 1);
-        scalar = rewriter
-                     .create<tosa::ReshapeOp>(
-                         op->getLoc(),
-                         RankedTensorType::get(
-                             perm, scalar.getType().cast<TensorType>().getElementType()),
-                         scalar, rewriter.getI64ArrayAttr(perm))
-                     .output();
-      }
-    }
+    Value scalar = ReshapeToRank(rewriter, op->getLoc(), op.scalar(), GetRank(op.x()));
     rewriter.replaceOpWithNewOp<tosa::MulOp>(
         op,
         /* output */ op->getResultTypes().front().cast<TensorType>(),
@@ -84,12 +86,153 @@ struct CastOpLowering final : public OpConversionPattern<CastOp> {
   }
 };
 
+template<typename OneFlowOp, typename TosaOp>
+struct BroadcastBinaryOpLowering final : public OpConversionPattern<OneFlowOp> {
+ public:
+  using OpConversionPattern<OneFlowOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OneFlowOp op, typename OneFlowOp::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const int64_t rank = std::max(GetRank(op.x()), GetRank(op.y()));
+    Value x = ReshapeToRank(rewriter, op->getLoc(), op.x(), rank);
+    Value y = ReshapeToRank(rewriter, op->getLoc(), op.y(), rank);
+    rewriter.replaceOpWithNewOp<TosaOp>(op, op.z().getType(), x, y);
+    return success();
+  }
+};
+
+struct BroadcastMulOpLowering final : public OpConversionPattern<BroadcastMulOp> {
+ public:
+  using OpConversionPattern<BroadcastMulOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(BroadcastMulOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const int64_t rank = std::max(GetRank(op.x()), GetRank(op.y()));
+    Value x = ReshapeToRank(rewriter, op->getLoc(), op.x(), rank);
+    Value y = ReshapeToRank(rewriter, op->getLoc(), op.y(), rank);
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, op.z().getType(), x, y,
+                                             rewriter.getIntegerAttr(rewriter.getI32Type(), 0));
+    return success();
+  }
+};
+
+// TOSA only divides integers, so floating point division is x * reciprocal(y).
+struct BroadcastDivOpLowering final : public OpConversionPattern<BroadcastDivOp> {
+ public:
+  using OpConversionPattern<BroadcastDivOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(BroadcastDivOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    const int64_t rank = std::max(GetRank(op.x()), GetRank(op.y()));
+    Value x = ReshapeToRank(rewriter, op->getLoc(), op.x(), rank);
+    Value y = ReshapeToRank(rewriter, op->getLoc(), op.y(), rank);
+    if (op.z().getType().cast<TensorType>().getElementType().isa<FloatType>()) {
+      Value reciprocal =
+          rewriter.create<tosa::ReciprocalOp>(op->getLoc(), y.getType(), y).output();
+      rewriter.replaceOpWithNewOp<tosa::MulOp>(op, op.z().getType(), x, reciprocal,
+                                               rewriter.getIntegerAttr(rewriter.getI32Type(), 0));
+    } else {
+      rewriter.replaceOpWithNewOp<tosa::DivOp>(op, op.z().getType(), x, y);
+    }
+    return success();
+  }
+};
+
+template<typename OneFlowOp, typename TosaOp>
+struct UnaryOpLowering final : public OpConversionPattern<OneFlowOp> {
+ public:
+  using OpConversionPattern<OneFlowOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(OneFlowOp op, typename OneFlowOp::Adaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOpWithNewOp<TosaOp>(op, op->getResultTypes().front(),
+                                        op->getOperand(0));
+    return success();
+  }
+};
+
+struct ReluOpLowering final : public OpConversionPattern<ReluOp> {
+ public:
+  using OpConversionPattern<ReluOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ReluOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOpWithNewOp<tosa::ReluNOp>(
+        op, op.y().getType(), op.x(),
+        rewriter.getI64IntegerAttr(std::numeric_limits<int64_t>::max()),
+        rewriter.getF32FloatAttr(std::numeric_limits<float>::max()));
+    return success();
+  }
+};
+
+struct SquareOpLowering final : public OpConversionPattern<SquareOp> {
+ public:
+  using OpConversionPattern<SquareOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(SquareOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, op.y().getType(), op.x(), op.x(),
+                                             rewriter.getIntegerAttr(rewriter.getI32Type(), 0));
+    return success();
+  }
+};
+
+// Returns the operand of scalar_add and scalar_mul as a constant of `rank` dimensions of 1.
+template<typename OneFlowOp>
+Value GetScalarOperand(ConversionPatternRewriter& rewriter, OneFlowOp op) {
+  auto out_type = op.out().getType().template cast<RankedTensorType>();
+  auto scalar_type =
+      RankedTensorType::get(std::vector<int64_t>(out_type.getRank(), 1), out_type.getElementType());
+  Attribute value;
+  if (out_type.getElementType().template isa<FloatType>()) {
+    double operand = op.has_float_operand() ? op.float_operand().convertToDouble()
+                                            : static_cast<double>(op.int_operand());
+    value = DenseElementsAttr::get(scalar_type,
+                                   rewriter.getFloatAttr(out_type.getElementType(), operand));
+  } else {
+    int64_t operand = op.has_int_operand() ? op.int_operand()
+                                           : static_cast<int64_t>(
+                                               op.float_operand().convertToDouble());
+    value = DenseElementsAttr::get(scalar_type,
+                                   rewriter.getIntegerAttr(out_type.getElementType(), operand));
+  }
+  return rewriter.create<tosa::ConstOp>(op->getLoc(), scalar_type, value).output();
+}
+
+struct ScalarAddOpLowering final : public OpConversionPattern<ScalarAddOp> {
+ public:
+  using OpConversionPattern<ScalarAddOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarAddOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    Value scalar = GetScalarOperand(rewriter, op);
+    rewriter.replaceOpWithNewOp<tosa::AddOp>(op, op.out().getType(), op.in(), scalar);
+    return success();
+  }
+};
+
+struct ScalarMulOpLowering final : public OpConversionPattern<ScalarMulOp> {
+ public:
+  using OpConversionPattern<ScalarMulOp>::OpConversionPattern;
+  LogicalResult matchAndRewrite(ScalarMulOp op, OpAdaptor adaptor,
+                                ConversionPatternRewriter& rewriter) const override {
+    Value scalar = GetScalarOperand(rewriter, op);
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, op.out().getType(), op.in(), scalar,
+                                             rewriter.getIntegerAttr(rewriter.getI32Type(), 0));
+    return success();
+  }
+};
+
 namespace {
 struct OneFlowLoweringToTosaPass : public LowerOneFlowToTosaPassBase<OneFlowLoweringToTosaPass> {
   void runOnOperation() override;
 };
 }  // namespace
 
+void populateLowerOneFlowElementwiseToTosaPatterns(RewritePatternSet& patterns) {
+  patterns.insert<BroadcastBinaryOpLowering<BroadcastAddOp, tosa::AddOp>,
+                  BroadcastBinaryOpLowering<BroadcastSubOp, tosa::SubOp>, BroadcastMulOpLowering,
+                  BroadcastDivOpLowering, UnaryOpLowering<TanhOp, tosa::TanhOp>,
+                  UnaryOpLowering<SigmoidOp, tosa::SigmoidOp>, UnaryOpLowering<ExpOp, tosa::ExpOp>,
+                  UnaryOpLowering<NegativeOp, tosa::NegateOp>,
+                  UnaryOpLowering<ReciprocalOp, tosa::ReciprocalOp>,
+                  UnaryOpLowering<RsqrtOp, tosa::RsqrtOp>, ReluOpLowering, SquareOpLowering,
+                  ScalarAddOpLowering, ScalarMulOpLowering>(patterns.getContext());
+}
+
 std::unique_ptr<Pass> createLowerOneFlowToTosaPass() {
   return std::make_unique<OneFlowLoweringToTosaPass>();
 }
@@ -100,6 +243,7 @@ void OneFlowLoweringToTosaPass::runOnOperation() {
   target.addIllegalDialect<OneFlowDialect>();
   RewritePatternSet patterns(&getContext());
   patterns.insert<CastOpLowering, ScalarMulByTensorOpLowering>(&getContext());
+  populateLowerOneFlowElementwiseToTosaPatterns(patterns);
   if (failed(applyPartialConversion(getOperation(), target, std::move(patterns)))) {
     getOperation()->dump();
     signalPassFailure();
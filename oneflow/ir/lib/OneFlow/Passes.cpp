@@ -51,7 +51,10 @@ limitations under the License.
 #include "mlir/Conversion/SCFToGPU/SCFToGPUPass.h"
 #endif  // WITH_MLIR_CUDA_CODEGEN
 
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
 
 #include <iostream>
 #include <string>
@@ -238,6 +241,159 @@ static StringRef sanitizeIdentifier(StringRef name, SmallString<16>& buffer,
   return {};
 }
 
+namespace {
+
+// Only for outlining outside of the pattern driver.
+class OutlineRewriter final : public PatternRewriter {
+ public:
+  explicit OutlineRewriter(MLIRContext* context) : PatternRewriter(context) {}
+};
+
+bool IsElementwiseJitType(Type type) {
+  auto tensor_type = type.dyn_cast<RankedTensorType>();
+  if (!tensor_type || !tensor_type.hasStaticShape()) { return false; }
+  // The data types the mlir_jit kernels are registered for.
+  Type element_type = tensor_type.getElementType();
+  return element_type.isF32() || element_type.isF64() || element_type.isSignlessInteger(32)
+         || element_type.isSignlessInteger(64);
+}
+
+bool IsElementwiseJitFusable(Operation* op) {
+#ifdef WITH_MLIR_CUDA_CODEGEN
+  if (!llvm::isa<CastOp, ScalarMulByTensorOp, ScalarAddOp, ScalarMulOp, BroadcastAddOp,
+                 BroadcastSubOp, BroadcastMulOp, BroadcastDivOp, ReluOp, TanhOp, SigmoidOp, ExpOp,
+                 NegativeOp, ReciprocalOp, RsqrtOp, SquareOp>(op)) {
+    return false;
+  }
+  auto device_tag =
+      op->getAttrOfType<StringAttr>(OpTrait::IsOpConfCompatible<void>::getDeviceTagAttr());
+  if (!device_tag || (device_tag.getValue() != "cuda" && device_tag.getValue() != "gpu")) {
+    return false;
+  }
+  // The function is compiled for the logical shapes, which are the physical shapes only when the
+  // op is placed on a single device.
+  auto hierarchy =
+      op->getAttrOfType<ArrayAttr>(OpTrait::IsOpConfCompatible<void>::getHierarchyAttr());
+  if (!hierarchy) { return false; }
+  for (Attribute dim : hierarchy) {
+    if (dim.cast<IntegerAttr>().getInt() != 1) { return false; }
+  }
+  return llvm::all_of(op->getOperandTypes(), IsElementwiseJitType)
+         && llvm::all_of(op->getResultTypes(), IsElementwiseJitType);
+#else
+  return false;
+#endif  // WITH_MLIR_CUDA_CODEGEN
+}
+
+bool IsSamePlacement(Operation* a, Operation* b) {
+  const auto device_tag = OpTrait::IsOpConfCompatible<void>::getDeviceTagAttr();
+  const auto device_name = OpTrait::IsOpConfCompatible<void>::getDeviceNameAttr();
+  return a->getAttr(device_tag) == b->getAttr(device_tag)
+         && a->getAttr(device_name) == b->getAttr(device_name);
+}
+
+// Returns the connected components of the runs of consecutive fusable ops. Ops are in
+// topological order in the block, so no path leaves such a component and comes back to it, and
+// every component can be replaced by one op at the position of its last op.
+SmallVector<SmallVector<Operation*, 8>, 4> FindElementwiseClusters(Block& block) {
+  SmallVector<SmallVector<Operation*, 8>, 4> clusters;
+  SmallVector<Operation*, 8> run;
+  auto FlushRun = [&]() {
+    llvm::EquivalenceClasses<Operation*> components;
+    for (Operation* op : run) { components.insert(op); }
+    for (Operation* op : run) {
+      for (Value operand : op->getOperands()) {
+        Operation* def = operand.getDefiningOp();
+        if (def && components.findValue(def) != components.end()) {
+          components.unionSets(def, op);
+        }
+      }
+    }
+    llvm::MapVector<Operation*, SmallVector<Operation*, 8>> leader2ops;
+    for (Operation* op : run) { leader2ops[components.getLeaderValue(op)].push_back(op); }
+    for (auto& pair : leader2ops) {
+      if (pair.second.size() > 1) { clusters.push_back(std::move(pair.second)); }
+    }
+    run.clear();
+  };
+  for (Operation& op : block) {
+    if (!IsElementwiseJitFusable(&op)) {
+      FlushRun();
+      continue;
+    }
+    if (!run.empty() && !IsSamePlacement(run.front(), &op)) { FlushRun(); }
+    run.push_back(&op);
+  }
+  FlushRun();
+  return clusters;
+}
+
+}  // namespace
+
+LogicalResult OutlineElementwiseCluster(::mlir::PatternRewriter& rewriter,
+                                        ArrayRef<Operation*> cluster) {
+  llvm::SmallPtrSet<Operation*, 8> in_cluster(cluster.begin(), cluster.end());
+  llvm::SetVector<Value> operands;
+  SmallVector<Value, 4> results;
+  for (Operation* op : cluster) {
+    for (Value operand : op->getOperands()) {
+      Operation* def = operand.getDefiningOp();
+      if (!def || !in_cluster.contains(def)) { operands.insert(operand); }
+    }
+    for (Value result : op->getResults()) {
+      if (llvm::any_of(result.getUsers(),
+                       [&](Operation* user) { return !in_cluster.contains(user); })) {
+        results.push_back(result);
+      }
+    }
+  }
+  if (results.empty()) { return success(); }
+  Operation* last_op = cluster.back();
+  auto GetOpName = [](Operation* op) {
+    return op->getAttrOfType<StringAttr>(OpTrait::IsOpConfCompatible<void>::getOpNameAttr())
+        .getValue();
+  };
+  SmallString<64> op_name_storage;
+  auto op_name = (GetOpName(cluster.front()) + "__FUSE__" + GetOpName(last_op))
+                     .toStringRef(op_name_storage);
+  SmallString<16> tempBuffer;
+  op_name = sanitizeIdentifier(op_name, tempBuffer);
+  SmallVector<Value, 4> operand_values(operands.begin(), operands.end());
+  SmallVector<Operation*, 4> ops(cluster.begin(), cluster.end());
+  rewriter.setInsertionPoint(last_op);
+  NamedAttrList attributes =
+      GetJitOpAttributes(rewriter, op_name, operand_values.size(), results.size(), last_op);
+  auto function =
+      GetOrInsertFuncOp(rewriter, last_op->getLoc(), op_name, operand_values, results, ops);
+  if (!function) { return failure(); }
+  auto created =
+      rewriter.create<MlirJitOp>(last_op->getLoc(), function, attributes, operand_values);
+  if (failed(DumpAssembly(rewriter, created))) { return failure(); }
+  for (auto pair : llvm::zip(results, created->getResults())) {
+    std::get<0>(pair).replaceUsesWithIf(std::get<1>(pair), [&](OpOperand& use) {
+      return !in_cluster.contains(use.getOwner());
+    });
+  }
+  for (Operation* op : llvm::reverse(cluster)) { op->erase(); }
+  return success();
+}
+
+LogicalResult OutlineElementwiseSubgraphs(ModuleOp module) {
+  SmallVector<SmallVector<Operation*, 8>, 4> clusters;
+  module.walk([&](oneflow::Job job) {
+    for (Block& block : job.body()) {
+      for (auto& cluster : FindElementwiseClusters(block)) {
+        clusters.push_back(std::move(cluster));
+      }
+    }
+  });
+  OutlineRewriter rewriter(module->getContext());
+  for (const auto& cluster : clusters) {
+    if (failed(OutlineElementwiseCluster(rewriter, cluster))) { return failure(); }
+  }
+  return success();
+}
+
 ::llvm::SmallVector<::mlir::Value, 4> CreateGPUMemcpyOpFromMemrefCopy(
     ::mlir::PatternRewriter& rewriter, ::mlir::memref::CopyOp copyOp) {
   // NOTE: to get lowered to LLVM, it has to be async
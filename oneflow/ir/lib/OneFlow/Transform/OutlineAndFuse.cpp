@@ -32,6 +32,12 @@ class OutlineJitFunctionPass : public OutlineJitFunctionPassBase<OutlineJitFunct
   }
 };
 
+class OutlineElementwiseJitPass : public OutlineElementwiseJitPassBase<OutlineElementwiseJitPass> {
+  void runOnOperation() override {
+    if (failed(oneflow::OutlineElementwiseSubgraphs(getOperation()))) { signalPassFailure(); }
+  }
+};
+
 class FuseIntoExistingOpPass : public FuseIntoExistingOpPassBase<FuseIntoExistingOpPass> {
   void runOnOperation() override {
     Operation* op = getOperation();
@@ -51,6 +57,10 @@ std::unique_ptr<Pass> createOutlineJitFunctionPass() {
   return std::make_unique<OutlineJitFunctionPass>();
 }
 
+std::unique_ptr<Pass> createOutlineElementwiseJitPass() {
+  return std::make_unique<OutlineElementwiseJitPass>();
+}
+
 std::unique_ptr<Pass> createFuseIntoExistingOpPass() {
   return std::make_unique<FuseIntoExistingOpPass>();
 }
@@ -40,33 +40,66 @@ const SharedLibs* SharedLibPaths() { return MutSharedLibPaths(); }
 
 namespace {
 
+void RegisterJitDialects(mlir::DialectRegistry& registry) {
+  registry
+      .insert<mlir::oneflow::OneFlowDialect, mlir::StandardOpsDialect, mlir::memref::MemRefDialect,
+              mlir::tosa::TosaDialect, mlir::linalg::LinalgDialect>();
+}
+
+Maybe<DataType> GetDataTypeFromMlirType(mlir::Type type) {
+  if (type.isF32()) { return DataType::kFloat; }
+  if (type.isF64()) { return DataType::kDouble; }
+  if (type.isF16()) { return DataType::kFloat16; }
+  if (type.isSignlessInteger(32)) { return DataType::kInt32; }
+  if (type.isSignlessInteger(64)) { return DataType::kInt64; }
+  if (type.isSignlessInteger(8)) { return DataType::kInt8; }
+  UNIMPLEMENTED_THEN_RETURN() << "unsupported MLIR type of mlir_jit output";
+}
+
+// The outlined function has the static logical shapes of its results, which are the outputs.
+Maybe<void> ForEachOutputType(
+    user_op::InferContext* ctx,
+    const std::function<Maybe<void>(int32_t, mlir::RankedTensorType)>& Handler) {
+  mlir::DialectRegistry registry;
+  RegisterJitDialects(registry);
+  mlir::MLIRContext mlir_ctx(registry);
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"), &mlir_ctx);
+  CHECK_OR_RETURN(!!module) << "fail to parse MLIR, op: " << ctx->op_name();
+  auto funcs = module->getOps<mlir::FuncOp>();
+  CHECK_OR_RETURN(!funcs.empty()) << "no function in the MLIR of op: " << ctx->op_name();
+  const auto& result_types = (*funcs.begin()).getType().getResults();
+  CHECK_EQ_OR_RETURN(result_types.size(), ctx->outputs().size());
+  for (int32_t i = 0; i < result_types.size(); ++i) {
+    auto tensor_type = result_types[i].dyn_cast<mlir::RankedTensorType>();
+    CHECK_OR_RETURN(tensor_type && tensor_type.hasStaticShape())
+        << "mlir_jit only supports outputs of static shapes, op: " << ctx->op_name();
+    JUST(Handler(i, tensor_type));
+  }
+  return Maybe<void>::Ok();
+}
+
 REGISTER_USER_OP("mlir_jit")
     .Attr<std::string>("mlir_assembly")
-    .Input("in")
-    .Output("out")
+    .InputWithMinimum("in", 1)
+    .OutputWithMinimum("out", 1)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
-      // TODO: infer shape by extracting Ops from mlir_assembly
-      CHECK_EQ(ctx->inputs().size(), 2);
-      CHECK_EQ(ctx->outputs().size(), 1);
-      const Shape& in_shape = ctx->InputShape("in", 0);
-      Shape* out_shape = ctx->OutputShape("out", 0);
-      *out_shape = in_shape;
-      *ctx->OutputDType("out", 0) = ctx->InputDType("in", 1);
-      return Maybe<void>::Ok();
+      return ForEachOutputType(ctx, [&](int32_t i, mlir::RankedTensorType type) -> Maybe<void> {
+        *ctx->OutputShape("out", i) =
+            Shape(DimVector(type.getShape().begin(), type.getShape().end()));
+        return Maybe<void>::Ok();
+      });
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
-      const user_op::TensorDesc& in_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
-      FOR_RANGE(int64_t, i, 0, in_tensor.shape().NumAxes()) {
-        ctx->NewBuilder()
-            .Split(user_op::OpArg("in", 0), i)
-            .Split(user_op::OpArg("out", 0), i)
-            .Build();
-      }
+      // The function is compiled for the logical shapes, so every device computes all of them.
+      ctx->NewBuilder().Broadcast(ctx->inputs()).Broadcast(ctx->outputs()).Build();
       return Maybe<void>::Ok();
     })
     .SetDataTypeInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
-      *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
-      return Maybe<void>::Ok();
+      return ForEachOutputType(ctx, [&](int32_t i, mlir::RankedTensorType type) -> Maybe<void> {
+        *ctx->OutputDType("out", i) = JUST(GetDataTypeFromMlirType(type.getElementType()));
+        return Maybe<void>::Ok();
+      });
     });
 
 using OpaqueMemRefDescriptor = std::shared_ptr<void>;
@@ -132,18 +165,19 @@ llvm::SmallVector<OpaqueMemRefDescriptor> GetMLIRCInterfaceArgs(
   return args;
 }
 
-void WithMlirContext(
-    user_op::KernelComputeContext* ctx, const llvm::SmallVector<llvm::StringRef, 4>& ext_libs,
-    const std::function<mlir::OwningOpRef<mlir::ModuleOp>(mlir::MLIRContext* mlir_ctx)>& parse,
+// Lowers the assembly and compiles it once for all the runs of the kernel.
+std::unique_ptr<mlir::ExecutionEngine> CompileJitEngine(
+    const std::string& op_name, const std::string& assembly,
     const std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>& lower) {
+  llvm::SmallVector<llvm::StringRef, 4> ext_libs(
+      {SharedLibPaths()->begin(), SharedLibPaths()->end()});
   mlir::DialectRegistry registry;
-  registry
-      .insert<mlir::oneflow::OneFlowDialect, mlir::StandardOpsDialect, mlir::memref::MemRefDialect,
-              mlir::tosa::TosaDialect, mlir::linalg::LinalgDialect>();
+  RegisterJitDialects(registry);
   mlir::registerLLVMDialectTranslation(registry);
   mlir::MLIRContext mlir_ctx(registry);
-  mlir::OwningOpRef<mlir::ModuleOp> module = parse(&mlir_ctx);
-  CHECK(!!module) << "fail to parse MLIR, op: " << ctx->op_name();
+  mlir::OwningOpRef<mlir::ModuleOp> module =
+      mlir::parseSourceString<mlir::ModuleOp>(assembly, &mlir_ctx);
+  CHECK(!!module) << "fail to parse MLIR, op: " << op_name;
   if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
@@ -153,14 +187,17 @@ void WithMlirContext(
     std::string mlir;
     llvm::raw_string_ostream os_mlir(mlir);
     module->print(os_mlir);
-    TeePersistentLogStream::Create(JoinPath("jit", ctx->op_name() + ".mlir"))->Write(mlir);
+    TeePersistentLogStream::Create(JoinPath("jit", op_name + ".mlir"))->Write(mlir);
   }
   auto jit_or_error = mlir::ExecutionEngine::create(
       /* m */ *module, /* llvmModuleBuilder */ nullptr, /* transformer */ {},
       /* jitCodeGenOptLevel */ llvm::None, /* sharedLibPaths */ ext_libs);
   CHECK(!!jit_or_error) << "failed to create JIT exe engine, "
                         << llvm::toString(jit_or_error.takeError());
-  auto jit = std::move(jit_or_error.get());
+  return std::move(jit_or_error.get());
+}
+
+void InvokeJitEngine(user_op::KernelComputeContext* ctx, mlir::ExecutionEngine* jit) {
   llvm::SmallVector<OpaqueMemRefDescriptor> args /* args must outlive JIT invocation */ =
       GetMLIRCInterfaceArgs(ctx);
   llvm::SmallVector<void*> packed_args{};
@@ -169,26 +206,38 @@ void WithMlirContext(
   CHECK(!error) << "fail to invoke jit engine, error: " << llvm::toString(std::move(error));
 }
 
+class MlirJitKernelState final : public user_op::OpKernelState {
+ public:
+  explicit MlirJitKernelState(std::unique_ptr<mlir::ExecutionEngine>&& engine)
+      : engine_(std::move(engine)) {}
+  ~MlirJitKernelState() override = default;
+
+  mlir::ExecutionEngine* engine() const { return engine_.get(); }
+
+ private:
+  std::unique_ptr<mlir::ExecutionEngine> engine_;
+};
+
 template<typename T>
 class MlirJitCpuKernel final : public user_op::OpKernel {
  public:
   MlirJitCpuKernel() = default;
   ~MlirJitCpuKernel() = default;
 
- private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<MlirJitKernelState>(CompileJitEngine(
+        ctx->op_name(), ctx->Attr<std::string>("mlir_assembly"),
         [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
           CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToLLVM(mlir_ctx, module)))
               << "fail to lower OneFlow to LLVM";
-        });
+        }));
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    InvokeJitEngine(ctx, CHECK_NOTNULL(dynamic_cast<MlirJitKernelState*>(state))->engine());
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -218,20 +267,20 @@ class MlirJitGpuKernel final : public user_op::OpKernel {
   MlirJitGpuKernel() = default;
   ~MlirJitGpuKernel() = default;
 
- private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<MlirJitKernelState>(CompileJitEngine(
+        ctx->op_name(), ctx->Attr<std::string>("mlir_assembly"),
         [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
           CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToCUDALLVM(mlir_ctx, module)))
               << "fail to lower OneFlow to CUDA LLVM";
-        });
+        }));
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    InvokeJitEngine(ctx, CHECK_NOTNULL(dynamic_cast<MlirJitKernelState*>(state))->engine());
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/framework/user_op_registry.h"
 #include "oneflow/core/framework/user_op_registry_manager.h"
 #include "oneflow/core/job/job_ir.h"
+#include "oneflow/core/job/compile_time_profile.h"
 
 namespace oneflow {
 
@@ -57,12 +58,21 @@ template<IRPassType ir_pass_type>
 class RoundTripOneFlowJobWrapper : public mlir::oneflow::RoundTripOneFlowJobWrapperInterface {
  public:
   explicit RoundTripOneFlowJobWrapper(::oneflow::Job* job)
-      : job_(job), op_graph_(*job), job_builder_(job), is_updated_(false) {}
+      : job_(job),
+        profile_("ir round trip " + IRPassTypeName<ir_pass_type>() + " of "
+                 + job->job_conf().job_name()),
+        op_graph_(*job),
+        job_builder_(job),
+        is_updated_(false) {
+    profile_.Tick("build op graph");
+  }
 
   const Job* job() const override { return job_; }
 
   bool IsLastIRPass() const override { return IsLastIRPassForIRPassType<ir_pass_type>(); }
 
+  void TickCompileTime(const std::string& step) override { profile_.Tick(step); }
+
   void UpdateJob(::oneflow::Job* new_job) override {
     CHECK(is_updated_ == false);
     job_->Swap(new_job);
@@ -144,6 +154,7 @@ class RoundTripOneFlowJobWrapper : public mlir::oneflow::RoundTripOneFlowJobWrap
 
  private:
   Job* job_;
+  CompileTimeProfile profile_;
   const OpGraph op_graph_;
   JobBuilder job_builder_;
   bool is_updated_;
@@ -159,17 +170,22 @@ bool IRRoundTrip<ir_pass_type>::IsEnabled(const JobPassCtx& ctx) const {
 template<IRPassType ir_pass_type>
 Maybe<void> IRRoundTrip<ir_pass_type>::Apply(Job* job, JobPassCtx* ctx) const {
   if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
-  const OpGraph op_graph(*job);
+  // Serializing a big job to text takes as long as translating it, so it is opt-in.
+  const bool dump_job = ParseBooleanFromEnv("ONEFLOW_MLIR_DUMP_IR", false);
   RoundTripOneFlowJobWrapper<ir_pass_type> w(job);
-  TeePersistentLogStream::Create(JoinPath(w.LogDir(), "job_before_ir_round_trip.prototxt"))
-      ->Write(*job);
+  if (dump_job) {
+    TeePersistentLogStream::Create(JoinPath(w.LogDir(), "job_before_ir_round_trip.prototxt"))
+        ->Write(*job);
+  }
   mlir::oneflow::RoundTripOneFlowJob(w, [](::oneflow::Job* job, std::string& reason) {
     // TODO: It is not clear how to define if extra boxing is introduced
     TODO();
     return true;
   });
-  TeePersistentLogStream::Create(JoinPath(w.LogDir(), "job_after_ir_round_trip.prototxt"))
-      ->Write(*job);
+  if (dump_job) {
+    TeePersistentLogStream::Create(JoinPath(w.LogDir(), "job_after_ir_round_trip.prototxt"))
+        ->Write(*job);
+  }
   return Maybe<void>::Ok();
 }
 
@@ -145,6 +145,8 @@ class RoundTripOneFlowJobWrapperInterface {
   virtual void TopoForEachOpConf(
       std::function<void(const ::oneflow::OperatorConf*)> Handler) const = 0;
   virtual bool IsLastIRPass() const = 0;
+  // Accounts the time since the previous step to the step in the compile time profile of the job.
+  virtual void TickCompileTime(const std::string& step) = 0;
 };
 
 void RoundTripOneFlowJob(
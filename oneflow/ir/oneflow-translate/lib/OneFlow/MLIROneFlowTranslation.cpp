@@ -42,6 +42,7 @@ limitations under the License.
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
+#include "mlir/Support/Timing.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Translation.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -764,7 +765,14 @@ Type JobImporter::GetInterfaceBlobConfType(const ::oneflow::InterfaceBlobConf& b
                                *data_type);
 }
 
+// Printing the module of a big job takes as long as translating it, so it is opt-in.
+bool IsRoundTripDumpEnabled() {
+  static const bool enabled = ::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_DUMP_IR", false);
+  return enabled;
+}
+
 void DumpMLIR(RoundTripOneFlowJobWrapperInterface& job_wrapper, ModuleOp module, std::string name) {
+  if (!IsRoundTripDumpEnabled()) { return; }
   std::string mlir;
   llvm::raw_string_ostream os_mlir(mlir);
   module->print(os_mlir);
@@ -772,8 +780,10 @@ void DumpMLIR(RoundTripOneFlowJobWrapperInterface& job_wrapper, ModuleOp module,
 }
 
 LogicalResult ApplyRoundTripPatterns(RoundTripOneFlowJobWrapperInterface& job_wrapper,
-                                     MLIRContext* context, OwningOpRef<ModuleOp>& module) {
+                                     MLIRContext* context, OwningOpRef<ModuleOp>& module,
+                                     TimingScope& timing_scope) {
   mlir::PassManager pm(context);
+  pm.enableTiming(timing_scope);
   // this canonicalizer should create concrete ops and create fuse opportunities
   pm.addPass(createCanonicalizerPass());
   std::string graphviz;
@@ -781,14 +791,21 @@ LogicalResult ApplyRoundTripPatterns(RoundTripOneFlowJobWrapperInterface& job_wr
     pm.addPass(oneflow::createOutlineJitFunctionPass());
   }
   pm.addPass(oneflow::createFuseIntoExistingOpPass());
+  // After the fusions into existing ops, which have hand-written kernels.
+  if (job_wrapper.IsLastIRPass()
+      && std::getenv("ONEFLOW_MLIR_ENABLE_ELEMENTWISE_JIT_FUSION") != nullptr) {
+    pm.addPass(oneflow::createOutlineElementwiseJitPass());
+  }
   pm.addPass(createCanonicalizerPass());
   llvm::raw_string_ostream os_graphviz(graphviz);
-  pm.addPass(createPrintOpGraphPass(os_graphviz));
+  if (IsRoundTripDumpEnabled()) { pm.addPass(createPrintOpGraphPass(os_graphviz)); }
   if (mlir::failed(pm.run(*module))) {
     module->emitError("Failed to run round-trip passes");
     return failure();
   }
-  job_wrapper.DumpLog("RoundTripOneFlowJob.optimized.mlir.dot", graphviz);
+  if (IsRoundTripDumpEnabled()) {
+    job_wrapper.DumpLog("RoundTripOneFlowJob.optimized.mlir.dot", graphviz);
+  }
   DumpMLIR(job_wrapper, module.get(), "RoundTripOneFlowJob.optimized");
   return success();
 }
@@ -812,13 +829,27 @@ void RoundTripOneFlowJob(
   context.getOrLoadDialect<oneflow::OneFlowDialect>();
   context.loadDialect<StandardOpsDialect>();
 
+  // The per pass break down of the round-trip passes, the total of which goes to the compile time
+  // profile of the job.
+  std::string pass_timing;
+  llvm::raw_string_ostream os_pass_timing(pass_timing);
+  DefaultTimingManager timing_manager;
+  timing_manager.setEnabled(::oneflow::ParseBooleanFromEnv("ONEFLOW_PROFILE_COMPILE_TIME", false));
+  timing_manager.setOutput(os_pass_timing);
   OwningOpRef<ModuleOp> module(
       ModuleOp::create(FileLineColLoc::get(&context, "", /*line=*/0, /*column=*/0)));
   JobImporter imp(job_wrapper, &context, module.get());
   // TODO: Add flag in job desc to decide whether to run mlir optimizer
   if (succeeded(imp.ProcessJob())) {
+    job_wrapper.TickCompileTime("translate job to IR");
     DumpMLIR(job_wrapper, module.get(), "RoundTripOneFlowJob.imported");
-    if (failed(ApplyRoundTripPatterns(job_wrapper, &context, module))) { exit(EXIT_FAILURE); }
+    {
+      TimingScope timing_scope = timing_manager.getRootScope();
+      if (failed(ApplyRoundTripPatterns(job_wrapper, &context, module, timing_scope))) {
+        exit(EXIT_FAILURE);
+      }
+    }
+    job_wrapper.TickCompileTime("round-trip passes");
     if (::oneflow::ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) {
       module->print(llvm::outs());
     }
@@ -828,6 +859,11 @@ void RoundTripOneFlowJob(
                    << job->job_conf().job_name() << "\n";
       exit(EXIT_FAILURE);
     }
+    job_wrapper.TickCompileTime("translate IR to job");
+    timing_manager.print();
+    if (!os_pass_timing.str().empty()) {
+      job_wrapper.DumpLog("RoundTripOneFlowJob.pass_timing.txt", pass_timing);
+    }
   } else {
     llvm::errs() << "fail to convert job to IR, job_name: " << job->job_conf().job_name() << "\n";
     exit(EXIT_FAILURE);
@@ -19,6 +19,8 @@ limitations under the License.
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
 #include "oneflow/core/common/buffer.h"
+#include "oneflow/core/profiler/data_reader_metrics.h"
+#include <iomanip>
 
 namespace oneflow {
 
@@ -26,6 +28,64 @@ namespace data {
 
 static const int32_t kDataReaderBatchBufferSize = 4;
 
+// Number of batches each stage of a DataReader may run ahead of the next one.
+inline int64_t DataReaderPrefetchDepth() {
+  return std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_DATA_READER_PREFETCH_DEPTH", kDataReaderBatchBufferSize), 1);
+}
+
+// Number of threads running Parser::Prepare, only used by parsers that have a prepare stage.
+inline int64_t DataReaderNumPrepareThreads() {
+  return std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_DATA_READER_NUM_PREPARE_THREADS", 2), 1);
+}
+
+// Logs the stage stats of each DataReader every this many batches, 0 disables it.
+inline int64_t DataReaderStatsInterval() {
+  return std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_DATA_READER_STATS_INTERVAL", 0), 0);
+}
+
+class DataReaderStageStats final {
+ public:
+  DataReaderStageStats() : num_batches_(0), elapsed_ns_(0) {}
+  ~DataReaderStageStats() = default;
+
+  void Add(int64_t elapsed_ns) {
+    num_batches_.fetch_add(1, std::memory_order_relaxed);
+    elapsed_ns_.fetch_add(elapsed_ns, std::memory_order_relaxed);
+  }
+
+  // Returns "<avg ms per batch>ms (<batches per second of busy time>/s)" and resets the stats.
+  std::string ToStringAndReset() {
+    const int64_t num_batches = num_batches_.exchange(0, std::memory_order_relaxed);
+    const int64_t elapsed_ns = elapsed_ns_.exchange(0, std::memory_order_relaxed);
+    if (num_batches == 0) { return "-"; }
+    const double avg_ms = elapsed_ns / 1e6 / num_batches;
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3) << avg_ms << "ms";
+    if (elapsed_ns > 0) {
+      ss << " (" << std::setprecision(1) << 1e9 * num_batches / elapsed_ns << "/s)";
+    }
+    return ss.str();
+  }
+
+ private:
+  std::atomic<int64_t> num_batches_;
+  std::atomic<int64_t> elapsed_ns_;
+};
+
+inline int64_t DataReaderNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// A DataReader runs up to three stages, each on its own threads and bounded by the prefetch depth:
+//   load:    loader_->Next() on the load thread (file I/O and the nested datasets),
+//   prepare: parser_->Prepare() on the prepare threads, if the parser has such a stage,
+//   parse:   parser_->Parse() into the outputs on the kernel compute thread.
+// Batches are handed to the prepare threads round robin, so the batch order is kept.
+// Each fetch that finds no batch ready stalls the kernel, and is recorded with the time it waited
+// in the data reader metrics of the profiler.
 template<typename LoadTarget>
 class DataReader {
  public:
@@ -33,29 +93,52 @@ class DataReader {
   using BatchType = std::vector<SampleType>;
 
   DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+      : op_name_(ctx->op_name()),
+        is_closed_(false),
+        prefetch_depth_(DataReaderPrefetchDepth()),
+        stats_interval_(DataReaderStatsInterval()),
+        num_read_batches_(0),
+        batch_buffer_(prefetch_depth_),
+        next_prepare_in_idx_(0),
+        next_prepare_out_idx_(0) {}
 
   virtual ~DataReader() {
     Close();
     if (load_thrd_.joinable()) { load_thrd_.join(); }
+    for (auto& thrd : prepare_thrds_) { thrd.join(); }
   }
 
   void Read(user_op::KernelComputeContext* ctx) {
     CHECK(load_thrd_.joinable()) << "You should call StartLoadThread before read data";
+    const int64_t fetch_start = DataReaderNowNs();
     auto batch = FetchBatchData();
+    const int64_t parse_start = DataReaderNowNs();
     parser_->Parse(batch, ctx);
+    const int64_t parse_end = DataReaderNowNs();
+    wait_stats_.Add(parse_start - fetch_start);
+    parse_stats_.Add(parse_end - parse_start);
+    num_read_batches_ += 1;
+    if (stats_interval_ > 0 && num_read_batches_ % stats_interval_ == 0) {
+      LOG(INFO) << "DataReader " << this << " after " << num_read_batches_
+                << " batches, per batch: load " << load_stats_.ToStringAndReset() << ", prepare "
+                << prepare_stats_.ToStringAndReset() << ", wait "
+                << wait_stats_.ToStringAndReset() << ", parse " << parse_stats_.ToStringAndReset();
+    }
   }
 
   void Close() {
     if (!is_closed_.load()) {
       is_closed_.store(true);
       batch_buffer_.Close();
+      for (auto& buffer : prepare_in_buffers_) { buffer->Close(); }
+      for (auto& buffer : prepare_out_buffers_) { buffer->Close(); }
     }
   }
 
  protected:
   void StartLoadThread() {
     if (load_thrd_.joinable()) { return; }
+    if (parser_ && parser_->HasPrepare()) { StartPrepareThreads(DataReaderNumPrepareThreads()); }
     load_thrd_ = std::thread([this] {
       while (!is_closed_.load() && LoadBatch()) {}
     });
@@ -65,20 +148,73 @@ class DataReader {
   std::unique_ptr<Parser<LoadTarget>> parser_;
 
  private:
+  void StartPrepareThreads(int64_t num_threads) {
+    for (int64_t i = 0; i < num_threads; ++i) {
+      prepare_in_buffers_.emplace_back(std::make_unique<Buffer<BatchType>>(prefetch_depth_));
+      prepare_out_buffers_.emplace_back(std::make_unique<Buffer<BatchType>>(prefetch_depth_));
+    }
+    for (int64_t i = 0; i < num_threads; ++i) {
+      prepare_thrds_.emplace_back([this, i] {
+        Buffer<BatchType>* in_buffer = prepare_in_buffers_.at(i).get();
+        Buffer<BatchType>* out_buffer = prepare_out_buffers_.at(i).get();
+        BatchType batch;
+        while (in_buffer->Pull(&batch) == kBufferStatusSuccess) {
+          const int64_t start = DataReaderNowNs();
+          parser_->Prepare(batch);
+          prepare_stats_.Add(DataReaderNowNs() - start);
+          if (out_buffer->Push(std::move(batch)) != kBufferStatusSuccess) { break; }
+        }
+      });
+    }
+  }
+
   BatchType FetchBatchData() {
+    Buffer<BatchType>* buffer = &batch_buffer_;
+    if (!prepare_out_buffers_.empty()) {
+      buffer = prepare_out_buffers_.at(next_prepare_out_idx_).get();
+      next_prepare_out_idx_ = (next_prepare_out_idx_ + 1) % prepare_out_buffers_.size();
+    }
     BatchType batch;
-    CHECK_EQ(batch_buffer_.Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    const BufferStatus status = buffer->TryReceive(&batch);
+    if (status == BufferStatus::kBufferStatusSuccess) {
+      profiler::RecordDataReaderFetch(op_name_, false, 0);
+      return batch;
+    }
+    CHECK_EQ(status, BufferStatus::kBufferStatusEmpty);
+    const int64_t start = DataReaderNowNs();
+    CHECK_EQ(buffer->Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    profiler::RecordDataReaderFetch(op_name_, true, DataReaderNowNs() - start);
     return batch;
   }
 
   bool LoadBatch() {
+    const int64_t start = DataReaderNowNs();
     BatchType batch = loader_->Next();
-    return batch_buffer_.Push(std::move(batch)) == BufferStatus::kBufferStatusSuccess;
+    load_stats_.Add(DataReaderNowNs() - start);
+    if (prepare_in_buffers_.empty()) {
+      return batch_buffer_.Push(std::move(batch)) == BufferStatus::kBufferStatusSuccess;
+    }
+    auto& buffer = prepare_in_buffers_.at(next_prepare_in_idx_);
+    next_prepare_in_idx_ = (next_prepare_in_idx_ + 1) % prepare_in_buffers_.size();
+    return buffer->Push(std::move(batch)) == BufferStatus::kBufferStatusSuccess;
   }
 
+  const std::string op_name_;
   std::atomic<bool> is_closed_;
+  const int64_t prefetch_depth_;
+  const int64_t stats_interval_;
+  int64_t num_read_batches_;
   Buffer<BatchType> batch_buffer_;
   std::thread load_thrd_;
+  std::vector<std::unique_ptr<Buffer<BatchType>>> prepare_in_buffers_;
+  std::vector<std::unique_ptr<Buffer<BatchType>>> prepare_out_buffers_;
+  std::vector<std::thread> prepare_thrds_;
+  size_t next_prepare_in_idx_;
+  size_t next_prepare_out_idx_;
+  DataReaderStageStats load_stats_;
+  DataReaderStageStats prepare_stats_;
+  DataReaderStageStats wait_stats_;
+  DataReaderStageStats parse_stats_;
 };
 
 }  // namespace data
@@ -0,0 +1,221 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/indexed_record_dataset.h"
+#include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/ofrecord_view.h"
+#include "oneflow/user/data/onerec_dataset.h"
+#include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/user/data/coco_data_reader.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/record/record.pb.h"
+#include "nlohmann/json.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+// Drives the loading stages of the data readers at full speed, one stage after the other on the
+// calling thread, and prints the samples per second of each stage as a json array. A stage at far
+// more samples per second than the training steps consume is not what makes training input-bound.
+// The sources are configured through the environment, those left unset are skipped:
+//   ONEFLOW_DATA_READER_BENCHMARK_OFRECORD_FILES: comma separated OFRecord part files.
+//   ONEFLOW_DATA_READER_BENCHMARK_ONEREC_FILES: comma separated OneRec files.
+//   ONEFLOW_DATA_READER_BENCHMARK_GPT_DATA_PREFIX: prefix of the .bin/.idx Megatron GPT files.
+//   ONEFLOW_DATA_READER_BENCHMARK_GPT_SEQ_LENGTH: tokens per GPT sample, 1024 by default.
+//   ONEFLOW_DATA_READER_BENCHMARK_COCO_ANNOTATION_FILE: COCO annotation json.
+//   ONEFLOW_DATA_READER_BENCHMARK_COCO_IMAGE_DIR: directory of the COCO images.
+//   ONEFLOW_DATA_READER_BENCHMARK_NUM_SAMPLES: samples per stage, 10000 by default.
+//   ONEFLOW_DATA_READER_BENCHMARK_OUTPUT: file the json is written to, stdout by default.
+// OFRecord and OneRec are read through their memory-mapped indexes, the readers they back need a
+// kernel context to be built.
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+class StageTimer final {
+ public:
+  StageTimer(std::string source, std::vector<nlohmann::json>* records)
+      : source_(std::move(source)), records_(records) {}
+  ~StageTimer() = default;
+
+  // Runs `num_samples` samples through `Stage`, which gets the sample id.
+  void Run(const std::string& stage, int64_t num_samples,
+           const std::function<void(int64_t)>& Stage) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < num_samples; ++i) { Stage(i); }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    nlohmann::json record;
+    record["source"] = source_;
+    record["stage"] = stage;
+    record["samples"] = num_samples;
+    record["seconds"] = seconds;
+    record["samples_per_second"] = seconds > 0 ? num_samples / seconds : 0.0;
+    records_->emplace_back(std::move(record));
+  }
+
+ private:
+  std::string source_;
+  std::vector<nlohmann::json>* records_;
+};
+
+std::vector<std::string> SplitFilePaths(const std::string& text) {
+  std::vector<std::string> file_paths;
+  Split(text, ",", [&](std::string&& path) {
+    if (!path.empty()) { file_paths.emplace_back(std::move(path)); }
+  });
+  return file_paths;
+}
+
+// index: opening the files, load: copying the records out, parse: decoding the OFRecord protos,
+// view: walking the features of the records in place as the decoders of raw records do.
+void BenchmarkOFRecord(const std::vector<std::string>& file_paths, int64_t num_samples,
+                       std::vector<nlohmann::json>* records) {
+  StageTimer timer("ofrecord", records);
+  std::unique_ptr<IndexedRecordDataset> dataset;
+  timer.Run("index", 1, [&](int64_t) {
+    dataset.reset(
+        new IndexedRecordDataset(file_paths, &OFRecordDataset::IndexFile, RecordVerifyFn()));
+  });
+  CHECK_GT(dataset->Size(), 0);
+  std::vector<TensorBuffer> samples(std::min<int64_t>(num_samples, dataset->Size()));
+  timer.Run("load", num_samples, [&](int64_t i) {
+    auto batch = dataset->At(i % dataset->Size());
+    samples.at(i % samples.size()).Swap(batch.front());
+  });
+  timer.Run("parse", num_samples, [&](int64_t i) {
+    const TensorBuffer& sample = samples.at(i % samples.size());
+    OFRecord record;
+    CHECK(record.ParseFromArray(sample.data(), sample.nbytes()));
+  });
+  timer.Run("view", num_samples, [&](int64_t i) {
+    const TensorBuffer& sample = samples.at(i % samples.size());
+    int64_t num_values = 0;
+    OFRecordView(sample.data<char>(), sample.nbytes())
+        .ForEachFeature([&](OFRecordBytes name, const OFRecordFeatureView& feature) {
+          num_values += feature.size();
+        });
+    CHECK_GE(num_values, 0);
+  });
+}
+
+// index: opening the files, load: copying the payloads out and checking their digests.
+void BenchmarkOneRec(const std::vector<std::string>& file_paths, int64_t num_samples,
+                     std::vector<nlohmann::json>* records) {
+  StageTimer timer("onerec", records);
+  std::unique_ptr<IndexedRecordDataset> dataset;
+  timer.Run("index", 1, [&](int64_t) {
+    dataset.reset(new IndexedRecordDataset(file_paths, &OneRecDataset::IndexFile,
+                                           &OneRecDataset::VerifyRecord));
+  });
+  CHECK_GT(dataset->Size(), 0);
+  timer.Run("load", num_samples, [&](int64_t i) { dataset->At(i % dataset->Size()); });
+}
+
+// index: building the document, sample and shuffle indices, load: gathering the sample tokens.
+void BenchmarkGPT(const std::string& data_file_prefix, int64_t seq_len, int64_t num_samples,
+                  std::vector<nlohmann::json>* records) {
+  StageTimer timer("megatron_gpt", records);
+  const size_t label_len = 1;
+  std::unique_ptr<MegatronGPTMMapDataset> dataset;
+  timer.Run("index", 1, [&](int64_t) {
+    dataset.reset(new MegatronGPTMMapDataset(data_file_prefix, seq_len, label_len, num_samples,
+                                             {1}, 0, true, kOneflowDatasetSeed));
+  });
+  std::vector<int64_t> tokens(seq_len + label_len);
+  timer.Run("load", num_samples, [&](int64_t i) { dataset->GetSample(i, tokens.data()); });
+}
+
+// meta: loading the annotations, load: reading the image files like COCODataset, parse: building
+// the boxes, labels and segmentations like COCOParser.
+void BenchmarkCOCO(const std::string& annotation_file, const std::string& image_dir,
+                   int64_t num_samples, std::vector<nlohmann::json>* records) {
+  StageTimer timer("coco", records);
+  std::unique_ptr<COCOMeta> meta;
+  timer.Run("meta", 1, [&](int64_t) {
+    meta.reset(new COCOMeta(kInvalidSessionId, annotation_file, image_dir, true));
+  });
+  CHECK_GT(meta->Size(), 0);
+  timer.Run("load", num_samples, [&](int64_t i) {
+    const std::string& image_file_path = meta->GetImageFilePath(i % meta->Size());
+    PersistentInStream in_stream(DataFS(), image_file_path);
+    TensorBuffer data;
+    data.Resize(Shape({DataFS()->GetFileSize(image_file_path)}), DataType::kChar);
+    CHECK_EQ(in_stream.ReadFully(data.mut_data<char>(), data.nbytes()), 0);
+  });
+  timer.Run("parse", num_samples, [&](int64_t i) {
+    const int64_t index = i % meta->Size();
+    meta->GetBboxVec<float>(index);
+    meta->GetLabelVec<int32_t>(index);
+    TensorBuffer segm;
+    TensorBuffer segm_index;
+    meta->ReadSegmentationsToTensorBuffer<float>(index, &segm, &segm_index);
+  });
+}
+
+int Main() {
+  const int64_t num_samples =
+      ParseIntegerFromEnv("ONEFLOW_DATA_READER_BENCHMARK_NUM_SAMPLES", 10000);
+  CHECK_GT(num_samples, 0);
+  std::vector<nlohmann::json> records;
+
+  const auto ofrecord_files =
+      SplitFilePaths(GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_OFRECORD_FILES", ""));
+  if (!ofrecord_files.empty()) { BenchmarkOFRecord(ofrecord_files, num_samples, &records); }
+
+  const auto onerec_files =
+      SplitFilePaths(GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_ONEREC_FILES", ""));
+  if (!onerec_files.empty()) { BenchmarkOneRec(onerec_files, num_samples, &records); }
+
+  const std::string gpt_data_prefix =
+      GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_GPT_DATA_PREFIX", "");
+  if (!gpt_data_prefix.empty()) {
+    const int64_t seq_len =
+        ParseIntegerFromEnv("ONEFLOW_DATA_READER_BENCHMARK_GPT_SEQ_LENGTH", 1024);
+    CHECK_GT(seq_len, 0);
+    BenchmarkGPT(gpt_data_prefix, seq_len, num_samples, &records);
+  }
+
+  const std::string coco_annotation_file =
+      GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_COCO_ANNOTATION_FILE", "");
+  if (!coco_annotation_file.empty()) {
+    BenchmarkCOCO(coco_annotation_file,
+                  GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_COCO_IMAGE_DIR", ""), num_samples,
+                  &records);
+  }
+
+  const std::string output = GetStringFromEnv("ONEFLOW_DATA_READER_BENCHMARK_OUTPUT", "");
+  const std::string json = nlohmann::json(records).dump(2);
+  if (output.empty()) {
+    std::cout << json << std::endl;
+  } else {
+    std::ofstream ofs(output);
+    ofs << json << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace data
+
+}  // namespace oneflow
+
+int main() { return oneflow::data::Main(); }
@@ -63,6 +63,18 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
     // iter0 | 0, 1, 2, | 3, 4, 5, | 6, 7, 8, | 9, 0, 1, |
     // iter1 | 2, 3, 4, | 5, 6, 7, | 8, 9, 0, | 1, 2, 3, |
     BatchType batch = nested_ds_->At(index_seq_.at(pos_));
+    Advance();
+    return batch;
+  }
+
+  // Skips the samples this shard has already read, e.g. before the checkpoint to resume from,
+  // without loading them.
+  void Skip(int64_t num_samples) {
+    for (int64_t i = 0; i < num_samples; ++i) { Advance(); }
+  }
+
+ private:
+  void Advance() {
     if (stride_partition_) {
       pos_ += num_shards_;
     } else {
@@ -74,10 +86,8 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
       }
     }
     CheckRanOutOfSize();
-    return batch;
   }
 
- private:
   void CheckRanOutOfSize() {
     if (pos_ >= index_seq_.size()) {
       GenNewIndexSequence();
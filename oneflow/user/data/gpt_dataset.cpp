@@ -21,8 +21,14 @@ limitations under the License.
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #endif
 
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
 namespace oneflow {
 
 namespace data {
@@ -74,6 +80,24 @@ size_t GetNumCompleteEpochs(size_t num_samples, size_t seq_length, size_t tokens
   return separate_last_epoch ? (num_epochs - 1) : num_epochs;
 }
 
+constexpr char kIndexCacheMagicCode[] = "GPTIDXC\x00";
+constexpr size_t kIndexCacheMagicCodeLen = sizeof(kIndexCacheMagicCode) - 1;
+constexpr uint64_t kIndexCacheVersion = 1;
+
+// magic code, version, then the number of documents, the tokens per epoch and the sizes of the
+// doc, sample and shuffle indices, followed by the three index arrays.
+struct IndexCacheHeader {
+  char magic_code[kIndexCacheMagicCodeLen];
+  uint64_t version;
+  uint64_t num_docs;
+  uint64_t tokens_per_epoch;
+  uint64_t num_doc_indices;
+  uint64_t num_sample_indices;
+  uint64_t num_shuffle_indices;
+};
+
+static_assert(sizeof(size_t) == sizeof(uint64_t), "the index cache stores size_t as uint64_t");
+
 }  // namespace
 
 constexpr char MegatronGPTIndex::kMagicCode[];
@@ -161,11 +185,17 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
   tokens_per_epoch_ = GetEpochNumTokens(epoch_doc_indices);
   num_epochs_ = GetNumEpochs(num_samples_, seq_len_, tokens_per_epoch_);
   num_complete_epochs_ = GetNumCompleteEpochs(num_samples_, seq_len_, tokens_per_epoch_);
-  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
-  size_t total_num_samples = static_cast<size_t>(
-      std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-  InitSampleIndices(total_num_samples);
-  InitShuffleIndices(sample_indices_.size());
+  const bool use_index_cache = ParseBooleanFromEnv("ONEFLOW_GPT_DATASET_INDEX_CACHE", true);
+  const std::string index_cache_path =
+      IndexCachePath(data_file_prefix, split_sizes, split_index);
+  if (!use_index_cache || !LoadIndexCache(index_cache_path)) {
+    InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
+    size_t total_num_samples = static_cast<size_t>(
+        std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
+    InitSampleIndices(total_num_samples);
+    InitShuffleIndices(total_num_samples);
+    if (use_index_cache) { SaveIndexCache(index_cache_path); }
+  }
   std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
   VLOG(2) << "Create GPT Dataset successed, sequence length: " << seq_len_
           << ", number of samples: " << num_samples_
@@ -185,30 +215,34 @@ size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
                                             size_t num_epochs, size_t num_complete_epochs) {
-  doc_indices_.reserve(epoch_doc_indices.size() * num_epochs);
-  InitDocIndices(epoch_doc_indices, num_complete_epochs);
+  std::vector<size_t> doc_indices;
+  doc_indices.reserve(epoch_doc_indices.size() * num_epochs);
+  InitDocIndices(epoch_doc_indices, num_complete_epochs, &doc_indices);
   if (num_epochs != num_complete_epochs) {
     CHECK_EQ(num_complete_epochs + 1, num_epochs);
-    InitDocIndices(epoch_doc_indices, 1);
+    InitDocIndices(epoch_doc_indices, 1, &doc_indices);
   }
+  doc_indices_.Reset(std::move(doc_indices));
 }
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
-                                            size_t num_epochs) {
-  auto start = std::distance(doc_indices_.cbegin(), doc_indices_.cend());
+                                            size_t num_epochs, std::vector<size_t>* doc_indices) {
+  auto start = std::distance(doc_indices->cbegin(), doc_indices->cend());
   FOR_RANGE(size_t, i, 0, num_epochs) {
-    doc_indices_.insert(doc_indices_.end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
+    doc_indices->insert(doc_indices->end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
   }
-  if (shuffle_) { std::shuffle(doc_indices_.begin() + start, doc_indices_.end(), gen_); }
+  if (shuffle_) { std::shuffle(doc_indices->begin() + start, doc_indices->end(), gen_); }
 }
 
 void MegatronGPTMMapDataset::InitSampleIndices(size_t total_num_samples) {
-  sample_indices_.reserve(total_num_samples);
+  std::vector<size_t> sample_indices;
+  sample_indices.reserve(total_num_samples * 2);
   size_t doc_indices_idx = 0;
   size_t doc_offset = 0;
   FOR_RANGE(size_t, i, 0, total_num_samples) {
     if (doc_indices_idx >= doc_indices_.size()) { break; }
-    sample_indices_.emplace_back(doc_indices_idx, doc_offset);
+    sample_indices.push_back(doc_indices_idx);
+    sample_indices.push_back(doc_offset);
     int remaining_tokens = seq_len_;
     while (remaining_tokens > 0) {
       CHECK_LT(doc_indices_idx, doc_indices_.size());
@@ -226,22 +260,149 @@ void MegatronGPTMMapDataset::InitSampleIndices(size_t total_num_samples) {
       remaining_tokens -= doc_len;
     }
   }
-  CHECK_EQ(sample_indices_.size(), total_num_samples);
-  CHECK_GE(sample_indices_.size(), num_samples_);
+  CHECK_EQ(sample_indices.size(), total_num_samples * 2);
+  CHECK_GE(total_num_samples, num_samples_);
+  sample_indices_.Reset(std::move(sample_indices));
 }
 
 void MegatronGPTMMapDataset::InitShuffleIndices(size_t total_num_samples) {
-  shuffle_indices_.resize(total_num_samples);
-  std::iota(shuffle_indices_.begin(), shuffle_indices_.end(), 0);
+  std::vector<size_t> shuffle_indices(total_num_samples);
+  std::iota(shuffle_indices.begin(), shuffle_indices.end(), 0);
   if (shuffle_) {
     size_t num_samples = static_cast<size_t>(
         std::floor(static_cast<double>(num_complete_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-    CHECK_LE(num_samples, shuffle_indices_.size());
-    std::shuffle(shuffle_indices_.begin(), shuffle_indices_.begin() + num_samples, gen_);
+    CHECK_LE(num_samples, shuffle_indices.size());
+    std::shuffle(shuffle_indices.begin(), shuffle_indices.begin() + num_samples, gen_);
     if (num_complete_epochs_ != num_epochs_) {
-      std::shuffle(shuffle_indices_.begin() + num_samples, shuffle_indices_.end(), gen_);
+      std::shuffle(shuffle_indices.begin() + num_samples, shuffle_indices.end(), gen_);
     }
   }
+  shuffle_indices_.Reset(std::move(shuffle_indices));
+}
+
+std::string MegatronGPTMMapDataset::IndexCachePath(const std::string& data_file_prefix,
+                                                   const std::vector<int64_t>& split_sizes,
+                                                   size_t split_index) const {
+  std::ostringstream path;
+  path << data_file_prefix << "_split";
+  for (int64_t split_size : split_sizes) { path << "_" << split_size; }
+  path << "_" << split_index << "_" << seq_len_ << "sl_" << num_epochs_ << "ep_"
+       << num_complete_epochs_ << "cep_";
+  if (shuffle_) {
+    path << seed_ << "s";
+  } else {
+    path << "noshuffle";
+  }
+  path << ".gpt_index";
+  return path.str();
+}
+
+bool MegatronGPTMMapDataset::LoadIndexCache(const std::string& path) {
+#ifdef __linux__
+  struct stat s;
+  if (stat(path.c_str(), &s) != 0 || access(path.c_str(), R_OK) != 0) { return false; }
+  IndexCacheHeader header;
+  if (static_cast<size_t>(s.st_size) < sizeof(header)) {
+    LOG(WARNING) << "Ignore the truncated GPT dataset index cache " << path;
+    return false;
+  }
+  auto cache = std::make_unique<const MappedBuffer>(path);
+  std::memcpy(&header, cache->ptr(), sizeof(header));
+  const size_t num_indices =
+      header.num_doc_indices + header.num_sample_indices + header.num_shuffle_indices;
+  if (std::memcmp(header.magic_code, kIndexCacheMagicCode, kIndexCacheMagicCodeLen) != 0
+      || header.version != kIndexCacheVersion || header.num_docs != index_->num_docs()
+      || header.tokens_per_epoch != tokens_per_epoch_
+      || cache->size() != sizeof(header) + num_indices * sizeof(size_t)) {
+    LOG(WARNING) << "Ignore the mismatched GPT dataset index cache " << path;
+    return false;
+  }
+  const size_t* indices = reinterpret_cast<const size_t*>(
+      static_cast<const char*>(cache->ptr()) + sizeof(header));
+  doc_indices_.Reset(indices, header.num_doc_indices);
+  indices += header.num_doc_indices;
+  sample_indices_.Reset(indices, header.num_sample_indices);
+  indices += header.num_sample_indices;
+  shuffle_indices_.Reset(indices, header.num_shuffle_indices);
+  index_cache_ = std::move(cache);
+  VLOG(2) << "Load GPT Dataset index cache " << path;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void MegatronGPTMMapDataset::SaveIndexCache(const std::string& path) const {
+#ifdef __linux__
+  IndexCacheHeader header;
+  std::memcpy(header.magic_code, kIndexCacheMagicCode, kIndexCacheMagicCodeLen);
+  header.version = kIndexCacheVersion;
+  header.num_docs = index_->num_docs();
+  header.tokens_per_epoch = tokens_per_epoch_;
+  header.num_doc_indices = doc_indices_.size();
+  header.num_sample_indices = sample_indices_.size();
+  header.num_shuffle_indices = shuffle_indices_.size();
+  // Several ranks might build the same indices, rename the complete file into place.
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const MegatronGPTIndexArray* indices :
+         {&doc_indices_, &sample_indices_, &shuffle_indices_}) {
+      out.write(reinterpret_cast<const char*>(indices->data()), indices->size() * sizeof(size_t));
+    }
+    out.close();
+    if (!out.good()) {
+      LOG(WARNING) << "Failed to write the GPT dataset index cache " << tmp_path;
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to write the GPT dataset index cache " << path;
+    std::remove(tmp_path.c_str());
+  }
+#endif
+}
+
+MegatronGPTBlendedDataset::MegatronGPTBlendedDataset(
+    std::vector<std::unique_ptr<const MegatronGPTMMapDataset>>&& datasets,
+    const std::vector<float>& weights, size_t num_samples)
+    : datasets_(std::move(datasets)) {
+  CHECK_EQ(datasets_.size(), weights.size());
+  CHECK_GT(datasets_.size(), 0);
+  const double total_weight = std::accumulate(weights.cbegin(), weights.cend(), 0.0);
+  CHECK_GT(total_weight, 0);
+  dataset_index_.resize(num_samples);
+  dataset_sample_index_.resize(num_samples);
+  std::vector<size_t> num_taken(datasets_.size(), 0);
+  FOR_RANGE(size_t, i, 0, num_samples) {
+    size_t dataset = 0;
+    double max_error = -std::numeric_limits<double>::infinity();
+    FOR_RANGE(size_t, j, 0, datasets_.size()) {
+      const double error = weights[j] / total_weight * (i + 1) - num_taken[j];
+      if (error > max_error) {
+        max_error = error;
+        dataset = j;
+      }
+    }
+    dataset_index_[i] = dataset;
+    dataset_sample_index_[i] = num_taken[dataset];
+    num_taken[dataset] += 1;
+  }
+}
+
+std::vector<size_t> MegatronGPTBlendedDataset::GetNumSamplesPerDataset(
+    const std::vector<float>& weights, size_t num_samples) {
+  const double total_weight = std::accumulate(weights.cbegin(), weights.cend(), 0.0);
+  CHECK_GT(total_weight, 0);
+  std::vector<size_t> num_samples_per_dataset(weights.size());
+  FOR_RANGE(size_t, i, 0, weights.size()) {
+    CHECK_GE(weights[i], 0);
+    num_samples_per_dataset[i] =
+        static_cast<size_t>(std::ceil(weights[i] / total_weight * num_samples * 1.005));
+  }
+  return num_samples_per_dataset;
 }
 
 const HashMap<char, size_t> MegatronGPTMMapDataset::kDTypeCode2Size = {
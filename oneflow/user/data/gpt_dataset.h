@@ -58,6 +58,33 @@ class MappedBuffer final {
   size_t size_;
 };
 
+// A read-only array of indices, either built in memory or pointing into a mapped index cache.
+class MegatronGPTIndexArray final {
+ public:
+  MegatronGPTIndexArray() : data_(nullptr), size_(0) {}
+  ~MegatronGPTIndexArray() = default;
+
+  void Reset(std::vector<size_t>&& values) {
+    values_ = std::move(values);
+    data_ = values_.data();
+    size_ = values_.size();
+  }
+  void Reset(const size_t* data, size_t size) {
+    std::vector<size_t>().swap(values_);
+    data_ = data;
+    size_ = size;
+  }
+
+  const size_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t operator[](size_t i) const { return data_[i]; }
+
+ private:
+  std::vector<size_t> values_;
+  const size_t* data_;
+  size_t size_;
+};
+
 class MegatronGPTMMapDataset final {
  public:
   MegatronGPTMMapDataset(const std::string& data_file_prefix, size_t seq_len, size_t label_len,
@@ -75,9 +102,16 @@ class MegatronGPTMMapDataset final {
   size_t GetEpochNumTokens(const std::vector<size_t>& doc_indices) const;
   void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
                       size_t num_complete_epochs);
-  void InitDocIndices(const std::vector<size_t>& doc_indices, size_t num_epochs);
+  void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
+                      std::vector<size_t>* doc_indices);
   void InitSampleIndices(size_t total_num_samples);
   void InitShuffleIndices(size_t total_num_samples);
+  // The index arrays only depend on the documents, the split, seq_len, the number of epochs, the
+  // seed and shuffle, so they are saved next to the dataset and mapped by the later runs.
+  std::string IndexCachePath(const std::string& data_file_prefix,
+                             const std::vector<int64_t>& split_sizes, size_t split_index) const;
+  bool LoadIndexCache(const std::string& path);
+  void SaveIndexCache(const std::string& path) const;
   template<typename T>
   void ReadTokens(const void* src, size_t offset, T* dst, size_t size) const;
 
@@ -96,18 +130,45 @@ class MegatronGPTMMapDataset final {
   size_t tokens_per_epoch_;
   size_t num_epochs_;
   size_t num_complete_epochs_;
-  std::vector<size_t> doc_indices_;
-  std::vector<std::pair<size_t, size_t>> sample_indices_;
-  std::vector<size_t> shuffle_indices_;
+  std::unique_ptr<const MappedBuffer> index_cache_;
+  MegatronGPTIndexArray doc_indices_;
+  // (index into doc_indices_, token offset inside the doc) of every sample, flattened
+  MegatronGPTIndexArray sample_indices_;
+  MegatronGPTIndexArray shuffle_indices_;
+};
+
+// Samples from several datasets by weight, where sample i is taken from the dataset whose
+// share of the first i samples lags its weight the most.
+class MegatronGPTBlendedDataset final {
+ public:
+  MegatronGPTBlendedDataset(std::vector<std::unique_ptr<const MegatronGPTMMapDataset>>&& datasets,
+                            const std::vector<float>& weights, size_t num_samples);
+  OF_DISALLOW_COPY_AND_MOVE(MegatronGPTBlendedDataset);
+  ~MegatronGPTBlendedDataset() = default;
+
+  // The number of samples every dataset has to provide, with some margin for the rounding.
+  static std::vector<size_t> GetNumSamplesPerDataset(const std::vector<float>& weights,
+                                                     size_t num_samples);
+
+  template<typename T>
+  void GetSample(size_t index, T* data) const {
+    CHECK_LT(index, dataset_index_.size());
+    datasets_[dataset_index_[index]]->GetSample(dataset_sample_index_[index], data);
+  }
+
+ private:
+  std::vector<std::unique_ptr<const MegatronGPTMMapDataset>> datasets_;
+  std::vector<size_t> dataset_index_;
+  std::vector<size_t> dataset_sample_index_;
 };
 
 template<typename T>
 void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
   CHECK_LT(index, shuffle_indices_.size());
   const size_t sample_index = shuffle_indices_[index];
-  CHECK_LT(sample_index, sample_indices_.size());
-  size_t doc_indices_idx = sample_indices_[sample_index].first;
-  size_t doc_offset = sample_indices_[sample_index].second;
+  CHECK_LT(sample_index * 2, sample_indices_.size());
+  size_t doc_indices_idx = sample_indices_[sample_index * 2];
+  size_t doc_offset = sample_indices_[sample_index * 2 + 1];
   int remaining_tokens = sample_len_;
   while (remaining_tokens > 0) {
     CHECK_LT(doc_indices_idx, doc_indices_.size());
@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/index_shuffle_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+IndexShuffleDataset::IndexShuffleDataset(const std::vector<std::string>& file_paths,
+                                         const RecordIndexFn& index_fn,
+                                         const RecordVerifyFn& verify_fn,
+                                         int64_t shuffle_buffer_size, int64_t seed,
+                                         int64_t batch_size)
+    : verify_fn_(verify_fn), batch_size_(batch_size), num_remaining_records_(0) {
+  CHECK_GT(batch_size_, 0);
+  int64_t num_records = 0;
+  for (const auto& path : file_paths) {
+    files_.emplace_back(std::make_shared<MappedRecordFile>(path, index_fn));
+    num_records += files_.back()->records().size();
+  }
+  CHECK_GT(num_records, 0) << "no records found in the data files of this rank";
+  std::seed_seq seq({seed});
+  rand_engine_ = std::mt19937_64(seq);
+  file_cursors_.resize(files_.size());
+  ResetEpoch();
+  const int64_t buffer_size = std::max<int64_t>(std::min(shuffle_buffer_size, num_records), 1);
+  shuffle_buffer_.reserve(buffer_size);
+  for (int64_t i = 0; i < buffer_size; ++i) { shuffle_buffer_.push_back(NextInterleaved()); }
+}
+
+void IndexShuffleDataset::ResetEpoch() {
+  num_remaining_records_ = 0;
+  for (size_t i = 0; i < files_.size(); ++i) {
+    file_cursors_[i] = 0;
+    num_remaining_records_ += files_[i]->records().size();
+  }
+}
+
+IndexShuffleDataset::RecordLocation IndexShuffleDataset::NextInterleaved() {
+  if (num_remaining_records_ == 0) { ResetEpoch(); }
+  std::uniform_int_distribution<int64_t> dis(0, num_remaining_records_ - 1);
+  int64_t pick = dis(rand_engine_);
+  for (size_t i = 0; i < files_.size(); ++i) {
+    const int64_t remaining = files_[i]->records().size() - file_cursors_[i];
+    if (pick < remaining) {
+      num_remaining_records_ -= 1;
+      return RecordLocation{static_cast<int32_t>(i), file_cursors_[i]++};
+    }
+    pick -= remaining;
+  }
+  UNIMPLEMENTED();
+  return RecordLocation{};
+}
+
+IndexShuffleDataset::BatchType IndexShuffleDataset::Next() {
+  BatchType batch(batch_size_);
+  std::uniform_int_distribution<size_t> dis(0, shuffle_buffer_.size() - 1);
+  for (auto& sample : batch) {
+    RecordLocation location = NextInterleaved();
+    std::swap(shuffle_buffer_[dis(rand_engine_)], location);
+    const MappedRecordFile& file = *files_[location.file_id];
+    if (verify_fn_) { verify_fn_(file, file.records()[location.record_id]); }
+    file.LoadRecord(location.record_id, &sample);
+  }
+  return batch;
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_INDEX_SHUFFLE_DATASET_H_
+#define ONEFLOW_USER_DATA_INDEX_SHUFFLE_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/mapped_record_file.h"
+
+namespace oneflow {
+namespace data {
+
+// Shuffles the records of memory-mapped record files by their locations only.
+//
+// Records are drawn from the part files in a random interleaving, each part file is picked with a
+// probability proportional to its remaining records, and then pass a shuffle buffer of locations
+// like RandomShuffleDataset does with whole samples. A buffered record costs a few bytes however
+// large it is, so the buffer may be as large as the shard. A new epoch starts once every record of
+// the shard has been drawn.
+class IndexShuffleDataset final : public Dataset<TensorBuffer> {
+ public:
+  using Base = Dataset<TensorBuffer>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+
+  OF_DISALLOW_COPY_AND_MOVE(IndexShuffleDataset);
+  IndexShuffleDataset(const std::vector<std::string>& file_paths, const RecordIndexFn& index_fn,
+                      const RecordVerifyFn& verify_fn, int64_t shuffle_buffer_size, int64_t seed,
+                      int64_t batch_size);
+  ~IndexShuffleDataset() override = default;
+
+  BatchType Next() override;
+
+ private:
+  struct RecordLocation {
+    int32_t file_id;
+    int64_t record_id;
+  };
+
+  void ResetEpoch();
+  RecordLocation NextInterleaved();
+
+  std::vector<std::shared_ptr<MappedRecordFile>> files_;
+  RecordVerifyFn verify_fn_;
+  int64_t batch_size_;
+  std::vector<int64_t> file_cursors_;
+  int64_t num_remaining_records_;
+  std::vector<RecordLocation> shuffle_buffer_;
+  std::mt19937_64 rand_engine_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_INDEX_SHUFFLE_DATASET_H_
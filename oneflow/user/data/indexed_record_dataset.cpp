@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/indexed_record_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+IndexedRecordDataset::IndexedRecordDataset(const std::vector<std::string>& file_paths,
+                                           const RecordIndexFn& index_fn,
+                                           const RecordVerifyFn& verify_fn)
+    : verify_fn_(verify_fn) {
+  file_offsets_.push_back(0);
+  for (const auto& path : file_paths) {
+    files_.emplace_back(std::make_shared<MappedRecordFile>(path, index_fn));
+    file_offsets_.push_back(file_offsets_.back() + files_.back()->records().size());
+  }
+  CHECK_GT(file_offsets_.back(), 0) << "no records found in the data files";
+}
+
+IndexedRecordDataset::BatchType IndexedRecordDataset::At(int64_t index) const {
+  CHECK_GE(index, 0);
+  CHECK_LT(index, file_offsets_.back());
+  const auto it = std::upper_bound(file_offsets_.cbegin(), file_offsets_.cend(), index) - 1;
+  const MappedRecordFile& file = *files_.at(std::distance(file_offsets_.cbegin(), it));
+  const int64_t record_id = index - *it;
+  if (verify_fn_) { verify_fn_(file, file.records().at(record_id)); }
+  BatchType batch(1);
+  file.LoadRecord(record_id, &batch.front());
+  return batch;
+}
+
+}  // namespace data
+}  // namespace oneflow
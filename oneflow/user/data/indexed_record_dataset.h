@@ -0,0 +1,52 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
+#define ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/mapped_record_file.h"
+
+namespace oneflow {
+namespace data {
+
+// Random access to the records of memory-mapped record files, record N being the N-th record of
+// the concatenation of all files. With the sidecar indexes of the files, opening the dataset and
+// seeking to any record do not scan the data.
+class IndexedRecordDataset final : public RandomAccessDataset<TensorBuffer> {
+ public:
+  using Base = RandomAccessDataset<TensorBuffer>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+
+  OF_DISALLOW_COPY_AND_MOVE(IndexedRecordDataset);
+  IndexedRecordDataset(const std::vector<std::string>& file_paths, const RecordIndexFn& index_fn,
+                       const RecordVerifyFn& verify_fn);
+  ~IndexedRecordDataset() override = default;
+
+  BatchType At(int64_t index) const override;
+  size_t Size() const override { return file_offsets_.back(); }
+
+ private:
+  std::vector<std::shared_ptr<MappedRecordFile>> files_;
+  // file_offsets_[i] is the index of the first record of files_[i], the last one is the total.
+  std::vector<int64_t> file_offsets_;
+  RecordVerifyFn verify_fn_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <fstream>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/user/data/indexed_record_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// Records of the file are prefixed by their one byte size.
+void IndexByteSizedRecords(const char* data, size_t size, std::vector<RecordSpan>* records) {
+  size_t pos = 0;
+  while (pos < size) {
+    const int64_t record_size = data[pos];
+    records->push_back(RecordSpan{static_cast<int64_t>(pos + 1), record_size});
+    pos += 1 + record_size;
+  }
+}
+
+void WriteRecords(const std::string& path, const std::vector<std::string>& records) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  for (const auto& record : records) { out << static_cast<char>(record.size()) << record; }
+}
+
+std::string RecordAt(const IndexedRecordDataset& dataset, int64_t index) {
+  auto batch = dataset.At(index);
+  return std::string(batch.front().data<char>(), batch.front().elem_cnt());
+}
+
+}  // namespace
+
+TEST(IndexedRecordDataset, seek_with_sidecar_index) {
+#ifdef __linux__
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::vector<std::string> paths{JoinPath(current_dir, "tmp_test_record_index_0"),
+                                       JoinPath(current_dir, "tmp_test_record_index_1")};
+  WriteRecords(paths[0], {"a", "bc", "def"});
+  WriteRecords(paths[1], {"ghij", "k"});
+  for (const auto& path : paths) { std::remove(RecordIndexPath(path).c_str()); }
+  int64_t num_scans = 0;
+  RecordIndexFn index_fn = [&](const char* data, size_t size, std::vector<RecordSpan>* records) {
+    num_scans += 1;
+    IndexByteSizedRecords(data, size, records);
+  };
+  {
+    IndexedRecordDataset dataset(paths, index_fn, RecordVerifyFn());
+    ASSERT_EQ(num_scans, 2);
+    ASSERT_EQ(dataset.Size(), 5);
+    ASSERT_EQ(RecordAt(dataset, 2), "def");
+    ASSERT_EQ(RecordAt(dataset, 3), "ghij");
+  }
+  {
+    IndexedRecordDataset dataset(paths, index_fn, RecordVerifyFn());
+    ASSERT_EQ(num_scans, 2);
+    ASSERT_EQ(RecordAt(dataset, 4), "k");
+    ASSERT_EQ(RecordAt(dataset, 0), "a");
+  }
+  // The index of a rewritten file is stale.
+  WriteRecords(paths[1], {"ghij", "k", "lm"});
+  {
+    IndexedRecordDataset dataset(paths, index_fn, RecordVerifyFn());
+    ASSERT_EQ(num_scans, 3);
+    ASSERT_EQ(dataset.Size(), 6);
+    ASSERT_EQ(RecordAt(dataset, 5), "lm");
+  }
+  for (const auto& path : paths) {
+    std::remove(path.c_str());
+    std::remove(RecordIndexPath(path).c_str());
+  }
+#endif  // __linux__
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/mapped_record_file.h"
+
+namespace oneflow {
+namespace data {
+
+MappedRecordFile::MappedRecordFile(const std::string& path, const RecordIndexFn& index_fn)
+    : path_(path), data_(nullptr), size_(0) {
+#ifdef __linux__
+  embedding::PosixFile file(path, O_RDONLY, 0644);
+  size_ = file.Size();
+  if (size_ > 0) {
+    mapped_file_ = embedding::PosixMappedFile(std::move(file), size_, PROT_READ);
+    data_ = static_cast<const char*>(mapped_file_.ptr());
+    // Records are read in shuffled order, read ahead of the kernel would be wasted.
+    PCHECK(madvise(mapped_file_.ptr(), size_, MADV_RANDOM) == 0);
+  }
+  if (!LoadRecordIndex(path, size_, &records_)) {
+    index_fn(data_, size_, &records_);
+    if (ParseBooleanFromEnv("ONEFLOW_DATA_RECORD_INDEX_WRITE", true)) {
+      SaveRecordIndex(path, size_, records_);
+    }
+  }
+#else
+  UNIMPLEMENTED() << "memory-mapped record files are only supported on linux";
+#endif  // __linux__
+}
+
+void MappedRecordFile::LoadRecord(int64_t record_id, TensorBuffer* buffer) const {
+  static const bool zero_copy = ParseBooleanFromEnv("ONEFLOW_DATA_ZERO_COPY_RECORDS", false);
+  const RecordSpan& record = records_.at(record_id);
+  if (zero_copy) {
+    buffer->ResetView(Shape({record.size}), DataType::kChar, data_ + record.offset,
+                      shared_from_this());
+    return;
+  }
+  buffer->Resize(Shape({record.size}), DataType::kChar);
+  std::memcpy(buffer->mut_data<char>(), data_ + record.offset, record.size);
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,68 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_MAPPED_RECORD_FILE_H_
+#define ONEFLOW_USER_DATA_MAPPED_RECORD_FILE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/user/data/record_index.h"
+
+#ifdef __linux__
+#include "oneflow/core/embedding/posix_file.h"
+#endif  // __linux__
+
+namespace oneflow {
+namespace data {
+
+// Fills the spans of all records of a file held in [data, data + size).
+using RecordIndexFn =
+    std::function<void(const char* data, size_t size, std::vector<RecordSpan>* records)>;
+
+// A local record file mapped into memory, together with the offset table of its records. The
+// table is loaded from the sidecar index of the file if there is one, otherwise the file is
+// scanned with index_fn and the index is written next to it for later readers.
+//
+// With ONEFLOW_DATA_ZERO_COPY_RECORDS=1, records are loaded as read-only TensorBuffer views into
+// the mapping instead of copies, and each view keeps the file mapped until it is released.
+class MappedRecordFile final : public std::enable_shared_from_this<MappedRecordFile> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MappedRecordFile);
+  MappedRecordFile(const std::string& path, const RecordIndexFn& index_fn);
+  ~MappedRecordFile() = default;
+
+  const std::string& path() const { return path_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::vector<RecordSpan>& records() const { return records_; }
+  void LoadRecord(int64_t record_id, TensorBuffer* buffer) const;
+
+ private:
+  std::string path_;
+#ifdef __linux__
+  embedding::PosixMappedFile mapped_file_;
+#endif  // __linux__
+  const char* data_;
+  size_t size_;
+  std::vector<RecordSpan> records_;
+};
+
+// Checks the payload of a record before it is handed out, may be empty.
+using RecordVerifyFn = std::function<void(const MappedRecordFile& file, const RecordSpan& record)>;
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_MAPPED_RECORD_FILE_H_
@@ -21,6 +21,10 @@ limitations under the License.
 #include "oneflow/user/data/ofrecord_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
+#include "oneflow/user/data/index_shuffle_dataset.h"
+#include "oneflow/user/data/indexed_record_dataset.h"
+#include "oneflow/user/data/distributed_training_dataset.h"
+#include "oneflow/user/data/distributed_util.h"
 
 namespace oneflow {
 namespace data {
@@ -30,11 +34,47 @@ class OFRecordDataReader final : public DataReader<TensorBuffer> {
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
     batch_size_ = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     if (auto* pool = TensorBufferPool::TryGet()) { pool->IncreasePoolSizeByBase(batch_size_); }
-    loader_.reset(new OFRecordDataset(ctx));
-    if (ctx->Attr<bool>("random_shuffle")) {
-      loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+    const bool random_shuffle = ctx->Attr<bool>("random_shuffle");
+    const auto& shuffle_mode = ctx->Attr<std::string>("shuffle_mode");
+    if (shuffle_mode == "sample") {
+      // Every rank indexes all the part files and reads its shard of samples, sharding is fair
+      // however the records are spread over the files.
+      std::vector<std::string> data_file_paths;
+      Range range;
+      OFRecordDataset::GetDataFilePaths(ctx, &data_file_paths, &range);
+      std::unique_ptr<RandomAccessDataset<TensorBuffer>> dataset(
+          new IndexedRecordDataset(data_file_paths, &OFRecordDataset::IndexFile, RecordVerifyFn()));
+      size_t world_size = 1;
+      int64_t rank = 0;
+      CHECK_JUST(InitDataSourceDistributedInfo(ctx, world_size, rank));
+      // All ranks have to shuffle with the same permutation.
+      int64_t seed = ctx->Attr<int64_t>("seed");
+      if (seed == -1) { seed = kOneflowDatasetSeed; }
+      auto* distributed_dataset = new DistributedTrainingDataset<TensorBuffer>(
+          world_size, rank, false, random_shuffle, seed, std::move(dataset));
+      distributed_dataset->Skip(ctx->Attr<int64_t>("start_sample"));
+      loader_.reset(distributed_dataset);
+      loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
+    } else if (random_shuffle && shuffle_mode == "index") {
+      std::vector<std::string> data_file_paths;
+      Range range;
+      OFRecordDataset::GetDataFilePaths(ctx, &data_file_paths, &range);
+      std::vector<std::string> local_file_paths(data_file_paths.begin() + range.begin(),
+                                                data_file_paths.begin() + range.end());
+      int64_t seed = ctx->Attr<int64_t>("seed");
+      if (seed == -1) { seed = NewRandomSeed(); }
+      loader_.reset(new IndexShuffleDataset(local_file_paths, &OFRecordDataset::IndexFile,
+                                            RecordVerifyFn(),
+                                            ctx->Attr<int32_t>("shuffle_buffer_size"), seed,
+                                            batch_size_));
+    } else {
+      CHECK(shuffle_mode == "instance") << "invalid shuffle_mode " << shuffle_mode;
+      loader_.reset(new OFRecordDataset(ctx));
+      if (random_shuffle) {
+        loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+      }
+      loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
     }
-    loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
     parser_.reset(new OFRecordParser());
     StartLoadThread();
   }
@@ -20,10 +20,12 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/block_compressed_file.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/mapped_record_file.h"
 
 namespace oneflow {
 namespace data {
@@ -39,18 +41,28 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   OFRecordDataset(user_op::KernelInitContext* ctx) {
     current_epoch_ = 0;
     shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
-
-    // in stream
     data_part_num_ = ctx->Attr<int32_t>("data_part_num");
+    GetDataFilePaths(ctx, &data_file_paths_, &range_);
+    std::vector<std::string> local_file_paths = GetLocalFilePaths();
+    in_stream_.reset(
+        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
+  }
+  ~OFRecordDataset() = default;
+
+  // Paths of all the part files, and the range of them read by this rank.
+  static void GetDataFilePaths(user_op::KernelInitContext* ctx,
+                               std::vector<std::string>* data_file_paths, Range* range) {
+    const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
     std::string data_dir = ctx->Attr<std::string>("data_dir");
     std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
     int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
 
-    for (int i = 0; i < data_part_num_; ++i) {
+    data_file_paths->clear();
+    for (int i = 0; i < data_part_num; ++i) {
       std::string num = std::to_string(i);
       int32_t zero_count =
           std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
-      data_file_paths_.emplace_back(
+      data_file_paths->emplace_back(
           JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
     }
 
@@ -66,21 +78,36 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       // we assume that it works in DDP
       if (nd_sbp_str_vec.empty()) { is_local = true; }
     }
+    int32_t parallel_id = 0;
+    int32_t parallel_num = 1;
     if (is_local) {
-      parallel_id_ = GlobalProcessCtx::Rank();
-      parallel_num_ = GlobalProcessCtx::WorldSize();
+      parallel_id = GlobalProcessCtx::Rank();
+      parallel_num = GlobalProcessCtx::WorldSize();
     } else {
-      parallel_id_ = ctx->parallel_ctx().parallel_id();
-      parallel_num_ = ctx->parallel_ctx().parallel_num();
+      parallel_id = ctx->parallel_ctx().parallel_id();
+      parallel_num = ctx->parallel_ctx().parallel_num();
+    }
+    CHECK_LE(parallel_num, data_part_num);
+    BalancedSplitter bs(data_part_num, parallel_num);
+    *range = bs.At(parallel_id);
+  }
+
+  // Indexes a file of records each prefixed by its int64 size.
+  static void IndexFile(const char* data, size_t size, std::vector<RecordSpan>* records) {
+    CHECK(!IsBlockCompressedData(data, size))
+        << "block compressed files can not be indexed in place, read them as a stream";
+    size_t pos = 0;
+    while (pos < size) {
+      int64_t record_size = -1;
+      CHECK_LE(pos + sizeof(int64_t), size) << "truncated OFRecord file";
+      std::memcpy(&record_size, data + pos, sizeof(int64_t));
+      pos += sizeof(int64_t);
+      CHECK_GT(record_size, 0);
+      CHECK_LE(pos + record_size, size) << "truncated OFRecord file";
+      records->push_back(RecordSpan{static_cast<int64_t>(pos), record_size});
+      pos += record_size;
     }
-    CHECK_LE(parallel_num_, data_part_num_);
-    BalancedSplitter bs(data_part_num_, parallel_num_);
-    range_ = bs.At(parallel_id_);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
   }
-  ~OFRecordDataset() = default;
 
   BatchType Next() override {
     BatchType batch;
@@ -123,8 +150,6 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   bool shuffle_after_epoch_;
 
   int32_t data_part_num_;
-  int32_t parallel_id_;
-  int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
   std::unique_ptr<PersistentInStream> in_stream_;
@@ -35,11 +35,18 @@ class OFRecordParser final : public Parser<TensorBuffer> {
 
   void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
-    OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
-    MultiThreadLoop(batch_data.size(), [&](size_t i) {
-      auto& sample = batch_data[i];
-      CHECK(dptr[i].ParseFromArray(sample.data(), sample.nbytes()));
-    });
+    if (out_tensor->data_type() == DataType::kTensorBuffer) {
+      // raw_records: the serialized records are handed over as they are, the decoders read them
+      // in place through OFRecordView.
+      TensorBuffer* dptr = out_tensor->mut_dptr<TensorBuffer>();
+      for (size_t i = 0; i < batch_data.size(); ++i) { dptr[i].Swap(batch_data[i]); }
+    } else {
+      OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
+      MultiThreadLoop(batch_data.size(), [&](size_t i) {
+        auto& sample = batch_data[i];
+        CHECK(dptr[i].ParseFromArray(sample.data(), sample.nbytes()));
+      });
+    }
     if (batch_data.size() != out_tensor->shape().elem_cnt()) {
       CHECK_EQ(out_tensor->mut_shape()->NumAxes(), 1);
       out_tensor->mut_shape()->Set(0, batch_data.size());
@@ -0,0 +1,354 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+enum WireType { kVarint = 0, kFixed64 = 1, kLengthDelimited = 2, kFixed32 = 5 };
+
+// Reads the protobuf wire format in place. Fixed width values are little endian on the wire, as on
+// the hosts the readers run on.
+class WireReader final {
+ public:
+  explicit WireReader(OFRecordBytes bytes)
+      : pos_(reinterpret_cast<const uint8_t*>(bytes.data)), end_(pos_ + bytes.size) {}
+  ~WireReader() = default;
+
+  bool Done() const { return pos_ == end_; }
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      CHECK(pos_ != end_) << "truncated OFRecord";
+      const uint8_t byte = *pos_++;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) { return value; }
+    }
+    LOG(FATAL) << "malformed varint in OFRecord";
+    return 0;
+  }
+
+  void ReadTag(uint32_t* field, WireType* type) {
+    const uint64_t tag = ReadVarint();
+    *field = static_cast<uint32_t>(tag >> 3);
+    *type = static_cast<WireType>(tag & 7);
+  }
+
+  OFRecordBytes ReadLengthDelimited() {
+    const uint64_t size = ReadVarint();
+    CHECK_LE(size, static_cast<uint64_t>(end_ - pos_)) << "truncated OFRecord";
+    OFRecordBytes bytes{reinterpret_cast<const char*>(pos_), static_cast<size_t>(size)};
+    pos_ += size;
+    return bytes;
+  }
+
+  template<typename T>
+  T ReadFixed() {
+    CHECK_LE(sizeof(T), static_cast<size_t>(end_ - pos_)) << "truncated OFRecord";
+    T value;
+    std::memcpy(&value, pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  void Skip(WireType type) {
+    switch (type) {
+      case kVarint: ReadVarint(); break;
+      case kFixed64: ReadFixed<uint64_t>(); break;
+      case kLengthDelimited: ReadLengthDelimited(); break;
+      case kFixed32: ReadFixed<uint32_t>(); break;
+      default: LOG(FATAL) << "unsupported wire type " << type << " in OFRecord";
+    }
+  }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* end_;
+};
+
+template<OFRecordFeatureView::Kind kind>
+struct ListTraits;
+
+template<>
+struct ListTraits<OFRecordFeatureView::kFloatList> {
+  using T = float;
+  static constexpr WireType kValueType = kFixed32;
+  static const T* Data(const Feature& feature) { return feature.float_list().value().data(); }
+};
+
+template<>
+struct ListTraits<OFRecordFeatureView::kDoubleList> {
+  using T = double;
+  static constexpr WireType kValueType = kFixed64;
+  static const T* Data(const Feature& feature) { return feature.double_list().value().data(); }
+};
+
+template<>
+struct ListTraits<OFRecordFeatureView::kInt32List> {
+  using T = int32_t;
+  static constexpr WireType kValueType = kVarint;
+  static const T* Data(const Feature& feature) { return feature.int32_list().value().data(); }
+};
+
+template<>
+struct ListTraits<OFRecordFeatureView::kInt64List> {
+  using T = int64_t;
+  static constexpr WireType kValueType = kVarint;
+  static const T* Data(const Feature& feature) { return feature.int64_list().value().data(); }
+};
+
+int64_t CountBytesValues(OFRecordBytes list) {
+  int64_t count = 0;
+  WireReader reader(list);
+  while (!reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field == 1 && type == kLengthDelimited) { count += 1; }
+    reader.Skip(type);
+  }
+  return count;
+}
+
+// Numeric lists are written packed, the unpacked encoding is accepted as protobuf does.
+template<OFRecordFeatureView::Kind kind>
+int64_t CountListValues(OFRecordBytes list) {
+  using Traits = ListTraits<kind>;
+  int64_t count = 0;
+  WireReader reader(list);
+  while (!reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field != 1) {
+      reader.Skip(type);
+    } else if (type == kLengthDelimited) {
+      const OFRecordBytes packed = reader.ReadLengthDelimited();
+      if (Traits::kValueType == kVarint) {
+        for (size_t i = 0; i < packed.size; ++i) {
+          if ((packed.data[i] & 0x80) == 0) { count += 1; }
+        }
+      } else {
+        CHECK_EQ(packed.size % sizeof(typename Traits::T), 0) << "malformed packed OFRecord list";
+        count += packed.size / sizeof(typename Traits::T);
+      }
+    } else {
+      CHECK(type == Traits::kValueType) << "malformed OFRecord list";
+      reader.Skip(type);
+      count += 1;
+    }
+  }
+  return count;
+}
+
+template<OFRecordFeatureView::Kind kind>
+typename ListTraits<kind>::T ReadListValue(WireReader* reader) {
+  using T = typename ListTraits<kind>::T;
+  if (ListTraits<kind>::kValueType == kVarint) {
+    return static_cast<T>(reader->ReadVarint());
+  } else {
+    return reader->ReadFixed<T>();
+  }
+}
+
+template<OFRecordFeatureView::Kind kind, typename U>
+void CopyListValues(OFRecordBytes list, U* dst, int64_t n) {
+  using Traits = ListTraits<kind>;
+  using T = typename Traits::T;
+  int64_t i = 0;
+  WireReader reader(list);
+  while (i < n && !reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field != 1) {
+      reader.Skip(type);
+    } else if (type == kLengthDelimited) {
+      const OFRecordBytes packed = reader.ReadLengthDelimited();
+      if (Traits::kValueType == kVarint) {
+        WireReader values(packed);
+        while (i < n && !values.Done()) { dst[i++] = static_cast<U>(ReadListValue<kind>(&values)); }
+      } else {
+        const int64_t num_values = std::min<int64_t>(n - i, packed.size / sizeof(T));
+        for (int64_t j = 0; j < num_values; ++j) {
+          T value;
+          std::memcpy(&value, packed.data + j * sizeof(T), sizeof(T));
+          dst[i++] = static_cast<U>(value);
+        }
+      }
+    } else {
+      CHECK(type == Traits::kValueType) << "malformed OFRecord list";
+      dst[i++] = static_cast<U>(ReadListValue<kind>(&reader));
+    }
+  }
+  CHECK_EQ(i, n) << "truncated OFRecord list";
+}
+
+template<OFRecordFeatureView::Kind kind, typename U>
+void CopyFeatureValues(const Feature* feature, OFRecordBytes list, U* dst, int64_t n) {
+  using T = typename ListTraits<kind>::T;
+  if (feature != nullptr) {
+    const T* src = ListTraits<kind>::Data(*feature);
+    std::transform(src, src + n, dst, [](T v) { return static_cast<U>(v); });
+  } else {
+    CopyListValues<kind>(list, dst, n);
+  }
+}
+
+// Calls Handler with the key and the serialized Feature of every entry of the map, an entry
+// missing either has it empty.
+template<typename HandlerT>
+void ForEachMapEntry(OFRecordBytes record, const HandlerT& Handler) {
+  WireReader reader(record);
+  while (!reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field != 1 || type != kLengthDelimited) {
+      reader.Skip(type);
+      continue;
+    }
+    WireReader entry(reader.ReadLengthDelimited());
+    OFRecordBytes key{"", 0};
+    OFRecordBytes value{"", 0};
+    while (!entry.Done()) {
+      entry.ReadTag(&field, &type);
+      if (field == 1 && type == kLengthDelimited) {
+        key = entry.ReadLengthDelimited();
+      } else if (field == 2 && type == kLengthDelimited) {
+        value = entry.ReadLengthDelimited();
+      } else {
+        entry.Skip(type);
+      }
+    }
+    Handler(key, value);
+  }
+}
+
+}  // namespace
+
+OFRecordFeatureView::OFRecordFeatureView(const Feature& feature)
+    : feature_(&feature), kind_(static_cast<Kind>(feature.kind_case())) {
+  switch (kind_) {
+    case kBytesList: size_ = feature.bytes_list().value_size(); break;
+    case kFloatList: size_ = feature.float_list().value_size(); break;
+    case kDoubleList: size_ = feature.double_list().value_size(); break;
+    case kInt32List: size_ = feature.int32_list().value_size(); break;
+    case kInt64List: size_ = feature.int64_list().value_size(); break;
+    default: size_ = 0;
+  }
+}
+
+OFRecordFeatureView::OFRecordFeatureView(const char* data, size_t size) {
+  WireReader reader(OFRecordBytes{data, size});
+  while (!reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field >= kBytesList && field <= kInt64List && type == kLengthDelimited) {
+      // Last member of the oneof wins.
+      kind_ = static_cast<Kind>(field);
+      list_ = reader.ReadLengthDelimited();
+    } else {
+      reader.Skip(type);
+    }
+  }
+  switch (kind_) {
+    case kBytesList: size_ = CountBytesValues(list_); break;
+    case kFloatList: size_ = CountListValues<kFloatList>(list_); break;
+    case kDoubleList: size_ = CountListValues<kDoubleList>(list_); break;
+    case kInt32List: size_ = CountListValues<kInt32List>(list_); break;
+    case kInt64List: size_ = CountListValues<kInt64List>(list_); break;
+    default: size_ = 0;
+  }
+}
+
+OFRecordBytes OFRecordFeatureView::bytes(int64_t i) const {
+  CHECK_EQ(kind_, kBytesList);
+  CHECK(i >= 0 && i < size_) << "index " << i << " out of a bytes list of size " << size_;
+  if (feature_ != nullptr) {
+    const std::string& value = feature_->bytes_list().value(i);
+    return OFRecordBytes{value.data(), value.size()};
+  }
+  int64_t index = 0;
+  WireReader reader(list_);
+  while (!reader.Done()) {
+    uint32_t field = 0;
+    WireType type = kVarint;
+    reader.ReadTag(&field, &type);
+    if (field == 1 && type == kLengthDelimited) {
+      const OFRecordBytes value = reader.ReadLengthDelimited();
+      if (index == i) { return value; }
+      index += 1;
+    } else {
+      reader.Skip(type);
+    }
+  }
+  UNIMPLEMENTED();
+  return OFRecordBytes{nullptr, 0};
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyTo(T* dst, int64_t n) const {
+  CHECK_LE(n, size_);
+  switch (kind_) {
+    case kFloatList: CopyFeatureValues<kFloatList>(feature_, list_, dst, n); break;
+    case kDoubleList: CopyFeatureValues<kDoubleList>(feature_, list_, dst, n); break;
+    case kInt32List: CopyFeatureValues<kInt32List>(feature_, list_, dst, n); break;
+    case kInt64List: CopyFeatureValues<kInt64List>(feature_, list_, dst, n); break;
+    default: LOG(FATAL) << "feature of kind " << kind_ << " is not a numeric list";
+  }
+}
+
+#define INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(T) \
+  template void OFRecordFeatureView::CopyTo<T>(T * dst, int64_t n) const;
+
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(char)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(float)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(double)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(int8_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(int32_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(int64_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO(uint8_t)
+
+#undef INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_TO
+
+bool OFRecordView::Find(const std::string& name, OFRecordFeatureView* feature) const {
+  bool found = false;
+  OFRecordBytes found_value{nullptr, 0};
+  ForEachMapEntry(OFRecordBytes{data_, size_}, [&](OFRecordBytes key, OFRecordBytes value) {
+    if (key.size == name.size() && std::memcmp(key.data, name.data(), key.size) == 0) {
+      found = true;
+      found_value = value;
+    }
+  });
+  if (found) { *feature = OFRecordFeatureView(found_value.data, found_value.size); }
+  return found;
+}
+
+void OFRecordView::ForEachFeature(
+    const std::function<void(OFRecordBytes name, const OFRecordFeatureView& feature)>& Handler)
+    const {
+  ForEachMapEntry(OFRecordBytes{data_, size_}, [&](OFRecordBytes key, OFRecordBytes value) {
+    Handler(key, OFRecordFeatureView(value.data, value.size));
+  });
+}
+
+}  // namespace data
+}  // namespace oneflow
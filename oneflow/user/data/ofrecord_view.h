@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+#define ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+namespace data {
+
+// Bytes inside a record, valid as long as the record they point into.
+struct OFRecordBytes {
+  const char* data;
+  size_t size;
+};
+
+// One Feature of an OFRecord, read in place from its serialized bytes without building the
+// protobuf message, or wrapping an already parsed Feature so that decoders handle both the same.
+class OFRecordFeatureView final {
+ public:
+  // Same values as the field numbers of the Feature oneof.
+  enum Kind {
+    kNone = 0,
+    kBytesList = 1,
+    kFloatList = 2,
+    kDoubleList = 3,
+    kInt32List = 4,
+    kInt64List = 5,
+  };
+
+  OFRecordFeatureView() = default;
+  explicit OFRecordFeatureView(const Feature& feature);
+  OFRecordFeatureView(const char* data, size_t size);
+  ~OFRecordFeatureView() = default;
+
+  Kind kind() const { return kind_; }
+  // Number of values of the list.
+  int64_t size() const { return size_; }
+  // The i-th value of a bytes list.
+  OFRecordBytes bytes(int64_t i) const;
+  // Converts the first n values of a numeric list to T.
+  template<typename T>
+  void CopyTo(T* dst, int64_t n) const;
+
+ private:
+  const Feature* feature_ = nullptr;
+  Kind kind_ = kNone;
+  // The serialized list message of the feature.
+  OFRecordBytes list_{nullptr, 0};
+  int64_t size_ = 0;
+};
+
+// A serialized OFRecord read in place. Nothing is decoded up front, looking a feature up walks the
+// map entries of the record and skips those of other features by their length.
+class OFRecordView final {
+ public:
+  OFRecordView(const char* data, size_t size) : data_(data), size_(size) {}
+  ~OFRecordView() = default;
+
+  // Returns false when the record has no feature named `name`. Like the parsed map, the last entry
+  // of a name wins.
+  bool Find(const std::string& name, OFRecordFeatureView* feature) const;
+  void ForEachFeature(
+      const std::function<void(OFRecordBytes name, const OFRecordFeatureView& feature)>& Handler)
+      const;
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+std::string ToString(OFRecordBytes bytes) { return std::string(bytes.data, bytes.size); }
+
+template<typename T>
+std::vector<T> Values(const OFRecordFeatureView& feature) {
+  std::vector<T> values(feature.size());
+  feature.CopyTo(values.data(), values.size());
+  return values;
+}
+
+OFRecord MakeRecord() {
+  OFRecord record;
+  auto* features = record.mutable_feature();
+  (*features)["encoded"].mutable_bytes_list()->add_value(std::string("\x00\xff jpeg", 7));
+  (*features)["encoded"].mutable_bytes_list()->add_value("second");
+  for (float v : {1.5f, -2.25f, 3.f}) { (*features)["float"].mutable_float_list()->add_value(v); }
+  for (double v : {0.1, -1e300}) { (*features)["double"].mutable_double_list()->add_value(v); }
+  for (int32_t v : {7, -1, 300, INT32_MIN}) {
+    (*features)["class/label"].mutable_int32_list()->add_value(v);
+  }
+  for (int64_t v : {int64_t(1) << 40, int64_t(-5)}) {
+    (*features)["int64"].mutable_int64_list()->add_value(v);
+  }
+  (*features)["empty"];
+  return record;
+}
+
+}  // namespace
+
+TEST(OFRecordView, matches_parsed_record) {
+  const OFRecord record = MakeRecord();
+  const std::string serialized = record.SerializeAsString();
+  const OFRecordView view(serialized.data(), serialized.size());
+  for (const auto& pair : record.feature()) {
+    OFRecordFeatureView feature;
+    ASSERT_TRUE(view.Find(pair.first, &feature));
+    const OFRecordFeatureView parsed(pair.second);
+    ASSERT_EQ(feature.kind(), parsed.kind());
+    ASSERT_EQ(feature.size(), parsed.size());
+    switch (feature.kind()) {
+      case OFRecordFeatureView::kBytesList:
+        for (int64_t i = 0; i < feature.size(); ++i) {
+          ASSERT_EQ(ToString(feature.bytes(i)), ToString(parsed.bytes(i)));
+          ASSERT_EQ(ToString(feature.bytes(i)), pair.second.bytes_list().value(i));
+        }
+        break;
+      case OFRecordFeatureView::kNone: break;
+      default:
+        ASSERT_EQ(Values<double>(feature), Values<double>(parsed));
+        ASSERT_EQ(Values<int64_t>(feature), Values<int64_t>(parsed));
+    }
+  }
+  OFRecordFeatureView feature;
+  ASSERT_FALSE(view.Find("missing", &feature));
+  ASSERT_TRUE(view.Find("class/label", &feature));
+  ASSERT_EQ(Values<int32_t>(feature), std::vector<int32_t>({7, -1, 300, INT32_MIN}));
+  ASSERT_TRUE(view.Find("float", &feature));
+  std::vector<float> prefix(2);
+  feature.CopyTo(prefix.data(), prefix.size());
+  ASSERT_EQ(prefix, std::vector<float>({1.5f, -2.25f}));
+  int64_t num_features = 0;
+  view.ForEachFeature([&](OFRecordBytes name, const OFRecordFeatureView& feature) {
+    ASSERT_TRUE(record.feature().count(ToString(name)));
+    num_features += 1;
+  });
+  ASSERT_EQ(num_features, record.feature_size());
+}
+
+TEST(OFRecordView, unpacked_lists_and_repeated_names) {
+  // {"f": float_list [1.5, 2.5] written unpacked}, then {"f": int64_list [3]}.
+  std::string serialized;
+  auto AppendEntry = [&](const std::string& key, const std::string& feature) {
+    const std::string entry = std::string("\x0a", 1) + static_cast<char>(key.size()) + key
+                              + std::string("\x12", 1) + static_cast<char>(feature.size())
+                              + feature;
+    serialized += std::string("\x0a", 1) + static_cast<char>(entry.size()) + entry;
+  };
+  std::string float_list;
+  for (float v : {1.5f, 2.5f}) {
+    float_list += std::string("\x0d", 1) + std::string(reinterpret_cast<const char*>(&v), 4);
+  }
+  AppendEntry("f", std::string("\x12", 1) + static_cast<char>(float_list.size()) + float_list);
+  const OFRecordView first(serialized.data(), serialized.size());
+  OFRecordFeatureView feature;
+  ASSERT_TRUE(first.Find("f", &feature));
+  ASSERT_EQ(feature.kind(), OFRecordFeatureView::kFloatList);
+  ASSERT_EQ(Values<float>(feature), std::vector<float>({1.5f, 2.5f}));
+
+  AppendEntry("f", std::string("\x2a\x02\x08\x03", 4));
+  OFRecord parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+  const OFRecordView view(serialized.data(), serialized.size());
+  ASSERT_TRUE(view.Find("f", &feature));
+  ASSERT_EQ(feature.kind(), OFRecordFeatureView::kInt64List);
+  const OFRecordFeatureView parsed_feature(parsed.feature().at("f"));
+  ASSERT_EQ(Values<int64_t>(feature), Values<int64_t>(parsed_feature));
+}
+
+}  // namespace data
+}  // namespace oneflow
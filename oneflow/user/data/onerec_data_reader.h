@@ -22,6 +22,9 @@ limitations under the License.
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
+#include "oneflow/user/data/index_shuffle_dataset.h"
+#include "oneflow/user/data/indexed_record_dataset.h"
+#include "oneflow/user/data/distributed_training_dataset.h"
 
 namespace oneflow {
 namespace data {
@@ -32,8 +35,23 @@ class OneRecDataReader final : public DataReader<TensorBuffer> {
     batch_size_ = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     if (auto* pool = TensorBufferPool::TryGet()) { pool->IncreasePoolSizeByBase(batch_size_); }
     const auto random_shuffle = ctx->Attr<bool>("random_shuffle");
-    parser_.reset(new OneRecParser());
-    if (random_shuffle) {
+    parser_.reset(new OneRecParser(ctx->Attr<bool>("verify_example")));
+    if (ctx->Attr<std::string>("shuffle_mode") == "sample") {
+      std::unique_ptr<RandomAccessDataset<TensorBuffer>> dataset(new IndexedRecordDataset(
+          ctx->Attr<std::vector<std::string>>("files"), &OneRecDataset::IndexFile,
+          &OneRecDataset::VerifyRecord));
+      size_t world_size = 1;
+      int64_t rank = 0;
+      CHECK_JUST(InitDataSourceDistributedInfo(ctx, world_size, rank));
+      // All ranks have to shuffle with the same permutation.
+      int64_t seed = ctx->Attr<int64_t>("seed");
+      if (seed == -1) { seed = kOneflowDatasetSeed; }
+      auto* distributed_dataset = new DistributedTrainingDataset<TensorBuffer>(
+          world_size, rank, false, random_shuffle, seed, std::move(dataset));
+      distributed_dataset->Skip(ctx->Attr<int64_t>("start_sample"));
+      loader_.reset(distributed_dataset);
+      loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
+    } else if (random_shuffle) {
       const auto mode = ctx->Attr<std::string>("shuffle_mode");
       if (mode == "batch") {
         loader_.reset(new OneRecDataset(ctx, batch_size_));
@@ -42,6 +60,13 @@ class OneRecDataReader final : public DataReader<TensorBuffer> {
         loader_.reset(new OneRecDataset(ctx, 1));
         loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
         loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
+      } else if (mode == "index") {
+        int64_t seed = ctx->Attr<int64_t>("seed");
+        if (seed == -1) { seed = NewRandomSeed(); }
+        loader_.reset(new IndexShuffleDataset(
+            OneRecDataset::GetLocalFilePaths(ctx), &OneRecDataset::IndexFile,
+            &OneRecDataset::VerifyRecord, ctx->Attr<int32_t>("shuffle_buffer_size"), seed,
+            batch_size_));
       } else {
         UNIMPLEMENTED();
       }
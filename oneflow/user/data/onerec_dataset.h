@@ -18,11 +18,13 @@ limitations under the License.
 
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/distributed_util.h"
+#include "oneflow/user/data/mapped_record_file.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/block_compressed_file.h"
 #include "oneflow/core/job/job_set.pb.h"
 
 #define XXH_NAMESPACE LZ4_
@@ -97,6 +99,50 @@ class OneRecDataset final : public Dataset<TensorBuffer> {
 
   ~OneRecDataset() { CHECK_NE(LZ4_XXH64_freeState(hash_state_), XXH_ERROR); }
 
+  // Paths of the files read by this rank, in the order of the first epoch.
+  static std::vector<std::string> GetLocalFilePaths(user_op::KernelInitContext* ctx) {
+    const auto& data_file_paths = ctx->Attr<std::vector<std::string>>("files");
+    size_t world_size = 1;
+    int64_t rank = 0;
+    CHECK_JUST(InitDataSourceDistributedInfo(ctx, world_size, rank));
+    BalancedSplitter bs(data_file_paths.size(), world_size);
+    const Range range = bs.At(rank);
+    return std::vector<std::string>(data_file_paths.begin() + range.begin(),
+                                    data_file_paths.begin() + range.end());
+  }
+
+  // Indexes the frames of a OneRec file and checks their headers.
+  static void IndexFile(const char* data, size_t size, std::vector<RecordSpan>* records) {
+    CHECK(!IsBlockCompressedData(data, size))
+        << "block compressed files can not be indexed in place, read them as a stream";
+    size_t pos = 0;
+    while (pos < size) {
+      CHECK_LE(pos + kHeaderSize, size) << "truncated OneRec file";
+      OneRecFrameHeaderView header_view{};
+      std::memcpy(header_view.raw, data + pos, kHeaderSize);
+      CHECK_EQ(header_view.header.magic, kMagicNumber);
+      CHECK_EQ(header_view.header.reserved, kReservedNumber);
+      const int32_t payload_size = header_view.header.payload_size;
+      CHECK_GE(payload_size, 0);
+      CHECK_EQ(ByteSwap(header_view.header.digest),
+               XXH64(header_view.raw, kHeaderSizeWithoutDigest, 0));
+      const int64_t frame_size =
+          kHeaderSize + RoundUp(payload_size, kPayloadAlignmentSize) + kDigestFieldSize;
+      CHECK_LE(pos + frame_size, size) << "truncated OneRec file";
+      records->push_back(RecordSpan{static_cast<int64_t>(pos + kHeaderSize), payload_size});
+      pos += frame_size;
+    }
+  }
+
+  // Checks the payload of a frame indexed by IndexFile against its footer digest.
+  static void VerifyRecord(const MappedRecordFile& file, const RecordSpan& record) {
+    OneRecFrameFooterView footer_view{};
+    std::memcpy(footer_view.raw,
+                file.data() + record.offset + RoundUp(record.size, kPayloadAlignmentSize),
+                kDigestFieldSize);
+    CHECK_EQ(ByteSwap(footer_view.digest), XXH64(file.data() + record.offset, record.size, 0));
+  }
+
   BatchType Next() override {
     BatchType batch;
     batch.reserve(batch_size_);
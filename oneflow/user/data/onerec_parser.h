@@ -31,23 +31,29 @@ class OneRecParser final : public Parser<TensorBuffer> {
   using SampleType = typename Base::SampleType;
   using BatchType = typename Base::BatchType;
 
-  OneRecParser() = default;
+  explicit OneRecParser(bool verify_example) : verify_example_(verify_example) {}
   ~OneRecParser() = default;
 
+  bool HasPrepare() const override { return verify_example_; }
+
+  void Prepare(BatchType& batch_data) override {
+    for (auto& sample : batch_data) {
+      flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(sample.data()),
+                                     static_cast<size_t>(sample.elem_cnt()));
+      CHECK(onerec::example::VerifyExampleBuffer(verifier));
+    }
+  }
+
   void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
-    const bool verify_example = ctx->Attr<bool>("verify_example");
     FOR_RANGE(size_t, i, 0, batch_data.size()) {
-      auto& sample = batch_data[i];
-      if (verify_example) {
-        flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(sample.data()),
-                                       static_cast<size_t>(sample.elem_cnt()));
-        CHECK(onerec::example::VerifyExampleBuffer(verifier));
-      }
       TensorBuffer* out = out_tensor->mut_dptr<TensorBuffer>() + i;
-      out->Swap(sample);
+      out->Swap(batch_data[i]);
     }
   }
+
+ private:
+  bool verify_example_;
 };
 
 }  // namespace data
@@ -31,6 +31,10 @@ class Parser {
   Parser() = default;
   virtual ~Parser() = default;
 
+  // Per-batch work that does not need the kernel outputs, DataReader runs it on its prepare threads
+  // ahead of Parse.
+  virtual bool HasPrepare() const { return false; }
+  virtual void Prepare(BatchType& batch_data) {}
   virtual void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) = 0;
 };
 
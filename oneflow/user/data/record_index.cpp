@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/record_index.h"
+
+#ifdef __linux__
+#include "oneflow/core/embedding/posix_file.h"
+#include <libgen.h>
+#endif  // __linux__
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+constexpr uint64_t kRecordIndexMagic = 0x5844495243455246ULL;  // "FRECRIDX"
+constexpr uint32_t kRecordIndexVersion = 1;
+
+struct RecordIndexHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  int64_t data_file_size;
+  int64_t num_records;
+};
+static_assert(sizeof(RecordIndexHeader) == 32, "");
+static_assert(sizeof(RecordSpan) == 16, "");
+
+#ifdef __linux__
+
+void ReadFully(int fd, char* buf, size_t n) {
+  while (n > 0) {
+    const ssize_t ret = read(fd, buf, n);
+    PCHECK(ret > 0);
+    buf += ret;
+    n -= ret;
+  }
+}
+
+void WriteFully(int fd, const char* buf, size_t n) {
+  while (n > 0) {
+    const ssize_t ret = write(fd, buf, n);
+    PCHECK(ret > 0);
+    buf += ret;
+    n -= ret;
+  }
+}
+
+bool IsDirWritable(const std::string& path) {
+  std::vector<char> dirname_input(path.size() + 1);
+  std::memcpy(dirname_input.data(), path.c_str(), path.size() + 1);
+  return access(dirname(dirname_input.data()), W_OK) == 0;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+std::string RecordIndexPath(const std::string& data_path) { return data_path + ".idx"; }
+
+bool LoadRecordIndex(const std::string& data_path, int64_t data_file_size,
+                     std::vector<RecordSpan>* records) {
+#ifdef __linux__
+  const std::string index_path = RecordIndexPath(data_path);
+  if (!embedding::PosixFile::FileExists(index_path)) { return false; }
+  embedding::PosixFile file(index_path, O_RDONLY, 0644);
+  RecordIndexHeader header{};
+  CHECK_GE(file.Size(), sizeof(header)) << "truncated record index " << index_path;
+  ReadFully(file.fd(), reinterpret_cast<char*>(&header), sizeof(header));
+  CHECK_EQ(header.magic, kRecordIndexMagic) << "invalid record index " << index_path;
+  CHECK_EQ(header.version, kRecordIndexVersion) << "invalid record index " << index_path;
+  if (header.data_file_size != data_file_size) {
+    LOG(WARNING) << "ignore stale record index " << index_path;
+    return false;
+  }
+  CHECK_EQ(file.Size(), sizeof(header) + header.num_records * sizeof(RecordSpan))
+      << "truncated record index " << index_path;
+  records->resize(header.num_records);
+  ReadFully(file.fd(), reinterpret_cast<char*>(records->data()),
+            header.num_records * sizeof(RecordSpan));
+  return true;
+#else
+  return false;
+#endif  // __linux__
+}
+
+void SaveRecordIndex(const std::string& data_path, int64_t data_file_size,
+                     const std::vector<RecordSpan>& records) {
+#ifdef __linux__
+  if (!IsDirWritable(data_path)) { return; }
+  const std::string index_path = RecordIndexPath(data_path);
+  // Readers of other ranks may index the same file at the same time, each of them writes its
+  // own temporary file and the last rename wins with identical content.
+  const std::string tmp_path = index_path + ".tmp." + std::to_string(getpid());
+  {
+    embedding::PosixFile file(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    RecordIndexHeader header{};
+    header.magic = kRecordIndexMagic;
+    header.version = kRecordIndexVersion;
+    header.data_file_size = data_file_size;
+    header.num_records = records.size();
+    WriteFully(file.fd(), reinterpret_cast<const char*>(&header), sizeof(header));
+    WriteFully(file.fd(), reinterpret_cast<const char*>(records.data()),
+               records.size() * sizeof(RecordSpan));
+  }
+  PCHECK(rename(tmp_path.c_str(), index_path.c_str()) == 0);
+#endif  // __linux__
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_RECORD_INDEX_H_
+#define ONEFLOW_USER_DATA_RECORD_INDEX_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace data {
+
+// The payload of one record inside of a record file.
+struct RecordSpan {
+  int64_t offset;
+  int64_t size;
+};
+
+// Sidecar index of a record file, stored next to it as "<path>.idx":
+//
+//   | magic (8B) | version (4B) | reserved (4B) | data file size (8B) | num records (8B) |
+//   | record 0 offset (8B) | record 0 size (8B) | record 1 offset (8B) | ...               |
+//
+// All fields are little-endian. An index is stale and ignored when the size of its data file
+// differs from the recorded one.
+std::string RecordIndexPath(const std::string& data_path);
+
+// Returns false if the index of data_path does not exist or is stale.
+bool LoadRecordIndex(const std::string& data_path, int64_t data_file_size,
+                     std::vector<RecordSpan>* records);
+
+// Writes the index atomically, does nothing if the directory of data_path is read-only.
+void SaveRecordIndex(const std::string& data_path, int64_t data_file_size,
+                     const std::vector<RecordSpan>& records);
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_RECORD_INDEX_H_
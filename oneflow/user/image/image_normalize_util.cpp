@@ -0,0 +1,30 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/image/image_normalize_util.h"
+
+namespace oneflow {
+
+void NormalizeImageNHWC(const unsigned char* src, float* dst, int64_t num_pixels,
+                        const ImageNormalizeParam& param) {
+  for (int64_t i = 0; i < num_pixels; ++i) {
+    for (int c = 0; c < kImageNormalizeNumChannels; ++c) {
+      const int64_t offset = i * kImageNormalizeNumChannels + c;
+      dst[offset] = (static_cast<float>(src[offset]) - param.mean[c]) * param.inv_std[c];
+    }
+  }
+}
+
+}  // namespace oneflow
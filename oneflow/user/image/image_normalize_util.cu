@@ -0,0 +1,44 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/image/image_normalize_util.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+
+namespace {
+
+__global__ void NormalizeImageNHWCGpu(const unsigned char* src, float* dst, int64_t num_pixels,
+                                      ImageNormalizeParam param) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, num_pixels) {
+    const unsigned char* src_pixel = src + i * kImageNormalizeNumChannels;
+    float* dst_pixel = dst + i * kImageNormalizeNumChannels;
+#pragma unroll
+    for (int c = 0; c < kImageNormalizeNumChannels; ++c) {
+      dst_pixel[c] = (static_cast<float>(src_pixel[c]) - param.mean[c]) * param.inv_std[c];
+    }
+  }
+}
+
+}  // namespace
+
+void NormalizeImageNHWC(cudaStream_t stream, const unsigned char* src, float* dst,
+                        int64_t num_pixels, const ImageNormalizeParam& param) {
+  if (num_pixels == 0) { return; }
+  NormalizeImageNHWCGpu<<<BlocksNum4ThreadsNum(num_pixels), kCudaThreadsNumPerBlock, 0, stream>>>(
+      src, dst, num_pixels, param);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,47 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_IMAGE_IMAGE_NORMALIZE_UTIL_H_
+#define ONEFLOW_USER_IMAGE_IMAGE_NORMALIZE_UTIL_H_
+
+#include <cstdint>
+
+#ifdef WITH_CUDA
+#include <cuda_runtime.h>
+#endif  // WITH_CUDA
+
+namespace oneflow {
+
+constexpr int kImageNormalizeNumChannels = 3;
+
+// Per-channel (x - mean) / std of an interleaved uint8 image, std is stored as its reciprocal.
+struct ImageNormalizeParam {
+  float mean[kImageNormalizeNumChannels];
+  float inv_std[kImageNormalizeNumChannels];
+};
+
+void NormalizeImageNHWC(const unsigned char* src, float* dst, int64_t num_pixels,
+                        const ImageNormalizeParam& param);
+
+#ifdef WITH_CUDA
+
+void NormalizeImageNHWC(cudaStream_t stream, const unsigned char* src, float* dst,
+                        int64_t num_pixels, const ImageNormalizeParam& param);
+
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_IMAGE_IMAGE_NORMALIZE_UTIL_H_
@@ -18,10 +18,12 @@ limitations under the License.
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/job/parallel_desc.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/include/primitive/cast.h"
 #include "oneflow/user/kernels/gather_kernel_util.h"
 #include "oneflow/user/kernels/unsorted_segment_sum_kernel_util.h"
 #include "oneflow/core/cuda/atomic.cuh"
 #include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/core/embedding/embedding_manager.h"
 
 namespace oneflow {
 
@@ -40,12 +42,17 @@ __global__ void HashTableUniqueAndPartitionPairs(const uint32_t table_capacity,
                                                  const K* keys, const V* values,
                                                  K* partitioned_unique_keys,
                                                  V* partitioned_unique_values, IDX* reverse_index,
-                                                 bool need_process_values) {
+                                                 bool need_process_values,
+                                                 const int64_t* column_parallel_ids) {
   CUDA_1D_KERNEL_LOOP_T(uint32_t, i, num_keys) {
     IDX r_index_plus_one = 0;
     const K key = keys[i];
     size_t key_hash = HASH()(key);
     uint32_t partition_id = key_hash % num_partition;
+    if (column_parallel_ids != nullptr) {
+      const int64_t parallel_id = column_parallel_ids[values[i]];
+      if (parallel_id >= 0) { partition_id = parallel_id; }
+    }
     IDX* unique_count = unique_counts + partition_id;
     K* unique_keys = partitioned_unique_keys + partition_id * num_keys;
     uint32_t pos = key_hash % table_capacity;
@@ -98,7 +105,8 @@ void UniqueAndPartition(cudaStream_t cuda_stream, int64_t num_ids, size_t capaci
                         int64_t num_partition, const K* ids, const V* column_ids,
                         IDX* num_partitioned_unique_ids_ptr, K* partitioned_unique_ids,
                         V* partitioned_unique_column_ids, IDX* inverse_unique_partition_indices,
-                        void* workspace_ptr, size_t workspace_bytes, bool need_process_column_ids) {
+                        void* workspace_ptr, size_t workspace_bytes, bool need_process_column_ids,
+                        const int64_t* column_parallel_ids) {
   size_t table_capacity_bytes = capacity * sizeof(TableEntry<K>);
   CHECK_GE(workspace_bytes, table_capacity_bytes);
   OF_CUDA_CHECK(cudaMemsetAsync(workspace_ptr, 0, table_capacity_bytes, cuda_stream));
@@ -108,7 +116,8 @@ void UniqueAndPartition(cudaStream_t cuda_stream, int64_t num_ids, size_t capaci
       <<<BlocksNum4ThreadsNum(num_ids), kCudaThreadsNumPerBlock, 0, cuda_stream>>>(
           capacity, num_ids, num_partition, num_partitioned_unique_ids_ptr,
           reinterpret_cast<TableEntry<K>*>(workspace_ptr), ids, column_ids, partitioned_unique_ids,
-          partitioned_unique_column_ids, inverse_unique_partition_indices, need_process_column_ids);
+          partitioned_unique_column_ids, inverse_unique_partition_indices, need_process_column_ids,
+          column_parallel_ids);
 }
 
 template<typename T>
@@ -296,6 +305,38 @@ class DataShuffleKernelState final : public user_op::OpKernelState {
   IDX* host_num_unique_matrix_;
 };
 
+template<typename IDX>
+class IdShuffleKernelState final : public user_op::OpKernelState {
+ public:
+  explicit IdShuffleKernelState(user_op::KernelInitContext* ctx)
+      : data_shuffle_state_(ctx), device_index_(-1), column_parallel_ids_(nullptr) {
+    const auto& column_parallel_ids = ctx->Attr<std::vector<int64_t>>("column_parallel_ids");
+    if (!column_parallel_ids.empty()) {
+      OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+      const size_t bytes = column_parallel_ids.size() * sizeof(int64_t);
+      OF_CUDA_CHECK(cudaMalloc(&column_parallel_ids_, bytes));
+      OF_CUDA_CHECK(
+          cudaMemcpy(column_parallel_ids_, column_parallel_ids.data(), bytes, cudaMemcpyDefault));
+    }
+  }
+  ~IdShuffleKernelState() override {
+    if (column_parallel_ids_ != nullptr) {
+      CudaCurrentDeviceGuard guard(device_index_);
+      OF_CUDA_CHECK(cudaFree(column_parallel_ids_));
+    }
+  }
+
+  DataShuffleKernelState<IDX>* data_shuffle_state() { return &data_shuffle_state_; }
+
+  // The rank holding every column placed table-wise, nullptr if all columns are row-wise.
+  const int64_t* column_parallel_ids() const { return column_parallel_ids_; }
+
+ private:
+  DataShuffleKernelState<IDX> data_shuffle_state_;
+  int device_index_;
+  int64_t* column_parallel_ids_;
+};
+
 }  // namespace
 
 template<typename K, typename U, typename IDX>
@@ -306,15 +347,16 @@ class IdShuffleKernel final : public user_op::OpKernel {
 
   std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
       user_op::KernelInitContext* ctx) const override {
-    return std::make_shared<DataShuffleKernelState<IDX>>(ctx);
+    return std::make_shared<IdShuffleKernelState<IDX>>(ctx);
   }
 
  private:
   using user_op::OpKernel::Compute;
   void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
                const user_op::OpKernelCache*) const override {
-    auto* kernel_state = dynamic_cast<DataShuffleKernelState<IDX>*>(state);
-    CHECK(kernel_state != nullptr);
+    auto* id_shuffle_state = dynamic_cast<IdShuffleKernelState<IDX>*>(state);
+    CHECK(id_shuffle_state != nullptr);
+    DataShuffleKernelState<IDX>* kernel_state = id_shuffle_state->data_shuffle_state();
     const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
     user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
     user_op::Tensor* inverse_unique_partition_indices =
@@ -365,7 +407,7 @@ class IdShuffleKernel final : public user_op::OpKernel {
         reinterpret_cast<const K*>(ids->dptr()), column_ids_ptr, num_partitioned_unique,
         partitioned_unique_ids, partitioned_unique_column_ids,
         reinterpret_cast<IDX*>(inverse_unique_partition_indices->mut_dptr()), workspace_ptr,
-        workspace_size, need_process_column_ids);
+        workspace_size, need_process_column_ids, id_shuffle_state->column_parallel_ids());
     ncclComm_t comm = kernel_state->comm();
     OF_NCCL_CHECK(ncclAllGather(num_partitioned_unique, num_unique_matrix_ptr, parallel_num,
                                 GetNcclDataType(num_unique_matrix->data_type()), comm,
@@ -390,7 +432,7 @@ class IdShuffleKernel final : public user_op::OpKernel {
         reinterpret_cast<K*>(cur_rank_unique_ids->mut_dptr()),
         reinterpret_cast<U*>(cur_rank_unique_column_ids->mut_dptr()),
         reinterpret_cast<IDX*>(cur_rank_inverse_indices->mut_dptr()), workspace_ptr, workspace_size,
-        need_process_column_ids);
+        need_process_column_ids, nullptr);
     if (!need_process_column_ids) {
       OF_CUDA_CHECK(cudaMemsetAsync(cur_rank_unique_column_ids->mut_dptr(), 0,
                                     received_elem_cnt * sizeof(U), cuda_stream));
@@ -662,4 +704,238 @@ class EmbeddingGradientShuffleKernel final : public user_op::OpKernel {
 OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CUDA_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
                                  FLOATING_DATA_TYPE_SEQ HALF_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
 
+namespace {
+
+template<typename IDX>
+class EmbeddingLookupShuffleKernelState final : public user_op::OpKernelState {
+ public:
+  explicit EmbeddingLookupShuffleKernelState(user_op::KernelInitContext* ctx)
+      : shuffle_state_(ctx) {
+    embedding::KeyValueStoreOptions options(ctx->Attr<std::string>("key_value_store_options"));
+    const user_op::TensorDesc* cur_rank_unique_ids =
+        ctx->TensorDesc4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    key_value_store_ = Global<embedding::EmbeddingManager>::Get()->GetOrCreateKeyValueStore(
+        options, ctx->parallel_ctx().parallel_id(), ctx->parallel_ctx().parallel_num(),
+        cur_rank_unique_ids->shape().elem_cnt());
+  }
+  ~EmbeddingLookupShuffleKernelState() override = default;
+
+  DataShuffleKernelState<IDX>* ShuffleState() { return &shuffle_state_; }
+
+  embedding::KeyValueStore* KeyValueStore() { return key_value_store_; }
+
+ private:
+  DataShuffleKernelState<IDX> shuffle_state_;
+  embedding::KeyValueStore* key_value_store_;
+};
+
+template<typename K, typename IDX>
+__global__ void GatherReceivedIdsKernel(int64_t num_ids, const IDX* cur_rank_inverse_indices,
+                                        const K* cur_rank_unique_ids, K* received_ids) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, num_ids) {
+    received_ids[i] = cur_rank_unique_ids[cur_rank_inverse_indices[i]];
+  }
+}
+
+// Rows missing in the store are sent as zeros.
+__global__ void ZeroMissingRowsKernel(int64_t max_elem_cnt, int64_t embedding_size,
+                                      const uint32_t* n_missing, const uint32_t* missing_indices,
+                                      float* values) {
+  const int64_t missing_elem_cnt = *n_missing * embedding_size;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, max_elem_cnt) {
+    if (i < missing_elem_cnt) {
+      const int64_t row = i / embedding_size;
+      const int64_t col = i - row * embedding_size;
+      values[missing_indices[row] * embedding_size + col] = 0;
+    }
+  }
+}
+
+template<typename T>
+class EmbeddingLookupShuffleTmpBufferManager final {
+ public:
+  EmbeddingLookupShuffleTmpBufferManager(void* ptr, int64_t num_keys, int64_t key_size,
+                                         int64_t embedding_size)
+      : ptr_(ptr) {
+    const size_t embeddings_size = GetCudaAlignedSize(num_keys * embedding_size * sizeof(T));
+    received_ids_offset_ = 0;
+    // The store holds float rows, other types are looked up into a float buffer and then cast.
+    lookup_values_offset_ = received_ids_offset_ + GetCudaAlignedSize(num_keys * key_size);
+    send_embeddings_offset_ =
+        lookup_values_offset_
+        + (std::is_same<T, float>::value
+               ? 0
+               : GetCudaAlignedSize(num_keys * embedding_size * sizeof(float)));
+    received_embeddings_offset_ = send_embeddings_offset_ + embeddings_size;
+    n_missing_offset_ = received_embeddings_offset_ + embeddings_size;
+    missing_indices_offset_ = n_missing_offset_ + GetCudaAlignedSize(sizeof(uint32_t));
+    total_buffer_size_ =
+        missing_indices_offset_ + GetCudaAlignedSize(num_keys * sizeof(uint32_t));
+  }
+  ~EmbeddingLookupShuffleTmpBufferManager() = default;
+
+  size_t TotalBufferSize() const { return total_buffer_size_; }
+
+  void* ReceivedIds() const { return Ptr<void>(received_ids_offset_); }
+  float* LookupValues() const {
+    return std::is_same<T, float>::value ? Ptr<float>(send_embeddings_offset_)
+                                         : Ptr<float>(lookup_values_offset_);
+  }
+  T* SendEmbeddings() const { return Ptr<T>(send_embeddings_offset_); }
+  T* ReceivedEmbeddings() const { return Ptr<T>(received_embeddings_offset_); }
+  uint32_t* NumMissing() const { return Ptr<uint32_t>(n_missing_offset_); }
+  uint32_t* MissingIndices() const { return Ptr<uint32_t>(missing_indices_offset_); }
+
+ private:
+  template<typename U>
+  U* Ptr(size_t offset) const {
+    CHECK(ptr_ != nullptr);
+    return reinterpret_cast<U*>(reinterpret_cast<char*>(ptr_) + offset);
+  }
+
+  void* ptr_;
+  size_t received_ids_offset_;
+  size_t lookup_values_offset_;
+  size_t send_embeddings_offset_;
+  size_t received_embeddings_offset_;
+  size_t n_missing_offset_;
+  size_t missing_indices_offset_;
+  size_t total_buffer_size_;
+};
+
+template<typename IDX>
+void GatherReceivedIds(ep::Stream* stream, int64_t key_size, int64_t num_ids,
+                       const IDX* cur_rank_inverse_indices, const void* cur_rank_unique_ids,
+                       void* received_ids) {
+  if (key_size == sizeof(uint32_t)) {
+    RUN_CUDA_KERNEL((GatherReceivedIdsKernel<uint32_t, IDX>), stream, num_ids, num_ids,
+                    cur_rank_inverse_indices, static_cast<const uint32_t*>(cur_rank_unique_ids),
+                    static_cast<uint32_t*>(received_ids));
+  } else if (key_size == sizeof(uint64_t)) {
+    RUN_CUDA_KERNEL((GatherReceivedIdsKernel<uint64_t, IDX>), stream, num_ids, num_ids,
+                    cur_rank_inverse_indices, static_cast<const uint64_t*>(cur_rank_unique_ids),
+                    static_cast<uint64_t*>(received_ids));
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace
+
+// Fuses the lookup of the ids received by this rank in the key value store with
+// embedding_shuffle. The received ids are looked up as they are, so the rows land in the send
+// layout directly instead of being gathered from the unique rows, an id requested by several
+// ranks is looked up once for each of them.
+template<typename T, typename IDX>
+class EmbeddingLookupShuffleKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingLookupShuffleKernel() = default;
+  ~EmbeddingLookupShuffleKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<EmbeddingLookupShuffleKernelState<IDX>>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<EmbeddingLookupShuffleKernelState<IDX>*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_unique_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+
+    const int64_t embedding_size = embeddings->shape().At(embeddings->shape().NumAxes() - 1);
+    const int64_t num_ids = inverse_unique_partition_indices->shape().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    const int64_t num_keys = cur_rank_unique_ids->shape().elem_cnt();
+    const int64_t key_size = GetSizeOfDataType(cur_rank_unique_ids->data_type());
+    CHECK_EQ(num_keys, parallel_num * num_ids);
+    embedding::KeyValueStore* store = kernel_state->KeyValueStore();
+    CHECK_EQ(store->KeySize(), key_size);
+    CHECK_EQ(store->ValueSize(), embedding_size * sizeof(float));
+    EmbeddingLookupShuffleTmpBufferManager<T> buffer_manager(tmp_buffer->mut_dptr(), num_keys,
+                                                             key_size, embedding_size);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), buffer_manager.TotalBufferSize());
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    IDX* host_num_unique_matrix = kernel_state->ShuffleState()->HostNumUniqueMatrix();
+    OF_CUDA_CHECK(cudaMemcpyAsync(
+        host_num_unique_matrix, reinterpret_cast<const IDX*>(num_unique_matrix->dptr()),
+        parallel_num * parallel_num * sizeof(IDX), cudaMemcpyDefault, cuda_stream));
+    CHECK_JUST(ctx->stream()->Sync());
+    int64_t cur_rank_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += host_num_unique_matrix[i * parallel_num + parallel_id];
+    }
+
+    const int64_t send_elem_cnt = cur_rank_num_ids * embedding_size;
+    if (cur_rank_num_ids > 0) {
+      GatherReceivedIds<IDX>(ctx->stream(), key_size, cur_rank_num_ids,
+                             reinterpret_cast<const IDX*>(cur_rank_inverse_indices->dptr()),
+                             cur_rank_unique_ids->dptr(), buffer_manager.ReceivedIds());
+    }
+    store->Get(ctx->stream(), cur_rank_num_ids, buffer_manager.ReceivedIds(),
+               buffer_manager.LookupValues(), buffer_manager.NumMissing(),
+               buffer_manager.MissingIndices());
+    if (send_elem_cnt > 0) {
+      RUN_CUDA_KERNEL(ZeroMissingRowsKernel, ctx->stream(), send_elem_cnt, send_elem_cnt,
+                      embedding_size, buffer_manager.NumMissing(),
+                      buffer_manager.MissingIndices(), buffer_manager.LookupValues());
+      if (!std::is_same<T, float>::value) {
+        auto cast = ep::primitive::NewPrimitive<ep::primitive::CastFactory>(
+            DeviceType::kCUDA, DataType::kFloat, embeddings->data_type());
+        CHECK(cast);
+        cast->Launch(ctx->stream(), buffer_manager.LookupValues(),
+                     buffer_manager.SendEmbeddings(), send_elem_cnt);
+      }
+    }
+
+    ncclComm_t comm = kernel_state->ShuffleState()->comm();
+    ShuffleEmbeddings(cuda_stream, comm, parallel_id, parallel_num, num_ids, embedding_size,
+                      embeddings->data_type(), host_num_unique_matrix,
+                      buffer_manager.SendEmbeddings(), buffer_manager.ReceivedEmbeddings());
+
+    // reverse unique_partition
+    GatherKernelUtilImpl<DeviceType::kCUDA, T, IDX>::Forward(
+        ctx->stream(), reinterpret_cast<const IDX*>(inverse_unique_partition_indices->dptr()),
+        inverse_unique_partition_indices->shape().elem_cnt(), buffer_manager.ReceivedEmbeddings(),
+        Shape({1, parallel_num * num_ids, embedding_size}), embeddings->mut_dptr<T>(), 0);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUDA_EMBEDDING_LOOKUP_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)               \
+  REGISTER_USER_KERNEL("embedding_lookup_shuffle")                                                \
+      .SetCreateFn<EmbeddingLookupShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                   \
+                                                OF_PP_PAIR_FIRST(idx_dtype_pair)>>()              \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCUDA)                                         \
+          && (user_op::HobDataType("embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))           \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& cur_rank_unique_ids =                                          \
+            ctx->InputTensorDesc("cur_rank_unique_ids", 0);                                       \
+        const user_op::TensorDesc* embeddings = ctx->OutputTensorDesc("embeddings", 0);           \
+        const int64_t embedding_size =                                                            \
+            embeddings->shape().At(embeddings->shape().NumAxes() - 1);                            \
+        EmbeddingLookupShuffleTmpBufferManager<OF_PP_PAIR_FIRST(t_dtype_pair)> buffer_manager(    \
+            nullptr, cur_rank_unique_ids.shape().elem_cnt(),                                      \
+            GetSizeOfDataType(cur_rank_unique_ids.data_type()), embedding_size);                  \
+        return buffer_manager.TotalBufferSize();                                                  \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CUDA_EMBEDDING_LOOKUP_SHUFFLE_KERNEL,
+                                 OF_PP_MAKE_TUPLE_SEQ(float, DataType::kFloat)
+                                     HALF_DATA_TYPE_SEQ,
+                                 IDX_DATA_TYPE_SEQ)
+
 }  // namespace oneflow
@@ -17,31 +17,33 @@ limitations under the License.
 #include "oneflow/user/kernels/distributions/normal_distribution.h"
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
 
 namespace oneflow {
 
 namespace {
 
-template<typename T>
-__device__ T GenNormal(curandState* state, const T mean, const T std);
+// Each element draws from its own Philox subsequence.
+__device__ float GenNormalRaw(cuda::philox::State* state, float) { return curand_normal(state); }
 
-template<>
-__device__ float GenNormal<float>(curandState* state, const float mean, const float std) {
-  return (curand_normal(state) + mean) / std;
+__device__ double GenNormalRaw(cuda::philox::State* state, double) {
+  return curand_normal_double(state);
 }
 
-template<>
-__device__ double GenNormal<double>(curandState* state, const double mean, const double std) {
-  return (curand_normal_double(state) + mean) / std;
+template<typename T>
+__device__ T GenNormal(cuda::philox::State* state, const T mean, const T std) {
+  return (GenNormalRaw(state, T()) + mean) / std;
 }
 
 template<typename T>
-__global__ void GenerateGpu(curandState* state, const int64_t elem_cnt, T* dptr, const T mean,
-                            const T std) {
-  const int id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandState localState = state[id];
-  CUDA_1D_KERNEL_LOOP(i, elem_cnt) { dptr[i] = GenNormal<T>(&localState, mean, std); }
-  state[id] = localState;
+__global__ void GenerateGpu(uint64_t seed, one::CUDAGeneratorState* gen_state,
+                            const int64_t elem_cnt, T* dptr, const T mean, const T std) {
+  const uint64_t offset = cuda::philox::Offset(gen_state);
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
+    cuda::philox::State state = cuda::philox::MakeState(seed, offset, i);
+    dptr[i] = GenNormal<T>(&state, mean, std);
+  }
+  cuda::philox::AdvanceOffset(gen_state, cuda::philox::kOffsetIncrement);
 }
 
 }  // namespace
@@ -51,12 +53,12 @@ void NormalDistribution<DeviceType::kCUDA, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0);
+  if (elem_cnt == 0) { return; }
   auto gen = CHECK_JUST(generator->Get<one::CUDAGeneratorImpl>());
   int32_t block_num = gen->max_block_num();
   int32_t thread_num = gen->max_thread_num();
-  auto* curand_states = gen->curand_states();
   GenerateGpu<T><<<block_num, thread_num, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-      curand_states, elem_cnt, dptr, mean_, std_);
+      gen->current_seed(), gen->cuda_gen_state(), elem_cnt, dptr, mean_, std_);
 }
 
 #define INITIATE_CUDA_NORMAL_DISTRIBUTION(T, typeproto)               \
@@ -19,10 +19,6 @@ limitations under the License.
 
 #include "oneflow/core/ep/include/stream.h"
 #include "oneflow/core/framework/random_generator.h"
-#ifdef WITH_CUDA
-#include <curand.h>
-#include <curand_kernel.h>
-#endif
 
 namespace oneflow {
 
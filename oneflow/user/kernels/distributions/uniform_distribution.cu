@@ -16,37 +16,38 @@ limitations under the License.
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/user/kernels/distributions/uniform_distribution.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
 
 namespace oneflow {
 
 namespace {
 
-template<typename T>
-__device__ T GenUniform(curandState* state, const T low, const T high);
+// Each element draws from its own Philox subsequence, a float or a double from (0.0, 1.0].
+__device__ float GenUniformRaw(cuda::philox::State* state, float) {
+  return curand_uniform(state);
+}
 
-template<>
-__device__ float GenUniform<float>(curandState* state, const float low, const float high) {
-  auto rand_num = curand_uniform(state);
-  // curand_uniform generates (0.0, 1.0], but we want [0.0, 1.0) here
-  if (rand_num == 1.0) { rand_num = 0.0; }
-  return rand_num * (high - low) + low;
+__device__ double GenUniformRaw(cuda::philox::State* state, double) {
+  return curand_uniform_double(state);
 }
 
-template<>
-__device__ double GenUniform<double>(curandState* state, const double low, const double high) {
-  auto rand_num = curand_uniform_double(state);
-  // curand_uniform_double generates (0.0, 1.0], but we want [0.0, 1.0) here
+template<typename T>
+__device__ T GenUniform(cuda::philox::State* state, const T low, const T high) {
+  auto rand_num = GenUniformRaw(state, T());
+  // curand_uniform generates (0.0, 1.0], but we want [0.0, 1.0) here
   if (rand_num == 1.0) { rand_num = 0.0; }
   return rand_num * (high - low) + low;
 }
 
 template<typename T>
-__global__ void GenerateGpu(curandState* state, const int64_t elem_cnt, T* dptr, const T low,
-                            const T high) {
-  const int id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandState localState = state[id];
-  CUDA_1D_KERNEL_LOOP(i, elem_cnt) { dptr[i] = GenUniform<T>(&localState, low, high); }
-  state[id] = localState;
+__global__ void GenerateGpu(uint64_t seed, one::CUDAGeneratorState* gen_state,
+                            const int64_t elem_cnt, T* dptr, const T low, const T high) {
+  const uint64_t offset = cuda::philox::Offset(gen_state);
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
+    cuda::philox::State state = cuda::philox::MakeState(seed, offset, i);
+    dptr[i] = GenUniform<T>(&state, low, high);
+  }
+  cuda::philox::AdvanceOffset(gen_state, cuda::philox::kOffsetIncrement);
 }
 
 }  // namespace
@@ -56,12 +57,12 @@ void UniformDistribution<DeviceType::kCUDA, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0);
+  if (elem_cnt == 0) { return; }
   auto gen = CHECK_JUST(generator->Get<one::CUDAGeneratorImpl>());
   int32_t block_num = gen->max_block_num();
   int32_t thread_num = gen->max_thread_num();
-  auto* curand_states = gen->curand_states();
   GenerateGpu<T><<<block_num, thread_num, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-      curand_states, elem_cnt, dptr, low_, high_);
+      gen->current_seed(), gen->cuda_gen_state(), elem_cnt, dptr, low_, high_);
 }
 
 #define INITIATE_CUDA_UNIFORM_DISTRIBUTION(T, typeproto)               \
@@ -19,27 +19,31 @@ limitations under the License.
 #include "oneflow/core/framework/dtype.h"
 #include "oneflow/user/kernels/distributions/uniform_int_distribution.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
 
 namespace oneflow {
 
 namespace {
 
-__device__ int64_t GenUniformInt(curandState* state, const int64_t low, const int64_t high) {
+__device__ int64_t GenUniformInt(cuda::philox::State* state, const int64_t low,
+                                 const int64_t high) {
   auto rand_num = curand_uniform(state);
   // curand_uniform generates (0.0, 1.0], but we want [0.0, 1.0) here
   if (rand_num == 1.0) { rand_num = 0.0; }
   return static_cast<int64_t>(rand_num * (high - low) + low);
 }
 
+// Each element draws from its own Philox subsequence.
 template<typename T>
-__global__ void GenerateGpu(curandState* state, const int64_t elem_cnt, T* dptr, const int64_t low,
+__global__ void GenerateGpu(uint64_t seed, one::CUDAGeneratorState* gen_state,
+                            const int64_t elem_cnt, T* dptr, const int64_t low,
                             const int64_t high) {
-  const int id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandState localState = state[id];
+  const uint64_t offset = cuda::philox::Offset(gen_state);
   CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
-    dptr[i] = static_cast<T>(GenUniformInt(&localState, low, high));
+    cuda::philox::State state = cuda::philox::MakeState(seed, offset, i);
+    dptr[i] = static_cast<T>(GenUniformInt(&state, low, high));
   }
-  state[id] = localState;
+  cuda::philox::AdvanceOffset(gen_state, cuda::philox::kOffsetIncrement);
 }
 
 }  // namespace
@@ -49,12 +53,12 @@ void UniformIntDistribution<DeviceType::kCUDA, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0);
+  if (elem_cnt == 0) { return; }
   auto gen = CHECK_JUST(generator->Get<one::CUDAGeneratorImpl>());
   int32_t block_num = gen->max_block_num();
   int32_t thread_num = gen->max_thread_num();
-  auto* curand_states = gen->curand_states();
   GenerateGpu<T><<<block_num, thread_num, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-      curand_states, elem_cnt, dptr, low_, high_);
+      gen->current_seed(), gen->cuda_gen_state(), elem_cnt, dptr, low_, high_);
 }
 
 #define INITIATE_CUDA_UNIFORM_INT_DISTRIBUTION(T, typeproto)              \
@@ -30,18 +30,37 @@ void MaskAndScale(ep::Stream* stream, const int64_t n, float scale, const T* x,
 }
 
 template<typename T>
-void FusedDropoutKernel(ep::Stream* stream, const int64_t elem_cnt,
+void BitMaskAndScale(ep::Stream* stream, const int64_t elem_cnt, const int64_t row_size,
+                     float scale, const T* x, const uint8_t* mask, T* y) {
+  const int64_t bytes_per_row = RoundUp(row_size, kDropoutMaskBits) / kDropoutMaskBits;
+  for (int64_t i = 0; i < elem_cnt; ++i) {
+    const int64_t row = i / row_size;
+    const int64_t col = i - row * row_size;
+    const uint8_t bits = mask[row * bytes_per_row + col / kDropoutMaskBits];
+    const bool keep = (bits >> (col % kDropoutMaskBits)) & 1;
+    y[i] = x[i] * static_cast<T>(keep) * scale;
+  }
+}
+
+template<typename T>
+void FusedDropoutKernel(ep::Stream* stream, const int64_t elem_cnt, const int64_t row_size,
                         const std::shared_ptr<one::CPUGeneratorImpl>& cpu_gen, const float rate,
-                        float scale, const T* x, bool* mask, T* y) {
+                        float scale, const T* x, uint8_t* mask, T* y) {
   /*
   `uniform_real_distribution` interval is [a, b).
   And `curand_uniform4` interval is (0, 1.0], so we use > in CUDA and use >= in CPU.
   */
   std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
                                                             GetOneVal<float>());
+  const int64_t bytes_per_row = RoundUp(row_size, kDropoutMaskBits) / kDropoutMaskBits;
+  std::memset(mask, 0, elem_cnt / row_size * bytes_per_row);
   for (int64_t i = 0; i < elem_cnt; ++i) {
-    mask[i] = random_distribution(cpu_gen->engine()) >= rate;
-    y[i] = x[i] * static_cast<T>(mask[i]) * scale;
+    const int64_t row = i / row_size;
+    const int64_t col = i - row * row_size;
+    const bool keep = random_distribution(cpu_gen->engine()) >= rate;
+    uint8_t* bits = mask + row * bytes_per_row + col / kDropoutMaskBits;
+    *bits |= static_cast<uint8_t>(keep) << (col % kDropoutMaskBits);
+    y[i] = x[i] * static_cast<T>(keep) * scale;
   }
 }
 
@@ -74,8 +93,11 @@ class DropoutKernelCPU final : public user_op::OpKernel {
     std::shared_ptr<one::CPUGeneratorImpl> cpu_generator =
         CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
 
-    FusedDropoutKernel<T>(ctx->stream(), in->shape().elem_cnt(), cpu_generator, rate, scale,
-                          in->dptr<T>(), mask->mut_dptr<bool>(), out->mut_dptr<T>());
+    const int64_t elem_cnt = in->shape().elem_cnt();
+    if (elem_cnt == 0) { return; }
+    FusedDropoutKernel<T>(ctx->stream(), elem_cnt, DropoutMaskRowSize(in->shape()),
+                          cpu_generator, rate, scale, in->dptr<T>(), mask->mut_dptr<uint8_t>(),
+                          out->mut_dptr<T>());
 
     if (ctx->has_input("_add_to_output", 0)) {
       const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
@@ -97,7 +119,7 @@ class DropoutKernelCPU final : public user_op::OpKernel {
       .SetCreateFn<DropoutKernelCPU<dtype>>()                                                   \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
                        && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value)         \
-                       && (user_op::HobDataType("mask", 0) == GetDataType<bool>::value))        \
+                       && (user_op::HobDataType("mask", 0) == GetDataType<uint8_t>::value))     \
       .SetInplaceProposalFn([](const user_op::InferContext&,                                    \
                                user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
         OF_RETURN_IF_ERROR(AddInplaceArgPairFn("out", 0, "in", 0, true));                       \
@@ -119,8 +141,16 @@ class DropoutGradKernelCPU final : public user_op::OpKernel {
     const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
     user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
     const float scale = ctx->Attr<float>("scale");
-    MaskAndScale<T>(ctx->stream(), dy->shape().elem_cnt(), scale, dy->dptr<T>(), mask->dptr<bool>(),
-                    dx->mut_dptr<T>());
+    if (mask->data_type() == DataType::kBool) {
+      MaskAndScale<T>(ctx->stream(), dy->shape().elem_cnt(), scale, dy->dptr<T>(),
+                      mask->dptr<bool>(), dx->mut_dptr<T>());
+    } else {
+      // The packed mask of dropout, masks from random_mask_like keep a bool per element.
+      const int64_t elem_cnt = dy->shape().elem_cnt();
+      if (elem_cnt == 0) { return; }
+      BitMaskAndScale<T>(ctx->stream(), elem_cnt, DropoutMaskRowSize(dy->shape()), scale,
+                         dy->dptr<T>(), mask->dptr<uint8_t>(), dx->mut_dptr<T>());
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -16,7 +16,7 @@ limitations under the License.
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/cuda/elementwise.cuh"
-#include "oneflow/core/cuda/atomic.cuh"
+#include "oneflow/core/cuda/philox.cuh"
 #include "oneflow/user/kernels/dropout_kernel.h"
 #include "oneflow/core/kernel/cuda_graph_support.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
@@ -29,351 +29,189 @@ constexpr int32_t kVecSize = 4;
 constexpr int32_t kBlockSize = 256;
 
 template<typename T>
-constexpr int32_t GetDropoutPackSize() {
-  // For float, bfloat16, half.
-  return 4;
-};
-
-template<>
-constexpr int32_t GetDropoutPackSize<half2>() {
-  return 2;
-};
-
-template<>
-constexpr int32_t GetDropoutPackSize<double>() {
-  return 2;
-};
-
-union RandPack4 {
-  float4 storage;
-  float elem[4];
-};
-
-template<typename T>
-struct GetPack2Type {
-  using T2 = typename std::aligned_storage<2 * sizeof(T), 2 * sizeof(T)>::type;
-};
-
-template<>
-struct GetPack2Type<half> {
-  using T2 = half2;
-};
-
-#if CUDA_VERSION >= 11000
-template<>
-struct GetPack2Type<nv_bfloat16> {
-  using T2 = nv_bfloat162;
-};
-#endif
-
-template<typename T>
-using Pack2Type = typename GetPack2Type<T>::T2;
-
-using H2PackType = typename std::aligned_storage<4 * sizeof(half), 4 * sizeof(half)>::type;
-
-template<typename T>
-union H2Pack {
-  cuda::elementwise::Pack<T, 4> pack_storage;
-  Pack2Type<T> h2[2];
-  __device__ H2Pack() {
-    // do nothing
-  }
-};
-
-template<>
-union H2Pack<half> {
-  cuda::elementwise::Pack<half, 4> pack_storage;
-  half2 h2[2];
-  __device__ H2Pack() {
-    // do nothing
-  }
-};
-
-#if CUDA_VERSION >= 11000
-template<>
-union H2Pack<nv_bfloat16> {
-  cuda::elementwise::Pack<nv_bfloat16, 4> pack_storage;
-  nv_bfloat162 h2[2];
-  __device__ H2Pack() {
-    // do nothing
-  }
-};
-#endif
+using DropoutComputeType =
+    typename std::conditional<std::is_same<T, double>::value, double, float>::type;
 
+// Elements of a byte loaded at a time when the rows are a whole number of bytes.
 template<typename T>
-__device__ Pack2Type<T> Make2(float v);
-
-template<>
-__device__ Pack2Type<half> Make2<half>(float v) {
-  return __float2half2_rn(v);
+constexpr int32_t GetDropoutPackSize() {
+  return cuda::elementwise::kMaxPackBytes / sizeof(T) < kDropoutMaskBits
+             ? cuda::elementwise::kMaxPackBytes / sizeof(T)
+             : kDropoutMaskBits;
 }
 
-#if CUDA_VERSION >= 11000
-template<>
-__device__ Pack2Type<nv_bfloat16> Make2<nv_bfloat16>(float v) {
-  return __float2bfloat162_rn(v);
+// Elements that took their numbers from one curand_uniform4 of a thread, before the mask was
+// packed into bits.
+template<typename T>
+constexpr int32_t GetRandPackSize() {
+  return std::is_same<T, double>::value ? 2 : 4;
 }
-#endif
-
-#if CUDA_VERSION >= 11000
-#define RETURN_VOID_IF_HALF                                                                        \
-  typename std::enable_if_t<(std::is_same<T, half>::value || std::is_same<T, nv_bfloat16>::value), \
-                            void>
-#else
-#define RETURN_VOID_IF_HALF typename std::enable_if_t<std::is_same<T, half>::value, void>
-#endif
-#define RETURN_VOID_IF_FLOAT typename std::enable_if_t<std::is_same<T, float>::value, void>
-#define RETURN_VOID_IF_DOUBLE typename std::enable_if_t<std::is_same<T, double>::value, void>
 
-template<typename T, int pack_size, bool tail, bool has_addend>
-__global__ RETURN_VOID_IF_FLOAT FusedDropoutAddGpu(
-    uint64_t seed, one::CUDAGeneratorState* cuda_gen_state, uint64_t inc_offset,
-    const int64_t elem_cnt, float rate, float scale, int64_t n_tail, const T* x, bool* mask,
-    const T* addend, T* y, const T* tail_x, bool* tail_mask, const T* tail_addend, T* tail_y) {
-  int32_t global_thread_id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandStatePhilox4_32_10_t state;
-  curand_init(seed, global_thread_id, cuda_gen_state->dev_offset, &state);
-  using LoadType = cuda::elementwise::PackType<T, pack_size>;
-  using LoadPack = cuda::elementwise::Pack<T, pack_size>;
-  using MaskType = cuda::elementwise::PackType<bool, pack_size>;
-  using MaskPack = cuda::elementwise::Pack<bool, pack_size>;
-
-  T t_scale = static_cast<T>(scale);
-  RandPack4 rand_uniform_pack4;
-  for (int64_t linear_index = global_thread_id * pack_size; linear_index < elem_cnt;
-       linear_index += gridDim.x * blockDim.x * pack_size) {
-    rand_uniform_pack4.storage = curand_uniform4(&state);
-
-    const LoadType* x_load = reinterpret_cast<const LoadType*>(x + linear_index);
-    LoadPack x_vec;
-    x_vec.storage = *x_load;
-
-    LoadPack addend_vec;
-    if (has_addend) {
-      const LoadType* addend_load = reinterpret_cast<const LoadType*>(addend + linear_index);
-      addend_vec.storage = *addend_load;
-    }
-
-    MaskPack mask_vec;
-    LoadPack y_vec;
-#pragma unroll
-    for (int i = 0; i < pack_size; i++) {
-      mask_vec.elem[i] = rand_uniform_pack4.elem[i] > rate;
-      T tmp_float_mask = static_cast<float>(mask_vec.elem[i]);
-      y_vec.elem[i] = x_vec.elem[i] * tmp_float_mask * t_scale;
-      if (has_addend) { y_vec.elem[i] += addend_vec.elem[i]; }
-    }
-
-    *(reinterpret_cast<LoadType*>(y + linear_index)) = y_vec.storage;
-    *(reinterpret_cast<MaskType*>(mask + linear_index)) = mask_vec.storage;
-  }
-
-  if (tail && global_thread_id < n_tail) {
-    const float rand_uniform = curand_uniform(&state);
-    const bool mask_val = rand_uniform > rate;
-    tail_mask[global_thread_id] = mask_val;
-    T tmp_float_mask = static_cast<float>(mask_val);
-    T tmp_tail_out = tail_x[global_thread_id] * tmp_float_mask * t_scale;
-    if (has_addend) { tmp_tail_out += tail_addend[global_thread_id]; }
-    tail_y[global_thread_id] = tmp_tail_out;
+// Element i went to the thread of its pack in a grid-stride loop over num_rand_threads threads,
+// which drew from the subsequence of its id and used rand_pack_size numbers per pack. The tail
+// elements took one more number of the first threads.
+template<int32_t rand_pack_size>
+__device__ __forceinline__ void RandPosition(const int64_t i, const int64_t pack_num,
+                                             const int64_t num_rand_threads,
+                                             int64_t* subsequence, uint64_t* position) {
+  const int64_t pack = i / rand_pack_size;
+  if (pack < pack_num) {
+    *subsequence = pack % num_rand_threads;
+    *position = pack / num_rand_threads * rand_pack_size + i % rand_pack_size;
+  } else {
+    const int64_t thread = i - pack_num * rand_pack_size;
+    const int64_t num_packs =
+        pack_num > thread ? (pack_num - thread + num_rand_threads - 1) / num_rand_threads : 0;
+    *subsequence = thread;
+    // The loop drew a curand_uniform4 per kVecSize numbers it used.
+    *position = (num_packs * rand_pack_size + kVecSize - 1) / kVecSize * kVecSize;
   }
+}
 
-  __syncthreads();
-
-  if (threadIdx.x == 0) {
-    int32_t new_counter = cuda::atomic::Add(&cuda_gen_state->dev_counter, 1) + 1;
-    if (new_counter == gridDim.x) {
-      cuda_gen_state->dev_counter = 0;           // reset counter to zero
-      cuda_gen_state->dev_offset += inc_offset;  // maintain the state of generator's dev_offset
+// Draws the numbers of the n elements from begin in the same order as the unpacked kernel did,
+// so a seed keeps giving the same mask. Neighbouring elements of a pack continue one state.
+template<int32_t rand_pack_size>
+__device__ __forceinline__ void DrawMaskByte(uint64_t seed, uint64_t offset, const int64_t begin,
+                                             const int64_t n, const int64_t pack_num,
+                                             const int64_t num_rand_threads, float* rand) {
+  cuda::philox::State state;
+  int64_t last_subsequence = -1;
+  uint64_t last_position = 0;
+  for (int32_t i = 0; i < n; ++i) {
+    int64_t subsequence = 0;
+    uint64_t position = 0;
+    RandPosition<rand_pack_size>(begin + i, pack_num, num_rand_threads, &subsequence, &position);
+    if (subsequence != last_subsequence || position != last_position + 1) {
+      state = cuda::philox::MakeState(seed, offset + position, subsequence);
     }
+    rand[i] = curand_uniform(&state);
+    last_subsequence = subsequence;
+    last_position = position;
   }
 }
 
-template<typename T, int pack_size, bool tail, bool has_addend>
-__global__ RETURN_VOID_IF_HALF FusedDropoutAddGpu(
-    uint64_t seed, one::CUDAGeneratorState* cuda_gen_state, uint64_t inc_offset,
-    const int64_t elem_cnt, float rate, float scale, int64_t n_tail, const T* x, bool* mask,
-    const T* addend, T* y, const T* tail_x, bool* tail_mask, const T* tail_addend, T* tail_y) {
-  int32_t global_thread_id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandStatePhilox4_32_10_t state;
-  curand_init(seed, global_thread_id, cuda_gen_state->dev_offset, &state);
+// One thread per byte of the mask. When aligned, the rows are a whole number of bytes and the 8
+// elements of a byte are loaded and stored as packs.
+template<typename T, bool aligned, bool has_addend>
+__global__ void FusedDropoutAddGpu(uint64_t seed, one::CUDAGeneratorState* cuda_gen_state,
+                                   uint64_t inc_offset, const int64_t elem_cnt,
+                                   const int64_t num_rand_threads, const int64_t num_bytes,
+                                   const int64_t row_size, const int64_t bytes_per_row, float rate,
+                                   float scale, const T* x, uint8_t* mask, const T* addend, T* y) {
+  using ComputeType = DropoutComputeType<T>;
+  constexpr int32_t pack_size = aligned ? GetDropoutPackSize<T>() : 1;
+  constexpr int32_t rand_pack_size = GetRandPackSize<T>();
   using LoadType = cuda::elementwise::PackType<T, pack_size>;
   using LoadPack = cuda::elementwise::Pack<T, pack_size>;
-  using StoreType = cuda::elementwise::PackType<Pack2Type<T>, pack_size / 2>;
-  using StorePack = cuda::elementwise::Pack<Pack2Type<T>, pack_size / 2>;
-  using MaskType = cuda::elementwise::PackType<bool, pack_size>;
-  using MaskPack = cuda::elementwise::Pack<bool, pack_size>;
-
-  RandPack4 rand_uniform_pack4;
-  Pack2Type<T> h2_scale = Make2<T>(scale);
-
-  for (int64_t linear_index = global_thread_id * pack_size; linear_index < elem_cnt;
-       linear_index += gridDim.x * blockDim.x * pack_size) {
-    rand_uniform_pack4.storage = curand_uniform4(&state);
-    const LoadType* x_load = reinterpret_cast<const LoadType*>(x + linear_index);
-    H2Pack<T> x_vec{};
-    x_vec.pack_storage.storage = *x_load;
-
-    H2Pack<T> addend_vec{};
-    if (has_addend) {
-      const LoadType* addend_load = reinterpret_cast<const LoadType*>(addend + linear_index);
-      addend_vec.pack_storage.storage = *addend_load;
-    }
-
-    MaskPack mask_vec;
-    StorePack y_vec;
-    StorePack one_or_zero_h2;
-
-    mask_vec.elem[0] = rand_uniform_pack4.elem[0] > rate;
-    float tmp_float_mask = static_cast<float>(mask_vec.elem[0]);
-    one_or_zero_h2.elem[0].x = tmp_float_mask;
-    mask_vec.elem[1] = rand_uniform_pack4.elem[1] > rate;
-    tmp_float_mask = static_cast<float>(mask_vec.elem[1]);
-    one_or_zero_h2.elem[0].y = tmp_float_mask;
-    y_vec.elem[0] = __hmul2(__hmul2(x_vec.h2[0], one_or_zero_h2.elem[0]), h2_scale);
-
-    mask_vec.elem[2] = rand_uniform_pack4.elem[2] > rate;
-    tmp_float_mask = static_cast<float>(mask_vec.elem[2]);
-    one_or_zero_h2.elem[1].x = tmp_float_mask;
-    mask_vec.elem[3] = rand_uniform_pack4.elem[3] > rate;
-    tmp_float_mask = static_cast<float>(mask_vec.elem[3]);
-    one_or_zero_h2.elem[1].y = tmp_float_mask;
-    y_vec.elem[1] = __hmul2(__hmul2(x_vec.h2[1], one_or_zero_h2.elem[1]), h2_scale);
-
-    if (has_addend) {
-      y_vec.elem[0] = __hadd2(y_vec.elem[0], addend_vec.h2[0]);
-      y_vec.elem[1] = __hadd2(y_vec.elem[1], addend_vec.h2[1]);
-    }
-
-    *(reinterpret_cast<StoreType*>(y + linear_index)) = y_vec.storage;
-    *(reinterpret_cast<MaskType*>(mask + linear_index)) = mask_vec.storage;
-  }
-
-  if (tail && global_thread_id < n_tail) {
-    const float rand_uniform = curand_uniform(&state);
-    const bool mask_val = rand_uniform > rate;
-    tail_mask[global_thread_id] = mask_val;
-    float tmp_half_mask = static_cast<float>(mask_val);
-    T tmp_tail_out = tail_x[global_thread_id] * static_cast<T>(tmp_half_mask) * h2_scale.x;
-    if (has_addend) { tmp_tail_out += tail_addend[global_thread_id]; }
-    tail_y[global_thread_id] = tmp_tail_out;
-  }
-
-  __syncthreads();
-  if (threadIdx.x == 0) {
-    int32_t new_counter = cuda::atomic::Add(&cuda_gen_state->dev_counter, 1) + 1;
-    if (new_counter == gridDim.x) {
-      cuda_gen_state->dev_counter = 0;           // reset counter to zero
-      cuda_gen_state->dev_offset += inc_offset;  // maintain the state of generator's dev_offset
+  const uint64_t offset = cuda::philox::Offset(cuda_gen_state);
+  const int64_t pack_num = elem_cnt / rand_pack_size;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, byte, num_bytes) {
+    const int64_t row = byte / bytes_per_row;
+    const int64_t col = (byte - row * bytes_per_row) * kDropoutMaskBits;
+    const int64_t begin = row * row_size + col;
+    const int64_t n = aligned ? kDropoutMaskBits : min(row_size - col, kDropoutMaskBits);
+    float rand[kDropoutMaskBits];
+    DrawMaskByte<rand_pack_size>(seed, offset, begin, n, pack_num, num_rand_threads, rand);
+    uint8_t bits = 0;
+#pragma unroll
+    for (int32_t p = 0; p < kDropoutMaskBits; p += pack_size) {
+      if (!aligned && p >= n) { break; }
+      LoadPack x_pack;
+      x_pack.storage = *reinterpret_cast<const LoadType*>(x + begin + p);
+      LoadPack addend_pack;
+      if (has_addend) {
+        addend_pack.storage = *reinterpret_cast<const LoadType*>(addend + begin + p);
+      }
+      LoadPack y_pack;
+#pragma unroll
+      for (int32_t i = 0; i < pack_size; ++i) {
+        const bool keep = rand[p + i] > rate;
+        bits |= static_cast<uint8_t>(keep) << (p + i);
+        ComputeType out = static_cast<ComputeType>(x_pack.elem[i])
+                          * static_cast<ComputeType>(keep) * static_cast<ComputeType>(scale);
+        if (has_addend) { out += static_cast<ComputeType>(addend_pack.elem[i]); }
+        y_pack.elem[i] = static_cast<T>(out);
+      }
+      *reinterpret_cast<LoadType*>(y + begin + p) = y_pack.storage;
     }
+    mask[byte] = bits;
   }
+  cuda::philox::AdvanceOffset(cuda_gen_state, inc_offset);
 }
 
-template<typename T, int pack_size, bool tail, bool has_addend>
-__global__ RETURN_VOID_IF_DOUBLE FusedDropoutAddGpu(
-    uint64_t seed, one::CUDAGeneratorState* cuda_gen_state, uint64_t inc_offset,
-    const int64_t elem_cnt, float rate, float scale, int64_t n_tail, const T* x, bool* mask,
-    const T* addend, T* y, const T* tail_x, bool* tail_mask, const T* tail_addend, T* tail_y) {
-  int32_t global_thread_id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandStatePhilox4_32_10_t state;
-  curand_init(seed, global_thread_id, cuda_gen_state->dev_offset, &state);
+template<typename T, bool aligned>
+__global__ void BitMaskAndScaleGpu(const int64_t num_bytes, const int64_t row_size,
+                                   const int64_t bytes_per_row, float scale, const T* dy,
+                                   const uint8_t* mask, T* dx) {
+  using ComputeType = DropoutComputeType<T>;
+  constexpr int32_t pack_size = aligned ? GetDropoutPackSize<T>() : 1;
   using LoadType = cuda::elementwise::PackType<T, pack_size>;
   using LoadPack = cuda::elementwise::Pack<T, pack_size>;
-  using MaskType = cuda::elementwise::PackType<bool, pack_size>;
-  using MaskPack = cuda::elementwise::Pack<bool, pack_size>;
-
-  RandPack4 rand_uniform_pack4;
-  bool grid_loop_rand_state = 0;
-
-  for (int64_t linear_index = global_thread_id * pack_size; linear_index < elem_cnt;
-       linear_index += gridDim.x * blockDim.x * pack_size) {
-    if (grid_loop_rand_state == 0) {
-      rand_uniform_pack4.storage = curand_uniform4(&state);
-      grid_loop_rand_state ^= 1;
-    } else {
-      // Use the last two random numbers we generated in previous iteration.
-      rand_uniform_pack4.elem[0] = rand_uniform_pack4.elem[2];
-      rand_uniform_pack4.elem[1] = rand_uniform_pack4.elem[3];
-      grid_loop_rand_state ^= 1;
-    }
-    const LoadType* x_load = reinterpret_cast<const LoadType*>(x + linear_index);
-    LoadPack x_vec;
-    x_vec.storage = *x_load;
-
-    LoadPack addend_vec;
-    if (has_addend) {
-      const LoadType* addend_load = reinterpret_cast<const LoadType*>(addend + linear_index);
-      addend_vec.storage = *addend_load;
-    }
-
-    MaskPack mask_vec;
-    LoadPack y_vec;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, byte, num_bytes) {
+    const uint8_t bits = mask[byte];
+    const int64_t row = byte / bytes_per_row;
+    const int64_t col = (byte - row * bytes_per_row) * kDropoutMaskBits;
+    const int64_t begin = row * row_size + col;
+    const int64_t n = aligned ? kDropoutMaskBits : min(row_size - col, kDropoutMaskBits);
 #pragma unroll
-    for (int i = 0; i < pack_size; i++) {
-      mask_vec.elem[i] = rand_uniform_pack4.elem[i] > rate;
-      y_vec.elem[i] = x_vec.elem[i] * mask_vec.elem[i] * scale;
-      if (has_addend) { y_vec.elem[i] += addend_vec.elem[i]; }
-    }
-    *(reinterpret_cast<LoadType*>(y + linear_index)) = y_vec.storage;
-    *(reinterpret_cast<MaskType*>(mask + linear_index)) = mask_vec.storage;
-  }
-
-  if (tail && global_thread_id < n_tail) {
-    const float rand_uniform = curand_uniform(&state);
-    const bool mask_val = rand_uniform > rate;
-    tail_mask[global_thread_id] = mask_val;
-    double tmp_tail_out = tail_x[global_thread_id] * mask_val * scale;
-    if (has_addend) { tmp_tail_out += tail_addend[global_thread_id]; }
-    tail_y[global_thread_id] = tmp_tail_out;
-  }
-
-  __syncthreads();
-  if (threadIdx.x == 0) {
-    int32_t new_counter = cuda::atomic::Add(&cuda_gen_state->dev_counter, 1) + 1;
-    if (new_counter == gridDim.x) {
-      cuda_gen_state->dev_counter = 0;           // reset counter to zero
-      cuda_gen_state->dev_offset += inc_offset;  // maintain the state of generator's dev_offset
+    for (int32_t p = 0; p < kDropoutMaskBits; p += pack_size) {
+      if (!aligned && p >= n) { break; }
+      LoadPack dy_pack;
+      dy_pack.storage = *reinterpret_cast<const LoadType*>(dy + begin + p);
+      LoadPack dx_pack;
+#pragma unroll
+      for (int32_t i = 0; i < pack_size; ++i) {
+        const ComputeType keep = static_cast<ComputeType>((bits >> (p + i)) & 1);
+        dx_pack.elem[i] = static_cast<T>(static_cast<ComputeType>(dy_pack.elem[i]) * keep
+                                         * static_cast<ComputeType>(scale));
+      }
+      *reinterpret_cast<LoadType*>(dx + begin + p) = dx_pack.storage;
     }
   }
 }
 
-template<int pack_size>
-unsigned int ComputeGridSize(ep::Stream* stream, const int32_t block_size, const int64_t elem_cnt) {
+unsigned int ComputeGridSize(ep::Stream* stream, const int32_t block_size, const int64_t n) {
   auto* cuda_stream = stream->As<ep::CudaStream>();
   const int32_t max_threads_multi_process =
       cuda_stream->device_properties().maxThreadsPerMultiProcessor;
   const int32_t multi_processor_count = cuda_stream->device_properties().multiProcessorCount;
   unsigned int blocks_per_sm = max_threads_multi_process / block_size;
-  unsigned int grid_size = ((elem_cnt + block_size - 1) / block_size);
+  unsigned int grid_size = ((n + block_size - 1) / block_size);
   grid_size = std::min((unsigned int)multi_processor_count * blocks_per_sm, grid_size);
   return grid_size;
 }
 
-template<typename T, bool has_addend>
-void DispatchTail(ep::Stream* stream, uint64_t seed, one::CUDAGeneratorState* cuda_gen_state,
-                  const int64_t elem_cnt, float rate, float scale, const T* x, bool* mask,
-                  const T* addend, T* y) {
-  unsigned int grid_size = ComputeGridSize<4>(stream, kBlockSize, elem_cnt);
-  constexpr int pack_size = GetDropoutPackSize<T>();
-  const int64_t pack_num = elem_cnt / pack_size;
-  const int64_t tail_offset = pack_num * pack_size;
-  const int64_t n_tail = elem_cnt - tail_offset;
-  const bool tail = n_tail > 0 ? true : false;
-  uint64_t inc_offset = 0;
+template<typename T>
+bool IsPackAligned(const int64_t row_size, const T* ptr) {
+  constexpr size_t pack_bytes = GetDropoutPackSize<T>() * sizeof(T);
+  return row_size % kDropoutMaskBits == 0
+         && (ptr == nullptr || reinterpret_cast<uintptr_t>(ptr) % pack_bytes == 0);
+}
 
-  if (tail) {
-    // If tail, we need generate randnum one more time, so here we add another `1`.
-    inc_offset = ((elem_cnt - 1) / (kBlockSize * grid_size * kVecSize) + 1) * kVecSize + 1;
-    FusedDropoutAddGpu<T, pack_size, true, has_addend>
-        <<<grid_size, kBlockSize, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-            seed, cuda_gen_state, inc_offset, elem_cnt, rate, scale, n_tail, x, mask, addend, y,
-            (x + tail_offset), (mask + tail_offset), (addend + tail_offset), (y + tail_offset));
+template<typename T, bool has_addend>
+void DispatchAligned(ep::Stream* stream, uint64_t seed, one::CUDAGeneratorState* cuda_gen_state,
+                     const int64_t elem_cnt, const int64_t row_size, float rate, float scale,
+                     const T* x, uint8_t* mask, const T* addend, T* y) {
+  const int64_t bytes_per_row = RoundUp(row_size, kDropoutMaskBits) / kDropoutMaskBits;
+  const int64_t num_bytes = elem_cnt / row_size * bytes_per_row;
+  const unsigned int grid_size = ComputeGridSize(stream, kBlockSize, num_bytes);
+  // The numbers follow the launch of the unpacked kernel, a thread per element up to a full
+  // device, and the offset advances as much as it did.
+  const int64_t num_rand_threads =
+      static_cast<int64_t>(ComputeGridSize(stream, kBlockSize, elem_cnt)) * kBlockSize;
+  uint64_t inc_offset = ((elem_cnt - 1) / (num_rand_threads * kVecSize) + 1) * kVecSize;
+  // If tail, the first threads drew one more number.
+  if (elem_cnt % GetRandPackSize<T>() != 0) { inc_offset += 1; }
+  cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+  if (IsPackAligned(row_size, x) && IsPackAligned(row_size, addend)
+      && IsPackAligned(row_size, y)) {
+    FusedDropoutAddGpu<T, true, has_addend><<<grid_size, kBlockSize, 0, cuda_stream>>>(
+        seed, cuda_gen_state, inc_offset, elem_cnt, num_rand_threads, num_bytes, row_size,
+        bytes_per_row, rate, scale, x, mask, addend, y);
   } else {
-    inc_offset = ((elem_cnt - 1) / (kBlockSize * grid_size * kVecSize) + 1) * kVecSize;
-    FusedDropoutAddGpu<T, pack_size, false, has_addend>
-        <<<grid_size, kBlockSize, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-            seed, cuda_gen_state, inc_offset, elem_cnt, rate, scale, n_tail, x, mask, addend, y,
-            nullptr, nullptr, nullptr, nullptr);
+    FusedDropoutAddGpu<T, false, has_addend><<<grid_size, kBlockSize, 0, cuda_stream>>>(
+        seed, cuda_gen_state, inc_offset, elem_cnt, num_rand_threads, num_bytes, row_size,
+        bytes_per_row, rate, scale, x, mask, addend, y);
   }
 }
 
@@ -430,17 +268,21 @@ class DropoutKernelGPU final : public user_op::OpKernel, public user_op::CudaGra
     if (rate < 1.0f) { scale = 1.0f / (1.0f - rate); }
     one::CUDAGeneratorState* cuda_gen_state = cuda_generator->cuda_gen_state();
 
+    const int64_t elem_cnt = in->shape().elem_cnt();
+    if (elem_cnt == 0) { return; }
+    const int64_t row_size = DropoutMaskRowSize(in->shape());
     if (ctx->has_input("_add_to_output", 0)) {
       const user_op::Tensor* addend = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
-      DispatchTail<T, true>(
-          ctx->stream(), seed, cuda_gen_state, in->shape().elem_cnt(), rate, scale,
-          reinterpret_cast<const T*>(in->dptr()), reinterpret_cast<bool*>(mask->mut_dptr()),
-          reinterpret_cast<const T*>(addend->dptr()), reinterpret_cast<T*>(out->mut_dptr()));
+      DispatchAligned<T, true>(ctx->stream(), seed, cuda_gen_state, elem_cnt, row_size, rate,
+                               scale, reinterpret_cast<const T*>(in->dptr()),
+                               mask->mut_dptr<uint8_t>(),
+                               reinterpret_cast<const T*>(addend->dptr()),
+                               reinterpret_cast<T*>(out->mut_dptr()));
     } else {
-      DispatchTail<T, false>(ctx->stream(), seed, cuda_gen_state, in->shape().elem_cnt(), rate,
-                             scale, reinterpret_cast<const T*>(in->dptr()),
-                             reinterpret_cast<bool*>(mask->mut_dptr()), nullptr,
-                             reinterpret_cast<T*>(out->mut_dptr()));
+      DispatchAligned<T, false>(ctx->stream(), seed, cuda_gen_state, elem_cnt, row_size, rate,
+                                scale, reinterpret_cast<const T*>(in->dptr()),
+                                mask->mut_dptr<uint8_t>(), nullptr,
+                                reinterpret_cast<T*>(out->mut_dptr()));
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -450,7 +292,7 @@ class DropoutKernelGPU final : public user_op::OpKernel, public user_op::CudaGra
   REGISTER_USER_KERNEL("dropout").SetCreateFn<DropoutKernelGPU<cpp_type>>().SetIsMatchedHob( \
       (user_op::HobDeviceType() == DeviceType::kCUDA)                                        \
       && (user_op::HobDataType("out", 0) == data_type)                                       \
-      && (user_op::HobDataType("mask", 0) == GetDataType<bool>::value))
+      && (user_op::HobDataType("mask", 0) == GetDataType<uint8_t>::value))
 
 REGISTER_DROPOUT_KERNEL_GPU(half, DataType::kFloat16);
 REGISTER_DROPOUT_KERNEL_GPU(float, DataType::kFloat);
@@ -473,10 +315,29 @@ class DropoutGradKernelGPU final : public user_op::OpKernel, public user_op::Cud
     user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
     const float scale = ctx->Attr<float>("scale");
     const int64_t elem_cnt = dy->shape().elem_cnt();
-    OF_CUDA_CHECK((cuda::elementwise::Binary(
-        MaskAndScaleFunctor<T>(scale), elem_cnt, reinterpret_cast<T*>(dx->mut_dptr()),
-        reinterpret_cast<const T*>(dy->dptr()), reinterpret_cast<const bool*>(mask->dptr()),
-        ctx->stream()->As<ep::CudaStream>()->cuda_stream())));
+    if (mask->data_type() == DataType::kBool) {
+      OF_CUDA_CHECK((cuda::elementwise::Binary(
+          MaskAndScaleFunctor<T>(scale), elem_cnt, reinterpret_cast<T*>(dx->mut_dptr()),
+          reinterpret_cast<const T*>(dy->dptr()), reinterpret_cast<const bool*>(mask->dptr()),
+          ctx->stream()->As<ep::CudaStream>()->cuda_stream())));
+      return;
+    }
+    // The packed mask of dropout, masks from random_mask_like keep a bool per element.
+    if (elem_cnt == 0) { return; }
+    const int64_t row_size = DropoutMaskRowSize(dy->shape());
+    const int64_t bytes_per_row = RoundUp(row_size, kDropoutMaskBits) / kDropoutMaskBits;
+    const int64_t num_bytes = elem_cnt / row_size * bytes_per_row;
+    const T* dy_ptr = reinterpret_cast<const T*>(dy->dptr());
+    T* dx_ptr = reinterpret_cast<T*>(dx->mut_dptr());
+    const unsigned int grid_size = ComputeGridSize(ctx->stream(), kBlockSize, num_bytes);
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    if (IsPackAligned(row_size, dy_ptr) && IsPackAligned(row_size, dx_ptr)) {
+      BitMaskAndScaleGpu<T, true><<<grid_size, kBlockSize, 0, cuda_stream>>>(
+          num_bytes, row_size, bytes_per_row, scale, dy_ptr, mask->dptr<uint8_t>(), dx_ptr);
+    } else {
+      BitMaskAndScaleGpu<T, false><<<grid_size, kBlockSize, 0, cuda_stream>>>(
+          num_bytes, row_size, bytes_per_row, scale, dy_ptr, mask->dptr<uint8_t>(), dx_ptr);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
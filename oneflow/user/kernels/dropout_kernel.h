@@ -21,6 +21,21 @@ limitations under the License.
 
 namespace oneflow {
 
+// The mask of dropout keeps a bit per element: the elements of each row of the last axis are
+// packed 8 to a byte, least significant bit first, and the last byte of a row is zero padded.
+constexpr int64_t kDropoutMaskBits = 8;
+
+inline int64_t DropoutMaskRowSize(const ShapeView& shape) {
+  return shape.NumAxes() == 0 ? 1 : shape.At(shape.NumAxes() - 1);
+}
+
+inline Shape DropoutMaskShape(const Shape& shape) {
+  if (shape.NumAxes() == 0) { return Shape({1}); }
+  DimVector dim_vec = shape.dim_vec();
+  dim_vec.back() = RoundUp(dim_vec.back(), kDropoutMaskBits) / kDropoutMaskBits;
+  return Shape(dim_vec);
+}
+
 class FusedDropoutKernelState : public user_op::OpKernelState {
  public:
   explicit FusedDropoutKernelState(const std::shared_ptr<one::Generator>& generator)
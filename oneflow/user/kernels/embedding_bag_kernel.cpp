@@ -0,0 +1,114 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/embedding_bag_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+EmbeddingBagMode ParseEmbeddingBagMode(const std::string& mode) {
+  if (mode == "sum") {
+    return EmbeddingBagMode::kSum;
+  } else if (mode == "mean") {
+    return EmbeddingBagMode::kMean;
+  } else if (mode == "max") {
+    return EmbeddingBagMode::kMax;
+  } else {
+    UNIMPLEMENTED();
+    return EmbeddingBagMode::kSum;
+  }
+}
+
+template<typename T, typename K>
+EmbeddingBagParams<T, K> MakeEmbeddingBagParams(user_op::KernelComputeContext* ctx) {
+  const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+  const user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+  EmbeddingBagParams<T, K> params{};
+  params.mode = ParseEmbeddingBagMode(ctx->Attr<std::string>("mode"));
+  params.batch_size = indices->shape().At(0);
+  params.bag_size = indices->shape().At(1);
+  params.embedding_dim = weight->shape().At(1);
+  params.padding_idx = ctx->Attr<int64_t>("padding_idx");
+  params.weight = weight->dptr<T>();
+  params.indices = indices->dptr<K>();
+  if (ctx->has_input("per_sample_weights", 0)) {
+    params.per_sample_weights = ctx->Tensor4ArgNameAndIndex("per_sample_weights", 0)->dptr<T>();
+  }
+  return params;
+}
+
+}  // namespace
+
+template<DeviceType device_type, typename T, typename K>
+class EmbeddingBagKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingBagKernel() = default;
+  ~EmbeddingBagKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    if (out->shape().elem_cnt() == 0) { return; }
+    EmbeddingBagParams<T, K> params = MakeEmbeddingBagParams<T, K>(ctx);
+    params.out = out->mut_dptr<T>();
+    EmbeddingBagKernelUtil<device_type, T, K>::Forward(ctx->stream(), params);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T, typename K>
+class EmbeddingBagGradKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingBagGradKernel() = default;
+  ~EmbeddingBagGradKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* values = ctx->Tensor4ArgNameAndIndex("values", 0);
+    if (values->shape().elem_cnt() == 0) { return; }
+    EmbeddingBagParams<T, K> params = MakeEmbeddingBagParams<T, K>(ctx);
+    params.out_grad = ctx->Tensor4ArgNameAndIndex("out_grad", 0)->dptr<T>();
+    params.values = values->mut_dptr<T>();
+    EmbeddingBagKernelUtil<device_type, T, K>::Backward(ctx->stream(), params);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_EMBEDDING_BAG_KERNELS(device, dtype_pair, itype_pair)                            \
+  REGISTER_USER_KERNEL("embedding_bag")                                                           \
+      .SetCreateFn<EmbeddingBagKernel<device, OF_PP_PAIR_FIRST(dtype_pair),                       \
+                                      OF_PP_PAIR_FIRST(itype_pair)>>()                            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                       \
+                       && (user_op::HobDataType("weight", 0) == OF_PP_PAIR_SECOND(dtype_pair))    \
+                       && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(itype_pair))); \
+  REGISTER_USER_KERNEL("embedding_bag_grad")                                                      \
+      .SetCreateFn<EmbeddingBagGradKernel<device, OF_PP_PAIR_FIRST(dtype_pair),                   \
+                                          OF_PP_PAIR_FIRST(itype_pair)>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                       \
+                       && (user_op::HobDataType("weight", 0) == OF_PP_PAIR_SECOND(dtype_pair))    \
+                       && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(itype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_EMBEDDING_BAG_KERNELS, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_EMBEDDING_BAG_KERNELS, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/embedding_bag_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+template<typename T, typename K>
+struct EmbeddingBagKernelUtil<DeviceType::kCPU, T, K> {
+  static void Forward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    const size_t grain = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.bag_size));
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, elem_cnt,
+        [&params](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) { EmbeddingBagForwardElem<T, K, T>(params, i); }
+        },
+        grain);
+  }
+
+  static void Backward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    const size_t grain = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.bag_size));
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, elem_cnt,
+        [&params](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) { EmbeddingBagBackwardElem<T, K, T>(params, i); }
+        },
+        grain);
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_EMBEDDING_BAG_KERNEL_UTIL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_CUDA
+#include "oneflow/user/kernels/embedding_bag_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T, typename K, typename ComputeType>
+__global__ void EmbeddingBagForwardGpu(const EmbeddingBagParams<T, K> params, int64_t elem_cnt) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    EmbeddingBagForwardElem<T, K, ComputeType>(params, i);
+  }
+}
+
+template<typename T, typename K, typename ComputeType>
+__global__ void EmbeddingBagBackwardGpu(const EmbeddingBagParams<T, K> params, int64_t elem_cnt) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    EmbeddingBagBackwardElem<T, K, ComputeType>(params, i);
+  }
+}
+
+template<typename T, typename K>
+EmbeddingBagParams<half, K> ToHalfParams(const EmbeddingBagParams<T, K>& params) {
+  EmbeddingBagParams<half, K> half_params;
+  half_params.mode = params.mode;
+  half_params.batch_size = params.batch_size;
+  half_params.bag_size = params.bag_size;
+  half_params.embedding_dim = params.embedding_dim;
+  half_params.padding_idx = params.padding_idx;
+  half_params.weight = reinterpret_cast<const half*>(params.weight);
+  half_params.indices = params.indices;
+  half_params.per_sample_weights = reinterpret_cast<const half*>(params.per_sample_weights);
+  half_params.out_grad = reinterpret_cast<const half*>(params.out_grad);
+  half_params.out = reinterpret_cast<half*>(params.out);
+  half_params.values = reinterpret_cast<half*>(params.values);
+  return half_params;
+}
+
+}  // namespace
+
+template<typename T, typename K>
+struct EmbeddingBagKernelUtil<DeviceType::kCUDA, T, K> {
+  static void Forward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    RUN_CUDA_KERNEL((EmbeddingBagForwardGpu<T, K, T>), stream, elem_cnt, params, elem_cnt);
+  }
+
+  static void Backward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    RUN_CUDA_KERNEL((EmbeddingBagBackwardGpu<T, K, T>), stream, elem_cnt, params, elem_cnt);
+  }
+};
+
+// float16 is reduced in float to keep long bags from losing precision.
+template<typename K>
+struct EmbeddingBagKernelUtil<DeviceType::kCUDA, float16, K> {
+  static void Forward(ep::Stream* stream, const EmbeddingBagParams<float16, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    RUN_CUDA_KERNEL((EmbeddingBagForwardGpu<half, K, float>), stream, elem_cnt,
+                    ToHalfParams(params), elem_cnt);
+  }
+
+  static void Backward(ep::Stream* stream, const EmbeddingBagParams<float16, K>& params) {
+    const int64_t elem_cnt = params.batch_size * params.embedding_dim;
+    RUN_CUDA_KERNEL((EmbeddingBagBackwardGpu<half, K, float>), stream, elem_cnt,
+                    ToHalfParams(params), elem_cnt);
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_EMBEDDING_BAG_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
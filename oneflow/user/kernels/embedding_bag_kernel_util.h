@@ -0,0 +1,134 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_EMBEDDING_BAG_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_EMBEDDING_BAG_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+enum class EmbeddingBagMode {
+  kSum = 0,
+  kMean = 1,
+  kMax = 2,
+};
+
+// weight is [num_embeddings, embedding_dim], indices and per_sample_weights are
+// [batch_size, bag_size], out and out_grad are [batch_size, embedding_dim] and values, the
+// gradient of every looked up row, is [batch_size, bag_size, embedding_dim]. Ids equal to
+// padding_idx are skipped and do not count towards the mean.
+template<typename T, typename K>
+struct EmbeddingBagParams {
+  EmbeddingBagMode mode;
+  int64_t batch_size;
+  int64_t bag_size;
+  int64_t embedding_dim;
+  int64_t padding_idx;
+  const T* weight;
+  const K* indices;
+  const T* per_sample_weights;
+  const T* out_grad;
+  T* out;
+  T* values;
+};
+
+template<DeviceType device_type, typename T, typename K>
+struct EmbeddingBagKernelUtil {
+  static void Forward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params);
+  static void Backward(ep::Stream* stream, const EmbeddingBagParams<T, K>& params);
+};
+
+// Both kernels work on one output element (bag b, column d) at a time so that the bag is reduced
+// in registers and neighbouring threads read neighbouring columns of the same weight row.
+template<typename T, typename K, typename ComputeType>
+OF_DEVICE_FUNC void EmbeddingBagForwardElem(const EmbeddingBagParams<T, K>& params,
+                                            int64_t offset) {
+  const int64_t b = offset / params.embedding_dim;
+  const int64_t d = offset - b * params.embedding_dim;
+  const K* bag_indices = params.indices + b * params.bag_size;
+  ComputeType acc = 0;
+  int64_t count = 0;
+  for (int64_t j = 0; j < params.bag_size; ++j) {
+    const int64_t id = static_cast<int64_t>(bag_indices[j]);
+    if (id == params.padding_idx) { continue; }
+    ComputeType val = static_cast<ComputeType>(params.weight[id * params.embedding_dim + d]);
+    if (params.mode == EmbeddingBagMode::kMax) {
+      if (count == 0 || val > acc) { acc = val; }
+    } else {
+      if (params.per_sample_weights != nullptr) {
+        val *= static_cast<ComputeType>(params.per_sample_weights[b * params.bag_size + j]);
+      }
+      acc += val;
+    }
+    count += 1;
+  }
+  if (params.mode == EmbeddingBagMode::kMean && count > 0) {
+    acc /= static_cast<ComputeType>(count);
+  }
+  params.out[offset] = static_cast<T>(acc);
+}
+
+template<typename T, typename K, typename ComputeType>
+OF_DEVICE_FUNC void EmbeddingBagBackwardElem(const EmbeddingBagParams<T, K>& params,
+                                             int64_t offset) {
+  const int64_t b = offset / params.embedding_dim;
+  const int64_t d = offset - b * params.embedding_dim;
+  const K* bag_indices = params.indices + b * params.bag_size;
+  int64_t count = 0;
+  int64_t max_j = -1;
+  ComputeType max_val = 0;
+  for (int64_t j = 0; j < params.bag_size; ++j) {
+    const int64_t id = static_cast<int64_t>(bag_indices[j]);
+    if (id == params.padding_idx) { continue; }
+    if (params.mode == EmbeddingBagMode::kMax) {
+      const ComputeType val =
+          static_cast<ComputeType>(params.weight[id * params.embedding_dim + d]);
+      if (max_j < 0 || val > max_val) {
+        max_val = val;
+        max_j = j;
+      }
+    }
+    count += 1;
+  }
+  ComputeType dy = static_cast<ComputeType>(params.out_grad[offset]);
+  if (params.mode == EmbeddingBagMode::kMean && count > 0) {
+    dy /= static_cast<ComputeType>(count);
+  }
+  T* bag_values = params.values + b * params.bag_size * params.embedding_dim + d;
+  for (int64_t j = 0; j < params.bag_size; ++j) {
+    ComputeType grad = 0;
+    if (static_cast<int64_t>(bag_indices[j]) != params.padding_idx) {
+      if (params.mode == EmbeddingBagMode::kMax) {
+        if (j == max_j) { grad = dy; }
+      } else if (params.per_sample_weights != nullptr) {
+        grad = dy * static_cast<ComputeType>(params.per_sample_weights[b * params.bag_size + j]);
+      } else {
+        grad = dy;
+      }
+    }
+    bag_values[j * params.embedding_dim] = static_cast<T>(grad);
+  }
+}
+
+#define INSTANTIATE_EMBEDDING_BAG_KERNEL_UTIL(device_type_v, dtype_pair, itype_pair)  \
+  template struct EmbeddingBagKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair), \
+                                         OF_PP_PAIR_FIRST(itype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_EMBEDDING_BAG_KERNEL_UTIL_H_
@@ -0,0 +1,248 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/ep/cuda/primitive/cublas_lt_matmul.h"
+#include <cub/cub.cuh>
+#if CUDA_VERSION >= 11000
+#include <cuda_bf16.h>
+#endif  // CUDA_VERSION >= 11000
+#if CUDA_VERSION >= 11080
+#include <cuda_fp8.h>
+#endif  // CUDA_VERSION >= 11080
+
+namespace oneflow {
+
+namespace {
+
+#if CUDA_VERSION >= 11080
+
+// The largest finite value of E4M3.
+constexpr float kFp8E4M3Max = 448.f;
+// cuBLASLt runs fp8 GEMMs from sm_89 on.
+constexpr int kMinFp8CudaArch = 890;
+
+// Indices into the float workspace of the kernel.
+enum Fp8ScaleIndex {
+  kAScale = 0,
+  kBScale,
+  kAScaleInv,
+  kBScaleInv,
+  kAAmax,
+  kBAmax,
+  kNumFp8Scales,
+};
+
+// Delayed scaling: the scales of a step come from the amax history of the previous steps, so
+// quantizing needs no extra pass over the inputs. An empty history, as in the first step,
+// scales by 1.
+__global__ void ComputeFp8Scales(const float* a_amax_history, const float* b_amax_history,
+                                 const int64_t history_len, float* scales) {
+  const float* histories[2] = {a_amax_history, b_amax_history};
+  for (int i = 0; i < 2; ++i) {
+    float history_amax = 0.f;
+    for (int64_t j = 0; j < history_len; ++j) {
+      history_amax = fmaxf(history_amax, histories[i][j]);
+    }
+    const float scale =
+        (history_amax > 0.f && isfinite(history_amax)) ? kFp8E4M3Max / history_amax : 1.f;
+    scales[kAScale + i] = scale;
+    scales[kAScaleInv + i] = 1.f / scale;
+    scales[kAAmax + i] = 0.f;
+  }
+}
+
+// The bits of non-negative floats are ordered the same as the floats.
+__device__ __forceinline__ void AtomicMaxNonNegative(float* address, float value) {
+  atomicMax(reinterpret_cast<int*>(address), __float_as_int(value));
+}
+
+// Quantizes the rows x cols x into y, transposed to cols x rows if asked to, and takes the amax
+// of x along the way.
+template<typename T>
+__global__ void QuantizeToFp8(const T* x, const int64_t rows, const int64_t cols,
+                              const bool transpose, const float* scale, __nv_fp8_e4m3* y,
+                              float* amax) {
+  typedef cub::BlockReduce<float, kCudaThreadsNumPerBlock> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage cub_reduce_tmp_storage;
+  const float x_scale = *scale;
+  float thread_amax = 0.f;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, rows * cols) {
+    const float value = static_cast<float>(x[i]);
+    thread_amax = fmaxf(thread_amax, fabsf(value));
+    const int64_t offset = transpose ? (i % cols) * rows + i / cols : i;
+    // The conversion saturates to the largest finite value.
+    y[offset] = __nv_fp8_e4m3(value * x_scale);
+  }
+  const float block_amax = BlockReduce(cub_reduce_tmp_storage).Reduce(thread_amax, cub::Max());
+  if (threadIdx.x == 0) { AtomicMaxNonNegative(amax, block_amax); }
+}
+
+// Shifts the amax of this step into the front of the histories.
+__global__ void UpdateAmaxHistories(const float* scales, const int64_t history_len,
+                                    float* a_amax_history, float* b_amax_history) {
+  float* histories[2] = {a_amax_history, b_amax_history};
+  for (int i = 0; i < 2; ++i) {
+    for (int64_t j = history_len - 1; j > 0; --j) { histories[i][j] = histories[i][j - 1]; }
+    histories[i][0] = scales[kAAmax + i];
+  }
+}
+
+struct Fp8MatmulTmpBuffer {
+  Fp8MatmulTmpBuffer(int64_t m, int64_t n, int64_t k)
+      : quantized_a_bytes(GetCudaAlignedSize(m * k * sizeof(__nv_fp8_e4m3))),
+        quantized_b_bytes(GetCudaAlignedSize(n * k * sizeof(__nv_fp8_e4m3))),
+        scales_bytes(GetCudaAlignedSize(kNumFp8Scales * sizeof(float))) {}
+  size_t TotalBytes() const { return quantized_a_bytes + quantized_b_bytes + scales_bytes; }
+
+  size_t quantized_a_bytes;
+  size_t quantized_b_bytes;
+  size_t scales_bytes;
+};
+
+template<typename T>
+bool LaunchFp8Matmul(ep::CudaStream* cuda_stream, const T* a, const T* b, const int64_t m,
+                     const int64_t n, const int64_t k, const bool transpose_b, const double alpha,
+                     const DataType data_type, float* a_amax_history, float* b_amax_history,
+                     const int64_t history_len, void* tmp_buffer, T* out) {
+  const Fp8MatmulTmpBuffer buffer(m, n, k);
+  auto* quantized_a = reinterpret_cast<__nv_fp8_e4m3*>(tmp_buffer);
+  auto* quantized_b = quantized_a + buffer.quantized_a_bytes;
+  float* scales = reinterpret_cast<float*>(quantized_b + buffer.quantized_b_bytes);
+  ComputeFp8Scales<<<1, 1, 0, cuda_stream->cuda_stream()>>>(a_amax_history, b_amax_history,
+                                                            history_len, scales);
+  QuantizeToFp8<T><<<BlocksNum4ThreadsNum(m * k), kCudaThreadsNumPerBlock, 0,
+                     cuda_stream->cuda_stream()>>>(a, m, k, false, scales + kAScale, quantized_a,
+                                                   scales + kAAmax);
+  // b is quantized into n x k.
+  QuantizeToFp8<T><<<BlocksNum4ThreadsNum(n * k), kCudaThreadsNumPerBlock, 0,
+                     cuda_stream->cuda_stream()>>>(b, transpose_b ? n : k, transpose_b ? k : n,
+                                                   !transpose_b, scales + kBScale, quantized_b,
+                                                   scales + kBAmax);
+  UpdateAmaxHistories<<<1, 1, 0, cuda_stream->cuda_stream()>>>(scales, history_len,
+                                                               a_amax_history, b_amax_history);
+  // The row-major out = a * b is the column-major out^T = b^T * a^T, with b stored as n x k that
+  // is the TN layout fp8 GEMMs require.
+  ep::primitive::CublasLtMatmulProblem problem{};
+  problem.m = n;
+  problem.n = m;
+  problem.k = k;
+  problem.lda = k;
+  problem.ldb = k;
+  problem.ldc = n;
+  problem.batch_count = 1;
+  problem.data_type = DataType::kFloat8E4M3;
+  problem.trans_a = CUBLAS_OP_T;
+  problem.trans_b = CUBLAS_OP_N;
+  problem.epilogue = CUBLASLT_EPILOGUE_DEFAULT;
+  problem.c_data_type = data_type;
+  const ep::primitive::CublasLtMatmulScales lt_scales{scales + kBScaleInv, scales + kAScaleInv};
+  return ep::primitive::LaunchCublasLtMatmul(cuda_stream, problem, Scalar(alpha), quantized_b,
+                                             quantized_a, Scalar(0), out, nullptr, &lt_scales);
+}
+
+#endif  // CUDA_VERSION >= 11080
+
+size_t InferFp8MatmulTmpSize(user_op::InferContext* ctx) {
+#if CUDA_VERSION >= 11080
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& out_shape = ctx->OutputShape("out", 0);
+  return Fp8MatmulTmpBuffer(a_shape.At(0), out_shape.At(1), a_shape.At(1)).TotalBytes();
+#else
+  return 0;
+#endif  // CUDA_VERSION >= 11080
+}
+
+}  // namespace
+
+class GpuFp8MatmulKernel final : public user_op::OpKernel {
+ public:
+  GpuFp8MatmulKernel() = default;
+  ~GpuFp8MatmulKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    user_op::Tensor* a_amax_history = ctx->Tensor4ArgNameAndIndex("a_amax_history", 0);
+    user_op::Tensor* b_amax_history = ctx->Tensor4ArgNameAndIndex("b_amax_history", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const bool transpose_b = ctx->Attr<bool>("transpose_b");
+    const double alpha = ctx->Attr<double>("alpha");
+    const DataType data_type = out->data_type();
+    const int64_t m = out->shape().At(0);
+    const int64_t n = out->shape().At(1);
+    const int64_t k = a->shape().At(1);
+    if (m * n == 0) { return; }
+    if (!TryLaunchFp8Matmul(ctx->stream()->As<ep::CudaStream>(), a, b, m, n, k, transpose_b,
+                            alpha, a_amax_history, b_amax_history, tmp_buffer, out)) {
+      // Same as matmul when fp8 GEMMs are unavailable.
+      auto matmul = ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+          DeviceType::kCUDA, data_type, ep::primitive::BlasTransposeType::N,
+          transpose_b ? ep::primitive::BlasTransposeType::T : ep::primitive::BlasTransposeType::N);
+      CHECK(matmul);
+      matmul->Launch(ctx->stream(), m, n, k, alpha, a->dptr(), b->dptr(), 0.0, out->mut_dptr());
+    }
+  }
+
+  bool TryLaunchFp8Matmul(ep::CudaStream* cuda_stream, const user_op::Tensor* a,
+                          const user_op::Tensor* b, const int64_t m, const int64_t n,
+                          const int64_t k, const bool transpose_b, const double alpha,
+                          user_op::Tensor* a_amax_history, user_op::Tensor* b_amax_history,
+                          user_op::Tensor* tmp_buffer, user_op::Tensor* out) const {
+#if CUDA_VERSION >= 11080
+    if (!ep::primitive::IsCublasLtMatmulEnabled() || cuda_stream->cuda_arch() < kMinFp8CudaArch
+        || k == 0) {
+      return false;
+    }
+    const int64_t history_len = a_amax_history->shape().elem_cnt();
+    float* a_history = a_amax_history->mut_dptr<float>();
+    float* b_history = b_amax_history->mut_dptr<float>();
+    void* buffer = tmp_buffer->mut_dptr();
+    switch (out->data_type()) {
+#define FP8_MATMUL_CASE(data_type, T)                                                           \
+  case data_type:                                                                              \
+    return LaunchFp8Matmul(cuda_stream, reinterpret_cast<const T*>(a->dptr()),                 \
+                           reinterpret_cast<const T*>(b->dptr()), m, n, k, transpose_b, alpha, \
+                           data_type, a_history, b_history, history_len, buffer,               \
+                           reinterpret_cast<T*>(out->mut_dptr()));
+      FP8_MATMUL_CASE(DataType::kFloat, float)
+      FP8_MATMUL_CASE(DataType::kFloat16, half)
+      FP8_MATMUL_CASE(DataType::kBFloat16, nv_bfloat16)
+#undef FP8_MATMUL_CASE
+      default: return false;
+    }
+#else
+    return false;
+#endif  // CUDA_VERSION >= 11080
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("fp8_matmul")
+    .SetCreateFn<GpuFp8MatmulKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)
+                     && ((user_op::HobDataType("a", 0) == DataType::kFloat)
+                         || (user_op::HobDataType("a", 0) == DataType::kFloat16)
+                         || (user_op::HobDataType("a", 0) == DataType::kBFloat16)))
+    .SetInferTmpSizeFn(InferFp8MatmulTmpSize);
+
+}  // namespace oneflow
@@ -0,0 +1,629 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/cuda/philox.cuh"
+#include "oneflow/core/cuda/softmax.cuh"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/device/cuda_pseudo_bfloat16.h"
+#include "oneflow/core/kernel/cuda_graph_support.h"
+#include "oneflow/user/kernels/dropout_kernel.h"
+
+namespace oneflow {
+
+namespace {
+
+// The attention is computed tile by tile like flash attention, the [query_seq_len, kv_seq_len]
+// scores of a head never leave the chip. The forward runs the softmax online over the key tiles
+// and keeps only its log-sum-exp per query, the backward recomputes the probabilities from it.
+constexpr int kWarpSize = 32;
+constexpr int kNumWarps = 4;
+constexpr int kBlockSize = kNumWarps * kWarpSize;
+// Each lane of a warp scores one key of a tile.
+constexpr int kKeyTileSize = kWarpSize;
+// Query rows of a forward block, each warp keeps the running softmax of its rows in registers.
+constexpr int kRowsPerWarp = 4;
+constexpr int kQueryTileSize = kNumWarps * kRowsPerWarp;
+constexpr int kMaxHeadSize = 128;
+// Dims of a head accumulated by each lane.
+constexpr int kMaxDimsPerLane = kMaxHeadSize / kWarpSize;
+// The dropout of an attention probability takes one philox draw, the generator offset moves by a
+// whole draw of four numbers per launch.
+constexpr uint64_t kPhiloxOffsetIncrement = 4;
+// Packed sequences are the z axis of the grid.
+constexpr int64_t kMaxNumSeqs = 65535;
+
+template<typename T>
+__device__ __forceinline__ float ToFloat(T x) {
+  return static_cast<float>(x);
+}
+
+template<typename T>
+__device__ __forceinline__ T FromFloat(float x) {
+  return static_cast<T>(x);
+}
+
+template<>
+__device__ __forceinline__ float ToFloat<half>(half x) {
+  return __half2float(x);
+}
+
+template<>
+__device__ __forceinline__ half FromFloat<half>(float x) {
+  return __float2half(x);
+}
+
+#if CUDA_VERSION >= 11000
+template<>
+__device__ __forceinline__ float ToFloat<nv_bfloat16>(nv_bfloat16 x) {
+  return __bfloat162float(x);
+}
+
+template<>
+__device__ __forceinline__ nv_bfloat16 FromFloat<nv_bfloat16>(float x) {
+  return __float2bfloat16(x);
+}
+#endif  // CUDA_VERSION >= 11000
+
+// Rows of the key and value tiles in shared memory are padded to an odd number of words, so the
+// lanes reading a row each hit different banks.
+template<typename T>
+constexpr int64_t TileRowStride(int64_t head_size) {
+  return head_size + 4 / sizeof(T);
+}
+
+template<typename T>
+struct AttentionParams {
+  const T* query;
+  const T* key;
+  const T* value;
+  // [batch, kv_seq_len], the keys that are false are padding, nullptr if all keys are attended.
+  const bool* key_mask;
+  // [num_seqs + 1] boundaries of packed sequences along the seq axis, nullptr if not packed.
+  const int32_t* cu_seqlens_q;
+  const int32_t* cu_seqlens_k;
+  int64_t num_heads;
+  // Lengths of the seq axes, of all the packed sequences together.
+  int64_t query_seq_len;
+  int64_t kv_seq_len;
+  // The grid covers num_seqs sequences of up to these lengths.
+  int64_t num_seqs;
+  int64_t max_query_seq_len;
+  int64_t max_kv_seq_len;
+  int64_t head_size;
+  float scale;
+  bool causal;
+  float dropout_rate;
+};
+
+// The rows of the query and of the key that one sequence takes, the whole seq axes unless the
+// sequences are packed. Query and key indices of the kernels are relative to these ranges.
+struct SeqRange {
+  int64_t query_offset;
+  int64_t query_len;
+  int64_t kv_offset;
+  int64_t kv_len;
+};
+
+template<typename T>
+__device__ __forceinline__ SeqRange GetSeqRange(const AttentionParams<T>& params, int64_t seq) {
+  if (params.cu_seqlens_q == nullptr) { return {0, params.query_seq_len, 0, params.kv_seq_len}; }
+  const int64_t query_offset = params.cu_seqlens_q[seq];
+  const int64_t kv_offset = params.cu_seqlens_k[seq];
+  return {query_offset, params.cu_seqlens_q[seq + 1] - query_offset, kv_offset,
+          params.cu_seqlens_k[seq + 1] - kv_offset};
+}
+
+// Causal attention is aligned to the last keys, query i attends the keys up to
+// i + kv_len - query_len.
+template<typename T>
+__device__ __forceinline__ bool IsKeyAttended(const AttentionParams<T>& params,
+                                              const SeqRange& range, int64_t batch,
+                                              int64_t query_idx, int64_t key_idx) {
+  if (key_idx >= range.kv_len) { return false; }
+  if (params.causal && key_idx > query_idx + range.kv_len - range.query_len) { return false; }
+  return params.key_mask == nullptr || params.key_mask[batch * params.kv_seq_len + key_idx];
+}
+
+// The dropout scale of the probability at `element` of the [batch, num_heads, query_seq_len,
+// kv_seq_len] scores, drawn from its own philox subsequence so the backward draws it again.
+__device__ __forceinline__ float DropoutScale(uint64_t seed, uint64_t offset, int64_t element,
+                                              float rate) {
+  if (rate == 0.0f) { return 1.0f; }
+  cuda::philox::State state = cuda::philox::MakeState(seed, offset, element);
+  return curand_uniform(&state) > rate ? 1.0f / (1.0f - rate) : 0.0f;
+}
+
+template<typename T>
+__device__ void LoadKeyValueTile(const AttentionParams<T>& params, const T* key, const T* value,
+                                 int64_t kv_len, int64_t kv_begin, T* key_tile, T* value_tile) {
+  const int64_t head_size = params.head_size;
+  const int64_t row_stride = TileRowStride<T>(head_size);
+  for (int64_t i = threadIdx.x; i < kKeyTileSize * head_size; i += blockDim.x) {
+    const int64_t row = i / head_size;
+    const int64_t col = i - row * head_size;
+    const int64_t key_idx = kv_begin + row;
+    T key_val = FromFloat<T>(0.0f);
+    T value_val = FromFloat<T>(0.0f);
+    if (key_idx < kv_len) {
+      key_val = key[key_idx * head_size + col];
+      value_val = value[key_idx * head_size + col];
+    }
+    key_tile[row * row_stride + col] = key_val;
+    value_tile[row * row_stride + col] = value_val;
+  }
+}
+
+// grid: (query tiles, batch * num_heads, sequences).
+template<typename T>
+__global__ void FusedAttentionForwardGpu(AttentionParams<T> params, T* out, float* softmax_lse,
+                                         uint64_t seed, one::CUDAGeneratorState* gen_state,
+                                         int64_t* rng_state) {
+  extern __shared__ __align__(sizeof(double)) unsigned char shared_buf[];
+  const int64_t head_size = params.head_size;
+  const int64_t row_stride = TileRowStride<T>(head_size);
+  T* key_tile = reinterpret_cast<T*>(shared_buf);
+  T* value_tile = key_tile + kKeyTileSize * row_stride;
+  float* query_tile = reinterpret_cast<float*>(value_tile + kKeyTileSize * row_stride);
+
+  const int64_t batch_head = blockIdx.y;
+  const int64_t batch = batch_head / params.num_heads;
+  const SeqRange range = GetSeqRange(params, blockIdx.z);
+  const int64_t query_seq_len = range.query_len;
+  const int64_t kv_seq_len = range.kv_len;
+  const int64_t query_begin = blockIdx.x * kQueryTileSize;
+  // First rows of the sequence in the query, in out and softmax_lse and in the key and value.
+  const int64_t query_row_begin = batch_head * params.query_seq_len + range.query_offset;
+  const int64_t kv_row_begin = batch_head * params.kv_seq_len + range.kv_offset;
+  const T* query = params.query + query_row_begin * head_size;
+  const T* key = params.key + kv_row_begin * head_size;
+  const T* value = params.value + kv_row_begin * head_size;
+  for (int64_t i = threadIdx.x; i < kQueryTileSize * head_size; i += blockDim.x) {
+    const int64_t query_idx = query_begin + i / head_size;
+    query_tile[i] =
+        query_idx < query_seq_len ? ToFloat(query[query_begin * head_size + i]) : 0.0f;
+  }
+  const uint64_t offset = cuda::philox::Offset(gen_state);
+  if (blockIdx.x == 0 && blockIdx.y == 0 && blockIdx.z == 0 && threadIdx.x == 0) {
+    rng_state[0] = static_cast<int64_t>(seed);
+    rng_state[1] = static_cast<int64_t>(offset);
+  }
+
+  const int warp_id = threadIdx.x / kWarpSize;
+  const int lane_id = threadIdx.x % kWarpSize;
+  float row_max[kRowsPerWarp];
+  float row_sum[kRowsPerWarp];
+  float acc[kRowsPerWarp][kMaxDimsPerLane];
+#pragma unroll
+  for (int r = 0; r < kRowsPerWarp; ++r) {
+    row_max[r] = -INFINITY;
+    row_sum[r] = 0.0f;
+#pragma unroll
+    for (int t = 0; t < kMaxDimsPerLane; ++t) { acc[r][t] = 0.0f; }
+  }
+  // The keys past those the last row of the tile attends are not loaded, and none if the tile is
+  // past the end of a shorter packed sequence.
+  int64_t kv_end = query_begin < query_seq_len ? kv_seq_len : 0;
+  if (params.causal && kv_end > 0) {
+    const int64_t causal_end = query_begin + kQueryTileSize + kv_seq_len - query_seq_len;
+    kv_end = causal_end < 0 ? 0 : (causal_end < kv_end ? causal_end : kv_end);
+  }
+  for (int64_t kv_begin = 0; kv_begin < kv_end; kv_begin += kKeyTileSize) {
+    __syncthreads();
+    LoadKeyValueTile(params, key, value, kv_seq_len, kv_begin, key_tile, value_tile);
+    __syncthreads();
+    const int64_t key_idx = kv_begin + lane_id;
+    const T* key_row = key_tile + lane_id * row_stride;
+#pragma unroll
+    for (int r = 0; r < kRowsPerWarp; ++r) {
+      const int row = warp_id * kRowsPerWarp + r;
+      const int64_t query_idx = query_begin + row;
+      if (query_idx >= query_seq_len) { break; }
+      const bool attended = IsKeyAttended(params, range, batch, query_idx, key_idx);
+      float score = -INFINITY;
+      if (attended) {
+        const float* query_row = query_tile + row * head_size;
+        float dot = 0.0f;
+        for (int64_t d = 0; d < head_size; ++d) { dot += query_row[d] * ToFloat(key_row[d]); }
+        score = dot * params.scale;
+      }
+      const float tile_max =
+          cuda::softmax::WarpAllReduce<cuda::softmax::MaxOp, float, kWarpSize>(score);
+      const float new_max = max(row_max[r], tile_max);
+      // No key attended by the row so far.
+      if (new_max == -INFINITY) { continue; }
+      const float correction = __expf(row_max[r] - new_max);
+      float prob = attended ? __expf(score - new_max) : 0.0f;
+      row_sum[r] = row_sum[r] * correction
+                   + cuda::softmax::WarpAllReduce<cuda::softmax::SumOp, float, kWarpSize>(prob);
+      row_max[r] = new_max;
+      // Dropout applies to the normalized probabilities, so only to the output accumulation.
+      if (attended) {
+        prob *= DropoutScale(
+            seed, offset,
+            (query_row_begin + query_idx) * params.kv_seq_len + range.kv_offset + key_idx,
+            params.dropout_rate);
+      }
+#pragma unroll
+      for (int t = 0; t < kMaxDimsPerLane; ++t) { acc[r][t] *= correction; }
+      for (int j = 0; j < kKeyTileSize; ++j) {
+        const float p = __shfl_sync(0xffffffff, prob, j);
+        const T* value_row = value_tile + j * row_stride;
+#pragma unroll
+        for (int t = 0; t < kMaxDimsPerLane; ++t) {
+          const int64_t d = lane_id + t * kWarpSize;
+          if (d < head_size) { acc[r][t] += p * ToFloat(value_row[d]); }
+        }
+      }
+    }
+  }
+#pragma unroll
+  for (int r = 0; r < kRowsPerWarp; ++r) {
+    const int64_t query_idx = query_begin + warp_id * kRowsPerWarp + r;
+    if (query_idx >= query_seq_len) { break; }
+    const int64_t row = query_row_begin + query_idx;
+    // Rows attending no key are zeros, their lse makes every probability zero in the backward.
+    const float inv_sum = row_sum[r] > 0.0f ? 1.0f / row_sum[r] : 0.0f;
+#pragma unroll
+    for (int t = 0; t < kMaxDimsPerLane; ++t) {
+      const int64_t d = lane_id + t * kWarpSize;
+      if (d < head_size) { out[row * head_size + d] = FromFloat<T>(acc[r][t] * inv_sum); }
+    }
+    if (lane_id == 0) {
+      softmax_lse[row] = row_sum[r] > 0.0f ? row_max[r] + __logf(row_sum[r]) : INFINITY;
+    }
+  }
+  cuda::philox::AdvanceOffset(gen_state, kPhiloxOffsetIncrement);
+}
+
+// delta[row] = dot(out[row], out_grad[row]), the row sum of probs * probs_grad.
+template<typename T>
+__global__ void FusedAttentionGradDeltaGpu(int64_t num_rows, int64_t head_size, const T* out,
+                                           const T* out_grad, float* delta) {
+  const int64_t num_warps = gridDim.x * blockDim.x / kWarpSize;
+  const int lane_id = threadIdx.x % kWarpSize;
+  for (int64_t row = (blockIdx.x * blockDim.x + threadIdx.x) / kWarpSize; row < num_rows;
+       row += num_warps) {
+    float sum = 0.0f;
+    for (int64_t d = lane_id; d < head_size; d += kWarpSize) {
+      sum += ToFloat(out[row * head_size + d]) * ToFloat(out_grad[row * head_size + d]);
+    }
+    sum = cuda::softmax::WarpAllReduce<cuda::softmax::SumOp, float, kWarpSize>(sum);
+    if (lane_id == 0) { delta[row] = sum; }
+  }
+}
+
+// grid: (key tiles, batch * num_heads, sequences). The block owns the key and value grads of its
+// tile, the query grads of all its query rows are added to query_grad_acc.
+template<typename T>
+__global__ void FusedAttentionBackwardGpu(AttentionParams<T> params, const T* out_grad,
+                                          const float* softmax_lse, const float* delta,
+                                          const int64_t* rng_state, float* query_grad_acc,
+                                          T* key_grad, T* value_grad) {
+  extern __shared__ __align__(sizeof(double)) unsigned char shared_buf[];
+  const int64_t head_size = params.head_size;
+  const int64_t row_stride = TileRowStride<T>(head_size);
+  const int64_t grad_row_stride = head_size + 1;
+  const int warp_id = threadIdx.x / kWarpSize;
+  const int lane_id = threadIdx.x % kWarpSize;
+  T* key_tile = reinterpret_cast<T*>(shared_buf);
+  T* value_tile = key_tile + kKeyTileSize * row_stride;
+  float* key_grad_tile = reinterpret_cast<float*>(value_tile + kKeyTileSize * row_stride);
+  float* value_grad_tile = key_grad_tile + kKeyTileSize * grad_row_stride;
+  float* query_row = value_grad_tile + kKeyTileSize * grad_row_stride + warp_id * 2 * head_size;
+  float* out_grad_row = query_row + head_size;
+
+  const int64_t batch_head = blockIdx.y;
+  const int64_t batch = batch_head / params.num_heads;
+  const SeqRange range = GetSeqRange(params, blockIdx.z);
+  const int64_t query_seq_len = range.query_len;
+  const int64_t kv_seq_len = range.kv_len;
+  const int64_t kv_begin = blockIdx.x * kKeyTileSize;
+  // The tile is past the end of a shorter packed sequence.
+  if (kv_begin >= kv_seq_len) { return; }
+  const int64_t query_row_begin = batch_head * params.query_seq_len + range.query_offset;
+  const int64_t kv_row_begin = batch_head * params.kv_seq_len + range.kv_offset;
+  const T* query = params.query + query_row_begin * head_size;
+  const T* key = params.key + kv_row_begin * head_size;
+  const T* value = params.value + kv_row_begin * head_size;
+  LoadKeyValueTile(params, key, value, kv_seq_len, kv_begin, key_tile, value_tile);
+  for (int64_t i = threadIdx.x; i < kKeyTileSize * grad_row_stride; i += blockDim.x) {
+    key_grad_tile[i] = 0.0f;
+    value_grad_tile[i] = 0.0f;
+  }
+  __syncthreads();
+  const uint64_t seed = static_cast<uint64_t>(rng_state[0]);
+  const uint64_t offset = static_cast<uint64_t>(rng_state[1]);
+  const int64_t key_idx = kv_begin + lane_id;
+  const T* key_row = key_tile + lane_id * row_stride;
+  const T* value_row = value_tile + lane_id * row_stride;
+  float* key_grad_row = key_grad_tile + lane_id * grad_row_stride;
+  float* value_grad_row = value_grad_tile + lane_id * grad_row_stride;
+  // The queries before this one attend no key of the tile.
+  int64_t query_begin = 0;
+  if (params.causal) {
+    const int64_t causal_begin = kv_begin - kv_seq_len + query_seq_len;
+    query_begin = causal_begin < 0 ? 0 : causal_begin;
+  }
+  for (int64_t query_idx = query_begin + warp_id; query_idx < query_seq_len;
+       query_idx += kNumWarps) {
+    const bool attended = IsKeyAttended(params, range, batch, query_idx, key_idx);
+    if (!__any_sync(0xffffffff, attended)) { continue; }
+    const int64_t row = query_row_begin + query_idx;
+    for (int64_t d = lane_id; d < head_size; d += kWarpSize) {
+      query_row[d] = ToFloat(query[query_idx * head_size + d]);
+      out_grad_row[d] = ToFloat(out_grad[row * head_size + d]);
+    }
+    __syncwarp();
+    float score_grad = 0.0f;
+    if (attended) {
+      float dot = 0.0f;
+      float prob_grad = 0.0f;
+      for (int64_t d = 0; d < head_size; ++d) {
+        dot += query_row[d] * ToFloat(key_row[d]);
+        prob_grad += out_grad_row[d] * ToFloat(value_row[d]);
+      }
+      const float prob = __expf(dot * params.scale - softmax_lse[row]);
+      const float dropout_scale = DropoutScale(
+          seed, offset, row * params.kv_seq_len + range.kv_offset + key_idx, params.dropout_rate);
+      const float dropped_prob = prob * dropout_scale;
+      score_grad = prob * (prob_grad * dropout_scale - delta[row]) * params.scale;
+      // Each warp adds the grads of its query rows to the same keys.
+      for (int64_t d = 0; d < head_size; ++d) {
+        atomicAdd(value_grad_row + d, dropped_prob * out_grad_row[d]);
+        atomicAdd(key_grad_row + d, score_grad * query_row[d]);
+      }
+    }
+    float query_grad[kMaxDimsPerLane];
+#pragma unroll
+    for (int t = 0; t < kMaxDimsPerLane; ++t) { query_grad[t] = 0.0f; }
+    for (int j = 0; j < kKeyTileSize; ++j) {
+      const float grad = __shfl_sync(0xffffffff, score_grad, j);
+      const T* tile_row = key_tile + j * row_stride;
+#pragma unroll
+      for (int t = 0; t < kMaxDimsPerLane; ++t) {
+        const int64_t d = lane_id + t * kWarpSize;
+        if (d < head_size) { query_grad[t] += grad * ToFloat(tile_row[d]); }
+      }
+    }
+#pragma unroll
+    for (int t = 0; t < kMaxDimsPerLane; ++t) {
+      const int64_t d = lane_id + t * kWarpSize;
+      if (d < head_size) { atomicAdd(query_grad_acc + row * head_size + d, query_grad[t]); }
+    }
+    __syncwarp();
+  }
+  __syncthreads();
+  for (int64_t i = threadIdx.x; i < kKeyTileSize * head_size; i += blockDim.x) {
+    const int64_t tile_row = i / head_size;
+    const int64_t col = i - tile_row * head_size;
+    const int64_t grad_key_idx = kv_begin + tile_row;
+    if (grad_key_idx >= kv_seq_len) { break; }
+    const int64_t grad_offset = (kv_row_begin + grad_key_idx) * head_size + col;
+    key_grad[grad_offset] = FromFloat<T>(key_grad_tile[tile_row * grad_row_stride + col]);
+    value_grad[grad_offset] = FromFloat<T>(value_grad_tile[tile_row * grad_row_stride + col]);
+  }
+}
+
+template<typename T>
+__global__ void CastQueryGradGpu(int64_t elem_cnt, const float* query_grad_acc, T* query_grad) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) { query_grad[i] = FromFloat<T>(query_grad_acc[i]); }
+}
+
+template<typename T>
+AttentionParams<T> MakeAttentionParams(user_op::KernelComputeContext* ctx) {
+  const user_op::Tensor* query = ctx->Tensor4ArgNameAndIndex("query", 0);
+  const user_op::Tensor* key = ctx->Tensor4ArgNameAndIndex("key", 0);
+  const user_op::Tensor* value = ctx->Tensor4ArgNameAndIndex("value", 0);
+  AttentionParams<T> params{};
+  params.query = query->dptr<T>();
+  params.key = key->dptr<T>();
+  params.value = value->dptr<T>();
+  params.key_mask = nullptr;
+  if (ctx->has_input("key_mask", 0)) {
+    params.key_mask = ctx->Tensor4ArgNameAndIndex("key_mask", 0)->dptr<bool>();
+  }
+  params.num_heads = query->shape().At(1);
+  params.query_seq_len = query->shape().At(2);
+  params.kv_seq_len = key->shape().At(2);
+  params.cu_seqlens_q = nullptr;
+  params.cu_seqlens_k = nullptr;
+  params.num_seqs = 1;
+  params.max_query_seq_len = params.query_seq_len;
+  params.max_kv_seq_len = params.kv_seq_len;
+  if (ctx->has_input("cu_seqlens_q", 0)) {
+    const user_op::Tensor* cu_seqlens_q = ctx->Tensor4ArgNameAndIndex("cu_seqlens_q", 0);
+    params.cu_seqlens_q = cu_seqlens_q->dptr<int32_t>();
+    params.cu_seqlens_k = ctx->Tensor4ArgNameAndIndex("cu_seqlens_k", 0)->dptr<int32_t>();
+    params.num_seqs = cu_seqlens_q->shape().At(0) - 1;
+    CHECK_LE(params.num_seqs, kMaxNumSeqs)
+        << "fused_attention supports up to " << kMaxNumSeqs << " packed sequences";
+    // Without the longest lengths the grid covers the whole seq axes, which is correct but
+    // launches blocks that find nothing to do.
+    const int64_t max_seqlen_q = ctx->Attr<int64_t>("max_seqlen_q");
+    const int64_t max_seqlen_k = ctx->Attr<int64_t>("max_seqlen_k");
+    if (max_seqlen_q > 0) { params.max_query_seq_len = max_seqlen_q; }
+    if (max_seqlen_k > 0) { params.max_kv_seq_len = max_seqlen_k; }
+  }
+  params.head_size = query->shape().At(3);
+  params.scale = ctx->Attr<float>("scale");
+  params.causal = ctx->Attr<bool>("causal");
+  params.dropout_rate = ctx->Attr<float>("dropout_rate");
+  CHECK_LE(params.head_size, kMaxHeadSize)
+      << "fused_attention supports head sizes up to " << kMaxHeadSize;
+  return params;
+}
+
+// Kernels taking more than the default 48KB of shared memory have to opt in.
+template<typename Kernel>
+void SetDynamicSharedMemorySize(ep::CudaStream* stream, Kernel kernel, size_t shared_mem_size) {
+  CHECK_LE(shared_mem_size, stream->device_properties().sharedMemPerBlockOptin)
+      << "fused_attention needs " << shared_mem_size << " bytes of shared memory per block";
+  if (shared_mem_size > kCudaMaxSharedMemoryByteSize) {
+    OF_CUDA_CHECK(cudaFuncSetAttribute(kernel, cudaFuncAttributeMaxDynamicSharedMemorySize,
+                                       shared_mem_size));
+  }
+}
+
+}  // namespace
+
+template<typename T>
+class FusedAttentionKernel final : public user_op::OpKernel, public user_op::CudaGraphSupport {
+ public:
+  FusedAttentionKernel() = default;
+  ~FusedAttentionKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    const auto& generator = CHECK_JUST(one::MakeGenerator(DeviceType::kCUDA));
+    return std::make_shared<FusedDropoutKernelState>(generator);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0);
+    user_op::Tensor* rng_state = ctx->Tensor4ArgNameAndIndex("rng_state", 0);
+    const AttentionParams<T> params = MakeAttentionParams<T>(ctx);
+    const int64_t batch_heads = out->shape().At(0) * params.num_heads;
+    if (out->shape().elem_cnt() == 0) { return; }
+    uint64_t seed = 0;
+    one::CUDAGeneratorState* gen_state = nullptr;
+    if (params.dropout_rate > 0.0f) {
+      auto* dropout_state = dynamic_cast<FusedDropoutKernelState*>(state);
+      CHECK_NOTNULL(dropout_state);
+      const auto& generator = dropout_state->generator();
+      CHECK_NOTNULL(generator);
+      std::shared_ptr<one::CUDAGeneratorImpl> cuda_generator =
+          CHECK_JUST(generator->Get<one::CUDAGeneratorImpl>());
+      seed = cuda_generator->current_seed();
+      gen_state = cuda_generator->cuda_gen_state();
+    }
+    auto* cuda_stream = ctx->stream()->As<ep::CudaStream>();
+    const size_t shared_mem_size =
+        2 * kKeyTileSize * TileRowStride<T>(params.head_size) * sizeof(T)
+        + kQueryTileSize * params.head_size * sizeof(float);
+    SetDynamicSharedMemorySize(cuda_stream, FusedAttentionForwardGpu<T>, shared_mem_size);
+    const dim3 grid((params.max_query_seq_len + kQueryTileSize - 1) / kQueryTileSize, batch_heads,
+                    params.num_seqs);
+    FusedAttentionForwardGpu<T><<<grid, kBlockSize, shared_mem_size, cuda_stream->cuda_stream()>>>(
+        params, out->mut_dptr<T>(), softmax_lse->mut_dptr<float>(), seed, gen_state,
+        rng_state->mut_dptr<int64_t>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_ATTENTION_CUDA_KERNEL(cpp_type, data_type)      \
+  REGISTER_USER_KERNEL("fused_attention")                              \
+      .SetCreateFn<FusedAttentionKernel<cpp_type>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA) \
+                       && (user_op::HobDataType("out", 0) == data_type));
+
+REGISTER_FUSED_ATTENTION_CUDA_KERNEL(float, DataType::kFloat)
+REGISTER_FUSED_ATTENTION_CUDA_KERNEL(half, DataType::kFloat16)
+#if CUDA_VERSION >= 11000
+REGISTER_FUSED_ATTENTION_CUDA_KERNEL(nv_bfloat16, DataType::kBFloat16)
+#endif
+#undef REGISTER_FUSED_ATTENTION_CUDA_KERNEL
+
+template<typename T>
+class FusedAttentionGradKernel final : public user_op::OpKernel,
+                                       public user_op::CudaGraphSupport {
+ public:
+  FusedAttentionGradKernel() = default;
+  ~FusedAttentionGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const user_op::Tensor* out_grad = ctx->Tensor4ArgNameAndIndex("out_grad", 0);
+    const user_op::Tensor* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0);
+    const user_op::Tensor* rng_state = ctx->Tensor4ArgNameAndIndex("rng_state", 0);
+    user_op::Tensor* query_grad = ctx->Tensor4ArgNameAndIndex("query_grad", 0);
+    user_op::Tensor* key_grad = ctx->Tensor4ArgNameAndIndex("key_grad", 0);
+    user_op::Tensor* value_grad = ctx->Tensor4ArgNameAndIndex("value_grad", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const AttentionParams<T> params = MakeAttentionParams<T>(ctx);
+    const int64_t batch_heads = out->shape().At(0) * params.num_heads;
+    const int64_t num_rows = batch_heads * params.query_seq_len;
+    const int64_t query_elem_cnt = query_grad->shape().elem_cnt();
+    if (query_elem_cnt == 0 && key_grad->shape().elem_cnt() == 0) { return; }
+    auto* cuda_stream = ctx->stream()->As<ep::CudaStream>();
+
+    float* delta = tmp_buffer->mut_dptr<float>();
+    float* query_grad_acc = reinterpret_cast<float*>(query_grad->mut_dptr());
+    if (!std::is_same<T, float>::value) {
+      query_grad_acc = reinterpret_cast<float*>(tmp_buffer->mut_dptr<char>()
+                                                + GetCudaAlignedSize(num_rows * sizeof(float)));
+    }
+    OF_CUDA_CHECK(cudaMemsetAsync(query_grad_acc, 0, query_elem_cnt * sizeof(float),
+                                  cuda_stream->cuda_stream()));
+    if (num_rows > 0) {
+      RUN_CUDA_KERNEL((FusedAttentionGradDeltaGpu<T>), ctx->stream(), num_rows * kWarpSize,
+                      num_rows, params.head_size, out->dptr<T>(), out_grad->dptr<T>(), delta);
+    }
+    if (params.kv_seq_len > 0) {
+      const size_t shared_mem_size =
+          2 * kKeyTileSize * TileRowStride<T>(params.head_size) * sizeof(T)
+          + 2 * kKeyTileSize * (params.head_size + 1) * sizeof(float)
+          + kNumWarps * 2 * params.head_size * sizeof(float);
+      SetDynamicSharedMemorySize(cuda_stream, FusedAttentionBackwardGpu<T>, shared_mem_size);
+      const dim3 grid((params.max_kv_seq_len + kKeyTileSize - 1) / kKeyTileSize, batch_heads,
+                      params.num_seqs);
+      FusedAttentionBackwardGpu<T>
+          <<<grid, kBlockSize, shared_mem_size, cuda_stream->cuda_stream()>>>(
+              params, out_grad->dptr<T>(), softmax_lse->dptr<float>(), delta,
+              rng_state->dptr<int64_t>(), query_grad_acc, key_grad->mut_dptr<T>(),
+              value_grad->mut_dptr<T>());
+    }
+    if (!std::is_same<T, float>::value && query_elem_cnt > 0) {
+      RUN_CUDA_KERNEL((CastQueryGradGpu<T>), ctx->stream(), query_elem_cnt, query_elem_cnt,
+                      query_grad_acc, query_grad->mut_dptr<T>());
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+user_op::InferTmpSizeFn GenFusedAttentionGradInferTmpSizeFn() {
+  return [](user_op::InferContext* ctx) {
+    const Shape& query_shape = ctx->InputShape("query", 0);
+    const int64_t num_rows = query_shape.Count(0, 3);
+    size_t tmp_size = GetCudaAlignedSize(num_rows * sizeof(float));
+    if (!std::is_same<T, float>::value) {
+      tmp_size += GetCudaAlignedSize(query_shape.elem_cnt() * sizeof(float));
+    }
+    return tmp_size;
+  };
+}
+
+#define REGISTER_FUSED_ATTENTION_GRAD_CUDA_KERNEL(cpp_type, data_type)          \
+  REGISTER_USER_KERNEL("fused_attention_grad")                                  \
+      .SetCreateFn<FusedAttentionGradKernel<cpp_type>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)          \
+                       && (user_op::HobDataType("query_grad", 0) == data_type)) \
+      .SetInferTmpSizeFn(GenFusedAttentionGradInferTmpSizeFn<cpp_type>());
+
+REGISTER_FUSED_ATTENTION_GRAD_CUDA_KERNEL(float, DataType::kFloat)
+REGISTER_FUSED_ATTENTION_GRAD_CUDA_KERNEL(half, DataType::kFloat16)
+#if CUDA_VERSION >= 11000
+REGISTER_FUSED_ATTENTION_GRAD_CUDA_KERNEL(nv_bfloat16, DataType::kBFloat16)
+#endif
+#undef REGISTER_FUSED_ATTENTION_GRAD_CUDA_KERNEL
+
+}  // namespace oneflow
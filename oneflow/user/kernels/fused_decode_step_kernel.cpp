@@ -0,0 +1,94 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/distributions/common.h"
+#include "oneflow/user/kernels/fused_decode_step_kernel_util.h"
+#include "oneflow/user/kernels/random_seed_util.h"
+
+namespace oneflow {
+
+template<DeviceType device_type, typename T>
+class FusedDecodeStepKernel final : public user_op::OpKernel {
+ public:
+  FusedDecodeStepKernel() = default;
+  ~FusedDecodeStepKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    const auto& generator = CHECK_JUST(one::MakeGenerator(device_type));
+    generator->set_current_seed(
+        CHECK_JUST(GetOpKernelRandomSeedInCurrentRank(ctx, ctx->Attr<int64_t>("seed"))));
+    return std::make_shared<DistributionKernelState>(generator);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const user_op::Tensor* logits = ctx->Tensor4ArgNameAndIndex("logits", 0);
+    FusedDecodeStepParams<T> params;
+    params.batch_size = logits->shape().At(0);
+    params.num_beams = logits->shape().At(1);
+    params.vocab_size = logits->shape().At(2);
+    params.temperature = ctx->Attr<float>("temperature");
+    params.top_k = ctx->Attr<int64_t>("top_k");
+    params.top_p = ctx->Attr<float>("top_p");
+    params.length_penalty = ctx->Attr<float>("length_penalty");
+    params.eos_token_id = ctx->Attr<int64_t>("eos_token_id");
+    params.pad_token_id = ctx->Attr<int64_t>("pad_token_id");
+    params.logits = logits->dptr<T>();
+    params.scores = ctx->Tensor4ArgNameAndIndex("scores", 0)->dptr<float>();
+    params.finished = ctx->Tensor4ArgNameAndIndex("finished", 0)->dptr<bool>();
+    params.lengths = ctx->Tensor4ArgNameAndIndex("lengths", 0)->dptr<int32_t>();
+    params.next_tokens = ctx->Tensor4ArgNameAndIndex("next_tokens", 0)->mut_dptr<int64_t>();
+    params.out_scores = ctx->Tensor4ArgNameAndIndex("out_scores", 0)->mut_dptr<float>();
+    params.out_finished = ctx->Tensor4ArgNameAndIndex("out_finished", 0)->mut_dptr<bool>();
+    params.out_lengths = ctx->Tensor4ArgNameAndIndex("out_lengths", 0)->mut_dptr<int32_t>();
+    params.parent_beams = ctx->Tensor4ArgNameAndIndex("parent_beams", 0)->mut_dptr<int32_t>();
+    if (ctx->Attr<std::string>("mode") == "beam") {
+      user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+      FusedDecodeStepKernelUtil<device_type, T>::BeamSearch(ctx->stream(), params,
+                                                            tmp_buffer->mut_dptr());
+    } else {
+      auto* distribution_state = dynamic_cast<DistributionKernelState*>(state);
+      CHECK_NOTNULL(distribution_state);
+      const auto& generator = distribution_state->generator();
+      CHECK_NOTNULL(generator);
+      FusedDecodeStepKernelUtil<device_type, T>::Sample(ctx->stream(), params, generator);
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_DECODE_STEP_KERNEL(device, dtype_pair)                                  \
+  REGISTER_USER_KERNEL("fused_decode_step")                                                    \
+      .SetCreateFn<FusedDecodeStepKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                    \
+                       && (user_op::HobDataType("logits", 0) == OF_PP_PAIR_SECOND(dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                            \
+        if (ctx->Attr<std::string>("mode") != "beam") { return 0; }                            \
+        const Shape& logits_shape = ctx->InputShape("logits", 0);                              \
+        return GetBeamSearchWorkspaceSize(logits_shape.At(0), logits_shape.At(1));             \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_DECODE_STEP_KERNEL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_DECODE_STEP_KERNEL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,167 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/fused_decode_step_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/framework/random_generator_impl.h"
+
+namespace oneflow {
+
+template<typename T>
+struct FusedDecodeStepKernelUtil<DeviceType::kCPU, T> {
+  static void Sample(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                     const std::shared_ptr<one::Generator>& generator) {
+    auto gen = CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
+    std::uniform_real_distribution<float> uniform(0, 1);
+    const int64_t vocab_size = params.vocab_size;
+    std::vector<float> probs(vocab_size);
+    std::vector<float> sorted(vocab_size);
+    FOR_RANGE(int64_t, row, 0, params.batch_size * params.num_beams) {
+      // Drawn for every beam, so the numbers of a beam do not depend on the others finishing.
+      const float u = uniform(gen->engine());
+      params.parent_beams[row] = row % params.num_beams;
+      if (params.finished[row]) {
+        params.next_tokens[row] = params.pad_token_id;
+        params.out_scores[row] = params.scores[row];
+        params.out_finished[row] = true;
+        params.out_lengths[row] = params.lengths[row];
+        continue;
+      }
+      const T* logits = params.logits + row * vocab_size;
+      const float max_logit = static_cast<float>(*std::max_element(logits, logits + vocab_size));
+      float sum = 0;
+      FOR_RANGE(int64_t, v, 0, vocab_size) {
+        probs[v] = std::exp((static_cast<float>(logits[v]) - max_logit) / params.temperature);
+        sum += probs[v];
+      }
+      sorted = probs;
+      std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+      float threshold = 0;
+      if (params.top_k > 0 && params.top_k < vocab_size) {
+        threshold = std::max(threshold, sorted[params.top_k - 1]);
+      }
+      if (params.top_p < 1) {
+        float mass = 0;
+        for (const float prob : sorted) {
+          mass += prob;
+          if (mass >= params.top_p * sum) {
+            threshold = std::max(threshold, prob);
+            break;
+          }
+        }
+      }
+      float kept_sum = 0;
+      int64_t last_kept = 0;
+      FOR_RANGE(int64_t, v, 0, vocab_size) {
+        if (probs[v] >= threshold) {
+          kept_sum += probs[v];
+          last_kept = v;
+        }
+      }
+      const float target = u * kept_sum;
+      int64_t token = last_kept;
+      float cum = 0;
+      FOR_RANGE(int64_t, v, 0, vocab_size) {
+        if (probs[v] < threshold) { continue; }
+        cum += probs[v];
+        if (cum > target) {
+          token = v;
+          break;
+        }
+      }
+      params.next_tokens[row] = token;
+      params.out_scores[row] = params.scores[row] + std::log(probs[token] / kept_sum);
+      params.out_finished[row] = token == params.eos_token_id;
+      params.out_lengths[row] = params.lengths[row] + 1;
+    }
+  }
+
+  static void BeamSearch(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                         void* workspace) {
+    const int64_t num_beams = params.num_beams;
+    const int64_t vocab_size = params.vocab_size;
+    const int64_t num_rows = params.batch_size * num_beams;
+    float* candidate_scores = reinterpret_cast<float*>(workspace);
+    int64_t* candidate_tokens = reinterpret_cast<int64_t*>(
+        reinterpret_cast<char*>(workspace)
+        + GetCudaAlignedSize(num_rows * num_beams * sizeof(float)));
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_rows, [&](int64_t begin, int64_t end) {
+      std::vector<int64_t> tokens(vocab_size);
+      for (int64_t row = begin; row < end; ++row) {
+        float* row_scores = candidate_scores + row * num_beams;
+        int64_t* row_tokens = candidate_tokens + row * num_beams;
+        std::fill(row_scores, row_scores + num_beams, -std::numeric_limits<float>::infinity());
+        std::fill(row_tokens, row_tokens + num_beams, params.pad_token_id);
+        if (params.finished[row]) {
+          row_scores[0] = params.scores[row];
+          continue;
+        }
+        const T* logits = params.logits + row * vocab_size;
+        float max_logit = -std::numeric_limits<float>::infinity();
+        FOR_RANGE(int64_t, v, 0, vocab_size) {
+          max_logit = std::max(max_logit, static_cast<float>(logits[v]) / params.temperature);
+        }
+        float sum = 0;
+        FOR_RANGE(int64_t, v, 0, vocab_size) {
+          sum += std::exp(static_cast<float>(logits[v]) / params.temperature - max_logit);
+        }
+        const float log_sum_exp = max_logit + std::log(sum);
+        std::iota(tokens.begin(), tokens.end(), 0);
+        std::partial_sort(tokens.begin(), tokens.begin() + num_beams, tokens.end(),
+                          [&](int64_t a, int64_t b) {
+                            return logits[a] > logits[b] || (logits[a] == logits[b] && a < b);
+                          });
+        FOR_RANGE(int64_t, c, 0, num_beams) {
+          row_scores[c] = params.scores[row]
+                          + static_cast<float>(logits[tokens[c]]) / params.temperature
+                          - log_sum_exp;
+          row_tokens[c] = tokens[c];
+        }
+      }
+    });
+    const int64_t num_candidates = num_beams * num_beams;
+    std::vector<int64_t> order(num_candidates);
+    std::vector<float> keys(num_candidates);
+    FOR_RANGE(int64_t, b, 0, params.batch_size) {
+      const int64_t first_row = b * num_beams;
+      FOR_RANGE(int64_t, i, 0, num_candidates) {
+        const int64_t row = first_row + i / num_beams;
+        const int32_t length = params.lengths[row] + (params.finished[row] ? 0 : 1);
+        keys[i] = LengthNormalizedScore(candidate_scores[first_row * num_beams + i], length,
+                                        params.length_penalty);
+      }
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+                       [&](int64_t x, int64_t y) { return keys[x] > keys[y]; });
+      FOR_RANGE(int64_t, k, 0, num_beams) {
+        const int64_t i = order[k];
+        const int64_t parent = i / num_beams;
+        const int64_t row = first_row + parent;
+        const int64_t token = candidate_tokens[first_row * num_beams + i];
+        const int64_t out = first_row + k;
+        params.next_tokens[out] = token;
+        params.out_scores[out] = candidate_scores[first_row * num_beams + i];
+        params.out_finished[out] = params.finished[row] || token == params.eos_token_id;
+        params.out_lengths[out] = params.lengths[row] + (params.finished[row] ? 0 : 1);
+        params.parent_beams[out] = parent;
+      }
+    }
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_FUSED_DECODE_STEP_KERNEL_UTIL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
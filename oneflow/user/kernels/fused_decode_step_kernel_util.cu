@@ -0,0 +1,374 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/fused_decode_step_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
+#include <cub/cub.cuh>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kDecodeStepBlockSize = 256;
+constexpr int64_t kMaxDecodeStepGridSize = 4096;
+// The thresholds of top_k and top_p are found by bisection over the probabilities relative to
+// the most likely token, instead of sorting the vocabulary.
+constexpr int kNumThresholdBisections = 32;
+
+template<typename T>
+struct DecodeStepCudaType {
+  using type = T;
+};
+
+template<>
+struct DecodeStepCudaType<float16> {
+  using type = half;
+};
+
+struct ScoredToken {
+  float score;
+  int64_t token;
+};
+
+// Descending scores, then ascending tokens.
+__device__ __forceinline__ bool Before(float a_score, int64_t a_token, float b_score,
+                                       int64_t b_token) {
+  return a_score > b_score || (a_score == b_score && a_token < b_token);
+}
+
+struct BeforeOp {
+  __device__ __forceinline__ ScoredToken operator()(const ScoredToken& a,
+                                                    const ScoredToken& b) const {
+    return Before(a.score, a.token, b.score, b.token) ? a : b;
+  }
+};
+
+template<typename T>
+__device__ __forceinline__ void CopyFinishedBeam(const FusedDecodeStepParams<T>& params,
+                                                 int64_t row) {
+  params.next_tokens[row] = params.pad_token_id;
+  params.out_scores[row] = params.scores[row];
+  params.out_finished[row] = true;
+  params.out_lengths[row] = params.lengths[row];
+  params.parent_beams[row] = row % params.num_beams;
+}
+
+// One thread block for each beam.
+template<typename T>
+__global__ void SampleGpu(FusedDecodeStepParams<T> params,
+                          const typename DecodeStepCudaType<T>::type* logits_ptr, uint64_t seed,
+                          one::CUDAGeneratorState* gen_state) {
+  typedef cub::BlockReduce<float, kDecodeStepBlockSize> BlockReduce;
+  typedef cub::BlockReduce<int64_t, kDecodeStepBlockSize> BlockReduceIndex;
+  typedef cub::BlockScan<float, kDecodeStepBlockSize> BlockScan;
+  __shared__ union {
+    typename BlockReduce::TempStorage reduce;
+    typename BlockReduceIndex::TempStorage reduce_index;
+    typename BlockScan::TempStorage scan;
+  } storage;
+  __shared__ float shared_value;
+  __shared__ int64_t shared_index;
+  const uint64_t offset = cuda::philox::Offset(gen_state);
+  const int64_t vocab_size = params.vocab_size;
+  const float temperature = params.temperature;
+  const auto BlockSum = [&](float value) -> float {
+    const float sum = BlockReduce(storage.reduce).Sum(value);
+    if (threadIdx.x == 0) { shared_value = sum; }
+    __syncthreads();
+    const float result = shared_value;
+    __syncthreads();
+    return result;
+  };
+  const auto BlockSumIndex = [&](int64_t value) -> int64_t {
+    const int64_t sum = BlockReduceIndex(storage.reduce_index).Sum(value);
+    if (threadIdx.x == 0) { shared_index = sum; }
+    __syncthreads();
+    const int64_t result = shared_index;
+    __syncthreads();
+    return result;
+  };
+  for (int64_t row = blockIdx.x; row < params.batch_size * params.num_beams; row += gridDim.x) {
+    if (params.finished[row]) {
+      if (threadIdx.x == 0) { CopyFinishedBeam(params, row); }
+      continue;
+    }
+    const auto* logits = logits_ptr + row * vocab_size;
+    float thread_max = -INFINITY;
+    for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+      thread_max = max(thread_max, static_cast<float>(logits[v]));
+    }
+    const float max_logit = BlockReduce(storage.reduce).Reduce(thread_max, cub::Max());
+    if (threadIdx.x == 0) { shared_value = max_logit; }
+    __syncthreads();
+    const float row_max = shared_value;
+    __syncthreads();
+    const auto Prob = [&](int64_t v) -> float {
+      return exp((static_cast<float>(logits[v]) - row_max) / temperature);
+    };
+    float thread_sum = 0;
+    for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+      thread_sum += Prob(v);
+    }
+    const float sum = BlockSum(thread_sum);
+    float threshold = 0;
+    if (params.top_k > 0 && params.top_k < vocab_size) {
+      // The largest threshold keeping at least top_k tokens.
+      float lo = 0;
+      float hi = 1;
+      for (int i = 0; i < kNumThresholdBisections; ++i) {
+        const float mid = (lo + hi) / 2;
+        int64_t thread_count = 0;
+        for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+          thread_count += Prob(v) >= mid ? 1 : 0;
+        }
+        if (BlockSumIndex(thread_count) >= params.top_k) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      threshold = lo;
+    }
+    if (params.top_p < 1) {
+      // The largest threshold keeping at least top_p of the probability.
+      float lo = 0;
+      float hi = 1;
+      for (int i = 0; i < kNumThresholdBisections; ++i) {
+        const float mid = (lo + hi) / 2;
+        float thread_mass = 0;
+        for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+          const float prob = Prob(v);
+          if (prob >= mid) { thread_mass += prob; }
+        }
+        if (BlockSum(thread_mass) >= params.top_p * sum) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      threshold = max(threshold, lo);
+    }
+    float thread_kept = 0;
+    int64_t thread_last = 0;
+    for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+      const float prob = Prob(v);
+      if (prob >= threshold && prob > 0) {
+        thread_kept += prob;
+        thread_last = v;
+      }
+    }
+    const float kept = BlockSum(thread_kept);
+    const int64_t last_kept =
+        BlockReduceIndex(storage.reduce_index).Reduce(thread_last, cub::Max());
+    if (threadIdx.x == 0) {
+      cuda::philox::State state = cuda::philox::MakeState(seed, offset, row);
+      shared_value = curand_uniform(&state) * kept;
+      shared_index = last_kept;
+    }
+    __syncthreads();
+    const float target = shared_value;
+    int64_t token = shared_index;
+    __syncthreads();
+    // The first token whose cumulative probability exceeds the target, a tile at a time.
+    float carry = 0;
+    for (int64_t begin = 0; begin < vocab_size; begin += kDecodeStepBlockSize) {
+      const int64_t v = begin + threadIdx.x;
+      float prob = v < vocab_size ? Prob(v) : 0;
+      if (prob < threshold) { prob = 0; }
+      float cum = 0;
+      float tile_sum = 0;
+      BlockScan(storage.scan).InclusiveSum(prob, cum, tile_sum);
+      __syncthreads();
+      const int64_t candidate =
+          (prob > 0 && carry + cum > target) ? v : GetMaxVal<int64_t>();
+      const int64_t first = BlockReduceIndex(storage.reduce_index).Reduce(candidate, cub::Min());
+      if (threadIdx.x == 0) { shared_index = first; }
+      __syncthreads();
+      const int64_t found = shared_index;
+      __syncthreads();
+      if (found != GetMaxVal<int64_t>()) {
+        token = found;
+        break;
+      }
+      carry += tile_sum;
+    }
+    if (threadIdx.x == 0) {
+      params.next_tokens[row] = token;
+      params.out_scores[row] = params.scores[row] + log(Prob(token) / kept);
+      params.out_finished[row] = token == params.eos_token_id;
+      params.out_lengths[row] = params.lengths[row] + 1;
+      params.parent_beams[row] = row % params.num_beams;
+    }
+  }
+  cuda::philox::AdvanceOffset(gen_state, cuda::philox::kOffsetIncrement);
+}
+
+// One thread block for each beam, picking its num_beams best tokens one after another, each
+// the best of the tokens after the previous one in the order of Before.
+template<typename T>
+__global__ void BeamCandidatesGpu(FusedDecodeStepParams<T> params,
+                                  const typename DecodeStepCudaType<T>::type* logits_ptr,
+                                  float* candidate_scores, int64_t* candidate_tokens) {
+  typedef cub::BlockReduce<float, kDecodeStepBlockSize> BlockReduce;
+  typedef cub::BlockReduce<ScoredToken, kDecodeStepBlockSize> BlockReduceScoredToken;
+  __shared__ union {
+    typename BlockReduce::TempStorage reduce;
+    typename BlockReduceScoredToken::TempStorage reduce_scored_token;
+  } storage;
+  __shared__ float shared_value;
+  __shared__ ScoredToken shared_best;
+  const int64_t num_beams = params.num_beams;
+  const int64_t vocab_size = params.vocab_size;
+  const float temperature = params.temperature;
+  for (int64_t row = blockIdx.x; row < params.batch_size * num_beams; row += gridDim.x) {
+    float* row_scores = candidate_scores + row * num_beams;
+    int64_t* row_tokens = candidate_tokens + row * num_beams;
+    if (params.finished[row]) {
+      for (int64_t c = threadIdx.x; c < num_beams; c += kDecodeStepBlockSize) {
+        row_scores[c] = c == 0 ? params.scores[row] : -INFINITY;
+        row_tokens[c] = params.pad_token_id;
+      }
+      continue;
+    }
+    const auto* logits = logits_ptr + row * vocab_size;
+    float thread_max = -INFINITY;
+    for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+      thread_max = max(thread_max, static_cast<float>(logits[v]) / temperature);
+    }
+    const float max_logit = BlockReduce(storage.reduce).Reduce(thread_max, cub::Max());
+    if (threadIdx.x == 0) { shared_value = max_logit; }
+    __syncthreads();
+    const float row_max = shared_value;
+    __syncthreads();
+    float thread_sum = 0;
+    for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+      thread_sum += exp(static_cast<float>(logits[v]) / temperature - row_max);
+    }
+    const float sum = BlockReduce(storage.reduce).Sum(thread_sum);
+    if (threadIdx.x == 0) { shared_value = row_max + log(sum); }
+    __syncthreads();
+    const float log_sum_exp = shared_value;
+    ScoredToken prev{INFINITY, -1};
+    for (int64_t c = 0; c < num_beams; ++c) {
+      ScoredToken thread_best{-INFINITY, GetMaxVal<int64_t>()};
+      for (int64_t v = threadIdx.x; v < vocab_size; v += kDecodeStepBlockSize) {
+        const float logit = static_cast<float>(logits[v]) / temperature;
+        if (Before(prev.score, prev.token, logit, v)
+            && Before(logit, v, thread_best.score, thread_best.token)) {
+          thread_best = ScoredToken{logit, v};
+        }
+      }
+      const ScoredToken best =
+          BlockReduceScoredToken(storage.reduce_scored_token).Reduce(thread_best, BeforeOp());
+      if (threadIdx.x == 0) {
+        shared_best = best;
+        row_scores[c] = params.scores[row] + best.score - log_sum_exp;
+        row_tokens[c] = best.token;
+      }
+      __syncthreads();
+      prev = shared_best;
+      __syncthreads();
+    }
+  }
+}
+
+// One thread for each batch, picking the num_beams best of the continuations of its beams.
+template<typename T>
+__global__ void SelectBeamsGpu(FusedDecodeStepParams<T> params, const float* candidate_scores,
+                               const int64_t* candidate_tokens) {
+  const int64_t num_beams = params.num_beams;
+  const int64_t num_candidates = num_beams * num_beams;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, b, params.batch_size) {
+    const int64_t first_row = b * num_beams;
+    const float* scores = candidate_scores + first_row * num_beams;
+    const int64_t* tokens = candidate_tokens + first_row * num_beams;
+    const auto Length = [&](int64_t row) -> int32_t {
+      return params.lengths[row] + (params.finished[row] ? 0 : 1);
+    };
+    const auto Key = [&](int64_t i) -> float {
+      return LengthNormalizedScore(scores[i], Length(first_row + i / num_beams),
+                                   params.length_penalty);
+    };
+    float prev_key = INFINITY;
+    int64_t prev = -1;
+    for (int64_t k = 0; k < num_beams; ++k) {
+      float best_key = -INFINITY;
+      int64_t best = -1;
+      for (int64_t i = 0; i < num_candidates; ++i) {
+        const float key = Key(i);
+        if (!Before(prev_key, prev, key, i)) { continue; }
+        if (best < 0 || Before(key, i, best_key, best)) {
+          best_key = key;
+          best = i;
+        }
+      }
+      const int64_t parent = best / num_beams;
+      const int64_t row = first_row + parent;
+      const int64_t out = first_row + k;
+      params.next_tokens[out] = tokens[best];
+      params.out_scores[out] = scores[best];
+      params.out_finished[out] = params.finished[row] || tokens[best] == params.eos_token_id;
+      params.out_lengths[out] = Length(row);
+      params.parent_beams[out] = parent;
+      prev_key = best_key;
+      prev = best;
+    }
+  }
+}
+
+int64_t DecodeStepGridSize(int64_t num_rows) {
+  return std::max<int64_t>(std::min(num_rows, kMaxDecodeStepGridSize), 1);
+}
+
+}  // namespace
+
+template<typename T>
+struct FusedDecodeStepKernelUtil<DeviceType::kCUDA, T> {
+  using CudaT = typename DecodeStepCudaType<T>::type;
+
+  static void Sample(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                     const std::shared_ptr<one::Generator>& generator) {
+    const int64_t num_rows = params.batch_size * params.num_beams;
+    if (num_rows == 0) { return; }
+    auto gen = CHECK_JUST(generator->Get<one::CUDAGeneratorImpl>());
+    SampleGpu<T><<<DecodeStepGridSize(num_rows), kDecodeStepBlockSize, 0,
+                   stream->As<ep::CudaStream>()->cuda_stream()>>>(
+        params, reinterpret_cast<const CudaT*>(params.logits), gen->current_seed(),
+        gen->cuda_gen_state());
+  }
+
+  static void BeamSearch(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                         void* workspace) {
+    const int64_t num_rows = params.batch_size * params.num_beams;
+    if (num_rows == 0) { return; }
+    float* candidate_scores = reinterpret_cast<float*>(workspace);
+    int64_t* candidate_tokens = reinterpret_cast<int64_t*>(
+        reinterpret_cast<char*>(workspace)
+        + GetCudaAlignedSize(num_rows * params.num_beams * sizeof(float)));
+    cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+    BeamCandidatesGpu<T><<<DecodeStepGridSize(num_rows), kDecodeStepBlockSize, 0, cuda_stream>>>(
+        params, reinterpret_cast<const CudaT*>(params.logits), candidate_scores,
+        candidate_tokens);
+    RUN_CUDA_KERNEL((SelectBeamsGpu<T>), stream, params.batch_size, params, candidate_scores,
+                    candidate_tokens);
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_FUSED_DECODE_STEP_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
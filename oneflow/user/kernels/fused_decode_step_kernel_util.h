@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_DECODE_STEP_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_DECODE_STEP_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/framework/random_generator.h"
+
+namespace oneflow {
+
+// The logits are [batch_size, num_beams, vocab_size] and all the others [batch_size, num_beams].
+// A finished beam emits pad_token_id and keeps its score and length, the others emit a token,
+// add its log probability to their scores and grow by one, and finish on eos_token_id.
+template<typename T>
+struct FusedDecodeStepParams {
+  int64_t batch_size;
+  int64_t num_beams;
+  int64_t vocab_size;
+  float temperature;
+  int64_t top_k;
+  float top_p;
+  float length_penalty;
+  int64_t eos_token_id;
+  int64_t pad_token_id;
+  const T* logits;
+  const float* scores;
+  const bool* finished;
+  const int32_t* lengths;
+  int64_t* next_tokens;
+  float* out_scores;
+  bool* out_finished;
+  int32_t* out_lengths;
+  int32_t* parent_beams;
+};
+
+// The best num_beams continuations of each beam, as scores and tokens.
+inline size_t GetBeamSearchWorkspaceSize(int64_t batch_size, int64_t num_beams) {
+  const int64_t num_candidates = batch_size * num_beams * num_beams;
+  return GetCudaAlignedSize(num_candidates * sizeof(float))
+         + GetCudaAlignedSize(num_candidates * sizeof(int64_t));
+}
+
+OF_DEVICE_FUNC float LengthNormalizedScore(float score, int32_t length, float length_penalty) {
+  return score / powf(static_cast<float>(length > 1 ? length : 1), length_penalty);
+}
+
+// Sample draws the token of every beam on its own from the softmax of logits / temperature,
+// restricted to the top_k most likely tokens if top_k > 0 and to the smallest set of the most
+// likely tokens holding top_p of the probability. Tokens tied with the last one kept are kept.
+//
+// BeamSearch keeps, for each batch, the num_beams best continuations of its beams ranked by
+// score / length ** length_penalty, where a finished beam continues only with itself, so the
+// finished hypotheses stay among the beams while they are among the best. parent_beams gives
+// the beam each continuation comes from. The scores of all but the first beam should start at
+// -inf, so the first step does not select the same continuation num_beams times.
+template<DeviceType device_type, typename T>
+struct FusedDecodeStepKernelUtil {
+  static void Sample(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                     const std::shared_ptr<one::Generator>& generator);
+  static void BeamSearch(ep::Stream* stream, const FusedDecodeStepParams<T>& params,
+                         void* workspace);
+};
+
+#define INSTANTIATE_FUSED_DECODE_STEP_KERNEL_UTIL(device_type_v, dtype_pair) \
+  template struct FusedDecodeStepKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_DECODE_STEP_KERNEL_UTIL_H_
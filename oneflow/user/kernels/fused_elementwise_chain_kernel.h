@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_CHAIN_KERNEL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_CHAIN_KERNEL_H_
+
+#include "oneflow/user/kernels/activation_kernels.h"
+#include "oneflow/user/ops/fused_elementwise_chain_util.h"
+#include "oneflow/core/ep/common/primitive/unary_functor.h"
+#include "oneflow/core/ndarray/binary_func.h"
+
+namespace oneflow {
+
+// Runs the steps of the chain on each element, with the functors of the ops it replaces. Only
+// float chains are fused, so that each step rounds as the op it replaces.
+template<DeviceType device_type, typename T>
+struct ElementwiseChainFunctor {
+  struct Step {
+    ElementwiseChainOp op;
+    float param0;
+    float param1;
+  };
+
+  static ElementwiseChainFunctor Create(user_op::KernelComputeContext* ctx) {
+    const auto& op_types = ctx->Attr<std::vector<std::string>>("op_types");
+    const auto& params = ctx->Attr<std::vector<float>>("params");
+    CHECK_LE(op_types.size(), kMaxElementwiseChainLength);
+    CHECK_EQ(params.size(), 2 * op_types.size());
+    ElementwiseChainFunctor functor;
+    functor.num_steps = op_types.size();
+    for (int32_t i = 0; i < functor.num_steps; ++i) {
+      CHECK(ElementwiseChainOp4OpTypeName(op_types.at(i), &functor.steps[i].op));
+      functor.steps[i].param0 = params.at(2 * i);
+      functor.steps[i].param1 = params.at(2 * i + 1);
+    }
+    return functor;
+  }
+
+  OF_DEVICE_FUNC T operator()(T x) const {
+    for (int32_t i = 0; i < num_steps; ++i) { x = Apply(steps[i], x); }
+    return x;
+  }
+
+  OF_DEVICE_FUNC static T Apply(const Step& step, T x) {
+    switch (step.op) {
+      case ElementwiseChainOp::kScalarAdd:
+        return BinaryFuncAdd<T>::Invoke(x, static_cast<T>(step.param0));
+      case ElementwiseChainOp::kScalarMul:
+        return BinaryFuncMul<T>::Invoke(x, static_cast<T>(step.param0));
+      case ElementwiseChainOp::kScalarDiv:
+        return BinaryFuncDiv<T>::Invoke(x, static_cast<T>(step.param0));
+      case ElementwiseChainOp::kRelu:
+        return ep::primitive::UnaryFunctor<device_type, ep::primitive::UnaryOp::kRelu, T, T>()(x);
+      case ElementwiseChainOp::kElu: return EluFunctor<T>(step.param0)(x);
+      case ElementwiseChainOp::kCelu: return CeluFunctor<T>(step.param0)(x);
+      case ElementwiseChainOp::kHardswish: return HardswishFunctor<T>()(x);
+      case ElementwiseChainOp::kHardsigmoid: return HardsigmoidFunctor<T>()(x);
+      case ElementwiseChainOp::kHardtanh: return HardtanhFunctor<T>(step.param0, step.param1)(x);
+      case ElementwiseChainOp::kLeakyRelu: return LeakyReluFunctor<T>(step.param0)(x);
+      case ElementwiseChainOp::kMish: return MishFunctor<T>()(x);
+      case ElementwiseChainOp::kSilu: return SiluFunctor<T>()(x);
+      case ElementwiseChainOp::kSelu: return SeluFunctor<T>()(x);
+      case ElementwiseChainOp::kSoftsign: return SoftSignFunctor<T>()(x);
+      default: return x;
+    }
+  }
+
+  int32_t num_steps;
+  Step steps[kMaxElementwiseChainLength];
+};
+
+#define REGISTER_FUSED_ELEMENTWISE_CHAIN_KERNEL(device, dtype)                                    \
+  REGISTER_USER_KERNEL("fused_elementwise_chain")                                                 \
+      .SetCreateFn([]() {                                                                         \
+        return user_op::NewOpKernel<                                                              \
+            UnaryElemwiseXpuKernel<device, ElementwiseChainFunctor<device, dtype>, dtype, dtype>>( \
+            ElementwiseChainFunctor<device, dtype>::Create, "out", "in");                        \
+      })                                                                                          \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                       \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_ELEMENTWISE_CHAIN_KERNEL_H_
@@ -0,0 +1,259 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/job/nd_sbp_util.h"
+#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/fused_linear_cross_entropy_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+class FusedLinearCrossEntropyKernelCache final : public user_op::OpKernelCache {
+ public:
+  explicit FusedLinearCrossEntropyKernelCache(int64_t class_offset)
+      : class_offset_(class_offset) {}
+  ~FusedLinearCrossEntropyKernelCache() override = default;
+
+  int64_t class_offset() const { return class_offset_; }
+
+ private:
+  const int64_t class_offset_;
+};
+
+std::shared_ptr<user_op::OpKernelCache> CreateClassOffsetCache(user_op::KernelCacheContext* ctx) {
+  if (ctx->parallel_ctx().parallel_num() == 1) { return nullptr; }
+  const NdSbp& nd_sbp = ctx->NdSbp4ArgNameAndIndex("weight", 0);
+  const Shape& hierarchy = *ctx->parallel_desc().hierarchy();
+  const Shape& logical_shape = ctx->LogicalTensorDesc4ArgNameAndIndex("weight", 0)->shape();
+  const TensorSliceView view = GetTensorSliceView4ParallelId(hierarchy, nd_sbp, logical_shape,
+                                                             ctx->parallel_ctx().parallel_id());
+  return std::make_shared<FusedLinearCrossEntropyKernelCache>(view.At(0).begin());
+}
+
+int64_t ClassOffset(const user_op::OpKernelCache* cache) {
+  if (cache == nullptr) { return 0; }
+  const auto* kernel_cache = dynamic_cast<const FusedLinearCrossEntropyKernelCache*>(cache);
+  CHECK_NOTNULL(kernel_cache);
+  return kernel_cache->class_offset();
+}
+
+std::unique_ptr<ep::primitive::Matmul> NewMatmulPrimitive(
+    DeviceType device_type, DataType data_type, ep::primitive::BlasTransposeType trans_a,
+    ep::primitive::BlasTransposeType trans_b) {
+  return ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(device_type, data_type, trans_a,
+                                                                   trans_b);
+}
+
+template<typename T, typename K, typename S>
+FusedLinearCrossEntropyParams<T, K, S> MakeFusedLinearCrossEntropyParams(
+    user_op::KernelComputeContext* ctx) {
+  const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+  const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+  FusedLinearCrossEntropyParams<T, K, S> params{};
+  params.num_rows = x->shape().At(0);
+  params.num_classes = weight->shape().At(0);
+  params.hidden_size = x->shape().At(1);
+  params.ignore_index = ctx->Attr<int64_t>("ignore_index");
+  params.x = x->dptr<T>();
+  params.weight = weight->dptr<T>();
+  return params;
+}
+
+int64_t ChunkSize(user_op::InferContext* ctx) {
+  return std::min(ctx->Attr<int64_t>("chunk_size"), ctx->InputShape("weight", 0).At(0));
+}
+
+}  // namespace
+
+template<DeviceType device_type, typename T, typename K>
+class FusedLinearCrossEntropyStatKernel final : public user_op::OpKernel {
+ public:
+  FusedLinearCrossEntropyStatKernel() = default;
+  ~FusedLinearCrossEntropyStatKernel() override = default;
+
+ private:
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    FusedLinearCrossEntropyParams<T, K, S> params{};
+    params.num_rows = x->shape().At(0);
+    params.num_classes = weight->shape().At(0);
+    params.hidden_size = x->shape().At(1);
+    params.logits = tmp_buffer->mut_dptr<T>();
+    params.max = ctx->Tensor4ArgNameAndIndex("max", 0)->mut_dptr<S>();
+    params.sum_exp = ctx->Tensor4ArgNameAndIndex("sum_exp", 0)->mut_dptr<S>();
+    CHECK_GT(params.num_classes, 0);
+    const int64_t chunk_size = std::min(ctx->Attr<int64_t>("chunk_size"), params.num_classes);
+    auto matmul =
+        NewMatmulPrimitive(device_type, x->data_type(), ep::primitive::BlasTransposeType::N,
+                           ep::primitive::BlasTransposeType::T);
+    CHECK(matmul);
+    for (int64_t begin = 0; begin < params.num_classes; begin += chunk_size) {
+      params.chunk_begin = begin;
+      params.chunk_size = std::min(chunk_size, params.num_classes - begin);
+      matmul->Launch(ctx->stream(), params.num_rows, params.chunk_size, params.hidden_size, 1.0,
+                     x->dptr<T>(), weight->dptr<T>() + begin * params.hidden_size, 0.0,
+                     params.logits);
+      FusedLinearCrossEntropyKernelUtil<device_type, T, K>::UpdateStat(ctx->stream(), params,
+                                                                       begin == 0);
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T, typename K>
+class FusedLinearCrossEntropyKernel final : public user_op::OpKernel {
+ public:
+  FusedLinearCrossEntropyKernel() = default;
+  ~FusedLinearCrossEntropyKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelCache> InitOpKernelCache(
+      user_op::KernelCacheContext* ctx) const override {
+    return CreateClassOffsetCache(ctx);
+  }
+
+ private:
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
+    FusedLinearCrossEntropyParams<T, K, S> params =
+        MakeFusedLinearCrossEntropyParams<T, K, S>(ctx);
+    params.class_offset = ClassOffset(cache);
+    params.label = ctx->Tensor4ArgNameAndIndex("label", 0)->dptr<K>();
+    params.log_sum_exp = ctx->Tensor4ArgNameAndIndex("log_sum_exp", 0)->dptr<S>();
+    params.out = ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr<T>();
+    FusedLinearCrossEntropyKernelUtil<device_type, T, K>::ComputeLoss(ctx->stream(), params);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T, typename K>
+class FusedLinearCrossEntropyGradKernel final : public user_op::OpKernel {
+ public:
+  FusedLinearCrossEntropyGradKernel() = default;
+  ~FusedLinearCrossEntropyGradKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelCache> InitOpKernelCache(
+      user_op::KernelCacheContext* ctx) const override {
+    return CreateClassOffsetCache(ctx);
+  }
+
+ private:
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState*,
+               const user_op::OpKernelCache* cache) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* x_diff = ctx->Tensor4ArgNameAndIndex("x_diff", 0);
+    user_op::Tensor* weight_diff = ctx->Tensor4ArgNameAndIndex("weight_diff", 0);
+    FusedLinearCrossEntropyParams<T, K, S> params =
+        MakeFusedLinearCrossEntropyParams<T, K, S>(ctx);
+    if (params.num_rows == 0 || params.num_classes == 0) {
+      Memset<device_type>(ctx->stream(), weight_diff->mut_dptr(), 0,
+                          weight_diff->shape().elem_cnt() * sizeof(T));
+      Memset<device_type>(ctx->stream(), x_diff->mut_dptr(), 0,
+                          x_diff->shape().elem_cnt() * sizeof(T));
+      return;
+    }
+    params.class_offset = ClassOffset(cache);
+    params.label = ctx->Tensor4ArgNameAndIndex("label", 0)->dptr<K>();
+    params.log_sum_exp = ctx->Tensor4ArgNameAndIndex("log_sum_exp", 0)->dptr<S>();
+    params.dy = ctx->Tensor4ArgNameAndIndex("dy", 0)->dptr<T>();
+    params.logits = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0)->mut_dptr<T>();
+    const int64_t chunk_size = std::min(ctx->Attr<int64_t>("chunk_size"), params.num_classes);
+    const DataType data_type = x->data_type();
+    auto logits_matmul = NewMatmulPrimitive(device_type, data_type,
+                                            ep::primitive::BlasTransposeType::N,
+                                            ep::primitive::BlasTransposeType::T);
+    auto x_diff_matmul = NewMatmulPrimitive(device_type, data_type,
+                                            ep::primitive::BlasTransposeType::N,
+                                            ep::primitive::BlasTransposeType::N);
+    auto weight_diff_matmul = NewMatmulPrimitive(device_type, data_type,
+                                                 ep::primitive::BlasTransposeType::T,
+                                                 ep::primitive::BlasTransposeType::N);
+    CHECK(logits_matmul);
+    CHECK(x_diff_matmul);
+    CHECK(weight_diff_matmul);
+    for (int64_t begin = 0; begin < params.num_classes; begin += chunk_size) {
+      params.chunk_begin = begin;
+      params.chunk_size = std::min(chunk_size, params.num_classes - begin);
+      const T* weight_chunk = params.weight + begin * params.hidden_size;
+      logits_matmul->Launch(ctx->stream(), params.num_rows, params.chunk_size, params.hidden_size,
+                            1.0, params.x, weight_chunk, 0.0, params.logits);
+      FusedLinearCrossEntropyKernelUtil<device_type, T, K>::ComputeLogitsGrad(ctx->stream(),
+                                                                              params);
+      // x_diff accumulates over the chunks, every chunk owns its rows of weight_diff.
+      x_diff_matmul->Launch(ctx->stream(), params.num_rows, params.hidden_size, params.chunk_size,
+                            1.0, params.logits, weight_chunk, begin == 0 ? 0.0 : 1.0,
+                            x_diff->mut_dptr<T>());
+      weight_diff_matmul->Launch(ctx->stream(), params.chunk_size, params.hidden_size,
+                                 params.num_rows, 1.0, params.logits, params.x, 0.0,
+                                 weight_diff->mut_dptr<T>() + begin * params.hidden_size);
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+// The stat kernel reads no label, its util is instantiated with int64_t labels.
+#define REGISTER_FUSED_LINEAR_CROSS_ENTROPY_STAT_KERNEL(device, dtype_pair)                   \
+  REGISTER_USER_KERNEL("fused_linear_cross_entropy_stat")                                     \
+      .SetCreateFn<                                                                           \
+          FusedLinearCrossEntropyStatKernel<device, OF_PP_PAIR_FIRST(dtype_pair), int64_t>>() \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                   \
+                       && (user_op::HobDataType("x", 0) == OF_PP_PAIR_SECOND(dtype_pair)))    \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                           \
+        return ctx->InputShape("x", 0).At(0) * ChunkSize(ctx)                                 \
+               * sizeof(OF_PP_PAIR_FIRST(dtype_pair));                                        \
+      });
+
+#define REGISTER_FUSED_LINEAR_CROSS_ENTROPY_KERNELS(device, dtype_pair, itype_pair)             \
+  REGISTER_USER_KERNEL("fused_linear_cross_entropy")                                            \
+      .SetCreateFn<FusedLinearCrossEntropyKernel<device, OF_PP_PAIR_FIRST(dtype_pair),          \
+                                                 OF_PP_PAIR_FIRST(itype_pair)>>()               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("x", 0) == OF_PP_PAIR_SECOND(dtype_pair))       \
+                       && (user_op::HobDataType("label", 0) == OF_PP_PAIR_SECOND(itype_pair))); \
+  REGISTER_USER_KERNEL("fused_linear_cross_entropy_grad")                                       \
+      .SetCreateFn<FusedLinearCrossEntropyGradKernel<device, OF_PP_PAIR_FIRST(dtype_pair),      \
+                                                     OF_PP_PAIR_FIRST(itype_pair)>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("x", 0) == OF_PP_PAIR_SECOND(dtype_pair))       \
+                       && (user_op::HobDataType("label", 0) == OF_PP_PAIR_SECOND(itype_pair)))  \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
+        return ctx->InputShape("x", 0).At(0) * ChunkSize(ctx)                                   \
+               * sizeof(OF_PP_PAIR_FIRST(dtype_pair));                                          \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_LINEAR_CROSS_ENTROPY_STAT_KERNEL,
+                                 (DeviceType::kCPU), FLOATING_DATA_TYPE_SEQ)
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_LINEAR_CROSS_ENTROPY_KERNELS, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_LINEAR_CROSS_ENTROPY_STAT_KERNEL,
+                                 (DeviceType::kCUDA), FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ)
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_FUSED_LINEAR_CROSS_ENTROPY_KERNELS, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/fused_linear_cross_entropy_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+template<typename T, typename K>
+struct FusedLinearCrossEntropyKernelUtil<DeviceType::kCPU, T, K> {
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+
+  static void UpdateStat(ep::Stream* stream, const FusedLinearCrossEntropyParams<T, K, S>& params,
+                         bool first_chunk) {
+    const size_t grain = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.chunk_size));
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, params.num_rows,
+        [&params, first_chunk](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            FusedLinearCrossEntropyUpdateStatRow<T, K, S>(params, first_chunk, i);
+          }
+        },
+        grain);
+  }
+
+  static void ComputeLoss(ep::Stream* stream,
+                          const FusedLinearCrossEntropyParams<T, K, S>& params) {
+    const size_t grain = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.hidden_size));
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, params.num_rows,
+        [&params](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            FusedLinearCrossEntropyLossRow<T, K, S>(params, i);
+          }
+        },
+        grain);
+  }
+
+  static void ComputeLogitsGrad(ep::Stream* stream,
+                                const FusedLinearCrossEntropyParams<T, K, S>& params) {
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, params.num_rows * params.chunk_size, [&params](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            FusedLinearCrossEntropyLogitsGradElem<T, K, S>(params, i);
+          }
+        });
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL,
+                                 (DeviceType::kCPU), FLOATING_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
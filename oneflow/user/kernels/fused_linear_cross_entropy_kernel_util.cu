@@ -0,0 +1,125 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_CUDA
+#include "oneflow/user/kernels/fused_linear_cross_entropy_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T, typename K, typename S>
+__global__ void FusedLinearCrossEntropyUpdateStatGpu(
+    const FusedLinearCrossEntropyParams<T, K, S> params, bool first_chunk) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, params.num_rows) {
+    FusedLinearCrossEntropyUpdateStatRow<T, K, S>(params, first_chunk, i);
+  }
+}
+
+template<typename T, typename K, typename S>
+__global__ void FusedLinearCrossEntropyLossGpu(
+    const FusedLinearCrossEntropyParams<T, K, S> params) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, params.num_rows) {
+    FusedLinearCrossEntropyLossRow<T, K, S>(params, i);
+  }
+}
+
+template<typename T, typename K, typename S>
+__global__ void FusedLinearCrossEntropyLogitsGradGpu(
+    const FusedLinearCrossEntropyParams<T, K, S> params, int64_t elem_cnt) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    FusedLinearCrossEntropyLogitsGradElem<T, K, S>(params, i);
+  }
+}
+
+template<typename K>
+FusedLinearCrossEntropyParams<half, K, float> ToHalfParams(
+    const FusedLinearCrossEntropyParams<float16, K, float>& params) {
+  FusedLinearCrossEntropyParams<half, K, float> half_params;
+  half_params.num_rows = params.num_rows;
+  half_params.num_classes = params.num_classes;
+  half_params.hidden_size = params.hidden_size;
+  half_params.chunk_begin = params.chunk_begin;
+  half_params.chunk_size = params.chunk_size;
+  half_params.class_offset = params.class_offset;
+  half_params.ignore_index = params.ignore_index;
+  half_params.x = reinterpret_cast<const half*>(params.x);
+  half_params.weight = reinterpret_cast<const half*>(params.weight);
+  half_params.label = params.label;
+  half_params.log_sum_exp = params.log_sum_exp;
+  half_params.dy = reinterpret_cast<const half*>(params.dy);
+  half_params.logits = reinterpret_cast<half*>(params.logits);
+  half_params.max = params.max;
+  half_params.sum_exp = params.sum_exp;
+  half_params.out = reinterpret_cast<half*>(params.out);
+  return half_params;
+}
+
+}  // namespace
+
+template<typename T, typename K>
+struct FusedLinearCrossEntropyKernelUtil<DeviceType::kCUDA, T, K> {
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+
+  static void UpdateStat(ep::Stream* stream, const FusedLinearCrossEntropyParams<T, K, S>& params,
+                         bool first_chunk) {
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyUpdateStatGpu<T, K, S>), stream, params.num_rows,
+                    params, first_chunk);
+  }
+
+  static void ComputeLoss(ep::Stream* stream,
+                          const FusedLinearCrossEntropyParams<T, K, S>& params) {
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyLossGpu<T, K, S>), stream, params.num_rows, params);
+  }
+
+  static void ComputeLogitsGrad(ep::Stream* stream,
+                                const FusedLinearCrossEntropyParams<T, K, S>& params) {
+    const int64_t elem_cnt = params.num_rows * params.chunk_size;
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyLogitsGradGpu<T, K, S>), stream, elem_cnt, params,
+                    elem_cnt);
+  }
+};
+
+template<typename K>
+struct FusedLinearCrossEntropyKernelUtil<DeviceType::kCUDA, float16, K> {
+  static void UpdateStat(ep::Stream* stream,
+                         const FusedLinearCrossEntropyParams<float16, K, float>& params,
+                         bool first_chunk) {
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyUpdateStatGpu<half, K, float>), stream,
+                    params.num_rows, ToHalfParams(params), first_chunk);
+  }
+
+  static void ComputeLoss(ep::Stream* stream,
+                          const FusedLinearCrossEntropyParams<float16, K, float>& params) {
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyLossGpu<half, K, float>), stream, params.num_rows,
+                    ToHalfParams(params));
+  }
+
+  static void ComputeLogitsGrad(ep::Stream* stream,
+                                const FusedLinearCrossEntropyParams<float16, K, float>& params) {
+    const int64_t elem_cnt = params.num_rows * params.chunk_size;
+    RUN_CUDA_KERNEL((FusedLinearCrossEntropyLogitsGradGpu<half, K, float>), stream, elem_cnt,
+                    ToHalfParams(params), elem_cnt);
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL,
+                                 (DeviceType::kCUDA), FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ,
+                                 INDEX_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
+
+#endif  // WITH_CUDA
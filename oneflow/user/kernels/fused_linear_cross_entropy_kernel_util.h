@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+// The running max, sum_exp and log_sum_exp of float16 logits are kept in float.
+template<typename T>
+struct FusedLinearCrossEntropyStatType {
+  using type = T;
+};
+
+template<>
+struct FusedLinearCrossEntropyStatType<float16> {
+  using type = float;
+};
+
+// x is [num_rows, hidden_size] and weight is [num_classes, hidden_size], where num_classes is the
+// local part of the classes starting at class_offset. The logits of the classes
+// [chunk_begin, chunk_begin + chunk_size) of weight are computed into logits, which is
+// [num_rows, chunk_size], one chunk at a time so that the whole [num_rows, num_classes] logits
+// never exist at once. max and sum_exp are [num_rows], label, log_sum_exp, dy and out are
+// [num_rows].
+template<typename T, typename K, typename S>
+struct FusedLinearCrossEntropyParams {
+  int64_t num_rows;
+  int64_t num_classes;
+  int64_t hidden_size;
+  int64_t chunk_begin;
+  int64_t chunk_size;
+  int64_t class_offset;
+  int64_t ignore_index;
+  const T* x;
+  const T* weight;
+  const K* label;
+  const S* log_sum_exp;
+  const T* dy;
+  T* logits;
+  S* max;
+  S* sum_exp;
+  T* out;
+};
+
+template<DeviceType device_type, typename T, typename K>
+struct FusedLinearCrossEntropyKernelUtil {
+  using S = typename FusedLinearCrossEntropyStatType<T>::type;
+  // Folds the logits of a chunk into the running max and sum_exp, which the first chunk sets.
+  static void UpdateStat(ep::Stream* stream, const FusedLinearCrossEntropyParams<T, K, S>& params,
+                         bool first_chunk);
+  static void ComputeLoss(ep::Stream* stream, const FusedLinearCrossEntropyParams<T, K, S>& params);
+  // Replaces the logits of a chunk with their gradient dy * (softmax - one_hot(label)).
+  static void ComputeLogitsGrad(ep::Stream* stream,
+                                const FusedLinearCrossEntropyParams<T, K, S>& params);
+};
+
+template<typename S>
+OF_DEVICE_FUNC S FusedLinearCrossEntropyExp(S x) {
+#if defined(__CUDA_ARCH__)
+  return exp(x);
+#else
+  return std::exp(x);
+#endif
+}
+
+OF_DEVICE_FUNC bool FusedLinearCrossEntropyIsLocalLabel(int64_t label, int64_t class_offset,
+                                                        int64_t num_classes) {
+  return label >= class_offset && label < class_offset + num_classes;
+}
+
+template<typename T, typename K, typename S>
+OF_DEVICE_FUNC void FusedLinearCrossEntropyUpdateStatRow(
+    const FusedLinearCrossEntropyParams<T, K, S>& params, bool first_chunk, int64_t row) {
+  const T* row_logits = params.logits + row * params.chunk_size;
+  S chunk_max = static_cast<S>(row_logits[0]);
+  for (int64_t j = 1; j < params.chunk_size; ++j) {
+    const S logit = static_cast<S>(row_logits[j]);
+    if (logit > chunk_max) { chunk_max = logit; }
+  }
+  S max = chunk_max;
+  S sum_exp = 0;
+  if (!first_chunk) {
+    const S prev_max = params.max[row];
+    if (prev_max > max) { max = prev_max; }
+    sum_exp = params.sum_exp[row] * FusedLinearCrossEntropyExp<S>(prev_max - max);
+  }
+  for (int64_t j = 0; j < params.chunk_size; ++j) {
+    sum_exp += FusedLinearCrossEntropyExp<S>(static_cast<S>(row_logits[j]) - max);
+  }
+  params.max[row] = max;
+  params.sum_exp[row] = sum_exp;
+}
+
+// Only the part holding the label of a row gives it a loss, log_sum_exp - logit[label].
+template<typename T, typename K, typename S>
+OF_DEVICE_FUNC void FusedLinearCrossEntropyLossRow(
+    const FusedLinearCrossEntropyParams<T, K, S>& params, int64_t row) {
+  const int64_t label = static_cast<int64_t>(params.label[row]);
+  S loss = 0;
+  if (label != params.ignore_index
+      && FusedLinearCrossEntropyIsLocalLabel(label, params.class_offset, params.num_classes)) {
+    const T* x_row = params.x + row * params.hidden_size;
+    const T* weight_row = params.weight + (label - params.class_offset) * params.hidden_size;
+    S logit = 0;
+    for (int64_t k = 0; k < params.hidden_size; ++k) {
+      logit += static_cast<S>(x_row[k]) * static_cast<S>(weight_row[k]);
+    }
+    loss = params.log_sum_exp[row] - logit;
+  }
+  params.out[row] = static_cast<T>(loss);
+}
+
+template<typename T, typename K, typename S>
+OF_DEVICE_FUNC void FusedLinearCrossEntropyLogitsGradElem(
+    const FusedLinearCrossEntropyParams<T, K, S>& params, int64_t offset) {
+  const int64_t row = offset / params.chunk_size;
+  const int64_t col = offset - row * params.chunk_size;
+  const int64_t label = static_cast<int64_t>(params.label[row]);
+  if (label == params.ignore_index) {
+    params.logits[offset] = static_cast<T>(static_cast<S>(0));
+    return;
+  }
+  const S logit = static_cast<S>(params.logits[offset]);
+  S grad = FusedLinearCrossEntropyExp<S>(logit - params.log_sum_exp[row]);
+  if (label == params.class_offset + params.chunk_begin + col) { grad -= static_cast<S>(1); }
+  params.logits[offset] = static_cast<T>(static_cast<S>(params.dy[row]) * grad);
+}
+
+#define INSTANTIATE_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL(device_type_v, dtype_pair, itype_pair) \
+  template struct FusedLinearCrossEntropyKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair),  \
+                                                    OF_PP_PAIR_FIRST(itype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_LINEAR_CROSS_ENTROPY_KERNEL_UTIL_H_
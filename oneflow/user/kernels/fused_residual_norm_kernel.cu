@@ -0,0 +1,583 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/device/cudnn_util.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/kernel/cuda_graph_support.h"
+#include "oneflow/core/ep/include/primitive/fill.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/layer_norm.cuh"
+#include <cub/cub.cuh>
+
+namespace oneflow {
+
+namespace {
+
+enum class NormActivation { kNone, kGelu, kSilu };
+
+NormActivation ParseNormActivation(const std::string& activation) {
+  if (activation == "gelu") {
+    return NormActivation::kGelu;
+  } else if (activation == "silu") {
+    return NormActivation::kSilu;
+  } else {
+    CHECK_EQ(activation, "none");
+    return NormActivation::kNone;
+  }
+}
+
+template<typename T>
+__device__ __forceinline__ T ActivationForward(NormActivation activation, T z) {
+  if (activation == NormActivation::kGelu) {
+    return static_cast<T>(0.5) * z * (static_cast<T>(1.0) + erf(z * static_cast<T>(M_SQRT1_2)));
+  } else if (activation == NormActivation::kSilu) {
+    return z / (static_cast<T>(1.0) + exp(-z));
+  } else {
+    return z;
+  }
+}
+
+template<typename T>
+__device__ __forceinline__ T ActivationBackward(NormActivation activation, T z, T dy) {
+  if (activation == NormActivation::kGelu) {
+    const T cdf = static_cast<T>(0.5) * (static_cast<T>(1.0) + erf(z * static_cast<T>(M_SQRT1_2)));
+    const T pdf = exp(static_cast<T>(-0.5) * z * z) * static_cast<T>(M_2_SQRTPI * M_SQRT1_2 * 0.5);
+    return dy * (cdf + z * pdf);
+  } else if (activation == NormActivation::kSilu) {
+    const T sigmoid = static_cast<T>(1.0) / (static_cast<T>(1.0) + exp(-z));
+    return dy * sigmoid * (static_cast<T>(1.0) + z * (static_cast<T>(1.0) - sigmoid));
+  } else {
+    return dy;
+  }
+}
+
+struct FusedResidualNormParams {
+  const void* x;
+  const void* residual;
+  const void* bias;
+  const void* gamma;
+  const void* beta;
+  NormActivation activation;
+  int64_t rows;
+  int64_t cols;
+};
+
+template<typename T, typename ComputeType>
+__device__ __forceinline__ ComputeType LoadParam(const T* param, int64_t col,
+                                                 ComputeType default_value) {
+  return param == nullptr ? default_value : static_cast<ComputeType>(param[col]);
+}
+
+// Loads x + residual + bias and writes the sum back, so that the sum can be both returned as the
+// next residual and used by the backward pass. The uncached layer norm path loads a row twice and
+// writes the same values twice, which is harmless.
+template<typename SRC, typename DST>
+struct ResidualLoad {
+  ResidualLoad(const SRC* x, const SRC* residual, const SRC* bias, SRC* sum, int64_t row_size)
+      : x(x), residual(residual), bias(bias), sum(sum), row_size(row_size) {}
+  template<int N>
+  __device__ void load(DST* dst, int64_t row, int64_t col) const {
+    cuda::layer_norm::Pack<SRC, N> x_pack;
+    cuda::layer_norm::Pack<SRC, N> residual_pack;
+    cuda::layer_norm::Pack<SRC, N> bias_pack;
+    cuda::layer_norm::Pack<SRC, N> sum_pack;
+    const int64_t offset = (row * row_size + col) / N;
+    x_pack.storage = *(reinterpret_cast<const cuda::layer_norm::PackType<SRC, N>*>(x) + offset);
+    if (residual != nullptr) {
+      residual_pack.storage =
+          *(reinterpret_cast<const cuda::layer_norm::PackType<SRC, N>*>(residual) + offset);
+    }
+    if (bias != nullptr) {
+      bias_pack.storage =
+          *(reinterpret_cast<const cuda::layer_norm::PackType<SRC, N>*>(bias) + col / N);
+    }
+#pragma unroll
+    for (int i = 0; i < N; ++i) {
+      DST h = static_cast<DST>(x_pack.elem[i]);
+      if (residual != nullptr) { h += static_cast<DST>(residual_pack.elem[i]); }
+      if (bias != nullptr) { h += static_cast<DST>(bias_pack.elem[i]); }
+      sum_pack.elem[i] = static_cast<SRC>(h);
+      // Normalize the rounded sum so that the backward pass sees the same input.
+      dst[i] = static_cast<DST>(sum_pack.elem[i]);
+    }
+    *(reinterpret_cast<cuda::layer_norm::PackType<SRC, N>*>(sum) + offset) = sum_pack.storage;
+  }
+  const SRC* x;
+  const SRC* residual;
+  const SRC* bias;
+  SRC* sum;
+  int64_t row_size;
+};
+
+template<typename SRC, typename DST>
+struct AffineActivationStore {
+  AffineActivationStore(DST* y, int64_t row_size, const DST* gamma, const DST* beta,
+                        NormActivation activation)
+      : y(y), row_size(row_size), gamma(gamma), beta(beta), activation(activation) {}
+  template<int N>
+  __device__ void store(const SRC* src, int64_t row, int64_t col) {
+    cuda::layer_norm::Pack<DST, N> y_pack;
+    const int64_t offset = (row * row_size + col) / N;
+#pragma unroll
+    for (int i = 0; i < N; ++i) {
+      const SRC z = src[i] * LoadParam<DST, SRC>(gamma, col + i, 1)
+                    + LoadParam<DST, SRC>(beta, col + i, 0);
+      y_pack.elem[i] = static_cast<DST>(ActivationForward<SRC>(activation, z));
+    }
+    *(reinterpret_cast<cuda::layer_norm::PackType<DST, N>*>(y) + offset) = y_pack.storage;
+  }
+  DST* y;
+  int64_t row_size;
+  const DST* gamma;
+  const DST* beta;
+  NormActivation activation;
+};
+
+// Recomputes the pre-activation output from the saved sum and statistics and loads
+// act'(z) * dy * gamma, the gradient of the normalized input.
+template<typename SRC, typename DST>
+struct ActivationScaleLoad {
+  ActivationScaleLoad(const SRC* dy, const SRC* sum, const DST* mean, const DST* inv_variance,
+                      const SRC* gamma, const SRC* beta, NormActivation activation,
+                      int64_t row_size)
+      : dy(dy),
+        sum(sum),
+        mean(mean),
+        inv_variance(inv_variance),
+        gamma(gamma),
+        beta(beta),
+        activation(activation),
+        row_size(row_size) {}
+  template<int N>
+  __device__ void load(DST* dst, int64_t row, int64_t col) const {
+    cuda::layer_norm::Pack<SRC, N> dy_pack;
+    cuda::layer_norm::Pack<SRC, N> sum_pack;
+    const int64_t offset = (row * row_size + col) / N;
+    dy_pack.storage = *(reinterpret_cast<const cuda::layer_norm::PackType<SRC, N>*>(dy) + offset);
+    if (activation != NormActivation::kNone) {
+      sum_pack.storage =
+          *(reinterpret_cast<const cuda::layer_norm::PackType<SRC, N>*>(sum) + offset);
+    }
+    const DST mean_val = mean[row];
+    const DST inv_variance_val = inv_variance[row];
+#pragma unroll
+    for (int i = 0; i < N; ++i) {
+      const DST gamma_val = LoadParam<SRC, DST>(gamma, col + i, 1);
+      DST dz = static_cast<DST>(dy_pack.elem[i]);
+      if (activation != NormActivation::kNone) {
+        const DST normalized = (static_cast<DST>(sum_pack.elem[i]) - mean_val) * inv_variance_val;
+        const DST z = normalized * gamma_val + LoadParam<SRC, DST>(beta, col + i, 0);
+        dz = ActivationBackward<DST>(activation, z, dz);
+      }
+      dst[i] = dz * gamma_val;
+    }
+  }
+  const SRC* dy;
+  const SRC* sum;
+  const DST* mean;
+  const DST* inv_variance;
+  const SRC* gamma;
+  const SRC* beta;
+  NormActivation activation;
+  int64_t row_size;
+};
+
+template<typename SRC, typename DST>
+struct SumGradAddStore {
+  SumGradAddStore(const DST* sum_grad, DST* dst, int64_t row_size)
+      : sum_grad(sum_grad), dst(dst), row_size(row_size) {}
+  template<int N>
+  __device__ void store(const SRC* src, int64_t row, int64_t col) {
+    cuda::layer_norm::Pack<DST, N> sum_grad_pack;
+    cuda::layer_norm::Pack<DST, N> dst_pack;
+    const int64_t offset = (row * row_size + col) / N;
+    if (sum_grad != nullptr) {
+      sum_grad_pack.storage =
+          *(reinterpret_cast<const cuda::layer_norm::PackType<DST, N>*>(sum_grad) + offset);
+    }
+#pragma unroll
+    for (int i = 0; i < N; ++i) {
+      SRC val = src[i];
+      if (sum_grad != nullptr) { val += static_cast<SRC>(sum_grad_pack.elem[i]); }
+      dst_pack.elem[i] = static_cast<DST>(val);
+    }
+    *(reinterpret_cast<cuda::layer_norm::PackType<DST, N>*>(dst) + offset) = dst_pack.storage;
+  }
+  const DST* sum_grad;
+  DST* dst;
+  int64_t row_size;
+};
+
+constexpr int kRmsNormBlockSize = 256;
+
+template<typename T, typename ComputeType>
+__global__ void RmsNormForwardGpu(FusedResidualNormParams params, const double epsilon, T* sum,
+                                  T* y, ComputeType* mean, ComputeType* inv_rms) {
+  using BlockReduce = cub::BlockReduce<ComputeType, kRmsNormBlockSize>;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ ComputeType row_inv_rms;
+  const T* x = static_cast<const T*>(params.x);
+  const T* residual = static_cast<const T*>(params.residual);
+  const T* bias = static_cast<const T*>(params.bias);
+  const T* gamma = static_cast<const T*>(params.gamma);
+  for (int64_t row = blockIdx.x; row < params.rows; row += gridDim.x) {
+    const int64_t row_offset = row * params.cols;
+    ComputeType square_sum = 0;
+    for (int64_t col = threadIdx.x; col < params.cols; col += kRmsNormBlockSize) {
+      ComputeType h = static_cast<ComputeType>(x[row_offset + col]);
+      if (residual != nullptr) { h += static_cast<ComputeType>(residual[row_offset + col]); }
+      if (bias != nullptr) { h += static_cast<ComputeType>(bias[col]); }
+      const T rounded = static_cast<T>(h);
+      sum[row_offset + col] = rounded;
+      h = static_cast<ComputeType>(rounded);
+      square_sum += h * h;
+    }
+    const ComputeType row_square_sum = BlockReduce(temp_storage).Sum(square_sum);
+    if (threadIdx.x == 0) {
+      const ComputeType inv = rsqrt(row_square_sum / static_cast<ComputeType>(params.cols)
+                                    + static_cast<ComputeType>(epsilon));
+      row_inv_rms = inv;
+      mean[row] = 0;
+      inv_rms[row] = inv;
+    }
+    __syncthreads();
+    const ComputeType inv = row_inv_rms;
+    // Each thread reads back only the sum elements it wrote above.
+    for (int64_t col = threadIdx.x; col < params.cols; col += kRmsNormBlockSize) {
+      const ComputeType normalized = static_cast<ComputeType>(sum[row_offset + col]) * inv;
+      const ComputeType z = normalized * LoadParam<T, ComputeType>(gamma, col, 1);
+      y[row_offset + col] = static_cast<T>(ActivationForward<ComputeType>(params.activation, z));
+    }
+    __syncthreads();
+  }
+}
+
+template<typename T, typename ComputeType>
+__global__ void RmsNormBackwardGpu(FusedResidualNormParams params, const T* dy, const T* sum,
+                                   const ComputeType* inv_rms, const T* sum_grad, T* sum_diff) {
+  using BlockReduce = cub::BlockReduce<ComputeType, kRmsNormBlockSize>;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ ComputeType row_dot;
+  const T* gamma = static_cast<const T*>(params.gamma);
+  const ComputeType cols = static_cast<ComputeType>(params.cols);
+  for (int64_t row = blockIdx.x; row < params.rows; row += gridDim.x) {
+    const int64_t row_offset = row * params.cols;
+    const ComputeType inv = inv_rms[row];
+    ComputeType dot = 0;
+    for (int64_t col = threadIdx.x; col < params.cols; col += kRmsNormBlockSize) {
+      const ComputeType normalized = static_cast<ComputeType>(sum[row_offset + col]) * inv;
+      const ComputeType gamma_val = LoadParam<T, ComputeType>(gamma, col, 1);
+      const ComputeType dz =
+          ActivationBackward<ComputeType>(params.activation, normalized * gamma_val,
+                                          static_cast<ComputeType>(dy[row_offset + col]));
+      dot += dz * gamma_val * normalized;
+    }
+    const ComputeType sum_dot = BlockReduce(temp_storage).Sum(dot);
+    if (threadIdx.x == 0) { row_dot = sum_dot / cols; }
+    __syncthreads();
+    const ComputeType mean_dot = row_dot;
+    for (int64_t col = threadIdx.x; col < params.cols; col += kRmsNormBlockSize) {
+      const ComputeType normalized = static_cast<ComputeType>(sum[row_offset + col]) * inv;
+      const ComputeType gamma_val = LoadParam<T, ComputeType>(gamma, col, 1);
+      const ComputeType dz =
+          ActivationBackward<ComputeType>(params.activation, normalized * gamma_val,
+                                          static_cast<ComputeType>(dy[row_offset + col]));
+      ComputeType dh = inv * (dz * gamma_val - normalized * mean_dot);
+      if (sum_grad != nullptr) { dh += static_cast<ComputeType>(sum_grad[row_offset + col]); }
+      sum_diff[row_offset + col] = static_cast<T>(dh);
+    }
+    __syncthreads();
+  }
+}
+
+int GetRmsNormNumBlocks(int64_t rows) {
+  constexpr int64_t kMaxBlocks = 8192;
+  return static_cast<int>(std::min<int64_t>(rows, kMaxBlocks));
+}
+
+constexpr int kTileSize = 32;
+constexpr int kNumPerBlock = 4;
+constexpr int kBlockDimX = 32;
+constexpr int kBlockDimY = 32 / kNumPerBlock;
+
+template<typename T>
+__inline__ __device__ T WarpReduceSum(T val) {
+  for (int mask = 16; mask > 0; mask /= 2) { val += __shfl_down_sync(0xffffffff, val, mask); }
+  return val;
+}
+
+// Same tiling as LayerNormParamGrad, with the affine output and the activation gradient
+// recomputed from the saved sum. For rms_norm the saved mean is zero.
+template<typename T, typename ComputeType>
+__global__ void FusedResidualNormParamGrad(FusedResidualNormParams params, const T* __restrict__ dy,
+                                           const T* __restrict__ sum,
+                                           const ComputeType* __restrict__ mean,
+                                           const ComputeType* __restrict__ inv_var,
+                                           T* __restrict__ tmp_gamma_diff,
+                                           T* __restrict__ tmp_beta_diff) {
+  __shared__ ComputeType dgamma[32][33];
+  __shared__ ComputeType dbeta[32][33];
+  const T* gamma = static_cast<const T*>(params.gamma);
+  const T* beta = static_cast<const T*>(params.beta);
+  const int rows = params.rows;
+  const int cols = params.cols;
+  ComputeType dgamma_sum[kNumPerBlock];
+  ComputeType dbeta_sum[kNumPerBlock];
+#pragma unroll
+  for (int index = 0; index < kNumPerBlock; ++index) {
+    dgamma_sum[index] = 0;
+    dbeta_sum[index] = 0;
+  }
+  const int col_id = blockIdx.x * blockDim.x + threadIdx.x;
+  if (col_id < cols) {
+    const ComputeType gamma_val = LoadParam<T, ComputeType>(gamma, col_id, 1);
+    const ComputeType beta_val = LoadParam<T, ComputeType>(beta, col_id, 0);
+    for (int i = blockIdx.y * kTileSize + threadIdx.y; i < rows; i += kTileSize * gridDim.y) {
+#pragma unroll
+      for (int index = 0; index < kNumPerBlock; ++index) {
+        int row_id = i + index * blockDim.y;
+        if (row_id < rows) {
+          int offset = row_id * cols + col_id;
+          const ComputeType normalized =
+              (static_cast<ComputeType>(sum[offset]) - mean[row_id]) * inv_var[row_id];
+          const ComputeType dz =
+              ActivationBackward<ComputeType>(params.activation, normalized * gamma_val + beta_val,
+                                              static_cast<ComputeType>(dy[offset]));
+          dgamma_sum[index] += dz * normalized;
+          dbeta_sum[index] += dz;
+        }
+      }
+    }
+  }
+#pragma unroll
+  for (int index = 0; index < kNumPerBlock; ++index) {
+    dgamma[index * blockDim.y + threadIdx.y][threadIdx.x] = dgamma_sum[index];
+    dbeta[index * blockDim.y + threadIdx.y][threadIdx.x] = dbeta_sum[index];
+  }
+  __syncthreads();
+#pragma unroll
+  for (int index = 0; index < kNumPerBlock; ++index) {
+    const int col_id = blockIdx.x * blockDim.x + threadIdx.y + index * blockDim.y;
+    if (col_id < cols) {
+      ComputeType global_dgamma =
+          WarpReduceSum<ComputeType>(dgamma[threadIdx.x][threadIdx.y + index * blockDim.y]);
+      ComputeType global_dbeta =
+          WarpReduceSum<ComputeType>(dbeta[threadIdx.x][threadIdx.y + index * blockDim.y]);
+      if (threadIdx.x == 0) {
+        const int offset = blockIdx.y * cols + col_id;
+        tmp_gamma_diff[offset] = global_dgamma;
+        tmp_beta_diff[offset] = global_dbeta;
+      }
+    }
+  }
+}
+
+template<typename T>
+int GetParamGradGridDimY(const int64_t num_instances, const int64_t norm_size) {
+  using ComputeType = typename cuda::layer_norm::DefaultComputeType<T>::type;
+  const int grid_dim_x = (norm_size + kTileSize - 1) / kTileSize;
+  const int max_grid_dim_y = (num_instances + kTileSize - 1) / kTileSize;
+  int max_active_blocks = 0;
+  OF_CUDA_CHECK(cudaOccupancyMaxActiveBlocksPerMultiprocessor(
+      &max_active_blocks, FusedResidualNormParamGrad<T, ComputeType>, kBlockDimX * kBlockDimY,
+      0));
+  int dev;
+  OF_CUDA_CHECK(cudaGetDevice(&dev));
+  int sm_count;
+  OF_CUDA_CHECK(cudaDeviceGetAttribute(&sm_count, cudaDevAttrMultiProcessorCount, dev));
+  const int num_blocks = max_active_blocks * sm_count;
+  const int grid_dim_y = std::min(max_grid_dim_y, static_cast<int>(num_blocks / grid_dim_x));
+  return std::max(grid_dim_y, 1);
+}
+
+FusedResidualNormParams MakeParams(user_op::KernelComputeContext* ctx, const std::string& x_name,
+                                   int64_t rows, int64_t cols) {
+  FusedResidualNormParams params{};
+  params.x = ctx->Tensor4ArgNameAndIndex(x_name, 0)->dptr();
+  auto OptionalInput = [&](const std::string& arg_name) -> const void* {
+    return ctx->has_input(arg_name, 0) ? ctx->Tensor4ArgNameAndIndex(arg_name, 0)->dptr() : nullptr;
+  };
+  params.residual = OptionalInput("residual");
+  params.bias = OptionalInput("bias");
+  params.gamma = OptionalInput("gamma");
+  params.beta = OptionalInput("beta");
+  params.activation = ParseNormActivation(ctx->Attr<std::string>("activation"));
+  params.rows = rows;
+  params.cols = cols;
+  return params;
+}
+
+}  // namespace
+
+template<typename T>
+class FusedResidualNormGpuKernel final : public user_op::OpKernel,
+                                         public user_op::CudaGraphSupport {
+ public:
+  FusedResidualNormGpuKernel() = default;
+  ~FusedResidualNormGpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    using ComputeType = typename cuda::layer_norm::DefaultComputeType<T>::type;
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* sum = ctx->Tensor4ArgNameAndIndex("sum", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const double epsilon = ctx->Attr<double>("epsilon");
+    CHECK_GE(epsilon, CUDNN_BN_MIN_EPSILON);
+    const int64_t rows = mean->shape().elem_cnt();
+    if (rows == 0) { return; }
+    const int64_t cols = y->shape().elem_cnt() / rows;
+    const FusedResidualNormParams params = MakeParams(ctx, "x", rows, cols);
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    if (ctx->Attr<std::string>("norm_type") == "rms_norm") {
+      RmsNormForwardGpu<T, ComputeType>
+          <<<GetRmsNormNumBlocks(rows), kRmsNormBlockSize, 0, cuda_stream>>>(
+              params, epsilon, sum->mut_dptr<T>(), y->mut_dptr<T>(),
+              mean->mut_dptr<ComputeType>(), inv_variance->mut_dptr<ComputeType>());
+    } else {
+      ResidualLoad<T, ComputeType> load(static_cast<const T*>(params.x),
+                                        static_cast<const T*>(params.residual),
+                                        static_cast<const T*>(params.bias), sum->mut_dptr<T>(),
+                                        cols);
+      AffineActivationStore<ComputeType, T> store(y->mut_dptr<T>(), cols,
+                                                  static_cast<const T*>(params.gamma),
+                                                  static_cast<const T*>(params.beta),
+                                                  params.activation);
+      OF_CUDA_CHECK((cuda::layer_norm::DispatchLayerNorm<decltype(load), decltype(store),
+                                                         ComputeType>(
+          cuda_stream, load, store, rows, cols, epsilon, mean->mut_dptr<ComputeType>(),
+          inv_variance->mut_dptr<ComputeType>())));
+    }
+  }
+};
+
+#define REGISTER_FUSED_RESIDUAL_NORM_CUDA_KERNEL(dtype)                                 \
+  REGISTER_USER_KERNEL("fused_residual_norm")                                           \
+      .SetCreateFn<FusedResidualNormGpuKernel<dtype>>()                                 \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)                  \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_RESIDUAL_NORM_CUDA_KERNEL(float)
+REGISTER_FUSED_RESIDUAL_NORM_CUDA_KERNEL(double)
+REGISTER_FUSED_RESIDUAL_NORM_CUDA_KERNEL(half)
+
+template<typename T>
+class FusedResidualNormGradGpuKernel final : public user_op::OpKernel,
+                                             public user_op::CudaGraphSupport {
+ public:
+  FusedResidualNormGradGpuKernel() = default;
+  ~FusedResidualNormGradGpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    using ComputeType = typename cuda::layer_norm::DefaultComputeType<T>::type;
+    const user_op::Tensor* y_grad = ctx->Tensor4ArgNameAndIndex("y_grad", 0);
+    const user_op::Tensor* sum = ctx->Tensor4ArgNameAndIndex("sum", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* sum_diff = ctx->Tensor4ArgNameAndIndex("sum_diff", 0);
+    const int64_t rows = mean->shape().elem_cnt();
+    if (rows == 0) { return; }
+    const int64_t cols = sum->shape().elem_cnt() / rows;
+    const FusedResidualNormParams params = MakeParams(ctx, "sum", rows, cols);
+    const T* sum_grad_ptr = nullptr;
+    if (ctx->has_input("sum_grad", 0)) {
+      sum_grad_ptr = ctx->Tensor4ArgNameAndIndex("sum_grad", 0)->dptr<T>();
+    }
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    if (ctx->Attr<std::string>("norm_type") == "rms_norm") {
+      RmsNormBackwardGpu<T, ComputeType>
+          <<<GetRmsNormNumBlocks(rows), kRmsNormBlockSize, 0, cuda_stream>>>(
+              params, y_grad->dptr<T>(), sum->dptr<T>(), inv_variance->dptr<ComputeType>(),
+              sum_grad_ptr, sum_diff->mut_dptr<T>());
+    } else {
+      cuda::layer_norm::DirectLoad<T, ComputeType> load_x(sum->dptr<T>(), cols);
+      ActivationScaleLoad<T, ComputeType> load_scaled_dy(
+          y_grad->dptr<T>(), sum->dptr<T>(), mean->dptr<ComputeType>(),
+          inv_variance->dptr<ComputeType>(), static_cast<const T*>(params.gamma),
+          static_cast<const T*>(params.beta), params.activation, cols);
+      SumGradAddStore<ComputeType, T> store(sum_grad_ptr, sum_diff->mut_dptr<T>(), cols);
+      OF_CUDA_CHECK((cuda::layer_norm::DispatchLayerNormGrad<decltype(load_x),
+                                                             decltype(load_scaled_dy),
+                                                             decltype(store), ComputeType>(
+          cuda_stream, load_x, load_scaled_dy, store, mean->dptr<ComputeType>(),
+          inv_variance->dptr<ComputeType>(), rows, cols)));
+    }
+    const bool has_gamma_diff = ctx->has_output("gamma_diff", 0);
+    const bool has_beta_diff = ctx->has_output("beta_diff", 0);
+    if (!has_gamma_diff && !has_beta_diff) { return; }
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int grid_dim_x = (cols + kTileSize - 1) / kTileSize;
+    const int grid_dim_y = GetParamGradGridDimY<T>(rows, cols);
+    const size_t tmp_gamma_diff_size = grid_dim_y * cols * sizeof(T);
+    T* tmp_gamma_diff_ptr = reinterpret_cast<T*>(tmp_buffer->mut_dptr());
+    T* tmp_beta_diff_ptr = reinterpret_cast<T*>(tmp_buffer->mut_dptr<char>() + tmp_gamma_diff_size);
+    T* reduce_buf_ptr =
+        reinterpret_cast<T*>(tmp_buffer->mut_dptr<char>() + 2 * tmp_gamma_diff_size);
+    FusedResidualNormParamGrad<T, ComputeType>
+        <<<dim3(grid_dim_x, grid_dim_y), dim3(kBlockDimX, kBlockDimY), 0, cuda_stream>>>(
+            params, y_grad->dptr<T>(), sum->dptr<T>(), mean->dptr<ComputeType>(),
+            inv_variance->dptr<ComputeType>(), tmp_gamma_diff_ptr, tmp_beta_diff_ptr);
+    const DataType data_type = sum->data_type();
+    std::unique_ptr<ep::primitive::Fill> fill =
+        ep::primitive::NewPrimitive<ep::primitive::FillFactory>(ctx->stream()->device_type(),
+                                                                data_type);
+    CHECK(fill);
+    fill->Launch(ctx->stream(), reduce_buf_ptr, 1.0, grid_dim_y);
+    std::unique_ptr<ep::primitive::Matmul> matmul =
+        ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+            ctx->stream()->device_type(), data_type, ep::primitive::BlasTransposeType::T,
+            ep::primitive::BlasTransposeType::N);
+    CHECK(matmul);
+    if (has_gamma_diff) {
+      matmul->Launch(ctx->stream(), cols, 1, grid_dim_y, 1.0, tmp_gamma_diff_ptr, reduce_buf_ptr,
+                     0.0, ctx->Tensor4ArgNameAndIndex("gamma_diff", 0)->mut_dptr());
+    }
+    if (has_beta_diff) {
+      matmul->Launch(ctx->stream(), cols, 1, grid_dim_y, 1.0, tmp_beta_diff_ptr, reduce_buf_ptr,
+                     0.0, ctx->Tensor4ArgNameAndIndex("beta_diff", 0)->mut_dptr());
+    }
+  }
+};
+
+#define REGISTER_FUSED_RESIDUAL_NORM_GRAD_CUDA_KERNEL(dtype)                             \
+  REGISTER_USER_KERNEL("fused_residual_norm_grad")                                       \
+      .SetCreateFn<FusedResidualNormGradGpuKernel<dtype>>()                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)                   \
+                       && (user_op::HobDataType("sum", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                      \
+        if (!ctx->has_output("gamma_diff", 0) && !ctx->has_output("beta_diff", 0)) {     \
+          return 0;                                                                      \
+        }                                                                                \
+        const auto& mean = ctx->InputTensorDesc("mean", 0);                              \
+        const int64_t num_instances = mean.shape().elem_cnt();                           \
+        if (num_instances == 0) { return 0; }                                            \
+        const int64_t norm_size = ctx->InputTensorDesc("sum", 0).shape().elem_cnt()      \
+                                  / num_instances;                                       \
+        const int grid_dim_y = GetParamGradGridDimY<dtype>(num_instances, norm_size);    \
+        return (2 * grid_dim_y * norm_size + grid_dim_y) * sizeof(dtype);                \
+      });
+
+REGISTER_FUSED_RESIDUAL_NORM_GRAD_CUDA_KERNEL(float)
+REGISTER_FUSED_RESIDUAL_NORM_GRAD_CUDA_KERNEL(double)
+REGISTER_FUSED_RESIDUAL_NORM_GRAD_CUDA_KERNEL(half)
+
+}  // namespace oneflow
@@ -63,10 +63,29 @@ class GPTDataLoader final : public OpKernelState {
     label_len_ = 1;
     int64_t num_samples = ctx->Attr<int64_t>("num_samples");
 
-    dataset_ = std::make_unique<const MegatronGPTMMapDataset>(
-        ctx->Attr<std::string>("data_file_prefix"), seq_len_, label_len_, num_samples,
-        ctx->Attr<std::vector<int64_t>>("split_sizes"), ctx->Attr<int64_t>("split_index"),
-        ctx->Attr<bool>("shuffle"), ctx->Attr<int64_t>("random_seed"));
+    const auto& split_sizes = ctx->Attr<std::vector<int64_t>>("split_sizes");
+    const int64_t split_index = ctx->Attr<int64_t>("split_index");
+    const bool shuffle = ctx->Attr<bool>("shuffle");
+    const int64_t random_seed = ctx->Attr<int64_t>("random_seed");
+    const auto& blend_prefixes = ctx->Attr<std::vector<std::string>>("blend_data_file_prefixes");
+    if (blend_prefixes.empty()) {
+      dataset_ = std::make_unique<const MegatronGPTMMapDataset>(
+          ctx->Attr<std::string>("data_file_prefix"), seq_len_, label_len_, num_samples,
+          split_sizes, split_index, shuffle, random_seed);
+    } else {
+      const auto& blend_weights = ctx->Attr<std::vector<float>>("blend_weights");
+      CHECK_EQ(blend_prefixes.size(), blend_weights.size());
+      const std::vector<size_t> dataset_num_samples =
+          MegatronGPTBlendedDataset::GetNumSamplesPerDataset(blend_weights, num_samples);
+      std::vector<std::unique_ptr<const MegatronGPTMMapDataset>> datasets;
+      FOR_RANGE(size_t, i, 0, blend_prefixes.size()) {
+        datasets.emplace_back(std::make_unique<const MegatronGPTMMapDataset>(
+            blend_prefixes[i], seq_len_, label_len_, dataset_num_samples[i], split_sizes,
+            split_index, shuffle, random_seed));
+      }
+      blended_dataset_ = std::make_unique<const MegatronGPTBlendedDataset>(
+          std::move(datasets), blend_weights, num_samples);
+    }
 
     batch_size_ = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().At(0);
     CHECK_JUST(InitDataSourceDistributedInfo(ctx, num_shards_, shard_index_));
@@ -82,7 +101,11 @@ class GPTDataLoader final : public OpKernelState {
     T* dptr = tokens->mut_dptr<T>();
     for (size_t i = 0; i < batch_size_; ++i) {
       size_t sample_iter = iter * batch_size_ * num_shards_ + shard_index_ * batch_size_ + i;
-      dataset_->GetSample(sample_iter, dptr + i * sample_len);
+      if (blended_dataset_) {
+        blended_dataset_->GetSample(sample_iter, dptr + i * sample_len);
+      } else {
+        dataset_->GetSample(sample_iter, dptr + i * sample_len);
+      }
     }
   }
 
@@ -94,6 +117,7 @@ class GPTDataLoader final : public OpKernelState {
 
  private:
   std::unique_ptr<const MegatronGPTMMapDataset> dataset_;
+  std::unique_ptr<const MegatronGPTBlendedDataset> blended_dataset_;
   size_t seq_len_;
   size_t label_len_;
   size_t batch_size_;
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/top_k_kernel_util.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 
 namespace oneflow {
@@ -219,7 +220,7 @@ class GpuHeapSelectionTopKKernel final : public user_op::OpKernel {
 
 #define REGISTER_CUDA_HEAP_SELECTION_TOP_K_KERNEL(dtype)                                          \
   REGISTER_USER_KERNEL("top_k").SetCreateFn<GpuHeapSelectionTopKKernel<dtype>>().SetIsMatchedHob( \
-      (user_op::HobDeviceType() == DeviceType::kCUDA) && (user_op::HobAttr<int32_t>("k") <= 128)  \
+      (user_op::HobDeviceType() == DeviceType::kCUDA) && HobUseHeapSelectionTopK()                \
       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value));
 
 REGISTER_CUDA_HEAP_SELECTION_TOP_K_KERNEL(float)
@@ -0,0 +1,464 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <cub/cub.cuh>
+#include <curand_kernel.h>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int32_t kMaxCropAttempts = 10;
+constexpr float kPi = 3.14159265358979323846f;
+
+enum class InterpolationType {
+  kNearest = 0,
+  kBilinear = 1,
+  kBicubic = 2,
+};
+
+struct ChannelVal {
+  float val[3];
+};
+
+// Attrs of the whole augmentation chain, passed by value to the kernels.
+struct AugmentAttr {
+  float area_min;
+  float area_max;
+  float log_ratio_min;
+  float log_ratio_max;
+  float flip_prob;
+  float rotate_radians;
+  float brightness;
+  float contrast;
+  float saturation;
+  float hue;
+  bool is_bgr;
+  ChannelVal mean;
+  ChannelVal inv_std;
+};
+
+// Random parameters drawn for each image of a batch.
+struct AugmentParam {
+  int32_t in_h;
+  int32_t in_w;
+  float crop_y;
+  float crop_x;
+  float crop_h;
+  float crop_w;
+  float cos_a;
+  float sin_a;
+  bool flip;
+  float brightness;
+  float contrast;
+  float saturation;
+  float hue_cos;
+  float hue_sin;
+  float gray_mean;
+};
+
+class ImageAugmentKernelState final : public user_op::OpKernelState {
+ public:
+  explicit ImageAugmentKernelState(int64_t seed) : seed_(seed), step_(0) {}
+  ~ImageAugmentKernelState() override = default;
+
+  uint64_t seed() const { return seed_; }
+  uint64_t NextStep() { return step_++; }
+
+ private:
+  uint64_t seed_;
+  uint64_t step_;
+};
+
+__device__ __forceinline__ float Uniform(curandStatePhilox4_32_10_t* state, float lo, float hi) {
+  return lo + (hi - lo) * curand_uniform(state);
+}
+
+__device__ __forceinline__ float Clamp255(float v) { return fminf(fmaxf(v, 0.f), 255.f); }
+
+// Same weights as torchvision for the gray scale, on RGB.
+__device__ __forceinline__ float Gray(float r, float g, float b) {
+  return 0.299f * r + 0.587f * g + 0.114f * b;
+}
+
+template<int C>
+__device__ __forceinline__ float PixelGray(const uint8_t* pixel, bool is_bgr) {
+  if (C == 1) { return pixel[0]; }
+  return is_bgr ? Gray(pixel[2], pixel[1], pixel[0]) : Gray(pixel[0], pixel[1], pixel[2]);
+}
+
+// One block an image: draws the parameters of the image, and the mean gray of it if contrast
+// is jittered.
+template<int C>
+__global__ void GenAugmentParamsGpu(const uint8_t* in_dptr, const int32_t* in_size_dptr,
+                                    int32_t max_h, int32_t max_w, AugmentAttr attr, uint64_t seed,
+                                    uint64_t step, AugmentParam* params) {
+  typedef cub::BlockReduce<float, kCudaThreadsNumPerBlock> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage reduce_tmp_storage;
+  const int32_t n = blockIdx.x;
+  const int32_t in_h = in_size_dptr ? min(in_size_dptr[n * 2], max_h) : max_h;
+  const int32_t in_w = in_size_dptr ? min(in_size_dptr[n * 2 + 1], max_w) : max_w;
+  float gray_sum = 0;
+  if (attr.contrast > 0) {
+    const uint8_t* image = in_dptr + static_cast<int64_t>(n) * max_h * max_w * C;
+    for (int32_t i = threadIdx.x; i < in_h * in_w; i += blockDim.x) {
+      const int32_t y = i / in_w;
+      const int32_t x = i - y * in_w;
+      gray_sum += PixelGray<C>(image + (static_cast<int64_t>(y) * max_w + x) * C, attr.is_bgr);
+    }
+  }
+  gray_sum = BlockReduce(reduce_tmp_storage).Sum(gray_sum);
+  if (threadIdx.x != 0) { return; }
+  curandStatePhilox4_32_10_t state;
+  curand_init(seed, n, step * 64, &state);
+  AugmentParam param;
+  param.in_h = in_h;
+  param.in_w = in_w;
+  // Random resized crop, the same sampling as torchvision with a center crop as the fallback. An
+  // area range of [1, 1] keeps the whole image whatever its aspect ratio.
+  const float area = static_cast<float>(in_h) * in_w;
+  bool found = false;
+  if (attr.area_min >= 1) {
+    param.crop_w = in_w;
+    param.crop_h = in_h;
+    param.crop_x = 0;
+    param.crop_y = 0;
+    found = true;
+  }
+  for (int32_t i = 0; i < kMaxCropAttempts && !found; ++i) {
+    const float target_area = area * Uniform(&state, attr.area_min, attr.area_max);
+    const float ratio = expf(Uniform(&state, attr.log_ratio_min, attr.log_ratio_max));
+    const float w = roundf(sqrtf(target_area * ratio));
+    const float h = roundf(sqrtf(target_area / ratio));
+    if (w > 0 && h > 0 && w <= in_w && h <= in_h) {
+      param.crop_w = w;
+      param.crop_h = h;
+      param.crop_x = floorf(Uniform(&state, 0.f, in_w - w + 1 - 1e-3f));
+      param.crop_y = floorf(Uniform(&state, 0.f, in_h - h + 1 - 1e-3f));
+      found = true;
+    }
+  }
+  if (!found) {
+    const float in_ratio = static_cast<float>(in_w) / in_h;
+    const float ratio_min = expf(attr.log_ratio_min);
+    const float ratio_max = expf(attr.log_ratio_max);
+    if (in_ratio < ratio_min) {
+      param.crop_w = in_w;
+      param.crop_h = roundf(in_w / ratio_min);
+    } else if (in_ratio > ratio_max) {
+      param.crop_h = in_h;
+      param.crop_w = roundf(in_h * ratio_max);
+    } else {
+      param.crop_w = in_w;
+      param.crop_h = in_h;
+    }
+    param.crop_x = floorf((in_w - param.crop_w) / 2);
+    param.crop_y = floorf((in_h - param.crop_h) / 2);
+  }
+  param.flip = curand_uniform(&state) < attr.flip_prob;
+  const float angle = Uniform(&state, -attr.rotate_radians, attr.rotate_radians);
+  param.cos_a = cosf(angle);
+  param.sin_a = sinf(angle);
+  param.brightness = Uniform(&state, fmaxf(0.f, 1 - attr.brightness), 1 + attr.brightness);
+  param.contrast = Uniform(&state, fmaxf(0.f, 1 - attr.contrast), 1 + attr.contrast);
+  param.saturation = Uniform(&state, fmaxf(0.f, 1 - attr.saturation), 1 + attr.saturation);
+  const float hue_angle = Uniform(&state, -attr.hue, attr.hue) * 2 * kPi;
+  param.hue_cos = cosf(hue_angle);
+  param.hue_sin = sinf(hue_angle);
+  param.gray_mean = in_h * in_w > 0 ? Clamp255(gray_sum / (in_h * in_w) * param.brightness) : 0;
+  params[n] = param;
+}
+
+__device__ __forceinline__ float CubicWeight(float x) {
+  // Keys' kernel with a = -0.75, as OpenCV does.
+  constexpr float a = -0.75f;
+  x = fabsf(x);
+  if (x <= 1) { return ((a + 2) * x - (a + 3)) * x * x + 1; }
+  if (x < 2) { return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a; }
+  return 0;
+}
+
+template<int C>
+__device__ __forceinline__ void Fetch(const uint8_t* image, int32_t max_w, int32_t in_h,
+                                      int32_t in_w, int32_t y, int32_t x, float weight,
+                                      float* val) {
+  y = min(max(y, 0), in_h - 1);
+  x = min(max(x, 0), in_w - 1);
+  const uint8_t* pixel = image + (static_cast<int64_t>(y) * max_w + x) * C;
+#pragma unroll
+  for (int c = 0; c < C; ++c) { val[c] += weight * pixel[c]; }
+}
+
+// Samples the image at (sy, sx) in pixel coordinates, where pixel centers are integers. Points
+// outside of the image are filled with zeros.
+template<int C, InterpolationType interpolation>
+__device__ __forceinline__ bool Sample(const uint8_t* image, int32_t max_w, int32_t in_h,
+                                       int32_t in_w, float sy, float sx, float* val) {
+#pragma unroll
+  for (int c = 0; c < C; ++c) { val[c] = 0; }
+  if (sy < -0.5f || sx < -0.5f || sy > in_h - 0.5f || sx > in_w - 0.5f) { return false; }
+  if (interpolation == InterpolationType::kNearest) {
+    Fetch<C>(image, max_w, in_h, in_w, __float2int_rd(sy + 0.5f), __float2int_rd(sx + 0.5f), 1.f,
+             val);
+  } else if (interpolation == InterpolationType::kBilinear) {
+    const int32_t y0 = __float2int_rd(sy);
+    const int32_t x0 = __float2int_rd(sx);
+    const float dy = sy - y0;
+    const float dx = sx - x0;
+    Fetch<C>(image, max_w, in_h, in_w, y0, x0, (1 - dy) * (1 - dx), val);
+    Fetch<C>(image, max_w, in_h, in_w, y0, x0 + 1, (1 - dy) * dx, val);
+    Fetch<C>(image, max_w, in_h, in_w, y0 + 1, x0, dy * (1 - dx), val);
+    Fetch<C>(image, max_w, in_h, in_w, y0 + 1, x0 + 1, dy * dx, val);
+  } else {
+    const int32_t y0 = __float2int_rd(sy);
+    const int32_t x0 = __float2int_rd(sx);
+    const float dy = sy - y0;
+    const float dx = sx - x0;
+#pragma unroll
+    for (int i = -1; i <= 2; ++i) {
+      const float wy = CubicWeight(i - dy);
+#pragma unroll
+      for (int j = -1; j <= 2; ++j) {
+        Fetch<C>(image, max_w, in_h, in_w, y0 + i, x0 + j, wy * CubicWeight(j - dx), val);
+      }
+    }
+  }
+  return true;
+}
+
+// Brightness, contrast, saturation and hue in this fixed order, clamped after each of them like
+// torchvision does, on RGB.
+__device__ __forceinline__ void JitterColor(const AugmentParam& param, const AugmentAttr& attr,
+                                            float* rgb) {
+  if (attr.brightness > 0) {
+#pragma unroll
+    for (int c = 0; c < 3; ++c) { rgb[c] = Clamp255(rgb[c] * param.brightness); }
+  }
+  if (attr.contrast > 0) {
+#pragma unroll
+    for (int c = 0; c < 3; ++c) {
+      rgb[c] = Clamp255((rgb[c] - param.gray_mean) * param.contrast + param.gray_mean);
+    }
+  }
+  if (attr.saturation > 0) {
+    const float gray = Gray(rgb[0], rgb[1], rgb[2]);
+#pragma unroll
+    for (int c = 0; c < 3; ++c) { rgb[c] = Clamp255((rgb[c] - gray) * param.saturation + gray); }
+  }
+  if (attr.hue > 0) {
+    // Rotates the chroma in YIQ space.
+    const float y = 0.299f * rgb[0] + 0.587f * rgb[1] + 0.114f * rgb[2];
+    const float i0 = 0.596f * rgb[0] - 0.274f * rgb[1] - 0.322f * rgb[2];
+    const float q0 = 0.211f * rgb[0] - 0.523f * rgb[1] + 0.312f * rgb[2];
+    const float i = i0 * param.hue_cos - q0 * param.hue_sin;
+    const float q = i0 * param.hue_sin + q0 * param.hue_cos;
+    rgb[0] = Clamp255(y + 0.956f * i + 0.621f * q);
+    rgb[1] = Clamp255(y - 0.272f * i - 0.647f * q);
+    rgb[2] = Clamp255(y - 1.106f * i + 1.703f * q);
+  }
+}
+
+// One thread an output pixel: flip, rotation, crop and resize are folded into a single inverse
+// mapping to the source image, followed by color jitter and normalization.
+template<int C, InterpolationType interpolation, bool nchw>
+__global__ void ImageAugmentGpu(int32_t elem_cnt, const uint8_t* in_dptr, int32_t max_h,
+                                int32_t max_w, const AugmentParam* params, AugmentAttr attr,
+                                int32_t out_h, int32_t out_w, float* out_dptr) {
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
+    const int32_t n = i / (out_h * out_w);
+    const int32_t y = (i / out_w) % out_h;
+    const int32_t x = i % out_w;
+    const AugmentParam param = params[n];
+    const float ox = param.flip ? out_w - 1 - x : x;
+    const float du = (ox + 0.5f) * param.crop_w / out_w - param.crop_w * 0.5f;
+    const float dv = (y + 0.5f) * param.crop_h / out_h - param.crop_h * 0.5f;
+    // the center of the crop box in pixel coordinates
+    const float cx = param.crop_x + param.crop_w * 0.5f - 0.5f;
+    const float cy = param.crop_y + param.crop_h * 0.5f - 0.5f;
+    const float sx = param.cos_a * du - param.sin_a * dv + cx;
+    const float sy = param.sin_a * du + param.cos_a * dv + cy;
+    const uint8_t* image = in_dptr + static_cast<int64_t>(n) * max_h * max_w * C;
+    float val[3];
+    Sample<C, interpolation>(image, max_w, param.in_h, param.in_w, sy, sx, val);
+#pragma unroll
+    for (int c = 0; c < C; ++c) { val[c] = Clamp255(val[c]); }
+    if (C == 3) {
+      float rgb[3];
+      rgb[0] = val[attr.is_bgr ? 2 : 0];
+      rgb[1] = val[1];
+      rgb[2] = val[attr.is_bgr ? 0 : 2];
+      JitterColor(param, attr, rgb);
+      val[attr.is_bgr ? 2 : 0] = rgb[0];
+      val[1] = rgb[1];
+      val[attr.is_bgr ? 0 : 2] = rgb[2];
+    } else if (attr.brightness > 0) {
+      val[0] = Clamp255(val[0] * param.brightness);
+    }
+#pragma unroll
+    for (int c = 0; c < C; ++c) {
+      const float out = (val[c] - attr.mean.val[c]) * attr.inv_std.val[c];
+      if (nchw) {
+        out_dptr[((static_cast<int64_t>(n) * C + c) * out_h + y) * out_w + x] = out;
+      } else {
+        out_dptr[static_cast<int64_t>(i) * C + c] = out;
+      }
+    }
+  }
+}
+
+template<int C, InterpolationType interpolation>
+void LaunchImageAugment(ep::Stream* stream, bool nchw, int32_t elem_cnt, const uint8_t* in_dptr,
+                        int32_t max_h, int32_t max_w, const AugmentParam* params,
+                        const AugmentAttr& attr, int32_t out_h, int32_t out_w, float* out_dptr) {
+  cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+  if (nchw) {
+    ImageAugmentGpu<C, interpolation, true>
+        <<<BlocksNum4ThreadsNum(elem_cnt), kCudaThreadsNumPerBlock, 0, cuda_stream>>>(
+            elem_cnt, in_dptr, max_h, max_w, params, attr, out_h, out_w, out_dptr);
+  } else {
+    ImageAugmentGpu<C, interpolation, false>
+        <<<BlocksNum4ThreadsNum(elem_cnt), kCudaThreadsNumPerBlock, 0, cuda_stream>>>(
+            elem_cnt, in_dptr, max_h, max_w, params, attr, out_h, out_w, out_dptr);
+  }
+}
+
+template<int C>
+void DispatchInterpolation(ep::Stream* stream, InterpolationType interpolation, bool nchw,
+                           int32_t elem_cnt, const uint8_t* in_dptr, int32_t max_h, int32_t max_w,
+                           const AugmentParam* params, const AugmentAttr& attr, int32_t out_h,
+                           int32_t out_w, float* out_dptr) {
+  if (interpolation == InterpolationType::kNearest) {
+    LaunchImageAugment<C, InterpolationType::kNearest>(stream, nchw, elem_cnt, in_dptr, max_h,
+                                                       max_w, params, attr, out_h, out_w,
+                                                       out_dptr);
+  } else if (interpolation == InterpolationType::kBilinear) {
+    LaunchImageAugment<C, InterpolationType::kBilinear>(stream, nchw, elem_cnt, in_dptr, max_h,
+                                                        max_w, params, attr, out_h, out_w,
+                                                        out_dptr);
+  } else {
+    LaunchImageAugment<C, InterpolationType::kBicubic>(stream, nchw, elem_cnt, in_dptr, max_h,
+                                                       max_w, params, attr, out_h, out_w,
+                                                       out_dptr);
+  }
+}
+
+ChannelVal GetChannelVal(const std::vector<float>& values, bool inverse) {
+  ChannelVal ret;
+  for (int i = 0; i < 3; ++i) {
+    const float val = values.size() == 1 ? values.at(0) : values.at(i);
+    ret.val[i] = inverse ? 1.0f / val : val;
+  }
+  return ret;
+}
+
+}  // namespace
+
+class ImageAugmentGpuKernel final : public user_op::OpKernel {
+ public:
+  ImageAugmentGpuKernel() = default;
+  ~ImageAugmentGpuKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    int64_t seed = ctx->Attr<int64_t>("seed");
+    if (seed == -1) { seed = NewRandomSeed(); }
+    return std::make_shared<ImageAugmentKernelState>(seed);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* augment_state = dynamic_cast<ImageAugmentKernelState*>(state);
+    CHECK_NOTNULL(augment_state);
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t N = in->shape().At(0);
+    if (N == 0) { return; }
+    const int32_t max_h = in->shape().At(1);
+    const int32_t max_w = in->shape().At(2);
+    const int32_t C = in->shape().At(3);
+    const int32_t out_h = ctx->Attr<int64_t>("target_height");
+    const int32_t out_w = ctx->Attr<int64_t>("target_width");
+    const int64_t elem_cnt = static_cast<int64_t>(N) * out_h * out_w;
+    CHECK_LE(elem_cnt, GetMaxVal<int32_t>());
+    const int32_t* in_size_dptr = nullptr;
+    if (ctx->has_input("in_size", 0)) {
+      in_size_dptr = ctx->Tensor4ArgNameAndIndex("in_size", 0)->dptr<int32_t>();
+    }
+
+    AugmentAttr attr{};
+    const auto& random_area = ctx->Attr<std::vector<float>>("random_area");
+    const auto& random_aspect_ratio = ctx->Attr<std::vector<float>>("random_aspect_ratio");
+    attr.area_min = random_area.at(0);
+    attr.area_max = random_area.at(1);
+    attr.log_ratio_min = std::log(random_aspect_ratio.at(0));
+    attr.log_ratio_max = std::log(random_aspect_ratio.at(1));
+    attr.flip_prob = ctx->Attr<float>("flip_prob");
+    attr.rotate_radians = ctx->Attr<float>("rotate_degrees") * kPi / 180;
+    attr.brightness = ctx->Attr<float>("brightness");
+    attr.contrast = ctx->Attr<float>("contrast");
+    attr.saturation = ctx->Attr<float>("saturation");
+    attr.hue = ctx->Attr<float>("hue");
+    attr.is_bgr = ctx->Attr<std::string>("color_space") == "BGR";
+    attr.mean = GetChannelVal(ctx->Attr<std::vector<float>>("mean"), false);
+    attr.inv_std = GetChannelVal(ctx->Attr<std::vector<float>>("std"), true);
+
+    const std::string& interpolation_type = ctx->Attr<std::string>("interpolation_type");
+    InterpolationType interpolation = InterpolationType::kBilinear;
+    if (interpolation_type == "nearest") {
+      interpolation = InterpolationType::kNearest;
+    } else if (interpolation_type == "bicubic") {
+      interpolation = InterpolationType::kBicubic;
+    }
+    const bool nchw = ctx->Attr<std::string>("output_layout") == "NCHW";
+
+    auto* params = reinterpret_cast<AugmentParam*>(tmp_buffer->mut_dptr());
+    const uint64_t step = augment_state->NextStep();
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    if (C == 3) {
+      GenAugmentParamsGpu<3><<<N, kCudaThreadsNumPerBlock, 0, cuda_stream>>>(
+          in->dptr<uint8_t>(), in_size_dptr, max_h, max_w, attr, augment_state->seed(), step,
+          params);
+      DispatchInterpolation<3>(ctx->stream(), interpolation, nchw, elem_cnt, in->dptr<uint8_t>(),
+                               max_h, max_w, params, attr, out_h, out_w, out->mut_dptr<float>());
+    } else if (C == 1) {
+      GenAugmentParamsGpu<1><<<N, kCudaThreadsNumPerBlock, 0, cuda_stream>>>(
+          in->dptr<uint8_t>(), in_size_dptr, max_h, max_w, attr, augment_state->seed(), step,
+          params);
+      DispatchInterpolation<1>(ctx->stream(), interpolation, nchw, elem_cnt, in->dptr<uint8_t>(),
+                               max_h, max_w, params, attr, out_h, out_w, out->mut_dptr<float>());
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("image_augment")
+    .SetCreateFn<ImageAugmentGpuKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)
+                     && (user_op::HobDataType("in", 0) == DataType::kUInt8)
+                     && (user_op::HobDataType("out", 0) == DataType::kFloat))
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) {
+      const Shape& in_shape = ctx->InputShape("in", 0);
+      return GetCudaAlignedSize(in_shape.At(0) * sizeof(AugmentParam));
+    });
+
+}  // namespace oneflow
@@ -14,9 +14,175 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_vectorized.h"
 
 namespace oneflow {
 
+namespace {
+
+template<typename T>
+struct LayerNormForwardParams {
+  int64_t norm_size;
+  T epsilon;
+  const T* x;
+  const T* gamma;
+  const T* beta;
+  T* y;
+  T* mean;
+  T* inv_variance;
+};
+
+template<typename T>
+struct LayerNormForwardRowsFunctor {
+  template<ep::CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end,
+                                   const LayerNormForwardParams<T>& params) {
+    constexpr int kLanes = ep::VectorizedLanes<T, isa>::value;
+    const int64_t norm_size = params.norm_size;
+    const T* gamma = params.gamma;
+    const T* beta = params.beta;
+    for (int64_t i = begin; i < end; ++i) {
+      const T* row_x = params.x + i * norm_size;
+      T* row_y = params.y + i * norm_size;
+      const T row_mean = ep::VectorizedRowSum<T, kLanes>(row_x, norm_size) / norm_size;
+      const T row_variance =
+          ep::VectorizedRowSquaredDeviationSum<T, kLanes>(row_x, norm_size, row_mean) / norm_size;
+      const T row_inv_variance = static_cast<T>(1) / std::sqrt(row_variance + params.epsilon);
+      params.mean[i] = row_mean;
+      params.inv_variance[i] = row_inv_variance;
+      if (gamma != nullptr && beta != nullptr) {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          row_y[j] = (row_x[j] - row_mean) * row_inv_variance * gamma[j] + beta[j];
+        }
+      } else if (gamma != nullptr) {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          row_y[j] = (row_x[j] - row_mean) * row_inv_variance * gamma[j];
+        }
+      } else if (beta != nullptr) {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          row_y[j] = (row_x[j] - row_mean) * row_inv_variance + beta[j];
+        }
+      } else {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          row_y[j] = (row_x[j] - row_mean) * row_inv_variance;
+        }
+      }
+    }
+  }
+};
+
+template<typename T>
+struct LayerNormBackwardParams {
+  int64_t norm_size;
+  const T* dy;
+  const T* x;
+  const T* mean;
+  const T* inv_variance;
+  const T* gamma;
+  const T* add_to_output;
+  T* dx;
+};
+
+// dx = inv_variance * (g - mean(g) - x_hat * mean(g * x_hat)) with g = dy * gamma. The two row
+// sums are taken over blocks staged in stack buffers, so the element wise loops stay plain and
+// the sums use the vectorized reduction.
+template<typename T>
+struct LayerNormBackwardRowsFunctor {
+  template<ep::CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end,
+                                   const LayerNormBackwardParams<T>& params) {
+    constexpr int kLanes = ep::VectorizedLanes<T, isa>::value;
+    constexpr int64_t kBlockSize = 256;
+    T g_buf[kBlockSize];
+    T g_x_hat_buf[kBlockSize];
+    const int64_t norm_size = params.norm_size;
+    const T* gamma = params.gamma;
+    for (int64_t i = begin; i < end; ++i) {
+      const T* row_dy = params.dy + i * norm_size;
+      const T* row_x = params.x + i * norm_size;
+      T* row_dx = params.dx + i * norm_size;
+      const T row_mean = params.mean[i];
+      const T row_inv_variance = params.inv_variance[i];
+      T sum_g = 0;
+      T sum_g_x_hat = 0;
+      for (int64_t j = 0; j < norm_size; j += kBlockSize) {
+        const int64_t block_size = std::min(kBlockSize, norm_size - j);
+        if (gamma != nullptr) {
+          for (int64_t k = 0; k < block_size; ++k) { g_buf[k] = row_dy[j + k] * gamma[j + k]; }
+        } else {
+          for (int64_t k = 0; k < block_size; ++k) { g_buf[k] = row_dy[j + k]; }
+        }
+        for (int64_t k = 0; k < block_size; ++k) {
+          g_x_hat_buf[k] = g_buf[k] * (row_x[j + k] - row_mean) * row_inv_variance;
+        }
+        sum_g += ep::VectorizedRowSum<T, kLanes>(g_buf, block_size);
+        sum_g_x_hat += ep::VectorizedRowSum<T, kLanes>(g_x_hat_buf, block_size);
+      }
+      const T mean_g = sum_g / norm_size;
+      const T mean_g_x_hat = sum_g_x_hat / norm_size;
+      if (gamma != nullptr) {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          const T x_hat = (row_x[j] - row_mean) * row_inv_variance;
+          row_dx[j] = (row_dy[j] * gamma[j] - mean_g - x_hat * mean_g_x_hat) * row_inv_variance;
+        }
+      } else {
+        for (int64_t j = 0; j < norm_size; ++j) {
+          const T x_hat = (row_x[j] - row_mean) * row_inv_variance;
+          row_dx[j] = (row_dy[j] - mean_g - x_hat * mean_g_x_hat) * row_inv_variance;
+        }
+      }
+      if (params.add_to_output != nullptr) {
+        const T* row_add_to_output = params.add_to_output + i * norm_size;
+        for (int64_t j = 0; j < norm_size; ++j) { row_dx[j] += row_add_to_output[j]; }
+      }
+    }
+  }
+};
+
+template<typename T>
+struct LayerNormParamGradParams {
+  int64_t num_instances;
+  int64_t norm_size;
+  const T* dy;
+  const T* x;
+  const T* mean;
+  const T* inv_variance;
+  T* gamma_diff;
+  T* beta_diff;
+};
+
+// Sums dy * x_hat and dy over the rows for the columns in [begin, end). Each column is owned by
+// one thread and accumulated in row order, so the result does not depend on the thread count.
+template<typename T>
+struct LayerNormParamGradColsFunctor {
+  template<ep::CpuIsa isa>
+  static ALWAYS_INLINE void Invoke(int64_t begin, int64_t end,
+                                   const LayerNormParamGradParams<T>& params) {
+    const int64_t norm_size = params.norm_size;
+    T* gamma_diff = params.gamma_diff;
+    T* beta_diff = params.beta_diff;
+    if (gamma_diff != nullptr) { std::fill(gamma_diff + begin, gamma_diff + end, 0); }
+    if (beta_diff != nullptr) { std::fill(beta_diff + begin, beta_diff + end, 0); }
+    for (int64_t i = 0; i < params.num_instances; ++i) {
+      const T* row_dy = params.dy + i * norm_size;
+      const T* row_x = params.x + i * norm_size;
+      const T row_mean = params.mean[i];
+      const T row_inv_variance = params.inv_variance[i];
+      if (gamma_diff != nullptr) {
+        for (int64_t j = begin; j < end; ++j) {
+          gamma_diff[j] += row_dy[j] * (row_x[j] - row_mean) * row_inv_variance;
+        }
+      }
+      if (beta_diff != nullptr) {
+        for (int64_t j = begin; j < end; ++j) { beta_diff[j] += row_dy[j]; }
+      }
+    }
+  }
+};
+
+}  // namespace
+
 template<typename T>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
@@ -25,7 +191,42 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    LayerNormForwardParams<T> params;
+    params.norm_size = x->shape().elem_cnt() / num_instances;
+    params.epsilon = static_cast<T>(epsilon);
+    params.x = x->dptr<T>();
+    params.gamma = nullptr;
+    params.beta = nullptr;
+    params.y = y->mut_dptr<T>();
+    params.mean = mean->mut_dptr<T>();
+    params.inv_variance = inv_variance->mut_dptr<T>();
+    if (ctx->has_input("gamma", 0)) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      params.gamma = gamma->dptr<T>();
+      CHECK_EQ(gamma->shape().elem_cnt(), params.norm_size);
+    }
+    if (ctx->has_input("beta", 0)) {
+      params.beta = ctx->Tensor4ArgNameAndIndex("beta", 0)->dptr<T>();
+    }
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const ep::CpuIsa isa = static_cast<ep::CpuDevice*>(cpu_stream->device())->isa();
+    const size_t grain_size = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.norm_size));
+    cpu_stream->ParallelFor(
+        0, num_instances,
+        [&](int64_t begin, int64_t end) {
+          ep::CpuIsaInvoke<LayerNormForwardRowsFunctor<T>>(isa, begin, end, params);
+        },
+        grain_size);
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
@@ -45,7 +246,42 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    LayerNormBackwardParams<T> params;
+    params.norm_size = x->shape().elem_cnt() / num_instances;
+    params.dy = dy->dptr<T>();
+    params.x = x->dptr<T>();
+    params.mean = mean->dptr<T>();
+    params.inv_variance = inv_variance->dptr<T>();
+    params.gamma = nullptr;
+    params.add_to_output = nullptr;
+    params.dx = dx->mut_dptr<T>();
+    if (ctx->has_input("gamma", 0)) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      params.gamma = gamma->dptr<T>();
+      CHECK_EQ(gamma->shape().elem_cnt(), params.norm_size);
+    }
+    if (ctx->has_input("_add_to_output", 0)) {
+      params.add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0)->dptr<T>();
+    }
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const ep::CpuIsa isa = static_cast<ep::CpuDevice*>(cpu_stream->device())->isa();
+    const size_t grain_size = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, params.norm_size));
+    cpu_stream->ParallelFor(
+        0, num_instances,
+        [&](int64_t begin, int64_t end) {
+          ep::CpuIsaInvoke<LayerNormBackwardRowsFunctor<T>>(isa, begin, end, params);
+        },
+        grain_size);
+  };
 };
 
 #define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
@@ -65,7 +301,47 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    LayerNormParamGradParams<T> params;
+    params.num_instances = num_instances;
+    params.norm_size = num_instances == 0 ? 0 : x->shape().elem_cnt() / num_instances;
+    params.dy = dy->dptr<T>();
+    params.x = x->dptr<T>();
+    params.mean = mean->dptr<T>();
+    params.inv_variance = inv_variance->dptr<T>();
+    params.gamma_diff = nullptr;
+    params.beta_diff = nullptr;
+    if (ctx->has_output("gamma_diff", 0)) {
+      user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+      params.gamma_diff = gamma_diff->mut_dptr<T>();
+      if (num_instances == 0) {
+        std::fill(params.gamma_diff, params.gamma_diff + gamma_diff->shape().elem_cnt(), 0);
+      }
+    }
+    if (ctx->has_output("beta_diff", 0)) {
+      user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+      params.beta_diff = beta_diff->mut_dptr<T>();
+      if (num_instances == 0) {
+        std::fill(params.beta_diff, params.beta_diff + beta_diff->shape().elem_cnt(), 0);
+      }
+    }
+    if (num_instances == 0) { return; }
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const ep::CpuIsa isa = static_cast<ep::CpuDevice*>(cpu_stream->device())->isa();
+    const size_t grain_size = std::max<int64_t>(
+        1, ep::CpuStream::kParallelForDefaultGrain / std::max<int64_t>(1, num_instances));
+    cpu_stream->ParallelFor(
+        0, params.norm_size,
+        [&](int64_t begin, int64_t end) {
+          ep::CpuIsaInvoke<LayerNormParamGradColsFunctor<T>>(isa, begin, end, params);
+        },
+        grain_size);
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
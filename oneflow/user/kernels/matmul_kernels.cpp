@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 #include "oneflow/core/ep/include/primitive/matmul.h"
 #include "oneflow/core/ep/include/primitive/batch_matmul.h"
+#include "oneflow/core/ep/include/primitive/fused_matmul_bias.h"
 
 namespace oneflow {
 
@@ -350,6 +351,75 @@ REGISTER_USER_KERNEL("broadcast_matmul_grad_b")
       return Maybe<void>::Ok();
     });
 
+ep::primitive::MatmulEpilogue GetMatmulEpilogue(const std::string& activation) {
+  if (activation == "none") {
+    return ep::primitive::MatmulEpilogue::kBias;
+  } else if (activation == "relu") {
+    return ep::primitive::MatmulEpilogue::kBiasRelu;
+  } else if (activation == "gelu") {
+    return ep::primitive::MatmulEpilogue::kBiasGelu;
+  } else {
+    UNIMPLEMENTED();
+    return ep::primitive::MatmulEpilogue::kBias;
+  }
+}
+
+template<typename Context>
+std::unique_ptr<ep::primitive::FusedMatmulBias> NewFusedMatmulBiasPrimitive(Context* ctx) {
+  const DataType data_type = ctx->TensorDesc4ArgNameAndIndex("out", 0)->data_type();
+  const auto trans_a = GetBlasTransposeType(ctx, "transpose_a");
+  const auto trans_b = GetBlasTransposeType(ctx, "transpose_b");
+  const auto epilogue = GetMatmulEpilogue(ctx->template Attr<std::string>("activation"));
+  return ep::primitive::NewPrimitive<ep::primitive::FusedMatmulBiasFactory>(
+      ctx->device_type(), data_type, trans_a, trans_b, epilogue);
+}
+
+auto FusedMatmulBiasPrimitiveExists() {
+  return hob::make_custom("FusedMatmulBiasPrimitiveExists",
+                          [](const user_op::KernelRegContext& ctx) {
+                            return NewFusedMatmulBiasPrimitive(&ctx).operator bool();
+                          });
+}
+
+class FusedMatmulBiasKernel final : public user_op::OpKernel, public user_op::CudaGraphSupport {
+ public:
+  FusedMatmulBiasKernel() = default;
+  ~FusedMatmulBiasKernel() = default;
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto trans_a = GetBlasTransposeType(ctx, "transpose_a");
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int64_t num_a_axes = a->shape().NumAxes();
+    // The leading axes of a fold into m, a transposed a is 2-D.
+    int64_t m = 0;
+    int64_t k = 0;
+    if (trans_a == ep::primitive::BlasTransposeType::T) {
+      CHECK_EQ(num_a_axes, 2);
+      m = a->shape().At(1);
+      k = a->shape().At(0);
+    } else {
+      m = a->shape().Count(0, num_a_axes - 1);
+      k = a->shape().At(num_a_axes - 1);
+    }
+    const int64_t n = bias->shape().At(0);
+    CHECK_EQ(out->shape().elem_cnt(), m * n);
+    auto fused_matmul_bias = NewFusedMatmulBiasPrimitive(ctx);
+    CHECK(fused_matmul_bias);
+    fused_matmul_bias->Launch(ctx->stream(), m, n, k, ctx->Attr<double>("alpha"), a->dptr(),
+                              b->dptr(), bias->dptr(), 0.0, out->mut_dptr());
+  }
+};
+
+REGISTER_USER_KERNEL("fused_matmul_bias")
+    .SetCreateFn<FusedMatmulBiasKernel>()
+    .SetIsMatchedHob(FusedMatmulBiasPrimitiveExists());
+
 }  // namespace
 
 }  // namespace oneflow
@@ -0,0 +1,184 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/moe_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+const user_op::Tensor* OptionalInput(user_op::KernelComputeContext* ctx, const std::string& name) {
+  return ctx->has_input(name, 0) ? ctx->Tensor4ArgNameAndIndex(name, 0) : nullptr;
+}
+
+template<typename T>
+const T* OptionalDptr(const user_op::Tensor* tensor) {
+  return tensor == nullptr ? nullptr : tensor->dptr<T>();
+}
+
+}  // namespace
+
+template<DeviceType device_type, typename T>
+class MoeGatingKernel final : public user_op::OpKernel {
+ public:
+  MoeGatingKernel() = default;
+  ~MoeGatingKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* logits = ctx->Tensor4ArgNameAndIndex("logits", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    MoeGatingKernelUtil<device_type, T>::Forward(
+        ctx->stream(), logits->shape().At(0), logits->shape().At(1), ctx->Attr<int64_t>("top_k"),
+        ctx->Attr<int64_t>("capacity"), logits->dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("expert_indices", 0)->mut_dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("locations", 0)->mut_dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("gates", 0)->mut_dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("probs", 0)->mut_dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("aux_loss", 0)->mut_dptr<T>(), tmp_buffer->mut_dptr());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class MoeGatingGradKernel final : public user_op::OpKernel {
+ public:
+  MoeGatingGradKernel() = default;
+  ~MoeGatingGradKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* probs = ctx->Tensor4ArgNameAndIndex("probs", 0);
+    const user_op::Tensor* expert_indices = ctx->Tensor4ArgNameAndIndex("expert_indices", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    MoeGatingKernelUtil<device_type, T>::Backward(
+        ctx->stream(), probs->shape().At(0), probs->shape().At(1), expert_indices->shape().At(1),
+        probs->dptr<T>(), expert_indices->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("gates", 0)->dptr<T>(),
+        OptionalDptr<T>(OptionalInput(ctx, "gates_grad")),
+        OptionalDptr<T>(OptionalInput(ctx, "aux_loss_grad")),
+        ctx->Tensor4ArgNameAndIndex("logits_grad", 0)->mut_dptr<T>(), tmp_buffer->mut_dptr());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class MoeDispatchKernel final : public user_op::OpKernel {
+ public:
+  MoeDispatchKernel() = default;
+  ~MoeDispatchKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* expert_indices = ctx->Tensor4ArgNameAndIndex("expert_indices", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    if (out->shape().elem_cnt() == 0) { return; }
+    MoeDispatchKernelUtil<device_type, T>::Dispatch(
+        ctx->stream(), in->shape().At(0), expert_indices->shape().At(1), out->shape().At(0),
+        out->shape().At(1), out->shape().At(2), in->dptr<T>(), expert_indices->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("locations", 0)->dptr<int32_t>(),
+        OptionalDptr<T>(OptionalInput(ctx, "gates")), out->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class MoeCombineKernel final : public user_op::OpKernel {
+ public:
+  MoeCombineKernel() = default;
+  ~MoeCombineKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* expert_indices = ctx->Tensor4ArgNameAndIndex("expert_indices", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    if (out->shape().elem_cnt() == 0) { return; }
+    MoeDispatchKernelUtil<device_type, T>::Combine(
+        ctx->stream(), out->shape().At(0), expert_indices->shape().At(1), in->shape().At(0),
+        in->shape().At(1), in->shape().At(2), in->dptr<T>(), expert_indices->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("locations", 0)->dptr<int32_t>(),
+        OptionalDptr<T>(OptionalInput(ctx, "gates")), out->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class MoeGatesGradKernel final : public user_op::OpKernel {
+ public:
+  MoeGatesGradKernel() = default;
+  ~MoeGatesGradKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* tokens = ctx->Tensor4ArgNameAndIndex("tokens", 0);
+    const user_op::Tensor* expert_buffer = ctx->Tensor4ArgNameAndIndex("expert_buffer", 0);
+    const user_op::Tensor* expert_indices = ctx->Tensor4ArgNameAndIndex("expert_indices", 0);
+    user_op::Tensor* gates_grad = ctx->Tensor4ArgNameAndIndex("gates_grad", 0);
+    if (gates_grad->shape().elem_cnt() == 0) { return; }
+    MoeDispatchKernelUtil<device_type, T>::GatesGrad(
+        ctx->stream(), tokens->shape().At(0), expert_indices->shape().At(1),
+        expert_buffer->shape().At(0), expert_buffer->shape().At(1), expert_buffer->shape().At(2),
+        tokens->dptr<T>(), expert_buffer->dptr<T>(), expert_indices->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("locations", 0)->dptr<int32_t>(), gates_grad->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_MOE_GATING_KERNELS(device, dtype_pair)                                          \
+  REGISTER_USER_KERNEL("moe_gating")                                                             \
+      .SetCreateFn<MoeGatingKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                      \
+                       && (user_op::HobDataType("logits", 0) == OF_PP_PAIR_SECOND(dtype_pair)))  \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        return GetMoeGatingWorkspaceSize(ctx->InputShape("logits", 0).At(1));                    \
+      });                                                                                        \
+  REGISTER_USER_KERNEL("moe_gating_grad")                                                        \
+      .SetCreateFn<MoeGatingGradKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()                  \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                      \
+                       && (user_op::HobDataType("probs", 0) == OF_PP_PAIR_SECOND(dtype_pair)))   \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        return GetMoeGatingWorkspaceSize(ctx->InputShape("probs", 0).At(1));                     \
+      });
+
+#define REGISTER_MOE_DISPATCH_KERNELS(device, dtype_pair)                                       \
+  REGISTER_USER_KERNEL("moe_dispatch")                                                          \
+      .SetCreateFn<MoeDispatchKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("in", 0) == OF_PP_PAIR_SECOND(dtype_pair)));    \
+  REGISTER_USER_KERNEL("moe_combine")                                                           \
+      .SetCreateFn<MoeCombineKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("in", 0) == OF_PP_PAIR_SECOND(dtype_pair)));    \
+  REGISTER_USER_KERNEL("moe_gates_grad")                                                        \
+      .SetCreateFn<MoeGatesGradKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()                  \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("tokens", 0) == OF_PP_PAIR_SECOND(dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_MOE_GATING_KERNELS, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ)
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_MOE_DISPATCH_KERNELS, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_MOE_GATING_KERNELS, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ)
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_MOE_DISPATCH_KERNELS, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,179 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/moe_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+template<typename T>
+struct MoeGatingKernelUtil<DeviceType::kCPU, T> {
+  static void Forward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                      int64_t capacity, const T* logits, int32_t* expert_indices,
+                      int32_t* locations, T* gates, T* probs, T* aux_loss, void* workspace) {
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens, [&](int64_t begin, int64_t end) {
+      for (int64_t t = begin; t < end; ++t) {
+        const T* row = logits + t * num_experts;
+        T* prob_row = probs + t * num_experts;
+        const T max_val = *std::max_element(row, row + num_experts);
+        T sum = 0;
+        for (int64_t e = 0; e < num_experts; ++e) {
+          prob_row[e] = std::exp(row[e] - max_val);
+          sum += prob_row[e];
+        }
+        for (int64_t e = 0; e < num_experts; ++e) { prob_row[e] /= sum; }
+        int32_t* chosen = expert_indices + t * top_k;
+        T chosen_prob_sum = 0;
+        for (int64_t j = 0; j < top_k; ++j) {
+          int32_t best = -1;
+          for (int64_t e = 0; e < num_experts; ++e) {
+            if (std::find(chosen, chosen + j, e) != chosen + j) { continue; }
+            if (best < 0 || prob_row[e] > prob_row[best]) { best = e; }
+          }
+          chosen[j] = best;
+          gates[t * top_k + j] = prob_row[best];
+          chosen_prob_sum += prob_row[best];
+        }
+        if (top_k > 1) {
+          for (int64_t j = 0; j < top_k; ++j) { gates[t * top_k + j] /= chosen_prob_sum; }
+        }
+      }
+    });
+    std::vector<int64_t> expert_offsets(num_experts, 0);
+    for (int64_t j = 0; j < top_k; ++j) {
+      for (int64_t t = 0; t < num_tokens; ++t) {
+        const int64_t location = expert_offsets[expert_indices[t * top_k + j]]++;
+        locations[t * top_k + j] = location < capacity ? static_cast<int32_t>(location) : -1;
+      }
+    }
+    T* top1_counts = static_cast<T*>(workspace);
+    std::fill(top1_counts, top1_counts + num_experts, static_cast<T>(0));
+    for (int64_t t = 0; t < num_tokens; ++t) { top1_counts[expert_indices[t * top_k]] += 1; }
+    T loss = 0;
+    for (int64_t e = 0; e < num_experts; ++e) {
+      T prob_sum = 0;
+      for (int64_t t = 0; t < num_tokens; ++t) { prob_sum += probs[t * num_experts + e]; }
+      loss += top1_counts[e] * prob_sum;
+    }
+    *aux_loss = num_tokens > 0 ? loss * num_experts / (num_tokens * num_tokens) : 0;
+  }
+
+  static void Backward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                       const T* probs, const int32_t* expert_indices, const T* gates,
+                       const T* gates_grad, const T* aux_loss_grad, T* logits_grad,
+                       void* workspace) {
+    int32_t* top1_counts = static_cast<int32_t*>(workspace);
+    std::fill(top1_counts, top1_counts + num_experts, 0);
+    T aux_scale = 0;
+    if (aux_loss_grad != nullptr && num_tokens > 0) {
+      for (int64_t t = 0; t < num_tokens; ++t) { top1_counts[expert_indices[t * top_k]] += 1; }
+      aux_scale = *aux_loss_grad * num_experts / (num_tokens * num_tokens);
+    }
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens, [&](int64_t begin, int64_t end) {
+      for (int64_t t = begin; t < end; ++t) {
+        const T* prob_row = probs + t * num_experts;
+        const int32_t* chosen = expert_indices + t * top_k;
+        const T* token_gates_grad = gates_grad == nullptr ? nullptr : gates_grad + t * top_k;
+        T gates_grad_dot = 0;
+        T chosen_prob_sum = 0;
+        for (int64_t j = 0; j < top_k; ++j) {
+          if (token_gates_grad != nullptr) {
+            gates_grad_dot += token_gates_grad[j] * gates[t * top_k + j];
+          }
+          chosen_prob_sum += prob_row[chosen[j]];
+        }
+        T dot = 0;
+        for (int64_t e = 0; e < num_experts; ++e) {
+          dot += prob_row[e]
+                 * MoeGatingProbGrad(e, top_k, chosen, token_gates_grad, gates_grad_dot,
+                                     chosen_prob_sum, aux_scale, top1_counts);
+        }
+        for (int64_t e = 0; e < num_experts; ++e) {
+          const T prob_grad = MoeGatingProbGrad(e, top_k, chosen, token_gates_grad,
+                                                gates_grad_dot, chosen_prob_sum, aux_scale,
+                                                top1_counts);
+          logits_grad[t * num_experts + e] = prob_row[e] * (prob_grad - dot);
+        }
+      }
+    });
+  }
+};
+
+template<typename T>
+struct MoeDispatchKernelUtil<DeviceType::kCPU, T> {
+  static void Dispatch(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                       int64_t capacity, int64_t hidden_size, const T* tokens,
+                       const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                       T* expert_buffer) {
+    std::fill(expert_buffer, expert_buffer + num_experts * capacity * hidden_size,
+              static_cast<T>(0));
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens * top_k, [&](int64_t begin,
+                                                                         int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        if (locations[i] < 0) { continue; }
+        const T gate = gates == nullptr ? static_cast<T>(1) : gates[i];
+        const T* src = tokens + (i / top_k) * hidden_size;
+        T* dst = expert_buffer + (expert_indices[i] * capacity + locations[i]) * hidden_size;
+        for (int64_t h = 0; h < hidden_size; ++h) { dst[h] = src[h] * gate; }
+      }
+    });
+  }
+
+  static void Combine(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                      int64_t capacity, int64_t hidden_size, const T* expert_buffer,
+                      const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                      T* tokens) {
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens, [&](int64_t begin, int64_t end) {
+      for (int64_t t = begin; t < end; ++t) {
+        T* dst = tokens + t * hidden_size;
+        std::fill(dst, dst + hidden_size, static_cast<T>(0));
+        for (int64_t j = 0; j < top_k; ++j) {
+          const int64_t i = t * top_k + j;
+          if (locations[i] < 0) { continue; }
+          const T gate = gates == nullptr ? static_cast<T>(1) : gates[i];
+          const T* src =
+              expert_buffer + (expert_indices[i] * capacity + locations[i]) * hidden_size;
+          for (int64_t h = 0; h < hidden_size; ++h) { dst[h] += src[h] * gate; }
+        }
+      }
+    });
+  }
+
+  static void GatesGrad(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                        int64_t capacity, int64_t hidden_size, const T* tokens,
+                        const T* expert_buffer, const int32_t* expert_indices,
+                        const int32_t* locations, T* gates_grad) {
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens * top_k, [&](int64_t begin,
+                                                                         int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        T dot = 0;
+        if (locations[i] >= 0) {
+          const T* token = tokens + (i / top_k) * hidden_size;
+          const T* slot =
+              expert_buffer + (expert_indices[i] * capacity + locations[i]) * hidden_size;
+          for (int64_t h = 0; h < hidden_size; ++h) { dot += token[h] * slot[h]; }
+        }
+        gates_grad[i] = dot;
+      }
+    });
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_MOE_GATING_KERNEL_UTIL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ);
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_MOE_DISPATCH_KERNEL_UTIL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
@@ -0,0 +1,382 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/moe_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <cub/cub.cuh>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kMoeWarpsPerBlock = 4;
+constexpr int kMoeBlockSize = 256;
+
+template<typename T>
+__device__ T WarpAllReduceSum(T val) {
+  for (int mask = kCudaWarpSize / 2; mask > 0; mask /= 2) {
+    val += __shfl_xor_sync(0xffffffff, val, mask);
+  }
+  return val;
+}
+
+template<typename T>
+__device__ T WarpAllReduceMax(T val) {
+  for (int mask = kCudaWarpSize / 2; mask > 0; mask /= 2) {
+    val = max(val, __shfl_xor_sync(0xffffffff, val, mask));
+  }
+  return val;
+}
+
+// Ties go to the smaller expert id, the same as the CPU kernel.
+template<typename T>
+__device__ void WarpAllReduceArgMax(T* prob, int32_t* expert) {
+  for (int mask = kCudaWarpSize / 2; mask > 0; mask /= 2) {
+    const T other_prob = __shfl_xor_sync(0xffffffff, *prob, mask);
+    const int32_t other_expert = __shfl_xor_sync(0xffffffff, *expert, mask);
+    if (other_expert >= 0
+        && (*expert < 0 || other_prob > *prob || (other_prob == *prob && other_expert < *expert))) {
+      *prob = other_prob;
+      *expert = other_expert;
+    }
+  }
+}
+
+int GetNumWarpBlocks(int64_t num_warps) {
+  return static_cast<int>(std::min<int64_t>(
+      (num_warps + kMoeWarpsPerBlock - 1) / kMoeWarpsPerBlock, kCudaMaxBlocksNum));
+}
+
+// One warp per token computes the softmax and picks the top_k experts.
+template<typename T>
+__global__ void MoeSoftmaxTopKGpu(int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                                  const T* logits, int32_t* expert_indices, T* gates, T* probs) {
+  const int lane = threadIdx.x % kCudaWarpSize;
+  const int64_t num_warps = static_cast<int64_t>(gridDim.x) * blockDim.x / kCudaWarpSize;
+  for (int64_t t = (static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kCudaWarpSize;
+       t < num_tokens; t += num_warps) {
+    const T* row = logits + t * num_experts;
+    T* prob_row = probs + t * num_experts;
+    T max_val = -GetMaxVal<T>();
+    for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) { max_val = max(max_val, row[e]); }
+    max_val = WarpAllReduceMax(max_val);
+    T sum = 0;
+    for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) { sum += exp(row[e] - max_val); }
+    sum = WarpAllReduceSum(sum);
+    for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) {
+      prob_row[e] = exp(row[e] - max_val) / sum;
+    }
+    __syncwarp();
+    int32_t chosen[kMoeMaxTopK];
+    T chosen_prob[kMoeMaxTopK];
+    T chosen_prob_sum = 0;
+#pragma unroll
+    for (int j = 0; j < kMoeMaxTopK; ++j) {
+      if (j >= top_k) { break; }
+      T best_prob = 0;
+      int32_t best_expert = -1;
+      for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) {
+        bool taken = false;
+        for (int i = 0; i < j; ++i) { taken |= (chosen[i] == e); }
+        if (taken) { continue; }
+        if (best_expert < 0 || prob_row[e] > best_prob) {
+          best_prob = prob_row[e];
+          best_expert = static_cast<int32_t>(e);
+        }
+      }
+      WarpAllReduceArgMax(&best_prob, &best_expert);
+      chosen[j] = best_expert;
+      chosen_prob[j] = best_prob;
+      chosen_prob_sum += best_prob;
+    }
+    if (lane == 0) {
+      for (int64_t j = 0; j < top_k; ++j) {
+        expert_indices[t * top_k + j] = chosen[j];
+        gates[t * top_k + j] = top_k > 1 ? chosen_prob[j] / chosen_prob_sum : chosen_prob[j];
+      }
+    }
+  }
+}
+
+// One block per expert scans the slots routed to it in priority order, and writes the top-1
+// count times the probability sum of the expert for the load balancing loss.
+template<typename T>
+__global__ void MoeLocationsGpu(int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                                int64_t capacity, const int32_t* expert_indices, const T* probs,
+                                int32_t* locations, T* aux_terms) {
+  typedef cub::BlockScan<int32_t, kMoeBlockSize> BlockScan;
+  typedef cub::BlockReduce<T, kMoeBlockSize> BlockReduce;
+  __shared__ typename BlockScan::TempStorage scan_storage;
+  __shared__ typename BlockReduce::TempStorage reduce_storage;
+  for (int64_t e = blockIdx.x; e < num_experts; e += gridDim.x) {
+    int64_t offset = 0;
+    int64_t num_top1 = 0;
+    for (int64_t j = 0; j < top_k; ++j) {
+      for (int64_t start = 0; start < num_tokens; start += kMoeBlockSize) {
+        const int64_t t = start + threadIdx.x;
+        const int64_t i = t * top_k + j;
+        const bool hit = t < num_tokens && expert_indices[i] == e;
+        int32_t rank = 0;
+        int32_t total = 0;
+        BlockScan(scan_storage).ExclusiveSum(hit ? 1 : 0, rank, total);
+        if (hit) {
+          const int64_t location = offset + rank;
+          locations[i] = location < capacity ? static_cast<int32_t>(location) : -1;
+        }
+        offset += total;
+        if (j == 0) { num_top1 += total; }
+        __syncthreads();
+      }
+    }
+    T prob_sum = 0;
+    for (int64_t t = threadIdx.x; t < num_tokens; t += kMoeBlockSize) {
+      prob_sum += probs[t * num_experts + e];
+    }
+    prob_sum = BlockReduce(reduce_storage).Sum(prob_sum);
+    if (threadIdx.x == 0) { aux_terms[e] = static_cast<T>(num_top1) * prob_sum; }
+    __syncthreads();
+  }
+}
+
+template<typename T>
+__global__ void MoeAuxLossGpu(int64_t num_tokens, int64_t num_experts, const T* aux_terms,
+                              T* aux_loss) {
+  typedef cub::BlockReduce<T, kMoeBlockSize> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage reduce_storage;
+  T sum = 0;
+  for (int64_t e = threadIdx.x; e < num_experts; e += kMoeBlockSize) { sum += aux_terms[e]; }
+  sum = BlockReduce(reduce_storage).Sum(sum);
+  if (threadIdx.x == 0) {
+    *aux_loss = sum * static_cast<T>(num_experts) / static_cast<T>(num_tokens * num_tokens);
+  }
+}
+
+__global__ void MoeCountTop1Gpu(int64_t num_tokens, int64_t top_k, const int32_t* expert_indices,
+                                int32_t* top1_counts) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, t, num_tokens) {
+    atomicAdd(top1_counts + expert_indices[t * top_k], 1);
+  }
+}
+
+template<typename T>
+__global__ void MoeGatingGradGpu(int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                                 const T* probs, const int32_t* expert_indices, const T* gates,
+                                 const T* gates_grad, const T* aux_loss_grad,
+                                 const int32_t* top1_counts, T* logits_grad) {
+  const int lane = threadIdx.x % kCudaWarpSize;
+  const int64_t num_warps = static_cast<int64_t>(gridDim.x) * blockDim.x / kCudaWarpSize;
+  const T aux_scale =
+      aux_loss_grad == nullptr
+          ? static_cast<T>(0)
+          : *aux_loss_grad * static_cast<T>(num_experts) / static_cast<T>(num_tokens * num_tokens);
+  for (int64_t t = (static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kCudaWarpSize;
+       t < num_tokens; t += num_warps) {
+    const T* prob_row = probs + t * num_experts;
+    const int32_t* chosen = expert_indices + t * top_k;
+    const T* token_gates_grad = gates_grad == nullptr ? nullptr : gates_grad + t * top_k;
+    T gates_grad_dot = 0;
+    T chosen_prob_sum = 0;
+    for (int64_t j = 0; j < top_k; ++j) {
+      if (token_gates_grad != nullptr) {
+        gates_grad_dot += token_gates_grad[j] * gates[t * top_k + j];
+      }
+      chosen_prob_sum += prob_row[chosen[j]];
+    }
+    T dot = 0;
+    for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) {
+      dot += prob_row[e]
+             * MoeGatingProbGrad(e, top_k, chosen, token_gates_grad, gates_grad_dot,
+                                 chosen_prob_sum, aux_scale, top1_counts);
+    }
+    dot = WarpAllReduceSum(dot);
+    for (int64_t e = lane; e < num_experts; e += kCudaWarpSize) {
+      const T prob_grad = MoeGatingProbGrad(e, top_k, chosen, token_gates_grad, gates_grad_dot,
+                                            chosen_prob_sum, aux_scale, top1_counts);
+      logits_grad[t * num_experts + e] = prob_row[e] * (prob_grad - dot);
+    }
+  }
+}
+
+template<typename T>
+struct MoeCudaType {
+  using type = T;
+  using compute_type = T;
+};
+
+template<>
+struct MoeCudaType<float16> {
+  using type = half;
+  using compute_type = float;
+};
+
+template<typename T, typename ComputeType>
+__global__ void MoeDispatchGpu(int64_t elem_cnt, int64_t top_k, int64_t capacity,
+                               int64_t hidden_size, const T* tokens,
+                               const int32_t* expert_indices, const int32_t* locations,
+                               const T* gates, T* expert_buffer) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, offset, elem_cnt) {
+    const int64_t i = offset / hidden_size;
+    const int64_t h = offset - i * hidden_size;
+    const int32_t location = locations[i];
+    if (location < 0) { continue; }
+    ComputeType val = static_cast<ComputeType>(tokens[(i / top_k) * hidden_size + h]);
+    if (gates != nullptr) { val *= static_cast<ComputeType>(gates[i]); }
+    expert_buffer[(expert_indices[i] * capacity + location) * hidden_size + h] =
+        static_cast<T>(val);
+  }
+}
+
+template<typename T, typename ComputeType>
+__global__ void MoeCombineGpu(int64_t elem_cnt, int64_t top_k, int64_t capacity,
+                              int64_t hidden_size, const T* expert_buffer,
+                              const int32_t* expert_indices, const int32_t* locations,
+                              const T* gates, T* tokens) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, offset, elem_cnt) {
+    const int64_t t = offset / hidden_size;
+    const int64_t h = offset - t * hidden_size;
+    ComputeType acc = 0;
+    for (int64_t i = t * top_k; i < (t + 1) * top_k; ++i) {
+      const int32_t location = locations[i];
+      if (location < 0) { continue; }
+      ComputeType val = static_cast<ComputeType>(
+          expert_buffer[(expert_indices[i] * capacity + location) * hidden_size + h]);
+      if (gates != nullptr) { val *= static_cast<ComputeType>(gates[i]); }
+      acc += val;
+    }
+    tokens[offset] = static_cast<T>(acc);
+  }
+}
+
+// One warp per routed slot.
+template<typename T, typename ComputeType>
+__global__ void MoeGatesGradGpu(int64_t num_slots, int64_t top_k, int64_t capacity,
+                                int64_t hidden_size, const T* tokens, const T* expert_buffer,
+                                const int32_t* expert_indices, const int32_t* locations,
+                                T* gates_grad) {
+  const int lane = threadIdx.x % kCudaWarpSize;
+  const int64_t num_warps = static_cast<int64_t>(gridDim.x) * blockDim.x / kCudaWarpSize;
+  for (int64_t i = (static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x) / kCudaWarpSize;
+       i < num_slots; i += num_warps) {
+    const int32_t location = locations[i];
+    ComputeType dot = 0;
+    if (location >= 0) {
+      const T* token = tokens + (i / top_k) * hidden_size;
+      const T* slot = expert_buffer + (expert_indices[i] * capacity + location) * hidden_size;
+      for (int64_t h = lane; h < hidden_size; h += kCudaWarpSize) {
+        dot += static_cast<ComputeType>(token[h]) * static_cast<ComputeType>(slot[h]);
+      }
+    }
+    dot = WarpAllReduceSum(dot);
+    if (lane == 0) { gates_grad[i] = static_cast<T>(dot); }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+struct MoeGatingKernelUtil<DeviceType::kCUDA, T> {
+  static void Forward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                      int64_t capacity, const T* logits, int32_t* expert_indices,
+                      int32_t* locations, T* gates, T* probs, T* aux_loss, void* workspace) {
+    cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+    if (num_tokens == 0) {
+      OF_CUDA_CHECK(cudaMemsetAsync(aux_loss, 0, sizeof(T), cuda_stream));
+      return;
+    }
+    MoeSoftmaxTopKGpu<T><<<GetNumWarpBlocks(num_tokens), kMoeWarpsPerBlock * kCudaWarpSize, 0,
+                           cuda_stream>>>(num_tokens, num_experts, top_k, logits, expert_indices,
+                                          gates, probs);
+    T* aux_terms = static_cast<T*>(workspace);
+    MoeLocationsGpu<T>
+        <<<std::min<int64_t>(num_experts, kCudaMaxBlocksNum), kMoeBlockSize, 0, cuda_stream>>>(
+            num_tokens, num_experts, top_k, capacity, expert_indices, probs, locations,
+            aux_terms);
+    MoeAuxLossGpu<T><<<1, kMoeBlockSize, 0, cuda_stream>>>(num_tokens, num_experts, aux_terms,
+                                                             aux_loss);
+  }
+
+  static void Backward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                       const T* probs, const int32_t* expert_indices, const T* gates,
+                       const T* gates_grad, const T* aux_loss_grad, T* logits_grad,
+                       void* workspace) {
+    if (num_tokens == 0) { return; }
+    cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+    int32_t* top1_counts = static_cast<int32_t*>(workspace);
+    OF_CUDA_CHECK(cudaMemsetAsync(top1_counts, 0, num_experts * sizeof(int32_t), cuda_stream));
+    if (aux_loss_grad != nullptr) {
+      RUN_CUDA_KERNEL(MoeCountTop1Gpu, stream, num_tokens, num_tokens, top_k, expert_indices,
+                      top1_counts);
+    }
+    MoeGatingGradGpu<T><<<GetNumWarpBlocks(num_tokens), kMoeWarpsPerBlock * kCudaWarpSize, 0,
+                          cuda_stream>>>(num_tokens, num_experts, top_k, probs, expert_indices,
+                                         gates, gates_grad, aux_loss_grad, top1_counts,
+                                         logits_grad);
+  }
+};
+
+template<typename T>
+struct MoeDispatchKernelUtil<DeviceType::kCUDA, T> {
+  using CudaT = typename MoeCudaType<T>::type;
+  using ComputeType = typename MoeCudaType<T>::compute_type;
+
+  static void Dispatch(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                       int64_t capacity, int64_t hidden_size, const T* tokens,
+                       const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                       T* expert_buffer) {
+    OF_CUDA_CHECK(cudaMemsetAsync(expert_buffer, 0,
+                                  num_experts * capacity * hidden_size * sizeof(T),
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+    const int64_t elem_cnt = num_tokens * top_k * hidden_size;
+    if (elem_cnt == 0) { return; }
+    RUN_CUDA_KERNEL((MoeDispatchGpu<CudaT, ComputeType>), stream, elem_cnt, elem_cnt, top_k,
+                    capacity, hidden_size, reinterpret_cast<const CudaT*>(tokens),
+                    expert_indices, locations, reinterpret_cast<const CudaT*>(gates),
+                    reinterpret_cast<CudaT*>(expert_buffer));
+  }
+
+  static void Combine(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                      int64_t capacity, int64_t hidden_size, const T* expert_buffer,
+                      const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                      T* tokens) {
+    const int64_t elem_cnt = num_tokens * hidden_size;
+    if (elem_cnt == 0) { return; }
+    RUN_CUDA_KERNEL((MoeCombineGpu<CudaT, ComputeType>), stream, elem_cnt, elem_cnt, top_k,
+                    capacity, hidden_size, reinterpret_cast<const CudaT*>(expert_buffer),
+                    expert_indices, locations, reinterpret_cast<const CudaT*>(gates),
+                    reinterpret_cast<CudaT*>(tokens));
+  }
+
+  static void GatesGrad(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                        int64_t capacity, int64_t hidden_size, const T* tokens,
+                        const T* expert_buffer, const int32_t* expert_indices,
+                        const int32_t* locations, T* gates_grad) {
+    const int64_t num_slots = num_tokens * top_k;
+    if (num_slots == 0) { return; }
+    MoeGatesGradGpu<CudaT, ComputeType>
+        <<<GetNumWarpBlocks(num_slots), kMoeWarpsPerBlock * kCudaWarpSize, 0,
+           stream->As<ep::CudaStream>()->cuda_stream()>>>(
+            num_slots, top_k, capacity, hidden_size, reinterpret_cast<const CudaT*>(tokens),
+            reinterpret_cast<const CudaT*>(expert_buffer), expert_indices, locations,
+            reinterpret_cast<CudaT*>(gates_grad));
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_MOE_GATING_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ);
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_MOE_DISPATCH_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
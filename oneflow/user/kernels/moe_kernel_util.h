@@ -0,0 +1,90 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_MOE_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_MOE_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+constexpr int kMoeMaxTopK = 8;
+
+// Per expert scratch of the gating kernels, either the load balancing terms or the top-1 counts.
+inline size_t GetMoeGatingWorkspaceSize(int64_t num_experts) {
+  return GetCudaAlignedSize(num_experts * sizeof(double));
+}
+
+// logits and probs are [num_tokens, num_experts]; expert_indices, locations and gates are
+// [num_tokens, top_k]. Slot j of every token is placed after the slots j' < j of all the tokens
+// and after slot j of the tokens before it, so the top-1 choices are the last to be dropped.
+// A dropped slot has location -1.
+template<DeviceType device_type, typename T>
+struct MoeGatingKernelUtil {
+  static void Forward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                      int64_t capacity, const T* logits, int32_t* expert_indices,
+                      int32_t* locations, T* gates, T* probs, T* aux_loss, void* workspace);
+  static void Backward(ep::Stream* stream, int64_t num_tokens, int64_t num_experts, int64_t top_k,
+                       const T* probs, const int32_t* expert_indices, const T* gates,
+                       const T* gates_grad, const T* aux_loss_grad, T* logits_grad,
+                       void* workspace);
+};
+
+// tokens are [num_tokens, hidden_size] and the expert buffer is
+// [num_experts, capacity, hidden_size]. gates may be null, in which case no weighting is applied.
+template<DeviceType device_type, typename T>
+struct MoeDispatchKernelUtil {
+  static void Dispatch(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                       int64_t capacity, int64_t hidden_size, const T* tokens,
+                       const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                       T* expert_buffer);
+  static void Combine(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                      int64_t capacity, int64_t hidden_size, const T* expert_buffer,
+                      const int32_t* expert_indices, const int32_t* locations, const T* gates,
+                      T* tokens);
+  static void GatesGrad(ep::Stream* stream, int64_t num_tokens, int64_t top_k, int64_t num_experts,
+                        int64_t capacity, int64_t hidden_size, const T* tokens,
+                        const T* expert_buffer, const int32_t* expert_indices,
+                        const int32_t* locations, T* gates_grad);
+};
+
+// Gradient of the logits of one token given the gradient of its softmax probabilities, which
+// come from the chosen gates and from the load balancing loss E * sum_e(f_e * P_e), where f_e is
+// the fraction of the tokens whose first choice is e and P_e the mean probability of e.
+template<typename T>
+OF_DEVICE_FUNC T MoeGatingProbGrad(int64_t e, int64_t top_k, const int32_t* expert_indices,
+                                   const T* gates_grad, T gates_grad_dot, T chosen_prob_sum,
+                                   T aux_scale, const int32_t* top1_counts) {
+  T prob_grad = aux_scale * static_cast<T>(top1_counts[e]);
+  if (gates_grad == nullptr) { return prob_grad; }
+  for (int64_t j = 0; j < top_k; ++j) {
+    if (expert_indices[j] != e) { continue; }
+    // gates of top_k > 1 are renormalized over the chosen probabilities.
+    prob_grad += top_k > 1 ? (gates_grad[j] - gates_grad_dot) / chosen_prob_sum : gates_grad[j];
+  }
+  return prob_grad;
+}
+
+#define INSTANTIATE_MOE_GATING_KERNEL_UTIL(device_type_v, dtype_pair) \
+  template struct MoeGatingKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair)>;
+
+#define INSTANTIATE_MOE_DISPATCH_KERNEL_UTIL(device_type_v, dtype_pair) \
+  template struct MoeDispatchKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_MOE_KERNEL_UTIL_H_
@@ -0,0 +1,223 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/multi_tensor_model_update_kernel_util.h"
+#include "oneflow/core/kernel/cuda_graph_support.h"
+
+namespace oneflow {
+
+namespace {
+
+struct MultiTensorUpdateScalars {
+  const float* learning_rate_ptr = nullptr;
+  const void* scale_by_ptr = nullptr;
+  const int64_t* skip_if_ptr = nullptr;
+};
+
+MultiTensorUpdateScalars GetMultiTensorUpdateScalars(user_op::KernelComputeContext* ctx) {
+  MultiTensorUpdateScalars scalars;
+  if (ctx->has_input("learning_rate", 0)) {
+    const user_op::Tensor* learning_rate = ctx->Tensor4ArgNameAndIndex("learning_rate", 0);
+    scalars.learning_rate_ptr = learning_rate->dptr<float>();
+  }
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+    CHECK_EQ(scale_by_tensor->data_type(), ctx->Tensor4ArgNameAndIndex("model", 0)->data_type());
+    CHECK_EQ(scale_by_tensor->shape().elem_cnt(), 1);
+    scalars.scale_by_ptr = scale_by_tensor->dptr();
+  }
+  if (ctx->has_input("skip_if", 0)) {
+    const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+    CHECK_EQ(skip_if->shape().elem_cnt(), 1);
+    scalars.skip_if_ptr = skip_if->dptr<int64_t>();
+  }
+  return scalars;
+}
+
+// Packs (model_diff, model, states...) of every tensor into chunks of at most kMaxTuples tuples
+// and calls Launch once per chunk with the largest element count in that chunk.
+template<int N>
+void ForEachTensorTupleChunk(
+    user_op::KernelComputeContext* ctx, const std::vector<std::string>& state_arg_names,
+    const std::function<void(int64_t max_elem_cnt, int64_t n_tensor,
+                             const TensorTupleParams<N>& params)>& Launch) {
+  CHECK_EQ(state_arg_names.size() + 2, static_cast<size_t>(N));
+  const int64_t num_tensors = ctx->input_size("model");
+  for (int64_t start = 0; start < num_tensors; start += kMaxTuples) {
+    TensorTupleParams<N> params{};
+    const int64_t n_tensor = std::min<int64_t>(start + kMaxTuples, num_tensors) - start;
+    int64_t max_elem_cnt = 0;
+    for (int64_t i = 0; i < n_tensor; ++i) {
+      const user_op::Tensor* model_diff = ctx->Tensor4ArgNameAndIndex("model_diff", start + i);
+      user_op::Tensor* model = ctx->Tensor4ArgNameAndIndex("model", start + i);
+      const int64_t elem_cnt = model->shape().elem_cnt();
+      CHECK_EQ(model_diff->shape().elem_cnt(), elem_cnt);
+      params.ptr[0][i] = const_cast<void*>(model_diff->dptr());
+      params.ptr[1][i] = model->mut_dptr();
+      for (size_t j = 0; j < state_arg_names.size(); ++j) {
+        params.ptr[j + 2][i] = ctx->Tensor4ArgNameAndIndex(state_arg_names.at(j), start + i)
+                                   ->mut_dptr();
+      }
+      params.sizes[i] = elem_cnt;
+      max_elem_cnt = std::max(max_elem_cnt, elem_cnt);
+    }
+    if (max_elem_cnt == 0) { continue; }
+    Launch(max_elem_cnt, n_tensor, params);
+  }
+}
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorSGDUpdateKernel final : public user_op::OpKernel,
+                                         public user_op::CudaGraphSupport {
+ public:
+  MultiTensorSGDUpdateKernel() = default;
+  ~MultiTensorSGDUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const MultiTensorUpdateScalars scalars = GetMultiTensorUpdateScalars(ctx);
+    ForEachTensorTupleChunk<2>(
+        ctx, {},
+        [&](int64_t max_elem_cnt, int64_t n_tensor, const TensorTupleParams<2>& params) {
+          MultiTensorSGDUpdateKernelUtil<device_type, T, G>::Update(
+              ctx->stream(), max_elem_cnt, n_tensor, static_cast<T>(scale), l1, l2, weight_decay,
+              learning_rate_val, scalars.learning_rate_ptr,
+              static_cast<const T*>(scalars.scale_by_ptr), scalars.skip_if_ptr, params);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(device, dtype, gtype)                     \
+  REGISTER_USER_KERNEL("multi_tensor_sgd_update")                                         \
+      .SetCreateFn<MultiTensorSGDUpdateKernel<device, dtype, gtype>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                               \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+#ifdef WITH_CUDA
+REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
+REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
+REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(DeviceType::kCUDA, double, double);
+#endif  // WITH_CUDA
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorMomentumUpdateKernel final : public user_op::OpKernel,
+                                              public user_op::CudaGraphSupport {
+ public:
+  MultiTensorMomentumUpdateKernel() = default;
+  ~MultiTensorMomentumUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta = ctx->Attr<float>("beta");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const MultiTensorUpdateScalars scalars = GetMultiTensorUpdateScalars(ctx);
+    ForEachTensorTupleChunk<3>(
+        ctx, {"momentum"},
+        [&](int64_t max_elem_cnt, int64_t n_tensor, const TensorTupleParams<3>& params) {
+          MultiTensorMomentumUpdateKernelUtil<device_type, T, G>::Update(
+              ctx->stream(), max_elem_cnt, n_tensor, static_cast<T>(scale), l1, l2, beta,
+              weight_decay, learning_rate_val, scalars.learning_rate_ptr,
+              static_cast<const T*>(scalars.scale_by_ptr), scalars.skip_if_ptr, params);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_KERNEL(device, dtype, gtype)                \
+  REGISTER_USER_KERNEL("multi_tensor_momentum_update")                                    \
+      .SetCreateFn<MultiTensorMomentumUpdateKernel<device, dtype, gtype>>()               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                               \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+#ifdef WITH_CUDA
+REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
+REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
+REGISTER_MULTI_TENSOR_MOMENTUM_UPDATE_KERNEL(DeviceType::kCUDA, double, double);
+#endif  // WITH_CUDA
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorAdamUpdateKernel final : public user_op::OpKernel,
+                                          public user_op::CudaGraphSupport {
+ public:
+  MultiTensorAdamUpdateKernel() = default;
+  ~MultiTensorAdamUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const float bias_correction1_val = ctx->Attr<float>("bias_correction1_val");
+    const float bias_correction2_val = ctx->Attr<float>("bias_correction2_val");
+    const float* bias_correction1_ptr = nullptr;
+    if (ctx->has_input("bias_correction1", 0)) {
+      const user_op::Tensor* bias_correction1 = ctx->Tensor4ArgNameAndIndex("bias_correction1", 0);
+      CHECK_EQ(bias_correction1->shape().elem_cnt(), 1);
+      bias_correction1_ptr = bias_correction1->dptr<float>();
+    }
+    const float* bias_correction2_ptr = nullptr;
+    if (ctx->has_input("bias_correction2", 0)) {
+      const user_op::Tensor* bias_correction2 = ctx->Tensor4ArgNameAndIndex("bias_correction2", 0);
+      CHECK_EQ(bias_correction2->shape().elem_cnt(), 1);
+      bias_correction2_ptr = bias_correction2->dptr<float>();
+    }
+    const MultiTensorUpdateScalars scalars = GetMultiTensorUpdateScalars(ctx);
+    ForEachTensorTupleChunk<4>(
+        ctx, {"m", "v"},
+        [&](int64_t max_elem_cnt, int64_t n_tensor, const TensorTupleParams<4>& params) {
+          MultiTensorAdamUpdateKernelUtil<device_type, T, G>::Update(
+              ctx->stream(), max_elem_cnt, n_tensor, static_cast<T>(scale), l1, l2, beta1, beta2,
+              epsilon, weight_decay, learning_rate_val, bias_correction1_val, bias_correction2_val,
+              scalars.learning_rate_ptr, static_cast<const T*>(scalars.scale_by_ptr),
+              scalars.skip_if_ptr, bias_correction1_ptr, bias_correction2_ptr, params);
+        });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(device, dtype, gtype)                    \
+  REGISTER_USER_KERNEL("multi_tensor_adam_update")                                        \
+      .SetCreateFn<MultiTensorAdamUpdateKernel<device, dtype, gtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                               \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+#ifdef WITH_CUDA
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, double, double);
+#endif  // WITH_CUDA
+
+}  // namespace
+
+}  // namespace oneflow
@@ -18,6 +18,8 @@ limitations under the License.
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/job/nd_sbp_util.h"
+#include "oneflow/core/register/tensor_slice_copier.h"
 #include "oneflow/core/ep/include/primitive/permute.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow/user/ops/nccl_logical_util.h"
@@ -444,6 +446,234 @@ class NcclLogical2DSameDim1AllReduce final : public user_op::OpKernel {
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
+// NOTE: A piece of the output held by several source ranks, because the source nd_sbp broadcasts
+// on some hierarchy dim, is read from the one whose index on the broadcast dims equals the index
+// of the destination rank. Every piece is then received exactly once and the reads are spread
+// over the copies.
+bool Is2DSendRecvSource(const Shape& hierarchy, const NdSbp& src_nd_sbp, int64_t src_parallel_id,
+                        int64_t dst_parallel_id) {
+  const int64_t group_size = hierarchy.At(1);
+  const int64_t src_index[2] = {src_parallel_id / group_size, src_parallel_id % group_size};
+  const int64_t dst_index[2] = {dst_parallel_id / group_size, dst_parallel_id % group_size};
+  for (int64_t i = 0; i < 2; ++i) {
+    if (src_nd_sbp.sbp_parallel(i).has_broadcast_parallel() && src_index[i] != dst_index[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct NcclLogical2DSendRecvPlan {
+  TensorSliceView in_view;
+  TensorSliceView out_view;
+  // indexed by the parallel id of the peer, empty when nothing is exchanged with it
+  std::vector<TensorSliceView> send_views;
+  std::vector<TensorSliceView> recv_views;
+};
+
+void Init2DSendRecvPlan(const Shape& hierarchy, const NdSbp& src_nd_sbp, const NdSbp& dst_nd_sbp,
+                        const Shape& logical_shape, int64_t parallel_id,
+                        NcclLogical2DSendRecvPlan* plan) {
+  CHECK_EQ(hierarchy.NumAxes(), 2);
+  CHECK_EQ(src_nd_sbp.sbp_parallel_size(), 2);
+  CHECK_EQ(dst_nd_sbp.sbp_parallel_size(), 2);
+  const int64_t parallel_num = hierarchy.elem_cnt();
+  plan->in_view = GetTensorSliceView4ParallelId(hierarchy, src_nd_sbp, logical_shape, parallel_id);
+  plan->out_view = GetTensorSliceView4ParallelId(hierarchy, dst_nd_sbp, logical_shape, parallel_id);
+  plan->send_views.resize(parallel_num);
+  plan->recv_views.resize(parallel_num);
+  for (int64_t peer = 0; peer < parallel_num; ++peer) {
+    if (Is2DSendRecvSource(hierarchy, src_nd_sbp, parallel_id, peer)) {
+      plan->send_views[peer] = plan->in_view.Intersect(
+          GetTensorSliceView4ParallelId(hierarchy, dst_nd_sbp, logical_shape, peer));
+    }
+    if (Is2DSendRecvSource(hierarchy, src_nd_sbp, peer, parallel_id)) {
+      plan->recv_views[peer] = plan->out_view.Intersect(
+          GetTensorSliceView4ParallelId(hierarchy, src_nd_sbp, logical_shape, peer));
+    }
+  }
+}
+
+template<typename ContextT>
+void Init2DSendRecvPlanFromContext(ContextT* ctx, NcclLogical2DSendRecvPlan* plan) {
+  NdSbp src_nd_sbp;
+  NdSbp dst_nd_sbp;
+  CHECK_JUST(GetNcclLogicalNdSbpFromAttr(ctx, "src_reduced_nd_sbp", &src_nd_sbp));
+  CHECK_JUST(GetNcclLogicalNdSbpFromAttr(ctx, "dst_reduced_nd_sbp", &dst_nd_sbp));
+  Init2DSendRecvPlan(*ctx->parallel_desc().hierarchy(), src_nd_sbp, dst_nd_sbp,
+                     ctx->LogicalTensorDesc4ArgNameAndIndex("in", 0)->shape(),
+                     ctx->parallel_ctx().parallel_id(), plan);
+}
+
+// The pieces sent to and received from remote peers are staged contiguously in the tmp buffer,
+// the sends first.
+size_t Get2DSendRecvBufferSize(const NcclLogical2DSendRecvPlan& plan, int64_t parallel_id,
+                               DataType data_type, std::vector<size_t>* send_offsets,
+                               std::vector<size_t>* recv_offsets) {
+  const int64_t parallel_num = plan.send_views.size();
+  size_t buffer_size = 0;
+  const auto ForEachRemotePiece = [&](const std::vector<TensorSliceView>& views,
+                                      std::vector<size_t>* offsets) {
+    if (offsets != nullptr) { offsets->assign(parallel_num, 0); }
+    for (int64_t peer = 0; peer < parallel_num; ++peer) {
+      if (peer == parallel_id || views.at(peer).IsEmpty()) { continue; }
+      if (offsets != nullptr) { offsets->at(peer) = buffer_size; }
+      buffer_size += GetCudaAlignedSize(views.at(peer).shape().elem_cnt()
+                                        * GetSizeOfDataType(data_type));
+    }
+  };
+  ForEachRemotePiece(plan.send_views, send_offsets);
+  ForEachRemotePiece(plan.recv_views, recv_offsets);
+  return buffer_size;
+}
+
+class NcclLogical2DSendRecvKernelState final : public user_op::OpKernelState {
+ public:
+  explicit NcclLogical2DSendRecvKernelState(user_op::KernelInitContext* ctx)
+      : is_init_(false),
+        parallel_desc_(ctx->parallel_desc()),
+        this_parallel_id_(ctx->parallel_ctx().parallel_id()) {
+    const DataType data_type = ctx->TensorDesc4ArgNameAndIndex("in", 0)->data_type();
+    Init2DSendRecvPlanFromContext(ctx, &plan_);
+    buffer_size_ = Get2DSendRecvBufferSize(plan_, this_parallel_id_, data_type, &send_offsets_,
+                                           &recv_offsets_);
+    const int64_t parallel_num = plan_.send_views.size();
+    pack_copiers_.resize(parallel_num);
+    unpack_copiers_.resize(parallel_num);
+    for (int64_t peer = 0; peer < parallel_num; ++peer) {
+      const TensorSliceView& send_view = plan_.send_views.at(peer);
+      const TensorSliceView& recv_view = plan_.recv_views.at(peer);
+      if (peer == this_parallel_id_) {
+        // the piece this rank already holds is copied locally without nccl
+        if (!send_view.IsEmpty()) {
+          local_copier_.reset(new TensorSliceCopier(plan_.out_view, plan_.in_view, send_view,
+                                                    data_type, DeviceType::kCUDA));
+        }
+        continue;
+      }
+      if (!send_view.IsEmpty()) {
+        pack_copiers_.at(peer).reset(new TensorSliceCopier(send_view, plan_.in_view, send_view,
+                                                           data_type, DeviceType::kCUDA));
+      }
+      if (!recv_view.IsEmpty()) {
+        unpack_copiers_.at(peer).reset(new TensorSliceCopier(plan_.out_view, recv_view, recv_view,
+                                                             data_type, DeviceType::kCUDA));
+      }
+    }
+  }
+  ~NcclLogical2DSendRecvKernelState() override = default;
+
+  ncclComm_t comm() {
+    if (!is_init_) {
+      std::set<std::pair<int64_t, int64_t>> device_set;
+      FOR_RANGE(int64_t, parallel_id, 0, parallel_desc_.parallel_num()) {
+        const int64_t machine_id = CHECK_JUST(parallel_desc_.MachineId4ParallelId(parallel_id));
+        const int64_t device_id = CHECK_JUST(parallel_desc_.DeviceId4ParallelId(parallel_id));
+        device_set.emplace(std::make_pair(machine_id, device_id));
+      }
+      comm_ = CHECK_NOTNULL(Global<EagerNcclCommMgr>::Get())->GetCommForDevice(device_set);
+      is_init_ = true;
+    }
+    return comm_;
+  }
+
+  int64_t this_parallel_id() const { return this_parallel_id_; }
+  const NcclLogical2DSendRecvPlan& plan() const { return plan_; }
+  size_t buffer_size() const { return buffer_size_; }
+  size_t send_offset(int64_t peer) const { return send_offsets_.at(peer); }
+  size_t recv_offset(int64_t peer) const { return recv_offsets_.at(peer); }
+  const TensorSliceCopier* local_copier() const { return local_copier_.get(); }
+  const TensorSliceCopier* pack_copier(int64_t peer) const { return pack_copiers_.at(peer).get(); }
+  const TensorSliceCopier* unpack_copier(int64_t peer) const {
+    return unpack_copiers_.at(peer).get();
+  }
+
+ private:
+  bool is_init_;
+  ParallelDesc parallel_desc_;
+  int64_t this_parallel_id_;
+  ncclComm_t comm_{};
+  NcclLogical2DSendRecvPlan plan_;
+  size_t buffer_size_;
+  std::vector<size_t> send_offsets_;
+  std::vector<size_t> recv_offsets_;
+  std::unique_ptr<TensorSliceCopier> local_copier_;
+  std::vector<std::unique_ptr<TensorSliceCopier>> pack_copiers_;
+  std::vector<std::unique_ptr<TensorSliceCopier>> unpack_copiers_;
+};
+
+class NcclLogical2DSendRecv final : public user_op::OpKernel {
+ public:
+  NcclLogical2DSendRecv() = default;
+  ~NcclLogical2DSendRecv() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<NcclLogical2DSendRecvKernelState>(ctx);
+  }
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<NcclLogical2DSendRecvKernelState*>(state);
+    CHECK_NOTNULL(kernel_state);
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    CHECK_EQ(in->data_type(), out->data_type());
+    const NcclLogical2DSendRecvPlan& plan = kernel_state->plan();
+    const int64_t parallel_num = plan.send_views.size();
+    const int64_t this_parallel_id = kernel_state->this_parallel_id();
+    char* buffer = nullptr;
+    if (kernel_state->buffer_size() > 0) {
+      user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+      CHECK_GE(tmp_buffer->shape().elem_cnt(), static_cast<int64_t>(kernel_state->buffer_size()));
+      buffer = tmp_buffer->mut_dptr<char>();
+    }
+    for (int64_t peer = 0; peer < parallel_num; ++peer) {
+      const TensorSliceCopier* pack_copier = kernel_state->pack_copier(peer);
+      if (pack_copier == nullptr) { continue; }
+      pack_copier->Copy(ctx->stream(), buffer + kernel_state->send_offset(peer), in->dptr());
+    }
+    if (kernel_state->local_copier() != nullptr) {
+      kernel_state->local_copier()->Copy(ctx->stream(), out->mut_dptr(), in->dptr());
+    }
+    if (kernel_state->buffer_size() > 0) {
+      const ncclDataType_t nccl_data_type = GetNcclDataType(in->data_type());
+      cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+      OF_NCCL_CHECK(ncclGroupStart());
+      for (int64_t peer = 0; peer < parallel_num; ++peer) {
+        if (peer == this_parallel_id) { continue; }
+        const TensorSliceView& send_view = plan.send_views.at(peer);
+        const TensorSliceView& recv_view = plan.recv_views.at(peer);
+        if (!send_view.IsEmpty()) {
+          OF_NCCL_CHECK(ncclSend(buffer + kernel_state->send_offset(peer),
+                                 send_view.shape().elem_cnt(), nccl_data_type, peer,
+                                 kernel_state->comm(), cuda_stream));
+        }
+        if (!recv_view.IsEmpty()) {
+          OF_NCCL_CHECK(ncclRecv(buffer + kernel_state->recv_offset(peer),
+                                 recv_view.shape().elem_cnt(), nccl_data_type, peer,
+                                 kernel_state->comm(), cuda_stream));
+        }
+      }
+      OF_NCCL_CHECK(ncclGroupEnd());
+    }
+    for (int64_t peer = 0; peer < parallel_num; ++peer) {
+      const TensorSliceCopier* unpack_copier = kernel_state->unpack_copier(peer);
+      if (unpack_copier == nullptr) { continue; }
+      unpack_copier->Copy(ctx->stream(), out->mut_dptr(), buffer + kernel_state->recv_offset(peer));
+    }
+  };
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+size_t Infer2DSendRecvKernelTmpBufferSize(user_op::InferContext* ctx) {
+  NcclLogical2DSendRecvPlan plan;
+  Init2DSendRecvPlanFromContext(ctx, &plan);
+  return Get2DSendRecvBufferSize(plan, ctx->parallel_ctx().parallel_id(),
+                                 ctx->InputTensorDesc("in", 0).data_type(), nullptr, nullptr);
+}
+
 }  // namespace
 
 REGISTER_USER_KERNEL("_nccl_logical_2D_same_dim0_all_reduce")
@@ -488,6 +718,11 @@ REGISTER_USER_KERNEL("_nccl_logical_2D_same_dim1_all_reduce")
     .SetCreateFn<NcclLogical2DSameDim1AllReduce>()
     .SetIsMatchedHob(user_op::HobDeviceType() == DeviceType::kCUDA);
 
+REGISTER_USER_KERNEL("_nccl_logical_2D_send_recv")
+    .SetCreateFn<NcclLogical2DSendRecv>()
+    .SetIsMatchedHob(user_op::HobDeviceType() == DeviceType::kCUDA)
+    .SetInferTmpSizeFn(Infer2DSendRecvKernelTmpBufferSize);
+
 }  // namespace oneflow
 
 #endif  // WITH_CUDA && NCCL_VERSION_CODE > 2700
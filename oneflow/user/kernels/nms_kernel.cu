@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/user/kernels/radix_sort.cuh"
 
 namespace oneflow {
 
@@ -87,6 +88,212 @@ __global__ void ScanSuppression(int num_boxes, int num_blocks, int num_keep,
   }
 }
 
+template<typename T>
+__device__ __forceinline__ const T* SegmentBoxes(const T* boxes, int segment, int num_classes,
+                                                 int num_boxes, bool per_class_boxes) {
+  const int64_t boxes_index = per_class_boxes ? segment : segment / num_classes;
+  return boxes + boxes_index * num_boxes * 4;
+}
+
+__global__ void InitializeBatchedNmsIndices(int32_t elem_cnt, int32_t* indices_ptr,
+                                            int32_t instance_size) {
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) { indices_ptr[i] = i % instance_size; };
+}
+
+// Every segment, an (image, class) pair, is one z slice of the grid. The candidates of a segment
+// are its first num_candidates boxes in the descending order of scores.
+template<typename T>
+__global__ void CalcBatchedSuppressionBitmaskMatrix(int num_classes, int num_boxes,
+                                                    int num_candidates, bool per_class_boxes,
+                                                    float iou_threshold, const T* boxes,
+                                                    const int32_t* sorted_indices,
+                                                    int64_t* suppression_bmask_matrix) {
+  const int segment = blockIdx.z;
+  const int row = blockIdx.y;
+  const int col = blockIdx.x;
+
+  if (row > col) return;
+
+  const T* segment_boxes = SegmentBoxes(boxes, segment, num_classes, num_boxes, per_class_boxes);
+  const int32_t* segment_indices = sorted_indices + static_cast<int64_t>(segment) * num_boxes;
+  int64_t* segment_bmask =
+      suppression_bmask_matrix + static_cast<int64_t>(segment) * num_candidates * gridDim.y;
+  const int row_size = min(num_candidates - row * kBlockSize, kBlockSize);
+  const int col_size = min(num_candidates - col * kBlockSize, kBlockSize);
+
+  __shared__ T block_boxes[kBlockSize * 4];
+  if (threadIdx.x < col_size) {
+    const T* box = segment_boxes + segment_indices[kBlockSize * col + threadIdx.x] * 4;
+    block_boxes[threadIdx.x * 4 + 0] = box[0];
+    block_boxes[threadIdx.x * 4 + 1] = box[1];
+    block_boxes[threadIdx.x * 4 + 2] = box[2];
+    block_boxes[threadIdx.x * 4 + 3] = box[3];
+  }
+  __syncthreads();
+
+  if (threadIdx.x < row_size) {
+    const int cur_box_idx = kBlockSize * row + threadIdx.x;
+    const T* cur_box_ptr = segment_boxes + segment_indices[cur_box_idx] * 4;
+    unsigned long long bits = 0;
+    int start = 0;
+    if (row == col) { start = threadIdx.x + 1; }
+    for (int i = start; i < col_size; i++) {
+      if (IoU(cur_box_ptr, block_boxes + i * 4) > iou_threshold) { bits |= 1Ull << i; }
+    }
+    segment_bmask[cur_box_idx * gridDim.y + col] = bits;
+  }
+}
+
+// One block per segment. The score of a kept candidate is written to kept_scores, the others
+// get the lowest value so that they sort last when the classes of an image are merged.
+template<typename T>
+__global__ void BatchedScanSuppression(int num_boxes, int num_candidates, int num_blocks,
+                                       float score_threshold, const T* sorted_scores,
+                                       const int64_t* suppression_bmask, T* kept_scores) {
+  extern __shared__ int64_t remv[];
+  const int segment = blockIdx.x;
+  const T* segment_scores = sorted_scores + static_cast<int64_t>(segment) * num_boxes;
+  const int64_t* segment_bmask =
+      suppression_bmask + static_cast<int64_t>(segment) * num_candidates * num_blocks;
+  T* segment_kept_scores = kept_scores + static_cast<int64_t>(segment) * num_candidates;
+  for (int i = threadIdx.x; i < num_candidates; i += blockDim.x) {
+    segment_kept_scores[i] = GetMinVal<T>();
+  }
+  remv[threadIdx.x] = 0;
+  __syncthreads();
+  for (int i = 0; i < num_candidates; ++i) {
+    const T score = segment_scores[i];
+    if (!(score > static_cast<T>(score_threshold))) { break; }
+    const int block_n = i / kBlockSize;
+    const int block_i = i % kBlockSize;
+    const bool kept = !(remv[block_n] & (1Ull << block_i));
+    __syncthreads();
+    if (kept) {
+      remv[threadIdx.x] |= segment_bmask[i * num_blocks + threadIdx.x];
+      if (threadIdx.x == 0) { segment_kept_scores[i] = score; }
+    }
+    __syncthreads();
+  }
+}
+
+// The kept candidates of all the classes of an image are sorted by score, the first
+// max_output of them are the detections of the image and the rest of the output is padding.
+template<typename T>
+__global__ void GatherBatchedDetections(int batch_size, int num_classes, int num_boxes,
+                                        int num_candidates, int max_output, bool per_class_boxes,
+                                        const T* boxes, const int32_t* sorted_indices,
+                                        const T* merged_scores, const int32_t* merged_indices,
+                                        T* out_boxes, T* out_scores, int64_t* out_classes,
+                                        int64_t* out_indices, int32_t* num_detections) {
+  const int num_merged = num_classes * num_candidates;
+  const int elem_cnt = batch_size * max_output;
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
+    const int b = i / max_output;
+    const int j = i - b * max_output;
+    const T* image_scores = merged_scores + static_cast<int64_t>(b) * num_merged;
+    const int32_t* image_indices = merged_indices + static_cast<int64_t>(b) * num_merged;
+    if (j < num_merged && image_scores[j] > GetMinVal<T>()) {
+      const int c = image_indices[j] / num_candidates;
+      const int k = image_indices[j] - c * num_candidates;
+      const int segment = b * num_classes + c;
+      const int32_t box_index = sorted_indices[static_cast<int64_t>(segment) * num_boxes + k];
+      const T* box = SegmentBoxes(boxes, segment, num_classes, num_boxes, per_class_boxes)
+                     + box_index * 4;
+      for (int d = 0; d < 4; ++d) { out_boxes[i * 4 + d] = box[d]; }
+      out_scores[i] = image_scores[j];
+      out_classes[i] = c;
+      out_indices[i] = box_index;
+      if (j + 1 == max_output || j + 1 == num_merged || !(image_scores[j + 1] > GetMinVal<T>())) {
+        num_detections[b] = j + 1;
+      }
+    } else {
+      for (int d = 0; d < 4; ++d) { out_boxes[i * 4 + d] = 0; }
+      out_scores[i] = 0;
+      out_classes[i] = -1;
+      out_indices[i] = -1;
+      if (j == 0) { num_detections[b] = 0; }
+    }
+  }
+}
+
+template<typename T>
+class BatchedNmsTmpBufferManager final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BatchedNmsTmpBufferManager);
+  BatchedNmsTmpBufferManager(int32_t batch_size, int32_t num_classes, int32_t num_boxes,
+                             int32_t num_candidates, void* ptr) {
+    const int64_t num_segments = static_cast<int64_t>(batch_size) * num_classes;
+    const int64_t num_sorted = num_segments * num_boxes;
+    const int64_t num_merged = num_segments * num_candidates;
+    const int64_t num_blocks = CeilDiv<int64_t>(num_candidates, kBlockSize);
+    const size_t sorted_scores_bytes = GetCudaAlignedSize(num_sorted * sizeof(T));
+    const size_t sorted_indices_bytes = GetCudaAlignedSize(num_sorted * sizeof(int32_t));
+    const size_t indices_bytes =
+        GetCudaAlignedSize(std::max(num_sorted, num_merged) * sizeof(int32_t));
+    const size_t bmask_bytes =
+        GetCudaAlignedSize(num_segments * num_candidates * num_blocks * sizeof(int64_t));
+    const size_t kept_scores_bytes = GetCudaAlignedSize(num_merged * sizeof(T));
+    const size_t merged_scores_bytes = GetCudaAlignedSize(num_merged * sizeof(T));
+    const size_t merged_indices_bytes = GetCudaAlignedSize(num_merged * sizeof(int32_t));
+    temp_storage_bytes_ = 0;
+    if (num_sorted > 0) {
+      temp_storage_bytes_ = std::max(
+          InferTempStorageForSortPairsDescending<T, int32_t>(num_segments, num_boxes),
+          InferTempStorageForSortPairsDescending<T, int32_t>(batch_size,
+                                                             num_classes * num_candidates));
+    }
+    char* cur = reinterpret_cast<char*>(ptr);
+    sorted_scores_ptr_ = reinterpret_cast<T*>(cur);
+    cur += sorted_scores_bytes;
+    sorted_indices_ptr_ = reinterpret_cast<int32_t*>(cur);
+    cur += sorted_indices_bytes;
+    indices_ptr_ = reinterpret_cast<int32_t*>(cur);
+    cur += indices_bytes;
+    suppression_mask_ptr_ = reinterpret_cast<int64_t*>(cur);
+    suppression_mask_bytes_ = bmask_bytes;
+    cur += bmask_bytes;
+    kept_scores_ptr_ = reinterpret_cast<T*>(cur);
+    cur += kept_scores_bytes;
+    merged_scores_ptr_ = reinterpret_cast<T*>(cur);
+    cur += merged_scores_bytes;
+    merged_indices_ptr_ = reinterpret_cast<int32_t*>(cur);
+    cur += merged_indices_bytes;
+    temp_storage_ptr_ = cur;
+    total_bytes_ = cur - reinterpret_cast<char*>(ptr) + temp_storage_bytes_;
+  }
+  ~BatchedNmsTmpBufferManager() = default;
+
+  T* SortedScoresPtr() const { return sorted_scores_ptr_; }
+  int32_t* SortedIndicesPtr() const { return sorted_indices_ptr_; }
+  int32_t* IndicesPtr() const { return indices_ptr_; }
+  int64_t* SuppressionMaskPtr() const { return suppression_mask_ptr_; }
+  size_t SuppressionMaskBytes() const { return suppression_mask_bytes_; }
+  T* KeptScoresPtr() const { return kept_scores_ptr_; }
+  T* MergedScoresPtr() const { return merged_scores_ptr_; }
+  int32_t* MergedIndicesPtr() const { return merged_indices_ptr_; }
+  void* TempStoragePtr() const { return temp_storage_ptr_; }
+  size_t TempStorageBytes() const { return temp_storage_bytes_; }
+  size_t TotalBytes() const { return total_bytes_; }
+
+ private:
+  T* sorted_scores_ptr_;
+  int32_t* sorted_indices_ptr_;
+  int32_t* indices_ptr_;
+  int64_t* suppression_mask_ptr_;
+  size_t suppression_mask_bytes_;
+  T* kept_scores_ptr_;
+  T* merged_scores_ptr_;
+  int32_t* merged_indices_ptr_;
+  void* temp_storage_ptr_;
+  size_t temp_storage_bytes_;
+  size_t total_bytes_;
+};
+
+int32_t BatchedNmsNumCandidates(int32_t num_boxes, int32_t pre_nms_top_n) {
+  if (pre_nms_top_n <= 0 || pre_nms_top_n > num_boxes) { return num_boxes; }
+  return pre_nms_top_n;
+}
+
 }  // namespace
 
 template<typename T>
@@ -141,4 +348,103 @@ class NmsGpuKernel final : public user_op::OpKernel {
 REGISTER_NMS_CUDA_KERNEL(float)
 REGISTER_NMS_CUDA_KERNEL(double)
 
+// Suppresses every class of every image in a fixed number of launches: the scores of all the
+// (image, class) segments are sorted at once, the candidates of all the segments are suppressed
+// by one bitmask and one scan launch, and a second sort merges the classes of every image.
+template<typename T>
+class BatchedNmsGpuKernel final : public user_op::OpKernel {
+ public:
+  BatchedNmsGpuKernel() = default;
+  ~BatchedNmsGpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* boxes = ctx->Tensor4ArgNameAndIndex("boxes", 0);
+    const user_op::Tensor* scores = ctx->Tensor4ArgNameAndIndex("scores", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t batch_size = scores->shape().At(0);
+    const int32_t num_classes = scores->shape().At(1);
+    const int32_t num_boxes = scores->shape().At(2);
+    const int32_t num_candidates =
+        BatchedNmsNumCandidates(num_boxes, ctx->Attr<int32_t>("pre_nms_top_n"));
+    const int32_t max_output = ctx->Attr<int32_t>("max_output_per_image");
+    const bool per_class_boxes = boxes->shape().NumAxes() == 4;
+    const int32_t num_segments = batch_size * num_classes;
+    BatchedNmsTmpBufferManager<T> buf_manager(batch_size, num_classes, num_boxes, num_candidates,
+                                              tmp_buffer->mut_dptr());
+    CHECK_LE(buf_manager.TotalBytes(), tmp_buffer->shape().elem_cnt());
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+
+    if (num_segments > 0 && num_boxes > 0) {
+      const int32_t num_blocks = CeilDiv<int32_t>(num_candidates, kBlockSize);
+      CHECK_LE(num_blocks, kCudaThreadsNumPerBlock);
+      CHECK_LE(num_segments, 65535);
+      const int32_t sorted_cnt = num_segments * num_boxes;
+      InitializeBatchedNmsIndices<<<BlocksNum4ThreadsNum(sorted_cnt), kCudaThreadsNumPerBlock, 0,
+                                    cuda_stream>>>(sorted_cnt, buf_manager.IndicesPtr(),
+                                                   num_boxes);
+      SortPairsDescending(scores->dptr<T>(), buf_manager.IndicesPtr(), num_segments, num_boxes,
+                          buf_manager.TempStoragePtr(), buf_manager.TempStorageBytes(),
+                          buf_manager.SortedScoresPtr(), buf_manager.SortedIndicesPtr(),
+                          cuda_stream);
+
+      Memset<DeviceType::kCUDA>(ctx->stream(), buf_manager.SuppressionMaskPtr(), 0,
+                                buf_manager.SuppressionMaskBytes());
+      dim3 blocks(num_blocks, num_blocks, num_segments);
+      dim3 threads(kBlockSize);
+      CalcBatchedSuppressionBitmaskMatrix<<<blocks, threads, 0, cuda_stream>>>(
+          num_classes, num_boxes, num_candidates, per_class_boxes,
+          ctx->Attr<float>("iou_threshold"), boxes->dptr<T>(), buf_manager.SortedIndicesPtr(),
+          buf_manager.SuppressionMaskPtr());
+      BatchedScanSuppression<<<num_segments, num_blocks, num_blocks * sizeof(int64_t),
+                               cuda_stream>>>(
+          num_boxes, num_candidates, num_blocks, ctx->Attr<float>("score_threshold"),
+          buf_manager.SortedScoresPtr(), buf_manager.SuppressionMaskPtr(),
+          buf_manager.KeptScoresPtr());
+
+      const int32_t num_merged = num_classes * num_candidates;
+      const int32_t merged_cnt = batch_size * num_merged;
+      InitializeBatchedNmsIndices<<<BlocksNum4ThreadsNum(merged_cnt), kCudaThreadsNumPerBlock, 0,
+                                    cuda_stream>>>(merged_cnt, buf_manager.IndicesPtr(),
+                                                   num_merged);
+      SortPairsDescending(buf_manager.KeptScoresPtr(), buf_manager.IndicesPtr(), batch_size,
+                          num_merged, buf_manager.TempStoragePtr(),
+                          buf_manager.TempStorageBytes(), buf_manager.MergedScoresPtr(),
+                          buf_manager.MergedIndicesPtr(), cuda_stream);
+    }
+
+    const int32_t out_cnt = batch_size * max_output;
+    const int32_t num_sorted_classes = num_boxes > 0 ? num_classes : 0;
+    GatherBatchedDetections<<<BlocksNum4ThreadsNum(out_cnt), kCudaThreadsNumPerBlock, 0,
+                              cuda_stream>>>(
+        batch_size, num_sorted_classes, num_boxes, num_candidates, max_output, per_class_boxes,
+        boxes->dptr<T>(), buf_manager.SortedIndicesPtr(), buf_manager.MergedScoresPtr(),
+        buf_manager.MergedIndicesPtr(), ctx->Tensor4ArgNameAndIndex("out_boxes", 0)->mut_dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("out_scores", 0)->mut_dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("out_classes", 0)->mut_dptr<int64_t>(),
+        ctx->Tensor4ArgNameAndIndex("out_indices", 0)->mut_dptr<int64_t>(),
+        ctx->Tensor4ArgNameAndIndex("num_detections", 0)->mut_dptr<int32_t>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BATCHED_NMS_CUDA_KERNEL(dtype)                                               \
+  REGISTER_USER_KERNEL("batched_nms")                                                         \
+      .SetCreateFn<BatchedNmsGpuKernel<dtype>>()                                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)                        \
+                       && (user_op::HobDataType("scores", 0) == GetDataType<dtype>::value))   \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                     \
+        const Shape& scores_shape = ctx->InputShape("scores", 0);                             \
+        const int32_t num_boxes = scores_shape.At(2);                                         \
+        const int32_t num_candidates =                                                        \
+            BatchedNmsNumCandidates(num_boxes, ctx->Attr<int32_t>("pre_nms_top_n"));          \
+        BatchedNmsTmpBufferManager<dtype> buf_manager(scores_shape.At(0), scores_shape.At(1), \
+                                                      num_boxes, num_candidates, nullptr);    \
+        return buf_manager.TotalBytes();                                                      \
+      });
+
+REGISTER_BATCHED_NMS_CUDA_KERNEL(float)
+REGISTER_BATCHED_NMS_CUDA_KERNEL(double)
+
 }  // namespace oneflow
@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/user/kernels/random_seed_util.h"
 #include "oneflow/user/image/jpeg_decoder.h"
+#include "oneflow/user/data/ofrecord_view.h"
 
 #include <opencv2/opencv.hpp>
 #include <jpeglib.h>
@@ -34,43 +35,52 @@ namespace oneflow {
 
 namespace {
 
+// The records of "in" are parsed OFRecords, or the serialized ones of OFRecordReader with
+// raw_records which are read in place without building the protobuf messages.
+data::OFRecordFeatureView FindFeature(const user_op::Tensor* in, int64_t i,
+                                      const std::string& name) {
+  data::OFRecordFeatureView feature;
+  if (in->data_type() == DataType::kOFRecord) {
+    const OFRecord& record = in->dptr<OFRecord>()[i];
+    auto it = record.feature().find(name);
+    CHECK(it != record.feature().end()) << "Field " << name << " not found";
+    feature = data::OFRecordFeatureView(it->second);
+  } else {
+    CHECK_EQ(in->data_type(), DataType::kTensorBuffer);
+    const TensorBuffer& buffer = in->dptr<TensorBuffer>()[i];
+    const data::OFRecordView record(buffer.data<char>(), buffer.nbytes());
+    CHECK(record.Find(name, &feature)) << "Field " << name << " not found";
+  }
+  return feature;
+}
+
 template<typename T>
-void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt, bool truncate,
-                          bool dim1_varying_length) {
-  if (feature.has_bytes_list()) {
-    CHECK_EQ(feature.bytes_list().value_size(), 1);
-    const auto& value0 = feature.bytes_list().value(0);
-    auto in_dptr = reinterpret_cast<const int8_t*>(value0.c_str());
-    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size());
+void DecodeOneRawOFRecord(const data::OFRecordFeatureView& feature, T* dptr,
+                          int64_t sample_elem_cnt, bool truncate, bool dim1_varying_length) {
+  if (feature.kind() == data::OFRecordFeatureView::kBytesList) {
+    CHECK_EQ(feature.size(), 1);
+    const data::OFRecordBytes value0 = feature.bytes(0);
+    auto in_dptr = reinterpret_cast<const int8_t*>(value0.data);
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size);
     std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,
                    [](int8_t v) { return static_cast<T>(v); });
-  }
-#define DEFINE_ONE_ELIF(PbT, CppT)                                                       \
-  else if (feature.has_##PbT##_list()) {                                                 \
-    const auto& list = feature.PbT##_list();                                             \
-    const CppT* in_dptr = list.value().data();                                           \
-    const int64_t padding_elem_num = truncate ? sample_elem_cnt - list.value_size() : 0; \
-    if (truncate) {                                                                      \
-      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, list.value_size());           \
-    } else {                                                                             \
-      if (dim1_varying_length) {                                                         \
-        sample_elem_cnt = list.value_size();                                             \
-      } else {                                                                           \
-        CHECK_EQ(sample_elem_cnt, list.value_size());                                    \
-      }                                                                                  \
-    }                                                                                    \
-    std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,                             \
-                   [](CppT v) { return static_cast<T>(v); });                            \
-    if (padding_elem_num > 0) {                                                          \
-      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));              \
-    }                                                                                    \
-  }
-  DEFINE_ONE_ELIF(float, float)
-  DEFINE_ONE_ELIF(double, double)
-  DEFINE_ONE_ELIF(int32, int32_t)
-  DEFINE_ONE_ELIF(int64, int64_t)
-#undef DEFINE_ONE_ELIF
-  else {
+  } else if (feature.kind() != data::OFRecordFeatureView::kNone) {
+    const int64_t list_size = feature.size();
+    const int64_t padding_elem_num = truncate ? sample_elem_cnt - list_size : 0;
+    if (truncate) {
+      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, list_size);
+    } else {
+      if (dim1_varying_length) {
+        sample_elem_cnt = list_size;
+      } else {
+        CHECK_EQ(sample_elem_cnt, list_size);
+      }
+    }
+    feature.CopyTo(dptr, sample_elem_cnt);
+    if (padding_elem_num > 0) {
+      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+    }
+  } else {
     UNIMPLEMENTED();
   }
 }
@@ -91,7 +101,6 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
@@ -99,22 +108,20 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
-      CHECK(record.feature().find(name) != record.feature().end())
-          << "Field " << name << " not found";
-      const Feature& feature = record.feature().at(name);
-      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, truncate, dim1_varying_length);
+      DecodeOneRawOFRecord(FindFeature(in_blob, i, name), dptr, sample_elem_cnt, truncate,
+                           dim1_varying_length);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                       \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                   \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                            \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)            \
-                       && (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                                \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                            \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)         \
+                           || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)) \
                        && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
 REGISTER_RAW_DECODER_KERNEL(char)
@@ -135,23 +142,19 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     CHECK_EQ(out->shape(), in->shape());
-    CHECK_EQ(in->data_type(), DataType::kOFRecord);
     CHECK_EQ(out->data_type(), DataType::kTensorBuffer);
     const int64_t num_instances = in->shape().elem_cnt();
-    const auto* records = in->dptr<OFRecord>();
     auto* buffers = out->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     MultiThreadLoop(num_instances, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
-      auto it = record.feature().find(name);
-      CHECK(it != record.feature().end()) << "Field " << name << " not found";
-      const Feature& feature = it->second;
-      CHECK(feature.has_bytes_list());
-      CHECK_EQ(feature.bytes_list().value_size(), 1);
-      const int64_t size = feature.bytes_list().value(0).size();
+      const data::OFRecordFeatureView feature = FindFeature(in, i, name);
+      CHECK_EQ(feature.kind(), data::OFRecordFeatureView::kBytesList);
+      CHECK_EQ(feature.size(), 1);
+      const data::OFRecordBytes value0 = feature.bytes(0);
+      const int64_t size = value0.size;
       buffer->Resize(Shape({size}), DataType::kUInt8);
-      memcpy(buffer->mut_data(), feature.bytes_list().value(0).data(), size);
+      memcpy(buffer->mut_data(), value0.data, size);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -160,31 +163,30 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_bytes_decoder")
     .SetCreateFn<OFRecordBytesDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 namespace {
 
-void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
-                                        const std::string& name, const std::string& color_space,
+void DecodeRandomCropImageFromOneRecord(const data::OFRecordFeatureView& feature,
+                                        TensorBuffer* buffer, const std::string& color_space,
                                         RandomCropGenerator* random_crop_gen) {
-  CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
-  const Feature& feature = record.feature().at(name);
-  CHECK(feature.has_bytes_list());
-  CHECK(feature.bytes_list().value_size() == 1);
-  const std::string& src_data = feature.bytes_list().value(0);
+  CHECK_EQ(feature.kind(), data::OFRecordFeatureView::kBytesList);
+  CHECK(feature.size() == 1);
+  const data::OFRecordBytes src_data = feature.bytes(0);
   cv::Mat image;
 
-  if (JpegPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data()),
-                                       src_data.size(), random_crop_gen, nullptr, 0, &image)) {
+  if (JpegPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data),
+                                       src_data.size, random_crop_gen, nullptr, 0, &image)) {
     // convert color space
     // jpeg decode output RGB
     if (ImageUtil::IsColor(color_space) && color_space != "RGB") {
       ImageUtil::ConvertColor("RGB", image, color_space, image);
     }
   } else {
-    OpenCvPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data()),
-                                       src_data.size(), random_crop_gen, color_space, image);
+    OpenCvPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data),
+                                       src_data.size, random_crop_gen, color_space, image);
     // convert color space
     // opencv decode output BGR
     if (ImageUtil::IsColor(color_space) && color_space != "BGR") {
@@ -227,16 +229,14 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
       RandomCropGenerator* gen = crop_window_generators->GetGenerator(i);
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, gen);
+      DecodeRandomCropImageFromOneRecord(FindFeature(in_blob, i, name), buffer, color_space, gen);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -245,7 +245,8 @@ class OFRecordImageDecoderRandomCropKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder_random_crop")
     .SetCreateFn<OFRecordImageDecoderRandomCropKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 class OFRecordImageDecoderKernel final : public user_op::OpKernel {
@@ -260,15 +261,14 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
     CHECK(record_num > 0);
     user_op::Tensor* in_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     CHECK_EQ(out_blob->shape(), in_blob->shape());
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     TensorBuffer* buffers = out_blob->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
     const std::string& color_space = ctx->Attr<std::string>("color_space");
 
     MultiThreadLoop(record_num, [&](size_t i) {
-      const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
-      DecodeRandomCropImageFromOneRecord(record, buffer, name, color_space, nullptr);
+      DecodeRandomCropImageFromOneRecord(FindFeature(in_blob, i, name), buffer, color_space,
+                                         nullptr);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -277,7 +277,8 @@ class OFRecordImageDecoderKernel final : public user_op::OpKernel {
 REGISTER_USER_KERNEL("ofrecord_image_decoder")
     .SetCreateFn<OFRecordImageDecoderKernel>()
     .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
-                     && (user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                     && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)
+                         || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer))
                      && (user_op::HobDataType("out", 0) == DataType::kTensorBuffer));
 
 }  // namespace oneflow
@@ -0,0 +1,417 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/embedding/embedding_manager.h"
+#include "oneflow/core/embedding/sparse_update.cuh"
+
+namespace oneflow {
+
+namespace {
+
+// Prefetches on a stream and a thread of its own, so that neither the compute stream nor the
+// thread launching the kernels waits for the store. At most one prefetch is in flight, the next
+// one waits for it before reusing the ids buffer.
+class EmbeddingPrefetchKernelState final : public user_op::OpKernelState {
+ public:
+  explicit EmbeddingPrefetchKernelState(user_op::KernelInitContext* ctx)
+      : device_index_(-1), pending_(false), shutdown_(false) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    embedding::KeyValueStoreOptions options(ctx->Attr<std::string>("key_value_store_options"));
+    const user_op::TensorDesc* unique_ids = ctx->TensorDesc4ArgNameAndIndex("unique_ids", 0);
+    max_num_ids_ = unique_ids->shape().elem_cnt();
+    key_size_ = options.KeySize();
+    key_value_store_ = Global<embedding::EmbeddingManager>::Get()->GetOrCreateKeyValueStore(
+        options, ctx->parallel_ctx().parallel_id(), ctx->parallel_ctx().parallel_num(),
+        max_num_ids_);
+    OF_CUDA_CHECK(cudaMalloc(&ids_, max_num_ids_ * key_size_));
+    OF_CUDA_CHECK(cudaMalloc(&num_ids_, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaMallocHost(&host_num_ids_, sizeof(uint32_t)));
+    OF_CUDA_CHECK(cudaEventCreateWithFlags(&ids_ready_, cudaEventDisableTiming));
+    device_ = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCUDA,
+                                                                  device_index_);
+    stream_ = device_->CreateStream();
+    thread_ = std::thread(&EmbeddingPrefetchKernelState::PollTasks, this);
+  }
+  ~EmbeddingPrefetchKernelState() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+    CudaCurrentDeviceGuard guard(device_index_);
+    device_->DestroyStream(stream_);
+    OF_CUDA_CHECK(cudaEventDestroy(ids_ready_));
+    OF_CUDA_CHECK(cudaFree(ids_));
+    OF_CUDA_CHECK(cudaFree(num_ids_));
+    OF_CUDA_CHECK(cudaFreeHost(host_num_ids_));
+  }
+
+  // Copies the ids on the compute stream and hands them to the prefetch thread, which starts once
+  // the copy is done on its own stream.
+  void Schedule(ep::Stream* stream, const void* num_unique_ids, const void* unique_ids) {
+    WaitUntilDone();
+    cudaStream_t cuda_stream = stream->As<ep::CudaStream>()->cuda_stream();
+    OF_CUDA_CHECK(cudaMemcpyAsync(num_ids_, num_unique_ids, sizeof(uint32_t), cudaMemcpyDefault,
+                                  cuda_stream));
+    OF_CUDA_CHECK(cudaMemcpyAsync(ids_, unique_ids, max_num_ids_ * key_size_, cudaMemcpyDefault,
+                                  cuda_stream));
+    OF_CUDA_CHECK(cudaEventRecord(ids_ready_, cuda_stream));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = true;
+    }
+    cond_.notify_all();
+  }
+
+  void WaitUntilDone() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return !pending_; });
+  }
+
+ private:
+  void PollTasks() {
+    OF_CUDA_CHECK(cudaSetDevice(device_index_));
+    cudaStream_t cuda_stream = stream_->As<ep::CudaStream>()->cuda_stream();
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&]() { return pending_ || shutdown_; });
+        if (!pending_) { break; }
+      }
+      OF_CUDA_CHECK(cudaStreamWaitEvent(cuda_stream, ids_ready_, 0));
+      OF_CUDA_CHECK(cudaMemcpyAsync(host_num_ids_, num_ids_, sizeof(uint32_t), cudaMemcpyDefault,
+                                    cuda_stream));
+      CHECK_JUST(stream_->Sync());
+      key_value_store_->Prefetch(stream_, *host_num_ids_, ids_);
+      CHECK_JUST(stream_->Sync());
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = false;
+      }
+      cond_.notify_all();
+    }
+  }
+
+  int device_index_;
+  int64_t max_num_ids_;
+  uint32_t key_size_;
+  embedding::KeyValueStore* key_value_store_;
+  void* ids_;
+  uint32_t* num_ids_;
+  uint32_t* host_num_ids_;
+  cudaEvent_t ids_ready_;
+  std::shared_ptr<ep::Device> device_;
+  ep::Stream* stream_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool pending_;
+  bool shutdown_;
+  std::thread thread_;
+};
+
+}  // namespace
+
+class EmbeddingPrefetchKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingPrefetchKernel() = default;
+  ~EmbeddingPrefetchKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<EmbeddingPrefetchKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<EmbeddingPrefetchKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    user_op::Tensor* context = ctx->Tensor4ArgNameAndIndex("context", 0);
+    kernel_state->Schedule(ctx->stream(), num_unique_ids->dptr(), unique_ids->dptr());
+    OF_CUDA_CHECK(cudaMemcpyAsync(context->mut_dptr(), num_unique_ids->dptr(), sizeof(uint32_t),
+                                  cudaMemcpyDefault,
+                                  ctx->stream()->As<ep::CudaStream>()->cuda_stream()));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("embedding_prefetch")
+    .SetCreateFn<EmbeddingPrefetchKernel>()
+    .SetIsMatchedHob(user_op::HobDeviceType() == DeviceType::kCUDA);
+
+namespace {
+
+embedding::SparseUpdateOptions::Optimizer ParseOptimizer(const std::string& optimizer) {
+  if (optimizer == "sgd") {
+    return embedding::SparseUpdateOptions::Optimizer::kSGD;
+  } else if (optimizer == "momentum") {
+    return embedding::SparseUpdateOptions::Optimizer::kMomentum;
+  } else if (optimizer == "adam") {
+    return embedding::SparseUpdateOptions::Optimizer::kAdam;
+  } else if (optimizer == "adagrad") {
+    return embedding::SparseUpdateOptions::Optimizer::kAdagrad;
+  } else {
+    UNIMPLEMENTED();
+    return embedding::SparseUpdateOptions::Optimizer::kSGD;
+  }
+}
+
+template<typename Key>
+__global__ void GatherMissingKernel(uint32_t elem_cnt, uint32_t embedding_size,
+                                    const uint32_t* missing_indices, const Key* keys,
+                                    const float* model_diff, Key* missing_keys,
+                                    float* missing_diff) {
+  CUDA_1D_KERNEL_LOOP(i, elem_cnt) {
+    const uint32_t row = i / embedding_size;
+    const uint32_t col = i - row * embedding_size;
+    const uint32_t index = missing_indices[row];
+    if (col == 0) { missing_keys[row] = keys[index]; }
+    missing_diff[i] = model_diff[index * embedding_size + col];
+  }
+}
+
+__global__ void ZeroMissingRowsKernel(uint32_t max_elem_cnt, uint32_t value_length,
+                                      const uint32_t* n_missing, const uint32_t* missing_indices,
+                                      float* values) {
+  const uint32_t missing_elem_cnt = *n_missing * value_length;
+  CUDA_1D_KERNEL_LOOP(i, max_elem_cnt) {
+    if (i < missing_elem_cnt) {
+      const uint32_t row = i / value_length;
+      const uint32_t col = i - row * value_length;
+      values[missing_indices[row] * value_length + col] = 0;
+    }
+  }
+}
+
+template<embedding::SparseUpdateOptions::Optimizer optimizer>
+__global__ void SparseUpdateRowsKernel(uint32_t diff_elem_cnt, uint32_t value_length,
+                                       embedding::SparseUpdateOptions options,
+                                       const float* model_diff, float* values) {
+  const uint32_t embedding_size = options.embedding_size;
+  CUDA_1D_KERNEL_LOOP(i, diff_elem_cnt) {
+    const uint32_t row = i / embedding_size;
+    const uint32_t col = i - row * embedding_size;
+    embedding::SparseUpdateElem<optimizer>(options, values + row * value_length + col,
+                                           model_diff[i]);
+  }
+}
+
+class EmbeddingUpdateTmpBufferManager final {
+ public:
+  EmbeddingUpdateTmpBufferManager(void* ptr, int64_t num_keys, int64_t key_size,
+                                  int64_t value_size, int64_t embedding_size)
+      : ptr_(ptr) {
+    values_offset_ = 0;
+    missing_keys_offset_ = values_offset_ + GetCudaAlignedSize(num_keys * value_size);
+    missing_diff_offset_ = missing_keys_offset_ + GetCudaAlignedSize(num_keys * key_size);
+    n_missing_offset_ =
+        missing_diff_offset_ + GetCudaAlignedSize(num_keys * embedding_size * sizeof(float));
+    missing_indices_offset_ = n_missing_offset_ + GetCudaAlignedSize(sizeof(uint32_t));
+    total_buffer_size_ =
+        missing_indices_offset_ + GetCudaAlignedSize(num_keys * sizeof(uint32_t));
+  }
+  ~EmbeddingUpdateTmpBufferManager() = default;
+
+  size_t TotalBufferSize() const { return total_buffer_size_; }
+
+  float* Values() const { return Ptr<float>(values_offset_); }
+  void* MissingKeys() const { return Ptr<void>(missing_keys_offset_); }
+  float* MissingDiff() const { return Ptr<float>(missing_diff_offset_); }
+  uint32_t* NumMissing() const { return Ptr<uint32_t>(n_missing_offset_); }
+  uint32_t* MissingIndices() const { return Ptr<uint32_t>(missing_indices_offset_); }
+
+ private:
+  template<typename U>
+  U* Ptr(size_t offset) const {
+    CHECK(ptr_ != nullptr);
+    return reinterpret_cast<U*>(reinterpret_cast<char*>(ptr_) + offset);
+  }
+
+  size_t values_offset_;
+  size_t missing_keys_offset_;
+  size_t missing_diff_offset_;
+  size_t n_missing_offset_;
+  size_t missing_indices_offset_;
+  size_t total_buffer_size_;
+  void* ptr_;
+};
+
+class EmbeddingUpdateKernelState final : public user_op::OpKernelState {
+ public:
+  explicit EmbeddingUpdateKernelState(user_op::KernelInitContext* ctx) : device_index_(-1) {
+    OF_CUDA_CHECK(cudaGetDevice(&device_index_));
+    embedding::KeyValueStoreOptions options(ctx->Attr<std::string>("key_value_store_options"));
+    key_value_store_ = Global<embedding::EmbeddingManager>::Get()->GetOrCreateKeyValueStore(
+        options, ctx->parallel_ctx().parallel_id(), ctx->parallel_ctx().parallel_num(),
+        ctx->TensorDesc4ArgNameAndIndex("unique_ids", 0)->shape().elem_cnt());
+    OF_CUDA_CHECK(cudaMallocHost(&host_num_keys_, sizeof(uint32_t)));
+  }
+  ~EmbeddingUpdateKernelState() override {
+    CudaCurrentDeviceGuard guard(device_index_);
+    OF_CUDA_CHECK(cudaFreeHost(host_num_keys_));
+  }
+
+  embedding::KeyValueStore* KeyValueStore() const { return key_value_store_; }
+
+  uint32_t SyncNumKeys(ep::Stream* stream, const uint32_t* num_keys) {
+    OF_CUDA_CHECK(cudaMemcpyAsync(host_num_keys_, num_keys, sizeof(uint32_t), cudaMemcpyDefault,
+                                  stream->As<ep::CudaStream>()->cuda_stream()));
+    CHECK_JUST(stream->Sync());
+    return *host_num_keys_;
+  }
+
+ private:
+  int device_index_;
+  embedding::KeyValueStore* key_value_store_;
+  uint32_t* host_num_keys_;
+};
+
+template<typename Key>
+void UpdateRows(ep::Stream* stream, embedding::KeyValueStore* store,
+                const embedding::SparseUpdateOptions& options,
+                const EmbeddingUpdateTmpBufferManager& buffer_manager, uint32_t num_keys,
+                const Key* keys, const float* model_diff) {
+  const uint32_t value_length = store->ValueSize() / sizeof(float);
+  store->Get(stream, num_keys, keys, buffer_manager.Values(), buffer_manager.NumMissing(),
+             buffer_manager.MissingIndices());
+  // Rows not in the store start from zero, as the lookups see them.
+  const uint32_t values_elem_cnt = num_keys * value_length;
+  RUN_CUDA_KERNEL(ZeroMissingRowsKernel, stream, values_elem_cnt, values_elem_cnt, value_length,
+                  buffer_manager.NumMissing(), buffer_manager.MissingIndices(),
+                  buffer_manager.Values());
+  const uint32_t diff_elem_cnt = num_keys * options.embedding_size;
+#define LAUNCH_SPARSE_UPDATE_ROWS_KERNEL(optimizer)                                               \
+  RUN_CUDA_KERNEL((SparseUpdateRowsKernel<optimizer>), stream, diff_elem_cnt, diff_elem_cnt,      \
+                  value_length, options, model_diff, buffer_manager.Values())
+  if (options.optimizer == embedding::SparseUpdateOptions::Optimizer::kSGD) {
+    LAUNCH_SPARSE_UPDATE_ROWS_KERNEL(embedding::SparseUpdateOptions::Optimizer::kSGD);
+  } else if (options.optimizer == embedding::SparseUpdateOptions::Optimizer::kMomentum) {
+    LAUNCH_SPARSE_UPDATE_ROWS_KERNEL(embedding::SparseUpdateOptions::Optimizer::kMomentum);
+  } else if (options.optimizer == embedding::SparseUpdateOptions::Optimizer::kAdam) {
+    LAUNCH_SPARSE_UPDATE_ROWS_KERNEL(embedding::SparseUpdateOptions::Optimizer::kAdam);
+  } else if (options.optimizer == embedding::SparseUpdateOptions::Optimizer::kAdagrad) {
+    LAUNCH_SPARSE_UPDATE_ROWS_KERNEL(embedding::SparseUpdateOptions::Optimizer::kAdagrad);
+  } else {
+    UNIMPLEMENTED();
+  }
+#undef LAUNCH_SPARSE_UPDATE_ROWS_KERNEL
+  store->Put(stream, num_keys, keys, buffer_manager.Values());
+}
+
+}  // namespace
+
+template<typename Key>
+class EmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingUpdateKernel() = default;
+  ~EmbeddingUpdateKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<EmbeddingUpdateKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<EmbeddingUpdateKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    embedding::KeyValueStore* store = kernel_state->KeyValueStore();
+    CHECK_EQ(store->KeySize(), sizeof(Key));
+    const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+    const user_op::Tensor* unique_ids = ctx->Tensor4ArgNameAndIndex("unique_ids", 0);
+    const user_op::Tensor* embedding_diff = ctx->Tensor4ArgNameAndIndex("embedding_diff", 0);
+    const user_op::Tensor* learning_rate = ctx->Tensor4ArgNameAndIndex("learning_rate", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    embedding::SparseUpdateOptions options;
+    options.optimizer = ParseOptimizer(ctx->Attr<std::string>("optimizer"));
+    options.embedding_size = embedding_diff->shape().At(1);
+    options.learning_rate_ptr = learning_rate->dptr<float>();
+    options.scale = ctx->Attr<double>("scale");
+    options.weight_decay = ctx->Attr<float>("weight_decay");
+    options.beta = ctx->Attr<float>("beta");
+    options.beta1 = ctx->Attr<float>("beta1");
+    options.beta2 = ctx->Attr<float>("beta2");
+    options.epsilon = ctx->Attr<float>("epsilon");
+    if (ctx->has_input("bias_correction1", 0)) {
+      options.bias_correction1_ptr =
+          ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+      options.bias_correction2_ptr =
+          ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    EmbeddingUpdateTmpBufferManager buffer_manager(
+        tmp_buffer->mut_dptr(), unique_ids->shape().elem_cnt(), sizeof(Key), store->ValueSize(),
+        options.embedding_size);
+    const uint32_t num_keys =
+        kernel_state->SyncNumKeys(ctx->stream(), num_unique_ids->dptr<uint32_t>());
+    const Key* keys = unique_ids->dptr<Key>();
+    const float* model_diff = embedding_diff->dptr<float>();
+    if (!store->SupportsUpdate()) {
+      UpdateRows<Key>(ctx->stream(), store, options, buffer_manager, num_keys, keys, model_diff);
+      return;
+    }
+    // Update the rows held by the first tier in place, the others through Get and Put.
+    store->Update(ctx->stream(), num_keys, keys, model_diff, options, buffer_manager.NumMissing(),
+                  buffer_manager.MissingIndices());
+    const uint32_t num_missing =
+        kernel_state->SyncNumKeys(ctx->stream(), buffer_manager.NumMissing());
+    if (num_missing == 0) { return; }
+    const uint32_t missing_elem_cnt = num_missing * options.embedding_size;
+    RUN_CUDA_KERNEL(GatherMissingKernel<Key>, ctx->stream(), missing_elem_cnt, missing_elem_cnt,
+                    options.embedding_size, buffer_manager.MissingIndices(), keys, model_diff,
+                    static_cast<Key*>(buffer_manager.MissingKeys()),
+                    buffer_manager.MissingDiff());
+    UpdateRows<Key>(ctx->stream(), store, options, buffer_manager, num_missing,
+                    static_cast<const Key*>(buffer_manager.MissingKeys()),
+                    buffer_manager.MissingDiff());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_CUDA_EMBEDDING_UPDATE_KERNEL(key_dtype_pair)                                     \
+  REGISTER_USER_KERNEL("embedding_update")                                                        \
+      .SetCreateFn<EmbeddingUpdateKernel<OF_PP_PAIR_FIRST(key_dtype_pair)>>()                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)                            \
+                       && (user_op::HobDataType("unique_ids", 0)                                  \
+                           == OF_PP_PAIR_SECOND(key_dtype_pair)))                                 \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& unique_ids = ctx->InputTensorDesc("unique_ids", 0);            \
+        const user_op::TensorDesc& embedding_diff = ctx->InputTensorDesc("embedding_diff", 0);    \
+        embedding::KeyValueStoreOptions options(                                                  \
+            ctx->Attr<std::string>("key_value_store_options"));                                   \
+        EmbeddingUpdateTmpBufferManager buffer_manager(                                           \
+            nullptr, unique_ids.shape().elem_cnt(), sizeof(OF_PP_PAIR_FIRST(key_dtype_pair)),     \
+            options.ValueSize(), embedding_diff.shape().At(1));                                   \
+        return buffer_manager.TotalBufferSize();                                                  \
+      });
+
+#define KEY_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64)
+
+OF_PP_FOR_EACH_TUPLE(REGISTER_CUDA_EMBEDDING_UPDATE_KERNEL, KEY_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
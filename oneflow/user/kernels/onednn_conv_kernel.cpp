@@ -0,0 +1,175 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_ONEDNN
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/onednn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Splits the first axis, of the output channels, of a conv weight into the groups.
+void SplitGroups(int64_t groups, dnnl::memory::dims* dims, dnnl::memory::dims* strides) {
+  if (groups == 1) { return; }
+  dims->at(0) /= groups;
+  dims->insert(dims->begin(), groups);
+  strides->insert(strides->begin(), strides->at(0) * dims->at(1));
+}
+
+class OneDnnConvKernel final : public user_op::OpKernel {
+ public:
+  OneDnnConvKernel() = default;
+  ~OneDnnConvKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = nullptr;
+    if (ctx->has_input("bias", 0)) { bias = ctx->Tensor4ArgNameAndIndex("bias", 0); }
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const bool channels_last = ctx->Attr<std::string>("data_format") == "channels_last";
+    const int32_t groups = ctx->Attr<int32_t>("groups");
+    const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+    const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+    const auto& dilation_rate = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+
+    dnnl::memory::dims src_dims, src_strides, weight_dims, weight_strides, dst_dims, dst_strides;
+    GetOneDnnChannelsDimsAndStrides(in->shape(), channels_last, &src_dims, &src_strides);
+    GetOneDnnChannelsDimsAndStrides(weight->shape(), channels_last, &weight_dims, &weight_strides);
+    SplitGroups(groups, &weight_dims, &weight_strides);
+    GetOneDnnChannelsDimsAndStrides(out->shape(), channels_last, &dst_dims, &dst_strides);
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc src_md(src_dims, data_type, src_strides);
+    const dnnl::memory::desc weight_md(weight_dims, data_type, weight_strides);
+    const dnnl::memory::desc dst_md(dst_dims, data_type, dst_strides);
+    const dnnl::memory::desc bias_md({dst_dims.at(1)}, data_type, dnnl::memory::format_tag::a);
+    // oneDNN counts the dilation from 0. The output sizes are floored as in oneflow, so the
+    // padding after is taken the same as the padding before.
+    dnnl::memory::dims dilates = OneDnnDims(dilation_rate);
+    for (auto& dilate : dilates) { dilate -= 1; }
+    const dnnl::memory::dims padding = OneDnnDims(padding_before);
+
+    const auto Create = [&](const dnnl::engine& engine) -> dnnl::primitive {
+      // The library picks winograd or direct convolution.
+      const auto desc =
+          bias != nullptr
+              ? dnnl::convolution_forward::desc(
+                  dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, src_md,
+                  weight_md, bias_md, dst_md, OneDnnDims(strides), dilates, padding, padding)
+              : dnnl::convolution_forward::desc(
+                  dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, src_md,
+                  weight_md, dst_md, OneDnnDims(strides), dilates, padding, padding);
+      return dnnl::convolution_forward(dnnl::convolution_forward::primitive_desc(desc, engine));
+    };
+    std::unordered_map<int, dnnl::memory> args{
+        {DNNL_ARG_SRC, OneDnnMemory(ctx->stream(), src_md, in->dptr())},
+        {DNNL_ARG_WEIGHTS, OneDnnMemory(ctx->stream(), weight_md, weight->dptr())},
+        {DNNL_ARG_DST, OneDnnMemory(ctx->stream(), dst_md, out->mut_dptr())}};
+    if (bias != nullptr) {
+      args.emplace(DNNL_ARG_BIAS, OneDnnMemory(ctx->stream(), bias_md, bias->dptr()));
+    }
+    const std::string key =
+        OneDnnPrimitiveKey(ctx->op_type_name(), src_dims, src_strides, weight_dims, weight_strides,
+                           dst_dims, bias != nullptr, strides, dilation_rate, padding_before);
+    ExecuteOneDnnPrimitive(ctx->stream(), key, Create, args);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+class OneDnnDeconvKernel final : public user_op::OpKernel {
+ public:
+  OneDnnDeconvKernel() = default;
+  ~OneDnnDeconvKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const bool channels_last = ctx->Attr<std::string>("data_format") == "channels_last";
+    const int32_t groups = ctx->Attr<int32_t>("groups");
+    const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+    const auto& output_padding = ctx->Attr<std::vector<int32_t>>("output_padding");
+    const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+    const auto& dilation_rate = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+
+    dnnl::memory::dims src_dims, src_strides, weight_dims, weight_strides, dst_dims, dst_strides;
+    GetOneDnnChannelsDimsAndStrides(in->shape(), channels_last, &src_dims, &src_strides);
+    // The weight of deconv is {I, O / groups, spatial...}, oneDNN takes {O, I, spatial...}, or
+    // {groups, O / groups, I / groups, spatial...} with groups.
+    GetOneDnnChannelsDimsAndStrides(weight->shape(), channels_last, &weight_dims, &weight_strides);
+    std::swap(weight_dims.at(0), weight_dims.at(1));
+    std::swap(weight_strides.at(0), weight_strides.at(1));
+    if (groups > 1) {
+      weight_dims.at(1) /= groups;
+      weight_dims.insert(weight_dims.begin(), groups);
+      weight_strides.insert(weight_strides.begin(), weight_strides.at(1) * weight_dims.at(2));
+    }
+    GetOneDnnChannelsDimsAndStrides(out->shape(), channels_last, &dst_dims, &dst_strides);
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc src_md(src_dims, data_type, src_strides);
+    const dnnl::memory::desc weight_md(weight_dims, data_type, weight_strides);
+    const dnnl::memory::desc dst_md(dst_dims, data_type, dst_strides);
+    dnnl::memory::dims dilates = OneDnnDims(dilation_rate);
+    for (auto& dilate : dilates) { dilate -= 1; }
+    const dnnl::memory::dims padding_l = OneDnnDims(padding_before);
+    // The output padding is taken off the padding after.
+    dnnl::memory::dims padding_r = padding_l;
+    for (size_t i = 0; i < padding_r.size(); ++i) { padding_r.at(i) -= output_padding.at(i); }
+
+    const auto Create = [&](const dnnl::engine& engine) -> dnnl::primitive {
+      const dnnl::deconvolution_forward::desc desc(
+          dnnl::prop_kind::forward_inference, dnnl::algorithm::deconvolution_direct, src_md,
+          weight_md, dst_md, OneDnnDims(strides), dilates, padding_l, padding_r);
+      return dnnl::deconvolution_forward(
+          dnnl::deconvolution_forward::primitive_desc(desc, engine));
+    };
+    ExecuteOneDnnPrimitive(
+        ctx->stream(),
+        OneDnnPrimitiveKey(ctx->op_type_name(), src_dims, src_strides, weight_dims,
+                           weight_strides, dst_dims, strides, dilation_rate, padding_l, padding_r),
+        Create,
+        {{DNNL_ARG_SRC, OneDnnMemory(ctx->stream(), src_md, in->dptr())},
+         {DNNL_ARG_WEIGHTS, OneDnnMemory(ctx->stream(), weight_md, weight->dptr())},
+         {DNNL_ARG_DST, OneDnnMemory(ctx->stream(), dst_md, out->mut_dptr())}});
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_ONEDNN_CONV_KERNEL(op_name, kernel, tensor_name)                         \
+  REGISTER_USER_KERNEL(#op_name)                                                          \
+      .SetCreateFn<kernel>()                                                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && (user_op::HobDataType(tensor_name, 0) == DataType::kFloat)      \
+                       && HobOneDnnKernelEnabled())                                       \
+      .SetPriority(user_op::kKernelPriorityOptimized)
+
+REGISTER_ONEDNN_CONV_KERNEL(conv1d, OneDnnConvKernel, "in");
+REGISTER_ONEDNN_CONV_KERNEL(conv2d, OneDnnConvKernel, "in");
+REGISTER_ONEDNN_CONV_KERNEL(conv3d, OneDnnConvKernel, "in");
+REGISTER_ONEDNN_CONV_KERNEL(deconv1d, OneDnnDeconvKernel, "out");
+REGISTER_ONEDNN_CONV_KERNEL(deconv2d, OneDnnDeconvKernel, "out");
+REGISTER_ONEDNN_CONV_KERNEL(deconv3d, OneDnnDeconvKernel, "out");
+
+}  // namespace
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
@@ -0,0 +1,132 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_ONEDNN
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/user/kernels/onednn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// The dims {batch, rows, cols} of a matrix, of which the last two axes are stored transposed if
+// transpose.
+void GetMatrixDimsAndStrides(const ShapeView& shape, bool transpose, dnnl::memory::dims* dims,
+                             dnnl::memory::dims* strides) {
+  const int64_t num_axes = shape.NumAxes();
+  const int64_t rows = shape.At(num_axes - 2);
+  const int64_t cols = shape.At(num_axes - 1);
+  const int64_t batch_size = shape.Count(0, num_axes - 2);
+  if (transpose) {
+    *dims = {batch_size, cols, rows};
+    *strides = {rows * cols, 1, cols};
+  } else {
+    *dims = {batch_size, rows, cols};
+    *strides = {rows * cols, cols, 1};
+  }
+}
+
+// matmul and batch_matmul, with alpha and _add_to_output fused into the primitive as the output
+// scale and a sum post-op.
+class OneDnnMatmulKernel final : public user_op::OpKernel {
+ public:
+  OneDnnMatmulKernel() = default;
+  ~OneDnnMatmulKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const bool transpose_a = ctx->Attr<bool>("transpose_a");
+    const bool transpose_b = ctx->Attr<bool>("transpose_b");
+    const double alpha = ctx->Attr<double>("alpha");
+    const bool add_to_output = ctx->has_input("_add_to_output", 0);
+    if (add_to_output) {
+      const user_op::Tensor* addend = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(addend->shape(), out->shape());
+      if (addend->dptr() != out->dptr()) {
+        auto memcpy = ep::primitive::NewPrimitive<ep::primitive::MemcpyFactory>(
+            ctx->device_type(), ep::primitive::MemcpyKind::kDtoD);
+        CHECK(memcpy);
+        memcpy->Launch(ctx->stream(), out->mut_dptr(), addend->dptr(),
+                       out->shape().elem_cnt() * GetSizeOfDataType(out->data_type()));
+      }
+    }
+    if (a->shape().elem_cnt() == 0) {
+      // The products of empty sums are zeros.
+      if (!add_to_output) {
+        std::memset(out->mut_dptr(), 0,
+                    out->shape().elem_cnt() * GetSizeOfDataType(out->data_type()));
+      }
+      return;
+    }
+    dnnl::memory::dims a_dims, a_strides, b_dims, b_strides, out_dims, out_strides;
+    GetMatrixDimsAndStrides(a->shape(), transpose_a, &a_dims, &a_strides);
+    GetMatrixDimsAndStrides(b->shape(), transpose_b, &b_dims, &b_strides);
+    GetMatrixDimsAndStrides(out->shape(), false, &out_dims, &out_strides);
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc a_md(a_dims, data_type, a_strides);
+    const dnnl::memory::desc b_md(b_dims, data_type, b_strides);
+    const dnnl::memory::desc out_md(out_dims, data_type, out_strides);
+
+    const auto Create = [&](const dnnl::engine& engine) -> dnnl::primitive {
+      dnnl::primitive_attr attr;
+      if (alpha != 1.0) { attr.set_output_scales(0, {static_cast<float>(alpha)}); }
+      if (add_to_output) {
+        dnnl::post_ops post_ops;
+        post_ops.append_sum(1.0f);
+        attr.set_post_ops(post_ops);
+      }
+      const dnnl::matmul::desc desc(a_md, b_md, out_md);
+      return dnnl::matmul(dnnl::matmul::primitive_desc(desc, attr, engine));
+    };
+    const std::string key = OneDnnPrimitiveKey("matmul", a_dims, a_strides, b_dims, b_strides,
+                                               out_dims, alpha, add_to_output);
+    ExecuteOneDnnPrimitive(ctx->stream(), key, Create,
+                           {{DNNL_ARG_SRC, OneDnnMemory(ctx->stream(), a_md, a->dptr())},
+                            {DNNL_ARG_WEIGHTS, OneDnnMemory(ctx->stream(), b_md, b->dptr())},
+                            {DNNL_ARG_DST, OneDnnMemory(ctx->stream(), out_md, out->mut_dptr())}});
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_ONEDNN_MATMUL_KERNEL(op_name)                                                \
+  REGISTER_USER_KERNEL(op_name)                                                               \
+      .SetCreateFn<OneDnnMatmulKernel>()                                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                         \
+                       && (user_op::HobDataType("out", 0) == DataType::kFloat)                \
+                       && HobOneDnnKernelEnabled())                                           \
+      .SetInplaceProposalFn(                                                                  \
+          [](const user_op::InferContext& ctx,                                                \
+             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {          \
+            if (ctx.has_input("_add_to_output", 0)) {                                         \
+              OF_RETURN_IF_ERROR(AddInplaceArgPairFn("out", 0, "_add_to_output", 0, true));   \
+            }                                                                                 \
+            return Maybe<void>::Ok();                                                         \
+          })                                                                                  \
+      .SetPriority(user_op::kKernelPriorityOptimized)
+
+REGISTER_ONEDNN_MATMUL_KERNEL("matmul");
+REGISTER_ONEDNN_MATMUL_KERNEL("batch_matmul");
+
+}  // namespace
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
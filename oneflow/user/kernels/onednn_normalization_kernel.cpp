@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_ONEDNN
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/onednn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Batch normalization in inference, with the channels on the second axis or the last one.
+class OneDnnNormalizationInferenceKernel final : public user_op::OpKernel {
+ public:
+  OneDnnNormalizationInferenceKernel() = default;
+  ~OneDnnNormalizationInferenceKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const user_op::Tensor* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    const user_op::Tensor* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    CHECK(moving_mean != nullptr && moving_variance != nullptr);
+    const int32_t axis = ctx->Attr<int32_t>("axis");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    const bool channels_last = axis != 1;
+    CHECK(!channels_last || axis == x->shape().NumAxes() - 1);
+
+    dnnl::memory::dims dims, strides;
+    GetOneDnnChannelsDimsAndStrides(x->shape(), channels_last, &dims, &strides);
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc data_md(dims, data_type, strides);
+    const dnnl::memory::desc channel_md({dims.at(1)}, data_type, dnnl::memory::format_tag::a);
+
+    const auto Create = [&](const dnnl::engine& engine) -> dnnl::primitive {
+      const dnnl::batch_normalization_forward::desc desc(
+          dnnl::prop_kind::forward_inference, data_md, epsilon,
+          dnnl::normalization_flags::use_global_stats | dnnl::normalization_flags::use_scale
+              | dnnl::normalization_flags::use_shift);
+      return dnnl::batch_normalization_forward(
+          dnnl::batch_normalization_forward::primitive_desc(desc, engine));
+    };
+    const std::string key = OneDnnPrimitiveKey("normalization", dims, strides, epsilon);
+    ep::Stream* stream = ctx->stream();
+    ExecuteOneDnnPrimitive(
+        stream, key, Create,
+        {{DNNL_ARG_SRC, OneDnnMemory(stream, data_md, x->dptr())},
+         {DNNL_ARG_MEAN, OneDnnMemory(stream, channel_md, moving_mean->dptr())},
+         {DNNL_ARG_VARIANCE, OneDnnMemory(stream, channel_md, moving_variance->dptr())},
+         {DNNL_ARG_SCALE, OneDnnMemory(stream, channel_md, gamma->dptr())},
+         {DNNL_ARG_SHIFT, OneDnnMemory(stream, channel_md, beta->dptr())},
+         {DNNL_ARG_DST, OneDnnMemory(stream, data_md, y->mut_dptr())}});
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+auto OneDnnNormalizationSupported() {
+  return hob::make_custom("OneDnnNormalizationSupported", [](const user_op::KernelRegContext& ctx) {
+    const int32_t axis = ctx.Attr<int32_t>("axis");
+    const int64_t num_axes = ctx.TensorDesc4ArgNameAndIndex("x", 0)->shape().NumAxes();
+    // The generic kernel adds _add_to_output in place, which oneDNN has no post-op for here.
+    return !ctx.user_op_conf().has_input("_add_to_output", 0)
+           && ctx.user_op_conf().has_input("moving_mean", 0)
+           && (axis == 1 || (num_axes >= 3 && axis == num_axes - 1));
+  });
+}
+
+REGISTER_USER_KERNEL("normalization")
+    .SetCreateFn<OneDnnNormalizationInferenceKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("y", 0) == DataType::kFloat)
+                     && (user_op::HobAttr<bool>("training") == false)
+                     && OneDnnNormalizationSupported() && HobOneDnnKernelEnabled())
+    .SetPriority(user_op::kKernelPriorityOptimized);
+
+}  // namespace
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
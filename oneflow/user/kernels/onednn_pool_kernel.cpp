@@ -0,0 +1,121 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_ONEDNN
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/onednn_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// avgpool_{1,2,3}d and tf_{avg,max}_pool_{1,2,3}d. maxpool_{1,2,3}d are left to the generic
+// kernels since oneDNN does not output the indices they return.
+class OneDnnPoolKernel final : public user_op::OpKernel {
+ public:
+  OneDnnPoolKernel() = default;
+  ~OneDnnPoolKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const bool channels_last = ctx->Attr<std::string>("data_format") == "channels_last";
+    const bool is_tf_pool = ctx->op_type_name().rfind("tf_", 0) == 0;
+    dnnl::algorithm algorithm = dnnl::algorithm::pooling_max;
+    std::vector<int32_t> kernel_size;
+    std::vector<int32_t> strides;
+    std::vector<int32_t> padding_before;
+    if (is_tf_pool) {
+      kernel_size = ctx->Attr<std::vector<int32_t>>("pool_size");
+      strides = ctx->Attr<std::vector<int32_t>>("strides");
+      padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+      if (ctx->op_type_name().rfind("tf_avg_pool", 0) == 0) {
+        algorithm = dnnl::algorithm::pooling_avg_exclude_padding;
+      }
+    } else {
+      kernel_size = ctx->Attr<std::vector<int32_t>>("kernel_size");
+      strides = ctx->Attr<std::vector<int32_t>>("stride");
+      padding_before = ctx->Attr<std::vector<int32_t>>("padding");
+      algorithm = ctx->Attr<bool>("count_include_pad")
+                      ? dnnl::algorithm::pooling_avg_include_padding
+                      : dnnl::algorithm::pooling_avg_exclude_padding;
+    }
+
+    dnnl::memory::dims src_dims, src_strides, dst_dims, dst_strides;
+    GetOneDnnChannelsDimsAndStrides(x->shape(), channels_last, &src_dims, &src_strides);
+    GetOneDnnChannelsDimsAndStrides(y->shape(), channels_last, &dst_dims, &dst_strides);
+    const dnnl::memory::dims padding_l = OneDnnDims(padding_before);
+    // The padding after covering the last window, which the windows of ceil mode overhang.
+    dnnl::memory::dims padding_r(padding_l.size());
+    for (size_t i = 0; i < padding_r.size(); ++i) {
+      padding_r.at(i) = std::max<int64_t>((dst_dims.at(i + 2) - 1) * strides.at(i)
+                                              + kernel_size.at(i) - src_dims.at(i + 2)
+                                              - padding_l.at(i),
+                                          0);
+    }
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc src_md(src_dims, data_type, src_strides);
+    const dnnl::memory::desc dst_md(dst_dims, data_type, dst_strides);
+
+    const auto Create = [&](const dnnl::engine& engine) -> dnnl::primitive {
+      const dnnl::pooling_forward::desc desc(dnnl::prop_kind::forward_inference, algorithm, src_md,
+                                             dst_md, OneDnnDims(strides), OneDnnDims(kernel_size),
+                                             padding_l, padding_r);
+      return dnnl::pooling_forward(dnnl::pooling_forward::primitive_desc(desc, engine));
+    };
+    const std::string key =
+        OneDnnPrimitiveKey("pool", static_cast<int>(algorithm), src_dims, src_strides, dst_dims,
+                           dst_strides, kernel_size, strides, padding_l, padding_r);
+    ExecuteOneDnnPrimitive(ctx->stream(), key, Create,
+                           {{DNNL_ARG_SRC, OneDnnMemory(ctx->stream(), src_md, x->dptr())},
+                            {DNNL_ARG_DST, OneDnnMemory(ctx->stream(), dst_md, y->mut_dptr())}});
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_ONEDNN_POOL_KERNEL(op_name, extra_hob)                                  \
+  REGISTER_USER_KERNEL(op_name)                                                          \
+      .SetCreateFn<OneDnnPoolKernel>()                                                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                    \
+                       && (user_op::HobDataType("x", 0) == DataType::kFloat) && extra_hob \
+                       && HobOneDnnKernelEnabled())                                      \
+      .SetPriority(user_op::kKernelPriorityOptimized)
+
+// The divisor of the windows overhanging the padding in ceil mode, and an overridden divisor, are
+// not those of oneDNN.
+#define AVG_POOL_HOB                                  \
+  (user_op::HobAttr<bool>("ceil_mode") == false)      \
+      && (user_op::HobAttr<int32_t>("divisor_override") == 0)
+
+REGISTER_ONEDNN_POOL_KERNEL("avgpool_1d", AVG_POOL_HOB);
+REGISTER_ONEDNN_POOL_KERNEL("avgpool_2d", AVG_POOL_HOB);
+REGISTER_ONEDNN_POOL_KERNEL("avgpool_3d", AVG_POOL_HOB);
+REGISTER_ONEDNN_POOL_KERNEL("tf_avg_pool_1d", user_op::HobTrue());
+REGISTER_ONEDNN_POOL_KERNEL("tf_avg_pool_2d", user_op::HobTrue());
+REGISTER_ONEDNN_POOL_KERNEL("tf_avg_pool_3d", user_op::HobTrue());
+REGISTER_ONEDNN_POOL_KERNEL("tf_max_pool_1d", user_op::HobTrue());
+REGISTER_ONEDNN_POOL_KERNEL("tf_max_pool_2d", user_op::HobTrue());
+REGISTER_ONEDNN_POOL_KERNEL("tf_max_pool_3d", user_op::HobTrue());
+
+#undef AVG_POOL_HOB
+
+}  // namespace
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_ONEDNN_UTIL_H_
+#define ONEFLOW_USER_KERNELS_ONEDNN_UTIL_H_
+
+#ifdef WITH_ONEDNN
+
+#include <oneapi/dnnl/dnnl.hpp>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+
+namespace oneflow {
+
+// The oneDNN kernels are registered above the generic CPU kernels of the same ops, so they run
+// the cases they match unless ONEFLOW_ENABLE_ONEDNN_KERNELS is false.
+inline auto HobOneDnnKernelEnabled() {
+  return hob::make_custom("OneDnnKernelEnabled", [](const user_op::KernelRegContext&) -> bool {
+    static const bool enabled = ParseBooleanFromEnv("ONEFLOW_ENABLE_ONEDNN_KERNELS", true);
+    return enabled;
+  });
+}
+
+inline dnnl::memory::dims OneDnnDims(const ShapeView& shape) {
+  return dnnl::memory::dims(shape.ptr(), shape.ptr() + shape.NumAxes());
+}
+
+template<typename T>
+dnnl::memory::dims OneDnnDims(const std::vector<T>& values) {
+  return dnnl::memory::dims(values.begin(), values.end());
+}
+
+// The dims {N, C, spatial...} of an activation, or {O, I, spatial...} of a conv weight, and their
+// strides in the contiguous tensor of the data_format.
+inline void GetOneDnnChannelsDimsAndStrides(const ShapeView& shape, bool channels_last,
+                                            dnnl::memory::dims* dims,
+                                            dnnl::memory::dims* strides) {
+  const int64_t num_axes = shape.NumAxes();
+  dnnl::memory::dims physical_strides(num_axes);
+  int64_t stride = 1;
+  for (int64_t i = num_axes - 1; i >= 0; --i) {
+    physical_strides.at(i) = stride;
+    stride *= shape.At(i);
+  }
+  *dims = OneDnnDims(shape);
+  *strides = physical_strides;
+  if (channels_last) {
+    // Channels go from the last axis to the second.
+    std::rotate(dims->begin() + 1, dims->end() - 1, dims->end());
+    std::rotate(strides->begin() + 1, strides->end() - 1, strides->end());
+  }
+}
+
+namespace onednn {
+
+template<typename T>
+void AppendToKey(std::ostringstream* ss, const T& value) {
+  *ss << value << ",";
+}
+
+template<typename T>
+void AppendToKey(std::ostringstream* ss, const std::vector<T>& values) {
+  *ss << "[";
+  for (const T& value : values) { AppendToKey(ss, value); }
+  *ss << "]";
+}
+
+}  // namespace onednn
+
+// The key of the cached primitive computing the op of the args, which are the shapes and attrs it
+// depends on.
+template<typename... Args>
+std::string OneDnnPrimitiveKey(const std::string& op_type_name, const Args&... args) {
+  std::ostringstream ss;
+  ss.precision(17);
+  ss << op_type_name << ":";
+  (void)std::initializer_list<int>{(onednn::AppendToKey(&ss, args), 0)...};
+  return ss.str();
+}
+
+// Runs the primitive cached in the stream for the key on the args, created by Create from the
+// engine of the stream the first time.
+template<typename CreateFn>
+void ExecuteOneDnnPrimitive(ep::Stream* stream, const std::string& key, const CreateFn& Create,
+                            const std::unordered_map<int, dnnl::memory>& args) {
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  const size_t num_threads = static_cast<ep::CpuDevice*>(cpu_stream->device())->GetNumThreads();
+  ep::CpuNumThreadsGuard guard(num_threads);
+  const dnnl::engine& engine = *cpu_stream->onednn_engine();
+  const dnnl::primitive& primitive = cpu_stream->onednn_primitive_cache()->GetOrCreate(
+      key, [&]() -> dnnl::primitive { return Create(engine); });
+  primitive.execute(*cpu_stream->onednn_stream(), args);
+  cpu_stream->onednn_stream()->wait();
+}
+
+inline dnnl::memory OneDnnMemory(ep::Stream* stream, const dnnl::memory::desc& md,
+                                 const void* ptr) {
+  return dnnl::memory(md, *stream->As<ep::CpuStream>()->onednn_engine(), const_cast<void*>(ptr));
+}
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
+
+#endif  // ONEFLOW_USER_KERNELS_ONEDNN_UTIL_H_
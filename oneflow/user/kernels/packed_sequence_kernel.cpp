@@ -0,0 +1,75 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/packed_sequence_kernel_util.h"
+
+namespace oneflow {
+
+template<DeviceType device_type, typename T>
+class PaddedToPackedKernel final : public user_op::OpKernel {
+ public:
+  PaddedToPackedKernel() = default;
+  ~PaddedToPackedKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    PackedSequenceKernelUtil<device_type, T>::PaddedToPacked(
+        ctx->stream(), in->shape().At(0), in->shape().At(1), out->shape().At(0),
+        in->shape().Count(2), ctx->Tensor4ArgNameAndIndex("cu_seqlens", 0)->dptr<int32_t>(),
+        in->dptr<T>(), out->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class PackedToPaddedKernel final : public user_op::OpKernel {
+ public:
+  PackedToPaddedKernel() = default;
+  ~PackedToPaddedKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    PackedSequenceKernelUtil<device_type, T>::PackedToPadded(
+        ctx->stream(), out->shape().At(0), out->shape().At(1), in->shape().At(0),
+        in->shape().Count(1), ctx->Tensor4ArgNameAndIndex("cu_seqlens", 0)->dptr<int32_t>(),
+        in->dptr<T>(), out->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_PACKED_SEQUENCE_KERNELS(device, dtype_pair)                                  \
+  REGISTER_USER_KERNEL("padded_to_packed")                                                    \
+      .SetCreateFn<PaddedToPackedKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                   \
+                       && (user_op::HobDataType("in", 0) == OF_PP_PAIR_SECOND(dtype_pair)));  \
+  REGISTER_USER_KERNEL("packed_to_padded")                                                    \
+      .SetCreateFn<PackedToPaddedKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                   \
+                       && (user_op::HobDataType("in", 0) == OF_PP_PAIR_SECOND(dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_PACKED_SEQUENCE_KERNELS, (DeviceType::kCPU),
+                                 ARITHMETIC_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_PACKED_SEQUENCE_KERNELS, (DeviceType::kCUDA),
+                                 ARITHMETIC_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/packed_sequence_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+template<typename T>
+struct PackedSequenceKernelUtil<DeviceType::kCPU, T> {
+  static void PaddedToPacked(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* padded, T* packed) {
+    // Rows past the end of the last sequence.
+    const int64_t packed_len = std::min<int64_t>(cu_seqlens[batch_size], total_len);
+    std::fill(packed + packed_len * row_size, packed + total_len * row_size, static_cast<T>(0));
+    stream->As<ep::CpuStream>()->ParallelFor(0, batch_size, [&](int64_t begin, int64_t end) {
+      for (int64_t b = begin; b < end; ++b) {
+        const int64_t offset = cu_seqlens[b];
+        const int64_t seqlen = std::min<int64_t>(cu_seqlens[b + 1], packed_len) - offset;
+        if (seqlen <= 0) { continue; }
+        const int64_t copy_len = std::min(seqlen, max_seqlen);
+        const T* src = padded + b * max_seqlen * row_size;
+        T* dst = packed + offset * row_size;
+        std::copy(src, src + copy_len * row_size, dst);
+        std::fill(dst + copy_len * row_size, dst + seqlen * row_size, static_cast<T>(0));
+      }
+    });
+  }
+
+  static void PackedToPadded(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* packed, T* padded) {
+    stream->As<ep::CpuStream>()->ParallelFor(0, batch_size, [&](int64_t begin, int64_t end) {
+      for (int64_t b = begin; b < end; ++b) {
+        const int64_t offset = cu_seqlens[b];
+        const int64_t seqlen = std::max<int64_t>(
+            std::min<int64_t>({cu_seqlens[b + 1], total_len, offset + max_seqlen}) - offset, 0);
+        T* dst = padded + b * max_seqlen * row_size;
+        std::copy(packed + offset * row_size, packed + (offset + seqlen) * row_size, dst);
+        std::fill(dst + seqlen * row_size, dst + max_seqlen * row_size, static_cast<T>(0));
+      }
+    });
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_PACKED_SEQUENCE_KERNEL_UTIL, (DeviceType::kCPU),
+                                 ARITHMETIC_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
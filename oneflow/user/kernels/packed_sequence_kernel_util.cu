@@ -0,0 +1,109 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/packed_sequence_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+struct PackedSequenceCudaType {
+  using type = T;
+};
+
+template<>
+struct PackedSequenceCudaType<float16> {
+  using type = half;
+};
+
+// The sequence holding packed row `row`, -1 past the last one.
+__device__ __forceinline__ int64_t SequenceOfRow(int64_t batch_size, const int32_t* cu_seqlens,
+                                                 int64_t row) {
+  if (row >= cu_seqlens[batch_size]) { return -1; }
+  int64_t lo = 0;
+  int64_t hi = batch_size;
+  while (hi - lo > 1) {
+    const int64_t mid = (lo + hi) / 2;
+    if (cu_seqlens[mid] <= row) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+template<typename T>
+__global__ void PaddedToPackedGpu(int64_t elem_cnt, int64_t batch_size, int64_t max_seqlen,
+                                  int64_t row_size, const int32_t* cu_seqlens, const T* padded,
+                                  T* packed) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t row = i / row_size;
+    const int64_t b = SequenceOfRow(batch_size, cu_seqlens, row);
+    const int64_t t = row - (b < 0 ? 0 : cu_seqlens[b]);
+    packed[i] = (b < 0 || t >= max_seqlen)
+                    ? static_cast<T>(0.0f)
+                    : padded[(b * max_seqlen + t) * row_size + i - row * row_size];
+  }
+}
+
+template<typename T>
+__global__ void PackedToPaddedGpu(int64_t elem_cnt, int64_t max_seqlen, int64_t total_len,
+                                  int64_t row_size, const int32_t* cu_seqlens, const T* packed,
+                                  T* padded) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t row = i / row_size;
+    const int64_t b = row / max_seqlen;
+    const int64_t src_row = cu_seqlens[b] + row - b * max_seqlen;
+    padded[i] = (src_row < cu_seqlens[b + 1] && src_row < total_len)
+                    ? packed[src_row * row_size + i - row * row_size]
+                    : static_cast<T>(0.0f);
+  }
+}
+
+}  // namespace
+
+template<typename T>
+struct PackedSequenceKernelUtil<DeviceType::kCUDA, T> {
+  using CudaT = typename PackedSequenceCudaType<T>::type;
+
+  static void PaddedToPacked(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* padded, T* packed) {
+    const int64_t elem_cnt = total_len * row_size;
+    if (elem_cnt == 0) { return; }
+    RUN_CUDA_KERNEL((PaddedToPackedGpu<CudaT>), stream, elem_cnt, elem_cnt, batch_size,
+                    max_seqlen, row_size, cu_seqlens, reinterpret_cast<const CudaT*>(padded),
+                    reinterpret_cast<CudaT*>(packed));
+  }
+
+  static void PackedToPadded(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* packed, T* padded) {
+    const int64_t elem_cnt = batch_size * max_seqlen * row_size;
+    if (elem_cnt == 0) { return; }
+    RUN_CUDA_KERNEL((PackedToPaddedGpu<CudaT>), stream, elem_cnt, elem_cnt, max_seqlen,
+                    total_len, row_size, cu_seqlens, reinterpret_cast<const CudaT*>(packed),
+                    reinterpret_cast<CudaT*>(padded));
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_PACKED_SEQUENCE_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 ARITHMETIC_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
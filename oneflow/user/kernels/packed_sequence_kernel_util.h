@@ -0,0 +1,43 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_PACKED_SEQUENCE_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_PACKED_SEQUENCE_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+// Row t of sequence b is row b * max_seqlen + t of padded and row cu_seqlens[b] + t of packed,
+// rows being row_size elements. The output rows without an input row, the padding or the rows past
+// the last sequence, are zeros.
+template<DeviceType device_type, typename T>
+struct PackedSequenceKernelUtil {
+  static void PaddedToPacked(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* padded, T* packed);
+  static void PackedToPadded(ep::Stream* stream, int64_t batch_size, int64_t max_seqlen,
+                             int64_t total_len, int64_t row_size, const int32_t* cu_seqlens,
+                             const T* packed, T* padded);
+};
+
+#define INSTANTIATE_PACKED_SEQUENCE_KERNEL_UTIL(device_type_v, dtype_pair) \
+  template struct PackedSequenceKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_PACKED_SEQUENCE_KERNEL_UTIL_H_
@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/paged_attention_kernel_util.h"
+
+namespace oneflow {
+
+template<DeviceType device_type, typename T>
+class PagedKvCacheAppendKernel final : public user_op::OpKernel {
+ public:
+  PagedKvCacheAppendKernel() = default;
+  ~PagedKvCacheAppendKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* key = ctx->Tensor4ArgNameAndIndex("key", 0);
+    PagedAttentionKernelUtil<device_type, T>::Append(
+        ctx->stream(), key->shape().At(0), key->shape().Count(1),
+        ctx->Tensor4ArgNameAndIndex("slot_mapping", 0)->dptr<int64_t>(), key->dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("value", 0)->dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("key_cache", 0)->mut_dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("value_cache", 0)->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<DeviceType device_type, typename T>
+class PagedDecodeAttentionKernel final : public user_op::OpKernel {
+ public:
+  PagedDecodeAttentionKernel() = default;
+  ~PagedDecodeAttentionKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* query = ctx->Tensor4ArgNameAndIndex("query", 0);
+    const user_op::Tensor* key_cache = ctx->Tensor4ArgNameAndIndex("key_cache", 0);
+    const user_op::Tensor* block_tables = ctx->Tensor4ArgNameAndIndex("block_tables", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    PagedAttentionKernelUtil<device_type, T>::DecodeAttention(
+        ctx->stream(), query->shape().At(0), query->shape().At(1), key_cache->shape().At(2),
+        query->shape().At(2), key_cache->shape().At(1), block_tables->shape().At(1),
+        ctx->Attr<float>("scale"), query->dptr<T>(), key_cache->dptr<T>(),
+        ctx->Tensor4ArgNameAndIndex("value_cache", 0)->dptr<T>(), block_tables->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("context_lens", 0)->dptr<int32_t>(),
+        ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr<T>(), tmp_buffer->mut_dptr());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<DeviceType device_type, typename T>
+class PagedKvCacheReorderBeamsKernel final : public user_op::OpKernel {
+ public:
+  PagedKvCacheReorderBeamsKernel() = default;
+  ~PagedKvCacheReorderBeamsKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* key_cache = ctx->Tensor4ArgNameAndIndex("key_cache", 0);
+    const user_op::Tensor* block_tables = ctx->Tensor4ArgNameAndIndex("block_tables", 0);
+    const user_op::Tensor* parent_beams = ctx->Tensor4ArgNameAndIndex("parent_beams", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    for (const std::string& cache : {"key_cache", "value_cache"}) {
+      PagedAttentionKernelUtil<device_type, T>::ReorderBeams(
+          ctx->stream(), parent_beams->shape().elem_cnt(), parent_beams->shape().At(1),
+          key_cache->shape().Count(2), key_cache->shape().At(1), block_tables->shape().At(1),
+          block_tables->dptr<int32_t>(),
+          ctx->Tensor4ArgNameAndIndex("context_lens", 0)->dptr<int32_t>(),
+          parent_beams->dptr<int32_t>(), ctx->Tensor4ArgNameAndIndex(cache, 0)->mut_dptr<T>(),
+          tmp_buffer->mut_dptr());
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_PAGED_ATTENTION_KERNELS(device, dtype_pair)                                     \
+  REGISTER_USER_KERNEL("paged_kv_cache_append")                                                  \
+      .SetCreateFn<PagedKvCacheAppendKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                      \
+                       && (user_op::HobDataType("key", 0) == OF_PP_PAIR_SECOND(dtype_pair)));    \
+  REGISTER_USER_KERNEL("paged_decode_attention")                                                 \
+      .SetCreateFn<PagedDecodeAttentionKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                      \
+                       && (user_op::HobDataType("query", 0) == OF_PP_PAIR_SECOND(dtype_pair)))   \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        const Shape& query_shape = ctx->InputShape("query", 0);                                  \
+        return GetPagedDecodeAttentionWorkspaceSize(                                             \
+            query_shape.At(0), query_shape.At(1),                                                \
+            ctx->InputShape("block_tables", 0).At(1) * ctx->InputShape("key_cache", 0).At(1),    \
+            sizeof(OF_PP_PAIR_FIRST(dtype_pair)));                                               \
+      });                                                                                        \
+  REGISTER_USER_KERNEL("paged_kv_cache_reorder_beams")                                           \
+      .SetCreateFn<PagedKvCacheReorderBeamsKernel<device, OF_PP_PAIR_FIRST(dtype_pair)>>()       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                      \
+                       && (user_op::HobDataType("key_cache", 0) == OF_PP_PAIR_SECOND(dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        const Shape& key_cache_shape = ctx->InputShape("key_cache", 0);                          \
+        return GetPagedKvCacheReorderBeamsWorkspaceSize(                                         \
+            ctx->InputShape("parent_beams", 0).elem_cnt(),                                       \
+            ctx->InputShape("block_tables", 0).At(1) * key_cache_shape.At(1),                    \
+            key_cache_shape.Count(2), sizeof(OF_PP_PAIR_FIRST(dtype_pair)));                     \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_PAGED_ATTENTION_KERNELS, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ)
+
+#ifdef WITH_CUDA
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_PAGED_ATTENTION_KERNELS, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ)
+#endif  // WITH_CUDA
+
+}  // namespace oneflow
@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/paged_attention_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+template<typename T>
+struct PagedAttentionKernelUtil<DeviceType::kCPU, T> {
+  static void Append(ep::Stream* stream, int64_t num_tokens, int64_t token_size,
+                     const int64_t* slot_mapping, const T* key, const T* value, T* key_cache,
+                     T* value_cache) {
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_tokens, [&](int64_t begin, int64_t end) {
+      for (int64_t t = begin; t < end; ++t) {
+        const int64_t slot = slot_mapping[t];
+        if (slot < 0) { continue; }
+        std::copy(key + t * token_size, key + (t + 1) * token_size, key_cache + slot * token_size);
+        std::copy(value + t * token_size, value + (t + 1) * token_size,
+                  value_cache + slot * token_size);
+      }
+    });
+  }
+
+  static void DecodeAttention(ep::Stream* stream, int64_t batch_size, int64_t num_heads,
+                              int64_t num_kv_heads, int64_t head_dim, int64_t block_size,
+                              int64_t max_num_blocks_per_seq, float scale, const T* query,
+                              const T* key_cache, const T* value_cache,
+                              const int32_t* block_tables, const int32_t* context_lens, T* out,
+                              void* workspace) {
+    const int64_t max_context_len = max_num_blocks_per_seq * block_size;
+    const int64_t token_size = num_kv_heads * head_dim;
+    const int64_t num_queries_per_kv = num_heads / num_kv_heads;
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size * num_heads, [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t b = i / num_heads;
+            const int64_t kv_head_offset = (i - b * num_heads) / num_queries_per_kv * head_dim;
+            const int64_t context_len = context_lens[b];
+            const int32_t* block_table = block_tables + b * max_num_blocks_per_seq;
+            const T* q = query + i * head_dim;
+            T* probs = reinterpret_cast<T*>(workspace) + i * max_context_len;
+            const auto Slot = [&](int64_t pos) -> int64_t {
+              return static_cast<int64_t>(block_table[pos / block_size]) * block_size
+                     + pos % block_size;
+            };
+            T max_logit = GetMinVal<T>();
+            for (int64_t pos = 0; pos < context_len; ++pos) {
+              const T* k = key_cache + Slot(pos) * token_size + kv_head_offset;
+              T dot = 0;
+              for (int64_t d = 0; d < head_dim; ++d) { dot += q[d] * k[d]; }
+              probs[pos] = dot * static_cast<T>(scale);
+              max_logit = std::max(max_logit, probs[pos]);
+            }
+            T sum = 0;
+            for (int64_t pos = 0; pos < context_len; ++pos) {
+              probs[pos] = std::exp(probs[pos] - max_logit);
+              sum += probs[pos];
+            }
+            T* o = out + i * head_dim;
+            std::fill(o, o + head_dim, static_cast<T>(0));
+            for (int64_t pos = 0; pos < context_len; ++pos) {
+              const T* v = value_cache + Slot(pos) * token_size + kv_head_offset;
+              const T p = probs[pos] / sum;
+              for (int64_t d = 0; d < head_dim; ++d) { o[d] += p * v[d]; }
+            }
+          }
+        });
+  }
+
+  static void ReorderBeams(ep::Stream* stream, int64_t num_seqs, int64_t num_beams,
+                           int64_t token_size, int64_t block_size, int64_t max_num_blocks_per_seq,
+                           const int32_t* block_tables, const int32_t* context_lens,
+                           const int32_t* parent_beams, T* cache, void* workspace) {
+    const int64_t max_context_len = max_num_blocks_per_seq * block_size;
+    T* staged = reinterpret_cast<T*>(workspace);
+    const auto Slot = [&](int64_t seq, int64_t pos) -> int64_t {
+      return static_cast<int64_t>(block_tables[seq * max_num_blocks_per_seq + pos / block_size])
+                 * block_size
+             + pos % block_size;
+    };
+    const auto Parent = [&](int64_t seq) -> int64_t {
+      return seq / num_beams * num_beams + parent_beams[seq];
+    };
+    // The parents are staged first, since they may be overwritten by the beams they replace.
+    for (const bool write_back : {false, true}) {
+      stream->As<ep::CpuStream>()->ParallelFor(0, num_seqs, [&](int64_t begin, int64_t end) {
+        for (int64_t seq = begin; seq < end; ++seq) {
+          const int64_t parent = Parent(seq);
+          if (parent == seq) { continue; }
+          T* seq_staged = staged + seq * max_context_len * token_size;
+          for (int64_t pos = 0; pos < context_lens[parent]; ++pos) {
+            if (write_back) {
+              std::copy(seq_staged + pos * token_size, seq_staged + (pos + 1) * token_size,
+                        cache + Slot(seq, pos) * token_size);
+            } else {
+              const T* src = cache + Slot(parent, pos) * token_size;
+              std::copy(src, src + token_size, seq_staged + pos * token_size);
+            }
+          }
+        }
+      });
+    }
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_PAGED_ATTENTION_KERNEL_UTIL, (DeviceType::kCPU),
+                                 FLOATING_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
@@ -0,0 +1,212 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/paged_attention_kernel_util.h"
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <cub/cub.cuh>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int kPagedAttentionBlockSize = 128;
+
+template<typename T>
+struct PagedAttentionCudaType {
+  using type = T;
+  using compute_type = T;
+};
+
+template<>
+struct PagedAttentionCudaType<float16> {
+  using type = half;
+  using compute_type = float;
+};
+
+template<typename T>
+__device__ T WarpAllReduceSum(T val) {
+  for (int mask = kCudaWarpSize / 2; mask > 0; mask /= 2) {
+    val += __shfl_xor_sync(0xffffffff, val, mask);
+  }
+  return val;
+}
+
+template<typename T>
+__global__ void PagedKvCacheAppendGpu(int64_t elem_cnt, int64_t token_size,
+                                      const int64_t* slot_mapping, const T* key, const T* value,
+                                      T* key_cache, T* value_cache) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t t = i / token_size;
+    const int64_t slot = slot_mapping[t];
+    if (slot < 0) { continue; }
+    const int64_t offset = slot * token_size + i - t * token_size;
+    key_cache[offset] = key[i];
+    value_cache[offset] = value[i];
+  }
+}
+
+// Stages the cached tokens of the parents of the beams taking them, then writes them back into
+// the blocks of those beams, as one parent may be replaced by another beam.
+template<typename T>
+__global__ void PagedKvCacheReorderBeamsGpu(int64_t elem_cnt, int64_t num_beams,
+                                            int64_t token_size, int64_t block_size,
+                                            int64_t max_num_blocks_per_seq,
+                                            const int32_t* block_tables,
+                                            const int32_t* context_lens,
+                                            const int32_t* parent_beams, bool write_back,
+                                            T* cache, T* staged) {
+  const int64_t max_context_len = max_num_blocks_per_seq * block_size;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t seq = i / (max_context_len * token_size);
+    const int64_t parent = seq / num_beams * num_beams + parent_beams[seq];
+    if (parent == seq) { continue; }
+    const int64_t pos = i / token_size - seq * max_context_len;
+    if (pos >= context_lens[parent]) { continue; }
+    const int64_t d = i - i / token_size * token_size;
+    if (write_back) {
+      const int64_t slot =
+          static_cast<int64_t>(block_tables[seq * max_num_blocks_per_seq + pos / block_size])
+              * block_size
+          + pos % block_size;
+      cache[slot * token_size + d] = staged[i];
+    } else {
+      const int64_t slot =
+          static_cast<int64_t>(block_tables[parent * max_num_blocks_per_seq + pos / block_size])
+              * block_size
+          + pos % block_size;
+      staged[i] = cache[slot * token_size + d];
+    }
+  }
+}
+
+// One thread block for each query head. The warps compute the logits of one position at a time,
+// with the lanes along head_dim so the keys are read coalesced, then the threads compute the
+// output along head_dim.
+template<typename T, typename ComputeType>
+__global__ void PagedDecodeAttentionGpu(int64_t num_heads, int64_t num_kv_heads,
+                                        int64_t head_dim, int64_t block_size,
+                                        int64_t max_num_blocks_per_seq, ComputeType scale,
+                                        const T* query, const T* key_cache, const T* value_cache,
+                                        const int32_t* block_tables, const int32_t* context_lens,
+                                        T* out, ComputeType* workspace) {
+  typedef cub::BlockReduce<ComputeType, kPagedAttentionBlockSize> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage reduce_storage;
+  __shared__ ComputeType shared_max_logit;
+  __shared__ ComputeType shared_sum;
+  const int64_t i = blockIdx.x;
+  const int64_t b = i / num_heads;
+  const int64_t kv_head_offset = (i - b * num_heads) / (num_heads / num_kv_heads) * head_dim;
+  const int64_t context_len = context_lens[b];
+  const int64_t token_size = num_kv_heads * head_dim;
+  const int32_t* block_table = block_tables + b * max_num_blocks_per_seq;
+  const T* q = query + i * head_dim;
+  ComputeType* probs = workspace + i * max_num_blocks_per_seq * block_size;
+  const auto Slot = [&](int64_t pos) -> int64_t {
+    return static_cast<int64_t>(block_table[pos / block_size]) * block_size + pos % block_size;
+  };
+  const int lane = threadIdx.x % kCudaWarpSize;
+  for (int64_t pos = threadIdx.x / kCudaWarpSize; pos < context_len;
+       pos += kPagedAttentionBlockSize / kCudaWarpSize) {
+    const T* k = key_cache + Slot(pos) * token_size + kv_head_offset;
+    ComputeType dot = 0;
+    for (int64_t d = lane; d < head_dim; d += kCudaWarpSize) {
+      dot += static_cast<ComputeType>(q[d]) * static_cast<ComputeType>(k[d]);
+    }
+    dot = WarpAllReduceSum(dot);
+    if (lane == 0) { probs[pos] = dot * scale; }
+  }
+  __syncthreads();
+  ComputeType thread_max_logit = GetMinVal<ComputeType>();
+  for (int64_t pos = threadIdx.x; pos < context_len; pos += kPagedAttentionBlockSize) {
+    thread_max_logit = max(thread_max_logit, probs[pos]);
+  }
+  const ComputeType max_logit = BlockReduce(reduce_storage).Reduce(thread_max_logit, cub::Max());
+  if (threadIdx.x == 0) { shared_max_logit = max_logit; }
+  __syncthreads();
+  ComputeType thread_sum = 0;
+  for (int64_t pos = threadIdx.x; pos < context_len; pos += kPagedAttentionBlockSize) {
+    const ComputeType prob = exp(probs[pos] - shared_max_logit);
+    probs[pos] = prob;
+    thread_sum += prob;
+  }
+  const ComputeType sum = BlockReduce(reduce_storage).Sum(thread_sum);
+  if (threadIdx.x == 0) { shared_sum = sum; }
+  __syncthreads();
+  for (int64_t d = threadIdx.x; d < head_dim; d += kPagedAttentionBlockSize) {
+    ComputeType acc = 0;
+    for (int64_t pos = 0; pos < context_len; ++pos) {
+      acc += probs[pos] * static_cast<ComputeType>(value_cache[Slot(pos) * token_size
+                                                               + kv_head_offset + d]);
+    }
+    out[i * head_dim + d] = static_cast<T>(context_len > 0 ? acc / shared_sum : acc);
+  }
+}
+
+}  // namespace
+
+template<typename T>
+struct PagedAttentionKernelUtil<DeviceType::kCUDA, T> {
+  using CudaT = typename PagedAttentionCudaType<T>::type;
+  using ComputeType = typename PagedAttentionCudaType<T>::compute_type;
+
+  static void Append(ep::Stream* stream, int64_t num_tokens, int64_t token_size,
+                     const int64_t* slot_mapping, const T* key, const T* value, T* key_cache,
+                     T* value_cache) {
+    const int64_t elem_cnt = num_tokens * token_size;
+    if (elem_cnt == 0) { return; }
+    RUN_CUDA_KERNEL((PagedKvCacheAppendGpu<CudaT>), stream, elem_cnt, elem_cnt, token_size,
+                    slot_mapping, reinterpret_cast<const CudaT*>(key),
+                    reinterpret_cast<const CudaT*>(value), reinterpret_cast<CudaT*>(key_cache),
+                    reinterpret_cast<CudaT*>(value_cache));
+  }
+
+  static void DecodeAttention(ep::Stream* stream, int64_t batch_size, int64_t num_heads,
+                              int64_t num_kv_heads, int64_t head_dim, int64_t block_size,
+                              int64_t max_num_blocks_per_seq, float scale, const T* query,
+                              const T* key_cache, const T* value_cache,
+                              const int32_t* block_tables, const int32_t* context_lens, T* out,
+                              void* workspace) {
+    const int64_t num_queries = batch_size * num_heads;
+    if (num_queries == 0) { return; }
+    PagedDecodeAttentionGpu<CudaT, ComputeType>
+        <<<num_queries, kPagedAttentionBlockSize, 0,
+           stream->As<ep::CudaStream>()->cuda_stream()>>>(
+            num_heads, num_kv_heads, head_dim, block_size, max_num_blocks_per_seq,
+            static_cast<ComputeType>(scale), reinterpret_cast<const CudaT*>(query),
+            reinterpret_cast<const CudaT*>(key_cache), reinterpret_cast<const CudaT*>(value_cache),
+            block_tables, context_lens, reinterpret_cast<CudaT*>(out),
+            reinterpret_cast<ComputeType*>(workspace));
+  }
+
+  static void ReorderBeams(ep::Stream* stream, int64_t num_seqs, int64_t num_beams,
+                           int64_t token_size, int64_t block_size, int64_t max_num_blocks_per_seq,
+                           const int32_t* block_tables, const int32_t* context_lens,
+                           const int32_t* parent_beams, T* cache, void* workspace) {
+    const int64_t elem_cnt = num_seqs * max_num_blocks_per_seq * block_size * token_size;
+    if (elem_cnt == 0) { return; }
+    for (const bool write_back : {false, true}) {
+      RUN_CUDA_KERNEL((PagedKvCacheReorderBeamsGpu<CudaT>), stream, elem_cnt, elem_cnt, num_beams,
+                      token_size, block_size, max_num_blocks_per_seq, block_tables, context_lens,
+                      parent_beams, write_back, reinterpret_cast<CudaT*>(cache),
+                      reinterpret_cast<CudaT*>(workspace));
+    }
+  }
+};
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_PAGED_ATTENTION_KERNEL_UTIL, (DeviceType::kCUDA),
+                                 FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ);
+
+}  // namespace oneflow
@@ -0,0 +1,68 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_PAGED_ATTENTION_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_PAGED_ATTENTION_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/include/stream.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+// The attention probabilities of every query head over its context, computed in float or in
+// double for double inputs.
+inline size_t GetPagedDecodeAttentionWorkspaceSize(int64_t batch_size, int64_t num_heads,
+                                                   int64_t max_context_len, size_t data_size) {
+  const size_t compute_size = std::max(data_size, sizeof(float));
+  return GetCudaAlignedSize(batch_size * num_heads * max_context_len * compute_size);
+}
+
+// The tokens of all the sequences being reordered, staged before they are written back.
+inline size_t GetPagedKvCacheReorderBeamsWorkspaceSize(int64_t num_seqs, int64_t max_context_len,
+                                                      int64_t token_size, size_t data_size) {
+  return GetCudaAlignedSize(num_seqs * max_context_len * token_size * data_size);
+}
+
+// The caches are [num_blocks, block_size, num_kv_heads, head_dim], so the token at slot s is at
+// s * token_size with token_size = num_kv_heads * head_dim. key and value are
+// [num_tokens, num_kv_heads, head_dim], and a token with a negative slot is skipped.
+// The sequence b * num_beams + j of ReorderBeams takes the cached tokens of the sequence
+// b * num_beams + parent_beams[b][j], the context lengths of the beams of a batch being equal.
+// query and out are [batch_size, num_heads, head_dim]. Position p of sequence b is at slot
+// block_tables[b][p / block_size] * block_size + p % block_size, for p < context_lens[b].
+template<DeviceType device_type, typename T>
+struct PagedAttentionKernelUtil {
+  static void Append(ep::Stream* stream, int64_t num_tokens, int64_t token_size,
+                     const int64_t* slot_mapping, const T* key, const T* value, T* key_cache,
+                     T* value_cache);
+  static void DecodeAttention(ep::Stream* stream, int64_t batch_size, int64_t num_heads,
+                              int64_t num_kv_heads, int64_t head_dim, int64_t block_size,
+                              int64_t max_num_blocks_per_seq, float scale, const T* query,
+                              const T* key_cache, const T* value_cache,
+                              const int32_t* block_tables, const int32_t* context_lens, T* out,
+                              void* workspace);
+  static void ReorderBeams(ep::Stream* stream, int64_t num_seqs, int64_t num_beams,
+                           int64_t token_size, int64_t block_size, int64_t max_num_blocks_per_seq,
+                           const int32_t* block_tables, const int32_t* context_lens,
+                           const int32_t* parent_beams, T* cache, void* workspace);
+};
+
+#define INSTANTIATE_PAGED_ATTENTION_KERNEL_UTIL(device_type_v, dtype_pair) \
+  template struct PagedAttentionKernelUtil<device_type_v, OF_PP_PAIR_FIRST(dtype_pair)>;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_PAGED_ATTENTION_KERNEL_UTIL_H_
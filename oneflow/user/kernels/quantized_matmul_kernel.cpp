@@ -0,0 +1,114 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace oneflow {
+
+namespace {
+
+// Symmetric 8 bit quantization of the google formula, the same as fake_quantization.
+inline int8_t QuantizeSymmetricInt8(float x, float scale) {
+  const float out = std::nearbyint(x / scale);
+  return static_cast<int8_t>(std::min(127.f, std::max(-128.f, out)));
+}
+
+size_t InferQuantizedMatmulTmpSize(user_op::InferContext* ctx) {
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& b_shape = ctx->InputShape("b", 0);
+  return a_shape.elem_cnt() * sizeof(int8_t) + b_shape.elem_cnt() * sizeof(int8_t);
+}
+
+}  // namespace
+
+class CpuQuantizedMatmulKernel final : public user_op::OpKernel {
+ public:
+  CpuQuantizedMatmulKernel() = default;
+  ~CpuQuantizedMatmulKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const user_op::Tensor* a_scale = ctx->Tensor4ArgNameAndIndex("a_scale", 0);
+    const user_op::Tensor* b_scale = ctx->Tensor4ArgNameAndIndex("b_scale", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const bool transpose_b = ctx->Attr<bool>("transpose_b");
+    const float alpha = static_cast<float>(ctx->Attr<double>("alpha"));
+    const int64_t m = out->shape().At(0);
+    const int64_t n = out->shape().At(1);
+    const int64_t k = a->shape().At(1);
+    if (m * n == 0) { return; }
+    const int64_t b_scale_size = b_scale->shape().elem_cnt();
+    const float a_scale_val = *a_scale->dptr<float>();
+    const float* b_scale_ptr = b_scale->dptr<float>();
+
+    // Both quantized operands are k-major, so each output is a dot of two contiguous rows.
+    int8_t* quantized_a = tmp_buffer->mut_dptr<int8_t>();
+    int8_t* quantized_b = quantized_a + m * k;
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const float* a_ptr = a->dptr<float>();
+    cpu_stream->ParallelFor(0, m * k, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        quantized_a[i] = QuantizeSymmetricInt8(a_ptr[i], a_scale_val);
+      }
+    });
+    const float* b_ptr = b->dptr<float>();
+    cpu_stream->ParallelFor(0, n, [&](int64_t begin, int64_t end) {
+      for (int64_t j = begin; j < end; ++j) {
+        const float scale = b_scale_ptr[b_scale_size == 1 ? 0 : j];
+        for (int64_t l = 0; l < k; ++l) {
+          const float x = transpose_b ? b_ptr[j * k + l] : b_ptr[l * n + j];
+          quantized_b[j * k + l] = QuantizeSymmetricInt8(x, scale);
+        }
+      }
+    });
+    float* out_ptr = out->mut_dptr<float>();
+    const int64_t grain = std::max<int64_t>(1, ep::CpuStream::kParallelForDefaultGrain / (n * k));
+    cpu_stream->ParallelFor(
+        0, m,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int8_t* a_row = quantized_a + i * k;
+            for (int64_t j = 0; j < n; ++j) {
+              const int8_t* b_row = quantized_b + j * k;
+              int32_t acc = 0;
+              for (int64_t l = 0; l < k; ++l) {
+                acc += static_cast<int32_t>(a_row[l]) * static_cast<int32_t>(b_row[l]);
+              }
+              out_ptr[i * n + j] = static_cast<float>(acc) * a_scale_val
+                                   * b_scale_ptr[b_scale_size == 1 ? 0 : j] * alpha;
+            }
+          }
+        },
+        grain);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_matmul")
+    .SetCreateFn<CpuQuantizedMatmulKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)
+                     && (user_op::HobDataType("a", 0) == DataType::kFloat))
+    .SetInferTmpSizeFn(InferQuantizedMatmulTmpSize);
+
+}  // namespace oneflow
@@ -0,0 +1,170 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/device/cuda_util.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/kernel/kernel_util.cuh"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/cuda/primitive/cublas_lt_matmul.h"
+
+#include <cstring>
+
+namespace oneflow {
+
+namespace {
+
+// Symmetric 8 bit quantization of the google formula, the same as fake_quantization.
+__device__ __forceinline__ int8_t QuantizeSymmetricInt8(float x, float scale) {
+  return static_cast<int8_t>(fminf(127.f, fmaxf(-128.f, nearbyintf(x / scale))));
+}
+
+__global__ void QuantizeA(const float* a, const float* a_scale, const int64_t elem_cnt,
+                          int8_t* quantized_a) {
+  const float scale = *a_scale;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    quantized_a[i] = QuantizeSymmetricInt8(a[i], scale);
+  }
+}
+
+// Writes b as n x k whether or not it is transposed.
+__global__ void QuantizeB(const float* b, const float* b_scale, const int64_t b_scale_size,
+                          const int64_t n, const int64_t k, const bool transpose_b,
+                          int8_t* quantized_b) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, n * k) {
+    const int64_t j = i / k;
+    const int64_t l = i - j * k;
+    const float x = transpose_b ? b[i] : b[l * n + j];
+    quantized_b[i] = QuantizeSymmetricInt8(x, b_scale[b_scale_size == 1 ? 0 : j]);
+  }
+}
+
+// The fallback when cuBLASLt has no int8 algorithm for the problem.
+__global__ void NaiveInt8Matmul(const int8_t* quantized_a, const int8_t* quantized_b,
+                                const int64_t m, const int64_t n, const int64_t k, int32_t* c) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, m * n) {
+    const int8_t* a_row = quantized_a + (i / n) * k;
+    const int8_t* b_row = quantized_b + (i % n) * k;
+    int32_t acc = 0;
+    for (int64_t l = 0; l < k; ++l) {
+      acc += static_cast<int32_t>(a_row[l]) * static_cast<int32_t>(b_row[l]);
+    }
+    c[i] = acc;
+  }
+}
+
+__global__ void Dequantize(const int32_t* c, const float* a_scale, const float* b_scale,
+                           const int64_t b_scale_size, const int64_t n, const float alpha,
+                           const int64_t elem_cnt, float* out) {
+  const float scale = *a_scale * alpha;
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    out[i] = static_cast<float>(c[i]) * scale * b_scale[b_scale_size == 1 ? 0 : i % n];
+  }
+}
+
+// Tries the int32 c = quantized_a * quantized_b^T, row-major, with cuBLASLt. That is the
+// column-major c^T = quantized_b * quantized_a^T, the TN layout int8 kernels prefer.
+bool LaunchCublasLtInt8Matmul(ep::Stream* stream, const int8_t* quantized_a,
+                              const int8_t* quantized_b, const int64_t m, const int64_t n,
+                              const int64_t k, int32_t* c) {
+#if CUDA_VERSION >= 11040
+  if (!ep::primitive::IsCublasLtMatmulEnabled()) { return false; }
+  ep::primitive::CublasLtMatmulProblem problem;
+  std::memset(&problem, 0, sizeof(problem));
+  problem.m = n;
+  problem.n = m;
+  problem.k = k;
+  problem.lda = k;
+  problem.ldb = k;
+  problem.ldc = n;
+  problem.batch_count = 1;
+  problem.data_type = DataType::kInt8;
+  problem.trans_a = CUBLAS_OP_T;
+  problem.trans_b = CUBLAS_OP_N;
+  problem.epilogue = CUBLASLT_EPILOGUE_DEFAULT;
+  return ep::primitive::LaunchCublasLtMatmul(stream->As<ep::CudaStream>(), problem, Scalar(1),
+                                             quantized_b, quantized_a, Scalar(0), c, nullptr);
+#else
+  return false;
+#endif  // CUDA_VERSION >= 11040
+}
+
+struct QuantizedMatmulTmpBuffer {
+  QuantizedMatmulTmpBuffer(int64_t m, int64_t n, int64_t k)
+      : quantized_a_bytes(GetCudaAlignedSize(m * k * sizeof(int8_t))),
+        quantized_b_bytes(GetCudaAlignedSize(n * k * sizeof(int8_t))),
+        c_bytes(GetCudaAlignedSize(m * n * sizeof(int32_t))) {}
+  size_t TotalBytes() const { return quantized_a_bytes + quantized_b_bytes + c_bytes; }
+
+  size_t quantized_a_bytes;
+  size_t quantized_b_bytes;
+  size_t c_bytes;
+};
+
+size_t InferQuantizedMatmulTmpSize(user_op::InferContext* ctx) {
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& out_shape = ctx->OutputShape("out", 0);
+  return QuantizedMatmulTmpBuffer(a_shape.At(0), out_shape.At(1), a_shape.At(1)).TotalBytes();
+}
+
+}  // namespace
+
+class GpuQuantizedMatmulKernel final : public user_op::OpKernel {
+ public:
+  GpuQuantizedMatmulKernel() = default;
+  ~GpuQuantizedMatmulKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* a = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const user_op::Tensor* b = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const user_op::Tensor* a_scale = ctx->Tensor4ArgNameAndIndex("a_scale", 0);
+    const user_op::Tensor* b_scale = ctx->Tensor4ArgNameAndIndex("b_scale", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const bool transpose_b = ctx->Attr<bool>("transpose_b");
+    const float alpha = static_cast<float>(ctx->Attr<double>("alpha"));
+    const int64_t m = out->shape().At(0);
+    const int64_t n = out->shape().At(1);
+    const int64_t k = a->shape().At(1);
+    if (m * n == 0) { return; }
+    const int64_t b_scale_size = b_scale->shape().elem_cnt();
+
+    const QuantizedMatmulTmpBuffer buffer(m, n, k);
+    int8_t* quantized_a = tmp_buffer->mut_dptr<int8_t>();
+    int8_t* quantized_b = quantized_a + buffer.quantized_a_bytes;
+    int32_t* c = reinterpret_cast<int32_t*>(quantized_b + buffer.quantized_b_bytes);
+    RUN_CUDA_KERNEL(QuantizeA, ctx->stream(), m * k, a->dptr<float>(), a_scale->dptr<float>(),
+                    m * k, quantized_a);
+    RUN_CUDA_KERNEL(QuantizeB, ctx->stream(), n * k, b->dptr<float>(), b_scale->dptr<float>(),
+                    b_scale_size, n, k, transpose_b, quantized_b);
+    if (!LaunchCublasLtInt8Matmul(ctx->stream(), quantized_a, quantized_b, m, n, k, c)) {
+      RUN_CUDA_KERNEL(NaiveInt8Matmul, ctx->stream(), m * n, quantized_a, quantized_b, m, n, k, c);
+    }
+    RUN_CUDA_KERNEL(Dequantize, ctx->stream(), m * n, c, a_scale->dptr<float>(),
+                    b_scale->dptr<float>(), b_scale_size, n, alpha, m * n,
+                    out->mut_dptr<float>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("quantized_matmul")
+    .SetCreateFn<GpuQuantizedMatmulKernel>()
+    .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA)
+                     && (user_op::HobDataType("a", 0) == DataType::kFloat))
+    .SetInferTmpSizeFn(InferQuantizedMatmulTmpSize);
+
+}  // namespace oneflow
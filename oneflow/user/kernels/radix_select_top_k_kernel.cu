@@ -0,0 +1,278 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/radix_sort.cuh"
+#include "oneflow/user/kernels/top_k_kernel_util.h"
+#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <cuda_fp16.h>
+
+namespace oneflow {
+
+namespace {
+
+// Maps a value to unsigned bits whose unsigned order is the order of the values, so that the
+// selection and the final sort are both plain unsigned radix passes.
+template<typename T>
+struct RadixSelectTraits;
+
+template<>
+struct RadixSelectTraits<float> {
+  using UnsignedBits = uint32_t;
+  __device__ __forceinline__ static UnsignedBits Convert(float v) {
+    const uint32_t x = __float_as_uint(v);
+    return x ^ ((x & 0x80000000u) ? 0xffffffffu : 0x80000000u);
+  }
+};
+
+template<>
+struct RadixSelectTraits<double> {
+  using UnsignedBits = uint64_t;
+  __device__ __forceinline__ static UnsignedBits Convert(double v) {
+    const uint64_t x = static_cast<uint64_t>(__double_as_longlong(v));
+    return x ^ ((x & 0x8000000000000000ull) ? 0xffffffffffffffffull : 0x8000000000000000ull);
+  }
+};
+
+template<>
+struct RadixSelectTraits<half> {
+  using UnsignedBits = uint16_t;
+  __device__ __forceinline__ static UnsignedBits Convert(half v) {
+    const uint16_t x = __half_as_ushort(v);
+    return x ^ ((x & 0x8000u) ? 0xffffu : 0x8000u);
+  }
+};
+
+template<typename T, typename U>
+struct IntegralRadixSelectTraits {
+  using UnsignedBits = U;
+  __device__ __forceinline__ static UnsignedBits Convert(T v) {
+    const U sign_bit = std::is_signed<T>::value ? (static_cast<U>(1) << (sizeof(U) * 8 - 1)) : 0;
+    return static_cast<U>(static_cast<U>(v) ^ sign_bit);
+  }
+};
+
+template<>
+struct RadixSelectTraits<int8_t> : public IntegralRadixSelectTraits<int8_t, uint8_t> {};
+template<>
+struct RadixSelectTraits<uint8_t> : public IntegralRadixSelectTraits<uint8_t, uint8_t> {};
+template<>
+struct RadixSelectTraits<int32_t> : public IntegralRadixSelectTraits<int32_t, uint32_t> {};
+template<>
+struct RadixSelectTraits<int64_t> : public IntegralRadixSelectTraits<int64_t, uint64_t> {};
+
+constexpr int kRadixBits = 8;
+constexpr int kRadixSize = 1 << kRadixBits;
+constexpr int kRadixSelectBlockSize = 512;
+
+// One block per instance. The bits of the k-th largest value are found most significant digit
+// first with a shared memory histogram per digit, then the instance is scanned once more in
+// index order to gather every value above it and the first values equal to it. The gathered
+// entries keep their index order, so ties stay stable through the segmented sort that follows.
+template<typename T>
+__global__ void RadixSelectTopKGpu(const T* in_ptr, const int64_t instance_size, const int64_t k,
+                                   typename RadixSelectTraits<T>::UnsignedBits* selected_keys_ptr,
+                                   int64_t* selected_indices_ptr) {
+  using Traits = RadixSelectTraits<T>;
+  using UnsignedBits = typename Traits::UnsignedBits;
+  using BlockScan = cub::BlockScan<uint64_t, kRadixSelectBlockSize>;
+  __shared__ typename BlockScan::TempStorage scan_storage;
+  __shared__ int32_t histogram[kRadixSize];
+  __shared__ UnsignedBits shared_desired;
+  __shared__ int64_t shared_k_to_find;
+
+  const T* input = in_ptr + blockIdx.x * instance_size;
+  UnsignedBits desired = 0;
+  UnsignedBits desired_mask = 0;
+  int64_t k_to_find = k;
+  for (int digit_pos = sizeof(UnsignedBits) * 8 - kRadixBits; digit_pos >= 0;
+       digit_pos -= kRadixBits) {
+    for (int i = threadIdx.x; i < kRadixSize; i += blockDim.x) { histogram[i] = 0; }
+    __syncthreads();
+    for (int64_t i = threadIdx.x; i < instance_size; i += blockDim.x) {
+      const UnsignedBits bits = Traits::Convert(input[i]);
+      if ((bits & desired_mask) == desired) {
+        atomicAdd(&histogram[(bits >> digit_pos) & (kRadixSize - 1)], 1);
+      }
+    }
+    __syncthreads();
+    if (threadIdx.x == 0) {
+      for (int digit = kRadixSize - 1; digit >= 0; --digit) {
+        const int64_t count = histogram[digit];
+        if (count >= k_to_find) {
+          shared_desired = desired | static_cast<UnsignedBits>(static_cast<UnsignedBits>(digit)
+                                                               << digit_pos);
+          break;
+        }
+        k_to_find -= count;
+      }
+      shared_k_to_find = k_to_find;
+    }
+    __syncthreads();
+    desired = shared_desired;
+    k_to_find = shared_k_to_find;
+    desired_mask |= static_cast<UnsignedBits>(static_cast<UnsignedBits>(kRadixSize - 1)
+                                              << digit_pos);
+  }
+
+  const int64_t num_greater = k - k_to_find;
+  UnsignedBits* selected_keys = selected_keys_ptr + blockIdx.x * k;
+  int64_t* selected_indices = selected_indices_ptr + blockIdx.x * k;
+  int64_t greater_base = 0;
+  int64_t equal_base = 0;
+  for (int64_t tile = 0; tile < instance_size; tile += blockDim.x) {
+    if (greater_base == num_greater && equal_base >= k_to_find) { break; }
+    const int64_t i = tile + threadIdx.x;
+    UnsignedBits bits = 0;
+    bool greater = false;
+    bool equal = false;
+    if (i < instance_size) {
+      bits = Traits::Convert(input[i]);
+      greater = bits > desired;
+      equal = bits == desired;
+    }
+    // Both counters are scanned at once, the greater one in the high 32 bits.
+    const uint64_t flags = (static_cast<uint64_t>(greater) << 32) | static_cast<uint64_t>(equal);
+    uint64_t offsets = 0;
+    uint64_t aggregate = 0;
+    BlockScan(scan_storage).ExclusiveSum(flags, offsets, aggregate);
+    if (greater) {
+      const int64_t pos = greater_base + static_cast<int64_t>(offsets >> 32);
+      selected_keys[pos] = bits;
+      selected_indices[pos] = i;
+    } else if (equal) {
+      const int64_t rank = equal_base + static_cast<int64_t>(offsets & 0xffffffffull);
+      if (rank < k_to_find) {
+        selected_keys[num_greater + rank] = bits;
+        selected_indices[num_greater + rank] = i;
+      }
+    }
+    greater_base += static_cast<int64_t>(aggregate >> 32);
+    equal_base += static_cast<int64_t>(aggregate & 0xffffffffull);
+    __syncthreads();
+  }
+}
+
+template<typename T>
+class TmpBufferManager final {
+ public:
+  using UnsignedBits = typename RadixSelectTraits<T>::UnsignedBits;
+  OF_DISALLOW_COPY_AND_MOVE(TmpBufferManager);
+  TmpBufferManager(int64_t capacity, void* ptr, int64_t instance_num, int64_t k)
+      : capacity_{capacity} {
+    const int64_t keys_aligned_bytes =
+        GetCudaAlignedSize(instance_num * k * sizeof(UnsignedBits));
+    const int64_t indices_aligned_bytes = GetCudaAlignedSize(instance_num * k * sizeof(int64_t));
+    selected_keys_ptr_ = reinterpret_cast<UnsignedBits*>(ptr);
+    selected_indices_ptr_ = reinterpret_cast<int64_t*>(reinterpret_cast<char*>(selected_keys_ptr_)
+                                                       + keys_aligned_bytes);
+    sorted_keys_ptr_ = reinterpret_cast<UnsignedBits*>(
+        reinterpret_cast<char*>(selected_indices_ptr_) + indices_aligned_bytes);
+    temp_storage_ptr_ =
+        reinterpret_cast<void*>(reinterpret_cast<char*>(sorted_keys_ptr_) + keys_aligned_bytes);
+    temp_storage_bytes_ = capacity_ - 2 * keys_aligned_bytes - indices_aligned_bytes;
+    CHECK_GE(temp_storage_bytes_, 0);
+  }
+  ~TmpBufferManager() = default;
+
+  UnsignedBits* SelectedKeysPtr() const { return selected_keys_ptr_; }
+  int64_t* SelectedIndicesPtr() const { return selected_indices_ptr_; }
+  UnsignedBits* SortedKeysPtr() const { return sorted_keys_ptr_; }
+  void* TempStoragePtr() const { return temp_storage_ptr_; }
+
+  int64_t TempStorageBytes() const { return temp_storage_bytes_; }
+
+ private:
+  int64_t capacity_;
+
+  UnsignedBits* selected_keys_ptr_;
+  int64_t* selected_indices_ptr_;
+  UnsignedBits* sorted_keys_ptr_;
+  void* temp_storage_ptr_;
+
+  int64_t temp_storage_bytes_;
+};
+
+template<typename T>
+size_t InferRadixSelectTopKTmpSize(user_op::InferContext* ctx) {
+  using UnsignedBits = typename RadixSelectTraits<T>::UnsignedBits;
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  const int64_t elem_cnt = in_shape.elem_cnt();
+  const int64_t instance_size = in_shape.dim_vec().back();
+  const int64_t instance_num = elem_cnt / instance_size;
+  const int64_t k = std::min(static_cast<int64_t>(ctx->Attr<int32_t>("k")), instance_size);
+  const int64_t keys_aligned_bytes = GetCudaAlignedSize(instance_num * k * sizeof(UnsignedBits));
+  const int64_t indices_aligned_bytes = GetCudaAlignedSize(instance_num * k * sizeof(int64_t));
+  const int64_t temp_storage_bytes =
+      InferTempStorageForSortPairsDescending<UnsignedBits, int64_t>(instance_num, k);
+  return 2 * keys_aligned_bytes + indices_aligned_bytes + temp_storage_bytes;
+}
+
+}  // namespace
+
+template<typename T>
+class GpuRadixSelectTopKKernel final : public user_op::OpKernel {
+ public:
+  GpuRadixSelectTopKKernel() = default;
+  ~GpuRadixSelectTopKKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    if (in->shape().elem_cnt() == 0) { return; }
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+
+    const int64_t elem_cnt = in->shape().elem_cnt();
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = elem_cnt / instance_size;
+    const int64_t k = std::min(static_cast<int64_t>(ctx->Attr<int32_t>("k")), instance_size);
+    TmpBufferManager<T> buf_manager(static_cast<int64_t>(tmp_buffer->shape().elem_cnt()),
+                                    tmp_buffer->mut_dptr<void>(), instance_num, k);
+    cudaStream_t cuda_stream = ctx->stream()->As<ep::CudaStream>()->cuda_stream();
+    RadixSelectTopKGpu<T><<<instance_num, kRadixSelectBlockSize, 0, cuda_stream>>>(
+        in->dptr<T>(), instance_size, k, buf_manager.SelectedKeysPtr(),
+        buf_manager.SelectedIndicesPtr());
+    if (ctx->Attr<bool>("sorted")) {
+      SortPairsDescending(buf_manager.SelectedKeysPtr(), buf_manager.SelectedIndicesPtr(),
+                          instance_num, k, buf_manager.TempStoragePtr(),
+                          buf_manager.TempStorageBytes(), buf_manager.SortedKeysPtr(),
+                          out->mut_dptr<int64_t>(), cuda_stream);
+    } else {
+      OF_CUDA_CHECK(cudaMemcpyAsync(out->mut_dptr<int64_t>(), buf_manager.SelectedIndicesPtr(),
+                                    instance_num * k * sizeof(int64_t), cudaMemcpyDefault,
+                                    cuda_stream));
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(dtype, data_type)                                 \
+  REGISTER_USER_KERNEL("top_k")                                                                   \
+      .SetCreateFn<GpuRadixSelectTopKKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCUDA) && HobUseRadixSelectTopK() \
+                       && (user_op::HobDataType("in", 0) == data_type))                           \
+      .SetInferTmpSizeFn(InferRadixSelectTopKTmpSize<dtype>);
+
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(float, DataType::kFloat)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(double, DataType::kDouble)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(half, DataType::kFloat16)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(uint8_t, DataType::kUInt8)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(int8_t, DataType::kInt8)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(int32_t, DataType::kInt32)
+REGISTER_CUDA_RADIX_SELECT_TOP_K_KERNEL(int64_t, DataType::kInt64)
+
+}  // namespace oneflow
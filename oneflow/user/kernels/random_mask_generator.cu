@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/user/kernels/random_mask_generator.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
 
 namespace oneflow {
 
@@ -29,38 +30,53 @@ union Pack {
   bool b_value[sizeof(PackType)];
 };
 
-__device__ bool GenMask(curandState* state, const float rate) {
-  return curand_uniform(state) > rate;
+constexpr int32_t kPackSize = sizeof(PackType);
+// The numbers of a pack are drawn four at a time from the subsequence of the pack.
+constexpr uint64_t kOffsetIncrement = kPackSize;
+
+__device__ void GenPackMask(uint64_t seed, uint64_t offset, int64_t pack_idx, const float rate,
+                            Pack* pack) {
+  cuda::philox::State state = cuda::philox::MakeState(seed, offset, pack_idx);
+#pragma unroll
+  for (int j = 0; j < kPackSize; j += 4) {
+    const float4 rand = curand_uniform4(&state);
+    pack->b_value[j] = rand.x > rate;
+    pack->b_value[j + 1] = rand.y > rate;
+    pack->b_value[j + 2] = rand.z > rate;
+    pack->b_value[j + 3] = rand.w > rate;
+  }
 }
 
-__global__ void GenerateGpu(curandState* state, const int64_t n, const float rate, bool* mask) {
-  const int id = blockIdx.x * blockDim.x + threadIdx.x;
-  curandState localState = state[id];
+__global__ void GenerateGpu(uint64_t seed, one::CUDAGeneratorState* gen_state, const int64_t n,
+                            const float rate, bool* mask) {
+  const uint64_t offset = cuda::philox::Offset(gen_state);
   PackType* pack_mask = reinterpret_cast<PackType*>(mask);
+  const int64_t num_packs = n / kPackSize;
   Pack pack;
-  CUDA_1D_KERNEL_LOOP(i, n / sizeof(PackType)) {
-#pragma unroll
-    for (int j = 0; j < sizeof(PackType); ++j) { pack.b_value[j] = GenMask(&localState, rate); }
+  CUDA_1D_KERNEL_LOOP(i, num_packs) {
+    GenPackMask(seed, offset, i, rate, &pack);
     pack_mask[i] = pack.p_value;
   }
-  const int32_t rem_cnt = n % sizeof(PackType);
-  const int32_t rem_offset = n - rem_cnt;
-  if (id < rem_cnt) { mask[id + rem_offset] = GenMask(&localState, rate); }
-  state[id] = localState;
+  const int32_t rem_cnt = n % kPackSize;
+  if (rem_cnt > 0 && blockIdx.x == 0 && threadIdx.x == 0) {
+    GenPackMask(seed, offset, num_packs, rate, &pack);
+    for (int32_t j = 0; j < rem_cnt; ++j) { mask[num_packs * kPackSize + j] = pack.b_value[j]; }
+  }
+  cuda::philox::AdvanceOffset(gen_state, kOffsetIncrement);
 }
 
 }  // namespace
 
 void RandomMaskGenerator<DeviceType::kCUDA>::Generate(ep::Stream* stream, const int64_t n,
                                                       const float rate, bool* mask) {
+  if (n == 0) { return; }
   int32_t block_num = generator_->max_block_num();
   int32_t thread_num = generator_->max_thread_num();
-  auto* curand_states = generator_->curand_states();
-  const int32_t elem_cnt_per_block = thread_num * sizeof(PackType) * kMinPackPerThread;
+  const int32_t elem_cnt_per_block = thread_num * kPackSize * kMinPackPerThread;
   const int32_t block_num_final =
       std::min(static_cast<int32_t>((n + elem_cnt_per_block - 1) / elem_cnt_per_block), block_num);
   GenerateGpu<<<block_num_final, thread_num, 0, stream->As<ep::CudaStream>()->cuda_stream()>>>(
-      curand_states, n, rate, mask);
+      generator_->current_seed(), generator_->cuda_gen_state(), n, rate, mask);
 }
 
 template class RandomMaskGenerator<DeviceType::kCUDA>;
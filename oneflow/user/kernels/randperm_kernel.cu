@@ -13,9 +13,6 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-#include <curand.h>
-#include <curand_kernel.h>
-
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/ep/include/stream.h"
 #include "oneflow/core/framework/framework.h"
@@ -25,14 +22,18 @@ limitations under the License.
 #include "oneflow/user/kernels/radix_sort.cuh"
 #include "oneflow/user/kernels/distributions/common.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/cuda/philox.cuh"
 
 namespace oneflow {
-__global__ void GeneKeysAndValues(const int32_t n, int32_t* values, int32_t* keys,
-                                  curandState* state) {
+__global__ void GeneKeysAndValues(uint64_t seed, one::CUDAGeneratorState* gen_state,
+                                  const int32_t n, int32_t* values, int32_t* keys) {
+  const uint64_t offset = cuda::philox::Offset(gen_state);
   XPU_1D_KERNEL_LOOP(i, n) {
-    keys[i] = curand(state + i);
+    cuda::philox::State state = cuda::philox::MakeState(seed, offset, i);
+    keys[i] = curand(&state);
     values[i] = i;
   }
+  cuda::philox::AdvanceOffset(gen_state, cuda::philox::kOffsetIncrement);
 }
 
 class GpuRandPermKernel final : public user_op::OpKernel {
@@ -63,8 +64,6 @@ class GpuRandPermKernel final : public user_op::OpKernel {
     CHECK_NOTNULL(generator);
 
     int32_t block_num = gpu_generator->max_block_num();
-    int32_t thread_num = gpu_generator->max_thread_num();
-    curandState* curand_states = gpu_generator->curand_states();
 
     // layout for tmp |...key(in and out,2xN)..|....value....|.... space for sort function....|
     // values are the desired indexes ,and keys are generated randomly.
@@ -82,7 +81,7 @@ class GpuRandPermKernel final : public user_op::OpKernel {
 
     GeneKeysAndValues<<<block_num, kCudaThreadsNumPerBlock, 0,
                         ctx->stream()->As<ep::CudaStream>()->cuda_stream()>>>(
-        n, value_base, key_base, curand_states);
+        gpu_generator->current_seed(), gpu_generator->cuda_gen_state(), n, value_base, key_base);
 
     auto err = cub::DeviceRadixSort::SortPairs(
         /* d_temp_storage */ tmp_base,
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/framework/consistent_tensor_infer_cache.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/kernel/cuda_graph_support.h"
 
 namespace oneflow {
 namespace one {
@@ -384,6 +385,8 @@ Maybe<void> InitTensorTupleIndexes4Bns(const std::shared_ptr<const OperatorConf>
   opkernel->input_arg_tuple_ = input_arg_tuple;
   opkernel->output_arg_tuple_ = output_arg_tuple;
   opkernel->need_check_mem_case_ = true;
+  opkernel->max_kernel_priority_ =
+      user_op::UserOpRegistryMgr::Get().GetOpKernelMaxPriority(op_conf->user_conf().op_type_name());
 
   opkernel->tmp_blob_object_.reset(
       new vm::EagerBlobObject(opkernel->mem_case(), std::make_shared<Shape>(), DataType::kChar,
@@ -437,8 +440,11 @@ Maybe<void> StatefulLocalOpKernel::ChooseOpKernel(
     // do nothing
   }
 
-  for (const auto& pair : dtype2cached_kernels_[primary_dtype]) {
-    if (likely(pair.first->is_matched_hob->get(*reg_ctx_))) {
+  auto* cached_kernels = &dtype2cached_kernels_[primary_dtype];
+  for (const auto& pair : *cached_kernels) {
+    // A cached kernel of lower priority may be shadowed by one not cached yet.
+    if (likely(pair.first->priority == max_kernel_priority_
+               && pair.first->is_matched_hob->get(*reg_ctx_))) {
       reg_ctx_->Update(AttrMap{}, nullptr, nullptr, nullptr);
       *need_temp_storage = pair.first->need_temp_storage;
       *user_opkernel = pair.second.get();
@@ -452,9 +458,16 @@ Maybe<void> StatefulLocalOpKernel::ChooseOpKernel(
   const auto* kernel_reg_val =
       JUST(user_op::UserOpRegistryMgr::Get().GetOpKernelRegistryResult(op_type_name, *reg_ctx_));
   CHECK_NOTNULL(kernel_reg_val);
+  for (const auto& pair : *cached_kernels) {
+    if (pair.first == kernel_reg_val) {
+      reg_ctx_->Update(AttrMap{}, nullptr, nullptr, nullptr);
+      *need_temp_storage = pair.first->need_temp_storage;
+      *user_opkernel = pair.second.get();
+      return Maybe<void>::Ok();
+    }
+  }
   auto* kernel = kernel_reg_val->create_fn();
-  dtype2cached_kernels_[primary_dtype].push_back(
-      {kernel_reg_val, std::shared_ptr<const user_op::OpKernel>(kernel)});
+  cached_kernels->push_back({kernel_reg_val, std::shared_ptr<const user_op::OpKernel>(kernel)});
 
   infer_tmp_size_fn_map_.emplace(kernel, &kernel_reg_val->infer_tmp_size_fn);
   reg_ctx_->Update(AttrMap{}, nullptr, nullptr, nullptr);
@@ -490,6 +503,40 @@ void StatefulLocalOpKernel::TryInitOpKernelStateAndCache(
   }
 }
 
+user_op::OpKernelState* StatefulLocalOpKernel::LookupOpKernelState(
+    const user_op::OpKernel* op_kernel) const {
+  auto it = op_kernel_state_map_.find(op_kernel);
+  return it == op_kernel_state_map_.end() ? nullptr : it->second.get();
+}
+
+user_op::OpKernelCache* StatefulLocalOpKernel::LookupOpKernelCache(
+    const user_op::OpKernel* op_kernel) const {
+  auto it = op_kernel_cache_map_.find(op_kernel);
+  return it == op_kernel_cache_map_.end() ? nullptr : it->second.get();
+}
+
+bool StatefulLocalOpKernel::IsCudaGraphSupported(
+    const user_op::OpKernel* op_kernel, DeviceCtx* device_ctx, EagerBlobObjectListRawPtr inputs,
+    EagerBlobObjectListRawPtr outputs,
+    ConsistentTensorInferResultRawPtr consistent_tensor_infer_result,
+    user_op::OpKernelState* state) {
+  auto it = cuda_graph_supported_map_.find(op_kernel);
+  if (it != cuda_graph_supported_map_.end()) { return it->second; }
+  const auto* cuda_graph_support = dynamic_cast<const user_op::CudaGraphSupport*>(op_kernel);
+  bool supported = false;
+  if (cuda_graph_support != nullptr) {
+    LocalUserKernelInitAndCacheContext init_ctx(
+        device_ctx, op_conf_->device_tag(), user_op_conf_.get(), input_arg_tuple_,
+        output_arg_tuple_, inputs, outputs, consistent_tensor_infer_result,
+        composed_attrs_for_scheduler_thread());
+    supported = cuda_graph_support->IsCudaGraphSupported(&init_ctx, state);
+  }
+  VLOG(3) << "Eager CUDA Graphs " << (supported ? "supported: " : "not supported: ")
+          << op_type_name();
+  cuda_graph_supported_map_.emplace(op_kernel, supported);
+  return supported;
+}
+
 const user_op::InferTmpSizeFn& StatefulLocalOpKernel::GetInferTmpSizeFn(
     const user_op::OpKernel* op_kernel) const {
   return *infer_tmp_size_fn_map_.at(op_kernel);
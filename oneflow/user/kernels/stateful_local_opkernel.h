@@ -435,6 +435,17 @@ class StatefulLocalOpKernel final {
       ConsistentTensorInferResultRawPtr consistent_tensor_infer_result,
       user_op::OpKernelState** state, user_op::OpKernelCache** cache);
 
+  // The state and cache of op_kernel last set by TryInitOpKernelStateAndCache, nullptr if none.
+  user_op::OpKernelState* LookupOpKernelState(const user_op::OpKernel* op_kernel) const;
+  user_op::OpKernelCache* LookupOpKernelCache(const user_op::OpKernel* op_kernel) const;
+
+  // Whether the launches of op_kernel can be captured into a CUDA graph and replayed, the answer is
+  // computed once for each op kernel.
+  bool IsCudaGraphSupported(const user_op::OpKernel* op_kernel, DeviceCtx* device_ctx,
+                            EagerBlobObjectListRawPtr inputs, EagerBlobObjectListRawPtr outputs,
+                            ConsistentTensorInferResultRawPtr consistent_tensor_infer_result,
+                            user_op::OpKernelState* state);
+
   vm::EagerBlobObject* mut_temp_blob_object();
 
   user_op::OpKernelState* mut_opkernel_state(const user_op::OpKernel* opkernel) {
@@ -464,9 +475,11 @@ class StatefulLocalOpKernel final {
                                    std::shared_ptr<const user_op::OpKernel>>>,
              DataType_MAX>
       dtype2cached_kernels_;
+  int32_t max_kernel_priority_;
   HashMap<const user_op::OpKernel*, std::shared_ptr<user_op::OpKernelState>> op_kernel_state_map_;
   HashMap<const user_op::OpKernel*, std::shared_ptr<user_op::OpKernelCache>> op_kernel_cache_map_;
   HashMap<const user_op::OpKernel*, const user_op::InferTmpSizeFn*> infer_tmp_size_fn_map_;
+  HashMap<const user_op::OpKernel*, bool> cuda_graph_supported_map_;
   std::unique_ptr<vm::EagerBlobObject> tmp_blob_object_;
   std::vector<int64_t> input_tuple_indexes4const_ibns_;
   std::vector<int64_t> input_tuple_indexes4mut_ibns_;
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/user/kernels/to_contiguous_kernel.h"
 #include "oneflow/core/framework/stride.h"
 #include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/ep/include/primitive/elementwise_unary.h"
 
 namespace oneflow {
 
@@ -74,6 +75,9 @@ struct ToContiguousUtil<DeviceType::kCPU, T> : ToContiguousUtilBase {
 
 namespace {
 
+// The most dims the strided launch of ep::primitive::ElementwiseUnary takes.
+constexpr int64_t kMaxPrimitiveNumDims = 8;
+
 template<DeviceType device_type, typename T>
 class ToContiguousKernel final : public user_op::OpKernel {
  public:
@@ -92,6 +96,23 @@ class ToContiguousKernel final : public user_op::OpKernel {
 
     const auto& in_stride = ctx->Attr<std::vector<int64_t>>("stride");
 
+    const int64_t num_dims = in_shape.NumAxes();
+    if (num_dims <= kMaxPrimitiveNumDims) {
+      auto primitive = ep::primitive::NewPrimitive<ep::primitive::ElementwiseUnaryFactory>(
+          ctx->device_type(), ep::primitive::UnaryOp::kIdentity, in_data_type, in_data_type);
+      if (primitive) {
+        int64_t out_stride[kMaxPrimitiveNumDims];
+        int64_t stride = 1;
+        for (int64_t i = num_dims - 1; i >= 0; --i) {
+          out_stride[i] = stride;
+          stride *= in_shape.At(i);
+        }
+        primitive->Launch(ctx->stream(), num_dims, in_shape.ptr(), in_stride.data(), in->dptr(),
+                          out_stride, out->mut_dptr());
+        return;
+      }
+    }
+
     const char* in_dptr = static_cast<const char*>(in->raw_dptr());
     char* out_dptr = static_cast<char*>(out->mut_raw_dptr());
     ToContiguousUtil<device_type, T>(ctx->stream(), in_shape, in_stride, in_dptr, out_dptr)();
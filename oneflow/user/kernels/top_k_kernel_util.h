@@ -0,0 +1,49 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_TOP_K_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_TOP_K_KERNEL_UTIL_H_
+
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+// The heap selection kernel keeps one heap of k entries per thread in shared memory and runs a
+// single block per instance, so it only pays off while both k and the instance are small. All
+// other cases go to the radix select kernel.
+constexpr int32_t kHeapSelectionTopKMaxK = 128;
+constexpr int64_t kHeapSelectionTopKMaxInstanceSize = 4096;
+
+ALWAYS_INLINE inline auto HobTopKInstanceSize() {
+  return hob::make_custom("top_k_instance_size",
+                          [](const user_op::KernelRegContext& ctx) -> int64_t {
+                            const user_op::TensorDesc* in = ctx.TensorDesc4ArgNameAndIndex("in", 0);
+                            return in->shape().NumAxes() == 0 ? 1 : in->shape().dim_vec().back();
+                          });
+}
+
+ALWAYS_INLINE inline auto HobUseHeapSelectionTopK() {
+  return (user_op::HobAttr<int32_t>("k") <= kHeapSelectionTopKMaxK)
+         && (HobTopKInstanceSize() <= kHeapSelectionTopKMaxInstanceSize);
+}
+
+ALWAYS_INLINE inline auto HobUseRadixSelectTopK() {
+  return (user_op::HobAttr<int32_t>("k") > kHeapSelectionTopKMaxK)
+         || (HobTopKInstanceSize() > kHeapSelectionTopKMaxInstanceSize);
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_TOP_K_KERNEL_UTIL_H_
@@ -14,53 +14,60 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/ep/include/primitive/unique.h"
 
 namespace oneflow {
 
+namespace {
+
 template<typename KEY, typename IDX>
-struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
-  static void Unique(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
-                     IDX* idx_out, void* workspace, int64_t workspace_size_in_bytes) {
-    UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::UniqueWithCounts(
-        stream, n, in, num_unique, unique_out, idx_out, nullptr, workspace,
-        workspace_size_in_bytes);
-  }
-  static void UniqueWithCounts(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique,
-                               KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
-                               int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
-    }
-    *num_unique = map.size();
-  }
-  static void GetUniqueWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
-                                            int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
-  }
-  static void GetUniqueWithCountsWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
-                                                      int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
-  }
-};
+std::unique_ptr<ep::primitive::Unique> NewUniquePrimitive(DeviceType device_type) {
+  auto primitive = ep::primitive::NewPrimitive<ep::primitive::UniqueFactory>(
+      device_type, GetDataType<KEY>::value, GetDataType<IDX>::value);
+  CHECK(primitive);
+  return primitive;
+}
+
+}  // namespace
+
+template<DeviceType device_type, typename KEY, typename IDX>
+void UniqueKernelUtil<device_type, KEY, IDX>::Unique(ep::Stream* stream, int64_t n, const KEY* in,
+                                                     IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                                                     void* workspace,
+                                                     int64_t workspace_size_in_bytes) {
+  NewUniquePrimitive<KEY, IDX>(device_type)
+      ->Launch(stream, n, in, num_unique, unique_out, idx_out, nullptr, workspace,
+               workspace_size_in_bytes);
+}
+
+template<DeviceType device_type, typename KEY, typename IDX>
+void UniqueKernelUtil<device_type, KEY, IDX>::UniqueWithCounts(
+    ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+    IDX* count, void* workspace, int64_t workspace_size_in_bytes) {
+  NewUniquePrimitive<KEY, IDX>(device_type)
+      ->Launch(stream, n, in, num_unique, unique_out, idx_out, count, workspace,
+               workspace_size_in_bytes);
+}
+
+template<DeviceType device_type, typename KEY, typename IDX>
+void UniqueKernelUtil<device_type, KEY, IDX>::GetUniqueWorkspaceSizeInBytes(
+    ep::Stream* stream, int64_t n, int64_t* workspace_size_in_bytes) {
+  *workspace_size_in_bytes = static_cast<int64_t>(
+      NewUniquePrimitive<KEY, IDX>(device_type)->GetWorkspaceSizeInBytes(n, false));
+}
+
+template<DeviceType device_type, typename KEY, typename IDX>
+void UniqueKernelUtil<device_type, KEY, IDX>::GetUniqueWithCountsWorkspaceSizeInBytes(
+    ep::Stream* stream, int64_t n, int64_t* workspace_size_in_bytes) {
+  *workspace_size_in_bytes = static_cast<int64_t>(
+      NewUniquePrimitive<KEY, IDX>(device_type)->GetWorkspaceSizeInBytes(n, true));
+}
 
-#define INSTANTIATE_UNIQUE_KERNEL_UTIL_CPU(key_type_pair, idx_type_pair)              \
-  template struct UniqueKernelUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(key_type_pair), \
+#define INSTANTIATE_UNIQUE_KERNEL_UTIL(device_type, key_type_pair, idx_type_pair) \
+  template struct UniqueKernelUtil<device_type, OF_PP_PAIR_FIRST(key_type_pair),  \
                                    OF_PP_PAIR_FIRST(idx_type_pair)>;
-OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_UNIQUE_KERNEL_UTIL_CPU, ARITHMETIC_DATA_TYPE_SEQ,
-                                 INDEX_DATA_TYPE_SEQ);
-#undef INSTANTIATE_UNIQUE_KERNEL_UTIL_CPU
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INSTANTIATE_UNIQUE_KERNEL_UTIL, DEVICE_TYPE_SEQ,
+                                 ARITHMETIC_DATA_TYPE_SEQ, INDEX_DATA_TYPE_SEQ);
+#undef INSTANTIATE_UNIQUE_KERNEL_UTIL
 
 }  // namespace oneflow
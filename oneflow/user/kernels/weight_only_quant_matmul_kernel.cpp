@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/kernel/cuda_graph_support.h"
+#include "oneflow/core/ep/include/primitive/weight_only_quant_matmul.h"
+
+namespace oneflow {
+
+namespace {
+
+std::unique_ptr<ep::primitive::WeightOnlyQuantMatmul> NewWeightOnlyQuantMatmulPrimitive(
+    DeviceType device_type, DataType data_type, int32_t num_bits) {
+  return ep::primitive::NewPrimitive<ep::primitive::WeightOnlyQuantMatmulFactory>(
+      device_type, data_type, num_bits);
+}
+
+auto WeightOnlyQuantMatmulPrimitiveExists() {
+  return hob::make_custom("WeightOnlyQuantMatmulPrimitiveExists",
+                          [](const user_op::KernelRegContext& ctx) {
+                            return NewWeightOnlyQuantMatmulPrimitive(
+                                       ctx.device_type(),
+                                       ctx.TensorDesc4ArgNameAndIndex("out", 0)->data_type(),
+                                       ctx.Attr<int32_t>("num_bits"))
+                                .operator bool();
+                          });
+}
+
+class WeightOnlyQuantMatmulKernel final : public user_op::OpKernel,
+                                          public user_op::CudaGraphSupport {
+ public:
+  WeightOnlyQuantMatmulKernel() = default;
+  ~WeightOnlyQuantMatmulKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* scale = ctx->Tensor4ArgNameAndIndex("scale", 0);
+    const user_op::Tensor* bias =
+        ctx->has_input("bias", 0) ? ctx->Tensor4ArgNameAndIndex("bias", 0) : nullptr;
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t k = x->shape().At(x->shape().NumAxes() - 1);
+    const int64_t m = x->shape().elem_cnt() / k;
+    const int64_t n = weight->shape().At(0);
+    auto matmul = NewWeightOnlyQuantMatmulPrimitive(ctx->device_type(), out->data_type(),
+                                                    ctx->Attr<int32_t>("num_bits"));
+    CHECK(matmul);
+    matmul->Launch(ctx->stream(), m, n, k, ctx->Attr<int64_t>("group_size"), x->dptr(),
+                   weight->dptr(), scale->dptr(), bias == nullptr ? nullptr : bias->dptr(),
+                   out->mut_dptr(), tmp_buffer->mut_dptr(), tmp_buffer->shape().elem_cnt());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+REGISTER_USER_KERNEL("weight_only_quant_matmul")
+    .SetCreateFn<WeightOnlyQuantMatmulKernel>()
+    .SetIsMatchedHob(WeightOnlyQuantMatmulPrimitiveExists())
+    .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {
+      const Shape& x_shape = ctx->InputShape("x", 0);
+      const int64_t k = x_shape.At(x_shape.NumAxes() - 1);
+      auto matmul = NewWeightOnlyQuantMatmulPrimitive(ctx->parallel_desc().device_type(),
+                                                      ctx->InputDType("x", 0),
+                                                      ctx->Attr<int32_t>("num_bits"));
+      CHECK(matmul);
+      return matmul->GetWorkspaceSizeInBytes(x_shape.elem_cnt() / k,
+                                             ctx->InputShape("weight", 0).At(0), k);
+    });
+
+}  // namespace
+
+}  // namespace oneflow
@@ -33,6 +33,18 @@ namespace oneflow {
   }
   const int64_t num_ids = ids_shape.elem_cnt();
   const int64_t parallel_num = ctx->parallel_num();
+  // The ids of a column placed table-wise all go to one rank instead of being partitioned by hash,
+  // so an id must not appear in two columns, see embedding::PlanEmbeddingSharding.
+  const auto& column_parallel_ids = ctx->Attr<std::vector<int64_t>>("column_parallel_ids");
+  if (!column_parallel_ids.empty()) {
+    CHECK_OR_RETURN(ctx->has_input("column_ids", 0) || num_columns > 1)
+        << "column_parallel_ids needs the column ids";
+    CHECK_EQ_OR_RETURN(column_parallel_ids.size(), num_columns);
+    for (const int64_t parallel_id : column_parallel_ids) {
+      CHECK_GE_OR_RETURN(parallel_id, -1);
+      CHECK_LT_OR_RETURN(parallel_id, parallel_num);
+    }
+  }
   *ctx->OutputShape("num_unique_matrix", 0) = Shape({parallel_num * parallel_num});
   *ctx->OutputShape("inverse_unique_partition_indices", 0) = ids_shape;
   *ctx->OutputShape("cur_rank_num_unique", 0) = Shape({1});
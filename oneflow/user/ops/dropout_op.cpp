@@ -15,13 +15,14 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/framework/op_generated.h"
+#include "oneflow/user/kernels/dropout_kernel.h"
 
 namespace oneflow {
 
 /* static */ Maybe<void> DropoutOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
   const Shape& in_shape = ctx->InputShape("in", 0);
   *ctx->OutputShape("out", 0) = in_shape;
-  *ctx->OutputShape("mask", 0) = in_shape;
+  *ctx->OutputShape("mask", 0) = DropoutMaskShape(in_shape);
   *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("in", 0);
   return Maybe<void>::Ok();
 }
@@ -30,9 +31,21 @@ namespace oneflow {
   return InferLogicalTensorDesc(ctx);
 }
 
+namespace {
+
+// The bits of a row of the last axis are packed into bytes, so the mask splits along the last
+// axis only when every rank gets whole bytes.
+bool IsDropoutMaskSplitable(const Shape& shape, int64_t axis, int64_t parallel_num) {
+  if (axis != shape.NumAxes() - 1) { return true; }
+  return shape.At(axis) % (kDropoutMaskBits * parallel_num) == 0;
+}
+
+}  // namespace
+
 /* static */ Maybe<void> DropoutOp::GetSbp(user_op::SbpContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
   FOR_RANGE(int64_t, axis, 0, in_tensor.shape().NumAxes()) {
+    if (!IsDropoutMaskSplitable(in_tensor.shape(), axis, ctx->parallel_num())) { continue; }
     ctx->NewBuilder().Split(ctx->inputs(), axis).Split(ctx->outputs(), axis).Build();
   }
   return Maybe<void>::Ok();
@@ -47,7 +60,7 @@ namespace oneflow {
 
 /* static */ Maybe<void> DropoutOp::InferDataType(user_op::InferContext* ctx) {
   *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
-  *ctx->OutputDType("mask", 0) = DataType::kBool;
+  *ctx->OutputDType("mask", 0) = DataType::kUInt8;
   return Maybe<void>::Ok();
 }
 
@@ -55,7 +68,12 @@ namespace oneflow {
   const Shape& dy_shape = ctx->InputShape("dy", 0);
   *ctx->OutputShape("dx", 0) = dy_shape;
   *ctx->OutputIsDynamic("dx", 0) = ctx->InputIsDynamic("dy", 0);
-  CHECK_EQ_OR_RETURN(ctx->InputShape("mask", 0), dy_shape);
+  // A bool per element from random_mask_like, or the packed bits from dropout.
+  if (ctx->InputDType("mask", 0) == DataType::kBool) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("mask", 0), dy_shape);
+  } else {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("mask", 0), DropoutMaskShape(dy_shape));
+  }
   return Maybe<void>::Ok();
 }
 
@@ -65,7 +83,12 @@ namespace oneflow {
 
 /* static */ Maybe<void> DropoutGradOp::GetSbp(user_op::SbpContext* ctx) {
   const user_op::TensorDesc& dy_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("dy", 0);
+  const bool packed_mask =
+      ctx->LogicalTensorDesc4InputArgNameAndIndex("mask", 0).data_type() != DataType::kBool;
   FOR_RANGE(int64_t, axis, 0, dy_tensor.shape().NumAxes()) {
+    if (packed_mask && !IsDropoutMaskSplitable(dy_tensor.shape(), axis, ctx->parallel_num())) {
+      continue;
+    }
     ctx->NewBuilder()
         .Split(user_op::OpArg("dy", 0), axis)
         .Split(user_op::OpArg("mask", 0), axis)
@@ -84,7 +107,8 @@ namespace oneflow {
 
 /* static */ Maybe<void> DropoutGradOp::InferDataType(user_op::InferContext* ctx) {
   *ctx->OutputDType("dx", 0) = ctx->InputDType("dy", 0);
-  CHECK_EQ_OR_RETURN(ctx->InputDType("mask", 0), DataType::kBool);
+  const DataType mask_data_type = ctx->InputDType("mask", 0);
+  CHECK_OR_RETURN(mask_data_type == DataType::kBool || mask_data_type == DataType::kUInt8);
   return Maybe<void>::Ok();
 }
 
@@ -0,0 +1,194 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckEmbeddingBagAttr(const user_op::UserOpConfWrapper& conf) {
+  const std::string& mode = conf.attr<std::string>("mode");
+  CHECK_OR_RETURN(mode == "sum" || mode == "mean" || mode == "max")
+      << "embedding_bag mode should be one of sum, mean and max, but got " << mode;
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckEmbeddingBagInputs(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& weight = ctx->InputTensorDesc("weight", 0);
+  const user_op::TensorDesc& indices = ctx->InputTensorDesc("indices", 0);
+  CHECK_EQ_OR_RETURN(weight.shape().NumAxes(), 2)
+      << "embedding_bag expects weight of shape [num_embeddings, embedding_dim]";
+  CHECK_EQ_OR_RETURN(indices.shape().NumAxes(), 2)
+      << "embedding_bag expects indices of shape [batch_size, bag_size]";
+  if (ctx->has_input("per_sample_weights", 0)) {
+    CHECK_OR_RETURN(ctx->Attr<std::string>("mode") != "max")
+        << "per_sample_weights is not supported in max mode";
+    CHECK_EQ_OR_RETURN(ctx->InputShape("per_sample_weights", 0), indices.shape());
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> EmbeddingBagOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckEmbeddingBagInputs(ctx));
+  const user_op::TensorDesc& weight = ctx->InputTensorDesc("weight", 0);
+  const user_op::TensorDesc& indices = ctx->InputTensorDesc("indices", 0);
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = Shape({indices.shape().At(0), weight.shape().At(1)});
+  out->set_is_dynamic(indices.is_dynamic());
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::GetSbp(user_op::SbpContext* ctx) {
+  auto builder = ctx->NewBuilder()
+                     .Broadcast(user_op::OpArg("weight", 0))
+                     .Split(user_op::OpArg("indices", 0), 0)
+                     .Split(user_op::OpArg("out", 0), 0);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    builder.Split(user_op::OpArg("per_sample_weights", 0), 0);
+  }
+  builder.Build();
+  auto dim_builder = ctx->NewBuilder()
+                         .Split(user_op::OpArg("weight", 0), 1)
+                         .Broadcast(user_op::OpArg("indices", 0))
+                         .Split(user_op::OpArg("out", 0), 1);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    dim_builder.Broadcast(user_op::OpArg("per_sample_weights", 0));
+  }
+  dim_builder.Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  user_op::InputArgModifier* indices_modifier = GetInputArgModifierFn("indices", 0);
+  CHECK_OR_RETURN(indices_modifier != nullptr);
+  indices_modifier->set_requires_grad(false);
+  if (conf.has_input("per_sample_weights", 0)) {
+    user_op::InputArgModifier* per_sample_weights_modifier =
+        GetInputArgModifierFn("per_sample_weights", 0);
+    CHECK_OR_RETURN(per_sample_weights_modifier != nullptr);
+    per_sample_weights_modifier->set_requires_grad(false);
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::InferDataType(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& weight = ctx->InputTensorDesc("weight", 0);
+  CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("indices", 0)));
+  if (ctx->has_input("per_sample_weights", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("per_sample_weights", 0), weight.data_type());
+  }
+  *ctx->OutputDType("out", 0) = weight.data_type();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                   const user_op::UserOpConfWrapper& conf) {
+  return CheckEmbeddingBagAttr(conf);
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckEmbeddingBagInputs(ctx));
+  const user_op::TensorDesc& weight = ctx->InputTensorDesc("weight", 0);
+  const user_op::TensorDesc& indices = ctx->InputTensorDesc("indices", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("out_grad", 0),
+                     Shape({indices.shape().At(0), weight.shape().At(1)}));
+  user_op::TensorDesc* values = ctx->OutputTensorDesc("values", 0);
+  *values->mut_shape() =
+      Shape({indices.shape().At(0), indices.shape().At(1), weight.shape().At(1)});
+  values->set_is_dynamic(indices.is_dynamic());
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::GetSbp(user_op::SbpContext* ctx) {
+  auto builder = ctx->NewBuilder()
+                     .Split(user_op::OpArg("out_grad", 0), 0)
+                     .Broadcast(user_op::OpArg("weight", 0))
+                     .Split(user_op::OpArg("indices", 0), 0)
+                     .Split(user_op::OpArg("values", 0), 0);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    builder.Split(user_op::OpArg("per_sample_weights", 0), 0);
+  }
+  builder.Build();
+  auto dim_builder = ctx->NewBuilder()
+                         .Split(user_op::OpArg("out_grad", 0), 1)
+                         .Split(user_op::OpArg("weight", 0), 1)
+                         .Broadcast(user_op::OpArg("indices", 0))
+                         .Split(user_op::OpArg("values", 0), 2);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    dim_builder.Broadcast(user_op::OpArg("per_sample_weights", 0));
+  }
+  dim_builder.Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("indices", 0)));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("out_grad", 0), ctx->InputDType("weight", 0));
+  *ctx->OutputDType("values", 0) = ctx->InputDType("weight", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                       const user_op::UserOpConfWrapper& conf) {
+  return CheckEmbeddingBagAttr(conf);
+}
+
+REGISTER_USER_OP_GRAD("embedding_bag")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      if (!op.NeedGenGradTensor4OpInput("weight", 0)) { return Maybe<void>::Ok(); }
+      user_op::UserOpConfWrapperBuilder values_builder(op.op_name() + "_grad_values");
+      values_builder.Op("embedding_bag_grad")
+          .Input("out_grad", op.GetGradTensorWithOpOutput("out", 0))
+          .Input("weight", op.input("weight", 0))
+          .Input("indices", op.input("indices", 0))
+          .Output("values")
+          .Attr("mode", op.attr<std::string>("mode"))
+          .Attr("padding_idx", op.attr<int64_t>("padding_idx"));
+      if (op.user_op_conf().has_input("per_sample_weights", 0)) {
+        values_builder.Input("per_sample_weights", op.input("per_sample_weights", 0));
+      }
+      user_op::UserOpConfWrapper values_op = values_builder.Build();
+      AddOp(values_op);
+      // Kept as values + unsorted_segment_sum_like so that IndexedSlicesOptimizerRewritePass can
+      // turn the weight update into a sparse one.
+      user_op::UserOpConfWrapperBuilder weight_grad_builder(op.op_name() + "_grad");
+      user_op::UserOpConfWrapper weight_grad_op =
+          weight_grad_builder.Op("unsorted_segment_sum_like")
+              .Input("data", values_op.output("values", 0))
+              .Input("segment_ids", op.input("indices", 0))
+              .Input("like", op.input("weight", 0))
+              .Output("out")
+              .Attr<int64_t>("axis", 0)
+              .Build();
+      op.BindGradTensorWithOpInput(weight_grad_op.output("out", 0), "weight", 0);
+      AddOp(weight_grad_op);
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+/*static*/ Maybe<void> Fp8MatmulOp::GetSbp(user_op::SbpContext* ctx) {
+  // NOTE: the amax histories are always broadcast, with split inputs each rank keeps the amax of
+  // its own part, which is all its scales are applied to.
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("a", 0), 0)
+      .Broadcast(user_op::OpArg("b", 0))
+      .Broadcast(user_op::OpArg("a_amax_history", 0))
+      .Broadcast(user_op::OpArg("b_amax_history", 0))
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("a", 0))
+      .Split(user_op::OpArg("b", 0), transpose_b ? 0 : 1)
+      .Broadcast(user_op::OpArg("a_amax_history", 0))
+      .Broadcast(user_op::OpArg("b_amax_history", 0))
+      .Split(user_op::OpArg("out", 0), 1)
+      .Build();
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("a", 0), 1)
+      .Split(user_op::OpArg("b", 0), transpose_b ? 1 : 0)
+      .Broadcast(user_op::OpArg("a_amax_history", 0))
+      .Broadcast(user_op::OpArg("b_amax_history", 0))
+      .PartialSum(user_op::OpArg("out", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> Fp8MatmulOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& b_shape = ctx->InputShape("b", 0);
+  CHECK_EQ_OR_RETURN(a_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(b_shape.NumAxes(), 2);
+  const int64_t k = a_shape.At(1);
+  CHECK_EQ_OR_RETURN(transpose_b ? b_shape.At(1) : b_shape.At(0), k);
+  const Shape& a_amax_history_shape = ctx->InputShape("a_amax_history", 0);
+  CHECK_EQ_OR_RETURN(a_amax_history_shape.NumAxes(), 1);
+  CHECK_GT_OR_RETURN(a_amax_history_shape.elem_cnt(), 0);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("b_amax_history", 0), a_amax_history_shape);
+  *ctx->OutputShape("out", 0) = Shape({a_shape.At(0), transpose_b ? b_shape.At(0) : b_shape.At(1)});
+  *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("a", 0);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> Fp8MatmulOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> Fp8MatmulOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType& dtype = ctx->InputDType("a", 0);
+  CHECK_OR_RETURN(dtype == DataType::kFloat || dtype == DataType::kFloat16
+                  || dtype == DataType::kBFloat16)
+      << "fp8_matmul takes float, float16 or bfloat16, but got " << DataType_Name(dtype);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b", 0), dtype);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("a_amax_history", 0), DataType::kFloat);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b_amax_history", 0), DataType::kFloat);
+  *ctx->OutputDType("out", 0) = dtype;
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> Fp8MatmulOp::ModifyInputArg(const GetInputArgModifier& GetInputArgModifierFn,
+                                                   const user_op::UserOpConfWrapper& conf) {
+  for (const std::string& history : {"a_amax_history", "b_amax_history"}) {
+    user_op::InputArgModifier* modifier = GetInputArgModifierFn(history, 0);
+    CHECK_OR_RETURN(modifier != nullptr);
+    modifier->set_requires_grad(false);
+    modifier->set_is_mutable(true);
+  }
+  return Maybe<void>::Ok();
+}
+
+// The backward GEMMs stay in the data type of the forward pass.
+REGISTER_USER_OP_GRAD("fp8_matmul")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               const user_op::AddOpFn& AddOp) -> Maybe<void> {
+      const bool transpose_b = op.attr<bool>("transpose_b");
+      const double alpha = op.attr<double>("alpha");
+      if (op.NeedGenGradTensor4OpInput("a", 0)) {
+        user_op::UserOpConfWrapper grad_a_op =
+            user_op::UserOpConfWrapperBuilder(op.op_name() + "_grad_a")
+                .Op("matmul")
+                .Input("a", op.GetGradTensorWithOpOutput("out", 0))
+                .Input("b", op.input("b", 0))
+                .Output("out")
+                .Attr<bool>("transpose_a", false)
+                .Attr<bool>("transpose_b", !transpose_b)
+                .Attr<double>("alpha", alpha)
+                .Build();
+        op.BindGradTensorWithOpInput(grad_a_op.output("out", 0), "a", 0);
+        AddOp(grad_a_op);
+      }
+      if (op.NeedGenGradTensor4OpInput("b", 0)) {
+        user_op::UserOpConfWrapperBuilder grad_b_builder(op.op_name() + "_grad_b");
+        if (transpose_b) {
+          grad_b_builder.Op("matmul")
+              .Input("a", op.GetGradTensorWithOpOutput("out", 0))
+              .Input("b", op.input("a", 0));
+        } else {
+          grad_b_builder.Op("matmul")
+              .Input("a", op.input("a", 0))
+              .Input("b", op.GetGradTensorWithOpOutput("out", 0));
+        }
+        user_op::UserOpConfWrapper grad_b_op = grad_b_builder.Output("out")
+                                                   .Attr<bool>("transpose_a", true)
+                                                   .Attr<bool>("transpose_b", false)
+                                                   .Attr<double>("alpha", alpha)
+                                                   .Build();
+        op.BindGradTensorWithOpInput(grad_b_op.output("out", 0), "b", 0);
+        AddOp(grad_b_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
@@ -0,0 +1,237 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+// query is [batch, num_heads, query_seq_len, head_size], key and value are
+// [batch, num_heads, kv_seq_len, head_size], key_mask is [batch, kv_seq_len].
+// Packed sequences have a batch of 1 with the sequences laid end to end along the seq axis,
+// sequence i being the rows [cu_seqlens[i], cu_seqlens[i + 1]) of the query and of the key.
+Maybe<void> CheckAttentionInputs(user_op::InferContext* ctx) {
+  const Shape& query_shape = ctx->InputShape("query", 0);
+  const Shape& key_shape = ctx->InputShape("key", 0);
+  const Shape& value_shape = ctx->InputShape("value", 0);
+  CHECK_EQ_OR_RETURN(query_shape.NumAxes(), 4);
+  CHECK_EQ_OR_RETURN(key_shape.NumAxes(), 4);
+  CHECK_EQ_OR_RETURN(key_shape, value_shape);
+  CHECK_EQ_OR_RETURN(query_shape.At(0), key_shape.At(0));
+  CHECK_EQ_OR_RETURN(query_shape.At(1), key_shape.At(1));
+  CHECK_EQ_OR_RETURN(query_shape.At(3), key_shape.At(3));
+  CHECK_GT_OR_RETURN(query_shape.At(3), 0);
+  if (ctx->has_input("key_mask", 0)) {
+    const Shape& key_mask_shape = ctx->InputShape("key_mask", 0);
+    CHECK_EQ_OR_RETURN(key_mask_shape, Shape({key_shape.At(0), key_shape.At(2)}));
+  }
+  const bool packed = ctx->has_input("cu_seqlens_q", 0);
+  CHECK_EQ_OR_RETURN(packed, ctx->has_input("cu_seqlens_k", 0))
+      << "cu_seqlens_q and cu_seqlens_k of fused_attention go together";
+  if (packed) {
+    CHECK_OR_RETURN(!ctx->has_input("key_mask", 0))
+        << "packed sequences of fused_attention take no key_mask";
+    CHECK_EQ_OR_RETURN(query_shape.At(0), 1) << "packed sequences should have a batch of 1";
+    const Shape& cu_seqlens_shape = ctx->InputShape("cu_seqlens_q", 0);
+    CHECK_EQ_OR_RETURN(cu_seqlens_shape.NumAxes(), 1);
+    CHECK_GE_OR_RETURN(cu_seqlens_shape.At(0), 2);
+    CHECK_EQ_OR_RETURN(ctx->InputShape("cu_seqlens_k", 0), cu_seqlens_shape);
+  }
+  CHECK_GE_OR_RETURN(ctx->Attr<int64_t>("max_seqlen_q"), 0);
+  CHECK_GE_OR_RETURN(ctx->Attr<int64_t>("max_seqlen_k"), 0);
+  const float dropout_rate = ctx->Attr<float>("dropout_rate");
+  CHECK_GE_OR_RETURN(dropout_rate, 0.0f);
+  CHECK_LT_OR_RETURN(dropout_rate, 1.0f);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckAttentionDataTypes(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("query", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("key", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("value", 0), data_type);
+  if (ctx->has_input("key_mask", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("key_mask", 0), DataType::kBool);
+  }
+  if (ctx->has_input("cu_seqlens_q", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("cu_seqlens_q", 0), DataType::kInt32);
+    CHECK_EQ_OR_RETURN(ctx->InputDType("cu_seqlens_k", 0), DataType::kInt32);
+  }
+  return Maybe<void>::Ok();
+}
+
+// Split by batch or by heads. Packed sequences share the batch of 1 and are split by heads only,
+// with their boundaries broadcast.
+template<typename BuildFn>
+void ForEachAttentionSbpAxis(user_op::SbpContext* ctx, const BuildFn& Build) {
+  const bool has_key_mask = ctx->user_op_conf().has_input("key_mask", 0);
+  const bool packed = ctx->user_op_conf().has_input("cu_seqlens_q", 0);
+  for (int64_t axis : {0, 1}) {
+    if (packed && axis == 0) { continue; }
+    user_op::UserOpSbpSignatureBuilder builder = ctx->NewBuilder();
+    Build(axis, &builder);
+    if (has_key_mask) {
+      if (axis == 0) {
+        builder.Split(user_op::OpArg("key_mask", 0), 0);
+      } else {
+        builder.Broadcast(user_op::OpArg("key_mask", 0));
+      }
+    }
+    if (packed) {
+      builder.Broadcast(user_op::OpArg("cu_seqlens_q", 0))
+          .Broadcast(user_op::OpArg("cu_seqlens_k", 0));
+    }
+    builder.Build();
+  }
+}
+
+}  // namespace
+
+/*static*/ auto FusedAttentionOp::InferLogicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionInputs(ctx));
+  const Shape& query_shape = ctx->InputShape("query", 0);
+  *ctx->OutputShape("out", 0) = query_shape;
+  *ctx->OutputShape("softmax_lse", 0) =
+      Shape({query_shape.At(0), query_shape.At(1), query_shape.At(2)});
+  // The seed and the offset of the dropout random numbers, for the backward to regenerate them.
+  *ctx->OutputShape("rng_state", 0) = Shape({2});
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedAttentionOp::InferPhysicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  return FusedAttentionOp::InferLogicalTensorDesc(ctx);
+}
+/*static*/ auto FusedAttentionOp::InferDataType(user_op::InferContext* ctx) -> Maybe<void> {
+  JUST(CheckAttentionDataTypes(ctx));
+  *ctx->OutputDType("out", 0) = ctx->InputDType("query", 0);
+  *ctx->OutputDType("softmax_lse", 0) = DataType::kFloat;
+  *ctx->OutputDType("rng_state", 0) = DataType::kInt64;
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedAttentionOp::ModifyInputArg(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf) -> Maybe<void> {
+  for (const std::string& arg_name : {"key_mask", "cu_seqlens_q", "cu_seqlens_k"}) {
+    if (!conf.has_input(arg_name, 0)) { continue; }
+    user_op::InputArgModifier* modifier = GetInputArgModifierFn(arg_name, 0);
+    CHECK_OR_RETURN(modifier != nullptr);
+    modifier->set_requires_grad(false);
+  }
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedAttentionOp::GetSbp(user_op::SbpContext* ctx) -> Maybe<void> {
+  // The rng state is made by each rank for its own part.
+  ForEachAttentionSbpAxis(ctx, [](int64_t axis, user_op::UserOpSbpSignatureBuilder* builder) {
+    builder->Split(user_op::OpArg("query", 0), axis)
+        .Split(user_op::OpArg("key", 0), axis)
+        .Split(user_op::OpArg("value", 0), axis)
+        .Split(user_op::OpArg("out", 0), axis)
+        .Split(user_op::OpArg("softmax_lse", 0), axis)
+        .Broadcast(user_op::OpArg("rng_state", 0));
+  });
+  return Maybe<void>::Ok();
+}
+
+/*static*/ auto FusedAttentionGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  JUST(CheckAttentionInputs(ctx));
+  const Shape& query_shape = ctx->InputShape("query", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("out", 0), query_shape);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("out_grad", 0), query_shape);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("softmax_lse", 0),
+                     Shape({query_shape.At(0), query_shape.At(1), query_shape.At(2)}));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("rng_state", 0), Shape({2}));
+  *ctx->OutputShape("query_grad", 0) = query_shape;
+  *ctx->OutputShape("key_grad", 0) = ctx->InputShape("key", 0);
+  *ctx->OutputShape("value_grad", 0) = ctx->InputShape("value", 0);
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedAttentionGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx)
+    -> Maybe<void> {
+  return FusedAttentionGradOp::InferLogicalTensorDesc(ctx);
+}
+/*static*/ auto FusedAttentionGradOp::InferDataType(user_op::InferContext* ctx) -> Maybe<void> {
+  JUST(CheckAttentionDataTypes(ctx));
+  const DataType data_type = ctx->InputDType("query", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("out", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("out_grad", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("softmax_lse", 0), DataType::kFloat);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("rng_state", 0), DataType::kInt64);
+  *ctx->OutputDType("query_grad", 0) = data_type;
+  *ctx->OutputDType("key_grad", 0) = data_type;
+  *ctx->OutputDType("value_grad", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+/*static*/ auto FusedAttentionGradOp::GetSbp(user_op::SbpContext* ctx) -> Maybe<void> {
+  ForEachAttentionSbpAxis(ctx, [](int64_t axis, user_op::UserOpSbpSignatureBuilder* builder) {
+    builder->Split(user_op::OpArg("query", 0), axis)
+        .Split(user_op::OpArg("key", 0), axis)
+        .Split(user_op::OpArg("value", 0), axis)
+        .Split(user_op::OpArg("out", 0), axis)
+        .Split(user_op::OpArg("out_grad", 0), axis)
+        .Split(user_op::OpArg("softmax_lse", 0), axis)
+        .Broadcast(user_op::OpArg("rng_state", 0))
+        .Split(user_op::OpArg("query_grad", 0), axis)
+        .Split(user_op::OpArg("key_grad", 0), axis)
+        .Split(user_op::OpArg("value_grad", 0), axis);
+  });
+  return Maybe<void>::Ok();
+}
+
+REGISTER_USER_OP_GRAD("fused_attention")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               const user_op::AddOpFn& AddOp) -> Maybe<void> {
+      if (op.NeedGenGradTensor4OpInput("query", 0) || op.NeedGenGradTensor4OpInput("key", 0)
+          || op.NeedGenGradTensor4OpInput("value", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+        builder.Op("fused_attention_grad")
+            .Input("query", op.input("query", 0))
+            .Input("key", op.input("key", 0))
+            .Input("value", op.input("value", 0))
+            .Input("out", op.output("out", 0))
+            .Input("out_grad", op.GetGradTensorWithOpOutput("out", 0))
+            .Input("softmax_lse", op.output("softmax_lse", 0))
+            .Input("rng_state", op.output("rng_state", 0))
+            .Output("query_grad")
+            .Output("key_grad")
+            .Output("value_grad")
+            .Attr("scale", op.attr<float>("scale"))
+            .Attr("causal", op.attr<bool>("causal"))
+            .Attr("dropout_rate", op.attr<float>("dropout_rate"))
+            .Attr("max_seqlen_q", op.attr<int64_t>("max_seqlen_q"))
+            .Attr("max_seqlen_k", op.attr<int64_t>("max_seqlen_k"));
+        for (const std::string& arg_name : {"key_mask", "cu_seqlens_q", "cu_seqlens_k"}) {
+          if (op.user_op_conf().has_input(arg_name, 0)) {
+            builder.Input(arg_name, op.input(arg_name, 0));
+          }
+        }
+        user_op::UserOpConfWrapper grad_op = builder.Build();
+        if (op.NeedGenGradTensor4OpInput("query", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("query_grad", 0), "query", 0);
+        }
+        if (op.NeedGenGradTensor4OpInput("key", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("key_grad", 0), "key", 0);
+        }
+        if (op.NeedGenGradTensor4OpInput("value", 0)) {
+          op.BindGradTensorWithOpInput(grad_op.output("value_grad", 0), "value", 0);
+        }
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
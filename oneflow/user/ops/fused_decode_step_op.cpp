@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+// logits are [batch_size, num_beams, vocab_size], the states of the beams are
+// [batch_size, num_beams].
+/* static */ Maybe<void> FusedDecodeStepOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& logits_shape = ctx->InputShape("logits", 0);
+  CHECK_EQ_OR_RETURN(logits_shape.NumAxes(), 3)
+      << "logits should be of shape [batch_size, num_beams, vocab_size]";
+  CHECK_GT_OR_RETURN(logits_shape.At(2), 0);
+  const Shape beam_shape({logits_shape.At(0), logits_shape.At(1)});
+  for (const std::string& state : {"scores", "finished", "lengths"}) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape(state, 0), beam_shape)
+        << state << " should be of shape [batch_size, num_beams]";
+  }
+  if (ctx->Attr<std::string>("mode") == "beam") {
+    CHECK_LE_OR_RETURN(logits_shape.At(1), logits_shape.At(2))
+        << "beam search needs num_beams <= vocab_size";
+  }
+  for (const std::string& out :
+       {"next_tokens", "out_scores", "out_finished", "out_lengths", "parent_beams"}) {
+    *ctx->OutputShape(out, 0) = beam_shape;
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedDecodeStepOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedDecodeStepOp::GetSbp(user_op::SbpContext* ctx) {
+  // The beams of a batch compete with each other, only the batch is split.
+  ctx->NewBuilder().Split(ctx->inputs(), 0).Split(ctx->outputs(), 0).Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedDecodeStepOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("scores", 0), DataType::kFloat);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("finished", 0), DataType::kBool);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("lengths", 0), DataType::kInt32);
+  *ctx->OutputDType("next_tokens", 0) = DataType::kInt64;
+  *ctx->OutputDType("out_scores", 0) = DataType::kFloat;
+  *ctx->OutputDType("out_finished", 0) = DataType::kBool;
+  *ctx->OutputDType("out_lengths", 0) = DataType::kInt32;
+  *ctx->OutputDType("parent_beams", 0) = DataType::kInt32;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedDecodeStepOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                     const user_op::UserOpConfWrapper& conf) {
+  const std::string& mode = conf.attr<std::string>("mode");
+  CHECK_OR_RETURN(mode == "sample" || mode == "beam")
+      << "fused_decode_step expects mode to be sample or beam, but got " << mode;
+  CHECK_GT_OR_RETURN(conf.attr<float>("temperature"), 0)
+      << "fused_decode_step expects a positive temperature";
+  CHECK_GE_OR_RETURN(conf.attr<int64_t>("top_k"), 0);
+  const float top_p = conf.attr<float>("top_p");
+  CHECK_OR_RETURN(top_p > 0 && top_p <= 1) << "fused_decode_step expects top_p in (0, 1]";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
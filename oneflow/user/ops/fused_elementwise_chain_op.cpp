@@ -0,0 +1,58 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+#include "oneflow/user/ops/fused_elementwise_chain_util.h"
+
+namespace oneflow {
+
+/*static*/ Maybe<void> FusedElementwiseChainOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const auto& op_types = ctx->Attr<std::vector<std::string>>("op_types");
+  CHECK_GT_OR_RETURN(op_types.size(), 0);
+  CHECK_LE_OR_RETURN(op_types.size(), kMaxElementwiseChainLength);
+  CHECK_EQ_OR_RETURN(ctx->Attr<std::vector<float>>("params").size(), 2 * op_types.size());
+  for (const std::string& op_type : op_types) {
+    ElementwiseChainOp op{};
+    CHECK_OR_RETURN(ElementwiseChainOp4OpTypeName(op_type, &op))
+        << "fused_elementwise_chain does not support " << op_type;
+  }
+  const user_op::TensorDesc& in = ctx->InputTensorDesc("in", 0);
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = in.shape();
+  *out->mut_is_dynamic() = in.is_dynamic();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> FusedElementwiseChainOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> FusedElementwiseChainOp::InferDataType(user_op::InferContext* ctx) {
+  *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> FusedElementwiseChainOp::GetSbp(user_op::SbpContext* ctx) {
+  const user_op::TensorDesc& in = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
+  FOR_RANGE(int64_t, i, 0, in.shape().NumAxes()) {
+    ctx->NewBuilder().Split(user_op::OpArg("in", 0), i).Split(user_op::OpArg("out", 0), i).Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
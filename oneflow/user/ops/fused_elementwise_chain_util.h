@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_OPS_FUSED_ELEMENTWISE_CHAIN_UTIL_H_
+#define ONEFLOW_USER_OPS_FUSED_ELEMENTWISE_CHAIN_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// The steps fused_elementwise_chain can run, each is a user op of one input and one output of the
+// same shape. Every step takes two float params: the scalar operand of the scalar ops, the attrs
+// of the activations.
+#define FUSED_ELEMENTWISE_CHAIN_OP_SEQ                     \
+  OF_PP_MAKE_TUPLE_SEQ("scalar_add", kScalarAdd)           \
+  OF_PP_MAKE_TUPLE_SEQ("scalar_mul", kScalarMul)           \
+  OF_PP_MAKE_TUPLE_SEQ("scalar_div", kScalarDiv)           \
+  OF_PP_MAKE_TUPLE_SEQ("relu", kRelu)                      \
+  OF_PP_MAKE_TUPLE_SEQ("elu", kElu)                        \
+  OF_PP_MAKE_TUPLE_SEQ("celu", kCelu)                      \
+  OF_PP_MAKE_TUPLE_SEQ("hardswish", kHardswish)            \
+  OF_PP_MAKE_TUPLE_SEQ("hardsigmoid", kHardsigmoid)        \
+  OF_PP_MAKE_TUPLE_SEQ("hardtanh", kHardtanh)              \
+  OF_PP_MAKE_TUPLE_SEQ("leaky_relu", kLeakyRelu)           \
+  OF_PP_MAKE_TUPLE_SEQ("mish", kMish)                      \
+  OF_PP_MAKE_TUPLE_SEQ("silu", kSilu)                      \
+  OF_PP_MAKE_TUPLE_SEQ("selu", kSelu)                      \
+  OF_PP_MAKE_TUPLE_SEQ("softsign", kSoftsign)
+
+#define MAKE_ELEMENTWISE_CHAIN_OP_ENUM_ITEM(op_type_name, op) op,
+
+enum class ElementwiseChainOp : int32_t {
+  OF_PP_FOR_EACH_TUPLE(MAKE_ELEMENTWISE_CHAIN_OP_ENUM_ITEM, FUSED_ELEMENTWISE_CHAIN_OP_SEQ)
+};
+
+#undef MAKE_ELEMENTWISE_CHAIN_OP_ENUM_ITEM
+
+constexpr int32_t kMaxElementwiseChainLength = 8;
+
+// Returns false if `op_type_name` can not be a step.
+inline bool ElementwiseChainOp4OpTypeName(const std::string& op_type_name,
+                                          ElementwiseChainOp* op) {
+#define MAKE_ELEMENTWISE_CHAIN_OP_CASE(name, item) \
+  if (op_type_name == name) {                      \
+    *op = ElementwiseChainOp::item;                \
+    return true;                                   \
+  }
+  OF_PP_FOR_EACH_TUPLE(MAKE_ELEMENTWISE_CHAIN_OP_CASE, FUSED_ELEMENTWISE_CHAIN_OP_SEQ)
+#undef MAKE_ELEMENTWISE_CHAIN_OP_CASE
+  return false;
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_OPS_FUSED_ELEMENTWISE_CHAIN_UTIL_H_
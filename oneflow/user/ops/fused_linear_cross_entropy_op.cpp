@@ -0,0 +1,264 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckChunkSize(const user_op::UserOpConfWrapper& conf) {
+  CHECK_GT_OR_RETURN(conf.attr<int64_t>("chunk_size"), 0)
+      << "fused_linear_cross_entropy expects a positive chunk_size";
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckXAndWeight(user_op::InferContext* ctx) {
+  const Shape& x_shape = ctx->InputShape("x", 0);
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  CHECK_EQ_OR_RETURN(x_shape.NumAxes(), 2)
+      << "fused_linear_cross_entropy expects x of shape [num_rows, hidden_size]";
+  CHECK_EQ_OR_RETURN(weight_shape.NumAxes(), 2)
+      << "fused_linear_cross_entropy expects weight of shape [num_classes, hidden_size]";
+  CHECK_EQ_OR_RETURN(x_shape.At(1), weight_shape.At(1))
+      << "the hidden size of x and weight of fused_linear_cross_entropy mismatch";
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckRowInput(user_op::InferContext* ctx, const std::string& name) {
+  CHECK_EQ_OR_RETURN(ctx->InputShape(name, 0), Shape({ctx->InputShape("x", 0).At(0)}))
+      << name << " of fused_linear_cross_entropy should have one element per row of x";
+  return Maybe<void>::Ok();
+}
+
+// The statistics are kept in float for float16, log_sum_exp has the same data type.
+DataType StatDataType(DataType data_type) {
+  return data_type == DataType::kFloat16 ? DataType::kFloat : data_type;
+}
+
+// The number of parts the classes of weight are split into, one statistic per part and row.
+int64_t NumClassParts(user_op::InferContext* ctx) {
+  if (ctx->parallel_num() == 1) { return 1; }
+  const NdSbp& weight_nd_sbp = ctx->NdSbp4ArgNameAndIndex("weight", 0);
+  const Shape& hierarchy = *ctx->parallel_desc().hierarchy();
+  int64_t num_parts = 1;
+  for (int64_t i = 0; i < hierarchy.NumAxes(); ++i) {
+    const SbpParallel& sbp = weight_nd_sbp.sbp_parallel(i);
+    if (sbp.has_split_parallel() && sbp.split_parallel().axis() == 0) {
+      num_parts *= hierarchy.At(i);
+    }
+  }
+  return num_parts;
+}
+
+}  // namespace
+
+/* static */ Maybe<void> FusedLinearCrossEntropyStatOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckXAndWeight(ctx));
+  const Shape stat_shape({ctx->InputShape("x", 0).At(0), NumClassParts(ctx)});
+  *ctx->OutputShape("max", 0) = stat_shape;
+  *ctx->OutputShape("sum_exp", 0) = stat_shape;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyStatOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckXAndWeight(ctx));
+  const Shape stat_shape({ctx->InputShape("x", 0).At(0), 1});
+  *ctx->OutputShape("max", 0) = stat_shape;
+  *ctx->OutputShape("sum_exp", 0) = stat_shape;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyStatOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("x", 0), 0)
+      .Broadcast(user_op::OpArg("weight", 0))
+      .Split(user_op::OpArg("max", 0), 0)
+      .Split(user_op::OpArg("sum_exp", 0), 0)
+      .Build();
+  // Split classes: every part reduces its own classes, into its own column of the statistics.
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("x", 0))
+      .Split(user_op::OpArg("weight", 0), 0)
+      .Split(user_op::OpArg("max", 0), 1)
+      .Split(user_op::OpArg("sum_exp", 0), 1)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyStatOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("x", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), data_type);
+  *ctx->OutputDType("max", 0) = StatDataType(data_type);
+  *ctx->OutputDType("sum_exp", 0) = StatDataType(data_type);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyStatOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckChunkSize(conf);
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckXAndWeight(ctx));
+  JUST(CheckRowInput(ctx, "label"));
+  JUST(CheckRowInput(ctx, "log_sum_exp"));
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = ctx->InputShape("label", 0);
+  out->set_is_dynamic(ctx->InputIsDynamic("label", 0));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("x", 0), 0)
+      .Broadcast(user_op::OpArg("weight", 0))
+      .Split(user_op::OpArg("label", 0), 0)
+      .Split(user_op::OpArg("log_sum_exp", 0), 0)
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  // Split classes: only the part holding the class of a row gives it a loss.
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("x", 0))
+      .Split(user_op::OpArg("weight", 0), 0)
+      .Broadcast(user_op::OpArg("label", 0))
+      .Broadcast(user_op::OpArg("log_sum_exp", 0))
+      .PartialSum(user_op::OpArg("out", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper&) {
+  user_op::InputArgModifier* label_modifier = GetInputArgModifierFn("label", 0);
+  CHECK_OR_RETURN(label_modifier != nullptr);
+  label_modifier->set_requires_grad(false);
+  // The gradient of the whole loss is given to x and weight, log_sum_exp is a saved statistic.
+  user_op::InputArgModifier* log_sum_exp_modifier = GetInputArgModifierFn("log_sum_exp", 0);
+  CHECK_OR_RETURN(log_sum_exp_modifier != nullptr);
+  log_sum_exp_modifier->set_requires_grad(false);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("x", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), data_type);
+  CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("label", 0)));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("log_sum_exp", 0), StatDataType(data_type));
+  *ctx->OutputDType("out", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckChunkSize(conf);
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyGradOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckXAndWeight(ctx));
+  JUST(CheckRowInput(ctx, "dy"));
+  JUST(CheckRowInput(ctx, "label"));
+  JUST(CheckRowInput(ctx, "log_sum_exp"));
+  *ctx->OutputShape("x_diff", 0) = ctx->InputShape("x", 0);
+  *ctx->OutputIsDynamic("x_diff", 0) = ctx->InputIsDynamic("x", 0);
+  *ctx->OutputShape("weight_diff", 0) = ctx->InputShape("weight", 0);
+  *ctx->OutputIsDynamic("weight_diff", 0) = ctx->InputIsDynamic("weight", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyGradOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyGradOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("dy", 0), 0)
+      .Split(user_op::OpArg("x", 0), 0)
+      .Broadcast(user_op::OpArg("weight", 0))
+      .Split(user_op::OpArg("label", 0), 0)
+      .Split(user_op::OpArg("log_sum_exp", 0), 0)
+      .Split(user_op::OpArg("x_diff", 0), 0)
+      .PartialSum(user_op::OpArg("weight_diff", 0))
+      .Build();
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("dy", 0))
+      .Broadcast(user_op::OpArg("x", 0))
+      .Split(user_op::OpArg("weight", 0), 0)
+      .Broadcast(user_op::OpArg("label", 0))
+      .Broadcast(user_op::OpArg("log_sum_exp", 0))
+      .PartialSum(user_op::OpArg("x_diff", 0))
+      .Split(user_op::OpArg("weight_diff", 0), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyGradOp::InferDataType(
+    user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("x", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("dy", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), data_type);
+  CHECK_OR_RETURN(IsIndexDataType(ctx->InputDType("label", 0)));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("log_sum_exp", 0), StatDataType(data_type));
+  *ctx->OutputDType("x_diff", 0) = data_type;
+  *ctx->OutputDType("weight_diff", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedLinearCrossEntropyGradOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckChunkSize(conf);
+}
+
+REGISTER_USER_OP_GRAD("fused_linear_cross_entropy")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      if (!op.NeedGenGradTensor4OpInput("x", 0) && !op.NeedGenGradTensor4OpInput("weight", 0)) {
+        return Maybe<void>::Ok();
+      }
+      user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+      user_op::UserOpConfWrapper grad_op =
+          builder.Op("fused_linear_cross_entropy_grad")
+              .Input("dy", op.GetGradTensorWithOpOutput("out", 0))
+              .Input("x", op.input("x", 0))
+              .Input("weight", op.input("weight", 0))
+              .Input("label", op.input("label", 0))
+              .Input("log_sum_exp", op.input("log_sum_exp", 0))
+              .Output("x_diff")
+              .Output("weight_diff")
+              .Attr("chunk_size", op.attr<int64_t>("chunk_size"))
+              .Attr("ignore_index", op.attr<int64_t>("ignore_index"))
+              .Build();
+      if (op.NeedGenGradTensor4OpInput("x", 0)) {
+        op.BindGradTensorWithOpInput(grad_op.output("x_diff", 0), "x", 0);
+      }
+      if (op.NeedGenGradTensor4OpInput("weight", 0)) {
+        op.BindGradTensorWithOpInput(grad_op.output("weight_diff", 0), "weight", 0);
+      }
+      AddOp(grad_op);
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
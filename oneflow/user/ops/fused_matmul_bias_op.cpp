@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+// a is (..., m, k), or (k, m) when transpose_a, b is (k, n), or (n, k) when transpose_b.
+Maybe<void> GetFusedMatmulBiasAxes(user_op::InferContext* ctx, int64_t* m_axis, int64_t* n,
+                                   int64_t* k) {
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& b_shape = ctx->InputShape("b", 0);
+  const Shape& bias_shape = ctx->InputShape("bias", 0);
+  const bool transpose_a = ctx->Attr<bool>("transpose_a");
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  CHECK_GE_OR_RETURN(a_shape.NumAxes(), 2) << "a of fused_matmul_bias must be at least 2-D";
+  CHECK_EQ_OR_RETURN(b_shape.NumAxes(), 2) << "b of fused_matmul_bias must be 2-D";
+  CHECK_EQ_OR_RETURN(bias_shape.NumAxes(), 1) << "bias of fused_matmul_bias must be 1-D";
+  if (transpose_a) {
+    CHECK_EQ_OR_RETURN(a_shape.NumAxes(), 2) << "a of fused_matmul_bias is transposed only in 2-D";
+    *m_axis = 1;
+    *k = a_shape.At(0);
+  } else {
+    *m_axis = a_shape.NumAxes() - 2;
+    *k = a_shape.At(a_shape.NumAxes() - 1);
+  }
+  CHECK_EQ_OR_RETURN(b_shape.At(transpose_b ? 1 : 0), *k);
+  *n = b_shape.At(transpose_b ? 0 : 1);
+  CHECK_EQ_OR_RETURN(bias_shape.At(0), *n);
+  const std::string& activation = ctx->Attr<std::string>("activation");
+  CHECK_OR_RETURN(activation == "none" || activation == "relu" || activation == "gelu")
+      << "unsupported activation " << activation << " of fused_matmul_bias";
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> FusedMatmulBiasOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  int64_t m_axis = 0;
+  int64_t n = 0;
+  int64_t k = 0;
+  JUST(GetFusedMatmulBiasAxes(ctx, &m_axis, &n, &k));
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  DimVector out_dim_vec(a_shape.dim_vec().begin(), a_shape.dim_vec().end() - 2);
+  out_dim_vec.emplace_back(a_shape.At(m_axis));
+  out_dim_vec.emplace_back(n);
+  *ctx->OutputShape("out", 0) = Shape(out_dim_vec);
+  *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("a", 0);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> FusedMatmulBiasOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedMatmulBiasOp::GetSbp(user_op::SbpContext* ctx) {
+  // The bias and the activation rule out a partial sum on k.
+  const bool transpose_a = ctx->Attr<bool>("transpose_a");
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  const int64_t num_a_axes =
+      ctx->LogicalTensorDesc4InputArgNameAndIndex("a", 0).shape().NumAxes();
+  // S(batch axis) x B x B -> S(batch axis)
+  for (int64_t i = 0; i < num_a_axes - 2; ++i) {
+    ctx->NewBuilder()
+        .Split(user_op::OpArg("a", 0), i)
+        .Broadcast(user_op::OpArg("b", 0))
+        .Broadcast(user_op::OpArg("bias", 0))
+        .Split(user_op::OpArg("out", 0), i)
+        .Build();
+  }
+  // S(m axis) x B x B -> S(m axis)
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("a", 0), transpose_a ? 1 : num_a_axes - 2)
+      .Broadcast(user_op::OpArg("b", 0))
+      .Broadcast(user_op::OpArg("bias", 0))
+      .Split(user_op::OpArg("out", 0), num_a_axes - 2)
+      .Build();
+  // B x S(n axis) x S(0) -> S(n axis)
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("a", 0))
+      .Split(user_op::OpArg("b", 0), transpose_b ? 0 : 1)
+      .Split(user_op::OpArg("bias", 0), 0)
+      .Split(user_op::OpArg("out", 0), num_a_axes - 1)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedMatmulBiasOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("a", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("bias", 0), data_type);
+  *ctx->OutputDType("out", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,255 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<void> CheckFusedResidualNormAttr(const user_op::UserOpConfWrapper& conf) {
+  const std::string& norm_type = conf.attr<std::string>("norm_type");
+  CHECK_OR_RETURN(norm_type == "layer_norm" || norm_type == "rms_norm")
+      << "norm_type should be layer_norm or rms_norm, but got " << norm_type;
+  const std::string& activation = conf.attr<std::string>("activation");
+  CHECK_OR_RETURN(activation == "none" || activation == "gelu" || activation == "silu")
+      << "activation should be one of none, gelu and silu, but got " << activation;
+  return Maybe<void>::Ok();
+}
+
+Maybe<int64_t> GetBeginNormAxis(const Shape& x_shape, int64_t begin_norm_axis) {
+  if (begin_norm_axis < 0) { begin_norm_axis += x_shape.NumAxes(); }
+  CHECK_GE_OR_RETURN(begin_norm_axis, 1);
+  CHECK_LT_OR_RETURN(begin_norm_axis, x_shape.NumAxes());
+  return begin_norm_axis;
+}
+
+Shape InferNormParamShape(const Shape& x_shape, int64_t begin_norm_axis) {
+  return Shape(DimVector(x_shape.dim_vec().cbegin() + begin_norm_axis, x_shape.dim_vec().cend()));
+}
+
+Shape InferNormStatShape(const Shape& x_shape, int64_t begin_norm_axis) {
+  return Shape(DimVector(x_shape.dim_vec().cbegin(), x_shape.dim_vec().cbegin() + begin_norm_axis));
+}
+
+DataType InferNormStatDataType(DataType data_type) {
+  return data_type == DataType::kFloat16 ? DataType::kFloat : data_type;
+}
+
+}  // namespace
+
+/* static */ Maybe<void> FusedResidualNormOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& x = ctx->InputTensorDesc("x", 0);
+  const int64_t begin_norm_axis =
+      JUST(GetBeginNormAxis(x.shape(), ctx->Attr<int64_t>("begin_norm_axis")));
+  const Shape param_shape = InferNormParamShape(x.shape(), begin_norm_axis);
+  if (ctx->has_input("residual", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("residual", 0), x.shape());
+  }
+  for (const std::string& param : {"bias", "gamma", "beta"}) {
+    if (ctx->has_input(param, 0)) {
+      CHECK_EQ_OR_RETURN(ctx->InputShape(param, 0), param_shape)
+          << param << " of fused_residual_norm should have the normalized shape";
+    }
+  }
+  if (ctx->has_input("beta", 0)) {
+    CHECK_OR_RETURN(ctx->Attr<std::string>("norm_type") == "layer_norm")
+        << "rms_norm does not take beta";
+  }
+  for (const std::string& output : {"y", "sum"}) {
+    user_op::TensorDesc* desc = ctx->OutputTensorDesc(output, 0);
+    *desc->mut_shape() = x.shape();
+    *desc->mut_is_dynamic() = x.is_dynamic();
+  }
+  const Shape stat_shape = InferNormStatShape(x.shape(), begin_norm_axis);
+  *ctx->OutputShape("mean", 0) = stat_shape;
+  *ctx->OutputShape("inv_variance", 0) = stat_shape;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedResidualNormOp::GetSbp(user_op::SbpContext* ctx) {
+  const Shape& x_shape = ctx->LogicalTensorDesc4InputArgNameAndIndex("x", 0).shape();
+  const int64_t begin_norm_axis =
+      JUST(GetBeginNormAxis(x_shape, ctx->Attr<int64_t>("begin_norm_axis")));
+  for (int64_t i = 0; i < begin_norm_axis; ++i) {
+    auto builder = ctx->NewBuilder().Split(user_op::OpArg("x", 0), i);
+    if (ctx->user_op_conf().has_input("residual", 0)) {
+      builder.Split(user_op::OpArg("residual", 0), i);
+    }
+    for (const std::string& param : {"bias", "gamma", "beta"}) {
+      if (ctx->user_op_conf().has_input(param, 0)) {
+        builder.Broadcast(user_op::OpArg(param, 0));
+      }
+    }
+    builder.Split(ctx->outputs(), i).Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("x", 0);
+  for (const std::string& input : {"residual", "bias", "gamma", "beta"}) {
+    if (ctx->has_input(input, 0)) { CHECK_EQ_OR_RETURN(ctx->InputDType(input, 0), data_type); }
+  }
+  *ctx->OutputDType("y", 0) = data_type;
+  *ctx->OutputDType("sum", 0) = data_type;
+  *ctx->OutputDType("mean", 0) = InferNormStatDataType(data_type);
+  *ctx->OutputDType("inv_variance", 0) = InferNormStatDataType(data_type);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                        const user_op::UserOpConfWrapper& conf) {
+  return CheckFusedResidualNormAttr(conf);
+}
+
+/* static */ Maybe<void> FusedResidualNormGradOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const user_op::TensorDesc& sum = ctx->InputTensorDesc("sum", 0);
+  const int64_t begin_norm_axis =
+      JUST(GetBeginNormAxis(sum.shape(), ctx->Attr<int64_t>("begin_norm_axis")));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("y_grad", 0), sum.shape());
+  if (ctx->has_input("sum_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("sum_grad", 0), sum.shape());
+  }
+  user_op::TensorDesc* sum_diff = ctx->OutputTensorDesc("sum_diff", 0);
+  *sum_diff->mut_shape() = sum.shape();
+  *sum_diff->mut_is_dynamic() = sum.is_dynamic();
+  const Shape param_shape = InferNormParamShape(sum.shape(), begin_norm_axis);
+  if (ctx->has_output("gamma_diff", 0)) {
+    CHECK_OR_RETURN(ctx->has_input("gamma", 0));
+    *ctx->OutputShape("gamma_diff", 0) = param_shape;
+  }
+  if (ctx->has_output("beta_diff", 0)) { *ctx->OutputShape("beta_diff", 0) = param_shape; }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormGradOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> FusedResidualNormGradOp::GetSbp(user_op::SbpContext* ctx) {
+  const Shape& sum_shape = ctx->LogicalTensorDesc4InputArgNameAndIndex("sum", 0).shape();
+  const int64_t begin_norm_axis =
+      JUST(GetBeginNormAxis(sum_shape, ctx->Attr<int64_t>("begin_norm_axis")));
+  for (int64_t i = 0; i < begin_norm_axis; ++i) {
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("y_grad", 0), i)
+                       .Split(user_op::OpArg("sum", 0), i)
+                       .Split(user_op::OpArg("mean", 0), i)
+                       .Split(user_op::OpArg("inv_variance", 0), i)
+                       .Split(user_op::OpArg("sum_diff", 0), i);
+    if (ctx->user_op_conf().has_input("sum_grad", 0)) {
+      builder.Split(user_op::OpArg("sum_grad", 0), i);
+    }
+    for (const std::string& param : {"gamma", "beta"}) {
+      if (ctx->user_op_conf().has_input(param, 0)) {
+        builder.Broadcast(user_op::OpArg(param, 0));
+      }
+    }
+    for (const std::string& param_diff : {"gamma_diff", "beta_diff"}) {
+      if (ctx->user_op_conf().has_output(param_diff, 0)) {
+        builder.PartialSum(user_op::OpArg(param_diff, 0));
+      }
+    }
+    builder.Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormGradOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("sum", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("y_grad", 0), data_type);
+  if (ctx->has_input("sum_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("sum_grad", 0), data_type);
+  }
+  *ctx->OutputDType("sum_diff", 0) = data_type;
+  if (ctx->has_output("gamma_diff", 0)) { *ctx->OutputDType("gamma_diff", 0) = data_type; }
+  if (ctx->has_output("beta_diff", 0)) { *ctx->OutputDType("beta_diff", 0) = data_type; }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> FusedResidualNormGradOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckFusedResidualNormAttr(conf);
+}
+
+REGISTER_USER_OP_GRAD("fused_residual_norm")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      const auto& conf = op.user_op_conf();
+      const bool has_gamma_diff =
+          conf.has_input("gamma", 0) && op.NeedGenGradTensor4OpInput("gamma", 0);
+      const bool has_beta_diff =
+          conf.has_input("beta", 0) && op.NeedGenGradTensor4OpInput("beta", 0);
+      user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+      builder.Op("fused_residual_norm_grad")
+          .Input("y_grad", op.GetGradTensorWithOpOutput("y", 0))
+          .Input("sum", op.output("sum", 0))
+          .Input("mean", op.output("mean", 0))
+          .Input("inv_variance", op.output("inv_variance", 0))
+          .Output("sum_diff")
+          .Attr("norm_type", op.attr<std::string>("norm_type"))
+          .Attr("activation", op.attr<std::string>("activation"))
+          .Attr("begin_norm_axis", op.attr<int64_t>("begin_norm_axis"));
+      if (op.HasGradTensor4OpOutput("sum", 0)) {
+        builder.Input("sum_grad", op.GetGradTensorWithOpOutput("sum", 0));
+      }
+      if (conf.has_input("gamma", 0)) { builder.Input("gamma", op.input("gamma", 0)); }
+      if (conf.has_input("beta", 0)) { builder.Input("beta", op.input("beta", 0)); }
+      if (has_gamma_diff) { builder.Output("gamma_diff"); }
+      if (has_beta_diff) { builder.Output("beta_diff"); }
+      user_op::UserOpConfWrapper grad_op = builder.Build();
+      AddOp(grad_op);
+      if (has_gamma_diff) {
+        op.BindGradTensorWithOpInput(grad_op.output("gamma_diff", 0), "gamma", 0);
+      }
+      if (has_beta_diff) {
+        op.BindGradTensorWithOpInput(grad_op.output("beta_diff", 0), "beta", 0);
+      }
+      // sum = x + residual + bias, so x and residual both receive sum_diff.
+      const std::string& sum_diff = grad_op.output("sum_diff", 0);
+      if (op.NeedGenGradTensor4OpInput("x", 0)) {
+        op.BindGradTensorWithOpInput(sum_diff, "x", 0);
+      }
+      if (conf.has_input("residual", 0) && op.NeedGenGradTensor4OpInput("residual", 0)) {
+        op.BindGradTensorWithOpInput(sum_diff, "residual", 0);
+      }
+      if (conf.has_input("bias", 0) && op.NeedGenGradTensor4OpInput("bias", 0)) {
+        const Shape& x_shape = op.TensorDesc4ArgNameAndIndex("x", 0).shape();
+        int64_t begin_norm_axis = op.attr<int64_t>("begin_norm_axis");
+        if (begin_norm_axis < 0) { begin_norm_axis += x_shape.NumAxes(); }
+        std::vector<int32_t> reduce_axes(begin_norm_axis);
+        std::iota(reduce_axes.begin(), reduce_axes.end(), 0);
+        user_op::UserOpConfWrapperBuilder bias_grad_builder(op.op_name() + "_bias_grad");
+        user_op::UserOpConfWrapper bias_grad_op = bias_grad_builder.Op("reduce_sum")
+                                                      .Input("input_tensor", sum_diff)
+                                                      .Output("output_tensor")
+                                                      .Attr("axis", reduce_axes)
+                                                      .Attr("keepdims", false)
+                                                      .Build();
+        op.BindGradTensorWithOpInput(bias_grad_op.output("output_tensor", 0), "bias", 0);
+        AddOp(bias_grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
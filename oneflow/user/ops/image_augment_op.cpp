@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+/* static */ Maybe<void> ImageAugmentOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& in_desc = ctx->InputTensorDesc("in", 0);
+  // {N, H, W, C}, each image is in the top left corner of its slot
+  CHECK_EQ_OR_RETURN(in_desc.shape().NumAxes(), 4);
+  const int64_t N = in_desc.shape().At(0);
+  const int64_t C = in_desc.shape().At(3);
+  CHECK_OR_RETURN(C == 1 || C == 3) << "image_augment only supports 1 or 3 channels";
+  if (ctx->has_input("in_size", 0)) {
+    const user_op::TensorDesc& size_desc = ctx->InputTensorDesc("in_size", 0);
+    CHECK_OR_RETURN(size_desc.shape() == Shape({N, 2}));
+  }
+  const int64_t H = ctx->Attr<int64_t>("target_height");
+  const int64_t W = ctx->Attr<int64_t>("target_width");
+  user_op::TensorDesc* out_desc = ctx->OutputTensorDesc("out", 0);
+  if (ctx->Attr<std::string>("output_layout") == "NCHW") {
+    *out_desc->mut_shape() = Shape({N, C, H, W});
+  } else {
+    *out_desc->mut_shape() = Shape({N, H, W, C});
+  }
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> ImageAugmentOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> ImageAugmentOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder().Split(ctx->inputs(), 0).Split(ctx->outputs(), 0).Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> ImageAugmentOp::CheckAttr(const user_op::UserOpDefWrapper& def,
+                                                   const user_op::UserOpConfWrapper& conf) {
+  bool check_failed = false;
+  std::stringstream err;
+  err << "Illegal attr value for " << conf.op_type_name() << " op, op_name: " << conf.op_name();
+  if (conf.attr<int64_t>("target_height") <= 0 || conf.attr<int64_t>("target_width") <= 0) {
+    err << ", target_height: " << conf.attr<int64_t>("target_height")
+        << ", target_width: " << conf.attr<int64_t>("target_width") << " (must be positive)";
+    check_failed = true;
+  }
+  const std::string& interpolation_type = conf.attr<std::string>("interpolation_type");
+  if (interpolation_type != "nearest" && interpolation_type != "bilinear"
+      && interpolation_type != "bicubic") {
+    err << ", interpolation_type: " << interpolation_type
+        << " (interpolation_type can only be one of nearest, bilinear and bicubic)";
+    check_failed = true;
+  }
+  for (const std::string& name : {"random_area", "random_aspect_ratio"}) {
+    const auto& range = conf.attr<std::vector<float>>(name);
+    if (range.size() != 2 || range.at(0) <= 0 || range.at(0) > range.at(1)) {
+      err << ", " << name << " (must be a range of 2 positive values)";
+      check_failed = true;
+    }
+  }
+  const auto& random_area = conf.attr<std::vector<float>>("random_area");
+  if (random_area.size() == 2 && random_area.at(1) > 1) {
+    err << ", random_area (must not exceed 1)";
+    check_failed = true;
+  }
+  for (const std::string& name : {"mean", "std"}) {
+    const auto& values = conf.attr<std::vector<float>>(name);
+    if (values.size() != 1 && values.size() != 3) {
+      err << ", " << name << " (must have 1 or 3 values)";
+      check_failed = true;
+    }
+  }
+  const std::string& color_space = conf.attr<std::string>("color_space");
+  if (color_space != "BGR" && color_space != "RGB" && color_space != "GRAY") {
+    err << ", color_space: " << color_space
+        << " (color_space can only be one of BGR, RGB and GRAY)";
+    check_failed = true;
+  }
+  const std::string& output_layout = conf.attr<std::string>("output_layout");
+  if (output_layout != "NCHW" && output_layout != "NHWC") {
+    err << ", output_layout: " << output_layout << " (output_layout can only be NCHW or NHWC)";
+    check_failed = true;
+  }
+  if (check_failed) { return oneflow::Error::CheckFailedError() << err.str(); }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> ImageAugmentOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("in", 0), DataType::kUInt8);
+  if (ctx->has_input("in_size", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("in_size", 0), DataType::kInt32);
+  }
+  *ctx->OutputDType("out", 0) = DataType::kFloat;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
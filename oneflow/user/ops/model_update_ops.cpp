@@ -421,6 +421,92 @@ Maybe<void> InferLarsUpdateDataType(user_op::InferContext* ctx) {
   return Maybe<void>::Ok();
 }
 
+Maybe<void> InferMultiTensorUpdateTensorDesc(user_op::InferContext* ctx,
+                                             const std::vector<std::string>& state_arg_names) {
+  const int64_t num_tensors = ctx->input_size("model");
+  CHECK_EQ_OR_RETURN(ctx->input_size("model_diff"), num_tensors);
+  for (const auto& state_arg_name : state_arg_names) {
+    CHECK_EQ_OR_RETURN(ctx->input_size(state_arg_name), num_tensors);
+  }
+  FOR_RANGE(int64_t, i, 0, num_tensors) {
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    CHECK_EQ_OR_RETURN(model_diff.shape(), model.shape());
+    for (const auto& state_arg_name : state_arg_names) {
+      const user_op::TensorDesc& state = ctx->InputTensorDesc(state_arg_name, i);
+      JUST(CheckShapeLike(&state, &model));
+    }
+  }
+  JUST(CheckLearningRateShape(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarShape(&scale_by_tensor));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferMultiTensorUpdateDataType(user_op::InferContext* ctx,
+                                           const std::vector<std::string>& state_arg_names) {
+  const user_op::TensorDesc& model_0 = ctx->InputTensorDesc("model", 0);
+  const user_op::TensorDesc& model_diff_0 = ctx->InputTensorDesc("model_diff", 0);
+  FOR_RANGE(int64_t, i, 0, ctx->input_size("model")) {
+    // One kernel launch covers all tensors, so they must share the model and gradient types.
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    JUST(CheckDataTypeLike(&model, &model_0));
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    JUST(CheckDataTypeLike(&model_diff, &model_diff_0));
+    for (const auto& state_arg_name : state_arg_names) {
+      const user_op::TensorDesc& state = ctx->InputTensorDesc(state_arg_name, i);
+      JUST(CheckDataTypeLike(&state, &model));
+    }
+  }
+  JUST(CheckLearningRateDataType(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarDataType(&scale_by_tensor, model_0.data_type()));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> GetMultiTensorUpdateSbp(user_op::SbpContext* ctx,
+                                    const std::vector<std::string>& state_arg_names) {
+  const int64_t num_tensors = ctx->user_op_conf().input_size("model");
+  int64_t min_num_axes = ctx->LogicalTensorDesc4InputArgNameAndIndex("model", 0).shape().NumAxes();
+  FOR_RANGE(int64_t, i, 1, num_tensors) {
+    min_num_axes = std::min(
+        min_num_axes, ctx->LogicalTensorDesc4InputArgNameAndIndex("model", i).shape().NumAxes());
+  }
+  FOR_RANGE(int64_t, axis, 0, min_num_axes) {
+    std::vector<user_op::OpArg> split_args;
+    FOR_RANGE(int64_t, i, 0, num_tensors) {
+      split_args.emplace_back("model", i);
+      split_args.emplace_back("model_diff", i);
+      for (const auto& state_arg_name : state_arg_names) {
+        split_args.emplace_back(state_arg_name, i);
+      }
+    }
+    ctx->NewBuilder().Broadcast(ctx->inputs()).Split(split_args, axis).Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> MultiTensorUpdateInputArgModifyFn(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf, const std::vector<std::string>& state_arg_names) {
+  FOR_RANGE(int32_t, i, 0, conf.input_size("model")) {
+    JUST(SetInputArgModifierMutable(GetInputArgModifierFn, "model", i));
+    for (const auto& state_arg_name : state_arg_names) {
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, state_arg_name, i));
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckMultiTensorUpdateAttr(const user_op::UserOpConfWrapper& conf) {
+  CHECK_GE_OR_RETURN(conf.input_size("model"), 1);
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 /* static */ Maybe<void> SgdUpdateOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
@@ -786,4 +872,87 @@ Maybe<void> InferLarsUpdateDataType(user_op::InferContext* ctx) {
   return InferLarsUpdateDataType(ctx);
 }
 
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateTensorDesc(ctx, {});
+}
+
+/*static*/ Maybe<void> MultiTensorSgdUpdateOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return GetMultiTensorUpdateSbp(ctx, {});
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf, {});
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, {});
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                           const user_op::UserOpConfWrapper& conf) {
+  return CheckMultiTensorUpdateAttr(conf);
+}
+
+/* static */ Maybe<void> MultiTensorMomentumUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateTensorDesc(ctx, {"momentum"});
+}
+
+/*static*/ Maybe<void> MultiTensorMomentumUpdateOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorMomentumUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return GetMultiTensorUpdateSbp(ctx, {"momentum"});
+}
+
+/* static */ Maybe<void> MultiTensorMomentumUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf, {"momentum"});
+}
+
+/* static */ Maybe<void> MultiTensorMomentumUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, {"momentum"});
+}
+
+/* static */ Maybe<void> MultiTensorMomentumUpdateOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckMultiTensorUpdateAttr(conf);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateTensorDesc(ctx, {"m", "v"});
+}
+
+/*static*/ Maybe<void> MultiTensorAdamUpdateOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return GetMultiTensorUpdateSbp(ctx, {"m", "v"});
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorUpdateInputArgModifyFn(GetInputArgModifierFn, conf, {"m", "v"});
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, {"m", "v"});
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::CheckAttr(
+    const user_op::UserOpDefWrapper&, const user_op::UserOpConfWrapper& conf) {
+  return CheckMultiTensorUpdateAttr(conf);
+}
+
 }  // namespace oneflow
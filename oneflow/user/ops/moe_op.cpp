@@ -0,0 +1,390 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+// The gating kernels keep the chosen experts of a token in registers.
+constexpr int64_t kMoeMaxTopK = 8;
+
+Maybe<void> CheckMoeRouting(user_op::InferContext* ctx, int64_t num_tokens) {
+  const Shape& expert_indices_shape = ctx->InputShape("expert_indices", 0);
+  CHECK_EQ_OR_RETURN(expert_indices_shape.NumAxes(), 2)
+      << "expert_indices should be of shape [num_tokens, top_k]";
+  CHECK_EQ_OR_RETURN(expert_indices_shape.At(0), num_tokens);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("locations", 0), expert_indices_shape);
+  if (ctx->has_input("gates", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("gates", 0), expert_indices_shape);
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckMoeRoutingDataType(user_op::InferContext* ctx, DataType data_type) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("expert_indices", 0), DataType::kInt32);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("locations", 0), DataType::kInt32);
+  if (ctx->has_input("gates", 0)) { CHECK_EQ_OR_RETURN(ctx->InputDType("gates", 0), data_type); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckMoeBufferAttr(const user_op::UserOpConfWrapper& conf) {
+  CHECK_GT_OR_RETURN(conf.attr<int64_t>("num_experts"), 0);
+  CHECK_GT_OR_RETURN(conf.attr<int64_t>("capacity"), 0);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SetMoeRoutingArgsNoGrad(const GetInputArgModifier& GetInputArgModifierFn,
+                                    const user_op::UserOpConfWrapper& conf) {
+  user_op::InputArgModifier* expert_indices_modifier = GetInputArgModifierFn("expert_indices", 0);
+  CHECK_OR_RETURN(expert_indices_modifier != nullptr);
+  expert_indices_modifier->set_requires_grad(false);
+  user_op::InputArgModifier* locations_modifier = GetInputArgModifierFn("locations", 0);
+  CHECK_OR_RETURN(locations_modifier != nullptr);
+  locations_modifier->set_requires_grad(false);
+  return Maybe<void>::Ok();
+}
+
+// The expert buffer [num_experts, capacity, hidden_size] of every rank holds the tokens that rank
+// routed to each expert, so a token-split dispatch yields a buffer split on the capacity axis.
+// Boxing it to split on the expert axis, where expert parallel weights live, is the all-to-all.
+Maybe<void> InferMoeExpertBuffer(user_op::InferContext* ctx, int64_t capacity_factor) {
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  CHECK_EQ_OR_RETURN(in_shape.NumAxes(), 2)
+      << "moe_dispatch expects in of shape [num_tokens, hidden_size]";
+  JUST(CheckMoeRouting(ctx, in_shape.At(0)));
+  const int64_t num_experts = ctx->Attr<int64_t>("num_experts");
+  const int64_t capacity = ctx->Attr<int64_t>("capacity");
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = Shape({num_experts, capacity * capacity_factor, in_shape.At(1)});
+  out->set_is_dynamic(false);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferMoeCombinedTokens(user_op::InferContext* ctx, int64_t capacity_factor) {
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  CHECK_EQ_OR_RETURN(in_shape.NumAxes(), 3)
+      << "moe_combine expects in of shape [num_experts, capacity, hidden_size]";
+  CHECK_EQ_OR_RETURN(in_shape.At(0), ctx->Attr<int64_t>("num_experts"));
+  CHECK_EQ_OR_RETURN(in_shape.At(1), ctx->Attr<int64_t>("capacity") * capacity_factor);
+  const Shape& expert_indices_shape = ctx->InputShape("expert_indices", 0);
+  JUST(CheckMoeRouting(ctx, expert_indices_shape.At(0)));
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = Shape({expert_indices_shape.At(0), in_shape.At(2)});
+  out->set_is_dynamic(ctx->InputIsDynamic("expert_indices", 0));
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> MoeGatingOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& logits_shape = ctx->InputShape("logits", 0);
+  CHECK_EQ_OR_RETURN(logits_shape.NumAxes(), 2)
+      << "moe_gating expects logits of shape [num_tokens, num_experts]";
+  const int64_t top_k = ctx->Attr<int64_t>("top_k");
+  CHECK_LE_OR_RETURN(top_k, logits_shape.At(1));
+  const Shape routing_shape({logits_shape.At(0), top_k});
+  const bool is_dynamic = ctx->InputIsDynamic("logits", 0);
+  for (const std::string& name : {"expert_indices", "locations", "gates"}) {
+    user_op::TensorDesc* desc = ctx->OutputTensorDesc(name, 0);
+    *desc->mut_shape() = routing_shape;
+    desc->set_is_dynamic(is_dynamic);
+  }
+  *ctx->OutputShape("probs", 0) = logits_shape;
+  *ctx->OutputIsDynamic("probs", 0) = is_dynamic;
+  *ctx->OutputShape("aux_loss", 0) = Shape({1});
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MoeGatingOp::GetSbp(user_op::SbpContext* ctx) {
+  // Every rank routes its own tokens against its own capacity, and the load balancing loss of
+  // the rank groups adds up.
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("logits", 0), 0)
+      .Split(user_op::OpArg("expert_indices", 0), 0)
+      .Split(user_op::OpArg("locations", 0), 0)
+      .Split(user_op::OpArg("gates", 0), 0)
+      .Split(user_op::OpArg("probs", 0), 0)
+      .PartialSum(user_op::OpArg("aux_loss", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("logits", 0);
+  *ctx->OutputDType("expert_indices", 0) = DataType::kInt32;
+  *ctx->OutputDType("locations", 0) = DataType::kInt32;
+  *ctx->OutputDType("gates", 0) = data_type;
+  *ctx->OutputDType("probs", 0) = data_type;
+  *ctx->OutputDType("aux_loss", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                const user_op::UserOpConfWrapper& conf) {
+  const int64_t top_k = conf.attr<int64_t>("top_k");
+  CHECK_OR_RETURN(top_k >= 1 && top_k <= kMoeMaxTopK)
+      << "moe_gating top_k should be in [1, " << kMoeMaxTopK << "], but got " << top_k;
+  CHECK_GT_OR_RETURN(conf.attr<int64_t>("capacity"), 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& probs_shape = ctx->InputShape("probs", 0);
+  const Shape& expert_indices_shape = ctx->InputShape("expert_indices", 0);
+  CHECK_EQ_OR_RETURN(probs_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(expert_indices_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(expert_indices_shape.At(0), probs_shape.At(0));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("gates", 0), expert_indices_shape);
+  if (ctx->has_input("gates_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("gates_grad", 0), expert_indices_shape);
+  }
+  if (ctx->has_input("aux_loss_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputShape("aux_loss_grad", 0).elem_cnt(), 1);
+  }
+  *ctx->OutputShape("logits_grad", 0) = probs_shape;
+  *ctx->OutputIsDynamic("logits_grad", 0) = ctx->InputIsDynamic("probs", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MoeGatingGradOp::GetSbp(user_op::SbpContext* ctx) {
+  auto builder = ctx->NewBuilder()
+                     .Split(user_op::OpArg("probs", 0), 0)
+                     .Split(user_op::OpArg("expert_indices", 0), 0)
+                     .Split(user_op::OpArg("gates", 0), 0)
+                     .Split(user_op::OpArg("logits_grad", 0), 0);
+  if (ctx->user_op_conf().has_input("gates_grad", 0)) {
+    builder.Split(user_op::OpArg("gates_grad", 0), 0);
+  }
+  if (ctx->user_op_conf().has_input("aux_loss_grad", 0)) {
+    builder.Broadcast(user_op::OpArg("aux_loss_grad", 0));
+  }
+  builder.Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatingGradOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("probs", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("expert_indices", 0), DataType::kInt32);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("gates", 0), data_type);
+  if (ctx->has_input("gates_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("gates_grad", 0), data_type);
+  }
+  if (ctx->has_input("aux_loss_grad", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("aux_loss_grad", 0), data_type);
+  }
+  *ctx->OutputDType("logits_grad", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeDispatchOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  return InferMoeExpertBuffer(ctx, ctx->parallel_num());
+}
+
+/* static */ Maybe<void> MoeDispatchOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferMoeExpertBuffer(ctx, 1);
+}
+
+/* static */ Maybe<void> MoeDispatchOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder().Split(ctx->inputs(), 0).Split(user_op::OpArg("out", 0), 1).Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeDispatchOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetMoeRoutingArgsNoGrad(GetInputArgModifierFn, conf);
+}
+
+/* static */ Maybe<void> MoeDispatchOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("in", 0);
+  JUST(CheckMoeRoutingDataType(ctx, data_type));
+  *ctx->OutputDType("out", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeDispatchOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                  const user_op::UserOpConfWrapper& conf) {
+  return CheckMoeBufferAttr(conf);
+}
+
+/* static */ Maybe<void> MoeCombineOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  return InferMoeCombinedTokens(ctx, ctx->parallel_num());
+}
+
+/* static */ Maybe<void> MoeCombineOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferMoeCombinedTokens(ctx, 1);
+}
+
+/* static */ Maybe<void> MoeCombineOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(ctx->inputs(), 0)
+      .Split(user_op::OpArg("in", 0), 1)
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeCombineOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetMoeRoutingArgsNoGrad(GetInputArgModifierFn, conf);
+}
+
+/* static */ Maybe<void> MoeCombineOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("in", 0);
+  JUST(CheckMoeRoutingDataType(ctx, data_type));
+  *ctx->OutputDType("out", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeCombineOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                 const user_op::UserOpConfWrapper& conf) {
+  return CheckMoeBufferAttr(conf);
+}
+
+/* static */ Maybe<void> MoeGatesGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& tokens_shape = ctx->InputShape("tokens", 0);
+  const Shape& expert_buffer_shape = ctx->InputShape("expert_buffer", 0);
+  CHECK_EQ_OR_RETURN(tokens_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(expert_buffer_shape.NumAxes(), 3);
+  CHECK_EQ_OR_RETURN(tokens_shape.At(1), expert_buffer_shape.At(2));
+  JUST(CheckMoeRouting(ctx, tokens_shape.At(0)));
+  *ctx->OutputShape("gates_grad", 0) = ctx->InputShape("expert_indices", 0);
+  *ctx->OutputIsDynamic("gates_grad", 0) = ctx->InputIsDynamic("expert_indices", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatesGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MoeGatesGradOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(ctx->inputs(), 0)
+      .Split(user_op::OpArg("expert_buffer", 0), 1)
+      .Split(user_op::OpArg("gates_grad", 0), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> MoeGatesGradOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("tokens", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("expert_buffer", 0), data_type);
+  JUST(CheckMoeRoutingDataType(ctx, data_type));
+  *ctx->OutputDType("gates_grad", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+REGISTER_USER_OP_GRAD("moe_gating")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      if (!op.NeedGenGradTensor4OpInput("logits", 0)) { return Maybe<void>::Ok(); }
+      const bool has_gates_grad = op.HasGradTensor4OpOutput("gates", 0);
+      const bool has_aux_loss_grad = op.HasGradTensor4OpOutput("aux_loss", 0);
+      if (!has_gates_grad && !has_aux_loss_grad) { return Maybe<void>::Ok(); }
+      user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+      builder.Op("moe_gating_grad")
+          .Input("probs", op.output("probs", 0))
+          .Input("expert_indices", op.output("expert_indices", 0))
+          .Input("gates", op.output("gates", 0))
+          .Output("logits_grad");
+      if (has_gates_grad) { builder.Input("gates_grad", op.GetGradTensorWithOpOutput("gates", 0)); }
+      if (has_aux_loss_grad) {
+        builder.Input("aux_loss_grad", op.GetGradTensorWithOpOutput("aux_loss", 0));
+      }
+      user_op::UserOpConfWrapper grad_op = builder.Build();
+      op.BindGradTensorWithOpInput(grad_op.output("logits_grad", 0), "logits", 0);
+      AddOp(grad_op);
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_USER_OP_GRAD("moe_dispatch")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      const bool has_gates = op.user_op_conf().has_input("gates", 0);
+      if (op.NeedGenGradTensor4OpInput("in", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad_in");
+        builder.Op("moe_combine")
+            .Input("in", op.GetGradTensorWithOpOutput("out", 0))
+            .Input("expert_indices", op.input("expert_indices", 0))
+            .Input("locations", op.input("locations", 0))
+            .Output("out")
+            .Attr("num_experts", op.attr<int64_t>("num_experts"))
+            .Attr("capacity", op.attr<int64_t>("capacity"));
+        if (has_gates) { builder.Input("gates", op.input("gates", 0)); }
+        user_op::UserOpConfWrapper grad_op = builder.Build();
+        op.BindGradTensorWithOpInput(grad_op.output("out", 0), "in", 0);
+        AddOp(grad_op);
+      }
+      if (has_gates && op.NeedGenGradTensor4OpInput("gates", 0)) {
+        user_op::UserOpConfWrapper grad_op =
+            user_op::UserOpConfWrapperBuilder(op.op_name() + "_grad_gates")
+                .Op("moe_gates_grad")
+                .Input("tokens", op.input("in", 0))
+                .Input("expert_buffer", op.GetGradTensorWithOpOutput("out", 0))
+                .Input("expert_indices", op.input("expert_indices", 0))
+                .Input("locations", op.input("locations", 0))
+                .Output("gates_grad")
+                .Build();
+        op.BindGradTensorWithOpInput(grad_op.output("gates_grad", 0), "gates", 0);
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_USER_OP_GRAD("moe_combine")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      const bool has_gates = op.user_op_conf().has_input("gates", 0);
+      if (op.NeedGenGradTensor4OpInput("in", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad_in");
+        builder.Op("moe_dispatch")
+            .Input("in", op.GetGradTensorWithOpOutput("out", 0))
+            .Input("expert_indices", op.input("expert_indices", 0))
+            .Input("locations", op.input("locations", 0))
+            .Output("out")
+            .Attr("num_experts", op.attr<int64_t>("num_experts"))
+            .Attr("capacity", op.attr<int64_t>("capacity"));
+        if (has_gates) { builder.Input("gates", op.input("gates", 0)); }
+        user_op::UserOpConfWrapper grad_op = builder.Build();
+        op.BindGradTensorWithOpInput(grad_op.output("out", 0), "in", 0);
+        AddOp(grad_op);
+      }
+      if (has_gates && op.NeedGenGradTensor4OpInput("gates", 0)) {
+        user_op::UserOpConfWrapper grad_op =
+            user_op::UserOpConfWrapperBuilder(op.op_name() + "_grad_gates")
+                .Op("moe_gates_grad")
+                .Input("tokens", op.GetGradTensorWithOpOutput("out", 0))
+                .Input("expert_buffer", op.input("in", 0))
+                .Input("expert_indices", op.input("expert_indices", 0))
+                .Input("locations", op.input("locations", 0))
+                .Output("gates_grad")
+                .Build();
+        op.BindGradTensorWithOpInput(grad_op.output("gates_grad", 0), "gates", 0);
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
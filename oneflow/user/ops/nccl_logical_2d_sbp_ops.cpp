@@ -235,4 +235,45 @@ _ncclLogical_2DSameDim0AllGatherNoncontinuousOp::InferDeviceAndStream(
   return DeviceAndStreamInferFn<&SyncLaunched>(ctx);
 }
 
+/* static */ Maybe<void> _ncclLogical_2DSendRecvOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  *ctx->OutputShape("out", 0) = ctx->InputShape("in", 0);
+  *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("in", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> _ncclLogical_2DSendRecvOp::GetSbp(user_op::SbpContext* ctx) {
+  return user_op::GetSbpFnUtil::DefaultBroadcastToBroadcast(ctx);
+}
+
+/* static */ Maybe<void> _ncclLogical_2DSendRecvOp::InferNdSbp(user_op::InferNdSbpFnContext* ctx) {
+  NdSbp* input_nd_sbp = ctx->NdSbp4ArgNameAndIndex("in", 0);
+  NdSbp* output_nd_sbp = ctx->NdSbp4ArgNameAndIndex("out", 0);
+  input_nd_sbp->clear_sbp_parallel();
+  output_nd_sbp->clear_sbp_parallel();
+
+  JUST(GetNcclLogicalNdSbpFromAttr(ctx, "src_reduced_nd_sbp", input_nd_sbp));
+  JUST(GetNcclLogicalNdSbpFromAttr(ctx, "dst_reduced_nd_sbp", output_nd_sbp));
+  // (S/B, S/B) -> (S/B, S/B)
+  CHECK_EQ_OR_RETURN(input_nd_sbp->sbp_parallel_size(), 2);
+  CHECK_EQ_OR_RETURN(output_nd_sbp->sbp_parallel_size(), 2);
+  for (int64_t i = 0; i < 2; ++i) {
+    CHECK_OR_RETURN(!input_nd_sbp->sbp_parallel(i).has_partial_sum_parallel());
+    CHECK_OR_RETURN(!output_nd_sbp->sbp_parallel(i).has_partial_sum_parallel());
+  }
+  CHECK_EQ_OR_RETURN(ctx->parallel_hierarchy().NumAxes(), 2);
+
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> _ncclLogical_2DSendRecvOp::InferDataType(user_op::InferContext* ctx) {
+  *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<Symbol<Stream>> _ncclLogical_2DSendRecvOp::InferDeviceAndStream(
+    user_op::DeviceAndStreamInferContext* ctx) {
+  return DeviceAndStreamInferFn<&SyncLaunched>(ctx);
+}
+
 }  // namespace oneflow
@@ -30,6 +30,31 @@ Maybe<void> InferNmsDataType(user_op::InferContext* ctx) {
   return Maybe<void>::Ok();
 }
 
+// scores is [batch, classes, boxes] and boxes is either shared by the classes,
+// [batch, boxes, 4], or per class, [batch, classes, boxes, 4].
+Maybe<void> InferBatchedNmsTensorDesc(user_op::InferContext* ctx) {
+  const Shape& scores_shape = ctx->InputShape("scores", 0);
+  const Shape& boxes_shape = ctx->InputShape("boxes", 0);
+  CHECK_EQ_OR_RETURN(scores_shape.NumAxes(), 3)
+      << "batched_nms expects scores of shape [batch, classes, boxes]";
+  const int64_t batch_size = scores_shape.At(0);
+  const int64_t num_boxes = scores_shape.At(2);
+  if (boxes_shape.NumAxes() == 3) {
+    CHECK_EQ_OR_RETURN(boxes_shape, Shape({batch_size, num_boxes, 4}))
+        << "batched_nms expects boxes of shape [batch, boxes, 4] or [batch, classes, boxes, 4]";
+  } else {
+    CHECK_EQ_OR_RETURN(boxes_shape, Shape({batch_size, scores_shape.At(1), num_boxes, 4}))
+        << "batched_nms expects boxes of shape [batch, boxes, 4] or [batch, classes, boxes, 4]";
+  }
+  const int64_t max_output = ctx->Attr<int32_t>("max_output_per_image");
+  *ctx->OutputShape("out_boxes", 0) = Shape({batch_size, max_output, 4});
+  *ctx->OutputShape("out_scores", 0) = Shape({batch_size, max_output});
+  *ctx->OutputShape("out_classes", 0) = Shape({batch_size, max_output});
+  *ctx->OutputShape("out_indices", 0) = Shape({batch_size, max_output});
+  *ctx->OutputShape("num_detections", 0) = Shape({batch_size});
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 /* static */ Maybe<void> NmsOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
@@ -48,4 +73,36 @@ Maybe<void> InferNmsDataType(user_op::InferContext* ctx) {
   return InferNmsDataType(ctx);
 }
 
+/* static */ Maybe<void> BatchedNmsOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  return InferBatchedNmsTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> BatchedNmsOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> BatchedNmsOp::GetSbp(user_op::SbpContext* ctx) {
+  // Every image is suppressed on its own.
+  ctx->NewBuilder().Split(ctx->inputs(), 0).Split(ctx->outputs(), 0).Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> BatchedNmsOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("scores", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("boxes", 0), data_type);
+  *ctx->OutputDType("out_boxes", 0) = data_type;
+  *ctx->OutputDType("out_scores", 0) = data_type;
+  *ctx->OutputDType("out_classes", 0) = DataType::kInt64;
+  *ctx->OutputDType("out_indices", 0) = DataType::kInt64;
+  *ctx->OutputDType("num_detections", 0) = DataType::kInt32;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> BatchedNmsOp::CheckAttr(const user_op::UserOpDefWrapper&,
+                                                 const user_op::UserOpConfWrapper& conf) {
+  CHECK_GT_OR_RETURN(conf.attr<int32_t>("max_output_per_image"), 0)
+      << "batched_nms expects a positive max_output_per_image";
+  return Maybe<void>::Ok();
+}
+
 }  // namespace oneflow
@@ -19,6 +19,15 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// Records are either parsed OFRecords or the serialized ones of OFRecordReader with raw_records.
+bool IsRecordDataType(DataType data_type) {
+  return data_type == DataType::kOFRecord || data_type == DataType::kTensorBuffer;
+}
+
+}  // namespace
+
 /* static */ Maybe<void> OfrecordRawDecoderOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
@@ -51,7 +60,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordRawDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   *out_tensor->mut_data_type() = ctx->Attr<DataType>("data_type");
   return Maybe<void>::Ok();
 }
@@ -84,7 +93,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordBytesDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in.data_type()));
   *out->mut_data_type() = DataType::kTensorBuffer;
   return Maybe<void>::Ok();
 }
@@ -118,7 +127,7 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordImageDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   *out_tensor->mut_data_type() = DataType::kTensorBuffer;
   return Maybe<void>::Ok();
 }
@@ -154,7 +163,7 @@ namespace oneflow {
     user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  CHECK_OR_RETURN(IsRecordDataType(in_tensor.data_type()));
   *out_tensor->mut_data_type() = DataType::kTensorBuffer;
   return Maybe<void>::Ok();
 }
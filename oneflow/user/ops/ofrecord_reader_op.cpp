@@ -64,7 +64,9 @@ namespace oneflow {
 }
 
 /* static */ Maybe<void> OFRecordReaderOp::InferDataType(user_op::InferContext* ctx) {
-  *ctx->OutputDType("out", 0) = DataType::kOFRecord;
+  // raw_records outputs the serialized records, which the decoders read without parsing them.
+  *ctx->OutputDType("out", 0) =
+      ctx->Attr<bool>("raw_records") ? DataType::kTensorBuffer : DataType::kOFRecord;
   return Maybe<void>::Ok();
 }
 
@@ -0,0 +1,171 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+#include "oneflow/core/embedding/key_value_store_options.h"
+#include "oneflow/core/embedding/cache.h"
+
+namespace oneflow {
+
+/* static */ Maybe<void> EmbeddingPrefetchOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& num_unique_ids_shape = ctx->InputShape("num_unique_ids", 0);
+  const Shape& unique_ids_shape = ctx->InputShape("unique_ids", 0);
+  CHECK_EQ_OR_RETURN(num_unique_ids_shape.elem_cnt(), 1);
+  CHECK_EQ_OR_RETURN(unique_ids_shape.NumAxes(), 1);
+  *ctx->OutputShape("context", 0) = num_unique_ids_shape;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingPrefetchOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> EmbeddingPrefetchOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Broadcast(user_op::OpArg("num_unique_ids", 0))
+      .Split(user_op::OpArg("unique_ids", 0), 0)
+      .Broadcast(user_op::OpArg("context", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingPrefetchOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(ctx->InputDType("num_unique_ids", 0) == DataType::kUInt32);
+  *ctx->OutputDType("context", 0) = ctx->InputDType("num_unique_ids", 0);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingLookupShuffleOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const Shape& num_unique_matrix_shape = ctx->InputShape("num_unique_matrix", 0);
+  const Shape& cur_rank_num_unique_shape = ctx->InputShape("cur_rank_num_unique", 0);
+  const Shape& cur_rank_unique_ids_shape = ctx->InputShape("cur_rank_unique_ids", 0);
+  const Shape& cur_rank_inverse_indices_shape = ctx->InputShape("cur_rank_inverse_indices", 0);
+  const Shape& inverse_unique_partition_indices_shape =
+      ctx->InputShape("inverse_unique_partition_indices", 0);
+  const int64_t num_ids = inverse_unique_partition_indices_shape.elem_cnt();
+  const int64_t parallel_num = ctx->parallel_num();
+  embedding::KeyValueStoreOptions options(ctx->Attr<std::string>("key_value_store_options"));
+  CHECK_EQ_OR_RETURN(options.ValueSize() % sizeof(float), 0);
+  const int64_t embedding_size = options.ValueSize() / sizeof(float);
+  CHECK_EQ_OR_RETURN(num_unique_matrix_shape.elem_cnt(), parallel_num * parallel_num);
+  CHECK_EQ_OR_RETURN(cur_rank_num_unique_shape.elem_cnt(), 1);
+  CHECK_EQ_OR_RETURN(cur_rank_unique_ids_shape.elem_cnt(), parallel_num * num_ids);
+  CHECK_EQ_OR_RETURN(cur_rank_inverse_indices_shape.elem_cnt(), parallel_num * num_ids);
+  DimVector out_dim_vec = inverse_unique_partition_indices_shape.dim_vec();
+  out_dim_vec.push_back(embedding_size);
+  *ctx->OutputShape("embeddings", 0) = Shape(out_dim_vec);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingLookupShuffleOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> EmbeddingLookupShuffleOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(ctx->inputs(), 0)
+      .Broadcast(user_op::OpArg("num_unique_matrix", 0))
+      .Broadcast(user_op::OpArg("cur_rank_num_unique", 0))
+      .Split(ctx->outputs(), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingLookupShuffleOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(ctx->InputDType("num_unique_matrix", 0) == DataType::kUInt32);
+  CHECK_OR_RETURN(ctx->InputDType("cur_rank_num_unique", 0) == DataType::kUInt32);
+  CHECK_OR_RETURN(ctx->InputDType("cur_rank_inverse_indices", 0) == DataType::kUInt32);
+  CHECK_OR_RETURN(ctx->InputDType("inverse_unique_partition_indices", 0) == DataType::kUInt32);
+  // The store holds float rows, they are cast to dtype before being shuffled.
+  const DataType dtype = ctx->Attr<DataType>("dtype");
+  CHECK_OR_RETURN(dtype == DataType::kFloat || dtype == DataType::kFloat16)
+      << "embedding_lookup_shuffle only supports float and float16 embeddings";
+  *ctx->OutputDType("embeddings", 0) = dtype;
+  return Maybe<void>::Ok();
+}
+
+namespace {
+
+Maybe<uint32_t> GetNumOptimizerStates(const std::string& optimizer) {
+  if (optimizer == "sgd") {
+    return embedding::NumOptimizerStates(embedding::SparseUpdateOptions::Optimizer::kSGD);
+  } else if (optimizer == "momentum") {
+    return embedding::NumOptimizerStates(embedding::SparseUpdateOptions::Optimizer::kMomentum);
+  } else if (optimizer == "adam") {
+    return embedding::NumOptimizerStates(embedding::SparseUpdateOptions::Optimizer::kAdam);
+  } else if (optimizer == "adagrad") {
+    return embedding::NumOptimizerStates(embedding::SparseUpdateOptions::Optimizer::kAdagrad);
+  } else {
+    UNIMPLEMENTED_THEN_RETURN() << "embedding_update does not support optimizer " << optimizer;
+  }
+}
+
+}  // namespace
+
+/* static */ Maybe<void> EmbeddingUpdateOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& num_unique_ids_shape = ctx->InputShape("num_unique_ids", 0);
+  const Shape& unique_ids_shape = ctx->InputShape("unique_ids", 0);
+  const Shape& embedding_diff_shape = ctx->InputShape("embedding_diff", 0);
+  CHECK_EQ_OR_RETURN(num_unique_ids_shape.elem_cnt(), 1);
+  CHECK_EQ_OR_RETURN(unique_ids_shape.NumAxes(), 1);
+  CHECK_EQ_OR_RETURN(embedding_diff_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(embedding_diff_shape.At(0), unique_ids_shape.At(0));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("learning_rate", 0).elem_cnt(), 1);
+  CHECK_EQ_OR_RETURN(ctx->has_input("bias_correction1", 0), ctx->has_input("bias_correction2", 0));
+  const std::string& optimizer = ctx->Attr<std::string>("optimizer");
+  // The rows of the store hold the embedding followed by the optimizer states.
+  embedding::KeyValueStoreOptions options(ctx->Attr<std::string>("key_value_store_options"));
+  const int64_t embedding_size = embedding_diff_shape.At(1);
+  CHECK_EQ_OR_RETURN(options.ValueSize(),
+                     (1 + JUST(GetNumOptimizerStates(optimizer))) * embedding_size * sizeof(float))
+      << "the value_size of " << options.Name() << " does not fit the rows of " << optimizer;
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingUpdateOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> EmbeddingUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  std::vector<user_op::OpArg> broadcast_args;
+  broadcast_args.emplace_back("num_unique_ids", 0);
+  broadcast_args.emplace_back("learning_rate", 0);
+  if (ctx->user_op_conf().has_input("bias_correction1", 0)) {
+    broadcast_args.emplace_back("bias_correction1", 0);
+    broadcast_args.emplace_back("bias_correction2", 0);
+  }
+  ctx->NewBuilder()
+      .Broadcast(broadcast_args)
+      .Split(user_op::OpArg("unique_ids", 0), 0)
+      .Split(user_op::OpArg("embedding_diff", 0), 0)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_OR_RETURN(ctx->InputDType("num_unique_ids", 0) == DataType::kUInt32);
+  CHECK_OR_RETURN(ctx->InputDType("embedding_diff", 0) == DataType::kFloat);
+  CHECK_OR_RETURN(ctx->InputDType("learning_rate", 0) == DataType::kFloat);
+  if (ctx->has_input("bias_correction1", 0)) {
+    CHECK_OR_RETURN(ctx->InputDType("bias_correction1", 0) == DataType::kFloat);
+    CHECK_OR_RETURN(ctx->InputDType("bias_correction2", 0) == DataType::kFloat);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
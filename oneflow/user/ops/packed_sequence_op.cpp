@@ -0,0 +1,170 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+// Packed sequences are the rows of sequence b laid one after another without padding, in rows
+// cu_seqlens[b] to cu_seqlens[b + 1] of a [total_len, ...] tensor. The padded layout puts them in
+// [batch_size, max_seqlen, ...] with zeros after the end of each sequence.
+
+namespace {
+
+Maybe<void> CheckCuSeqlens(user_op::InferContext* ctx) {
+  const user_op::TensorDesc& cu_seqlens = ctx->InputTensorDesc("cu_seqlens", 0);
+  CHECK_EQ_OR_RETURN(cu_seqlens.shape().NumAxes(), 1)
+      << "cu_seqlens should be of shape [batch_size + 1]";
+  CHECK_GE_OR_RETURN(cu_seqlens.shape().At(0), 1)
+      << "cu_seqlens should be of shape [batch_size + 1]";
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InferPackedSequenceDataType(user_op::InferContext* ctx) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("cu_seqlens", 0), DataType::kInt32);
+  *ctx->OutputDType("out", 0) = ctx->InputDType("in", 0);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SetCuSeqlensNoGrad(const GetInputArgModifier& GetInputArgModifierFn) {
+  user_op::InputArgModifier* cu_seqlens_modifier = GetInputArgModifierFn("cu_seqlens", 0);
+  CHECK_OR_RETURN(cu_seqlens_modifier != nullptr);
+  cu_seqlens_modifier->set_requires_grad(false);
+  return Maybe<void>::Ok();
+}
+
+// The rows are moved whole, so the sbp may split the feature axes, in_axis_offset and
+// out_axis_offset being where they start in "in" and in "out".
+Maybe<void> GetPackedSequenceSbp(user_op::SbpContext* ctx, int64_t in_axis_offset,
+                                 int64_t out_axis_offset) {
+  const int64_t num_axes = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0).shape().NumAxes();
+  FOR_RANGE(int64_t, i, in_axis_offset, num_axes) {
+    ctx->NewBuilder()
+        .Split(user_op::OpArg("in", 0), i)
+        .Broadcast(user_op::OpArg("cu_seqlens", 0))
+        .Split(user_op::OpArg("out", 0), i - in_axis_offset + out_axis_offset)
+        .Build();
+  }
+  ctx->NewBuilder()
+      .PartialSum(user_op::OpArg("in", 0))
+      .Broadcast(user_op::OpArg("cu_seqlens", 0))
+      .PartialSum(user_op::OpArg("out", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> PaddedToPackedOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckCuSeqlens(ctx));
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  CHECK_GE_OR_RETURN(in_shape.NumAxes(), 2)
+      << "padded_to_packed expects input of shape [batch_size, max_seqlen, ...]";
+  CHECK_EQ_OR_RETURN(in_shape.At(0) + 1, ctx->InputShape("cu_seqlens", 0).At(0))
+      << "cu_seqlens should be of shape [batch_size + 1]";
+  const int64_t total_len = ctx->Attr<int64_t>("total_len");
+  CHECK_GE_OR_RETURN(total_len, 0) << "total_len should be >= 0";
+  DimVector dim_vec(in_shape.dim_vec().begin() + 1, in_shape.dim_vec().end());
+  dim_vec.at(0) = total_len;
+  *ctx->OutputShape("out", 0) = Shape(dim_vec);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PaddedToPackedOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> PaddedToPackedOp::GetSbp(user_op::SbpContext* ctx) {
+  return GetPackedSequenceSbp(ctx, 2, 1);
+}
+
+/* static */ Maybe<void> PaddedToPackedOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetCuSeqlensNoGrad(GetInputArgModifierFn);
+}
+
+/* static */ Maybe<void> PaddedToPackedOp::InferDataType(user_op::InferContext* ctx) {
+  return InferPackedSequenceDataType(ctx);
+}
+
+/* static */ Maybe<void> PackedToPaddedOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckCuSeqlens(ctx));
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  CHECK_GE_OR_RETURN(in_shape.NumAxes(), 1)
+      << "packed_to_padded expects input of shape [total_len, ...]";
+  const int64_t max_seqlen = ctx->Attr<int64_t>("max_seqlen");
+  CHECK_GE_OR_RETURN(max_seqlen, 0) << "max_seqlen should be >= 0";
+  DimVector dim_vec(in_shape.dim_vec());
+  dim_vec.at(0) = max_seqlen;
+  dim_vec.insert(dim_vec.begin(), ctx->InputShape("cu_seqlens", 0).At(0) - 1);
+  *ctx->OutputShape("out", 0) = Shape(dim_vec);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PackedToPaddedOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> PackedToPaddedOp::GetSbp(user_op::SbpContext* ctx) {
+  return GetPackedSequenceSbp(ctx, 1, 2);
+}
+
+/* static */ Maybe<void> PackedToPaddedOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetCuSeqlensNoGrad(GetInputArgModifierFn);
+}
+
+/* static */ Maybe<void> PackedToPaddedOp::InferDataType(user_op::InferContext* ctx) {
+  return InferPackedSequenceDataType(ctx);
+}
+
+REGISTER_USER_OP_GRAD("padded_to_packed")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      if (op.NeedGenGradTensor4OpInput("in", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+        user_op::UserOpConfWrapper grad_op =
+            builder.Op("packed_to_padded")
+                .Input("in", op.GetGradTensorWithOpOutput("out", 0))
+                .Input("cu_seqlens", op.input("cu_seqlens", 0))
+                .Output("out")
+                .Attr<int64_t>("max_seqlen", op.TensorDesc4ArgNameAndIndex("in", 0).shape().At(1))
+                .Build();
+        op.BindGradTensorWithOpInput(grad_op.output("out", 0), "in", 0);
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+REGISTER_USER_OP_GRAD("packed_to_padded")
+    .SetGenBackwardOpConfFn([](const user_op::UserOpWrapper& op,
+                               user_op::AddOpFn AddOp) -> Maybe<void> {
+      if (op.NeedGenGradTensor4OpInput("in", 0)) {
+        user_op::UserOpConfWrapperBuilder builder(op.op_name() + "_grad");
+        user_op::UserOpConfWrapper grad_op =
+            builder.Op("padded_to_packed")
+                .Input("in", op.GetGradTensorWithOpOutput("out", 0))
+                .Input("cu_seqlens", op.input("cu_seqlens", 0))
+                .Output("out")
+                .Attr<int64_t>("total_len", op.TensorDesc4ArgNameAndIndex("in", 0).shape().At(0))
+                .Build();
+        op.BindGradTensorWithOpInput(grad_op.output("out", 0), "in", 0);
+        AddOp(grad_op);
+      }
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow
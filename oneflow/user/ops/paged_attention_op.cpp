@@ -0,0 +1,199 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+namespace {
+
+// The key and value caches are [num_blocks, block_size, num_kv_heads, head_dim]. A slot is
+// block_id * block_size + the offset in the block.
+Maybe<void> CheckKvCache(user_op::InferContext* ctx) {
+  const Shape& key_cache_shape = ctx->InputShape("key_cache", 0);
+  CHECK_EQ_OR_RETURN(key_cache_shape.NumAxes(), 4)
+      << "key_cache should be of shape [num_blocks, block_size, num_kv_heads, head_dim]";
+  CHECK_EQ_OR_RETURN(ctx->InputShape("value_cache", 0), key_cache_shape)
+      << "value_cache should be of the shape of key_cache";
+  CHECK_OR_RETURN(!ctx->InputIsDynamic("key_cache", 0));
+  CHECK_OR_RETURN(!ctx->InputIsDynamic("value_cache", 0));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckKvCacheDataType(user_op::InferContext* ctx, DataType data_type) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("key_cache", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("value_cache", 0), data_type);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> PagedKvCacheAppendOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckKvCache(ctx));
+  const Shape& key_cache_shape = ctx->InputShape("key_cache", 0);
+  const Shape& key_shape = ctx->InputShape("key", 0);
+  CHECK_EQ_OR_RETURN(key_shape.NumAxes(), 3)
+      << "key should be of shape [num_tokens, num_kv_heads, head_dim]";
+  CHECK_EQ_OR_RETURN(key_shape.At(1), key_cache_shape.At(2));
+  CHECK_EQ_OR_RETURN(key_shape.At(2), key_cache_shape.At(3));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("value", 0), key_shape);
+  const Shape& slot_mapping_shape = ctx->InputShape("slot_mapping", 0);
+  CHECK_EQ_OR_RETURN(slot_mapping_shape.NumAxes(), 1);
+  CHECK_EQ_OR_RETURN(slot_mapping_shape.At(0), key_shape.At(0));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheAppendOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> PagedKvCacheAppendOp::GetSbp(user_op::SbpContext* ctx) {
+  // Each rank keeps the heads it computes, in the blocks shared by all the ranks.
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("key_cache", 0), 2)
+      .Split(user_op::OpArg("value_cache", 0), 2)
+      .Split(user_op::OpArg("key", 0), 1)
+      .Split(user_op::OpArg("value", 0), 1)
+      .Broadcast(user_op::OpArg("slot_mapping", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheAppendOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  for (const std::string& cache : {"key_cache", "value_cache"}) {
+    user_op::InputArgModifier* cache_modifier = GetInputArgModifierFn(cache, 0);
+    CHECK_OR_RETURN(cache_modifier != nullptr);
+    cache_modifier->set_is_mutable(true);
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheAppendOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("key", 0);
+  JUST(CheckKvCacheDataType(ctx, data_type));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("value", 0), data_type);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("slot_mapping", 0), DataType::kInt64);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheReorderBeamsOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckKvCache(ctx));
+  const Shape& parent_beams_shape = ctx->InputShape("parent_beams", 0);
+  CHECK_EQ_OR_RETURN(parent_beams_shape.NumAxes(), 2)
+      << "parent_beams should be of shape [batch_size, num_beams]";
+  const int64_t num_seqs = parent_beams_shape.elem_cnt();
+  const Shape& block_tables_shape = ctx->InputShape("block_tables", 0);
+  CHECK_EQ_OR_RETURN(block_tables_shape.NumAxes(), 2)
+      << "block_tables should be of shape [batch_size * num_beams, max_num_blocks_per_seq]";
+  CHECK_EQ_OR_RETURN(block_tables_shape.At(0), num_seqs);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("context_lens", 0), Shape({num_seqs}));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheReorderBeamsOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> PagedKvCacheReorderBeamsOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("key_cache", 0), 2)
+      .Split(user_op::OpArg("value_cache", 0), 2)
+      .Broadcast(user_op::OpArg("block_tables", 0))
+      .Broadcast(user_op::OpArg("context_lens", 0))
+      .Broadcast(user_op::OpArg("parent_beams", 0))
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheReorderBeamsOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  for (const std::string& cache : {"key_cache", "value_cache"}) {
+    user_op::InputArgModifier* cache_modifier = GetInputArgModifierFn(cache, 0);
+    CHECK_OR_RETURN(cache_modifier != nullptr);
+    cache_modifier->set_is_mutable(true);
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedKvCacheReorderBeamsOp::InferDataType(user_op::InferContext* ctx) {
+  JUST(CheckKvCacheDataType(ctx, ctx->InputDType("key_cache", 0)));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("block_tables", 0), DataType::kInt32);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("context_lens", 0), DataType::kInt32);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("parent_beams", 0), DataType::kInt32);
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedDecodeAttentionOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  JUST(CheckKvCache(ctx));
+  const Shape& key_cache_shape = ctx->InputShape("key_cache", 0);
+  const Shape& query_shape = ctx->InputShape("query", 0);
+  CHECK_EQ_OR_RETURN(query_shape.NumAxes(), 3)
+      << "query should be of shape [batch_size, num_heads, head_dim]";
+  CHECK_EQ_OR_RETURN(query_shape.At(1) % key_cache_shape.At(2), 0)
+      << "num_heads should be a multiple of num_kv_heads";
+  CHECK_EQ_OR_RETURN(query_shape.At(2), key_cache_shape.At(3));
+  const Shape& block_tables_shape = ctx->InputShape("block_tables", 0);
+  CHECK_EQ_OR_RETURN(block_tables_shape.NumAxes(), 2)
+      << "block_tables should be of shape [batch_size, max_num_blocks_per_seq]";
+  CHECK_EQ_OR_RETURN(block_tables_shape.At(0), query_shape.At(0));
+  CHECK_EQ_OR_RETURN(ctx->InputShape("context_lens", 0), Shape({query_shape.At(0)}));
+  user_op::TensorDesc* out = ctx->OutputTensorDesc("out", 0);
+  *out->mut_shape() = query_shape;
+  out->set_is_dynamic(ctx->InputIsDynamic("query", 0));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedDecodeAttentionOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> PagedDecodeAttentionOp::GetSbp(user_op::SbpContext* ctx) {
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("query", 0), 0)
+      .Broadcast(user_op::OpArg("key_cache", 0))
+      .Broadcast(user_op::OpArg("value_cache", 0))
+      .Split(user_op::OpArg("block_tables", 0), 0)
+      .Split(user_op::OpArg("context_lens", 0), 0)
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  // Tensor parallel attention, the kv heads of a rank serve its query heads.
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("query", 0), 1)
+      .Split(user_op::OpArg("key_cache", 0), 2)
+      .Split(user_op::OpArg("value_cache", 0), 2)
+      .Broadcast(user_op::OpArg("block_tables", 0))
+      .Broadcast(user_op::OpArg("context_lens", 0))
+      .Split(user_op::OpArg("out", 0), 1)
+      .Build();
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> PagedDecodeAttentionOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType data_type = ctx->InputDType("query", 0);
+  JUST(CheckKvCacheDataType(ctx, data_type));
+  CHECK_EQ_OR_RETURN(ctx->InputDType("block_tables", 0), DataType::kInt32);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("context_lens", 0), DataType::kInt32);
+  *ctx->OutputDType("out", 0) = data_type;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
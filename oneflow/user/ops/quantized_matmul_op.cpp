@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+/*static*/ Maybe<void> QuantizedMatmulOp::GetSbp(user_op::SbpContext* ctx) {
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  const bool per_channel =
+      ctx->LogicalTensorDesc4InputArgNameAndIndex("b_scale", 0).shape().elem_cnt() > 1;
+  ctx->NewBuilder()
+      .Split(user_op::OpArg("a", 0), 0)
+      .Broadcast(user_op::OpArg("b", 0))
+      .Broadcast(user_op::OpArg("a_scale", 0))
+      .Broadcast(user_op::OpArg("b_scale", 0))
+      .Split(user_op::OpArg("out", 0), 0)
+      .Build();
+  auto builder = ctx->NewBuilder()
+                     .Broadcast(user_op::OpArg("a", 0))
+                     .Split(user_op::OpArg("b", 0), transpose_b ? 0 : 1)
+                     .Broadcast(user_op::OpArg("a_scale", 0));
+  if (per_channel) {
+    builder.Split(user_op::OpArg("b_scale", 0), 0);
+  } else {
+    builder.Broadcast(user_op::OpArg("b_scale", 0));
+  }
+  builder.Split(user_op::OpArg("out", 0), 1).Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const bool transpose_b = ctx->Attr<bool>("transpose_b");
+  const Shape& a_shape = ctx->InputShape("a", 0);
+  const Shape& b_shape = ctx->InputShape("b", 0);
+  CHECK_EQ_OR_RETURN(a_shape.NumAxes(), 2);
+  CHECK_EQ_OR_RETURN(b_shape.NumAxes(), 2);
+  const int64_t k = a_shape.At(1);
+  const int64_t n = transpose_b ? b_shape.At(0) : b_shape.At(1);
+  CHECK_EQ_OR_RETURN(transpose_b ? b_shape.At(1) : b_shape.At(0), k);
+  CHECK_EQ_OR_RETURN(ctx->InputShape("a_scale", 0).elem_cnt(), 1);
+  // NOTE: b_scale is either per-layer or per output channel.
+  const int64_t b_scale_size = ctx->InputShape("b_scale", 0).elem_cnt();
+  CHECK_OR_RETURN(b_scale_size == 1 || b_scale_size == n)
+      << "b_scale of quantized_matmul should have 1 or " << n << " elements, but got "
+      << b_scale_size;
+  *ctx->OutputShape("out", 0) = Shape({a_shape.At(0), n});
+  *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("a", 0);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> QuantizedMatmulOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType& dtype = ctx->InputDType("a", 0);
+  CHECK_EQ_OR_RETURN(dtype, DataType::kFloat);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b", 0), dtype);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("a_scale", 0), dtype);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("b_scale", 0), dtype);
+  *ctx->OutputDType("out", 0) = dtype;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
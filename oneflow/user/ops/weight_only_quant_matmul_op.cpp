@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/op_generated.h"
+
+namespace oneflow {
+
+/*static*/ Maybe<void> WeightOnlyQuantMatmulOp::GetSbp(user_op::SbpContext* ctx) {
+  const user_op::TensorDesc& x = ctx->LogicalTensorDesc4InputArgNameAndIndex("x", 0);
+  const bool has_bias = ctx->user_op_conf().has_input("bias", 0);
+  for (int64_t i = 0; i < x.shape().NumAxes() - 1; ++i) {
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("x", 0), i)
+                       .Broadcast(user_op::OpArg("weight", 0))
+                       .Broadcast(user_op::OpArg("scale", 0));
+    if (has_bias) { builder.Broadcast(user_op::OpArg("bias", 0)); }
+    builder.Split(user_op::OpArg("out", 0), i).Build();
+  }
+  // The rows of the weight are its output channels, together with their scales.
+  auto builder = ctx->NewBuilder()
+                     .Broadcast(user_op::OpArg("x", 0))
+                     .Split(user_op::OpArg("weight", 0), 0)
+                     .Split(user_op::OpArg("scale", 0), 0);
+  if (has_bias) { builder.Split(user_op::OpArg("bias", 0), 0); }
+  builder.Split(user_op::OpArg("out", 0), x.shape().NumAxes() - 1).Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> WeightOnlyQuantMatmulOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const int32_t num_bits = ctx->Attr<int32_t>("num_bits");
+  const int64_t group_size = ctx->Attr<int64_t>("group_size");
+  CHECK_OR_RETURN(num_bits == 4 || num_bits == 8)
+      << "weight_only_quant_matmul supports 4 or 8 bits, but got " << num_bits;
+  CHECK_GT_OR_RETURN(group_size, 0);
+  const Shape& x_shape = ctx->InputShape("x", 0);
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  const Shape& scale_shape = ctx->InputShape("scale", 0);
+  CHECK_GE_OR_RETURN(x_shape.NumAxes(), 1);
+  CHECK_EQ_OR_RETURN(weight_shape.NumAxes(), 2);
+  const int64_t k = x_shape.At(x_shape.NumAxes() - 1);
+  const int64_t n = weight_shape.At(0);
+  CHECK_EQ_OR_RETURN(k % group_size, 0)
+      << "the in features " << k << " should be a multiple of group_size " << group_size;
+  CHECK_EQ_OR_RETURN(weight_shape.At(1) * 8, k * num_bits)
+      << "weight of " << num_bits << " bits should have " << k * num_bits / 8
+      << " bytes per row, but got " << weight_shape.At(1);
+  CHECK_EQ_OR_RETURN(scale_shape, Shape({n, k / group_size}));
+  if (ctx->has_input("bias", 0)) { CHECK_EQ_OR_RETURN(ctx->InputShape("bias", 0), Shape({n})); }
+  Shape out_shape = x_shape;
+  out_shape.Set(out_shape.NumAxes() - 1, n);
+  *ctx->OutputShape("out", 0) = out_shape;
+  *ctx->OutputIsDynamic("out", 0) = ctx->InputIsDynamic("x", 0);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> WeightOnlyQuantMatmulOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> WeightOnlyQuantMatmulOp::InferDataType(user_op::InferContext* ctx) {
+  const DataType& dtype = ctx->InputDType("x", 0);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), DataType::kInt8);
+  CHECK_EQ_OR_RETURN(ctx->InputDType("scale", 0), dtype);
+  if (ctx->has_input("bias", 0)) { CHECK_EQ_OR_RETURN(ctx->InputDType("bias", 0), dtype); }
+  *ctx->OutputDType("out", 0) = dtype;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace oneflow
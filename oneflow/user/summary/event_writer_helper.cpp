@@ -52,7 +52,7 @@ Maybe<void> FillScalarInSummary(const float& value, const std::string& tag, Summ
 }
 
 template<typename T>
-Maybe<void> FillHistogramInSummary(const user_op::Tensor& value, const std::string& tag,
+Maybe<void> FillHistogramInSummary(const std::vector<T>& values, const std::string& tag,
                                    Summary* s) {
   SummaryMetadata metadata;
   SetPluginData(&metadata, kHistogramPluginName);
@@ -60,10 +60,7 @@ Maybe<void> FillHistogramInSummary(const user_op::Tensor& value, const std::stri
   v->set_tag(tag);
   *v->mutable_metadata() = metadata;
   summary::Histogram histo;
-  for (int64_t i = 0; i < value.shape().elem_cnt(); i++) {
-    double double_val = value.dptr<T>()[i];
-    histo.AppendValue(double_val);
-  }
+  for (const T& value : values) { histo.AppendValue(static_cast<double>(value)); }
   histo.AppendToProto(v->mutable_histo());
   return Maybe<void>::Ok();
 }
@@ -114,46 +111,35 @@ bool WriteImageToBuffer(const uint8_t* image, int width, int height, int depth,
   return true;
 }
 
-Maybe<void> FillImageInSummary(const user_op::Tensor& tensor, const std::string& tag, Summary* s) {
+Maybe<void> FillImageInSummary(const std::vector<uint8_t>& images, const Shape& shape,
+                               const std::string& tag, Summary* s) {
   SummaryMetadata metadata;
   SetPluginData(&metadata, kImagePluginName);
-  if (!(tensor.shape().NumAxes() == 4
-        && (tensor.shape().At(3) == 1 || tensor.shape().At(3) == 3 || tensor.shape().At(3) == 4))) {
-    UNIMPLEMENTED();
-  }
-  if (!(tensor.shape().At(0) < (1LL << 31) && tensor.shape().At(1) < (1LL << 31)
-        && tensor.shape().At(2) < (1LL << 31)
-        && (tensor.shape().At(1) * tensor.shape().At(2)) < (1LL << 29))) {
-    UNIMPLEMENTED();
-  }
-  const int64_t batch_size = static_cast<int64_t>(tensor.shape().At(0));
-  const int64_t h = static_cast<int64_t>(tensor.shape().At(1));
-  const int64_t w = static_cast<int64_t>(tensor.shape().At(2));
+  const int64_t batch_size = static_cast<int64_t>(shape.At(0));
+  const int64_t h = static_cast<int64_t>(shape.At(1));
+  const int64_t w = static_cast<int64_t>(shape.At(2));
   const int64_t hw = h * w;
-  const int64_t depth = static_cast<int64_t>(tensor.shape().At(3));
-  if (tensor.data_type() == DataType::kUInt8) {
-    auto ith_image = [&tensor, hw, depth](int i) {
-      auto images = tensor.dptr<uint8_t>();
-      auto image_i = std::unique_ptr<uint8_t[]>{new uint8_t[hw * depth]};
-      memcpy(image_i.get(), images + i * hw * depth, hw * depth);
-      return image_i;
-    };
-    for (int i = 0; i < batch_size; ++i) {
-      Summary::Value* v = s->add_value();
-      *v->mutable_metadata() = metadata;
-      if (batch_size == 1) {
-        v->set_tag(tag);
-      } else {
-        v->set_tag(tag + std::to_string(i));
-      }
-      Image* si = v->mutable_image();
-      si->set_height(h);
-      si->set_width(w);
-      si->set_colorspace(depth);
-      auto image = ith_image(i);
-      if (!WriteImageToBuffer(image.get(), w, h, depth, si->mutable_encoded_image_string()))
-        UNIMPLEMENTED();
+  const int64_t depth = static_cast<int64_t>(shape.At(3));
+  auto ith_image = [&images, hw, depth](int i) {
+    auto image_i = std::unique_ptr<uint8_t[]>{new uint8_t[hw * depth]};
+    memcpy(image_i.get(), images.data() + i * hw * depth, hw * depth);
+    return image_i;
+  };
+  for (int i = 0; i < batch_size; ++i) {
+    Summary::Value* v = s->add_value();
+    *v->mutable_metadata() = metadata;
+    if (batch_size == 1) {
+      v->set_tag(tag);
+    } else {
+      v->set_tag(tag + std::to_string(i));
     }
+    Image* si = v->mutable_image();
+    si->set_height(h);
+    si->set_width(w);
+    si->set_colorspace(depth);
+    auto image = ith_image(i);
+    if (!WriteImageToBuffer(image.get(), w, h, depth, si->mutable_encoded_image_string()))
+      UNIMPLEMENTED();
   }
   return Maybe<void>::Ok();
 }
@@ -178,22 +164,52 @@ struct EventWriterHelper<DeviceType::kCPU, T> {
     Global<EventsWriter>::Get()->AppendQueue(std::move(e));
   }
 
+  // The histogram is built on the writer thread from a copy of the values.
   static void WriteHistogramToFile(int64_t step, const user_op::Tensor& value,
                                    const std::string& tag) {
-    std::unique_ptr<Event> e{new Event};
-    e->set_step(step);
-    e->set_wall_time(GetWallTime());
-    CHECK_JUST(FillHistogramInSummary<T>(value, tag, e->mutable_summary()));
-    Global<EventsWriter>::Get()->AppendQueue(std::move(e));
+    const double wall_time = GetWallTime();
+    auto values = std::make_shared<std::vector<T>>(value.dptr<T>(),
+                                                   value.dptr<T>() + value.shape().elem_cnt());
+    const size_t byte_size = values->size() * sizeof(T);
+    Global<EventsWriter>::Get()->AppendQueue(
+        [step, wall_time, values, tag]() {
+          std::unique_ptr<Event> e{new Event};
+          e->set_step(step);
+          e->set_wall_time(wall_time);
+          CHECK_JUST(FillHistogramInSummary<T>(*values, tag, e->mutable_summary()));
+          return e;
+        },
+        byte_size);
   }
 
+  // The images are encoded to png on the writer thread from a copy of the pixels.
   static void WriteImageToFile(int64_t step, const user_op::Tensor& tensor,
                                const std::string& tag) {
-    std::unique_ptr<Event> e{new Event};
-    e->set_step(step);
-    e->set_wall_time(GetWallTime());
-    CHECK_JUST(FillImageInSummary(tensor, tag, e->mutable_summary()));
-    Global<EventsWriter>::Get()->AppendQueue(std::move(e));
+    const ShapeView& shape_view = tensor.shape();
+    if (!(shape_view.NumAxes() == 4
+          && (shape_view.At(3) == 1 || shape_view.At(3) == 3 || shape_view.At(3) == 4))) {
+      UNIMPLEMENTED();
+    }
+    if (!(shape_view.At(0) < (1LL << 31) && shape_view.At(1) < (1LL << 31)
+          && shape_view.At(2) < (1LL << 31)
+          && (shape_view.At(1) * shape_view.At(2)) < (1LL << 29))) {
+      UNIMPLEMENTED();
+    }
+    if (tensor.data_type() != DataType::kUInt8) { return; }
+    const double wall_time = GetWallTime();
+    Shape shape;
+    shape_view.ToShape(&shape);
+    auto images = std::make_shared<std::vector<uint8_t>>(
+        tensor.dptr<uint8_t>(), tensor.dptr<uint8_t>() + shape.elem_cnt());
+    Global<EventsWriter>::Get()->AppendQueue(
+        [step, wall_time, images, shape, tag]() {
+          std::unique_ptr<Event> e{new Event};
+          e->set_step(step);
+          e->set_wall_time(wall_time);
+          CHECK_JUST(FillImageInSummary(*images, shape, tag, e->mutable_summary()));
+          return e;
+        },
+        images->size());
   }
 };
 
@@ -21,17 +21,32 @@ namespace oneflow {
 
 namespace summary {
 
-EventsWriter::EventsWriter() : is_inited_(false) {}
+EventsWriter::EventsWriter()
+    : is_inited_(false),
+      queued_bytes_(0),
+      max_queued_bytes_(ParseIntegerFromEnv("ONEFLOW_SUMMARY_WRITER_MAX_QUEUED_MBYTE", 64)
+                        * 1024 * 1024),
+      num_dropped_events_(0),
+      writing_(false),
+      flush_requested_(false),
+      shutdown_(false) {}
 
 EventsWriter::~EventsWriter() { Close(); }
 
 Maybe<void> EventsWriter::Init(const std::string& logdir) {
-  file_system_ = std::make_unique<fs::PosixFileSystem>();
-  log_dir_ = logdir + "/event";
-  file_system_->RecursivelyCreateDirIfNotExist(log_dir_);
-  JUST(TryToInit());
-  is_inited_ = true;
-  last_flush_time_ = CurrentMircoTime();
+  Flush();
+  {
+    std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+    file_system_ = std::make_unique<fs::PosixFileSystem>();
+    log_dir_ = logdir + "/event";
+    file_system_->RecursivelyCreateDirIfNotExist(log_dir_);
+    JUST(TryToInit());
+    is_inited_ = true;
+  }
+  if (!writer_thread_.joinable()) {
+    shutdown_ = false;
+    writer_thread_ = std::thread(&EventsWriter::WriterLoop, this);
+  }
   return Maybe<void>::Ok();
 }
 
@@ -56,32 +71,86 @@ Maybe<void> EventsWriter::TryToInit() {
     event.set_wall_time(current_time);
     event.set_file_version(FILE_VERSION);
     WriteEvent(event);
-    Flush();
+    FileFlush();
   }
   return Maybe<void>::Ok();
 }
 
 void EventsWriter::AppendQueue(std::unique_ptr<Event> event) {
-  queue_mutex.lock();
-  event_queue_.emplace_back(std::move(event));
-  queue_mutex.unlock();
-  if (event_queue_.size() > MAX_QUEUE_NUM || CurrentMircoTime() - last_flush_time_ > FLUSH_TIME) {
-    Flush();
+  const size_t byte_size = event->ByteSizeLong();
+  std::shared_ptr<Event> shared_event(event.release());
+  AppendQueue([shared_event]() { return std::make_unique<Event>(std::move(*shared_event)); },
+              byte_size);
+}
+
+void EventsWriter::AppendQueue(std::function<std::unique_ptr<Event>()> make_event,
+                               size_t byte_size) {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (queued_bytes_ + byte_size > max_queued_bytes_) {
+      num_dropped_events_ += 1;
+      if (num_dropped_events_ == 1 || num_dropped_events_ % 100 == 0) {
+        LOG(WARNING) << num_dropped_events_ << " summary events dropped because more than "
+                     << max_queued_bytes_ << " bytes of events are waiting to be written";
+      }
+      return;
+    }
+    queued_bytes_ += byte_size;
+    event_queue_.emplace_back(QueuedEvent{std::move(make_event), byte_size});
+  }
+  queue_cond_.notify_one();
+}
+
+void EventsWriter::WriterLoop() {
+  while (true) {
+    std::deque<QueuedEvent> events;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock,
+                       [this]() { return shutdown_ || flush_requested_ || !event_queue_.empty(); });
+      if (shutdown_ && event_queue_.empty()) { break; }
+      events.swap(event_queue_);
+      flush_requested_ = false;
+      writing_ = true;
+    }
+    size_t written_bytes = 0;
+    {
+      std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+      for (QueuedEvent& queued_event : events) {
+        std::unique_ptr<Event> event = queued_event.make_event();
+        if (event) { WriteEvent(*event); }
+        written_bytes += queued_event.byte_size;
+      }
+      FileFlush();
+    }
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      queued_bytes_ -= written_bytes;
+      writing_ = false;
+    }
+    flushed_cond_.notify_all();
   }
 }
 
 void EventsWriter::Flush() {
-  queue_mutex.lock();
-  for (const std::unique_ptr<Event>& e : event_queue_) { WriteEvent(*e); }
-  event_queue_.clear();
-  queue_mutex.unlock();
-  FileFlush();
-  last_flush_time_ = CurrentMircoTime();
+  if (!writer_thread_.joinable()) { return; }
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  flush_requested_ = true;
+  queue_cond_.notify_one();
+  flushed_cond_.wait(lock, [this]() {
+    return event_queue_.empty() && !writing_ && !flush_requested_;
+  });
+}
+
+int64_t EventsWriter::num_dropped_events() const {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return num_dropped_events_;
 }
 
 void EventsWriter::WriteEvent(const Event& event) {
   std::string event_str;
   event.AppendToString(&event_str);
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (!TryToInit().IsOk()) {
     LOG(ERROR) << "Write failed because file could not be opened.";
     return;
@@ -98,22 +167,30 @@ void EventsWriter::WriteEvent(const Event& event) {
   writable_file_->Append(head, sizeof(head));
   writable_file_->Append(event_str.data(), event_str.size());
   writable_file_->Append(tail, sizeof(tail));
-  FileFlush();
 }
 
 void EventsWriter::FileFlush() {
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (writable_file_ == nullptr) { return; }
   writable_file_->Flush();
 }
 
 void EventsWriter::Close() {
   if (!is_inited_) { return; }
-  queue_mutex.unlock();
-  Flush();
+  if (writer_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      shutdown_ = true;
+    }
+    queue_cond_.notify_one();
+    writer_thread_.join();
+  }
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (writable_file_ != nullptr) {
     writable_file_->Close();
     writable_file_.reset(nullptr);
   }
+  is_inited_ = false;
 }
 
 }  // namespace summary
@@ -22,18 +22,23 @@ limitations under the License.
 #include "oneflow/core/summary/event.pb.h"
 
 #include <time.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
+#include <thread>
 
 namespace oneflow {
 
 namespace summary {
 
-#define MAX_QUEUE_NUM 10
-#define FLUSH_TIME 3 * 60 * 1000 * 1000
 #define FILE_VERSION "brain.Event:3"
 const size_t kHeadSize = sizeof(uint64_t) + sizeof(uint32_t);
 const size_t kTailSize = sizeof(uint32_t);
 
+// Events are queued by the summary kernels and written in batches by a background thread, so
+// logging does not block the step. Once the queued events hold more memory than
+// ONEFLOW_SUMMARY_WRITER_MAX_QUEUED_MBYTE, new events are dropped.
 class EventsWriter {
  public:
   EventsWriter();
@@ -41,14 +46,26 @@ class EventsWriter {
 
   Maybe<void> Init(const std::string& logdir);
   void WriteEvent(const Event& event);
+  // Blocks until all the queued events have been written to the log file.
   void Flush();
   void Close();
 
   void AppendQueue(std::unique_ptr<Event> event);
+  // Queues an event built by make_event on the writer thread, byte_size is the memory held by
+  // make_event until then.
+  void AppendQueue(std::function<std::unique_ptr<Event>()> make_event, size_t byte_size);
   void FileFlush();
 
+  int64_t num_dropped_events() const;
+
  private:
+  struct QueuedEvent {
+    std::function<std::unique_ptr<Event>()> make_event;
+    size_t byte_size;
+  };
+
   Maybe<void> TryToInit();
+  void WriterLoop();
   inline static void EncodeHead(char* head, size_t size);
   inline static void EncodeTail(char* tail, const char* data, size_t size);
 
@@ -57,9 +74,21 @@ class EventsWriter {
   std::string filename_;
   std::unique_ptr<fs::FileSystem> file_system_;
   std::unique_ptr<fs::WritableFile> writable_file_;
-  uint64_t last_flush_time_;
-  std::vector<std::unique_ptr<Event>> event_queue_;
-  std::mutex queue_mutex;
+  // Guards the log file, which is written by the writer thread.
+  std::recursive_mutex file_mutex_;
+
+  std::deque<QueuedEvent> event_queue_;
+  // Memory held by the events queued or being written.
+  size_t queued_bytes_;
+  const size_t max_queued_bytes_;
+  int64_t num_dropped_events_;
+  bool writing_;
+  bool flush_requested_;
+  bool shutdown_;
+  mutable std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::condition_variable flushed_cond_;
+  std::thread writer_thread_;
   OF_DISALLOW_COPY(EventsWriter);
 };
 
@@ -24,6 +24,7 @@ limitations under the License.
 
 #include <fstream>
 #include <mutex>
+#include <sstream>
 
 #ifdef WITH_TENSORRT
 #include "oneflow/xrt/tensorrt/trt_int8_calibrator.h"
@@ -57,6 +58,14 @@ bool FLAGS_tensorrt_int8 = EnvToBool(FLAGS_tensorrt_int8, false);
 // tensorrt_int8 flag is true.
 std::string FLAGS_int8_calibration = EnvToString(FLAGS_int8_calibration, "");
 
+// Directory to persist the built TENSORRT engines in and to load them from on later starts.
+// Default is empty, and this means the engines are built in every process.
+std::string FLAGS_tensorrt_engine_cache_dir = EnvToString(FLAGS_tensorrt_engine_cache_dir, "");
+
+// Axes of the TENSORRT engine inputs with a range of sizes, as comma separated axis:min:opt:max.
+// Default is empty, and this means an engine is built for every input shape.
+std::string FLAGS_tensorrt_dynamic_axes = EnvToString(FLAGS_tensorrt_dynamic_axes, "");
+
 namespace oneflow {
 namespace xrt {
 
@@ -81,6 +90,9 @@ static std::unordered_map<std::string, std::string> user_op_type_name2string_map
     {"broadcast_mul", "BcastMul"},
     {"broadcast_div", "BcastDiv"},
     {"broadcast_min", "BcastMin"},
+    {"broadcast_sub", "BcastSub"},
+    {"broadcast_minimum", "BcastMin"},
+    {"broadcast_maximum", "BcastMax"},
     {"cast", "Cast"},
     {"concat", "Concat"},
     {"conv2d", "Conv2D"},
@@ -93,6 +105,7 @@ static std::unordered_map<std::string, std::string> user_op_type_name2string_map
     {"reduce_mean", "ReduceMean"},
     {"reshape", "Reshape"},
     {"reshape_like", "ReshapeLike"},
+    {"slice", "Slice"},
     {"softmax", "Softmax"},
     {"softmax_grad", "SoftmaxGrad"},
     {"top_k", "TopK"},
@@ -108,6 +121,7 @@ static std::unordered_map<std::string, std::string> user_op_type_name2string_map
     {"adam_update", "AdamOptimizer"},
     {"rsqrt", "Rsqrt"},
     {"square_sum", "SquareSum"},
+    {"fused_self_attention_query_mul_key_and_value", "FusedSelfAttentionQueryMulKeyAndValue"},
 };
 
 std::string ExtractOpTypeAsString(const OperatorConf& conf) {
@@ -208,7 +222,33 @@ void InitXrtConfigurations(const XrtConfig& config) {
         FLAGS_int8_calibration = trt_config.int8_calibration();
       }
     }
+    if (trt_config.has_engine_cache_dir()) {
+      FLAGS_tensorrt_engine_cache_dir = trt_config.engine_cache_dir();
+    }
+    if (trt_config.has_dynamic_axes()) { FLAGS_tensorrt_dynamic_axes = trt_config.dynamic_axes(); }
+  }
+}
+
+std::vector<DynamicAxisRange> ParseDynamicAxes(const std::string& dynamic_axes) {
+  std::vector<DynamicAxisRange> ranges;
+  std::istringstream ranges_stream(dynamic_axes);
+  std::string range_str;
+  while (std::getline(ranges_stream, range_str, ',')) {
+    if (range_str.empty()) { continue; }
+    DynamicAxisRange range{};
+    char sep[3] = {0};
+    std::istringstream range_stream(range_str);
+    range_stream >> range.axis >> sep[0] >> range.min >> sep[1] >> range.opt >> sep[2]
+        >> range.max;
+    CHECK(!range_stream.fail() && sep[0] == ':' && sep[1] == ':' && sep[2] == ':')
+        << "Dynamic axis should be axis:min:opt:max, but got " << range_str;
+    CHECK_GE(range.axis, 0);
+    CHECK(range.min > 0 && range.min <= range.opt && range.opt <= range.max)
+        << "Invalid range of dynamic axis " << range_str;
+    for (const auto& other : ranges) { CHECK_NE(other.axis, range.axis); }
+    ranges.push_back(range);
   }
+  return ranges;
 }
 
 bool XrtCompilationEnabled() {
@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/core/register/blob.h"
 #include "oneflow/core/register/logical_blob_id.pb.h"
+#include "oneflow/xrt/executable.h"
 #include "oneflow/xrt/graph/graph.h"
 #include "oneflow/xrt/parameter.h"
 #include "oneflow/xrt/passes/pass.h"
@@ -56,6 +57,9 @@ std::shared_ptr<XrtGraph> BuildXrtGraph(const OpGraph* op_graph);
 
 void InitXrtConfigurations(const XrtConfig& config);
 
+// Parses comma separated axis:min:opt:max ranges.
+std::vector<DynamicAxisRange> ParseDynamicAxes(const std::string& dynamic_axes);
+
 bool XrtCompilationEnabled();
 
 // Create a default options for xrt pass.
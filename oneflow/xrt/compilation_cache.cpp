@@ -32,12 +32,24 @@ size_t SignatureHash::operator()(const Signature& signature) const {
 
 Signature ComputeSignature(const std::string& name, const int device_ordinal,
                            const std::vector<Parameter>& entry_params) {
+  return ComputeSignature(name, device_ordinal, entry_params, {});
+}
+
+Signature ComputeSignature(const std::string& name, const int device_ordinal,
+                           const std::vector<Parameter>& entry_params,
+                           const std::vector<DynamicAxisRange>& dynamic_axes) {
   Signature signature;
   signature.builder_name = name;
   signature.device_ordinal = device_ordinal;
   signature.entry_shapes.resize(entry_params.size());
   for (int i = 0; i < entry_params.size(); ++i) {
-    signature.entry_shapes[i] = entry_params[i].shape();
+    Shape shape = entry_params[i].shape();
+    for (const DynamicAxisRange& range : dynamic_axes) {
+      if (range.axis < shape.NumAxes() && range.Contains(shape.At(range.axis))) {
+        shape.Set(range.axis, -1);
+      }
+    }
+    signature.entry_shapes[i] = shape;
   }
   return signature;
 }
@@ -49,6 +49,12 @@ struct SignatureHash {
 Signature ComputeSignature(const std::string& name, const int device_ordinal,
                            const std::vector<xrt::Parameter>& entry_params);
 
+// Sizes on the dynamic axes that are in the ranges are masked as -1, so that all the entry
+// shapes an executable covers share its signature.
+Signature ComputeSignature(const std::string& name, const int device_ordinal,
+                           const std::vector<xrt::Parameter>& entry_params,
+                           const std::vector<DynamicAxisRange>& dynamic_axes);
+
 class CompilationCache {
  public:
   Executable* GetRecord(const Signature& signature) const;
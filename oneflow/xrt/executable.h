@@ -24,6 +24,17 @@ limitations under the License.
 namespace oneflow {
 namespace xrt {
 
+// The range an axis of the entry parameters of an executable may vary in, and the size it is
+// optimized for.
+struct DynamicAxisRange {
+  int32_t axis;
+  int64_t min;
+  int64_t opt;
+  int64_t max;
+
+  bool Contains(int64_t dim) const { return dim >= min && dim <= max; }
+};
+
 struct ExecutableRunOptions {
   // Specify stream if the engine supports multiple computation streams.
   // It will use the default computation stream if `stream` is not set.
@@ -52,6 +63,13 @@ struct ExecutableRunOptions {
 
   std::string tensorrt_int8_calibration = "";
 
+  // Directory of the serialized TensorRT engines. Engines are rebuilt in
+  // every process if it is empty.
+  std::string tensorrt_engine_cache_dir = "";
+
+  // Axes of the TensorRT network inputs that one engine covers a range of.
+  std::vector<DynamicAxisRange> tensorrt_dynamic_axes;
+
   // Feed the return parameters to reuse it's storage while running
   // the executable.
   std::vector<Parameter> return_params;
@@ -78,12 +96,18 @@ class Executable {
 
   const std::vector<Parameter>& Results() const { return results_; }
 
+  // Identifies the compiled function and its entry signature across processes,
+  // engines persisting their compilation results key them by it.
+  const std::string& fingerprint() const { return fingerprint_; }
+  void set_fingerprint(const std::string& fingerprint) { fingerprint_ = fingerprint; }
+
  protected:
   // Executable name.
   std::string name_;
   // Executable engine, XLA or TensorRT.
   XrtEngine engine_;
   std::vector<Parameter> results_;
+  std::string fingerprint_;
 };
 
 }  // namespace xrt
@@ -21,6 +21,8 @@ limitations under the License.
 #include "oneflow/xrt/platform.h"
 #include "oneflow/xrt/utility/env.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 
 // General executable setup.
 // Maximum temporary workspace bytes.
@@ -33,6 +35,8 @@ int32_t FLAGS_max_batch_size = EnvToInt(FLAGS_max_batch_size, 1);
 extern bool FLAGS_tensorrt_fp16;
 extern bool FLAGS_tensorrt_int8;
 extern std::string FLAGS_int8_calibration;
+extern std::string FLAGS_tensorrt_engine_cache_dir;
+extern std::string FLAGS_tensorrt_dynamic_axes;
 
 namespace oneflow {
 namespace xrt {
@@ -48,6 +52,25 @@ const LogicalBlobId& BnInOp2Lbi(const Kernel& kernel, const std::string& bn_in_o
   return kernel.op_attribute().arg_signature().bn_in_op2lbi().at(bn_in_op);
 }
 
+// The attribute maps of the nodes are serialized in key order, so that the same function yields
+// the same fingerprint in every process.
+std::string FunctionFingerprint(const XrtLaunchOpConf::Function& function,
+                                const std::vector<xrt::Parameter>& entry_params,
+                                const xrt::Signature& signature) {
+  std::string fingerprint;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&fingerprint);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(function.SerializeToCodedStream(&coded_stream));
+  }
+  for (int i = 0; i < entry_params.size(); ++i) {
+    fingerprint += entry_params[i].name() + signature.entry_shapes[i].ToString()
+                   + std::to_string(static_cast<int>(entry_params[i].data_type()));
+  }
+  return fingerprint;
+}
+
 }  // namespace
 
 template<DeviceType device_type>
@@ -70,11 +93,17 @@ xrt::Executable* XrtLaunchKernel<device_type>::BuildExecutable(
     const std::vector<xrt::Parameter>& entry_params,
     const std::vector<xrt::Parameter>& return_params,
     const std::vector<xrt::InputOutputAlias>& aliases, const int device_ordinal) const {
-  if (!compilation_cache_) { compilation_cache_.reset(new xrt::CompilationCache); }
+  if (!compilation_cache_) {
+    compilation_cache_.reset(new xrt::CompilationCache);
+    const std::string& engine_name = this->op_conf().xrt_launch_conf().engine();
+    if (xrt::StringToXrtEngine(engine_name) == xrt::XrtEngine::TENSORRT) {
+      dynamic_axes_ = xrt::ParseDynamicAxes(FLAGS_tensorrt_dynamic_axes);
+    }
+  }
 
   xrt::Executable* executable = nullptr;
   xrt::Signature signature =
-      xrt::ComputeSignature(this->op_conf().name(), device_ordinal, entry_params);
+      xrt::ComputeSignature(this->op_conf().name(), device_ordinal, entry_params, dynamic_axes_);
   bool force_compile = false;
   if (!force_compile) { executable = compilation_cache_->GetRecord(signature); }
 
@@ -110,6 +139,9 @@ xrt::Executable* XrtLaunchKernel<device_type>::BuildExecutable(
     xrt::XrtDevice device = xrt::DeviceTypeToXrtDevice(device_type);
     xrt::GraphCompiler compiler(this->op_conf().name(), engine, device, device_ordinal);
     auto result = compiler.Compile(graph.get(), entry_params, return_params, aliases);
+    if (engine == xrt::XrtEngine::TENSORRT && !FLAGS_tensorrt_engine_cache_dir.empty()) {
+      result->set_fingerprint(FunctionFingerprint(launch_conf.function(), entry_params, signature));
+    }
     // Record new compilation result
     compilation_cache_->Record(signature, result);
     // Get compilation result from cache
@@ -201,6 +233,8 @@ void XrtLaunchKernel<device_type>::ForwardDataContent(KernelContext* ctx) const
     run_options.tensorrt_fp16 = FLAGS_tensorrt_fp16;
     run_options.tensorrt_int8 = FLAGS_tensorrt_int8;
     run_options.tensorrt_int8_calibration = FLAGS_int8_calibration;
+    run_options.tensorrt_engine_cache_dir = FLAGS_tensorrt_engine_cache_dir;
+    run_options.tensorrt_dynamic_axes = dynamic_axes_;
   }
   bool status = executable->Run(entry_params, run_options, block_until_done);
   CHECK(status) << "Executable is running failed.";
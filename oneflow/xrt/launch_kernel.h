@@ -68,6 +68,8 @@ class XrtLaunchKernel : public Kernel {
  private:
   mutable BlobDescGetter<device_type> desc_getter_;
   mutable std::shared_ptr<xrt::CompilationCache> compilation_cache_;
+  // Axes of the entry parameters one TensorRT executable covers a range of.
+  mutable std::vector<xrt::DynamicAxisRange> dynamic_axes_;
 };
 
 }  // namespace oneflow
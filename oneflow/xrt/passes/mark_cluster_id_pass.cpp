@@ -13,6 +13,11 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <sstream>
+
 #include "oneflow/xrt/graph/graph.h"
 #include "oneflow/xrt/passes/cluster.h"
 #include "oneflow/xrt/passes/pass.h"
@@ -41,6 +46,8 @@ class MarkClusterIdPass : public XrtPass {
   // Rerank cluster id start by 0.
   void RerankClusterIds();
   void DumpClusterInfoToGraph(XrtGraph* graph);
+  // Logs the number of clusters and the distribution of their sizes for each engine.
+  void ReportClusterStats(const XrtGraph* graph) const;
 
   bool TryToFuseWithParent(ClusterNode* children, ClusterNode* parent,
                            const ClusteringOptions& options);
@@ -167,6 +174,34 @@ void MarkClusterIdPass::DumpClusterInfoToGraph(XrtGraph* graph) {
   }
 }
 
+void MarkClusterIdPass::ReportClusterStats(const XrtGraph* graph) const {
+  util::Map<XrtEngine, std::vector<int>> engine_cluster_sizes;
+  for (const ClusterNode* node : root_nodes_) {
+    engine_cluster_sizes[node->engine()].emplace_back(node->size());
+  }
+  for (auto& pair : engine_cluster_sizes) {
+    std::vector<int>& sizes = pair.second;
+    std::sort(sizes.begin(), sizes.end());
+    int64_t num_nodes = std::accumulate(sizes.begin(), sizes.end(), int64_t(0));
+    // Clusters of at most 2, 4, 8, ... nodes.
+    std::map<int, int> histogram;
+    for (int size : sizes) {
+      int bucket = 2;
+      while (bucket < size) { bucket *= 2; }
+      ++histogram[bucket];
+    }
+    std::ostringstream hist_str;
+    for (const auto& bucket : histogram) {
+      hist_str << " <=" << bucket.first << ":" << bucket.second;
+    }
+    LOG(INFO) << "XRT engine " << XrtEngine_Name(pair.first) << " has " << sizes.size()
+              << " clusters covering " << num_nodes << " of " << graph->Nodes().size()
+              << " nodes, cluster size min " << sizes.front() << " median "
+              << sizes[sizes.size() / 2] << " max " << sizes.back() << ", histogram"
+              << hist_str.str();
+  }
+}
+
 void MarkClusterIdPass::FinalizeClusterEngine(const ClusteringOptions& options,
                                               const XrtEngine& engine) {
   const int min_nodes = options.minimum_nodes;
@@ -207,6 +242,7 @@ void MarkClusterIdPass::Run(XrtGraph* graph, const XrtPassOptions& options) {
 
   RemoveInvalidClusterNodes(clustering_options);
   RerankClusterIds();
+  ReportClusterStats(graph);
 
   DumpClusterInfoToGraph(graph);
 }
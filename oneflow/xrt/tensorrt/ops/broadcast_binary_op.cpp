@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+#include "oneflow/xrt/tensorrt/trt_helpers.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+template<nvinfer1::ElementWiseOperation element_wise_op>
+class BcastBinaryOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    CHECK_EQ(ctx->InputType("x_0"), ctx->InputType("y_0"));
+    int num_axes =
+        std::max(ctx->InputShape("x_0").NumAxes(), ctx->InputShape("y_0").NumAxes());
+    nvinfer1::ITensor* x = helpers::ExpandDimsTo(ctx, ctx->Input("x_0"), num_axes);
+    nvinfer1::ITensor* y = helpers::ExpandDimsTo(ctx, ctx->Input("y_0"), num_axes);
+    auto* layer = ctx->builder()->addElementWise(*x, *y, element_wise_op);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetOutput("z_0", layer->getOutput(0));
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(BcastAdd, BcastBinaryOp<nvinfer1::ElementWiseOperation::kSUM>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(BcastSub, BcastBinaryOp<nvinfer1::ElementWiseOperation::kSUB>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(BcastMul, BcastBinaryOp<nvinfer1::ElementWiseOperation::kPROD>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(BcastDiv, BcastBinaryOp<nvinfer1::ElementWiseOperation::kDIV>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(BcastMin, BcastBinaryOp<nvinfer1::ElementWiseOperation::kMIN>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(BcastMax, BcastBinaryOp<nvinfer1::ElementWiseOperation::kMAX>)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+
+#include "oneflow/xrt/api.h"
+#include "oneflow/xrt/tensorrt/trt_helpers.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+// Splits the hidden states of layout (seq_len, batch_size, num_heads, 3, head_size) into query,
+// key and value of layout (batch_size, num_heads, seq_len, head_size), and outputs
+// alpha * query * key^T together with the value.
+class FusedSelfAttentionQueryMulKeyAndValueOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    Shape hidden_shape = ctx->InputShape("hidden_states_0");
+    CHECK_EQ(hidden_shape.NumAxes(), 3);
+    const int64_t head_size = ctx->Attr<int64_t>("head_size");
+    const int64_t seq_len = hidden_shape.At(0);
+    const int64_t batch_size = hidden_shape.At(1);
+    CHECK_EQ(hidden_shape.At(2) % (head_size * 3), 0);
+    const int64_t num_heads = hidden_shape.At(2) / (head_size * 3);
+
+    nvinfer1::ITensor* hidden = helpers::Reshape(
+        ctx, ctx->Input("hidden_states_0"),
+        AsShape(std::vector<int64_t>{seq_len, batch_size, num_heads, 3, head_size}));
+    // (3, batch_size, num_heads, seq_len, head_size)
+    hidden = helpers::Transpose(ctx, hidden, {3, 1, 2, 0, 4});
+
+    Shape split_shape = AsShape(std::vector<int64_t>{batch_size, num_heads, seq_len, head_size});
+    auto Split = [&](int index) {
+      nvinfer1::Dims start, size, stride;
+      start.nbDims = size.nbDims = stride.nbDims = 5;
+      for (int i = 0; i < 5; ++i) {
+        start.d[i] = 0;
+        size.d[i] = (i == 0) ? 1 : split_shape.At(i - 1);
+        stride.d[i] = 1;
+      }
+      start.d[0] = index;
+      auto* layer = ctx->builder()->addSlice(*hidden, start, size, stride);
+      return helpers::Reshape(ctx, layer->getOutput(0), split_shape);
+    };
+    nvinfer1::ITensor* query = Split(0);
+    nvinfer1::ITensor* key = Split(1);
+    nvinfer1::ITensor* value = Split(2);
+
+    auto* matmul = ctx->builder()->addMatrixMultiply(*query, nvinfer1::MatrixOperation::kNONE,
+                                                     *key, nvinfer1::MatrixOperation::kTRANSPOSE);
+    nvinfer1::ITensor* alpha = helpers::Scalar(ctx, ctx->Attr<float>("alpha"),
+                                               ctx->InputType("hidden_states_0"), 4);
+    auto* layer = ctx->builder()->addElementWise(*matmul->getOutput(0), *alpha,
+                                                 nvinfer1::ElementWiseOperation::kPROD);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetOutput("query_mul_key_0", layer->getOutput(0));
+    ctx->SetOutput("value_0", value);
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(FusedSelfAttentionQueryMulKeyAndValue,
+                       FusedSelfAttentionQueryMulKeyAndValueOp)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
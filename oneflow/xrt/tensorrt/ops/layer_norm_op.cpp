@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+
+#include "oneflow/xrt/api.h"
+#include "oneflow/xrt/tensorrt/trt_helpers.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+class LayerNormOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    Shape in_shape = ctx->InputShape("x_0");
+    int num_axes = in_shape.NumAxes();
+    int begin_norm_axis = ctx->Attr<int64_t>("begin_norm_axis");
+    int begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    if (begin_norm_axis < 0) { begin_norm_axis += num_axes; }
+    if (begin_params_axis < 0) { begin_params_axis += num_axes; }
+    CHECK_GE(begin_norm_axis, 0);
+    CHECK_LT(begin_norm_axis, num_axes);
+    CHECK_GE(begin_params_axis, 0);
+    CHECK_LT(begin_params_axis, num_axes);
+
+    uint32_t reduce_axes = 0;
+    for (int i = begin_norm_axis; i < num_axes; ++i) { reduce_axes |= (1U << i); }
+
+    auto* builder = ctx->builder();
+    DataType data_type = ctx->InputType("x_0");
+    nvinfer1::ITensor* in = ctx->Input("x_0");
+    auto* mean = builder->addReduce(*in, nvinfer1::ReduceOperation::kAVG, reduce_axes, true);
+    auto* centered = builder->addElementWise(*in, *mean->getOutput(0),
+                                             nvinfer1::ElementWiseOperation::kSUB);
+    nvinfer1::ITensor* diff = centered->getOutput(0);
+    auto* square = builder->addElementWise(*diff, *diff, nvinfer1::ElementWiseOperation::kPROD);
+    auto* variance = builder->addReduce(*square->getOutput(0), nvinfer1::ReduceOperation::kAVG,
+                                        reduce_axes, true);
+    nvinfer1::ITensor* epsilon =
+        helpers::Scalar(ctx, ctx->Attr<double>("epsilon"), data_type, num_axes);
+    auto* shifted = builder->addElementWise(*variance->getOutput(0), *epsilon,
+                                            nvinfer1::ElementWiseOperation::kSUM);
+    auto* stddev = builder->addUnary(*shifted->getOutput(0), nvinfer1::UnaryOperation::kSQRT);
+    auto* inv_variance =
+        builder->addUnary(*stddev->getOutput(0), nvinfer1::UnaryOperation::kRECIP);
+    auto* normalized = builder->addElementWise(*diff, *inv_variance->getOutput(0),
+                                               nvinfer1::ElementWiseOperation::kPROD);
+    nvinfer1::ITensor* out = normalized->getOutput(0);
+
+    // Gamma and beta have the dimensions from `begin_params_axis`, and are reshaped with
+    // leading dimensions of 1 to broadcast against the input.
+    std::vector<int64_t> params_dims(num_axes, 1);
+    for (int i = begin_params_axis; i < num_axes; ++i) { params_dims[i] = in_shape.At(i); }
+    if (ctx->Attr<bool>("scale")) {
+      nvinfer1::ITensor* gamma =
+          helpers::Reshape(ctx, ctx->Weight("gamma_0"), AsShape(params_dims));
+      auto* layer = builder->addElementWise(*out, *gamma, nvinfer1::ElementWiseOperation::kPROD);
+      out = layer->getOutput(0);
+    }
+    if (ctx->Attr<bool>("center")) {
+      nvinfer1::ITensor* beta =
+          helpers::Reshape(ctx, ctx->Weight("beta_0"), AsShape(params_dims));
+      auto* layer = builder->addElementWise(*out, *beta, nvinfer1::ElementWiseOperation::kSUM);
+      out = layer->getOutput(0);
+    }
+    ctx->SetOutput("y_0", out);
+
+    Shape mean_shape(
+        DimVector(in_shape.dim_vec().begin(), in_shape.dim_vec().begin() + begin_norm_axis));
+    if (ctx->HasOutput("mean_0")) {
+      ctx->SetOutput("mean_0", helpers::Reshape(ctx, mean->getOutput(0), mean_shape));
+    }
+    if (ctx->HasOutput("inv_variance_0")) {
+      ctx->SetOutput("inv_variance_0",
+                     helpers::Reshape(ctx, inv_variance->getOutput(0), mean_shape));
+    }
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(LayerNorm, LayerNormOp).Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,53 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+#include "oneflow/xrt/tensorrt/trt_helpers.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+template<nvinfer1::ElementWiseOperation element_wise_op>
+class ScalarBinaryOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    double operand = 0.0;
+    if (ctx->Attr<bool>("has_float_operand")) {
+      operand = ctx->Attr<double>("float_operand");
+    } else {
+      CHECK(ctx->Attr<bool>("has_int_operand"));
+      operand = static_cast<double>(ctx->Attr<int64_t>("int_operand"));
+    }
+    nvinfer1::ITensor* in = ctx->SoleInput();
+    nvinfer1::ITensor* scalar = helpers::Scalar(ctx, operand, ctx->SoleInputType(),
+                                                ctx->SoleInputShape().NumAxes());
+    auto* layer = ctx->builder()->addElementWise(*in, *scalar, element_wise_op);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetSoleOutput(layer->getOutput(0));
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(ScalarAdd, ScalarBinaryOp<nvinfer1::ElementWiseOperation::kSUM>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_TRT_OP_KERNEL(ScalarMul, ScalarBinaryOp<nvinfer1::ElementWiseOperation::kPROD>)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,56 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+class SliceOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    Shape in_shape = ctx->SoleInputShape();
+    Shape out_shape = ctx->SoleOutputShape();
+    const auto& start = ctx->Attr<std::vector<int64_t>>("start");
+    const auto& step = ctx->Attr<std::vector<int64_t>>("step");
+    CHECK_EQ(start.size(), in_shape.NumAxes());
+    CHECK_EQ(step.size(), in_shape.NumAxes());
+
+    nvinfer1::Dims start_dims, size_dims, stride_dims;
+    start_dims.nbDims = size_dims.nbDims = stride_dims.nbDims = in_shape.NumAxes();
+    for (int i = 0; i < in_shape.NumAxes(); ++i) {
+      const int64_t dim_size = in_shape.At(i);
+      int64_t begin = start[i] < 0 ? start[i] + dim_size : start[i];
+      // The same regulation as the slice op, a negative step starts at the last element at most.
+      begin = std::max<int64_t>(begin, 0);
+      begin = std::min<int64_t>(begin, step[i] > 0 ? dim_size : dim_size - 1);
+      start_dims.d[i] = begin;
+      size_dims.d[i] = out_shape.At(i);
+      stride_dims.d[i] = step[i];
+    }
+    nvinfer1::ITensor* in = ctx->SoleInput();
+    auto* layer = ctx->builder()->addSlice(*in, start_dims, size_dims, stride_dims);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetSoleOutput(layer->getOutput(0));
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(Slice, SliceOp).EnableTrainPhase().Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
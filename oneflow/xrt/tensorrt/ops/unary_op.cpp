@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cmath>
+
+#include "oneflow/xrt/tensorrt/ops/op_context.h"
+#include "oneflow/xrt/tensorrt/ops/op_kernel.h"
+#include "oneflow/xrt/tensorrt/trt_helpers.h"
+
+namespace oneflow {
+namespace xrt {
+namespace tensorrt {
+
+class RsqrtOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    nvinfer1::ITensor* in = ctx->SoleInput();
+    auto* sqrt = ctx->builder()->addUnary(*in, nvinfer1::UnaryOperation::kSQRT);
+    auto* layer = ctx->builder()->addUnary(*sqrt->getOutput(0), nvinfer1::UnaryOperation::kRECIP);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetSoleOutput(layer->getOutput(0));
+  }
+};
+
+// gelu(x) = 0.5 * x * (1 + erf(x / sqrt(2)))
+class GeluOp : public TrtOpKernel {
+ public:
+  void Compile(TrtOpContext* ctx) override {
+    nvinfer1::ITensor* in = ctx->SoleInput();
+    DataType data_type = ctx->SoleInputType();
+    int num_axes = ctx->SoleInputShape().NumAxes();
+    auto* builder = ctx->builder();
+
+    nvinfer1::ITensor* rsqrt2 = helpers::Scalar(ctx, M_SQRT1_2, data_type, num_axes);
+    nvinfer1::ITensor* one = helpers::Scalar(ctx, 1.f, data_type, num_axes);
+    nvinfer1::ITensor* half = helpers::Scalar(ctx, 0.5f, data_type, num_axes);
+
+    auto* scaled = builder->addElementWise(*in, *rsqrt2, nvinfer1::ElementWiseOperation::kPROD);
+    auto* erf = builder->addUnary(*scaled->getOutput(0), nvinfer1::UnaryOperation::kERF);
+    auto* shifted =
+        builder->addElementWise(*erf->getOutput(0), *one, nvinfer1::ElementWiseOperation::kSUM);
+    auto* half_in = builder->addElementWise(*in, *half, nvinfer1::ElementWiseOperation::kPROD);
+    auto* layer = builder->addElementWise(*half_in->getOutput(0), *shifted->getOutput(0),
+                                          nvinfer1::ElementWiseOperation::kPROD);
+    layer->setName(ctx->op_name().c_str());
+    ctx->SetSoleOutput(layer->getOutput(0));
+  }
+};
+
+REGISTER_TRT_OP_KERNEL(Rsqrt, RsqrtOp).EnableTrainPhase().Finalize();
+REGISTER_TRT_OP_KERNEL(Gelu, GeluOp).EnableTrainPhase().Finalize();
+
+}  // namespace tensorrt
+}  // namespace xrt
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 #ifdef WITH_CUDA
 #include "cuda_runtime.h"
 #endif
+#include "absl/strings/str_cat.h"
 #include "oneflow/xrt/tensorrt/trt_builder.h"
 
 namespace oneflow {
@@ -92,6 +93,36 @@ int64_t TrtBuilder::AddWeight(nvinfer1::Weights& weight) {
   return handle;
 }
 
+nvinfer1::Weights TrtBuilder::ConstantWeight(float value, const DataType& data_type,
+                                             int64_t count) {
+  auto host_data = std::make_shared<std::vector<uint8_t>>(count * SizeOf(data_type));
+  switch (data_type) {
+    case oneflow::kFloat: {
+      std::fill_n(reinterpret_cast<float*>(host_data->data()), count, value);
+      break;
+    }
+    case oneflow::kFloat16: {
+      std::fill_n(reinterpret_cast<float16*>(host_data->data()), count,
+                  static_cast<float16>(value));
+      break;
+    }
+    case oneflow::kInt32: {
+      std::fill_n(reinterpret_cast<int32_t*>(host_data->data()), count,
+                  static_cast<int32_t>(value));
+      break;
+    }
+    default: LOG(FATAL) << "Unsupported data type " << data_type << " for TensorRT constants.";
+  }
+  // Constants have no parameter name, so give them one which never collides with parameters.
+  host_weights_[absl::StrCat("_constant_", host_weights_.size())] = host_data;
+
+  nvinfer1::Weights weight;
+  weight.type = DataTypeToTrtDataType(data_type);
+  weight.values = host_data->data();
+  weight.count = count;
+  return weight;
+}
+
 nv::unique_ptr<nvinfer1::ICudaEngine> TrtBuilder::BuildCudaEngine() {
   auto build_config = nv::unique_ptr<nvinfer1::IBuilderConfig>(builder_->createBuilderConfig());
   return nv::unique_ptr<nvinfer1::ICudaEngine>(
@@ -127,6 +127,10 @@ class TrtBuilder {
   // Returns handle for the added weight.
   int64_t AddWeight(nvinfer1::Weights& weight);
 
+  // Returns weight of `count` elements filled with `value`. Its host memory is kept in the host
+  // weights, so it lives as long as the engine built from the network.
+  nvinfer1::Weights ConstantWeight(float value, const DataType& data_type, int64_t count = 1);
+
   nv::unique_ptr<nvinfer1::IBuilder> ReleaseBuilder() { return std::move(builder_); }
 
   nv::unique_ptr<nvinfer1::INetworkDefinition> ReleaseNetwork() { return std::move(network_); }
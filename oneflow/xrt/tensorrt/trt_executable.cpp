@@ -15,9 +15,17 @@ limitations under the License.
 */
 #include "oneflow/xrt/tensorrt/trt_executable.h"
 #include "oneflow/xrt/tensorrt/trt_int8_calibrator.h"
+#include "oneflow/xrt/tensorrt/trt_logger.h"
+#include "oneflow/xrt/tensorrt/trt_shape.h"
 #include "oneflow/xrt/platform.h"
 
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include "cuda_runtime.h"
 #include "absl/strings/str_cat.h"
@@ -27,6 +35,51 @@ namespace xrt {
 
 namespace tensorrt {
 
+namespace {
+
+bool HasDynamicDim(const nvinfer1::Dims& dims) {
+  for (int i = 0; i < dims.nbDims; ++i) {
+    if (dims.d[i] < 0) { return true; }
+  }
+  return false;
+}
+
+// Marks the sizes of the network inputs on the dynamic axes as -1 if they are in the ranges,
+// consistently with the masking of the compilation signature, and adds their ranges to the
+// profile. Returns whether any input is dynamic.
+bool SetupDynamicInputs(const std::vector<DynamicAxisRange>& dynamic_axes,
+                        nvinfer1::INetworkDefinition* network,
+                        nvinfer1::IOptimizationProfile* profile) {
+  bool has_dynamic_input = false;
+  for (int i = 0; i < network->getNbInputs(); ++i) {
+    nvinfer1::ITensor* input = network->getInput(i);
+    nvinfer1::Dims dims = input->getDimensions();
+    nvinfer1::Dims min_dims = dims;
+    nvinfer1::Dims opt_dims = dims;
+    nvinfer1::Dims max_dims = dims;
+    bool dynamic = false;
+    for (const DynamicAxisRange& range : dynamic_axes) {
+      if (range.axis >= dims.nbDims) { continue; }
+      // The input may already be dynamic if the engine is rebuilt.
+      if (dims.d[range.axis] >= 0 && !range.Contains(dims.d[range.axis])) { continue; }
+      dims.d[range.axis] = -1;
+      min_dims.d[range.axis] = range.min;
+      opt_dims.d[range.axis] = range.opt;
+      max_dims.d[range.axis] = range.max;
+      dynamic = true;
+    }
+    if (!dynamic) { continue; }
+    input->setDimensions(dims);
+    CHECK(profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMIN, min_dims));
+    CHECK(profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kOPT, opt_dims));
+    CHECK(profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMAX, max_dims));
+    has_dynamic_input = true;
+  }
+  return has_dynamic_input;
+}
+
+}  // namespace
+
 nvinfer1::ICudaEngine* TrtExecutable::CreateExecutableEngine(
     const ExecutableRunOptions& run_options, const int batch_size /*= 1*/,
     TRTInt8Calibrator* calibrator /*= nullptr*/) {
@@ -40,6 +93,13 @@ nvinfer1::ICudaEngine* TrtExecutable::CreateExecutableEngine(
   }
   build_config->setMaxWorkspaceSize(max_workspace_size);
 
+  if (!run_options.tensorrt_dynamic_axes.empty()) {
+    nvinfer1::IOptimizationProfile* profile = builder_->createOptimizationProfile();
+    if (SetupDynamicInputs(run_options.tensorrt_dynamic_axes, network_.get(), profile)) {
+      build_config->addOptimizationProfile(profile);
+    }
+  }
+
   nvinfer1::BuilderFlags flags = 0U;
   if (run_options.tensorrt_fp16) {
     if (builder_->platformHasFastFp16()) {
@@ -73,7 +133,97 @@ nvinfer1::ICudaEngine* TrtExecutable::CreateExecutableEngine(
   int32_t max_batch_size = std::max(run_options.max_batch_size, batch_size);
   builder_->setMaxBatchSize(max_batch_size);
   // builder_->setGpuAllocator();
-  return builder_->buildEngineWithConfig(*network_, *build_config);
+  nvinfer1::ICudaEngine* engine = builder_->buildEngineWithConfig(*network_, *build_config);
+  CHECK(engine || run_options.tensorrt_dynamic_axes.empty())
+      << "TensorRT could not build the engine of " << this->name()
+      << " with dynamic axes, some layers may depend on static input sizes, unset "
+         "FLAGS_tensorrt_dynamic_axes to build an engine for every input shape.";
+  return engine;
+}
+
+nvinfer1::ICudaEngine* TrtExecutable::LoadOrCreateExecutableEngine(
+    const ExecutableRunOptions& run_options, const int batch_size,
+    TRTInt8Calibrator* calibrator) {
+  if (run_options.tensorrt_engine_cache_dir.empty() || this->fingerprint().empty()) {
+    return CreateExecutableEngine(run_options, batch_size, calibrator);
+  }
+  const std::string key = EngineCacheKey(run_options, batch_size, calibrator);
+  const std::string path = absl::StrCat(run_options.tensorrt_engine_cache_dir, "/trt_",
+                                        absl::Hex(std::hash<std::string>()(key)), ".engine");
+  nvinfer1::ICudaEngine* engine = LoadSerializedEngine(path, key);
+  if (engine) {
+    LOG(INFO) << "Load TensorRT engine of " << this->name() << " from " << path;
+    return engine;
+  }
+  engine = CreateExecutableEngine(run_options, batch_size, calibrator);
+  if (engine) { SaveSerializedEngine(path, key, engine); }
+  return engine;
+}
+
+std::string TrtExecutable::EngineCacheKey(const ExecutableRunOptions& run_options,
+                                          const int batch_size,
+                                          TRTInt8Calibrator* calibrator) const {
+  cudaDeviceProp prop;
+  CHECK_EQ(cudaSuccess, cudaGetDeviceProperties(&prop, run_options.device_ordinal));
+  std::string dynamic_axes;
+  for (const DynamicAxisRange& range : run_options.tensorrt_dynamic_axes) {
+    absl::StrAppend(&dynamic_axes, range.axis, ":", range.min, ":", range.opt, ":", range.max,
+                    ",");
+  }
+  return absl::StrCat(this->fingerprint(), "|trt:", getInferLibVersion(), "|gpu:", prop.name,
+                      ":", prop.major, ".", prop.minor, "|fp16:", run_options.tensorrt_fp16,
+                      "|int8:", run_options.tensorrt_int8 && calibrator != nullptr, ":",
+                      run_options.tensorrt_int8_calibration,
+                      "|batch:", std::max(run_options.max_batch_size, batch_size),
+                      "|workspace:", run_options.device_memory_limit, "|dynamic:", dynamic_axes);
+}
+
+// A cached engine file starts with the length of its key and the key, followed by the
+// serialized engine. Keys are compared in full since file names only carry their hash.
+nvinfer1::ICudaEngine* TrtExecutable::LoadSerializedEngine(const std::string& path,
+                                                           const std::string& key) {
+  std::ifstream infile(path, std::ios::in | std::ios::binary);
+  if (!infile.good()) { return nullptr; }
+  const std::string content((std::istreambuf_iterator<char>(infile)),
+                            std::istreambuf_iterator<char>());
+  uint64_t key_size = 0;
+  if (content.size() < sizeof(key_size)) { return nullptr; }
+  std::memcpy(&key_size, content.data(), sizeof(key_size));
+  if (content.size() < sizeof(key_size) + key_size
+      || content.compare(sizeof(key_size), key_size, key) != 0) {
+    LOG(WARNING) << "Ignore TensorRT engine cache " << path << " built for another key";
+    return nullptr;
+  }
+  static nv::Logger logger;
+  if (!runtime_) { runtime_.reset(nvinfer1::createInferRuntime(logger)); }
+  const char* data = content.data() + sizeof(key_size) + key_size;
+  const size_t size = content.size() - sizeof(key_size) - key_size;
+#if NV_TENSORRT_MAJOR > 7
+  return runtime_->deserializeCudaEngine(data, size);
+#else
+  return runtime_->deserializeCudaEngine(data, size, nullptr);
+#endif
+}
+
+void TrtExecutable::SaveSerializedEngine(const std::string& path, const std::string& key,
+                                         nvinfer1::ICudaEngine* engine) const {
+  auto serialized = nv::unique_ptr<nvinfer1::IHostMemory>(engine->serialize());
+  CHECK(serialized) << "Failed to serialize TensorRT engine of " << this->name();
+  // Replicas starting together may build the same engine, each of them renames its own file.
+  const std::string tmp_path = absl::StrCat(path, ".tmp.", getpid());
+  {
+    std::ofstream outfile(tmp_path, std::ios::out | std::ios::binary);
+    if (!outfile.good()) {
+      LOG(WARNING) << "Could not write TensorRT engine cache " << tmp_path;
+      return;
+    }
+    const uint64_t key_size = key.size();
+    outfile.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+    outfile.write(key.data(), key.size());
+    outfile.write(reinterpret_cast<const char*>(serialized->data()), serialized->size());
+  }
+  CHECK_EQ(std::rename(tmp_path.c_str(), path.c_str()), 0)
+      << "Could not rename TensorRT engine cache " << tmp_path << " to " << path;
 }
 
 bool TrtExecutable::ExecuteEngine(int batch_size, void** buffers, void* stream,
@@ -114,8 +264,8 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
     calibrator_.reset(new TRTInt8Calibrator(calibration_data));
   }
   if (!execution_context_ && !engine_) {
-    engine_.reset(CreateExecutableEngine(run_options, 1 /*batch size*/,  // NOLINT
-                                         calibrator_.get()));
+    engine_.reset(LoadOrCreateExecutableEngine(run_options, 1 /*batch size*/,  // NOLINT
+                                               calibrator_.get()));
     CHECK(engine_) << "Cannot create TensorRT executable engine.";
   }
 
@@ -142,12 +292,20 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
   }
   // TODO(hjchen2): Check batch size is same for all binding parameters.
   const int batch_size = binding_params[0]->shape().At(0);
-  if (batch_size > engine_->getMaxBatchSize()) {
+  bool has_dynamic_input = false;
+  for (int i = 0; i < num_bindings; ++i) {
+    if (engine_->bindingIsInput(i) && HasDynamicDim(engine_->getBindingDimensions(i))) {
+      has_dynamic_input = true;
+    }
+  }
+  // Engines with dynamic inputs cover the batch sizes in their profile, the compilation
+  // signature sends the others to another executable.
+  if (!has_dynamic_input && batch_size > engine_->getMaxBatchSize()) {
     LOG(WARNING) << "Rebuild engine since the maximum batch size "  // NOLINT
                  << engine_->getMaxBatchSize()                      // NOLINT
                  << " is less than the input batch size " << batch_size;
-    engine_.reset(CreateExecutableEngine(run_options, batch_size,  // NOLINT
-                                         calibrator_.get()));
+    engine_.reset(LoadOrCreateExecutableEngine(run_options, batch_size,  // NOLINT
+                                               calibrator_.get()));
     CHECK(engine_) << "Failed to create engine with batch size " << batch_size;
     execution_context_.reset(engine_->createExecutionContext());
   }
@@ -182,6 +340,17 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
     }
   }
 
+  if (has_dynamic_input) {
+    if (!execution_context_) { execution_context_.reset(engine_->createExecutionContext()); }
+    for (int i = 0; i < num_bindings; ++i) {
+      if (!engine_->bindingIsInput(i)) { continue; }
+      CHECK(execution_context_->setBindingDimensions(i,
+                                                     ShapeToXrtDims(binding_params[i]->shape())))
+          << "Input " << engine_->getBindingName(i) << " of shape "
+          << binding_params[i]->shape().ToString() << " is out of the dynamic axis ranges";
+    }
+  }
+
   return ExecuteEngine(batch_size, buffers.data(), run_options.stream,  // NOLINT
                        block_until_done);
 }
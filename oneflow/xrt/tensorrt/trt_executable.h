@@ -58,11 +58,28 @@ class TrtExecutable : public Executable {
                                                 const int batch_size = 1,
                                                 TRTInt8Calibrator* calibrator = nullptr);
 
+  // Loads the engine from run_options.tensorrt_engine_cache_dir if it was serialized there
+  // by a previous build with the same function, TensorRT version, GPU and precision flags,
+  // otherwise builds and serializes it.
+  nvinfer1::ICudaEngine* LoadOrCreateExecutableEngine(const ExecutableRunOptions& run_options,
+                                                      const int batch_size,
+                                                      TRTInt8Calibrator* calibrator);
+
+  std::string EngineCacheKey(const ExecutableRunOptions& run_options, const int batch_size,
+                             TRTInt8Calibrator* calibrator) const;
+
+  nvinfer1::ICudaEngine* LoadSerializedEngine(const std::string& path, const std::string& key);
+
+  void SaveSerializedEngine(const std::string& path, const std::string& key,
+                            nvinfer1::ICudaEngine* engine) const;
+
   bool ExecuteEngine(const int batch_size, void** buffers, void* stream, bool block_until_done);
 
   std::string LoadCalibrationTable(const std::string& calibration_path);
 
  private:
+  // Deserialized engines must not outlive the runtime.
+  nv::unique_ptr<nvinfer1::IRuntime> runtime_;
   nv::unique_ptr<nvinfer1::ICudaEngine> engine_;
   nv::unique_ptr<nvinfer1::IBuilder> builder_;
   nv::unique_ptr<nvinfer1::INetworkDefinition> network_;
@@ -69,6 +69,30 @@ nvinfer1::ITensor* Transpose(TrtOpContext* ctx, nvinfer1::Weights in, const Shap
   return layer->getOutput(0);
 }
 
+nvinfer1::ITensor* Scalar(TrtOpContext* ctx, float value, const DataType& data_type,
+                          int num_axes) {
+  nvinfer1::Dims dims;
+  dims.nbDims = num_axes;
+  for (int i = 0; i < num_axes; ++i) { dims.d[i] = 1; }
+  nvinfer1::Weights weight = ctx->builder()->ConstantWeight(value, data_type);
+  auto* layer = ctx->builder()->addConstant(dims, weight);
+  return layer->getOutput(0);
+}
+
+nvinfer1::ITensor* ExpandDimsTo(TrtOpContext* ctx, nvinfer1::ITensor* in, int num_axes) {
+  nvinfer1::Dims in_dims = in->getDimensions();
+  CHECK_LE(in_dims.nbDims, num_axes);
+  if (in_dims.nbDims == num_axes) { return in; }
+  nvinfer1::Dims dims;
+  dims.nbDims = num_axes;
+  int offset = num_axes - in_dims.nbDims;
+  for (int i = 0; i < offset; ++i) { dims.d[i] = 1; }
+  for (int i = 0; i < in_dims.nbDims; ++i) { dims.d[offset + i] = in_dims.d[i]; }
+  auto* layer = ctx->builder()->addShuffle(*in);
+  layer->setReshapeDimensions(dims);
+  return layer->getOutput(0);
+}
+
 }  // namespace helpers
 
 }  // namespace tensorrt
@@ -39,6 +39,15 @@ nvinfer1::ITensor* Transpose(TrtOpContext* ctx, nvinfer1::ITensor* in,
 nvinfer1::ITensor* Transpose(TrtOpContext* ctx, nvinfer1::Weights in, const Shape& shape,
                              const std::vector<int>& permute);
 
+// Returns a constant of `value` with `num_axes` dimensions of 1, which broadcasts against any
+// tensor of `num_axes` dimensions in element-wise layers.
+nvinfer1::ITensor* Scalar(TrtOpContext* ctx, float value, const DataType& data_type,
+                          int num_axes);
+
+// Prepends dimensions of 1 to `in` until it has `num_axes` dimensions, since element-wise
+// layers only broadcast between tensors of the same number of dimensions.
+nvinfer1::ITensor* ExpandDimsTo(TrtOpContext* ctx, nvinfer1::ITensor* in, int num_axes);
+
 }  // namespace helpers
 
 }  // namespace tensorrt
@@ -17,9 +17,13 @@ limitations under the License.
 import os
 import sys
 import collections
+import time
 
+_import_start_time = time.perf_counter()
 import oneflow._oneflow_internal
 
+_import_internal_time = time.perf_counter()
+
 oneflow._oneflow_internal.InitNumpyCAPI()
 oneflow._oneflow_internal.CheckAndClearRegistryFlag()
 Size = oneflow._oneflow_internal.Size
@@ -339,6 +343,7 @@ from oneflow.nn.modules.math_ops import addmm_op as addmm
 from oneflow.nn.modules.math_ops import topk_op as topk
 from oneflow.nn.modules.nonzero import nonzero_op as nonzero
 from oneflow.nn.modules.nms import nms_op as nms
+from oneflow._C import batched_nms
 from oneflow.nn.modules.numel import numel_op as numel
 from oneflow.nn.modules.meshgrid import meshgrid_op as meshgrid
 from oneflow.nn.modules.random_ops import rand_op as rand
@@ -398,6 +403,10 @@ from . import (
     amp,
 )  # , saved_model NOTE(chengcheng): unavailable now
 import oneflow.utils.data
+import oneflow.utils.checkpoint
+import oneflow.utils.dlpack
+import oneflow.utils.peer_checkpoint
+from oneflow.utils.dlpack import from_dlpack
 import oneflow.comm
 import oneflow.framework.docstr as docstr
 import oneflow.cuda
@@ -408,3 +417,17 @@ if oneflow._oneflow_internal.flags.with_mlir():
     if os.getenv("ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"):
         print("MLIR JIT engine will load:", oneflow_internal_path, file=sys.stderr)
         oneflow._oneflow_internal.ir.load_jit_shared_lib(oneflow_internal_path)
+
+if os.getenv("ONEFLOW_PROFILE_STARTUP"):
+    print(
+        "import oneflow took %.3f ms, of which loading oneflow._oneflow_internal, "
+        "with its static registrations, took %.3f ms"
+        % (
+            (time.perf_counter() - _import_start_time) * 1000,
+            (_import_internal_time - _import_start_time) * 1000,
+        ),
+        file=sys.stderr,
+    )
+    print(
+        oneflow._oneflow_internal.GetRegistrationTimeSummary(), end="", file=sys.stderr
+    )
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+from oneflow.autograd import graph
 from oneflow.autograd.autograd import backward, grad
 from oneflow.autograd.autograd_function import Function
 from oneflow.autograd.autograd_mode import (
@@ -26,6 +27,7 @@ from oneflow.autograd.autograd_mode import (
 __all__ = [
     "backward",
     "grad",
+    "graph",
     "Function",
     "grad_enable",
     "inference_mode",
@@ -0,0 +1,101 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow as flow
+import oneflow._oneflow_internal
+
+
+class saved_tensors_hooks:
+    r"""
+    Context-manager that sets a pair of pack / unpack hooks for the tensors saved for
+    backward.
+
+    ``pack_hook`` is called with each tensor saved by the ops in the context, and the
+    object it returns is stored instead of the tensor. ``unpack_hook`` is called with
+    that object right before backward uses the tensor, and must return a tensor with the
+    same content. The hooks can compress the saved tensors, offload them or drop them
+    and recompute them in ``unpack_hook``.
+
+    This context manager is thread local; it will not affect computation in other
+    threads.
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> def pack_hook(x):
+        ...     return x.to(flow.float64)
+        >>> def unpack_hook(x):
+        ...     return x.to(flow.float32)
+        >>> a = flow.ones(5, requires_grad=True)
+        >>> with flow.autograd.graph.saved_tensors_hooks(pack_hook, unpack_hook):
+        ...     y = a * a
+        >>> y.sum().backward()
+        >>> a.grad
+        tensor([2., 2., 2., 2., 2.], dtype=oneflow.float32)
+    """
+
+    def __init__(self, pack_hook, unpack_hook):
+        self.pack_hook = pack_hook
+        self.unpack_hook = unpack_hook
+
+    def __enter__(self):
+        oneflow._oneflow_internal.autograd._push_saved_tensors_hooks(
+            self.pack_hook, self.unpack_hook
+        )
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        oneflow._oneflow_internal.autograd._pop_saved_tensors_hooks()
+
+
+class save_on_cpu(saved_tensors_hooks):
+    r"""
+    Context-manager under which the tensors saved for backward are offloaded to host
+    memory and copied back to their device when backward uses them.
+
+    The copies are launched asynchronously by the virtual machine, so the copy back of
+    a saved tensor is issued ahead of the backward kernels that use it and overlaps with
+    the kernels before them. Tensors on cpu and global tensors are saved as they are.
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> a = flow.ones(5, requires_grad=True)
+        >>> with flow.autograd.graph.save_on_cpu():
+        ...     y = a * a
+        >>> y.sum().backward()
+        >>> a.grad
+        tensor([2., 2., 2., 2., 2.], dtype=oneflow.float32)
+    """
+
+    def __init__(self):
+        def pack_to_cpu(tensor):
+            if tensor.is_global or tensor.device.type == "cpu":
+                return (None, tensor)
+            return (tensor.device, tensor.to("cpu"))
+
+        def unpack_from_cpu(packed):
+            device, tensor = packed
+            if device is None:
+                return tensor
+            return tensor.to(device)
+
+        super().__init__(pack_to_cpu, unpack_from_cpu)
+
+
+if __name__ == "__main__":
+    import doctest
+
+    doctest.testmod(raise_on_error=True)
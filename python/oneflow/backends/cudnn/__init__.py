@@ -19,3 +19,4 @@ from oneflow.framework.config_util import (
 from oneflow.framework.config_util import (
     api_enable_cudnn_fused_normalization_add_relu as enable_fused_normalization_add_relu,
 )
+from oneflow.backends.cudnn.conv_algo_cache import warmup as warmup_conv_algo_cache
@@ -0,0 +1,123 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import argparse
+import json
+import os
+
+import oneflow as flow
+
+_CACHE_DIR_ENV = "ONEFLOW_CUDNN_CONV_ALGO_CACHE_DIR"
+
+_CONV_MODULES = {1: flow.nn.Conv1d, 2: flow.nn.Conv2d, 3: flow.nn.Conv3d}
+
+
+class _ConvEvalGraph(flow.nn.Graph):
+    def __init__(self, conv):
+        super().__init__()
+        self.conv = conv
+        self.config.enable_cudnn_conv_heuristic_search_algo(False)
+
+    def build(self, x):
+        return self.conv(x)
+
+
+class _ConvTrainGraph(flow.nn.Graph):
+    def __init__(self, conv, input_scale):
+        super().__init__()
+        self.conv = conv
+        # Scaling the input by a parameter makes it require grad, so the backward data
+        # algorithm is searched as well.
+        self.input_scale = input_scale
+        self.add_optimizer(
+            flow.optim.SGD(
+                list(conv.parameters()) + [input_scale], lr=0.0, momentum=0.0
+            )
+        )
+        self.config.enable_cudnn_conv_heuristic_search_algo(False)
+
+    def build(self, x):
+        y = self.conv(x * self.input_scale)
+        loss = y.sum()
+        loss.backward()
+        return loss
+
+
+def _warmup_one(config):
+    input_shape = list(config["input_shape"])
+    num_spatial_dims = len(input_shape) - 2
+    assert num_spatial_dims in _CONV_MODULES, "input_shape must be 3-D, 4-D or 5-D"
+    dtype = getattr(flow, config.get("dtype", "float32"))
+    conv = _CONV_MODULES[num_spatial_dims](
+        input_shape[1],
+        config["out_channels"],
+        config["kernel_size"],
+        stride=config.get("stride", 1),
+        padding=config.get("padding", 0),
+        dilation=config.get("dilation", 1),
+        groups=config.get("groups", 1),
+        bias=False,
+    ).to(device="cuda", dtype=dtype)
+    x = flow.randn(*input_shape, device="cuda").to(dtype)
+    if config.get("backward", True):
+        input_scale = flow.nn.Parameter(flow.ones(1, device="cuda", dtype=dtype))
+        _ConvTrainGraph(conv, input_scale)(x)
+    else:
+        _ConvEvalGraph(conv)(x)
+
+
+def warmup(configs, cache_dir=None):
+    r"""Run exhaustive cuDNN convolution algorithm search for every convolution in
+    ``configs`` so the results land in the persistent algorithm cache.
+
+    The cache directory is read from ``ONEFLOW_CUDNN_CONV_ALGO_CACHE_DIR`` the first time
+    a convolution algorithm is searched in the process, so ``cache_dir`` only takes
+    effect when this is called before any convolution has run.
+
+    Args:
+        configs (list of dict): each dict describes one convolution with keys
+            ``input_shape`` (N, C, *spatial), ``out_channels``, ``kernel_size`` and
+            optional ``stride``, ``padding``, ``dilation``, ``groups``, ``dtype``
+            (default ``"float32"``) and ``backward`` (default ``True``).
+        cache_dir (str, optional): directory of the persistent cache.
+    """
+    if cache_dir is not None:
+        os.makedirs(cache_dir, exist_ok=True)
+        os.environ[_CACHE_DIR_ENV] = cache_dir
+    assert os.getenv(_CACHE_DIR_ENV), (
+        "set %s or pass cache_dir to persist the searched algorithms" % _CACHE_DIR_ENV
+    )
+    for config in configs:
+        _warmup_one(config)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Pre-warm the persistent cuDNN convolution algorithm cache."
+    )
+    parser.add_argument(
+        "--config",
+        required=True,
+        help="json file holding a list of convolution configs, see warmup()",
+    )
+    parser.add_argument("--cache-dir", default=None, help="persistent cache directory")
+    args = parser.parse_args()
+    with open(args.config) as f:
+        configs = json.load(f)
+    warmup(configs, args.cache_dir)
+
+
+if __name__ == "__main__":
+    main()
@@ -21,8 +21,13 @@ from oneflow.framework.config_util import (
     api_nccl_fusion_all_gather as allow_fuse_all_gather,
     api_nccl_fusion_reduce as allow_fuse_reduce,
     api_nccl_fusion_broadcast as allow_fuse_broadcast,
+    api_nccl_fusion_all_to_all as allow_fuse_all_to_all,
     api_nccl_enable_mixed_fusion as allow_fuse_mixed_ops,
     api_nccl_fusion_all_reduce_use_buffer as enable_use_buffer_to_fuse_all_reduce,
+    api_nccl_all_reduce_compression as set_all_reduce_compression,
+    api_nccl_all_reduce_compression_error_feedback as enable_all_reduce_compression_error_feedback,
+    api_nccl_enable_hierarchical_all_reduce as enable_hierarchical_all_reduce,
+    api_nccl_fusion_threshold_auto_tune as enable_fusion_threshold_auto_tune,
 )
 
 from oneflow.framework.config_util import api_nccl_num_streams as set_stream_num
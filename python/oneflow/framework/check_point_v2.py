@@ -112,8 +112,14 @@ def _save_tensor_to_disk(tensor: "oneflow.Tensor", dir_name: Union[str, Path]) -
         tensor.dtype
     )
     data_path = os.path.join(dir_name, DATA_FILENAME)
-    with open(data_path, "wb") as f:
-        f.write(tensor.numpy().tobytes())
+    if async_save_path is not None and tensor.is_local:
+        global async_snapshot_id
+        async_snapshot_id = oneflow._oneflow_internal.async_snapshot.WriteTensor(
+            tensor, str(async_save_path), data_path
+        )
+    else:
+        with open(data_path, "wb") as f:
+            f.write(tensor.numpy().tobytes())
 
     with open(os.path.join(dir_name, META_INFO_FILENAME), "w") as f:
         f.write(text_format.MessageToString(meta_info))
@@ -268,6 +274,35 @@ def legacy_load(
     return var_dict
 
 
+class AsyncSaveHandle:
+    r"""The handle of an object saved by :func:`oneflow.save` with ``async_save=True``,
+    whose tensors are still being written to the disk in the background.
+    """
+
+    def __init__(self, snapshot_id: int):
+        self._snapshot_id = snapshot_id
+
+    def done(self) -> bool:
+        r"""Returns whether all the tensors have been written."""
+        return oneflow._oneflow_internal.async_snapshot.IsDone(self._snapshot_id)
+
+    def wait(self) -> None:
+        r"""Blocks until all the tensors have been written."""
+        oneflow._oneflow_internal.async_snapshot.Wait(self._snapshot_id)
+
+
+@contextmanager
+def async_save_context(path: Path):
+    global async_save_path
+    global async_snapshot_id
+    async_save_path = path
+    async_snapshot_id = 0
+    try:
+        yield
+    finally:
+        async_save_path = None
+
+
 @contextmanager
 def tensor_pickling_context(path: Path, global_src_dst_rank: int):
     global save_load_path
@@ -325,8 +360,11 @@ def load(path: str, global_src_rank: Optional[int] = None,) -> Any:
 
 
 def save(
-    obj: Any, path: Union[str, Path], global_dst_rank: Optional[int] = None,
-) -> None:
+    obj: Any,
+    path: Union[str, Path],
+    global_dst_rank: Optional[int] = None,
+    async_save: bool = False,
+) -> Optional[AsyncSaveHandle]:
     r"""Save an object to a directory.
 
     Args:
@@ -337,9 +375,31 @@ def save(
             will be saved by the process whose rank == 
             global_src_rank, while other processes will not do any
             disk I/O.
+        async_save (bool, optional): When True, the tensors are
+            copied to host memory and written to the disk by
+            background threads, so that this function returns
+            without waiting for them. Default: False
+
+    Returns:
+        An :class:`AsyncSaveHandle` to wait for the tensors if
+        ``async_save`` is True, otherwise None.
+
+    Note:
+        A save waits for the tensors of the previous asynchronous
+        save to be written first.
     """
     path: Path = Path(path)
+    oneflow._oneflow_internal.async_snapshot.WaitAll()
+    if async_save:
+        with async_save_context(path):
+            _save(obj, path, global_dst_rank)
+            snapshot_id = async_snapshot_id
+        return AsyncSaveHandle(snapshot_id)
+    _save(obj, path, global_dst_rank)
+    return None
+
 
+def _save(obj: Any, path: Path, global_dst_rank: Optional[int]) -> None:
     if isinstance(obj, graph_util.Graph):
         graph: graph_util.Graph = obj
         if not graph._is_compiled:
@@ -367,3 +427,5 @@ def save(
 
 save_load_path = None
 global_src_dsk_rank = None
+async_save_path = None
+async_snapshot_id = 0
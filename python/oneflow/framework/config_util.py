@@ -503,6 +503,22 @@ def nccl_fusion_broadcast(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_fusion_broadcast = val
 
 
+def api_nccl_fusion_all_to_all(val: bool) -> None:
+    """Whether or not use nccl fusion during all2all progress
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([nccl_fusion_all_to_all, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_fusion_all_to_all(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.nccl_fusion_all_to_all = val
+
+
 def api_nccl_fusion_max_ops(val: int) -> None:
     """Maximum number of ops for nccl fusion.
 
@@ -551,6 +567,87 @@ def nccl_enable_mixed_fusion(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_enable_mixed_fusion = val
 
 
+def api_nccl_all_reduce_compression(val: str) -> None:
+    """Compress float sum all-reduce to a 16-bit type on the wire
+
+    Args:
+        val (str): "none", "fp16" or "bf16"
+    """
+    return enable_if.unique([nccl_all_reduce_compression, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_all_reduce_compression(val):
+    sess = session_ctx.GetDefaultSession()
+    name2compression = {
+        "none": resource_util.kNcclAllReduceCompressionNone,
+        "fp16": resource_util.kNcclAllReduceCompressionFloat16,
+        "bf16": resource_util.kNcclAllReduceCompressionBFloat16,
+    }
+    assert val in name2compression, "unsupported compression: " + str(val)
+    compression = name2compression[val]
+    sess.config_proto.resource.collective_boxing_conf.nccl_all_reduce_compression = (
+        compression
+    )
+
+
+def api_nccl_all_reduce_compression_error_feedback(val: bool) -> None:
+    """Whether or not add the compression error of all-reduce back in the next iteration
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([nccl_all_reduce_compression_error_feedback, do_nothing])(
+        val
+    )
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_all_reduce_compression_error_feedback(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.nccl_all_reduce_compression_error_feedback = (
+        val
+    )
+
+
+def api_nccl_enable_hierarchical_all_reduce(val: bool) -> None:
+    """Whether or not run nccl all reduce hierarchically inside and across nodes
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([nccl_enable_hierarchical_all_reduce, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_enable_hierarchical_all_reduce(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.nccl_enable_hierarchical_all_reduce = (
+        val
+    )
+
+
+def api_nccl_fusion_threshold_auto_tune(val: bool, iters: int = 10) -> None:
+    """Whether or not measure nccl all reduce at startup to pick the fusion threshold
+
+    Args:
+        val (bool): True or False
+        iters (int): number of all reduce measured for each size
+    """
+    return enable_if.unique([nccl_fusion_threshold_auto_tune, do_nothing])(val, iters)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_fusion_threshold_auto_tune(val, iters):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    assert type(iters) is int
+    sess.config_proto.resource.collective_boxing_conf.nccl_fusion_threshold_auto_tune = val
+    sess.config_proto.resource.collective_boxing_conf.nccl_fusion_auto_tune_iters = iters
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("This action donot working because session is initialized.", file=sys.stderr)
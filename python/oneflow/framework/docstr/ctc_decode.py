@@ -54,3 +54,62 @@ add_docstr(
 
     """,
 )
+
+add_docstr(
+    oneflow._C.fused_decode_step,
+    r"""
+    fused_decode_step(logits, scores, finished, lengths, *, mode="sample", temperature=1.0, top_k=0, top_p=1.0, length_penalty=1.0, eos_token_id=-1, pad_token_id=0, generator=None) -> (Tensor, Tensor, Tensor, Tensor, Tensor)
+
+    Performs one step of autoregressive decoding on the device, from the logits of the last
+    position to the next tokens and the new state of the beams, so the host only has to read
+    the tokens back.
+
+    With ``mode="sample"``, every beam draws its token from the softmax of
+    ``logits / temperature``, restricted to the :attr:`top_k` most likely tokens when
+    :attr:`top_k` is positive and to the most likely tokens holding :attr:`top_p` of the
+    probability. With ``mode="beam"``, every batch keeps the ``num_beams`` best continuations of
+    its beams ranked by :math:`score / length^{length\_penalty}`. A finished beam emits
+    :attr:`pad_token_id` and keeps its score and length, and a beam finishes on
+    :attr:`eos_token_id`.
+
+    Args:
+        logits (Tensor): The logits of shape :math:`(batch\_size, num\_beams, vocab\_size)`
+        scores (Tensor): The float32 sums of the log probabilities of the beams of shape
+            :math:`(batch\_size, num\_beams)`. In beam mode, all but the first beam of a batch
+            should start at ``-inf``.
+        finished (Tensor): The bool finished states of the beams
+        lengths (Tensor): The int32 numbers of tokens generated by the beams
+        mode (str, optional): ``"sample"`` or ``"beam"``. Default: ``"sample"``
+        temperature (float, optional): Divides the logits. Default: ``1.0``
+        top_k (int, optional): Keeps the ``top_k`` most likely tokens if positive. Default: ``0``
+        top_p (float, optional): Keeps the most likely tokens holding ``top_p`` of the
+            probability. Default: ``1.0``
+        length_penalty (float, optional): The exponent of the length normalizing the scores
+            of beam search. Default: ``1.0``
+        eos_token_id (int, optional): The token finishing a beam. Default: ``-1``
+        pad_token_id (int, optional): The token emitted by finished beams. Default: ``0``
+        generator (Generator, optional): The generator of the samples. Default: ``None``
+
+    Returns:
+        next_tokens, scores, finished, lengths and parent_beams, all of shape
+        :math:`(batch\_size, num\_beams)`. parent_beams gives the beam every new beam continues,
+        to reorder the key/value cache with :meth:`oneflow.nn.PagedKVCache.reorder_beams`.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> import oneflow.nn.functional as F
+
+        >>> logits = flow.tensor([[[2.0, 1.0, 0.0], [0.0, 0.0, 0.0]]])
+        >>> scores = flow.tensor([[0.0, -float("inf")]])
+        >>> finished = flow.zeros(1, 2, dtype=flow.bool)
+        >>> lengths = flow.zeros(1, 2, dtype=flow.int32)
+        >>> outs = F.fused_decode_step(logits, scores, finished, lengths, mode="beam")
+        >>> outs[0]
+        tensor([[0, 1]], dtype=oneflow.int64)
+        >>> outs[4]
+        tensor([[0, 0]], dtype=oneflow.int32)
+    """,
+)
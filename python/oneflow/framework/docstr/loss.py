@@ -77,3 +77,44 @@ add_docstr(
     
     """,
 )
+
+add_docstr(
+    oneflow._C.fused_linear_cross_entropy,
+    r"""
+    fused_linear_cross_entropy(x, weight, label, *, ignore_index=-100, chunk_size=4096) -> Tensor
+
+    Computes ``cross_entropy(linear(x, weight), label, reduction="none")`` without
+    materializing the logits. The classes are visited ``chunk_size`` at a time: the forward
+    keeps a running max and sum of exponentials per row and the backward recomputes the logits
+    of every chunk, so the extra memory is :math:`N \times chunk\_size` instead of
+    :math:`N \times num\_classes`.
+
+    When :attr:`weight` is split along the classes over several devices, every device only
+    reduces its own classes and the loss is gathered as a partial sum.
+
+    Args:
+        x (Tensor): The hidden states of shape :math:`(*, hidden\_size)`
+        weight (Tensor): The classifier of shape :math:`(num\_classes, hidden\_size)`
+        label (Tensor): The target classes of shape :math:`(*)`
+        ignore_index (int, optional): Rows of this label get a zero loss and gradient.
+            Default: ``-100``
+        chunk_size (int, optional): The number of classes the logits are computed for at a
+            time. Default: ``4096``
+
+    Returns:
+        Tensor of the shape of :attr:`label`.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> import oneflow.nn.functional as F
+
+        >>> x = flow.ones(2, 3)
+        >>> weight = flow.zeros(4, 3)
+        >>> label = flow.tensor([0, 3])
+        >>> F.fused_linear_cross_entropy(x, weight, label)
+        tensor([1.3863, 1.3863], dtype=oneflow.float32)
+    """,
+)
@@ -37,3 +37,36 @@ add_docstr(
         Tensor: int64 tensor with the indices of the elements that have been kept by NMS, sorted in decreasing order of scores
     """,
 )
+
+add_docstr(
+    oneflow.batched_nms,
+    """
+    batched_nms(boxes, scores, *, iou_threshold, score_threshold=0.0, pre_nms_top_n=-1, max_output_per_image=100) -> Tuple[Tensor, Tensor, Tensor, Tensor, Tensor]
+
+    Performs non-maximum suppression (NMS) for every class of every image of a batch at
+    once, on the device and without synchronizing with the host.
+
+    The boxes of every (image, class) pair scoring above ``score_threshold`` are sorted by
+    score, the first ``pre_nms_top_n`` of them are suppressed independently of the other
+    classes, and the kept boxes of all the classes of an image are sorted by score again,
+    of which the first ``max_output_per_image`` are returned.
+
+    Args:
+        boxes (Tensor[B, N, 4] or Tensor[B, C, N, 4]): boxes in ``(x1, y1, x2, y2)`` format,
+            either shared by all the classes or given per class
+        scores (Tensor[B, C, N]): the score of every box for every class
+        iou_threshold (float): discards all overlapping boxes with IoU > iou_threshold
+        score_threshold (float): discards all boxes with a score <= score_threshold
+        pre_nms_top_n (int): the number of best scoring boxes of every class that take part
+            in the suppression, all of them if it is not positive
+        max_output_per_image (int): the number of detections returned for every image
+
+    Returns:
+        A tuple of ``out_boxes`` (Tensor[B, max_output_per_image, 4]), ``out_scores``
+        (Tensor[B, max_output_per_image]), ``out_classes`` and ``out_indices``
+        (int64 Tensor[B, max_output_per_image]), the class and the box index of every
+        detection, and ``num_detections`` (int32 Tensor[B]). The detections of an image are
+        sorted in decreasing order of scores and the entries past ``num_detections`` are
+        padded with zeros and class and index -1.
+    """,
+)
@@ -250,10 +250,24 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_best_fit")
+def policy_best_fit(func_desc):
+    """A static memory allocation policy called: best_fit
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_best_fit_algo"
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     """Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_best_fit_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -265,6 +279,7 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_best_fit_algo",
     ]
 
 
@@ -641,6 +656,20 @@ def set_qat_symmetric(func_desc, value: str):
     func_desc.job_config_proto.mutable_qat_config().set_target_backend(value)
 
 
+@oneflow_function_config("qat.calibration")
+def set_qat_calibration(func_desc, value=True):
+    """If true, the observers of an inference job update the scales for post-training
+    quantization.
+    """
+    func_desc.job_config_proto.mutable_qat_config().set_calibration(value)
+
+
+@oneflow_function_config("qat.int8_inference")
+def set_qat_int8_inference(func_desc, value=True):
+    """If true, the fake quantized matmuls of an inference job run in int8."""
+    func_desc.job_config_proto.mutable_qat_config().set_int8_inference(value)
+
+
 @oneflow_function_config("enable_auto_mixed_precision")
 def set_enable_auto_mixed_precision(func_desc, value=True):
     """If true, then job will use mixed precision mode, it means use both float16 and float32 during model training.
@@ -842,6 +871,34 @@ def set_tensorrt_int8_calibration(func_desc, value):
     )
 
 
+@oneflow_function_config("tensorrt.engine_cache_dir")
+def set_tensorrt_engine_cache_dir(func_desc, value):
+    """Set up the directory to persist built tensorrt engines in and to load them from
+
+    Args:
+        func_desc ([type]): [description]
+        value (str): directory shared by the processes running the same job
+    """
+    set_use_tensorrt(func_desc, True)
+    func_desc.job_config_proto.mutable_xrt_config().mutable_tensorrt_config().set_engine_cache_dir(
+        value
+    )
+
+
+@oneflow_function_config("tensorrt.dynamic_axes")
+def set_tensorrt_dynamic_axes(func_desc, value):
+    """Set up the axes of the tensorrt engine inputs that one engine covers a range of
+
+    Args:
+        func_desc ([type]): [description]
+        value (str): comma separated axis:min:opt:max, e.g. "0:1:16:64,1:8:128:512"
+    """
+    set_use_tensorrt(func_desc, True)
+    func_desc.job_config_proto.mutable_xrt_config().mutable_tensorrt_config().set_dynamic_axes(
+        value
+    )
+
+
 @oneflow_function_config("default_logical_view")
 def set_default_distribute_strategy(func_desc, value):
     """Set up default distribute strategy for job
@@ -13,6 +13,8 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import json
+
 import oneflow._oneflow_internal
 
 
@@ -30,3 +32,131 @@ def ProfilerStart():
 
 def ProfilerStop():
     oneflow._oneflow_internal.profiler.ProfilerStop()
+
+
+def EnableInstructionTrace():
+    oneflow._oneflow_internal.profiler.EnableInstructionTrace()
+
+
+def DisableInstructionTrace():
+    oneflow._oneflow_internal.profiler.DisableInstructionTrace()
+
+
+def ResetInstructionTrace():
+    oneflow._oneflow_internal.profiler.ResetInstructionTrace()
+
+
+def GetInstructionLatencySummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetInstructionLatencySummary())
+
+
+def DumpInstructionChromeTrace(path):
+    oneflow._oneflow_internal.profiler.DumpInstructionChromeTrace(path)
+
+
+def EnableCollectiveTrace():
+    oneflow._oneflow_internal.profiler.EnableCollectiveTrace()
+
+
+def DisableCollectiveTrace():
+    oneflow._oneflow_internal.profiler.DisableCollectiveTrace()
+
+
+def ResetCollectiveTrace():
+    oneflow._oneflow_internal.profiler.ResetCollectiveTrace()
+
+
+def GetCollectiveSummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetCollectiveSummary())
+
+
+def DumpCollectiveChromeTrace(path):
+    oneflow._oneflow_internal.profiler.DumpCollectiveChromeTrace(path)
+
+
+def EnableKernelMetrics():
+    oneflow._oneflow_internal.profiler.EnableKernelMetrics()
+
+
+def DisableKernelMetrics():
+    oneflow._oneflow_internal.profiler.DisableKernelMetrics()
+
+
+def ResetKernelMetrics():
+    oneflow._oneflow_internal.profiler.ResetKernelMetrics()
+
+
+def GetKernelMetricsSummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetKernelMetricsSummary())
+
+
+def ResetDataReaderMetrics():
+    oneflow._oneflow_internal.profiler.ResetDataReaderMetrics()
+
+
+def GetDataReaderMetricsSummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetDataReaderMetricsSummary())
+
+
+def ResetCheckpointIOMetrics():
+    oneflow._oneflow_internal.profiler.ResetCheckpointIOMetrics()
+
+
+def GetCheckpointIOMetricsSummary():
+    return json.loads(
+        oneflow._oneflow_internal.profiler.GetCheckpointIOMetricsSummary()
+    )
+
+
+def ResetManagedMemoryMetrics():
+    oneflow._oneflow_internal.profiler.ResetManagedMemoryMetrics()
+
+
+def GetManagedMemoryMetricsSummary():
+    return json.loads(
+        oneflow._oneflow_internal.profiler.GetManagedMemoryMetricsSummary()
+    )
+
+
+def EnableEventTrace():
+    oneflow._oneflow_internal.profiler.EnableEventTrace()
+
+
+def DisableEventTrace():
+    oneflow._oneflow_internal.profiler.DisableEventTrace()
+
+
+def ResetEventTrace():
+    oneflow._oneflow_internal.profiler.ResetEventTrace()
+
+
+def GetEventTraceOpSummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetEventTraceOpSummary())
+
+
+def GetEventTraceKernelSummary():
+    return json.loads(oneflow._oneflow_internal.profiler.GetEventTraceKernelSummary())
+
+
+def DumpEventTraceChromeTrace(path):
+    oneflow._oneflow_internal.profiler.DumpEventTraceChromeTrace(path)
+
+
+def EnableMemoryTrace(record_stack=False):
+    oneflow._oneflow_internal.profiler.EnableMemoryTrace(record_stack)
+
+
+def DisableMemoryTrace():
+    oneflow._oneflow_internal.profiler.DisableMemoryTrace()
+
+
+def ResetMemoryTrace():
+    oneflow._oneflow_internal.profiler.ResetMemoryTrace()
+
+
+def GetMemorySnapshot(at_peak=False):
+    return json.loads(oneflow._oneflow_internal.profiler.GetMemorySnapshot(at_peak))
+
+
+def DumpMemoryTimelineChromeTrace(path):
+    oneflow._oneflow_internal.profiler.DumpMemoryTimelineChromeTrace(path)
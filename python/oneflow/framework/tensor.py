@@ -617,6 +617,58 @@ def _relu(self, inplace=False):
     return flow.relu(self, inplace=inplace)
 
 
+def _relu_inplace(self):
+    return flow.relu(self, inplace=True)
+
+
+def _abs_inplace(self):
+    return flow._C.abs_(self)
+
+
+def _ceil_inplace(self):
+    return flow._C.ceil_(self)
+
+
+def _round_inplace(self):
+    return flow._C.round_(self)
+
+
+def _exp_inplace(self):
+    return flow._C.exp_(self)
+
+
+def _log_inplace(self):
+    return flow._C.log_(self)
+
+
+def _neg_inplace(self):
+    return flow._C.negative_(self)
+
+
+def _reciprocal_inplace(self):
+    return flow._C.reciprocal_(self)
+
+
+def _rsqrt_inplace(self):
+    return flow._C.rsqrt_(self)
+
+
+def _sigmoid_inplace(self):
+    return flow._C.sigmoid_(self)
+
+
+def _sqrt_inplace(self):
+    return flow._C.sqrt_(self)
+
+
+def _square_inplace(self):
+    return flow._C.square_(self)
+
+
+def _tanh_inplace(self):
+    return flow._C.tanh_(self)
+
+
 def _softmax(self, dim=None):
     return flow.softmax(self, dim=dim)
 
@@ -975,6 +1027,16 @@ def _numpy(self):
     return self.to_numpy()
 
 
+def _dlpack(self, stream=None):
+    return flow.utils.dlpack.to_dlpack(self, stream)
+
+
+def _dlpack_device(self):
+    if self.is_cuda:
+        return (flow.utils.dlpack._kDLCUDA, self.device.index)
+    return (flow.utils.dlpack._kDLCPU, 0)
+
+
 def _zero_(self):
     return self.zeros_()
 
@@ -1000,6 +1062,8 @@ def RegisterMethods():
     Tensor.__matmul__ = lambda self, other: self.matmul(other)
     Tensor.ndim = property(_ndim)
     Tensor.numpy = _numpy
+    Tensor.__dlpack__ = _dlpack
+    Tensor.__dlpack_device__ = _dlpack_device
     Tensor.size = _size
     Tensor.dim = _ndim
     Tensor.ndimension = _ndim
@@ -1192,6 +1256,19 @@ def RegisterMethods():
     Tensor.prod = _prod
     Tensor.sin = _sin
     Tensor.sin_ = _sin_inplace
+    Tensor.relu_ = _relu_inplace
+    Tensor.abs_ = _abs_inplace
+    Tensor.ceil_ = _ceil_inplace
+    Tensor.round_ = _round_inplace
+    Tensor.exp_ = _exp_inplace
+    Tensor.log_ = _log_inplace
+    Tensor.neg_ = _neg_inplace
+    Tensor.reciprocal_ = _reciprocal_inplace
+    Tensor.rsqrt_ = _rsqrt_inplace
+    Tensor.sigmoid_ = _sigmoid_inplace
+    Tensor.sqrt_ = _sqrt_inplace
+    Tensor.square_ = _square_inplace
+    Tensor.tanh_ = _tanh_inplace
     Tensor.zero_ = _zero_
     Tensor.is_consistent = _is_consistent
     Tensor.to_consistent = _to_consistent
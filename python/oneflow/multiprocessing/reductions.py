@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import os
 from multiprocessing.reduction import ForkingPickler
 
 import numpy as np
@@ -20,7 +21,6 @@ import numpy as np
 import oneflow as flow
 from oneflow.nn.parameter import Parameter
 from oneflow.framework.tensor import Tensor
-from oneflow.multiprocessing import shared_memory
 
 
 try:
@@ -40,73 +40,81 @@ def rebuild_empty_tensor(shape, dtype, requires_grad):
     return t.reshape(*shape)
 
 
-def rebuild_shm_tensor(shm, shape, dtype, requires_grad):
-    def delete_shm():
-        shm.close()
-        try:
-            shm.unlink()
-        except:
-            pass
+def _use_cuda_ipc():
+    return os.getenv("ONEFLOW_MULTIPROCESSING_CUDA_IPC", "1") == "1"
+
 
-    arr = np.ndarray(shape, dtype=dtype, buffer=shm.buf)
+def rebuild_pooled_shm_tensor(name, shape, dtype, requires_grad):
+    internal = flow._oneflow_internal.multiprocessing
+    shm = internal.open_pooled_shared_memory(name)
+
+    def release_shm():
+        # Gives the segment back to the sender, which hands it out again.
+        internal.release_pooled_shared_memory(shm)
+
+    arr = np.ndarray(
+        shape,
+        dtype=dtype,
+        buffer=shm.buf,
+        offset=internal.pooled_shared_memory_header_size,
+    )
     t = flow.from_numpy(arr)
-    t._register_storage_delete_hook(delete_shm)
+    t._register_storage_delete_hook(release_shm)
     t.requires_grad = requires_grad
-
     return t
 
 
-def rebuild_empty_parameter(shape, dtype, requires_grad):
-    t = flow.tensor([], dtype=dtype)
-    t = t.reshape(*shape)
-    return Parameter(t, requires_grad=requires_grad)
-
+def rebuild_cuda_ipc_tensor(ipc_desc, shape, dtype, requires_grad):
+    t = flow._oneflow_internal.multiprocessing.rebuild_cuda_tensor(
+        *ipc_desc, list(shape), dtype
+    )
+    t.requires_grad = requires_grad
+    return t
 
-def rebuild_shm_parameter(shm, shape, dtype, requires_grad):
-    def delete_shm():
-        shm.close()
-        shm.unlink()
 
-    arr = np.ndarray(shape, dtype=dtype, buffer=shm.buf)
-    t = flow.from_numpy(arr)
-    t._register_storage_delete_hook(delete_shm)
-    return Parameter(t, requires_grad=requires_grad)
+def rebuild_parameter(rebuild_tensor, args, requires_grad):
+    return Parameter(rebuild_tensor(*args), requires_grad=requires_grad)
 
 
-def reduce_tensor(tensor):
+def _reduce_tensor_data(tensor):
+    if tensor.is_cuda and tensor.is_contiguous() and _use_cuda_ipc():
+        try:
+            ipc_desc = flow._oneflow_internal.multiprocessing.share_cuda_tensor(tensor)
+            return (
+                rebuild_cuda_ipc_tensor,
+                (ipc_desc, tuple(tensor.shape), tensor.dtype, False),
+            )
+        except Exception:
+            # Built without CUDA, or all the IPC blocks are in flight.
+            pass
     tensor_data = tensor.numpy()
-    requires_grad = tensor.requires_grad
-
     if tensor_data.nbytes == 0:
-        return (rebuild_empty_tensor, (tensor.shape, tensor.dtype, requires_grad))
-    else:
-        shm = shared_memory.SharedMemory(create=True, size=tensor_data.nbytes)
-        shm_numpy = np.ndarray(
-            tensor_data.shape, dtype=tensor_data.dtype, buffer=shm.buf
-        )
-        shm_numpy[:] = tensor_data[:]
-        return (
-            rebuild_shm_tensor,
-            (shm, tensor_data.shape, tensor_data.dtype, requires_grad),
-        )
+        return (rebuild_empty_tensor, (tensor.shape, tensor.dtype, False))
+    internal = flow._oneflow_internal.multiprocessing
+    shm = internal.acquire_pooled_shared_memory(tensor_data.nbytes)
+    shm_numpy = np.ndarray(
+        tensor_data.shape,
+        dtype=tensor_data.dtype,
+        buffer=shm.buf,
+        offset=internal.pooled_shared_memory_header_size,
+    )
+    shm_numpy[:] = tensor_data[:]
+    return (
+        rebuild_pooled_shm_tensor,
+        (shm.name, tensor_data.shape, tensor_data.dtype, False),
+    )
 
 
-def reduce_parameter(tensor):
-    tensor_data = tensor.numpy()
-    requires_grad = tensor.requires_grad
+def reduce_tensor(tensor):
+    rebuild_tensor, args = _reduce_tensor_data(tensor)
+    return (rebuild_tensor, args[:-1] + (tensor.requires_grad,))
 
-    if tensor_data.nbytes == 0:
-        return (rebuild_empty_parameter, (tensor, shape, tensor.dtype, requires_grad))
-    else:
-        shm = shared_memory.SharedMemory(create=True, size=tensor_data.nbytes)
-        shm_numpy = np.ndarray(
-            tensor_data.shape, dtype=tensor_data.dtype, buffer=shm.buf
-        )
-        shm_numpy[:] = tensor_data[:]
-        return (
-            rebuild_shm_parameter,
-            (shm, tensor_data.shape, tensor_data.dtype, requires_grad),
-        )
+
+def reduce_parameter(tensor):
+    return (
+        rebuild_parameter,
+        _reduce_tensor_data(tensor) + (tensor.requires_grad,),
+    )
 
 
 def init_reductions():
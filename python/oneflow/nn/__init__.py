@@ -47,6 +47,7 @@ from oneflow.nn.modules.batchnorm_fused import (
     FusedBatchNorm3d,
 )
 from oneflow.nn.modules.fused_mlp import FusedMLP
+from oneflow.nn.modules.paged_kv_cache import PagedKVCache
 
 from oneflow.nn.modules.container import (
     ModuleDict,
@@ -69,6 +70,7 @@ from oneflow.nn.modules.moving_average_min_max_observer import (
 )
 from oneflow.nn.modules.fake_quantization import FakeQuantization
 from oneflow.nn.modules.quantization import Quantization
+from oneflow.nn.modules.weight_only_quantization import WeightOnlyQuantLinear
 from oneflow.nn.modules.distributed_partial_fc_sample import (
     DistributedPariticalFCSample,
 )
@@ -56,8 +56,10 @@ from oneflow._C import pad
 from oneflow._C import upsample
 from oneflow._C import triplet_margin_loss
 from oneflow._C import ctc_greedy_decoder
+from oneflow._C import fused_decode_step
 from oneflow._C import one_hot
+from oneflow._C import fused_linear_cross_entropy
 from oneflow._C import normalize
-from oneflow.nn.modules.sparse import embedding
+from oneflow.nn.modules.sparse import embedding, embedding_bag
 from oneflow.nn.modules.linear import linear
 from oneflow.nn.modules.activation import relu6
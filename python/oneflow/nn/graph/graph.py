@@ -15,6 +15,7 @@ limitations under the License.
 """
 import os
 import time
+import weakref
 from collections import OrderedDict
 from functools import partial
 from typing import Dict, Optional, Union, List
@@ -115,6 +116,8 @@ class Graph(object):
         self._variables_conf = OrderedDict()
         self._additional_variable_tobe_loaded = OrderedDict()
         self._is_compiled = False
+        # Folded variables need recomputing after module states are loaded
+        self._folded_variables_stale = False
         # Default is local view
         self._is_global_view = False
         # forward graph job proto
@@ -207,6 +210,10 @@ class Graph(object):
             ):
                 self._compile(*args, **kwargs)
 
+        if self._folded_variables_stale:
+            self._c_nn_graph.update_folded_variables()
+            self._folded_variables_stale = False
+
         return self.__run(*args, **kwargs)
 
     def add_optimizer(
@@ -696,8 +703,28 @@ class Graph(object):
         self._is_compiled = True
         # After compile, _additional_variable_tobe_loaded is useless.
         self._additional_variable_tobe_loaded.clear()
+        if self.config.proto.enable_inference_graph_optimization():
+            self.__mark_folded_variables_stale_on_load()
         return eager_outputs
 
+    def __mark_folded_variables_stale_on_load(self):
+        # The variables folded from parameters and buffers are computed once after
+        # compiling, so loading a state dict into a module of the graph marks them for
+        # recomputing before the next run.
+        graph_ref = weakref.ref(self)
+
+        def mark_stale(*args):
+            graph = graph_ref()
+            if graph is not None:
+                graph._folded_variables_stale = True
+
+        for block in self._blocks.values():
+            if not isinstance(block.origin, Module):
+                continue
+            for module in block.origin.modules():
+                hooks = module._load_state_dict_pre_hooks
+                hooks[len(hooks)] = mark_stale
+
     def __build_graph(self, *args, **kwargs):
         session = session_ctx.GetDefaultSession()
         assert type(session) is MultiClientSession
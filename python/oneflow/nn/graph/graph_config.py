@@ -18,6 +18,8 @@ import os
 from collections import OrderedDict
 
 from oneflow.nn.graph.optimizer import OptDict
+import oneflow._oneflow_internal
+import oneflow._oneflow_internal.oneflow.core.common.data_type as data_type_cfg
 import oneflow._oneflow_internal.oneflow.core.job.job_conf as job_conf_cfg
 
 
@@ -61,9 +63,13 @@ class GraphConfig(object):
         """
         self._outputs_buffer_size = value
 
-    def enable_amp(self, mode: bool = True):
+    def enable_amp(self, mode: bool = True, dtype=None):
         r"""If set to true, then graph will use mixed precision mode, it means use both float16 and float32 during model training.
 
+        With ``dtype=flow.bfloat16`` the low precision type is bfloat16, which has the
+        range of float32, so no ``GradScaler`` is needed. It requires CUDA 11 or later.
+        The variables and the optimizer stay in float32 either way.
+
         For example:
 
         .. code-block:: python
@@ -82,9 +88,118 @@ class GraphConfig(object):
 
         Args:
             mode (bool, optional): The default vaule is True.
+            dtype (flow.dtype, optional): flow.float16 or flow.bfloat16. The default
+                value is flow.float16.
         """
         assert type(mode) is bool
         self.proto.set_enable_auto_mixed_precision(mode)
+        if dtype is not None:
+            self.proto.set_mixed_precision_data_type(
+                data_type_cfg.DataType(
+                    oneflow._oneflow_internal.deprecated.GetProtoDtype4OfDtype(dtype)
+                )
+            )
+
+    def set_amp_list_overrides(self, white_list=(), black_list=()):
+        r"""Move op types of mixed precision mode into the white list, whose ops always
+        run in low precision, or the black list, whose ops always run in float32,
+        from whichever list they are in by default. It is useful to keep an op without a
+        bfloat16 kernel out of the low precision part of the graph.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(3, 8, False)
+                    self.config.enable_amp(True, dtype=flow.bfloat16)
+                    self.config.set_amp_list_overrides(black_list=["softmax"])
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            white_list (list of str, optional): Op types to run in low precision.
+            black_list (list of str, optional): Op types to run in float32.
+        """
+        self.proto.clear_amp_white_list_override()
+        for op_type in white_list:
+            self.proto.add_amp_white_list_override(op_type)
+        self.proto.clear_amp_black_list_override()
+        for op_type in black_list:
+            self.proto.add_amp_black_list_override(op_type)
+
+    def enable_fp8_matmul(self, mode: bool = True, amax_history_len: int = 16):
+        r"""If set to true, the forward pass of 2D matmuls on GPUs runs in fp8 (E4M3) with
+        delayed scaling: each input is scaled by the largest absolute value it had over
+        the last amax_history_len steps, which is kept as a variable. It needs CUDA 11.8
+        and a Hopper GPU, and applies to matmuls whose reduced and output dimensions are
+        multiples of 16. The backward pass keeps the data type of the forward pass.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(64, 128, False)
+                    self.config.enable_amp(True, dtype=flow.bfloat16)
+                    self.config.enable_fp8_matmul(True)
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default value is True.
+            amax_history_len (int, optional): The number of steps the scales are derived
+                from. The default value is 16.
+        """
+        assert type(mode) is bool
+        assert amax_history_len > 0
+        self.proto.set_enable_fp8_matmul(mode)
+        self.proto.set_fp8_amax_history_len(amax_history_len)
+
+    def set_num_compute_streams(self, value: int = 1):
+        r"""Set the number of compute streams of each GPU. With more than one, the
+        independent branches of the graph whose outputs are small, like the towers of a
+        multi-tower model or the experts of an MoE layer, run on different streams so
+        that their kernels overlap. Ops with outputs of more than 8MB per device stay on
+        the default stream, which can be changed with the environment variable
+        ONEFLOW_MULTI_COMPUTE_STREAM_MAX_OUTPUT_MBYTE. It has no effect when nccl runs on
+        the compute stream.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.towers = flow.nn.ModuleList(
+                        [flow.nn.Linear(64, 64) for _ in range(4)]
+                    )
+                    self.config.set_num_compute_streams(4)
+                def build(self, x):
+                    return sum(tower(x) for tower in self.towers)
+
+            graph = Graph()
+
+        Args:
+            value (int, optional): The default value is 1.
+        """
+        assert value >= 1
+        self.proto.set_num_compute_streams(value)
 
     def allow_fuse_model_update_ops(self, mode: bool = True):
         r"""If set to true, try to fuse cast + scale + l1_l2_regularize_gradient + model_update to one op to improve performance.
@@ -163,6 +278,377 @@ class GraphConfig(object):
         """
         self.proto.set_enable_fuse_cast_scale(mode)
 
+    def allow_fuse_elementwise_chain(self, mode: bool = True):
+        r"""If set to true, fuse chains of float element-wise ops, such as scalar_mul, scalar_add
+        and the activations, into one kernel per chain.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.config.allow_fuse_elementwise_chain(True)
+                def build(self, x):
+                    return flow.nn.functional.silu(x * 2.0 + 1.0)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_fuse_elementwise_chain(mode)
+
+    def allow_fuse_matmul_bias_activation(self, mode: bool = True):
+        r"""If set to true, fuse matmul, the following bias_add and an optional relu into one
+        cuBLASLt matmul with a bias epilogue on CUDA devices.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(64, 128)
+                    self.config.allow_fuse_matmul_bias_activation(True)
+                def build(self, x):
+                    return flow.relu(self.linear(x))
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_fuse_matmul_bias_activation(mode)
+
+    def allow_fuse_residual_norm(self, mode: bool = True):
+        r"""If set to true, fuse the residual add, an optional bias_add before it, the following
+        layer_norm and an optional gelu or silu into one kernel on CUDA devices. Only graphs
+        for inference are rewritten.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.norm = flow.nn.LayerNorm(768)
+                    self.config.allow_fuse_residual_norm(True)
+                def build(self, x, residual):
+                    return self.norm(x + residual)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_fuse_residual_norm(mode)
+
+    def allow_multi_tensor_model_update(self, mode: bool = True):
+        r"""If set to true, merge the sgd, momentum and adam update ops of parameters that share
+        the same placement, data type and optimizer hyper-parameters into one multi-tensor
+        update op, which updates the whole parameter list with a few kernel launches on CUDA
+        devices instead of one launch per parameter.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(3, 8, False)
+                    self.config.allow_multi_tensor_model_update(True)
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_multi_tensor_model_update(mode)
+
+    def enable_auto_parallel(self, mode: bool = True):
+        r"""If set to true, search the sbp signatures of the operators in the graph by a cost
+        model of computation and boxing, instead of inferring them greedily one by one.
+        The sbp of inputs, variables and explicit ``to_global`` are kept.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(3, 8, False)
+                    self.config.enable_auto_parallel(True)
+                    # Keep the estimated activation memory per device under 4GB.
+                    self.config.set_auto_parallel_memory_budget(4096)
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_auto_parallel(mode)
+
+    def set_auto_parallel_computation_cost_ratio(self, ratio: float):
+        r"""Set the cost of computing one byte relative to transferring one byte by boxing in the
+        auto parallel search. The default value is 0.05.
+
+        Args:
+            ratio (float): the cost ratio.
+        """
+        self.proto.set_auto_parallel_computation_cost_ratio(ratio)
+
+    def set_auto_parallel_memory_budget(self, mbyte: int):
+        r"""Set the estimated memory per device in MB the auto parallel search should keep the
+        outputs of operators under. No budget if it is 0, which is the default.
+
+        Args:
+            mbyte (int): the memory budget in MB.
+        """
+        self.proto.set_auto_parallel_memory_budget_mbyte(mbyte)
+
+    def set_auto_checkpointing_memory_budget(self, mbyte: int):
+        r"""Set the memory per device in MB to fit the training graph into by recomputing the
+        outputs of forward operators in the backward pass, like setting
+        ``config.activation_checkpointing`` of blocks but chosen automatically. The operators
+        with the most memory saved at the estimated peak for the least recomputation are chosen,
+        matmul and convolution operators are never recomputed. Disabled if it is 0, which is the
+        default.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.add_optimizer(optimizer)
+                    self.config.set_auto_checkpointing_memory_budget(8192)
+                def build(self, x):
+                    loss = self.model(x)
+                    loss.backward()
+                    return loss
+
+        Args:
+            mbyte (int): the memory budget in MB.
+        """
+        self.proto.set_auto_checkpointing_memory_budget_mbyte(mbyte)
+
+    def enable_activation_offload(
+        self, mode: bool = True, threshold_mbyte: int = 16, prefetch_distance: int = 8
+    ):
+        r"""If set to true, the forward activations at least ``threshold_mbyte`` per device are
+        copied to host memory after they are produced, and copied back ``prefetch_distance``
+        operators ahead of their first use in the backward pass. The copies run on the copy
+        streams, so the device memory is free while the activations are idle.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.add_optimizer(optimizer)
+                    self.config.enable_activation_offload(True, threshold_mbyte=64)
+                def build(self, x):
+                    loss = self.model(x)
+                    loss.backward()
+                    return loss
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+            threshold_mbyte (int, optional): The minimum size in MB per device of an activation
+                to offload. The default value is 16.
+            prefetch_distance (int, optional): The number of operators to copy an activation
+                back ahead of its first use in the backward pass. The default value is 8.
+        """
+        self.proto.set_enable_activation_offload(mode)
+        self.proto.set_activation_offload_threshold_mbyte(threshold_mbyte)
+        self.proto.set_activation_offload_prefetch_distance(prefetch_distance)
+
+    def enable_sequence_parallel(self, mode: bool = True, axis: int = 0):
+        r"""If set to true, the ops computed independently at each position of the sequence, like
+        layer norm, dropout and the residual add, that follow the all-reduce of a tensor parallel
+        block run on a slice of the sequence on each rank. The all-reduce becomes a reduce-scatter
+        before them and an all-gather before the next block, which keeps the communication
+        volume and divides the memory of their activations by the tensor parallel degree.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.add_optimizer(optimizer)
+                    self.config.enable_sequence_parallel(True, axis=0)
+                def build(self, x):
+                    loss = self.model(x)
+                    loss.backward()
+                    return loss
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+            axis (int, optional): The sequence axis of the activations. Only axis 0 uses the
+                NCCL logical ops, other axes go through the general boxing. The default value is 0.
+        """
+        self.proto.set_enable_sequence_parallel(mode)
+        self.proto.set_sequence_parallel_axis(axis)
+
+    def enable_tensor_parallel_comm_overlap(
+        self, mode: bool = True, max_num_chunks: int = 4, min_chunk_mbyte: int = 4
+    ):
+        r"""If set to true, the matmuls the partial sum output of which is all-reduced, like the
+        row parallel linear layers of tensor parallel blocks, are split into chunks along the
+        first axis, so the all-reduce of each chunk overlaps the matmul of the next one.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.config.enable_tensor_parallel_comm_overlap(True, max_num_chunks=4)
+                def build(self, x):
+                    return self.model(x)
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+            max_num_chunks (int, optional): The maximum number of chunks of a matmul. The default
+                value is 4.
+            min_chunk_mbyte (int, optional): The minimum size in MB of the all-reduce of a
+                chunk, fewer chunks are used for smaller outputs. The default value is 4.
+        """
+        self.proto.set_enable_tensor_parallel_comm_overlap(mode)
+        self.proto.set_tensor_parallel_comm_overlap_max_num_chunks(max_num_chunks)
+        self.proto.set_tensor_parallel_comm_overlap_min_chunk_mbyte(min_chunk_mbyte)
+
+    def enable_comm_aware_nccl_order(self, mode: bool = True):
+        r"""If set to true, the ops between which NCCL logical ops are inserted are ordered by
+        the longest path of estimated compute and communication to the end of their subgraph,
+        instead of the topological order of the model code. The collectives on the critical path
+        are then issued as early as their inputs allow, to overlap the compute after them.
+
+        The estimated exposed communication before and after the reordering is logged at VLOG(1).
+        It takes effect with ``flow.boxing.nccl.enable_use_compute_stream(True)``.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.add_optimizer(optimizer)
+                    self.config.enable_comm_aware_nccl_order(True)
+                def build(self, x):
+                    loss = self.model(x)
+                    loss.backward()
+                    return loss
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_nccl_logical_op_comm_aware_order(mode)
+
+    def enable_inference_graph_optimization(self, mode: bool = True):
+        r"""If set to true, the job of a graph without optimizer is optimized for inference:
+
+        - identity ops are removed;
+        - batch norms in eval mode are folded into the weights of the convs and matmuls before them;
+        - the ops that only depend on parameters, buffers and constants are folded into new
+          variables, which are computed once after the graph is compiled;
+        - the ops computing the same thing are merged and the unused ops are pruned.
+
+        The folded variables are recomputed before the next call after ``load_state_dict`` of a
+        module in the graph. Other in place changes of the parameters after the graph is
+        compiled, like ``param.copy_(...)``, are not seen by the folded variables.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.config.enable_inference_graph_optimization(True)
+                def build(self, x):
+                    return self.model(x)
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_inference_graph_optimization(mode)
+
+    def enable_channels_last(self, mode: bool = True):
+        r"""If set to true, the 4-D convs, poolings, batch norms and the elementwise ops
+        between them on GPUs are converted to the channels last (NHWC) layout, in which cudnn
+        runs half convs on tensor cores without transposing their inputs and outputs.
+
+        The connected ops are converted together as a region, and the tensors entering and
+        leaving a region are transposed. A region is only converted when the transposes saved
+        in its convs outweigh the inserted ones, which usually needs AMP and channel counts
+        divisible by 8. The inputs and outputs of the graph keep their layout.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.model = model
+                    self.config.enable_amp(True)
+                    self.config.enable_channels_last(True)
+                def build(self, x):
+                    return self.model(x)
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.set_enable_channels_last(mode)
+
     def set_gradient_accumulation_steps(self, value):
         r"""Set num of steps to accumulate gradient.
 
@@ -188,6 +674,43 @@ class GraphConfig(object):
         """
         self.proto.set_num_gradient_accumulation_steps(value)
 
+    def set_pipeline_schedule(self, schedule: str = "1f1b"):
+        r"""Set the schedule of pipelining parallelism.
+
+        "1f1b" lets each stage keep the activations of at most as many micro-batches as the
+        number of stages from it to the last stage, which bounds the activation memory
+        without growing the bubble. "interleaved" keeps modules of different stage ids but
+        the same placement as virtual stages on the same devices instead of merging them, which
+        shortens the bubble by the number of virtual stages per device. The expected bubble
+        ratio is logged at compile time, set the environment variable
+        ONEFLOW_PROFILE_PIPELINE_BUBBLE to log the realised one of each step.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.m_stage0 = ...
+                    self.m_stage1 = ...
+                    self.m_stage0.config.stage_id = 0
+                    self.m_stage1.config.stage_id = 1
+                    self.config.set_gradient_accumulation_steps(8)
+                    self.config.set_pipeline_schedule("1f1b")
+                def build(self, x):
+                    return self.m_stage1(self.m_stage0(x))
+
+            graph = Graph()
+
+        Args:
+            schedule (str): "1f1b" or "interleaved".
+        """
+        assert schedule in ("1f1b", "interleaved")
+        self.proto.set_pipeline_schedule(schedule)
+
     def set_zero_redundancy_optimizer_mode(self, mode: str = "distributed_split"):
         r"""Set mode to remove redundancy of optimizer states.
         This optimzation will reduce optimizer states memory consumption as described
@@ -244,6 +767,47 @@ class GraphConfig(object):
         assert value >= 1
         self.proto.set_optimizer_placement_optimization_threshold(value)
 
+    def set_zero_redundancy_optimizer_stage(self, stage: int = 2, prefetch_distance=4):
+        r"""Set the ZeRO stage of "distributed_split" mode.
+
+        Stage 1 and stage 2 are the same: optimizer states, gradients and parameters are
+        split across devices, the gradients are reduce-scattered and the parameters are
+        gathered once for both the forward and the backward pass. Stage 3 frees the gathered
+        parameters after the forward pass and gathers them again for the backward pass,
+        `prefetch_distance` ops before their first backward use.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(3, 8, False)
+                    self.config.set_zero_redundancy_optimizer_mode("distributed_split")
+                    self.config.set_zero_redundancy_optimizer_stage(3)
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            stage (int): 1, 2 or 3.
+            prefetch_distance (int): number of ops to start gathering a parameter before its
+                first backward use in stage 3.
+        """
+        assert stage in (1, 2, 3)
+        assert isinstance(prefetch_distance, int)
+        assert prefetch_distance >= 1
+        self.proto.set_optimizer_placement_optimization_shard_restore_level(
+            2 if stage == 3 else 1
+        )
+        self.proto.set_optimizer_placement_optimization_prefetch_distance(
+            prefetch_distance
+        )
+
     def enable_xla_jit(self, value=True):
         r"""Whether use xla_jit in xrt or not.
 
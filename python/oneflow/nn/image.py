@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+from oneflow.nn.modules.dataset import ImageAugment as Augment
 from oneflow.nn.modules.dataset import ImageBatchAlign as batch_align
 from oneflow.nn.modules.dataset import ImageDecode as decode
 from oneflow.nn.modules.dataset import ImageFlip as flip
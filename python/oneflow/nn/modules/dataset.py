@@ -52,12 +52,17 @@ class OFRecordReader(Module):
         device: Union[flow.device, str] = None,
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
+        shuffle_mode: str = "instance",
+        start_sample: int = 0,
+        raw_records: bool = False,
         name: Optional[str] = None,
     ):
         super().__init__()
 
         if name is not None:
             print("WARNING: name has been deprecated and has NO effect.\n")
+        if shuffle_mode not in ["instance", "index", "sample"]:
+            raise ValueError("shuffle_mode should be 'instance', 'index' or 'sample'")
         self.ofrecord_dir = ofrecord_dir
         self.batch_size = batch_size
         self.data_part_num = data_part_num
@@ -66,6 +71,11 @@ class OFRecordReader(Module):
         self.random_shuffle = random_shuffle
         self.shuffle_buffer_size = shuffle_buffer_size
         self.shuffle_after_epoch = shuffle_after_epoch
+        self.shuffle_mode = shuffle_mode
+        self.start_sample = start_sample
+        # Outputs the serialized records instead of parsed OFRecords, the OFRecord
+        # decoders read them in place without parsing every feature of every record.
+        self.raw_records = raw_records
 
         self.placement = placement
         if placement is None:
@@ -102,6 +112,9 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                shuffle_mode=self.shuffle_mode,
+                start_sample=self.start_sample,
+                raw_records=self.raw_records,
                 sbp=self.sbp,
                 placement=self.placement,
             )
@@ -117,6 +130,9 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                shuffle_mode=self.shuffle_mode,
+                start_sample=self.start_sample,
+                raw_records=self.raw_records,
                 device=self.device,
             )
         return res
@@ -425,6 +441,8 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
         num_workers: Optional[int] = 3,
         warmup_size: Optional[int] = 6400,
         max_num_pixels: Optional[int] = 67108864,
+        mean: Optional[Sequence[float]] = None,
+        std: Optional[Sequence[float]] = None,
     ):
         super().__init__()
         self.target_width = target_width
@@ -438,6 +456,11 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
         self.num_workers = num_workers
         self.warmup_size = warmup_size
         self.max_num_pixels = max_num_pixels
+        # with mean and std, the output is float and normalized on the decoding device
+        assert (mean is None) == (std is None)
+        self.mean = [] if mean is None else list(mean)
+        self.std = [] if std is None else list(std)
+        assert len(self.mean) in (0, 3) and len(self.std) == len(self.mean)
         gpu_decoder_conf = (
             flow._oneflow_internal.oneflow.core.operator.op_conf.ImageDecoderRandomCropResizeOpConf()
         )
@@ -468,6 +491,8 @@ class OFRecordImageGpuDecoderRandomCropResize(Module):
             num_workers=self.num_workers,
             warmup_size=self.warmup_size,
             max_num_pixels=self.max_num_pixels,
+            mean=self.mean,
+            std=self.std,
         )
         if not res.is_cuda:
             print(
@@ -887,6 +912,96 @@ class ImageBatchAlign(Module):
         )
 
 
+class ImageAugment(Module):
+    r"""Augments a batch of uint8 images on the GPU with a single fused kernel, which applies
+    random resized crop, rotation, horizontal flip, resize, color jitter and normalization.
+
+    Parameters:
+        target_size (Sequence[int]): (height, width) of the output images
+        interpolation_type (str): "nearest", "bilinear" or "bicubic", defaults to "bilinear"
+        random_area (Sequence[float]): range of the crop area relative to the image, defaults to [1.0, 1.0] which keeps the whole image
+        random_aspect_ratio (Sequence[float]): range of the crop aspect ratio, defaults to [1.0, 1.0]
+        flip_prob (float): probability of a horizontal flip, defaults to 0
+        rotate_degrees (float): rotates by a random angle in [-rotate_degrees, rotate_degrees], defaults to 0
+        brightness, contrast, saturation (float): jitter the factor in [max(0, 1 - x), 1 + x], default to 0
+        hue (float): shifts the hue by a random fraction of a turn in [-hue, hue], defaults to 0
+        mean, std (Sequence[float]): normalization of 1 or 3 channels
+        color_space (str): "BGR", "RGB" or "GRAY", defaults to "BGR"
+        output_layout (str): "NCHW" or "NHWC", defaults to "NCHW"
+        random_seed (Optional[int]): the random seed
+
+    The input is a {N, H, W, C} uint8 tensor holding each image in the top left corner of its
+    slot, as produced by nn.image.batch_align. An optional {N, 2} int32 tensor holds the
+    (height, width) of each image, otherwise every image fills its slot.
+    """
+
+    def __init__(
+        self,
+        target_size: Sequence[int],
+        interpolation_type: str = "bilinear",
+        random_area: Sequence[float] = [1.0, 1.0],
+        random_aspect_ratio: Sequence[float] = [1.0, 1.0],
+        flip_prob: float = 0.0,
+        rotate_degrees: float = 0.0,
+        brightness: float = 0.0,
+        contrast: float = 0.0,
+        saturation: float = 0.0,
+        hue: float = 0.0,
+        mean: Sequence[float] = [0.0],
+        std: Sequence[float] = [1.0],
+        color_space: str = "BGR",
+        output_layout: str = "NCHW",
+        random_seed: Optional[int] = None,
+    ):
+        super().__init__()
+        assert len(target_size) == 2
+        self.target_size = target_size
+        self.interpolation_type = interpolation_type
+        self.random_area = random_area
+        self.random_aspect_ratio = random_aspect_ratio
+        self.flip_prob = flip_prob
+        self.rotate_degrees = rotate_degrees
+        self.brightness = brightness
+        self.contrast = contrast
+        self.saturation = saturation
+        self.hue = hue
+        self.mean = mean
+        self.std = std
+        self.color_space = color_space
+        self.output_layout = output_layout
+        (self.seed, _) = mirrored_gen_random_seed(random_seed)
+        self._op_with_size = (
+            flow.stateful_op("image_augment")
+            .Input("in")
+            .Input("in_size")
+            .Output("out")
+            .Build()
+        )
+        self._op = flow.stateful_op("image_augment").Input("in").Output("out").Build()
+
+    def forward(self, input, in_size=None):
+        return _C.dispatch_image_augment(
+            self._op if in_size is None else self._op_with_size,
+            (input,) if in_size is None else (input, in_size),
+            target_height=self.target_size[0],
+            target_width=self.target_size[1],
+            interpolation_type=self.interpolation_type,
+            random_area=self.random_area,
+            random_aspect_ratio=self.random_aspect_ratio,
+            flip_prob=self.flip_prob,
+            rotate_degrees=self.rotate_degrees,
+            brightness=self.brightness,
+            contrast=self.contrast,
+            saturation=self.saturation,
+            hue=self.hue,
+            mean=self.mean,
+            std=self.std,
+            color_space=self.color_space,
+            output_layout=self.output_layout,
+            seed=self.seed,
+        )
+
+
 class OFRecordBytesDecoder(Module):
     r"""This operator reads an tensor as bytes. The output might need
 
@@ -955,10 +1070,13 @@ class OneRecReader(Module):
         files (List[str]): The file list to be read from filesystem
         batch_size (int): batch size
         shuffle (bool): shuffle or not
-        shuffle_mode (str): can be "batch" or "instance"
+        shuffle_mode (str): can be "batch", "instance", "index" or "sample". "index" shuffles
+            record offsets of memory-mapped local files, interleaving all parts. "sample" shards
+            the records of all files across ranks by sample, using the ".idx" files next to them
         shuffle_buffer_size (int): shuffle buffer size, default to 1024
         shuffle_after_epoch (bool): if shuffle after each epoch
         verify_example (bool): if verify example, defaults to True
+        start_sample (int): number of samples each rank has already read, used with "sample" mode to resume, defaults to 0
         placement (Optional[oneflow._oneflow_internal.placement]): The placement attribute allows you to specify which physical device the output tensor is stored on.
         sbp (Optional[Union[oneflow._oneflow_internal.sbp.sbp, List[oneflow._oneflow_internal.sbp.sbp]]]): When creating a global tensor, specify the SBP of the output tensor.
 
@@ -1001,6 +1119,7 @@ class OneRecReader(Module):
         shuffle_buffer_size: int = 1024,
         shuffle_after_epoch: bool = False,
         verify_example: bool = True,
+        start_sample: int = 0,
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
     ):
@@ -1010,8 +1129,10 @@ class OneRecReader(Module):
         _handle_shuffle_args(self, shuffle, random_seed)
         _handle_distributed_args(self, None, placement, sbp)
 
-        if shuffle_mode not in ["batch", "instance"]:
-            raise ValueError("shuffle_mode should be 'batch' or 'instance'")
+        if shuffle_mode not in ["batch", "instance", "index", "sample"]:
+            raise ValueError(
+                "shuffle_mode should be 'batch', 'instance', 'index' or 'sample'"
+            )
 
         self.files = files
         self.batch_size = batch_size
@@ -1019,6 +1140,7 @@ class OneRecReader(Module):
         self.shuffle_buffer_size = shuffle_buffer_size
         self.shuffle_after_epoch = shuffle_after_epoch
         self.verify_example = verify_example
+        self.start_sample = start_sample
 
         self.op = flow.stateful_op("OneRecReader").Output("out").Build()
 
@@ -1034,6 +1156,7 @@ class OneRecReader(Module):
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 random_seed=self.random_seed,
                 verify_example=self.verify_example,
+                start_sample=self.start_sample,
                 device=self.device,
             )
         else:
@@ -1047,6 +1170,7 @@ class OneRecReader(Module):
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 random_seed=self.random_seed,
                 verify_example=self.verify_example,
+                start_sample=self.start_sample,
                 placement=self.placement,
                 sbp=self.sbp,
             )
@@ -1056,7 +1180,7 @@ class OneRecReader(Module):
 class GPTIndexedBinDataReader(Module):
     def __init__(
         self,
-        data_file_prefix: str,
+        data_file_prefix: Union[str, Sequence[str]],
         seq_length: int,
         num_samples: int,
         batch_size: int,
@@ -1068,13 +1192,33 @@ class GPTIndexedBinDataReader(Module):
         device: Union[flow.device, str] = None,
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
+        blend_weights: Optional[Sequence[float]] = None,
     ):
         super().__init__()
 
         _handle_shuffle_args(self, shuffle, random_seed)
         _handle_distributed_args(self, device, placement, sbp)
 
-        self.data_file_prefix = data_file_prefix
+        # several data file prefixes are blended by blend_weights
+        if isinstance(data_file_prefix, str):
+            if blend_weights is not None:
+                raise ValueError("blend_weights requires several data file prefixes")
+            self.data_file_prefix = data_file_prefix
+            self.blend_data_file_prefixes = []
+            self.blend_weights = []
+        else:
+            data_file_prefix = list(data_file_prefix)
+            if blend_weights is None:
+                blend_weights = [1.0] * len(data_file_prefix)
+            if len(blend_weights) != len(data_file_prefix):
+                raise ValueError(
+                    "blend_weights {} does not match data file prefixes {}".format(
+                        blend_weights, data_file_prefix
+                    )
+                )
+            self.data_file_prefix = ""
+            self.blend_data_file_prefixes = data_file_prefix
+            self.blend_weights = [float(w) for w in blend_weights]
         self.batch_size = batch_size
         self.num_samples = num_samples
         self.seq_length = seq_length
@@ -1113,6 +1257,8 @@ class GPTIndexedBinDataReader(Module):
                 random_seed=self.random_seed,
                 split_sizes=self.split_sizes,
                 split_index=self.split_index,
+                blend_data_file_prefixes=self.blend_data_file_prefixes,
+                blend_weights=self.blend_weights,
                 device=self.device,
             )
         else:
@@ -1128,6 +1274,8 @@ class GPTIndexedBinDataReader(Module):
                 random_seed=self.random_seed,
                 split_sizes=self.split_sizes,
                 split_index=self.split_index,
+                blend_data_file_prefixes=self.blend_data_file_prefixes,
+                blend_weights=self.blend_weights,
                 placement=self.placement,
                 sbp=self.sbp,
             )
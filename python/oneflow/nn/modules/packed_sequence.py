@@ -0,0 +1,54 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from typing import Sequence, Tuple, Union
+
+import oneflow as flow
+from oneflow.framework.tensor import Tensor
+
+
+def pack_sequences(
+    padded: Tensor, lengths: Union[Sequence[int], Tensor]
+) -> Tuple[Tensor, Tensor, int]:
+    """Packs the sequences of a padded batch one after another without padding.
+
+    ``padded`` is of shape :math:`(batch\\_size, max\\_seqlen, *)` and sequence ``b``
+    takes its first ``lengths[b]`` rows. Returns the packed tensor of shape
+    :math:`(total\\_len, *)`, the int32 ``cu_seqlens`` of shape
+    :math:`(batch\\_size + 1)` whose entries ``b`` and ``b + 1`` delimit the rows of
+    sequence ``b``, and the length of the longest sequence.
+
+    Ops computing each token on its own, like linear or layer norm, run on the packed
+    tensor as is, and :func:`oneflow._C.fused_attention` takes ``cu_seqlens`` to attend
+    within each sequence, so no compute is spent on padding.
+    """
+    if isinstance(lengths, Tensor):
+        lengths = lengths.tolist()
+    assert len(lengths) == padded.shape[0], "lengths should have batch_size entries"
+    cu_seqlens = [0]
+    for length in lengths:
+        assert 0 <= length <= padded.shape[1], f"length {length} is out of range"
+        cu_seqlens.append(cu_seqlens[-1] + length)
+    total_len = cu_seqlens[-1]
+    cu_seqlens = flow.tensor(cu_seqlens, dtype=flow.int32, device=padded.device)
+    packed = flow._C.padded_to_packed(padded, cu_seqlens, total_len)
+    return packed, cu_seqlens, max(lengths, default=0)
+
+
+def unpack_sequences(packed: Tensor, cu_seqlens: Tensor, max_seqlen: int) -> Tensor:
+    """The inverse of :func:`pack_sequences`, gives the padded batch of shape
+    :math:`(batch\\_size, max\\_seqlen, *)` with zeros after the end of each sequence.
+    """
+    return flow._C.packed_to_padded(packed, cu_seqlens, max_seqlen)
@@ -0,0 +1,178 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from typing import Dict, List, Sequence
+
+import numpy as np
+
+import oneflow as flow
+
+
+class PagedKVCache(object):
+    """Key/value cache of autoregressive decoding kept in fixed size blocks.
+
+    The device storage of every layer is a pair of tensors of shape
+    :math:`(num\\_blocks, block\\_size, num\\_kv\\_heads, head\\_dim)`. Blocks are handed
+    out to sequences by a host side allocator, so a sequence grows one token at a
+    time without moving what is already cached, and sequences of different lengths
+    share the storage without fragmenting it. A token of a sequence lives in slot
+    ``block_id * block_size + offset`` of the storage.
+
+    Args:
+        num_layers (int): number of attention layers sharing the allocator
+        num_blocks (int): number of blocks of the storage
+        block_size (int): number of tokens of a block
+        num_kv_heads (int): number of key/value heads
+        head_dim (int): size of a head
+        dtype (oneflow.dtype): data type of the storage. Default: ``oneflow.float32``
+        device (oneflow.device or str): device of the storage. Default: ``"cuda"``
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> cache = flow.nn.PagedKVCache(1, 16, 4, 2, 8, device="cpu")
+        >>> cache.add_sequence(0)
+        >>> slot_mapping = cache.reserve([0], [3])
+        >>> cache.append(0, flow.randn(3, 2, 8), flow.randn(3, 2, 8), slot_mapping)
+        >>> cache.decode_attention(0, flow.randn(1, 2, 8), [0]).shape
+        oneflow.Size([1, 2, 8])
+
+    """
+
+    def __init__(
+        self,
+        num_layers: int,
+        num_blocks: int,
+        block_size: int,
+        num_kv_heads: int,
+        head_dim: int,
+        dtype: flow.dtype = flow.float32,
+        device="cuda",
+    ):
+        self.block_size = block_size
+        self.num_blocks = num_blocks
+        shape = (num_blocks, block_size, num_kv_heads, head_dim)
+        self.key_caches = [
+            flow.zeros(shape, dtype=dtype, device=device) for _ in range(num_layers)
+        ]
+        self.value_caches = [
+            flow.zeros(shape, dtype=dtype, device=device) for _ in range(num_layers)
+        ]
+        self._device = self.key_caches[0].device if num_layers > 0 else device
+        # Popped from the end, so the blocks are handed out in ascending order.
+        self._free_blocks: List[int] = list(range(num_blocks - 1, -1, -1))
+        self._block_tables: Dict[int, List[int]] = {}
+        self._context_lens: Dict[int, int] = {}
+
+    @property
+    def num_free_blocks(self) -> int:
+        return len(self._free_blocks)
+
+    def add_sequence(self, seq_id: int):
+        assert seq_id not in self._block_tables, f"sequence {seq_id} already exists"
+        self._block_tables[seq_id] = []
+        self._context_lens[seq_id] = 0
+
+    def free_sequence(self, seq_id: int):
+        """Returns the blocks of a finished sequence to the allocator."""
+        self._free_blocks.extend(reversed(self._block_tables.pop(seq_id)))
+        del self._context_lens[seq_id]
+
+    def context_len(self, seq_id: int) -> int:
+        return self._context_lens[seq_id]
+
+    def reserve(self, seq_ids: Sequence[int], num_tokens: Sequence[int]):
+        """Reserves slots for ``num_tokens[i]`` new tokens of ``seq_ids[i]``, allocating
+        blocks on demand, and returns the slot mapping of the new tokens in order as
+        an int64 tensor, to be passed to :meth:`append`.
+        """
+        assert len(seq_ids) == len(num_tokens)
+        num_new_blocks = 0
+        for seq_id, n in zip(seq_ids, num_tokens):
+            blocks = len(self._block_tables[seq_id])
+            needed = -(-(self._context_lens[seq_id] + n) // self.block_size)
+            num_new_blocks += max(needed - blocks, 0)
+        if num_new_blocks > len(self._free_blocks):
+            raise RuntimeError(
+                f"out of kv cache blocks: {num_new_blocks} needed, "
+                f"{len(self._free_blocks)} free"
+            )
+        slots = []
+        for seq_id, n in zip(seq_ids, num_tokens):
+            table = self._block_tables[seq_id]
+            pos = self._context_lens[seq_id]
+            for _ in range(n):
+                if pos // self.block_size == len(table):
+                    table.append(self._free_blocks.pop())
+                block_id = table[pos // self.block_size]
+                slots.append(block_id * self.block_size + pos % self.block_size)
+                pos += 1
+            self._context_lens[seq_id] = pos
+        return flow.tensor(np.array(slots, dtype=np.int64), device=self._device)
+
+    def append(self, layer: int, key, value, slot_mapping):
+        """Writes ``key`` and ``value`` of shape :math:`(num\\_tokens, num\\_kv\\_heads,
+        head\\_dim)` into the storage of ``layer`` in place.
+        """
+        flow._C.paged_kv_cache_append(
+            self.key_caches[layer], self.value_caches[layer], key, value, slot_mapping
+        )
+
+    def block_tables(self, seq_ids: Sequence[int]):
+        """Returns the block tables of ``seq_ids``, padded to the same width, and their
+        context lengths as int32 tensors.
+        """
+        tables = [self._block_tables[seq_id] for seq_id in seq_ids]
+        width = max([len(table) for table in tables] + [1])
+        block_tables = np.zeros((len(tables), width), dtype=np.int32)
+        for i, table in enumerate(tables):
+            block_tables[i, : len(table)] = table
+        context_lens = np.array(
+            [self._context_lens[seq_id] for seq_id in seq_ids], dtype=np.int32
+        )
+        return (
+            flow.tensor(block_tables, device=self._device),
+            flow.tensor(context_lens, device=self._device),
+        )
+
+    def decode_attention(self, layer: int, query, seq_ids: Sequence[int], scale=None):
+        """Attends ``query`` of shape :math:`(len(seq\\_ids), num\\_heads, head\\_dim)`,
+        one token of each sequence, to everything cached for ``seq_ids`` in ``layer``.
+        """
+        block_tables, context_lens = self.block_tables(seq_ids)
+        return flow._C.paged_decode_attention(
+            query,
+            self.key_caches[layer],
+            self.value_caches[layer],
+            block_tables,
+            context_lens,
+            scale=scale,
+        )
+
+    def reorder_beams(self, seq_ids: Sequence[int], parent_beams):
+        """Makes beam ``j`` of every batch ``b`` cache the tokens of its beam
+        ``parent_beams[b][j]`` in every layer, as given by
+        :func:`oneflow.nn.functional.fused_decode_step`. ``seq_ids`` lists the sequences
+        of the beams batch by batch, and the beams of a batch must have the same context
+        length.
+        """
+        block_tables, context_lens = self.block_tables(seq_ids)
+        parent_beams = parent_beams.to(device=self._device, dtype=flow.int32)
+        for key_cache, value_cache in zip(self.key_caches, self.value_caches):
+            flow._C.paged_kv_cache_reorder_beams(
+                key_cache, value_cache, block_tables, context_lens, parent_beams
+            )
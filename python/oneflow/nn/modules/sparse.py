@@ -158,6 +158,55 @@ def embedding(
     return res
 
 
+def embedding_bag(
+    input,
+    weight,
+    mode="mean",
+    per_sample_weights=None,
+    padding_idx=None,
+):
+    r"""Computes sums, means or maxes of `bags` of embeddings, without instantiating
+    the intermediate embeddings.
+
+    Every row of :attr:`input` is one bag of fixed size; variable-length bags can be
+    expressed by filling the unused slots with :attr:`padding_idx`, which is excluded
+    from the reduction and from the mean denominator.
+
+    Args:
+        input (LongTensor): Tensor of shape :math:`(B, N)` with the indices of every bag
+        weight (Tensor): The embedding matrix of shape :math:`(num\_embeddings, embedding\_dim)`
+        mode (str, optional): ``"sum"``, ``"mean"`` or ``"max"``. Default: ``"mean"``
+        per_sample_weights (Tensor, optional): Tensor of the same shape as :attr:`input`
+            scaling every looked up embedding before the reduction. Only supported by
+            ``"sum"`` and ``"mean"``.
+        padding_idx (int, optional): Index whose entries do not contribute to the output
+            and the gradient.
+
+    Returns:
+        Tensor of shape :math:`(B, embedding\_dim)`.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> import oneflow.nn.functional as F
+
+        >>> weight = flow.arange(12, dtype=flow.float32).reshape(4, 3)
+        >>> input = flow.tensor([[0, 2], [1, 3]])
+        >>> F.embedding_bag(input, weight, mode="sum")
+        tensor([[ 6.,  8., 10.],
+                [12., 14., 16.]], dtype=oneflow.float32)
+    """
+    if padding_idx is None:
+        padding_idx = -1
+    elif padding_idx < 0:
+        padding_idx += weight.shape[0]
+    return flow._C.embedding_bag(
+        input, weight, per_sample_weights, mode=mode, padding_idx=padding_idx
+    )
+
+
 if __name__ == "__main__":
     import doctest
 
@@ -0,0 +1,174 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import numpy as np
+
+import oneflow as flow
+from oneflow.framework.tensor import Tensor
+from oneflow.nn.module import Module
+from oneflow.nn.modules.linear import Linear
+
+
+def quantize_weight_only(weight: Tensor, num_bits: int = 8, group_size: int = 128):
+    """Quantizes the weight of a linear layer, of shape
+    :math:`(out\\_features, in\\_features)`, symmetrically to ``num_bits`` signed
+    integers with one scale per ``group_size`` consecutive input features of every
+    output feature.
+
+    Returns the int8 weight of shape
+    :math:`(out\\_features, in\\_features * num\\_bits / 8)`, two 4 bits values being
+    packed in a byte with the even feature in the low nibble, and the scales of shape
+    :math:`(out\\_features, in\\_features / group\\_size)` in the data type of
+    ``weight``.
+    """
+    assert num_bits in (4, 8), "only 4 or 8 bits weights are supported"
+    w = weight.numpy().astype(np.float32)
+    n, k = w.shape
+    assert (
+        k % group_size == 0
+    ), f"in_features {k} is not a multiple of group_size {group_size}"
+    qmax = 2 ** (num_bits - 1) - 1
+    groups = w.reshape(n, k // group_size, group_size)
+    scale = np.abs(groups).max(axis=2) / qmax
+    scale[scale == 0] = 1
+    q = np.clip(np.rint(groups / scale[:, :, None]), -qmax, qmax).astype(np.int8)
+    q = q.reshape(n, k)
+    if num_bits == 4:
+        q = ((q[:, 0::2] & 0xF) | (q[:, 1::2] << 4)).astype(np.int8)
+    return (
+        flow.tensor(q, device=weight.device),
+        flow.tensor(scale, dtype=weight.dtype, device=weight.device),
+    )
+
+
+class WeightOnlyQuantLinear(Module):
+    """A linear layer whose weight is stored as group-wise quantized 4 or 8 bits
+    integers, see :func:`quantize_weight_only`, while the input, the output and the
+    computation stay in the floating data type. A fused kernel dequantizes the weight
+    on the fly, reading 4 to 8 times fewer bytes than the floating weight, which is what
+    the small batches of decoding are bound by.
+
+    A model is converted with :func:`oneflow.nn.utils.convert_to_weight_only_quant`, and
+    its ``state_dict`` then holds the quantized checkpoint.
+
+    Args:
+        in_features (int): size of each input sample, a multiple of ``group_size``
+        out_features (int): size of each output sample
+        bias (bool): whether the layer has a bias. Default: ``True``
+        num_bits (int): 4 or 8. Default: 8
+        group_size (int): number of input features sharing a scale. Default: 128
+    """
+
+    def __init__(
+        self,
+        in_features: int,
+        out_features: int,
+        bias: bool = True,
+        num_bits: int = 8,
+        group_size: int = 128,
+        dtype: flow.dtype = flow.float32,
+        device=None,
+    ):
+        super().__init__()
+        assert num_bits in (4, 8), "only 4 or 8 bits weights are supported"
+        assert in_features % group_size == 0
+        self.in_features = in_features
+        self.out_features = out_features
+        self.num_bits = num_bits
+        self.group_size = group_size
+        self.register_buffer(
+            "weight",
+            flow.zeros(
+                out_features,
+                in_features * num_bits // 8,
+                dtype=flow.int8,
+                device=device,
+            ),
+        )
+        self.register_buffer(
+            "scale",
+            flow.ones(
+                out_features, in_features // group_size, dtype=dtype, device=device
+            ),
+        )
+        if bias:
+            self.register_buffer(
+                "bias", flow.zeros(out_features, dtype=dtype, device=device)
+            )
+        else:
+            self.register_buffer("bias", None)
+
+    @classmethod
+    def from_linear(cls, linear: Linear, num_bits: int = 8, group_size: int = 128):
+        group_size = min(group_size, linear.in_features)
+        weight = linear.weight.detach()
+        m = cls(
+            linear.in_features,
+            linear.out_features,
+            bias=linear.bias is not None,
+            num_bits=num_bits,
+            group_size=group_size,
+            dtype=weight.dtype,
+            device=weight.device,
+        )
+        m.weight, m.scale = quantize_weight_only(weight, num_bits, group_size)
+        if linear.bias is not None:
+            m.bias = linear.bias.detach().clone()
+        return m
+
+    def forward(self, x):
+        return flow._C.weight_only_quant_matmul(
+            x,
+            self.weight,
+            self.scale,
+            self.bias,
+            num_bits=self.num_bits,
+            group_size=self.group_size,
+        )
+
+    def extra_repr(self) -> str:
+        return (
+            f"in_features={self.in_features}, out_features={self.out_features}, "
+            f"bias={self.bias is not None}, num_bits={self.num_bits}, "
+            f"group_size={self.group_size}"
+        )
+
+
+def convert_to_weight_only_quant(
+    module: Module, num_bits: int = 8, group_size: int = 128
+) -> Module:
+    """Replaces the :class:`oneflow.nn.Linear` layers of ``module`` with
+    :class:`oneflow.nn.WeightOnlyQuantLinear` layers holding their quantized weights,
+    and returns the converted module. Layers whose ``in_features`` is not a multiple of
+    ``group_size`` are kept as they are.
+
+    For example, to convert a checkpoint:
+
+    .. code-block:: python
+
+        model.load_state_dict(flow.load("model"))
+        model = flow.nn.utils.convert_to_weight_only_quant(model, num_bits=4)
+        flow.save(model.state_dict(), "model_int4")
+
+    """
+    if isinstance(module, Linear):
+        if module.in_features % min(group_size, module.in_features) != 0:
+            return module
+        return WeightOnlyQuantLinear.from_linear(module, num_bits, group_size)
+    for name, child in list(module.named_children()):
+        converted = convert_to_weight_only_quant(child, num_bits, group_size)
+        if converted is not child:
+            setattr(module, name, converted)
+    return module
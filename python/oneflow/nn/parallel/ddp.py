@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 from collections import OrderedDict
+from typing import Optional
 
 import oneflow as flow
 from oneflow.framework.tensor_tuple_util import convert_to_tensor_tuple
@@ -35,12 +36,16 @@ def grad_setting_fn(module, param):
 
 
 def allreduce_fn(module, param):
-    ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
-    buckets = module._buckets
-    bucket_tensors = module._bucket_tensors
-
     def allreduce(grad):
+        ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
+        buckets = module._buckets
+        bucket_tensors = module._bucket_tensors
         ddp_state_for_reversed_params[param][0] = True
+        if module._grad_ready_order is not None:
+            module._grad_ready_order.append(param)
+        # Buckets are reduced in the same order on all ranks. A bucket is launched
+        # as soon as it and all buckets before it are ready, while the rest of
+        # backward keeps running.
         for index, bucket in enumerate(buckets):
             deleted = all(ddp_state_for_reversed_params[x][1] for x in bucket)
             if deleted:
@@ -63,9 +68,111 @@ def allreduce_fn(module, param):
     return allreduce
 
 
+def numel_in_bucket(tensor: flow.Tensor):
+    def align(x: int, unit_size: int):
+        return (x + (unit_size - 1)) // unit_size * unit_size
+
+    # tensor memory should be align to 512 bytes for cuda operations,
+    # 4 is the bytes of a float number
+    # TODO(jianhao): expose the `kCudaMemAllocAlignSize` from C++ to
+    # avoid this hardcoded "512"
+    return align(tensor.numel(), 512 // 4)
+
+
+def build_buckets(module, ordered_params, bucket_size, bucket_cap_mb, device):
+    """Splits the parameters, in the order their gradients are expected to be ready,
+    into buckets of at most bucket_size parameters and bucket_cap_mb megabytes, and
+    moves the existing gradients into the new bucket tensors."""
+    bucket_cap_numel = (
+        None if bucket_cap_mb is None else int(bucket_cap_mb * 1024 * 1024) // 4
+    )
+    buckets = []
+    for param in ordered_params:
+        if len(buckets) > 0:
+            bucket = buckets[-1]
+            numel = sum(numel_in_bucket(x) for x in bucket) + numel_in_bucket(param)
+            if (bucket_size is None or len(bucket) < bucket_size) and (
+                bucket_cap_numel is None or numel <= bucket_cap_numel
+            ):
+                bucket.append(param)
+                continue
+        buckets.append([param])
+
+    module._buckets = buckets
+    module._bucket_index = {}
+    module._param_grad_offset_in_bucket = {}
+    module._bucket_tensors = []
+    with flow.no_grad():
+        for index, bucket in enumerate(buckets):
+            offset_in_bucket = 0
+            for param in bucket:
+                assert param.is_leaf
+                module._bucket_index[param] = index
+                module._param_grad_offset_in_bucket[param] = offset_in_bucket
+                offset_in_bucket += numel_in_bucket(param)
+            bucket_tensor = flow.zeros(
+                offset_in_bucket, dtype=flow.float32, device=device
+            )
+            module._bucket_tensors.append(bucket_tensor)
+            for param in bucket:
+                if param.grad is None:
+                    continue
+                start = module._param_grad_offset_in_bucket[param]
+                grad = flow._C.slice_view_1d_contiguous(
+                    bucket_tensor, start, start + param.numel()
+                ).view(param.shape)
+                grad.copy_(param.grad)
+                param.grad = grad
+                param._is_grad_acc_inplace = True
+
+
+def rebuild_buckets_in_ready_order(module, bucket_size, bucket_cap_mb, device):
+    """Rebuilds the buckets in the order the gradients became ready in the first
+    backward, which is the reverse topological order of the parameters in the autograd
+    graph. The order of rank 0 is used so that all ranks launch the same all-reduces."""
+    params = list(module._ddp_state_for_reversed_params.keys())
+    ready_order = module._grad_ready_order
+    module._grad_ready_order = None
+    seen = set()
+    ordered_params = []
+    for param in ready_order + params:
+        if param not in seen:
+            seen.add(param)
+            ordered_params.append(param)
+    param_index = {param: i for i, param in enumerate(params)}
+    order = flow.tensor(
+        [param_index[param] for param in ordered_params],
+        dtype=flow.int64,
+        device=device,
+    )
+    flow._C.broadcast(order, src_rank=0, inplace=True)
+    ordered_params = [params[i] for i in order.numpy().tolist()]
+    build_buckets(module, ordered_params, bucket_size, bucket_cap_mb, device)
+
+
 def DistributedDataParallel(
-    module: "flow.nn.Module", *, broadcast_buffers: bool = True, bucket_size: int = 10
+    module: "flow.nn.Module",
+    *,
+    broadcast_buffers: bool = True,
+    bucket_size: Optional[int] = None,
+    bucket_cap_mb: Optional[float] = 25,
 ):
+    """Wraps module for eager data parallel training.
+
+    The gradients are averaged across ranks by all-reducing buckets of parameters.
+    A bucket is reduced once the gradients of all its parameters are accumulated, so
+    the communication overlaps with the rest of backward. The buckets follow the
+    reversed order of the parameters first, and are rebuilt in the order the
+    gradients became ready after the first backward.
+
+    Args:
+        broadcast_buffers (bool): Broadcast the buffers of module from rank 0 before
+            each forward. Default: True.
+        bucket_size (int, optional): The maximum number of parameters in a bucket,
+            unbounded if None. Default: None.
+        bucket_cap_mb (float, optional): The maximum size of a bucket in megabytes,
+            unbounded if None. Default: 25.
+    """
     assert all(x.dtype == flow.float32 for x in module.parameters())
 
     world_size = flow.env.get_world_size()
@@ -78,48 +185,16 @@ def DistributedDataParallel(
             x.requires_grad_(requires_grad)
 
     all_grad_size = sum([x.numel() for x in module.parameters()])
+    device = None
     if all_grad_size > 0:
         device = list(module.parameters())[0].device
         assert all(x.device == device for x in module.parameters())
     reversed_param_list = list(
         reversed(list([param for param in module.parameters() if param.requires_grad]))
     )
-    module._param_grad_offset_in_bucket = {}
-
-    def numel_in_bucket(tensor: flow.Tensor):
-        def align(x: int, unit_size: int):
-            return (x + (unit_size - 1)) // unit_size * unit_size
-
-        # tensor memory should be align to 512 bytes for cuda operations,
-        # 4 is the bytes of a float number
-        # TODO(jianhao): expose the `kCudaMemAllocAlignSize` from C++ to
-        # avoid this hardcoded "512"
-        return align(tensor.numel(), 512 // 4)
-
-    offset_in_bucket = 0
-    with flow.no_grad():
-        for i, param in enumerate(reversed_param_list):
-            assert param.is_leaf
-            if i % bucket_size == 0:
-                offset_in_bucket = 0
-            module._param_grad_offset_in_bucket[param] = offset_in_bucket
-            offset_in_bucket += numel_in_bucket(param)
-
-    module._bucket_index = {
-        x: i // bucket_size for i, x in enumerate(reversed_param_list)
-    }
-    module._buckets = [
-        reversed_param_list[i : i + bucket_size]
-        for i in range(0, len(reversed_param_list), bucket_size)
-    ]
-
-    bucket_elems = 0
-    module._bucket_tensors = []
-    for b in module._buckets:
-        bucket_elems = sum([numel_in_bucket(x) for x in b])
-        module._bucket_tensors.append(
-            flow.zeros(bucket_elems, dtype=flow.float32, device=device)
-        )
+    build_buckets(module, reversed_param_list, bucket_size, bucket_cap_mb, device)
+    # The order the gradients become ready in is recorded during the first backward.
+    module._grad_ready_order = []
 
     ddp_state_for_reversed_params = OrderedDict(
         reversed([(x, [False, False]) for x in module.parameters() if x.requires_grad])
@@ -144,6 +219,8 @@ def DistributedDataParallel(
             param._register_post_grad_accumulation_hook(allreduce_fn(module, param))
 
     def post_forward_hook(module, input, output):
+        if module._grad_ready_order:
+            rebuild_buckets_in_ready_order(module, bucket_size, bucket_cap_mb, device)
         ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
         for state in ddp_state_for_reversed_params.values():
             state[0], state[1] = False, False
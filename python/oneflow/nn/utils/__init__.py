@@ -16,3 +16,5 @@ limitations under the License.
 from oneflow.nn.utils.clip_grad import clip_grad_norm_, clip_grad_value_
 from oneflow.nn.utils.weight_norm import weight_norm
 from oneflow.nn.utils.weight_norm import remove_weight_norm
+from oneflow.nn.modules.weight_only_quantization import convert_to_weight_only_quant
+from oneflow.nn.modules.packed_sequence import pack_sequences, unpack_sequences
@@ -14,6 +14,71 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 from oneflow.framework.profiler import ProfilerStart as profiler_start
+from oneflow.framework.profiler import (
+    DisableInstructionTrace as disable_instruction_trace,
+)
+from oneflow.framework.profiler import (
+    DumpInstructionChromeTrace as dump_instruction_chrome_trace,
+)
+from oneflow.framework.profiler import (
+    EnableInstructionTrace as enable_instruction_trace,
+)
+from oneflow.framework.profiler import (
+    GetInstructionLatencySummary as get_instruction_latency_summary,
+)
+from oneflow.framework.profiler import ResetInstructionTrace as reset_instruction_trace
+from oneflow.framework.profiler import (
+    DisableCollectiveTrace as disable_collective_trace,
+)
+from oneflow.framework.profiler import (
+    DumpCollectiveChromeTrace as dump_collective_chrome_trace,
+)
+from oneflow.framework.profiler import EnableCollectiveTrace as enable_collective_trace
+from oneflow.framework.profiler import GetCollectiveSummary as get_collective_summary
+from oneflow.framework.profiler import ResetCollectiveTrace as reset_collective_trace
+from oneflow.framework.profiler import DisableKernelMetrics as disable_kernel_metrics
+from oneflow.framework.profiler import EnableKernelMetrics as enable_kernel_metrics
+from oneflow.framework.profiler import (
+    GetKernelMetricsSummary as get_kernel_metrics_summary,
+)
+from oneflow.framework.profiler import ResetKernelMetrics as reset_kernel_metrics
+from oneflow.framework.profiler import (
+    GetDataReaderMetricsSummary as get_data_reader_metrics_summary,
+)
+from oneflow.framework.profiler import (
+    ResetDataReaderMetrics as reset_data_reader_metrics,
+)
+from oneflow.framework.profiler import (
+    GetCheckpointIOMetricsSummary as get_checkpoint_io_metrics_summary,
+)
+from oneflow.framework.profiler import (
+    ResetCheckpointIOMetrics as reset_checkpoint_io_metrics,
+)
+from oneflow.framework.profiler import (
+    GetManagedMemoryMetricsSummary as get_managed_memory_metrics_summary,
+)
+from oneflow.framework.profiler import (
+    ResetManagedMemoryMetrics as reset_managed_memory_metrics,
+)
+from oneflow.framework.profiler import EnableEventTrace as enable_event_trace
+from oneflow.framework.profiler import DisableEventTrace as disable_event_trace
+from oneflow.framework.profiler import ResetEventTrace as reset_event_trace
+from oneflow.framework.profiler import (
+    GetEventTraceOpSummary as get_event_trace_op_summary,
+)
+from oneflow.framework.profiler import (
+    GetEventTraceKernelSummary as get_event_trace_kernel_summary,
+)
+from oneflow.framework.profiler import (
+    DumpEventTraceChromeTrace as dump_event_trace_chrome_trace,
+)
+from oneflow.framework.profiler import EnableMemoryTrace as enable_memory_trace
+from oneflow.framework.profiler import DisableMemoryTrace as disable_memory_trace
+from oneflow.framework.profiler import ResetMemoryTrace as reset_memory_trace
+from oneflow.framework.profiler import GetMemorySnapshot as get_memory_snapshot
+from oneflow.framework.profiler import (
+    DumpMemoryTimelineChromeTrace as dump_memory_timeline_chrome_trace,
+)
 from oneflow.framework.profiler import ProfilerStop as profiler_stop
 from oneflow.framework.profiler import RangePop as range_pop
 from oneflow.framework.profiler import RangePush as range_push
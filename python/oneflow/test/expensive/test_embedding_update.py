@@ -0,0 +1,203 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import json
+import os
+import tempfile
+import unittest
+from collections import OrderedDict
+from oneflow.test_utils.test_util import GenArgDict
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+num_optimizer_states = {"sgd": 0, "momentum": 1, "adam": 2, "adagrad": 1}
+cache_options = {
+    "none": [],
+    "lru": [{"policy": "lru", "capacity": 4096, "value_memory_kind": "device"}],
+    "full": [{"policy": "full", "capacity": 4096, "value_memory_kind": "device"}],
+}
+
+
+class EmbeddingModule(flow.nn.Module):
+    def __init__(self, data):
+        super().__init__()
+        self.weight = flow.nn.Parameter(flow.tensor(data).to("cuda"))
+
+    def forward(self, ids):
+        return flow._C.gather(self.weight, ids, 0)
+
+
+def _make_optimizer(optimizer, parameters, lr):
+    if optimizer == "sgd":
+        return flow.optim.SGD(parameters, lr=lr)
+    elif optimizer == "momentum":
+        return flow.optim.SGD(parameters, lr=lr, momentum=0.9)
+    elif optimizer == "adam":
+        return flow.optim.Adam(parameters, lr=lr, betas=(0.9, 0.999), eps=1e-8)
+    elif optimizer == "adagrad":
+        return flow.optim.Adagrad(parameters, lr=lr, eps=1e-10)
+    raise ValueError(optimizer)
+
+
+def _test_embedding_update(test_case, optimizer, cache):
+    batch_size = 256
+    num_columns = 4
+    num_rows = 1000
+    embedding_size = 16
+    num_steps = 3
+    lr = 0.1
+    line_size = embedding_size * (1 + num_optimizer_states[optimizer])
+    data = np.random.rand(num_rows, embedding_size).astype(np.float32)
+    # Only the rows of even keys are put, the others start from zeros.
+    data[1::2] = 0
+    all_ids = [
+        np.random.randint(0, num_rows, (batch_size, num_columns), dtype=np.int64)
+        for _ in range(num_steps)
+    ]
+    all_grads = [
+        np.random.randn(batch_size, num_columns, embedding_size).astype(np.float32)
+        for _ in range(num_steps)
+    ]
+
+    # The reference is a gathered parameter updated by the sparse optimizer of a graph.
+    # There is no indexed_slices_adagrad_update, adagrad uses the dense update.
+    module = EmbeddingModule(data)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.m = module
+            self.add_optimizer(
+                _make_optimizer(optimizer, module.parameters(), lr),
+                is_sparse=(optimizer != "adagrad"),
+            )
+
+        def build(self, ids, grad):
+            loss = (self.m(ids) * grad).sum()
+            loss.backward()
+            return loss
+
+    train_graph = TrainGraph()
+    for ids, grad in zip(all_ids, all_grads):
+        train_graph(flow.tensor(ids).to("cuda"), flow.tensor(grad).to("cuda"))
+    if optimizer != "adagrad":
+        op_types = [
+            op.user_conf.op_type_name
+            for op in train_graph._full_graph_proto.net.op
+            if op.HasField("user_conf")
+        ]
+        test_case.assertIn("indexed_slices_" + optimizer + "_update", op_types)
+    expected = module.weight.numpy()
+
+    # Value files are opened with O_DIRECT, which tmpfs does not support.
+    table_dir = tempfile.TemporaryDirectory(dir=".")
+    name = "update_" + optimizer + "_" + cache
+    options = json.dumps(
+        {
+            "name": name,
+            "key_size": 8,
+            "value_size": line_size * 4,
+            "caches": cache_options[cache],
+            "persistent_table": {"path": table_dir.name, "physical_block_size": 512},
+        }
+    )
+    lookup_ids = flow.tensor(np.arange(num_rows, dtype=np.int64).reshape(-1, 1)).to(
+        "cuda"
+    )
+
+    def lookup():
+        (
+            num_unique_matrix,
+            inverse_unique_partition_indices,
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            _,
+            cur_rank_inverse_indices,
+        ) = flow._C.one_embedding_id_shuffle(lookup_ids, None, 1)
+        return flow._C.one_embedding_lookup_shuffle(
+            num_unique_matrix,
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            cur_rank_inverse_indices,
+            inverse_unique_partition_indices,
+            options,
+        ).numpy()
+
+    # Creates the store, then seeds the even rows with zero optimizer states.
+    lookup()
+    keys = np.arange(0, num_rows, 2, dtype=np.int64)
+    rows = np.zeros((keys.size, line_size), dtype=np.float32)
+    rows[:, :embedding_size] = data[keys]
+    flow._oneflow_internal.embedding.PutEmbeddingRows(name, 0, keys, rows)
+    learning_rate = flow.tensor([lr], dtype=flow.float32).to("cuda")
+    for step, (ids, grad) in enumerate(zip(all_ids, all_grads)):
+        (
+            num_unique_matrix,
+            inverse_unique_partition_indices,
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            _,
+            cur_rank_inverse_indices,
+        ) = flow._C.one_embedding_id_shuffle(
+            flow.tensor(ids).to("cuda"), None, num_columns
+        )
+        unique_grad = flow._C.one_embedding_embedding_gradient_shuffle(
+            flow.tensor(grad).to("cuda"),
+            num_unique_matrix,
+            cur_rank_inverse_indices,
+            inverse_unique_partition_indices,
+        )
+        bias_correction1 = None
+        bias_correction2 = None
+        if optimizer == "adam":
+            bias_correction1 = flow.tensor([1 - 0.9 ** (step + 1)]).to("cuda")
+            bias_correction2 = flow.tensor([1 - 0.999 ** (step + 1)]).to("cuda")
+        flow._C.one_embedding_update(
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            unique_grad,
+            learning_rate,
+            bias_correction1,
+            bias_correction2,
+            options,
+            optimizer,
+            beta=0.9,
+            beta1=0.9,
+            beta2=0.999,
+            epsilon=1e-10 if optimizer == "adagrad" else 1e-8,
+        )
+    embeddings = lookup().reshape(num_rows, line_size)
+    test_case.assertTrue(
+        np.allclose(embeddings[:, :embedding_size], expected, atol=1e-5, rtol=1e-4)
+    )
+    table_dir.cleanup()
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class EmbeddingUpdateTestCase(flow.unittest.TestCase):
+    def test_embedding_update(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["optimizer"] = ["sgd", "momentum", "adam", "adagrad"]
+        # Without a cache the rows go through Get and Put, the caches update in place.
+        arg_dict["cache"] = ["none", "lru", "full"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_update(test_case, **kwargs)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import json
+import os
+import tempfile
 import unittest
 from collections import OrderedDict
 from oneflow.test_utils.test_util import GenArgDict
@@ -211,6 +214,79 @@ def _test_embedding_gradient_shuffle(test_case):
     )
 
 
+def _test_embedding_lookup_shuffle(test_case, dtype):
+    batch_size = 512
+    num_columns = 26
+    num_rows = 1000
+    embedding_size = 128
+    ids = np.random.randint(0, num_rows, (batch_size, num_columns), dtype=np.int64)
+    data = np.random.rand(num_rows, embedding_size).astype(np.float32)
+    # Only the rows of even keys are put, the others are missing and looked up as zeros.
+    data[1::2] = 0
+    np_dtype = np.float16 if dtype == flow.float16 else np.float32
+    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    data_tensor = flow.tensor(data.astype(np_dtype), requires_grad=False).to("cuda")
+    # Value files are opened with O_DIRECT, which tmpfs does not support.
+    table_dir = tempfile.TemporaryDirectory(dir=".")
+    name = "lookup_shuffle_" + str(dtype).split(".")[-1]
+    options = json.dumps(
+        {
+            "name": name,
+            "key_size": 8,
+            "value_size": embedding_size * 4,
+            "caches": [
+                {"policy": "lru", "capacity": 4096, "value_memory_kind": "device"}
+            ],
+            "persistent_table": {"path": table_dir.name, "physical_block_size": 512},
+        }
+    )
+
+    class TestGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+
+        def build(self, ids, data):
+            (
+                num_unique_matrix,
+                inverse_unique_partition_indices,
+                cur_rank_num_unique,
+                cur_rank_unique_ids,
+                _,
+                cur_rank_inverse_indices,
+            ) = flow._C.one_embedding_id_shuffle(ids, None, num_columns)
+            embeddings = flow._C.one_embedding_lookup_shuffle(
+                num_unique_matrix,
+                cur_rank_num_unique,
+                cur_rank_unique_ids,
+                cur_rank_inverse_indices,
+                inverse_unique_partition_indices,
+                options,
+                dtype,
+            )
+            # The unfused path, looked up by a gather of the table.
+            unique_embeddings = flow._C.gather(data, cur_rank_unique_ids, axis=0)
+            expected = flow._C.one_embedding_embedding_shuffle(
+                unique_embeddings,
+                num_unique_matrix,
+                cur_rank_inverse_indices,
+                inverse_unique_partition_indices,
+            )
+            return embeddings, expected
+
+    graph = TestGraph()
+    embeddings, expected = graph(ids_tensor, data_tensor)
+    test_case.assertEqual(embeddings.dtype, dtype)
+    test_case.assertTrue(np.array_equal(embeddings.numpy(), np.zeros(expected.shape)))
+    keys = np.arange(0, num_rows, 2, dtype=np.int64)
+    flow._oneflow_internal.embedding.PutEmbeddingRows(name, 0, keys, data[keys])
+    # The second run is served by the table and the third one by the cache.
+    for _ in range(2):
+        embeddings, expected = graph(ids_tensor, data_tensor)
+        test_case.assertTrue(np.array_equal(embeddings.numpy(), expected.numpy()))
+    test_case.assertTrue(np.array_equal(expected.numpy(), data.astype(np_dtype)[ids]))
+    table_dir.cleanup()
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class DataShuffleTestCase(flow.unittest.TestCase):
@@ -227,6 +303,12 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         for kwargs in GenArgDict(arg_dict):
             _test_embedding_shuffle(test_case, **kwargs)
 
+    def test_embedding_lookup_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["dtype"] = [flow.float32, flow.float16]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_lookup_shuffle(test_case, **kwargs)
+
     def test_embedding_gradient_shuffle(test_case):
         arg_dict = OrderedDict()
         for kwargs in GenArgDict(arg_dict):
@@ -0,0 +1,92 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _make_mlp():
+    layers = []
+    for _ in range(4):
+        layers += [flow.nn.Linear(512, 512), flow.nn.ReLU()]
+    layers.append(flow.nn.Linear(512, 1))
+    return flow.nn.Sequential(*layers)
+
+
+def _train_mlp(state_dict, x, offload, iter_num=3, lr=0.1):
+    model = _make_mlp().to("cuda")
+    model.load_state_dict(state_dict)
+    optimizer = flow.optim.SGD(model.parameters(), lr=lr)
+
+    class MLPTrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            if offload:
+                self.config.enable_activation_offload(
+                    True, threshold_mbyte=1, prefetch_distance=1
+                )
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = MLPTrainGraph()
+    losses = [graph(x).numpy() for _ in range(iter_num)]
+    params = [p.numpy() for p in model.parameters()]
+    op_names = [op.name for op in graph._full_graph_proto.net.op]
+    d2h_op_names = [
+        name for name in op_names if name.startswith("System-Activation-Offload-D2H_")
+    ]
+    h2d_op_names = [
+        name for name in op_names if name.startswith("System-Activation-Offload-H2D_")
+    ]
+    return losses, params, d2h_op_names, h2d_op_names
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestGraphActivationOffload(flow.unittest.TestCase):
+    def test_activation_offload(test_case):
+        state_dict = _make_mlp().state_dict()
+        # Each activation takes 2MB, over the threshold of 1MB.
+        x = flow.randn(1024, 512, device="cuda")
+
+        losses, params, d2h_names, h2d_names = _train_mlp(state_dict, x, False)
+        test_case.assertEqual(len(d2h_names), 0)
+        test_case.assertEqual(len(h2d_names), 0)
+        offload_losses, offload_params, d2h_names, h2d_names = _train_mlp(
+            state_dict, x, True
+        )
+        # Every offloaded activation is copied out and back in.
+        test_case.assertGreater(len(d2h_names), 0)
+        test_case.assertEqual(len(d2h_names), len(h2d_names))
+        for loss, offload_loss in zip(losses, offload_losses):
+            test_case.assertTrue(np.allclose(loss, offload_loss, rtol=1e-5, atol=1e-6))
+        for param, offload_param in zip(params, offload_params):
+            test_case.assertTrue(
+                np.allclose(param, offload_param, rtol=1e-5, atol=1e-6)
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,95 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _train_mlp(state_dict, x, budget_mbyte, iter_num=3, lr=0.1):
+    model = flow.nn.Sequential(
+        flow.nn.Linear(256, 512),
+        flow.nn.ReLU(),
+        flow.nn.Linear(512, 512),
+        flow.nn.GELU(),
+        flow.nn.Linear(512, 1),
+    ).to("cuda")
+    model.load_state_dict(state_dict)
+    optimizer = flow.optim.SGD(model.parameters(), lr=lr)
+
+    class MLPTrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            if budget_mbyte > 0:
+                self.config.set_auto_checkpointing_memory_budget(budget_mbyte)
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = MLPTrainGraph()
+    losses = []
+    grads = None
+    for i in range(iter_num):
+        params = [p.numpy() for p in model.parameters()]
+        losses.append(graph(x).numpy())
+        if i == 0:
+            # Plain SGD, the first update gives the gradients back.
+            grads = [(p - q.numpy()) / lr for p, q in zip(params, model.parameters())]
+    fake_op_names = [
+        op.name
+        for op in graph._full_graph_proto.net.op
+        if op.name.startswith("OneFlow-System-Checkpointing-Fake-Fw-Op_")
+    ]
+    return losses, grads, fake_op_names
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestGraphAutoCheckpointing(flow.unittest.TestCase):
+    def test_auto_checkpointing_memory_budget(test_case):
+        init_model = flow.nn.Sequential(
+            flow.nn.Linear(256, 512),
+            flow.nn.ReLU(),
+            flow.nn.Linear(512, 512),
+            flow.nn.GELU(),
+            flow.nn.Linear(512, 1),
+        )
+        state_dict = init_model.state_dict()
+        # Each activation takes 2MB, far over a budget of 1MB.
+        x = flow.randn(1024, 256, device="cuda")
+
+        losses, grads, fake_op_names = _train_mlp(state_dict, x, 0)
+        test_case.assertEqual(len(fake_op_names), 0)
+        budget_losses, budget_grads, budget_fake_op_names = _train_mlp(state_dict, x, 1)
+        # The relu and gelu outputs are recomputed, the matmuls never are.
+        test_case.assertGreater(len(budget_fake_op_names), 0)
+        for name in budget_fake_op_names:
+            test_case.assertNotIn("matmul", name)
+        for loss, budget_loss in zip(losses, budget_losses):
+            test_case.assertTrue(np.allclose(loss, budget_loss, rtol=1e-5, atol=1e-6))
+        for grad, budget_grad in zip(grads, budget_grads):
+            test_case.assertTrue(np.allclose(grad, budget_grad, rtol=1e-4, atol=1e-5))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,97 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _user_op_confs(graph, op_type_name):
+    return [
+        op.user_conf
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf") and op.user_conf.op_type_name == op_type_name
+    ]
+
+
+class _ConvBlock(flow.nn.Module):
+    def __init__(self, channels):
+        super().__init__()
+        self.conv1 = flow.nn.Conv2d(channels, channels, 3, padding=1, bias=False)
+        self.bn1 = flow.nn.BatchNorm2d(channels)
+        self.conv2 = flow.nn.Conv2d(channels, channels, 3, padding=1)
+        self.pool = flow.nn.MaxPool2d(2)
+
+    def forward(self, x):
+        h = flow.relu(self.bn1(self.conv1(x)))
+        h = self.conv2(h) + x
+        return self.pool(flow.relu(h))
+
+
+def _test_channels_last(test_case, dtype, expect_converted):
+    channels = 64
+    model = _ConvBlock(channels).to("cuda").to(dtype)
+    model.eval()
+    x = flow.tensor(
+        np.random.randn(8, channels, 32, 32), dtype=dtype, device="cuda"
+    )
+    eager_y = model(x)
+
+    class ChannelsLastGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.config.enable_channels_last(True)
+
+        def build(self, x):
+            return self.model(x)
+
+    graph = ChannelsLastGraph()
+    lazy_y = graph(x)
+    test_case.assertEqual(lazy_y.shape, eager_y.shape)
+    data_formats = [
+        conf.attr["data_format"].at_string
+        for conf in _user_op_confs(graph, "conv2d")
+    ]
+    transposes = _user_op_confs(graph, "transpose")
+    if expect_converted:
+        test_case.assertEqual(data_formats, ["channels_last"] * 2)
+        # The input and the two weights are transposed in, the output back out.
+        test_case.assertEqual(len(transposes), 4)
+    else:
+        test_case.assertEqual(data_formats, ["channels_first"] * 2)
+        test_case.assertEqual(len(transposes), 0)
+    tol = 1e-4 if dtype == flow.float32 else 1e-2
+    test_case.assertTrue(
+        np.allclose(lazy_y.numpy(), eager_y.numpy(), rtol=tol, atol=tol)
+    )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestChannelsLast(oneflow.unittest.TestCase):
+    def test_channels_last_half(test_case):
+        _test_channels_last(test_case, flow.float16, True)
+
+    def test_channels_last_float_kept(test_case):
+        # Float convs do not run on tensor cores, so nothing pays for the transposes.
+        _test_channels_last(test_case, flow.float32, False)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,78 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+from oneflow.test_utils.test_util import IsFp8CapableGpu
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _max_rel_error(out, ref):
+    return np.abs(out - ref).max() / np.abs(ref).max()
+
+
+class _LinearGraph(flow.nn.Graph):
+    def __init__(self, linear, fp8_matmul):
+        super().__init__()
+        self.linear = linear
+        self.config.enable_fp8_matmul(fp8_matmul, amax_history_len=4)
+
+    def build(self, x):
+        return self.linear(x)
+
+
+def _test_fp8_matmul_pass(test_case):
+    linear = flow.nn.Linear(32, 64, False).to("cuda")
+    # x is far below 1, so it mostly flushes to zero with the scale of 1 of the empty
+    # history of the first step.
+    x = flow.randn(16, 32, device="cuda") * 1e-3
+    fp8_graph = _LinearGraph(linear, True)
+    graph = _LinearGraph(linear, False)
+    ref = graph(x).numpy()
+    test_case.assertLess(_max_rel_error(ref, linear(x).numpy()), 1e-5)
+    test_case.assertGreater(_max_rel_error(fp8_graph(x).numpy(), ref), 0.2)
+    # The amax the first step wrote into the history variable scales x into the range of
+    # E4M3 from then on.
+    for _ in range(3):
+        test_case.assertLess(_max_rel_error(fp8_graph(x).numpy(), ref), 0.1)
+
+    fp8_op_type_names = _op_type_names(fp8_graph)
+    test_case.assertEqual(fp8_op_type_names.count("fp8_matmul"), 1)
+    test_case.assertNotIn("matmul", fp8_op_type_names)
+    op_type_names = _op_type_names(graph)
+    test_case.assertEqual(op_type_names.count("matmul"), 1)
+    test_case.assertNotIn("fp8_matmul", op_type_names)
+
+
+@unittest.skipIf(not IsFp8CapableGpu(), "needs a GPU with fp8 GEMMs")
+@flow.unittest.skip_unless_1n1d()
+class TestGraphFp8Matmul(oneflow.unittest.TestCase):
+    def test_fp8_matmul_pass(test_case):
+        _test_fp8_matmul_pass(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,103 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _scalar_chain_with_relu_tail(x):
+    # scalar ops with float and int operands, ending with relu whose output is renamed
+    y = flow.relu((x * 2.5 + 3) * -1 + 0.5)
+    return y + x, y
+
+
+def _long_chain(x):
+    # 12 element-wise ops, fused into chains of 8 and 4
+    y = x * 0.5 + 1
+    y = flow.nn.functional.silu(y) * 2 - 0.25
+    y = flow.nn.functional.leaky_relu(y, 0.1) * 3 + 2
+    y = flow.nn.functional.hardtanh(y, -2.0, 2.0) * 1.5 + 1
+    return flow.nn.functional.mish(y)
+
+
+def _test_fuse_elementwise_chain(test_case, func, num_fused_ops, device):
+    x = flow.tensor(np.random.randn(4, 33), dtype=flow.float32, device=device)
+
+    class ElementwiseChainGraph(flow.nn.Graph):
+        def __init__(self, enabled):
+            super().__init__()
+            self.config.allow_fuse_elementwise_chain(enabled)
+
+        def build(self, x):
+            return func(x)
+
+    eager_outputs = func(x)
+    if not isinstance(eager_outputs, tuple):
+        eager_outputs = (eager_outputs,)
+    for enabled in [True, False]:
+        graph = ElementwiseChainGraph(enabled)
+        lazy_outputs = graph(x)
+        if not isinstance(lazy_outputs, tuple):
+            lazy_outputs = (lazy_outputs,)
+        test_case.assertEqual(len(lazy_outputs), len(eager_outputs))
+        for lazy, eager in zip(lazy_outputs, eager_outputs):
+            test_case.assertTrue(
+                np.allclose(lazy.numpy(), eager.numpy(), rtol=1e-5, atol=1e-5)
+            )
+        op_type_names = _op_type_names(graph)
+        if enabled:
+            test_case.assertEqual(
+                op_type_names.count("fused_elementwise_chain"), num_fused_ops
+            )
+            test_case.assertNotIn("scalar_mul", op_type_names)
+            test_case.assertNotIn("scalar_add", op_type_names)
+            test_case.assertNotIn("relu", op_type_names)
+        else:
+            test_case.assertNotIn("fused_elementwise_chain", op_type_names)
+            test_case.assertIn("scalar_mul", op_type_names)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFuseElementwiseChain(oneflow.unittest.TestCase):
+    def test_fuse_elementwise_chain(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["func_and_num_fused_ops"] = [
+            (_scalar_chain_with_relu_tail, 1),
+            (_long_chain, 2),
+        ]
+        arg_dict["device"] = ["cpu"]
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"].append("cuda")
+        for (func, num_fused_ops), device in GenArgList(arg_dict):
+            _test_fuse_elementwise_chain(test_case, func, num_fused_ops, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,114 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _test_fuse_linear_relu(test_case, input_shape, dtype):
+    linear = flow.nn.Linear(input_shape[-1], 24).to("cuda").to(dtype)
+    x = flow.tensor(np.random.randn(*input_shape), dtype=dtype, device="cuda")
+    eager_out = flow.relu(linear(x))
+
+    class LinearReluGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.linear = linear
+            self.config.allow_fuse_matmul_bias_activation(True)
+
+        def build(self, x):
+            return flow.relu(self.linear(x))
+
+    graph = LinearReluGraph()
+    lazy_out = graph(x)
+    op_type_names = _op_type_names(graph)
+    test_case.assertIn("fused_matmul_bias", op_type_names)
+    test_case.assertNotIn("broadcast_add", op_type_names)
+    test_case.assertNotIn("relu", op_type_names)
+    tol = 1e-4 if dtype == flow.float32 else 1e-2
+    test_case.assertTrue(
+        np.allclose(lazy_out.numpy(), eager_out.numpy(), rtol=tol, atol=tol)
+    )
+
+
+def _test_fuse_linear_train(test_case):
+    x = np.random.randn(8, 16).astype(np.float32)
+
+    def make_linear():
+        linear = flow.nn.Linear(16, 32).to("cuda")
+        flow.nn.init.constant_(linear.weight, 0.01)
+        flow.nn.init.constant_(linear.bias, 0.1)
+        return linear
+
+    eager_linear = make_linear()
+    eager_optimizer = flow.optim.SGD(eager_linear.parameters(), lr=0.1)
+    lazy_linear = make_linear()
+
+    class LinearReluTrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.linear = lazy_linear
+            self.add_optimizer(flow.optim.SGD(lazy_linear.parameters(), lr=0.1))
+            self.config.allow_fuse_matmul_bias_activation(True)
+
+        def build(self, x):
+            loss = flow.relu(self.linear(x)).sum()
+            loss.backward()
+            return loss
+
+    graph = LinearReluTrainGraph()
+    for _ in range(3):
+        eager_loss = flow.relu(eager_linear(flow.tensor(x, device="cuda"))).sum()
+        eager_loss.backward()
+        eager_optimizer.step()
+        eager_optimizer.zero_grad()
+        lazy_loss = graph(flow.tensor(x, device="cuda"))
+        test_case.assertTrue(
+            np.allclose(lazy_loss.numpy(), eager_loss.numpy(), rtol=1e-4, atol=1e-4)
+        )
+    # relu_grad reads the output of relu, so the whole forward is still fused.
+    test_case.assertIn("fused_matmul_bias", _op_type_names(graph))
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestFuseMatmulBiasActivation(oneflow.unittest.TestCase):
+    def test_fuse_linear_relu_2d(test_case):
+        _test_fuse_linear_relu(test_case, (8, 16), flow.float32)
+
+    def test_fuse_linear_relu_3d(test_case):
+        _test_fuse_linear_relu(test_case, (2, 8, 16), flow.float32)
+
+    def test_fuse_linear_relu_half(test_case):
+        _test_fuse_linear_relu(test_case, (8, 16), flow.float16)
+
+    def test_fuse_linear_train(test_case):
+        _test_fuse_linear_train(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,93 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _test_fuse_residual_layer_norm(test_case, activation, dtype):
+    hidden_size = 64
+    linear = flow.nn.Linear(hidden_size, hidden_size).to("cuda").to(dtype)
+    norm = flow.nn.LayerNorm(hidden_size).to("cuda").to(dtype)
+    act = {"none": lambda x: x, "gelu": flow.gelu, "silu": flow.nn.functional.silu}[
+        activation
+    ]
+    x = flow.tensor(np.random.randn(4, 16, hidden_size), dtype=dtype, device="cuda")
+    residual = flow.tensor(
+        np.random.randn(4, 16, hidden_size), dtype=dtype, device="cuda"
+    )
+
+    def forward(x, residual):
+        h = linear(x) + residual
+        return act(norm(h)), h
+
+    eager_y, eager_h = forward(x, residual)
+
+    class ResidualNormGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.linear = linear
+            self.norm = norm
+            self.config.allow_fuse_residual_norm(True)
+
+        def build(self, x, residual):
+            return forward(x, residual)
+
+    graph = ResidualNormGraph()
+    lazy_y, lazy_h = graph(x, residual)
+    op_type_names = _op_type_names(graph)
+    test_case.assertIn("fused_residual_norm", op_type_names)
+    test_case.assertNotIn("layer_norm", op_type_names)
+    if activation != "none":
+        test_case.assertNotIn(activation, op_type_names)
+    tol = 1e-4 if dtype == flow.float32 else 1e-2
+    test_case.assertTrue(
+        np.allclose(lazy_y.numpy(), eager_y.numpy(), rtol=tol, atol=tol)
+    )
+    test_case.assertTrue(
+        np.allclose(lazy_h.numpy(), eager_h.numpy(), rtol=tol, atol=tol)
+    )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestFuseResidualNorm(oneflow.unittest.TestCase):
+    def test_fuse_residual_layer_norm(test_case):
+        _test_fuse_residual_layer_norm(test_case, "none", flow.float32)
+
+    def test_fuse_residual_layer_norm_gelu(test_case):
+        _test_fuse_residual_layer_norm(test_case, "gelu", flow.float32)
+
+    def test_fuse_residual_layer_norm_silu(test_case):
+        _test_fuse_residual_layer_norm(test_case, "silu", flow.float32)
+
+    def test_fuse_residual_layer_norm_half(test_case):
+        _test_fuse_residual_layer_norm(test_case, "gelu", flow.float16)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -112,6 +112,83 @@ def _test_grad_acc_graph(test_case, device):
             )
 
 
+def _train_data_parallel_with_grad_acc(defer_acc_boxing, lr=0.1, iter_num=3):
+    P = flow.placement("cuda", ranks=[0, 1])
+    B = flow.sbp.broadcast
+    model = flow.nn.Sequential(
+        flow.nn.Linear(8, 16), flow.nn.ReLU(), flow.nn.Linear(16, 4)
+    )
+    # Both runs start from the same parameters and see the same input.
+    rng = np.random.RandomState(0)
+    state_dict = {}
+    for k, v in model.state_dict().items():
+        value = rng.uniform(-0.5, 0.5, v.shape)
+        state_dict[k] = flow.tensor(value, dtype=flow.float32)
+    model.load_state_dict(state_dict)
+    model.to_global(placement=P, sbp=B)
+    optimizer = flow.optim.SGD(model.parameters(), lr=lr)
+    x = flow.tensor(rng.uniform(-1, 1, (16, 8)), dtype=flow.float32, placement=P, sbp=B)
+    x = x.to_global(sbp=flow.sbp.split(0))
+
+    class DataParallelGradAccGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.set_gradient_accumulation_steps(4)
+            self.config.proto.set_enable_defer_acc_boxing(defer_acc_boxing)
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = DataParallelGradAccGraph()
+    params = [[p.to_local().numpy() for p in model.parameters()]]
+    for _ in range(iter_num):
+        graph(x)
+        params.append([p.to_local().numpy() for p in model.parameters()])
+    # With plain SGD the update of a step is the learning rate times the gradient.
+    grads = [
+        [(prev - cur) / lr for (prev, cur) in zip(params[i], params[i + 1])]
+        for i in range(iter_num)
+    ]
+    proto = graph._full_graph_proto
+    nd_sbp_signatures = proto.job_parallel_view_conf.op_name2nd_sbp_signature_conf
+    acc_in_sbps = [
+        nd_sbp_signatures[op.name].bn_in_op2nd_sbp["in_0"].sbp_parallel[0]
+        for op in proto.net.op
+        if op.HasField("user_conf") and op.user_conf.op_type_name == "acc"
+    ]
+    return grads, params, acc_in_sbps
+
+
+def _test_defer_acc_boxing(test_case):
+    grads, params, acc_in_sbps = _train_data_parallel_with_grad_acc(False)
+    (
+        deferred_grads,
+        deferred_params,
+        deferred_acc_in_sbps,
+    ) = _train_data_parallel_with_grad_acc(True)
+    # Only with the pass, the gradients of the 4 broadcast parameters are accumulated as
+    # partial sums before they are all-reduced.
+    test_case.assertEqual(len(deferred_acc_in_sbps), 4)
+    test_case.assertTrue(
+        all(sbp.HasField("partial_sum_parallel") for sbp in deferred_acc_in_sbps)
+    )
+    test_case.assertFalse(
+        any(sbp.HasField("partial_sum_parallel") for sbp in acc_in_sbps)
+    )
+    for step_grads, deferred_step_grads in zip(grads, deferred_grads):
+        for grad, deferred_grad in zip(step_grads, deferred_step_grads):
+            test_case.assertTrue(np.allclose(grad, deferred_grad, rtol=1e-4, atol=1e-5))
+    for step_params, deferred_step_params in zip(params, deferred_params):
+        for param, deferred_param in zip(step_params, deferred_step_params):
+            test_case.assertTrue(
+                np.allclose(param, deferred_param, rtol=1e-5, atol=1e-6)
+            )
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestGradAccGraph(oneflow.unittest.TestCase):
@@ -122,5 +199,12 @@ class TestGradAccGraph(oneflow.unittest.TestCase):
         _test_grad_acc_graph(test_case, flow.device("cpu"))
 
 
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n2d()
+class TestDeferAccBoxingGraph(oneflow.unittest.TestCase):
+    def test_defer_acc_boxing(test_case):
+        _test_defer_acc_boxing(test_case)
+
+
 if __name__ == "__main__":
     unittest.main()
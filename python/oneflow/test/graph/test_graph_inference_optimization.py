@@ -0,0 +1,164 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _randomize_bn_stats(bn):
+    num_features = bn.num_features
+    bn.running_mean.copy_(flow.randn(num_features))
+    bn.running_var.copy_(flow.rand(num_features) + 0.5)
+    bn.weight.data.copy_(flow.randn(num_features))
+    bn.bias.data.copy_(flow.randn(num_features))
+
+
+class _ConvBn(flow.nn.Module):
+    input_shape = (4, 3, 6, 6)
+
+    def __init__(self):
+        super().__init__()
+        self.conv = flow.nn.Conv2d(3, 8, 3, padding=1)
+        self.bn = flow.nn.BatchNorm2d(8)
+        _randomize_bn_stats(self.bn)
+
+    def forward(self, x):
+        return self.bn(self.conv(x))
+
+
+class _LinearBiasAddBn(flow.nn.Module):
+    input_shape = (4, 12)
+
+    def __init__(self):
+        super().__init__()
+        self.weight = flow.nn.Parameter(flow.randn(16, 12))
+        self.bias = flow.nn.Parameter(flow.randn(16))
+        self.bn = flow.nn.BatchNorm1d(16)
+        _randomize_bn_stats(self.bn)
+
+    def forward(self, x):
+        y = flow._C.matmul(x, self.weight, transpose_a=False, transpose_b=True)
+        return self.bn(flow._C.bias_add(y, self.bias, axis=1))
+
+
+class _DuplicatedSubexpression(flow.nn.Module):
+    input_shape = (4, 12)
+
+    def __init__(self):
+        super().__init__()
+        self.weight = flow.nn.Parameter(flow.randn(16, 12))
+
+    def forward(self, x):
+        a = flow.sigmoid(flow._C.matmul(x, self.weight, transpose_b=True))
+        b = flow.sigmoid(flow._C.matmul(x, self.weight, transpose_b=True))
+        return a * b
+
+
+class _VariableOnlyChain(flow.nn.Module):
+    input_shape = (4, 12)
+
+    def __init__(self):
+        super().__init__()
+        self.scale = flow.nn.Parameter(flow.randn(12))
+
+    def forward(self, x):
+        folded = flow.sin(self.scale * 2.0 + 1.0)
+        return x * folded
+
+
+def _test_inference_graph_optimization(test_case, model_cls, device):
+    model = model_cls().to(device)
+    model.eval()
+    x = flow.randn(*model_cls.input_shape, device=device)
+
+    class InferenceGraph(flow.nn.Graph):
+        def __init__(self, enabled):
+            super().__init__()
+            self.model = model
+            self.config.enable_inference_graph_optimization(enabled)
+
+        def build(self, x):
+            return self.model(x)
+
+    eager_y = model(x)
+    graph = InferenceGraph(True)
+    lazy_y = graph(x)
+    reference_graph = InferenceGraph(False)
+    reference_y = reference_graph(x)
+    test_case.assertTrue(
+        np.allclose(lazy_y.numpy(), eager_y.numpy(), rtol=1e-4, atol=1e-4)
+    )
+    test_case.assertTrue(
+        np.allclose(reference_y.numpy(), eager_y.numpy(), rtol=1e-4, atol=1e-4)
+    )
+
+    op_type_names = _op_type_names(graph)
+    reference_op_type_names = _op_type_names(reference_graph)
+    if model_cls in (_ConvBn, _LinearBiasAddBn):
+        test_case.assertIn("normalization", reference_op_type_names)
+        test_case.assertNotIn("normalization", op_type_names)
+    elif model_cls is _DuplicatedSubexpression:
+        test_case.assertEqual(reference_op_type_names.count("sigmoid"), 2)
+        test_case.assertEqual(op_type_names.count("sigmoid"), 1)
+        test_case.assertEqual(op_type_names.count("matmul"), 1)
+    elif model_cls is _VariableOnlyChain:
+        test_case.assertIn("sin", reference_op_type_names)
+        test_case.assertNotIn("sin", op_type_names)
+
+    # The folded variables follow the parameters loaded after compiling.
+    new_model = model_cls().to(device)
+    new_model.eval()
+    model.load_state_dict(new_model.state_dict())
+    eager_y = model(x)
+    lazy_y = graph(x)
+    test_case.assertTrue(
+        np.allclose(lazy_y.numpy(), eager_y.numpy(), rtol=1e-4, atol=1e-4)
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphInferenceOptimization(oneflow.unittest.TestCase):
+    def test_inference_graph_optimization(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["model_cls"] = [
+            _ConvBn,
+            _LinearBiasAddBn,
+            _DuplicatedSubexpression,
+            _VariableOnlyChain,
+        ]
+        arg_dict["device"] = ["cpu"]
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"].append("cuda")
+        for arg in GenArgList(arg_dict):
+            _test_inference_graph_optimization(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,108 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _make_model():
+    model = flow.nn.Sequential(
+        flow.nn.Linear(16, 32), flow.nn.ReLU(), flow.nn.Linear(32, 4)
+    ).to("cuda")
+    for param in model.parameters():
+        flow.nn.init.constant_(param, 0.05)
+    return model
+
+
+def _test_multi_tensor_update(test_case, make_optimizer, multi_tensor_op_type_name):
+    x = np.random.randn(8, 16).astype(np.float32)
+
+    eager_model = _make_model()
+    eager_optimizer = make_optimizer(eager_model.parameters())
+    lazy_model = _make_model()
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = lazy_model
+            self.add_optimizer(make_optimizer(lazy_model.parameters()))
+            self.config.allow_multi_tensor_model_update(True)
+
+        def build(self, x):
+            loss = self.model(x).sum()
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    for _ in range(3):
+        eager_loss = eager_model(flow.tensor(x, device="cuda")).sum()
+        eager_loss.backward()
+        eager_optimizer.step()
+        eager_optimizer.zero_grad()
+        lazy_loss = graph(flow.tensor(x, device="cuda"))
+        test_case.assertTrue(
+            np.allclose(lazy_loss.numpy(), eager_loss.numpy(), rtol=1e-4, atol=1e-4)
+        )
+    op_type_names = _op_type_names(graph)
+    test_case.assertEqual(op_type_names.count(multi_tensor_op_type_name), 1)
+    for eager_param, lazy_param in zip(
+        eager_model.parameters(), lazy_model.parameters()
+    ):
+        test_case.assertTrue(
+            np.allclose(
+                lazy_param.numpy(), eager_param.numpy(), rtol=1e-4, atol=1e-4
+            )
+        )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestMultiTensorModelUpdate(oneflow.unittest.TestCase):
+    def test_multi_tensor_sgd_update(test_case):
+        _test_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.SGD(params, lr=0.1),
+            "multi_tensor_sgd_update",
+        )
+
+    def test_multi_tensor_momentum_update(test_case):
+        _test_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.SGD(params, lr=0.1, momentum=0.9),
+            "multi_tensor_momentum_update",
+        )
+
+    def test_multi_tensor_adam_update(test_case):
+        _test_multi_tensor_update(
+            test_case,
+            lambda params: flow.optim.Adam(params, lr=0.01),
+            "multi_tensor_adam_update",
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
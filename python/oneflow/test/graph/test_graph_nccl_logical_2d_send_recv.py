@@ -0,0 +1,99 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+# Read once, the direct path further needs nccl on the compute stream, which is what
+# turns it on and off below.
+os.environ["ONEFLOW_BOXING_ENABLE_2D_SEND_RECV"] = "1"
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+class _ToGlobalGraph(flow.nn.Graph):
+    def __init__(self, dst_sbp):
+        super().__init__()
+        self.dst_sbp = dst_sbp
+
+    def build(self, x):
+        return x.to_global(sbp=self.dst_sbp)
+
+
+def _run_transitions(transitions, x_np, placement):
+    outs, op_type_names = [], []
+    for (src_sbp, dst_sbp) in transitions:
+        x = flow.tensor(x_np, placement=placement, sbp=[flow.sbp.broadcast] * 2)
+        graph = _ToGlobalGraph(dst_sbp)
+        y = graph(x.to_global(sbp=src_sbp))
+        outs.append((tuple(y.sbp), y.to_global(sbp=[flow.sbp.broadcast] * 2)))
+        op_type_names.append(_op_type_names(graph))
+    return outs, op_type_names
+
+
+def _test_2d_send_recv(test_case):
+    B = flow.sbp.broadcast
+    S0 = flow.sbp.split(0)
+    S1 = flow.sbp.split(1)
+    # Transitions changing both dims, which otherwise go through a middle nd_sbp.
+    transitions = [
+        ((S0, S1), (B, S0)),
+        ((S1, S0), (S0, B)),
+        ((S0, B), (S1, S0)),
+        ((B, S1), (S0, B)),
+        ((S0, S1), (S1, S0)),
+    ]
+    placement = flow.placement("cuda", ranks=np.array(range(4)).reshape(2, 2))
+    x_np = np.arange(8 * 8 * 4, dtype=np.float32).reshape(8, 8, 4)
+    outs, op_type_names = _run_transitions(transitions, x_np, placement)
+    flow.boxing.nccl.enable_use_compute_stream(True)
+    try:
+        direct_outs, direct_op_type_names = _run_transitions(
+            transitions, x_np, placement
+        )
+    finally:
+        flow.boxing.nccl.enable_use_compute_stream(False)
+    for i, (_, dst_sbp) in enumerate(transitions):
+        test_case.assertNotIn("_nccl_logical_2D_send_recv", op_type_names[i])
+        test_case.assertEqual(
+            direct_op_type_names[i].count("_nccl_logical_2D_send_recv"), 1
+        )
+        (sbp, out), (direct_sbp, direct_out) = outs[i], direct_outs[i]
+        test_case.assertEqual(sbp, dst_sbp)
+        test_case.assertEqual(direct_sbp, dst_sbp)
+        test_case.assertTrue(np.array_equal(out.to_local().numpy(), x_np))
+        test_case.assertTrue(np.array_equal(direct_out.to_local().numpy(), x_np))
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n4d()
+class TestGraphNcclLogical2DSendRecv(oneflow.unittest.TestCase):
+    def test_2d_send_recv(test_case):
+        _test_2d_send_recv(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
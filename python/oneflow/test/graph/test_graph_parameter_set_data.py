@@ -0,0 +1,51 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphParameterSetData(oneflow.unittest.TestCase):
+    def test_set_data_between_runs(test_case):
+        linear = flow.nn.Linear(4, 3, bias=False)
+        flow.nn.init.constant_(linear.weight, 1.0)
+
+        class LinearGraph(flow.nn.Graph):
+            def __init__(self):
+                super().__init__()
+                self.linear = linear
+
+            def build(self, x):
+                return self.linear(x)
+
+        graph = LinearGraph()
+        x = flow.tensor(np.arange(8, dtype=np.float32).reshape(2, 4))
+        test_case.assertTrue(
+            np.allclose(graph(x).numpy(), x.numpy().dot(np.ones((4, 3))))
+        )
+        # The tensor stays the same, its blob is replaced.
+        weight = np.random.randn(3, 4).astype(np.float32)
+        linear.weight.data = flow.tensor(weight)
+        test_case.assertTrue(
+            np.allclose(graph(x).numpy(), x.numpy().dot(weight.T), atol=1e-5)
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
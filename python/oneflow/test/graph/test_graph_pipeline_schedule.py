@@ -0,0 +1,122 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+rank = flow.env.get_rank()
+
+
+def _train_pipeline(schedule, iter_num=3):
+    P0 = flow.placement("cuda", ranks=[0])
+    P1 = flow.placement("cuda", ranks=[1])
+    P01 = flow.placement("cuda", ranks=[0, 1])
+    B = flow.sbp.broadcast
+    # Four stages interleaved on two devices, the other schedules merge the stages of
+    # each device into one.
+    placements = [P0, P1, P0, P1]
+    rng = np.random.RandomState(0)
+    layers = []
+    for i, placement in enumerate(placements):
+        layer = flow.nn.Linear(16, 1 if i == len(placements) - 1 else 16)
+        state_dict = {}
+        for k, v in layer.state_dict().items():
+            value = rng.uniform(-0.5, 0.5, v.shape)
+            state_dict[k] = flow.tensor(value, dtype=flow.float32)
+        layer.load_state_dict(state_dict)
+        layers.append(layer.to_global(placement=placement, sbp=B))
+    x = flow.tensor(rng.uniform(-1, 1, (8, 16)), dtype=flow.float32)
+    x = x.to_global(placement=P0, sbp=B)
+
+    class PipelineModule(flow.nn.Module):
+        def __init__(self):
+            super().__init__()
+            self.layers = flow.nn.ModuleList(layers)
+
+        def forward(self, x):
+            for layer, placement in zip(self.layers, placements):
+                x = layer(x.to_global(placement=placement, sbp=B)).relu()
+            return x
+
+    pp_m = PipelineModule()
+    optimizer = flow.optim.SGD(pp_m.parameters(), lr=0.01)
+
+    class PipelineGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.pp_m = pp_m
+            for stage_id, layer in enumerate(self.pp_m.layers):
+                layer.config.stage_id = stage_id
+            self.config.set_gradient_accumulation_steps(4)
+            if schedule is not None:
+                self.config.set_pipeline_schedule(schedule)
+            self.add_optimizer(optimizer)
+
+        def build(self, x):
+            loss = self.pp_m(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = PipelineGraph()
+    losses = []
+    for _ in range(iter_num):
+        loss = graph(x)
+        if rank == 1:
+            # The loss is a 0-size tensor on the other rank.
+            losses.append(loss.to_local().numpy())
+    params = [
+        p.to_global(placement=P01, sbp=B).to_local().numpy()
+        for p in pp_m.parameters()
+    ]
+    buffer_sizes = [
+        op.user_conf.attr["buffer_size"].at_int64
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf") and op.user_conf.op_type_name == "identity_buffer"
+    ]
+    return losses, params, buffer_sizes
+
+
+def _test_pipeline_schedule(test_case):
+    losses, params, buffer_sizes = _train_pipeline(None)
+    # The forward to backward buffers of the merged stages 2 and 3 hold twice the
+    # number of stages.
+    test_case.assertEqual(max(buffer_sizes), 8)
+    # 1F1B holds as many micro-batches as the stages from a stage to the last one,
+    # interleaved counts the virtual stages.
+    for schedule, max_buffer_size in [("1f1b", 2), ("interleaved", 4)]:
+        schedule_losses, schedule_params, buffer_sizes = _train_pipeline(schedule)
+        test_case.assertEqual(max(buffer_sizes), max_buffer_size)
+        for loss, schedule_loss in zip(losses, schedule_losses):
+            test_case.assertTrue(np.allclose(loss, schedule_loss, rtol=1e-5, atol=1e-6))
+        for param, schedule_param in zip(params, schedule_params):
+            test_case.assertTrue(
+                np.allclose(param, schedule_param, rtol=1e-5, atol=1e-6)
+            )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n2d()
+class TestGraphPipelineSchedule(oneflow.unittest.TestCase):
+    def test_pipeline_schedule(test_case):
+        _test_pipeline_schedule(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
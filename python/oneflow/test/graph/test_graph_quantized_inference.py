@@ -0,0 +1,88 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _op_type_names(graph):
+    return [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+
+
+def _test_quantized_inference(test_case, device):
+    model = flow.nn.Sequential(
+        flow.nn.Linear(32, 16), flow.nn.ReLU(), flow.nn.Linear(16, 8)
+    ).to(device)
+    model.eval()
+    x = flow.randn(6, 32, device=device)
+
+    class QuantizedInferenceGraph(flow.nn.Graph):
+        def __init__(self, int8_inference):
+            super().__init__()
+            self.model = model
+            self.config.proto.set_enable_quantization_aware_training(True)
+            qat_config = self.config.proto.mutable_qat_config()
+            # The observers of the activations take their scales from this batch.
+            qat_config.set_calibration(True)
+            qat_config.set_int8_inference(int8_inference)
+
+        def build(self, x):
+            return self.model(x)
+
+    fake_quant_graph = QuantizedInferenceGraph(False)
+    fake_quant_y = fake_quant_graph(x)
+    int8_graph = QuantizedInferenceGraph(True)
+    int8_y = int8_graph(x)
+
+    fake_quant_op_type_names = _op_type_names(fake_quant_graph)
+    test_case.assertEqual(fake_quant_op_type_names.count("matmul"), 2)
+    test_case.assertIn("fake_quantization", fake_quant_op_type_names)
+    test_case.assertNotIn("quantized_matmul", fake_quant_op_type_names)
+    int8_op_type_names = _op_type_names(int8_graph)
+    test_case.assertEqual(int8_op_type_names.count("quantized_matmul"), 2)
+    test_case.assertNotIn("matmul", int8_op_type_names)
+    test_case.assertNotIn("fake_quantization", int8_op_type_names)
+    # Both compute with the same quantized operands, in float or with int32 sums.
+    test_case.assertTrue(
+        np.allclose(int8_y.numpy(), fake_quant_y.numpy(), rtol=1e-4, atol=1e-4)
+    )
+    # And stay close to the float model.
+    test_case.assertTrue(np.abs(int8_y.numpy() - model(x).numpy()).max() < 0.1)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphQuantizedInference(oneflow.unittest.TestCase):
+    def test_quantized_inference(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu"]
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"].append("cuda")
+        for arg in GenArgList(arg_dict):
+            _test_quantized_inference(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class _TensorParallelBlock(flow.nn.Module):
+    def __init__(self, hidden_size):
+        super().__init__()
+        self.column_linear = flow.nn.Linear(hidden_size, hidden_size * 2)
+        self.row_linear = flow.nn.Linear(hidden_size * 2, hidden_size, False)
+        self.norm = flow.nn.LayerNorm(hidden_size)
+        self.head = flow.nn.Linear(hidden_size, 4)
+
+    def forward(self, x):
+        h = flow.nn.functional.gelu(self.column_linear(x))
+        # The residual add consumes the partial sum of the row parallel linear as
+        # broadcast, the add and the layer norm after it make the sequence-wise region.
+        return self.head(self.norm(self.row_linear(h) + x))
+
+
+def _train_with_sequence_parallel(sequence_parallel, iter_num=4):
+    P = flow.placement("cuda", ranks=[0, 1])
+    B = flow.sbp.broadcast
+    model = _TensorParallelBlock(16)
+    # Both runs start from the same parameters and see the same input.
+    rng = np.random.RandomState(0)
+    state_dict = {}
+    for k, v in model.state_dict().items():
+        state_dict[k] = flow.tensor(rng.uniform(-0.5, 0.5, v.shape), dtype=flow.float32)
+    model.load_state_dict(state_dict)
+    model.to_global(placement=P, sbp=B)
+    # Megatron style tensor parallelism, the column parallel linear is split along its
+    # outputs and the row parallel one along its inputs.
+    model.column_linear.weight = flow.nn.Parameter(
+        model.column_linear.weight.to_global(sbp=flow.sbp.split(0))
+    )
+    model.column_linear.bias = flow.nn.Parameter(
+        model.column_linear.bias.to_global(sbp=flow.sbp.split(0))
+    )
+    model.row_linear.weight = flow.nn.Parameter(
+        model.row_linear.weight.to_global(sbp=flow.sbp.split(1))
+    )
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.1)
+    x = flow.tensor(rng.uniform(-1, 1, (8, 16)), dtype=flow.float32, placement=P, sbp=B)
+
+    class SequenceParallelGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.enable_sequence_parallel(sequence_parallel, axis=0)
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = SequenceParallelGraph()
+    losses = [graph(x).to_local().numpy() for _ in range(iter_num)]
+    params = [p.to_global(sbp=B).to_local().numpy() for p in model.parameters()]
+    op_names = [op.name for op in graph._full_graph_proto.net.op]
+    return losses, params, op_names
+
+
+def _test_sequence_parallel(test_case):
+    losses, params, op_names = _train_with_sequence_parallel(False)
+    sp_losses, sp_params, sp_op_names = _train_with_sequence_parallel(True)
+    scatter_prefix = "System-Sequence-Parallel-Scatter-"
+    gather_prefix = "System-Sequence-Parallel-Gather-"
+    test_case.assertFalse(any(name.startswith(scatter_prefix) for name in op_names))
+    # The output of the row parallel linear and the residual are scattered, the output
+    # of the layer norm is gathered for the head.
+    test_case.assertEqual(
+        len([name for name in sp_op_names if name.startswith(scatter_prefix)]), 2
+    )
+    test_case.assertEqual(
+        len([name for name in sp_op_names if name.startswith(gather_prefix)]), 1
+    )
+    for loss, sp_loss in zip(losses, sp_losses):
+        test_case.assertTrue(np.allclose(loss, sp_loss, rtol=1e-4, atol=1e-5))
+    for param, sp_param in zip(params, sp_params):
+        test_case.assertTrue(np.allclose(param, sp_param, rtol=1e-4, atol=1e-5))
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n2d()
+class TestGraphSequenceParallel(oneflow.unittest.TestCase):
+    def test_sequence_parallel(test_case):
+        _test_sequence_parallel(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class _TensorParallelMLP(flow.nn.Module):
+    def __init__(self, hidden_size):
+        super().__init__()
+        self.column_linear = flow.nn.Linear(hidden_size, hidden_size * 2)
+        self.row_linear = flow.nn.Linear(hidden_size * 2, hidden_size, False)
+
+    def forward(self, x):
+        h = flow.nn.functional.gelu(self.column_linear(x))
+        # The residual add takes the partial sum of the row parallel linear all-reduced.
+        return self.row_linear(h) + x
+
+
+def _train_with_comm_overlap(comm_overlap, iter_num=3):
+    P = flow.placement("cuda", ranks=[0, 1])
+    B = flow.sbp.broadcast
+    model = _TensorParallelMLP(1024)
+    # Both runs start from the same parameters and see the same input.
+    rng = np.random.RandomState(0)
+    state_dict = {}
+    for k, v in model.state_dict().items():
+        value = rng.uniform(-0.05, 0.05, v.shape)
+        state_dict[k] = flow.tensor(value, dtype=flow.float32)
+    model.load_state_dict(state_dict)
+    model.to_global(placement=P, sbp=B)
+    model.column_linear.weight = flow.nn.Parameter(
+        model.column_linear.weight.to_global(sbp=flow.sbp.split(0))
+    )
+    model.column_linear.bias = flow.nn.Parameter(
+        model.column_linear.bias.to_global(sbp=flow.sbp.split(0))
+    )
+    model.row_linear.weight = flow.nn.Parameter(
+        model.row_linear.weight.to_global(sbp=flow.sbp.split(1))
+    )
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.1)
+    # The 4MB output of the row parallel linear makes 4 chunks of 1MB.
+    x = flow.tensor(
+        rng.uniform(-1, 1, (1024, 1024)), dtype=flow.float32, placement=P, sbp=B
+    )
+
+    class CommOverlapGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.enable_tensor_parallel_comm_overlap(
+                comm_overlap, max_num_chunks=4, min_chunk_mbyte=1
+            )
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = CommOverlapGraph()
+    losses = [graph(x).to_local().numpy() for _ in range(iter_num)]
+    params = [p.to_global(sbp=B).to_local().numpy() for p in model.parameters()]
+    op_names = [op.name for op in graph._full_graph_proto.net.op]
+    return losses, params, op_names
+
+
+def _test_tensor_parallel_comm_overlap(test_case):
+    losses, params, op_names = _train_with_comm_overlap(False)
+    overlap_losses, overlap_params, overlap_op_names = _train_with_comm_overlap(True)
+    test_case.assertFalse(any("-overlap_chunk" in name for name in op_names))
+    chunk_all_reduce_names = [
+        name
+        for name in overlap_op_names
+        if "-overlap_chunk" in name and name.endswith("-all_reduce")
+    ]
+    test_case.assertEqual(len(chunk_all_reduce_names), 4)
+    test_case.assertEqual(
+        len([name for name in overlap_op_names if name.endswith("-overlap_concat")]), 1
+    )
+    for loss, overlap_loss in zip(losses, overlap_losses):
+        test_case.assertTrue(np.allclose(loss, overlap_loss, rtol=1e-4, atol=1e-5))
+    for param, overlap_param in zip(params, overlap_params):
+        test_case.assertTrue(np.allclose(param, overlap_param, rtol=1e-4, atol=1e-5))
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n2d()
+class TestGraphTensorParallelCommOverlap(oneflow.unittest.TestCase):
+    def test_tensor_parallel_comm_overlap(test_case):
+        _test_tensor_parallel_comm_overlap(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -100,6 +100,54 @@ def _test_linear_train_graph_with_zero(test_case, zero_stage=1):
     graph_check_list = train_with_graph(iter_num)
 
 
+def _train_mlp_with_zero_stage(stage, iter_num=4):
+    P = flow.placement("cuda", ranks=[0, 1])
+    B = flow.sbp.broadcast
+    S0 = flow.sbp.split(0)
+    model = flow.nn.Sequential(
+        flow.nn.Linear(16, 32), flow.nn.ReLU(), flow.nn.Linear(32, 8)
+    )
+    model = model.to_global(placement=P, sbp=B)
+    # Both runs start from the same parameters and see the same input.
+    rng = np.random.RandomState(0)
+    state_dict = {}
+    for k, v in model.state_dict().items():
+        value = rng.uniform(-0.5, 0.5, v.shape)
+        state_dict[k] = flow.tensor(value, dtype=flow.float32, placement=P, sbp=B)
+    model.load_state_dict(state_dict)
+    optimizer = flow.optim.Adam(model.parameters(), lr=0.01)
+    x = flow.tensor(rng.uniform(-1, 1, (8, 16)), dtype=flow.float32, placement=P, sbp=B)
+    x = x.to_global(sbp=S0)
+
+    class MLPTrainGraphWithZeRO(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.set_zero_redundancy_optimizer_mode("distributed_split")
+            self.config.set_zero_redundancy_optimizer_min_size_after_split(1)
+            self.config.set_zero_redundancy_optimizer_stage(stage, prefetch_distance=1)
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = MLPTrainGraphWithZeRO()
+    losses = [graph(x).to_global(sbp=B).to_local().numpy() for _ in range(iter_num)]
+    params = [p.to_global(sbp=B).to_local().numpy() for p in model.parameters()]
+    return losses, params
+
+
+def _test_zero_stage3_matches_stage1(test_case):
+    losses, params = _train_mlp_with_zero_stage(1)
+    stage3_losses, stage3_params = _train_mlp_with_zero_stage(3)
+    for loss, stage3_loss in zip(losses, stage3_losses):
+        test_case.assertTrue(np.allclose(loss, stage3_loss, rtol=1e-5, atol=1e-6))
+    for param, stage3_param in zip(params, stage3_params):
+        test_case.assertTrue(np.allclose(param, stage3_param, rtol=1e-5, atol=1e-6))
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n2d()
 class TestLinearTrainGraphWithZeRO(oneflow.unittest.TestCase):
@@ -112,6 +160,9 @@ class TestLinearTrainGraphWithZeRO(oneflow.unittest.TestCase):
     def test_linear_train_graph_with_zero_3(test_case):
         _test_linear_train_graph_with_zero(test_case, 3)
 
+    def test_zero_stage3_matches_stage1(test_case):
+        _test_zero_stage3_matches_stage1(test_case)
+
 
 if __name__ == "__main__":
     unittest.main()
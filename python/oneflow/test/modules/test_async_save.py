@@ -0,0 +1,66 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_async_save(test_case, device):
+    m = flow.nn.Linear(64, 32).to(device)
+    expected = {k: v.numpy() for k, v in m.state_dict().items()}
+    with tempfile.TemporaryDirectory() as save_dir:
+        handle = flow.save(m.state_dict(), save_dir, async_save=True)
+        # The saved values are the ones at the time of the save.
+        with flow.no_grad():
+            m.weight.fill_(0.0)
+            m.bias.add_(1.0)
+        handle.wait()
+        test_case.assertTrue(handle.done())
+        loaded = flow.load(save_dir)
+    for k, v in expected.items():
+        test_case.assertTrue(np.array_equal(loaded[k].numpy(), v))
+
+
+def _test_consecutive_async_saves(test_case, device):
+    x = flow.randn(16, 16, device=device)
+    with tempfile.TemporaryDirectory() as save_dir:
+        dirs = [os.path.join(save_dir, str(i)) for i in range(3)]
+        for i, d in enumerate(dirs):
+            # Each save waits for the previous one first.
+            flow.save({"x": x + i}, d, async_save=True)
+        handle = flow.save({"x": x + len(dirs)}, os.path.join(save_dir, "last"))
+        test_case.assertIsNone(handle)
+        for i, d in enumerate(dirs):
+            loaded = flow.load(d)
+            test_case.assertTrue(np.allclose(loaded["x"].numpy(), (x + i).numpy()))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestAsyncSave(flow.unittest.TestCase):
+    def test_async_save(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            _test_async_save(test_case, device)
+            _test_consecutive_async_saves(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,96 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+from oneflow.test_utils.test_util import GenArgList
+
+from test_nms import nms_np
+
+
+def _batched_nms_np(
+    boxes, scores, iou_threshold, score_threshold, pre_nms_top_n, max_output
+):
+    batch_size, num_classes, num_boxes = scores.shape
+    results = []
+    for b in range(batch_size):
+        detections = []
+        for c in range(num_classes):
+            class_boxes = boxes[b, c] if boxes.ndim == 4 else boxes[b]
+            order = np.argsort(-scores[b, c], kind="stable")
+            if pre_nms_top_n > 0:
+                order = order[:pre_nms_top_n]
+            order = order[scores[b, c, order] > score_threshold]
+            keep = nms_np(class_boxes[order], scores[b, c, order], iou_threshold)
+            for k in keep.astype(np.int64):
+                detections.append((scores[b, c, order[k]], c, order[k]))
+        detections.sort(key=lambda d: -d[0])
+        results.append(detections[:max_output])
+    return results
+
+
+def _test_batched_nms(test_case, device, per_class_boxes, pre_nms_top_n):
+    batch_size, num_classes, num_boxes, max_output = 3, 4, 200, 50
+    shape = (batch_size, num_boxes)
+    if per_class_boxes:
+        shape = (batch_size, num_classes, num_boxes)
+    boxes = np.random.rand(*shape, 4).astype(np.float32) * 100
+    boxes[..., 2:] += boxes[..., :2]
+    scores = np.random.rand(batch_size, num_classes, num_boxes).astype(np.float32)
+    out_boxes, out_scores, out_classes, out_indices, num_detections = flow.batched_nms(
+        flow.tensor(boxes, device=device),
+        flow.tensor(scores, device=device),
+        iou_threshold=0.5,
+        score_threshold=0.2,
+        pre_nms_top_n=pre_nms_top_n,
+        max_output_per_image=max_output,
+    )
+    expected = _batched_nms_np(boxes, scores, 0.5, 0.2, pre_nms_top_n, max_output)
+    for b in range(batch_size):
+        n = len(expected[b])
+        test_case.assertEqual(num_detections[b].item(), n)
+        test_case.assertTrue(
+            np.allclose(out_scores[b, :n].numpy(), [d[0] for d in expected[b]])
+        )
+        test_case.assertTrue(
+            np.array_equal(out_classes[b, :n].numpy(), [d[1] for d in expected[b]])
+        )
+        test_case.assertTrue(
+            np.array_equal(out_indices[b, :n].numpy(), [d[2] for d in expected[b]])
+        )
+        for j, (_, c, i) in enumerate(expected[b]):
+            box = boxes[b, c, i] if per_class_boxes else boxes[b, i]
+            test_case.assertTrue(np.allclose(out_boxes[b, j].numpy(), box))
+        test_case.assertTrue(np.all(out_classes[b, n:].numpy() == -1))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestBatchedNMS(flow.unittest.TestCase):
+    def test_batched_nms(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cuda"]
+        arg_dict["per_class_boxes"] = [False, True]
+        arg_dict["pre_nms_top_n"] = [-1, 64]
+        for arg in GenArgList(arg_dict):
+            _test_batched_nms(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
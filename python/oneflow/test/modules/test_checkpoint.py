@@ -0,0 +1,93 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+from oneflow.utils.checkpoint import checkpoint
+
+
+def _test_checkpoint_grad(test_case, device):
+    x_np = np.random.randn(4, 8).astype(np.float32)
+    w_np = np.random.randn(8, 6).astype(np.float32)
+
+    def segment(x, w):
+        h = flow.matmul(x, w)
+        h = flow.relu(h).reshape(2, 12)
+        return flow.tanh(h) * 2, h.sum()
+
+    grads = []
+    for use_checkpoint in [False, True]:
+        x = flow.tensor(x_np, device=device, requires_grad=True)
+        w = flow.tensor(w_np, device=device, requires_grad=True)
+        if use_checkpoint:
+            y, s = checkpoint(segment, x, w)
+        else:
+            y, s = segment(x, w)
+        test_case.assertTrue(y.requires_grad)
+        test_case.assertFalse(y.is_leaf)
+        (y.sum() + s).backward()
+        grads.append((x.grad.numpy(), w.grad.numpy()))
+    test_case.assertTrue(np.allclose(grads[0][0], grads[1][0], rtol=1e-4, atol=1e-4))
+    test_case.assertTrue(np.allclose(grads[0][1], grads[1][1], rtol=1e-4, atol=1e-4))
+
+
+def _test_checkpoint_dropout(test_case, device):
+    x = flow.ones(16, 16, device=device, requires_grad=True)
+    y = checkpoint(lambda t: flow.nn.functional.dropout(t * 3, p=0.5), x)
+    y.sum().backward()
+    # The replayed dropout keeps the same elements as the forward one.
+    test_case.assertTrue(np.allclose(x.grad.numpy(), y.numpy(), rtol=1e-4, atol=1e-4))
+
+
+def _test_checkpoint_inplace(test_case, device):
+    x_np = np.random.randn(3, 5).astype(np.float32)
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+
+    def segment(t):
+        h = t * 2
+        h += 1
+        return flow.relu(h)
+
+    y = checkpoint(segment, x)
+    y.sum().backward()
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), (x_np * 2 + 1 > 0) * 2.0, rtol=1e-4, atol=1e-4)
+    )
+
+    with test_case.assertRaises(Exception):
+        checkpoint(lambda t: t.add_(1), flow.ones(2, 3, device=device))
+    # The failed recording is dropped.
+    z = flow.ones(2, 3, device=device, requires_grad=True)
+    flow.sin(z).sum().backward()
+    test_case.assertTrue(np.allclose(z.grad.numpy(), np.cos(np.ones((2, 3)))))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCheckpoint(flow.unittest.TestCase):
+    def test_checkpoint(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            _test_checkpoint_grad(test_case, device)
+            _test_checkpoint_dropout(test_case, device)
+            _test_checkpoint_inplace(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,64 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+# The persistent cache directory is read once, on the first algorithm search in the process.
+_CACHE_DIR = tempfile.mkdtemp()
+os.environ["ONEFLOW_CUDNN_CONV_ALGO_CACHE_DIR"] = _CACHE_DIR
+
+
+@flow.unittest.skip_unless_1n1d()
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+class TestCudnnConvAlgoCache(flow.unittest.TestCase):
+    def test_warmup_writes_cache_file(test_case):
+        configs = [
+            {
+                "input_shape": [2, 4, 16, 16],
+                "out_channels": 8,
+                "kernel_size": 3,
+                "padding": 1,
+            },
+            {
+                "input_shape": [2, 4, 8, 8, 8],
+                "out_channels": 4,
+                "kernel_size": 3,
+                "stride": 2,
+                "backward": False,
+            },
+        ]
+        flow.backends.cudnn.warmup_conv_algo_cache(configs)
+        cache_files = [
+            name
+            for name in os.listdir(_CACHE_DIR)
+            if name.startswith("cudnn_conv_algo_cache.")
+        ]
+        test_case.assertEqual(len(cache_files), 1)
+        size = os.path.getsize(os.path.join(_CACHE_DIR, cache_files[0]))
+        test_case.assertGreater(size, 0)
+        # Searching the same convolutions again is served from the cache and appends nothing.
+        flow.backends.cudnn.warmup_conv_algo_cache(configs)
+        test_case.assertEqual(
+            os.path.getsize(os.path.join(_CACHE_DIR, cache_files[0])), size
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -367,5 +367,31 @@ class TestOFRecordBytesDecoder(flow.unittest.TestCase):
         test_case.assertTrue(np.array_equal(img, gt_np))
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordRawRecords(flow.unittest.TestCase):
+    def test_raw_records(test_case):
+        def decode(raw_records):
+            record_reader = flow.nn.OFRecordReader(
+                "/dataset/imagenette/ofrecord",
+                batch_size=4,
+                part_name_suffix_length=5,
+                raw_records=raw_records,
+            )
+            record = record_reader()
+            label = flow.nn.OFRecordRawDecoder(
+                "class/label", shape=(), dtype=flow.int32
+            )(record)
+            image = flow.nn.OFRecordImageDecoder("encoded", color_space="RGB")(record)
+            encoded = flow.nn.OFRecordBytesDecoder("encoded")(record)
+            return label.numpy(), image.numpy(), encoded.numpy()
+
+        parsed = decode(raw_records=False)
+        raw = decode(raw_records=True)
+        test_case.assertTrue(np.array_equal(parsed[0], raw[0]))
+        for parsed_buffers, raw_buffers in zip(parsed[1:], raw[1:]):
+            for parsed_buffer, raw_buffer in zip(parsed_buffers, raw_buffers):
+                test_case.assertTrue(np.array_equal(parsed_buffer, raw_buffer))
+
+
 if __name__ == "__main__":
     unittest.main()
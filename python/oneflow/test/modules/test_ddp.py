@@ -186,6 +186,50 @@ class TestDDP(flow.unittest.TestCase):
         for dev_type in test_device:
             test_case._test_out_of_order_execution(dev_type)
 
+    def _test_rebuilt_buckets_with_bucket_cap(test_case, dev_type):
+        class Model(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w1 = flow.nn.Parameter(flow.Tensor([1]))
+                self.w2 = flow.nn.Parameter(flow.Tensor([2]))
+                self.w3 = flow.nn.Parameter(flow.Tensor([3]))
+
+            def forward(self, x):
+                if flow.env.get_rank() == 0:
+                    x *= self.w1
+                    x *= self.w2
+                    x *= self.w3
+                else:
+                    x *= self.w3
+                    x *= self.w2
+                    x *= self.w1
+                return x
+
+        rank = flow.env.get_rank()
+        m = Model().to(dev_type)
+        # each parameter takes 512 bytes in a bucket, so a bucket holds two of them
+        m = ddp(m, bucket_cap_mb=0.001)
+        test_case.assertEqual([len(bucket) for bucket in m._buckets], [2, 1])
+
+        for _ in range(2):
+            if rank == 0:
+                x = flow.Tensor([1])
+            elif rank == 1:
+                x = flow.Tensor([2])
+            else:
+                raise ValueError()
+            x = x.to(dev_type)
+            y = m(x)
+            y.backward()
+
+        test_case.assertTrue(np_allclose_with_shape(m.w1.grad.numpy(), np.array([18])))
+        test_case.assertTrue(np_allclose_with_shape(m.w2.grad.numpy(), np.array([9])))
+        test_case.assertTrue(np_allclose_with_shape(m.w3.grad.numpy(), np.array([6])))
+
+    def test_rebuilt_buckets_with_bucket_cap(test_case):
+        for dev_type in test_device:
+            test_case._test_rebuilt_buckets_with_bucket_cap(dev_type)
+
     def _test_ddp_with_partial_requires_grad_parameter(test_case, dev_type):
         class Model(flow.nn.Module):
             def __init__(self):
@@ -0,0 +1,70 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import os
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestDLPack(flow.unittest.TestCase):
+    def test_shares_memory(test_case):
+        x = flow.arange(12, dtype=flow.float32).reshape(3, 4)
+        y = flow.from_dlpack(flow.utils.dlpack.to_dlpack(x))
+        test_case.assertEqual(y.shape, (3, 4))
+        test_case.assertEqual(y.stride(), (4, 1))
+        y[1, 2] = -1.0
+        test_case.assertEqual(x[1, 2].item(), -1.0)
+
+    def test_protocol(test_case):
+        x = flow.randn(2, 3, 4)
+        test_case.assertEqual(x.__dlpack_device__(), (1, 0))
+        y = flow.from_dlpack(x)
+        test_case.assertTrue(np.array_equal(x.numpy(), y.numpy()))
+
+    def test_more_dtype(test_case):
+        for dtype in [flow.float64, flow.int64, flow.int32, flow.int8, flow.uint8]:
+            x = flow.ones(2, 3, dtype=dtype)
+            y = flow.from_dlpack(x)
+            test_case.assertEqual(y.dtype, dtype)
+            test_case.assertTrue(np.array_equal(x.numpy(), y.numpy()))
+
+    def test_capsule_consumed_once(test_case):
+        capsule = flow.utils.dlpack.to_dlpack(flow.ones(2))
+        flow.from_dlpack(capsule)
+        with test_case.assertRaises(Exception):
+            flow.from_dlpack(capsule)
+
+    @unittest.skipIf(not hasattr(np, "from_dlpack"), "numpy without dlpack")
+    def test_numpy(test_case):
+        np_arr = np.random.randn(4, 5).transpose(1, 0)
+        x = flow.from_dlpack(np_arr)
+        test_case.assertEqual(x.stride(), (1, 5))
+        test_case.assertTrue(np.array_equal(np_arr, x.numpy()))
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_cuda(test_case):
+        x = flow.randn(16, 16, device="cuda")
+        test_case.assertEqual(x.__dlpack_device__(), (2, 0))
+        y = flow.from_dlpack(x) * 2
+        test_case.assertTrue(np.allclose(x.numpy() * 2, y.numpy()))
+
+
+if __name__ == "__main__":
+    unittest.main()
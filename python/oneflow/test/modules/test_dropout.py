@@ -178,6 +178,17 @@ def do_test_dropout_addend_numpy_fp16_p1(test_case, shape):
     )
 
 
+def do_test_dropout_mask_grad(test_case, shape, device, dtype):
+    # The mask saved for backward keeps a bit per element, odd rows pad the last byte.
+    x_tensor = flow.ones(*shape, dtype=dtype, device=device, requires_grad=True)
+    out = flow._C.dropout(x_tensor, p=0.5)
+    out.sum().backward()
+    test_case.assertTrue(
+        np.allclose(x_tensor.grad.numpy(), out.numpy(), atol=1e-5, rtol=1e-5)
+    )
+    test_case.assertTrue(np.all(np.isin(out.numpy(), [0.0, 2.0])))
+
+
 def fixed_cpu_seed_dropout_test(test_case):
     gen1 = flow.Generator()
     gen1.manual_seed(5)
@@ -281,6 +292,19 @@ class TestModule(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_dropout_mask_grad(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [do_test_dropout_mask_grad]
+        arg_dict["shape"] = [[4, 127, 256], [5, 33, 65], [7], [3, 1]]
+        arg_dict["device"] = ["cpu", "cuda"]
+        if os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"] = ["cpu"]
+        arg_dict["dtype"] = [flow.float32, flow.float16]
+        for arg in GenArgList(arg_dict):
+            if arg[2] == "cpu" and arg[3] == flow.float16:
+                continue
+            arg[0](test_case, *arg[1:])
+
     def test_cpu_fixed_dropout(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [
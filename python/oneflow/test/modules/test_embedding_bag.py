@@ -0,0 +1,98 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_embedding_bag(indices, weight, mode, per_sample_weights, padding_idx):
+    batch_size, bag_size = indices.shape
+    out = np.zeros((batch_size, weight.shape[1]), dtype=weight.dtype)
+    weight_grad = np.zeros_like(weight)
+    for b in range(batch_size):
+        ids = [j for j in range(bag_size) if indices[b, j] != padding_idx]
+        if len(ids) == 0:
+            continue
+        rows = weight[indices[b, ids]]
+        if mode == "max":
+            out[b] = rows.max(axis=0)
+            argmax = rows.argmax(axis=0)
+            for d in range(weight.shape[1]):
+                weight_grad[indices[b, ids[argmax[d]]], d] += 1
+            continue
+        scale = np.ones(len(ids), dtype=weight.dtype)
+        if per_sample_weights is not None:
+            scale = per_sample_weights[b, ids]
+        if mode == "mean":
+            scale = scale / len(ids)
+        out[b] = (rows * scale[:, None]).sum(axis=0)
+        for j, s in zip(ids, scale):
+            weight_grad[indices[b, j]] += s
+    return out, weight_grad
+
+
+def _test_embedding_bag(test_case, device, mode, weighted, padding_idx):
+    weight_np = np.random.randn(10, 7).astype(np.float32)
+    indices_np = np.random.randint(0, 10, size=(6, 5))
+    per_sample_weights_np = None
+    per_sample_weights = None
+    if weighted:
+        per_sample_weights_np = np.random.rand(6, 5).astype(np.float32)
+        per_sample_weights = flow.tensor(per_sample_weights_np, device=device)
+    weight = flow.tensor(weight_np, device=device, requires_grad=True)
+    indices = flow.tensor(indices_np, dtype=flow.int64, device=device)
+    out = flow.nn.functional.embedding_bag(
+        indices,
+        weight,
+        mode=mode,
+        per_sample_weights=per_sample_weights,
+        padding_idx=padding_idx,
+    )
+    out.sum().backward()
+    out_np, weight_grad_np = _np_embedding_bag(
+        indices_np,
+        weight_np,
+        mode,
+        per_sample_weights_np,
+        -1 if padding_idx is None else padding_idx,
+    )
+    test_case.assertTrue(np.allclose(out.numpy(), out_np, 1e-05, 1e-05))
+    test_case.assertTrue(np.allclose(weight.grad.numpy(), weight_grad_np, 1e-05, 1e-05))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEmbeddingBag(flow.unittest.TestCase):
+    def test_embedding_bag(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["mode"] = ["sum", "mean", "max"]
+        arg_dict["weighted"] = [False, True]
+        arg_dict["padding_idx"] = [None, 3]
+        for arg in GenArgList(arg_dict):
+            if arg[1] == "max" and arg[2]:
+                continue
+            _test_embedding_bag(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
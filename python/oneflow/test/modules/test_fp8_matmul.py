@@ -0,0 +1,96 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList, IsFp8CapableGpu
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _max_rel_error(out, ref):
+    return np.abs(out - ref).max() / np.abs(ref).max()
+
+
+def _test_fp8_matmul(test_case, transpose_b, dtype):
+    m, n, k, alpha, history_len = 24, 32, 64, 0.5, 4
+    a_history = flow.zeros(history_len, dtype=flow.float32, device="cuda")
+    b_history = flow.zeros(history_len, dtype=flow.float32, device="cuda")
+    a_amaxes, b_amaxes = [], []
+    for step in range(history_len + 2):
+        # a shrinks each step, so the scales from the larger amaxes of the earlier steps
+        # never saturate it.
+        a_np = np.random.randn(m, k).astype(np.float32) / (step + 1)
+        b_np = np.random.randn(k, n).astype(np.float32)
+        ref = a_np.dot(b_np) * alpha
+        b = b_np.T.copy() if transpose_b else b_np
+        out = flow._C.fp8_matmul(
+            flow.tensor(a_np, dtype=dtype, device="cuda"),
+            flow.tensor(b, dtype=dtype, device="cuda"),
+            a_history,
+            b_history,
+            transpose_b=transpose_b,
+            alpha=alpha,
+        )
+        test_case.assertEqual(tuple(out.shape), (m, n))
+        test_case.assertEqual(out.dtype, dtype)
+        # E4M3 keeps 3 mantissa bits, each product is off by a few percent.
+        test_case.assertLess(_max_rel_error(out.float().numpy(), ref), 0.1)
+        a_amaxes.insert(0, np.abs(flow.tensor(a_np, dtype=dtype).float().numpy()).max())
+        b_amaxes.insert(0, np.abs(flow.tensor(b_np, dtype=dtype).float().numpy()).max())
+        expected_a = np.zeros(history_len, dtype=np.float32)
+        expected_b = np.zeros(history_len, dtype=np.float32)
+        expected_a[: len(a_amaxes)] = a_amaxes[:history_len]
+        expected_b[: len(b_amaxes)] = b_amaxes[:history_len]
+        test_case.assertTrue(np.array_equal(a_history.numpy(), expected_a))
+        test_case.assertTrue(np.array_equal(b_history.numpy(), expected_b))
+
+
+def _test_fp8_matmul_delayed_scaling(test_case):
+    # Inputs far below 1 mostly flush to zero with the scale of 1 of an empty history,
+    # the next step scales them by the amax the first one recorded.
+    m, n, k = 16, 16, 32
+    a_np = np.random.randn(m, k).astype(np.float32) * 1e-3
+    b_np = np.random.randn(k, n).astype(np.float32)
+    ref = a_np.dot(b_np)
+    a = flow.tensor(a_np, device="cuda")
+    b = flow.tensor(b_np, device="cuda")
+    a_history = flow.zeros(2, dtype=flow.float32, device="cuda")
+    b_history = flow.zeros(2, dtype=flow.float32, device="cuda")
+    first = flow._C.fp8_matmul(a, b, a_history, b_history).numpy()
+    second = flow._C.fp8_matmul(a, b, a_history, b_history).numpy()
+    test_case.assertGreater(_max_rel_error(first, ref), 0.2)
+    test_case.assertLess(_max_rel_error(second, ref), 0.1)
+
+
+@unittest.skipIf(not IsFp8CapableGpu(), "needs a GPU with fp8 GEMMs")
+@flow.unittest.skip_unless_1n1d()
+class TestFp8Matmul(flow.unittest.TestCase):
+    def test_fp8_matmul(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["transpose_b"] = [True, False]
+        arg_dict["dtype"] = [flow.float32, flow.float16, flow.bfloat16]
+        for arg in GenArgList(arg_dict):
+            _test_fp8_matmul(test_case, *arg)
+
+    def test_fp8_matmul_delayed_scaling(test_case):
+        _test_fp8_matmul_delayed_scaling(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
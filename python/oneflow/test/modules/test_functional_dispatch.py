@@ -0,0 +1,82 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_binary_dispatch(test_case):
+    x_np = np.random.randn(2, 3).astype(np.float32)
+    y_np = np.random.randn(2, 3).astype(np.float32)
+    x = flow.tensor(x_np)
+    y = flow.tensor(y_np)
+    for func, np_func in [
+        (flow._C.add, np.add),
+        (flow._C.sub, np.subtract),
+        (flow._C.mul, np.multiply),
+    ]:
+        # Positional calls take the fast path, calls with keywords the generic one.
+        test_case.assertTrue(np.allclose(func(x, y).numpy(), np_func(x_np, y_np)))
+        test_case.assertTrue(np.allclose(func(x, 2).numpy(), np_func(x_np, 2)))
+        test_case.assertTrue(np.allclose(func(x, 0.5).numpy(), np_func(x_np, 0.5)))
+        test_case.assertTrue(np.allclose(func(3, x).numpy(), np_func(3, x_np)))
+        test_case.assertTrue(
+            np.allclose(func(x, other=y).numpy(), np_func(x_np, y_np))
+        )
+    out = flow._C.add(x, y, alpha=2)
+    test_case.assertTrue(np.allclose(out.numpy(), x_np + 2 * y_np))
+    # Falls through the fast schemas to the TensorTuple one.
+    out = flow._C.add([x, y, x])
+    test_case.assertTrue(np.allclose(out.numpy(), 2 * x_np + y_np))
+
+
+def _test_indexing_dispatch(test_case):
+    x_np = np.random.randn(4, 5).astype(np.float32)
+    x = flow.tensor(x_np)
+    test_case.assertTrue(np.allclose(x[1].numpy(), x_np[1]))
+    test_case.assertTrue(np.allclose(x[1:3, ::2].numpy(), x_np[1:3, ::2]))
+    test_case.assertTrue(np.allclose(x[..., None].numpy(), x_np[..., None]))
+    index = flow.tensor([0, 2], dtype=flow.int64)
+    test_case.assertTrue(np.allclose(x[index].numpy(), x_np[[0, 2]]))
+
+
+def _test_dispatch_errors(test_case):
+    x = flow.ones(2, 3)
+    with test_case.assertRaises(TypeError) as ctx:
+        flow._C.mul(x, "a")
+    test_case.assertTrue("valid signatures" in str(ctx.exception))
+    with test_case.assertRaises(TypeError):
+        flow._C.mul(x, x, x)
+    with test_case.assertRaises(TypeError):
+        flow._C.add(x, x, 1)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFunctionalDispatch(flow.unittest.TestCase):
+    def test_binary_dispatch(test_case):
+        _test_binary_dispatch(test_case)
+
+    def test_indexing_dispatch(test_case):
+        _test_indexing_dispatch(test_case)
+
+    def test_dispatch_errors(test_case):
+        _test_dispatch_errors(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,201 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+import os
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _naive_attention(query, key, value, key_mask, scale, causal):
+    scores = flow.matmul(query, key.transpose(-1, -2)) * scale
+    query_seq_len, kv_seq_len = scores.shape[-2], scores.shape[-1]
+    attended = np.ones((query.shape[0], 1, query_seq_len, kv_seq_len), dtype=bool)
+    if causal:
+        attended &= np.tril(
+            np.ones((query_seq_len, kv_seq_len), dtype=bool),
+            k=kv_seq_len - query_seq_len,
+        )
+    if key_mask is not None:
+        attended &= key_mask[:, None, None, :]
+    attended = flow.tensor(attended, dtype=flow.float32, device=query.device)
+    scores = scores * attended - 10000.0 * (1.0 - attended)
+    return flow.matmul(flow.softmax(scores, dim=-1), value)
+
+
+def _test_fused_attention(
+    test_case, dtype, batch_size, num_heads, seq_lens, head_size, causal, masked
+):
+    query_seq_len, kv_seq_len = seq_lens
+    query = np.random.randn(batch_size, num_heads, query_seq_len, head_size)
+    key = np.random.randn(batch_size, num_heads, kv_seq_len, head_size)
+    value = np.random.randn(batch_size, num_heads, kv_seq_len, head_size)
+    key_mask = None
+    if masked:
+        key_mask = np.random.randint(0, 2, size=(batch_size, kv_seq_len)).astype(bool)
+        # every query attends at least the first key
+        key_mask[:, 0] = True
+    scale = 1.0 / np.sqrt(head_size)
+
+    fused_inputs = [
+        flow.tensor(x, dtype=dtype, device="cuda", requires_grad=True)
+        for x in (query, key, value)
+    ]
+    fused_key_mask = None
+    if masked:
+        fused_key_mask = flow.tensor(key_mask, dtype=flow.bool, device="cuda")
+    fused_out = flow._C.fused_attention(
+        *fused_inputs, fused_key_mask, causal=causal, p=0.0
+    )
+
+    naive_inputs = [
+        flow.tensor(x, dtype=flow.float32, device="cuda", requires_grad=True)
+        for x in (query, key, value)
+    ]
+    naive_out = _naive_attention(*naive_inputs, key_mask, scale, causal)
+
+    out_grad = np.random.randn(*naive_out.shape)
+    fused_out.backward(flow.tensor(out_grad, dtype=dtype, device="cuda"))
+    naive_out.backward(flow.tensor(out_grad, dtype=flow.float32, device="cuda"))
+
+    tol = 1e-4 if dtype == flow.float32 else 1e-2
+    test_case.assertTrue(
+        np.allclose(
+            fused_out.numpy().astype(np.float32), naive_out.numpy(), atol=tol, rtol=tol
+        )
+    )
+    for fused_input, naive_input in zip(fused_inputs, naive_inputs):
+        test_case.assertTrue(
+            np.allclose(
+                fused_input.grad.numpy().astype(np.float32),
+                naive_input.grad.numpy(),
+                atol=tol * 10,
+                rtol=tol * 10,
+            )
+        )
+
+
+def _test_fused_attention_dropout(test_case, p):
+    shape = (2, 4, 64, 32)
+    query, key, value = [
+        flow.randn(*shape, device="cuda", requires_grad=True) for _ in range(3)
+    ]
+    out = flow._C.fused_attention(query, key, value, p=p)
+    test_case.assertTrue(np.isfinite(out.numpy()).all())
+    out.sum().backward()
+    for x in (query, key, value):
+        test_case.assertTrue(np.isfinite(x.grad.numpy()).all())
+    # the dropped probabilities differ from call to call
+    another_out = flow._C.fused_attention(query, key, value, p=p)
+    test_case.assertFalse(np.allclose(out.numpy(), another_out.numpy()))
+    eval_out = flow._C.fused_attention(query, key, value, p=p, training=False)
+    no_dropout_out = flow._C.fused_attention(query, key, value)
+    test_case.assertTrue(np.allclose(eval_out.numpy(), no_dropout_out.numpy()))
+
+
+def _test_fused_attention_packed(test_case, dtype, num_heads, head_size, causal):
+    # packed sequences of [1, num_heads, total_len, head_size] against each sequence
+    # run on its own
+    query_lens = [5, 40, 1, 17]
+    kv_lens = [5, 70, 3, 17] if not causal else query_lens
+    cu_seqlens_q = np.cumsum([0] + query_lens)
+    cu_seqlens_k = np.cumsum([0] + kv_lens)
+    query = np.random.randn(1, num_heads, cu_seqlens_q[-1], head_size)
+    key = np.random.randn(1, num_heads, cu_seqlens_k[-1], head_size)
+    value = np.random.randn(1, num_heads, cu_seqlens_k[-1], head_size)
+    out_grad = np.random.randn(*query.shape)
+
+    packed_inputs = [
+        flow.tensor(x, dtype=dtype, device="cuda", requires_grad=True)
+        for x in (query, key, value)
+    ]
+    packed_out = flow._C.fused_attention(
+        *packed_inputs,
+        causal=causal,
+        cu_seqlens_q=flow.tensor(cu_seqlens_q, dtype=flow.int32, device="cuda"),
+        cu_seqlens_k=flow.tensor(cu_seqlens_k, dtype=flow.int32, device="cuda"),
+        max_seqlen_q=max(query_lens),
+        max_seqlen_k=max(kv_lens),
+    )
+    packed_out.backward(flow.tensor(out_grad, dtype=dtype, device="cuda"))
+
+    tol = 1e-4 if dtype == flow.float32 else 1e-2
+    for b in range(len(query_lens)):
+        q_rows = slice(cu_seqlens_q[b], cu_seqlens_q[b + 1])
+        k_rows = slice(cu_seqlens_k[b], cu_seqlens_k[b + 1])
+        inputs = [
+            flow.tensor(x, dtype=dtype, device="cuda", requires_grad=True)
+            for x in (query[:, :, q_rows], key[:, :, k_rows], value[:, :, k_rows])
+        ]
+        out = flow._C.fused_attention(*inputs, causal=causal)
+        out.backward(flow.tensor(out_grad[:, :, q_rows], dtype=dtype, device="cuda"))
+        expected = [
+            (packed_out, out, q_rows),
+            (packed_inputs[0].grad, inputs[0].grad, q_rows),
+            (packed_inputs[1].grad, inputs[1].grad, k_rows),
+            (packed_inputs[2].grad, inputs[2].grad, k_rows),
+        ]
+        for packed, single, rows in expected:
+            test_case.assertTrue(
+                np.allclose(
+                    packed.numpy()[:, :, rows].astype(np.float32),
+                    single.numpy().astype(np.float32),
+                    atol=tol * 10,
+                    rtol=tol * 10,
+                )
+            )
+
+
+@flow.unittest.skip_unless_1n1d()
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
+class TestFusedAttention(flow.unittest.TestCase):
+    def test_fused_attention(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_attention]
+        args_dict["dtype"] = [flow.float32, flow.float16]
+        args_dict["batch_size"] = [2]
+        args_dict["num_heads"] = [1, 4]
+        args_dict["seq_lens"] = [(16, 16), (37, 37), (20, 70), (128, 128)]
+        args_dict["head_size"] = [32, 64, 128]
+        args_dict["causal"] = [False, True]
+        args_dict["masked"] = [False, True]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_attention_packed(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_attention_packed]
+        args_dict["dtype"] = [flow.float32, flow.float16]
+        args_dict["num_heads"] = [1, 4]
+        args_dict["head_size"] = [32, 64]
+        args_dict["causal"] = [False, True]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_attention_dropout(test_case):
+        for p in [0.1, 0.5]:
+            _test_fused_attention_dropout(test_case, p)
+
+
+if __name__ == "__main__":
+    unittest.main()
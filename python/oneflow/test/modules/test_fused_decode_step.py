@@ -0,0 +1,198 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_beam_step(logits, scores, finished, lengths, temperature, length_penalty, eos):
+    batch_size, num_beams, vocab_size = logits.shape
+    x = logits / temperature
+    log_probs = x - x.max(-1, keepdims=True)
+    log_probs -= np.log(np.exp(log_probs).sum(-1, keepdims=True))
+    next_tokens = np.zeros((batch_size, num_beams), dtype=np.int64)
+    out_scores = np.zeros((batch_size, num_beams), dtype=np.float32)
+    out_finished = np.zeros((batch_size, num_beams), dtype=np.bool_)
+    out_lengths = np.zeros((batch_size, num_beams), dtype=np.int32)
+    parents = np.zeros((batch_size, num_beams), dtype=np.int32)
+    for b in range(batch_size):
+        candidates = []
+        for j in range(num_beams):
+            if finished[b, j]:
+                candidates.append((scores[b, j], lengths[b, j], 0, j, True))
+                continue
+            for v in np.argsort(-logits[b, j], kind="stable")[:num_beams]:
+                score = scores[b, j] + log_probs[b, j, v]
+                candidates.append((score, lengths[b, j] + 1, v, j, False))
+        candidates.sort(key=lambda c: -c[0] / max(c[1], 1) ** length_penalty)
+        for k, (score, length, v, j, done) in enumerate(candidates[:num_beams]):
+            next_tokens[b, k] = v
+            out_scores[b, k] = score
+            out_finished[b, k] = done or v == eos
+            out_lengths[b, k] = length
+            parents[b, k] = j
+    return next_tokens, out_scores, out_finished, out_lengths, parents
+
+
+def _make_state(batch_size, num_beams, finished_beams=()):
+    scores = np.zeros((batch_size, num_beams), dtype=np.float32)
+    scores[:, 1:] = -np.arange(1, num_beams, dtype=np.float32)
+    finished = np.zeros((batch_size, num_beams), dtype=np.bool_)
+    for b, j in finished_beams:
+        finished[b, j] = True
+    lengths = np.random.randint(1, 8, size=(batch_size, num_beams)).astype(np.int32)
+    return scores, finished, lengths
+
+
+def _test_beam_search(test_case, device, dtype, num_beams):
+    batch_size, vocab_size, eos = 3, 37, 5
+    logits = np.random.randn(batch_size, num_beams, vocab_size).astype(np.float32)
+    logits[0, 0, eos] = 10.0
+    finished_beams = [(1, num_beams - 1)] if num_beams > 1 else []
+    scores, finished, lengths = _make_state(batch_size, num_beams, finished_beams)
+    outs = flow._C.fused_decode_step(
+        flow.tensor(logits, device=device, dtype=dtype),
+        flow.tensor(scores, device=device),
+        flow.tensor(finished, device=device),
+        flow.tensor(lengths, device=device),
+        mode="beam",
+        temperature=0.7,
+        length_penalty=1.2,
+        eos_token_id=eos,
+        pad_token_id=0,
+    )
+    if dtype == flow.float16:
+        logits = logits.astype(np.float16).astype(np.float32)
+    refs = _np_beam_step(logits, scores, finished, lengths, 0.7, 1.2, eos)
+    tolerance = 1e-2 if dtype == flow.float16 else 1e-4
+    for i, (out, ref) in enumerate(zip(outs, refs)):
+        if i == 1:
+            test_case.assertTrue(np.allclose(out.numpy(), ref, tolerance, tolerance))
+        else:
+            test_case.assertTrue(np.array_equal(out.numpy(), ref))
+
+
+def _test_greedy_sample(test_case, device, dtype):
+    batch_size, num_beams, vocab_size = 4, 2, 1000
+    logits = np.random.randn(batch_size, num_beams, vocab_size).astype(np.float32)
+    scores, finished, lengths = _make_state(batch_size, num_beams, [(2, 0)])
+    outs = flow._C.fused_decode_step(
+        flow.tensor(logits, device=device, dtype=dtype),
+        flow.tensor(scores, device=device),
+        flow.tensor(finished, device=device),
+        flow.tensor(lengths, device=device),
+        top_k=1,
+        eos_token_id=-1,
+        pad_token_id=7,
+    )
+    next_tokens, out_scores, out_finished, out_lengths, parents = outs
+    if dtype == flow.float16:
+        logits = logits.astype(np.float16).astype(np.float32)
+    expected = logits.argmax(-1)
+    expected[2, 0] = 7
+    test_case.assertTrue(np.array_equal(next_tokens.numpy(), expected))
+    test_case.assertTrue(np.allclose(out_scores.numpy(), scores, 1e-4, 1e-4))
+    test_case.assertTrue(np.array_equal(out_finished.numpy(), finished))
+    test_case.assertTrue(np.array_equal(out_lengths.numpy(), lengths + ~finished))
+    test_case.assertTrue(
+        np.array_equal(parents.numpy(), np.tile(np.arange(num_beams), (batch_size, 1)))
+    )
+
+
+def _test_top_p_sample(test_case, device):
+    # Only tokens 3 and 8 hold 0.9 of the probability.
+    batch_size, vocab_size = 64, 16
+    logits = np.full((batch_size, 1, vocab_size), -10.0, dtype=np.float32)
+    logits[:, :, 3] = 2.0
+    logits[:, :, 8] = 1.5
+    scores, finished, lengths = _make_state(batch_size, 1)
+    next_tokens = flow._C.fused_decode_step(
+        flow.tensor(logits, device=device),
+        flow.tensor(scores, device=device),
+        flow.tensor(finished, device=device),
+        flow.tensor(lengths, device=device),
+        top_p=0.9,
+        generator=flow.Generator(device=device),
+    )[0].numpy()
+    test_case.assertTrue(np.isin(next_tokens, [3, 8]).all())
+    test_case.assertTrue((next_tokens == 8).any())
+
+
+def _test_reorder_beams(test_case, device):
+    num_beams, block_size, context_len = 3, 4, 6
+    cache = flow.nn.PagedKVCache(2, 16, block_size, 1, 2, device=device)
+    seq_ids = list(range(2 * num_beams))
+    for seq_id in seq_ids:
+        cache.add_sequence(seq_id)
+    slot_mapping = cache.reserve(seq_ids, [context_len] * len(seq_ids))
+    keys = np.random.randn(len(seq_ids), context_len, 1, 2).astype(np.float32)
+    values = np.random.randn(len(seq_ids), context_len, 1, 2).astype(np.float32)
+    for layer in range(2):
+        cache.append(
+            layer,
+            flow.tensor(keys.reshape(-1, 1, 2), device=device),
+            flow.tensor(values.reshape(-1, 1, 2) * (layer + 1), device=device),
+            slot_mapping,
+        )
+    parents = np.array([[2, 2, 0], [1, 0, 1]], dtype=np.int32)
+    cache.reorder_beams(seq_ids, flow.tensor(parents))
+    slots = slot_mapping.numpy().reshape(len(seq_ids), context_len)
+    for layer in range(2):
+        key_cache = cache.key_caches[layer].numpy().reshape(-1, 1, 2)
+        value_cache = cache.value_caches[layer].numpy().reshape(-1, 1, 2)
+        for seq_id in seq_ids:
+            parent = seq_id // num_beams * num_beams + parents.flat[seq_id]
+            test_case.assertTrue(np.array_equal(key_cache[slots[seq_id]], keys[parent]))
+            test_case.assertTrue(
+                np.array_equal(value_cache[slots[seq_id]], values[parent] * (layer + 1))
+            )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedDecodeStep(flow.unittest.TestCase):
+    def test_beam_search(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["num_beams"] = [1, 4]
+        for arg in GenArgList(arg_dict):
+            _test_beam_search(test_case, *arg)
+        _test_beam_search(test_case, "cuda", flow.float16, 4)
+
+    def test_greedy_sample(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["dtype"] = [flow.float32]
+        for arg in GenArgList(arg_dict):
+            _test_greedy_sample(test_case, *arg)
+        _test_greedy_sample(test_case, "cuda", flow.float16)
+
+    def test_top_p_sample(test_case):
+        for device in ["cpu", "cuda"]:
+            _test_top_p_sample(test_case, device)
+
+    def test_reorder_beams(test_case):
+        for device in ["cpu", "cuda"]:
+            _test_reorder_beams(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,68 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_fused_linear_cross_entropy(test_case, device, chunk_size, ignore_index):
+    x_np = np.random.randn(3, 5, 16).astype(np.float32)
+    weight_np = np.random.randn(37, 16).astype(np.float32)
+    label_np = np.random.randint(0, 37, size=(3, 5))
+    label_np[1, 2] = ignore_index
+
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+    weight = flow.tensor(weight_np, device=device, requires_grad=True)
+    label = flow.tensor(label_np, dtype=flow.int64, device=device)
+    out = flow.nn.functional.fused_linear_cross_entropy(
+        x, weight, label, ignore_index=ignore_index, chunk_size=chunk_size
+    )
+    out.sum().backward()
+
+    ref_x = flow.tensor(x_np, device=device, requires_grad=True)
+    ref_weight = flow.tensor(weight_np, device=device, requires_grad=True)
+    logits = flow.matmul(ref_x.reshape(-1, 16), ref_weight, transpose_b=True)
+    loss = flow.nn.CrossEntropyLoss(ignore_index=ignore_index, reduction="none")
+    ref_out = loss(logits, label.reshape(-1)).reshape(3, 5)
+    ref_out.sum().backward()
+
+    test_case.assertEqual(out.shape, label.shape)
+    test_case.assertTrue(np.allclose(out.numpy(), ref_out.numpy(), 1e-4, 1e-4))
+    test_case.assertTrue(np.allclose(x.grad.numpy(), ref_x.grad.numpy(), 1e-4, 1e-4))
+    test_case.assertTrue(
+        np.allclose(weight.grad.numpy(), ref_weight.grad.numpy(), 1e-4, 1e-4)
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedLinearCrossEntropy(flow.unittest.TestCase):
+    def test_fused_linear_cross_entropy(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["chunk_size"] = [1, 8, 4096]
+        arg_dict["ignore_index"] = [-100, 4]
+        for arg in GenArgList(arg_dict):
+            _test_fused_linear_cross_entropy(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,110 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _composed_residual_norm(x, residual, bias, gamma, beta, norm_type, activation):
+    h = x + residual + bias
+    if norm_type == "layer_norm":
+        mean = h.mean(dim=-1, keepdim=True)
+        var = ((h - mean) ** 2).mean(dim=-1, keepdim=True)
+        z = (h - mean) / flow.sqrt(var + 1e-5) * gamma + beta
+    else:
+        z = h / flow.sqrt((h ** 2).mean(dim=-1, keepdim=True) + 1e-5) * gamma
+    if activation == "gelu":
+        z = flow.gelu(z)
+    elif activation == "silu":
+        z = flow.nn.functional.silu(z)
+    return z, h
+
+
+def _test_fused_residual_norm(test_case, norm_type, activation, cols):
+    shape = (4, 6, cols)
+    inputs_np = [np.random.randn(*shape), np.random.randn(*shape)]
+    params_np = [
+        np.random.randn(cols),
+        np.random.randn(cols) + 1,
+        np.random.randn(cols),
+    ]
+    if norm_type == "rms_norm":
+        params_np[2] = np.zeros(cols)
+
+    def make_tensors():
+        return [
+            flow.tensor(a, dtype=flow.float32, device="cuda", requires_grad=True)
+            for a in inputs_np + params_np
+        ]
+
+    x, residual, bias, gamma, beta = make_tensors()
+    y, h = flow._C.fused_residual_norm(
+        x,
+        residual,
+        bias,
+        gamma,
+        beta if norm_type == "layer_norm" else None,
+        norm_type=norm_type,
+        activation=activation,
+        epsilon=1e-5,
+    )
+    (y.sum() + (h * h).sum()).backward()
+
+    ref_x, ref_residual, ref_bias, ref_gamma, ref_beta = make_tensors()
+    ref_y, ref_h = _composed_residual_norm(
+        ref_x, ref_residual, ref_bias, ref_gamma, ref_beta, norm_type, activation
+    )
+    (ref_y.sum() + (ref_h * ref_h).sum()).backward()
+
+    test_case.assertTrue(np.allclose(y.numpy(), ref_y.numpy(), 1e-4, 1e-4))
+    test_case.assertTrue(np.allclose(h.numpy(), ref_h.numpy(), 1e-4, 1e-4))
+    pairs = [(x, ref_x), (residual, ref_residual), (bias, ref_bias), (gamma, ref_gamma)]
+    if norm_type == "layer_norm":
+        pairs.append((beta, ref_beta))
+    for tensor, ref_tensor in pairs:
+        test_case.assertTrue(
+            np.allclose(tensor.grad.numpy(), ref_tensor.grad.numpy(), 1e-3, 1e-3)
+        )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestFusedResidualNorm(flow.unittest.TestCase):
+    def test_fused_residual_norm(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_fused_residual_norm]
+        arg_dict["norm_type"] = ["layer_norm", "rms_norm"]
+        arg_dict["activation"] = ["none", "gelu", "silu"]
+        arg_dict["cols"] = [64, 37, 2048]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_fused_residual_norm_without_optional_inputs(test_case):
+        x = flow.randn(8, 32, device="cuda")
+        y, h = flow._C.fused_residual_norm(x, begin_norm_axis=1)
+        ref_y = flow.nn.LayerNorm(32, eps=1e-5, elementwise_affine=False)(x)
+        test_case.assertTrue(np.allclose(y.numpy(), ref_y.numpy(), 1e-4, 1e-4))
+        test_case.assertTrue(np.allclose(h.numpy(), x.numpy()))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -260,6 +260,76 @@ def _test_embedding_gradient_shuffle(test_case):
     )
 
 
+def _test_id_shuffle_table_wise(test_case):
+    batch_size = int(1024 / parallel_num)
+    placement = flow.placement(type="cuda", ranks=list(range(parallel_num)))
+    num_columns = 26
+    # The small tables of the even columns are placed table-wise, the others row-wise.
+    num_rows = [1000 if column % 2 == 0 else 100000 for column in range(num_columns)]
+    row_bytes = [512] * num_columns
+    lookups_per_step = [1024.0] * num_columns
+    plan = flow._oneflow_internal.embedding.PlanIdShuffleColumnParallelIds
+    column_parallel_ids = plan(
+        num_rows, row_bytes, lookups_per_step, parallel_num, 1 << 34, 1 << 20
+    )
+    test_case.assertTrue(-1 in column_parallel_ids)
+    for rank in range(parallel_num):
+        test_case.assertTrue(rank in column_parallel_ids)
+    data = np.random.rand(max_id, 128).astype(np.float32)
+    data_tensor = flow.tensor(data, requires_grad=False).to_global(
+        placement=placement, sbp=flow.sbp.broadcast()
+    )
+
+    class TestGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+
+        def build(self, ids, column_ids, data):
+            (
+                num_unique_matrix,
+                inverse_unique_partition_indices,
+                cur_rank_num_unique,
+                cur_rank_unique_ids,
+                cur_rank_unique_column_ids,
+                cur_rank_inverse_indices,
+            ) = flow._C.one_embedding_id_shuffle(
+                ids, column_ids, num_columns, column_parallel_ids
+            )
+            unique_embeddings = flow._C.gather(data, cur_rank_unique_ids, axis=0)
+            embeddings = flow._C.one_embedding_embedding_shuffle(
+                unique_embeddings,
+                flow._C.identity(num_unique_matrix),
+                flow._C.identity(cur_rank_inverse_indices),
+                flow._C.identity(inverse_unique_partition_indices),
+            )
+            return (
+                embeddings,
+                flow.cast(cur_rank_num_unique, flow.int32),
+                flow.cast(cur_rank_unique_column_ids, flow.int32),
+            )
+
+    graph = TestGraph()
+    ids_tensor, column_ids_tensor = get_tensors(batch_size, num_columns)
+    (
+        embeddings,
+        local_cur_rank_num_unique,
+        cur_rank_unique_column_ids,
+    ) = graph(ids_tensor, column_ids_tensor, data_tensor)
+    test_case.assertTrue(np.array_equal(embeddings.numpy(), data[ids_tensor.numpy()]))
+    cur_rank_num_unique = local_cur_rank_num_unique.to_local().to_global(
+        placement=placement, sbp=flow.sbp.split(0)
+    )
+    # every id of a table-wise column is looked up on the rank holding the table
+    cur_rank_num_ids = batch_size * num_columns * parallel_num
+    for rank in range(parallel_num):
+        num_unique = cur_rank_num_unique.numpy()[rank]
+        unique_column_ids = cur_rank_unique_column_ids.numpy()[
+            cur_rank_num_ids * rank : cur_rank_num_ids * rank + num_unique
+        ]
+        for column in unique_column_ids:
+            test_case.assertTrue(column_parallel_ids[column] in (-1, rank))
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n2d()
 class DataShuffleTestCase(flow.unittest.TestCase):
@@ -270,6 +340,9 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         for kwargs in GenArgDict(arg_dict):
             _test_id_shuffle(test_case, **kwargs)
 
+    def test_id_shuffle_table_wise(test_case):
+        _test_id_shuffle_table_wise(test_case)
+
     def test_embedding_shuffle(test_case):
         arg_dict = OrderedDict()
         arg_dict["dtype"] = [flow.float32, flow.float16]
@@ -0,0 +1,79 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _padded_images(sizes, channels=3):
+    max_h = max(h for (h, _) in sizes)
+    max_w = max(w for (_, w) in sizes)
+    images = np.zeros((len(sizes), max_h, max_w, channels), dtype=np.uint8)
+    for (i, (h, w)) in enumerate(sizes):
+        images[i, :h, :w] = np.random.randint(0, 256, size=(h, w, channels))
+    return images
+
+
+def _test_identity(test_case):
+    sizes = [(7, 9), (7, 9)]
+    images = _padded_images(sizes)
+    mean = [10.0, 20.0, 30.0]
+    std = [2.0, 4.0, 8.0]
+    augment = flow.nn.image.Augment(
+        target_size=[7, 9], interpolation_type="nearest", mean=mean, std=std
+    )
+    out = augment(flow.tensor(images, device="cuda"))
+    expected = (images.astype(np.float32) - mean) / std
+    test_case.assertTrue(
+        np.allclose(out.numpy(), expected.transpose(0, 3, 1, 2), atol=1e-5)
+    )
+
+
+def _test_flip_and_size(test_case):
+    sizes = [(5, 7), (9, 5)]
+    images = _padded_images(sizes)
+    augment = flow.nn.image.Augment(
+        target_size=[4, 3],
+        interpolation_type="nearest",
+        flip_prob=1.0,
+        output_layout="NHWC",
+    )
+    in_size = flow.tensor(np.array(sizes, dtype=np.int32), device="cuda")
+    out = augment(flow.tensor(images, device="cuda"), in_size).numpy()
+    for (i, (h, w)) in enumerate(sizes):
+        rows = ((np.arange(4) + 0.5) * h / 4).astype(np.int64)
+        cols = ((np.arange(3) + 0.5) * w / 3).astype(np.int64)
+        expected = images[i][rows][:, cols][:, ::-1]
+        test_case.assertTrue(np.allclose(out[i], expected))
+
+
+@flow.unittest.skip_unless_1n1d()
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+class TestImageAugment(flow.unittest.TestCase):
+    def test_identity(test_case):
+        _test_identity(test_case)
+
+    def test_flip_and_size(test_case):
+        _test_flip_and_size(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,82 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_inplace_unary(test_case, device):
+    x_np = np.random.rand(3, 4).astype(np.float32) + 0.5
+    for name, np_func in [
+        ("exp", np.exp),
+        ("log", np.log),
+        ("sqrt", np.sqrt),
+        ("tanh", np.tanh),
+        ("sigmoid", lambda v: 1 / (1 + np.exp(-v))),
+        ("square", np.square),
+        ("neg", np.negative),
+        ("ceil", np.ceil),
+    ]:
+        x = flow.tensor(x_np, device=device)
+        getattr(x, name + "_")()
+        test_case.assertEqual(x._version, 1)
+        test_case.assertTrue(
+            np.allclose(x.numpy(), np_func(x_np), rtol=1e-4, atol=1e-4)
+        )
+
+
+def _test_inplace_grad(test_case, device):
+    x_np = np.random.randn(3, 4).astype(np.float32)
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+    y = x * 2
+    y.tanh_()
+    y.relu_()
+    test_case.assertEqual(y._version, 2)
+    y.sum().backward()
+    t = np.tanh(x_np * 2)
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), (t > 0) * (1 - t * t) * 2, rtol=1e-4, atol=1e-4)
+    )
+
+
+def _test_inplace_version_check(test_case, device):
+    x = flow.ones(3, 4, device=device, requires_grad=True)
+    y = x * 2
+    z = flow.sin(y)
+    # The detached tensor shares the storage and the version with y.
+    y.detach().exp_()
+    test_case.assertEqual(y._version, 1)
+    with test_case.assertRaises(Exception) as ctx:
+        z.sum().backward()
+    test_case.assertTrue("inplace" in str(ctx.exception))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestInplace(flow.unittest.TestCase):
+    def test_inplace(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            _test_inplace_unary(test_case, device)
+            _test_inplace_grad(test_case, device)
+            _test_inplace_version_check(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
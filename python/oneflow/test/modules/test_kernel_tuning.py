@@ -0,0 +1,73 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# The tuning switches are read once, on the first tuned kernel in the process.
+_CACHE_DIR = tempfile.mkdtemp()
+os.environ["ONEFLOW_KERNEL_TUNING"] = "1"
+os.environ["ONEFLOW_KERNEL_TUNING_CACHE_DIR"] = _CACHE_DIR
+
+
+def _np_softmax(x):
+    e = np.exp(x - x.max(-1, keepdims=True))
+    return e / e.sum(-1, keepdims=True)
+
+
+@flow.unittest.skip_unless_1n1d()
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+class TestKernelTuning(flow.unittest.TestCase):
+    def test_tuned_softmax(test_case):
+        shapes = [(64, 100), (8, 1024), (4, 5000)]
+
+        def run():
+            for shape in shapes:
+                x = np.random.randn(*shape).astype(np.float32)
+                y = flow.softmax(flow.tensor(x, device="cuda"), dim=-1)
+                test_case.assertTrue(np.allclose(y.numpy(), _np_softmax(x), 1e-5, 1e-5))
+                log_y = flow.log_softmax(flow.tensor(x, device="cuda"), dim=-1)
+                test_case.assertTrue(
+                    np.allclose(log_y.numpy(), np.log(_np_softmax(x)), 1e-4, 1e-4)
+                )
+
+        run()
+        db_files = [
+            name
+            for name in os.listdir(_CACHE_DIR)
+            if name.startswith("kernel_tuning_db.")
+        ]
+        test_case.assertEqual(len(db_files), 1)
+        path = os.path.join(_CACHE_DIR, db_files[0])
+        with open(path) as f:
+            records = [line.split() for line in f]
+        test_case.assertEqual(len(records), 2 * len(shapes))
+        for kernel, key, num_candidates, candidate in records:
+            test_case.assertIn(kernel, ["softmax", "log_softmax"])
+            test_case.assertTrue(0 <= int(candidate) < int(num_candidates))
+        # The same problems are served from the tuned winners and append nothing.
+        run()
+        with open(path) as f:
+            test_case.assertEqual(len(f.readlines()), 2 * len(shapes))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,115 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import subprocess
+import sys
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+# The cpu isa is picked once per process, so every isa is checked in a child process.
+_CPU_ISA_ENV = "ONEFLOW_EP_CPU_MAX_ISA"
+_CHILD_ENV = "ONEFLOW_TEST_LAYER_NORM_CPU_CHILD"
+
+
+def _np_layer_norm(x, dy, gamma, beta, normalized_ndim, eps):
+    norm_axes = tuple(range(x.ndim - normalized_ndim, x.ndim))
+    norm_size = int(np.prod(x.shape[x.ndim - normalized_ndim :]))
+    mean = x.mean(axis=norm_axes, keepdims=True)
+    inv_variance = 1.0 / np.sqrt(x.var(axis=norm_axes, keepdims=True) + eps)
+    x_hat = (x - mean) * inv_variance
+    g = dy if gamma is None else dy * gamma
+    y = x_hat if gamma is None else x_hat * gamma + beta
+    mean_g = g.sum(axis=norm_axes, keepdims=True) / norm_size
+    mean_g_x_hat = (g * x_hat).sum(axis=norm_axes, keepdims=True) / norm_size
+    dx = (g - mean_g - x_hat * mean_g_x_hat) * inv_variance
+    row_axes = tuple(range(x.ndim - normalized_ndim))
+    gamma_diff = (dy * x_hat).sum(axis=row_axes)
+    beta_diff = dy.sum(axis=row_axes)
+    return y, dx, gamma_diff, beta_diff
+
+
+def _test_layer_norm_cpu(test_case, shape, normalized_ndim, affine, dtype):
+    eps = 1e-5
+    normalized_shape = shape[len(shape) - normalized_ndim :]
+    np_dtype = np.float32 if dtype == flow.float32 else np.float64
+    x_np = np.random.randn(*shape).astype(np_dtype)
+    dy_np = np.random.randn(*shape).astype(np_dtype)
+    m = flow.nn.LayerNorm(normalized_shape, eps=eps, elementwise_affine=affine)
+    m = m.to(dtype)
+    gamma_np, beta_np = None, None
+    if affine:
+        gamma_np = np.random.randn(*normalized_shape).astype(np_dtype)
+        beta_np = np.random.randn(*normalized_shape).astype(np_dtype)
+        m.weight.data.copy_(flow.tensor(gamma_np, dtype=dtype))
+        m.bias.data.copy_(flow.tensor(beta_np, dtype=dtype))
+    x = flow.tensor(x_np, dtype=dtype, requires_grad=True)
+    y = m(x)
+    y.backward(flow.tensor(dy_np, dtype=dtype))
+    y_np, dx_np, gamma_diff_np, beta_diff_np = _np_layer_norm(
+        x_np, dy_np, gamma_np, beta_np, normalized_ndim, eps
+    )
+    tol = 1e-4 if dtype == flow.float32 else 1e-8
+    test_case.assertTrue(np.allclose(y.numpy(), y_np, rtol=tol, atol=tol))
+    test_case.assertTrue(np.allclose(x.grad.numpy(), dx_np, rtol=tol, atol=tol))
+    if affine:
+        test_case.assertTrue(
+            np.allclose(m.weight.grad.numpy(), gamma_diff_np, rtol=tol, atol=tol)
+        )
+        test_case.assertTrue(
+            np.allclose(m.bias.grad.numpy(), beta_diff_np, rtol=tol, atol=tol)
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestLayerNormCpu(flow.unittest.TestCase):
+    def test_layer_norm_cpu(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["shape_and_normalized_ndim"] = [
+            ((4, 7, 33), 1),
+            ((2, 3, 300), 2),
+            ((8, 1030), 1),
+            ((5, 1), 1),
+        ]
+        arg_dict["affine"] = [True, False]
+        arg_dict["dtype"] = [flow.float32, flow.float64]
+        for (shape, normalized_ndim), affine, dtype in GenArgList(arg_dict):
+            _test_layer_norm_cpu(test_case, shape, normalized_ndim, affine, dtype)
+
+    @unittest.skipIf(os.getenv(_CHILD_ENV), "already running under a fixed cpu isa")
+    def test_layer_norm_cpu_each_isa(test_case):
+        for isa in ["default", "avx2", "avx512"]:
+            env = dict(os.environ)
+            env[_CPU_ISA_ENV] = isa
+            env[_CHILD_ENV] = "1"
+            result = subprocess.run(
+                [sys.executable, __file__, "TestLayerNormCpu.test_layer_norm_cpu"],
+                env=env,
+                stdout=subprocess.PIPE,
+                stderr=subprocess.STDOUT,
+            )
+            test_case.assertEqual(
+                result.returncode, 0, f"{isa}: {result.stdout.decode()}"
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
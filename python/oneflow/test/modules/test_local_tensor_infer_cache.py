@@ -0,0 +1,51 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestLocalTensorInferCache(flow.unittest.TestCase):
+    def test_repeated_calls_with_changing_metas(test_case):
+        # Calls alternate between cached input metas and attrs, results must follow them.
+        for _ in range(3):
+            for shape in [(2, 3), (4, 5, 6), (2, 3)]:
+                for dtype in [flow.float32, flow.int64]:
+                    x_np = np.random.randint(0, 10, size=shape)
+                    x = flow.tensor(x_np, dtype=dtype)
+                    y = flow.sum(x, dim=0)
+                    test_case.assertEqual(y.shape, flow.Size(shape[1:]))
+                    test_case.assertEqual(y.dtype, dtype)
+                    test_case.assertTrue(np.array_equal(y.numpy(), x_np.sum(axis=0)))
+                    y = flow.sum(x, dim=len(shape) - 1)
+                    test_case.assertEqual(y.shape, flow.Size(shape[:-1]))
+                    test_case.assertTrue(np.array_equal(y.numpy(), x_np.sum(axis=-1)))
+
+    def test_inplace_after_cached_call(test_case):
+        x = flow.ones(2, 3)
+        y = flow.ones(2, 3)
+        z = x + y
+        x.add_(y)
+        test_case.assertTrue(np.array_equal(x.numpy(), z.numpy()))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -306,6 +306,19 @@ class TestTopk(flow.unittest.TestCase):
         )
         return y[0], y[1]
 
+    @autotest(n=3, auto_backward=False)
+    def test_flow_topk_with_large_vocab(test_case):
+        device = random_device()
+        x = random_tensor(ndim=2, dim0=4, dim1=20000).to(device)
+        y = torch.topk(
+            x,
+            random(low=1, high=300).to(int),
+            dim=1,
+            largest=random_bool(),
+            sorted=constant(True),
+        )
+        return y[0], y[1]
+
 
 @flow.unittest.skip_unless_1n1d()
 class TestPow(flow.unittest.TestCase):
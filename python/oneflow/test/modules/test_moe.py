@@ -0,0 +1,144 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_moe_gating(logits, top_k, capacity):
+    num_tokens, num_experts = logits.shape
+    probs = np.exp(logits - logits.max(axis=1, keepdims=True))
+    probs /= probs.sum(axis=1, keepdims=True)
+    expert_indices = np.argsort(-probs, axis=1, kind="stable")[:, :top_k]
+    gates = np.take_along_axis(probs, expert_indices, axis=1)
+    if top_k > 1:
+        gates /= gates.sum(axis=1, keepdims=True)
+    locations = np.zeros_like(expert_indices)
+    offsets = np.zeros(num_experts, dtype=np.int64)
+    for j in range(top_k):
+        for t in range(num_tokens):
+            e = expert_indices[t, j]
+            locations[t, j] = offsets[e] if offsets[e] < capacity else -1
+            offsets[e] += 1
+    top1_fraction = np.bincount(expert_indices[:, 0], minlength=num_experts) / num_tokens
+    aux_loss = num_experts * np.sum(top1_fraction * probs.mean(axis=0))
+    return expert_indices, locations, gates, probs, aux_loss
+
+
+def _test_moe_gating(test_case, device, top_k, capacity):
+    logits_np = np.random.randn(16, 6).astype(np.float32)
+    logits = flow.tensor(logits_np, device=device)
+    expert_indices, locations, gates, probs, aux_loss = flow._C.moe_gating(
+        logits, top_k=top_k, capacity=capacity
+    )
+    (
+        expert_indices_np,
+        locations_np,
+        gates_np,
+        probs_np,
+        aux_loss_np,
+    ) = _np_moe_gating(logits_np, top_k, capacity)
+    test_case.assertTrue(np.array_equal(expert_indices.numpy(), expert_indices_np))
+    test_case.assertTrue(np.array_equal(locations.numpy(), locations_np))
+    test_case.assertTrue(np.allclose(gates.numpy(), gates_np, 1e-05, 1e-05))
+    test_case.assertTrue(np.allclose(probs.numpy(), probs_np, 1e-05, 1e-05))
+    test_case.assertTrue(np.allclose(aux_loss.numpy(), aux_loss_np, 1e-05, 1e-05))
+
+
+def _test_moe_dispatch_combine(test_case, device, top_k, capacity):
+    num_tokens, num_experts, hidden_size = 16, 6, 5
+    logits_np = np.random.randn(num_tokens, num_experts).astype(np.float32)
+    tokens_np = np.random.randn(num_tokens, hidden_size).astype(np.float32)
+    expert_weight_np = np.random.randn(num_experts, 1, hidden_size).astype(np.float32)
+
+    def run(use_fused):
+        logits = flow.tensor(logits_np, device=device, requires_grad=True)
+        tokens = flow.tensor(tokens_np, device=device, requires_grad=True)
+        expert_weight = flow.tensor(expert_weight_np, device=device)
+        expert_indices, locations, gates, probs, aux_loss = flow._C.moe_gating(
+            logits, top_k=top_k, capacity=capacity
+        )
+        if use_fused:
+            buffer = flow._C.moe_dispatch(
+                tokens,
+                expert_indices,
+                locations,
+                num_experts=num_experts,
+                capacity=capacity,
+            )
+            out = flow._C.moe_combine(
+                buffer * expert_weight,
+                expert_indices,
+                locations,
+                gates,
+                num_experts=num_experts,
+                capacity=capacity,
+            )
+        else:
+            kept = flow.tensor(
+                (locations.numpy() >= 0).astype(np.float32), device=device
+            )
+            ref_probs = flow.softmax(logits, dim=1)
+            ref_gates = flow.gather(ref_probs, 1, expert_indices.to(flow.int64))
+            if top_k > 1:
+                ref_gates = ref_gates / ref_gates.sum(dim=1, keepdim=True)
+            weights = flow.tensor(
+                expert_weight_np[expert_indices.numpy(), 0], device=device
+            )
+            out = (
+                tokens.unsqueeze(1) * weights * (ref_gates * kept).unsqueeze(2)
+            ).sum(dim=1)
+            top1_fraction = flow.tensor(
+                np.bincount(expert_indices.numpy()[:, 0], minlength=num_experts)
+                / num_tokens,
+                dtype=flow.float32,
+                device=device,
+            )
+            aux_loss = num_experts * (top1_fraction * ref_probs.mean(dim=0)).sum()
+        (out.sum() + 0.1 * aux_loss.sum()).backward()
+        return out.numpy(), logits.grad.numpy(), tokens.grad.numpy()
+
+    for fused, ref in zip(run(True), run(False)):
+        test_case.assertTrue(np.allclose(fused, ref, 1e-04, 1e-04))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestMoe(flow.unittest.TestCase):
+    def test_moe_gating(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["top_k"] = [1, 2]
+        arg_dict["capacity"] = [2, 16]
+        for arg in GenArgList(arg_dict):
+            _test_moe_gating(test_case, *arg)
+
+    def test_moe_dispatch_combine(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["top_k"] = [1, 2]
+        arg_dict["capacity"] = [2, 16]
+        for arg in GenArgList(arg_dict):
+            _test_moe_dispatch_combine(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
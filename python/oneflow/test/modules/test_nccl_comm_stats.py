@@ -0,0 +1,44 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+class TestNcclCommStats(flow.unittest.TestCase):
+    @flow.unittest.skip_unless_1n2d()
+    def test_comm_is_created_once(test_case):
+        x = flow.tensor(np.ones(4, dtype=np.float32) * (flow.env.get_rank() + 1))
+        y = flow._C.local_all_reduce(x.to("cuda"))
+        test_case.assertTrue(np.allclose(y.numpy(), np.ones(4) * 3))
+        stats = flow._oneflow_internal.nccl.GetCommStats()
+        test_case.assertGreaterEqual(stats["num_comms"], 1)
+        test_case.assertGreaterEqual(stats["memory_bytes"], 0)
+        # Later collectives on the same devices reuse the communicator.
+        y = flow._C.local_all_reduce(x.to("cuda"))
+        test_case.assertTrue(np.allclose(y.numpy(), np.ones(4) * 3))
+        test_case.assertEqual(
+            flow._oneflow_internal.nccl.GetCommStats()["num_comms"], stats["num_comms"]
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,146 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# The oneDNN kernels only take float32 on CPU and float64 runs the generic kernels, so
+# the two results of the same op check the oneDNN kernels when they are built.
+
+
+def _check_float_matches_double(test_case, fn, *arrays):
+    float_out = fn(*[flow.tensor(a, dtype=flow.float32) for a in arrays])
+    double_out = fn(*[flow.tensor(a, dtype=flow.float64) for a in arrays])
+    test_case.assertTrue(
+        np.allclose(float_out.numpy(), double_out.numpy(), rtol=1e-4, atol=1e-4)
+    )
+
+
+def _randn(*shape):
+    return np.random.randn(*shape)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOneDnnKernels(flow.unittest.TestCase):
+    def test_conv2d(test_case):
+        for groups, padding, stride, dilation in [
+            (1, 1, 1, 1),
+            (2, 0, 2, 1),
+            (4, 2, 1, 2),
+        ]:
+            _check_float_matches_double(
+                test_case,
+                lambda x, w, b: flow._C.conv2d(
+                    x,
+                    w,
+                    b,
+                    stride=[stride] * 2,
+                    padding=[padding] * 2,
+                    dilation=[dilation] * 2,
+                    groups=groups,
+                    channel_pos="channels_first",
+                ),
+                _randn(2, 8, 9, 11),
+                _randn(16, 8 // groups, 3, 3),
+                _randn(16),
+            )
+
+    def test_conv2d_channels_last(test_case):
+        _check_float_matches_double(
+            test_case,
+            lambda x, w: flow._C.conv2d(
+                x,
+                w,
+                stride=[1, 1],
+                padding=[1, 1],
+                dilation=[1, 1],
+                groups=1,
+                channel_pos="channels_last",
+            ),
+            _randn(2, 9, 11, 8),
+            _randn(16, 3, 3, 8),
+        )
+
+    def test_deconv2d(test_case):
+        for groups, output_padding in [(1, 0), (2, 1)]:
+
+            def deconv(x, w):
+                m = flow.nn.ConvTranspose2d(
+                    8,
+                    16,
+                    3,
+                    stride=2,
+                    padding=1,
+                    output_padding=output_padding,
+                    groups=groups,
+                    bias=False,
+                ).to(x.dtype)
+                m.weight = flow.nn.Parameter(w)
+                return m(x)
+
+            _check_float_matches_double(
+                test_case, deconv, _randn(2, 8, 5, 7), _randn(8, 16 // groups, 3, 3)
+            )
+
+    def test_matmul(test_case):
+        for transpose_a, transpose_b in [(False, False), (True, False), (False, True)]:
+            _check_float_matches_double(
+                test_case,
+                lambda a, b: flow._C.matmul(
+                    a, b, transpose_a=transpose_a, transpose_b=transpose_b, alpha=0.5
+                ),
+                _randn(6, 5) if not transpose_a else _randn(5, 6),
+                _randn(5, 7) if not transpose_b else _randn(7, 5),
+            )
+        _check_float_matches_double(
+            test_case,
+            lambda a, b: flow._C.batch_matmul(a, b, transpose_b=True),
+            _randn(2, 3, 6, 5),
+            _randn(2, 3, 7, 5),
+        )
+
+    def test_avg_pool2d(test_case):
+        for padding, count_include_pad in [(0, True), (1, True), (1, False)]:
+            _check_float_matches_double(
+                test_case,
+                lambda x: flow.nn.functional.avg_pool2d(
+                    x,
+                    3,
+                    stride=2,
+                    padding=padding,
+                    count_include_pad=count_include_pad,
+                ),
+                _randn(2, 4, 9, 10),
+            )
+
+    def test_batch_norm_inference(test_case):
+        _check_float_matches_double(
+            test_case,
+            lambda x, mean, var, gamma, beta: flow._C.normalization(
+                x, mean, var, gamma, beta, axis=1, is_training=False
+            ),
+            _randn(2, 4, 5, 6),
+            _randn(4),
+            np.random.rand(4) + 0.5,
+            _randn(4),
+            _randn(4),
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
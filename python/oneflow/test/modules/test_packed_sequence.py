@@ -0,0 +1,70 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_pack_unpack_sequences(test_case, device, dtype):
+    lengths = [3, 0, 7, 5]
+    batch_size, max_seqlen, hidden = len(lengths), 8, 6
+    padded = np.random.randn(batch_size, max_seqlen, hidden)
+    x = flow.tensor(padded, dtype=dtype, device=device, requires_grad=True)
+    packed, cu_seqlens, packed_max_seqlen = flow.nn.utils.pack_sequences(x, lengths)
+    test_case.assertEqual(packed_max_seqlen, 7)
+    test_case.assertTrue(
+        np.array_equal(cu_seqlens.numpy(), np.cumsum([0] + lengths).astype(np.int32))
+    )
+    expected_packed = np.concatenate(
+        [padded[b, :length] for b, length in enumerate(lengths)]
+    )
+    test_case.assertTrue(
+        np.allclose(packed.numpy(), expected_packed, atol=1e-3, rtol=1e-3)
+    )
+
+    unpacked = flow.nn.utils.unpack_sequences(packed, cu_seqlens, max_seqlen)
+    mask = np.arange(max_seqlen)[None, :] < np.array(lengths)[:, None]
+    expected_unpacked = padded * mask[:, :, None]
+    test_case.assertTrue(
+        np.allclose(unpacked.numpy(), expected_unpacked, atol=1e-3, rtol=1e-3)
+    )
+
+    out_grad = np.random.randn(*unpacked.shape)
+    unpacked.backward(flow.tensor(out_grad, dtype=dtype, device=device))
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), out_grad * mask[:, :, None], atol=1e-3, rtol=1e-3)
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestPackedSequence(flow.unittest.TestCase):
+    def test_pack_unpack_sequences(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_pack_unpack_sequences]
+        args_dict["device"] = ["cpu", "cuda"]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,127 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_decode_attention(query, keys, values, scale):
+    # query: [num_heads, head_dim], keys/values: [context_len, num_kv_heads, head_dim]
+    num_heads, num_kv_heads = query.shape[0], keys.shape[1]
+    out = np.zeros_like(query)
+    for h in range(num_heads):
+        kv_h = h // (num_heads // num_kv_heads)
+        logits = keys[:, kv_h, :].dot(query[h]) * scale
+        probs = np.exp(logits - logits.max())
+        probs /= probs.sum()
+        out[h] = probs.dot(values[:, kv_h, :])
+    return out
+
+
+def _test_paged_decode(test_case, device, num_heads, num_kv_heads, block_size):
+    head_dim = 16
+    cache = flow.nn.PagedKVCache(
+        2, 32, block_size, num_kv_heads, head_dim, device=device
+    )
+    prompt_lens = [5, 1, 9]
+    history = {}
+    for seq_id in range(len(prompt_lens)):
+        cache.add_sequence(seq_id)
+        history[seq_id] = ([], [])
+    # Prefill all the prompts at once, then decode a few steps, freeing a sequence
+    # midway so that its blocks are reused by a new one.
+    steps = [(list(range(3)), prompt_lens)] + [([0, 1, 2], [1, 1, 1])] * 2
+    steps += [([0, 2], [1, 1]), ([0, 2, 3], [1, 1, 4]), ([0, 2, 3], [1, 1, 1])]
+    for step, (seq_ids, num_tokens) in enumerate(steps):
+        for seq_id in seq_ids:
+            if seq_id not in history:
+                cache.add_sequence(seq_id)
+                history[seq_id] = ([], [])
+        slot_mapping = cache.reserve(seq_ids, num_tokens)
+        total = sum(num_tokens)
+        key_np = np.random.randn(total, num_kv_heads, head_dim).astype(np.float32)
+        value_np = np.random.randn(total, num_kv_heads, head_dim).astype(np.float32)
+        offset = 0
+        for seq_id, n in zip(seq_ids, num_tokens):
+            history[seq_id][0].extend(key_np[offset : offset + n])
+            history[seq_id][1].extend(value_np[offset : offset + n])
+            offset += n
+        for layer in range(2):
+            cache.append(
+                layer,
+                flow.tensor(key_np * (layer + 1), device=device),
+                flow.tensor(value_np, device=device),
+                slot_mapping,
+            )
+        query_np = np.random.randn(len(seq_ids), num_heads, head_dim).astype(
+            np.float32
+        )
+        query = flow.tensor(query_np, device=device)
+        for layer in range(2):
+            out = cache.decode_attention(layer, query, seq_ids)
+            for i, seq_id in enumerate(seq_ids):
+                test_case.assertEqual(
+                    cache.context_len(seq_id), len(history[seq_id][0])
+                )
+                ref = _np_decode_attention(
+                    query_np[i],
+                    np.stack(history[seq_id][0]) * (layer + 1),
+                    np.stack(history[seq_id][1]),
+                    1.0 / np.sqrt(head_dim),
+                )
+                test_case.assertTrue(np.allclose(out.numpy()[i], ref, 1e-04, 1e-04))
+        if step == 2:
+            cache.free_sequence(1)
+            del history[1]
+
+
+def _test_paged_cache_exhausted(test_case, device):
+    cache = flow.nn.PagedKVCache(1, 2, 4, 1, 8, device=device)
+    cache.add_sequence(0)
+    cache.reserve([0], [8])
+    test_case.assertEqual(cache.num_free_blocks, 0)
+    with test_case.assertRaises(RuntimeError):
+        cache.reserve([0], [1])
+    cache.free_sequence(0)
+    test_case.assertEqual(cache.num_free_blocks, 2)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestPagedAttention(flow.unittest.TestCase):
+    def test_paged_decode(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["num_heads"] = [4]
+        arg_dict["num_kv_heads"] = [4, 2]
+        arg_dict["block_size"] = [4, 16]
+        for arg in GenArgList(arg_dict):
+            _test_paged_decode(test_case, *arg)
+
+    def test_paged_cache_exhausted(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        for arg in GenArgList(arg_dict):
+            _test_paged_cache_exhausted(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
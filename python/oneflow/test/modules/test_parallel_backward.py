@@ -0,0 +1,80 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+
+# Must be set before the first backward of this process.
+os.environ["ONEFLOW_AUTOGRAD_PARALLEL_BACKWARD_THREAD_NUM"] = "4"
+
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+from oneflow import autograd
+
+
+class Scale(autograd.Function):
+    @staticmethod
+    def forward(ctx, x):
+        return x * 3
+
+    @staticmethod
+    def backward(ctx, y_grad):
+        return y_grad * 3
+
+
+def _test_multi_branch_backward(test_case, device):
+    x_np = np.random.randn(4, 8).astype(np.float32)
+    weights_np = [np.random.randn(8, 8).astype(np.float32) for _ in range(4)]
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+    weights = [flow.tensor(w, device=device, requires_grad=True) for w in weights_np]
+    hooked_grads = []
+    weights[0].register_hook(lambda grad: hooked_grads.append(grad.numpy()))
+
+    # Independent towers sharing the same input.
+    towers = [flow.relu(flow.matmul(x, w)) for w in weights[:3]]
+    towers.append(Scale.apply(flow.matmul(x, weights[3])))
+    y = sum(tower.sum() for tower in towers)
+    y.backward()
+
+    def relu_mask(w):
+        return (np.matmul(x_np, w) > 0).astype(np.float32)
+
+    x_grad = np.zeros_like(x_np)
+    for i, w in enumerate(weights_np):
+        tower_grad = relu_mask(w) if i < 3 else np.full((4, 8), 3, dtype=np.float32)
+        x_grad += np.matmul(tower_grad, w.T)
+        w_grad = np.matmul(x_np.T, tower_grad)
+        test_case.assertTrue(
+            np.allclose(weights[i].grad.numpy(), w_grad, rtol=1e-4, atol=1e-4)
+        )
+    test_case.assertTrue(np.allclose(x.grad.numpy(), x_grad, rtol=1e-4, atol=1e-4))
+    test_case.assertEqual(len(hooked_grads), 1)
+    test_case.assertTrue(np.allclose(hooked_grads[0], weights[0].grad.numpy()))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestParallelBackward(flow.unittest.TestCase):
+    def test_multi_branch_backward(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            for _ in range(3):
+                _test_multi_branch_backward(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
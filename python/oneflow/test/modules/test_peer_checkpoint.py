@@ -0,0 +1,68 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import shutil
+import unittest
+import uuid
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+from oneflow.utils.peer_checkpoint import PeerCheckpointer
+
+
+def _test_peer_checkpoint(test_case, device):
+    name = "test_peer_checkpoint_" + uuid.uuid4().hex
+    m = flow.nn.Linear(16, 8).to(device)
+    optimizer = flow.optim.SGD(m.parameters(), lr=0.1, momentum=0.9)
+    checkpointer = PeerCheckpointer(name, interval=2)
+    try:
+        test_case.assertIsNone(checkpointer.restore({"model": m.state_dict()}))
+        expected = None
+        for step in range(1, 5):
+            m(flow.randn(4, 16, device=device)).sum().backward()
+            optimizer.step()
+            optimizer.zero_grad()
+            state = {"model": m.state_dict(), "step": step}
+            if step % 2 == 0:
+                expected = {k: v.numpy() for k, v in m.state_dict().items()}
+            checkpointer.save(step, state)
+        checkpointer.wait()
+        test_case.assertTrue(checkpointer.done())
+        restored = checkpointer.restore({"model": m.state_dict(), "step": 0})
+        test_case.assertIsNotNone(restored)
+        step, state = restored
+        test_case.assertEqual(step, 4)
+        test_case.assertEqual(state["step"], 4)
+        for k, v in expected.items():
+            test_case.assertEqual(state["model"][k].device, m.state_dict()[k].device)
+            test_case.assertTrue(np.array_equal(state["model"][k].numpy(), v))
+    finally:
+        root = os.getenv("ONEFLOW_PEER_SNAPSHOT_DIR", "/dev/shm/oneflow_peer_snapshot")
+        shutil.rmtree(os.path.join(root, name), ignore_errors=True)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestPeerCheckpoint(flow.unittest.TestCase):
+    def test_peer_checkpoint(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            _test_peer_checkpoint(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
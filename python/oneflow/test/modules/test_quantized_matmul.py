@@ -0,0 +1,73 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_quantize(x, scale):
+    # Symmetric 8 bit quantization of the google formula, rounding half to even.
+    return np.clip(np.rint(x / scale), -128, 127).astype(np.int32)
+
+
+def _test_quantized_matmul(test_case, device, k, transpose_b, per_channel):
+    m, n, alpha = 5, 12, 0.5
+    a_np = np.random.randn(m, k).astype(np.float32)
+    b_np = np.random.randn(n, k).astype(np.float32)
+    a_scale_np = np.array([np.abs(a_np).max() / 127], dtype=np.float32)
+    if per_channel:
+        b_scale_np = (np.abs(b_np).max(axis=1) / 127).astype(np.float32)
+    else:
+        b_scale_np = np.array([np.abs(b_np).max() / 127], dtype=np.float32)
+    q_a = _np_quantize(a_np, a_scale_np[0])
+    q_b = _np_quantize(b_np, b_scale_np[:, None] if per_channel else b_scale_np[0])
+    # Dequantized reference, the int32 accumulation is exact.
+    ref = (q_a.dot(q_b.T) * a_scale_np[0] * b_scale_np * alpha).astype(np.float32)
+    out = flow._C.quantized_matmul(
+        flow.tensor(a_np, device=device),
+        flow.tensor(b_np if transpose_b else b_np.T.copy(), device=device),
+        flow.tensor(a_scale_np, device=device),
+        flow.tensor(b_scale_np, device=device),
+        transpose_b=transpose_b,
+        alpha=alpha,
+    )
+    test_case.assertEqual(tuple(out.shape), (m, n))
+    test_case.assertTrue(np.allclose(out.numpy(), ref, rtol=1e-5, atol=1e-5))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestQuantizedMatmul(flow.unittest.TestCase):
+    def test_quantized_matmul(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu"]
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"].append("cuda")
+        # k of 33 is not aligned for cuBLASLt and goes through the plain CUDA kernel.
+        arg_dict["k"] = [32, 33]
+        arg_dict["transpose_b"] = [True, False]
+        arg_dict["per_channel"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_quantized_matmul(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,107 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+from oneflow import autograd
+
+
+def _test_saved_tensors_hooks(test_case, device):
+    x_np = np.random.randn(4, 8).astype(np.float32)
+    w_np = np.random.randn(8, 6).astype(np.float32)
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+    w = flow.tensor(w_np, device=device, requires_grad=True)
+    packed_num = [0]
+    unpacked_num = [0]
+
+    def pack_hook(tensor):
+        packed_num[0] += 1
+        return tensor.to(flow.float64)
+
+    def unpack_hook(tensor):
+        unpacked_num[0] += 1
+        return tensor.to(flow.float32)
+
+    with autograd.graph.saved_tensors_hooks(pack_hook, unpack_hook):
+        y = flow.tanh(flow.matmul(x, w))
+    test_case.assertGreater(packed_num[0], 0)
+    test_case.assertEqual(unpacked_num[0], 0)
+    y.sum().backward()
+    test_case.assertEqual(unpacked_num[0], packed_num[0])
+
+    y_np = np.tanh(np.matmul(x_np, w_np))
+    y_grad = 1 - y_np * y_np
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), np.matmul(y_grad, w_np.T), rtol=1e-4, atol=1e-4)
+    )
+    test_case.assertTrue(
+        np.allclose(w.grad.numpy(), np.matmul(x_np.T, y_grad), rtol=1e-4, atol=1e-4)
+    )
+
+
+def _test_save_on_cpu(test_case, device):
+    class Square(autograd.Function):
+        @staticmethod
+        def forward(ctx, x):
+            ctx.save_for_backward(x)
+            return x * x
+
+        @staticmethod
+        def backward(ctx, y_grad):
+            (x,) = ctx.saved_tensors
+            test_case.assertEqual(x.device, flow.device(device))
+            return y_grad * 2 * x
+
+    x_np = np.random.randn(3, 5).astype(np.float32)
+    x = flow.tensor(x_np, device=device, requires_grad=True)
+    with autograd.graph.save_on_cpu():
+        y = flow.sigmoid(Square.apply(x))
+    y.sum().backward()
+    s = 1 / (1 + np.exp(-x_np * x_np))
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), s * (1 - s) * 2 * x_np, rtol=1e-4, atol=1e-4)
+    )
+
+
+def _test_pack_hook_error(test_case, device):
+    def pack_hook(tensor):
+        raise ValueError("pack failed")
+
+    x = flow.ones(2, 3, device=device, requires_grad=True)
+    with test_case.assertRaises(Exception):
+        with autograd.graph.saved_tensors_hooks(pack_hook, lambda x: x):
+            flow.sin(x)
+    # The hooks are popped by the context manager.
+    flow.sin(x).sum().backward()
+    test_case.assertTrue(np.allclose(x.grad.numpy(), np.cos(np.ones((2, 3)))))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestSavedTensorsHooks(flow.unittest.TestCase):
+    def test_saved_tensors_hooks(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+                continue
+            _test_saved_tensors_hooks(test_case, device)
+            _test_save_on_cpu(test_case, device)
+            _test_pack_hook_error(test_case, device)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,88 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import threading
+import unittest
+
+import numpy as np
+
+# Read once, when the first instructions are received by the virtual machine.
+os.environ["ONEFLOW_EAGER_ENABLE_SYNC_CPU_EXECUTION"] = "1"
+
+import oneflow as flow
+import oneflow.unittest
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestSyncCpuExecution(flow.unittest.TestCase):
+    def test_mlp_inference(test_case):
+        np_x = np.random.randn(4, 16).astype(np.float32)
+        np_w1 = np.random.randn(32, 16).astype(np.float32)
+        np_w2 = np.random.randn(8, 32).astype(np.float32)
+        x = flow.tensor(np_x)
+        w1 = flow.tensor(np_w1)
+        w2 = flow.tensor(np_w2)
+        for _ in range(3):
+            y = flow.matmul(flow.relu(flow.matmul(x, w1.T)), w2.T)
+        np_y = np.matmul(np.maximum(np.matmul(np_x, np_w1.T), 0), np_w2.T)
+        test_case.assertTrue(np.allclose(y.numpy(), np_y, rtol=1e-4, atol=1e-4))
+
+    def test_inplace_and_view(test_case):
+        x = flow.zeros(2, 3)
+        view = x.view(3, 2)
+        for i in range(5):
+            x.add_(1)
+            x.mul_(2)
+        expected = np.zeros((2, 3), dtype=np.float32)
+        for i in range(5):
+            expected = (expected + 1) * 2
+        test_case.assertTrue(np.array_equal(x.numpy(), expected))
+        test_case.assertTrue(np.array_equal(view.numpy(), expected.reshape(3, 2)))
+
+    def test_concurrent_issuing_threads(test_case):
+        # Instructions issued by one thread while another computes inline must not
+        # be run before the inline ones are done.
+        np_w = np.random.randn(16, 16).astype(np.float32)
+        w = flow.tensor(np_w)
+        num_threads = 4
+        num_iters = 50
+        results = [None] * num_threads
+
+        def Run(index):
+            x = flow.ones(8, 16) * index
+            for _ in range(num_iters):
+                x = flow.relu(flow.matmul(x, w))
+                x.mul_(0.5)
+                x = x / (x.sum() + 1)
+            results[index] = x.numpy()
+
+        threads = [threading.Thread(target=Run, args=(i,)) for i in range(num_threads)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for index in range(num_threads):
+            np_x = np.ones((8, 16), dtype=np.float32) * index
+            for _ in range(num_iters):
+                np_x = np.maximum(np.matmul(np_x, np_w), 0) * 0.5
+                np_x = np_x / (np_x.sum() + 1)
+            test_case.assertTrue(
+                np.allclose(results[index], np_x, rtol=1e-3, atol=1e-5)
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,102 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from oneflow.test_utils.test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.nn.modules.weight_only_quantization import quantize_weight_only
+
+
+def _np_dequantize(q, scale, num_bits, group_size):
+    q = q.astype(np.int32)
+    if num_bits == 4:
+        low = ((q & 0xF) ^ 0x8) - 0x8
+        high = q >> 4
+        q = np.stack([low, high], axis=2).reshape(q.shape[0], -1)
+    return q * np.repeat(scale, group_size, axis=1)
+
+
+def _test_weight_only_quant_matmul(test_case, device, num_bits, m, has_bias):
+    k, n, group_size = 64, 24, 16
+    x_np = np.random.randn(m, k).astype(np.float32)
+    w_np = np.random.randn(n, k).astype(np.float32)
+    bias_np = np.random.randn(n).astype(np.float32)
+    q, scale = quantize_weight_only(
+        flow.tensor(w_np, device=device), num_bits, group_size
+    )
+    test_case.assertEqual(q.dtype, flow.int8)
+    test_case.assertEqual(tuple(q.shape), (n, k * num_bits // 8))
+    dequantized = _np_dequantize(q.numpy(), scale.numpy(), num_bits, group_size)
+    # The quantization error is at most half a step of every group.
+    test_case.assertTrue(
+        np.all(np.abs(dequantized - w_np) <= np.repeat(scale.numpy(), group_size, 1))
+    )
+    bias = flow.tensor(bias_np, device=device) if has_bias else None
+    out = flow._C.weight_only_quant_matmul(
+        flow.tensor(x_np, device=device),
+        q,
+        scale,
+        bias,
+        num_bits=num_bits,
+        group_size=group_size,
+    )
+    ref = x_np.dot(dequantized.T) + (bias_np if has_bias else 0)
+    test_case.assertTrue(np.allclose(out.numpy(), ref, 1e-04, 1e-04))
+
+
+def _test_convert_to_weight_only_quant(test_case, device, num_bits):
+    model = flow.nn.Sequential(
+        flow.nn.Linear(64, 32), flow.nn.ReLU(), flow.nn.Linear(32, 8, bias=False)
+    ).to(device)
+    x = flow.randn(2, 5, 64, device=device)
+    ref = model(x).numpy()
+    model = flow.nn.utils.convert_to_weight_only_quant(model, num_bits, group_size=32)
+    test_case.assertTrue(isinstance(model[0], flow.nn.WeightOnlyQuantLinear))
+    test_case.assertTrue(isinstance(model[2], flow.nn.WeightOnlyQuantLinear))
+    test_case.assertTrue(model[2].bias is None)
+    out = model(x).numpy()
+    test_case.assertEqual(out.shape, ref.shape)
+    tol = 0.05 if num_bits == 8 else 0.5
+    test_case.assertTrue(np.abs(out - ref).max() < tol)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestWeightOnlyQuantMatmul(flow.unittest.TestCase):
+    def test_weight_only_quant_matmul(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["num_bits"] = [4, 8]
+        # A few rows go through the fused gemv kernel, many through dequantize and GEMM.
+        arg_dict["m"] = [1, 3, 33]
+        arg_dict["has_bias"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_weight_only_quant_matmul(test_case, *arg)
+
+    def test_convert_to_weight_only_quant(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["num_bits"] = [4, 8]
+        for arg in GenArgList(arg_dict):
+            _test_convert_to_weight_only_quant(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -16,6 +16,7 @@ limitations under the License.
 
 import itertools
 import os
+import subprocess
 from collections import OrderedDict
 from collections.abc import Iterable
 
@@ -117,3 +118,26 @@ def Coordinate2Index(coordinate, tensor_shape):
             size_at_axis *= tensor_shape[j]
         idx += size_at_axis
     return idx
+
+
+def IsFp8CapableGpu():
+    # fp8 GEMMs need CUDA 11.8, cuBLASLt and a GPU of compute capability 8.9 or above.
+    if os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+        return False
+    if not flow._oneflow_internal.flags.with_cuda():
+        return False
+    if flow._oneflow_internal.flags.cuda_version() < 11080:
+        return False
+    cublas_lt = os.getenv("ONEFLOW_EP_CUDA_ENABLE_CUBLASLT_MATMUL", "1")
+    if cublas_lt.lower() in ("0", "false"):
+        return False
+    try:
+        output = subprocess.check_output(
+            ["nvidia-smi", "--query-gpu=compute_cap", "--format=csv,noheader"]
+        )
+    except (OSError, subprocess.CalledProcessError):
+        return False
+    caps = output.decode().split()
+    if len(caps) == 0:
+        return False
+    return all(tuple(int(v) for v in cap.split(".")) >= (8, 9) for cap in caps)
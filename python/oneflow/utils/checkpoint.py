@@ -0,0 +1,76 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow as flow
+import oneflow._oneflow_internal
+from oneflow.framework.tensor_tuple_util import convert_to_tensor_tuple
+
+
+def _flatten_tensors(outputs):
+    if isinstance(outputs, flow.Tensor):
+        return [outputs]
+    if isinstance(outputs, (tuple, list)):
+        return [x for x in outputs if isinstance(x, flow.Tensor)]
+    raise TypeError(
+        "the checkpointed function must return a tensor or a tuple or list of tensors, "
+        f"but got {type(outputs)}"
+    )
+
+
+def checkpoint(function, *args, preserve_rng_state=True):
+    r"""
+    Checkpoints a part of the model to trade compute for memory.
+
+    ``function`` runs without saving its intermediate activations for backward; only the
+    inputs of the segment are kept. The ops it runs are recorded in C++, and backward
+    replays them through the interpreter to recompute the activations before computing
+    the gradients, without calling ``function`` again.
+
+    If ``preserve_rng_state`` is True, the state of the default generator before the
+    first random op of the segment is restored in the replay, so that ops like dropout
+    produce the same result as in forward.
+
+    The checkpointed function must not modify its inputs inplace, nor call custom
+    ``autograd.Function`` or other checkpointed functions.
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> from oneflow.utils.checkpoint import checkpoint
+        >>> x = flow.ones(2, 3, requires_grad=True)
+        >>> y = checkpoint(lambda t: (t * t).sin(), x)
+        >>> y.sum().backward()
+        >>> x.grad.shape
+        oneflow.Size([2, 3])
+    """
+    if not flow.is_grad_enabled():
+        return function(*args)
+    oneflow._oneflow_internal.autograd._begin_checkpoint(preserve_rng_state)
+    try:
+        outputs = function(*args)
+        outputs_tensors = _flatten_tensors(outputs)
+    except BaseException:
+        oneflow._oneflow_internal.autograd._abort_checkpoint()
+        raise
+    oneflow._oneflow_internal.autograd._end_checkpoint(
+        convert_to_tensor_tuple(outputs_tensors)
+    )
+    return outputs
+
+
+if __name__ == "__main__":
+    import doctest
+
+    doctest.testmod(raise_on_error=True)
@@ -0,0 +1,54 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow as flow
+import oneflow._oneflow_internal
+
+_kDLCPU = 1
+_kDLCUDA = 2
+
+
+def to_dlpack(tensor, stream=None):
+    r"""
+    Returns a DLPack capsule sharing the memory of the local eager ``tensor``.
+
+    For a cuda tensor, ``stream`` is the stream of the consumer as in ``__dlpack__``:
+    ``None`` or ``1`` for the legacy default stream, ``2`` for the per-thread default
+    stream, a ``cudaStream_t`` as an integer, or ``-1`` to skip the synchronization.
+    That stream waits for the work already issued on the tensor.
+    """
+    if stream is None:
+        stream = 1
+    return flow._oneflow_internal.dlpack.to_dlpack(tensor, stream)
+
+
+def from_dlpack(ext_tensor):
+    r"""
+    Returns a tensor sharing the memory of ``ext_tensor``, which is either an object
+    implementing ``__dlpack__`` or a DLPack capsule. A capsule can be consumed only
+    once.
+
+    A cuda producer is asked for its data on the legacy default stream, which the
+    stream of the returned tensor waits for before using it.
+    """
+    if hasattr(ext_tensor, "__dlpack__"):
+        device_type, _ = ext_tensor.__dlpack_device__()
+        if device_type == _kDLCUDA:
+            capsule = ext_tensor.__dlpack__(stream=1)
+        else:
+            capsule = ext_tensor.__dlpack__()
+    else:
+        capsule = ext_tensor
+    return flow._oneflow_internal.dlpack.from_dlpack(capsule)
@@ -0,0 +1,136 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import pickle
+from typing import Any, Optional, Tuple
+
+import numpy as np
+
+import oneflow as flow
+import oneflow._oneflow_internal
+
+
+class _LocalData:
+    def __init__(self, array: np.ndarray):
+        self.array = array
+
+
+def _to_local_data(obj: Any) -> Any:
+    if isinstance(obj, flow.Tensor):
+        tensor = obj.to_local() if obj.is_global else obj
+        return _LocalData(tensor.numpy())
+    if isinstance(obj, dict):
+        return type(obj)((k, _to_local_data(v)) for (k, v) in obj.items())
+    if isinstance(obj, (list, tuple)):
+        return type(obj)(_to_local_data(v) for v in obj)
+    return obj
+
+
+def _from_local_data(obj: Any, like: Any) -> Any:
+    if isinstance(obj, _LocalData):
+        if not isinstance(like, flow.Tensor):
+            raise ValueError("the restored state does not match the structure of like")
+        if like.is_global:
+            local = flow.tensor(
+                obj.array, dtype=like.dtype, device=flow.device(like.placement.type)
+            )
+            return local.to_global(placement=like.placement, sbp=like.sbp)
+        return flow.tensor(obj.array, dtype=like.dtype, device=like.device)
+    if isinstance(obj, dict):
+        return type(obj)(
+            (k, _from_local_data(v, like.get(k) if isinstance(like, dict) else None))
+            for (k, v) in obj.items()
+        )
+    if isinstance(obj, (list, tuple)):
+        likes = like if isinstance(like, (list, tuple)) else [None] * len(obj)
+        return type(obj)(_from_local_data(v, l) for (v, l) in zip(obj, likes))
+    return obj
+
+
+class PeerCheckpointer:
+    r"""
+    Keeps in-memory checkpoints of the local shards of a model and its optimizer on this
+    rank and on a buddy rank of another node, so that a job restarted after a node
+    failure restores them from the surviving peers at network speed, instead of from a
+    checkpoint on storage.
+
+    The shards are kept in files under ``ONEFLOW_PEER_SNAPSHOT_DIR``, ``/dev/shm`` by
+    default, which outlive the processes. The copy to host memory is synchronous, the
+    write and the transfer to the buddy run in the background.
+
+    Args:
+        name (str): The name of the checkpoint, unique among the jobs sharing the nodes.
+        interval (int): :meth:`save` replicates the state every ``interval`` steps.
+
+    For example:
+
+    .. code-block:: python
+
+        checkpointer = flow.utils.peer_checkpoint.PeerCheckpointer("gpt", interval=100)
+        like = {"model": model.state_dict(), "optim": optimizer.state_dict()}
+        restored = checkpointer.restore(like)
+        if restored is None:
+            restored = (0, flow.load(checkpoint_path))
+        step, state = restored
+        model.load_state_dict(state["model"])
+        optimizer.load_state_dict(state["optim"])
+        for step in range(step + 1, num_steps):
+            train_one_step()
+            checkpointer.save(
+                step, {"model": model.state_dict(), "optim": optimizer.state_dict()}
+            )
+    """
+
+    def __init__(self, name: str, interval: int = 1):
+        if interval <= 0:
+            raise ValueError(f"interval must be positive, but got {interval}")
+        self.name = name
+        self.interval = interval
+
+    def save(self, step: int, state: Any) -> None:
+        r"""Replicates the local shards of the tensors of ``state`` if ``step`` is a
+        multiple of the interval. Collective, all the ranks have to call it.
+        """
+        if step % self.interval != 0:
+            return
+        shard = pickle.dumps(_to_local_data(state), protocol=pickle.HIGHEST_PROTOCOL)
+        oneflow._oneflow_internal.peer_snapshot.Replicate(self.name, step, shard)
+
+    def done(self) -> bool:
+        r"""Returns whether the last replication has finished."""
+        return oneflow._oneflow_internal.peer_snapshot.IsReplicated()
+
+    def wait(self) -> None:
+        r"""Blocks until the last replication has finished."""
+        oneflow._oneflow_internal.peer_snapshot.WaitReplicated()
+
+    def restore(self, like: Any) -> Optional[Tuple[int, Any]]:
+        r"""Restores the latest step which all the ranks can restore from their peers.
+        Collective, all the ranks have to call it.
+
+        Args:
+            like: A state of the same structure as the saved one, such as the current
+                ``state_dict()``, whose tensors give the dtype, device, placement and
+                sbp of the restored tensors.
+
+        Returns:
+            ``(step, state)``, or None if some shard has no copy left, in which case the
+            checkpoint has to be loaded from storage.
+        """
+        restored = oneflow._oneflow_internal.peer_snapshot.Restore(self.name)
+        if restored is None:
+            return None
+        step, shard = restored
+        return step, _from_local_data(pickle.loads(shard), like)
@@ -0,0 +1,88 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# Measures the host overhead per call of the functional ops bound to python on tiny
+# tensors, which is dominated by the argument parsing and dispatch. Each case is timed
+# with positional arguments, taking the fast path of the generated schemas, and with the
+# same call through keywords, which goes through the generic ParseArgs. The records are
+# printed as a json array.
+import argparse
+import json
+import time
+
+import oneflow as flow
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--device", type=str, default="cpu")
+parser.add_argument("--iters", type=int, default=100000)
+parser.add_argument("--warmup", type=int, default=1000)
+parser.add_argument(
+    "--output", type=str, default=None, help="File the json is written to."
+)
+args = parser.parse_args()
+
+
+def _cases(x, y):
+    index = flow.tensor([0], dtype=flow.int64, device=x.device)
+    # The last argument is also passed by the keyword for the generic path.
+    return [
+        ("add_tensor_tensor", flow._C.add, (x, y), "other"),
+        ("add_tensor_scalar", flow._C.add, (x, 1), "other"),
+        ("mul_tensor_tensor", flow._C.mul, (x, y), "other"),
+        ("mul_scalar_tensor", flow._C.mul, (2.0, y), "other"),
+        ("getitem_int", flow._C.tensor_getitem, (x, 0), "index"),
+        ("getitem_slice", flow._C.tensor_getitem, (x, slice(0, 1)), "index"),
+        ("getitem_tensor", flow._C.tensor_getitem, (x, index), "index"),
+    ]
+
+
+def _time_per_call_us(func):
+    for _ in range(args.warmup):
+        func()
+    flow._oneflow_internal.eager.Sync()
+    start = time.perf_counter()
+    for _ in range(args.iters):
+        func()
+    flow._oneflow_internal.eager.Sync()
+    return (time.perf_counter() - start) * 1e6 / args.iters
+
+
+def main():
+    x = flow.ones(2, 2, device=args.device)
+    y = flow.ones(2, 2, device=args.device)
+    records = []
+    for name, func, func_args, keyword in _cases(x, y):
+        kwargs = {keyword: func_args[-1]}
+        fast_us = _time_per_call_us(lambda: func(*func_args))
+        generic_us = _time_per_call_us(lambda: func(*func_args[:-1], **kwargs))
+        records.append(
+            {
+                "case": name,
+                "device": args.device,
+                "iters": args.iters,
+                "fast_path_us": fast_us,
+                "generic_path_us": generic_us,
+            }
+        )
+    content = json.dumps(records, indent=2)
+    if args.output is None:
+        print(content)
+    else:
+        with open(args.output, "w") as f:
+            f.write(content + "\n")
+
+
+if __name__ == "__main__":
+    main()
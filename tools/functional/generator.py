@@ -86,6 +86,20 @@ mangled_name = {
     "DataTypeList": "Dtl",
 }
 
+# Positional argument types the C++ dispatcher matches with a plain C-level type check,
+# see FastParseArgs in oneflow/api/python/functional/py_function.cpp.
+fast_path_types = {
+    "Tensor",
+    "Scalar",
+    "TensorIndex",
+    "Int",
+    "Int32",
+    "Int64",
+    "Float",
+    "Double",
+    "Bool",
+}
+
 generic_type_aliases = {
     "Int": "int32_t",
     "Int32": "int32_t",
@@ -364,6 +378,12 @@ class FunctionSignature:
         fmt += ")"
         return fmt
 
+    @property
+    def has_fast_path(self):
+        return all(
+            arg._keyword_only or arg._type in fast_path_types for arg in self._args
+        )
+
     def get_mangled_type(self):
         fmt = mangled_name[self._ret._type]
         for _, arg in enumerate(self._args):
@@ -474,6 +494,9 @@ class Generator:
                 schema_fmt += '  static constexpr char const* signature = "{0}";\n'.format(
                     _escape_quote(signature.to_string(drop_name=True))
                 )
+                schema_fmt += "  static constexpr bool fast_path = {0};\n".format(
+                    "true" if signature.has_fast_path else "false"
+                )
                 schema_fmt += "  static FunctionDef function_def;\n"
                 schema_fmt += "};\n"
                 schema_fmt += "\n"
@@ -486,6 +509,9 @@ class Generator:
                 schema_fmt += "constexpr char const* {0}::signature;\n".format(
                     signature.get_schema_name()
                 )
+                schema_fmt += "constexpr bool {0}::fast_path;\n".format(
+                    signature.get_schema_name()
+                )
                 return_def = "ReturnDef(ValueTypeOf<{0}>())".format(return_type)
                 argument_def = []
                 for arg in signature._args:
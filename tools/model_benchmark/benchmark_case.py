@@ -0,0 +1,200 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# Runs one case of the model benchmark suite, a model trained in eager or graph mode at
+# a scale, and writes its record as json. run_benchmarks.py launches the cases, this
+# script only has to be run directly to look into one of them, under
+# oneflow.distributed.launch if the case takes several ranks.
+#
+# startup_s: from the launch of the process to the first step, i.e. importing oneflow
+#     and building the model, its data and its optimizer. MODEL_BENCHMARK_LAUNCH_TIME
+#     holds the launch time given by run_benchmarks.py, the process start is taken
+#     without it.
+# compile_s: the first step, which compiles the graph in graph mode and initializes the
+#     kernels in eager mode.
+# throughput_samples_per_s: over --iters steps synchronized at the end only.
+# latency_*_ms: percentiles of --latency_iters steps synchronized one by one.
+# peak_allocated_bytes, peak_reserved_bytes: of the VM allocators of this process over
+#     the startup, the first step and the warmup, as traced by the memory trace. The
+#     memory the plans of graphs reserve is not included.
+# device_used_bytes: memory of the devices used by this process after the warmup as
+#     reported by nvidia-smi, including the memory of graphs and the CUDA context.
+import argparse
+import json
+import os
+import subprocess
+import time
+
+_LAUNCH_TIME = float(os.getenv("MODEL_BENCHMARK_LAUNCH_TIME", "0"))
+if _LAUNCH_TIME <= 0:
+    try:
+        import psutil
+
+        _LAUNCH_TIME = psutil.Process().create_time()
+    except ImportError:
+        _LAUNCH_TIME = time.time()
+
+_IMPORT_START = time.time()
+import oneflow as flow
+
+_IMPORT_END = time.time()
+
+import bert
+import dlrm
+import gpt
+import resnet50
+from common import make_train_step
+from scales import SCALES
+
+MODELS = {"resnet50": resnet50, "bert": bert, "dlrm": dlrm, "gpt": gpt}
+MODES = ("eager", "graph")
+
+
+def _sync():
+    flow._oneflow_internal.eager.Sync()
+
+
+def _percentile(sorted_values, q):
+    index = int(round(q / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[index]
+
+
+def _device_used_bytes():
+    try:
+        output = subprocess.check_output(
+            [
+                "nvidia-smi",
+                "--query-compute-apps=pid,used_memory",
+                "--format=csv,noheader,nounits",
+            ],
+            universal_newlines=True,
+        )
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    used_mib = 0
+    for line in output.strip().splitlines():
+        pid, memory = [field.strip() for field in line.split(",")]
+        if pid == str(os.getpid()) and memory.isdigit():
+            used_mib += int(memory)
+    return used_mib * 1024 * 1024
+
+
+def _peak_memory():
+    snapshot = flow.profiler.get_memory_snapshot(at_peak=True)
+    peak_allocated = 0
+    peak_reserved = 0
+    for device_snapshot in snapshot.values():
+        peak_allocated = max(peak_allocated, device_snapshot["peak_allocated_bytes"])
+        peak_reserved = max(peak_reserved, device_snapshot["peak_reserved_bytes"])
+    return peak_allocated, peak_reserved
+
+
+def run_case(args):
+    scale = SCALES[args.model][args.scale]
+    flow.profiler.enable_memory_trace()
+    workload = MODELS[args.model].build(args, scale, args.mode)
+    step = make_train_step(workload, args.mode)
+    _sync()
+    startup_end = time.time()
+
+    start = time.perf_counter()
+    step()
+    _sync()
+    compile_s = time.perf_counter() - start
+    for _ in range(args.warmup):
+        step()
+    _sync()
+    # The steps measured repeat the warmup ones, so the peak has been reached.
+    flow.profiler.disable_memory_trace()
+    peak_allocated, peak_reserved = _peak_memory()
+    device_used = _device_used_bytes()
+
+    start = time.perf_counter()
+    for _ in range(args.iters):
+        step()
+    _sync()
+    throughput = workload.samples_per_step * args.iters / (time.perf_counter() - start)
+
+    latencies = []
+    for _ in range(args.latency_iters):
+        start = time.perf_counter()
+        step()
+        _sync()
+        latencies.append((time.perf_counter() - start) * 1e3)
+    latencies.sort()
+    if workload.cleanup is not None:
+        workload.cleanup()
+
+    record = {
+        "model": args.model,
+        "mode": args.mode,
+        "scale": args.scale,
+        "world_size": flow.env.get_world_size(),
+        "amp": workload.amp,
+        "samples_per_step": workload.samples_per_step,
+        "info": workload.info,
+        "metrics": {
+            "throughput_samples_per_s": throughput,
+            "latency_p50_ms": _percentile(latencies, 50),
+            "latency_p90_ms": _percentile(latencies, 90),
+            "latency_p99_ms": _percentile(latencies, 99),
+            "peak_allocated_bytes": peak_allocated,
+            "peak_reserved_bytes": peak_reserved,
+            "device_used_bytes": device_used,
+            "compile_s": compile_s,
+            "startup_s": startup_end - _LAUNCH_TIME,
+            "import_s": _IMPORT_END - _IMPORT_START,
+        },
+    }
+    return record
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", type=str, required=True, choices=sorted(MODELS))
+    parser.add_argument("--mode", type=str, required=True, choices=MODES)
+    parser.add_argument("--scale", type=str, default="small")
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--iters", type=int, default=50)
+    parser.add_argument("--latency_iters", type=int, default=50)
+    parser.add_argument(
+        "--data_dir", type=str, default=None, help="OFRecords of ImageNet for resnet50."
+    )
+    parser.add_argument("--data_part_num", type=int, default=1)
+    parser.add_argument(
+        "--embedding_dir",
+        type=str,
+        default=None,
+        help="Directory the PersistentTable of dlrm is created in.",
+    )
+    parser.add_argument(
+        "--output", type=str, default=None, help="File the json is written to."
+    )
+    args = parser.parse_args()
+    if args.scale not in SCALES[args.model]:
+        parser.error("{} has no scale {}".format(args.model, args.scale))
+    record = run_case(args)
+    if flow.env.get_rank() != 0:
+        return
+    content = json.dumps(record, indent=2)
+    if args.output is None:
+        print(content)
+    else:
+        with open(args.output, "w") as f:
+            f.write(content + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# BERT pretraining, masked language model and next sentence prediction, with AdamW on
+# synthetic tokens. Graph mode trains with AMP, eager mode in float32.
+import oneflow as flow
+import oneflow.nn as nn
+
+from common import Workload
+from transformer import TransformerLayer
+
+VOCAB_SIZE = 30522
+SEQ_LEN = 128
+MAX_PREDICTIONS = 20
+TYPE_VOCAB_SIZE = 2
+
+
+class BertPretraining(nn.Module):
+    def __init__(self, num_layers, hidden_size, num_heads):
+        super().__init__()
+        self.word_embedding = nn.Embedding(VOCAB_SIZE, hidden_size)
+        self.position_embedding = nn.Embedding(SEQ_LEN, hidden_size)
+        self.type_embedding = nn.Embedding(TYPE_VOCAB_SIZE, hidden_size)
+        self.embedding_norm = nn.LayerNorm(hidden_size)
+        self.layers = nn.ModuleList(
+            [
+                TransformerLayer(hidden_size, num_heads, causal=False, pre_norm=False)
+                for _ in range(num_layers)
+            ]
+        )
+        self.mlm_transform = nn.Sequential(
+            nn.Linear(hidden_size, hidden_size), nn.GELU(), nn.LayerNorm(hidden_size)
+        )
+        self.mlm_bias = nn.Parameter(flow.zeros(VOCAB_SIZE))
+        self.pooler = nn.Sequential(nn.Linear(hidden_size, hidden_size), nn.Tanh())
+        self.nsp = nn.Linear(hidden_size, 2)
+        self.loss = nn.CrossEntropyLoss()
+
+    def forward(
+        self, tokens, token_types, attention_mask, mlm_positions, mlm_labels, nsp_labels
+    ):
+        positions = flow.arange(SEQ_LEN, device=tokens.device).unsqueeze(0)
+        x = (
+            self.word_embedding(tokens)
+            + self.position_embedding(positions)
+            + self.type_embedding(token_types)
+        )
+        x = self.embedding_norm(x)
+        # Padding is masked out of the attention scores.
+        mask = ((1.0 - attention_mask) * -10000.0).unsqueeze(1).unsqueeze(1)
+        for layer in self.layers:
+            x = layer(x, mask)
+        hidden_size = x.shape[-1]
+        index = mlm_positions.unsqueeze(-1).expand(-1, -1, hidden_size)
+        mlm_hidden = self.mlm_transform(flow.gather(x, 1, index))
+        # The decoder of the masked tokens shares the weight of the word embedding.
+        mlm_logits = (
+            flow._C.matmul(
+                mlm_hidden.reshape(-1, hidden_size),
+                self.word_embedding.weight,
+                transpose_b=True,
+            )
+            + self.mlm_bias
+        )
+        nsp_logits = self.nsp(self.pooler(x[:, 0]))
+        return self.loss(mlm_logits, mlm_labels.reshape(-1)) + self.loss(
+            nsp_logits, nsp_labels
+        )
+
+
+def build(args, scale, mode):
+    batch_size = scale["batch_size"]
+    model = BertPretraining(
+        scale["num_layers"], scale["hidden_size"], scale["num_heads"]
+    ).to("cuda")
+    attention_mask = flow.ones(batch_size, SEQ_LEN, device="cuda")
+    # The tail of the second half of the samples is padding.
+    attention_mask[batch_size // 2 :, SEQ_LEN * 3 // 4 :] = 0
+    inputs = (
+        flow.randint(0, VOCAB_SIZE, (batch_size, SEQ_LEN), device="cuda"),
+        flow.randint(0, TYPE_VOCAB_SIZE, (batch_size, SEQ_LEN), device="cuda"),
+        attention_mask,
+        flow.randint(0, SEQ_LEN, (batch_size, MAX_PREDICTIONS), device="cuda"),
+        flow.randint(0, VOCAB_SIZE, (batch_size, MAX_PREDICTIONS), device="cuda"),
+        flow.randint(0, 2, (batch_size,), device="cuda"),
+    )
+    optimizer = flow.optim.AdamW(model.parameters(), lr=1e-4, weight_decay=0.01)
+    info = dict(scale, seq_len=SEQ_LEN, data="synthetic")
+    del info["nproc"]
+    return Workload(
+        model,
+        optimizer,
+        inputs,
+        samples_per_step=batch_size,
+        amp=mode == "graph",
+        info=info,
+    )
@@ -0,0 +1,92 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# Pieces shared by the models of the benchmark suite: the workload a model hands to
+# case.py and the ways it is trained, step by step in eager mode or as one nn.Graph.
+import oneflow as flow
+
+
+class Workload(object):
+    """A model ready to be trained.
+
+    `module` returns the loss of a step from `inputs`, which are empty when the module
+    reads its own data. A step trains on `samples_per_step` samples over all the ranks.
+    `configure_graph` is called with the nn.Graph wrapping `module` in graph mode, e.g.
+    to set the pipeline stages.
+    """
+
+    def __init__(
+        self,
+        module,
+        optimizer,
+        inputs=(),
+        samples_per_step=1,
+        amp=False,
+        accumulation_steps=1,
+        configure_graph=None,
+        info=None,
+        cleanup=None,
+    ):
+        self.module = module
+        self.optimizer = optimizer
+        self.inputs = tuple(inputs)
+        self.samples_per_step = samples_per_step
+        self.amp = amp
+        self.accumulation_steps = accumulation_steps
+        self.configure_graph = configure_graph
+        # Extra fields of the record of the case, such as the shapes of the model.
+        self.info = dict(info or {})
+        self.cleanup = cleanup
+
+
+class TrainGraph(flow.nn.Graph):
+    def __init__(self, workload):
+        super().__init__()
+        self.module = workload.module
+        self.add_optimizer(workload.optimizer)
+        if workload.amp:
+            self.config.enable_amp(True)
+            self.set_grad_scaler(flow.amp.GradScaler())
+        if workload.accumulation_steps > 1:
+            self.config.set_gradient_accumulation_steps(workload.accumulation_steps)
+        if workload.configure_graph is not None:
+            workload.configure_graph(self)
+
+    def build(self, *inputs):
+        loss = self.module(*inputs)
+        loss.backward()
+        return loss
+
+
+def make_train_step(workload, mode):
+    """Returns a function running one training step of `workload` in `mode`."""
+    if mode == "graph":
+        graph = TrainGraph(workload)
+        return lambda: graph(*workload.inputs)
+    if mode != "eager":
+        raise ValueError("unknown mode: {}".format(mode))
+    if workload.amp:
+        raise ValueError("amp is only supported in graph mode")
+    module = workload.module
+    optimizer = workload.optimizer
+
+    def step():
+        loss = module(*workload.inputs)
+        loss.backward()
+        optimizer.step()
+        optimizer.zero_grad()
+        return loss
+
+    return step
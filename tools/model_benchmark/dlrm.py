@@ -0,0 +1,123 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# DLRM on Criteo shaped synthetic samples. The sparse features are looked up from a one
+# embedding store, an LRU cache on the device in front of a PersistentTable under
+# --embedding_dir, which is trained offline: the lookup has no gradient, only the dense
+# MLPs are trained with SGD.
+import json
+import shutil
+import tempfile
+
+import oneflow as flow
+import oneflow.nn as nn
+
+from common import Workload
+
+NUM_DENSE_FEATURES = 13
+NUM_SPARSE_FEATURES = 26
+
+
+def _mlp(sizes):
+    layers = []
+    for i in range(len(sizes) - 1):
+        layers.append(nn.Linear(sizes[i], sizes[i + 1]))
+        if i + 2 < len(sizes):
+            layers.append(nn.ReLU())
+    return nn.Sequential(*layers)
+
+
+class DLRM(nn.Module):
+    def __init__(self, embedding_size, key_value_store_options):
+        super().__init__()
+        self.key_value_store_options = key_value_store_options
+        self.bottom_mlp = _mlp([NUM_DENSE_FEATURES, 512, 256, embedding_size])
+        num_features = NUM_SPARSE_FEATURES + 1
+        self.top_mlp = _mlp([num_features * num_features, 1024, 1024, 512, 256, 1])
+        self.loss = nn.BCEWithLogitsLoss()
+
+    def _lookup(self, ids, column_ids):
+        (
+            num_unique_matrix,
+            inverse_unique_partition_indices,
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            _,
+            cur_rank_inverse_indices,
+        ) = flow._C.one_embedding_id_shuffle(ids, column_ids, NUM_SPARSE_FEATURES)
+        return flow._C.one_embedding_lookup_shuffle(
+            num_unique_matrix,
+            cur_rank_num_unique,
+            cur_rank_unique_ids,
+            cur_rank_inverse_indices,
+            inverse_unique_partition_indices,
+            self.key_value_store_options,
+        )
+
+    def forward(self, dense_features, ids, column_ids, labels):
+        dense = self.bottom_mlp(dense_features)
+        sparse = self._lookup(ids, column_ids)
+        # Dot interaction of all the features, pairs included twice.
+        features = flow.cat([dense.unsqueeze(1), sparse], dim=1)
+        interaction = flow._C.matmul(features, features, transpose_b=True)
+        logits = self.top_mlp(flow.flatten(interaction, 1))
+        return self.loss(logits, labels)
+
+
+def build(args, scale, mode):
+    batch_size = scale["batch_size"]
+    embedding_size = scale["embedding_size"]
+    embedding_dir = tempfile.mkdtemp(prefix="dlrm_embedding_", dir=args.embedding_dir)
+    key_value_store_options = json.dumps(
+        {
+            "name": "dlrm_{}_{}".format(mode, embedding_size),
+            "key_size": 8,
+            "value_size": embedding_size * 4,
+            "caches": [
+                {
+                    "policy": "lru",
+                    "capacity": scale["cache_capacity"],
+                    "value_memory_kind": "device",
+                }
+            ],
+            "persistent_table": {"path": embedding_dir, "physical_block_size": 4096},
+        }
+    )
+    model = DLRM(embedding_size, key_value_store_options).to("cuda")
+    # The ids of a column are offset so that the columns share one store.
+    num_embeddings = scale["num_embeddings_per_column"]
+    column_ids = flow.arange(NUM_SPARSE_FEATURES, device="cuda").expand(
+        batch_size, NUM_SPARSE_FEATURES
+    )
+    ids = flow.randint(
+        0, num_embeddings, (batch_size, NUM_SPARSE_FEATURES), device="cuda"
+    )
+    inputs = (
+        flow.randn(batch_size, NUM_DENSE_FEATURES, device="cuda"),
+        ids + column_ids * num_embeddings,
+        column_ids.to(flow.int32),
+        flow.randint(0, 2, (batch_size, 1), device="cuda").to(flow.float),
+    )
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.1)
+    info = dict(scale, data="synthetic")
+    del info["nproc"]
+    return Workload(
+        model,
+        optimizer,
+        inputs,
+        samples_per_step=batch_size,
+        info=info,
+        cleanup=lambda: shutil.rmtree(embedding_dir, ignore_errors=True),
+    )
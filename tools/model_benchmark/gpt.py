@@ -0,0 +1,155 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# GPT trained with AdamW on synthetic tokens, with tensor parallelism inside the
+# pipeline stages and pipeline parallelism across them. The ranks of stage i are
+# [i * tensor_parallel, (i + 1) * tensor_parallel). The attention and feed forward
+# weights of a stage are split over its ranks as in Megatron-LM. Graph mode pipelines
+# the micro batches of a step with AMP, eager mode runs the stages one after another
+# on the whole batch in float32.
+import oneflow as flow
+import oneflow.nn as nn
+
+from common import Workload
+from transformer import TransformerLayer
+
+VOCAB_SIZE = 50304
+
+
+class Stage(nn.Module):
+    def __init__(self, scale, placement, first, last, num_layers):
+        super().__init__()
+        hidden_size = scale["hidden_size"]
+        self.placement = placement
+        self.first = first
+        self.last = last
+        broadcast = flow.sbp.broadcast
+        if first:
+            self.word_embedding = nn.Embedding(VOCAB_SIZE, hidden_size).to_global(
+                placement=placement, sbp=broadcast
+            )
+            self.position_embedding = nn.Embedding(
+                scale["seq_len"], hidden_size
+            ).to_global(placement=placement, sbp=broadcast)
+        self.layers = nn.ModuleList(
+            [
+                TransformerLayer(
+                    hidden_size,
+                    scale["num_heads"],
+                    causal=True,
+                    pre_norm=True,
+                    placement=placement,
+                )
+                for _ in range(num_layers)
+            ]
+        )
+        if last:
+            self.norm = nn.LayerNorm(hidden_size).to_global(
+                placement=placement, sbp=broadcast
+            )
+            self.head = nn.Linear(hidden_size, VOCAB_SIZE, bias=False).to_global(
+                placement=placement, sbp=flow.sbp.split(0)
+            )
+            self.loss = nn.CrossEntropyLoss()
+
+    def forward(self, x, labels=None):
+        x = x.to_global(placement=self.placement, sbp=flow.sbp.broadcast)
+        if self.first:
+            positions = flow.arange(
+                x.shape[1], placement=self.placement, sbp=flow.sbp.broadcast
+            ).unsqueeze(0)
+            x = self.word_embedding(x) + self.position_embedding(positions)
+        for layer in self.layers:
+            x = layer(x)
+        if not self.last:
+            return x
+        logits = self.head(self.norm(x))
+        labels = labels.to_global(placement=self.placement, sbp=flow.sbp.broadcast)
+        return self.loss(logits.reshape(-1, VOCAB_SIZE), labels.reshape(-1))
+
+
+class GPT(nn.Module):
+    def __init__(self, scale):
+        super().__init__()
+        tensor_parallel = scale["tensor_parallel"]
+        num_stages = scale["pipeline_parallel"]
+        assert scale["num_layers"] % num_stages == 0
+        assert scale["num_heads"] % tensor_parallel == 0
+        stages = []
+        for i in range(num_stages):
+            ranks = list(range(i * tensor_parallel, (i + 1) * tensor_parallel))
+            placement = flow.placement("cuda", ranks=ranks)
+            stages.append(
+                Stage(
+                    scale,
+                    placement,
+                    first=i == 0,
+                    last=i == num_stages - 1,
+                    num_layers=scale["num_layers"] // num_stages,
+                )
+            )
+        self.stages = nn.ModuleList(stages)
+
+    def forward(self, tokens, labels):
+        x = tokens
+        for stage in self.stages[:-1]:
+            x = stage(x)
+        return self.stages[-1](x, labels)
+
+
+def _set_stage_ids(graph):
+    for i, stage in enumerate(graph.module.stages):
+        stage.config.stage_id = i
+
+
+def build(args, scale, mode):
+    world_size = flow.env.get_world_size()
+    num_ranks = scale["tensor_parallel"] * scale["pipeline_parallel"]
+    if world_size != num_ranks:
+        raise ValueError(
+            "gpt needs {} ranks, launched with {}".format(num_ranks, world_size)
+        )
+    model = GPT(scale)
+    accumulation_steps = scale["num_micro_batches"] if mode == "graph" else 1
+    batch_size = scale["micro_batch_size"] * scale["num_micro_batches"]
+    first_placement = model.stages[0].placement
+    tokens = flow.randint(
+        0,
+        VOCAB_SIZE,
+        (batch_size, scale["seq_len"]),
+        placement=first_placement,
+        sbp=flow.sbp.broadcast,
+    )
+    labels = flow.randint(
+        0,
+        VOCAB_SIZE,
+        (batch_size, scale["seq_len"]),
+        placement=model.stages[-1].placement,
+        sbp=flow.sbp.broadcast,
+    )
+    optimizer = flow.optim.AdamW(model.parameters(), lr=1e-4, weight_decay=0.01)
+    info = dict(scale, batch_size=batch_size)
+    del info["nproc"]
+    info["data"] = "synthetic"
+    return Workload(
+        model,
+        optimizer,
+        (tokens, labels),
+        samples_per_step=batch_size,
+        amp=mode == "graph",
+        accumulation_steps=accumulation_steps,
+        configure_graph=_set_stage_ids,
+        info=info,
+    )
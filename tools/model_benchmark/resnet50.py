@@ -0,0 +1,151 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# ResNet-50 trained with SGD on ImageNet sized images. With --data_dir the images come
+# from OFRecords through the reader and the nvJPEG decoder, as in production, otherwise
+# from a synthetic batch resident on the device.
+import oneflow as flow
+import oneflow.nn as nn
+
+from common import Workload
+
+IMAGE_SIZE = 224
+NUM_CLASSES = 1000
+
+
+class Bottleneck(nn.Module):
+    def __init__(self, in_channels, channels, stride):
+        super().__init__()
+        out_channels = channels * 4
+        self.conv1 = nn.Conv2d(in_channels, channels, 1, bias=False)
+        self.bn1 = nn.BatchNorm2d(channels)
+        self.conv2 = nn.Conv2d(channels, channels, 3, stride, 1, bias=False)
+        self.bn2 = nn.BatchNorm2d(channels)
+        self.conv3 = nn.Conv2d(channels, out_channels, 1, bias=False)
+        self.bn3 = nn.BatchNorm2d(out_channels)
+        self.relu = nn.ReLU()
+        self.downsample = None
+        if stride != 1 or in_channels != out_channels:
+            self.downsample = nn.Sequential(
+                nn.Conv2d(in_channels, out_channels, 1, stride, bias=False),
+                nn.BatchNorm2d(out_channels),
+            )
+
+    def forward(self, x):
+        identity = x if self.downsample is None else self.downsample(x)
+        out = self.relu(self.bn1(self.conv1(x)))
+        out = self.relu(self.bn2(self.conv2(out)))
+        out = self.bn3(self.conv3(out))
+        return self.relu(out + identity)
+
+
+class ResNet50(nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.stem = nn.Sequential(
+            nn.Conv2d(3, 64, 7, 2, 3, bias=False),
+            nn.BatchNorm2d(64),
+            nn.ReLU(),
+            nn.MaxPool2d(3, 2, 1),
+        )
+        layers = []
+        in_channels = 64
+        for channels, num_blocks, stride in [
+            (64, 3, 1),
+            (128, 4, 2),
+            (256, 6, 2),
+            (512, 3, 2),
+        ]:
+            for i in range(num_blocks):
+                block_stride = stride if i == 0 else 1
+                layers.append(Bottleneck(in_channels, channels, block_stride))
+                in_channels = channels * 4
+        self.layers = nn.Sequential(*layers)
+        self.pool = nn.AdaptiveAvgPool2d((1, 1))
+        self.fc = nn.Linear(in_channels, NUM_CLASSES)
+
+    def forward(self, x):
+        x = self.pool(self.layers(self.stem(x)))
+        return self.fc(flow.flatten(x, 1))
+
+
+class OFRecordImageNet(nn.Module):
+    def __init__(self, data_dir, batch_size, data_part_num):
+        super().__init__()
+        self.reader = nn.OFRecordReader(
+            data_dir,
+            batch_size=batch_size,
+            data_part_num=data_part_num,
+            part_name_suffix_length=5,
+            random_shuffle=True,
+            shuffle_after_epoch=True,
+        )
+        self.label_decoder = nn.OFRecordRawDecoder(
+            "class/label", shape=(), dtype=flow.int32
+        )
+        self.bytes_decoder = nn.OFRecordBytesDecoder("encoded")
+        self.image_decoder = nn.OFRecordImageGpuDecoderRandomCropResize(
+            target_width=IMAGE_SIZE, target_height=IMAGE_SIZE, num_workers=3
+        )
+        self.flip = nn.CoinFlip(batch_size=batch_size)
+        self.crop_mirror_norm = nn.CropMirrorNormalize(
+            color_space="RGB",
+            output_layout="NCHW",
+            mean=[123.68, 116.779, 103.939],
+            std=[58.393, 57.12, 57.375],
+            output_dtype=flow.float,
+        )
+
+    def forward(self):
+        record = self.reader()
+        label = self.label_decoder(record)
+        image = self.image_decoder(self.bytes_decoder(record))
+        image = self.crop_mirror_norm(image, self.flip().to("cuda"))
+        return image, label.to("cuda")
+
+
+class TrainModule(nn.Module):
+    def __init__(self, model, data=None):
+        super().__init__()
+        self.model = model
+        self.data = data
+        self.loss = nn.CrossEntropyLoss()
+
+    def forward(self, *inputs):
+        image, label = self.data() if self.data is not None else inputs
+        return self.loss(self.model(image), label)
+
+
+def build(args, scale, mode):
+    batch_size = scale["batch_size"]
+    model = ResNet50().to("cuda")
+    info = {"batch_size": batch_size}
+    if args.data_dir:
+        module = TrainModule(
+            model, OFRecordImageNet(args.data_dir, batch_size, args.data_part_num)
+        )
+        inputs = ()
+        info["data"] = "ofrecord"
+    else:
+        module = TrainModule(model)
+        inputs = (
+            flow.randn(batch_size, 3, IMAGE_SIZE, IMAGE_SIZE, device="cuda"),
+            flow.randint(0, NUM_CLASSES, (batch_size,), device="cuda"),
+        )
+        info["data"] = "synthetic"
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.1, momentum=0.9)
+    return Workload(
+        module, optimizer, inputs, samples_per_step=batch_size, info=info
+    )
@@ -0,0 +1,223 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# The end-to-end model benchmark suite: ResNet-50 with the OFRecord and nvJPEG pipeline,
+# BERT with AMP, DLRM with one embedding and a PersistentTable, and GPT with tensor and
+# pipeline parallelism, each trained in eager and nn.Graph modes at the scales of
+# scales.py. Every case runs in its own processes through benchmark_case.py, which
+# documents the metrics, and the records are written as one json document.
+#
+# With --baseline, a json document written before, each metric of a case is compared to
+# the baseline of the same case and a change for the worse beyond the tolerance of the
+# metric is reported as a regression, as is a case which no longer runs. The exit status
+# is 1 when there is a regression, so that a release is not cut over one.
+#
+#   python3 tools/model_benchmark/run_benchmarks.py --scale small --output base.json
+#   python3 tools/model_benchmark/run_benchmarks.py --scale small --output new.json \
+#       --baseline base.json
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+from scales import SCALES
+
+_DIR = os.path.dirname(os.path.abspath(__file__))
+MODES = ("eager", "graph")
+
+# Name, whether higher is better, tolerance relative to the baseline. The tails of the
+# latency and the one-off times are noisier than the throughput.
+METRICS = [
+    ("throughput_samples_per_s", True, 0.05),
+    ("latency_p50_ms", False, 0.05),
+    ("latency_p90_ms", False, 0.10),
+    ("latency_p99_ms", False, 0.20),
+    ("peak_allocated_bytes", False, 0.02),
+    ("peak_reserved_bytes", False, 0.05),
+    ("device_used_bytes", False, 0.05),
+    ("compile_s", False, 0.20),
+    ("startup_s", False, 0.20),
+]
+
+
+def _num_gpus():
+    try:
+        output = subprocess.check_output(["nvidia-smi", "-L"], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError):
+        return 0
+    return len([line for line in output.splitlines() if line.startswith("GPU ")])
+
+
+def _oneflow_version():
+    output = subprocess.check_output(
+        [
+            sys.executable,
+            "-c",
+            "import oneflow; print(oneflow.__version__); print(oneflow.__git_commit__)",
+        ],
+        universal_newlines=True,
+    )
+    version, git_commit = output.strip().splitlines()[-2:]
+    return version, git_commit
+
+
+def _case_key(record):
+    return (record["model"], record["mode"], record["scale"])
+
+
+def run_case(args, model, mode, nproc):
+    record = {"model": model, "mode": mode, "scale": args.scale, "world_size": nproc}
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        output = os.path.join(tmp_dir, "record.json")
+        command = [os.path.join(_DIR, "benchmark_case.py")]
+        command += ["--model", model, "--mode", mode, "--scale", args.scale]
+        command += ["--warmup", str(args.warmup), "--iters", str(args.iters)]
+        command += ["--latency_iters", str(args.latency_iters), "--output", output]
+        if args.data_dir:
+            command += ["--data_dir", args.data_dir]
+            command += ["--data_part_num", str(args.data_part_num)]
+        if args.embedding_dir:
+            command += ["--embedding_dir", args.embedding_dir]
+        if nproc > 1:
+            launch = ["-m", "oneflow.distributed.launch"]
+            command = launch + ["--nproc_per_node", str(nproc)] + command
+        env = dict(os.environ, MODEL_BENCHMARK_LAUNCH_TIME=repr(time.time()))
+        process = subprocess.run(
+            [sys.executable] + command,
+            cwd=_DIR,
+            env=env,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            universal_newlines=True,
+            timeout=args.timeout,
+        )
+        if process.returncode != 0 or not os.path.exists(output):
+            record["status"] = "error"
+            record["error"] = "\n".join(process.stdout.splitlines()[-20:])
+            return record
+        with open(output) as f:
+            record = json.load(f)
+    record["status"] = "ok"
+    return record
+
+
+def compare(records, baseline_records):
+    key2baseline = {_case_key(record): record for record in baseline_records}
+    regressions = []
+    for record in records:
+        baseline = key2baseline.get(_case_key(record))
+        # Cases skipped for lack of devices are not compared either.
+        if baseline is None or baseline["status"] != "ok":
+            continue
+        if record["status"] == "skipped":
+            continue
+        if record["status"] != "ok":
+            regression = {"case": _case_key(record), "metric": "status"}
+            regression["value"] = record["status"]
+            regressions.append(regression)
+            continue
+        for name, higher_is_better, tolerance in METRICS:
+            value = record["metrics"].get(name)
+            base = baseline["metrics"].get(name)
+            if value is None or base is None or base == 0:
+                continue
+            change = (value - base) / float(base)
+            if (-change if higher_is_better else change) > tolerance:
+                regressions.append(
+                    {
+                        "case": _case_key(record),
+                        "metric": name,
+                        "value": value,
+                        "baseline": base,
+                        "change": change,
+                    }
+                )
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--models", type=str, default=",".join(sorted(SCALES)))
+    parser.add_argument("--modes", type=str, default=",".join(MODES))
+    parser.add_argument("--scale", type=str, default="small")
+    parser.add_argument("--warmup", type=int, default=10)
+    parser.add_argument("--iters", type=int, default=50)
+    parser.add_argument("--latency_iters", type=int, default=50)
+    parser.add_argument("--data_dir", type=str, default=None)
+    parser.add_argument("--data_part_num", type=int, default=1)
+    parser.add_argument("--embedding_dir", type=str, default=None)
+    parser.add_argument(
+        "--timeout", type=float, default=3600, help="Seconds a case may take."
+    )
+    parser.add_argument("--baseline", type=str, default=None)
+    parser.add_argument(
+        "--output", type=str, default=None, help="File the json is written to."
+    )
+    args = parser.parse_args()
+    num_gpus = _num_gpus()
+    version, git_commit = _oneflow_version()
+    records = []
+    for model in args.models.split(","):
+        if args.scale not in SCALES[model]:
+            continue
+        nproc = SCALES[model][args.scale]["nproc"]
+        for mode in args.modes.split(","):
+            if nproc > num_gpus:
+                record = {"model": model, "mode": mode, "scale": args.scale}
+                record["status"] = "skipped"
+                record["error"] = "needs {} gpus, {} found".format(nproc, num_gpus)
+            else:
+                try:
+                    record = run_case(args, model, mode, nproc)
+                except subprocess.TimeoutExpired:
+                    record = {"model": model, "mode": mode, "scale": args.scale}
+                    record["status"] = "error"
+                    record["error"] = "timed out"
+            print(
+                "{} {} {}: {}".format(model, mode, args.scale, record["status"]),
+                file=sys.stderr,
+            )
+            records.append(record)
+    result = {
+        "oneflow_version": version,
+        "git_commit": git_commit,
+        "host": platform.node(),
+        "num_gpus": num_gpus,
+        "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "cases": records,
+    }
+    if args.baseline is not None:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        result["baseline_git_commit"] = baseline.get("git_commit")
+        result["regressions"] = compare(records, baseline["cases"])
+        for regression in result["regressions"]:
+            print("regression: {}".format(json.dumps(regression)), file=sys.stderr)
+    content = json.dumps(result, indent=2)
+    if args.output is None:
+        print(content)
+    else:
+        with open(args.output, "w") as f:
+            f.write(content + "\n")
+    if result.get("regressions"):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
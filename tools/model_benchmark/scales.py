@@ -0,0 +1,81 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# The scales the models of the benchmark suite are trained at. nproc is the number of
+# ranks, each with a device, "small" is sized for a quick run on few devices and "full"
+# for the production scale of each model. Kept apart from the models so that
+# run_benchmarks.py can plan the cases without importing oneflow.
+SCALES = {
+    "resnet50": {
+        "small": {"nproc": 1, "batch_size": 32},
+        "full": {"nproc": 1, "batch_size": 192},
+    },
+    "bert": {
+        "small": {
+            "nproc": 1,
+            "batch_size": 16,
+            "num_layers": 2,
+            "hidden_size": 256,
+            "num_heads": 4,
+        },
+        "full": {
+            "nproc": 1,
+            "batch_size": 64,
+            "num_layers": 12,
+            "hidden_size": 768,
+            "num_heads": 12,
+        },
+    },
+    "dlrm": {
+        "small": {
+            "nproc": 1,
+            "batch_size": 2048,
+            "embedding_size": 16,
+            "num_embeddings_per_column": 100000,
+            "cache_capacity": 1 << 20,
+        },
+        "full": {
+            "nproc": 1,
+            "batch_size": 55296,
+            "embedding_size": 128,
+            "num_embeddings_per_column": 4000000,
+            "cache_capacity": 1 << 24,
+        },
+    },
+    "gpt": {
+        "small": {
+            "nproc": 4,
+            "tensor_parallel": 2,
+            "pipeline_parallel": 2,
+            "micro_batch_size": 4,
+            "num_micro_batches": 4,
+            "num_layers": 4,
+            "hidden_size": 512,
+            "num_heads": 8,
+            "seq_len": 256,
+        },
+        "full": {
+            "nproc": 8,
+            "tensor_parallel": 2,
+            "pipeline_parallel": 4,
+            "micro_batch_size": 8,
+            "num_micro_batches": 16,
+            "num_layers": 24,
+            "hidden_size": 2048,
+            "num_heads": 16,
+            "seq_len": 1024,
+        },
+    },
+}
@@ -0,0 +1,141 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# Transformer layers shared by BERT and GPT. The linear layers are made by `Linear`, so
+# that GPT can split them across the ranks for tensor parallelism.
+import math
+
+import oneflow as flow
+import oneflow.nn as nn
+
+
+class Linear(nn.Module):
+    """A linear layer over the last axis of `x`.
+
+    With a placement, the weight is split along its outputs (split_axis 0, column
+    parallel) or its inputs (split_axis 1, row parallel) over the ranks of the
+    placement.
+    """
+
+    def __init__(self, in_features, out_features, placement=None, split_axis=None):
+        super().__init__()
+        if placement is None:
+            self.weight = nn.Parameter(
+                flow.empty(out_features, in_features, device="cuda")
+            )
+            self.bias = nn.Parameter(flow.zeros(out_features, device="cuda"))
+        else:
+            weight_sbp = flow.sbp.broadcast
+            bias_sbp = flow.sbp.broadcast
+            if split_axis is not None:
+                weight_sbp = flow.sbp.split(split_axis)
+                if split_axis == 0:
+                    bias_sbp = flow.sbp.split(0)
+            self.weight = nn.Parameter(
+                flow.empty(
+                    out_features, in_features, placement=placement, sbp=weight_sbp
+                )
+            )
+            self.bias = nn.Parameter(
+                flow.zeros(out_features, placement=placement, sbp=bias_sbp)
+            )
+        nn.init.normal_(self.weight, std=0.02)
+
+    def forward(self, x):
+        shape = x.shape
+        y = flow._C.matmul(x.reshape(-1, shape[-1]), self.weight, transpose_b=True)
+        return (y + self.bias).reshape(*shape[:-1], -1)
+
+
+class SelfAttention(nn.Module):
+    def __init__(self, hidden_size, num_heads, causal, placement=None):
+        super().__init__()
+        self.num_heads = num_heads
+        self.head_size = hidden_size // num_heads
+        self.causal = causal
+        split_axis = 0 if placement is not None else None
+        self.query = Linear(hidden_size, hidden_size, placement, split_axis)
+        self.key = Linear(hidden_size, hidden_size, placement, split_axis)
+        self.value = Linear(hidden_size, hidden_size, placement, split_axis)
+        self.dense = Linear(
+            hidden_size, hidden_size, placement, 1 if placement is not None else None
+        )
+
+    def _split_heads(self, x):
+        batch_size, seq_len = x.shape[0], x.shape[1]
+        x = x.reshape(batch_size, seq_len, self.num_heads, self.head_size)
+        return x.permute(0, 2, 1, 3)
+
+    def forward(self, x, mask=None):
+        batch_size, seq_len, hidden_size = x.shape
+        query = self._split_heads(self.query(x))
+        key = self._split_heads(self.key(x))
+        value = self._split_heads(self.value(x))
+        scores = flow._C.matmul(query, key, transpose_b=True)
+        scale = 1.0 / math.sqrt(self.head_size)
+        if self.causal:
+            scores = flow._C.fused_scale_tril(
+                scores, diagonal=0, fill_value=-10000.0, scale=scale
+            )
+        else:
+            scores = scores * scale
+        if mask is not None:
+            scores = scores + mask
+        context = flow._C.matmul(flow.softmax(scores, dim=-1), value)
+        context = context.permute(0, 2, 1, 3).reshape(batch_size, seq_len, hidden_size)
+        return self.dense(context)
+
+
+class FeedForward(nn.Module):
+    def __init__(self, hidden_size, intermediate_size, placement=None):
+        super().__init__()
+        parallel = placement is not None
+        self.dense_in = Linear(
+            hidden_size, intermediate_size, placement, 0 if parallel else None
+        )
+        self.gelu = nn.GELU()
+        self.dense_out = Linear(
+            intermediate_size, hidden_size, placement, 1 if parallel else None
+        )
+
+    def forward(self, x):
+        return self.dense_out(self.gelu(self.dense_in(x)))
+
+
+class TransformerLayer(nn.Module):
+    """Post layer norm as in BERT, or pre layer norm as in GPT."""
+
+    def __init__(
+        self, hidden_size, num_heads, causal, pre_norm, dropout=0.1, placement=None
+    ):
+        super().__init__()
+        self.pre_norm = pre_norm
+        self.attention = SelfAttention(hidden_size, num_heads, causal, placement)
+        self.feed_forward = FeedForward(hidden_size, hidden_size * 4, placement)
+        self.attention_norm = nn.LayerNorm(hidden_size)
+        self.feed_forward_norm = nn.LayerNorm(hidden_size)
+        self.dropout = nn.Dropout(dropout)
+        if placement is not None:
+            self.attention_norm.to_global(placement=placement, sbp=flow.sbp.broadcast)
+            self.feed_forward_norm.to_global(
+                placement=placement, sbp=flow.sbp.broadcast
+            )
+
+    def forward(self, x, mask=None):
+        if self.pre_norm:
+            x = x + self.dropout(self.attention(self.attention_norm(x), mask))
+            return x + self.dropout(self.feed_forward(self.feed_forward_norm(x)))
+        x = self.attention_norm(x + self.dropout(self.attention(x, mask)))
+        return self.feed_forward_norm(x + self.dropout(self.feed_forward(x)))
@@ -0,0 +1,77 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# Measures the host time per call of a small nn.Graph holding many parameters, which is
+# dominated by RunLazyNNGraph: the input and output meta checks, the parameter blob list
+# and the instructions launching the job. The record is printed as json.
+import argparse
+import json
+import time
+
+import oneflow as flow
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--device", type=str, default="cuda")
+parser.add_argument("--num_layers", type=int, default=100)
+parser.add_argument("--iters", type=int, default=1000)
+parser.add_argument("--warmup", type=int, default=100)
+parser.add_argument(
+    "--output", type=str, default=None, help="File the json is written to."
+)
+args = parser.parse_args()
+
+
+class TinyGraph(flow.nn.Graph):
+    def __init__(self, model):
+        super().__init__()
+        self.model = model
+
+    def build(self, x):
+        return self.model(x)
+
+
+def main():
+    layers = [flow.nn.Linear(2, 2) for _ in range(args.num_layers)]
+    model = flow.nn.Sequential(*layers).to(args.device)
+    graph = TinyGraph(model)
+    x = flow.ones(2, 2, device=args.device)
+    for _ in range(args.warmup):
+        graph(x)
+    flow._oneflow_internal.eager.Sync()
+    # The calls return once the job is launched, the sync at the end bounds the device
+    # time which the host time per call is compared to.
+    start = time.perf_counter()
+    for _ in range(args.iters):
+        graph(x)
+    host_us = (time.perf_counter() - start) * 1e6 / args.iters
+    flow._oneflow_internal.eager.Sync()
+    total_us = (time.perf_counter() - start) * 1e6 / args.iters
+    record = {
+        "device": args.device,
+        "num_parameters": len(list(model.parameters())),
+        "iters": args.iters,
+        "host_us_per_call": host_us,
+        "total_us_per_call": total_us,
+    }
+    content = json.dumps(record, indent=2)
+    if args.output is None:
+        print(content)
+    else:
+        with open(args.output, "w") as f:
+            f.write(content + "\n")
+
+
+if __name__ == "__main__":
+    main()